@@ -36,8 +36,10 @@ CHAR strAssocHelpText[] =
         "Display or edit file associations.\n"
         "\n"
         "ASSOC [-license] [-m|-s|-u] [.ext[=[filetype]]]\n"
+        "ASSOC -c [-m|-s|-u]\n"
         "ASSOC -t [-m|-s|-u] [filetype[=[openCommandString]]]\n"
         "\n"
+        "   -c             Display the open command for each extension\n"
         "   -m             Display the contents from the merged system and user registry\n"
         "   -s             Display or update the contents from the system registry\n"
         "   -t             Display or update file types instead of extension associations\n"
@@ -354,95 +356,308 @@ AssocDisplaySingleFileType(
 }
 
 /**
- Display the file types of all extensions underneath the specified registry
- key.
+ An extension or file type found when enumerating a registry scope.
+ */
+typedef struct _ASSOC_INDEX_ENTRY {
 
- @param RootKey Specifies the registry key to enumerate.
+    /**
+     Links this entry into the list of extensions or file types in the index,
+     in the order they were enumerated.
+     */
+    YORI_LIST_ENTRY ListEntry;
 
- @return TRUE to indicate success, FALSE to indicate failure.
+    /**
+     Links this entry into the hash table of file types in the index.  This
+     is only used for file types.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The extension, including initial period, or the file type.
+     */
+    YORI_STRING Name;
+
+    /**
+     For an extension, the file type.  For a file type, the open command.
+     */
+    YORI_STRING Value;
+
+} ASSOC_INDEX_ENTRY, *PASSOC_INDEX_ENTRY;
+
+/**
+ The number of hash buckets to use for file types in an index.
+ */
+#define ASSOC_INDEX_HASH_BUCKETS (1000)
+
+/**
+ The extensions and file types within a registry scope, loaded in a single
+ pass so that an extension can be resolved to a command without further
+ registry access.
+ */
+typedef struct _ASSOC_INDEX {
+
+    /**
+     The list of extensions in the index.
+     */
+    YORI_LIST_ENTRY Extensions;
+
+    /**
+     The list of file types in the index.
+     */
+    YORI_LIST_ENTRY FileTypes;
+
+    /**
+     A hash table of file types, or NULL if file types were not loaded.
+     */
+    PYORI_HASH_TABLE FileTypeHash;
+
+} ASSOC_INDEX, *PASSOC_INDEX;
+
+/**
+ Read the default value of a registry key into a caller supplied buffer,
+ reallocating the buffer if it is too small.  The buffer is retained across
+ calls so that enumerating many keys does not allocate for each.
+
+ @param ParentKey The parent of the key to read.
+
+ @param SubKey The name of the key to read, relative to ParentKey.
+
+ @param Buffer On input, a buffer which may be used to hold the value.  On
+        successful completion, contains the value.
+
+ @return TRUE to indicate the value was read, FALSE if it was not found or
+         could not be read.
  */
 __success(return)
 BOOLEAN
-AssocEnumerateAssociations(
-    __in HKEY RootKey
+AssocReadDefaultValue(
+    __in HKEY ParentKey,
+    __in LPCTSTR SubKey,
+    __inout PYORI_STRING Buffer
     )
 {
     DWORD Error;
-    DWORD Index;
-    YORI_STRING KeyName;
-    DWORD KeyNameSize;
-    FILETIME LastWritten;
+    DWORD KeyValueSize;
+    DWORD KeyType;
+    HKEY ThisKey;
+
+    Buffer->LengthInChars = 0;
 
-    if (!YoriLibAllocateString(&KeyName, 1024)) {
+    Error = DllAdvApi32.pRegOpenKeyExW(ParentKey, SubKey, 0, KEY_QUERY_VALUE, &ThisKey);
+    if (Error != ERROR_SUCCESS) {
         return FALSE;
     }
 
-    Index = 0;
-    while (TRUE) {
-
-        KeyNameSize = KeyName.LengthAllocated;
-        Error = DllAdvApi32.pRegEnumKeyExW(RootKey, Index, KeyName.StartOfString, &KeyNameSize, NULL, NULL, NULL, &LastWritten);
+    while(TRUE) {
+        KeyValueSize = Buffer->LengthAllocated * sizeof(TCHAR);
+        Error = DllAdvApi32.pRegQueryValueExW(ThisKey, _T(""), NULL, &KeyType, (LPBYTE)Buffer->StartOfString, &KeyValueSize);
 
-        if (Error == ERROR_NO_MORE_ITEMS) {
+        if (Error != ERROR_MORE_DATA) {
             break;
         }
 
-        if (Error == ERROR_MORE_DATA) {
-            KeyNameSize = KeyName.LengthAllocated * 2;
-            YoriLibFreeStringContents(&KeyName);
-            if (KeyNameSize > 0x40000) {
-                break;
-            }
-            if (!YoriLibIsSizeAllocatable(KeyNameSize) ||
-                !YoriLibAllocateString(&KeyName, (YORI_ALLOC_SIZE_T)KeyNameSize)) {
-                break;
-            }
-            continue;
-        }
+        YoriLibFreeStringContents(Buffer);
+        if (!YoriLibIsSizeAllocatable(KeyValueSize) ||
+            !YoriLibAllocateString(Buffer, (YORI_ALLOC_SIZE_T)KeyValueSize)) {
 
-        if (Error != ERROR_SUCCESS) {
             break;
         }
+    }
 
-        KeyName.LengthInChars = (YORI_ALLOC_SIZE_T)KeyNameSize;
-        if (KeyName.LengthInChars >= 2 && KeyName.StartOfString[0] == '.') {
-            AssocDisplaySingleAssociation(RootKey, &KeyName);
-        }
-        Index++;
+    DllAdvApi32.pRegCloseKey(ThisKey);
+
+    if (Error != ERROR_SUCCESS) {
+        return FALSE;
+    }
+
+    Buffer->LengthInChars = (YORI_ALLOC_SIZE_T)(KeyValueSize / sizeof(TCHAR));
+    if (Buffer->LengthInChars > 0 &&
+        Buffer->StartOfString[Buffer->LengthInChars - 1] == '\0') {
+
+        Buffer->LengthInChars--;
     }
 
-    YoriLibFreeStringContents(&KeyName);
     return TRUE;
 }
 
 /**
- Display the file types underneath the specified registry key.
+ Add an extension or file type to an index.
+
+ @param Index Pointer to the index.
+
+ @param Name The extension or file type.
+
+ @param Value For an extension, the file type.  For a file type, the open
+        command.
+
+ @param IsFileType TRUE if the entry is a file type, FALSE if it is an
+        extension.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+AssocAddIndexEntry(
+    __inout PASSOC_INDEX Index,
+    __in PYORI_STRING Name,
+    __in PYORI_STRING Value,
+    __in BOOLEAN IsFileType
+    )
+{
+    PASSOC_INDEX_ENTRY Entry;
+    YORI_ALLOC_SIZE_T SizeNeeded;
+
+    SizeNeeded = sizeof(ASSOC_INDEX_ENTRY) + (Name->LengthInChars + 1 + Value->LengthInChars + 1) * sizeof(TCHAR);
+    Entry = YoriLibReferencedMalloc(SizeNeeded);
+    if (Entry == NULL) {
+        return FALSE;
+    }
+
+    Entry->Name.StartOfString = (LPTSTR)(Entry + 1);
+    Entry->Name.LengthInChars = Name->LengthInChars;
+    Entry->Name.LengthAllocated = Name->LengthInChars + 1;
+    Entry->Name.MemoryToFree = NULL;
+    memcpy(Entry->Name.StartOfString, Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+    Entry->Name.StartOfString[Name->LengthInChars] = '\0';
+
+    Entry->Value.StartOfString = Entry->Name.StartOfString + Entry->Name.LengthAllocated;
+    Entry->Value.LengthInChars = Value->LengthInChars;
+    Entry->Value.LengthAllocated = Value->LengthInChars + 1;
+    Entry->Value.MemoryToFree = NULL;
+    memcpy(Entry->Value.StartOfString, Value->StartOfString, Value->LengthInChars * sizeof(TCHAR));
+    Entry->Value.StartOfString[Value->LengthInChars] = '\0';
+
+    if (IsFileType) {
+        YoriLibAppendList(&Index->FileTypes, &Entry->ListEntry);
+        YoriLibHashInsertByKey(Index->FileTypeHash, &Entry->Name, Entry, &Entry->HashEntry);
+    } else {
+        YoriLibAppendList(&Index->Extensions, &Entry->ListEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Free all entries within an index.
+
+ @param Index Pointer to the index to free.
+ */
+VOID
+AssocCleanupIndex(
+    __inout PASSOC_INDEX Index
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PASSOC_INDEX_ENTRY Entry;
+
+    ListEntry = YoriLibGetNextListEntry(&Index->Extensions, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, ASSOC_INDEX_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Index->Extensions, ListEntry);
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibDereference(Entry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Index->FileTypes, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, ASSOC_INDEX_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Index->FileTypes, ListEntry);
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibHashRemoveByEntry(&Entry->HashEntry);
+        YoriLibDereference(Entry);
+    }
+
+    if (Index->FileTypeHash != NULL) {
+        YoriLibFreeEmptyHashTable(Index->FileTypeHash);
+        Index->FileTypeHash = NULL;
+    }
+}
+
+/**
+ Load the extensions and/or file types underneath a registry key into an
+ index.  This walks the key once, reusing the same buffers for every
+ subkey, so that a scope with thousands of entries doesn't perform an
+ allocation per entry, and so that later resolution of an extension to a
+ command can be performed from memory.
 
  @param RootKey Specifies the registry key to enumerate.
 
+ @param LoadExtensions TRUE if extensions and their file types should be
+        loaded.
+
+ @param LoadFileTypes TRUE if file types and their open commands should be
+        loaded.
+
+ @param Index On successful completion, populated with the extensions and
+        file types.  The caller should free this with
+        @ref AssocCleanupIndex .
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOLEAN
-AssocEnumerateFileTypes(
-    __in HKEY RootKey
+AssocBuildIndex(
+    __in HKEY RootKey,
+    __in BOOLEAN LoadExtensions,
+    __in BOOLEAN LoadFileTypes,
+    __out PASSOC_INDEX Index
     )
 {
     DWORD Error;
-    DWORD Index;
+    DWORD KeyIndex;
+    DWORD MaxSubKeyLength;
     YORI_STRING KeyName;
+    YORI_STRING KeyValue;
+    YORI_STRING SubKeyName;
     DWORD KeyNameSize;
     FILETIME LastWritten;
+    BOOLEAN Result;
+
+    YoriLibInitializeListHead(&Index->Extensions);
+    YoriLibInitializeListHead(&Index->FileTypes);
+    Index->FileTypeHash = NULL;
+
+    if (LoadFileTypes) {
+        Index->FileTypeHash = YoriLibAllocateHashTable(ASSOC_INDEX_HASH_BUCKETS);
+        if (Index->FileTypeHash == NULL) {
+            return FALSE;
+        }
+    }
+
+    //
+    //  If the system can report the longest subkey name, allocate a buffer
+    //  that can hold it so enumeration never needs to retry.
+    //
 
-    if (!YoriLibAllocateString(&KeyName, 1024)) {
+    MaxSubKeyLength = 1024;
+    if (DllAdvApi32.pRegQueryInfoKeyW != NULL) {
+        DWORD ReportedLength;
+        if (DllAdvApi32.pRegQueryInfoKeyW(RootKey, NULL, NULL, NULL, NULL, &ReportedLength, NULL, NULL, NULL, NULL, NULL, NULL) == ERROR_SUCCESS &&
+            ReportedLength + 1 > MaxSubKeyLength &&
+            ReportedLength < 0x40000) {
+
+            MaxSubKeyLength = ReportedLength + 1;
+        }
+    }
+
+    YoriLibInitEmptyString(&KeyValue);
+    YoriLibInitEmptyString(&SubKeyName);
+    if (!YoriLibAllocateString(&KeyName, (YORI_ALLOC_SIZE_T)MaxSubKeyLength) ||
+        !YoriLibAllocateString(&KeyValue, 1024) ||
+        !YoriLibAllocateString(&SubKeyName, (YORI_ALLOC_SIZE_T)(MaxSubKeyLength + sizeof("\\shell\\open\\command")))) {
+
+        YoriLibFreeStringContents(&KeyName);
+        YoriLibFreeStringContents(&KeyValue);
+        AssocCleanupIndex(Index);
         return FALSE;
     }
 
-    Index = 0;
+    Result = TRUE;
+    KeyIndex = 0;
     while (TRUE) {
 
         KeyNameSize = KeyName.LengthAllocated;
-        Error = DllAdvApi32.pRegEnumKeyExW(RootKey, Index, KeyName.StartOfString, &KeyNameSize, NULL, NULL, NULL, &LastWritten);
+        Error = DllAdvApi32.pRegEnumKeyExW(RootKey, KeyIndex, KeyName.StartOfString, &KeyNameSize, NULL, NULL, NULL, &LastWritten);
 
         if (Error == ERROR_NO_MORE_ITEMS) {
             break;
@@ -451,11 +666,13 @@ AssocEnumerateFileTypes(
         if (Error == ERROR_MORE_DATA) {
             KeyNameSize = KeyName.LengthAllocated * 2;
             YoriLibFreeStringContents(&KeyName);
+            YoriLibFreeStringContents(&SubKeyName);
             if (KeyNameSize > 0x40000) {
                 break;
             }
             if (!YoriLibIsSizeAllocatable(KeyNameSize) ||
-                !YoriLibAllocateString(&KeyName, (YORI_ALLOC_SIZE_T)KeyNameSize)) {
+                !YoriLibAllocateString(&KeyName, (YORI_ALLOC_SIZE_T)KeyNameSize) ||
+                !YoriLibAllocateString(&SubKeyName, (YORI_ALLOC_SIZE_T)(KeyNameSize + sizeof("\\shell\\open\\command")))) {
                 break;
             }
             continue;
@@ -466,13 +683,117 @@ AssocEnumerateFileTypes(
         }
 
         KeyName.LengthInChars = (YORI_ALLOC_SIZE_T)KeyNameSize;
-        if (KeyName.LengthInChars >= 1 && KeyName.StartOfString[0] != '.') {
-            AssocDisplaySingleFileType(RootKey, &KeyName);
+        if (KeyName.LengthInChars >= 2 && KeyName.StartOfString[0] == '.') {
+            if (LoadExtensions &&
+                AssocReadDefaultValue(RootKey, KeyName.StartOfString, &KeyValue) &&
+                KeyValue.LengthInChars > 0) {
+
+                if (!AssocAddIndexEntry(Index, &KeyName, &KeyValue, FALSE)) {
+                    Result = FALSE;
+                    break;
+                }
+            }
+        } else if (KeyName.LengthInChars >= 1 && LoadFileTypes) {
+            SubKeyName.LengthInChars = YoriLibSPrintf(SubKeyName.StartOfString, _T("%y\\shell\\open\\command"), &KeyName);
+            if (AssocReadDefaultValue(RootKey, SubKeyName.StartOfString, &KeyValue) &&
+                KeyValue.LengthInChars > 0) {
+
+                if (!AssocAddIndexEntry(Index, &KeyName, &KeyValue, TRUE)) {
+                    Result = FALSE;
+                    break;
+                }
+            }
         }
-        Index++;
+        KeyIndex++;
     }
 
     YoriLibFreeStringContents(&KeyName);
+    YoriLibFreeStringContents(&KeyValue);
+    YoriLibFreeStringContents(&SubKeyName);
+
+    if (!Result) {
+        AssocCleanupIndex(Index);
+    }
+
+    return Result;
+}
+
+/**
+ Display the file types of all extensions underneath the specified registry
+ key.
+
+ @param RootKey Specifies the registry key to enumerate.
+
+ @param ShowCommand If TRUE, display the command that opens each extension
+        instead of its file type.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+AssocEnumerateAssociations(
+    __in HKEY RootKey,
+    __in BOOLEAN ShowCommand
+    )
+{
+    ASSOC_INDEX Index;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_HASH_ENTRY HashEntry;
+    PASSOC_INDEX_ENTRY Entry;
+    PASSOC_INDEX_ENTRY FileType;
+
+    if (!AssocBuildIndex(RootKey, TRUE, ShowCommand, &Index)) {
+        return FALSE;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Index.Extensions, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, ASSOC_INDEX_ENTRY, ListEntry);
+        if (ShowCommand) {
+            HashEntry = YoriLibHashLookupByKey(Index.FileTypeHash, &Entry->Value);
+            if (HashEntry != NULL) {
+                FileType = HashEntry->Context;
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y=%y\n"), &Entry->Name, &FileType->Value);
+            }
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y=%y\n"), &Entry->Name, &Entry->Value);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Index.Extensions, ListEntry);
+    }
+
+    AssocCleanupIndex(&Index);
+    return TRUE;
+}
+
+/**
+ Display the file types underneath the specified registry key.
+
+ @param RootKey Specifies the registry key to enumerate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+AssocEnumerateFileTypes(
+    __in HKEY RootKey
+    )
+{
+    ASSOC_INDEX Index;
+    PYORI_LIST_ENTRY ListEntry;
+    PASSOC_INDEX_ENTRY Entry;
+
+    if (!AssocBuildIndex(RootKey, FALSE, TRUE, &Index)) {
+        return FALSE;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Index.FileTypes, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, ASSOC_INDEX_ENTRY, ListEntry);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y=%y\n"), &Entry->Name, &Entry->Value);
+        ListEntry = YoriLibGetNextListEntry(&Index.FileTypes, ListEntry);
+    }
+
+    AssocCleanupIndex(&Index);
     return TRUE;
 }
 
@@ -509,14 +830,14 @@ AssocOpenRegRootForScope(
 
     switch(Scope) {
         case AssocScopeSystem:
-            Error = DllAdvApi32.pRegOpenKeyExW(HKEY_LOCAL_MACHINE, _T("SOFTWARE\\Classes"), 0, KEY_ENUMERATE_SUB_KEYS, RootKey);
+            Error = DllAdvApi32.pRegOpenKeyExW(HKEY_LOCAL_MACHINE, _T("SOFTWARE\\Classes"), 0, KEY_ENUMERATE_SUB_KEYS | KEY_QUERY_VALUE, RootKey);
             *CloseKey = TRUE;
             break;
         case AssocScopeMerged:
             *RootKey = HKEY_CLASSES_ROOT;
             break;
         case AssocScopeUser:
-            Error = DllAdvApi32.pRegOpenKeyExW(HKEY_CURRENT_USER, _T("SOFTWARE\\Classes"), 0, KEY_ENUMERATE_SUB_KEYS, RootKey);
+            Error = DllAdvApi32.pRegOpenKeyExW(HKEY_CURRENT_USER, _T("SOFTWARE\\Classes"), 0, KEY_ENUMERATE_SUB_KEYS | KEY_QUERY_VALUE, RootKey);
             *CloseKey = TRUE;
             break;
         default:
@@ -535,12 +856,16 @@ AssocOpenRegRootForScope(
 
  @param Scope Specifies the scope of the operation.
 
+ @param ShowCommand If TRUE, display the command that opens each extension
+        instead of its file type.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOLEAN
 AssocEnumerateAssociationsForScope(
-    __in ASSOC_SCOPE Scope
+    __in ASSOC_SCOPE Scope,
+    __in BOOLEAN ShowCommand
     )
 {
     ASSOC_SCOPE EffectiveScope;
@@ -557,7 +882,7 @@ AssocEnumerateAssociationsForScope(
         return FALSE;
     }
 
-    Result = AssocEnumerateAssociations(RootKey);
+    Result = AssocEnumerateAssociations(RootKey, ShowCommand);
     if (CloseKey) {
         DllAdvApi32.pRegCloseKey(RootKey);
     }
@@ -818,9 +1143,11 @@ ENTRYPOINT(
     YORI_STRING Arg;
     ASSOC_SCOPE Scope;
     BOOLEAN FileTypeMode;
+    BOOLEAN ShowCommand;
 
     Scope = AssocScopeDefault;
     FileTypeMode = FALSE;
+    ShowCommand = FALSE;
     YoriLibLoadAdvApi32Functions();
 
     if (DllAdvApi32.pRegCloseKey == NULL ||
@@ -847,6 +1174,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2020"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
+                ShowCommand = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
                 Scope = AssocScopeMerged;
                 ArgumentUnderstood = TRUE;
@@ -875,7 +1205,7 @@ ENTRYPOINT(
         if (FileTypeMode) {
             AssocEnumerateFileTypesForScope(Scope);
         } else {
-            AssocEnumerateAssociationsForScope(Scope);
+            AssocEnumerateAssociationsForScope(Scope, ShowCommand);
         }
     } else {
         YORI_STRING Value;
@@ -35,10 +35,11 @@ CHAR strAttribHelpText[] =
         "\n"
         "Display or manipulate file attributes.\n"
         "\n"
-        "ATTRIB [/license] [+Attrs] [-Attrs] [/b] [/d] [/s] [/v] [<file>...]\n"
+        "ATTRIB [/license] [+Attrs] [-Attrs] [/b] [/d] [/j n] [/s] [/v] [<file>...]\n"
         "\n"
         "   /b             Use basic search criteria for files only\n"
         "   /d             Include directories as well as files\n"
+        "   /j             Modify files on the specified number of threads\n"
         "   /s             Process files from all subdirectories\n"
         "   /v             Verbose output\n"
         "\n";
@@ -172,8 +173,167 @@ typedef struct _ATTRIB_CONTEXT {
      */
     DWORDLONG FilesFound;
 
+    /**
+     The number of threads to use when modifying attributes.  If this is
+     greater than one, files are modified by the work queue.
+     */
+    DWORD ThreadCount;
+
+    /**
+     The queue of files to modify on background threads.  This is only used
+     if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
 } ATTRIB_CONTEXT, *PATTRIB_CONTEXT;
 
+/**
+ A single file whose attributes should be modified on a background thread.
+ */
+typedef struct _ATTRIB_WORK_ITEM {
+
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     Fully qualified path to the file.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The attributes to apply to the file.
+     */
+    DWORD NewAttributes;
+} ATTRIB_WORK_ITEM, *PATTRIB_WORK_ITEM;
+
+/**
+ Apply new attributes to a file.
+
+ @param AttribContext Pointer to the attrib context.
+
+ @param FilePath Pointer to the fully qualified file path.
+
+ @param NewAttributes The attributes to apply.
+
+ @param UnescapedPath Pointer to a string which can be used to display the
+        file name.  This is reallocated as needed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+AttribApplyAttributes(
+    __in PATTRIB_CONTEXT AttribContext,
+    __in PYORI_STRING FilePath,
+    __in DWORD NewAttributes,
+    __inout PYORI_STRING UnescapedPath
+    )
+{
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    if (!SetFileAttributes(FilePath->StartOfString, NewAttributes)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("attrib: modification of attributes failed: %y %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    if (AttribContext->Verbose) {
+        if (!YoriLibUnescapePath(FilePath, UnescapedPath)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Updating %y\n"), FilePath);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Updating %y\n"), UnescapedPath);
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Modify the attributes of a single file on a background thread.
+
+ @param Context Pointer to the attrib context.
+
+ @param Item Pointer to the work item within the attrib work item.  The
+        attrib work item is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be modified.
+ */
+VOID
+AttribWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PATTRIB_CONTEXT AttribContext = (PATTRIB_CONTEXT)Context;
+    PATTRIB_WORK_ITEM AttribItem;
+    YORI_STRING UnescapedPath;
+
+    AttribItem = CONTAINING_RECORD(Item, ATTRIB_WORK_ITEM, WorkItem);
+
+    if (!Cancelled) {
+        YoriLibInitEmptyString(&UnescapedPath);
+        AttribApplyAttributes(AttribContext, &AttribItem->FilePath, AttribItem->NewAttributes, &UnescapedPath);
+        YoriLibFreeStringContents(&UnescapedPath);
+    }
+
+    YoriLibFreeStringContents(&AttribItem->FilePath);
+    YoriLibFree(AttribItem);
+}
+
+/**
+ Attempt to modify the attributes of a file on a background thread.
+
+ @param AttribContext Pointer to the attrib context.
+
+ @param FilePath Pointer to the fully qualified file path.
+
+ @param NewAttributes The attributes to apply.
+
+ @return TRUE if the file was queued for a background thread, FALSE if it
+         was not and should be modified by the caller.
+ */
+BOOL
+AttribQueueFile(
+    __in PATTRIB_CONTEXT AttribContext,
+    __in PYORI_STRING FilePath,
+    __in DWORD NewAttributes
+    )
+{
+    PATTRIB_WORK_ITEM AttribItem;
+
+    AttribItem = YoriLibMalloc(sizeof(ATTRIB_WORK_ITEM));
+    if (AttribItem == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(AttribItem, sizeof(ATTRIB_WORK_ITEM));
+
+    //
+    //  The file name is a buffer owned by the enumerator which will be
+    //  reused for the next file, so it needs to be copied.
+    //
+
+    if (!YoriLibCopyString(&AttribItem->FilePath, FilePath)) {
+        YoriLibFree(AttribItem);
+        return FALSE;
+    }
+    AttribItem->NewAttributes = NewAttributes;
+
+    if (YoriLibQueueWorkItem(&AttribContext->WorkQueue, &AttribItem->WorkItem, TRUE)) {
+        return TRUE;
+    }
+
+    YoriLibFreeStringContents(&AttribItem->FilePath);
+    YoriLibFree(AttribItem);
+    return FALSE;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -204,13 +364,21 @@ AttribFileFoundCallback(
     DWORD NewAttributes;
 
     UNREFERENCED_PARAMETER(Depth);
-    UNREFERENCED_PARAMETER(FileInfo);
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
     AttribContext->FilesFoundThisArg++;
 
-    ExistingAttributes = GetFileAttributes(FilePath->StartOfString);
+    //
+    //  Enumeration has already returned the attributes, so only query them
+    //  for files that were specified literally.
+    //
+
+    if (FileInfo != NULL) {
+        ExistingAttributes = FileInfo->dwFileAttributes;
+    } else {
+        ExistingAttributes = GetFileAttributes(FilePath->StartOfString);
+    }
     if (ExistingAttributes == (DWORD)-1) {
         LastError = GetLastError();
         ErrText = YoriLibGetWinErrorText(LastError);
@@ -246,19 +414,20 @@ AttribFileFoundCallback(
         NewAttributes = NewAttributes | AttribContext->AttributesToSet;
 
         if (NewAttributes != ExistingAttributes) {
-            if (!SetFileAttributes(FilePath->StartOfString, NewAttributes)) {
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("attrib: modification of attributes failed: %y %s"), FilePath, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-                return TRUE;
-            } else if (AttribContext->Verbose) {
-                if (!YoriLibUnescapePath(FilePath, &AttribContext->UnescapedPath)) {
-                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Updating %y\n"), FilePath);
-                } else {
-                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Updating %y\n"), &AttribContext->UnescapedPath);
+            BOOL Queued;
+
+            Queued = FALSE;
+            if (AttribContext->ThreadCount > 1) {
+                Queued = AttribQueueFile(AttribContext, FilePath, NewAttributes);
+                if (!Queued && AttribContext->WorkQueue.Cancelled) {
+                    return FALSE;
                 }
             }
+
+            if (!Queued &&
+                !AttribApplyAttributes(AttribContext, FilePath, NewAttributes, &AttribContext->UnescapedPath)) {
+                return TRUE;
+            }
         }
     }
 
@@ -406,6 +575,8 @@ ENTRYPOINT(
     TCHAR PrefixChar;
     YORI_STRING Arg;
     YORI_STRING FullPath;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     ZeroMemory(&AttribContext, sizeof(AttribContext));
     YoriLibInitEmptyString(&Arg);
@@ -448,6 +619,14 @@ ENTRYPOINT(
                 AttribContext.IncludeDirectories = TRUE;
                 ArgumentUnderstood = TRUE;
 
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        AttribContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 AttribContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -510,10 +689,30 @@ ENTRYPOINT(
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
 
+    //
+    //  Displaying attributes is done in enumeration order, so background
+    //  threads are only used when modifying them.
+    //
+
+    if (AttribContext.AttributesToSet == 0 &&
+        AttribContext.AttributesToClear == 0) {
+
+        AttribContext.ThreadCount = 0;
+    }
+
+    if (AttribContext.ThreadCount > 1) {
+        if (!YoriLibInitializeWorkQueue(&AttribContext.WorkQueue, (YORI_ALLOC_SIZE_T)AttribContext.ThreadCount, 0, AttribWorkItem, &AttribContext)) {
+            return EXIT_FAILURE;
+        }
+    }
+
     if (MatchAllFiles) {
         YoriLibConstantString(&Arg, _T("*"));
 
         if (!YoriLibUserStringToSingleFilePath(&Arg, TRUE, &FullPath)) {
+            if (AttribContext.ThreadCount > 1) {
+                YoriLibCleanupWorkQueue(&AttribContext.WorkQueue);
+            }
             return EXIT_FAILURE;
         }
 
@@ -560,6 +759,13 @@ ENTRYPOINT(
         }
     }
 
+    if (AttribContext.ThreadCount > 1) {
+        if (!YoriLibWaitForWorkQueue(&AttribContext.WorkQueue)) {
+            Result = EXIT_FAILURE;
+        }
+        YoriLibCleanupWorkQueue(&AttribContext.WorkQueue);
+    }
+
     YoriLibFreeStringContents(&AttribContext.UnescapedPath);
 
     if (AttribContext.FilesFound == 0) {
@@ -54,318 +54,584 @@ Base64Help(VOID)
 }
 
 /**
- A buffer for a single data stream.
+ The number of input bytes encoded onto each line of output.  This
+ corresponds to 64 characters of output, which matches the format
+ generated by CryptBinaryToString.
  */
-typedef struct _BASE64_BUFFER {
+#define BASE64_BYTES_PER_LINE 48
+
+/**
+ The number of characters of output generated for each line.
+ */
+#define BASE64_CHARS_PER_LINE 64
+
+/**
+ The number of bytes to read from the input at a time when encoding.  This
+ is a multiple of BASE64_BYTES_PER_LINE so each block generates complete
+ lines.
+ */
+#define BASE64_ENCODE_BLOCK_SIZE (BASE64_BYTES_PER_LINE * 1024)
+
+/**
+ The number of bytes to read from the input at a time when decoding.
+ */
+#define BASE64_DECODE_BLOCK_SIZE (64 * 1024)
+
+/**
+ The characters used to represent each six bit value.
+ */
+const
+CHAR Base64EncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ A value in Base64DecodeTable indicating the character is whitespace, which
+ is ignored.
+ */
+#define BASE64_DECODE_WHITESPACE 0x40
+
+/**
+ A value in Base64DecodeTable indicating the character is padding.
+ */
+#define BASE64_DECODE_PADDING    0x41
+
+/**
+ A value in Base64DecodeTable indicating the character is not valid in
+ base64 encoded data.
+ */
+#define BASE64_DECODE_INVALID    0xFF
+
+/**
+ State for a streaming base64 operation.  Input is read in fixed size
+ blocks and output is written as each block is processed, so memory usage
+ does not depend on the size of the input.
+ */
+typedef struct _BASE64_CONTEXT {
 
     /**
-     A handle to a pipe which is the source of data for this buffer.
+     A handle which is the source of data.
      */
     HANDLE hSource;
 
     /**
-     The data buffer.
+     A buffer of data read from the source.
+     */
+    PUCHAR InputBuffer;
+
+    /**
+     A buffer of output which has been generated from the input buffer.
+     When encoding, this is a string of characters; when decoding, it is
+     binary data.
+     */
+    PVOID OutputBuffer;
+
+    /**
+     A lookup table from each input byte to its six bit value, or one of
+     the BASE64_DECODE_ values.  This is only used when decoding.
+     */
+    UCHAR DecodeTable[256];
+
+    /**
+     The six bit values which have been decoded but not yet combined into
+     complete bytes.  This is only used when decoding.
      */
-    YORI_LIB_BYTE_BUFFER ByteBuffer;
+    UCHAR Quantum[4];
 
-} BASE64_BUFFER, *PBASE64_BUFFER;
+    /**
+     The number of elements in Quantum which are populated.
+     */
+    UCHAR QuantumLength;
+
+    /**
+     Set to TRUE once padding has been encountered when decoding, which
+     indicates the end of the encoded data.
+     */
+    BOOLEAN PaddingFound;
+
+} BASE64_CONTEXT, *PBASE64_CONTEXT;
 
 /**
- Populate data from stdin into an in memory buffer.
+ Read from the source until a buffer is full or the source has no more
+ data.  Pipes can return less data than requested before the end of the
+ stream, so this reads repeatedly.
 
- @param ThisBuffer A pointer to the process buffer set.
+ @param hSource The handle to read from.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param Buffer Pointer to the buffer to populate.
+
+ @param BufferSize The number of bytes to read.
+
+ @param BytesRead On completion, updated to the number of bytes read.  If
+        this is less than BufferSize, the end of the stream was reached.
  */
-BOOL
-Base64BufferPump(
-    __in PBASE64_BUFFER ThisBuffer
+VOID
+Base64ReadBlock(
+    __in HANDLE hSource,
+    __out_bcount(BufferSize) PUCHAR Buffer,
+    __in DWORD BufferSize,
+    __out PDWORD BytesRead
     )
 {
-    DWORD BytesRead;
-    BOOL Result = FALSE;
-    PUCHAR WriteBuffer;
-    YORI_ALLOC_SIZE_T BytesAvailable;
+    DWORD TotalRead;
+    DWORD ThisRead;
 
-    while (TRUE) {
+    TotalRead = 0;
+    while (TotalRead < BufferSize) {
+        if (!ReadFile(hSource, &Buffer[TotalRead], BufferSize - TotalRead, &ThisRead, NULL) ||
+            ThisRead == 0) {
 
-        WriteBuffer = YoriLibByteBufferGetPointerToEnd(&ThisBuffer->ByteBuffer, 16384, &BytesAvailable);
-        if (WriteBuffer == NULL) {
             break;
         }
+        TotalRead = TotalRead + ThisRead;
+    }
 
-        if (ReadFile(ThisBuffer->hSource,
-                     WriteBuffer,
-                     BytesAvailable,
-                     &BytesRead,
-                     NULL)) {
+    *BytesRead = TotalRead;
+}
 
-            if (BytesRead == 0) {
-                Result = TRUE;
-                break;
-            }
+/**
+ Encode a buffer of bytes into base64 characters, generating a line break
+ after every BASE64_BYTES_PER_LINE bytes of input and after the final line.
+
+ @param Input Pointer to the bytes to encode.
+
+ @param InputLength The number of bytes to encode.
+
+ @param Output Pointer to a buffer to receive the encoded characters.  This
+        must be large enough to contain the output.
+
+ @return The number of characters written to Output.
+ */
+DWORD
+Base64EncodeBlock(
+    __in PUCHAR Input,
+    __in DWORD InputLength,
+    __out LPTSTR Output
+    )
+{
+    DWORD InputIndex;
+    DWORD OutputIndex;
+    DWORD LineBytes;
+    DWORD Triple;
+
+    OutputIndex = 0;
+    LineBytes = 0;
+    InputIndex = 0;
+
+    //
+    //  Process complete groups of three bytes, which each generate four
+    //  characters.
+    //
+
+    while (InputIndex + 3 <= InputLength) {
+        Triple = (Input[InputIndex] << 16) | (Input[InputIndex + 1] << 8) | Input[InputIndex + 2];
+        Output[OutputIndex] = Base64EncodeTable[(Triple >> 18) & 0x3F];
+        Output[OutputIndex + 1] = Base64EncodeTable[(Triple >> 12) & 0x3F];
+        Output[OutputIndex + 2] = Base64EncodeTable[(Triple >> 6) & 0x3F];
+        Output[OutputIndex + 3] = Base64EncodeTable[Triple & 0x3F];
+        OutputIndex = OutputIndex + 4;
+        InputIndex = InputIndex + 3;
+        LineBytes = LineBytes + 3;
+
+        if (LineBytes == BASE64_BYTES_PER_LINE) {
+            Output[OutputIndex] = '\r';
+            Output[OutputIndex + 1] = '\n';
+            OutputIndex = OutputIndex + 2;
+            LineBytes = 0;
+        }
+    }
 
-            YoriLibByteBufferAddToPopulatedLength(&ThisBuffer->ByteBuffer, BytesRead);
+    //
+    //  Process any final partial group, padding the output.
+    //
 
+    if (InputIndex < InputLength) {
+        Triple = Input[InputIndex] << 16;
+        if (InputIndex + 1 < InputLength) {
+            Triple = Triple | (Input[InputIndex + 1] << 8);
+        }
+        Output[OutputIndex] = Base64EncodeTable[(Triple >> 18) & 0x3F];
+        Output[OutputIndex + 1] = Base64EncodeTable[(Triple >> 12) & 0x3F];
+        if (InputIndex + 1 < InputLength) {
+            Output[OutputIndex + 2] = Base64EncodeTable[(Triple >> 6) & 0x3F];
         } else {
-            Result = TRUE;
-            break;
+            Output[OutputIndex + 2] = '=';
         }
+        Output[OutputIndex + 3] = '=';
+        OutputIndex = OutputIndex + 4;
+        LineBytes = LineBytes + 3;
     }
 
-    return Result;
+    if (LineBytes > 0) {
+        Output[OutputIndex] = '\r';
+        Output[OutputIndex + 1] = '\n';
+        OutputIndex = OutputIndex + 2;
+    }
+
+    return OutputIndex;
 }
 
 /**
- Allocate and initialize a buffer for an input stream.
+ Perform base64 encode on the source stream and output to the requested
+ device.  Input is processed in blocks containing a whole number of lines,
+ and each block is output before the next is read.
 
- @param Buffer Pointer to the buffer to allocate structures for.
+ @param Base64Context Pointer to the context describing the source.
 
- @return TRUE if the buffer is successfully initialized, FALSE if it is not.
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-Base64AllocateBuffer(
-    __out PBASE64_BUFFER Buffer
+Base64Encode(
+    __inout PBASE64_CONTEXT Base64Context
     )
 {
-    return YoriLibByteBufferInitialize(&Buffer->ByteBuffer, 1024);
+    YORI_STRING Buffer;
+    DWORD BytesRead;
+
+    YoriLibInitEmptyString(&Buffer);
+    Buffer.StartOfString = Base64Context->OutputBuffer;
+
+    while (TRUE) {
+        Base64ReadBlock(Base64Context->hSource, Base64Context->InputBuffer, BASE64_ENCODE_BLOCK_SIZE, &BytesRead);
+        if (BytesRead == 0) {
+            break;
+        }
+
+        Buffer.LengthInChars = (YORI_ALLOC_SIZE_T)Base64EncodeBlock(Base64Context->InputBuffer, BytesRead, Buffer.StartOfString);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Buffer);
+
+        if (BytesRead < BASE64_ENCODE_BLOCK_SIZE || YoriLibIsOperationCancelled()) {
+            break;
+        }
+    }
+
+    return TRUE;
 }
 
 /**
- Free structures associated with a single input stream.
+ Prepare the table used to map input bytes to six bit values when
+ decoding.
 
- @param ThisBuffer Pointer to the single stream's buffers to deallocate.
+ @param Base64Context Pointer to the context to populate.
  */
 VOID
-Base64FreeBuffer(
-    __in PBASE64_BUFFER ThisBuffer
+Base64InitializeDecodeTable(
+    __out PBASE64_CONTEXT Base64Context
     )
 {
-    YoriLibByteBufferCleanup(&ThisBuffer->ByteBuffer);
+    DWORD Index;
+
+    for (Index = 0; Index < sizeof(Base64Context->DecodeTable); Index++) {
+        Base64Context->DecodeTable[Index] = BASE64_DECODE_INVALID;
+    }
+
+    for (Index = 0; Index < sizeof(Base64EncodeTable) - 1; Index++) {
+        Base64Context->DecodeTable[(UCHAR)Base64EncodeTable[Index]] = (UCHAR)Index;
+    }
+
+    Base64Context->DecodeTable[' '] = BASE64_DECODE_WHITESPACE;
+    Base64Context->DecodeTable['\t'] = BASE64_DECODE_WHITESPACE;
+    Base64Context->DecodeTable['\r'] = BASE64_DECODE_WHITESPACE;
+    Base64Context->DecodeTable['\n'] = BASE64_DECODE_WHITESPACE;
+    Base64Context->DecodeTable['='] = BASE64_DECODE_PADDING;
 }
 
 /**
- Perform base64 encode and output to the requested device.
+ Combine the six bit values which have been collected into bytes.
 
- @param ThisBuffer Pointer to the buffer to output.
+ @param Base64Context Pointer to the context containing the values.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param Output Pointer to the buffer to receive the bytes.
+
+ @return The number of bytes written to Output, which is zero if too few
+         values have been collected to form a byte.
  */
-BOOL
-Base64Encode(
-    __inout PBASE64_BUFFER ThisBuffer
+DWORD
+Base64FlushQuantum(
+    __inout PBASE64_CONTEXT Base64Context,
+    __out PUCHAR Output
     )
 {
-    DWORD CharsRequired;
-    YORI_STRING Buffer;
-    DWORD Err;
-    LPTSTR ErrText;
-    PUCHAR SourceBuffer;
-    YORI_ALLOC_SIZE_T BytesPopulated;
+    PUCHAR Quantum;
+    DWORD BytesGenerated;
 
-    //
-    //  Calculate the buffer size needed
-    //
+    Quantum = Base64Context->Quantum;
+    BytesGenerated = 0;
 
-    SourceBuffer = YoriLibByteBufferGetPointerToValidData(&ThisBuffer->ByteBuffer, 0, &BytesPopulated);
-    if (!DllCrypt32.pCryptBinaryToStringW(SourceBuffer, BytesPopulated, CRYPT_STRING_BASE64, NULL, &CharsRequired)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to calculate buffer length in CryptBinaryToString: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        return FALSE;
+    if (Base64Context->QuantumLength >= 2) {
+        Output[0] = (UCHAR)((Quantum[0] << 2) | (Quantum[1] >> 4));
+        BytesGenerated = 1;
+    }
+    if (Base64Context->QuantumLength >= 3) {
+        Output[1] = (UCHAR)((Quantum[1] << 4) | (Quantum[2] >> 2));
+        BytesGenerated = 2;
+    }
+    if (Base64Context->QuantumLength >= 4) {
+        Output[2] = (UCHAR)((Quantum[2] << 6) | Quantum[3]);
+        BytesGenerated = 3;
     }
 
-    //
-    //  Check if the buffer size would overflow, and fail if so
-    //
+    Base64Context->QuantumLength = 0;
+    return BytesGenerated;
+}
 
-    if (!YoriLibIsSizeAllocatable(CharsRequired)) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: supplied data too large\n"));
-        return FALSE;
-    }
+/**
+ Decode a buffer of base64 characters into bytes.  Any partial group of
+ characters at the end of the buffer is retained in the context so that
+ decoding can continue with the next buffer.
 
-    //
-    //  Allocate buffer
-    //
+ @param Base64Context Pointer to the context containing decode state.
 
-    if (!YoriLibAllocateString(&Buffer, (YORI_ALLOC_SIZE_T)CharsRequired)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: allocation failure: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        return FALSE;
-    }
+ @param Input Pointer to the characters to decode.
 
-    //
-    //  Perform the encode
-    //
+ @param InputLength The number of bytes in Input.
 
-    if (!DllCrypt32.pCryptBinaryToStringW(SourceBuffer, BytesPopulated, CRYPT_STRING_BASE64, Buffer.StartOfString, &CharsRequired)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to encode in CryptBinaryToString: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&Buffer);
-        return FALSE;
-    }
+ @param CharSize The number of bytes in each character, which is two if the
+        input is UTF16 and one otherwise.
 
-    Buffer.LengthInChars = (YORI_ALLOC_SIZE_T)CharsRequired;
+ @param Output Pointer to a buffer to receive the decoded bytes.  This must
+        be at least three quarters of InputLength plus three bytes.
 
-    //
-    //  Free the source buffer.  We're done with it by this point, and
-    //  output may need to double buffer for encoding.
-    //
+ @param OutputLength On successful completion, updated to contain the
+        number of bytes written to Output.
 
-    Base64FreeBuffer(ThisBuffer);
+ @return TRUE to indicate success, FALSE if the input is not valid base64.
+ */
+__success(return)
+BOOL
+Base64DecodeBlock(
+    __inout PBASE64_CONTEXT Base64Context,
+    __in PUCHAR Input,
+    __in DWORD InputLength,
+    __in DWORD CharSize,
+    __out PUCHAR Output,
+    __out PDWORD OutputLength
+    )
+{
+    DWORD InputIndex;
+    DWORD OutputIndex;
+    UCHAR Value;
 
-    //
-    //  Output the encoded form.
-    //
+    OutputIndex = 0;
+
+    for (InputIndex = 0; InputIndex + CharSize <= InputLength; InputIndex = InputIndex + CharSize) {
 
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Buffer);
-    YoriLibFreeStringContents(&Buffer);
+        //
+        //  In UTF16 input, any character with a nonzero high byte is not
+        //  valid base64.
+        //
+
+        if (CharSize > 1 && Input[InputIndex + 1] != 0) {
+            return FALSE;
+        }
 
+        Value = Base64Context->DecodeTable[Input[InputIndex]];
+        if (Value < 0x40) {
+            if (Base64Context->PaddingFound) {
+                return FALSE;
+            }
+            Base64Context->Quantum[Base64Context->QuantumLength] = Value;
+            Base64Context->QuantumLength++;
+            if (Base64Context->QuantumLength == 4) {
+                OutputIndex = OutputIndex + Base64FlushQuantum(Base64Context, &Output[OutputIndex]);
+            }
+        } else if (Value == BASE64_DECODE_PADDING) {
+            if (!Base64Context->PaddingFound) {
+                if (Base64Context->QuantumLength < 2) {
+                    return FALSE;
+                }
+                OutputIndex = OutputIndex + Base64FlushQuantum(Base64Context, &Output[OutputIndex]);
+                Base64Context->PaddingFound = TRUE;
+            }
+        } else if (Value != BASE64_DECODE_WHITESPACE) {
+            return FALSE;
+        }
+    }
+
+    *OutputLength = OutputIndex;
     return TRUE;
 }
 
 /**
- Perform base64 decode and output to the requested device.
+ Write a buffer of binary data to standard output.
 
- @param ThisBuffer Pointer to the buffer to output.
+ @param Buffer Pointer to the data to write.
+
+ @param BytesToWrite The number of bytes to write.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-Base64Decode(
-    __inout PBASE64_BUFFER ThisBuffer
+Base64WriteOutput(
+    __in PUCHAR Buffer,
+    __in DWORD BytesToWrite
     )
 {
-    YORI_ALLOC_SIZE_T CharsRequired;
-    DWORD BytesRequired;
-    YORI_STRING Buffer;
-    PUCHAR BinaryBuffer;
-    DWORD Skip;
-    DWORD Flags;
     DWORD BytesSent;
-    BOOL Result;
+    DWORD BytesWritten;
     HANDLE hTarget;
     DWORD Err;
     LPTSTR ErrText;
-    PUCHAR SourceBuffer;
-    YORI_ALLOC_SIZE_T BytesPopulated;
 
-    //
-    //  Convert the input buffer into a UTF16 string.
-    //
+    BytesSent = 0;
+    hTarget = GetStdHandle(STD_OUTPUT_HANDLE);
 
-    SourceBuffer = YoriLibByteBufferGetPointerToValidData(&ThisBuffer->ByteBuffer, 0, &BytesPopulated);
-    if (SourceBuffer == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: allocation failure\n"));
-        return FALSE;
+    while (BytesSent < BytesToWrite) {
+        if (!WriteFile(hTarget,
+                       &Buffer[BytesSent],
+                       BytesToWrite - BytesSent,
+                       &BytesWritten,
+                       NULL)) {
+
+            Err = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to write to output: %s"), ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            return FALSE;
+        }
+
+        BytesSent = BytesSent + BytesWritten;
     }
-    CharsRequired = YoriLibGetMultibyteInputSizeNeeded(SourceBuffer, BytesPopulated);
-    if (!YoriLibAllocateString(&Buffer, CharsRequired + 1)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: allocation failure: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        return FALSE;
+
+    return TRUE;
+}
+
+/**
+ Perform base64 decode on the source stream and output to the requested
+ device.  Input is processed in fixed size blocks, and each block is output
+ before the next is read.
+
+ @param Base64Context Pointer to the context describing the source.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+Base64Decode(
+    __inout PBASE64_CONTEXT Base64Context
+    )
+{
+    DWORD BytesRead;
+    DWORD BytesDecoded;
+    DWORD CharSize;
+    DWORD StartOffset;
+    BOOLEAN FirstBlock;
+    PUCHAR OutputBuffer;
+
+    Base64InitializeDecodeTable(Base64Context);
+    OutputBuffer = (PUCHAR)Base64Context->OutputBuffer;
+
+    CharSize = sizeof(CHAR);
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharSize = sizeof(WCHAR);
     }
 
-    YoriLibMultibyteInput(SourceBuffer, BytesPopulated, Buffer.StartOfString, CharsRequired);
-    Buffer.LengthInChars = CharsRequired;
-    Buffer.StartOfString[CharsRequired] = '\0';
+    FirstBlock = TRUE;
+    while (TRUE) {
+        Base64ReadBlock(Base64Context->hSource, Base64Context->InputBuffer, BASE64_DECODE_BLOCK_SIZE, &BytesRead);
+        if (BytesRead == 0) {
+            break;
+        }
 
-    //
-    //  Free the source buffer.  We're done with it by this point, and
-    //  output may need to double buffer for encoding.
-    //
+        StartOffset = 0;
+        if (FirstBlock) {
+            StartOffset = YoriLibBytesInBom(Base64Context->InputBuffer, BytesRead);
+            FirstBlock = FALSE;
+        }
 
-    Base64FreeBuffer(ThisBuffer);
+        if (!Base64DecodeBlock(Base64Context,
+                               &Base64Context->InputBuffer[StartOffset],
+                               BytesRead - StartOffset,
+                               CharSize,
+                               OutputBuffer,
+                               &BytesDecoded)) {
 
-    //
-    //  Calculate the buffer size needed
-    //
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: input is not valid base64 data\n"));
+            return FALSE;
+        }
 
-    if (!DllCrypt32.pCryptStringToBinaryW(Buffer.StartOfString, Buffer.LengthInChars, CRYPT_STRING_BASE64, NULL, &BytesRequired, NULL, NULL)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to calculate buffer length in CryptStringToBinary: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&Buffer);
-        return FALSE;
+        if (!Base64WriteOutput(OutputBuffer, BytesDecoded)) {
+            return FALSE;
+        }
+
+        if (BytesRead < BASE64_DECODE_BLOCK_SIZE || YoriLibIsOperationCancelled()) {
+            break;
+        }
     }
 
     //
-    //  Allocate binary buffer
+    //  If the data ended without padding, output any remaining bytes.
     //
 
-    BinaryBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
-    if (BinaryBuffer == NULL) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: allocation failure: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&Buffer);
+    if (Base64Context->QuantumLength == 1) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: input is not valid base64 data\n"));
         return FALSE;
     }
 
-    //
-    //  Perform the decode
-    //
+    BytesDecoded = Base64FlushQuantum(Base64Context, OutputBuffer);
+    return Base64WriteOutput(OutputBuffer, BytesDecoded);
+}
 
-    if (!DllCrypt32.pCryptStringToBinaryW(Buffer.StartOfString, Buffer.LengthInChars, CRYPT_STRING_BASE64, BinaryBuffer, &BytesRequired, &Skip, &Flags)) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to encode in CryptBinaryToString: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&Buffer);
-        YoriLibFree(BinaryBuffer);
-        return FALSE;
+/**
+ Allocate the buffers used to process a stream.
+
+ @param Base64Context Pointer to the context to allocate buffers for.
+
+ @return TRUE if the buffers were allocated, FALSE if they were not.
+ */
+BOOL
+Base64AllocateBuffers(
+    __inout PBASE64_CONTEXT Base64Context
+    )
+{
+    DWORD InputSize;
+    DWORD OutputSize;
+
+    InputSize = BASE64_ENCODE_BLOCK_SIZE;
+    if (InputSize < BASE64_DECODE_BLOCK_SIZE) {
+        InputSize = BASE64_DECODE_BLOCK_SIZE;
     }
 
     //
-    //  We're done with the string form of the source, deallocate it.
+    //  Encoding generates four characters for each three bytes, plus a
+    //  line break for each line.  Decoding generates fewer bytes than its
+    //  input, plus up to three bytes from a previous block.
     //
 
-    YoriLibFreeStringContents(&Buffer);
+    OutputSize = (BASE64_ENCODE_BLOCK_SIZE / BASE64_BYTES_PER_LINE) * (BASE64_CHARS_PER_LINE + 2) * sizeof(TCHAR);
+    if (OutputSize < BASE64_DECODE_BLOCK_SIZE + 4) {
+        OutputSize = BASE64_DECODE_BLOCK_SIZE + 4;
+    }
 
-    //
-    //  Output the decoded form.
-    //
-    BytesSent = 0;
-    Result = TRUE;
-    hTarget = GetStdHandle(STD_OUTPUT_HANDLE);
+    Base64Context->InputBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)InputSize);
+    if (Base64Context->InputBuffer == NULL) {
+        return FALSE;
+    }
 
-    while (BytesSent < BytesRequired) {
-        DWORD BytesToWrite;
-        DWORD BytesWritten;
-        BytesToWrite = 4096;
-        if (BytesSent + BytesToWrite > BytesRequired) {
-            BytesToWrite = BytesRequired - BytesSent;
-        }
+    Base64Context->OutputBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)OutputSize);
+    if (Base64Context->OutputBuffer == NULL) {
+        return FALSE;
+    }
 
-        if (WriteFile(hTarget,
-                      YoriLibAddToPointer(BinaryBuffer, BytesSent),
-                      BytesToWrite,
-                      &BytesWritten,
-                      NULL)) {
+    return TRUE;
+}
 
-            BytesSent += BytesWritten;
-        } else {
-            Err = GetLastError();
-            ErrText = YoriLibGetWinErrorText(Err);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: failure to write to output: %s"), ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-            Result = FALSE;
-        }
+/**
+ Free the buffers used to process a stream.
 
-        ASSERT(BytesSent <= BytesRequired);
+ @param Base64Context Pointer to the context to free buffers for.
+ */
+VOID
+Base64FreeBuffers(
+    __inout PBASE64_CONTEXT Base64Context
+    )
+{
+    if (Base64Context->InputBuffer != NULL) {
+        YoriLibFree(Base64Context->InputBuffer);
+        Base64Context->InputBuffer = NULL;
+    }
+    if (Base64Context->OutputBuffer != NULL) {
+        YoriLibFree(Base64Context->OutputBuffer);
+        Base64Context->OutputBuffer = NULL;
     }
-    YoriLibFree(BinaryBuffer);
-
-    return Result;
 }
 
 #ifdef YORI_BUILTIN
@@ -401,12 +667,13 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T StartArg = 0;
     YORI_STRING Arg;
     BOOLEAN Decode = FALSE;
-    BASE64_BUFFER Base64Buffer;
+    BASE64_CONTEXT Base64Context;
     YORI_STRING FullFilePath;
     DWORD Err;
     LPTSTR ErrText;
+    BOOL Result;
 
-    ZeroMemory(&Base64Buffer, sizeof(Base64Buffer));
+    ZeroMemory(&Base64Context, sizeof(Base64Context));
     YoriLibInitEmptyString(&FullFilePath);
 
     for (i = 1; i < ArgC; i++) {
@@ -441,14 +708,6 @@ ENTRYPOINT(
         }
     }
 
-    YoriLibLoadCrypt32Functions();
-    if (DllCrypt32.pCryptBinaryToStringW == NULL ||
-        DllCrypt32.pCryptStringToBinaryW == NULL) {
-
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: operating system support not present\n"));
-        return EXIT_FAILURE;
-    }
-
 #if YORI_BUILTIN
     YoriLibCancelEnable(FALSE);
 #endif
@@ -459,7 +718,7 @@ ENTRYPOINT(
     //
 
     YoriLibInitEmptyString(&FullFilePath);
-    Base64Buffer.hSource = GetStdHandle(STD_INPUT_HANDLE);
+    Base64Context.hSource = GetStdHandle(STD_INPUT_HANDLE);
     if (StartArg == 0 || StartArg == ArgC) {
         if (YoriLibIsStdInConsole()) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: no file or pipe for input\n"));
@@ -474,8 +733,8 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        Base64Buffer.hSource = CreateFile(FullFilePath.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (Base64Buffer.hSource == INVALID_HANDLE_VALUE) {
+        Base64Context.hSource = CreateFile(FullFilePath.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (Base64Context.hSource == INVALID_HANDLE_VALUE) {
             Err = GetLastError();
             ErrText = YoriLibGetWinErrorText(Err);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: opening file failed: %s"), ErrText);
@@ -485,52 +744,34 @@ ENTRYPOINT(
         }
     }
 
-    if (!Base64AllocateBuffer(&Base64Buffer)) {
+    if (!Base64AllocateBuffers(&Base64Context)) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("base64: allocating buffer failed: %s"), ErrText);
         YoriLibFreeWinErrorText(ErrText);
         if (FullFilePath.LengthInChars > 0) {
-            CloseHandle(Base64Buffer.hSource);
-        }
-        YoriLibFreeStringContents(&FullFilePath);
-        return EXIT_FAILURE;
-    }
-
-    if (!Base64BufferPump(&Base64Buffer)) {
-        if (FullFilePath.LengthInChars > 0) {
-            CloseHandle(Base64Buffer.hSource);
+            CloseHandle(Base64Context.hSource);
         }
         YoriLibFreeStringContents(&FullFilePath);
-        Base64FreeBuffer(&Base64Buffer);
+        Base64FreeBuffers(&Base64Context);
         return EXIT_FAILURE;
     }
 
     if (!Decode) {
-        if (!Base64Encode(&Base64Buffer)) {
-            if (FullFilePath.LengthInChars > 0) {
-                CloseHandle(Base64Buffer.hSource);
-            }
-            YoriLibFreeStringContents(&FullFilePath);
-            Base64FreeBuffer(&Base64Buffer);
-            return EXIT_FAILURE;
-        }
+        Result = Base64Encode(&Base64Context);
     } else {
-        if (!Base64Decode(&Base64Buffer)) {
-            if (FullFilePath.LengthInChars > 0) {
-                CloseHandle(Base64Buffer.hSource);
-            }
-            YoriLibFreeStringContents(&FullFilePath);
-            Base64FreeBuffer(&Base64Buffer);
-            return EXIT_FAILURE;
-        }
+        Result = Base64Decode(&Base64Context);
     }
 
     if (FullFilePath.LengthInChars > 0) {
-        CloseHandle(Base64Buffer.hSource);
+        CloseHandle(Base64Context.hSource);
     }
     YoriLibFreeStringContents(&FullFilePath);
-    Base64FreeBuffer(&Base64Buffer);
+    Base64FreeBuffers(&Base64Context);
+
+    if (!Result) {
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,649 @@
+/**
+ * @file bench/bench.c
+ *
+ * Yori shell benchmark suite
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ Help text to display to the user.
+ */
+const
+CHAR strBenchHelpText[] =
+        "\n"
+        "Run benchmarks.\n"
+        "\n"
+        "YORIBENCH [-license] [-v Variation] [-x Variation]\n"
+        "\n"
+        "   -v             Variation to include\n"
+        "   -x             Variation to exclude\n"
+        "\n"
+        "Fixtures are generated in the temporary directory and removed after each\n"
+        "variation.  Variations which run other tools expect them to be in the same\n"
+        "directory as this program.\n"
+        "\n"
+        "Supported variations:\n";
+
+/**
+ A structure to describe a benchmark variation.
+ */
+typedef struct _BENCH_VARIATION {
+
+    /**
+     The function to call to invoke the variation.
+     */
+    PBENCH_FN Fn;
+
+    /**
+     The name of the variation.
+     */
+    LPCTSTR Name;
+
+    /**
+     If TRUE, the execution status of this variation was set explicitly via
+     command line parameter.  If FALSE, default execution should apply.
+     */
+    BOOLEAN ExplicitlySpecified;
+
+    /**
+     If TRUE, the variation should execute.  If FALSE, it should not.  Only
+     meaningful when ExplicitlySpecified is TRUE.
+     */
+    BOOLEAN Execute;
+
+} BENCH_VARIATION, *PBENCH_VARIATION;
+
+
+/**
+ A list of benchmark variations to execute.
+ */
+BENCH_VARIATION BenchVariations[] = {
+    {BenchLineReadAnsi,                    _T("LineReadAnsi")},
+    {BenchLineReadUtf8,                    _T("LineReadUtf8")},
+    {BenchLineReadUtf16,                   _T("LineReadUtf16")},
+    {BenchEnumTree,                        _T("EnumTree")},
+    {BenchHashTable,                       _T("HashTable")},
+    {BenchSPrintf,                         _T("SPrintf")},
+    {BenchFullPath,                        _T("FullPath")},
+    {BenchParseCmdline,                    _T("ParseCmdline")},
+    {BenchYmakeNoop,                       _T("YmakeNoop")},
+    {BenchSdirLargeDir,                    _T("SdirLargeDir")},
+    {BenchToolStartup,                     _T("ToolStartup")},
+    {BenchDyldResolve,                     _T("DyldResolve")},
+};
+
+/**
+ The frequency of the performance counter, in ticks per second.
+ */
+LARGE_INTEGER BenchFrequency;
+
+/**
+ Display usage text to the user.
+ */
+BOOL
+BenchHelp(VOID)
+{
+    DWORD i;
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("YoriBench %i.%02i\n"), YORI_VER_MAJOR, YORI_VER_MINOR);
+#if YORI_BUILD_ID
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Build %i\n"), YORI_BUILD_ID);
+#endif
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%hs"), strBenchHelpText);
+    for (i = 0; i < sizeof(BenchVariations)/sizeof(BenchVariations[0]); i++) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("    %s\n"), BenchVariations[i].Name);
+    }
+    return TRUE;
+}
+
+/**
+ Return the current value of the performance counter.
+
+ @return The current time, in units of BenchFrequency.
+ */
+LONGLONG
+BenchGetTime(VOID)
+{
+    LARGE_INTEGER Now;
+    QueryPerformanceCounter(&Now);
+    return Now.QuadPart;
+}
+
+/**
+ Display the result of a measurement.  Results are displayed in a fixed
+ format so that output from different builds can be compared with text
+ tools.
+
+ @param Name The name of the measurement.
+
+ @param Operations The number of operations performed.
+
+ @param Bytes The number of bytes processed, or zero if the measurement is
+        not bandwidth oriented.
+
+ @param StartTime The value of the performance counter when the measurement
+        started.
+
+ @param EndTime The value of the performance counter when the measurement
+        completed.
+ */
+VOID
+BenchReportResult(
+    __in LPCTSTR Name,
+    __in DWORDLONG Operations,
+    __in DWORDLONG Bytes,
+    __in LONGLONG StartTime,
+    __in LONGLONG EndTime
+    )
+{
+    LONGLONG Elapsed;
+    LONGLONG ElapsedUs;
+    LONGLONG OpsPerSecond;
+    LONGLONG MbPerSecond;
+
+    Elapsed = EndTime - StartTime;
+    if (Elapsed <= 0) {
+        Elapsed = 1;
+    }
+
+    ElapsedUs = Elapsed * 1000000 / BenchFrequency.QuadPart;
+    OpsPerSecond = (LONGLONG)Operations * BenchFrequency.QuadPart / Elapsed;
+
+    if (Bytes != 0) {
+        MbPerSecond = (LONGLONG)Bytes * BenchFrequency.QuadPart / Elapsed / (1024 * 1024);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("    %-28s %10lli us %12lli ops/s %8lli Mb/s\n"), Name, ElapsedUs, OpsPerSecond, MbPerSecond);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("    %-28s %10lli us %12lli ops/s\n"), Name, ElapsedUs, OpsPerSecond);
+    }
+}
+
+/**
+ Create an empty directory in the temporary directory to contain generated
+ fixtures.  If the directory exists from a previous run that did not
+ complete, it is deleted first.
+
+ @param Name The name of the fixture, which is used to generate the
+        directory name.
+
+ @param DirPath On successful completion, populated with the full path to
+        the directory.  The caller should free this with
+        YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchCreateFixtureDirectory(
+    __in LPCTSTR Name,
+    __out PYORI_STRING DirPath
+    )
+{
+    YORI_STRING TempPath;
+
+    if (!YoriLibGetTempPath(&TempPath, 0)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i YoriLibGetTempPath failed\n"), __FILE__, __LINE__);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(DirPath);
+    if (YoriLibYPrintf(DirPath, _T("%yYoriBench%s"), &TempPath, Name) < 0) {
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&TempPath);
+
+    if (GetFileAttributes(DirPath->StartOfString) != (DWORD)-1) {
+        BenchDeleteTree(DirPath);
+    }
+
+    if (!CreateDirectory(DirPath->StartOfString, NULL)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not create %y, error %i\n"), __FILE__, __LINE__, DirPath, GetLastError());
+        YoriLibFreeStringContents(DirPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ A callback invoked for each object found when deleting a fixture.  Child
+ objects are returned before their parent directory, so by the time a
+ directory is found it is empty.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies recursion depth.  Ignored in this application.
+
+ @param Context Pointer to a count of objects which could not be deleted.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+BenchDeleteFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PDWORD FailureCount = (PDWORD)Context;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    if (FileInfo != NULL &&
+        (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+
+        if (!RemoveDirectory(FilePath->StartOfString)) {
+            (*FailureCount)++;
+        }
+    } else {
+        if (!DeleteFile(FilePath->StartOfString)) {
+            (*FailureCount)++;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Delete a fixture directory and everything within it.
+
+ @param DirPath Pointer to the directory to delete.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchDeleteTree(
+    __in PYORI_STRING DirPath
+    )
+{
+    DWORD FailureCount;
+
+    FailureCount = 0;
+    YoriLibForEachFile(DirPath,
+                       YORILIB_FILEENUM_RETURN_FILES |
+                           YORILIB_FILEENUM_RETURN_DIRECTORIES |
+                           YORILIB_FILEENUM_DIRECTORY_CONTENTS |
+                           YORILIB_FILEENUM_RECURSE_BEFORE_RETURN |
+                           YORILIB_FILEENUM_NO_LINK_TRAVERSE,
+                       0,
+                       BenchDeleteFileFoundCallback,
+                       NULL,
+                       &FailureCount);
+
+    if (!RemoveDirectory(DirPath->StartOfString)) {
+        FailureCount++;
+    }
+
+    if (FailureCount > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i %i objects could not be deleted from %y\n"), __FILE__, __LINE__, FailureCount, DirPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Create a file with the specified contents, overwriting any existing file.
+
+ @param FilePath Pointer to the path of the file to create.
+
+ @param Buffer Pointer to the contents of the file.
+
+ @param Length The number of bytes in Buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchWriteFile(
+    __in PYORI_STRING FilePath,
+    __in_bcount(Length) PVOID Buffer,
+    __in DWORD Length
+    )
+{
+    HANDLE hFile;
+    DWORD BytesWritten;
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    hFile = CreateFile(FilePath->StartOfString,
+                       GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE,
+                       NULL,
+                       CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not create %y, error %i\n"), __FILE__, __LINE__, FilePath, GetLastError());
+        return FALSE;
+    }
+
+    if (Length > 0) {
+        if (!WriteFile(hFile, Buffer, Length, &BytesWritten, NULL) ||
+            BytesWritten != Length) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not write %y, error %i\n"), __FILE__, __LINE__, FilePath, GetLastError());
+            CloseHandle(hFile);
+            return FALSE;
+        }
+    }
+
+    CloseHandle(hFile);
+    return TRUE;
+}
+
+/**
+ Create a file containing text in a specified encoding, overwriting any
+ existing file.
+
+ @param FilePath Pointer to the path of the file to create.
+
+ @param Text Pointer to the text to write.
+
+ @param Encoding The encoding to write the text in.
+
+ @param FileSize Optionally points to a location to receive the number of
+        bytes written to the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchWriteTextFile(
+    __in PYORI_STRING FilePath,
+    __in PYORI_STRING Text,
+    __in DWORD Encoding,
+    __out_opt PDWORD FileSize
+    )
+{
+    LPSTR Bytes;
+    YORI_ALLOC_SIZE_T BytesNeeded;
+    DWORD SavedEncoding;
+    BOOLEAN Result;
+
+    SavedEncoding = YoriLibGetMultibyteOutputEncoding();
+    YoriLibSetMultibyteOutputEncoding(Encoding);
+
+    BytesNeeded = YoriLibGetMultibyteOutputSizeNeeded(Text->StartOfString, Text->LengthInChars);
+    Bytes = YoriLibMalloc(BytesNeeded);
+    if (Bytes == NULL) {
+        YoriLibSetMultibyteOutputEncoding(SavedEncoding);
+        return FALSE;
+    }
+
+    YoriLibMultibyteOutput(Text->StartOfString, Text->LengthInChars, Bytes, BytesNeeded);
+    YoriLibSetMultibyteOutputEncoding(SavedEncoding);
+
+    Result = BenchWriteFile(FilePath, Bytes, BytesNeeded);
+    if (FileSize != NULL) {
+        *FileSize = BytesNeeded;
+    }
+    YoriLibFree(Bytes);
+
+    return Result;
+}
+
+/**
+ Find the full path to a tool which is expected to be installed in the same
+ directory as this program.
+
+ @param ToolName The file name of the tool, including extension.
+
+ @param ToolPath On successful completion, populated with the full path to
+        the tool.  The caller should free this with YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchGetToolPath(
+    __in LPCTSTR ToolName,
+    __out PYORI_STRING ToolPath
+    )
+{
+    YORI_STRING MyPath;
+    LPTSTR FinalSlash;
+
+    if (!YoriLibAllocateString(&MyPath, 32768)) {
+        return FALSE;
+    }
+
+    MyPath.LengthInChars = (YORI_ALLOC_SIZE_T)GetModuleFileName(NULL, MyPath.StartOfString, MyPath.LengthAllocated);
+    if (MyPath.LengthInChars == 0 || MyPath.LengthInChars >= MyPath.LengthAllocated) {
+        YoriLibFreeStringContents(&MyPath);
+        return FALSE;
+    }
+
+    FinalSlash = YoriLibFindRightMostCharacter(&MyPath, '\\');
+    if (FinalSlash == NULL) {
+        YoriLibFreeStringContents(&MyPath);
+        return FALSE;
+    }
+
+    MyPath.LengthInChars = (YORI_ALLOC_SIZE_T)(FinalSlash - MyPath.StartOfString + 1);
+
+    YoriLibInitEmptyString(ToolPath);
+    if (YoriLibYPrintf(ToolPath, _T("%y%s"), &MyPath, ToolName) < 0) {
+        YoriLibFreeStringContents(&MyPath);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&MyPath);
+
+    if (GetFileAttributes(ToolPath->StartOfString) == (DWORD)-1) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y not found, skipping\n"), ToolPath);
+        YoriLibFreeStringContents(ToolPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Execute a child process with output discarded, wait for it to complete,
+ and return how long it took.
+
+ @param CmdLine The command line to execute.  This must be NULL terminated.
+
+ @param CurrentDirectory The directory for the child process to execute in.
+
+ @param Elapsed On successful completion, populated with the time the child
+        took to execute, in units of the performance counter frequency.
+
+ @return TRUE if the child was executed and returned success, FALSE if not.
+ */
+BOOLEAN
+BenchRunProcess(
+    __in PYORI_STRING CmdLine,
+    __in PYORI_STRING CurrentDirectory,
+    __out PLONGLONG Elapsed
+    )
+{
+    STARTUPINFO StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    SECURITY_ATTRIBUTES InheritAttributes;
+    HANDLE hNul;
+    LONGLONG StartTime;
+    DWORD ExitCode;
+
+    ASSERT(YoriLibIsStringNullTerminated(CmdLine));
+    ASSERT(YoriLibIsStringNullTerminated(CurrentDirectory));
+
+    ZeroMemory(&InheritAttributes, sizeof(InheritAttributes));
+    InheritAttributes.nLength = sizeof(InheritAttributes);
+    InheritAttributes.bInheritHandle = TRUE;
+
+    hNul = CreateFile(_T("NUL"),
+                      GENERIC_READ | GENERIC_WRITE,
+                      FILE_SHARE_READ | FILE_SHARE_WRITE,
+                      &InheritAttributes,
+                      OPEN_EXISTING,
+                      0,
+                      NULL);
+
+    if (hNul == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+    StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    StartupInfo.hStdInput = hNul;
+    StartupInfo.hStdOutput = hNul;
+    StartupInfo.hStdError = hNul;
+
+    StartTime = BenchGetTime();
+    if (!CreateProcess(NULL, CmdLine->StartOfString, NULL, NULL, TRUE, 0, NULL, CurrentDirectory->StartOfString, &StartupInfo, &ProcessInfo)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not execute %y, error %i\n"), __FILE__, __LINE__, CmdLine, GetLastError());
+        CloseHandle(hNul);
+        return FALSE;
+    }
+
+    WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+    *Elapsed = BenchGetTime() - StartTime;
+
+    ExitCode = EXIT_FAILURE;
+    GetExitCodeProcess(ProcessInfo.hProcess, &ExitCode);
+
+    CloseHandle(ProcessInfo.hProcess);
+    CloseHandle(ProcessInfo.hThread);
+    CloseHandle(hNul);
+
+    if (ExitCode != EXIT_SUCCESS) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i %y returned %i\n"), __FILE__, __LINE__, CmdLine, ExitCode);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ The main entrypoint for the benchmark cmdlet.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @return Exit code of the process, zero indicating success or nonzero on
+         failure.
+ */
+DWORD
+ymain(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    YORI_ALLOC_SIZE_T i;
+    WORD Var;
+    WORD Succeeded;
+    WORD Failed;
+    YORI_STRING Arg;
+    BOOLEAN ArgumentUnderstood;
+    BOOLEAN RunAll;
+    BOOLEAN ExecuteVariation;
+
+    RunAll = TRUE;
+
+    for (i = 1; i < ArgC; i++) {
+
+        ArgumentUnderstood = FALSE;
+        ASSERT(YoriLibIsStringNullTerminated(&ArgV[i]));
+
+        if (YoriLibIsCommandLineOption(&ArgV[i], &Arg)) {
+
+            if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
+                BenchHelp();
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
+                YoriLibDisplayMitLicense(_T("2026"));
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("v")) == 0) {
+                if (ArgC > i + 1) {
+                    for (Var = 0; Var < sizeof(BenchVariations)/sizeof(BenchVariations[0]); Var++) {
+                        if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], BenchVariations[Var].Name) == 0) {
+                            BenchVariations[Var].ExplicitlySpecified = TRUE;
+                            BenchVariations[Var].Execute = TRUE;
+                            RunAll = FALSE;
+                        }
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("x")) == 0) {
+                if (ArgC > i + 1) {
+                    for (Var = 0; Var < sizeof(BenchVariations)/sizeof(BenchVariations[0]); Var++) {
+                        if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], BenchVariations[Var].Name) == 0) {
+                            BenchVariations[Var].ExplicitlySpecified = TRUE;
+                            BenchVariations[Var].Execute = FALSE;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (!QueryPerformanceFrequency(&BenchFrequency) || BenchFrequency.QuadPart == 0) {
+        BenchFrequency.QuadPart = 1000;
+    }
+
+    Succeeded = 0;
+    Failed = 0;
+
+    for (i = 0; i < sizeof(BenchVariations)/sizeof(BenchVariations[0]); i++) {
+
+        ExecuteVariation = FALSE;
+        if (RunAll) {
+            if (!BenchVariations[i].ExplicitlySpecified ||
+                BenchVariations[i].Execute) {
+
+                ExecuteVariation = TRUE;
+            }
+        } else {
+            if (BenchVariations[i].ExplicitlySpecified &&
+                BenchVariations[i].Execute) {
+
+                ExecuteVariation = TRUE;
+            }
+        }
+
+        if (ExecuteVariation) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s...\n"), BenchVariations[i].Name);
+            if (BenchVariations[i].Fn()) {
+                Succeeded++;
+            } else {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s FAILED\n"), BenchVariations[i].Name);
+                Failed++;
+            }
+        }
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%i succeeded, %i failed\n"), Succeeded, Failed);
+
+    if (Failed == 0) {
+        return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+// vim:sw=4:ts=4:et:
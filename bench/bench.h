@@ -0,0 +1,152 @@
+/**
+ * @file bench/bench.h
+ *
+ * Yori shell benchmark header
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ Specifies the function signature for a benchmark variation.
+ */
+typedef
+BOOLEAN
+BENCH_FN(VOID);
+
+/**
+ A pointer to a benchmark variation.
+ */
+typedef BENCH_FN *PBENCH_FN;
+
+LONGLONG
+BenchGetTime(VOID);
+
+VOID
+BenchReportResult(
+    __in LPCTSTR Name,
+    __in DWORDLONG Operations,
+    __in DWORDLONG Bytes,
+    __in LONGLONG StartTime,
+    __in LONGLONG EndTime
+    );
+
+BOOLEAN
+BenchCreateFixtureDirectory(
+    __in LPCTSTR Name,
+    __out PYORI_STRING DirPath
+    );
+
+BOOLEAN
+BenchDeleteTree(
+    __in PYORI_STRING DirPath
+    );
+
+BOOLEAN
+BenchWriteFile(
+    __in PYORI_STRING FilePath,
+    __in_bcount(Length) PVOID Buffer,
+    __in DWORD Length
+    );
+
+BOOLEAN
+BenchWriteTextFile(
+    __in PYORI_STRING FilePath,
+    __in PYORI_STRING Text,
+    __in DWORD Encoding,
+    __out_opt PDWORD FileSize
+    );
+
+BOOLEAN
+BenchGetToolPath(
+    __in LPCTSTR ToolName,
+    __out PYORI_STRING ToolPath
+    );
+
+BOOLEAN
+BenchRunProcess(
+    __in PYORI_STRING CmdLine,
+    __in PYORI_STRING CurrentDirectory,
+    __out PLONGLONG Elapsed
+    );
+
+/**
+ A benchmark variation to read ANSI text one line at a time.
+ */
+BENCH_FN BenchLineReadAnsi;
+
+/**
+ A benchmark variation to read UTF-8 text one line at a time.
+ */
+BENCH_FN BenchLineReadUtf8;
+
+/**
+ A benchmark variation to read UTF-16 text one line at a time.
+ */
+BENCH_FN BenchLineReadUtf16;
+
+/**
+ A benchmark variation to recursively enumerate a generated tree.
+ */
+BENCH_FN BenchEnumTree;
+
+/**
+ A benchmark variation to insert, look up and remove hash table entries.
+ */
+BENCH_FN BenchHashTable;
+
+/**
+ A benchmark variation to format strings.
+ */
+BENCH_FN BenchSPrintf;
+
+/**
+ A benchmark variation to resolve paths into full paths.
+ */
+BENCH_FN BenchFullPath;
+
+/**
+ A benchmark variation to parse command lines into arguments.
+ */
+BENCH_FN BenchParseCmdline;
+
+/**
+ A benchmark variation to run ymake against an up to date generated
+ makefile.
+ */
+BENCH_FN BenchYmakeNoop;
+
+/**
+ A benchmark variation to run sdir against a large generated directory.
+ */
+BENCH_FN BenchSdirLargeDir;
+
+/**
+ A benchmark variation to measure the startup cost of small tools.
+ */
+BENCH_FN BenchToolStartup;
+
+/**
+ A benchmark variation to measure resolving optional functions from
+ kernel32 and ntdll.
+ */
+BENCH_FN BenchDyldResolve;
+
+// vim:sw=4:ts=4:et:
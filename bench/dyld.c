@@ -0,0 +1,84 @@
+/**
+ * @file bench/dyld.c
+ *
+ * Yori shell benchmark dynamic function resolution
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of times to resolve the function tables.
+ */
+#define BENCH_DYLD_ITERATIONS (1000)
+
+/**
+ A benchmark variation to measure the cost of resolving the optional
+ kernel32 and ntdll functions, which every tool does as it starts.  The
+ resolved tables are saved and restored around the measurement so the rest
+ of the program is unaffected.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchDyldResolve(VOID)
+{
+    YORI_KERNEL32_FUNCTIONS SavedKernel32;
+    YORI_NTDLL_FUNCTIONS SavedNtDll;
+    DWORD Index;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+
+    memcpy(&SavedNtDll, &DllNtDll, sizeof(DllNtDll));
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_DYLD_ITERATIONS; Index++) {
+        ZeroMemory(&DllNtDll, sizeof(DllNtDll));
+        YoriLibLoadNtDllFunctions();
+    }
+    EndTime = BenchGetTime();
+    memcpy(&DllNtDll, &SavedNtDll, sizeof(DllNtDll));
+    BenchReportResult(_T("DyldNtDll"), BENCH_DYLD_ITERATIONS, 0, StartTime, EndTime);
+
+    //
+    //  Note that nothing in the loop can call into a function which uses
+    //  these pointers, since they are temporarily incomplete.
+    //
+
+    memcpy(&SavedKernel32, &DllKernel32, sizeof(DllKernel32));
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_DYLD_ITERATIONS; Index++) {
+        ZeroMemory(&DllKernel32, sizeof(DllKernel32));
+        YoriLibLoadKernel32Functions();
+        if (DllKernel32.hDllKernel32Legacy != NULL) {
+            FreeLibrary(DllKernel32.hDllKernel32Legacy);
+        }
+    }
+    EndTime = BenchGetTime();
+    memcpy(&DllKernel32, &SavedKernel32, sizeof(DllKernel32));
+    BenchReportResult(_T("DyldKernel32"), BENCH_DYLD_ITERATIONS, 0, StartTime, EndTime);
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
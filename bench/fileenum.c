@@ -0,0 +1,239 @@
+/**
+ * @file bench/fileenum.c
+ *
+ * Yori shell benchmark file enumeration
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of directories to create below the fixture root.
+ */
+#define BENCH_ENUM_TOP_DIRECTORIES (10)
+
+/**
+ The number of directories to create below each top level directory.
+ */
+#define BENCH_ENUM_CHILD_DIRECTORIES (10)
+
+/**
+ The number of files to create in each child directory.
+ */
+#define BENCH_ENUM_FILES_PER_DIRECTORY (100)
+
+/**
+ The total number of objects in the generated tree, excluding the root.
+ */
+#define BENCH_ENUM_OBJECT_COUNT \
+    (BENCH_ENUM_TOP_DIRECTORIES + \
+     BENCH_ENUM_TOP_DIRECTORIES * BENCH_ENUM_CHILD_DIRECTORIES + \
+     BENCH_ENUM_TOP_DIRECTORIES * BENCH_ENUM_CHILD_DIRECTORIES * BENCH_ENUM_FILES_PER_DIRECTORY)
+
+/**
+ The number of times to enumerate the tree for each measurement.
+ */
+#define BENCH_ENUM_PASSES (3)
+
+/**
+ Generate a tree of directories and empty files below a fixture directory.
+
+ @param FixtureDir Pointer to the root of the tree.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchEnumGenerateTree(
+    __in PYORI_STRING FixtureDir
+    )
+{
+    YORI_STRING Path;
+    DWORD TopIndex;
+    DWORD ChildIndex;
+    DWORD FileIndex;
+    BOOLEAN Result;
+
+    if (!YoriLibAllocateString(&Path, FixtureDir->LengthInChars + 64)) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    for (TopIndex = 0; TopIndex < BENCH_ENUM_TOP_DIRECTORIES; TopIndex++) {
+        Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\dir%02i"), FixtureDir, TopIndex);
+        if (!CreateDirectory(Path.StartOfString, NULL)) {
+            goto Exit;
+        }
+        for (ChildIndex = 0; ChildIndex < BENCH_ENUM_CHILD_DIRECTORIES; ChildIndex++) {
+            Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\dir%02i\\sub%02i"), FixtureDir, TopIndex, ChildIndex);
+            if (!CreateDirectory(Path.StartOfString, NULL)) {
+                goto Exit;
+            }
+            for (FileIndex = 0; FileIndex < BENCH_ENUM_FILES_PER_DIRECTORY; FileIndex++) {
+                Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\dir%02i\\sub%02i\\file%04i.txt"), FixtureDir, TopIndex, ChildIndex, FileIndex);
+                if (!BenchWriteFile(&Path, NULL, 0)) {
+                    goto Exit;
+                }
+            }
+        }
+    }
+
+    Result = TRUE;
+
+Exit:
+    if (!Result) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not create %y, error %i\n"), __FILE__, __LINE__, &Path, GetLastError());
+    }
+    YoriLibFreeStringContents(&Path);
+    return Result;
+}
+
+/**
+ A callback invoked for each object found in the generated tree.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies recursion depth.  Ignored in this application.
+
+ @param Context Pointer to a count of objects found.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+BenchEnumFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PDWORD ObjectsFound = (PDWORD)Context;
+
+    UNREFERENCED_PARAMETER(FilePath);
+    UNREFERENCED_PARAMETER(FileInfo);
+    UNREFERENCED_PARAMETER(Depth);
+
+    (*ObjectsFound)++;
+    return TRUE;
+}
+
+/**
+ Enumerate the generated tree repeatedly with a specified set of flags and
+ report the time taken.
+
+ @param Name The name of the measurement to report.
+
+ @param FixtureDir Pointer to the root of the generated tree.
+
+ @param ExtraFlags Flags to supply to YoriLibForEachFile in addition to
+        those needed to recursively return every object.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchEnumMeasure(
+    __in LPCTSTR Name,
+    __in PYORI_STRING FixtureDir,
+    __in WORD ExtraFlags
+    )
+{
+    DWORD ObjectsFound;
+    DWORD Pass;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+    WORD MatchFlags;
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
+                 YORILIB_FILEENUM_RETURN_DIRECTORIES |
+                 YORILIB_FILEENUM_DIRECTORY_CONTENTS |
+                 YORILIB_FILEENUM_RECURSE_AFTER_RETURN |
+                 ExtraFlags;
+
+    StartTime = BenchGetTime();
+    for (Pass = 0; Pass < BENCH_ENUM_PASSES; Pass++) {
+        ObjectsFound = 0;
+        if (!YoriLibForEachFile(FixtureDir, MatchFlags, 0, BenchEnumFileFoundCallback, NULL, &ObjectsFound)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i YoriLibForEachFile failed searching %y, error %i\n"), __FILE__, __LINE__, FixtureDir, GetLastError());
+            return FALSE;
+        }
+
+        if (ObjectsFound != BENCH_ENUM_OBJECT_COUNT) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Found %i objects, expected %i\n"), __FILE__, __LINE__, ObjectsFound, BENCH_ENUM_OBJECT_COUNT);
+            return FALSE;
+        }
+    }
+    EndTime = BenchGetTime();
+
+    BenchReportResult(Name, (DWORDLONG)BENCH_ENUM_OBJECT_COUNT * BENCH_ENUM_PASSES, 0, StartTime, EndTime);
+    return TRUE;
+}
+
+/**
+ A benchmark variation to recursively enumerate a generated tree, both
+ serially and in parallel.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchEnumTree(VOID)
+{
+    YORI_STRING FixtureDir;
+    BOOLEAN Result;
+
+    if (!BenchCreateFixtureDirectory(_T("EnumTree"), &FixtureDir)) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (!BenchEnumGenerateTree(&FixtureDir)) {
+        goto Exit;
+    }
+
+    //
+    //  The first measurement includes the cost of caching the tree, so it
+    //  is reported separately.
+    //
+
+    if (!BenchEnumMeasure(_T("EnumTreeFirst"), &FixtureDir, 0)) {
+        goto Exit;
+    }
+
+    if (!BenchEnumMeasure(_T("EnumTreeSerial"), &FixtureDir, YORILIB_FILEENUM_NO_SHORT_NAMES)) {
+        goto Exit;
+    }
+
+    if (!BenchEnumMeasure(_T("EnumTreeParallel"), &FixtureDir, YORILIB_FILEENUM_PARALLEL | YORILIB_FILEENUM_NO_SHORT_NAMES)) {
+        goto Exit;
+    }
+
+    Result = TRUE;
+
+Exit:
+    BenchDeleteTree(&FixtureDir);
+    YoriLibFreeStringContents(&FixtureDir);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
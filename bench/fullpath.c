@@ -0,0 +1,101 @@
+/**
+ * @file bench/fullpath.c
+ *
+ * Yori shell benchmark full path resolution
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of paths to resolve for each measurement.
+ */
+#define BENCH_FULLPATH_ITERATIONS (200000)
+
+/**
+ A benchmark variation to resolve relative and absolute paths into full
+ paths.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchFullPath(VOID)
+{
+    TCHAR Buffer[MAX_PATH];
+    YORI_STRING Relative;
+    YORI_STRING Absolute;
+    YORI_STRING FullPath;
+    DWORD Index;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+
+    YoriLibConstantString(&Relative, _T("..\\subdir\\.\\file.txt"));
+    YoriLibConstantString(&Absolute, _T("C:\\Windows\\System32\\..\\System32\\kernel32.dll"));
+
+    //
+    //  Resolve into a new allocation each time, which is what most callers
+    //  do.
+    //
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_FULLPATH_ITERATIONS; Index++) {
+        YoriLibInitEmptyString(&FullPath);
+        if (!YoriLibGetFullPathNameReturnAllocation(&Relative, TRUE, &FullPath, NULL)) {
+            return FALSE;
+        }
+        YoriLibFreeStringContents(&FullPath);
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("FullPathRelativeAlloc"), BENCH_FULLPATH_ITERATIONS, 0, StartTime, EndTime);
+
+    //
+    //  Resolve into a buffer that is reused across calls.
+    //
+
+    YoriLibInitEmptyString(&FullPath);
+    FullPath.StartOfString = Buffer;
+    FullPath.LengthAllocated = sizeof(Buffer)/sizeof(Buffer[0]);
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_FULLPATH_ITERATIONS; Index++) {
+        if (!YoriLibGetFullPathNameToBuffer(&Relative, TRUE, &FullPath, NULL)) {
+            return FALSE;
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("FullPathRelativeBuffer"), BENCH_FULLPATH_ITERATIONS, 0, StartTime, EndTime);
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_FULLPATH_ITERATIONS; Index++) {
+        if (!YoriLibGetFullPathNameToBuffer(&Absolute, TRUE, &FullPath, NULL)) {
+            return FALSE;
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("FullPathAbsoluteBuffer"), BENCH_FULLPATH_ITERATIONS, 0, StartTime, EndTime);
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,176 @@
+/**
+ * @file bench/hash.c
+ *
+ * Yori shell benchmark hash tables
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of entries to insert into the hash table.
+ */
+#define BENCH_HASH_ENTRY_COUNT (100000)
+
+/**
+ The number of buckets in the hash table.
+ */
+#define BENCH_HASH_BUCKET_COUNT (4099)
+
+/**
+ The number of characters in each key, excluding the NULL terminator.
+ */
+#define BENCH_HASH_KEY_LENGTH (sizeof("HashBenchmarkKey00000000") - 1)
+
+/**
+ The number of times every key is looked up.
+ */
+#define BENCH_HASH_LOOKUP_PASSES (4)
+
+/**
+ A benchmark variation to insert, look up and remove hash table entries.
+ Keys are generated in a single allocation and entries are preallocated, so
+ the measurements reflect the cost of the hash table rather than the
+ allocator.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchHashTable(VOID)
+{
+    PYORI_HASH_TABLE HashTable;
+    PYORI_HASH_ENTRY Entries;
+    PYORI_STRING Keys;
+    LPTSTR KeyBuffer;
+    PYORI_HASH_ENTRY Found;
+    YORI_STRING LookupKey;
+    TCHAR LookupBuffer[BENCH_HASH_KEY_LENGTH + 1];
+    DWORD Index;
+    DWORD Inserted;
+    DWORD Pass;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+    BOOLEAN Result;
+
+    HashTable = YoriLibAllocateHashTable(BENCH_HASH_BUCKET_COUNT);
+    Entries = YoriLibMalloc(BENCH_HASH_ENTRY_COUNT * sizeof(YORI_HASH_ENTRY));
+    Keys = YoriLibMalloc(BENCH_HASH_ENTRY_COUNT * sizeof(YORI_STRING));
+    KeyBuffer = YoriLibMalloc(BENCH_HASH_ENTRY_COUNT * (BENCH_HASH_KEY_LENGTH + 1) * sizeof(TCHAR));
+    Inserted = 0;
+    Result = FALSE;
+
+    if (HashTable == NULL || Entries == NULL || Keys == NULL || KeyBuffer == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Allocation failure\n"), __FILE__, __LINE__);
+        goto Exit;
+    }
+
+    //
+    //  Multiplying by an odd constant gives each index a unique key while
+    //  spreading keys across the range of values.
+    //
+
+    for (Index = 0; Index < BENCH_HASH_ENTRY_COUNT; Index++) {
+        YoriLibInitEmptyString(&Keys[Index]);
+        Keys[Index].StartOfString = &KeyBuffer[Index * (BENCH_HASH_KEY_LENGTH + 1)];
+        Keys[Index].LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Keys[Index].StartOfString, _T("HashBenchmarkKey%08x"), Index * 2654435761);
+        Keys[Index].LengthAllocated = BENCH_HASH_KEY_LENGTH + 1;
+    }
+
+    StartTime = BenchGetTime();
+    for (Inserted = 0; Inserted < BENCH_HASH_ENTRY_COUNT; Inserted++) {
+        YoriLibHashInsertByKey(HashTable, &Keys[Inserted], &Keys[Inserted], &Entries[Inserted]);
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("HashInsert"), BENCH_HASH_ENTRY_COUNT, 0, StartTime, EndTime);
+
+    StartTime = BenchGetTime();
+    for (Pass = 0; Pass < BENCH_HASH_LOOKUP_PASSES; Pass++) {
+        for (Index = 0; Index < BENCH_HASH_ENTRY_COUNT; Index++) {
+            Found = YoriLibHashLookupByKey(HashTable, &Keys[Index]);
+            if (Found != &Entries[Index]) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Lookup of %y returned the wrong entry\n"), __FILE__, __LINE__, &Keys[Index]);
+                goto Exit;
+            }
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("HashLookupHit"), (DWORDLONG)BENCH_HASH_ENTRY_COUNT * BENCH_HASH_LOOKUP_PASSES, 0, StartTime, EndTime);
+
+    //
+    //  Look up keys that differ from inserted keys only in case, which
+    //  exercises the case insensitive comparison.  This includes the cost
+    //  of generating each key.
+    //
+
+    YoriLibInitEmptyString(&LookupKey);
+    LookupKey.StartOfString = LookupBuffer;
+    LookupKey.LengthAllocated = sizeof(LookupBuffer)/sizeof(LookupBuffer[0]);
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_HASH_ENTRY_COUNT; Index++) {
+        LookupKey.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(LookupBuffer, _T("hashbenchmarkkey%08x"), Index * 2654435761);
+        Found = YoriLibHashLookupByKey(HashTable, &LookupKey);
+        if (Found != &Entries[Index]) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Lookup of %y returned the wrong entry\n"), __FILE__, __LINE__, &LookupKey);
+            goto Exit;
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("HashLookupCase"), BENCH_HASH_ENTRY_COUNT, 0, StartTime, EndTime);
+
+    YoriLibInitEmptyString(&LookupKey);
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_HASH_ENTRY_COUNT; Index++) {
+        LookupKey.StartOfString = Keys[Index].StartOfString;
+        LookupKey.LengthInChars = Keys[Index].LengthInChars - 1;
+        Found = YoriLibHashLookupByKey(HashTable, &LookupKey);
+        if (Found != NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Lookup of %y unexpectedly succeeded\n"), __FILE__, __LINE__, &LookupKey);
+            goto Exit;
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("HashLookupMiss"), BENCH_HASH_ENTRY_COUNT, 0, StartTime, EndTime);
+
+    Result = TRUE;
+
+Exit:
+    for (Index = 0; Index < Inserted; Index++) {
+        YoriLibHashRemoveByEntry(&Entries[Index]);
+    }
+    if (HashTable != NULL) {
+        YoriLibFreeEmptyHashTable(HashTable);
+    }
+    if (Entries != NULL) {
+        YoriLibFree(Entries);
+    }
+    if (Keys != NULL) {
+        YoriLibFree(Keys);
+    }
+    if (KeyBuffer != NULL) {
+        YoriLibFree(KeyBuffer);
+    }
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,257 @@
+/**
+ * @file bench/lineread.c
+ *
+ * Yori shell benchmark line reading
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of lines to generate in the fixture file.
+ */
+#define BENCH_LINE_READ_LINE_COUNT (200000)
+
+/**
+ The number of times to read the fixture file.  The file is read once
+ before these to ensure it is cached.
+ */
+#define BENCH_LINE_READ_PASSES (4)
+
+/**
+ Generate a fixture file containing text in a specified encoding.
+
+ @param FilePath Pointer to the path of the file to create.
+
+ @param Encoding The encoding to write the file in.
+
+ @param IncludeNonAscii If TRUE, each line contains characters which are
+        outside of the ASCII range so that they are converted as part of
+        reading.  This is only meaningful for Unicode encodings.
+
+ @param FileSize On successful completion, updated to contain the number of
+        bytes in the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadGenerateFile(
+    __in PYORI_STRING FilePath,
+    __in DWORD Encoding,
+    __in BOOLEAN IncludeNonAscii,
+    __out PDWORD FileSize
+    )
+{
+    YORI_STRING Text;
+    YORI_ALLOC_SIZE_T LineLength;
+    DWORD Index;
+    BOOLEAN Result;
+
+    if (!YoriLibAllocateString(&Text, BENCH_LINE_READ_LINE_COUNT * 80)) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < BENCH_LINE_READ_LINE_COUNT; Index++) {
+        if (IncludeNonAscii) {
+            LineLength = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars],
+                                                           _T("%08i The quick brown fox jumps over the lazy dog \x00e9\x00fc\x20ac\x03a9\r\n"),
+                                                           Index);
+        } else {
+            LineLength = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars],
+                                                           _T("%08i The quick brown fox jumps over the lazy dog\r\n"),
+                                                           Index);
+        }
+        Text.LengthInChars = Text.LengthInChars + LineLength;
+    }
+
+    Result = BenchWriteTextFile(FilePath, &Text, Encoding, FileSize);
+    YoriLibFreeStringContents(&Text);
+
+    return Result;
+}
+
+/**
+ Read a fixture file one line at a time.
+
+ @param FilePath Pointer to the path of the file to read.
+
+ @param LinesFound On successful completion, updated to contain the number
+        of lines read.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadFile(
+    __in PYORI_STRING FilePath,
+    __out PDWORD LinesFound
+    )
+{
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    HANDLE hFile;
+
+    hFile = CreateFile(FilePath->StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not open %y, error %i\n"), __FILE__, __LINE__, FilePath, GetLastError());
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+    *LinesFound = 0;
+
+    while (YoriLibReadLineToString(&LineString, &LineContext, hFile)) {
+        (*LinesFound)++;
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hFile);
+    return TRUE;
+}
+
+/**
+ Measure reading a generated file in a specified encoding.
+
+ @param Name The name of the measurement to report.
+
+ @param Encoding The encoding of the file to generate and read.
+
+ @param IncludeNonAscii If TRUE, each line contains characters which are
+        outside of the ASCII range.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadEncoding(
+    __in LPCTSTR Name,
+    __in DWORD Encoding,
+    __in BOOLEAN IncludeNonAscii
+    )
+{
+    YORI_STRING FixtureDir;
+    YORI_STRING FilePath;
+    DWORD FileSize;
+    DWORD LinesFound;
+    DWORD SavedEncoding;
+    DWORD Pass;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+    BOOLEAN Result;
+
+    if (!BenchCreateFixtureDirectory(Name, &FixtureDir)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FilePath);
+    if (YoriLibYPrintf(&FilePath, _T("%y\\lines.txt"), &FixtureDir) < 0) {
+        BenchDeleteTree(&FixtureDir);
+        YoriLibFreeStringContents(&FixtureDir);
+        return FALSE;
+    }
+
+    Result = FALSE;
+    SavedEncoding = YoriLibGetMultibyteInputEncoding();
+    YoriLibSetMultibyteInputEncoding(Encoding);
+
+    if (!BenchLineReadGenerateFile(&FilePath, Encoding, IncludeNonAscii, &FileSize)) {
+        goto Exit;
+    }
+
+    if (!BenchLineReadFile(&FilePath, &LinesFound)) {
+        goto Exit;
+    }
+
+    if (LinesFound != BENCH_LINE_READ_LINE_COUNT) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Read %i lines, expected %i\n"), __FILE__, __LINE__, LinesFound, BENCH_LINE_READ_LINE_COUNT);
+        goto Exit;
+    }
+
+    StartTime = BenchGetTime();
+    for (Pass = 0; Pass < BENCH_LINE_READ_PASSES; Pass++) {
+        if (!BenchLineReadFile(&FilePath, &LinesFound)) {
+            goto Exit;
+        }
+    }
+    EndTime = BenchGetTime();
+
+    BenchReportResult(Name,
+                      (DWORDLONG)BENCH_LINE_READ_LINE_COUNT * BENCH_LINE_READ_PASSES,
+                      (DWORDLONG)FileSize * BENCH_LINE_READ_PASSES,
+                      StartTime,
+                      EndTime);
+
+    Result = TRUE;
+
+Exit:
+    YoriLibSetMultibyteInputEncoding(SavedEncoding);
+    YoriLibLineReadCleanupCache();
+    YoriLibFreeStringContents(&FilePath);
+    BenchDeleteTree(&FixtureDir);
+    YoriLibFreeStringContents(&FixtureDir);
+    return Result;
+}
+
+/**
+ A benchmark variation to read ANSI text one line at a time.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadAnsi(VOID)
+{
+    return BenchLineReadEncoding(_T("LineReadAnsi"), CP_ACP, FALSE);
+}
+
+/**
+ A benchmark variation to read UTF-8 text containing non-ASCII characters
+ one line at a time.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadUtf8(VOID)
+{
+    return BenchLineReadEncoding(_T("LineReadUtf8"), CP_UTF8, TRUE);
+}
+
+/**
+ A benchmark variation to read UTF-16 text containing non-ASCII characters
+ one line at a time.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchLineReadUtf16(VOID)
+{
+    return BenchLineReadEncoding(_T("LineReadUtf16"), CP_UTF16, TRUE);
+}
+
+// vim:sw=4:ts=4:et:
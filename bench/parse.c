@@ -0,0 +1,104 @@
+/**
+ * @file bench/parse.c
+ *
+ * Yori shell benchmark command parsing
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "bench.h"
+
+/**
+ The number of times to parse each command line.
+ */
+#define BENCH_PARSE_ITERATIONS (20000)
+
+/**
+ A set of representative command lines to parse.
+ */
+LPCTSTR BenchParseCmdlines[] = {
+    _T("dir"),
+    _T("sdir -fo fs C:\\Windows\\System32\\*.dll"),
+    _T("type \"C:\\Program Files\\Yori\\readme.txt\" | grep -i \"some text\" > out.txt"),
+    _T("for -p 4 %i in (*.c) do cl -nologo -c %i 2>&1 >>build.log"),
+    _T("if exist foo.txt;echo yes;echo no & ymake -j 8 && echo done || echo failed"),
+    _T("echo `ydate $YEAR$$MON$$DAY$` ^& \"quoted ^\" text\" \\\\server\\share\\path\\"),
+};
+
+/**
+ A benchmark variation to parse command lines into arguments and then into
+ execution plans.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchParseCmdline(VOID)
+{
+    YORI_LIBSH_CMD_CONTEXT CmdContext;
+    YORI_LIBSH_EXEC_PLAN ExecPlan;
+    YORI_STRING CmdLines[sizeof(BenchParseCmdlines)/sizeof(BenchParseCmdlines[0])];
+    DWORD CmdIndex;
+    DWORD Index;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+    LONGLONG CmdContextTime;
+    LONGLONG ExecPlanTime;
+    LONGLONG PhaseTime;
+
+    for (CmdIndex = 0; CmdIndex < sizeof(CmdLines)/sizeof(CmdLines[0]); CmdIndex++) {
+        YoriLibConstantString(&CmdLines[CmdIndex], BenchParseCmdlines[CmdIndex]);
+    }
+
+    CmdContextTime = 0;
+    ExecPlanTime = 0;
+
+    for (Index = 0; Index < BENCH_PARSE_ITERATIONS; Index++) {
+        for (CmdIndex = 0; CmdIndex < sizeof(CmdLines)/sizeof(CmdLines[0]); CmdIndex++) {
+            StartTime = BenchGetTime();
+            if (!YoriLibShParseCmdlineToCmdContext(&CmdLines[CmdIndex], 0, &CmdContext)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i YoriLibShParseCmdlineToCmdContext failed on '%y'\n"), __FILE__, __LINE__, &CmdLines[CmdIndex]);
+                return FALSE;
+            }
+            PhaseTime = BenchGetTime();
+            CmdContextTime = CmdContextTime + PhaseTime - StartTime;
+
+            if (!YoriLibShParseCmdContextToExecPlan(&CmdContext, &ExecPlan, NULL, NULL, NULL, NULL)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i YoriLibShParseCmdContextToExecPlan failed on '%y'\n"), __FILE__, __LINE__, &CmdLines[CmdIndex]);
+                YoriLibShFreeCmdContext(&CmdContext);
+                return FALSE;
+            }
+            EndTime = BenchGetTime();
+            ExecPlanTime = ExecPlanTime + EndTime - PhaseTime;
+
+            YoriLibShFreeExecPlan(&ExecPlan);
+            YoriLibShFreeCmdContext(&CmdContext);
+        }
+    }
+
+    BenchReportResult(_T("ParseCmdContext"), (DWORDLONG)BENCH_PARSE_ITERATIONS * (sizeof(CmdLines)/sizeof(CmdLines[0])), 0, 0, CmdContextTime);
+    BenchReportResult(_T("ParseExecPlan"), (DWORDLONG)BENCH_PARSE_ITERATIONS * (sizeof(CmdLines)/sizeof(CmdLines[0])), 0, 0, ExecPlanTime);
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
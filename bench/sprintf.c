@@ -0,0 +1,95 @@
+/**
+ * @file bench/sprintf.c
+ *
+ * Yori shell benchmark string formatting
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of strings to format for each measurement.
+ */
+#define BENCH_SPRINTF_ITERATIONS (500000)
+
+/**
+ A benchmark variation to format strings containing numbers, strings and
+ Yori strings.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchSPrintf(VOID)
+{
+    TCHAR Buffer[256];
+    YORI_STRING Dest;
+    YORI_STRING Name;
+    DWORD Index;
+    DWORDLONG FileSize;
+    YORI_SIGNED_ALLOC_SIZE_T Length;
+    LONGLONG StartTime;
+    LONGLONG EndTime;
+
+    YoriLibConstantString(&Name, _T("C:\\Windows\\System32\\kernel32.dll"));
+    FileSize = 0x123456789;
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_SPRINTF_ITERATIONS; Index++) {
+        YoriLibSPrintf(Buffer, _T("%08i %s %i"), Index, _T("literal"), Index);
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("SPrintfIntegers"), BENCH_SPRINTF_ITERATIONS, 0, StartTime, EndTime);
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_SPRINTF_ITERATIONS; Index++) {
+        YoriLibSPrintf(Buffer, _T("%y %lli %016llx %x"), &Name, FileSize, FileSize, Index);
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("SPrintfMixed"), BENCH_SPRINTF_ITERATIONS, 0, StartTime, EndTime);
+
+    //
+    //  Format into a Yori string which is already large enough, which is
+    //  how most tools format output lines.
+    //
+
+    if (!YoriLibAllocateString(&Dest, 256)) {
+        return FALSE;
+    }
+
+    StartTime = BenchGetTime();
+    for (Index = 0; Index < BENCH_SPRINTF_ITERATIONS; Index++) {
+        Length = YoriLibYPrintf(&Dest, _T("%-40y %12lli"), &Name, FileSize);
+        if (Length < 0) {
+            YoriLibFreeStringContents(&Dest);
+            return FALSE;
+        }
+    }
+    EndTime = BenchGetTime();
+    BenchReportResult(_T("YPrintf"), BENCH_SPRINTF_ITERATIONS, 0, StartTime, EndTime);
+
+    YoriLibFreeStringContents(&Dest);
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
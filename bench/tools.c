@@ -0,0 +1,419 @@
+/**
+ * @file bench/tools.c
+ *
+ * Yori shell benchmark of complete tools
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "bench.h"
+
+/**
+ The number of targets in the generated makefile.
+ */
+#define BENCH_YMAKE_TARGET_COUNT (10000)
+
+/**
+ The number of entries in the generated directory.
+ */
+#define BENCH_SDIR_ENTRY_COUNT (100000)
+
+/**
+ The number of times to run a tool after its first run.
+ */
+#define BENCH_TOOL_PASSES (3)
+
+/**
+ The number of times to launch each tool when measuring startup.
+ */
+#define BENCH_STARTUP_LAUNCHES (50)
+
+/**
+ Set the last write time of a file to a point in the past, so that files
+ created later are considered newer.
+
+ @param FilePath Pointer to the path of the file to update.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchMakeFileOlder(
+    __in PYORI_STRING FilePath
+    )
+{
+    HANDLE hFile;
+    FILETIME WriteTime;
+    LARGE_INTEGER Time;
+    BOOL Result;
+
+    hFile = CreateFile(FilePath->StartOfString,
+                       FILE_WRITE_ATTRIBUTES,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    //
+    //  One hour, in 100ns units.
+    //
+
+    GetSystemTimeAsFileTime(&WriteTime);
+    Time.LowPart = WriteTime.dwLowDateTime;
+    Time.HighPart = WriteTime.dwHighDateTime;
+    Time.QuadPart = Time.QuadPart - (LONGLONG)60 * 60 * 1000 * 1000 * 10;
+    WriteTime.dwLowDateTime = Time.LowPart;
+    WriteTime.dwHighDateTime = Time.HighPart;
+
+    Result = SetFileTime(hFile, NULL, NULL, &WriteTime);
+    CloseHandle(hFile);
+
+    if (!Result) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ Run a tool once to populate any caches, then repeatedly, reporting the time
+ for each.
+
+ @param Name The name of the measurement to report.
+
+ @param CmdLine The command line to execute.
+
+ @param CurrentDirectory The directory to execute the command in.
+
+ @param ObjectCount The number of objects the tool processes in each run.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchMeasureTool(
+    __in LPCTSTR Name,
+    __in PYORI_STRING CmdLine,
+    __in PYORI_STRING CurrentDirectory,
+    __in DWORD ObjectCount
+    )
+{
+    YORI_STRING FirstName;
+    LONGLONG Elapsed;
+    LONGLONG TotalElapsed;
+    DWORD Pass;
+
+    if (!BenchRunProcess(CmdLine, CurrentDirectory, &Elapsed)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FirstName);
+    if (YoriLibYPrintf(&FirstName, _T("%sFirst"), Name) < 0) {
+        return FALSE;
+    }
+    BenchReportResult(FirstName.StartOfString, ObjectCount, 0, 0, Elapsed);
+    YoriLibFreeStringContents(&FirstName);
+
+    TotalElapsed = 0;
+    for (Pass = 0; Pass < BENCH_TOOL_PASSES; Pass++) {
+        if (!BenchRunProcess(CmdLine, CurrentDirectory, &Elapsed)) {
+            return FALSE;
+        }
+        TotalElapsed = TotalElapsed + Elapsed;
+    }
+
+    BenchReportResult(Name, (DWORDLONG)ObjectCount * BENCH_TOOL_PASSES, 0, 0, TotalElapsed);
+    return TRUE;
+}
+
+/**
+ Generate a makefile with many targets, each built from a source file and a
+ common header by an inference rule, along with sources and outputs such
+ that every target is up to date.
+
+ @param FixtureDir Pointer to the directory to generate files in.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchYmakeGenerateFixture(
+    __in PYORI_STRING FixtureDir
+    )
+{
+    YORI_STRING Text;
+    YORI_STRING Path;
+    DWORD Index;
+    BOOLEAN Result;
+
+    if (!YoriLibAllocateString(&Text, BENCH_YMAKE_TARGET_COUNT * 64 + 256)) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&Path, FixtureDir->LengthInChars + 64)) {
+        YoriLibFreeStringContents(&Text);
+        return FALSE;
+    }
+
+    Result = FALSE;
+
+    Text.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Text.StartOfString, _T("all: \\\r\n"));
+    for (Index = 0; Index < BENCH_YMAKE_TARGET_COUNT; Index++) {
+        Text.LengthInChars = Text.LengthInChars + (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars], _T("\tf%05i.obj \\\r\n"), Index);
+    }
+    Text.LengthInChars = Text.LengthInChars + (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars], _T("\r\n"));
+
+    for (Index = 0; Index < BENCH_YMAKE_TARGET_COUNT; Index++) {
+        Text.LengthInChars = Text.LengthInChars + (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars], _T("f%05i.obj: common.h\r\n"), Index);
+    }
+
+    Text.LengthInChars = Text.LengthInChars + (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Text.StartOfString[Text.LengthInChars], _T("\r\n.c.obj:\r\n\t@copy $< $@ >NUL\r\n"));
+
+    Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\Makefile"), FixtureDir);
+    if (!BenchWriteTextFile(&Path, &Text, CP_ACP, NULL)) {
+        goto Exit;
+    }
+
+    Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\common.h"), FixtureDir);
+    if (!BenchWriteFile(&Path, NULL, 0) ||
+        !BenchMakeFileOlder(&Path)) {
+        goto Exit;
+    }
+
+    for (Index = 0; Index < BENCH_YMAKE_TARGET_COUNT; Index++) {
+        Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\f%05i.c"), FixtureDir, Index);
+        if (!BenchWriteFile(&Path, NULL, 0) ||
+            !BenchMakeFileOlder(&Path)) {
+            goto Exit;
+        }
+        Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\f%05i.obj"), FixtureDir, Index);
+        if (!BenchWriteFile(&Path, NULL, 0)) {
+            goto Exit;
+        }
+    }
+
+    Result = TRUE;
+
+Exit:
+    if (!Result) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Could not create %y, error %i\n"), __FILE__, __LINE__, &Path, GetLastError());
+    }
+    YoriLibFreeStringContents(&Path);
+    YoriLibFreeStringContents(&Text);
+    return Result;
+}
+
+/**
+ A benchmark variation to run ymake against a generated makefile where
+ every target is up to date.  This measures parsing and dependency
+ evaluation without any commands being executed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchYmakeNoop(VOID)
+{
+    YORI_STRING ToolPath;
+    YORI_STRING FixtureDir;
+    YORI_STRING CmdLine;
+    BOOLEAN Result;
+
+    if (!BenchGetToolPath(_T("ymake.exe"), &ToolPath)) {
+        return TRUE;
+    }
+
+    if (!BenchCreateFixtureDirectory(_T("YmakeNoop"), &FixtureDir)) {
+        YoriLibFreeStringContents(&ToolPath);
+        return FALSE;
+    }
+
+    Result = FALSE;
+    YoriLibInitEmptyString(&CmdLine);
+
+    if (!BenchYmakeGenerateFixture(&FixtureDir)) {
+        goto Exit;
+    }
+
+    if (YoriLibYPrintf(&CmdLine, _T("\"%y\" -f Makefile"), &ToolPath) < 0) {
+        goto Exit;
+    }
+
+    Result = BenchMeasureTool(_T("YmakeNoop"), &CmdLine, &FixtureDir, BENCH_YMAKE_TARGET_COUNT);
+
+Exit:
+    YoriLibFreeStringContents(&CmdLine);
+    BenchDeleteTree(&FixtureDir);
+    YoriLibFreeStringContents(&FixtureDir);
+    YoriLibFreeStringContents(&ToolPath);
+    return Result;
+}
+
+/**
+ A benchmark variation to run sdir against a directory containing a large
+ number of files.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchSdirLargeDir(VOID)
+{
+    YORI_STRING ToolPath;
+    YORI_STRING FixtureDir;
+    YORI_STRING CmdLine;
+    YORI_STRING Path;
+    DWORD Index;
+    BOOLEAN Result;
+
+    if (!BenchGetToolPath(_T("sdir.exe"), &ToolPath)) {
+        return TRUE;
+    }
+
+    if (!BenchCreateFixtureDirectory(_T("SdirLargeDir"), &FixtureDir)) {
+        YoriLibFreeStringContents(&ToolPath);
+        return FALSE;
+    }
+
+    Result = FALSE;
+    YoriLibInitEmptyString(&CmdLine);
+
+    if (!YoriLibAllocateString(&Path, FixtureDir.LengthInChars + 32)) {
+        goto Exit;
+    }
+
+    for (Index = 0; Index < BENCH_SDIR_ENTRY_COUNT; Index++) {
+        Path.LengthInChars = (YORI_ALLOC_SIZE_T)YoriLibSPrintf(Path.StartOfString, _T("%y\\entry%06i.dat"), &FixtureDir, Index);
+        if (!BenchWriteFile(&Path, NULL, 0)) {
+            YoriLibFreeStringContents(&Path);
+            goto Exit;
+        }
+    }
+    YoriLibFreeStringContents(&Path);
+
+    if (YoriLibYPrintf(&CmdLine, _T("\"%y\" \"%y\""), &ToolPath, &FixtureDir) < 0) {
+        goto Exit;
+    }
+
+    Result = BenchMeasureTool(_T("SdirLargeDir"), &CmdLine, &FixtureDir, BENCH_SDIR_ENTRY_COUNT);
+
+Exit:
+    YoriLibFreeStringContents(&CmdLine);
+    BenchDeleteTree(&FixtureDir);
+    YoriLibFreeStringContents(&FixtureDir);
+    YoriLibFreeStringContents(&ToolPath);
+    return Result;
+}
+
+/**
+ A tool to launch when measuring process startup, and the arguments to give
+ it so that it exits immediately with success.
+ */
+typedef struct _BENCH_STARTUP_TOOL {
+
+    /**
+     The name of the measurement to report.
+     */
+    LPCTSTR Name;
+
+    /**
+     The file name of the tool.
+     */
+    LPCTSTR ToolName;
+
+    /**
+     The arguments to pass to the tool.
+     */
+    LPCTSTR Args;
+} BENCH_STARTUP_TOOL, *PBENCH_STARTUP_TOOL;
+
+/**
+ The set of tools to launch when measuring process startup.  These perform
+ almost no work, so the time is dominated by process creation and library
+ initialization.
+ */
+CONST BENCH_STARTUP_TOOL BenchStartupTools[] = {
+    {_T("StartupYecho"),   _T("yecho.exe"),   _T("-n")},
+    {_T("StartupYintcmp"), _T("yintcmp.exe"), _T("1==1")},
+    {_T("StartupYstrcmp"), _T("ystrcmp.exe"), _T("a==a")},
+};
+
+/**
+ A benchmark variation to repeatedly launch tools that exit immediately, to
+ measure the cost of process startup.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+BenchToolStartup(VOID)
+{
+    YORI_STRING ToolPath;
+    YORI_STRING FixtureDir;
+    YORI_STRING CmdLine;
+    LONGLONG Elapsed;
+    LONGLONG TotalElapsed;
+    DWORD ToolIndex;
+    DWORD Launch;
+    BOOLEAN Result;
+
+    if (!BenchCreateFixtureDirectory(_T("ToolStartup"), &FixtureDir)) {
+        return FALSE;
+    }
+
+    Result = TRUE;
+    YoriLibInitEmptyString(&CmdLine);
+
+    for (ToolIndex = 0; ToolIndex < sizeof(BenchStartupTools)/sizeof(BenchStartupTools[0]); ToolIndex++) {
+        if (!BenchGetToolPath(BenchStartupTools[ToolIndex].ToolName, &ToolPath)) {
+            continue;
+        }
+
+        if (YoriLibYPrintf(&CmdLine, _T("\"%y\" %s"), &ToolPath, BenchStartupTools[ToolIndex].Args) < 0) {
+            YoriLibFreeStringContents(&ToolPath);
+            Result = FALSE;
+            break;
+        }
+        YoriLibFreeStringContents(&ToolPath);
+
+        TotalElapsed = 0;
+        for (Launch = 0; Launch < BENCH_STARTUP_LAUNCHES; Launch++) {
+            if (!BenchRunProcess(&CmdLine, &FixtureDir, &Elapsed)) {
+                Result = FALSE;
+                break;
+            }
+            TotalElapsed = TotalElapsed + Elapsed;
+        }
+
+        if (!Result) {
+            break;
+        }
+
+        BenchReportResult(BenchStartupTools[ToolIndex].Name, BENCH_STARTUP_LAUNCHES, 0, 0, TotalElapsed);
+    }
+
+    YoriLibFreeStringContents(&CmdLine);
+    BenchDeleteTree(&FixtureDir);
+    YoriLibFreeStringContents(&FixtureDir);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,127 @@
+/**
+ * @file builtins/cmdtime.c
+ *
+ * Yori shell display command latency breakdown
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yoricall.h>
+
+/**
+ Help text to display to the user.
+ */
+const
+CHAR strCmdTimeHelpText[] =
+        "\n"
+        "Displays the time spent in each phase of executing commands.\n"
+        "\n"
+        "CMDTIME [-license] [-r]\n"
+        "\n"
+        "   -r             Reset collected timings after displaying them\n"
+        "\n"
+        "Timings are collected when the YORICMDTIMING variable is set to 1.\n"
+        "Phases are:\n"
+        "   parse          Parsing the command line into programs\n"
+        "   expand         Expanding environment variables and aliases\n"
+        "   lookup         Locating the executable in the path\n"
+        "   launch         Creating the child process\n"
+        "   run            Waiting for the child process to exit\n"
+        "   drain          Waiting for buffered output after the child exits\n";
+
+/**
+ Display usage text to the user.
+ */
+BOOL
+CmdTimeHelp(VOID)
+{
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("CmdTime %i.%02i\n"), YORI_VER_MAJOR, YORI_VER_MINOR);
+#if YORI_BUILD_ID
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Build %i\n"), YORI_BUILD_ID);
+#endif
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%hs"), strCmdTimeHelpText);
+    return TRUE;
+}
+
+/**
+ Entrypoint for the cmdtime builtin command.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV The argument array.
+
+ @return ExitCode.
+ */
+DWORD
+YORI_BUILTIN_FN
+YoriCmd_CMDTIME(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    BOOLEAN ArgumentUnderstood;
+    BOOLEAN Reset;
+    YORI_ALLOC_SIZE_T i;
+    YORI_STRING Arg;
+    YORI_STRING Report;
+
+    Reset = FALSE;
+
+    for (i = 1; i < ArgC; i++) {
+
+        ArgumentUnderstood = FALSE;
+        ASSERT(YoriLibIsStringNullTerminated(&ArgV[i]));
+
+        if (YoriLibIsCommandLineOption(&ArgV[i], &Arg)) {
+
+            if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
+                CmdTimeHelp();
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
+                YoriLibDisplayMitLicense(_T("2026"));
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                Reset = TRUE;
+                ArgumentUnderstood = TRUE;
+            }
+        }
+
+        if (!ArgumentUnderstood) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Argument not understood, ignored: %y\n"), &ArgV[i]);
+        }
+    }
+
+    if (!YoriCallGetCommandTimings(Reset, &Report)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cmdtime: could not query command timings\n"));
+        return EXIT_FAILURE;
+    }
+
+    if (Report.LengthInChars > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Report);
+    }
+    YoriCallFreeYoriString(&Report);
+
+    return EXIT_SUCCESS;
+}
+
+// vim:sw=4:ts=4:et:
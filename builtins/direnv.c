@@ -107,6 +107,232 @@ BOOLEAN DirenvInstalled;
  */
 BOOLEAN DirenvApplyInvoked;
 
+/**
+ The maximum number of directories to remember.  When this is exceeded, the
+ least recently used directory is discarded.
+ */
+#define DIRENV_CACHE_MAX_DIRECTORIES 64
+
+/**
+ Information about whether a single directory contains an envrc.ys1 script.
+ The directory name follows this structure in the same allocation.
+ */
+typedef struct _DIRENV_CACHE_DIRECTORY {
+
+    /**
+     The entry within the hash table of directories, indexed by name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry within the list of directories, ordered from least recently
+     used to most recently used.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A change notification handle which is signalled when files are
+     created, deleted or renamed within the directory.  If the directory
+     does not support change notifications, this is NULL and the cached
+     result is never used.
+     */
+    HANDLE ChangeHandle;
+
+    /**
+     TRUE if the directory was found to contain an envrc.ys1 script.
+     */
+    BOOLEAN ScriptPresent;
+
+} DIRENV_CACHE_DIRECTORY, *PDIRENV_CACHE_DIRECTORY;
+
+/**
+ A cache of directories that have been checked for envrc.ys1 scripts, so
+ that changing directory within a tree does not need to probe every parent
+ each time.
+ */
+typedef struct _DIRENV_CACHE {
+
+    /**
+     A hash table of cached directories, indexed by name.
+     */
+    PYORI_GROWABLE_HASH_TABLE Table;
+
+    /**
+     A list of cached directories, ordered from least recently used to most
+     recently used.
+     */
+    YORI_LIST_ENTRY Directories;
+
+    /**
+     The number of entries in the Directories list.
+     */
+    DWORD DirectoryCount;
+
+} DIRENV_CACHE, *PDIRENV_CACHE;
+
+/**
+ The cache of directories that have been checked for envrc.ys1 scripts.
+ */
+DIRENV_CACHE DirenvCache;
+
+/**
+ Remove a directory from the cache and free it.
+
+ @param Directory Pointer to the directory to free.
+ */
+VOID
+DirenvFreeCacheDirectory(
+    __in PDIRENV_CACHE_DIRECTORY Directory
+    )
+{
+    YoriLibRemoveListItem(&Directory->ListEntry);
+    YoriLibGrowableHashRemoveByEntry(DirenvCache.Table, &Directory->HashEntry);
+    if (Directory->ChangeHandle != NULL) {
+        FindCloseChangeNotification(Directory->ChangeHandle);
+    }
+    YoriLibDereference(Directory);
+    DirenvCache.DirectoryCount--;
+}
+
+/**
+ Free all directories in the cache, along with the cache itself.
+ */
+VOID
+DirenvCleanupCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PDIRENV_CACHE_DIRECTORY Directory;
+
+    if (DirenvCache.Table == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&DirenvCache.Directories, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, DIRENV_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&DirenvCache.Directories, ListEntry);
+        DirenvFreeCacheDirectory(Directory);
+    }
+
+    YoriLibFreeEmptyGrowableHashTable(DirenvCache.Table);
+    DirenvCache.Table = NULL;
+}
+
+/**
+ Determine whether a directory contains an envrc.ys1 script.  If the
+ directory has been checked before and no file has been created, deleted or
+ renamed in it since, the previous answer is returned without touching the
+ file system.
+
+ @param Directory Pointer to the directory to check.  This is not NULL
+        terminated and does not contain a trailing separator.
+
+ @param ScriptPath Pointer to a NULL terminated string containing the path
+        to the script within the directory.
+
+ @return TRUE if the directory contains a script, FALSE if it does not.
+ */
+BOOLEAN
+DirenvDirectoryHasScript(
+    __in PYORI_STRING Directory,
+    __in PYORI_STRING ScriptPath
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PDIRENV_CACHE_DIRECTORY CacheDirectory;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Key;
+    LPTSTR WatchPath;
+    BOOLEAN ScriptPresent;
+
+    if (DirenvCache.Table == NULL) {
+        DirenvCache.Table = YoriLibAllocateGrowableHashTable(DIRENV_CACHE_MAX_DIRECTORIES);
+        if (DirenvCache.Table == NULL) {
+            return (GetFileAttributes(ScriptPath->StartOfString) != (DWORD)-1);
+        }
+        YoriLibInitializeListHead(&DirenvCache.Directories);
+    }
+
+    HashEntry = YoriLibGrowableHashLookupByKey(DirenvCache.Table, Directory);
+    if (HashEntry != NULL) {
+        CacheDirectory = HashEntry->Context;
+        if (CacheDirectory->ChangeHandle != NULL &&
+            WaitForSingleObject(CacheDirectory->ChangeHandle, 0) != WAIT_OBJECT_0) {
+
+            YoriLibRemoveListItem(&CacheDirectory->ListEntry);
+            YoriLibAppendList(&DirenvCache.Directories, &CacheDirectory->ListEntry);
+            return CacheDirectory->ScriptPresent;
+        }
+
+        DirenvFreeCacheDirectory(CacheDirectory);
+    }
+
+    if (DirenvCache.DirectoryCount >= DIRENV_CACHE_MAX_DIRECTORIES) {
+        ListEntry = YoriLibGetNextListEntry(&DirenvCache.Directories, NULL);
+        CacheDirectory = CONTAINING_RECORD(ListEntry, DIRENV_CACHE_DIRECTORY, ListEntry);
+        DirenvFreeCacheDirectory(CacheDirectory);
+    }
+
+    //
+    //  Allocate space for the directory name with a trailing separator,
+    //  so that a drive root refers to the root and not the drive's
+    //  current directory.
+    //
+
+    CacheDirectory = YoriLibReferencedMalloc(sizeof(DIRENV_CACHE_DIRECTORY) + (Directory->LengthInChars + 2) * sizeof(TCHAR));
+    if (CacheDirectory == NULL) {
+        return (GetFileAttributes(ScriptPath->StartOfString) != (DWORD)-1);
+    }
+
+    WatchPath = (LPTSTR)(CacheDirectory + 1);
+    memcpy(WatchPath, Directory->StartOfString, Directory->LengthInChars * sizeof(TCHAR));
+    WatchPath[Directory->LengthInChars] = '\0';
+    if (Directory->LengthInChars == 0 ||
+        !YoriLibIsSep(Directory->StartOfString[Directory->LengthInChars - 1])) {
+
+        WatchPath[Directory->LengthInChars] = '\\';
+        WatchPath[Directory->LengthInChars + 1] = '\0';
+    }
+
+    //
+    //  Register for changes before probing so that any change made while
+    //  probing is detected on the next lookup.
+    //
+
+    CacheDirectory->ChangeHandle = FindFirstChangeNotification(WatchPath, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (CacheDirectory->ChangeHandle == INVALID_HANDLE_VALUE) {
+        CacheDirectory->ChangeHandle = NULL;
+    }
+
+    ScriptPresent = (GetFileAttributes(ScriptPath->StartOfString) != (DWORD)-1);
+
+    if (CacheDirectory->ChangeHandle == NULL) {
+        YoriLibDereference(CacheDirectory);
+        return ScriptPresent;
+    }
+
+    CacheDirectory->ScriptPresent = ScriptPresent;
+
+    //
+    //  The key refers to the name within this allocation, so it has no
+    //  MemoryToFree of its own and is released along with the directory.
+    //
+
+    YoriLibInitEmptyString(&Key);
+    Key.StartOfString = WatchPath;
+    Key.LengthInChars = Directory->LengthInChars;
+    if (!YoriLibGrowableHashInsertByKey(DirenvCache.Table, &Key, CacheDirectory, &CacheDirectory->HashEntry)) {
+        FindCloseChangeNotification(CacheDirectory->ChangeHandle);
+        YoriLibDereference(CacheDirectory);
+        return ScriptPresent;
+    }
+
+    YoriLibAppendList(&DirenvCache.Directories, &CacheDirectory->ListEntry);
+    DirenvCache.DirectoryCount++;
+
+    return ScriptPresent;
+}
+
 /**
  Notification that the module is being unloaded or the shell is exiting,
  used to indicate any pending state should be cleaned up.
@@ -117,6 +343,7 @@ DirenvNotifyUnload(VOID)
 {
     YoriLibFreeStringContents(&DirenvPreviousExecutedScript);
     YoriLibFreeStringContents(&DirenvPreviousCurrentDirectory);
+    DirenvCleanupCache();
 }
 
 /**
@@ -481,7 +708,7 @@ DirenvApplyInternal(VOID)
     while (TRUE) {
         NewScript.LengthInChars = YoriLibSPrintf(NewScript.StartOfString, _T("%y\\envrc.ys1"), &CurrentDirectorySubset);
 
-        if (GetFileAttributes(NewScript.StartOfString) != (DWORD)-1) {
+        if (DirenvDirectoryHasScript(&CurrentDirectorySubset, &NewScript)) {
 
             //
             //  If the script we found is the same one that's active, do
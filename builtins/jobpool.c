@@ -0,0 +1,665 @@
+/**
+ * @file builtins/jobpool.c
+ *
+ * Yori shell run background jobs with bounded concurrency
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yoricall.h>
+
+
+/**
+ Help text to display to the user.
+ */
+const
+CHAR strJobPoolHelpText[] =
+        "\n"
+        "Run commands as background jobs in a named pool with a limited number of\n"
+        "jobs executing at once.\n"
+        "\n"
+        "JOBPOOL [-license] [-m <max>] <pool> <command>\n"
+        "JOBPOOL [-v] -w <pool>\n"
+        "JOBPOOL -l\n"
+        "\n"
+        "   -l             List pools and the number of jobs in each\n"
+        "   -m <max>       Set the number of jobs in the pool that can execute at once\n"
+        "   -v             Display the result of each job in the pool\n"
+        "   -w             Wait for all jobs in the pool to finish and delete the pool\n"
+        "\n"
+        "If the pool has as many jobs executing as it allows, the command is not\n"
+        "started until one of them finishes.  When waiting for a pool, the exit code\n"
+        "is zero if all jobs succeeded, or the exit code of the first job to fail.\n";
+
+/**
+ Display usage text to the user.
+ */
+BOOL
+JobPoolHelp(VOID)
+{
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("JobPool %i.%02i\n"), YORI_VER_MAJOR, YORI_VER_MINOR);
+#if YORI_BUILD_ID
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Build %i\n"), YORI_BUILD_ID);
+#endif
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%hs"), strJobPoolHelpText);
+    return TRUE;
+}
+
+/**
+ Information about a single job that was started within a pool.
+ */
+typedef struct _JOBPOOL_JOB {
+
+    /**
+     The shell's ID for the job.
+     */
+    DWORD JobId;
+
+    /**
+     The exit code of the job.  Only meaningful once Completed is TRUE.
+     */
+    DWORD ExitCode;
+
+    /**
+     TRUE if the job has finished executing.
+     */
+    BOOLEAN Completed;
+} JOBPOOL_JOB, *PJOBPOOL_JOB;
+
+/**
+ A named set of jobs with a limit on how many can execute at once.
+ */
+typedef struct _JOBPOOL {
+
+    /**
+     The link within the list of all pools.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The name of the pool.
+     */
+    YORI_STRING Name;
+
+    /**
+     The maximum number of jobs in the pool that can execute at once.
+     */
+    DWORD MaxConcurrency;
+
+    /**
+     The number of jobs in the pool that have not yet been observed to
+     finish.
+     */
+    DWORD RunningCount;
+
+    /**
+     The number of entries in the Jobs array that are populated.
+     */
+    DWORD JobCount;
+
+    /**
+     The number of entries allocated in the Jobs array.
+     */
+    DWORD JobsAllocated;
+
+    /**
+     An array of every job started within the pool, in the order they were
+     started.
+     */
+    PJOBPOOL_JOB Jobs;
+} JOBPOOL, *PJOBPOOL;
+
+/**
+ A list of pools that currently exist.
+ */
+YORI_LIST_ENTRY JobPoolList;
+
+/**
+ Free a pool and remove it from the list of pools.  The jobs within the pool
+ are not affected.
+
+ @param Pool The pool to free.
+ */
+VOID
+JobPoolFree(
+    __in PJOBPOOL Pool
+    )
+{
+    YoriLibRemoveListItem(&Pool->ListEntry);
+    YoriLibFreeStringContents(&Pool->Name);
+    if (Pool->Jobs != NULL) {
+        YoriLibFree(Pool->Jobs);
+    }
+    YoriLibFree(Pool);
+}
+
+/**
+ Notification that the module is being unloaded or the shell is exiting,
+ used to indicate any pools should be cleaned up.
+ */
+VOID
+YORI_BUILTIN_FN
+JobPoolNotifyUnload(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PJOBPOOL Pool;
+
+    if (JobPoolList.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&JobPoolList, NULL);
+    while (ListEntry != NULL) {
+        Pool = CONTAINING_RECORD(ListEntry, JOBPOOL, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&JobPoolList, ListEntry);
+        JobPoolFree(Pool);
+    }
+}
+
+/**
+ Find a pool by name.
+
+ @param Name The name of the pool.
+
+ @return Pointer to the pool, or NULL if no pool with this name exists.
+ */
+PJOBPOOL
+JobPoolFind(
+    __in PYORI_STRING Name
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PJOBPOOL Pool;
+
+    if (JobPoolList.Next == NULL) {
+        return NULL;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&JobPoolList, NULL);
+    while (ListEntry != NULL) {
+        Pool = CONTAINING_RECORD(ListEntry, JOBPOOL, ListEntry);
+        if (YoriLibCompareStringInsensitive(&Pool->Name, Name) == 0) {
+            return Pool;
+        }
+        ListEntry = YoriLibGetNextListEntry(&JobPoolList, ListEntry);
+    }
+
+    return NULL;
+}
+
+/**
+ Create a new, empty pool.
+
+ @param Name The name of the pool.
+
+ @param MaxConcurrency The maximum number of jobs in the pool that can
+        execute at once.
+
+ @return Pointer to the pool, or NULL on allocation failure.
+ */
+PJOBPOOL
+JobPoolCreate(
+    __in PYORI_STRING Name,
+    __in DWORD MaxConcurrency
+    )
+{
+    PJOBPOOL Pool;
+
+    Pool = YoriLibMalloc(sizeof(JOBPOOL));
+    if (Pool == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Pool, sizeof(JOBPOOL));
+    if (!YoriLibAllocateString(&Pool->Name, Name->LengthInChars + 1)) {
+        YoriLibFree(Pool);
+        return NULL;
+    }
+
+    memcpy(Pool->Name.StartOfString, Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+    Pool->Name.LengthInChars = Name->LengthInChars;
+    Pool->Name.StartOfString[Pool->Name.LengthInChars] = '\0';
+    Pool->MaxConcurrency = MaxConcurrency;
+
+    if (JobPoolList.Next == NULL) {
+        YoriLibInitializeListHead(&JobPoolList);
+    }
+
+    if (YoriLibIsListEmpty(&JobPoolList)) {
+        YoriCallSetUnloadRoutine(JobPoolNotifyUnload);
+    }
+
+    YoriLibAppendList(&JobPoolList, &Pool->ListEntry);
+    return Pool;
+}
+
+/**
+ Add a job to a pool, growing the array of jobs if needed.
+
+ @param Pool The pool to add the job to.
+
+ @param JobId The shell's ID for the job.
+
+ @return TRUE to indicate success, FALSE on allocation failure.
+ */
+__success(return)
+BOOLEAN
+JobPoolAddJob(
+    __in PJOBPOOL Pool,
+    __in DWORD JobId
+    )
+{
+    PJOBPOOL_JOB NewJobs;
+    DWORD NewAllocated;
+
+    if (Pool->JobCount >= Pool->JobsAllocated) {
+        NewAllocated = Pool->JobsAllocated * 2;
+        if (NewAllocated < 16) {
+            NewAllocated = 16;
+        }
+
+        NewJobs = YoriLibMalloc(NewAllocated * sizeof(JOBPOOL_JOB));
+        if (NewJobs == NULL) {
+            return FALSE;
+        }
+
+        if (Pool->Jobs != NULL) {
+            memcpy(NewJobs, Pool->Jobs, Pool->JobCount * sizeof(JOBPOOL_JOB));
+            YoriLibFree(Pool->Jobs);
+        }
+
+        Pool->Jobs = NewJobs;
+        Pool->JobsAllocated = NewAllocated;
+    }
+
+    Pool->Jobs[Pool->JobCount].JobId = JobId;
+    Pool->Jobs[Pool->JobCount].ExitCode = 0;
+    Pool->Jobs[Pool->JobCount].Completed = FALSE;
+    Pool->JobCount++;
+    Pool->RunningCount++;
+    return TRUE;
+}
+
+/**
+ Check each job in a pool that has not yet been observed to finish, and
+ record the exit code of any job that has.
+
+ @param Pool The pool to update.
+ */
+VOID
+JobPoolUpdateCompletion(
+    __in PJOBPOOL Pool
+    )
+{
+    DWORD Index;
+    BOOL HasCompleted;
+    BOOL HasOutput;
+    DWORD ExitCode;
+    YORI_STRING Command;
+    PJOBPOOL_JOB Job;
+
+    YoriLibInitEmptyString(&Command);
+
+    for (Index = 0; Index < Pool->JobCount; Index++) {
+        Job = &Pool->Jobs[Index];
+        if (Job->Completed) {
+            continue;
+        }
+
+        //
+        //  If the shell no longer knows about the job it finished long ago
+        //  and its result is lost.  Report it as a failure so a script
+        //  doesn't proceed as if it succeeded.
+        //
+
+        if (!YoriCallGetJobInformation(Job->JobId, &HasCompleted, &HasOutput, &ExitCode, &Command)) {
+            HasCompleted = TRUE;
+            ExitCode = EXIT_FAILURE;
+        }
+
+        if (HasCompleted) {
+            Job->Completed = TRUE;
+            Job->ExitCode = ExitCode;
+            Pool->RunningCount--;
+        }
+    }
+
+    YoriLibFreeStringContents(&Command);
+}
+
+/**
+ Wait until no more than a specified number of jobs in a pool are
+ executing.
+
+ @param Pool The pool to wait for.
+
+ @param TargetRunningCount The number of jobs that may still be executing
+        when this function returns.
+
+ @return TRUE if the pool has no more than TargetRunningCount jobs
+         executing, FALSE if the wait was cancelled or failed.
+ */
+__success(return)
+BOOLEAN
+JobPoolWaitForRunningCount(
+    __in PJOBPOOL Pool,
+    __in DWORD TargetRunningCount
+    )
+{
+    PDWORD JobIds;
+    DWORD JobCount;
+    DWORD Index;
+    DWORD CompletedJobId;
+    BOOLEAN Result;
+
+    JobPoolUpdateCompletion(Pool);
+    if (Pool->RunningCount <= TargetRunningCount) {
+        return TRUE;
+    }
+
+    JobIds = YoriLibMalloc(Pool->RunningCount * sizeof(DWORD));
+    if (JobIds == NULL) {
+        return FALSE;
+    }
+
+    Result = TRUE;
+    while (Pool->RunningCount > TargetRunningCount) {
+        JobCount = 0;
+        for (Index = 0; Index < Pool->JobCount; Index++) {
+            if (!Pool->Jobs[Index].Completed) {
+                JobIds[JobCount] = Pool->Jobs[Index].JobId;
+                JobCount++;
+            }
+        }
+
+        if (!YoriCallWaitForAnyJob(JobCount, JobIds, &CompletedJobId)) {
+            Result = FALSE;
+            break;
+        }
+
+        JobPoolUpdateCompletion(Pool);
+    }
+
+    YoriLibFree(JobIds);
+    return Result;
+}
+
+/**
+ Start a command as a background job within a pool, waiting for a slot in
+ the pool to become available if needed.
+
+ @param Pool The pool to start the job in.
+
+ @param CmdLine The command to execute.
+
+ @return TRUE to indicate the command was started, FALSE if it was not.
+ */
+__success(return)
+BOOLEAN
+JobPoolSubmit(
+    __in PJOBPOOL Pool,
+    __in PYORI_STRING CmdLine
+    )
+{
+    YORI_STRING Expression;
+    DWORD PreviousJobId;
+    DWORD JobId;
+    BOOLEAN Result;
+
+    if (!JobPoolWaitForRunningCount(Pool, Pool->MaxConcurrency - 1)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Expression);
+    if (YoriLibYPrintf(&Expression, _T("%y &"), CmdLine) < 0) {
+        return FALSE;
+    }
+
+    //
+    //  Job IDs are allocated in increasing order, so any job with an ID
+    //  above the highest one that exists now was started by this command.
+    //
+
+    PreviousJobId = 0;
+    JobId = YoriCallGetNextJobId(0);
+    while (JobId != 0) {
+        PreviousJobId = JobId;
+        JobId = YoriCallGetNextJobId(JobId);
+    }
+
+    YoriCallExecuteExpression(&Expression);
+    YoriLibFreeStringContents(&Expression);
+
+    Result = TRUE;
+    JobId = YoriCallGetNextJobId(PreviousJobId);
+    while (JobId != 0) {
+        if (!JobPoolAddJob(Pool, JobId)) {
+            Result = FALSE;
+        }
+        JobId = YoriCallGetNextJobId(JobId);
+    }
+
+    return Result;
+}
+
+/**
+ Wait for all jobs in a pool to finish and return the pool's aggregate
+ result.
+
+ @param Pool The pool to wait for.
+
+ @param DisplayResults If TRUE, display the exit code of each job.
+
+ @return Zero if every job succeeded, the exit code of the first job that
+         failed, or EXIT_FAILURE if the wait was cancelled.
+ */
+DWORD
+JobPoolWaitForAll(
+    __in PJOBPOOL Pool,
+    __in BOOLEAN DisplayResults
+    )
+{
+    DWORD Index;
+    DWORD Result;
+
+    if (!JobPoolWaitForRunningCount(Pool, 0)) {
+        return EXIT_FAILURE;
+    }
+
+    Result = EXIT_SUCCESS;
+    for (Index = 0; Index < Pool->JobCount; Index++) {
+        if (DisplayResults) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Job %i: result %i\n"), Pool->Jobs[Index].JobId, Pool->Jobs[Index].ExitCode);
+        }
+        if (Result == EXIT_SUCCESS) {
+            Result = Pool->Jobs[Index].ExitCode;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Display the pools that currently exist.
+ */
+VOID
+JobPoolDisplayPools(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PJOBPOOL Pool;
+
+    if (JobPoolList.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&JobPoolList, NULL);
+    while (ListEntry != NULL) {
+        Pool = CONTAINING_RECORD(ListEntry, JOBPOOL, ListEntry);
+        JobPoolUpdateCompletion(Pool);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%y: %i executing, %i total, max %i\n"),
+                      &Pool->Name,
+                      Pool->RunningCount,
+                      Pool->JobCount,
+                      Pool->MaxConcurrency);
+        ListEntry = YoriLibGetNextListEntry(&JobPoolList, ListEntry);
+    }
+}
+
+/**
+ Entrypoint for the jobpool builtin command.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV Array of arguments.
+
+ @return ExitCode.
+ */
+DWORD
+YORI_BUILTIN_FN
+YoriCmd_JOBPOOL(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    BOOLEAN ArgumentUnderstood;
+    BOOLEAN ListPools = FALSE;
+    BOOLEAN WaitForPool = FALSE;
+    BOOLEAN DisplayResults = FALSE;
+    DWORD MaxConcurrency = 0;
+    YORI_ALLOC_SIZE_T i;
+    YORI_ALLOC_SIZE_T StartArg = 0;
+    YORI_STRING Arg;
+    YORI_STRING CmdLine;
+    PJOBPOOL Pool;
+    DWORD Result;
+
+    YoriLibLoadNtDllFunctions();
+    YoriLibLoadKernel32Functions();
+
+    for (i = 1; i < ArgC; i++) {
+
+        ArgumentUnderstood = FALSE;
+        ASSERT(YoriLibIsStringNullTerminated(&ArgV[i]));
+
+        if (YoriLibIsCommandLineOption(&ArgV[i], &Arg)) {
+
+            if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
+                JobPoolHelp();
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
+                YoriLibDisplayMitLicense(_T("2026"));
+                return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
+                ListPools = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                if (ArgC > i + 1) {
+                    YORI_MAX_SIGNED_T llTemp;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                        CharsConsumed > 0 &&
+                        llTemp > 0) {
+
+                        MaxConcurrency = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("v")) == 0) {
+                DisplayResults = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("w")) == 0) {
+                WaitForPool = TRUE;
+                ArgumentUnderstood = TRUE;
+            }
+        } else {
+            ArgumentUnderstood = TRUE;
+            StartArg = i;
+            break;
+        }
+
+        if (!ArgumentUnderstood) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Argument not understood, ignored: %y\n"), &ArgV[i]);
+        }
+    }
+
+    if (ListPools) {
+        JobPoolDisplayPools();
+        return EXIT_SUCCESS;
+    }
+
+    if (StartArg == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("jobpool: missing argument\n"));
+        return EXIT_FAILURE;
+    }
+
+    Pool = JobPoolFind(&ArgV[StartArg]);
+
+    if (WaitForPool) {
+        if (Pool == NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("jobpool: pool %y not found\n"), &ArgV[StartArg]);
+            return EXIT_FAILURE;
+        }
+
+        Result = JobPoolWaitForAll(Pool, DisplayResults);
+        if (Pool->RunningCount == 0) {
+            JobPoolFree(Pool);
+        }
+        return Result;
+    }
+
+    if (StartArg + 1 >= ArgC) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("jobpool: missing command\n"));
+        return EXIT_FAILURE;
+    }
+
+    if (Pool == NULL) {
+        if (MaxConcurrency == 0) {
+            SYSTEM_INFO SystemInfo;
+            GetSystemInfo(&SystemInfo);
+            MaxConcurrency = SystemInfo.dwNumberOfProcessors;
+        }
+
+        Pool = JobPoolCreate(&ArgV[StartArg], MaxConcurrency);
+        if (Pool == NULL) {
+            return EXIT_FAILURE;
+        }
+    } else if (MaxConcurrency != 0) {
+        Pool->MaxConcurrency = MaxConcurrency;
+    }
+
+    if (!YoriLibBuildCmdlineFromArgcArgv(ArgC - StartArg - 1, &ArgV[StartArg + 1], TRUE, TRUE, &CmdLine)) {
+        return EXIT_FAILURE;
+    }
+
+    Result = EXIT_SUCCESS;
+    if (!JobPoolSubmit(Pool, &CmdLine)) {
+        Result = EXIT_FAILURE;
+    }
+
+    YoriLibFreeStringContents(&CmdLine);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
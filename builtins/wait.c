@@ -36,7 +36,13 @@ CHAR strWaitHelpText[] =
         "\n"
         "Wait for one job or all jobs to finish executing.\n"
         "\n"
-        "WAIT [-license] [<id>]\n";
+        "WAIT [-license] [-all|-any] [-v] [<id>...]\n"
+        "\n"
+        "   -all           Wait for all of the jobs to finish (default)\n"
+        "   -any           Wait for any one of the jobs to finish and display its ID\n"
+        "   -v             Display the ID of each job as it finishes\n"
+        "\n"
+        "If no IDs are specified, wait for all jobs.\n";
 
 /**
  Display usage text to the user.
@@ -52,6 +58,62 @@ WaitHelp(VOID)
     return TRUE;
 }
 
+/**
+ Wait for a set of jobs, optionally returning as soon as any one of them
+ finishes, and optionally displaying the ID of each job as it finishes.
+
+ @param JobCount The number of jobs in the JobIds array.
+
+ @param JobIds An array of job IDs to wait for.  On return, this array has
+        been reordered so that finished jobs are at the end.
+
+ @param WaitForAny If TRUE, return after one job finishes.  If FALSE, return
+        after all jobs finish.
+
+ @param DisplayCompleted If TRUE, display the ID of each job as it finishes.
+
+ @return TRUE if the jobs finished, FALSE if the wait was cancelled.
+ */
+BOOLEAN
+WaitForJobs(
+    __in DWORD JobCount,
+    __inout_ecount(JobCount) PDWORD JobIds,
+    __in BOOLEAN WaitForAny,
+    __in BOOLEAN DisplayCompleted
+    )
+{
+    DWORD CompletedJobId;
+    DWORD Index;
+
+    while (JobCount > 0) {
+        if (!YoriCallWaitForAnyJob(JobCount, JobIds, &CompletedJobId)) {
+            if (YoriLibIsOperationCancelled()) {
+                return FALSE;
+            }
+            break;
+        }
+
+        if (DisplayCompleted) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%i\n"), CompletedJobId);
+        }
+
+        if (WaitForAny) {
+            break;
+        }
+
+        for (Index = 0; Index < JobCount; Index++) {
+            if (JobIds[Index] == CompletedJobId) {
+                JobIds[Index] = JobIds[JobCount - 1];
+                JobIds[JobCount - 1] = CompletedJobId;
+                break;
+            }
+        }
+        JobCount--;
+    }
+
+    return TRUE;
+}
+
 /**
  Entrypoint for the wait builtin command.
 
@@ -70,9 +132,14 @@ YoriCmd_WAIT(
 {
     DWORD JobId = 0;
     BOOLEAN ArgumentUnderstood;
+    BOOLEAN WaitForAny = FALSE;
+    BOOLEAN DisplayCompleted = FALSE;
     YORI_ALLOC_SIZE_T i;
     YORI_ALLOC_SIZE_T StartArg = 0;
     YORI_STRING Arg;
+    PDWORD JobIds;
+    DWORD JobCount;
+    DWORD Result;
 
     YoriLibLoadNtDllFunctions();
     YoriLibLoadKernel32Functions();
@@ -90,6 +157,16 @@ YoriCmd_WAIT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2017-2018"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("all")) == 0) {
+                WaitForAny = FALSE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("any")) == 0) {
+                WaitForAny = TRUE;
+                DisplayCompleted = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("v")) == 0) {
+                DisplayCompleted = TRUE;
+                ArgumentUnderstood = TRUE;
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -102,14 +179,13 @@ YoriCmd_WAIT(
         }
     }
 
-    if (StartArg == 0) {
-        JobId = YoriCallGetNextJobId(JobId);
-        while (JobId != 0) {
-            YoriCallWaitForJob(JobId);
-            JobId = YoriCallGetNextJobId(JobId);
-        }
+    //
+    //  Waiting for a single job without any options retains the behavior
+    //  of the shell's job wait, which allows the job to be cancelled or
+    //  moved to the background.
+    //
 
-    } else {
+    if (StartArg != 0 && StartArg + 1 == ArgC && !WaitForAny && !DisplayCompleted) {
         YORI_MAX_SIGNED_T llTemp;
         YORI_ALLOC_SIZE_T CharsConsumed;
 
@@ -125,8 +201,64 @@ YoriCmd_WAIT(
             return EXIT_FAILURE;
         }
         YoriCallWaitForJob(JobId);
+        return EXIT_SUCCESS;
+    }
+
+    //
+    //  Collect the set of jobs to wait for, which is either the jobs
+    //  specified or every job.
+    //
+
+    JobCount = 0;
+    if (StartArg == 0) {
+        JobId = YoriCallGetNextJobId(0);
+        while (JobId != 0) {
+            JobCount++;
+            JobId = YoriCallGetNextJobId(JobId);
+        }
+    } else {
+        JobCount = ArgC - StartArg;
+    }
+
+    if (JobCount == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    JobIds = YoriLibMalloc(JobCount * sizeof(DWORD));
+    if (JobIds == NULL) {
+        return EXIT_FAILURE;
     }
-    return EXIT_SUCCESS;
+
+    if (StartArg == 0) {
+        JobId = YoriCallGetNextJobId(0);
+        for (i = 0; i < JobCount && JobId != 0; i++) {
+            JobIds[i] = JobId;
+            JobId = YoriCallGetNextJobId(JobId);
+        }
+        JobCount = i;
+    } else {
+        YORI_MAX_SIGNED_T llTemp;
+        YORI_ALLOC_SIZE_T CharsConsumed;
+
+        for (i = 0; i < JobCount; i++) {
+            if (!YoriLibStringToNumber(&ArgV[StartArg + i], TRUE, &llTemp, &CharsConsumed) ||
+                llTemp <= 0) {
+
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not a valid job.\n"), &ArgV[StartArg + i]);
+                YoriLibFree(JobIds);
+                return EXIT_FAILURE;
+            }
+            JobIds[i] = (DWORD)llTemp;
+        }
+    }
+
+    Result = EXIT_SUCCESS;
+    if (!WaitForJobs(JobCount, JobIds, WaitForAny, DisplayCompleted)) {
+        Result = EXIT_FAILURE;
+    }
+
+    YoriLibFree(JobIds);
+    return Result;
 }
 
 // vim:sw=4:ts=4:et:
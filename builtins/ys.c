@@ -224,6 +224,17 @@ typedef struct _YS_SCRIPT_LINE {
      */
     YORI_STRING LineContents;
 
+    /**
+     If the line is a label, the entry for the label within the script's
+     label index.
+     */
+    YORI_HASH_ENTRY LabelEntry;
+
+    /**
+     TRUE if LabelEntry is currently inserted into the script's label index.
+     */
+    BOOLEAN LabelIndexed;
+
 } YS_SCRIPT_LINE, *PYS_SCRIPT_LINE;
 
 /**
@@ -287,6 +298,14 @@ typedef struct _YS_SCRIPT {
      */
     PYS_SCRIPT_LINE ActiveLine;
 
+    /**
+     A hash table of labels within the script, used to find the target of
+     a goto without scanning every line.  This is NULL if the index has not
+     been built, which occurs on the first goto and again after lines are
+     added to the script.
+     */
+    PYORI_GROWABLE_HASH_TABLE LabelIndex;
+
     /**
      The global argument context of the script, describing the arguments that
      should be used when not executing functions within the script.
@@ -325,6 +344,120 @@ YsGotoScriptEnd(VOID)
     }
 }
 
+/**
+ Determine whether a line within a script is a label, and if so, return the
+ label name.
+
+ @param Line Pointer to the line.
+
+ @param LabelString On successful completion, updated to point to the label
+        name within the line.  This is not NULL terminated.
+
+ @return TRUE if the line is a label, FALSE if it is not.
+ */
+__success(return)
+BOOL
+YsGetLineLabel(
+    __in PYS_SCRIPT_LINE Line,
+    __out PYORI_STRING LabelString
+    )
+{
+    if (Line->LineContents.LengthInChars <= 1 ||
+        Line->LineContents.StartOfString[0] != ':') {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(LabelString);
+    LabelString->MemoryToFree = Line->LineContents.MemoryToFree;
+    LabelString->StartOfString = &Line->LineContents.StartOfString[1];
+    LabelString->LengthInChars = Line->LineContents.LengthInChars - 1;
+
+    if (LabelString->LengthInChars >= 1 &&
+        LabelString->StartOfString[LabelString->LengthInChars - 1] == '\0') {
+        LabelString->LengthInChars--;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free the index of labels within a script.  This is done when the script
+ is freed, or when lines are added to the script so the index needs to be
+ rebuilt.
+
+ @param Script Pointer to the script.
+ */
+VOID
+YsFreeLabelIndex(
+    __in PYS_SCRIPT Script
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYS_SCRIPT_LINE Line;
+
+    if (Script->LabelIndex == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
+        if (Line->LabelIndexed) {
+            YoriLibGrowableHashRemoveByEntry(Script->LabelIndex, &Line->LabelEntry);
+            Line->LabelIndexed = FALSE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, ListEntry);
+    }
+
+    YoriLibFreeEmptyGrowableHashTable(Script->LabelIndex);
+    Script->LabelIndex = NULL;
+}
+
+/**
+ Build an index of labels within a script.  If a label occurs more than
+ once, the first occurrence is indexed, since that is the one a goto
+ transfers execution to.
+
+ @param Script Pointer to the script.
+
+ @return TRUE to indicate the index was built, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YsBuildLabelIndex(
+    __in PYS_SCRIPT Script
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYS_SCRIPT_LINE Line;
+    YORI_STRING LabelString;
+
+    ASSERT(Script->LabelIndex == NULL);
+
+    Script->LabelIndex = YoriLibAllocateGrowableHashTable(64);
+    if (Script->LabelIndex == NULL) {
+        return FALSE;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
+        if (YsGetLineLabel(Line, &LabelString) &&
+            YoriLibGrowableHashLookupByKey(Script->LabelIndex, &LabelString) == NULL) {
+
+            if (!YoriLibGrowableHashInsertByKey(Script->LabelIndex, &LabelString, Line, &Line->LabelEntry)) {
+                YsFreeLabelIndex(Script);
+                return FALSE;
+            }
+            Line->LabelIndexed = TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, ListEntry);
+    }
+
+    return TRUE;
+}
+
 /**
  Switch the actively executing line within the script to the specified label,
  if it can be found.
@@ -340,7 +473,9 @@ YsGotoLabel(
     )
 {
     PYORI_LIST_ENTRY ListEntry;
+    PYORI_HASH_ENTRY HashEntry;
     PYS_SCRIPT_LINE Line;
+    YORI_STRING LabelString;
 
     //
     //  First special case :eof for no good reason other than CMD does.
@@ -352,30 +487,30 @@ YsGotoLabel(
     }
 
     //
-    //  Now look for user defined labels within the script.
+    //  Now look for user defined labels within the script.  Scripts that
+    //  loop can goto many times, so use the index of labels if it can be
+    //  built.
     //
 
+    if (YsActiveScript->LabelIndex != NULL || YsBuildLabelIndex(YsActiveScript)) {
+        YoriLibConstantString(&LabelString, Label);
+        HashEntry = YoriLibGrowableHashLookupByKey(YsActiveScript->LabelIndex, &LabelString);
+        if (HashEntry == NULL) {
+            return FALSE;
+        }
+
+        YsActiveScript->ActiveLine = HashEntry->Context;
+        return TRUE;
+    }
+
     ListEntry = YoriLibGetNextListEntry(&YsActiveScript->LineLinks, NULL);
     while (ListEntry != NULL) {
         Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
-        if (Line->LineContents.LengthInChars > 1 &&
-            Line->LineContents.StartOfString[0] == ':') {
-
-            YORI_STRING LabelString;
+        if (YsGetLineLabel(Line, &LabelString) &&
+            YoriLibCompareStringWithLiteralInsensitive(&LabelString, Label) == 0) {
 
-            YoriLibInitEmptyString(&LabelString);
-            LabelString.StartOfString = &Line->LineContents.StartOfString[1];
-            LabelString.LengthInChars = Line->LineContents.LengthInChars - 1;
-
-            if (LabelString.LengthInChars >= 1 &&
-                LabelString.StartOfString[LabelString.LengthInChars - 1] == '\0') {
-                LabelString.LengthInChars--;
-            }
-
-            if (YoriLibCompareStringWithLiteralInsensitive(&LabelString, Label) == 0) {
-                YsActiveScript->ActiveLine = Line;
-                return TRUE;
-            }
+            YsActiveScript->ActiveLine = Line;
+            return TRUE;
         }
         ListEntry = YoriLibGetNextListEntry(&YsActiveScript->LineLinks, ListEntry);
     }
@@ -430,6 +565,7 @@ YsLoadLines(
         }
 
         YoriLibInitEmptyString(&ThisLine->LineContents);
+        ThisLine->LabelIndexed = FALSE;
 
         if (!YoriLibReadLineToString(&ThisLine->LineContents, &LineContext, Handle)) {
             YoriLibFree(ThisLine);
@@ -906,6 +1042,13 @@ YoriCmd_INCLUDE(
 
     YoriLibFreeStringContents(&FileName);
 
+    //
+    //  The included lines may contain labels, so the index needs to be
+    //  rebuilt on the next goto.
+    //
+
+    YsFreeLabelIndex(YsActiveScript);
+
     if (!YsLoadLines(FileHandle, &YsActiveScript->ActiveLine->LineLinks)) {
         CloseHandle(FileHandle);
         return EXIT_FAILURE;
@@ -1181,6 +1324,8 @@ YsFreeScript(
     PYORI_LIST_ENTRY NextEntry;
     BOOL CallStackFound;
 
+    YsFreeLabelIndex(Script);
+
     NextEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
     while(NextEntry != NULL) {
         CurrentLine = CONTAINING_RECORD(NextEntry, YS_SCRIPT_LINE, LineLinks);
@@ -1225,6 +1370,7 @@ YsLoadScript(
 
     YoriLibInitializeListHead(&Script->LineLinks);
     YoriLibInitializeListHead(&Script->CallStackLinks);
+    Script->LabelIndex = NULL;
 
     if (!YsLoadLines(Handle, &Script->LineLinks)) {
         Result = FALSE;
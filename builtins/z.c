@@ -36,7 +36,13 @@ CHAR strZHelpText[] =
         "\n"
         "Changes the current directory based on a heuristic match.\n"
         "\n"
-        "Z [-license] <directory>\n";
+        "Z [-license] [-l] [-u] <directory>\n"
+        "\n"
+        "   -l             List the recently used directories\n"
+        "   -u             Unload the module and discard recent directories\n"
+        "\n"
+        "If YORIZFILE is set, recent directories are saved to and shared through the\n"
+        "file it refers to.\n";
 
 /**
  Display usage text to the user.
@@ -57,6 +63,19 @@ ZHelp(VOID)
  */
 #define Z_MAX_RECENT_DIRS (64)
 
+/**
+ The number of lines that the file of recent directories can grow to before
+ it is rewritten to contain only the current set of recent directories.
+ */
+#define Z_MAX_FILE_LINES (Z_MAX_RECENT_DIRS * 16)
+
+/**
+ The maximum number of bytes to read from the file of recent directories
+ at once.  If more than this has been added, only the most recent entries
+ are loaded.
+ */
+#define Z_MAX_FILE_READ (1024 * 1024)
+
 /**
  A linked list element corresponding to a remembered directory.
  */
@@ -68,6 +87,12 @@ typedef struct _Z_RECENT_DIRECTORY {
      */
     YORI_LIST_ENTRY ListEntry;
 
+    /**
+     The entry within the hash table of remembered directories, indexed by
+     directory name.  Corresponds to ZRecentDirectories.DirectoryIndex .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
     /**
      The fully qualified name of the remembered directory.
      */
@@ -101,6 +126,36 @@ typedef struct _Z_RECENT_DIRECTORIES {
      */
     DWORD MonotonicAddAttempt;
 
+    /**
+     A hash table of recent directories indexed by name, so a directory can
+     be found without searching the list.
+     */
+    PYORI_GROWABLE_HASH_TABLE DirectoryIndex;
+
+    /**
+     The fully qualified name of the file that recent directories are
+     shared through.  This is empty if no file has been used.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The file index of the file that recent directories were loaded from.
+     If this changes, the file has been rewritten.
+     */
+    DWORDLONG FileIndex;
+
+    /**
+     The offset within the file that has been loaded.  Any data beyond
+     this offset was added after the last load, possibly by another process.
+     */
+    DWORDLONG FileOffset;
+
+    /**
+     The number of lines in the file, used to determine when the file
+     should be rewritten.
+     */
+    DWORD FileLineCount;
+
 } Z_RECENT_DIRECTORIES, *PZ_RECENT_DIRECTORIES;
 
 /**
@@ -156,6 +211,45 @@ ZListStack(VOID)
     return TRUE;
 }
 
+/**
+ Remove a directory from the set of recent directories and free it.
+
+ @param RecentDir Pointer to the directory to remove.
+ */
+VOID
+ZRemoveRecentDirectory(
+    __in PZ_RECENT_DIRECTORY RecentDir
+    )
+{
+    YoriLibRemoveListItem(&RecentDir->ListEntry);
+    YoriLibGrowableHashRemoveByEntry(ZRecentDirectories.DirectoryIndex, &RecentDir->HashEntry);
+    YoriLibFreeStringContents(&RecentDir->DirectoryName);
+    YoriLibDereference(RecentDir);
+    ZRecentDirectories.RecentDirCount--;
+}
+
+/**
+ Remove all directories from the set of recent directories.
+ */
+VOID
+ZFlushRecentDirectories(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PZ_RECENT_DIRECTORY FoundRecentDir;
+
+    if (ZRecentDirectories.RecentDirList.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, NULL);
+    while (ListEntry != NULL) {
+        FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
+        ZRemoveRecentDirectory(FoundRecentDir);
+    }
+    ZRecentDirectories.MonotonicAddAttempt = 0;
+}
+
 /**
  Check the recent directories for a match to DirectoryName.  If a match is
  found, promote it to be the most recent entry and update its HitCount.
@@ -164,36 +258,54 @@ ZListStack(VOID)
 
  @param DirectoryName Pointer to the fully qualified directory name to add.
 
+ @param SavedHitCount If nonzero, the directory is being restored from a
+        saved set of recent directories, and this specifies its HitCount.
+        If zero, the directory is being visited, so its HitCount is
+        incremented.
+
  @return TRUE if the entry was successfully added, FALSE if it was not.
  */
 BOOL
 ZAddDirectoryToRecent(
-    __in PYORI_STRING DirectoryName
+    __in PYORI_STRING DirectoryName,
+    __in DWORD SavedHitCount
     )
 {
     PYORI_LIST_ENTRY ListEntry;
+    PYORI_HASH_ENTRY HashEntry;
     PZ_RECENT_DIRECTORY FoundRecentDir;
 
     if (ZRecentDirectories.RecentDirList.Next == NULL) {
         YoriLibInitializeListHead(&ZRecentDirectories.RecentDirList);
     }
 
+    if (ZRecentDirectories.DirectoryIndex == NULL) {
+        ZRecentDirectories.DirectoryIndex = YoriLibAllocateGrowableHashTable(Z_MAX_RECENT_DIRS);
+        if (ZRecentDirectories.DirectoryIndex == NULL) {
+            return FALSE;
+        }
+    }
+
     //
     //  If this attempt to add is a multiple of 1/4th of the size of the
     //  list, decrease each HitCount by 1/4th of its current value.
     //  This math isn't completely perfect, but it will tend to keep
     //  HitCounts relatively low while still maintaining a measurable
     //  difference between entries hit a lot and entries rarely hit.
+    //  Restoring a saved directory is not a new visit, so it doesn't
+    //  count.
     //
 
-    ZRecentDirectories.MonotonicAddAttempt++;
-    if ((ZRecentDirectories.MonotonicAddAttempt % (Z_MAX_RECENT_DIRS >> 2)) == 0) {
-        ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, NULL);
-        while (ListEntry != NULL) {
-            FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
-            ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
-            FoundRecentDir->HitCount -= (FoundRecentDir->HitCount >> 2);
-            ASSERT(FoundRecentDir->HitCount > 0);
+    if (SavedHitCount == 0) {
+        ZRecentDirectories.MonotonicAddAttempt++;
+        if ((ZRecentDirectories.MonotonicAddAttempt % (Z_MAX_RECENT_DIRS >> 2)) == 0) {
+            ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, NULL);
+            while (ListEntry != NULL) {
+                FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
+                ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
+                FoundRecentDir->HitCount -= (FoundRecentDir->HitCount >> 2);
+                ASSERT(FoundRecentDir->HitCount > 0);
+            }
         }
     }
 
@@ -203,16 +315,17 @@ ZAddDirectoryToRecent(
     //  HitCount, and return.
     //
 
-    ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, NULL);
-    while (ListEntry != NULL) {
-        FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
-        if (YoriLibCompareStringInsensitive(DirectoryName, &FoundRecentDir->DirectoryName) == 0) {
-            YoriLibRemoveListItem(&FoundRecentDir->ListEntry);
-            YoriLibInsertList(&ZRecentDirectories.RecentDirList, &FoundRecentDir->ListEntry);
+    HashEntry = YoriLibGrowableHashLookupByKey(ZRecentDirectories.DirectoryIndex, DirectoryName);
+    if (HashEntry != NULL) {
+        FoundRecentDir = HashEntry->Context;
+        YoriLibRemoveListItem(&FoundRecentDir->ListEntry);
+        YoriLibInsertList(&ZRecentDirectories.RecentDirList, &FoundRecentDir->ListEntry);
+        if (SavedHitCount == 0) {
             FoundRecentDir->HitCount++;
-            return TRUE;
+        } else {
+            FoundRecentDir->HitCount = SavedHitCount;
         }
-        ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
+        return TRUE;
     }
 
     //
@@ -223,10 +336,7 @@ ZAddDirectoryToRecent(
     if (ZRecentDirectories.RecentDirCount >= Z_MAX_RECENT_DIRS) {
         ListEntry = YoriLibGetPreviousListEntry(&ZRecentDirectories.RecentDirList, NULL);
         FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
-        YoriLibRemoveListItem(&FoundRecentDir->ListEntry);
-        YoriLibFreeStringContents(&FoundRecentDir->DirectoryName);
-        YoriLibDereference(FoundRecentDir);
-        ZRecentDirectories.RecentDirCount--;
+        ZRemoveRecentDirectory(FoundRecentDir);
     }
 
     //
@@ -244,9 +354,20 @@ ZAddDirectoryToRecent(
     FoundRecentDir->DirectoryName.LengthAllocated = DirectoryName->LengthInChars + 1;
     FoundRecentDir->DirectoryName.LengthInChars = DirectoryName->LengthInChars;
 
-    memcpy(FoundRecentDir->DirectoryName.StartOfString, DirectoryName->StartOfString, (DirectoryName->LengthInChars + 1) * sizeof(TCHAR));
+    memcpy(FoundRecentDir->DirectoryName.StartOfString, DirectoryName->StartOfString, DirectoryName->LengthInChars * sizeof(TCHAR));
+    FoundRecentDir->DirectoryName.StartOfString[DirectoryName->LengthInChars] = '\0';
 
-    FoundRecentDir->HitCount = 1;
+    if (SavedHitCount == 0) {
+        FoundRecentDir->HitCount = 1;
+    } else {
+        FoundRecentDir->HitCount = SavedHitCount;
+    }
+
+    if (!YoriLibGrowableHashInsertByKey(ZRecentDirectories.DirectoryIndex, &FoundRecentDir->DirectoryName, FoundRecentDir, &FoundRecentDir->HashEntry)) {
+        YoriLibFreeStringContents(&FoundRecentDir->DirectoryName);
+        YoriLibDereference(FoundRecentDir);
+        return FALSE;
+    }
 
     YoriLibInsertList(&ZRecentDirectories.RecentDirList, &FoundRecentDir->ListEntry);
     ZRecentDirectories.RecentDirCount++;
@@ -257,23 +378,406 @@ ZAddDirectoryToRecent(
 }
 
 /**
- Called when the module is unloaded to clean up state.
+ Resolve the file that recent directories should be shared through, if the
+ user has requested this behavior by setting YORIZFILE.
+
+ @param FilePath On successful completion, populated with the fully
+        qualified path to the file.  This is empty if no file is configured.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ZGetFileName(
+    __out PYORI_STRING FilePath
+    )
+{
+    YORI_STRING UserFileName;
+
+    YoriLibInitEmptyString(FilePath);
+    YoriLibInitEmptyString(&UserFileName);
+
+    if (!YoriLibAllocateAndGetEnvironmentVariable(_T("YORIZFILE"), &UserFileName)) {
+        return FALSE;
+    }
+
+    if (UserFileName.LengthInChars == 0) {
+        return TRUE;
+    }
+
+    if (!YoriLibUserStringToSingleFilePath(&UserFileName, TRUE, FilePath)) {
+        YoriLibFreeStringContents(&UserFileName);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&UserFileName);
+    return TRUE;
+}
+
+/**
+ Process a single line from the file of recent directories.  A line
+ consisting of a directory name indicates the directory was visited.  A
+ line consisting of a HitCount, a tab, and a directory name restores a
+ directory with the specified HitCount.
+
+ @param Line Pointer to the line to process.
  */
 VOID
-YORI_BUILTIN_FN
-ZNotifyUnload(VOID)
+ZProcessFileLine(
+    __in PYORI_STRING Line
+    )
+{
+    YORI_STRING DirectoryName;
+    YORI_STRING HitCountString;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    LPTSTR Tab;
+    DWORD SavedHitCount;
+
+    YoriLibInitEmptyString(&DirectoryName);
+    DirectoryName.StartOfString = Line->StartOfString;
+    DirectoryName.LengthInChars = Line->LengthInChars;
+    SavedHitCount = 0;
+
+    Tab = YoriLibFindLeftMostCharacter(Line, '\t');
+    if (Tab != NULL) {
+        YoriLibInitEmptyString(&HitCountString);
+        HitCountString.StartOfString = Line->StartOfString;
+        HitCountString.LengthInChars = (YORI_ALLOC_SIZE_T)(Tab - Line->StartOfString);
+        if (!YoriLibStringToNumber(&HitCountString, FALSE, &llTemp, &CharsConsumed) ||
+            CharsConsumed != HitCountString.LengthInChars ||
+            llTemp <= 0) {
+
+            return;
+        }
+
+        SavedHitCount = (DWORD)llTemp;
+        DirectoryName.StartOfString = Tab + 1;
+        DirectoryName.LengthInChars = Line->LengthInChars - HitCountString.LengthInChars - 1;
+    }
+
+    if (DirectoryName.LengthInChars > 0) {
+        ZAddDirectoryToRecent(&DirectoryName, SavedHitCount);
+    }
+}
+
+/**
+ Load any recent directories that have been added to the file of recent
+ directories since it was last loaded.  These may have been added by this
+ process or by any other process sharing the same file.  If the file has
+ been rewritten since it was last loaded, the recent directories are
+ discarded and the entire file is loaded.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ZLoadFromFile(VOID)
+{
+    YORI_STRING FilePath;
+    YORI_STRING Line;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    HANDLE FileHandle;
+    DWORDLONG FileIndex;
+    DWORDLONG FileSize;
+    DWORDLONG ReadOffset;
+    LONG OffsetHigh;
+    LPSTR Buffer;
+    DWORD BytesToRead;
+    DWORD BytesRead;
+    DWORD LineStart;
+    DWORD Index;
+    DWORD LineLength;
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    BOOLEAN PartialFirstLine;
+
+    if (!ZGetFileName(&FilePath)) {
+        return FALSE;
+    }
+
+    if (FilePath.LengthInChars == 0) {
+        YoriLibFreeStringContents(&ZRecentDirectories.FileName);
+        return TRUE;
+    }
+
+    //
+    //  If this is a different file to the one previously loaded, load all
+    //  of it.  Recent directories from the previous file are retained.
+    //
+
+    if (YoriLibCompareStringInsensitive(&FilePath, &ZRecentDirectories.FileName) != 0) {
+        YoriLibFreeStringContents(&ZRecentDirectories.FileName);
+        memcpy(&ZRecentDirectories.FileName, &FilePath, sizeof(YORI_STRING));
+        ZRecentDirectories.FileIndex = 0;
+        ZRecentDirectories.FileOffset = 0;
+        ZRecentDirectories.FileLineCount = 0;
+    } else {
+        YoriLibFreeStringContents(&FilePath);
+    }
+
+    FileHandle = CreateFile(ZRecentDirectories.FileName.StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND) {
+            ZRecentDirectories.FileOffset = 0;
+            ZRecentDirectories.FileLineCount = 0;
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    if (!GetFileInformationByHandle(FileHandle, &FileInfo)) {
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    FileIndex = ((DWORDLONG)FileInfo.nFileIndexHigh << 32) | FileInfo.nFileIndexLow;
+    FileSize = ((DWORDLONG)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+
+    //
+    //  If the file has been replaced since it was loaded, the recent
+    //  directories in it have already been merged and written out, so
+    //  start again from the new file.
+    //
+
+    if (FileIndex != ZRecentDirectories.FileIndex || FileSize < ZRecentDirectories.FileOffset) {
+        if (ZRecentDirectories.FileOffset > 0) {
+            ZFlushRecentDirectories();
+        }
+        ZRecentDirectories.FileIndex = FileIndex;
+        ZRecentDirectories.FileOffset = 0;
+        ZRecentDirectories.FileLineCount = 0;
+    }
+
+    if (FileSize == ZRecentDirectories.FileOffset) {
+        CloseHandle(FileHandle);
+        return TRUE;
+    }
+
+    ReadOffset = ZRecentDirectories.FileOffset;
+    PartialFirstLine = FALSE;
+    if (FileSize - ReadOffset > Z_MAX_FILE_READ) {
+        ReadOffset = FileSize - Z_MAX_FILE_READ;
+        PartialFirstLine = TRUE;
+    }
+    BytesToRead = (DWORD)(FileSize - ReadOffset);
+
+    Buffer = YoriLibMalloc(BytesToRead);
+    if (Buffer == NULL) {
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    OffsetHigh = (LONG)(ReadOffset >> 32);
+    if (SetFilePointer(FileHandle, (LONG)ReadOffset, &OffsetHigh, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+
+        YoriLibFree(Buffer);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    if (!ReadFile(FileHandle, Buffer, BytesToRead, &BytesRead, NULL)) {
+        YoriLibFree(Buffer);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    CloseHandle(FileHandle);
+
+    //
+    //  Process each complete line.  A line without a terminator may still
+    //  be being written by another process, so it is left to be loaded
+    //  next time.
+    //
+
+    YoriLibInitEmptyString(&Line);
+    LineStart = 0;
+    for (Index = 0; Index < BytesRead; Index++) {
+        if (Buffer[Index] != '\n') {
+            continue;
+        }
+
+        if (PartialFirstLine) {
+            PartialFirstLine = FALSE;
+            LineStart = Index + 1;
+            continue;
+        }
+
+        LineLength = Index - LineStart;
+        if (LineLength > 0 && Buffer[LineStart + LineLength - 1] == '\r') {
+            LineLength--;
+        }
+
+        CharsNeeded = YoriLibGetMultibyteInputSizeNeeded(&Buffer[LineStart], (YORI_ALLOC_SIZE_T)LineLength);
+        if (CharsNeeded > Line.LengthAllocated) {
+            YoriLibFreeStringContents(&Line);
+            if (!YoriLibAllocateString(&Line, CharsNeeded + 0x100)) {
+                break;
+            }
+        }
+
+        YoriLibMultibyteInput(&Buffer[LineStart], (YORI_ALLOC_SIZE_T)LineLength, Line.StartOfString, CharsNeeded);
+        Line.LengthInChars = CharsNeeded;
+        ZProcessFileLine(&Line);
+
+        ZRecentDirectories.FileLineCount++;
+        LineStart = Index + 1;
+    }
+
+    ZRecentDirectories.FileOffset = ReadOffset + LineStart;
+
+    YoriLibFreeStringContents(&Line);
+    YoriLibFree(Buffer);
+    return TRUE;
+}
+
+/**
+ Rewrite the file of recent directories to contain only the current set of
+ recent directories.  The new file is written under a temporary name and
+ then renamed over the existing file, so other processes reading the file
+ can detect that it has been replaced.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ZCompactFile(VOID)
 {
+    YORI_STRING TempFileName;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
     PYORI_LIST_ENTRY ListEntry;
     PZ_RECENT_DIRECTORY FoundRecentDir;
+    HANDLE FileHandle;
 
-    ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, NULL);
+    if (!YoriLibAllocateString(&TempFileName, ZRecentDirectories.FileName.LengthInChars + sizeof(".tmp"))) {
+        return FALSE;
+    }
+
+    TempFileName.LengthInChars = YoriLibSPrintf(TempFileName.StartOfString, _T("%y.tmp"), &ZRecentDirectories.FileName);
+
+    FileHandle = CreateFile(TempFileName.StartOfString,
+                            GENERIC_WRITE,
+                            0,
+                            NULL,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        YoriLibFreeStringContents(&TempFileName);
+        return FALSE;
+    }
+
+    //
+    //  Write from least recently used to most recently used, so loading
+    //  the file results in the same order.
+    //
+
+    ListEntry = YoriLibGetPreviousListEntry(&ZRecentDirectories.RecentDirList, NULL);
     while (ListEntry != NULL) {
         FoundRecentDir = CONTAINING_RECORD(ListEntry, Z_RECENT_DIRECTORY, ListEntry);
-        ListEntry = YoriLibGetNextListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
-        YoriLibRemoveListItem(&FoundRecentDir->ListEntry);
-        YoriLibFreeStringContents(&FoundRecentDir->DirectoryName);
-        YoriLibDereference(FoundRecentDir);
+        YoriLibOutputToDevice(FileHandle, 0, _T("%i\t%y\n"), FoundRecentDir->HitCount, &FoundRecentDir->DirectoryName);
+        ListEntry = YoriLibGetPreviousListEntry(&ZRecentDirectories.RecentDirList, ListEntry);
     }
+
+    if (!GetFileInformationByHandle(FileHandle, &FileInfo)) {
+        CloseHandle(FileHandle);
+        DeleteFile(TempFileName.StartOfString);
+        YoriLibFreeStringContents(&TempFileName);
+        return FALSE;
+    }
+
+    CloseHandle(FileHandle);
+
+    if (!MoveFileEx(TempFileName.StartOfString, ZRecentDirectories.FileName.StartOfString, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFile(TempFileName.StartOfString);
+        YoriLibFreeStringContents(&TempFileName);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+
+    ZRecentDirectories.FileIndex = ((DWORDLONG)FileInfo.nFileIndexHigh << 32) | FileInfo.nFileIndexLow;
+    ZRecentDirectories.FileOffset = ((DWORDLONG)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+    ZRecentDirectories.FileLineCount = ZRecentDirectories.RecentDirCount;
+    return TRUE;
+}
+
+/**
+ Record that the user has moved from one directory to another.  If a file
+ of recent directories is configured, the visits are appended to it and
+ loaded back from it, along with any visits from other processes.  If the
+ file has grown too large, it is rewritten.
+
+ @param OldDirectory Pointer to the directory being left.
+
+ @param NewDirectory Pointer to the directory being entered.
+
+ @return TRUE if the visits were recorded in the file, FALSE if they were
+         not, in which case the caller should add them to the recent
+         directories directly.
+ */
+BOOL
+ZRecordVisitsInFile(
+    __in PYORI_STRING OldDirectory,
+    __in PYORI_STRING NewDirectory
+    )
+{
+    HANDLE FileHandle;
+
+    if (ZRecentDirectories.FileName.LengthInChars == 0) {
+        return FALSE;
+    }
+
+    FileHandle = CreateFile(ZRecentDirectories.FileName.StartOfString,
+                            FILE_APPEND_DATA,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    YoriLibOutputToDevice(FileHandle, 0, _T("%y\n%y\n"), OldDirectory, NewDirectory);
+    CloseHandle(FileHandle);
+
+    if (!ZLoadFromFile()) {
+        return FALSE;
+    }
+
+    if (ZRecentDirectories.FileLineCount > Z_MAX_FILE_LINES) {
+        ZCompactFile();
+    }
+
+    return TRUE;
+}
+
+/**
+ Called when the module is unloaded to clean up state.
+ */
+VOID
+YORI_BUILTIN_FN
+ZNotifyUnload(VOID)
+{
+    ZFlushRecentDirectories();
+    if (ZRecentDirectories.DirectoryIndex != NULL) {
+        YoriLibFreeEmptyGrowableHashTable(ZRecentDirectories.DirectoryIndex);
+        ZRecentDirectories.DirectoryIndex = NULL;
+    }
+    YoriLibFreeStringContents(&ZRecentDirectories.FileName);
+    ZRecentDirectories.FileIndex = 0;
+    ZRecentDirectories.FileOffset = 0;
+    ZRecentDirectories.FileLineCount = 0;
 }
 
 /**
@@ -658,11 +1162,6 @@ YoriCmd_Z(
         }
     }
 
-    if (ListStack) {
-        ZListStack();
-        return EXIT_SUCCESS;
-    }
-
     if (Unload) {
         if (ZCallbacksRegistered) {
             YORI_STRING ZCmd;
@@ -673,6 +1172,33 @@ YoriCmd_Z(
         return EXIT_SUCCESS;
     }
 
+    //
+    //  Register the module so that recent directories, including any
+    //  loaded from a file, are retained and freed on unload.
+    //
+
+    if (!ZCallbacksRegistered) {
+        YORI_STRING ZCmd;
+        YoriLibConstantString(&ZCmd, _T("Z"));
+        if (!YoriCallBuiltinRegister(&ZCmd, YoriCmd_Z)) {
+            return EXIT_FAILURE;
+        }
+        YoriCallSetUnloadRoutine(ZNotifyUnload);
+        ZCallbacksRegistered = TRUE;
+    }
+
+    //
+    //  Pick up any directories recorded by other processes sharing the
+    //  same file.  If this fails, continue with what is already known.
+    //
+
+    ZLoadFromFile();
+
+    if (ListStack) {
+        ZListStack();
+        return EXIT_SUCCESS;
+    }
+
     if (StartArg == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("z: missing argument\n"));
         return EXIT_FAILURE;
@@ -716,8 +1242,10 @@ YoriCmd_Z(
 
     YoriLibFreeStringContents(&FullyResolvedUserSpecification);
 
-    ZAddDirectoryToRecent(&OldCurrentDirectory);
-    ZAddDirectoryToRecent(&BestMatch);
+    if (!ZRecordVisitsInFile(&OldCurrentDirectory, &BestMatch)) {
+        ZAddDirectoryToRecent(&OldCurrentDirectory, 0);
+        ZAddDirectoryToRecent(&BestMatch, 0);
+    }
 
     Result = YoriCallSetCurrentDirectory(&BestMatch);
     if (!Result) {
@@ -759,16 +1287,6 @@ YoriCmd_Z(
     YoriLibFreeStringContents(&OldCurrentDirectory);
     YoriLibFreeStringContents(&BestMatch);
 
-    if (!ZCallbacksRegistered) {
-        YORI_STRING ZCmd;
-        YoriLibConstantString(&ZCmd, _T("Z"));
-        if (!YoriCallBuiltinRegister(&ZCmd, YoriCmd_Z)) {
-            return EXIT_FAILURE;
-        }
-        YoriCallSetUnloadRoutine(ZNotifyUnload);
-        ZCallbacksRegistered = TRUE;
-    }
-
     return EXIT_SUCCESS;
 }
 
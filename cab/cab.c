@@ -383,7 +383,7 @@ CabExpandFileFoundCallback(
     YoriLibInitEmptyString(&ErrorString);
     ErrorCode = ERROR_SUCCESS;
 
-    if (!YoriLibExtractCab(FilePath, &ExpandContext->FullTargetDirectory, TRUE, 0, NULL, 0, NULL, NULL, NULL, NULL, &ErrorCode, &ErrorString)) {
+    if (!YoriLibExtractCab(FilePath, &ExpandContext->FullTargetDirectory, TRUE, 0, NULL, 0, NULL, NULL, NULL, NULL, YORI_LIB_CAB_EXTRACT_PARALLEL_WRITE, &ErrorCode, &ErrorString)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("YoriLibExtractCab failed on %y: %y\n"), FilePath, &ErrorString);
         YoriLibFreeStringContents(&ErrorString);
     }
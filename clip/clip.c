@@ -104,10 +104,11 @@ const CHAR ClipDummyFragEnd[] =
 #define HTMLCLIP_FRAGEND_SIZE (sizeof(ClipDummyFragEnd)-1)
 
 /**
- The maximum amount of data to buffer from a pipe before acting upon it.  The
- clipboard requires a full buffer of data to oeprate with.
+ The amount of memory to allocate initially when reading from a pipe, where
+ the length of the data is not known in advance.  The allocation doubles
+ each time it fills.
  */
-#define MAX_PIPE_SIZE (4*1024*1024)
+#define CLIP_PIPE_INITIAL_SIZE (64*1024)
 
 //
 //  Older versions of the analysis engine don't understand that a buffer
@@ -124,41 +125,61 @@ const CHAR ClipDummyFragEnd[] =
 #endif
 
 /**
- Copy the contents of a file or pipe to the clipboard in HTML format.
+ Read the contents of a file or pipe directly into a global memory block
+ that can be handed to the clipboard.  The block grows as data arrives, so
+ large inputs are held once rather than in a staging buffer and then copied.
+ Space can be reserved before and after the data for a format's header and
+ footer.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
+
+ @param HeaderSize The number of bytes to reserve before the data.
+
+ @param FooterSize The number of bytes to reserve after the data.
+
+ @param BlockHandle On successful completion, updated to contain the global
+        memory block.  The block is not locked.
+
+ @param BytesRead On successful completion, updated to contain the number of
+        bytes of data read, excluding any header or footer.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
 BOOL
-ClipCopyAsHtml(
+ClipReadToGlobalBlock(
     __in HANDLE hFile,
-    __in DWORD FileSize
+    __in DWORD FileSize,
+    __in DWORD HeaderSize,
+    __in DWORD FooterSize,
+    __out PHANDLE BlockHandle,
+    __out PYORI_ALLOC_SIZE_T BytesRead
     )
 {
-    YORI_ALLOC_SIZE_T AllocSize;
-    DWORD  DesiredSize;
+    YORI_MAX_UNSIGNED_T DesiredSize;
+    YORI_ALLOC_SIZE_T DataSize;
+    YORI_ALLOC_SIZE_T CurrentOffset;
+    DWORD  BytesTransferred;
     HANDLE hMem;
+    HANDLE hNewMem;
     PUCHAR pMem;
-    DWORD  BytesTransferred;
-    YORI_ALLOC_SIZE_T CurrentOffset;
-    UINT   ClipFmt;
-    DWORD  Err;
-    LPTSTR ErrText;
+    BOOLEAN SizeKnown;
 
-    //
-    //  Allocate space to copy the file or pipe contents.
-    //
+    SizeKnown = TRUE;
+    if (FileSize == 0) {
+        SizeKnown = FALSE;
+        FileSize = CLIP_PIPE_INITIAL_SIZE;
+    }
 
-    DesiredSize = FileSize + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 2;
+    DesiredSize = (YORI_MAX_UNSIGNED_T)FileSize + HeaderSize + FooterSize;
     if (!YoriLibIsSizeAllocatable(DesiredSize)) {
         return FALSE;
     }
-    AllocSize = (YORI_ALLOC_SIZE_T)DesiredSize;
-    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, AllocSize);
+
+    DataSize = (YORI_ALLOC_SIZE_T)FileSize;
+    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, (YORI_ALLOC_SIZE_T)DesiredSize);
     if (hMem == NULL) {
         return FALSE;
     }
@@ -169,104 +190,112 @@ ClipCopyAsHtml(
         return FALSE;
     }
 
-    //
-    //  Note this is not Unicode.
-    //
-    //  First, prepare the header.  Leave a magic space at the end of the
-    //  header.
-    //
-
-    YoriLibSPrintfSA((PCHAR)pMem,
-                     AllocSize,
-                     "Version:0.9\n"
-                     "StartHTML:%08i\n"
-                     "EndHTML:%08i\n"
-                     "StartFragment:%08i\n"
-                     "EndFragment:%08i\n"
-                     "<!--StartFragment-->"
-                     " ",
-                     (int)HTMLCLIP_HDR_SIZE,
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + FileSize),
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
-                     (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + FileSize));
-
     CurrentOffset = 0;
-
-    //
-    //  Read text immediately following the header that we just prepared.
-    //
-
-    while (ReadFile(hFile, pMem + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset = CurrentOffset + (YORI_ALLOC_SIZE_T)BytesTransferred;
+    while (TRUE) {
 
         //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
+        //  If the block is full, a file has been read completely.  A pipe
+        //  may have more, so double the block.  It needs to be unlocked
+        //  so that it can move.
         //
 
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
+        if (CurrentOffset == DataSize) {
+            if (SizeKnown) {
+                break;
+            }
 
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
+            DesiredSize = (YORI_MAX_UNSIGNED_T)DataSize * 2 + HeaderSize + FooterSize;
+            if (!YoriLibIsSizeAllocatable(DesiredSize)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: pipe data too large for clipboard\n"));
+                DllKernel32.pGlobalUnlock(hMem);
+                GlobalFree(hMem);
+                return FALSE;
+            }
+
+            DllKernel32.pGlobalUnlock(hMem);
+            hNewMem = GlobalReAlloc(hMem, (YORI_ALLOC_SIZE_T)DesiredSize, GMEM_MOVEABLE);
+            if (hNewMem == NULL) {
+                GlobalFree(hMem);
+                return FALSE;
+            }
+            hMem = hNewMem;
+            DataSize = DataSize * 2;
+
+            pMem = DllKernel32.pGlobalLock(hMem);
+            if (pMem == NULL) {
+                GlobalFree(hMem);
+                return FALSE;
+            }
         }
 
-        if (BytesTransferred == 0) {
+        if (!ReadFile(hFile, pMem + HeaderSize + CurrentOffset, DataSize - CurrentOffset, &BytesTransferred, NULL) ||
+            BytesTransferred == 0) {
+
             break;
         }
-    }
 
-    if (CurrentOffset == 0) {
-        ClipHelp();
-        return FALSE;
+        CurrentOffset = CurrentOffset + (YORI_ALLOC_SIZE_T)BytesTransferred;
     }
 
+    DllKernel32.pGlobalUnlock(hMem);
+
     //
-    //  If we don't have as much text as we expected, the header is wrong
-    //  and needs to be rewritten with correct values.
+    //  A pipe can leave up to half of the block unused.  Give it back,
+    //  since the clipboard will hold this block after the process exits.
+    //  If this fails the larger block is still usable.
     //
 
-    if (CurrentOffset < FileSize) {
-        FileSize = CurrentOffset;
-        YoriLibSPrintfA((PCHAR)pMem,
-                        "Version:0.9\n"
-                        "StartHTML:%08i\n"
-                        "EndHTML:%08i\n"
-                        "StartFragment:%08i\n"
-                        "EndFragment:%08i\n"
-                        "<!--StartFragment-->",
-                        (int)HTMLCLIP_HDR_SIZE,
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + FileSize),
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
-                        (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + FileSize));
+    if (!SizeKnown && CurrentOffset < DataSize) {
+        hNewMem = GlobalReAlloc(hMem, CurrentOffset + HeaderSize + FooterSize, GMEM_MOVEABLE);
+        if (hNewMem != NULL) {
+            hMem = hNewMem;
+        }
+    }
 
-        //
-        //  That magic space from above has now been set to NULL by printf.
-        //  Put the magic space back.
-        //
+    *BlockHandle = hMem;
+    *BytesRead = CurrentOffset;
+    return TRUE;
+}
 
-        pMem[HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE] = ' ';
-    }
+/**
+ Replace the contents of the clipboard with a global memory block.  On
+ success the clipboard owns the block; on failure the block is freed.
 
-    //
-    //  Fill in the footer of the protocol.
-    //
+ @param FormatName Optionally points to the name of a registered clipboard
+        format.  If NULL, the block is placed on the clipboard as Unicode
+        text.
 
-    YoriLibSPrintfA((PCHAR)(pMem + FileSize + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1),
-                    "%s",
-                    ClipDummyFragEnd);
+ @param hMem The global memory block containing the data.
 
-    DllKernel32.pGlobalUnlock(hMem);
+ @return TRUE to indicate success or FALSE to indicate failure.
+ */
+BOOL
+ClipSetClipboardBlock(
+    __in_opt LPCTSTR FormatName,
+    __in HANDLE hMem
+    )
+{
+    UINT   ClipFmt;
+    DWORD  Err;
+    LPTSTR ErrText;
 
-    //
-    //  Send the buffer to the clipboard.
-    //
+    ClipFmt = CF_UNICODETEXT;
+    if (FormatName != NULL) {
+        ClipFmt = DllUser32.pRegisterClipboardFormatW(FormatName);
+        if (ClipFmt == 0) {
+            Err = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
+            GlobalFree(hMem);
+            return FALSE;
+        }
+    }
 
     if (!YoriLibOpenClipboard()) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
+        GlobalFree(hMem);
         return FALSE;
     }
 
@@ -275,15 +304,7 @@ ClipCopyAsHtml(
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
         DllUser32.pCloseClipboard();
-        return FALSE;
-    }
-
-    ClipFmt = DllUser32.pRegisterClipboardFormatW(_T("HTML Format"));
-    if (ClipFmt == 0) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
+        GlobalFree(hMem);
         return FALSE;
     }
 
@@ -292,178 +313,170 @@ ClipCopyAsHtml(
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
         DllUser32.pCloseClipboard();
+        GlobalFree(hMem);
         return FALSE;
     }
+
     DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
     return TRUE;
 }
 
 /**
- Copy the contents of a file or pipe to the clipboard in RTF format.
+ Copy the contents of a file or pipe to the clipboard in HTML format.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
 BOOL
-ClipCopyAsRtf(
+ClipCopyAsHtml(
     __in HANDLE hFile,
     __in DWORD FileSize
     )
 {
-    LPSTR  AnsiBuffer;
-    YORI_ALLOC_SIZE_T AllocSize;
     HANDLE hMem;
-    PCHAR  pMem;
-    DWORD  BytesTransferred;
-    YORI_ALLOC_SIZE_T CurrentOffset;
-    DWORD  Err;
-    LPTSTR ErrText;
-    UINT   ClipFmt;
+    PUCHAR pMem;
+    YORI_ALLOC_SIZE_T BytesRead;
 
     //
-    //  Allocate space to copy the file or pipe contents.
+    //  Read text immediately following space for the header, leaving a
+    //  magic space between the header and the text, and space for the
+    //  footer and its NULL terminator after the text.
     //
 
-    if (!YoriLibIsSizeAllocatable(FileSize + 1)) {
+    if (!ClipReadToGlobalBlock(hFile,
+                               FileSize,
+                               HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1,
+                               HTMLCLIP_FRAGEND_SIZE + 1,
+                               &hMem,
+                               &BytesRead)) {
         return FALSE;
     }
-    AllocSize = (YORI_ALLOC_SIZE_T)(FileSize + 1);
-    AnsiBuffer = YoriLibMalloc(AllocSize);
-    if (AnsiBuffer == NULL) {
+
+    if (BytesRead == 0) {
+        GlobalFree(hMem);
+        ClipHelp();
+        return FALSE;
+    }
+
+    pMem = DllKernel32.pGlobalLock(hMem);
+    if (pMem == NULL) {
+        GlobalFree(hMem);
         return FALSE;
     }
 
     //
     //  Note this is not Unicode.
     //
+    //  Now that the length of the text is known, prepare the header.
+    //
 
-    CurrentOffset = 0;
+    YoriLibSPrintfA((PCHAR)pMem,
+                    "Version:0.9\n"
+                    "StartHTML:%08i\n"
+                    "EndHTML:%08i\n"
+                    "StartFragment:%08i\n"
+                    "EndFragment:%08i\n"
+                    "<!--StartFragment-->",
+                    (int)HTMLCLIP_HDR_SIZE,
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + HTMLCLIP_FRAGEND_SIZE + 1 + BytesRead),
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE),
+                    (int)(HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1 + BytesRead));
 
     //
-    //  Read text.
+    //  Printf terminated the header where the magic space should be.
+    //  Put the magic space back.
     //
 
-    while (ReadFile(hFile, AnsiBuffer + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset = CurrentOffset + (YORI_ALLOC_SIZE_T)BytesTransferred;
+    pMem[HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE] = ' ';
 
-        //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
-        //
+    //
+    //  Fill in the footer of the protocol.
+    //
 
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
+    YoriLibSPrintfA((PCHAR)(pMem + BytesRead + HTMLCLIP_HDR_SIZE + HTMLCLIP_FRAGSTART_SIZE + 1),
+                    "%s",
+                    ClipDummyFragEnd);
 
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
-        }
+    DllKernel32.pGlobalUnlock(hMem);
 
-        if (BytesTransferred == 0) {
-            break;
-        }
-    }
+    //
+    //  Send the buffer to the clipboard.
+    //
 
-    if (CurrentOffset == 0) {
-        YoriLibFree(AnsiBuffer);
-        ClipHelp();
+    return ClipSetClipboardBlock(_T("HTML Format"), hMem);
+}
+
+/**
+ Copy the contents of a file or pipe to the clipboard in RTF format.
+
+ @param hFile Handle to the file or pipe.
+
+ @param FileSize The length of the file, in bytes.  For a pipe, this value is
+        not known beforehand, and is specified as zero.
+
+ @return TRUE to indicate success or FALSE to indicate failure.
+ */
+BOOL
+ClipCopyAsRtf(
+    __in HANDLE hFile,
+    __in DWORD FileSize
+    )
+{
+    HANDLE hMem;
+    PCHAR  pMem;
+    YORI_ALLOC_SIZE_T BytesRead;
+    YORI_ALLOC_SIZE_T CurrentOffset;
+
+    //
+    //  Note this is not Unicode.  Read the text with space for a NULL
+    //  terminator.
+    //
+
+    if (!ClipReadToGlobalBlock(hFile, FileSize, 0, 1, &hMem, &BytesRead)) {
         return FALSE;
     }
 
-
-    AllocSize = CurrentOffset;
-    hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, (AllocSize + 1) * sizeof(TCHAR));
-    if (hMem == NULL) {
-        YoriLibFree(AnsiBuffer);
+    if (BytesRead == 0) {
+        GlobalFree(hMem);
+        ClipHelp();
         return FALSE;
     }
 
     pMem = DllKernel32.pGlobalLock(hMem);
     if (pMem == NULL) {
         GlobalFree(hMem);
-        YoriLibFree(AnsiBuffer);
         return FALSE;
     }
 
-    for (CurrentOffset = 0; CurrentOffset < AllocSize; CurrentOffset++) {
+    //
+    //  RTF is 7 bit, so strip the high bit in place.
+    //
 
-        //
-        //  Analyze gets really confused here and thinks AnsiBuffer is
-        //  of size BytesTransferred (ie., it doesn't understand that
-        //  the read started partway through the buffer.)  At this point,
-        //  it is of size CurrentOffset.
-        //
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-#pragma warning(suppress: 6385)
-#endif
-        pMem[CurrentOffset] = (CHAR)(AnsiBuffer[CurrentOffset] & 0x7f);
+    for (CurrentOffset = 0; CurrentOffset < BytesRead; CurrentOffset++) {
+        pMem[CurrentOffset] = (CHAR)(pMem[CurrentOffset] & 0x7f);
     }
 
-    pMem[AllocSize] = '\0';
+    pMem[BytesRead] = '\0';
     DllKernel32.pGlobalUnlock(hMem);
 
-    YoriLibFree(AnsiBuffer);
-
     //
     //  Send the buffer to the clipboard.
     //
 
-    if (!YoriLibOpenClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    if (!DllUser32.pEmptyClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    ClipFmt = DllUser32.pRegisterClipboardFormatW(_T("Rich Text Format"));
-    if (ClipFmt == 0) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not register clipboard format: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        return FALSE;
-    }
-
-    if (DllUser32.pSetClipboardData(ClipFmt, hMem) == NULL) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
-    return TRUE;
+    return ClipSetClipboardBlock(_T("Rich Text Format"), hMem);
 }
 
-#if defined(_MSC_VER) && (_MSC_VER >= 1500) && (_MSC_VER <= 1600)
-#pragma warning(pop)
-#endif
-
 /**
  Copy the contents of a file or pipe to the clipboard in text format.
 
  @param hFile Handle to the file or pipe.
 
  @param FileSize The length of the file, in bytes.  For a pipe, this value is
-        not known beforehand, and is specified as MAX_PIPE_SIZE.
+        not known beforehand, and is specified as zero.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
@@ -473,131 +486,75 @@ ClipCopyAsText(
     __in DWORD FileSize
     )
 {
+    HANDLE hAnsiMem;
     LPSTR  AnsiBuffer;
+    YORI_ALLOC_SIZE_T BytesRead;
     YORI_ALLOC_SIZE_T AllocSize;
     HANDLE hMem;
     PTCHAR pMem;
-    DWORD  BytesTransferred;
-    YORI_ALLOC_SIZE_T CurrentOffset;
-    DWORD  Err;
-    LPTSTR ErrText;
 
     //
-    //  Allocate space to copy the file or pipe contents.
+    //  Note this is not Unicode.  The text is read into one global block
+    //  and converted into the block that is given to the clipboard.
     //
 
-    if (!YoriLibIsSizeAllocatable(FileSize + 1)) {
+    if (!ClipReadToGlobalBlock(hFile, FileSize, 0, 0, &hAnsiMem, &BytesRead)) {
         return FALSE;
     }
-    AllocSize = (YORI_ALLOC_SIZE_T)(FileSize + 1);
-    AnsiBuffer = YoriLibMalloc(AllocSize);
-    if (AnsiBuffer == NULL) {
+
+    if (BytesRead == 0) {
+        GlobalFree(hAnsiMem);
+        ClipHelp();
         return FALSE;
     }
 
-    //
-    //  Note this is not Unicode.
-    //
-
-    CurrentOffset = 0;
-
-    //
-    //  Read text.
-    //
-
-    while (ReadFile(hFile, AnsiBuffer + CurrentOffset, FileSize - CurrentOffset, &BytesTransferred, NULL)) {
-        CurrentOffset = CurrentOffset + (YORI_ALLOC_SIZE_T)BytesTransferred;
-
-        //
-        //  If we're reading from the pipe and have exceeded our storage,
-        //  fail.
-        //
-
-        if (CurrentOffset == FileSize &&
-            FileSize == MAX_PIPE_SIZE &&
-            hFile == GetStdHandle(STD_INPUT_HANDLE)) {
-
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Pipe data too large for buffer.  Limit is %i bytes\n"), MAX_PIPE_SIZE);
-            return FALSE;
-        }
-
-        if (BytesTransferred == 0) {
-            break;
-        }
+    AnsiBuffer = DllKernel32.pGlobalLock(hAnsiMem);
+    if (AnsiBuffer == NULL) {
+        GlobalFree(hAnsiMem);
+        return FALSE;
     }
 
-    if (CurrentOffset == 0) {
-        YoriLibFree(AnsiBuffer);
-        ClipHelp();
+    AllocSize = YoriLibGetMultibyteInputSizeNeeded(AnsiBuffer, BytesRead);
+    if (!YoriLibIsSizeAllocatable(((YORI_MAX_UNSIGNED_T)AllocSize + 1) * sizeof(TCHAR))) {
+        DllKernel32.pGlobalUnlock(hAnsiMem);
+        GlobalFree(hAnsiMem);
         return FALSE;
     }
 
-
-    AllocSize = YoriLibGetMultibyteInputSizeNeeded(AnsiBuffer, CurrentOffset);
     hMem = GlobalAlloc(GMEM_MOVEABLE|GMEM_DDESHARE, (AllocSize + 1) * sizeof(TCHAR));
     if (hMem == NULL) {
-        YoriLibFree(AnsiBuffer);
+        DllKernel32.pGlobalUnlock(hAnsiMem);
+        GlobalFree(hAnsiMem);
         return FALSE;
     }
 
     pMem = DllKernel32.pGlobalLock(hMem);
     if (pMem == NULL) {
         GlobalFree(hMem);
-        YoriLibFree(AnsiBuffer);
+        DllKernel32.pGlobalUnlock(hAnsiMem);
+        GlobalFree(hAnsiMem);
         return FALSE;
     }
 
-    //
-    //  Analyze gets really confused here and thinks AnsiBuffer is
-    //  of size BytesTransferred (ie., it doesn't understand that
-    //  the read started partway through the buffer.)  At this point,
-    //  it is of size CurrentOffset.
-    //
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-#pragma warning(suppress: 6385)
-#endif
-    YoriLibMultibyteInput(AnsiBuffer, CurrentOffset, pMem, AllocSize);
+    YoriLibMultibyteInput(AnsiBuffer, BytesRead, pMem, AllocSize);
 
     pMem[AllocSize] = '\0';
     DllKernel32.pGlobalUnlock(hMem);
 
-    YoriLibFree(AnsiBuffer);
+    DllKernel32.pGlobalUnlock(hAnsiMem);
+    GlobalFree(hAnsiMem);
 
     //
     //  Send the buffer to the clipboard.
     //
 
-    if (!YoriLibOpenClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not open clipboard: %s\n"), ErrText);
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    if (!DllUser32.pEmptyClipboard()) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not empty clipboard: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    if (DllUser32.pSetClipboardData(CF_UNICODETEXT, hMem) == NULL) {
-        Err = GetLastError();
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("clip: could not set clipboard data: %s\n"), ErrText);
-        DllUser32.pCloseClipboard();
-        GlobalFree(hMem);
-        return FALSE;
-    }
-
-    DllUser32.pCloseClipboard();
-    GlobalFree(hMem);
-    return TRUE;
+    return ClipSetClipboardBlock(NULL, hMem);
 }
 
+#if defined(_MSC_VER) && (_MSC_VER >= 1500) && (_MSC_VER <= 1600)
+#pragma warning(pop)
+#endif
+
 /**
  Enumerate clipboard formats and find a registered format that matches a
  specified name.  If no matching registered format is found, return zero.
@@ -1182,7 +1139,7 @@ ENTRYPOINT(
             hFile = GetStdHandle(STD_OUTPUT_HANDLE);
         } else {
 
-            FileSize = MAX_PIPE_SIZE;
+            FileSize = 0;
             hFile = GetStdHandle(STD_INPUT_HANDLE);
 
             //
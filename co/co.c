@@ -41,6 +41,7 @@ typedef enum _CO_CONTROLS {
     CoCtrlMove = 6,
     CoCtrlSortLabel = 7,
     CoCtrlSortCombo = 8,
+    CoCtrlStatusLabel = 9,
 } CO_CONTROLS;
 
 /**
@@ -104,6 +105,12 @@ typedef struct _CO_FOUND_FILE {
      */
     BOOLEAN IsDirectory;
 
+    /**
+     TRUE if the object has been deleted or moved away from the directory
+     and should be removed from the list.
+     */
+    BOOLEAN Removed;
+
 } CO_FOUND_FILE, *PCO_FOUND_FILE;
 
 /**
@@ -116,6 +123,83 @@ typedef enum _CO_SORT_TYPE {
     CoSortBeyondMaximum = 3
 } CO_SORT_TYPE;
 
+/**
+ The set of file operations that can be performed in the background.
+ */
+typedef enum _CO_OPERATION_TYPE {
+    CoOperationDelete = 0,
+    CoOperationMove = 1,
+    CoOperationCopy = 2
+} CO_OPERATION_TYPE;
+
+/**
+ A single file being operated on by a background operation.
+ */
+typedef struct _CO_OPERATION_ITEM {
+
+    /**
+     The work queue linkage for this item.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The found file that this item refers to.  This remains valid for the
+     lifetime of the item because Source holds a reference on it, even if
+     the list has been repopulated.
+     */
+    PCO_FOUND_FILE FoundFile;
+
+    /**
+     The full path to the file to operate on.
+     */
+    YORI_STRING Source;
+
+    /**
+     The full path to the destination of a move or copy.
+     */
+    YORI_STRING Dest;
+
+    /**
+     The result of the operation on this file.  This is written by a worker
+     thread and is only meaningful once the operation has completed.
+     */
+    DWORD Error;
+} CO_OPERATION_ITEM, *PCO_OPERATION_ITEM;
+
+/**
+ A file operation on a set of files being performed in the background, so
+ the user can keep browsing while it executes.
+ */
+typedef struct _CO_OPERATION {
+
+    /**
+     The work queue whose worker threads perform the operation.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     The operation being performed.
+     */
+    CO_OPERATION_TYPE Type;
+
+    /**
+     The number of items in the Items array.
+     */
+    YORI_ALLOC_SIZE_T ItemCount;
+
+    /**
+     The number of items that have been processed.  Updated by worker
+     threads with interlocked operations.
+     */
+    volatile LONG ItemsCompleted;
+
+    /**
+     An array of files to operate on.  This follows the operation structure
+     in the same allocation.
+     */
+    PCO_OPERATION_ITEM Items;
+} CO_OPERATION, *PCO_OPERATION;
+
 /**
  A context that records files found and being operated on in the current
  window.
@@ -154,10 +238,21 @@ typedef struct _CO_CONTEXT {
      */
     PYORI_WIN_WINDOW_MANAGER_HANDLE WinMgr;
 
+    /**
+     Pointer to the label displaying the progress of file operations.
+     */
+    PYORI_WIN_CTRL_HANDLE StatusLabel;
+
     /**
      The current directory for the application.
      */
     YORI_STRING CurrentDirectory;
+
+    /**
+     If a file operation is executing in the background, points to the
+     operation.  NULL if no operation is in progress.
+     */
+    PCO_OPERATION Operation;
 } CO_CONTEXT, *PCO_CONTEXT;
 
 
@@ -195,6 +290,33 @@ CoFreeFileList(
     CoContext->FilesFoundCount = 0;
 }
 
+/**
+ Free a background file operation.  If the operation is still executing,
+ files that have not started are skipped, and this waits for files that
+ are being operated on to finish.
+
+ @param Operation Pointer to the operation to free.
+ */
+VOID
+CoFreeOperation(
+    __in PCO_OPERATION Operation
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (Operation->WorkQueue.Mutex != NULL) {
+        YoriLibCancelWorkQueue(&Operation->WorkQueue);
+    }
+    YoriLibCleanupWorkQueue(&Operation->WorkQueue);
+
+    for (Index = 0; Index < Operation->ItemCount; Index++) {
+        YoriLibFreeStringContents(&Operation->Items[Index].Source);
+        YoriLibFreeStringContents(&Operation->Items[Index].Dest);
+    }
+
+    YoriLibFree(Operation);
+}
+
 /**
  Free all allocations in the context.
 
@@ -205,6 +327,10 @@ CoFreeContext(
     __in PCO_CONTEXT CoContext
     )
 {
+    if (CoContext->Operation != NULL) {
+        CoFreeOperation(CoContext->Operation);
+        CoContext->Operation = NULL;
+    }
     CoFreeFileList(CoContext);
     YoriLibFreeStringContents(&CoContext->CurrentDirectory);
 }
@@ -275,12 +401,188 @@ CoFileFoundCallback(
     } else {
         FoundFile->IsDirectory = FALSE;
     }
+    FoundFile->Removed = FALSE;
 
     YoriLibAppendList(&CoContext->FilesFound, &FoundFile->ListEntry);
     CoContext->FilesFoundCount++;
     return TRUE;
 }
 
+/**
+ Compare two found files according to the sort order currently being
+ applied.
+
+ @param SortType The sort order to apply.
+
+ @param File1 Pointer to the first file to compare.
+
+ @param File2 Pointer to the second file to compare.
+
+ @return Negative if File1 should be displayed before File2, positive if
+         File2 should be displayed before File1, or zero if they are
+         equal for the purpose of this sort.
+ */
+int
+CoCompareFoundFiles(
+    __in CO_SORT_TYPE SortType,
+    __in PCO_FOUND_FILE File1,
+    __in PCO_FOUND_FILE File2
+    )
+{
+    if (SortType == CoSortBySize) {
+        if (File1->FileSize.QuadPart < File2->FileSize.QuadPart) {
+            return -1;
+        } else if (File1->FileSize.QuadPart > File2->FileSize.QuadPart) {
+            return 1;
+        }
+        return 0;
+    } else if (SortType == CoSortByDate) {
+        if (File1->WriteTime.QuadPart < File2->WriteTime.QuadPart) {
+            return -1;
+        } else if (File1->WriteTime.QuadPart > File2->WriteTime.QuadPart) {
+            return 1;
+        }
+        return 0;
+    }
+
+    return YoriLibCompareStringInsensitive(&File1->DisplayName, &File2->DisplayName);
+}
+
+/**
+ Sort the flat array of found files based on the selected sort criteria.
+ This is a bottom up merge sort, so large directories are sorted in
+ n log n time and files that compare equal retain their enumeration order.
+
+ @param CoContext Pointer to the context containing the array to sort.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CoSortFileArray(
+    __in PCO_CONTEXT CoContext
+    )
+{
+    PCO_FOUND_FILE* Source;
+    PCO_FOUND_FILE* Target;
+    PCO_FOUND_FILE* Swap;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_ALLOC_SIZE_T Width;
+    YORI_ALLOC_SIZE_T Start;
+    YORI_ALLOC_SIZE_T Middle;
+    YORI_ALLOC_SIZE_T End;
+    YORI_ALLOC_SIZE_T Left;
+    YORI_ALLOC_SIZE_T Right;
+    YORI_ALLOC_SIZE_T Index;
+
+    Count = CoContext->FilesFoundCount;
+    if (Count <= 1) {
+        return TRUE;
+    }
+
+    Target = YoriLibMalloc(sizeof(PCO_FOUND_FILE) * Count);
+    if (Target == NULL) {
+        return FALSE;
+    }
+
+    Source = CoContext->FileArray;
+
+    for (Width = 1; Width < Count; Width = Width * 2) {
+        for (Start = 0; Start < Count; Start = Start + 2 * Width) {
+            Middle = Start + Width;
+            if (Middle > Count) {
+                Middle = Count;
+            }
+            End = Middle + Width;
+            if (End > Count) {
+                End = Count;
+            }
+
+            Left = Start;
+            Right = Middle;
+            for (Index = Start; Index < End; Index++) {
+                if (Left < Middle &&
+                    (Right >= End ||
+                     CoCompareFoundFiles(CoContext->SortType, Source[Left], Source[Right]) <= 0)) {
+
+                    Target[Index] = Source[Left];
+                    Left++;
+                } else {
+                    Target[Index] = Source[Right];
+                    Right++;
+                }
+            }
+        }
+
+        Swap = Source;
+        Source = Target;
+        Target = Swap;
+    }
+
+    //
+    //  Source now refers to the sorted array.  Keep it, and free the other
+    //  one.
+    //
+
+    CoContext->FileArray = Source;
+    YoriLibFree(Target);
+    return TRUE;
+}
+
+/**
+ Populate the UI list from the flat array of found files, and make the
+ specified item active.
+
+ @param CoContext Pointer to the context containing found files.
+
+ @param ActiveIndex Specifies the index of the item to make active.  If
+        this is beyond the end of the list, the last item is made active.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CoDisplayFileArray(
+    __in PCO_CONTEXT CoContext,
+    __in YORI_ALLOC_SIZE_T ActiveIndex
+    )
+{
+    PYORI_STRING DisplayArray;
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriWinListClearAllItems(CoContext->List);
+
+    if (CoContext->FilesFoundCount == 0) {
+        return TRUE;
+    }
+
+    DisplayArray = YoriLibMalloc(sizeof(YORI_STRING) * CoContext->FilesFoundCount);
+    if (DisplayArray == NULL) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
+        memcpy(&DisplayArray[Index], &CoContext->FileArray[Index]->DisplayName, sizeof(YORI_STRING));
+    }
+
+    if (!YoriWinListAddItems(CoContext->List, DisplayArray, CoContext->FilesFoundCount)) {
+        YoriLibFree(DisplayArray);
+        return FALSE;
+    }
+
+    YoriLibFree(DisplayArray);
+
+    if (ActiveIndex >= CoContext->FilesFoundCount) {
+        ActiveIndex = CoContext->FilesFoundCount - 1;
+    }
+
+    if (ActiveIndex > 0) {
+        YoriWinListSetActiveOption(CoContext->List, ActiveIndex);
+    }
+
+    return TRUE;
+}
+
 /**
  Populate in memory structures and the UI list with found files.
 
@@ -295,14 +597,9 @@ CoPopulateList(
     )
 {
     YORI_STRING FileSpec;
-    PYORI_STRING DisplayArray;
     DWORD Index;
-    DWORD SubIndex;
-    DWORD BestIndex;
     PYORI_LIST_ENTRY ListEntry;
     PCO_FOUND_FILE FoundFile;
-    PCO_FOUND_FILE CompareFile;
-    PCO_FOUND_FILE BestFile;
 
     YoriLibInitEmptyString(&FileSpec);
     YoriLibYPrintf(&FileSpec, _T("%y\\*"), &CoContext->CurrentDirectory);
@@ -318,14 +615,8 @@ CoPopulateList(
         return TRUE;
     }
 
-    DisplayArray = YoriLibMalloc(sizeof(YORI_STRING) * CoContext->FilesFoundCount);
-    if (DisplayArray == NULL) {
-        return FALSE;
-    }
-
     CoContext->FileArray = YoriLibMalloc(sizeof(PCO_FOUND_FILE) * CoContext->FilesFoundCount);
     if (CoContext->FileArray == NULL) {
-        YoriLibDereference(DisplayArray);
         return FALSE;
     }
 
@@ -340,65 +631,59 @@ CoPopulateList(
         CoContext->FileArray[Index] = FoundFile;
     }
 
-    //
-    //  Sort the array based on the selected sort criteria
-    //
+    if (!CoSortFileArray(CoContext)) {
+        return FALSE;
+    }
 
-    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
-        FoundFile = CoContext->FileArray[Index];
-        BestFile = FoundFile;
-        BestIndex = Index;
-        for (SubIndex = Index + 1; SubIndex < CoContext->FilesFoundCount; SubIndex++) {
-            CompareFile = CoContext->FileArray[SubIndex];
-            if (CoContext->SortType == CoSortByName) {
-                if (YoriLibCompareStringInsensitive(&CompareFile->DisplayName, &BestFile->DisplayName) < 0) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            } else if (CoContext->SortType == CoSortBySize) {
-                if (CompareFile->FileSize.QuadPart < BestFile->FileSize.QuadPart) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            } else if (CoContext->SortType == CoSortByDate) {
-                if (CompareFile->WriteTime.QuadPart < BestFile->WriteTime.QuadPart) {
-                    BestFile = CompareFile;
-                    BestIndex = SubIndex;
-                }
-            }
-        }
+    return CoDisplayFileArray(CoContext, 0);
+}
 
-        if (BestIndex != Index) {
-            CoContext->FileArray[BestIndex] = CoContext->FileArray[Index];
-            CoContext->FileArray[Index] = BestFile;
-        }
-    }
+/**
+ Clear the contents of the list and start over.  This is used when the
+ directory being displayed changes, so it enumerates the directory again.
 
-    //
-    //  Generate the display array string based on the result of the sort
-    //
+ @param CoContext Pointer to context about files to display and the list to
+        display them in.
 
-    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
-        memcpy(&DisplayArray[Index], &CoContext->FileArray[Index]->DisplayName, sizeof(YORI_STRING));
-    }
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+CoRepopulateList(
+    __in PCO_CONTEXT CoContext
+    )
+{
+    CoFreeFileList(CoContext);
+    YoriWinListClearAllItems(CoContext->List);
+    return CoPopulateList(CoContext);
+}
 
-    //
-    //  Populate the list with the result
-    //
+/**
+ Re-sort the files that have already been found and redisplay them,
+ without enumerating the directory again.
 
-    if (!YoriWinListAddItems(CoContext->List, DisplayArray, CoContext->FilesFoundCount)) {
-        YoriLibDereference(DisplayArray);
+ @param CoContext Pointer to context about files to display and the list to
+        display them in.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CoResortList(
+    __in PCO_CONTEXT CoContext
+    )
+{
+    if (!CoSortFileArray(CoContext)) {
         return FALSE;
     }
 
-    YoriLibFree(DisplayArray);
-    return TRUE;
+    return CoDisplayFileArray(CoContext, 0);
 }
 
 /**
- Clear the contents of the list and start over.  This isn't a great user
- experience because of how it affects the view region.  We'll want something
- better.
+ Remove files that have been deleted or moved away from the list, without
+ enumerating the directory again.  The remaining files retain their order,
+ and the item nearest to the previously active item remains active.
 
  @param CoContext Pointer to context about files to display and the list to
         display them in.
@@ -406,14 +691,42 @@ CoPopulateList(
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
-BOOL
-CoRepopulateList(
+BOOLEAN
+CoRemoveFilesFromList(
     __in PCO_CONTEXT CoContext
     )
 {
-    CoFreeFileList(CoContext);
-    YoriWinListClearAllItems(CoContext->List);
-    return CoPopulateList(CoContext);
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T NewCount;
+    YORI_ALLOC_SIZE_T ActiveIndex;
+    YORI_ALLOC_SIZE_T NewActiveIndex;
+    PCO_FOUND_FILE FoundFile;
+
+    if (!YoriWinListGetActiveOption(CoContext->List, &ActiveIndex)) {
+        ActiveIndex = 0;
+    }
+
+    NewCount = 0;
+    NewActiveIndex = 0;
+    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
+        FoundFile = CoContext->FileArray[Index];
+        if (Index == ActiveIndex) {
+            NewActiveIndex = NewCount;
+        }
+
+        if (FoundFile->Removed) {
+            YoriLibRemoveListItem(&FoundFile->ListEntry);
+            YoriLibFreeStringContents(&FoundFile->DisplayName);
+            YoriLibFreeStringContents(&FoundFile->FullFilePath);
+            YoriLibDereference(FoundFile);
+        } else {
+            CoContext->FileArray[NewCount] = FoundFile;
+            NewCount++;
+        }
+    }
+
+    CoContext->FilesFoundCount = NewCount;
+    return CoDisplayFileArray(CoContext, NewActiveIndex);
 }
 
 /**
@@ -684,50 +997,320 @@ CoChdirButtonClicked(
 }
 
 /**
- A callback invoked when the delete button is clicked.
+ The interval in milliseconds at which the progress of a background file
+ operation is checked.
+ */
+#define CO_OPERATION_POLL_INTERVAL (100)
 
- @param Ctrl Pointer to the button that was clicked.
+/**
+ Perform a file operation on a single file.  This is invoked on a worker
+ thread.  Items are owned by the operation, so they are not freed here.
+
+ @param Context Pointer to the operation.
+
+ @param Item Pointer to the work item within the file to operate on.
+
+ @param Cancelled TRUE if the operation has been cancelled, so the file
+        should not be operated on.
  */
 VOID
-CoDeleteButtonClicked(
-    __in PYORI_WIN_CTRL_HANDLE Ctrl
+CoOperationWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PCO_OPERATION Operation;
+    PCO_OPERATION_ITEM OperationItem;
+
+    Operation = (PCO_OPERATION)Context;
+    OperationItem = CONTAINING_RECORD(Item, CO_OPERATION_ITEM, WorkItem);
+
+    if (Cancelled) {
+        OperationItem->Error = ERROR_CANCELLED;
+    } else if (Operation->Type == CoOperationDelete) {
+        OperationItem->Error = ERROR_SUCCESS;
+        if (!DeleteFile(OperationItem->Source.StartOfString)) {
+            OperationItem->Error = GetLastError();
+        }
+    } else if (Operation->Type == CoOperationMove) {
+        OperationItem->Error = YoriLibMoveFile(&OperationItem->Source, &OperationItem->Dest, TRUE, FALSE);
+    } else {
+        OperationItem->Error = YoriLibCopyFile(&OperationItem->Source, &OperationItem->Dest);
+    }
+
+    InterlockedIncrement(&Operation->ItemsCompleted);
+}
+
+/**
+ Display the progress of any background file operation in the status
+ label.
+
+ @param CoContext Pointer to the program context.
+ */
+VOID
+CoUpdateOperationStatus(
+    __in PCO_CONTEXT CoContext
+    )
+{
+    YORI_STRING Status;
+    PCO_OPERATION Operation;
+    LPCTSTR Verb;
+
+    Operation = CoContext->Operation;
+    YoriLibInitEmptyString(&Status);
+    if (Operation != NULL) {
+        if (Operation->Type == CoOperationDelete) {
+            Verb = _T("Delete");
+        } else if (Operation->Type == CoOperationMove) {
+            Verb = _T("Move");
+        } else {
+            Verb = _T("Copy");
+        }
+
+        YoriLibYPrintf(&Status, _T("%s %i/%i"), Verb, Operation->ItemsCompleted, Operation->ItemCount);
+    }
+
+    YoriWinLabelSetCaption(CoContext->StatusLabel, &Status);
+    YoriLibFreeStringContents(&Status);
+}
+
+/**
+ Complete a background file operation once every file has been processed.
+ Files that were deleted or moved away are removed from the list, and the
+ first error encountered, if any, is displayed.
+
+ @param CoContext Pointer to the program context.
+ */
+VOID
+CoCompleteOperation(
+    __in PCO_CONTEXT CoContext
     )
 {
+    PCO_OPERATION Operation;
+    PCO_OPERATION_ITEM Item;
+    PCO_OPERATION_ITEM FailedItem;
     YORI_ALLOC_SIZE_T Index;
-    BOOLEAN ListChanged = FALSE;
+    BOOLEAN ListChanged;
     YORI_STRING Buttons[1];
     YORI_STRING Title;
     YORI_STRING Label;
+    LPTSTR ErrText;
 
-    UNREFERENCED_PARAMETER(Ctrl);
+    Operation = CoContext->Operation;
+    CoContext->Operation = NULL;
 
-    if (!CoIsFileSelected(&CoContext)) {
-        return;
+    YoriWinSetPeriodicNotifyCallback(YoriWinGetControlParent(CoContext->List), 0, NULL);
+    CoUpdateOperationStatus(CoContext);
+
+    YoriLibCleanupWorkQueue(&Operation->WorkQueue);
+
+    ListChanged = FALSE;
+    FailedItem = NULL;
+    for (Index = 0; Index < Operation->ItemCount; Index++) {
+        Item = &Operation->Items[Index];
+        if (Item->Error == ERROR_SUCCESS) {
+            if (Operation->Type != CoOperationCopy) {
+                Item->FoundFile->Removed = TRUE;
+                ListChanged = TRUE;
+            }
+        } else if (FailedItem == NULL) {
+            FailedItem = Item;
+        }
     }
 
-    for (Index = 0; Index < CoContext.FilesFoundCount; Index++) {
-        if (YoriWinListIsOptionSelected(CoContext.List, Index)) {
-            if (!DeleteFile(CoContext.FileArray[Index]->FullFilePath.StartOfString)) {
-                DWORD LastError;
-                LPTSTR ErrText;
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibConstantString(&Buttons[0], _T("&Ok"));
-                YoriLibConstantString(&Title, _T("Error"));
-                YoriLibInitEmptyString(&Label);
-                YoriLibYPrintf(&Label, _T("Could not delete file \"%y\": %s"), &CoContext.FileArray[Index]->FullFilePath, ErrText);
+    if (ListChanged) {
+        CoRemoveFilesFromList(CoContext);
+    }
+
+    if (FailedItem != NULL) {
+        ErrText = YoriLibGetWinErrorText(FailedItem->Error);
+        if (ErrText != NULL) {
+            YoriLibConstantString(&Buttons[0], _T("&Ok"));
+            YoriLibConstantString(&Title, _T("Error"));
+            YoriLibInitEmptyString(&Label);
+            if (Operation->Type == CoOperationDelete) {
+                YoriLibYPrintf(&Label,
+                               _T("Could not delete file \"%y\": %s"),
+                               &FailedItem->Source,
+                               ErrText);
+            } else {
+                YoriLibYPrintf(&Label,
+                               _T("Could not %s file from \"%y\" to \"%y\": %s"),
+                               Operation->Type == CoOperationMove?_T("move"):_T("copy"),
+                               &FailedItem->Source,
+                               &FailedItem->Dest,
+                               ErrText);
+            }
+            if (Label.LengthInChars > 0) {
                 CoTrimTrailingNewlines(&Label);
-                YoriLibFreeWinErrorText(ErrText);
-                YoriDlgMessageBox(CoContext.WinMgr, &Title, &Label, 1, Buttons, 0, 0);
+                YoriDlgMessageBox(CoContext->WinMgr, &Title, &Label, 1, Buttons, 0, 0);
                 YoriLibFreeStringContents(&Label);
-                break;
             }
-            ListChanged = TRUE;
+            YoriLibFreeWinErrorText(ErrText);
         }
     }
-    if (ListChanged) {
-        CoRepopulateList(&CoContext);
+
+    CoFreeOperation(Operation);
+}
+
+/**
+ A callback invoked periodically while a background file operation is
+ executing, to display its progress and complete it once every file has
+ been processed.
+
+ @param WindowHandle Handle to the main window.
+ */
+VOID
+CoOperationPeriodicCallback(
+    __in PYORI_WIN_CTRL_HANDLE WindowHandle
+    )
+{
+    PCO_OPERATION Operation;
+
+    UNREFERENCED_PARAMETER(WindowHandle);
+
+    Operation = CoContext.Operation;
+    if (Operation == NULL) {
+        return;
     }
+
+    if ((YORI_ALLOC_SIZE_T)Operation->ItemsCompleted < Operation->ItemCount) {
+        CoUpdateOperationStatus(&CoContext);
+        return;
+    }
+
+    CoCompleteOperation(&CoContext);
+}
+
+/**
+ Start a file operation on each selected file.  The operation is performed
+ by worker threads, so the user can keep browsing while it executes, and
+ its progress is displayed in the status label.
+
+ @param CoContext Pointer to the program context.
+
+ @param Type The operation to perform.
+
+ @param TargetDirectory For a move or copy, the directory to move or copy
+        files into.
+
+ @return TRUE to indicate the operation was started, FALSE to indicate it
+         was not.
+ */
+__success(return)
+BOOLEAN
+CoStartOperation(
+    __in PCO_CONTEXT CoContext,
+    __in CO_OPERATION_TYPE Type,
+    __in_opt PYORI_STRING TargetDirectory
+    )
+{
+    PCO_OPERATION Operation;
+    PCO_OPERATION_ITEM Item;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T ItemCount;
+    YORI_STRING Buttons[1];
+    YORI_STRING Title;
+    YORI_STRING Label;
+
+    if (CoContext->Operation != NULL) {
+        YoriLibConstantString(&Buttons[0], _T("&Ok"));
+        YoriLibConstantString(&Title, _T("Error"));
+        YoriLibConstantString(&Label, _T("A file operation is already in progress."));
+        YoriDlgMessageBox(CoContext->WinMgr, &Title, &Label, 1, Buttons, 0, 0);
+        return FALSE;
+    }
+
+    ItemCount = 0;
+    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
+        if (YoriWinListIsOptionSelected(CoContext->List, Index)) {
+            ItemCount++;
+        }
+    }
+
+    if (ItemCount == 0) {
+        return FALSE;
+    }
+
+    Operation = YoriLibMalloc(sizeof(CO_OPERATION) + ItemCount * sizeof(CO_OPERATION_ITEM));
+    if (Operation == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Operation, sizeof(CO_OPERATION) + ItemCount * sizeof(CO_OPERATION_ITEM));
+    Operation->Type = Type;
+    Operation->Items = (PCO_OPERATION_ITEM)(Operation + 1);
+
+    for (Index = 0; Index < CoContext->FilesFoundCount; Index++) {
+        if (!YoriWinListIsOptionSelected(CoContext->List, Index)) {
+            continue;
+        }
+
+        Item = &Operation->Items[Operation->ItemCount];
+        Item->FoundFile = CoContext->FileArray[Index];
+        YoriLibCloneString(&Item->Source, &Item->FoundFile->FullFilePath);
+        Operation->ItemCount++;
+
+        if (TargetDirectory != NULL &&
+            YoriLibYPrintf(&Item->Dest, _T("%y\\%y"), TargetDirectory, &Item->FoundFile->DisplayName) < 0) {
+
+            CoFreeOperation(Operation);
+            return FALSE;
+        }
+    }
+
+    //
+    //  Allow every item to be queued at once, so queueing never waits for
+    //  the worker threads.
+    //
+
+    if (!YoriLibInitializeWorkQueue(&Operation->WorkQueue, 0, ItemCount, CoOperationWorkItem, Operation)) {
+        CoFreeOperation(Operation);
+        return FALSE;
+    }
+
+    CoContext->Operation = Operation;
+
+    //
+    //  If an item cannot be queued, because no worker thread could be
+    //  created, perform it now.  The operation still completes from the
+    //  periodic callback.
+    //
+
+    for (Index = 0; Index < ItemCount; Index++) {
+        Item = &Operation->Items[Index];
+        if (!YoriLibQueueWorkItem(&Operation->WorkQueue, &Item->WorkItem, FALSE)) {
+            CoOperationWorkItem(Operation, &Item->WorkItem, FALSE);
+        }
+    }
+
+    if (!YoriWinSetPeriodicNotifyCallback(YoriWinGetControlParent(CoContext->List), CO_OPERATION_POLL_INTERVAL, CoOperationPeriodicCallback)) {
+        CoCompleteOperation(CoContext);
+        return TRUE;
+    }
+
+    CoUpdateOperationStatus(CoContext);
+    return TRUE;
+}
+
+/**
+ A callback invoked when the delete button is clicked.
+
+ @param Ctrl Pointer to the button that was clicked.
+ */
+VOID
+CoDeleteButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    UNREFERENCED_PARAMETER(Ctrl);
+
+    if (!CoIsFileSelected(&CoContext)) {
+        return;
+    }
+
+    CoStartOperation(&CoContext, CoOperationDelete, NULL);
 }
 
 /**
@@ -746,13 +1329,6 @@ CoMoveButtonClicked(
     )
 {
     YORI_STRING FullDir;
-    YORI_STRING FullDest;
-    YORI_ALLOC_SIZE_T Index;
-    DWORD LastError;
-    BOOLEAN ListChanged = FALSE;
-    YORI_STRING Buttons[1];
-    YORI_STRING Title;
-    YORI_STRING Label;
 
     UNREFERENCED_PARAMETER(ClickedCtrl);
 
@@ -764,55 +1340,8 @@ CoMoveButtonClicked(
         return;
     }
 
-    if (!YoriLibAllocateString(&FullDest, FullDir.LengthAllocated + 256)) {
-        YoriLibFreeStringContents(&FullDir);
-        return;
-    }
-
-    ListChanged = FALSE;
-    for (Index = 0; Index < CoContext.FilesFoundCount; Index++) {
-        if (YoriWinListIsOptionSelected(CoContext.List, Index)) {
-
-            FullDest.LengthInChars =
-                YoriLibSPrintfS(FullDest.StartOfString,
-                                FullDest.LengthAllocated,
-                                _T("%y\\%y"),
-                                &FullDir,
-                                &CoContext.FileArray[Index]->DisplayName);
-
-            LastError = YoriLibMoveFile(&CoContext.FileArray[Index]->FullFilePath, &FullDest, TRUE, FALSE);
-            if (LastError != ERROR_SUCCESS) {
-                LPTSTR ErrText;
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                if (ErrText != NULL) {
-                    YoriLibConstantString(&Buttons[0], _T("&Ok"));
-                    YoriLibConstantString(&Title, _T("Error"));
-                    YoriLibInitEmptyString(&Label);
-                    YoriLibYPrintf(&Label,
-                                   _T("Could not move file from \"%y\" to \"%y\": %s"),
-                                   &CoContext.FileArray[Index]->FullFilePath,
-                                   &FullDest,
-                                   ErrText);
-                    if (Label.LengthInChars > 0) {
-                        CoTrimTrailingNewlines(&Label);
-                        YoriDlgMessageBox(CoContext.WinMgr, &Title, &Label, 1, Buttons, 0, 0);
-                        YoriLibFreeStringContents(&Label);
-                    }
-                    YoriLibFreeWinErrorText(ErrText);
-                }
-                break;
-            }
-            ListChanged = TRUE;
-        }
-    }
-
-    YoriLibFreeStringContents(&FullDest);
+    CoStartOperation(&CoContext, CoOperationMove, &FullDir);
     YoriLibFreeStringContents(&FullDir);
-
-    if (ListChanged) {
-        CoRepopulateList(&CoContext);
-    }
 }
 
 /**
@@ -826,13 +1355,6 @@ CoCopyButtonClicked(
     )
 {
     YORI_STRING FullDir;
-    YORI_STRING FullDest;
-    YORI_ALLOC_SIZE_T Index;
-    DWORD LastError;
-    BOOLEAN ListChanged = FALSE;
-    YORI_STRING Buttons[1];
-    YORI_STRING Title;
-    YORI_STRING Label;
 
     UNREFERENCED_PARAMETER(ClickedCtrl);
 
@@ -844,53 +1366,8 @@ CoCopyButtonClicked(
         return;
     }
 
-    if (!YoriLibAllocateString(&FullDest, FullDir.LengthAllocated + 256)) {
-        YoriLibFreeStringContents(&FullDir);
-        return;
-    }
-
-    ListChanged = FALSE;
-    for (Index = 0; Index < CoContext.FilesFoundCount; Index++) {
-        if (YoriWinListIsOptionSelected(CoContext.List, Index)) {
-            FullDest.LengthInChars =
-                YoriLibSPrintfS(FullDest.StartOfString,
-                                FullDest.LengthAllocated,
-                                _T("%y\\%y"),
-                                &FullDir,
-                                &CoContext.FileArray[Index]->DisplayName);
-
-            LastError = YoriLibCopyFile(&CoContext.FileArray[Index]->FullFilePath, &FullDest);
-            if (LastError != ERROR_SUCCESS) {
-                LPTSTR ErrText;
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                if (ErrText != NULL) {
-                    YoriLibConstantString(&Buttons[0], _T("&Ok"));
-                    YoriLibConstantString(&Title, _T("Error"));
-                    YoriLibInitEmptyString(&Label);
-                    YoriLibYPrintf(&Label,
-                                   _T("Could not copy file from \"%y\" to \"%y\": %s"),
-                                   &CoContext.FileArray[Index]->FullFilePath,
-                                   &FullDest,
-                                   ErrText);
-                    if (Label.LengthInChars > 0) {
-                        CoTrimTrailingNewlines(&Label);
-                        YoriDlgMessageBox(CoContext.WinMgr, &Title, &Label, 1, Buttons, 0, 0);
-                        YoriLibFreeStringContents(&Label);
-                    }
-                    YoriLibFreeWinErrorText(ErrText);
-                }
-                break;
-            }
-        }
-    }
-
-    YoriLibFreeStringContents(&FullDest);
+    CoStartOperation(&CoContext, CoOperationCopy, &FullDir);
     YoriLibFreeStringContents(&FullDir);
-
-    if (ListChanged) {
-        CoRepopulateList(&CoContext);
-    }
 }
 
 /**
@@ -909,7 +1386,7 @@ CoSortSelected(
     if (YoriWinComboGetActiveOption(ClickedCtrl, &ActiveIndex)) {
         if (ActiveIndex < CoSortBeyondMaximum && ActiveIndex != (YORI_ALLOC_SIZE_T)CoContext.SortType) {
             CoContext.SortType = ActiveIndex;
-            CoRepopulateList(&CoContext);
+            CoResortList(&CoContext);
         }
     }
 }
@@ -957,6 +1434,9 @@ CoSortSelected(
 
  @param SortComboRect On completion, updated to contain the rect describing
         the sort combo pull down in window client coordinates.
+
+ @param StatusLabelRect On completion, updated to contain the rect
+        describing the status label in window client coordinates.
  */
 VOID
 CoGetControlRectsFromWindowManagerSize(
@@ -969,7 +1449,8 @@ CoGetControlRectsFromWindowManagerSize(
     __out PSMALL_RECT MoveButtonRect,
     __out PSMALL_RECT CopyButtonRect,
     __out PSMALL_RECT SortLabelRect,
-    __out PSMALL_RECT SortComboRect
+    __out PSMALL_RECT SortComboRect,
+    __out PSMALL_RECT StatusLabelRect
     )
 {
     COORD ClientSize;
@@ -1038,6 +1519,11 @@ CoGetControlRectsFromWindowManagerSize(
     SortComboRect->Right = SortLabelRect->Right;
     SortComboRect->Top = (SHORT)(SortLabelRect->Bottom + 1);
     SortComboRect->Bottom = SortComboRect->Top;
+
+    StatusLabelRect->Left = SortLabelRect->Left;
+    StatusLabelRect->Right = SortLabelRect->Right;
+    StatusLabelRect->Top = (SHORT)(SortComboRect->Bottom + 1);
+    StatusLabelRect->Bottom = StatusLabelRect->Top;
 }
 
 /**
@@ -1069,6 +1555,7 @@ CoResizeWindowManager(
     SMALL_RECT CopyButtonRect;
     SMALL_RECT SortLabelRect;
     SMALL_RECT SortComboRect;
+    SMALL_RECT StatusLabelRect;
     PYORI_WIN_CTRL_HANDLE Ctrl;
 
     UNREFERENCED_PARAMETER(OldPosition);
@@ -1091,7 +1578,8 @@ CoResizeWindowManager(
                                            &MoveButtonRect,
                                            &CopyButtonRect,
                                            &SortLabelRect,
-                                           &SortComboRect);
+                                           &SortComboRect,
+                                           &StatusLabelRect);
 
     Rect.Left = (SHORT)((NewSize.X - WindowSize.X) / 2);
     Rect.Top = (SHORT)((NewSize.Y - WindowSize.Y) / 2);
@@ -1137,6 +1625,10 @@ CoResizeWindowManager(
     Ctrl = YoriWinFindControlById(WindowHandle, CoCtrlSortCombo);
     ASSERT(Ctrl != NULL);
     YoriWinComboReposition(Ctrl, &SortComboRect);
+
+    Ctrl = YoriWinFindControlById(WindowHandle, CoCtrlStatusLabel);
+    ASSERT(Ctrl != NULL);
+    YoriWinLabelReposition(Ctrl, &StatusLabelRect);
 }
 
 
@@ -1162,6 +1654,7 @@ CoCreateSynchronousMenu(VOID)
     SMALL_RECT CopyButtonRect;
     SMALL_RECT SortLabelRect;
     SMALL_RECT SortComboRect;
+    SMALL_RECT StatusLabelRect;
     COORD WindowSize;
     YORI_STRING Title;
     SMALL_RECT ButtonArea;
@@ -1189,7 +1682,8 @@ CoCreateSynchronousMenu(VOID)
                                            &MoveButtonRect,
                                            &CopyButtonRect,
                                            &SortLabelRect,
-                                           &SortComboRect);
+                                           &SortComboRect,
+                                           &StatusLabelRect);
 
     YoriLibConstantString(&Title, _T("Co"));
 
@@ -1314,9 +1808,20 @@ CoCreateSynchronousMenu(VOID)
     YoriWinComboAddItems(Ctrl, SortStrings, CoSortBeyondMaximum);
     YoriWinComboSetActiveOption(Ctrl, CoContext.SortType);
 
+    YoriLibConstantString(&Caption, _T(""));
+    Ctrl = YoriWinLabelCreate(Parent, &StatusLabelRect, &Caption, 0);
+    if (Ctrl == NULL) {
+        YoriWinDestroyWindow(Parent);
+        YoriWinCloseWindowManager(WinMgr);
+        return FALSE;
+    }
+    YoriWinSetControlId(Ctrl, CoCtrlStatusLabel);
+    CoContext.StatusLabel = Ctrl;
+
     YoriLibInitializeListHead(&CoContext.FilesFound);
     CoContext.FilesFoundCount = 0;
     CoContext.FileArray = NULL;
+    CoContext.Operation = NULL;
     CoContext.List = List;
     CoContext.WinMgr = WinMgr;
     if (!YoriLibGetCurrentDirectory(&CoContext.CurrentDirectory)) {
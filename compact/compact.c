@@ -35,11 +35,15 @@ CHAR strCompactHelpText[] =
         "\n"
         "Compress or decompress one or more files.\n"
         "\n"
-        "COMPACT [-license] [-b] [-c:algorithm | -u] [-s] [<file>...]\n"
+        "COMPACT [-license] [-b] [-c:algorithm | -u] [-j <num>] [-m <size>] [-p] [-s]\n"
+        "        [-v] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Compress files with the specified algorithm.  Options are:\n"
         "                    lzx, ntfs, xp4k, xp8k, xp16k\n"
+        "   -j <num>       Compress files on the specified number of threads\n"
+        "   -m <size>      Do not compress files smaller than size, default 10Kb\n"
+        "   -p             Display progress and throughput\n"
         "   -s             Process files from all subdirectories\n"
         "   -u             Decompress files\n"
         "   -v             Verbose output\n";
@@ -81,11 +85,28 @@ typedef struct _COMPACT_CONTEXT {
      */
     BOOL Verbose;
 
+    /**
+     TRUE if progress and throughput should be displayed periodically and
+     once all files have been processed.
+     */
+    BOOL ShowProgress;
+
+    /**
+     TRUE if the volume containing the current argument has been checked for
+     WOF support.  This is reset for each argument.
+     */
+    BOOL WofChecked;
+
     /**
      Records the total number of files processed.
      */
     LONGLONG FilesFound;
 
+    /**
+     The system time, in 100ns units, when progress was last displayed.
+     */
+    LONGLONG LastProgressTime;
+
     /**
      Context for the background thread pool that performs compression tasks.
      */
@@ -93,6 +114,84 @@ typedef struct _COMPACT_CONTEXT {
 
 } COMPACT_CONTEXT, *PCOMPACT_CONTEXT;
 
+/**
+ The interval between progress updates, in 100ns units.
+ */
+#define COMPACT_PROGRESS_INTERVAL (5 * 1000 * 1000 * 10)
+
+/**
+ Display the progress of compressing files, including the throughput
+ achieved since compression started.
+
+ @param CompactContext Pointer to the compact context.
+
+ @param Progress Pointer to the progress counters to display.
+ */
+VOID
+CompactDisplayProgress(
+    __in PCOMPACT_CONTEXT CompactContext,
+    __in PYORILIB_COMPRESS_PROGRESS Progress
+    )
+{
+    LONGLONG Elapsed;
+    LARGE_INTEGER Size;
+    YORI_STRING ProcessedString;
+    YORI_STRING StoredString;
+    YORI_STRING RateString;
+    TCHAR ProcessedBuffer[10];
+    TCHAR StoredBuffer[10];
+    TCHAR RateBuffer[10];
+
+    YoriLibInitEmptyString(&ProcessedString);
+    ProcessedString.StartOfString = ProcessedBuffer;
+    ProcessedString.LengthAllocated = sizeof(ProcessedBuffer)/sizeof(ProcessedBuffer[0]);
+
+    YoriLibInitEmptyString(&StoredString);
+    StoredString.StartOfString = StoredBuffer;
+    StoredString.LengthAllocated = sizeof(StoredBuffer)/sizeof(StoredBuffer[0]);
+
+    YoriLibInitEmptyString(&RateString);
+    RateString.StartOfString = RateBuffer;
+    RateString.LengthAllocated = sizeof(RateBuffer)/sizeof(RateBuffer[0]);
+
+    Size.QuadPart = Progress->BytesProcessed;
+    YoriLibFileSizeToString(&ProcessedString, &Size);
+
+    Size.QuadPart = Progress->BytesStored;
+    YoriLibFileSizeToString(&StoredString, &Size);
+
+    //
+    //  Time is measured in 100ns units, so scale to milliseconds and from
+    //  there to bytes per second.  Avoid a divide by zero if this is called
+    //  immediately.
+    //
+
+    Elapsed = (YoriLibGetSystemTimeAsInteger() - Progress->StartTime) / (10 * 1000);
+    if (Elapsed <= 0) {
+        Elapsed = 1;
+    }
+    Size.QuadPart = (LONGLONG)(Progress->BytesProcessed * 1000 / Elapsed);
+    YoriLibFileSizeToString(&RateString, &Size);
+
+    if (CompactContext->Compress) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%lli processed, %lli skipped, %lli failed, %y stored in %y, %y/s\n"),
+                      Progress->FilesProcessed,
+                      Progress->FilesSkipped,
+                      Progress->FilesFailed,
+                      &ProcessedString,
+                      &StoredString,
+                      &RateString);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%lli processed, %lli failed, %y, %y/s\n"),
+                      Progress->FilesProcessed,
+                      Progress->FilesFailed,
+                      &ProcessedString,
+                      &RateString);
+    }
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -125,6 +224,22 @@ CompactFileFoundCallback(
 
     IncludeFile = TRUE;
 
+    //
+    //  If compressing with WOF, check that the volume supports it before
+    //  queueing every file from the argument for a doomed attempt.
+    //
+
+    if (CompactContext->Compress &&
+        CompactContext->CompressContext.CompressionAlgorithm.WofAlgorithm != 0 &&
+        !CompactContext->WofChecked) {
+
+        CompactContext->WofChecked = TRUE;
+        if (YoriLibGetWofVersionAvailable(FilePath) == 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("compact: file compression is not supported on the volume containing %y\n"), FilePath);
+            return FALSE;
+        }
+    }
+
     if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 &&
         CompactContext->Compress &&
         CompactContext->CompressContext.CompressionAlgorithm.NtfsAlgorithm == 0) {
@@ -147,6 +262,18 @@ CompactFileFoundCallback(
         CompactContext->FilesFound++;
     }
 
+    if (CompactContext->ShowProgress) {
+        LONGLONG Now;
+        YORILIB_COMPRESS_PROGRESS Progress;
+
+        Now = YoriLibGetSystemTimeAsInteger();
+        if (Now - CompactContext->LastProgressTime >= COMPACT_PROGRESS_INTERVAL) {
+            CompactContext->LastProgressTime = Now;
+            YoriLibGetCompressProgress(&CompactContext->CompressContext, &Progress);
+            CompactDisplayProgress(CompactContext, &Progress);
+        }
+    }
+
     return TRUE;
 }
 
@@ -277,6 +404,32 @@ ENTRYPOINT(
                 CompressionAlgorithm.NtfsAlgorithm = COMPRESSION_FORMAT_DEFAULT;
                 CompactContext.Compress = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) &&
+                        CharsConsumed > 0 &&
+                        ThreadCount > 0) {
+
+                        CompactContext.CompressContext.ThreadCount = (YORI_ALLOC_SIZE_T)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                if (i + 1 < ArgC) {
+                    LARGE_INTEGER MinimumSize;
+                    MinimumSize = YoriLibStringToFileSize(&ArgV[i + 1]);
+                    if (MinimumSize.HighPart == 0 && MinimumSize.LowPart > 0) {
+                        CompactContext.CompressContext.MinimumFileSize = MinimumSize.LowPart;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
+                CompactContext.ShowProgress = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c:xpress")) == 0 ||
                        YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c:xp4k")) == 0) {
                 CompressionAlgorithm.EntireAlgorithm = 0;
@@ -345,7 +498,7 @@ ENTRYPOINT(
     //  object name in the root and not the object name in all children.
     //
 
-    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES;
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_NO_SHORT_NAMES;
     if (CompactContext.Recursive) {
         MatchFlags |= YORILIB_FILEENUM_RECURSE_BEFORE_RETURN;
     }
@@ -353,8 +506,11 @@ ENTRYPOINT(
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
 
+    CompactContext.LastProgressTime = YoriLibGetSystemTimeAsInteger();
+
     for (i = StartArg; i < ArgC; i++) {
 
+        CompactContext.WofChecked = FALSE;
         YoriLibForEachFile(&ArgV[i],
                            MatchFlags,
                            0,
@@ -365,6 +521,10 @@ ENTRYPOINT(
 
     YoriLibFreeCompressContext(&CompactContext.CompressContext);
 
+    if (CompactContext.ShowProgress) {
+        CompactDisplayProgress(&CompactContext, &CompactContext.CompressContext.Progress);
+    }
+
     if (CompactContext.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("compact: no matching files found\n"));
         return EXIT_FAILURE;
@@ -427,6 +427,8 @@ clean:
 	@if exist *.exp erase *.exp
 	@if exist *.res erase *.res
 	@if exist *.pru erase *.pru
+	@if exist *.prt erase *.prt
+	@if exist *.prd erase *.prd
 	@if exist *~ erase *~
 	@if exist *.exe.manifest erase *.exe.manifest
 
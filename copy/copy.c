@@ -35,18 +35,20 @@ CHAR strCopyHelpText[] =
         "\n"
         "Copies one or more files.\n"
         "\n"
-        "COPY [-license] [-b] [-c:algorithm] [-ds size] [-l] [-n|-nt|-p] [-s] [-t] [-v]\n"
-        "      [-x exclude] <src>\n"
-        "COPY [-license] [-b] [-c:algorithm] [-ds size] [-l] [-n|-nt|-p] [-s] [-t] [-v]\n"
-        "      [-x exclude] <src> [<src> ...] <dest>\n"
+        "COPY [-license] [-b] [-c:algorithm] [-ds size] [-j n] [-l] [-n|-nt|-nv|-p]\n"
+        "      [-s] [-t] [-v] [-x exclude] <src>\n"
+        "COPY [-license] [-b] [-c:algorithm] [-ds size] [-j n] [-l] [-n|-nt|-nv|-p]\n"
+        "      [-s] [-t] [-v] [-x exclude] <src> [<src> ...] <dest>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Compress targets with specified algorithm.  Options are:\n"
         "                    lzx, ntfs, xp4k, xp8k, xp16k\n"
         "   -ds            The size of the device, ignored for files\n"
+        "   -j             Copy files on the specified number of threads\n"
         "   -l             Copy links as links rather than contents\n"
         "   -n             Copy new or files whose size have changed only\n"
         "   -nt            Copy new or files whose size or timestamps have changed only\n"
+        "   -nv            As -nt, also comparing the contents of unchanged files\n"
         "   -p             Preserve existing files, no overwriting\n"
         "   -s             Copy subdirectories as well as files\n"
         "   -t             Copy timestamps only, no data\n"
@@ -104,6 +106,12 @@ typedef struct _COPY_CONTEXT {
      */
     YORILIB_COMPRESS_CONTEXT CompressContext;
 
+    /**
+     The queue of files to copy on background threads.  This is only used
+     if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
     /**
      The number of bytes to copy when copying to or from a device.  Zero
      means copy until the end of the device.
@@ -130,6 +138,41 @@ typedef struct _COPY_CONTEXT {
      */
     DWORD FilesFoundThisArg;
 
+    /**
+     The number of files skipped because they are unchanged on the target.
+     */
+    DWORD FilesSkipped;
+
+    /**
+     The number of bytes in files that have been copied to the target.
+     This only includes files found from enumeration.
+     */
+    LARGE_INTEGER BytesCopied;
+
+    /**
+     The number of bytes in files skipped because they are unchanged on the
+     target.
+     */
+    LARGE_INTEGER BytesSkipped;
+
+    /**
+     The volume serial number of the destination, if it supports cloning
+     extents.  Only meaningful if BlockClone is TRUE.
+     */
+    DWORD BlockCloneVolumeSerial;
+
+    /**
+     The cluster size of the destination volume, if it supports cloning
+     extents.  Only meaningful if BlockClone is TRUE.
+     */
+    DWORD BlockCloneClusterSize;
+
+    /**
+     The number of threads to copy files on.  If this is zero or one, files
+     are copied on the thread enumerating them.
+     */
+    DWORD ThreadCount;
+
     /**
      If TRUE, targets should be compressed.
      */
@@ -157,6 +200,13 @@ typedef struct _COPY_CONTEXT {
      */
     BOOLEAN CopyChangedTimestamps;
 
+    /**
+     If TRUE, files whose size and timestamp are unchanged have their
+     contents compared against the target, and are copied if the contents
+     differ.  This field is only meaningful if CopyNewOnly is TRUE.
+     */
+    BOOLEAN CompareContents;
+
     /**
      If TRUE, files are copied if they do not already exists.  Any existing
      file will be skipped.
@@ -186,8 +236,46 @@ typedef struct _COPY_CONTEXT {
      If TRUE, output is generated for each object copied.
      */
     BOOLEAN Verbose;
+
+    /**
+     If TRUE, the destination volume supports cloning extents, so files
+     from the same volume are cloned rather than having their data copied.
+     */
+    BOOLEAN BlockClone;
 } COPY_CONTEXT, *PCOPY_CONTEXT;
 
+/**
+ A single file to be copied on a background thread.
+ */
+typedef struct _COPY_WORK_ITEM {
+
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     Fully qualified path to the source file.
+     */
+    YORI_STRING SourceFile;
+
+    /**
+     Fully qualified path to the destination file.
+     */
+    YORI_STRING DestFile;
+
+    /**
+     Information about the source file from enumeration.  This is only
+     meaningful if FileInfoPresent is TRUE.
+     */
+    WIN32_FIND_DATA FileInfo;
+
+    /**
+     TRUE if FileInfo has been populated from enumeration.
+     */
+    BOOLEAN FileInfoPresent;
+} COPY_WORK_ITEM, *PCOPY_WORK_ITEM;
+
 /**
  Add a new exclude criteria to the list.
 
@@ -296,6 +384,80 @@ CopyBuildDestinationPath(
     return TRUE;
 }
 
+/**
+ Compare the contents of two files.
+
+ @param SourceFile Pointer to a NULL terminated source file name.
+
+ @param DestHandle A handle to the destination file, opened with read
+        access.
+
+ @return TRUE to indicate the file contents are identical, FALSE if they
+         differ or could not be compared.
+ */
+BOOL
+CopyAreFileContentsEqual(
+    __in PYORI_STRING SourceFile,
+    __in HANDLE DestHandle
+    )
+{
+    HANDLE SourceHandle;
+    PUCHAR SourceBuffer;
+    PUCHAR DestBuffer;
+    DWORD BufferSize;
+    DWORD SourceBytesRead;
+    DWORD DestBytesRead;
+    BOOL Result;
+
+    SourceHandle = CreateFile(SourceFile->StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN|FILE_FLAG_BACKUP_SEMANTICS,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    BufferSize = 64 * 1024;
+    if (!YoriLibIsSizeAllocatable(BufferSize * 2)) {
+        BufferSize = 16 * 1024;
+    }
+
+    SourceBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)(BufferSize * 2));
+    if (SourceBuffer == NULL) {
+        CloseHandle(SourceHandle);
+        return FALSE;
+    }
+    DestBuffer = SourceBuffer + BufferSize;
+
+    Result = FALSE;
+    while (TRUE) {
+        if (!ReadFile(SourceHandle, SourceBuffer, BufferSize, &SourceBytesRead, NULL) ||
+            !ReadFile(DestHandle, DestBuffer, BufferSize, &DestBytesRead, NULL)) {
+
+            break;
+        }
+
+        if (SourceBytesRead != DestBytesRead ||
+            memcmp(SourceBuffer, DestBuffer, SourceBytesRead) != 0) {
+
+            break;
+        }
+
+        if (SourceBytesRead == 0) {
+            Result = TRUE;
+            break;
+        }
+    }
+
+    YoriLibFree(SourceBuffer);
+    CloseHandle(SourceHandle);
+    return Result;
+}
+
 /**
  Returns TRUE to indicate that an object should be excluded based on the
  exclude criteria, or FALSE if it should be included.
@@ -303,6 +465,8 @@ CopyBuildDestinationPath(
  @param CopyContext Pointer to the copy context to check the new object
         against.
 
+ @param SourcePath Pointer to the fully qualified path to the source.
+
  @param RelativeSourcePath Pointer to a string describing the file relative
         to the root of the source of the copy operation.
 
@@ -315,6 +479,7 @@ CopyBuildDestinationPath(
 BOOL
 CopyShouldExclude(
     __in PCOPY_CONTEXT CopyContext,
+    __in PYORI_STRING SourcePath,
     __in PYORI_STRING RelativeSourcePath,
     __in_opt PWIN32_FIND_DATA SourceFindData
     )
@@ -337,6 +502,7 @@ CopyShouldExclude(
         LARGE_INTEGER DestWriteTime;
         LARGE_INTEGER SourceWriteTime;
         HANDLE DestFileHandle;
+        DWORD DesiredAccess;
 
         YoriLibInitEmptyString(&FullDest);
 
@@ -344,8 +510,13 @@ CopyShouldExclude(
             return FALSE;
         }
 
+        DesiredAccess = FILE_READ_ATTRIBUTES;
+        if (CopyContext->CompareContents) {
+            DesiredAccess = DesiredAccess | FILE_READ_DATA | SYNCHRONIZE;
+        }
+
         DestFileHandle = CreateFile(FullDest.StartOfString,
-                                    FILE_READ_ATTRIBUTES,
+                                    DesiredAccess,
                                     FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
                                     NULL,
                                     OPEN_EXISTING,
@@ -401,7 +572,29 @@ CopyShouldExclude(
             }
         }
 
+        //
+        //  The size and timestamp match.  If requested, check the data
+        //  matches too.  Directories have no data to compare.
+        //
+
+        if (CopyContext->CompareContents &&
+            (SourceFindData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+            if (!CopyAreFileContentsEqual(SourcePath, DestFileHandle)) {
+                CloseHandle(DestFileHandle);
+                return FALSE;
+            }
+        }
+
         CloseHandle(DestFileHandle);
+
+        if ((SourceFindData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            LARGE_INTEGER FileSize;
+            FileSize.HighPart = SourceFindData->nFileSizeHigh;
+            FileSize.LowPart = SourceFindData->nFileSizeLow;
+            CopyContext->FilesSkipped++;
+            CopyContext->BytesSkipped.QuadPart = CopyContext->BytesSkipped.QuadPart + FileSize.QuadPart;
+        }
         return TRUE;
     }
     return FALSE;
@@ -547,10 +740,493 @@ CopyAsLink(
         return FALSE;
     }
 
-    CloseHandle(SourceFileHandle);
-    CloseHandle(DestFileHandle);
-    YoriLibFree(ReparseData);
-    return TRUE;
+    CloseHandle(SourceFileHandle);
+    CloseHandle(DestFileHandle);
+    YoriLibFree(ReparseData);
+    return TRUE;
+}
+
+/**
+ The size of each buffer used when copying data with overlapped I/O.  This
+ must be a multiple of the page size so it satisfies the alignment
+ requirements of unbuffered I/O.
+ */
+#define COPY_PIPELINE_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The number of buffers, and therefore the maximum number of I/Os, in flight
+ at once when copying data with overlapped I/O.
+ */
+#define COPY_PIPELINE_BUFFER_COUNT (4)
+
+/**
+ The alignment to use for unbuffered I/O when the device does not report a
+ sector size.  This is the page size, which is at least as large as the
+ sector size of any device expected to be encountered.
+ */
+#define COPY_PIPELINE_UNBUFFERED_ALIGNMENT (4096)
+
+/**
+ The amount of data to copy above which overlapped I/O should bypass the
+ file cache.  Below this size, caching the data is cheap and may be useful;
+ above it, the copy would displace everything else from the cache.
+ */
+#define COPY_PIPELINE_UNBUFFERED_THRESHOLD (256 * 1024 * 1024)
+
+/**
+ The state of a single buffer used when copying data with overlapped I/O.
+ */
+typedef enum _COPY_PIPELINE_STATE {
+    CopyPipelineIdle = 0,
+    CopyPipelineReading = 1,
+    CopyPipelineWriting = 2
+} COPY_PIPELINE_STATE;
+
+/**
+ A single buffer used when copying data with overlapped I/O.  Each buffer
+ is read from the source and written to the same offset in the target.
+ */
+typedef struct _COPY_PIPELINE_SLOT {
+
+    /**
+     The overlapped structure for the I/O in progress on this buffer.
+     */
+    OVERLAPPED Overlapped;
+
+    /**
+     Pointer to the buffer.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The offset in the source and target that this buffer refers to.
+     */
+    DWORDLONG Offset;
+
+    /**
+     The number of bytes of the source that this buffer refers to.
+     */
+    DWORD Length;
+
+    /**
+     The I/O that is currently in progress on this buffer.
+     */
+    COPY_PIPELINE_STATE State;
+} COPY_PIPELINE_SLOT, *PCOPY_PIPELINE_SLOT;
+
+/**
+ Display an error encountered while copying data with overlapped I/O.
+
+ @param Operation Pointer to a NULL terminated string describing the
+        operation that failed.
+
+ @param FileName Pointer to the file that the operation failed on.
+
+ @param LastError The Win32 error code.
+ */
+VOID
+CopyPipelineDisplayError(
+    __in LPCTSTR Operation,
+    __in PYORI_STRING FileName,
+    __in DWORD LastError
+    )
+{
+    LPTSTR ErrText;
+
+    ErrText = YoriLibGetWinErrorText(LastError);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%s failed: %y: %s"), Operation, FileName, ErrText);
+    YoriLibFreeWinErrorText(ErrText);
+}
+
+/**
+ Copy data from a source to a target with several overlapped reads and
+ writes in flight at once, so reading from the source and writing to the
+ target proceed concurrently.  Large copies are performed without
+ buffering so they run at device speed and do not displace the file cache.
+ This is only used when both the source and target are disks or files; if
+ either is not, or the objects cannot be opened for overlapped I/O, this
+ function returns FALSE and the caller should copy synchronously.  Errors
+ opening objects are left for the synchronous path to report.
+
+ @param CopyContext Pointer to the copy context, specifying device size.
+
+ @param SourceFile Pointer to the source file/device name.
+
+ @param DestFile Pointer to the destination file/device name.
+
+ @param CopyResult On return from this function indicating the copy was
+        attempted, set to TRUE if the copy succeeded or FALSE if it failed.
+
+ @return TRUE to indicate the copy was attempted by this function, FALSE to
+         indicate the caller should perform the copy.
+ */
+BOOL
+CopyAsPipelinedDataMove(
+    __in PCOPY_CONTEXT CopyContext,
+    __in PYORI_STRING SourceFile,
+    __in PYORI_STRING DestFile,
+    __out PBOOL CopyResult
+    )
+{
+    COPY_PIPELINE_SLOT Slots[COPY_PIPELINE_BUFFER_COUNT];
+    HANDLE WaitHandles[COPY_PIPELINE_BUFFER_COUNT];
+    DWORD WaitSlots[COPY_PIPELINE_BUFFER_COUNT];
+    PCOPY_PIPELINE_SLOT Slot;
+    HANDLE SourceHandle;
+    HANDLE DestHandle;
+    HANDLE IoHandle;
+    PUCHAR BufferBase;
+    DWORDLONG BytesToCopy;
+    DWORDLONG NextReadOffset;
+    DWORDLONG EndOfData;
+    LARGE_INTEGER NewEndOfFile;
+    DWORD FlagsAndAttributes;
+    DWORD SectorSize;
+    DWORD WriteAlignment;
+    DWORD IoLength;
+    DWORD BytesTransferred;
+    DWORD ActiveCount;
+    DWORD FoundEvent;
+    DWORD LastError;
+    DWORD Index;
+    BOOLEAN Unbuffered;
+    BOOL Attempted;
+    BOOL Success;
+
+    *CopyResult = FALSE;
+    Attempted = FALSE;
+    Success = TRUE;
+    DestHandle = INVALID_HANDLE_VALUE;
+    BufferBase = NULL;
+    ZeroMemory(Slots, sizeof(Slots));
+
+    //
+    //  Size and geometry queries are synchronous, so perform them on
+    //  handles opened for synchronous I/O, then reopen each object for
+    //  overlapped I/O.
+    //
+
+    SourceHandle = CreateFile(SourceFile->StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_OPEN_NO_RECALL|FILE_FLAG_BACKUP_SEMANTICS,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    if (GetFileType(SourceHandle) != FILE_TYPE_DISK ||
+        YoriLibGetFileOrDeviceSize(SourceHandle, &BytesToCopy) != ERROR_SUCCESS) {
+
+        goto Exit;
+    }
+
+    CloseHandle(SourceHandle);
+    SourceHandle = INVALID_HANDLE_VALUE;
+
+    if (CopyContext->DeviceSize.QuadPart != 0 &&
+        (DWORDLONG)CopyContext->DeviceSize.QuadPart < BytesToCopy) {
+
+        BytesToCopy = CopyContext->DeviceSize.QuadPart;
+    }
+
+    DestHandle = CreateFile(DestFile->StartOfString,
+                            GENERIC_WRITE,
+                            FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                            NULL,
+                            CREATE_ALWAYS,
+                            FILE_FLAG_BACKUP_SEMANTICS,
+                            NULL);
+
+    if (DestHandle == INVALID_HANDLE_VALUE &&
+        GetLastError() == ERROR_INVALID_PARAMETER) {
+
+        DestHandle = CreateFile(DestFile->StartOfString,
+                                GENERIC_WRITE,
+                                FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS,
+                                NULL);
+    }
+
+    if (DestHandle == INVALID_HANDLE_VALUE ||
+        GetFileType(DestHandle) != FILE_TYPE_DISK) {
+
+        goto Exit;
+    }
+
+    SectorSize = YoriLibGetHandleSectorSize(DestHandle);
+    CloseHandle(DestHandle);
+    DestHandle = INVALID_HANDLE_VALUE;
+
+    //
+    //  Large copies bypass the file cache.
+    //
+
+    Unbuffered = FALSE;
+    FlagsAndAttributes = FILE_FLAG_OVERLAPPED|FILE_FLAG_BACKUP_SEMANTICS;
+    if (BytesToCopy >= COPY_PIPELINE_UNBUFFERED_THRESHOLD) {
+        Unbuffered = TRUE;
+        FlagsAndAttributes = FlagsAndAttributes | FILE_FLAG_NO_BUFFERING;
+    }
+
+    SourceHandle = CreateFile(SourceFile->StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FlagsAndAttributes | FILE_FLAG_OPEN_NO_RECALL,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    DestHandle = CreateFile(DestFile->StartOfString,
+                            GENERIC_WRITE,
+                            FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FlagsAndAttributes,
+                            NULL);
+
+    if (DestHandle == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    //
+    //  Writes to a device need to be in whole sectors.  Unbuffered writes
+    //  to a file also need to be aligned, and the file is truncated to the
+    //  correct size after the copy.
+    //
+
+    WriteAlignment = SectorSize;
+    if (Unbuffered && WriteAlignment < COPY_PIPELINE_UNBUFFERED_ALIGNMENT) {
+        WriteAlignment = COPY_PIPELINE_UNBUFFERED_ALIGNMENT;
+    }
+
+    if (WriteAlignment != 0 && (COPY_PIPELINE_BUFFER_SIZE % WriteAlignment) != 0) {
+        goto Exit;
+    }
+
+    //
+    //  Allocate with VirtualAlloc so buffers are page aligned as required
+    //  by unbuffered I/O.
+    //
+
+    BufferBase = VirtualAlloc(NULL, COPY_PIPELINE_BUFFER_SIZE * COPY_PIPELINE_BUFFER_COUNT, MEM_COMMIT, PAGE_READWRITE);
+    if (BufferBase == NULL) {
+        goto Exit;
+    }
+
+    for (Index = 0; Index < COPY_PIPELINE_BUFFER_COUNT; Index++) {
+        Slots[Index].Buffer = BufferBase + Index * COPY_PIPELINE_BUFFER_SIZE;
+        Slots[Index].Overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Slots[Index].Overlapped.hEvent == NULL) {
+            goto Exit;
+        }
+    }
+
+    Attempted = TRUE;
+    NextReadOffset = 0;
+    EndOfData = 0;
+
+    while (TRUE) {
+
+        //
+        //  Start reads into any idle buffers.
+        //
+
+        for (Index = 0; Index < COPY_PIPELINE_BUFFER_COUNT; Index++) {
+            Slot = &Slots[Index];
+            if (Slot->State != CopyPipelineIdle ||
+                !Success ||
+                NextReadOffset >= BytesToCopy) {
+
+                continue;
+            }
+
+            Slot->Offset = NextReadOffset;
+            Slot->Length = COPY_PIPELINE_BUFFER_SIZE;
+            if (BytesToCopy - NextReadOffset < COPY_PIPELINE_BUFFER_SIZE) {
+                Slot->Length = (DWORD)(BytesToCopy - NextReadOffset);
+            }
+
+            IoLength = Slot->Length;
+            if (Unbuffered && (IoLength % COPY_PIPELINE_UNBUFFERED_ALIGNMENT) != 0) {
+                IoLength = (IoLength / COPY_PIPELINE_UNBUFFERED_ALIGNMENT + 1) * COPY_PIPELINE_UNBUFFERED_ALIGNMENT;
+            }
+
+            Slot->Overlapped.Offset = (DWORD)Slot->Offset;
+            Slot->Overlapped.OffsetHigh = (DWORD)(Slot->Offset >> 32);
+            if (!ReadFile(SourceHandle, Slot->Buffer, IoLength, NULL, &Slot->Overlapped)) {
+                LastError = GetLastError();
+                if (LastError != ERROR_IO_PENDING) {
+                    CopyPipelineDisplayError(_T("Read from source"), SourceFile, LastError);
+                    Success = FALSE;
+                    continue;
+                }
+            }
+
+            Slot->State = CopyPipelineReading;
+            NextReadOffset = NextReadOffset + Slot->Length;
+        }
+
+        //
+        //  Wait for any I/O to complete.  If none are in flight, the copy
+        //  is finished.
+        //
+
+        ActiveCount = 0;
+        for (Index = 0; Index < COPY_PIPELINE_BUFFER_COUNT; Index++) {
+            if (Slots[Index].State != CopyPipelineIdle) {
+                WaitHandles[ActiveCount] = Slots[Index].Overlapped.hEvent;
+                WaitSlots[ActiveCount] = Index;
+                ActiveCount++;
+            }
+        }
+
+        if (ActiveCount == 0) {
+            break;
+        }
+
+        FoundEvent = WaitForMultipleObjects(ActiveCount, WaitHandles, FALSE, INFINITE);
+        if (FoundEvent >= WAIT_OBJECT_0 + ActiveCount) {
+
+            //
+            //  This is not expected.  Cancel any I/O and wait for it to
+            //  complete before the buffers are freed.
+            //
+
+            Success = FALSE;
+            CancelIo(SourceHandle);
+            CancelIo(DestHandle);
+            for (Index = 0; Index < COPY_PIPELINE_BUFFER_COUNT; Index++) {
+                Slot = &Slots[Index];
+                if (Slot->State == CopyPipelineReading) {
+                    GetOverlappedResult(SourceHandle, &Slot->Overlapped, &BytesTransferred, TRUE);
+                } else if (Slot->State == CopyPipelineWriting) {
+                    GetOverlappedResult(DestHandle, &Slot->Overlapped, &BytesTransferred, TRUE);
+                }
+                Slot->State = CopyPipelineIdle;
+            }
+            break;
+        }
+
+        Slot = &Slots[WaitSlots[FoundEvent - WAIT_OBJECT_0]];
+        if (Slot->State == CopyPipelineReading) {
+            IoHandle = SourceHandle;
+        } else {
+            IoHandle = DestHandle;
+        }
+
+        if (!GetOverlappedResult(IoHandle, &Slot->Overlapped, &BytesTransferred, FALSE)) {
+            LastError = GetLastError();
+            if (Slot->State == CopyPipelineReading && LastError == ERROR_HANDLE_EOF) {
+                BytesTransferred = 0;
+            } else {
+                if (Slot->State == CopyPipelineReading) {
+                    CopyPipelineDisplayError(_T("Read from source"), SourceFile, LastError);
+                } else {
+                    CopyPipelineDisplayError(_T("Write to destination"), DestFile, LastError);
+                }
+                Success = FALSE;
+                Slot->State = CopyPipelineIdle;
+                continue;
+            }
+        }
+
+        if (Slot->State == CopyPipelineWriting) {
+            Slot->State = CopyPipelineIdle;
+            continue;
+        }
+
+        //
+        //  A read has completed.  If the source ended sooner than expected,
+        //  stop issuing reads beyond its end.  If there is data, write it
+        //  to the target at the same offset.
+        //
+
+        Slot->State = CopyPipelineIdle;
+        if (BytesTransferred > Slot->Length) {
+            BytesTransferred = Slot->Length;
+        }
+
+        if (BytesTransferred < Slot->Length) {
+            if (Slot->Offset + BytesTransferred < BytesToCopy) {
+                BytesToCopy = Slot->Offset + BytesTransferred;
+            }
+        }
+
+        if (!Success || BytesTransferred == 0) {
+            continue;
+        }
+
+        if (Slot->Offset + BytesTransferred > EndOfData) {
+            EndOfData = Slot->Offset + BytesTransferred;
+        }
+
+        IoLength = BytesTransferred;
+        if (WriteAlignment != 0 && (IoLength % WriteAlignment) != 0) {
+            IoLength = (IoLength / WriteAlignment + 1) * WriteAlignment;
+            ZeroMemory(Slot->Buffer + BytesTransferred, IoLength - BytesTransferred);
+        }
+
+        if (!WriteFile(DestHandle, Slot->Buffer, IoLength, NULL, &Slot->Overlapped)) {
+            LastError = GetLastError();
+            if (LastError != ERROR_IO_PENDING) {
+                CopyPipelineDisplayError(_T("Write to destination"), DestFile, LastError);
+                Success = FALSE;
+                continue;
+            }
+        }
+
+        Slot->State = CopyPipelineWriting;
+    }
+
+    //
+    //  If the target is a file and writes were extended to meet alignment
+    //  requirements, truncate it back to the size of the data.
+    //
+
+    if (Success && SectorSize == 0 && WriteAlignment != 0 && (EndOfData % WriteAlignment) != 0) {
+        NewEndOfFile.QuadPart = EndOfData;
+        SetFilePointer(DestHandle, NewEndOfFile.LowPart, &NewEndOfFile.HighPart, FILE_BEGIN);
+        if (!SetEndOfFile(DestHandle)) {
+            CopyPipelineDisplayError(_T("Setting size of destination"), DestFile, GetLastError());
+            Success = FALSE;
+        }
+    }
+
+Exit:
+
+    for (Index = 0; Index < COPY_PIPELINE_BUFFER_COUNT; Index++) {
+        if (Slots[Index].Overlapped.hEvent != NULL) {
+            CloseHandle(Slots[Index].Overlapped.hEvent);
+        }
+    }
+
+    if (BufferBase != NULL) {
+        VirtualFree(BufferBase, 0, MEM_RELEASE);
+    }
+
+    if (DestHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(DestHandle);
+    }
+
+    if (SourceHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(SourceHandle);
+    }
+
+    if (Attempted) {
+        *CopyResult = Success;
+    }
+
+    return Attempted;
 }
 
 /**
@@ -583,6 +1259,15 @@ CopyAsDumbDataMove(
     DWORD LastError;
     LPTSTR ErrText;
     LONGLONG TotalBytesCopied;
+    BOOL Result;
+
+    //
+    //  If the source and target support it, overlap reads and writes.
+    //
+
+    if (CopyAsPipelinedDataMove(CopyContext, SourceFile, DestFile, &Result)) {
+        return Result;
+    }
 
     SourceHandle = CreateFile(SourceFile->StartOfString,
                               GENERIC_READ,
@@ -748,6 +1433,405 @@ CopyTimestamps(
     return TRUE;
 }
 
+/**
+ Check whether the destination volume supports cloning extents between
+ files.  If it does, record the volume serial number and cluster size so
+ files from the same volume can be cloned rather than copied.
+
+ @param CopyContext Pointer to the copy context containing the destination.
+ */
+VOID
+CopyDetectBlockClone(
+    __in PCOPY_CONTEXT CopyContext
+    )
+{
+    YORI_STRING VolRootName;
+    DWORD VolumeSerial;
+    DWORD MaxComponentLength;
+    DWORD Capabilities;
+    DWORD SectorsPerCluster;
+    DWORD SectorSize;
+    DWORD FreeClusters;
+    DWORD TotalClusters;
+
+    CopyContext->BlockClone = FALSE;
+
+    YoriLibInitEmptyString(&VolRootName);
+    if (!YoriLibGetVolumePathName(&CopyContext->Dest, &VolRootName)) {
+        return;
+    }
+
+    //
+    //  GetVolumeInformation wants a name with a trailing backslash.  Add one
+    //  if needed.
+    //
+
+    if (VolRootName.LengthInChars > 0 &&
+        VolRootName.LengthInChars + 1 < VolRootName.LengthAllocated &&
+        VolRootName.StartOfString[VolRootName.LengthInChars - 1] != '\\') {
+
+        VolRootName.StartOfString[VolRootName.LengthInChars] = '\\';
+        VolRootName.StartOfString[VolRootName.LengthInChars + 1] = '\0';
+        VolRootName.LengthInChars++;
+    }
+
+    if (GetVolumeInformation(VolRootName.StartOfString,
+                             NULL,
+                             0,
+                             &VolumeSerial,
+                             &MaxComponentLength,
+                             &Capabilities,
+                             NULL,
+                             0) &&
+        (Capabilities & FILE_SUPPORTS_BLOCK_REFCOUNTING) != 0 &&
+        GetDiskFreeSpace(VolRootName.StartOfString,
+                         &SectorsPerCluster,
+                         &SectorSize,
+                         &FreeClusters,
+                         &TotalClusters) &&
+        SectorsPerCluster * SectorSize != 0) {
+
+        CopyContext->BlockCloneVolumeSerial = VolumeSerial;
+        CopyContext->BlockCloneClusterSize = SectorsPerCluster * SectorSize;
+        CopyContext->BlockClone = TRUE;
+    }
+
+    YoriLibFreeStringContents(&VolRootName);
+}
+
+/**
+ The maximum number of bytes to clone in a single request.  This is a
+ multiple of any cluster size.
+ */
+#define COPY_BLOCK_CLONE_CHUNK_SIZE (1024 * 1024 * 1024)
+
+/**
+ Attempt to copy a file by cloning its extents, so the target shares
+ storage with the source rather than having data copied.  This is only
+ possible if both files are on the same volume and the file system supports
+ extent sharing, such as ReFS.  On failure the partially created target is
+ deleted so the caller can copy the data.
+
+ @param CopyContext Pointer to the copy context, indicating the volume that
+        supports cloning.
+
+ @param SourceFile Pointer to the fully qualified source file name.
+
+ @param DestFile Pointer to the fully qualified destination file name.
+
+ @return TRUE if the file was cloned, FALSE if it was not and should be
+         copied.
+ */
+BOOL
+CopyAsBlockClone(
+    __in PCOPY_CONTEXT CopyContext,
+    __in PYORI_STRING SourceFile,
+    __in PYORI_STRING DestFile
+    )
+{
+    HANDLE SourceHandle;
+    HANDLE DestHandle;
+    BY_HANDLE_FILE_INFORMATION SourceInfo;
+    DUPLICATE_EXTENTS_DATA DuplicateExtents;
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER Offset;
+    DWORDLONG BytesRemaining;
+    DWORD BytesReturned;
+    DWORD LastError;
+    BOOL Result;
+
+    SourceHandle = CreateFile(SourceFile->StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ|FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_OPEN_NO_RECALL|FILE_FLAG_BACKUP_SEMANTICS,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    //
+    //  Only clone regular files on the same volume as the target.  Empty
+    //  files have nothing to clone, and sparse files need their sparseness
+    //  preserved, so leave both to CopyFile.
+    //
+
+    if (!GetFileInformationByHandle(SourceHandle, &SourceInfo) ||
+        SourceInfo.dwVolumeSerialNumber != CopyContext->BlockCloneVolumeSerial ||
+        (SourceInfo.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_SPARSE_FILE | FILE_ATTRIBUTE_REPARSE_POINT)) != 0 ||
+        (SourceInfo.nFileSizeHigh == 0 && SourceInfo.nFileSizeLow == 0)) {
+
+        CloseHandle(SourceHandle);
+        return FALSE;
+    }
+
+    DestHandle = CreateFile(DestFile->StartOfString,
+                            GENERIC_READ|GENERIC_WRITE,
+                            0,
+                            NULL,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL|FILE_FLAG_BACKUP_SEMANTICS,
+                            NULL);
+
+    if (DestHandle == INVALID_HANDLE_VALUE) {
+        CloseHandle(SourceHandle);
+        return FALSE;
+    }
+
+    //
+    //  The target needs to be large enough to contain the cloned range
+    //  before extents can be cloned into it.
+    //
+
+    Result = FALSE;
+    FileSize.HighPart = SourceInfo.nFileSizeHigh;
+    FileSize.LowPart = SourceInfo.nFileSizeLow;
+    Offset.QuadPart = FileSize.QuadPart;
+    if (SetFilePointer(DestHandle, Offset.LowPart, &Offset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+
+        goto Exit;
+    }
+
+    if (!SetEndOfFile(DestHandle)) {
+        goto Exit;
+    }
+
+    //
+    //  Clone requests must be in whole clusters.  The final cluster can
+    //  extend beyond the end of the file.
+    //
+
+    BytesRemaining = FileSize.QuadPart;
+    if ((BytesRemaining % CopyContext->BlockCloneClusterSize) != 0) {
+        BytesRemaining = (BytesRemaining / CopyContext->BlockCloneClusterSize + 1) * CopyContext->BlockCloneClusterSize;
+    }
+
+    Offset.QuadPart = 0;
+    DuplicateExtents.FileHandle = SourceHandle;
+    while (BytesRemaining > 0) {
+        DuplicateExtents.SourceFileOffset.QuadPart = Offset.QuadPart;
+        DuplicateExtents.TargetFileOffset.QuadPart = Offset.QuadPart;
+        DuplicateExtents.ByteCount.QuadPart = BytesRemaining;
+        if (BytesRemaining > COPY_BLOCK_CLONE_CHUNK_SIZE) {
+            DuplicateExtents.ByteCount.QuadPart = COPY_BLOCK_CLONE_CHUNK_SIZE;
+        }
+
+        if (!DeviceIoControl(DestHandle, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &DuplicateExtents, sizeof(DuplicateExtents), NULL, 0, &BytesReturned, NULL)) {
+
+            //
+            //  If the file system doesn't support this at all, don't try
+            //  again for later files.
+            //
+
+            LastError = GetLastError();
+            if (LastError == ERROR_INVALID_FUNCTION || LastError == ERROR_NOT_SUPPORTED) {
+                CopyContext->BlockClone = FALSE;
+            }
+            goto Exit;
+        }
+
+        Offset.QuadPart = Offset.QuadPart + DuplicateExtents.ByteCount.QuadPart;
+        BytesRemaining = BytesRemaining - DuplicateExtents.ByteCount.QuadPart;
+    }
+
+    //
+    //  Preserve the last write time, as CopyFile does.
+    //
+
+    SetFileTime(DestHandle, NULL, NULL, &SourceInfo.ftLastWriteTime);
+    Result = TRUE;
+
+Exit:
+    CloseHandle(DestHandle);
+    CloseHandle(SourceHandle);
+
+    if (Result) {
+        SetFileAttributes(DestFile->StartOfString, SourceInfo.dwFileAttributes);
+    } else {
+        DeleteFile(DestFile->StartOfString);
+    }
+
+    return Result;
+}
+
+/**
+ Copy the data of a regular file from the source to the target, and queue
+ the target for compression if requested.  This can be invoked on the
+ enumerating thread or on a background thread.
+
+ @param CopyContext Pointer to the copy context.
+
+ @param SourceFile Pointer to the fully qualified source file name.
+
+ @param DestFile Pointer to the fully qualified destination file name.
+ */
+VOID
+CopyRegularFile(
+    __in PCOPY_CONTEXT CopyContext,
+    __in PYORI_STRING SourceFile,
+    __in PYORI_STRING DestFile
+    )
+{
+    YORI_STRING HumanSourcePath;
+    YORI_STRING HumanDestPath;
+    PYORI_STRING SourceNameToDisplay;
+    PYORI_STRING DestNameToDisplay;
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    //
+    //  Cloning is only enabled when not compressing, so a cloned file is
+    //  complete.
+    //
+
+    if (CopyContext->BlockClone &&
+        CopyAsBlockClone(CopyContext, SourceFile, DestFile)) {
+
+        return;
+    }
+
+    LastError = YoriLibCopyFile(SourceFile, DestFile);
+    if (LastError != ERROR_SUCCESS) {
+
+        //
+        //  If it failed with an error indicating CopyFile couldn't
+        //  handle it, fall back to dumb data copy.  Note that this
+        //  function will output its own errors, so from this point,
+        //  error handling is over.
+        //
+
+        if (LastError == ERROR_INVALID_PARAMETER) {
+            CopyAsDumbDataMove(CopyContext, SourceFile, DestFile);
+        } else {
+            YoriLibInitEmptyString(&HumanSourcePath);
+            YoriLibInitEmptyString(&HumanDestPath);
+            SourceNameToDisplay = SourceFile;
+            DestNameToDisplay = DestFile;
+            if (YoriLibUnescapePath(SourceFile, &HumanSourcePath)) {
+                SourceNameToDisplay = &HumanSourcePath;
+            }
+            if (YoriLibUnescapePath(DestFile, &HumanDestPath)) {
+                DestNameToDisplay = &HumanDestPath;
+            }
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("CopyFile failed: %y to %y: %s"), SourceNameToDisplay, DestNameToDisplay, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            YoriLibFreeStringContents(&HumanSourcePath);
+            YoriLibFreeStringContents(&HumanDestPath);
+        }
+    }
+
+    if (CopyContext->CompressDest) {
+        YoriLibCompressFileInBackground(&CopyContext->CompressContext, DestFile);
+    }
+}
+
+/**
+ Copy a single file on a background thread.
+
+ @param Context Pointer to the copy context.
+
+ @param Item Pointer to the work item within the copy work item.  The copy
+        work item is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be copied.
+ */
+VOID
+CopyWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PCOPY_CONTEXT CopyContext = (PCOPY_CONTEXT)Context;
+    PCOPY_WORK_ITEM CopyItem;
+
+    CopyItem = CONTAINING_RECORD(Item, COPY_WORK_ITEM, WorkItem);
+
+    if (!Cancelled) {
+        CopyRegularFile(CopyContext, &CopyItem->SourceFile, &CopyItem->DestFile);
+        if (CopyContext->CopyTimestamps && CopyItem->FileInfoPresent) {
+            CopyTimestamps(&CopyItem->FileInfo, &CopyItem->DestFile);
+        }
+    }
+
+    YoriLibFreeStringContents(&CopyItem->SourceFile);
+    YoriLibFreeStringContents(&CopyItem->DestFile);
+    YoriLibFree(CopyItem);
+}
+
+/**
+ Attempt to copy a regular file on a background thread.  The timestamps of
+ the target are updated on the background thread after the data is copied.
+
+ @param CopyContext Pointer to the copy context.
+
+ @param SourceFile Pointer to the fully qualified source file name.
+
+ @param FileInfo Optionally points to information about the source file
+        from enumeration.
+
+ @param DestFile Pointer to the fully qualified destination file name.
+
+ @param Cancelled On completion, set to TRUE if the file could not be queued
+        because the operation was cancelled.
+
+ @return TRUE if the file was queued for a background thread, FALSE if it
+         was not and should be copied by the caller unless Cancelled is TRUE.
+ */
+BOOL
+CopyQueueRegularFile(
+    __in PCOPY_CONTEXT CopyContext,
+    __in PYORI_STRING SourceFile,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in PYORI_STRING DestFile,
+    __out PBOOLEAN Cancelled
+    )
+{
+    PCOPY_WORK_ITEM CopyItem;
+
+    *Cancelled = FALSE;
+    CopyItem = YoriLibMalloc(sizeof(COPY_WORK_ITEM));
+    if (CopyItem == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(CopyItem, sizeof(COPY_WORK_ITEM));
+
+    //
+    //  The source name is a buffer owned by the enumerator which will be
+    //  reused for the next file, so it needs to be copied.  The destination
+    //  was allocated for this file, so it can be referenced.
+    //
+
+    if (!YoriLibCopyString(&CopyItem->SourceFile, SourceFile)) {
+        YoriLibFree(CopyItem);
+        return FALSE;
+    }
+    YoriLibCloneString(&CopyItem->DestFile, DestFile);
+    if (FileInfo != NULL) {
+        memcpy(&CopyItem->FileInfo, FileInfo, sizeof(WIN32_FIND_DATA));
+        CopyItem->FileInfoPresent = TRUE;
+    }
+
+    if (YoriLibQueueWorkItem(&CopyContext->WorkQueue, &CopyItem->WorkItem, TRUE)) {
+        return TRUE;
+    }
+
+    if (CopyContext->WorkQueue.Cancelled) {
+        *Cancelled = TRUE;
+    }
+
+    YoriLibFreeStringContents(&CopyItem->SourceFile);
+    YoriLibFreeStringContents(&CopyItem->DestFile);
+    YoriLibFree(CopyItem);
+    return FALSE;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -785,8 +1869,11 @@ CopyFileFoundCallback(
     YORI_ALLOC_SIZE_T SlashesFound;
     YORI_ALLOC_SIZE_T Index;
     DWORD LastError;
+    BOOLEAN Queued;
+    BOOLEAN Cancelled;
 
     CopyContext->FilesFoundThisArg++;
+    Queued = FALSE;
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
@@ -816,7 +1903,7 @@ CopyFileFoundCallback(
     //  Check if the user wanted to exclude this file
     //
 
-    if (CopyShouldExclude(CopyContext, &RelativePathFromSource, FileInfo)) {
+    if (CopyShouldExclude(CopyContext, FilePath, &RelativePathFromSource, FileInfo)) {
 
         if (CopyContext->Verbose) {
             if (YoriLibUnescapePath(FilePath, &HumanSourcePath)) {
@@ -882,46 +1969,42 @@ CopyFileFoundCallback(
         } else if (CopyContext->DestinationIsDevice || YoriLibIsFileNameDeviceName(FilePath)) {
             CopyAsDumbDataMove(CopyContext, FilePath, &FullDest);
         } else {
-            LastError = YoriLibCopyFile(FilePath, &FullDest);
-            if (LastError != ERROR_SUCCESS) {
-
-                //
-                //  If it failed with an error indicating CopyFile couldn't
-                //  handle it, fall back to dumb data copy.  Note that this
-                //  function will output its own errors, so from this point,
-                //  error handling is over.
-                //
-
-                if (LastError == ERROR_INVALID_PARAMETER) {
-                    CopyAsDumbDataMove(CopyContext, FilePath, &FullDest);
-                } else {
-                    LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-                    if (SourceNameToDisplay != &HumanSourcePath) {
-                        if (YoriLibUnescapePath(FilePath, &HumanSourcePath)) {
-                            SourceNameToDisplay = &HumanSourcePath;
-                        }
-                    }
-                    if (DestNameToDisplay != &HumanDestPath) {
-                        if (YoriLibUnescapePath(&FullDest, &HumanDestPath)) {
-                            DestNameToDisplay = &HumanDestPath;
-                        }
-                    }
-                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("CopyFile failed: %y to %y: %s"), SourceNameToDisplay, DestNameToDisplay, ErrText);
-                    YoriLibFreeWinErrorText(ErrText);
+
+            //
+            //  Directories are created above as they are enumerated, before
+            //  any of their contents, so files within them can be copied on
+            //  background threads in any order.
+            //
+
+            if (CopyContext->ThreadCount > 1) {
+                Queued = CopyQueueRegularFile(CopyContext, FilePath, FileInfo, &FullDest, &Cancelled);
+                if (Cancelled) {
+                    YoriLibFreeStringContents(&FullDest);
+                    YoriLibFreeStringContents(&HumanSourcePath);
+                    YoriLibFreeStringContents(&HumanDestPath);
+                    return FALSE;
                 }
             }
 
-            if (CopyContext->CompressDest) {
-
-                YoriLibCompressFileInBackground(&CopyContext->CompressContext, &FullDest);
+            if (!Queued) {
+                CopyRegularFile(CopyContext, FilePath, &FullDest);
             }
         }
     }
 
-    if (CopyContext->CopyTimestamps && FileInfo != NULL) {
+    if (CopyContext->CopyTimestamps && FileInfo != NULL && !Queued) {
         CopyTimestamps(FileInfo, &FullDest);
     }
 
+    if (FileInfo != NULL &&
+        (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        LARGE_INTEGER FileSize;
+        FileSize.HighPart = FileInfo->nFileSizeHigh;
+        FileSize.LowPart = FileInfo->nFileSizeLow;
+        CopyContext->BytesCopied.QuadPart = CopyContext->BytesCopied.QuadPart + FileSize.QuadPart;
+    }
+
     CopyContext->FilesCopied++;
     YoriLibFreeStringContents(&FullDest);
     YoriLibFreeStringContents(&HumanSourcePath);
@@ -932,7 +2015,7 @@ CopyFileFoundCallback(
 /**
  Free the structures allocated within a copy context.  The structure itself
  is on the stack and is not freed.  This will wait for any outstanding
- compression work to complete.
+ copy and compression work to complete.
 
  @param CopyContext Pointer to the context to free.
  */
@@ -941,6 +2024,7 @@ CopyFreeCopyContext(
     __in PCOPY_CONTEXT CopyContext
     )
 {
+    YoriLibCleanupWorkQueue(&CopyContext->WorkQueue);
     YoriLibFreeCompressContext(&CopyContext->CompressContext);
     YoriLibFreeStringContents(&CopyContext->Dest);
     CopyFreeExcludes(CopyContext);
@@ -987,6 +2071,8 @@ ENTRYPOINT(
     COPY_CONTEXT CopyContext;
     YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm;
     YORI_STRING Arg;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     FileCount = 0;
     Recursive = FALSE;
@@ -1050,6 +2136,14 @@ ENTRYPOINT(
                 CompressionAlgorithm.WofAlgorithm = FILE_PROVIDER_COMPRESSION_XPRESS16K;
                 CopyContext.CompressDest = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        CopyContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 CopyContext.CopyAsLinks = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1058,6 +2152,7 @@ ENTRYPOINT(
                 CopyContext.SkipDataCopy = FALSE;
                 CopyContext.CopyNewOnly = TRUE;
                 CopyContext.CopyChangedTimestamps = FALSE;
+                CopyContext.CompareContents = FALSE;
                 CopyContext.CopyTimestamps = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("nt")) == 0) {
@@ -1065,6 +2160,15 @@ ENTRYPOINT(
                 CopyContext.SkipDataCopy = FALSE;
                 CopyContext.CopyNewOnly = TRUE;
                 CopyContext.CopyChangedTimestamps = TRUE;
+                CopyContext.CompareContents = FALSE;
+                CopyContext.CopyTimestamps = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("nv")) == 0) {
+                CopyContext.PreserveExisting = FALSE;
+                CopyContext.SkipDataCopy = FALSE;
+                CopyContext.CopyNewOnly = TRUE;
+                CopyContext.CopyChangedTimestamps = TRUE;
+                CopyContext.CompareContents = TRUE;
                 CopyContext.CopyTimestamps = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
@@ -1154,6 +2258,19 @@ ENTRYPOINT(
         }
     }
 
+    //
+    //  If the destination can share extents with files on the same volume,
+    //  copies within that volume can be performed without moving data.
+    //
+
+    if (!CopyContext.DestinationIsDevice &&
+        !CopyContext.CopyAsLinks &&
+        !CopyContext.SkipDataCopy &&
+        !CopyContext.CompressDest) {
+
+        CopyDetectBlockClone(&CopyContext);
+    }
+
     if (CopyContext.CompressDest) {
         if (!YoriLibInitializeCompressContext(&CopyContext.CompressContext, CompressionAlgorithm)) {
             CopyFreeCopyContext(&CopyContext);
@@ -1164,6 +2281,20 @@ ENTRYPOINT(
         }
     }
 
+    //
+    //  Copying to a device is inherently serial, so only use background
+    //  threads for file destinations.
+    //
+
+    if (CopyContext.ThreadCount > 1 && !CopyContext.DestinationIsDevice) {
+        if (!YoriLibInitializeWorkQueue(&CopyContext.WorkQueue, (YORI_ALLOC_SIZE_T)CopyContext.ThreadCount, 0, CopyWorkItem, &CopyContext)) {
+            CopyFreeCopyContext(&CopyContext);
+            return EXIT_FAILURE;
+        }
+    } else {
+        CopyContext.ThreadCount = 0;
+    }
+
 #if YORI_BUILTIN
     YoriLibCancelEnable(FALSE);
 #endif
@@ -1224,7 +2355,31 @@ ENTRYPOINT(
 
     Result = EXIT_SUCCESS;
 
-    if (CopyContext.FilesCopied == 0) {
+    if (CopyContext.ThreadCount > 1) {
+        if (!YoriLibWaitForWorkQueue(&CopyContext.WorkQueue)) {
+            Result = EXIT_FAILURE;
+        }
+    }
+
+    if (CopyContext.CopyNewOnly) {
+        YORI_STRING CopiedString;
+        YORI_STRING SkippedString;
+        TCHAR CopiedStringBuffer[6];
+        TCHAR SkippedStringBuffer[6];
+
+        YoriLibInitEmptyString(&CopiedString);
+        CopiedString.StartOfString = CopiedStringBuffer;
+        CopiedString.LengthAllocated = sizeof(CopiedStringBuffer)/sizeof(CopiedStringBuffer[0]);
+        YoriLibInitEmptyString(&SkippedString);
+        SkippedString.StartOfString = SkippedStringBuffer;
+        SkippedString.LengthAllocated = sizeof(SkippedStringBuffer)/sizeof(SkippedStringBuffer[0]);
+
+        YoriLibFileSizeToString(&CopiedString, &CopyContext.BytesCopied);
+        YoriLibFileSizeToString(&SkippedString, &CopyContext.BytesSkipped);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%i objects copied (%y), %i files unchanged (%y)\n"), CopyContext.FilesCopied, &CopiedString, CopyContext.FilesSkipped, &SkippedString);
+    }
+
+    if (CopyContext.FilesCopied == 0 && CopyContext.FilesSkipped == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("copy: no matching files found\n"));
         Result = EXIT_FAILURE;
     }
@@ -37,11 +37,13 @@ CHAR strCpuInfoHelpText[] =
         "Display cpu topology information.\n"
         "\n"
         "CPUINFO [-license] [-a] [-c] [-g] [-n] [-s] [-w ms] [<fmt>]\n"
+        "CPUINFO [-license] -r ms\n"
         "\n"
         "   -a             Display all information\n"
         "   -c             Display information about processor cores\n"
         "   -g             Display information about processor groups\n"
         "   -n             Display information about NUMA nodes\n"
+        "   -r ms          Record per processor utilization as CSV every ms\n"
         "   -s             Display information about processor sockets\n"
         "   -w ms          Wait time to measure CPU utilization\n"
         "\n"
@@ -1027,6 +1029,470 @@ CpuInfoLoadAndUpconvertProcessorInfo(
     return TRUE;
 }
 
+/**
+ The maximum number of logical processors within a processor group.
+ */
+#define CPUINFO_PROCESSORS_PER_GROUP (64)
+
+/**
+ A value used to indicate that the NUMA node or core of a logical processor
+ is not known.
+ */
+#define CPUINFO_UNKNOWN_INDEX ((DWORD)-1)
+
+/**
+ State used when recording utilization for each logical processor.
+ Logical processors are indexed by their group multiplied by
+ CPUINFO_PROCESSORS_PER_GROUP plus their number within the group, matching
+ the numbering used when displaying topology.
+ */
+typedef struct _CPUINFO_RECORD_CONTEXT {
+
+    /**
+     The number of processor groups to sample.
+     */
+    WORD GroupCount;
+
+    /**
+     The number of elements in each of the per processor arrays below.
+     */
+    DWORD ProcessorSlots;
+
+    /**
+     The number of bytes in each of the Samples allocations.
+     */
+    YORI_ALLOC_SIZE_T SampleBufferSize;
+
+    /**
+     Two sets of processor times.  One contains the previous sample and the
+     other the current sample.  These are reused for each sample.
+     */
+    PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Samples[2];
+
+    /**
+     The number of logical processors returned for each processor group.
+     */
+    PDWORD GroupProcessorCount;
+
+    /**
+     The NUMA node for each logical processor.
+     */
+    PDWORD NumaNode;
+
+    /**
+     The index of the core for each logical processor.
+     */
+    PDWORD Core;
+
+    /**
+     An array of logical processor indexes in the order they should be
+     output, which is sorted by NUMA node and core.
+     */
+    PDWORD Order;
+
+    /**
+     The number of elements in the Order array.
+     */
+    DWORD OrderCount;
+
+} CPUINFO_RECORD_CONTEXT, *PCPUINFO_RECORD_CONTEXT;
+
+/**
+ Free any allocations within a record context.
+
+ @param RecordContext Pointer to the record context.
+ */
+VOID
+CpuInfoCleanupRecordContext(
+    __inout PCPUINFO_RECORD_CONTEXT RecordContext
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < sizeof(RecordContext->Samples)/sizeof(RecordContext->Samples[0]); Index++) {
+        if (RecordContext->Samples[Index] != NULL) {
+            YoriLibFree(RecordContext->Samples[Index]);
+            RecordContext->Samples[Index] = NULL;
+        }
+    }
+
+    if (RecordContext->GroupProcessorCount != NULL) {
+        YoriLibFree(RecordContext->GroupProcessorCount);
+        RecordContext->GroupProcessorCount = NULL;
+    }
+
+    if (RecordContext->NumaNode != NULL) {
+        YoriLibFree(RecordContext->NumaNode);
+        RecordContext->NumaNode = NULL;
+    }
+
+    if (RecordContext->Core != NULL) {
+        YoriLibFree(RecordContext->Core);
+        RecordContext->Core = NULL;
+    }
+
+    if (RecordContext->Order != NULL) {
+        YoriLibFree(RecordContext->Order);
+        RecordContext->Order = NULL;
+    }
+}
+
+/**
+ Capture the processor times for every logical processor in the system.
+
+ @param RecordContext Pointer to the record context.
+
+ @param Sample Pointer to an array of processor times to populate.  This
+        must contain RecordContext->ProcessorSlots elements.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+CpuInfoCaptureProcessorTimes(
+    __in PCPUINFO_RECORD_CONTEXT RecordContext,
+    __out PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Sample
+    )
+{
+    WORD GroupIndex;
+    DWORD BufferSize;
+    DWORD BytesReturned;
+    LONG Status;
+    PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION GroupSample;
+
+    BufferSize = CPUINFO_PROCESSORS_PER_GROUP * sizeof(YORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION);
+
+    for (GroupIndex = 0; GroupIndex < RecordContext->GroupCount; GroupIndex++) {
+        GroupSample = &Sample[GroupIndex * CPUINFO_PROCESSORS_PER_GROUP];
+        BytesReturned = 0;
+
+        //
+        //  If the Ex version is available, it can query any processor group.
+        //  The non-Ex version only returns the group of the calling thread,
+        //  which is fine on systems that only support one group.
+        //
+
+        if (DllNtDll.pNtQuerySystemInformationEx != NULL) {
+            Status = DllNtDll.pNtQuerySystemInformationEx(SystemProcessorPerformanceInformation, &GroupIndex, sizeof(GroupIndex), GroupSample, BufferSize, &BytesReturned);
+        } else {
+            Status = DllNtDll.pNtQuerySystemInformation(SystemProcessorPerformanceInformation, GroupSample, BufferSize, &BytesReturned);
+        }
+
+        if (Status != 0) {
+            return FALSE;
+        }
+
+        RecordContext->GroupProcessorCount[GroupIndex] = BytesReturned / sizeof(YORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION);
+    }
+
+    return TRUE;
+}
+
+/**
+ Record the NUMA node and core of each logical processor and determine the
+ order that processors should be displayed.
+
+ @param CpuInfoContext Pointer to the context containing processor layout.
+        If topology information was not loaded, processors are displayed in
+        numerical order without any NUMA node or core information.
+
+ @param RecordContext Pointer to the record context, which should have
+        GroupProcessorCount populated from an initial sample.
+ */
+VOID
+CpuInfoBuildRecordOrder(
+    __in PCPUINFO_CONTEXT CpuInfoContext,
+    __inout PCPUINFO_RECORD_CONTEXT RecordContext
+    )
+{
+    PYORI_SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX Entry;
+    PYORI_PROCESSOR_GROUP_AFFINITY Group;
+    DWORD CurrentOffset;
+    DWORD CoreIndex;
+    DWORD GroupIndex;
+    DWORD Index;
+    DWORD InsertIndex;
+    DWORD LogicalProcessorIndex;
+    DWORD_PTR LogicalProcessorMask;
+    DWORD Processor;
+    DWORD Candidate;
+
+    for (Index = 0; Index < RecordContext->ProcessorSlots; Index++) {
+        RecordContext->NumaNode[Index] = CPUINFO_UNKNOWN_INDEX;
+        RecordContext->Core[Index] = CPUINFO_UNKNOWN_INDEX;
+    }
+
+    if (CpuInfoContext->TopologyLoaded) {
+        CurrentOffset = 0;
+        CoreIndex = 0;
+        Entry = CpuInfoContext->ProcInfo;
+
+        while (Entry != NULL) {
+
+            if (Entry->Relationship == YoriProcessorRelationProcessorCore) {
+                for (GroupIndex = 0; GroupIndex < Entry->u.Processor.GroupCount; GroupIndex++) {
+                    Group = &Entry->u.Processor.GroupMask[GroupIndex];
+                    for (LogicalProcessorIndex = 0; LogicalProcessorIndex < 8 * sizeof(DWORD_PTR); LogicalProcessorIndex++) {
+                        LogicalProcessorMask = 1;
+                        LogicalProcessorMask = LogicalProcessorMask<<LogicalProcessorIndex;
+                        Processor = Group->Group * CPUINFO_PROCESSORS_PER_GROUP + LogicalProcessorIndex;
+                        if ((Group->Mask & LogicalProcessorMask) && Processor < RecordContext->ProcessorSlots) {
+                            RecordContext->Core[Processor] = CoreIndex;
+                        }
+                    }
+                }
+                CoreIndex++;
+            } else if (Entry->Relationship == YoriProcessorRelationNumaNode) {
+                Group = &Entry->u.NumaNode.GroupMask;
+                for (LogicalProcessorIndex = 0; LogicalProcessorIndex < 8 * sizeof(DWORD_PTR); LogicalProcessorIndex++) {
+                    LogicalProcessorMask = 1;
+                    LogicalProcessorMask = LogicalProcessorMask<<LogicalProcessorIndex;
+                    Processor = Group->Group * CPUINFO_PROCESSORS_PER_GROUP + LogicalProcessorIndex;
+                    if ((Group->Mask & LogicalProcessorMask) && Processor < RecordContext->ProcessorSlots) {
+                        RecordContext->NumaNode[Processor] = Entry->u.NumaNode.NodeNumber;
+                    }
+                }
+            }
+
+            CurrentOffset += Entry->SizeInBytes;
+            if (CurrentOffset >= CpuInfoContext->BytesInBuffer) {
+                break;
+            }
+            Entry = YoriLibAddToPointer(CpuInfoContext->ProcInfo, CurrentOffset);
+        }
+    }
+
+    //
+    //  Insert each processor into the order sorted by NUMA node, then core,
+    //  then processor number.  The number of processors is small and this
+    //  is only done once, so an insertion sort is sufficient.  Since
+    //  processors are visited in numerical order, they only need to move
+    //  past processors with a larger node or core.
+    //
+
+    RecordContext->OrderCount = 0;
+    for (GroupIndex = 0; GroupIndex < RecordContext->GroupCount; GroupIndex++) {
+        for (LogicalProcessorIndex = 0; LogicalProcessorIndex < RecordContext->GroupProcessorCount[GroupIndex]; LogicalProcessorIndex++) {
+            Processor = GroupIndex * CPUINFO_PROCESSORS_PER_GROUP + LogicalProcessorIndex;
+            InsertIndex = RecordContext->OrderCount;
+            while (InsertIndex > 0) {
+                Candidate = RecordContext->Order[InsertIndex - 1];
+                if (RecordContext->NumaNode[Candidate] < RecordContext->NumaNode[Processor] ||
+                    (RecordContext->NumaNode[Candidate] == RecordContext->NumaNode[Processor] &&
+                     RecordContext->Core[Candidate] <= RecordContext->Core[Processor])) {
+
+                    break;
+                }
+                RecordContext->Order[InsertIndex] = Candidate;
+                InsertIndex--;
+            }
+            RecordContext->Order[InsertIndex] = Processor;
+            RecordContext->OrderCount++;
+        }
+    }
+}
+
+/**
+ Output a percentage, specified in hundredths of a percent, as a CSV field.
+
+ @param Part The amount of time spent in the state being measured.
+
+ @param Total The total amount of time.
+ */
+VOID
+CpuInfoOutputPercentField(
+    __in DWORDLONG Part,
+    __in DWORDLONG Total
+    )
+{
+    DWORD Percent;
+
+    Percent = 0;
+    if (Total > 0) {
+        if (Part > Total) {
+            Part = Total;
+        }
+        Percent = (DWORD)(Part * 10000 / Total);
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T(",%i.%02i"), Percent / 100, Percent % 100);
+}
+
+/**
+ Output a NUMA node or core index as a CSV field, leaving the field empty if
+ the value is not known.
+
+ @param Value The value to output.
+ */
+VOID
+CpuInfoOutputIndexField(
+    __in DWORD Value
+    )
+{
+    if (Value == CPUINFO_UNKNOWN_INDEX) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T(","));
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T(",%i"), Value);
+    }
+}
+
+/**
+ Repeatedly sample the time spent by each logical processor and output the
+ utilization, DPC and interrupt time of each as CSV, grouped by NUMA node
+ and core.  This continues until the user cancels.
+
+ @param CpuInfoContext Pointer to the context containing processor layout.
+
+ @param Interval The number of milliseconds between samples.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+CpuInfoRecordUtilization(
+    __in PCPUINFO_CONTEXT CpuInfoContext,
+    __in DWORD Interval
+    )
+{
+    CPUINFO_RECORD_CONTEXT RecordContext;
+    PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Previous;
+    PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Current;
+    PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Swap;
+    DWORDLONG IdleDelta;
+    DWORDLONG KernelDelta;
+    DWORDLONG UserDelta;
+    DWORDLONG DpcDelta;
+    DWORDLONG InterruptDelta;
+    DWORDLONG TotalDelta;
+    DWORDLONG KernelOnlyDelta;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER SampleTime;
+    DWORD Index;
+    DWORD Processor;
+    HANDLE CancelHandle;
+    BOOL Result;
+
+    if (DllNtDll.pNtQuerySystemInformation == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("OS support not present\n"));
+        return FALSE;
+    }
+
+    ZeroMemory(&RecordContext, sizeof(RecordContext));
+
+    RecordContext.GroupCount = 1;
+    if (DllNtDll.pNtQuerySystemInformationEx != NULL &&
+        CpuInfoContext->TopologyLoaded &&
+        CpuInfoContext->GroupCount.QuadPart > 1) {
+
+        RecordContext.GroupCount = (WORD)CpuInfoContext->GroupCount.QuadPart;
+    }
+
+    RecordContext.ProcessorSlots = RecordContext.GroupCount * CPUINFO_PROCESSORS_PER_GROUP;
+    RecordContext.SampleBufferSize = (YORI_ALLOC_SIZE_T)(RecordContext.ProcessorSlots * sizeof(YORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION));
+
+    RecordContext.Samples[0] = YoriLibMalloc(RecordContext.SampleBufferSize);
+    RecordContext.Samples[1] = YoriLibMalloc(RecordContext.SampleBufferSize);
+    RecordContext.GroupProcessorCount = YoriLibMalloc(RecordContext.GroupCount * sizeof(DWORD));
+    RecordContext.NumaNode = YoriLibMalloc(RecordContext.ProcessorSlots * sizeof(DWORD));
+    RecordContext.Core = YoriLibMalloc(RecordContext.ProcessorSlots * sizeof(DWORD));
+    RecordContext.Order = YoriLibMalloc(RecordContext.ProcessorSlots * sizeof(DWORD));
+
+    if (RecordContext.Samples[0] == NULL ||
+        RecordContext.Samples[1] == NULL ||
+        RecordContext.GroupProcessorCount == NULL ||
+        RecordContext.NumaNode == NULL ||
+        RecordContext.Core == NULL ||
+        RecordContext.Order == NULL) {
+
+        CpuInfoCleanupRecordContext(&RecordContext);
+        return FALSE;
+    }
+
+    Previous = RecordContext.Samples[0];
+    Current = RecordContext.Samples[1];
+
+    if (!CpuInfoCaptureProcessorTimes(&RecordContext, Previous)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cpuinfo: could not query processor times\n"));
+        CpuInfoCleanupRecordContext(&RecordContext);
+        return FALSE;
+    }
+    StartTime.QuadPart = YoriLibGetSystemTimeAsInteger();
+
+    CpuInfoBuildRecordOrder(CpuInfoContext, &RecordContext);
+
+#if YORI_BUILTIN
+    YoriLibCancelEnable(FALSE);
+#endif
+    CancelHandle = YoriLibCancelGetEvent();
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Time,Processor,Node,Core,Busy,User,Kernel,Dpc,Interrupt,Interrupts\n"));
+    Result = TRUE;
+
+    while (TRUE) {
+        if (CancelHandle != NULL) {
+            if (WaitForSingleObject(CancelHandle, Interval) == WAIT_OBJECT_0) {
+                break;
+            }
+        } else {
+            Sleep(Interval);
+        }
+
+        if (!CpuInfoCaptureProcessorTimes(&RecordContext, Current)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cpuinfo: could not query processor times\n"));
+            Result = FALSE;
+            break;
+        }
+        SampleTime.QuadPart = YoriLibGetSystemTimeAsInteger();
+
+        for (Index = 0; Index < RecordContext.OrderCount; Index++) {
+            Processor = RecordContext.Order[Index];
+
+            IdleDelta = Current[Processor].IdleTime.QuadPart - Previous[Processor].IdleTime.QuadPart;
+            KernelDelta = Current[Processor].KernelTime.QuadPart - Previous[Processor].KernelTime.QuadPart;
+            UserDelta = Current[Processor].UserTime.QuadPart - Previous[Processor].UserTime.QuadPart;
+            DpcDelta = Current[Processor].DpcTime.QuadPart - Previous[Processor].DpcTime.QuadPart;
+            InterruptDelta = Current[Processor].InterruptTime.QuadPart - Previous[Processor].InterruptTime.QuadPart;
+
+            //
+            //  Kernel time includes idle, DPC and interrupt time.  Report
+            //  these separately.
+            //
+
+            TotalDelta = KernelDelta + UserDelta;
+            if (IdleDelta > TotalDelta) {
+                IdleDelta = TotalDelta;
+            }
+
+            KernelOnlyDelta = 0;
+            if (KernelDelta > IdleDelta + DpcDelta + InterruptDelta) {
+                KernelOnlyDelta = KernelDelta - IdleDelta - DpcDelta - InterruptDelta;
+            }
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                          _T("%lli,%i"),
+                          (SampleTime.QuadPart - StartTime.QuadPart) / (10 * 1000),
+                          Processor);
+            CpuInfoOutputIndexField(RecordContext.NumaNode[Processor]);
+            CpuInfoOutputIndexField(RecordContext.Core[Processor]);
+            CpuInfoOutputPercentField(TotalDelta - IdleDelta, TotalDelta);
+            CpuInfoOutputPercentField(UserDelta, TotalDelta);
+            CpuInfoOutputPercentField(KernelOnlyDelta, TotalDelta);
+            CpuInfoOutputPercentField(DpcDelta, TotalDelta);
+            CpuInfoOutputPercentField(InterruptDelta, TotalDelta);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                          _T(",%i\n"),
+                          Current[Processor].InterruptCount - Previous[Processor].InterruptCount);
+        }
+
+        Swap = Previous;
+        Previous = Current;
+        Current = Swap;
+    }
+
+    CpuInfoCleanupRecordContext(&RecordContext);
+    return Result;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the cpuinfo builtin command.
@@ -1065,6 +1531,7 @@ ENTRYPOINT(
     BOOLEAN DisplayFormatString = TRUE;
     BOOLEAN InsertNewline = FALSE;
     BOOLEAN DisplayGraph = TRUE;
+    DWORD RecordInterval = 0;
     YORI_STRING Arg;
     CPUINFO_CONTEXT CpuInfoContext;
     YORI_STRING DisplayString;
@@ -1109,6 +1576,21 @@ ENTRYPOINT(
                 DisplayNuma = TRUE;
                 DisplayFormatString = FALSE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0 &&
+                       i + 1 < ArgC) {
+
+                YORI_MAX_SIGNED_T llTemp;
+                YORI_ALLOC_SIZE_T CharsConsumed;
+
+                llTemp = 0;
+                if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp > 0) {
+
+                    RecordInterval = (DWORD)llTemp;
+                    ArgumentUnderstood = TRUE;
+                    i = i + 1;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 DisplaySockets = TRUE;
                 DisplayFormatString = FALSE;
@@ -1168,6 +1650,19 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
+    if (RecordInterval > 0) {
+        if (!CpuInfoRecordUtilization(&CpuInfoContext, RecordInterval)) {
+            if (CpuInfoContext.ProcInfo != NULL) {
+                YoriLibFree(CpuInfoContext.ProcInfo);
+            }
+            return EXIT_FAILURE;
+        }
+        if (CpuInfoContext.ProcInfo != NULL) {
+            YoriLibFree(CpuInfoContext.ProcInfo);
+        }
+        return EXIT_SUCCESS;
+    }
+
     if (DisplayCores) {
         CpuInfoDisplayCores(&CpuInfoContext);
         InsertNewline = TRUE;
@@ -69,6 +69,174 @@
 #define MINICRT_BUILD
 #include "yoricrt.h"
 
+
+/**
+ The largest unit that can be loaded or stored in a single register on the
+ target architecture.  Bulk operations move data in units of this size once
+ the destination has been aligned.
+ */
+#if defined(_WIN64)
+typedef unsigned __int64 MCRT_WORD;
+#else
+typedef unsigned long MCRT_WORD;
+#endif
+
+/**
+ A mask of the low bits of an address which must be clear for the address
+ to be aligned to an MCRT_WORD.
+ */
+#define MCRT_WORD_MASK (sizeof(MCRT_WORD) - 1)
+
+/**
+ Returns nonzero if the specified pointer is aligned to an MCRT_WORD.
+ */
+#define MCRT_IS_WORD_ALIGNED(p) ((((MCRT_WORD)(p)) & MCRT_WORD_MASK) == 0)
+
+/**
+ Returns nonzero if word sized operations can be used between two pointers
+ once the first has been aligned.  On architectures that tolerate unaligned
+ loads the second pointer can have any alignment; on others, such as the
+ Alpha, MIPS and PowerPC systems supported by early versions of NT, both
+ pointers must share the same alignment or word operations would fault.
+ */
+#if defined(_M_IX86) || defined(_M_AMD64) || defined(_M_ARM64)
+#define MCRT_CAN_USE_WORDS(p1, p2) (1)
+#else
+#define MCRT_CAN_USE_WORDS(p1, p2) (((((MCRT_WORD)(p1)) ^ ((MCRT_WORD)(p2))) & MCRT_WORD_MASK) == 0)
+#endif
+
+/**
+ The smallest length where word sized operations are attempted.  Below this
+ the overhead of aligning the buffers exceeds any benefit.
+ */
+#define MCRT_WORD_THRESHOLD (2 * sizeof(MCRT_WORD))
+
+//
+//  Sigh, turn off optimizations now the optimizer is too aggressive to
+//  be helpful, and MSVC doesn't have finer grained tools.  The loops below
+//  look exactly like the functions they implement, and the optimizer will
+//  happily replace them with calls back into those functions.
+//
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1940) && defined(_M_IX86)
+#pragma optimize("", off)
+#endif
+
+/**
+ Copy memory from a lower address to a higher address.  This is used for
+ all disjoint copies, and for overlapping copies where the destination is
+ below the source, since each word is read before any write can reach it.
+
+ @param dest Pointer to the memory block to write to.
+
+ @param src Pointer to the memory block to read from.
+
+ @param len The number of bytes to copy.
+ */
+static void
+mini_memcpy_forward(void * dest, const void * src, unsigned int len)
+#ifdef __clang__
+__attribute__((no_builtin))
+#endif
+{
+    unsigned int words;
+    char * char_dest = (char *)dest;
+    const char * char_src = (const char *)src;
+    MCRT_WORD * word_dest;
+    const MCRT_WORD * word_src;
+
+    if (len >= MCRT_WORD_THRESHOLD && MCRT_CAN_USE_WORDS(char_dest, char_src)) {
+        while (!MCRT_IS_WORD_ALIGNED(char_dest)) {
+            *char_dest = *char_src;
+            char_dest++;
+            char_src++;
+            len--;
+        }
+
+        word_dest = (MCRT_WORD *)char_dest;
+        word_src = (const MCRT_WORD *)char_src;
+        words = len / sizeof(MCRT_WORD);
+        len = len & MCRT_WORD_MASK;
+
+        for (; words >= 4; words -= 4) {
+            word_dest[0] = word_src[0];
+            word_dest[1] = word_src[1];
+            word_dest[2] = word_src[2];
+            word_dest[3] = word_src[3];
+            word_dest += 4;
+            word_src += 4;
+        }
+
+        for (; words > 0; words--) {
+            *word_dest = *word_src;
+            word_dest++;
+            word_src++;
+        }
+
+        char_dest = (char *)word_dest;
+        char_src = (const char *)word_src;
+    }
+
+    for (; len > 0; len--) {
+        *char_dest = *char_src;
+        char_dest++;
+        char_src++;
+    }
+}
+
+/**
+ Copy memory starting from the end of the buffers and moving towards the
+ beginning.  This is used for overlapping copies where the destination is
+ above the source.
+
+ @param dest Pointer to the memory block to write to.
+
+ @param src Pointer to the memory block to read from.
+
+ @param len The number of bytes to copy.
+ */
+static void
+mini_memcpy_backward(void * dest, const void * src, unsigned int len)
+#ifdef __clang__
+__attribute__((no_builtin))
+#endif
+{
+    unsigned int words;
+    char * char_dest = (char *)dest + len;
+    const char * char_src = (const char *)src + len;
+    MCRT_WORD * word_dest;
+    const MCRT_WORD * word_src;
+
+    if (len >= MCRT_WORD_THRESHOLD && MCRT_CAN_USE_WORDS(char_dest, char_src)) {
+        while (!MCRT_IS_WORD_ALIGNED(char_dest)) {
+            char_dest--;
+            char_src--;
+            *char_dest = *char_src;
+            len--;
+        }
+
+        word_dest = (MCRT_WORD *)char_dest;
+        word_src = (const MCRT_WORD *)char_src;
+        words = len / sizeof(MCRT_WORD);
+        len = len & MCRT_WORD_MASK;
+
+        for (; words > 0; words--) {
+            word_dest--;
+            word_src--;
+            *word_dest = *word_src;
+        }
+
+        char_dest = (char *)word_dest;
+        char_src = (const char *)word_src;
+    }
+
+    for (; len > 0; len--) {
+        char_dest--;
+        char_src--;
+        *char_dest = *char_src;
+    }
+}
+
 /**
  Copy the contents of one memory block into another memory block where the
  two memory blocks must be disjoint so no consideration is made for writing
@@ -86,12 +254,7 @@ void *
 MCRT_FN
 mini_memcpy(void * dest, const void * src, unsigned int len)
 {
-    unsigned int i;
-    char * char_src = (char *)src;
-    char * char_dest = (char *)dest;
-    for (i = 0; i < len; i++) {
-        char_dest[i] = char_src[i];
-    }
+    mini_memcpy_forward(dest, src, len);
     return dest;
 }
 
@@ -112,34 +275,16 @@ void *
 MCRT_FN
 mini_memmove(void * dest, const void * src, unsigned int len)
 {
-    unsigned int i;
     char * char_src = (char *)src;
     char * char_dest = (char *)dest;
-    if (char_dest > char_src) {
-        if (len == 0) {
-            return dest;
-        }
-        for (i = len - 1; ; i--) {
-            char_dest[i] = char_src[i];
-            if (i==0) break;
-        }
-    } else {
-        for (i = 0; i < len; i++) {
-            char_dest[i] = char_src[i];
-        }
+    if (char_dest > char_src && char_dest < char_src + len) {
+        mini_memcpy_backward(dest, src, len);
+    } else if (char_dest != char_src) {
+        mini_memcpy_forward(dest, src, len);
     }
     return dest;
 }
 
-//
-//  Sigh, turn off optimizations now the optimizer is too aggressive to
-//  be helpful, and MSVC doesn't have finer grained tools
-//
-
-#if defined(_MSC_VER) && (_MSC_VER >= 1940) && defined(_M_IX86)
-#pragma optimize("", off)
-#endif
-
 /**
  Set a block of memory to a specific byte value.
 
@@ -158,26 +303,46 @@ mini_memset(void * dest, char c, unsigned int len)
 __attribute__((no_builtin("memset")))
 #endif
 {
-    unsigned int i;
-    unsigned int fill;
-    unsigned int chunks = len / sizeof(fill);
-    char * char_dest = (char *)dest;
-    unsigned int * uint_dest = (unsigned int *)dest;
+    unsigned int words;
+    MCRT_WORD fill;
+    char * char_dest = (char *)dest + len;
+    MCRT_WORD * word_dest;
 
     //
-    //  Note we go from the back to the front.  This is to 
+    //  Note we go from the back to the front.  This is to
     //  prevent newer compilers from noticing what we're doing
     //  and trying to invoke the built-in memset instead of us.
     //
 
-    fill = (c<<24) + (c<<16) + (c<<8) + c;
+    fill = (unsigned char)c;
+    fill = fill | (fill << 8);
+    fill = fill | (fill << 16);
+#if defined(_WIN64)
+    fill = fill | (fill << 32);
+#endif
+
+    if (len >= MCRT_WORD_THRESHOLD) {
+        while (!MCRT_IS_WORD_ALIGNED(char_dest)) {
+            char_dest--;
+            *char_dest = c;
+            len--;
+        }
 
-    for (i = len; i > chunks * sizeof(fill); i--) {
-        char_dest[i - 1] = c;
+        word_dest = (MCRT_WORD *)char_dest;
+        words = len / sizeof(MCRT_WORD);
+        len = len & MCRT_WORD_MASK;
+
+        for (; words > 0; words--) {
+            word_dest--;
+            *word_dest = fill;
+        }
+
+        char_dest = (char *)word_dest;
     }
 
-    for (i = chunks; i > 0; i--) {
-        uint_dest[i - 1] = fill;
+    for (; len > 0; len--) {
+        char_dest--;
+        *char_dest = c;
     }
 
     return dest;
@@ -205,15 +370,48 @@ int
 MCRT_FN
 mini_memcmp(const void * buf1, const void * buf2, unsigned int len)
 {
-    unsigned int i = 0;
-    unsigned char * char_buf1 = (unsigned char *)buf1;
-    unsigned char * char_buf2 = (unsigned char *)buf2;
-    for (i = 0; i < len; i++) {
-        if (char_buf1[i] < char_buf2[i]) {
+    const unsigned char * char_buf1 = (const unsigned char *)buf1;
+    const unsigned char * char_buf2 = (const unsigned char *)buf2;
+    const MCRT_WORD * word_buf1;
+    const MCRT_WORD * word_buf2;
+
+    //
+    //  Skip over equal words, then let the byte loop find which byte within
+    //  the first unequal word differs, since word comparisons don't
+    //  preserve byte ordering on little endian systems.
+    //
+
+    if (len >= MCRT_WORD_THRESHOLD && MCRT_CAN_USE_WORDS(char_buf1, char_buf2)) {
+        while (!MCRT_IS_WORD_ALIGNED(char_buf1)) {
+            if (*char_buf1 != *char_buf2) {
+                break;
+            }
+            char_buf1++;
+            char_buf2++;
+            len--;
+        }
+
+        if (MCRT_IS_WORD_ALIGNED(char_buf1)) {
+            word_buf1 = (const MCRT_WORD *)char_buf1;
+            word_buf2 = (const MCRT_WORD *)char_buf2;
+            while (len >= sizeof(MCRT_WORD) && *word_buf1 == *word_buf2) {
+                word_buf1++;
+                word_buf2++;
+                len -= sizeof(MCRT_WORD);
+            }
+            char_buf1 = (const unsigned char *)word_buf1;
+            char_buf2 = (const unsigned char *)word_buf2;
+        }
+    }
+
+    for (; len > 0; len--) {
+        if (*char_buf1 < *char_buf2) {
             return -1;
-        } else if (char_buf1[i] > char_buf2[i]) {
+        } else if (*char_buf1 > *char_buf2) {
             return 1;
         }
+        char_buf1++;
+        char_buf2++;
     }
     return 0;
 }
@@ -570,13 +570,21 @@ mini_tcsnicmp(const TCHAR * str1, const TCHAR * str2, unsigned int count)
     const TCHAR * ptr1 = str1;
     const TCHAR * ptr2 = str2;
     unsigned int remaining = count;
+    int char1;
+    int char2;
 
     while(remaining > 0) {
-        if (mini_ttoupper(*ptr1) < mini_ttoupper(*ptr2)) {
-            return -1;
-        } else if (mini_ttoupper(*ptr1) > mini_ttoupper(*ptr2)) {
-            return 1;
-        } else if (*ptr1 == '\0') {
+        char1 = *ptr1;
+        char2 = *ptr2;
+        if (char1 != char2) {
+            char1 = mini_ttoupper(char1);
+            char2 = mini_ttoupper(char2);
+            if (char1 < char2) {
+                return -1;
+            } else if (char1 > char2) {
+                return 1;
+            }
+        } else if (char1 == '\0') {
             return 0;
         }
         ptr1++;
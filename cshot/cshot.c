@@ -35,9 +35,10 @@ CHAR strCshotHelpText[] =
         "\n"
         "Captures previous output on the console and outputs to standard output.\n"
         "\n"
-        "CSHOT [-license] [-s num] [-c num]\n"
+        "CSHOT [-license] [-p] [-s num] [-c num]\n"
         "\n"
         "   -c             The number of lines to capture\n"
+        "   -p             Capture plain text without color\n"
         "   -s             The number of lines to skip\n";
 
 /**
@@ -89,6 +90,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
     YORI_MAX_SIGNED_T Temp;
     YORI_ALLOC_SIZE_T CharsConsumed;
+    DWORD Flags = 0;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -112,6 +114,9 @@ ENTRYPOINT(
                         i++;
                     }
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
+                Flags = Flags | YORILIB_REWRITE_CONSOLE_PLAIN_TEXT;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 if (ArgC > i + 1) {
                     if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &Temp, &CharsConsumed)) {
@@ -128,7 +133,7 @@ ENTRYPOINT(
         }
     }
 
-    if (!YoriLibRewriteConsoleContents(GetStdHandle(STD_OUTPUT_HANDLE), LineCount, SkipCount)) {
+    if (!YoriLibRewriteConsoleContents(GetStdHandle(STD_OUTPUT_HANDLE), LineCount, SkipCount, Flags)) {
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
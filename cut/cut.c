@@ -35,15 +35,16 @@ CHAR strCutHelpText[] =
         "\n"
         "Outputs a portion of an input buffer of text.\n"
         "\n"
-        "CUT [-license] [-b] [-s] [-f n] [-d <delimiter chars>] [-o n] [-l n]\n"
-        "    [[-i] -t <text>] [file]\n"
+        "CUT [-license] [-b] [-s] [-f n[,n...]] [-d <delimiter chars>] [-q] [-o n]\n"
+        "    [-l n] [[-i] -t <text>] [file]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -d             The set of characters which delimit fields, default comma\n"
-        "   -f n           The field number to cut\n"
+        "   -f n[,n...]    The field number or numbers to cut\n"
         "   -i             Match text case insensitively\n"
         "   -l             The length in bytes to cut from the line or field\n"
         "   -o             The offset in bytes to cut from the line or field\n"
+        "   -q             Delimiters within double quotes do not separate fields\n"
         "   -r             Operate on raw file offsets, not lines\n"
         "   -t text        Start matching offsets from the portion of line matching text\n"
         "   -s             Match files from all subdirectories\n"
@@ -63,6 +64,29 @@ CutHelp(VOID)
     return TRUE;
 }
 
+/**
+ The number of characters whose delimiter status is resolved through a
+ lookup table.  Characters above this value are compared against the
+ delimiter string.
+ */
+#define CUT_DELIMITER_TABLE_SIZE 128
+
+/**
+ Describes the location of a single field within a line.
+ */
+typedef struct _CUT_FIELD {
+
+    /**
+     The offset of the field from the start of the line, in characters.
+     */
+    YORI_ALLOC_SIZE_T Offset;
+
+    /**
+     The length of the field, in characters.
+     */
+    YORI_ALLOC_SIZE_T Length;
+} CUT_FIELD, *PCUT_FIELD;
+
 /**
  Context describing the operations to perform on each file found.
  */
@@ -92,6 +116,18 @@ typedef struct _CUT_CONTEXT {
      */
     BOOLEAN CaseInsensitive;
 
+    /**
+     TRUE if delimiters found within double quotes should be treated as
+     part of a field rather than separating fields.
+     */
+    BOOLEAN QuotedFields;
+
+    /**
+     For each character below CUT_DELIMITER_TABLE_SIZE, TRUE if the
+     character is a field delimiter.
+     */
+    BOOLEAN DelimiterTable[CUT_DELIMITER_TABLE_SIZE];
+
     /**
      Start processing the line from any matching text.  If empty, the entire
      line is used.
@@ -113,10 +149,27 @@ typedef struct _CUT_CONTEXT {
     DWORD SavedErrorThisArg;
 
     /**
-     For a field delimited stream, indicates the field number that should
-     be output.
+     For a field delimited stream, an array of field numbers that should
+     be output, in the order they should be output.
+     */
+    PDWORD FieldsOfInterest;
+
+    /**
+     The number of elements in the FieldsOfInterest array.
+     */
+    DWORD FieldOfInterestCount;
+
+    /**
+     The highest field number within FieldsOfInterest.  Lines are only
+     scanned as far as the end of this field.
+     */
+    DWORD HighestFieldOfInterest;
+
+    /**
+     An array of HighestFieldOfInterest + 1 elements, populated with the
+     location of each field in the line currently being processed.
      */
-    DWORD FieldOfInterest;
+    PCUT_FIELD Fields;
 
     /**
      Indicates the offset of the line or field, in bytes, that is of interest.
@@ -141,10 +194,197 @@ typedef struct _CUT_CONTEXT {
 
 } CUT_CONTEXT, *PCUT_CONTEXT;
 
+/**
+ Return the character at a specified offset within a line view.
+ */
+#define CUT_VIEW_CHAR(View, Index) \
+    ((View)->WideChars?((PWCHAR)(View)->Buffer)[Index]:(WCHAR)((PUCHAR)(View)->Buffer)[Index])
+
+/**
+ Indicate whether a character is a field delimiter.
+
+ @param CutContext The context that describes the delimiters.
+
+ @param Char The character to check.
+
+ @return TRUE if the character is a field delimiter, FALSE if it is not.
+ */
+BOOLEAN
+CutIsDelimiter(
+    __in PCUT_CONTEXT CutContext,
+    __in TCHAR Char
+    )
+{
+    LPTSTR Seperator;
+
+    if (Char < CUT_DELIMITER_TABLE_SIZE) {
+        return CutContext->DelimiterTable[Char];
+    }
+
+    for (Seperator = CutContext->FieldSeperator; *Seperator != '\0'; Seperator++) {
+        if (*Seperator == Char) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Locate the fields within a line in a single pass, populating the Fields
+ array in the cut context.  Scanning stops once the highest field that
+ the user is interested in has been found, so the remainder of the line is
+ never examined.
+
+ @param View Pointer to the line to scan.
+
+ @param StartOffset The offset within the line to start scanning from.
+
+ @param CutContext The context that describes the delimiters and receives
+        the location of each field.
+
+ @return The number of fields found, which is at most
+         HighestFieldOfInterest + 1.
+ */
+DWORD
+CutFindFields(
+    __in PYORI_LIB_LINE_VIEW View,
+    __in YORI_ALLOC_SIZE_T StartOffset,
+    __in PCUT_CONTEXT CutContext
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T FieldStart;
+    DWORD FieldsFound;
+    BOOLEAN InQuotes;
+    TCHAR Char;
+
+    FieldsFound = 0;
+    FieldStart = StartOffset;
+    InQuotes = FALSE;
+
+    for (Index = StartOffset; Index < View->LengthInChars; Index++) {
+        Char = CUT_VIEW_CHAR(View, Index);
+
+        //
+        //  A doubled quote within a quoted field toggles the state twice,
+        //  so it remains part of the field.
+        //
+
+        if (CutContext->QuotedFields && Char == '"') {
+            InQuotes = (BOOLEAN)!InQuotes;
+            continue;
+        }
+
+        if (!InQuotes && CutIsDelimiter(CutContext, Char)) {
+            CutContext->Fields[FieldsFound].Offset = FieldStart;
+            CutContext->Fields[FieldsFound].Length = (YORI_ALLOC_SIZE_T)(Index - FieldStart);
+            FieldsFound++;
+            if (FieldsFound > CutContext->HighestFieldOfInterest) {
+                return FieldsFound;
+            }
+            FieldStart = (YORI_ALLOC_SIZE_T)(Index + 1);
+        }
+    }
+
+    CutContext->Fields[FieldsFound].Offset = FieldStart;
+    CutContext->Fields[FieldsFound].Length = (YORI_ALLOC_SIZE_T)(View->LengthInChars - FieldStart);
+    FieldsFound++;
+
+    return FieldsFound;
+}
+
+/**
+ Append a range of a line to an output string, converting from the input
+ encoding as needed.  Only the requested range is copied.
+
+ @param View Pointer to the line containing the range.  This must not
+        require conversion.
+
+ @param Offset The offset of the range within the line, in characters.
+
+ @param Length The length of the range, in characters.
+
+ @param Output The string to append to.  This will be reallocated if it is
+        not large enough.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CutAppendRange(
+    __in PYORI_LIB_LINE_VIEW View,
+    __in YORI_ALLOC_SIZE_T Offset,
+    __in YORI_ALLOC_SIZE_T Length,
+    __inout PYORI_STRING Output
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    PUCHAR SourceBuffer;
+
+    ASSERT(!View->NeedsConversion);
+
+    if (Output->LengthInChars + Length + 1 > Output->LengthAllocated) {
+        if (!YoriLibReallocateString(Output, Output->LengthInChars + Length + 1 + 256)) {
+            return FALSE;
+        }
+    }
+
+    if (View->WideChars) {
+        memcpy(&Output->StartOfString[Output->LengthInChars], &((PWCHAR)View->Buffer)[Offset], Length * sizeof(WCHAR));
+    } else {
+        SourceBuffer = (PUCHAR)View->Buffer;
+        for (Index = 0; Index < Length; Index++) {
+            Output->StartOfString[Output->LengthInChars + Index] = SourceBuffer[Offset + Index];
+        }
+    }
+
+    Output->LengthInChars = Output->LengthInChars + Length;
+    return TRUE;
+}
+
+/**
+ Apply the user's requested offset and length to a range of a line.
+
+ @param Range On input, the range of the line or field.  On output, the
+        subset of that range that the user requested.
+
+ @param DesiredOffset The offset within the range that the user requested.
+
+ @param DesiredLength The length that the user requested, or zero to
+        indicate the remainder of the range.
+ */
+VOID
+CutApplyDesiredRange(
+    __inout PCUT_FIELD Range,
+    __in YORI_ALLOC_SIZE_T DesiredOffset,
+    __in YORI_ALLOC_SIZE_T DesiredLength
+    )
+{
+    if (Range->Length > DesiredOffset) {
+        Range->Offset = Range->Offset + DesiredOffset;
+        Range->Length = Range->Length - DesiredOffset;
+
+        if (DesiredLength != 0 &&
+            Range->Length > DesiredLength) {
+
+            Range->Length = DesiredLength;
+        }
+    } else {
+        Range->Length = 0;
+    }
+}
+
 /**
  Process an incoming stream from a single handle in line mode, applying the
  user requested actions.
 
+ Lines are read as views into the line reader's buffer.  Each line is
+ scanned once to locate every field of interest, and only the selected
+ ranges are copied into the output string.  Lines are only converted in
+ full if they contain characters that cannot be widened directly, or if
+ text matching requires a string to search.
+
  @param hSource The source handle containing data to process.
 
  @param CutContext The context that describes the actions to perform.
@@ -157,11 +397,21 @@ CutProcessHandleLines(
     __in PCUT_CONTEXT CutContext
     )
 {
-    YORI_STRING MatchingSubset;
     PVOID LineContext = NULL;
+    YORI_LIB_LINE_VIEW LineView;
     YORI_STRING LineString;
+    YORI_STRING OutputString;
     YORI_ALLOC_SIZE_T DesiredOffset;
     YORI_ALLOC_SIZE_T DesiredLength;
+    YORI_ALLOC_SIZE_T StartOffset;
+    YORI_ALLOC_SIZE_T OffsetOfMatch;
+    DWORD FieldsFound;
+    DWORD Index;
+    DWORD FieldNumber;
+    CUT_FIELD Range;
+    BOOLEAN MatchFound;
+    BOOLEAN DataFound;
+    BOOL Result;
 
     //
     //  Truncate the desired offset and length to 32 bits.  The line
@@ -173,82 +423,266 @@ CutProcessHandleLines(
     DesiredLength = (YORI_ALLOC_SIZE_T)CutContext->DesiredLength;
 
     YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&OutputString);
+    Result = TRUE;
 
     while (TRUE) {
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        if (!YoriLibReadLineView(&LineView, &LineContext, hSource)) {
             break;
         }
 
-        YoriLibInitEmptyString(&MatchingSubset);
+        //
+        //  If the line cannot be widened directly, or text matching needs
+        //  a string to search, convert the line and describe the converted
+        //  string as a view so the remaining logic is common.
+        //
 
-        MatchingSubset.StartOfString = LineString.StartOfString;
-        MatchingSubset.LengthInChars = LineString.LengthInChars;
+        if (LineView.NeedsConversion || CutContext->MatchText.LengthInChars > 0) {
+            if (!YoriLibLineViewToString(&LineView, &LineString)) {
+                Result = FALSE;
+                break;
+            }
+
+            LineView.Buffer = LineString.StartOfString;
+            LineView.LengthInChars = LineString.LengthInChars;
+            LineView.WideChars = TRUE;
+            LineView.NeedsConversion = FALSE;
+        }
 
+        StartOffset = 0;
         if (CutContext->MatchText.LengthInChars > 0) {
-            YORI_ALLOC_SIZE_T OffsetOfMatch;
-            BOOLEAN MatchFound;
             MatchFound = FALSE;
             if (CutContext->CaseInsensitive) {
-                if (YoriLibFindFirstMatchingSubstringInsensitive(&MatchingSubset, 1, &CutContext->MatchText, &OffsetOfMatch)) {
+                if (YoriLibFindFirstMatchingSubstringInsensitive(&LineString, 1, &CutContext->MatchText, &OffsetOfMatch)) {
                     MatchFound = TRUE;
                 }
             } else {
-                if (YoriLibFindFirstMatchingSubstring(&MatchingSubset, 1, &CutContext->MatchText, &OffsetOfMatch)) {
+                if (YoriLibFindFirstMatchingSubstring(&LineString, 1, &CutContext->MatchText, &OffsetOfMatch)) {
                     MatchFound = TRUE;
                 }
             }
 
-            if (MatchFound) {
-                MatchingSubset.StartOfString = &MatchingSubset.StartOfString[OffsetOfMatch];
-                MatchingSubset.LengthInChars = (YORI_ALLOC_SIZE_T)(MatchingSubset.LengthInChars - OffsetOfMatch);
-            } else {
-                MatchingSubset.LengthInChars = 0;
+            if (!MatchFound) {
+                continue;
             }
+
+            StartOffset = OffsetOfMatch;
         }
 
+        OutputString.LengthInChars = 0;
+        DataFound = FALSE;
+
         if (CutContext->FieldDelimited) {
-            YORI_ALLOC_SIZE_T CurrentField = 0;
+            FieldsFound = CutFindFields(&LineView, StartOffset, CutContext);
+
+            for (Index = 0; Index < CutContext->FieldOfInterestCount; Index++) {
+                FieldNumber = CutContext->FieldsOfInterest[Index];
+                if (Index > 0) {
+                    if (OutputString.LengthInChars + 1 >= OutputString.LengthAllocated) {
+                        if (!YoriLibReallocateString(&OutputString, OutputString.LengthInChars + 1 + 256)) {
+                            Result = FALSE;
+                            break;
+                        }
+                    }
+                    OutputString.StartOfString[OutputString.LengthInChars] = CutContext->FieldSeperator[0];
+                    OutputString.LengthInChars++;
+                }
 
-            for (CurrentField = 0; CurrentField <= CutContext->FieldOfInterest; CurrentField++) {
-                YORI_ALLOC_SIZE_T CharsBeforeSeperator;
+                if (FieldNumber >= FieldsFound) {
+                    continue;
+                }
 
-                CharsBeforeSeperator = YoriLibCountStringNotContainingChars(&MatchingSubset, CutContext->FieldSeperator);
-                if (CurrentField == CutContext->FieldOfInterest) {
-                    MatchingSubset.LengthInChars = CharsBeforeSeperator;
-                } else {
-                    MatchingSubset.LengthInChars = MatchingSubset.LengthInChars - CharsBeforeSeperator;
-                    if (MatchingSubset.LengthInChars == 0) {
+                Range.Offset = CutContext->Fields[FieldNumber].Offset;
+                Range.Length = CutContext->Fields[FieldNumber].Length;
+                CutApplyDesiredRange(&Range, DesiredOffset, DesiredLength);
+                if (Range.Length > 0) {
+                    if (!CutAppendRange(&LineView, Range.Offset, Range.Length, &OutputString)) {
+                        Result = FALSE;
                         break;
                     }
-                    MatchingSubset.LengthInChars -= 1;
-                    MatchingSubset.StartOfString = &MatchingSubset.StartOfString[CharsBeforeSeperator + 1];
+                    DataFound = TRUE;
                 }
             }
-        }
-        if (MatchingSubset.LengthInChars > DesiredOffset) {
-            MatchingSubset.StartOfString = &MatchingSubset.StartOfString[DesiredOffset];
-            MatchingSubset.LengthInChars = MatchingSubset.LengthInChars - DesiredOffset;
-
-            if (DesiredLength != 0 &&
-                MatchingSubset.LengthInChars > DesiredLength) {
 
-                MatchingSubset.LengthInChars = DesiredLength;
+            if (!Result) {
+                break;
             }
         } else {
-            MatchingSubset.LengthInChars = 0;
+            Range.Offset = StartOffset;
+            Range.Length = (YORI_ALLOC_SIZE_T)(LineView.LengthInChars - StartOffset);
+            CutApplyDesiredRange(&Range, DesiredOffset, DesiredLength);
+            if (Range.Length > 0) {
+                if (!CutAppendRange(&LineView, Range.Offset, Range.Length, &OutputString)) {
+                    Result = FALSE;
+                    break;
+                }
+                DataFound = TRUE;
+            }
         }
 
-        if (MatchingSubset.LengthInChars > 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &MatchingSubset);
+        if (DataFound) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &OutputString);
         }
     }
 
     YoriLibLineReadCloseOrCache(LineContext);
     YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&OutputString);
+
+    return Result;
+}
+
+/**
+ Parse a comma delimited list of field numbers and record them in the cut
+ context.
+
+ @param FieldList Pointer to the string containing field numbers.
+
+ @param CutContext The context to update with the fields of interest.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CutParseFieldList(
+    __in PYORI_STRING FieldList,
+    __inout PCUT_CONTEXT CutContext
+    )
+{
+    YORI_STRING Remaining;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T FieldCount;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    YORI_MAX_SIGNED_T Temp;
+    PDWORD Fields;
+    DWORD HighestField;
+
+    FieldCount = 1;
+    for (Index = 0; Index < FieldList->LengthInChars; Index++) {
+        if (FieldList->StartOfString[Index] == ',') {
+            FieldCount++;
+        }
+    }
+
+    Fields = YoriLibMalloc(FieldCount * sizeof(DWORD));
+    if (Fields == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Remaining);
+    Remaining.StartOfString = FieldList->StartOfString;
+    Remaining.LengthInChars = FieldList->LengthInChars;
+    HighestField = 0;
+
+    for (Index = 0; Index < FieldCount; Index++) {
+        if (!YoriLibStringToNumber(&Remaining, FALSE, &Temp, &CharsConsumed) ||
+            CharsConsumed == 0 ||
+            Temp < 0 ||
+            Temp >= 0x10000) {
+
+            YoriLibFree(Fields);
+            return FALSE;
+        }
+
+        Fields[Index] = (DWORD)Temp;
+        if (Fields[Index] > HighestField) {
+            HighestField = Fields[Index];
+        }
+
+        Remaining.StartOfString = &Remaining.StartOfString[CharsConsumed];
+        Remaining.LengthInChars = (YORI_ALLOC_SIZE_T)(Remaining.LengthInChars - CharsConsumed);
+
+        if (Index + 1 < FieldCount) {
+            if (Remaining.LengthInChars == 0 || Remaining.StartOfString[0] != ',') {
+                YoriLibFree(Fields);
+                return FALSE;
+            }
+            Remaining.StartOfString++;
+            Remaining.LengthInChars--;
+        }
+    }
+
+    if (CutContext->FieldsOfInterest != NULL) {
+        YoriLibFree(CutContext->FieldsOfInterest);
+    }
+
+    CutContext->FieldsOfInterest = Fields;
+    CutContext->FieldOfInterestCount = FieldCount;
+    CutContext->HighestFieldOfInterest = HighestField;
+    return TRUE;
+}
+
+/**
+ Prepare the cut context for field processing once all arguments have been
+ parsed.  This builds the delimiter lookup table and allocates the array
+ used to record the location of each field in a line.
+
+ @param CutContext The context to prepare.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+CutPrepareFields(
+    __inout PCUT_CONTEXT CutContext
+    )
+{
+    LPTSTR Seperator;
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = 0; Index < CUT_DELIMITER_TABLE_SIZE; Index++) {
+        CutContext->DelimiterTable[Index] = FALSE;
+    }
+
+    for (Seperator = CutContext->FieldSeperator; *Seperator != '\0'; Seperator++) {
+        if (*Seperator < CUT_DELIMITER_TABLE_SIZE) {
+            CutContext->DelimiterTable[*Seperator] = TRUE;
+        }
+    }
+
+    if (!CutContext->FieldDelimited) {
+        return TRUE;
+    }
+
+    if (CutContext->FieldsOfInterest == NULL) {
+        CutContext->FieldsOfInterest = YoriLibMalloc(sizeof(DWORD));
+        if (CutContext->FieldsOfInterest == NULL) {
+            return FALSE;
+        }
+        CutContext->FieldsOfInterest[0] = 0;
+        CutContext->FieldOfInterestCount = 1;
+        CutContext->HighestFieldOfInterest = 0;
+    }
+
+    CutContext->Fields = YoriLibMalloc((CutContext->HighestFieldOfInterest + 1) * sizeof(CUT_FIELD));
+    if (CutContext->Fields == NULL) {
+        return FALSE;
+    }
 
     return TRUE;
 }
 
+/**
+ Free any allocations within the cut context.
+
+ @param CutContext The context to clean up.
+ */
+VOID
+CutCleanupContext(
+    __in PCUT_CONTEXT CutContext
+    )
+{
+    if (CutContext->FieldsOfInterest != NULL) {
+        YoriLibFree(CutContext->FieldsOfInterest);
+        CutContext->FieldsOfInterest = NULL;
+    }
+    if (CutContext->Fields != NULL) {
+        YoriLibFree(CutContext->Fields);
+        CutContext->Fields = NULL;
+    }
+    YoriLibFreeStringContents(&CutContext->MatchText);
+}
+
 /**
  Process an incoming stream in raw file mode, applying the user requested
  actions.
@@ -573,9 +1007,11 @@ ENTRYPOINT(
 
             if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
                 CutHelp();
+                CutCleanupContext(&CutContext);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2017-2024"));
+                CutCleanupContext(&CutContext);
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
@@ -598,15 +1034,12 @@ ENTRYPOINT(
                 }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("f")) == 0) {
                 if (ArgC > i + 1) {
-                    if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &Temp, &CharsConsumed)) {
-                        if (CutContext.RawFile) {
-                            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: Field delimiting incompatible with raw file\n"));
-                        } else {
-                            CutContext.FieldDelimited = TRUE;
-                            CutContext.FieldOfInterest = (DWORD)Temp;
-                            ArgumentUnderstood = TRUE;
-                            i++;
-                        }
+                    if (CutContext.RawFile) {
+                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: Field delimiting incompatible with raw file\n"));
+                    } else if (CutParseFieldList(&ArgV[i + 1], &CutContext)) {
+                        CutContext.FieldDelimited = TRUE;
+                        ArgumentUnderstood = TRUE;
+                        i++;
                     }
                 }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
@@ -620,6 +1053,14 @@ ENTRYPOINT(
                         i++;
                     }
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("q")) == 0) {
+                if (CutContext.RawFile) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: Field delimiting incompatible with raw file\n"));
+                } else {
+                    CutContext.FieldDelimited = TRUE;
+                    CutContext.QuotedFields = TRUE;
+                    ArgumentUnderstood = TRUE;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 if (CutContext.FieldDelimited) {
                     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: Field delimiting incompatible with raw file\n"));
@@ -662,6 +1103,12 @@ ENTRYPOINT(
         CutContext.FieldSeperator = _T(",");
     }
 
+    if (!CutPrepareFields(&CutContext)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: out of memory\n"));
+        CutCleanupContext(&CutContext);
+        return EXIT_FAILURE;
+    }
+
 #if YORI_BUILTIN
     YoriLibCancelEnable(FALSE);
 #endif
@@ -678,7 +1125,7 @@ ENTRYPOINT(
     if (StartArg == 0 || StartArg == ArgC) {
         if (YoriLibIsStdInConsole()) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("cut: No file or pipe for input\n"));
-            YoriLibFreeStringContents(&CutContext.MatchText);
+            CutCleanupContext(&CutContext);
             return EXIT_FAILURE;
         }
         hSource = GetStdHandle(STD_INPUT_HANDLE);
@@ -726,7 +1173,7 @@ ENTRYPOINT(
 #if !YORI_BUILTIN
     YoriLibLineReadCleanupCache();
 #endif
-    YoriLibFreeStringContents(&CutContext.MatchText);
+    CutCleanupContext(&CutContext);
 
     return Result;
 }
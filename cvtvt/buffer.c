@@ -0,0 +1,158 @@
+/**
+ * @file cvtvt/buffer.c
+ *
+ * Buffer converted output before writing it to the output device.
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "cvtvt.h"
+
+/**
+ The number of characters to accumulate before writing to the output device.
+ */
+#define CVTVT_OUTPUT_BUFFER_LENGTH (256 * 1024)
+
+/**
+ Converted output which has not yet been written to the output device.
+ Converters generate text directly into the unused space at the end of this
+ buffer, so that each run of text or escape does not require an allocation
+ and a write to the device.
+ */
+YORI_STRING CvtvtOutputBuffer;
+
+/**
+ Return a string describing the unused space at the end of the output
+ buffer, allocating the buffer if it has not been allocated already.  If the
+ buffer cannot be allocated, the returned string has no space.
+
+ @param Space On completion, updated to describe the unused space at the end
+        of the output buffer.  This string is not allocated.
+ */
+VOID
+CvtvtGetOutputSpace(
+    __out PYORI_STRING Space
+    )
+{
+    YoriLibInitEmptyString(Space);
+
+    if (CvtvtOutputBuffer.LengthAllocated == 0) {
+        if (!YoriLibAllocateString(&CvtvtOutputBuffer, CVTVT_OUTPUT_BUFFER_LENGTH)) {
+            return;
+        }
+    }
+
+    Space->StartOfString = &CvtvtOutputBuffer.StartOfString[CvtvtOutputBuffer.LengthInChars];
+    Space->LengthAllocated = CvtvtOutputBuffer.LengthAllocated - CvtvtOutputBuffer.LengthInChars;
+}
+
+/**
+ Indicate that characters have been generated into the space returned from
+ @ref CvtvtGetOutputSpace and should be included in output.
+
+ @param CharsUsed The number of characters that were generated.
+ */
+VOID
+CvtvtCommitOutput(
+    __in YORI_ALLOC_SIZE_T CharsUsed
+    )
+{
+    ASSERT(CvtvtOutputBuffer.LengthInChars + CharsUsed <= CvtvtOutputBuffer.LengthAllocated);
+    CvtvtOutputBuffer.LengthInChars = CvtvtOutputBuffer.LengthInChars + CharsUsed;
+}
+
+/**
+ Write any buffered output to the output device.
+
+ @param hOutput Handle to the output device.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+CvtvtFlushOutput(
+    __in HANDLE hOutput
+    )
+{
+    BOOL Result;
+
+    if (CvtvtOutputBuffer.LengthInChars == 0) {
+        return TRUE;
+    }
+
+    Result = YoriLibOutputTextToMultibyteDevice(hOutput, &CvtvtOutputBuffer);
+    CvtvtOutputBuffer.LengthInChars = 0;
+    return Result;
+}
+
+/**
+ Add a string to the buffered output.  If the string is larger than the
+ buffer, it is written to the output device immediately.
+
+ @param hOutput Handle to the output device.
+
+ @param String Pointer to the string to output.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+CvtvtWriteOutput(
+    __in HANDLE hOutput,
+    __in PCYORI_STRING String
+    )
+{
+    YORI_STRING Space;
+
+    CvtvtGetOutputSpace(&Space);
+    if (String->LengthInChars > Space.LengthAllocated) {
+        if (!CvtvtFlushOutput(hOutput)) {
+            return FALSE;
+        }
+        CvtvtGetOutputSpace(&Space);
+        if (String->LengthInChars > Space.LengthAllocated) {
+            return YoriLibOutputTextToMultibyteDevice(hOutput, String);
+        }
+    }
+
+    memcpy(Space.StartOfString, String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+    CvtvtCommitOutput(String->LengthInChars);
+    return TRUE;
+}
+
+/**
+ Write any buffered output to the output device and free the output buffer.
+
+ @param hOutput Handle to the output device.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+CvtvtCloseOutput(
+    __in HANDLE hOutput
+    )
+{
+    BOOL Result;
+
+    Result = CvtvtFlushOutput(hOutput);
+    YoriLibFreeStringContents(&CvtvtOutputBuffer);
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -38,6 +38,13 @@
 
 BOOL CvtvtHtml4SetFunctions(__out PYORI_LIB_VT_CALLBACK_FUNCTIONS CallbackFunctions);
 BOOL CvtvtHtml5SetFunctions(__out PYORI_LIB_VT_CALLBACK_FUNCTIONS CallbackFunctions);
+BOOL CvtvtHtml5ClassesSetFunctions(__out PYORI_LIB_VT_CALLBACK_FUNCTIONS CallbackFunctions);
 BOOL CvtvtRtfSetFunctions(__out PYORI_LIB_VT_CALLBACK_FUNCTIONS CallbackFunctions);
 
+VOID CvtvtGetOutputSpace(__out PYORI_STRING Space);
+VOID CvtvtCommitOutput(__in YORI_ALLOC_SIZE_T CharsUsed);
+BOOL CvtvtFlushOutput(__in HANDLE hOutput);
+BOOL CvtvtWriteOutput(__in HANDLE hOutput, __in PCYORI_STRING String);
+BOOL CvtvtCloseOutput(__in HANDLE hOutput);
+
 // vim:sw=4:ts=4:et:
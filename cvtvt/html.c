@@ -48,6 +48,7 @@ CvtvtHtmlInitializeStream(
     )
 {
     YORI_STRING OutputString;
+    BOOL Result;
 
     UNREFERENCED_PARAMETER(Context);
 
@@ -56,9 +57,9 @@ CvtvtHtmlInitializeStream(
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &OutputString);
+    Result = CvtvtWriteOutput(hOutput, &OutputString);
     YoriLibFreeStringContents(&OutputString);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -78,24 +79,31 @@ CvtvtHtmlEndStream(
     )
 {
     YORI_STRING OutputString;
+    BOOL Result;
     UNREFERENCED_PARAMETER(Context);
 
     YoriLibInitEmptyString(&OutputString);
 
     if (!YoriLibHtmlGenerateEndString(&OutputString, &CvtvtHtmlGenerateContext)) {
+        CvtvtCloseOutput(hOutput);
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &OutputString);
+    Result = CvtvtWriteOutput(hOutput, &OutputString);
     YoriLibFreeStringContents(&OutputString);
 
-    return TRUE;
+    if (!CvtvtCloseOutput(hOutput)) {
+        Result = FALSE;
+    }
+
+    return Result;
 }
 
 
 /**
  Parse text between VT100 escape sequences and generate correct output for
- either HTML4 or HTML5.
+ either HTML4 or HTML5.  Text is generated directly into the output buffer
+ where possible.
 
  @param hOutput The output stream to populate with the translated text
         information.
@@ -115,15 +123,39 @@ CvtvtHtmlProcessAndOutputText(
 {
     YORI_STRING TextString;
     YORI_ALLOC_SIZE_T BufferSizeNeeded;
+    BOOL Result;
 
     UNREFERENCED_PARAMETER(Context);
 
-    YoriLibInitEmptyString(&TextString);
+    CvtvtGetOutputSpace(&TextString);
     BufferSizeNeeded = 0;
     if (!YoriLibHtmlGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
         return FALSE;
     }
 
+    if (BufferSizeNeeded > TextString.LengthAllocated) {
+        if (!CvtvtFlushOutput(hOutput)) {
+            return FALSE;
+        }
+
+        CvtvtGetOutputSpace(&TextString);
+        BufferSizeNeeded = 0;
+        if (!YoriLibHtmlGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
+            return FALSE;
+        }
+    }
+
+    if (BufferSizeNeeded <= TextString.LengthAllocated) {
+        CvtvtCommitOutput(TextString.LengthInChars);
+        return TRUE;
+    }
+
+    //
+    //  The text is larger than the output buffer, so generate it into its
+    //  own allocation and write it directly.
+    //
+
+    YoriLibInitEmptyString(&TextString);
     if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
         return FALSE;
     }
@@ -134,16 +166,16 @@ CvtvtHtmlProcessAndOutputText(
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
+    Result = YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
 
     YoriLibFreeStringContents(&TextString);
-    return TRUE;
+    return Result;
 }
 
 
 /**
  Parse a VT100 escape sequence and generate the correct output for either
- HTML4 or HTML5.
+ HTML4 or HTML5.  Text is generated directly into the output buffer.
 
  @param hOutput The output stream to populate with the translated escape
         information.
@@ -167,26 +199,38 @@ CvtvtHtmlProcessAndOutputEscape(
 
     UNREFERENCED_PARAMETER(Context);
 
-    YoriLibInitEmptyString(&TextString);
+    //
+    //  The generation state is only updated once the result has fit into
+    //  the output buffer.  Since an escape generates at most a pair of
+    //  short tags, it always fits into an empty buffer.
+    //
+
+    CvtvtGetOutputSpace(&TextString);
     BufferSizeNeeded = 0;
     memcpy(&DummyGenerateContext, &CvtvtHtmlGenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
     if (!YoriLibHtmlGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &DummyGenerateContext)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
-        return FALSE;
-    }
-
-    BufferSizeNeeded = 0;
-    if (!YoriLibHtmlGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &CvtvtHtmlGenerateContext)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
+    if (BufferSizeNeeded > TextString.LengthAllocated) {
+        if (!CvtvtFlushOutput(hOutput)) {
+            return FALSE;
+        }
+
+        CvtvtGetOutputSpace(&TextString);
+        BufferSizeNeeded = 0;
+        memcpy(&DummyGenerateContext, &CvtvtHtmlGenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
+        if (!YoriLibHtmlGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &DummyGenerateContext)) {
+            return FALSE;
+        }
+
+        if (BufferSizeNeeded > TextString.LengthAllocated) {
+            return FALSE;
+        }
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
-
-    YoriLibFreeStringContents(&TextString);
+    memcpy(&CvtvtHtmlGenerateContext, &DummyGenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
+    CvtvtCommitOutput(TextString.LengthInChars);
     return TRUE;
 }
 
@@ -204,6 +248,7 @@ CvtvtHtml4SetFunctions(
     )
 {
     CvtvtHtmlGenerateContext.HtmlVersion = 4;
+    CvtvtHtmlGenerateContext.UseClasses = FALSE;
     CallbackFunctions->InitializeStream = CvtvtHtmlInitializeStream;
     CallbackFunctions->EndStream = CvtvtHtmlEndStream;
     CallbackFunctions->ProcessAndOutputText = CvtvtHtmlProcessAndOutputText;
@@ -225,6 +270,7 @@ CvtvtHtml5SetFunctions(
     )
 {
     CvtvtHtmlGenerateContext.HtmlVersion = 5;
+    CvtvtHtmlGenerateContext.UseClasses = FALSE;
     CallbackFunctions->InitializeStream = CvtvtHtmlInitializeStream;
     CallbackFunctions->EndStream = CvtvtHtmlEndStream;
     CallbackFunctions->ProcessAndOutputText = CvtvtHtmlProcessAndOutputText;
@@ -232,4 +278,23 @@ CvtvtHtml5SetFunctions(
     return TRUE;
 }
 
+/**
+ Set parsing functions to generate HTML5 output where colors are described
+ by CSS classes defined once in the document header.
+
+ @param CallbackFunctions Function pointers to populate with those that can
+        generate HTML5 output.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+CvtvtHtml5ClassesSetFunctions(
+    __out PYORI_LIB_VT_CALLBACK_FUNCTIONS CallbackFunctions
+    )
+{
+    CvtvtHtml5SetFunctions(CallbackFunctions);
+    CvtvtHtmlGenerateContext.UseClasses = TRUE;
+    return TRUE;
+}
+
 // vim:sw=4:ts=4:et:
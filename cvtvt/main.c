@@ -37,6 +37,7 @@ CHAR strCvtvtHelpText[] =
         "CVTVT [-license] [Options] [-exec binary|filename]\n"
         "\n"
         " Options include:\n"
+        "   -css           Generate output with CSS classes\n"
         "   -exec binary   Run process and pipe its output into cvtvt\n"
         "   -html4         Generate output with FONT tags (no backgrounds)\n"
         "   -html5         Generate output with CSS\n"
@@ -308,6 +309,10 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2015-2018"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("css")) == 0) {
+                ArgParsed = TRUE;
+                StripEscapes = FALSE;
+                CvtvtHtml5ClassesSetFunctions(&Callbacks);
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("exec")) == 0) {
                 ArgParsed = TRUE;
                 ExecMode = TRUE;
@@ -433,6 +438,15 @@ ENTRYPOINT(
 
     while (YoriLibReadLineToStringEx(&LineString, &LineReadContext, TRUE, 100, hSource, &LineEnding, &TimeoutReached) || TimeoutReached) {
 
+        //
+        //  If the source is waiting for more data, write out anything
+        //  that has been converted so far.
+        //
+
+        if (TimeoutReached) {
+            CvtvtFlushOutput(hOutput);
+        }
+
         //
         //  Start producing HTML
         //
@@ -48,6 +48,7 @@ CvtvtRtfInitializeStream(
     )
 {
     YORI_STRING OutputString;
+    BOOL Result;
 
     UNREFERENCED_PARAMETER(Context);
 
@@ -56,9 +57,9 @@ CvtvtRtfInitializeStream(
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &OutputString);
+    Result = CvtvtWriteOutput(hOutput, &OutputString);
     YoriLibFreeStringContents(&OutputString);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -78,17 +79,23 @@ CvtvtRtfEndStream(
     )
 {
     YORI_STRING OutputString;
+    BOOL Result;
     UNREFERENCED_PARAMETER(Context);
     YoriLibInitEmptyString(&OutputString);
 
     if (!YoriLibRtfGenerateEndString(&OutputString)) {
+        CvtvtCloseOutput(hOutput);
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &OutputString);
+    Result = CvtvtWriteOutput(hOutput, &OutputString);
     YoriLibFreeStringContents(&OutputString);
 
-    return TRUE;
+    if (!CvtvtCloseOutput(hOutput)) {
+        Result = FALSE;
+    }
+
+    return Result;
 }
 
 
@@ -115,15 +122,39 @@ CvtvtRtfProcessAndOutputText(
 
     YORI_STRING TextString;
     YORI_ALLOC_SIZE_T BufferSizeNeeded;
+    BOOL Result;
 
     UNREFERENCED_PARAMETER(Context);
 
-    YoriLibInitEmptyString(&TextString);
+    //
+    //  Generate directly into the output buffer if the text fits, which
+    //  it will unless it is larger than the entire buffer.
+    //
+
+    CvtvtGetOutputSpace(&TextString);
     BufferSizeNeeded = 0;
     if (!YoriLibRtfGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
         return FALSE;
     }
 
+    if (BufferSizeNeeded > TextString.LengthAllocated) {
+        if (!CvtvtFlushOutput(hOutput)) {
+            return FALSE;
+        }
+
+        CvtvtGetOutputSpace(&TextString);
+        BufferSizeNeeded = 0;
+        if (!YoriLibRtfGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
+            return FALSE;
+        }
+    }
+
+    if (BufferSizeNeeded <= TextString.LengthAllocated) {
+        CvtvtCommitOutput(TextString.LengthInChars);
+        return TRUE;
+    }
+
+    YoriLibInitEmptyString(&TextString);
     if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
         return FALSE;
     }
@@ -134,10 +165,10 @@ CvtvtRtfProcessAndOutputText(
         return FALSE;
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
+    Result = YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
 
     YoriLibFreeStringContents(&TextString);
-    return TRUE;
+    return Result;
 }
 
 
@@ -166,26 +197,38 @@ CvtvtRtfProcessAndOutputEscape(
 
     UNREFERENCED_PARAMETER(Context);
 
-    YoriLibInitEmptyString(&TextString);
+    //
+    //  The underline state is only updated once the result has fit into
+    //  the output buffer.  An escape is short, so it always fits into an
+    //  empty buffer.
+    //
+
+    CvtvtGetOutputSpace(&TextString);
     BufferSizeNeeded = 0;
     DummyUnderlineState = CvtvtRtfUnderlineOn;
     if (!YoriLibRtfGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &DummyUnderlineState)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
-        return FALSE;
-    }
-
-    BufferSizeNeeded = 0;
-    if (!YoriLibRtfGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &CvtvtRtfUnderlineOn)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
+    if (BufferSizeNeeded > TextString.LengthAllocated) {
+        if (!CvtvtFlushOutput(hOutput)) {
+            return FALSE;
+        }
+
+        CvtvtGetOutputSpace(&TextString);
+        BufferSizeNeeded = 0;
+        DummyUnderlineState = CvtvtRtfUnderlineOn;
+        if (!YoriLibRtfGenerateEscapeString(&TextString, &BufferSizeNeeded, String, &DummyUnderlineState)) {
+            return FALSE;
+        }
+
+        if (BufferSizeNeeded > TextString.LengthAllocated) {
+            return FALSE;
+        }
     }
 
-    YoriLibOutputTextToMultibyteDevice(hOutput, &TextString);
-
-    YoriLibFreeStringContents(&TextString);
+    CvtvtRtfUnderlineOn = DummyUnderlineState;
+    CvtvtCommitOutput(TextString.LengthInChars);
     return TRUE;
 }
 
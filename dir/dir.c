@@ -1233,6 +1233,13 @@ ENTRYPOINT(
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
 
+    //
+    //  Buffer output so that each file found is not written to the
+    //  console individually.
+    //
+
+    YoriLibEnableOutputBuffering(YORI_LIB_OUTPUT_STDOUT);
+
     if (StartArg == 0 || StartArg == ArgC) {
         YORI_STRING FilesInDirectorySpec;
         YoriLibConstantString(&FilesInDirectorySpec, _T("*"));
@@ -1264,12 +1271,15 @@ ENTRYPOINT(
     }
 
     if (DirContext.FilesFound == 0 && DirContext.DirsFound == 0) {
+        YoriLibDisableOutputBuffering();
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("dir: no matching files found\n"));
         return EXIT_FAILURE;
     } else if (DirContext.Recursive && !DirContext.MinimalDisplay) {
         DirOutputEndOfRecursiveSummary(&DirContext);
     }
 
+    YoriLibDisableOutputBuffering();
+
     return EXIT_SUCCESS;
 }
 
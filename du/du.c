@@ -35,8 +35,8 @@ CHAR strDuHelpText[] =
         "\n"
         "Display disk space used within directories.\n"
         "\n"
-        "DU [-license] [-a] [-b] [-c] [-color] [-d] [-h] [-r <num>] [-s <size>]\n"
-        "   [-w] [<spec>...]\n"
+        "DU [-license] [-a] [-b] [-c] [-color] [-d] [-h] [-j <num>] [-m]\n"
+        "   [-r <num>] [-s <size>] [-stats] [-w] [<spec>...]\n"
         "\n"
         "   -a             Enable all features for maximum accuracy\n"
         "   -b             Use basic search criteria for files only\n"
@@ -44,10 +44,16 @@ CHAR strDuHelpText[] =
         "   -color         Use file color highlighting\n"
         "   -d             Include space used by alternate data streams\n"
         "   -h             Average space used across multiple hard links\n"
+        "   -j <num>       Scan directories in parallel on the specified number of threads\n"
+        "   -m             Read the master file table when scanning a volume root\n"
         "   -r <num>       The maximum recursion depth to display\n"
         "   -s <size>      Only display directories containing at least size bytes\n"
+        "   -stats         Display performance statistics on completion\n"
         "   -u             Round space up to file allocation unit or cluster size\n"
-        "   -w             Count files backed by a WIM archive as zero size\n";
+        "   -w             Count files backed by a WIM archive as zero size\n"
+        "\n"
+        "When scanning in parallel, compressed size and rounding to allocation units\n"
+        "use the allocation size recorded in each directory entry.\n";
 
 /**
  Display usage text to the user.
@@ -206,8 +212,87 @@ typedef struct _DU_CONTEXT {
      */
     YORI_LIB_FILE_FILTER ColorRules;
 
+    /**
+     The number of threads to scan directories with.  If greater than one,
+     directories are scanned in parallel where possible.
+     */
+    DWORD ThreadCount;
+
+    /**
+     When scanning in parallel, the number of bytes in each file system
+     allocation unit for the tree being scanned.  Since links are not
+     traversed, a single scan does not cross volumes.
+     */
+    LONGLONG ParallelAllocationSize;
+
+    /**
+     When scanning in parallel, the work queue which scans directories.
+     This is only initialized if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
 } DU_CONTEXT, *PDU_CONTEXT;
 
+/**
+ A directory found when scanning in parallel.  Each directory is scanned by
+ a single worker, which records the space used by files within it and links
+ any subdirectories beneath it for other workers to scan.  Totals for each
+ tree are calculated from the leaves upward once all workers have completed.
+ */
+typedef struct _DU_PARALLEL_DIRECTORY {
+
+    /**
+     The work item used to queue this directory to be scanned.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The link of this directory within its parent's list of children.
+     */
+    YORI_LIST_ENTRY SiblingList;
+
+    /**
+     The list of subdirectories found within this directory, in the order
+     they were found.  This is only modified by the worker scanning this
+     directory.
+     */
+    YORI_LIST_ENTRY ChildList;
+
+    /**
+     The fully qualified name of this directory, in escaped form.  This is
+     allocated as part of this structure.
+     */
+    YORI_STRING DirectoryName;
+
+    /**
+     The depth of this directory, where the directory being scanned is at
+     depth one.
+     */
+    DWORD Depth;
+
+    /**
+     The number of files or directories encountered within this directory.
+     */
+    LONGLONG ObjectsFoundThisDirectory;
+
+    /**
+     The amount of bytes consumed by files within this directory.
+     */
+    LONGLONG SpaceConsumedThisDirectory;
+
+    /**
+     The amount of bytes consumed by subdirectories within this directory.
+     This is populated only when the tree is being reported.
+     */
+    LONGLONG SpaceConsumedInChildren;
+} DU_PARALLEL_DIRECTORY, *PDU_PARALLEL_DIRECTORY;
+
+/**
+ The number of bytes to request from the file system on each directory
+ query when scanning in parallel.
+ */
+#define DU_PARALLEL_BUFFER_SIZE (64 * 1024)
+
 /**
  Deallocate all child allocations within a DU_CONTEXT structure.  The
  structure itself is typically stack allocated and will not be freed.
@@ -233,6 +318,7 @@ DuCleanupContext(
     DuContext->StackAllocated = 0;
     DuContext->StackIndex = 0;
     YoriLibFileFiltFreeFilter(&DuContext->ColorRules);
+    YoriLibCleanupWorkQueue(&DuContext->WorkQueue);
 }
 
 /**
@@ -257,40 +343,39 @@ DuCloseStack(
 }
 
 /**
- Print the space consumed by a particular directory, and close out the
- directory's stack frame so it can be reused by the next directory.
+ Print the space consumed by a particular directory, if the directory is
+ within the depth and size limits that the user requested.
 
- @param DuContext Pointer to the DuContext which contains the directory to
-        display and close.
+ @param DuContext Pointer to the DuContext specifying display options.
 
- @param Depth Specifies the array index of the directory to display and close.
+ @param DirectoryName Pointer to the name of the directory, in escaped form.
+
+ @param Depth Specifies the depth of the directory.
+
+ @param SizeToDisplay The number of bytes consumed by the directory and all
+        of its children.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-DuReportAndCloseStack(
+DuReportDirectory(
     __in PDU_CONTEXT DuContext,
-    __in DWORD Depth
+    __in PYORI_STRING DirectoryName,
+    __in DWORD Depth,
+    __in LARGE_INTEGER SizeToDisplay
     )
 {
     YORI_STRING UnescapedPath;
     PYORI_STRING StringToDisplay;
     YORI_STRING FileSizeString;
     TCHAR FileSizeStringBuffer[8];
-    LARGE_INTEGER SizeToDisplay;
     YORI_STRING VtAttribute;
     TCHAR VtAttributeBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
     YORILIB_COLOR_ATTRIBUTES Attribute;
 
-    PDU_DIRECTORY_STACK DirStack;
-
-    DirStack = &DuContext->DirStack[Depth];
-
     if (DuContext->MaximumDepthToDisplay == 0 ||
         Depth <= DuContext->MaximumDepthToDisplay) {
 
-        SizeToDisplay.QuadPart = DirStack->SpaceConsumedInChildren + DirStack->SpaceConsumedThisDirectory;
-
         if (DuContext->MinimumDirectorySizeToDisplay.QuadPart == 0 ||
             SizeToDisplay.QuadPart >= DuContext->MinimumDirectorySizeToDisplay.QuadPart) {
 
@@ -299,10 +384,10 @@ DuReportAndCloseStack(
             //
 
             YoriLibInitEmptyString(&UnescapedPath);
-            if (YoriLibUnescapePath(&DirStack->DirectoryName, &UnescapedPath)) {
+            if (YoriLibUnescapePath(DirectoryName, &UnescapedPath)) {
                 StringToDisplay = &UnescapedPath;
             } else {
-                StringToDisplay = &DirStack->DirectoryName;
+                StringToDisplay = DirectoryName;
             }
 
             //
@@ -326,8 +411,8 @@ DuReportAndCloseStack(
                 VtAttribute.StartOfString = VtAttributeBuffer;
                 VtAttribute.LengthAllocated = sizeof(VtAttributeBuffer)/sizeof(VtAttributeBuffer[0]);
 
-                if (!YoriLibUpdateFindDataFromFileInformation(&FileInfo, DirStack->DirectoryName.StartOfString, TRUE) || 
-                    !YoriLibFileFiltCheckColorMatch(&DuContext->ColorRules, &DirStack->DirectoryName, &FileInfo, &Attribute)) {
+                if (!YoriLibUpdateFindDataFromFileInformation(&FileInfo, DirectoryName->StartOfString, TRUE) || 
+                    !YoriLibFileFiltCheckColorMatch(&DuContext->ColorRules, DirectoryName, &FileInfo, &Attribute)) {
                     Attribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
                     Attribute.Win32Attr = (UCHAR)YoriLibVtGetDefaultColor();
                 }
@@ -352,6 +437,34 @@ DuReportAndCloseStack(
         }
     }
 
+    return TRUE;
+}
+
+/**
+ Print the space consumed by a particular directory, and close out the
+ directory's stack frame so it can be reused by the next directory.
+
+ @param DuContext Pointer to the DuContext which contains the directory to
+        display and close.
+
+ @param Depth Specifies the array index of the directory to display and close.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+DuReportAndCloseStack(
+    __in PDU_CONTEXT DuContext,
+    __in DWORD Depth
+    )
+{
+    LARGE_INTEGER SizeToDisplay;
+    PDU_DIRECTORY_STACK DirStack;
+
+    DirStack = &DuContext->DirStack[Depth];
+
+    SizeToDisplay.QuadPart = DirStack->SpaceConsumedInChildren + DirStack->SpaceConsumedThisDirectory;
+    DuReportDirectory(DuContext, &DirStack->DirectoryName, Depth, SizeToDisplay);
+
     DuCloseStack(DirStack);
     return TRUE;
 }
@@ -402,6 +515,60 @@ DuReportAndCloseAllActiveStacks(
     return TRUE;
 }
 
+/**
+ Determine the number of bytes in each file system allocation unit for the
+ volume containing a directory.
+
+ @param DirectoryName Pointer to a NULL terminated, fully qualified name of
+        the directory.  The string may be temporarily modified but is
+        restored before returning.
+
+ @return The number of bytes in each allocation unit.  If this cannot be
+         determined, a default of 4Kb is returned.
+ */
+LONGLONG
+DuGetAllocationSize(
+    __in PYORI_STRING DirectoryName
+    )
+{
+    DWORD SectorsPerCluster;
+    DWORD BytesPerSector;
+    DWORD NumberOfFreeClusters;
+    DWORD TotalNumberOfClusters;
+    LONGLONG AllocationSize;
+
+    //
+    //  If GetDiskFreeSpace fails, see if it works on the effective root.
+    //  This is to support systems without mount points where this call can
+    //  fail when called on a directory.
+    //
+
+    if (!GetDiskFreeSpace(DirectoryName->StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
+        YORI_STRING EffectiveRoot;
+
+        AllocationSize = 4096;
+
+        if (YoriLibFindEffectiveRoot(DirectoryName, &EffectiveRoot) &&
+            EffectiveRoot.LengthInChars < DirectoryName->LengthInChars) {
+
+            TCHAR SavedChar;
+            SavedChar = EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars];
+            EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = '\0';
+
+            if (GetDiskFreeSpace(EffectiveRoot.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
+                AllocationSize = SectorsPerCluster * BytesPerSector;
+            }
+
+            EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = SavedChar;
+        }
+
+    } else {
+        AllocationSize = SectorsPerCluster * BytesPerSector;
+    }
+
+    return AllocationSize;
+}
+
 /**
  Initialize a single directory stack location.
 
@@ -420,11 +587,6 @@ DuInitializeDirectoryStack(
     __in PYORI_STRING DirName
     )
 {
-    DWORD SectorsPerCluster;
-    DWORD BytesPerSector;
-    DWORD NumberOfFreeClusters;
-    DWORD TotalNumberOfClusters;
-
     if (DirStack->DirectoryName.LengthAllocated <= DirName->LengthInChars) {
         YoriLibFreeStringContents(&DirStack->DirectoryName);
         if (!YoriLibAllocateString(&DirStack->DirectoryName, DirName->LengthInChars + 80)) {
@@ -436,35 +598,8 @@ DuInitializeDirectoryStack(
     DirStack->DirectoryName.StartOfString[DirName->LengthInChars] = '\0';
     DirStack->DirectoryName.LengthInChars = DirName->LengthInChars;
 
-    //
-    //  If GetDiskFreeSpace fails, see if it works on the effective root.
-    //  This is to support systems without mount points where this call can
-    //  fail when called on a directory.
-    //
-
     if (DuContext->AllocationSize) {
-        if (!GetDiskFreeSpace(DirStack->DirectoryName.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
-            YORI_STRING EffectiveRoot;
-
-            DirStack->AllocationSize = 4096;
-
-            if (YoriLibFindEffectiveRoot(&DirStack->DirectoryName, &EffectiveRoot) &&
-                EffectiveRoot.LengthInChars < DirStack->DirectoryName.LengthInChars) {
-
-                TCHAR SavedChar;
-                SavedChar = EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars];
-                EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = '\0';
-
-                if (GetDiskFreeSpace(EffectiveRoot.StartOfString, &SectorsPerCluster, &BytesPerSector, &NumberOfFreeClusters, &TotalNumberOfClusters)) {
-                    DirStack->AllocationSize = SectorsPerCluster * BytesPerSector;
-                }
-
-                EffectiveRoot.StartOfString[EffectiveRoot.LengthInChars] = SavedChar;
-            }
-
-        } else {
-            DirStack->AllocationSize = SectorsPerCluster * BytesPerSector;
-        }
+        DirStack->AllocationSize = DuGetAllocationSize(&DirStack->DirectoryName);
     }
 
     return TRUE;
@@ -476,8 +611,8 @@ DuInitializeDirectoryStack(
 
  @param DuContext Context specifying the accounting options to apply.
 
- @param DirStack Pointer to the directory stack indicating the allocation size
-        used for the directory.
+ @param AllocationSize The number of bytes in each file system allocation
+        unit for the directory containing the file.
 
  @param FilePath Pointer to a fully specified path to the file.
 
@@ -489,7 +624,7 @@ DuInitializeDirectoryStack(
 LARGE_INTEGER
 DuCalculateSpaceUsedByFile(
     __in PDU_CONTEXT DuContext,
-    __in PDU_DIRECTORY_STACK DirStack,
+    __in LONGLONG AllocationSize,
     __in PYORI_STRING FilePath,
     __in PWIN32_FIND_DATA FileInfo
     )
@@ -568,7 +703,7 @@ DuCalculateSpaceUsedByFile(
     //
 
     if (DuContext->AllocationSize) {
-        FileSize.QuadPart = (FileSize.QuadPart + DirStack->AllocationSize - 1) & (~(DirStack->AllocationSize - 1));
+        FileSize.QuadPart = (FileSize.QuadPart + AllocationSize - 1) & (~(AllocationSize - 1));
     }
 
     //
@@ -597,7 +732,7 @@ DuCalculateSpaceUsedByFile(
                 if (_tcscmp(FindStreamData.cStreamName, L"::$DATA") != 0) {
                     FileSize.QuadPart += FindStreamData.StreamSize.QuadPart;
                     if (DuContext->AllocationSize) {
-                        FileSize.QuadPart = (FileSize.QuadPart + DirStack->AllocationSize - 1) & (~(DirStack->AllocationSize - 1));
+                        FileSize.QuadPart = (FileSize.QuadPart + AllocationSize - 1) & (~(AllocationSize - 1));
                     }
                 }
             } while (DllKernel32.pFindNextStreamW(hFind, &FindStreamData));
@@ -776,7 +911,7 @@ DuFileFoundCallback(
 
     if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
         LARGE_INTEGER FileSize;
-        FileSize = DuCalculateSpaceUsedByFile(DuContext, &DuContext->DirStack[Depth], FilePath, FileInfo);
+        FileSize = DuCalculateSpaceUsedByFile(DuContext, DuContext->DirStack[Depth].AllocationSize, FilePath, FileInfo);
         DuContext->DirStack[Depth].SpaceConsumedThisDirectory += FileSize.QuadPart;
     }
 
@@ -813,6 +948,528 @@ DuFileEnumerateErrorCallback(
     return TRUE;
 }
 
+/**
+ Determine the number of characters needed to describe an object within a
+ parent directory, not including a NULL terminator.
+
+ @param ParentName Pointer to the fully qualified name of the parent
+        directory.
+
+ @param Name Pointer to the name of the object within the parent directory.
+
+ @return The number of characters required.
+ */
+DWORD
+DuParallelGetChildPathLength(
+    __in PYORI_STRING ParentName,
+    __in PYORI_STRING Name
+    )
+{
+    DWORD Length;
+
+    Length = ParentName->LengthInChars + Name->LengthInChars;
+    if (ParentName->LengthInChars == 0 ||
+        !YoriLibIsSep(ParentName->StartOfString[ParentName->LengthInChars - 1])) {
+
+        Length++;
+    }
+
+    return Length;
+}
+
+/**
+ Construct the fully qualified name of an object within a parent directory.
+
+ @param ParentName Pointer to the fully qualified name of the parent
+        directory.
+
+ @param Name Pointer to the name of the object within the parent directory.
+
+ @param ChildPath On successful completion, populated with the fully
+        qualified, NULL terminated name of the object.  The caller must
+        ensure this has sufficient space, as indicated by
+        @ref DuParallelGetChildPathLength .
+ */
+VOID
+DuParallelGetChildPath(
+    __in PYORI_STRING ParentName,
+    __in PYORI_STRING Name,
+    __inout PYORI_STRING ChildPath
+    )
+{
+    YORI_ALLOC_SIZE_T Length;
+
+    ASSERT(ChildPath->LengthAllocated > DuParallelGetChildPathLength(ParentName, Name));
+
+    Length = ParentName->LengthInChars;
+    memcpy(ChildPath->StartOfString, ParentName->StartOfString, Length * sizeof(TCHAR));
+    if (Length == 0 || !YoriLibIsSep(ParentName->StartOfString[Length - 1])) {
+        ChildPath->StartOfString[Length] = '\\';
+        Length++;
+    }
+    memcpy(&ChildPath->StartOfString[Length], Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+    Length = Length + Name->LengthInChars;
+    ChildPath->StartOfString[Length] = '\0';
+    ChildPath->LengthInChars = Length;
+}
+
+/**
+ Allocate a structure describing a directory to scan in parallel.
+
+ @param ParentName Optionally points to the fully qualified name of the
+        parent directory.  If not specified, Name is fully qualified.
+
+ @param Name Pointer to the name of the directory.  If ParentName is
+        specified, this is the name of the directory within its parent.
+
+ @param Depth The depth of the directory.
+
+ @return Pointer to the allocated directory, or NULL on allocation failure.
+         The caller should free this with @ref YoriLibFree .
+ */
+PDU_PARALLEL_DIRECTORY
+DuParallelAllocateDirectory(
+    __in_opt PYORI_STRING ParentName,
+    __in PYORI_STRING Name,
+    __in DWORD Depth
+    )
+{
+    PDU_PARALLEL_DIRECTORY Directory;
+    DWORD NameLength;
+    DWORD BytesRequested;
+
+    if (ParentName != NULL) {
+        NameLength = DuParallelGetChildPathLength(ParentName, Name);
+    } else {
+        NameLength = Name->LengthInChars;
+    }
+
+    BytesRequested = sizeof(DU_PARALLEL_DIRECTORY) + (NameLength + 1) * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesRequested)) {
+        return NULL;
+    }
+
+    Directory = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequested);
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Directory, sizeof(DU_PARALLEL_DIRECTORY));
+    YoriLibInitializeListHead(&Directory->ChildList);
+    Directory->Depth = Depth;
+
+    YoriLibInitEmptyString(&Directory->DirectoryName);
+    Directory->DirectoryName.StartOfString = (LPTSTR)(Directory + 1);
+    Directory->DirectoryName.LengthAllocated = (YORI_ALLOC_SIZE_T)(NameLength + 1);
+
+    if (ParentName != NULL) {
+        DuParallelGetChildPath(ParentName, Name, &Directory->DirectoryName);
+    } else {
+        memcpy(Directory->DirectoryName.StartOfString, Name->StartOfString, NameLength * sizeof(TCHAR));
+        Directory->DirectoryName.StartOfString[NameLength] = '\0';
+        Directory->DirectoryName.LengthInChars = (YORI_ALLOC_SIZE_T)NameLength;
+    }
+
+    return Directory;
+}
+
+/**
+ Count the amount of disk space to attribute to a file found when scanning
+ in parallel.  Where the options allow, this uses the sizes returned in the
+ directory entry, so the file does not need to be opened.
+
+ @param DuContext Context specifying the accounting options to apply.
+
+ @param Directory Pointer to the directory containing the file.
+
+ @param FileName Pointer to the name of the file within the directory.
+
+ @param Entry Pointer to the directory entry describing the file.
+
+ @return The number of bytes attributable to the file.
+ */
+LARGE_INTEGER
+DuParallelCalculateSpaceUsedByEntry(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_PARALLEL_DIRECTORY Directory,
+    __in PYORI_STRING FileName,
+    __in PFILE_FULL_DIR_INFO Entry
+    )
+{
+    LARGE_INTEGER FileSize;
+    YORI_STRING FilePath;
+    WIN32_FIND_DATA FileInfo;
+
+    //
+    //  Hard links, WIM backing and named streams can only be determined by
+    //  asking about the file itself.  Fall back to the per file path for
+    //  these.
+    //
+
+    if (DuContext->AverageHardLinkSize ||
+        DuContext->WimBackedFilesAsZero ||
+        DuContext->IncludeNamedStreams) {
+
+        FileSize.QuadPart = 0;
+        if (!YoriLibAllocateString(&FilePath, (YORI_ALLOC_SIZE_T)(DuParallelGetChildPathLength(&Directory->DirectoryName, FileName) + 1))) {
+            return FileSize;
+        }
+
+        DuParallelGetChildPath(&Directory->DirectoryName, FileName, &FilePath);
+
+        ZeroMemory(&FileInfo, sizeof(FileInfo));
+        FileInfo.dwFileAttributes = Entry->FileAttributes;
+        FileInfo.nFileSizeHigh = (DWORD)Entry->EndOfFile.HighPart;
+        FileInfo.nFileSizeLow = Entry->EndOfFile.LowPart;
+
+        FileSize = DuCalculateSpaceUsedByFile(DuContext, DuContext->ParallelAllocationSize, &FilePath, &FileInfo);
+        YoriLibFreeStringContents(&FilePath);
+        return FileSize;
+    }
+
+    //
+    //  The allocation size reflects compression, sparse ranges and rounding
+    //  to the allocation unit, so if the user asked for any of these, use
+    //  it directly.
+    //
+
+    if (DuContext->CompressedFileSize || DuContext->AllocationSize) {
+        FileSize.QuadPart = Entry->AllocationSize.QuadPart;
+    } else {
+        FileSize.QuadPart = Entry->EndOfFile.QuadPart;
+    }
+
+    return FileSize;
+}
+
+VOID
+DuParallelDirectoryWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    );
+
+/**
+ Queue a directory to be scanned by a worker thread.  If the queue is full,
+ the directory is scanned on the current thread.  This allows workers to
+ queue subdirectories without waiting on each other.
+
+ @param DuContext Pointer to the context including the work queue.
+
+ @param Directory Pointer to the directory to scan.
+ */
+VOID
+DuParallelQueueDirectory(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_PARALLEL_DIRECTORY Directory
+    )
+{
+    if (!YoriLibQueueWorkItem(&DuContext->WorkQueue, &Directory->WorkItem, FALSE)) {
+        DuParallelDirectoryWorker(DuContext, &Directory->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+    }
+}
+
+/**
+ Scan the contents of a single directory, recording the space used by files
+ within it, and queue any subdirectories to be scanned.
+
+ @param DuContext Pointer to the context specifying the accounting options
+        to apply.
+
+ @param Directory Pointer to the directory to scan.
+ */
+VOID
+DuParallelScanDirectory(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_PARALLEL_DIRECTORY Directory
+    )
+{
+    HANDLE DirHandle;
+    PUCHAR Buffer;
+    YORI_ALLOC_SIZE_T BufferLength;
+    PFILE_FULL_DIR_INFO Entry;
+    DWORD InfoClass;
+    DWORD ErrorCode;
+    DWORD Offset;
+    YORI_STRING Name;
+    LARGE_INTEGER FileSize;
+    PDU_PARALLEL_DIRECTORY Child;
+    PYORI_LIST_ENTRY ListEntry;
+
+    DirHandle = CreateFile(Directory->DirectoryName.StartOfString,
+                           FILE_LIST_DIRECTORY | SYNCHRONIZE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_FLAG_BACKUP_SEMANTICS,
+                           NULL);
+
+    if (DirHandle == INVALID_HANDLE_VALUE) {
+        DuFileEnumerateErrorCallback(&Directory->DirectoryName, GetLastError(), Directory->Depth, DuContext);
+        return;
+    }
+
+    BufferLength = YoriLibMaximumAllocationInRange(16 * 1024, DU_PARALLEL_BUFFER_SIZE);
+    Buffer = NULL;
+    if (BufferLength > 0) {
+        Buffer = YoriLibMalloc(BufferLength);
+    }
+    if (Buffer == NULL) {
+        CloseHandle(DirHandle);
+        DuFileEnumerateErrorCallback(&Directory->DirectoryName, ERROR_NOT_ENOUGH_MEMORY, Directory->Depth, DuContext);
+        return;
+    }
+
+    //
+    //  Each query returns as many entries as fit in the buffer, including
+    //  the allocation size of each, so the files do not need to be opened.
+    //
+
+    ErrorCode = ERROR_SUCCESS;
+    InfoClass = FileFullDirectoryRestartInfo;
+    while (ErrorCode == ERROR_SUCCESS) {
+        if (YoriLibIsOperationCancelled()) {
+            ErrorCode = ERROR_CANCELLED;
+            break;
+        }
+
+        if (!DllKernel32.pGetFileInformationByHandleEx(DirHandle, InfoClass, Buffer, BufferLength)) {
+            ErrorCode = GetLastError();
+            break;
+        }
+        InfoClass = FileFullDirectoryInfo;
+
+        Offset = 0;
+        while (TRUE) {
+            Entry = (PFILE_FULL_DIR_INFO)YoriLibAddToPointer(Buffer, Offset);
+
+            YoriLibInitEmptyString(&Name);
+            Name.StartOfString = Entry->FileName;
+            Name.LengthInChars = (YORI_ALLOC_SIZE_T)(Entry->FileNameLength / sizeof(WCHAR));
+
+            if (YoriLibCompareStringWithLiteral(&Name, _T(".")) != 0 &&
+                YoriLibCompareStringWithLiteral(&Name, _T("..")) != 0) {
+
+                Directory->ObjectsFoundThisDirectory++;
+
+                if (Entry->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+
+                    //
+                    //  Links are not traversed, matching the serial
+                    //  enumerate.  For reparse points, the reparse tag is
+                    //  returned in place of the extended attribute size.
+                    //
+
+                    if ((Entry->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0 ||
+                        (Entry->EaSize != IO_REPARSE_TAG_MOUNT_POINT &&
+                         Entry->EaSize != IO_REPARSE_TAG_SYMLINK)) {
+
+                        Child = DuParallelAllocateDirectory(&Directory->DirectoryName, &Name, Directory->Depth + 1);
+                        if (Child == NULL) {
+                            ErrorCode = ERROR_NOT_ENOUGH_MEMORY;
+                            break;
+                        }
+                        YoriLibAppendList(&Directory->ChildList, &Child->SiblingList);
+                    }
+                } else {
+                    FileSize = DuParallelCalculateSpaceUsedByEntry(DuContext, Directory, &Name, Entry);
+                    Directory->SpaceConsumedThisDirectory += FileSize.QuadPart;
+                }
+            }
+
+            if (Entry->NextEntryOffset == 0) {
+                break;
+            }
+            Offset = Offset + Entry->NextEntryOffset;
+        }
+    }
+
+    YoriLibFree(Buffer);
+    CloseHandle(DirHandle);
+
+    if (ErrorCode != ERROR_NO_MORE_FILES && ErrorCode != ERROR_CANCELLED) {
+        DuFileEnumerateErrorCallback(&Directory->DirectoryName, ErrorCode, Directory->Depth, DuContext);
+    }
+
+    //
+    //  Subdirectories are queued once this directory is closed, so that if
+    //  they end up being scanned on this thread, the buffer and handle are
+    //  not held across the subtree.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&Directory->ChildList, NULL);
+    while (ListEntry != NULL) {
+        Child = CONTAINING_RECORD(ListEntry, DU_PARALLEL_DIRECTORY, SiblingList);
+        ListEntry = YoriLibGetNextListEntry(&Directory->ChildList, ListEntry);
+        DuParallelQueueDirectory(DuContext, Child);
+    }
+}
+
+/**
+ A work queue callback invoked to scan a single directory.  Unlike most work
+ items, the directory is not freed here, because it forms part of the tree
+ which is reported once all directories have been scanned.
+
+ @param Context Pointer to the du context.
+
+ @param Item Pointer to the work item within the directory to scan.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the
+        directory should not be scanned.
+ */
+VOID
+DuParallelDirectoryWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PDU_CONTEXT DuContext;
+    PDU_PARALLEL_DIRECTORY Directory;
+
+    DuContext = (PDU_CONTEXT)Context;
+    Directory = CONTAINING_RECORD(Item, DU_PARALLEL_DIRECTORY, WorkItem);
+
+    if (!Cancelled) {
+        DuParallelScanDirectory(DuContext, Directory);
+    }
+}
+
+/**
+ Calculate the space used by a tree of directories from the leaves upward,
+ display each directory in the same order as a serial scan would, and free
+ the tree.
+
+ @param DuContext Pointer to the context specifying display options.
+
+ @param Directory Pointer to the root of the tree to report.  This is freed
+        by this function.
+
+ @param Display If TRUE, directories are displayed.  If FALSE, the tree is
+        freed without displaying anything.
+ */
+VOID
+DuParallelReportAndFreeDirectory(
+    __in PDU_CONTEXT DuContext,
+    __in PDU_PARALLEL_DIRECTORY Directory,
+    __in BOOLEAN Display
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PDU_PARALLEL_DIRECTORY Child;
+    LARGE_INTEGER SizeToDisplay;
+
+    ListEntry = YoriLibGetNextListEntry(&Directory->ChildList, NULL);
+    while (ListEntry != NULL) {
+        Child = CONTAINING_RECORD(ListEntry, DU_PARALLEL_DIRECTORY, SiblingList);
+        ListEntry = YoriLibGetNextListEntry(&Directory->ChildList, ListEntry);
+        Directory->SpaceConsumedInChildren += Child->SpaceConsumedInChildren + Child->SpaceConsumedThisDirectory;
+        DuParallelReportAndFreeDirectory(DuContext, Child, Display);
+    }
+
+    //
+    //  A serial scan only displays directories which contain an object, so
+    //  do the same here.
+    //
+
+    if (Display && Directory->ObjectsFoundThisDirectory > 0) {
+        SizeToDisplay.QuadPart = Directory->SpaceConsumedInChildren + Directory->SpaceConsumedThisDirectory;
+        DuReportDirectory(DuContext, &Directory->DirectoryName, Directory->Depth, SizeToDisplay);
+    }
+
+    YoriLibFree(Directory);
+}
+
+/**
+ Determine whether a user specified object can be scanned in parallel.  This
+ requires a single directory without wildcards, and the ability to query
+ directory entries by handle.
+
+ @param DuContext Pointer to the context specifying the options to apply.
+
+ @param FileSpec Pointer to the user specified object.
+
+ @param FullPath On successful completion, updated to contain the fully
+        qualified name of the directory in escaped form.  The caller should
+        free this with @ref YoriLibFreeStringContents .
+
+ @return TRUE if the object can be scanned in parallel, FALSE if it should
+         be scanned serially.
+ */
+__success(return)
+BOOL
+DuParallelCanScan(
+    __in PDU_CONTEXT DuContext,
+    __in PYORI_STRING FileSpec,
+    __out PYORI_STRING FullPath
+    )
+{
+    DWORD Attributes;
+
+    if (DuContext->ThreadCount <= 1 ||
+        DllKernel32.pGetFileInformationByHandleEx == NULL) {
+
+        return FALSE;
+    }
+
+    if (YoriLibCountStringNotContainingChars(FileSpec, _T("*?{[")) != FileSpec->LengthInChars) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(FullPath);
+    if (!YoriLibUserStringToSingleFilePath(FileSpec, TRUE, FullPath)) {
+        return FALSE;
+    }
+
+    Attributes = GetFileAttributes(FullPath->StartOfString);
+    if (Attributes == INVALID_FILE_ATTRIBUTES ||
+        (Attributes & FILE_ATTRIBUTE_DIRECTORY) == 0 ||
+        (Attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+
+        YoriLibFreeStringContents(FullPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Scan a directory tree in parallel and display the space used by each
+ directory within it.
+
+ @param DuContext Pointer to the context specifying the options to apply.
+
+ @param DirectoryName Pointer to the fully qualified name of the directory
+        to scan, in escaped form.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+DuParallelScan(
+    __in PDU_CONTEXT DuContext,
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PDU_PARALLEL_DIRECTORY Root;
+    BOOLEAN Complete;
+
+    Root = DuParallelAllocateDirectory(NULL, DirectoryName, 1);
+    if (Root == NULL) {
+        return FALSE;
+    }
+
+    DuContext->ParallelAllocationSize = 4096;
+    if (DuContext->AllocationSize) {
+        DuContext->ParallelAllocationSize = DuGetAllocationSize(&Root->DirectoryName);
+    }
+
+    DuParallelQueueDirectory(DuContext, Root);
+    Complete = (BOOLEAN)YoriLibWaitForWorkQueue(&DuContext->WorkQueue);
+
+    DuParallelReportAndFreeDirectory(DuContext, Root, Complete);
+    return Complete;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the du builtin command.
@@ -846,9 +1503,11 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T StartArg = 0;
     WORD MatchFlags;
     BOOLEAN BasicEnumeration = FALSE;
+    BOOLEAN VolumeScan = FALSE;
     DU_CONTEXT DuContext;
     YORI_STRING Combined;
     YORI_STRING Arg;
+    YORI_STRING FullPath;
 
     ZeroMemory(&DuContext, sizeof(DuContext));
 
@@ -884,6 +1543,19 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
                 DuContext.AverageHardLinkSize = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) && CharsConsumed > 0) {
+                        DuContext.ThreadCount = (DWORD)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                VolumeScan = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 if (i + 1 < ArgC) {
                     YORI_MAX_SIGNED_T Depth;
@@ -901,6 +1573,9 @@ ENTRYPOINT(
                     ArgumentUnderstood = TRUE;
                     i++;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("stats")) == 0) {
+                YoriLibEnableStatistics();
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("u")) == 0) {
                 DuContext.AllocationSize = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -951,10 +1626,29 @@ ENTRYPOINT(
     MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
                  YORILIB_FILEENUM_RETURN_DIRECTORIES |
                  YORILIB_FILEENUM_RECURSE_BEFORE_RETURN |
-                 YORILIB_FILEENUM_NO_LINK_TRAVERSE;
+                 YORILIB_FILEENUM_NO_LINK_TRAVERSE |
+                 YORILIB_FILEENUM_NO_SHORT_NAMES;
     if (BasicEnumeration) {
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
+    if (VolumeScan) {
+        MatchFlags |= YORILIB_FILEENUM_VOLUME_SCAN;
+    }
+
+    //
+    //  Reading the master file table is a single pass over the volume, so
+    //  it takes precedence over scanning directories in parallel.
+    //
+
+    if (VolumeScan) {
+        DuContext.ThreadCount = 1;
+    }
+
+    if (DuContext.ThreadCount > 1) {
+        if (!YoriLibInitializeWorkQueue(&DuContext.WorkQueue, (YORI_ALLOC_SIZE_T)DuContext.ThreadCount, 0, DuParallelDirectoryWorker, &DuContext)) {
+            DuContext.ThreadCount = 1;
+        }
+    }
 
     //
     //  If no file name is specified, use .
@@ -963,12 +1657,22 @@ ENTRYPOINT(
     if (StartArg == 0 || StartArg == ArgC) {
         YORI_STRING FilesInDirectorySpec;
         YoriLibConstantString(&FilesInDirectorySpec, _T("."));
-        YoriLibForEachFile(&FilesInDirectorySpec, MatchFlags, 0, DuFileFoundCallback, NULL, &DuContext);
-        DuReportAndCloseAllActiveStacks(&DuContext, 1);
+        if (DuParallelCanScan(&DuContext, &FilesInDirectorySpec, &FullPath)) {
+            DuParallelScan(&DuContext, &FullPath);
+            YoriLibFreeStringContents(&FullPath);
+        } else {
+            YoriLibForEachFile(&FilesInDirectorySpec, MatchFlags, 0, DuFileFoundCallback, NULL, &DuContext);
+            DuReportAndCloseAllActiveStacks(&DuContext, 1);
+        }
     } else {
         for (i = StartArg; i < ArgC; i++) {
-            YoriLibForEachFile(&ArgV[i], MatchFlags, 0, DuFileFoundCallback, DuFileEnumerateErrorCallback, &DuContext);
-            DuReportAndCloseAllActiveStacks(&DuContext, 1);
+            if (DuParallelCanScan(&DuContext, &ArgV[i], &FullPath)) {
+                DuParallelScan(&DuContext, &FullPath);
+                YoriLibFreeStringContents(&FullPath);
+            } else {
+                YoriLibForEachFile(&ArgV[i], MatchFlags, 0, DuFileFoundCallback, DuFileEnumerateErrorCallback, &DuContext);
+                DuReportAndCloseAllActiveStacks(&DuContext, 1);
+            }
         }
     }
 
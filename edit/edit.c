@@ -65,6 +65,67 @@ EditHelp(VOID)
     return TRUE;
 }
 
+/**
+ State for a file being loaded by a background thread.
+ */
+typedef struct _EDIT_LOAD_CONTEXT {
+
+    /**
+     Handle to the file being loaded.
+     */
+    HANDLE hSource;
+
+    /**
+     Handle to the background thread loading the file.
+     */
+    HANDLE hThread;
+
+    /**
+     A mutex synchronizing access to the pending lines between the
+     background thread and the thread processing input.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled to indicate the background thread should stop
+     loading.
+     */
+    HANDLE ShutdownEvent;
+
+    /**
+     An array of lines that have been loaded but not yet added to the edit
+     control.  Protected by Mutex.
+     */
+    PYORI_STRING PendingLines;
+
+    /**
+     The number of entries allocated in PendingLines.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T PendingLinesAllocated;
+
+    /**
+     The number of lines populated in PendingLines.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T PendingLinesPopulated;
+
+    /**
+     The multibyte input encoding to restore when the load completes.
+     */
+    DWORD SavedEncoding;
+
+    /**
+     The line ending of the first line in the file.  This is populated when
+     the background thread completes.
+     */
+    YORI_LIB_LINE_ENDING FirstLineEnding;
+
+    /**
+     TRUE if the background thread could not load the entire file.
+     */
+    BOOLEAN Failed;
+
+} EDIT_LOAD_CONTEXT, *PEDIT_LOAD_CONTEXT;
+
 /**
  A context that records files found and being operated on in the current
  window.
@@ -106,6 +167,12 @@ typedef struct _EDIT_CONTEXT {
      */
     YORI_STRING Newline;
 
+    /**
+     If a file is being loaded by a background thread, points to the state
+     of the load.  NULL if no load is in progress.
+     */
+    PEDIT_LOAD_CONTEXT LoadContext;
+
     /**
      The character encoding to use.
      */
@@ -349,21 +416,108 @@ EditUpdateOpenedFileCaption(
 }
 
 /**
- Process a single opened stream, enumerating through all lines and populating
- the multiline edit control with the contents.
+ The number of lines to load before making them visible in the edit control,
+ so the first screen of a file is displayed without waiting for the rest.
+ */
+#define EDIT_LOAD_FIRST_BATCH_LINES (0x100)
 
- @param EditContext Pointer to the edit context.
+/**
+ The number of lines to load in each later batch before making them visible
+ in the edit control.
+ */
+#define EDIT_LOAD_BATCH_LINES (0x10000)
+
+/**
+ The interval in milliseconds at which lines loaded by the background thread
+ are added to the edit control.
+ */
+#define EDIT_LOAD_POLL_INTERVAL (100)
+
+/**
+ Move lines that have been loaded by the background thread into the array of
+ lines waiting to be added to the edit control.
+
+ @param LoadContext Pointer to the load context.
 
- @param hSource The opened source stream.
+ @param LineArray Pointer to an array of lines that have been loaded.  On
+        success, ownership of the lines moves to the pending array, although
+        the array itself remains owned by the caller.
+
+ @param LineCount The number of lines in LineArray.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOLEAN
-EditPopulateFromStream(
-    __in PEDIT_CONTEXT EditContext,
-    __in HANDLE hSource
+EditLoadPublishLines(
+    __in PEDIT_LOAD_CONTEXT LoadContext,
+    __in PYORI_STRING LineArray,
+    __in YORI_ALLOC_SIZE_T LineCount
     )
 {
+    BOOLEAN Result;
+
+    Result = TRUE;
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+
+    if (LoadContext->PendingLinesPopulated + LineCount > LoadContext->PendingLinesAllocated) {
+        PYORI_STRING NewLineArray;
+        YORI_ALLOC_SIZE_T BytesToAllocate;
+        DWORD RequiredBytes;
+        DWORD DesiredBytes;
+
+        RequiredBytes = LoadContext->PendingLinesPopulated;
+        RequiredBytes = RequiredBytes + LineCount;
+        RequiredBytes = RequiredBytes * sizeof(YORI_STRING);
+
+        DesiredBytes = LoadContext->PendingLinesPopulated;
+        DesiredBytes = DesiredBytes + LineCount;
+        DesiredBytes = DesiredBytes * 2;
+        DesiredBytes = DesiredBytes * sizeof(YORI_STRING);
+
+        BytesToAllocate = YoriLibMaximumAllocationInRange(RequiredBytes, DesiredBytes);
+        NewLineArray = NULL;
+        if (BytesToAllocate != 0) {
+            NewLineArray = YoriLibReferencedMalloc(BytesToAllocate);
+        }
+
+        if (NewLineArray == NULL) {
+            Result = FALSE;
+        } else {
+            if (LoadContext->PendingLinesPopulated > 0) {
+                memcpy(NewLineArray, LoadContext->PendingLines, LoadContext->PendingLinesPopulated * sizeof(YORI_STRING));
+            }
+            if (LoadContext->PendingLines != NULL) {
+                YoriLibDereference(LoadContext->PendingLines);
+            }
+            LoadContext->PendingLines = NewLineArray;
+            LoadContext->PendingLinesAllocated = BytesToAllocate / sizeof(YORI_STRING);
+        }
+    }
+
+    if (Result) {
+        memcpy(&LoadContext->PendingLines[LoadContext->PendingLinesPopulated], LineArray, LineCount * sizeof(YORI_STRING));
+        LoadContext->PendingLinesPopulated = LoadContext->PendingLinesPopulated + LineCount;
+    }
+
+    ReleaseMutex(LoadContext->Mutex);
+    return Result;
+}
+
+/**
+ A background thread which enumerates through all lines in an opened stream,
+ and publishes them in batches to be added to the multiline edit control by
+ the thread processing input.
+
+ @param Context Pointer to the load context.
+
+ @return Thread exit code, which is not used.
+ */
+DWORD WINAPI
+EditLoadThread(
+    __in PVOID Context
+    )
+{
+    PEDIT_LOAD_CONTEXT LoadContext;
     PVOID LineContext = NULL;
     YORI_STRING LineString;
     PTCHAR NewLine;
@@ -376,15 +530,19 @@ EditPopulateFromStream(
     BOOLEAN Result;
     YORI_ALLOC_SIZE_T LinesAllocated;
     YORI_ALLOC_SIZE_T LinesPopulated;
+    YORI_ALLOC_SIZE_T BatchLines;
     DWORD BytesDesired;
     PYORI_STRING LineArray;
     YORI_LIB_LINE_ENDING FirstLineEnding;
     YORI_LIB_LINE_ENDING LineEnding;
     BOOL TimeoutReached;
 
+    LoadContext = (PEDIT_LOAD_CONTEXT)Context;
+
     LineArray = NULL;
     LinesAllocated = 0;
     LinesPopulated = 0;
+    BatchLines = EDIT_LOAD_FIRST_BATCH_LINES;
 
     FirstLineEnding = YoriLibLineEndingNone;
 
@@ -393,7 +551,7 @@ EditPopulateFromStream(
 
     while (TRUE) {
 
-        if (!YoriLibReadLineToStringEx(&LineString, &LineContext, TRUE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
+        if (!YoriLibReadLineToStringEx(&LineString, &LineContext, TRUE, INFINITE, LoadContext->hSource, &LineEnding, &TimeoutReached)) {
             break;
         }
 
@@ -437,7 +595,9 @@ EditPopulateFromStream(
         }
 
         //
-        //  See if more lines in the line array need to be allocated
+        //  See if more lines in the line array need to be allocated.  Since
+        //  lines are published in batches, this array only grows to the
+        //  size of a batch.
         //
 
         if (LinesPopulated == LinesAllocated) {
@@ -503,6 +663,24 @@ EditPopulateFromStream(
 
         BufferOffset = BufferOffset + BytesAfterAlignment;
         BytesRemainingInBuffer = BytesRemainingInBuffer - BytesAfterAlignment;
+
+        //
+        //  When a batch is complete, hand it to the input thread, and stop
+        //  if the load has been cancelled.
+        //
+
+        if (LinesPopulated >= BatchLines) {
+            if (!EditLoadPublishLines(LoadContext, LineArray, LinesPopulated)) {
+                Result = FALSE;
+                break;
+            }
+            LinesPopulated = 0;
+            BatchLines = EDIT_LOAD_BATCH_LINES;
+
+            if (WaitForSingleObject(LoadContext->ShutdownEvent, 0) == WAIT_OBJECT_0) {
+                break;
+            }
+        }
     }
 
     if (Buffer != NULL) {
@@ -512,35 +690,310 @@ EditPopulateFromStream(
     YoriLibLineReadCloseOrCache(LineContext);
     YoriLibFreeStringContents(&LineString);
 
-    if (Result == FALSE) {
+    if (LinesPopulated > 0 &&
+        !EditLoadPublishLines(LoadContext, LineArray, LinesPopulated)) {
+
+        Result = FALSE;
         while (LinesPopulated > 0) {
             YoriLibFreeStringContents(&LineArray[LinesPopulated - 1]);
             LinesPopulated--;
         }
+    }
 
-        if (LineArray != NULL) {
-            YoriLibDereference(LineArray);
-        }
+    if (LineArray != NULL) {
+        YoriLibDereference(LineArray);
+    }
 
-        return FALSE;
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+    LoadContext->FirstLineEnding = FirstLineEnding;
+    LoadContext->Failed = (BOOLEAN)!Result;
+    ReleaseMutex(LoadContext->Mutex);
+
+    return 0;
+}
+
+/**
+ Free a load context, including any lines that were loaded but not added to
+ the edit control.  The background thread must have terminated before this
+ is called.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditFreeLoadContext(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    PEDIT_LOAD_CONTEXT LoadContext;
+
+    LoadContext = EditContext->LoadContext;
+    EditContext->LoadContext = NULL;
+
+    YoriWinSetPeriodicNotifyCallback(YoriWinGetControlParent(EditContext->MultilineEdit), 0, NULL);
+    YoriLibSetMultibyteInputEncoding(LoadContext->SavedEncoding);
+
+    while (LoadContext->PendingLinesPopulated > 0) {
+        YoriLibFreeStringContents(&LoadContext->PendingLines[LoadContext->PendingLinesPopulated - 1]);
+        LoadContext->PendingLinesPopulated--;
     }
 
-    if (LinesPopulated > 0) {
-        YoriWinMultilineEditAppendLinesNoDataCopy(EditContext->MultilineEdit, LineArray, LinesPopulated);
+    if (LoadContext->PendingLines != NULL) {
+        YoriLibDereference(LoadContext->PendingLines);
+    }
 
-        YoriLibConstantString(&EditContext->Newline, _T("\r\n"));
-        if (FirstLineEnding == YoriLibLineEndingLF) {
-            YoriLibConstantString(&EditContext->Newline, _T("\n"));
-        } else if (FirstLineEnding == YoriLibLineEndingCR) {
-            YoriLibConstantString(&EditContext->Newline, _T("\r"));
-        }
+    if (LoadContext->hThread != NULL) {
+        CloseHandle(LoadContext->hThread);
+    }
+
+    if (LoadContext->ShutdownEvent != NULL) {
+        CloseHandle(LoadContext->ShutdownEvent);
     }
 
+    if (LoadContext->Mutex != NULL) {
+        CloseHandle(LoadContext->Mutex);
+    }
+
+    if (LoadContext->hSource != NULL) {
+        CloseHandle(LoadContext->hSource);
+    }
+
+    YoriLibFree(LoadContext);
+}
+
+/**
+ Add any lines loaded by the background thread to the multiline edit
+ control.  If the background thread has finished, complete the load.
+
+ @param EditContext Pointer to the edit context.
+
+ @return TRUE to indicate that the load is complete, FALSE if the background
+         thread is still loading.
+ */
+BOOLEAN
+EditProcessLoadedLines(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    PEDIT_LOAD_CONTEXT LoadContext;
+    PYORI_STRING LineArray;
+    YORI_ALLOC_SIZE_T LineCount;
+    BOOLEAN Complete;
+    BOOLEAN Failed;
+
+    LoadContext = EditContext->LoadContext;
+    if (LoadContext == NULL) {
+        return TRUE;
+    }
+
+    //
+    //  Check for thread completion before taking the lines, so all lines
+    //  published before completion are consumed here.
+    //
+
+    Complete = FALSE;
+    if (WaitForSingleObject(LoadContext->hThread, 0) == WAIT_OBJECT_0) {
+        Complete = TRUE;
+    }
+
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+    LineArray = LoadContext->PendingLines;
+    LineCount = LoadContext->PendingLinesPopulated;
+    LoadContext->PendingLines = NULL;
+    LoadContext->PendingLinesAllocated = 0;
+    LoadContext->PendingLinesPopulated = 0;
+    ReleaseMutex(LoadContext->Mutex);
+
     if (LineArray != NULL) {
+        if (LineCount > 0) {
+            YoriWinMultilineEditAppendLinesNoDataCopy(EditContext->MultilineEdit, LineArray, LineCount);
+        }
         YoriLibDereference(LineArray);
     }
 
-    return Result;
+    if (!Complete) {
+        return FALSE;
+    }
+
+    YoriLibConstantString(&EditContext->Newline, _T("\r\n"));
+    if (LoadContext->FirstLineEnding == YoriLibLineEndingLF) {
+        YoriLibConstantString(&EditContext->Newline, _T("\n"));
+    } else if (LoadContext->FirstLineEnding == YoriLibLineEndingCR) {
+        YoriLibConstantString(&EditContext->Newline, _T("\r"));
+    }
+
+    Failed = LoadContext->Failed;
+    EditFreeLoadContext(EditContext);
+
+    //
+    //  If the file could not be completely loaded, prevent it from being
+    //  edited, since saving it would discard the remainder of the file.
+    //
+
+    if (Failed) {
+        YORI_STRING Title;
+        YORI_STRING Text;
+        YORI_STRING ButtonText;
+
+        EditContext->ReadOnly = TRUE;
+
+        YoriLibConstantString(&Title, _T("Open"));
+        YoriLibConstantString(&Text, _T("The file could not be completely loaded and has been opened read only."));
+        YoriLibConstantString(&ButtonText, _T("Ok"));
+
+        YoriDlgMessageBox(EditContext->WinMgr,
+                          &Title,
+                          &Text,
+                          1,
+                          &ButtonText,
+                          0,
+                          0);
+    }
+
+    YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly);
+    return TRUE;
+}
+
+/**
+ If a file is being loaded in the background, wait for the load to complete
+ and add all of its lines to the edit control.  This is used before
+ operations that require the complete file, such as saving.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditWaitForLoad(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    if (EditContext->LoadContext == NULL) {
+        return;
+    }
+
+    WaitForSingleObject(EditContext->LoadContext->hThread, INFINITE);
+    EditProcessLoadedLines(EditContext);
+}
+
+/**
+ If a file is being loaded in the background, stop loading it and discard
+ any lines that have not yet been added to the edit control.
+
+ @param EditContext Pointer to the edit context.
+ */
+VOID
+EditCancelLoad(
+    __in PEDIT_CONTEXT EditContext
+    )
+{
+    if (EditContext->LoadContext == NULL) {
+        return;
+    }
+
+    SetEvent(EditContext->LoadContext->ShutdownEvent);
+    WaitForSingleObject(EditContext->LoadContext->hThread, INFINITE);
+    EditFreeLoadContext(EditContext);
+    YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly);
+}
+
+VOID
+EditNotifyCursorMove(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl,
+    __in DWORD CursorOffset,
+    __in DWORD CursorLine
+    );
+
+/**
+ A callback invoked periodically while a file is being loaded in the
+ background, to add loaded lines to the edit control.
+
+ @param WindowHandle Pointer to the main window.
+ */
+VOID
+EditLoadPeriodicCallback(
+    __in PYORI_WIN_CTRL_HANDLE WindowHandle
+    )
+{
+    PEDIT_CONTEXT EditContext;
+    YORI_ALLOC_SIZE_T CursorOffset;
+    YORI_ALLOC_SIZE_T CursorLine;
+
+    EditContext = YoriWinGetControlContext(WindowHandle);
+    if (EditContext == NULL) {
+        return;
+    }
+
+    EditProcessLoadedLines(EditContext);
+
+    YoriWinMultilineEditGetCursorLocation(EditContext->MultilineEdit, &CursorOffset, &CursorLine);
+    EditNotifyCursorMove(EditContext->MultilineEdit, CursorOffset, CursorLine);
+}
+
+/**
+ Start loading a single opened stream on a background thread.  Lines are
+ added to the multiline edit control in batches as they are loaded, so the
+ beginning of the file can be displayed before the entire file has been
+ read.  The control is read only until loading completes.
+
+ @param EditContext Pointer to the edit context.
+
+ @param hSource The opened source stream.  On success, this handle is owned
+        by the background load and will be closed when it completes.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+EditPopulateFromStream(
+    __in PEDIT_CONTEXT EditContext,
+    __in HANDLE hSource
+    )
+{
+    PEDIT_LOAD_CONTEXT LoadContext;
+    DWORD ThreadId;
+
+    ASSERT(EditContext->LoadContext == NULL);
+
+    LoadContext = YoriLibMalloc(sizeof(EDIT_LOAD_CONTEXT));
+    if (LoadContext == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(LoadContext, sizeof(EDIT_LOAD_CONTEXT));
+    LoadContext->SavedEncoding = YoriLibGetMultibyteInputEncoding();
+    EditContext->LoadContext = LoadContext;
+
+    LoadContext->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (LoadContext->Mutex == NULL) {
+        EditFreeLoadContext(EditContext);
+        return FALSE;
+    }
+
+    LoadContext->ShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (LoadContext->ShutdownEvent == NULL) {
+        EditFreeLoadContext(EditContext);
+        return FALSE;
+    }
+
+    if (!YoriWinSetPeriodicNotifyCallback(YoriWinGetControlParent(EditContext->MultilineEdit), EDIT_LOAD_POLL_INTERVAL, EditLoadPeriodicCallback)) {
+        EditFreeLoadContext(EditContext);
+        return FALSE;
+    }
+
+    //
+    //  The encoding is process wide, so it remains in effect until the
+    //  load completes and is restored when the load context is freed.
+    //
+
+    YoriLibSetMultibyteInputEncoding(EditContext->Encoding);
+
+    LoadContext->hSource = hSource;
+    LoadContext->hThread = CreateThread(NULL, 0, EditLoadThread, LoadContext, 0, &ThreadId);
+    if (LoadContext->hThread == NULL) {
+        LoadContext->hSource = NULL;
+        EditFreeLoadContext(EditContext);
+        return FALSE;
+    }
+
+    YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, TRUE);
+    return TRUE;
 }
 
 /**
@@ -639,7 +1092,6 @@ EditLoadFile(
     )
 {
     HANDLE hFile;
-    DWORD SavedEncoding;
 
     if (FileName->StartOfString == NULL) {
         return FALSE;
@@ -647,6 +1099,8 @@ EditLoadFile(
 
     ASSERT(YoriLibIsStringNullTerminated(FileName));
 
+    EditCancelLoad(EditContext);
+
     hFile = CreateFile(FileName->StartOfString, FILE_READ_DATA | FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (hFile == INVALID_HANDLE_VALUE) {
         return FALSE;
@@ -683,11 +1137,10 @@ EditLoadFile(
     }
 
     YoriWinMultilineEditClear(EditContext->MultilineEdit);
-    SavedEncoding = YoriLibGetMultibyteInputEncoding();
-    YoriLibSetMultibyteInputEncoding(EditContext->Encoding);
-    EditPopulateFromStream(EditContext, hFile);
-    YoriLibSetMultibyteInputEncoding(SavedEncoding);
-    CloseHandle(hFile);
+    if (!EditPopulateFromStream(EditContext, hFile)) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
     return TRUE;
 }
 
@@ -724,6 +1177,8 @@ EditSaveFile(
         return FALSE;
     }
 
+    EditWaitForLoad(EditContext);
+
     if (EditContext->Newline.StartOfString == NULL) {
         YoriLibConstantString(&EditContext->Newline, _T("\r\n"));
         __analysis_assume(EditContext->Newline.StartOfString != NULL);
@@ -981,6 +1436,7 @@ EditNewButtonClicked(
         return;
     }
 
+    EditCancelLoad(EditContext);
     EditContext->WriteBom = FALSE;
     YoriWinMultilineEditClear(EditContext->MultilineEdit);
     YoriLibFreeStringContents(&EditContext->OpenFileName);
@@ -1288,7 +1744,7 @@ EditOpenButtonClicked(
         EditContext->ReadOnly = FALSE;
     }
 
-    YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly);
+    YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly || EditContext->LoadContext != NULL);
 }
 
 VOID
@@ -1368,6 +1824,12 @@ EditSaveAsButtonClicked(
     Parent = YoriWinGetControlParent(Ctrl);
     EditContext = YoriWinGetControlContext(Parent);
 
+    //
+    //  The line ending of the file is only known once it has been loaded.
+    //
+
+    EditWaitForLoad(EditContext);
+
     EncodingCount = EditPopulateEncodingArray(EncodingValues, FALSE);
 
     YoriLibConstantString(&LineEndingValues[0].ValueText, _T("Windows (CRLF)"));
@@ -2084,6 +2546,62 @@ EditFindPreviousButtonClicked(
     }
 }
 
+/**
+ Replace every match of the search string from a specified point in the
+ multiline edit control to the end of the buffer.  All replacements are
+ combined into a single undo operation, and the display is updated once
+ when complete rather than after each match.
+
+ @param EditContext Pointer to the edit context specifying the multiline
+        edit control, the string to search for, and whether to search case
+        sensitively or insensitively.
+
+ @param StartLine The zero based first line to search.
+
+ @param StartOffset The zero based first character in the line to search.
+
+ @param NewText Pointer to the text to replace each match with.
+
+ @return The number of matches that were replaced.
+ */
+YORI_ALLOC_SIZE_T
+EditReplaceAll(
+    __in PEDIT_CONTEXT EditContext,
+    __in YORI_ALLOC_SIZE_T StartLine,
+    __in YORI_ALLOC_SIZE_T StartOffset,
+    __in PYORI_STRING NewText
+    )
+{
+    YORI_ALLOC_SIZE_T MatchLine;
+    YORI_ALLOC_SIZE_T MatchOffset;
+    YORI_ALLOC_SIZE_T ReplaceCount;
+
+    ReplaceCount = 0;
+    YoriWinMultilineEditBeginUndoGroup(EditContext->MultilineEdit);
+
+    while (EditFindNextMatchingString(EditContext, StartLine, StartOffset, &MatchLine, &MatchOffset)) {
+        if (!YoriWinMultilineEditReplaceTextRange(EditContext->MultilineEdit,
+                                                  MatchLine,
+                                                  MatchOffset,
+                                                  MatchLine,
+                                                  MatchOffset + EditContext->SearchString.LengthInChars,
+                                                  NewText,
+                                                  &StartLine,
+                                                  &StartOffset)) {
+            break;
+        }
+        ReplaceCount++;
+    }
+
+    YoriWinMultilineEditEndUndoGroup(EditContext->MultilineEdit);
+
+    if (ReplaceCount > 0) {
+        YoriWinMultilineEditSetCursorLocation(EditContext->MultilineEdit, StartOffset, StartLine);
+    }
+
+    return ReplaceCount;
+}
+
 /**
  A callback invoked when the change menu item is invoked.
 
@@ -2238,6 +2756,17 @@ EditChangeButtonClicked(
             EditContext->SearchMatchCase = MatchCase;
         }
 
+        //
+        //  When replacing everything, perform all replacements in one pass
+        //  starting from the current match, or the cursor if no match has
+        //  been found yet, without updating the display for each one.
+        //
+
+        if (ReplaceAll) {
+            EditReplaceAll(EditContext, StartLine, StartOffset, &NewText);
+            break;
+        }
+
         if (MatchFound) {
             YoriWinMultilineEditDeleteSelection(EditContext->MultilineEdit);
             YoriWinMultilineEditInsertTextAtCursor(EditContext->MultilineEdit, &NewText);
@@ -2250,12 +2779,6 @@ EditChangeButtonClicked(
 
         MatchFound = TRUE;
 
-        //
-        //  MSFIX: In the ReplaceAll case, this is still updating the off
-        //  screen buffer constantly.  Ideally this wouldn't happen, but
-        //  it still needs to be updated once before returning to the user.
-        //
-
         YoriWinMultilineEditSetSelectionRange(EditContext->MultilineEdit, NextMatchLine, NextMatchOffset, NextMatchLine, NextMatchOffset + EditContext->SearchString.LengthInChars);
         StartLine = NextMatchLine;
         StartOffset = NextMatchOffset;
@@ -2705,7 +3228,11 @@ EditNotifyCursorMove(
     EditContext = YoriWinGetControlContext(Parent);
 
     YoriLibInitEmptyString(&NewStatus);
-    YoriLibYPrintf(&NewStatus, _T("%06i:%04i "), CursorLine + 1, CursorOffset + 1);
+    if (EditContext->LoadContext != NULL) {
+        YoriLibYPrintf(&NewStatus, _T("Loading... %06i:%04i "), CursorLine + 1, CursorOffset + 1);
+    } else {
+        YoriLibYPrintf(&NewStatus, _T("%06i:%04i "), CursorLine + 1, CursorOffset + 1);
+    }
 
     YoriWinLabelSetCaption(EditContext->StatusBar, &NewStatus);
     YoriLibFreeStringContents(&NewStatus);
@@ -3135,7 +3662,7 @@ EditCreateMainWindow(
     if (EditContext->OpenFileName.StartOfString != NULL) {
         EditLoadFile(EditContext, &EditContext->OpenFileName);
         EditUpdateOpenedFileCaption(EditContext);
-        YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly);
+        YoriWinMultilineEditSetReadOnly(EditContext->MultilineEdit, EditContext->ReadOnly || EditContext->LoadContext != NULL);
     }
 
     YoriWinSetControlContext(Parent, EditContext);
@@ -3146,6 +3673,7 @@ EditCreateMainWindow(
         Result = FALSE;
     }
 
+    EditCancelLoad(EditContext);
     YoriWinDestroyWindow(Parent);
     YoriWinCloseWindowManager(WinMgr);
     return (BOOL)Result;
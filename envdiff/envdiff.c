@@ -35,8 +35,10 @@ CHAR strEnvDiffHelpText[] =
         "\n"
         "Compares the difference between the current environment and one in a file.\n"
         "\n"
-        "ENVDIFF [-license] [-r] [<file>]\n"
+        "ENVDIFF [-license] [-m] [-r] [<file>]\n"
         "\n"
+        "   -m             Output changes as a delta, one change per line, with a\n"
+        "                    prefix of + for added, - for removed or * for modified\n"
         "   -r             Reverse to apply changes to source to current environment\n";
 
 /**
@@ -198,7 +200,8 @@ typedef enum _ENVDIFF_CHANGE_TYPE {
  Specifies the format to output environment changes in.
  */
 typedef enum _ENVDIFF_OUTPUT_FORMAT {
-    EnvDiffOutputCmdBatch = 0
+    EnvDiffOutputCmdBatch = 0,
+    EnvDiffOutputDelta = 1
 } ENVDIFF_OUTPUT_FORMAT;
 
 /**
@@ -228,7 +231,22 @@ EnvDiffOutputDifference(
     )
 {
     UNREFERENCED_PARAMETER(BaseValue);
-    UNREFERENCED_PARAMETER(Format);
+
+    //
+    //  The delta format always contains the complete new value so that a
+    //  consumer can apply each line without any variable expansion.
+    //
+
+    if (Format == EnvDiffOutputDelta) {
+        if (ChangeType == EnvDiffChangeAdd) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("+%y=%y\n"), Key, NewValue);
+        } else if (ChangeType == EnvDiffChangeRemove) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("-%y\n"), Key);
+        } else if (ChangeType == EnvDiffChangeModify) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("*%y=%y\n"), Key, NewValue);
+        }
+        return TRUE;
+    }
 
     if (ChangeType == EnvDiffChangeAdd) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("set %y=%y\n"), Key, NewValue);
@@ -263,10 +281,125 @@ EnvDiffOutputDifference(
     return TRUE;
 }
 
+/**
+ Build an array of the keys within an environment block, sorted without
+ regard to case.  Each key points into the environment block, and the value
+ follows the key in the block, so the array can be used to locate both.
+ Variables whose name starts with "=" are used for per drive current
+ directories and exit codes, and are not really user state, so they are
+ not included.
+
+ @param EnvironmentBlock Pointer to the environment block.
+
+ @param Keys On successful completion, updated to point to an array of keys.
+        The caller is expected to free this with @ref YoriLibFree .
+
+ @param KeyCount On successful completion, updated to contain the number of
+        elements in the Keys array.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+EnvDiffBuildSortedKeyArray(
+    __in PYORI_STRING EnvironmentBlock,
+    __out PYORI_STRING * Keys,
+    __out PYORI_ALLOC_SIZE_T KeyCount
+    )
+{
+    YORI_STRING KeyValue;
+    PYORI_STRING KeyArray;
+    YORI_ALLOC_SIZE_T Offset;
+    YORI_ALLOC_SIZE_T Count;
+
+    //
+    //  Count the entries so the array can be allocated once.
+    //
+
+    Count = 0;
+    Offset = 0;
+    while (TRUE) {
+        EnvDiffKeyValueAtOffset(EnvironmentBlock, Offset, &KeyValue);
+        if (KeyValue.LengthInChars == 0) {
+            break;
+        }
+        Count++;
+        Offset = EnvDiffGetNextKeyValueOffset(EnvironmentBlock, &KeyValue, Offset);
+    }
+
+    KeyArray = YoriLibMalloc((Count + 1) * sizeof(YORI_STRING));
+    if (KeyArray == NULL) {
+        return FALSE;
+    }
+
+    Count = 0;
+    Offset = 0;
+    while (TRUE) {
+        EnvDiffKeyValueAtOffset(EnvironmentBlock, Offset, &KeyValue);
+        if (KeyValue.LengthInChars == 0) {
+            break;
+        }
+        EnvDiffGetKeyFromKeyValue(&KeyValue, &KeyArray[Count]);
+        if (KeyArray[Count].LengthInChars > 0 &&
+            KeyArray[Count].StartOfString[0] != '=') {
+
+            Count++;
+        }
+        Offset = EnvDiffGetNextKeyValueOffset(EnvironmentBlock, &KeyValue, Offset);
+    }
+
+    //
+    //  Sort the keys rather than the key value pairs, since the characters
+    //  following the key would otherwise influence the order.  The merge
+    //  below requires the order to match its key comparison exactly.
+    //
+
+    if (Count > 1) {
+        YoriLibSortStringArray(KeyArray, Count);
+    }
+
+    *Keys = KeyArray;
+    *KeyCount = Count;
+    return TRUE;
+}
+
+/**
+ Find the value that corresponds to a key within an environment block.  The
+ key must point into the environment block, and the value is the remainder
+ of the same NULL terminated string following the equals sign.
+
+ @param EnvironmentBlock Pointer to the environment block.
+
+ @param Key Pointer to the key within the environment block.
+
+ @param Value On completion, updated to point to the value string within the
+        environment block.
+ */
+VOID
+EnvDiffGetValueFromKey(
+    __in PYORI_STRING EnvironmentBlock,
+    __in PYORI_STRING Key,
+    __out PYORI_STRING Value
+    )
+{
+    YORI_STRING KeyValue;
+
+    EnvDiffKeyValueAtOffset(EnvironmentBlock,
+                            (YORI_ALLOC_SIZE_T)(Key->StartOfString - EnvironmentBlock->StartOfString),
+                            &KeyValue);
+    EnvDiffGetValueFromKeyValue(&KeyValue, Key, Value);
+}
+
 /**
  Compare two environment blocks, and output the differences in the specified
  format.
 
+ Each block is reduced to an array of keys which is sorted once, and the two
+ arrays are then compared in a single pass.  Environment blocks returned by
+ the system are normally sorted already, but a block loaded from a file or
+ pipe has no such guarantee, and comparing unsorted blocks in order would
+ report spurious changes.
+
  @param BaseEnvironment Pointer to the original environment block.
 
  @param NewEnvironment Pointer to the new environment block.
@@ -282,103 +415,76 @@ EnvDiffCompareEnvironments(
     __in ENVDIFF_OUTPUT_FORMAT OutputFormat
     )
 {
-    YORI_STRING BaseKeyValue;
-    YORI_STRING NewKeyValue;
-    YORI_STRING BaseKey;
-    YORI_STRING NewKey;
+    PYORI_STRING BaseKeys;
+    PYORI_STRING NewKeys;
+    YORI_ALLOC_SIZE_T BaseCount;
+    YORI_ALLOC_SIZE_T NewCount;
+    YORI_ALLOC_SIZE_T BaseIndex;
+    YORI_ALLOC_SIZE_T NewIndex;
     YORI_STRING BaseValue;
     YORI_STRING NewValue;
-    YORI_ALLOC_SIZE_T BaseStart;
-    YORI_ALLOC_SIZE_T NewStart;
     int Compare;
 
-    YoriLibInitEmptyString(&BaseKeyValue);
-    YoriLibInitEmptyString(&NewKeyValue);
-
-    BaseStart = 0;
-    NewStart = 0;
-
-    while (TRUE) {
-
-        EnvDiffKeyValueAtOffset(BaseEnvironment, BaseStart, &BaseKeyValue);
-        EnvDiffKeyValueAtOffset(NewEnvironment, NewStart, &NewKeyValue);
-
-        if (BaseKeyValue.LengthInChars == 0 &&
-            NewKeyValue.LengthInChars == 0) {
-
-            break;
-        }
-
-        EnvDiffGetKeyFromKeyValue(&BaseKeyValue, &BaseKey);
-        EnvDiffGetKeyFromKeyValue(&NewKeyValue, &NewKey);
-        EnvDiffGetValueFromKeyValue(&BaseKeyValue, &BaseKey, &BaseValue);
-        EnvDiffGetValueFromKeyValue(&NewKeyValue, &NewKey, &NewValue);
-
-        //
-        //  Skip any variables whose name starts with "=".  These are used for
-        //  per drive current directories and exit code, and are not 
-        //  really user state.
-        //
-
-        if (BaseKey.LengthInChars > 0 &&
-            BaseKey.StartOfString[0] == '=') {
+    if (!EnvDiffBuildSortedKeyArray(BaseEnvironment, &BaseKeys, &BaseCount)) {
+        return FALSE;
+    }
 
-            BaseStart = EnvDiffGetNextKeyValueOffset(BaseEnvironment, &BaseKeyValue, BaseStart);
-            continue;
-        }
+    if (!EnvDiffBuildSortedKeyArray(NewEnvironment, &NewKeys, &NewCount)) {
+        YoriLibFree(BaseKeys);
+        return FALSE;
+    }
 
-        if (NewKey.LengthInChars > 0 &&
-            NewKey.StartOfString[0] == '=') {
+    BaseIndex = 0;
+    NewIndex = 0;
 
-            NewStart = EnvDiffGetNextKeyValueOffset(NewEnvironment, &NewKeyValue, NewStart);
-            continue;
-        }
+    while (BaseIndex < BaseCount || NewIndex < NewCount) {
 
         //
         //  If there is no base value, there is a new variable added that is
         //  not in base.  If there is no new value, there is a value in base
-        //  that has been removed.
+        //  that has been removed.  If both have variables, check to see if
+        //  one is ahead of the other.  Because the keys are sorted, if
+        //  there's a difference we know which one has a variable that the
+        //  other does not by lexicographic order.
         //
 
-        if (BaseKeyValue.LengthInChars == 0) {
-            EnvDiffOutputDifference(&NewKey, NULL, &NewValue, OutputFormat, EnvDiffChangeAdd);
-            NewStart = EnvDiffGetNextKeyValueOffset(NewEnvironment, &NewKeyValue, NewStart);
-        } else if (NewKeyValue.LengthInChars == 0) {
-            EnvDiffOutputDifference(&BaseKey, &BaseValue, NULL, OutputFormat, EnvDiffChangeRemove);
-            BaseStart = EnvDiffGetNextKeyValueOffset(BaseEnvironment, &BaseKeyValue, BaseStart);
+        if (BaseIndex >= BaseCount) {
+            Compare = 1;
+        } else if (NewIndex >= NewCount) {
+            Compare = -1;
+        } else {
+            Compare = YoriLibCompareStringInsensitive(&BaseKeys[BaseIndex], &NewKeys[NewIndex]);
+        }
+
+        if (Compare < 0) {
+            EnvDiffGetValueFromKey(BaseEnvironment, &BaseKeys[BaseIndex], &BaseValue);
+            EnvDiffOutputDifference(&BaseKeys[BaseIndex], &BaseValue, NULL, OutputFormat, EnvDiffChangeRemove);
+            BaseIndex++;
+        } else if (Compare > 0) {
+            EnvDiffGetValueFromKey(NewEnvironment, &NewKeys[NewIndex], &NewValue);
+            EnvDiffOutputDifference(&NewKeys[NewIndex], NULL, &NewValue, OutputFormat, EnvDiffChangeAdd);
+            NewIndex++;
         } else {
 
             //
-            //  If both have variables, check to see if one is ahead of the
-            //  other.  Because environment blocks are sorted, if there's
-            //  a difference we know which one has a variable that the other
-            //  does not by lexicographic order.
+            //  If the value is the same, nothing has happened.
+            //  Otherwise, indicate the modification.
             //
 
-            Compare = YoriLibCompareStringInsensitive(&BaseKey, &NewKey);
-            if (Compare < 0) {
-                EnvDiffOutputDifference(&BaseKey, &BaseValue, NULL, OutputFormat, EnvDiffChangeRemove);
-                BaseStart = EnvDiffGetNextKeyValueOffset(BaseEnvironment, &BaseKeyValue, BaseStart);
-            } else if (Compare > 0) {
-                EnvDiffOutputDifference(&NewKey, NULL, &NewValue, OutputFormat, EnvDiffChangeAdd);
-                NewStart = EnvDiffGetNextKeyValueOffset(NewEnvironment, &NewKeyValue, NewStart);
-            } else {
-
-                //
-                //  If the value is the same, nothing has happened.
-                //  Otherwise, indicate the modification.
-                //
-
-                if (YoriLibCompareString(&BaseValue, &NewValue) != 0) {
-                    EnvDiffOutputDifference(&NewKey, &BaseValue, &NewValue, OutputFormat, EnvDiffChangeModify);
-                }
-                BaseStart = EnvDiffGetNextKeyValueOffset(BaseEnvironment, &BaseKeyValue, BaseStart);
-                NewStart = EnvDiffGetNextKeyValueOffset(NewEnvironment, &NewKeyValue, NewStart);
+            EnvDiffGetValueFromKey(BaseEnvironment, &BaseKeys[BaseIndex], &BaseValue);
+            EnvDiffGetValueFromKey(NewEnvironment, &NewKeys[NewIndex], &NewValue);
+            if (YoriLibCompareString(&BaseValue, &NewValue) != 0) {
+                EnvDiffOutputDifference(&NewKeys[NewIndex], &BaseValue, &NewValue, OutputFormat, EnvDiffChangeModify);
             }
+            BaseIndex++;
+            NewIndex++;
         }
     }
 
-    return FALSE;
+    YoriLibFree(BaseKeys);
+    YoriLibFree(NewKeys);
+
+    return TRUE;
 }
 
 /**
@@ -550,8 +656,10 @@ ENTRYPOINT(
     YORI_STRING CurrentEnvironment;
     YORI_STRING BaseEnvironment;
     BOOLEAN Reverse;
+    ENVDIFF_OUTPUT_FORMAT OutputFormat;
 
     Reverse = FALSE;
+    OutputFormat = EnvDiffOutputCmdBatch;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -566,6 +674,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2021"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                OutputFormat = EnvDiffOutputDelta;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 Reverse = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -609,10 +720,15 @@ ENTRYPOINT(
     }
 
     if (Result == EXIT_SUCCESS) {
+        BOOLEAN Compared;
         if (Reverse) {
-            EnvDiffCompareEnvironments(&CurrentEnvironment, &BaseEnvironment, EnvDiffOutputCmdBatch);
+            Compared = EnvDiffCompareEnvironments(&CurrentEnvironment, &BaseEnvironment, OutputFormat);
         } else {
-            EnvDiffCompareEnvironments(&BaseEnvironment, &CurrentEnvironment, EnvDiffOutputCmdBatch);
+            Compared = EnvDiffCompareEnvironments(&BaseEnvironment, &CurrentEnvironment, OutputFormat);
+        }
+        if (!Compared) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("envdiff: out of memory\n"));
+            Result = EXIT_FAILURE;
         }
     }
 
@@ -35,10 +35,11 @@ CHAR strEraseHelpText[] =
         "\n"
         "Delete one or more files.\n"
         "\n"
-        "ERASE [-license] [-b] [-p | -r] [-s] <file> [<file>...]\n"
+        "ERASE [-license] [-b] [-j <num>] [-p | -r] [-s] <file> [<file>...]\n"
         "\n"
         "   --             Treat all further arguments as files to delete\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -j <num>       Delete files on the specified number of threads\n"
         "   -p             Delete files with POSIX semantics\n"
         "   -r             Send files to the recycle bin\n"
         "   -s             Erase all files matching the pattern in all subdirectories\n";
@@ -72,6 +73,14 @@ typedef struct _ERASE_CONTEXT {
      */
     BOOLEAN RecycleBin;
 
+    /**
+     If TRUE, attempt to delete with POSIX semantics, and fall back to
+     regular deletion if the file system does not support it.  This is used
+     when deleting in parallel, so that files are removed from the
+     namespace as soon as each delete completes.
+     */
+    BOOLEAN TryPosixSemantics;
+
     /**
      The number of files found.
      */
@@ -82,8 +91,43 @@ typedef struct _ERASE_CONTEXT {
      */
     DWORDLONG FilesMarkedForDelete;
 
+    /**
+     The number of threads to delete files with.  If greater than one,
+     files are deleted in parallel.
+     */
+    DWORD ThreadCount;
+
+    /**
+     The number of files successfully marked for delete by worker threads.
+     This is added to FilesMarkedForDelete once the workers are idle.
+     */
+    DWORD ParallelFilesMarkedForDelete;
+
+    /**
+     When deleting in parallel, the work queue which deletes files.  This is
+     only initialized if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
 } ERASE_CONTEXT, *PERASE_CONTEXT;
 
+/**
+ A file to delete on a worker thread.
+ */
+typedef struct _ERASE_FILE {
+
+    /**
+     The work item used to queue this file to be deleted.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The fully qualified name of the file.  This is allocated as part of
+     this structure.
+     */
+    YORI_STRING FilePath;
+} ERASE_FILE, *PERASE_FILE;
+
 /**
  Delete a file via DeleteFile or via the POSIX delete API depending on which
  command line arguments were specified.
@@ -102,11 +146,183 @@ EraseDeleteFile(
     __in PYORI_STRING FileName
     )
 {
-    if (!EraseContext->PosixSemantics) {
-        return DeleteFile(FileName->StartOfString);
+    DWORD Err;
+
+    if (EraseContext->PosixSemantics) {
+        return YoriLibPosixDeleteFile(FileName);
+    }
+
+    //
+    //  If POSIX semantics are being attempted opportunistically, try them
+    //  first.  If the file system doesn't understand the request, stop
+    //  trying.  Any other failure falls through to a regular delete, so the
+    //  error reported is the one the user would normally see.
+    //
+
+    if (EraseContext->TryPosixSemantics) {
+        if (YoriLibPosixDeleteFile(FileName)) {
+            return TRUE;
+        }
+        Err = GetLastError();
+        if (Err == ERROR_INVALID_PARAMETER ||
+            Err == ERROR_INVALID_FUNCTION ||
+            Err == ERROR_NOT_SUPPORTED) {
+
+            EraseContext->TryPosixSemantics = FALSE;
+        }
+    }
+
+    return DeleteFile(FileName->StartOfString);
+}
+
+/**
+ Delete a file that was found, displaying any error to the user.  This may
+ be called on multiple threads concurrently.
+
+ @param EraseContext Pointer to the context indicating how to delete the
+        file.
+
+ @param FilePath Pointer to the fully qualified path to the file.
+
+ @return TRUE to indicate the file was marked for delete, FALSE if it was
+         not.
+ */
+BOOLEAN
+EraseDeleteFoundFile(
+    __in PERASE_CONTEXT EraseContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    DWORD Err;
+    LPTSTR ErrText;
+    BOOLEAN FileDeleted;
+
+    FileDeleted = FALSE;
+
+    //
+    //  If the user wanted it deleted via the recycle bin, try that.
+    //
+
+    if (EraseContext->RecycleBin) {
+        if (YoriLibRecycleBinFile(FilePath)) {
+            FileDeleted = TRUE;
+        }
+    }
+
+    //
+    //  If the user didn't ask for recycle bin or if that failed, delete
+    //  directly.
+    //
+
+    if (!FileDeleted && !EraseDeleteFile(EraseContext, FilePath)) {
+        Err = GetLastError();
+        if (Err == ERROR_ACCESS_DENIED) {
+            DWORD OldAttributes = GetFileAttributes(FilePath->StartOfString);
+            DWORD NewAttributes = OldAttributes & ~(FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM);
+
+            if (OldAttributes != NewAttributes) {
+                SetFileAttributes(FilePath->StartOfString, NewAttributes);
+
+                Err = NO_ERROR;
+
+                if (!EraseDeleteFile(EraseContext, FilePath)) {
+                    Err = GetLastError();
+                } else {
+                    FileDeleted = TRUE;
+                }
+
+                if (Err != NO_ERROR) {
+                    SetFileAttributes(FilePath->StartOfString, OldAttributes);
+                }
+            }
+        }
+
+        if (Err != NO_ERROR) {
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("erase: delete of %y failed: %s"), FilePath, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+        }
+    } else {
+        FileDeleted = TRUE;
+    }
+
+    return FileDeleted;
+}
+
+/**
+ A work queue callback invoked to delete a single file.
+
+ @param Context Pointer to the erase context.
+
+ @param Item Pointer to the work item within the file to delete.
+
+ @param Cancelled If TRUE, the operation has been cancelled, and the file
+        should not be deleted.
+ */
+VOID
+EraseFileWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PERASE_CONTEXT EraseContext;
+    PERASE_FILE EraseFile;
+
+    EraseContext = (PERASE_CONTEXT)Context;
+    EraseFile = CONTAINING_RECORD(Item, ERASE_FILE, WorkItem);
+
+    if (!Cancelled) {
+        if (EraseDeleteFoundFile(EraseContext, &EraseFile->FilePath)) {
+            InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&EraseContext->ParallelFilesMarkedForDelete);
+        }
     }
 
-    return YoriLibPosixDeleteFile(FileName);
+    YoriLibFree(EraseFile);
+}
+
+/**
+ Queue a file to be deleted on a worker thread.
+
+ @param EraseContext Pointer to the context including the work queue.
+
+ @param FilePath Pointer to the fully qualified path to the file.
+
+ @return TRUE to indicate the file was queued, FALSE if it was not and
+         should be deleted on the current thread.
+ */
+BOOLEAN
+EraseQueueFile(
+    __in PERASE_CONTEXT EraseContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PERASE_FILE EraseFile;
+    YORI_MAX_UNSIGNED_T BytesRequested;
+
+    BytesRequested = sizeof(ERASE_FILE) + (FilePath->LengthInChars + 1) * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesRequested)) {
+        return FALSE;
+    }
+
+    EraseFile = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequested);
+    if (EraseFile == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&EraseFile->FilePath);
+    EraseFile->FilePath.StartOfString = (LPTSTR)(EraseFile + 1);
+    EraseFile->FilePath.LengthAllocated = (YORI_ALLOC_SIZE_T)(FilePath->LengthInChars + 1);
+    memcpy(EraseFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    EraseFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+    EraseFile->FilePath.LengthInChars = FilePath->LengthInChars;
+
+    if (!YoriLibQueueWorkItem(&EraseContext->WorkQueue, &EraseFile->WorkItem, TRUE)) {
+        YoriLibFree(EraseFile);
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 /**
@@ -132,68 +348,26 @@ EraseFileFoundCallback(
     __in PVOID Context
     )
 {
-    DWORD Err;
-    LPTSTR ErrText;
-    BOOLEAN FileDeleted;
     PERASE_CONTEXT EraseContext = (PERASE_CONTEXT)Context;
 
     UNREFERENCED_PARAMETER(Depth);
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
-    FileDeleted = FALSE;
     if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
 
         EraseContext->FilesFound++;
 
-        //
-        //  If the user wanted it deleted via the recycle bin, try that.
-        //
-
-        if (EraseContext->RecycleBin) {
-            if (YoriLibRecycleBinFile(FilePath)) {
-                FileDeleted = TRUE;
+        if (EraseContext->ThreadCount > 1) {
+            if (EraseQueueFile(EraseContext, FilePath)) {
+                return TRUE;
             }
-        }
-
-        //
-        //  If the user didn't ask for recycle bin or if that failed, delete
-        //  directly.
-        //
-
-        if (!FileDeleted && !EraseDeleteFile(EraseContext, FilePath)) {
-            Err = GetLastError();
-            if (Err == ERROR_ACCESS_DENIED) {
-                DWORD OldAttributes = GetFileAttributes(FilePath->StartOfString);
-                DWORD NewAttributes = OldAttributes & ~(FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM);
-
-                if (OldAttributes != NewAttributes) {
-                    SetFileAttributes(FilePath->StartOfString, NewAttributes);
-
-                    Err = NO_ERROR;
-
-                    if (!EraseDeleteFile(EraseContext, FilePath)) {
-                        Err = GetLastError();
-                    } else {
-                        FileDeleted = TRUE;
-                    }
-
-                    if (Err != NO_ERROR) {
-                        SetFileAttributes(FilePath->StartOfString, OldAttributes);
-                    }
-                }
+            if (YoriLibIsOperationCancelled()) {
+                return FALSE;
             }
-
-            if (Err != NO_ERROR) {
-                ErrText = YoriLibGetWinErrorText(Err);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("erase: delete of %y failed: %s"), FilePath, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-            }
-        } else {
-            FileDeleted = TRUE;
         }
 
-        if (FileDeleted) {
+        if (EraseDeleteFoundFile(EraseContext, FilePath)) {
             EraseContext->FilesMarkedForDelete++;
         }
     }
@@ -312,6 +486,16 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) && CharsConsumed > 0) {
+                        Context.ThreadCount = (DWORD)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
                 Context.PosixSemantics = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -369,6 +553,23 @@ ENTRYPOINT(
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
 
+    //
+    //  The recycle bin is not used in parallel, since moving files there
+    //  requires the shell to process each request.
+    //
+
+    if (Context.RecycleBin) {
+        Context.ThreadCount = 1;
+    }
+
+    if (Context.ThreadCount > 1) {
+        if (!YoriLibInitializeWorkQueue(&Context.WorkQueue, (YORI_ALLOC_SIZE_T)Context.ThreadCount, 0, EraseFileWorker, &Context)) {
+            Context.ThreadCount = 1;
+        } else if (DllKernel32.pSetFileInformationByHandle != NULL) {
+            Context.TryPosixSemantics = TRUE;
+        }
+    }
+
     for (i = StartArg; i < ArgC; i++) {
 
         YoriLibForEachStream(&ArgV[i],
@@ -379,6 +580,12 @@ ENTRYPOINT(
                              &Context);
     }
 
+    if (Context.ThreadCount > 1) {
+        YoriLibWaitForWorkQueue(&Context.WorkQueue);
+        Context.FilesMarkedForDelete = Context.FilesMarkedForDelete + Context.ParallelFilesMarkedForDelete;
+    }
+    YoriLibCleanupWorkQueue(&Context.WorkQueue);
+
     if (Context.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("erase: no matching files found\n"));
         ASSERT(Context.FilesMarkedForDelete == 0);
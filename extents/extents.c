@@ -35,13 +35,124 @@ CHAR strExtentsHelpText[] =
         "\n"
         "Output location of files within a volume or disk.\n"
         "\n"
-        "EXTENTS [-license] <file>...\n"
+        "EXTENTS [-license] [-b] [-d] [-h] [-j <num>] [-r] [-s] <file>...\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -d             Return directories rather than directory contents\n"
         "   -h             Display output in hexadecimal\n"
+        "   -j <num>       Examine files for a report on the specified number of threads\n"
+        "   -r             Report fragmentation statistics and free space for the\n"
+        "                    volume containing the first file\n"
         "   -s             Process files from all subdirectories\n";
 
+/**
+ The size of the buffer used for the first query of a file's extents.  If
+ the file has more extents than fit, the buffer is doubled for each
+ subsequent query up to EXTENTS_MAX_RETRIEVAL_POINTER_SIZE.
+ */
+#define EXTENTS_INITIAL_RETRIEVAL_POINTER_SIZE (4096)
+
+/**
+ The largest buffer used to query a file's extents.
+ */
+#define EXTENTS_MAX_RETRIEVAL_POINTER_SIZE (1024 * 1024)
+
+/**
+ The size of the buffer used to query the allocation bitmap of a volume.
+ Each byte describes eight clusters.
+ */
+#define EXTENTS_BITMAP_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The number of buckets in the fragment count histogram.  The first bucket
+ counts files with no allocated clusters, and each later bucket counts files
+ with up to twice as many fragments as the one before.  The final bucket
+ counts all files with more fragments.
+ */
+#define EXTENTS_HISTOGRAM_BUCKETS (13)
+
+/**
+ The number of most fragmented files to display in a report.
+ */
+#define EXTENTS_WORST_FILE_COUNT (10)
+
+/**
+ The maximum number of files which can be waiting for a worker thread.
+ */
+#define EXTENTS_MAX_PENDING_FILES (1024)
+
+/**
+ Information about a heavily fragmented file.
+ */
+typedef struct _EXTENTS_WORST_FILE {
+
+    /**
+     The full path to the file.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The number of fragments in the file.
+     */
+    LONGLONG Fragments;
+
+} EXTENTS_WORST_FILE, *PEXTENTS_WORST_FILE;
+
+/**
+ Aggregate fragmentation information collected across all files.
+ */
+typedef struct _EXTENTS_REPORT {
+
+    /**
+     A mutex synchronizing updates from worker threads.  This is NULL if
+     files are not being processed by worker threads.
+     */
+    HANDLE Mutex;
+
+    /**
+     The volume containing the first file found, which is the volume whose
+     free space is reported.
+     */
+    YORI_STRING VolumeName;
+
+    /**
+     The number of files whose fragments were counted.
+     */
+    LONGLONG FilesCounted;
+
+    /**
+     The number of files which could not be examined.
+     */
+    LONGLONG FilesFailed;
+
+    /**
+     The number of files with more than one fragment.
+     */
+    LONGLONG FragmentedFiles;
+
+    /**
+     The total number of fragments across all files.
+     */
+    LONGLONG TotalFragments;
+
+    /**
+     The number of files whose fragment count falls in each bucket.
+     */
+    LONGLONG Histogram[EXTENTS_HISTOGRAM_BUCKETS];
+
+    /**
+     The number of valid entries in WorstFiles.
+     */
+    DWORD WorstFileCount;
+
+    /**
+     The most fragmented files found so far, in descending order of fragment
+     count.
+     */
+    EXTENTS_WORST_FILE WorstFiles[EXTENTS_WORST_FILE_COUNT];
+
+} EXTENTS_REPORT, *PEXTENTS_REPORT;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -67,8 +178,48 @@ typedef struct _EXTENTS_CONTEXT {
      */
     BOOLEAN DisplayHex;
 
+    /**
+     If TRUE, count fragments and display an aggregate report rather than
+     displaying the extents of each file.
+     */
+    BOOLEAN GenerateReport;
+
+    /**
+     The number of threads to use when generating a report.  Zero indicates
+     one thread per processor.  If one, files are processed on the
+     enumerating thread.
+     */
+    DWORD ThreadCount;
+
+    /**
+     A queue of files to count fragments for on worker threads.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     Aggregate information collected when generating a report.
+     */
+    EXTENTS_REPORT Report;
+
 } EXTENTS_CONTEXT, *PEXTENTS_CONTEXT;
 
+/**
+ A file whose fragments should be counted on a worker thread.
+ */
+typedef struct _EXTENTS_FILE_ITEM {
+
+    /**
+     The work item within the work queue.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The full path to the file.
+     */
+    YORI_STRING FilePath;
+
+} EXTENTS_FILE_ITEM, *PEXTENTS_FILE_ITEM;
+
 /**
  Display usage text to the user.
  */
@@ -83,6 +234,334 @@ ExtentsHelp(VOID)
     return TRUE;
 }
 
+/**
+ Attempt to increase the size of the buffer used to query a file's extents,
+ so that a file with many extents requires fewer queries.  If the buffer is
+ already at its maximum size or memory cannot be allocated, the existing
+ buffer is retained.  The contents of the buffer are not preserved.
+
+ @param RetrievalPointers On input, points to the current buffer.  On output,
+        points to the buffer to use for the next query.
+
+ @param RetrievalPointerSize On input, points to the size of the current
+        buffer.  On output, updated to contain the size of the buffer to use
+        for the next query.
+ */
+VOID
+ExtentsGrowRetrievalPointers(
+    __inout PRETRIEVAL_POINTERS_BUFFER * RetrievalPointers,
+    __inout PYORI_ALLOC_SIZE_T RetrievalPointerSize
+    )
+{
+    PRETRIEVAL_POINTERS_BUFFER NewRetrievalPointers;
+    YORI_ALLOC_SIZE_T NewRetrievalPointerSize;
+
+    if (*RetrievalPointerSize >= EXTENTS_MAX_RETRIEVAL_POINTER_SIZE) {
+        return;
+    }
+
+    NewRetrievalPointerSize = *RetrievalPointerSize * 2;
+    NewRetrievalPointers = YoriLibMalloc(NewRetrievalPointerSize);
+    if (NewRetrievalPointers == NULL) {
+        return;
+    }
+
+    YoriLibFree(*RetrievalPointers);
+    *RetrievalPointers = NewRetrievalPointers;
+    *RetrievalPointerSize = NewRetrievalPointerSize;
+}
+
+/**
+ Count the number of fragments in a file.  Extents which are physically
+ adjacent on the volume are counted as a single fragment.  Ranges of the
+ file which are not allocated do not end a fragment, so a compressed or
+ sparse file whose allocated ranges are in order is not considered
+ fragmented.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param FragmentCount On successful completion, updated to contain the
+        number of fragments in the file.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code indicating
+         the reason for failure.
+ */
+DWORD
+ExtentsCountFragments(
+    __in PYORI_STRING FilePath,
+    __out PLONGLONG FragmentCount
+    )
+{
+    HANDLE FileHandle;
+    STARTING_VCN_INPUT_BUFFER StartingVcn;
+    PRETRIEVAL_POINTERS_BUFFER RetrievalPointers;
+    YORI_ALLOC_SIZE_T RetrievalPointerSize;
+    DWORD BytesReturned;
+    DWORD Error;
+    DWORD Index;
+    BOOLEAN MoreToGo;
+    LONGLONG Fragments;
+    YORI_MAX_SIGNED_T CurrentVcn;
+    YORI_MAX_SIGNED_T NextVcn;
+    YORI_MAX_UNSIGNED_T Lcn;
+    YORI_MAX_UNSIGNED_T NextLcn;
+
+    *FragmentCount = 0;
+
+    RetrievalPointerSize = EXTENTS_INITIAL_RETRIEVAL_POINTER_SIZE;
+    RetrievalPointers = YoriLibMalloc(RetrievalPointerSize);
+    if (RetrievalPointers == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    FileHandle = CreateFile(FilePath->StartOfString,
+                            FILE_READ_ATTRIBUTES,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                            NULL);
+
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        Error = GetLastError();
+        YoriLibFree(RetrievalPointers);
+        return Error;
+    }
+
+    YoriLibLiAssignUnsigned(&StartingVcn.StartingVcn, 0);
+
+    Fragments = 0;
+    NextLcn = INVALID_LCN;
+    Error = ERROR_SUCCESS;
+    MoreToGo = TRUE;
+    while (MoreToGo) {
+        MoreToGo = FALSE;
+        if (!DeviceIoControl(FileHandle,
+                             FSCTL_GET_RETRIEVAL_POINTERS,
+                             &StartingVcn,
+                             sizeof(StartingVcn),
+                             RetrievalPointers,
+                             RetrievalPointerSize,
+                             &BytesReturned,
+                             NULL)) {
+
+            Error = GetLastError();
+            if (Error == ERROR_MORE_DATA) {
+                MoreToGo = TRUE;
+                Error = ERROR_SUCCESS;
+            } else {
+
+                //
+                //  A file with no extents has no fragments.
+                //
+
+                if (Error == ERROR_HANDLE_EOF) {
+                    Error = ERROR_SUCCESS;
+                }
+                break;
+            }
+        }
+
+        CurrentVcn = RetrievalPointers->StartingVcn.QuadPart;
+        for (Index = 0; Index < RetrievalPointers->ExtentCount; Index++) {
+            NextVcn = RetrievalPointers->Extents[Index].NextVcn.QuadPart;
+            Lcn = RetrievalPointers->Extents[Index].Lcn.QuadPart;
+            if (Lcn != INVALID_LCN) {
+                if (Lcn != NextLcn) {
+                    Fragments++;
+                }
+                NextLcn = Lcn + (NextVcn - CurrentVcn);
+            }
+            CurrentVcn = NextVcn;
+        }
+
+        if (MoreToGo) {
+            if (CurrentVcn <= StartingVcn.StartingVcn.QuadPart) {
+                Error = ERROR_INVALID_DATA;
+                break;
+            }
+            StartingVcn.StartingVcn.QuadPart = CurrentVcn;
+            ExtentsGrowRetrievalPointers(&RetrievalPointers, &RetrievalPointerSize);
+        }
+    }
+
+    CloseHandle(FileHandle);
+    YoriLibFree(RetrievalPointers);
+
+    *FragmentCount = Fragments;
+    return Error;
+}
+
+/**
+ Record the number of fragments in a file into the aggregate report.
+
+ @param Report Pointer to the aggregate report.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @param Fragments The number of fragments in the file.
+
+ @param Error ERROR_SUCCESS if the fragments in the file were counted, or a
+        Win32 error code indicating why the file could not be examined.
+ */
+VOID
+ExtentsRecordFragments(
+    __in PEXTENTS_REPORT Report,
+    __in PYORI_STRING FilePath,
+    __in LONGLONG Fragments,
+    __in DWORD Error
+    )
+{
+    DWORD Bucket;
+    DWORD Index;
+    LONGLONG Remaining;
+    YORI_STRING SavedPath;
+
+    if (Error != ERROR_SUCCESS) {
+        LPTSTR ErrText;
+        ErrText = YoriLibGetWinErrorText(Error);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("extents: could not examine %y: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    }
+
+    Bucket = 0;
+    if (Fragments > 0) {
+        Bucket = 1;
+        Remaining = Fragments;
+        while (Remaining > 1 && Bucket < EXTENTS_HISTOGRAM_BUCKETS - 1) {
+            Remaining = Remaining / 2;
+            Bucket++;
+        }
+    }
+
+    if (Report->Mutex != NULL) {
+        WaitForSingleObject(Report->Mutex, INFINITE);
+    }
+
+    if (Error != ERROR_SUCCESS) {
+        Report->FilesFailed++;
+    } else {
+        Report->FilesCounted++;
+        Report->TotalFragments = Report->TotalFragments + Fragments;
+        Report->Histogram[Bucket]++;
+        if (Fragments > 1) {
+            Report->FragmentedFiles++;
+        }
+    }
+
+    //
+    //  Insert the file into the list of most fragmented files, discarding
+    //  the least fragmented entry if the list is full.
+    //
+
+    if (Error == ERROR_SUCCESS && Fragments > 1) {
+        Index = Report->WorstFileCount;
+        while (Index > 0 && Report->WorstFiles[Index - 1].Fragments < Fragments) {
+            Index--;
+        }
+
+        YoriLibInitEmptyString(&SavedPath);
+        if (Index < EXTENTS_WORST_FILE_COUNT &&
+            YoriLibCopyString(&SavedPath, FilePath)) {
+
+            if (Report->WorstFileCount == EXTENTS_WORST_FILE_COUNT) {
+                YoriLibFreeStringContents(&Report->WorstFiles[EXTENTS_WORST_FILE_COUNT - 1].FilePath);
+            } else {
+                Report->WorstFileCount++;
+            }
+
+            memmove(&Report->WorstFiles[Index + 1],
+                    &Report->WorstFiles[Index],
+                    (Report->WorstFileCount - Index - 1) * sizeof(EXTENTS_WORST_FILE));
+
+            memcpy(&Report->WorstFiles[Index].FilePath, &SavedPath, sizeof(YORI_STRING));
+            Report->WorstFiles[Index].Fragments = Fragments;
+        }
+    }
+
+    if (Report->Mutex != NULL) {
+        ReleaseMutex(Report->Mutex);
+    }
+}
+
+/**
+ Count the fragments in a single file on a worker thread and record the
+ result into the aggregate report.
+
+ @param Context Pointer to the extents context.
+
+ @param Item Pointer to the work item within the file item.  The file item
+        is deallocated by this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be examined.
+ */
+VOID
+ExtentsWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PEXTENTS_CONTEXT ExtentsContext = (PEXTENTS_CONTEXT)Context;
+    PEXTENTS_FILE_ITEM FileItem;
+    LONGLONG Fragments;
+    DWORD Error;
+
+    FileItem = CONTAINING_RECORD(Item, EXTENTS_FILE_ITEM, WorkItem);
+
+    if (!Cancelled) {
+        Error = ExtentsCountFragments(&FileItem->FilePath, &Fragments);
+        ExtentsRecordFragments(&ExtentsContext->Report, &FileItem->FilePath, Fragments, Error);
+    }
+
+    YoriLibFreeStringContents(&FileItem->FilePath);
+    YoriLibFree(FileItem);
+}
+
+/**
+ Attempt to count the fragments in a file on a worker thread.
+
+ @param ExtentsContext Pointer to the extents context.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @return TRUE if the file was queued for a worker thread, FALSE if it was
+         not and should be examined by the caller.
+ */
+BOOL
+ExtentsQueueFile(
+    __in PEXTENTS_CONTEXT ExtentsContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PEXTENTS_FILE_ITEM FileItem;
+
+    FileItem = YoriLibMalloc(sizeof(EXTENTS_FILE_ITEM));
+    if (FileItem == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  The file name is a buffer owned by the enumerator which will be
+    //  reused for the next file, so it needs to be copied.
+    //
+
+    YoriLibInitEmptyString(&FileItem->FilePath);
+    if (!YoriLibCopyString(&FileItem->FilePath, FilePath)) {
+        YoriLibFree(FileItem);
+        return FALSE;
+    }
+
+    if (!YoriLibQueueWorkItem(&ExtentsContext->WorkQueue, &FileItem->WorkItem, TRUE)) {
+        YoriLibFreeStringContents(&FileItem->FilePath);
+        YoriLibFree(FileItem);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -132,6 +611,36 @@ ExtentsFileFoundCallback(
 
     ExtentsContext = (PEXTENTS_CONTEXT)Context;
 
+    //
+    //  When generating a report, only the number of fragments is needed,
+    //  so the volume does not need to be examined for each file.  Record
+    //  the volume for the first file so its free space can be reported.
+    //
+
+    if (ExtentsContext->GenerateReport) {
+        LONGLONG Fragments;
+
+        if (ExtentsContext->Report.VolumeName.LengthInChars == 0) {
+            YoriLibFreeStringContents(&ExtentsContext->Report.VolumeName);
+            if (!YoriLibGetVolumePathName(FilePath, &ExtentsContext->Report.VolumeName)) {
+                YoriLibInitEmptyString(&ExtentsContext->Report.VolumeName);
+            }
+        }
+
+        ExtentsContext->FilesFound++;
+        ExtentsContext->FilesFoundThisArg++;
+
+        if (ExtentsContext->ThreadCount != 1 &&
+            ExtentsQueueFile(ExtentsContext, FilePath)) {
+
+            return TRUE;
+        }
+
+        Error = ExtentsCountFragments(FilePath, &Fragments);
+        ExtentsRecordFragments(&ExtentsContext->Report, FilePath, Fragments, Error);
+        return TRUE;
+    }
+
     //
     //  Find the volume hosting this file.
     //
@@ -258,7 +767,7 @@ ExtentsFileFoundCallback(
 
     CloseHandle(VolumeHandle);
 
-    RetrievalPointerSize = 4096;
+    RetrievalPointerSize = EXTENTS_INITIAL_RETRIEVAL_POINTER_SIZE;
     RetrievalPointers = YoriLibMalloc(RetrievalPointerSize);
     if (RetrievalPointers == NULL) {
         YoriLibFreeStringContents(&VolRootName);
@@ -404,6 +913,7 @@ ExtentsFileFoundCallback(
                 }
             } else if (CurrentVcn > StartingVcn.StartingVcn.QuadPart) {
                 StartingVcn.StartingVcn.QuadPart = CurrentVcn;
+                ExtentsGrowRetrievalPointers(&RetrievalPointers, &RetrievalPointerSize);
             } else {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("extents: get retrieval pointers did not advance, previous start vcn %lli, new start vcn %lli\n"), StartingVcn.StartingVcn.QuadPart, CurrentVcn);
                 MoreToGo = FALSE;
@@ -433,6 +943,309 @@ ExtentsFileFoundCallback(
     return TRUE;
 }
 
+/**
+ Summary information about the free space on a volume.
+ */
+typedef struct _EXTENTS_FREE_SPACE {
+
+    /**
+     The number of free clusters.
+     */
+    YORI_MAX_UNSIGNED_T FreeClusters;
+
+    /**
+     The number of ranges of contiguous free clusters.
+     */
+    YORI_MAX_UNSIGNED_T FreeExtents;
+
+    /**
+     The number of clusters in the largest range of contiguous free
+     clusters.
+     */
+    YORI_MAX_UNSIGNED_T LargestFreeExtent;
+
+    /**
+     The number of free clusters found since the last allocated cluster.
+     */
+    YORI_MAX_UNSIGNED_T CurrentFreeExtent;
+
+} EXTENTS_FREE_SPACE, *PEXTENTS_FREE_SPACE;
+
+/**
+ Indicate that an allocated cluster has been found, ending any range of free
+ clusters in progress.
+
+ @param FreeSpace Pointer to the free space summary to update.
+ */
+VOID
+ExtentsEndFreeExtent(
+    __inout PEXTENTS_FREE_SPACE FreeSpace
+    )
+{
+    if (FreeSpace->CurrentFreeExtent == 0) {
+        return;
+    }
+
+    FreeSpace->FreeExtents++;
+    FreeSpace->FreeClusters = FreeSpace->FreeClusters + FreeSpace->CurrentFreeExtent;
+    if (FreeSpace->CurrentFreeExtent > FreeSpace->LargestFreeExtent) {
+        FreeSpace->LargestFreeExtent = FreeSpace->CurrentFreeExtent;
+    }
+    FreeSpace->CurrentFreeExtent = 0;
+}
+
+/**
+ Display a summary of the free space on a volume by walking its allocation
+ bitmap.
+
+ @param VolumeName Pointer to the name of the volume.
+ */
+VOID
+ExtentsDisplayFreeSpace(
+    __in PYORI_STRING VolumeName
+    )
+{
+    YORI_STRING VolRootName;
+    HANDLE VolumeHandle;
+    STARTING_LCN_INPUT_BUFFER StartingLcn;
+    PVOLUME_BITMAP_BUFFER Bitmap;
+    EXTENTS_FREE_SPACE FreeSpace;
+    YORI_MAX_UNSIGNED_T ClusterCount;
+    YORI_MAX_UNSIGNED_T Index;
+    DWORD BytesReturned;
+    DWORD Error;
+    LPTSTR ErrText;
+    BOOLEAN MoreToGo;
+    DWORD SectorsPerCluster;
+    DWORD SectorSize;
+    DWORD FreeClusters;
+    DWORD TotalClusters;
+    DWORDLONG BytesPerCluster;
+    UCHAR Byte;
+
+    //
+    //  GetDiskFreeSpace wants a name with a trailing backslash, and opening
+    //  the volume requires a name without one.
+    //
+
+    if (!YoriLibAllocateString(&VolRootName, (YORI_ALLOC_SIZE_T)(VolumeName->LengthInChars + 2))) {
+        return;
+    }
+
+    VolRootName.LengthInChars = YoriLibSPrintf(VolRootName.StartOfString, _T("%y"), VolumeName);
+    if (VolRootName.LengthInChars > 0 &&
+        VolRootName.StartOfString[VolRootName.LengthInChars - 1] != '\\') {
+
+        VolRootName.StartOfString[VolRootName.LengthInChars] = '\\';
+        VolRootName.StartOfString[VolRootName.LengthInChars + 1] = '\0';
+        VolRootName.LengthInChars++;
+    }
+
+    if (!GetDiskFreeSpace(VolRootName.StartOfString,
+                          &SectorsPerCluster,
+                          &SectorSize,
+                          &FreeClusters,
+                          &TotalClusters)) {
+        Error = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Error);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("extents: GetDiskFreeSpace of %y failed: %s\n"), &VolRootName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFreeStringContents(&VolRootName);
+        return;
+    }
+
+    BytesPerCluster = SectorsPerCluster * SectorSize;
+
+    VolRootName.LengthInChars--;
+    VolRootName.StartOfString[VolRootName.LengthInChars] = '\0';
+
+    VolumeHandle = CreateFile(VolRootName.StartOfString,
+                              FILE_READ_ATTRIBUTES | FILE_TRAVERSE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_OPEN_NO_RECALL,
+                              NULL);
+    if (VolumeHandle == INVALID_HANDLE_VALUE) {
+        Error = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Error);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("extents: open of %y failed: %s\n"), &VolRootName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFreeStringContents(&VolRootName);
+        return;
+    }
+
+    Bitmap = YoriLibMalloc(EXTENTS_BITMAP_BUFFER_SIZE);
+    if (Bitmap == NULL) {
+        CloseHandle(VolumeHandle);
+        YoriLibFreeStringContents(&VolRootName);
+        return;
+    }
+
+    ZeroMemory(&FreeSpace, sizeof(FreeSpace));
+    YoriLibLiAssignUnsigned(&StartingLcn.StartingLcn, 0);
+
+    Error = ERROR_SUCCESS;
+    MoreToGo = TRUE;
+    while (MoreToGo) {
+        MoreToGo = FALSE;
+        if (!DeviceIoControl(VolumeHandle,
+                             FSCTL_GET_VOLUME_BITMAP,
+                             &StartingLcn,
+                             sizeof(StartingLcn),
+                             Bitmap,
+                             EXTENTS_BITMAP_BUFFER_SIZE,
+                             &BytesReturned,
+                             NULL)) {
+
+            Error = GetLastError();
+            if (Error != ERROR_MORE_DATA) {
+                break;
+            }
+            MoreToGo = TRUE;
+            Error = ERROR_SUCCESS;
+        }
+
+        if (BytesReturned <= FIELD_OFFSET(VOLUME_BITMAP_BUFFER, Buffer)) {
+            break;
+        }
+
+        ClusterCount = (BytesReturned - FIELD_OFFSET(VOLUME_BITMAP_BUFFER, Buffer)) * 8;
+        if (ClusterCount > (YORI_MAX_UNSIGNED_T)Bitmap->BitmapSize.QuadPart) {
+            ClusterCount = (YORI_MAX_UNSIGNED_T)Bitmap->BitmapSize.QuadPart;
+        }
+
+        //
+        //  Most of a volume is either entirely allocated or entirely free
+        //  in runs much longer than eight clusters, so check a byte at a
+        //  time before checking individual bits.
+        //
+
+        for (Index = 0; Index < ClusterCount; ) {
+            Byte = Bitmap->Buffer[Index / 8];
+            if ((Index % 8) == 0 && Index + 8 <= ClusterCount) {
+                if (Byte == 0) {
+                    FreeSpace.CurrentFreeExtent = FreeSpace.CurrentFreeExtent + 8;
+                    Index = Index + 8;
+                    continue;
+                } else if (Byte == 0xFF) {
+                    ExtentsEndFreeExtent(&FreeSpace);
+                    Index = Index + 8;
+                    continue;
+                }
+            }
+
+            if (Byte & (1 << (Index % 8))) {
+                ExtentsEndFreeExtent(&FreeSpace);
+            } else {
+                FreeSpace.CurrentFreeExtent++;
+            }
+            Index++;
+        }
+
+        if (MoreToGo) {
+            StartingLcn.StartingLcn.QuadPart = Bitmap->StartingLcn.QuadPart + ClusterCount;
+        }
+    }
+
+    ExtentsEndFreeExtent(&FreeSpace);
+
+    YoriLibFree(Bitmap);
+    CloseHandle(VolumeHandle);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\nFree space on %y:\n"), &VolRootName);
+    if (Error != ERROR_SUCCESS) {
+        ErrText = YoriLibGetWinErrorText(Error);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Could not read volume bitmap: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Free clusters:          %lli (%lli bytes)\n"), FreeSpace.FreeClusters, FreeSpace.FreeClusters * BytesPerCluster);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Free extents:           %lli\n"), FreeSpace.FreeExtents);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Largest free extent:    %lli clusters (%lli bytes)\n"), FreeSpace.LargestFreeExtent, FreeSpace.LargestFreeExtent * BytesPerCluster);
+        if (FreeSpace.FreeExtents > 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Average free extent:    %lli clusters\n"), FreeSpace.FreeClusters / FreeSpace.FreeExtents);
+        }
+    }
+
+    YoriLibFreeStringContents(&VolRootName);
+}
+
+/**
+ Display the aggregate fragmentation report.
+
+ @param Report Pointer to the aggregate report.
+ */
+VOID
+ExtentsDisplayReport(
+    __in PEXTENTS_REPORT Report
+    )
+{
+    DWORD Index;
+    LONGLONG Low;
+    LONGLONG High;
+    TCHAR RangeBuffer[32];
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Files examined:           %lli\n"), Report->FilesCounted);
+    if (Report->FilesFailed > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Files not examined:       %lli\n"), Report->FilesFailed);
+    }
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Fragmented files:         %lli\n"), Report->FragmentedFiles);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Total fragments:          %lli\n"), Report->TotalFragments);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\nFragments per file:\n"));
+    for (Index = 0; Index < EXTENTS_HISTOGRAM_BUCKETS; Index++) {
+        if (Index == 0) {
+            YoriLibSPrintf(RangeBuffer, _T("0"));
+        } else {
+            Low = ((LONGLONG)1) << (Index - 1);
+            High = (((LONGLONG)1) << Index) - 1;
+            if (Index == EXTENTS_HISTOGRAM_BUCKETS - 1) {
+                YoriLibSPrintf(RangeBuffer, _T("%lli+"), Low);
+            } else if (Low == High) {
+                YoriLibSPrintf(RangeBuffer, _T("%lli"), Low);
+            } else {
+                YoriLibSPrintf(RangeBuffer, _T("%lli-%lli"), Low, High);
+            }
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  %-12s %lli\n"), RangeBuffer, Report->Histogram[Index]);
+    }
+
+    if (Report->WorstFileCount > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\nMost fragmented files:\n"));
+        for (Index = 0; Index < Report->WorstFileCount; Index++) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  %-12lli %y\n"), Report->WorstFiles[Index].Fragments, &Report->WorstFiles[Index].FilePath);
+        }
+    }
+
+    if (Report->VolumeName.LengthInChars > 0) {
+        ExtentsDisplayFreeSpace(&Report->VolumeName);
+    }
+}
+
+/**
+ Free any allocations within the aggregate report.
+
+ @param Report Pointer to the aggregate report.
+ */
+VOID
+ExtentsCleanupReport(
+    __in PEXTENTS_REPORT Report
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Report->WorstFileCount; Index++) {
+        YoriLibFreeStringContents(&Report->WorstFiles[Index].FilePath);
+    }
+    Report->WorstFileCount = 0;
+    YoriLibFreeStringContents(&Report->VolumeName);
+
+    if (Report->Mutex != NULL) {
+        CloseHandle(Report->Mutex);
+        Report->Mutex = NULL;
+    }
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the extents builtin command.
@@ -471,6 +1284,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
 
     ZeroMemory(&ExtentsContext, sizeof(ExtentsContext));
+    YoriLibInitEmptyString(&ExtentsContext.Report.VolumeName);
 
     for (i = 1; i < ArgC; i++) {
 
@@ -493,6 +1307,19 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
                 ExtentsContext.DisplayHex = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) && CharsConsumed > 0) {
+                        ExtentsContext.ThreadCount = (DWORD)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                ExtentsContext.GenerateReport = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -541,6 +1368,28 @@ ENTRYPOINT(
             MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
         }
 
+        //
+        //  Extents for individual files are displayed in order on this
+        //  thread.  When generating a report, files can be examined in any
+        //  order, so hand them to worker threads.
+        //
+
+        if (!ExtentsContext.GenerateReport) {
+            ExtentsContext.ThreadCount = 1;
+        }
+
+        if (ExtentsContext.ThreadCount != 1) {
+            ExtentsContext.Report.Mutex = CreateMutex(NULL, FALSE, NULL);
+            if (ExtentsContext.Report.Mutex == NULL) {
+                ExtentsContext.ThreadCount = 1;
+            } else if (!YoriLibInitializeWorkQueue(&ExtentsContext.WorkQueue, (YORI_ALLOC_SIZE_T)ExtentsContext.ThreadCount, EXTENTS_MAX_PENDING_FILES, ExtentsWorkItem, &ExtentsContext)) {
+                YoriLibCleanupWorkQueue(&ExtentsContext.WorkQueue);
+                CloseHandle(ExtentsContext.Report.Mutex);
+                ExtentsContext.Report.Mutex = NULL;
+                ExtentsContext.ThreadCount = 1;
+            }
+        }
+
         for (i = StartArg; i < ArgC; i++) {
 
             ExtentsContext.FilesFoundThisArg = 0;
@@ -554,13 +1403,25 @@ ENTRYPOINT(
                 }
             }
         }
+
+        if (ExtentsContext.ThreadCount != 1) {
+            YoriLibWaitForWorkQueue(&ExtentsContext.WorkQueue);
+            YoriLibCleanupWorkQueue(&ExtentsContext.WorkQueue);
+        }
     }
 
     if (ExtentsContext.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("extents: no matching files found\n"));
+        ExtentsCleanupReport(&ExtentsContext.Report);
         return EXIT_FAILURE;
     }
 
+    if (ExtentsContext.GenerateReport) {
+        ExtentsDisplayReport(&ExtentsContext.Report);
+    }
+
+    ExtentsCleanupReport(&ExtentsContext.Report);
+
     return EXIT_SUCCESS;
 }
 
@@ -35,13 +35,59 @@ CHAR strFInfoHelpText[] =
         "\n"
         "Output information about file metadata.\n"
         "\n"
-        "FINFO [-license] [-b] [-d] [-f fmt] [-s] <file>...\n"
+        "FINFO [-license] [-b] [-csv|-json] [-d] [-f fmt] [-s] <file>...\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -csv           Output the variables in the format string as CSV\n"
         "   -d             Return directories rather than directory contents\n"
         "   -f             Specify a custom format string\n"
+        "   -json          Output the variables in the format string as JSON\n"
         "   -s             Process files from all subdirectories\n";
 
+/**
+ Specifies a pointer to a function which can collect file information from
+ the disk or file system for some particular piece of data.
+ */
+typedef BOOL (* PFINFO_COLLECT_FN)(PYORI_FILE_INFO, PWIN32_FIND_DATA, PYORI_STRING);
+
+/**
+ A value for VariableIndex indicating a format element is literal text.
+ */
+#define FINFO_FORMAT_LITERAL ((YORI_ALLOC_SIZE_T)-1)
+
+/**
+ The number of characters to buffer before writing output.
+ */
+#define FINFO_OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/**
+ A single element of a format string, which is either literal text or a
+ variable to expand.
+ */
+typedef struct _FINFO_FORMAT_ELEMENT {
+
+    /**
+     The literal text to output.  This refers to the format string and is
+     only meaningful if VariableIndex is FINFO_FORMAT_LITERAL.
+     */
+    YORI_STRING Literal;
+
+    /**
+     The index of the variable within FInfoKnownVariables, or
+     FINFO_FORMAT_LITERAL if this element is literal text.
+     */
+    YORI_ALLOC_SIZE_T VariableIndex;
+} FINFO_FORMAT_ELEMENT, *PFINFO_FORMAT_ELEMENT;
+
+/**
+ The form of output to generate.
+ */
+typedef enum _FINFO_OUTPUT_FORMAT {
+    FInfoOutputFormatText = 0,
+    FInfoOutputFormatCsv = 1,
+    FInfoOutputFormatJson = 2
+} FINFO_OUTPUT_FORMAT;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -68,6 +114,12 @@ typedef struct _FINFO_CONTEXT {
      */
     YORI_FILE_INFO Entry;
 
+    /**
+     State allowing the collectors invoked for each variable to share a
+     single handle to the file.
+     */
+    YORILIB_COLLECT_SESSION CollectSession;
+
     /**
      Records the total number of files processed.
      */
@@ -78,13 +130,44 @@ typedef struct _FINFO_CONTEXT {
      */
     LONGLONG FilesFoundThisArg;
 
-} FINFO_CONTEXT, *PFINFO_CONTEXT;
+    /**
+     The form of output to generate.
+     */
+    FINFO_OUTPUT_FORMAT OutputFormat;
 
-/**
- Specifies a pointer to a function which can collect file information from
- the disk or file system for some particular piece of data.
- */
-typedef BOOL (* PFINFO_COLLECT_FN)(PYORI_FILE_INFO, PWIN32_FIND_DATA, PYORI_STRING);
+    /**
+     An array of elements generated by parsing the format string once, so
+     that each file does not need to parse it or look up variables by name.
+     */
+    PFINFO_FORMAT_ELEMENT FormatElements;
+
+    /**
+     The number of elements in the FormatElements array.
+     */
+    YORI_ALLOC_SIZE_T FormatElementCount;
+
+    /**
+     An array of the distinct functions needed to collect the information
+     referenced by the format string.  Each is invoked once per file.
+     */
+    PFINFO_COLLECT_FN * CollectFns;
+
+    /**
+     The number of elements in the CollectFns array.
+     */
+    YORI_ALLOC_SIZE_T CollectFnCount;
+
+    /**
+     A buffer of output which has been generated but not yet written.
+     */
+    YORI_STRING OutputBuffer;
+
+    /**
+     A buffer to generate the value of a single variable into.
+     */
+    YORI_STRING ValueBuffer;
+
+} FINFO_CONTEXT, *PFINFO_CONTEXT;
 
 /**
  Specifies a pointer to a function which can output a particular piece of file
@@ -848,6 +931,32 @@ FInfoOutputOwner(
     return OwnerLength;
 }
 
+/**
+ Output the full path to the file.
+
+ @param Context Pointer to context about the file, including previously
+        obtained information to satisfy the output request.
+
+ @param OutputString Pointer to a string to populate with the contents of
+        the variable.
+
+ @return The number of characters populated into the variable, or the number
+         of characters required to successfully populate the contents into
+         the variable.
+ */
+YORI_ALLOC_SIZE_T
+FInfoOutputPath(
+    __in PFINFO_CONTEXT Context,
+    __inout PYORI_STRING OutputString
+    )
+{
+    if (OutputString->LengthAllocated >= Context->FilePath->LengthInChars) {
+        memcpy(OutputString->StartOfString, Context->FilePath->StartOfString, Context->FilePath->LengthInChars * sizeof(TCHAR));
+        OutputString->LengthInChars = Context->FilePath->LengthInChars;
+    }
+    return Context->FilePath->LengthInChars;
+}
+
 /**
  Output the reparse tag.
 
@@ -1202,7 +1311,7 @@ typedef struct _FINFO_KNOWN_VARIABLE {
 
     /**
      Pointer to a function which can obtain the variable contents from
-     the system.
+     the system, or NULL if no information needs to be obtained.
      */
     PFINFO_COLLECT_FN CollectFn;
 
@@ -1310,6 +1419,9 @@ FINFO_KNOWN_VARIABLE FInfoKnownVariables[] = {
     {_T("OWNER"),              YoriLibCollectOwner,                 FInfoOutputOwner,
      _T("The owner of the file.")},
 
+    {_T("PATH"),               NULL,                                FInfoOutputPath,
+     _T("The full path to the file.")},
+
     {_T("REPARSETAG"),         YoriLibCollectReparseTag,            FInfoOutputReparseTag,
      _T("The reparse tag in decimal.")},
 
@@ -1373,40 +1485,552 @@ FInfoHelp(VOID)
 }
 
 /**
- Expand any variables in the format string of information to display for each
- file.
+ Parse the format string into an array of literal text and variables, and
+ determine the set of functions needed to collect the information for those
+ variables.  This is performed once so that each file can be processed
+ without parsing the format string or looking up variables by name.
 
- @param OutputString The buffer to populate with the result of variable
-        expansion.
+ @param FInfoContext Pointer to the context containing the format string.
+        On successful completion, the format elements and collect functions
+        are populated.
 
- @param VariableName The name of the variable to populate data from.
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+FInfoCompileFormat(
+    __inout PFINFO_CONTEXT FInfoContext
+    )
+{
+    PYORI_STRING FormatString;
+    PFINFO_FORMAT_ELEMENT Element;
+    YORI_STRING VariableName;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T FinalIndex;
+    YORI_ALLOC_SIZE_T IgnoreUntil;
+    YORI_ALLOC_SIZE_T LiteralStart;
+    YORI_ALLOC_SIZE_T ElementCount;
+    YORI_ALLOC_SIZE_T VariableIndex;
+    YORI_ALLOC_SIZE_T CollectIndex;
+    YORI_MAX_UNSIGNED_T BytesNeeded;
+    PFINFO_COLLECT_FN CollectFn;
+    DWORD Phase;
+
+    FormatString = &FInfoContext->FormatString;
+    ElementCount = 0;
+
+    for (Phase = 0; Phase < 2; Phase++) {
+        ElementCount = 0;
+        IgnoreUntil = 0;
+        LiteralStart = 0;
+
+        for (Index = 0; Index < FormatString->LengthInChars; Index++) {
+
+            //
+            //  Escapes are preserved in the output, but the character after
+            //  an escape is never the start of a variable.
+            //
+
+            if (Index >= IgnoreUntil && YoriLibIsEscapeChar(FormatString->StartOfString[Index])) {
+                IgnoreUntil = Index + 2;
+                continue;
+            }
+
+            if (Index < IgnoreUntil || FormatString->StartOfString[Index] != '$') {
+                continue;
+            }
+
+            if (Index > LiteralStart) {
+                if (Phase == 1) {
+                    Element = &FInfoContext->FormatElements[ElementCount];
+                    YoriLibInitEmptyString(&Element->Literal);
+                    Element->Literal.StartOfString = &FormatString->StartOfString[LiteralStart];
+                    Element->Literal.LengthInChars = Index - LiteralStart;
+                    Element->VariableIndex = FINFO_FORMAT_LITERAL;
+                }
+                ElementCount++;
+            }
+
+            FinalIndex = Index + 1;
+            while (FinalIndex < FormatString->LengthInChars && FormatString->StartOfString[FinalIndex] != '$') {
+                FinalIndex++;
+            }
+
+            YoriLibInitEmptyString(&VariableName);
+            VariableName.StartOfString = &FormatString->StartOfString[Index + 1];
+            VariableName.LengthInChars = FinalIndex - Index - 1;
+
+            //
+            //  Variables which are not known expand to nothing.
+            //
+
+            for (VariableIndex = 0; VariableIndex < sizeof(FInfoKnownVariables)/sizeof(FInfoKnownVariables[0]); VariableIndex++) {
+                if (YoriLibCompareStringWithLiteral(&VariableName, FInfoKnownVariables[VariableIndex].VariableName) == 0) {
+                    if (Phase == 1) {
+                        Element = &FInfoContext->FormatElements[ElementCount];
+                        YoriLibInitEmptyString(&Element->Literal);
+                        Element->VariableIndex = VariableIndex;
+                    }
+                    ElementCount++;
+                    break;
+                }
+            }
+
+            Index = FinalIndex;
+            LiteralStart = FinalIndex + 1;
+        }
+
+        if (FormatString->LengthInChars > LiteralStart) {
+            if (Phase == 1) {
+                Element = &FInfoContext->FormatElements[ElementCount];
+                YoriLibInitEmptyString(&Element->Literal);
+                Element->Literal.StartOfString = &FormatString->StartOfString[LiteralStart];
+                Element->Literal.LengthInChars = FormatString->LengthInChars - LiteralStart;
+                Element->VariableIndex = FINFO_FORMAT_LITERAL;
+            }
+            ElementCount++;
+        }
+
+        if (Phase == 0) {
+
+            //
+            //  Allocate the elements and the collect functions together.
+            //  There can't be more distinct collect functions than elements.
+            //
+
+            BytesNeeded = (YORI_MAX_UNSIGNED_T)ElementCount * (sizeof(FINFO_FORMAT_ELEMENT) + sizeof(PFINFO_COLLECT_FN));
+            if (BytesNeeded == 0) {
+                return TRUE;
+            }
+
+            if (!YoriLibIsSizeAllocatable(BytesNeeded)) {
+                return FALSE;
+            }
+
+            FInfoContext->FormatElements = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesNeeded);
+            if (FInfoContext->FormatElements == NULL) {
+                return FALSE;
+            }
 
- @param Context Pointer to a FINFO_CONTEXT structure containing state about
-        the file.
+            FInfoContext->CollectFns = (PFINFO_COLLECT_FN *)(FInfoContext->FormatElements + ElementCount);
+        }
+    }
+
+    FInfoContext->FormatElementCount = ElementCount;
+    FInfoContext->CollectFnCount = 0;
+
+    for (Index = 0; Index < ElementCount; Index++) {
+        Element = &FInfoContext->FormatElements[Index];
+        if (Element->VariableIndex == FINFO_FORMAT_LITERAL) {
+            continue;
+        }
 
- @return The number of characters populated or number of characters required
-         to successfully populate the variable contents.
+        CollectFn = FInfoKnownVariables[Element->VariableIndex].CollectFn;
+        if (CollectFn == NULL) {
+            continue;
+        }
+
+        for (CollectIndex = 0; CollectIndex < FInfoContext->CollectFnCount; CollectIndex++) {
+            if (FInfoContext->CollectFns[CollectIndex] == CollectFn) {
+                break;
+            }
+        }
+
+        if (CollectIndex == FInfoContext->CollectFnCount) {
+            FInfoContext->CollectFns[CollectIndex] = CollectFn;
+            FInfoContext->CollectFnCount++;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Write any buffered output.
+
+ @param FInfoContext Pointer to the context containing the output buffer.
  */
-YORI_ALLOC_SIZE_T
-FInfoExpandVariables(
-    __inout PYORI_STRING OutputString,
-    __in PYORI_STRING VariableName,
-    __in PVOID Context
+VOID
+FInfoFlushOutput(
+    __inout PFINFO_CONTEXT FInfoContext
     )
 {
+    if (FInfoContext->OutputBuffer.LengthInChars > 0) {
+        YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, &FInfoContext->OutputBuffer);
+        FInfoContext->OutputBuffer.LengthInChars = 0;
+    }
+}
+
+/**
+ Ensure the output buffer has space for a specified number of characters,
+ writing any buffered output if needed.
+
+ @param FInfoContext Pointer to the context containing the output buffer.
+
+ @param CharsNeeded The number of characters which are about to be added.
+
+ @return TRUE to indicate space is available, FALSE on failure.
+ */
+BOOL
+FInfoReserveOutput(
+    __inout PFINFO_CONTEXT FInfoContext,
+    __in YORI_ALLOC_SIZE_T CharsNeeded
+    )
+{
+    PYORI_STRING OutputBuffer;
+    YORI_ALLOC_SIZE_T NewLength;
+
+    OutputBuffer = &FInfoContext->OutputBuffer;
+    if (OutputBuffer->LengthInChars + CharsNeeded < OutputBuffer->LengthAllocated) {
+        return TRUE;
+    }
+
+    FInfoFlushOutput(FInfoContext);
+    if (CharsNeeded < OutputBuffer->LengthAllocated) {
+        return TRUE;
+    }
+
+    NewLength = FINFO_OUTPUT_BUFFER_SIZE;
+    if (NewLength <= CharsNeeded) {
+        NewLength = CharsNeeded + 1;
+    }
+
+    YoriLibFreeStringContents(OutputBuffer);
+    if (!YoriLibAllocateString(OutputBuffer, NewLength)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Add a string to the output buffer.
+
+ @param FInfoContext Pointer to the context containing the output buffer.
+
+ @param String Pointer to the string to add.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoAppendOutput(
+    __inout PFINFO_CONTEXT FInfoContext,
+    __in PCYORI_STRING String
+    )
+{
+    PYORI_STRING OutputBuffer;
+
+    if (!FInfoReserveOutput(FInfoContext, String->LengthInChars)) {
+        return FALSE;
+    }
+
+    OutputBuffer = &FInfoContext->OutputBuffer;
+    memcpy(&OutputBuffer->StartOfString[OutputBuffer->LengthInChars], String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+    OutputBuffer->LengthInChars = OutputBuffer->LengthInChars + String->LengthInChars;
+    return TRUE;
+}
+
+/**
+ Add a NULL terminated constant string to the output buffer.
+
+ @param FInfoContext Pointer to the context containing the output buffer.
+
+ @param Literal Pointer to the string to add.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoAppendOutputLiteral(
+    __inout PFINFO_CONTEXT FInfoContext,
+    __in LPCTSTR Literal
+    )
+{
+    YORI_STRING String;
+
+    YoriLibConstantString(&String, Literal);
+    return FInfoAppendOutput(FInfoContext, &String);
+}
+
+/**
+ Add a value to the output buffer, escaping it as needed for the current
+ output format.  For CSV, values containing a delimiter, quote or newline
+ are quoted.  For JSON, the value is always quoted.
+
+ @param FInfoContext Pointer to the context containing the output buffer.
+
+ @param Value Pointer to the value to add.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoAppendEscapedOutput(
+    __inout PFINFO_CONTEXT FInfoContext,
+    __in PCYORI_STRING Value
+    )
+{
+    PYORI_STRING OutputBuffer;
     YORI_ALLOC_SIZE_T Index;
-    YORI_ALLOC_SIZE_T CharsNeeded = 0;
-    PFINFO_CONTEXT FInfoContext = (PFINFO_CONTEXT)Context;
+    YORI_ALLOC_SIZE_T Dest;
+    BOOLEAN Quote;
+    TCHAR Char;
+
+    OutputBuffer = &FInfoContext->OutputBuffer;
+
+    if (FInfoContext->OutputFormat == FInfoOutputFormatCsv) {
+        Quote = FALSE;
+        for (Index = 0; Index < Value->LengthInChars; Index++) {
+            Char = Value->StartOfString[Index];
+            if (Char == ',' || Char == '"' || Char == '\r' || Char == '\n') {
+                Quote = TRUE;
+                break;
+            }
+        }
 
-    for (Index = 0; Index < sizeof(FInfoKnownVariables)/sizeof(FInfoKnownVariables[0]); Index++) {
-        if (YoriLibCompareStringWithLiteral(VariableName, FInfoKnownVariables[Index].VariableName) == 0) {
-            FInfoKnownVariables[Index].CollectFn(&FInfoContext->Entry, FInfoContext->FileInfo, FInfoContext->FilePath);
-            CharsNeeded = FInfoKnownVariables[Index].OutputFn(FInfoContext, OutputString);
-            break;
+        if (!Quote) {
+            return FInfoAppendOutput(FInfoContext, Value);
+        }
+
+        if (!FInfoReserveOutput(FInfoContext, Value->LengthInChars * 2 + 2)) {
+            return FALSE;
+        }
+
+        Dest = OutputBuffer->LengthInChars;
+        OutputBuffer->StartOfString[Dest++] = '"';
+        for (Index = 0; Index < Value->LengthInChars; Index++) {
+            Char = Value->StartOfString[Index];
+            if (Char == '"') {
+                OutputBuffer->StartOfString[Dest++] = '"';
+            }
+            OutputBuffer->StartOfString[Dest++] = Char;
+        }
+        OutputBuffer->StartOfString[Dest++] = '"';
+        OutputBuffer->LengthInChars = Dest;
+        return TRUE;
+    }
+
+    //
+    //  Each character may expand into a six character \u escape.
+    //
+
+    if (!FInfoReserveOutput(FInfoContext, Value->LengthInChars * 6 + 2)) {
+        return FALSE;
+    }
+
+    Dest = OutputBuffer->LengthInChars;
+    OutputBuffer->StartOfString[Dest++] = '"';
+    for (Index = 0; Index < Value->LengthInChars; Index++) {
+        Char = Value->StartOfString[Index];
+        if (Char == '"' || Char == '\\') {
+            OutputBuffer->StartOfString[Dest++] = '\\';
+            OutputBuffer->StartOfString[Dest++] = Char;
+        } else if (Char < 0x20) {
+            Dest = Dest + YoriLibSPrintfS(&OutputBuffer->StartOfString[Dest], 7, _T("\\u%04x"), Char);
+        } else {
+            OutputBuffer->StartOfString[Dest++] = Char;
+        }
+    }
+    OutputBuffer->StartOfString[Dest++] = '"';
+    OutputBuffer->LengthInChars = Dest;
+    return TRUE;
+}
+
+/**
+ Generate the value of a single variable for the current file.
+
+ @param FInfoContext Pointer to the context describing the current file.  The
+        value is generated into the ValueBuffer within this context.
+
+ @param VariableIndex The index of the variable within FInfoKnownVariables.
+
+ @param Value On successful completion, updated to refer to the value of the
+        variable.  This refers to the ValueBuffer within the context and is
+        valid until the next variable is generated.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoGenerateVariable(
+    __inout PFINFO_CONTEXT FInfoContext,
+    __in YORI_ALLOC_SIZE_T VariableIndex,
+    __out PYORI_STRING Value
+    )
+{
+    YORI_ALLOC_SIZE_T CharsNeeded;
+
+    if (FInfoContext->ValueBuffer.LengthAllocated < 256) {
+        YoriLibFreeStringContents(&FInfoContext->ValueBuffer);
+        if (!YoriLibAllocateString(&FInfoContext->ValueBuffer, 256)) {
+            return FALSE;
+        }
+    }
+
+    while (TRUE) {
+
+        //
+        //  Leave space after the available buffer so that output functions
+        //  which format with a NULL terminator always have room for it.
+        //
+
+        YoriLibInitEmptyString(Value);
+        Value->StartOfString = FInfoContext->ValueBuffer.StartOfString;
+        Value->LengthAllocated = FInfoContext->ValueBuffer.LengthAllocated - 1;
+
+        CharsNeeded = FInfoKnownVariables[VariableIndex].OutputFn(FInfoContext, Value);
+        if (CharsNeeded <= Value->LengthAllocated) {
+            Value->LengthInChars = CharsNeeded;
+            return TRUE;
+        }
+
+        YoriLibFreeStringContents(&FInfoContext->ValueBuffer);
+        if (!YoriLibAllocateString(&FInfoContext->ValueBuffer, CharsNeeded + 1)) {
+            return FALSE;
+        }
+    }
+}
+
+/**
+ Output the header for the current output format, before any files are
+ processed.
+
+ @param FInfoContext Pointer to the context describing the format.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoOutputHeader(
+    __inout PFINFO_CONTEXT FInfoContext
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T VariableIndex;
+    BOOLEAN First;
+
+    if (FInfoContext->OutputFormat == FInfoOutputFormatJson) {
+        return FInfoAppendOutputLiteral(FInfoContext, _T("["));
+    }
+
+    if (FInfoContext->OutputFormat != FInfoOutputFormatCsv) {
+        return TRUE;
+    }
+
+    First = TRUE;
+    for (Index = 0; Index < FInfoContext->FormatElementCount; Index++) {
+        VariableIndex = FInfoContext->FormatElements[Index].VariableIndex;
+        if (VariableIndex == FINFO_FORMAT_LITERAL) {
+            continue;
+        }
+
+        if (!First && !FInfoAppendOutputLiteral(FInfoContext, _T(","))) {
+            return FALSE;
         }
+        First = FALSE;
+
+        if (!FInfoAppendOutputLiteral(FInfoContext, FInfoKnownVariables[VariableIndex].VariableName)) {
+            return FALSE;
+        }
+    }
+
+    return FInfoAppendOutputLiteral(FInfoContext, _T("\n"));
+}
+
+/**
+ Output the trailer for the current output format, after all files are
+ processed, and write any buffered output.
+
+ @param FInfoContext Pointer to the context describing the format.
+ */
+VOID
+FInfoOutputTrailer(
+    __inout PFINFO_CONTEXT FInfoContext
+    )
+{
+    if (FInfoContext->OutputFormat == FInfoOutputFormatJson) {
+        FInfoAppendOutputLiteral(FInfoContext, _T("\n]\n"));
     }
 
-    return CharsNeeded;
+    FInfoFlushOutput(FInfoContext);
+}
+
+/**
+ Output the information about the current file according to the compiled
+ format and output format.
+
+ @param FInfoContext Pointer to the context describing the current file.
+
+ @return TRUE to indicate success, FALSE on failure.
+ */
+BOOL
+FInfoOutputFile(
+    __inout PFINFO_CONTEXT FInfoContext
+    )
+{
+    PFINFO_FORMAT_ELEMENT Element;
+    YORI_STRING Value;
+    YORI_ALLOC_SIZE_T Index;
+    BOOLEAN First;
+
+    if (FInfoContext->OutputFormat == FInfoOutputFormatText) {
+        if (FInfoContext->FilesFound > 1 && !FInfoAppendOutputLiteral(FInfoContext, _T("\n"))) {
+            return FALSE;
+        }
+
+        for (Index = 0; Index < FInfoContext->FormatElementCount; Index++) {
+            Element = &FInfoContext->FormatElements[Index];
+            if (Element->VariableIndex == FINFO_FORMAT_LITERAL) {
+                if (!FInfoAppendOutput(FInfoContext, &Element->Literal)) {
+                    return FALSE;
+                }
+            } else {
+                if (!FInfoGenerateVariable(FInfoContext, Element->VariableIndex, &Value) ||
+                    !FInfoAppendOutput(FInfoContext, &Value)) {
+                    return FALSE;
+                }
+            }
+        }
+
+        return TRUE;
+    }
+
+    if (FInfoContext->OutputFormat == FInfoOutputFormatJson) {
+        if (FInfoContext->FilesFound > 1 && !FInfoAppendOutputLiteral(FInfoContext, _T(","))) {
+            return FALSE;
+        }
+        if (!FInfoAppendOutputLiteral(FInfoContext, _T("\n {"))) {
+            return FALSE;
+        }
+    }
+
+    First = TRUE;
+    for (Index = 0; Index < FInfoContext->FormatElementCount; Index++) {
+        Element = &FInfoContext->FormatElements[Index];
+        if (Element->VariableIndex == FINFO_FORMAT_LITERAL) {
+            continue;
+        }
+
+        if (!First && !FInfoAppendOutputLiteral(FInfoContext, _T(","))) {
+            return FALSE;
+        }
+        First = FALSE;
+
+        if (FInfoContext->OutputFormat == FInfoOutputFormatJson) {
+            if (!FInfoAppendOutputLiteral(FInfoContext, _T("\"")) ||
+                !FInfoAppendOutputLiteral(FInfoContext, FInfoKnownVariables[Element->VariableIndex].VariableName) ||
+                !FInfoAppendOutputLiteral(FInfoContext, _T("\":"))) {
+
+                return FALSE;
+            }
+        }
+
+        if (!FInfoGenerateVariable(FInfoContext, Element->VariableIndex, &Value) ||
+            !FInfoAppendEscapedOutput(FInfoContext, &Value)) {
+            return FALSE;
+        }
+    }
+
+    if (FInfoContext->OutputFormat == FInfoOutputFormatJson) {
+        return FInfoAppendOutputLiteral(FInfoContext, _T("}"));
+    }
+
+    return FInfoAppendOutputLiteral(FInfoContext, _T("\n"));
 }
 
 /**
@@ -1432,10 +2056,11 @@ FInfoFileFoundCallback(
     __in PVOID Context
     )
 {
-    YORI_STRING DisplayString;
     WIN32_FIND_DATA LocalFileInfo;
     PWIN32_FIND_DATA FileInfoToUse;
     PFINFO_CONTEXT FInfoContext;
+    YORI_ALLOC_SIZE_T Index;
+    BOOL Result;
 
     UNREFERENCED_PARAMETER(Depth);
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
@@ -1455,18 +2080,18 @@ FInfoFileFoundCallback(
     FInfoContext->FilesFound++;
     FInfoContext->FilesFoundThisArg++;
 
-    YoriLibInitEmptyString(&DisplayString);
-    YoriLibExpandCommandVariables(&FInfoContext->FormatString, '$', TRUE, FInfoExpandVariables, FInfoContext, &DisplayString);
-    if (DisplayString.StartOfString != NULL) {
-        if (FInfoContext->FilesFound > 1) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n%y"), &DisplayString);
-        } else {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
-        }
-        YoriLibFreeStringContents(&DisplayString);
+    YoriLibBeginCollectSession(&FInfoContext->CollectSession, &FInfoContext->Entry);
+    for (Index = 0; Index < FInfoContext->CollectFnCount; Index++) {
+        FInfoContext->CollectFns[Index](&FInfoContext->Entry, FileInfoToUse, FilePath);
     }
+    YoriLibEndCollectSession(&FInfoContext->CollectSession, &FInfoContext->Entry);
 
-    return TRUE;
+    Result = FInfoOutputFile(FInfoContext);
+    if (!Result) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("finfo: out of memory\n"));
+    }
+
+    return Result;
 }
 
 /**
@@ -1496,6 +2121,25 @@ TCHAR FInfoDefaultFormatString[] =
     _T("WRITEDATE:        $WRITEDATE_YEAR$/$WRITEDATE_MON$/$WRITEDATE_DAY$\n")
     _T("WRITETIME:        $WRITETIME_HOUR$:$WRITETIME_MIN$:$WRITETIME_SEC$\n");
 
+/**
+ Free any allocations within the context.
+
+ @param FInfoContext Pointer to the context to clean up.
+ */
+VOID
+FInfoCleanupContext(
+    __inout PFINFO_CONTEXT FInfoContext
+    )
+{
+    if (FInfoContext->FormatElements != NULL) {
+        YoriLibFree(FInfoContext->FormatElements);
+        FInfoContext->FormatElements = NULL;
+        FInfoContext->CollectFns = NULL;
+    }
+    YoriLibFreeStringContents(&FInfoContext->OutputBuffer);
+    YoriLibFreeStringContents(&FInfoContext->ValueBuffer);
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the finfo builtin command.
@@ -1534,6 +2178,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
 
     ZeroMemory(&FInfoContext, sizeof(FInfoContext));
+    YoriLibInitializeCollectSession(&FInfoContext.CollectSession);
     YoriLibConstantString(&FInfoContext.FormatString, FInfoDefaultFormatString);
 
     for (i = 1; i < ArgC; i++) {
@@ -1551,6 +2196,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("csv")) == 0) {
+                FInfoContext.OutputFormat = FInfoOutputFormatCsv;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 ReturnDirectories = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1560,6 +2208,9 @@ ENTRYPOINT(
                     i++;
                     memcpy(&FInfoContext.FormatString, &ArgV[i], sizeof(YORI_STRING));
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("json")) == 0) {
+                FInfoContext.OutputFormat = FInfoOutputFormatJson;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1592,6 +2243,14 @@ ENTRYPOINT(
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("finfo: missing argument\n"));
         return EXIT_FAILURE;
     } else {
+        if (!FInfoCompileFormat(&FInfoContext) ||
+            !FInfoOutputHeader(&FInfoContext)) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("finfo: out of memory\n"));
+            FInfoCleanupContext(&FInfoContext);
+            return EXIT_FAILURE;
+        }
+
         MatchFlags = YORILIB_FILEENUM_RETURN_FILES;
 
         if (ReturnDirectories) {
@@ -1621,8 +2280,12 @@ ENTRYPOINT(
                 }
             }
         }
+
+        FInfoOutputTrailer(&FInfoContext);
     }
 
+    FInfoCleanupContext(&FInfoContext);
+
     if (FInfoContext.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("finfo: no matching files found\n"));
         return EXIT_FAILURE;
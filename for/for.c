@@ -38,7 +38,7 @@ const
 CHAR strForHelpText[] =
         "Enumerates through a list of strings or files.\n"
         "\n"
-        "FOR [-license] [-b] [-c] [-d] [-i <criteria>] [-l] [-p n] [-r]\n"
+        "FOR [-license] [-b] [-c] [-d] [-i <criteria>] [-l] [-o] [-p n] [-r] [-t]\n"
         "    <var> in (<list>) do <cmd>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
@@ -46,8 +46,10 @@ CHAR strForHelpText[] =
         "   -d             Match directories rather than files\n"
         "   -i <criteria>  Only treat match files if they meet criteria, see below\n"
         "   -l             Use (start,step,end) notation for the list\n"
+        "   -o             Display the output of each command together once it completes\n"
         "   -p <n>         Execute with <n> concurrent processes\n"
         "   -r             Look for matches in subdirectories under the current directory\n"
+        "   -t             Prefix each line of output with the item being processed\n"
         "\n"
         " The -i option will match files only if they meet criteria.  This is a\n"
         " semicolon delimited list of entries matching the following form:\n"
@@ -75,6 +77,82 @@ ForHelp(VOID)
     return TRUE;
 }
 
+/**
+ The interval in milliseconds to check child processes which could not be
+ placed in a job object and therefore cannot report their completion.
+ */
+#define FOR_UNMONITORED_CHILD_POLL_INTERVAL (20)
+
+/**
+ Information about a single child process launched to process an item.
+ */
+typedef struct _FOR_CHILD {
+
+    /**
+     A handle to the child process.  This is NULL if this slot is not
+     currently in use.
+     */
+    HANDLE ProcessHandle;
+
+    /**
+     The process identifier of the child process.
+     */
+    DWORD ProcessId;
+
+    /**
+     A job object containing the child process, which notifies the
+     completion port when the process exits.  This is NULL if the child is
+     not being monitored via a job object.
+     */
+    HANDLE JobObject;
+
+    /**
+     A handle to the read end of a pipe receiving the output of the child
+     process.  This is NULL if the child's output is not being captured.
+     */
+    HANDLE OutputPipe;
+
+    /**
+     A handle to the thread reading from OutputPipe.
+     */
+    HANDLE PumpThread;
+
+    /**
+     A mutex to synchronize output from all child processes, so that each
+     line or each item is written without interruption.
+     */
+    HANDLE OutputMutex;
+
+    /**
+     A copy of the item being processed by this child, used to prefix its
+     output.
+     */
+    YORI_STRING Match;
+
+    /**
+     Output collected from the child process which will be displayed once
+     the child completes.
+     */
+    YORI_STRING Output;
+
+    /**
+     TRUE if the child could not be placed in a job object and needs to be
+     polled to determine when it completes.
+     */
+    BOOLEAN Unmonitored;
+
+    /**
+     TRUE if the output of the child should be collected and displayed once
+     the child completes.  FALSE if each line is displayed as it arrives.
+     */
+    BOOLEAN BufferOutput;
+
+    /**
+     TRUE if each line of output should be prefixed with Match.
+     */
+    BOOLEAN PrefixOutput;
+} FOR_CHILD, *PFOR_CHILD;
+
 /**
  State about the currently running processes as well as information required
  to launch any new processes from this program.
@@ -103,6 +181,13 @@ typedef struct _FOR_EXEC_CONTEXT {
      */
     PYORI_STRING ArgV;
 
+    /**
+     If the command is a single program which can be launched without a
+     subshell, the full path to the program.  If a subshell is required,
+     this is empty.
+     */
+    YORI_STRING DirectProgram;
+
     /**
      The number of processes that this program would like to have concurrently
      running.
@@ -116,11 +201,54 @@ typedef struct _FOR_EXEC_CONTEXT {
     YORI_ALLOC_SIZE_T CurrentConcurrentCount;
 
     /**
-     An array of handles with CurrentConcurrentCount number of valid
-     elements.  These correspond to processes that are currently running.
+     An array of TargetConcurrentCount child process slots.
+     */
+    PFOR_CHILD Children;
+
+    /**
+     A completion port which is notified as child processes exit.  If the
+     system does not support this, this is NULL, child processes are waited
+     on via WaitForMultipleObjects, and TargetConcurrentCount is limited
+     accordingly.
+     */
+    HANDLE CompletionPort;
+
+    /**
+     If CompletionPort is NULL, an array of TargetConcurrentCount handles
+     used to wait for child processes.
      */
     PHANDLE HandleArray;
 
+    /**
+     If CompletionPort is NULL, an array of TargetConcurrentCount elements
+     indicating the child slot corresponding to each entry in HandleArray.
+     */
+    PYORI_ALLOC_SIZE_T SlotArray;
+
+    /**
+     The number of running child processes which could not be placed in a
+     job object and need to be polled.
+     */
+    YORI_ALLOC_SIZE_T NumberUnmonitored;
+
+    /**
+     A mutex to synchronize output from all child processes.  This is only
+     created if output from child processes is being captured.
+     */
+    HANDLE OutputMutex;
+
+    /**
+     TRUE if the output of each child should be collected and displayed once
+     the child completes.
+     */
+    BOOLEAN BufferOutput;
+
+    /**
+     TRUE if each line of output from a child should be prefixed with the
+     item being processed.
+     */
+    BOOLEAN PrefixOutput;
+
     /**
      A list of criteria to filter matches against.
      */
@@ -129,48 +257,359 @@ typedef struct _FOR_EXEC_CONTEXT {
 } FOR_EXEC_CONTEXT, *PFOR_EXEC_CONTEXT;
 
 /**
- Wait for any single process to complete.
+ Add a line of output from a child process to the output collected from that
+ child.
+
+ @param Child Pointer to the child process.
+
+ @param Line Pointer to the line of output, not including any line break.
+
+ @return TRUE to indicate the line was collected, FALSE if it could not be.
+ */
+__success(return)
+BOOLEAN
+ForCollectChildOutput(
+    __in PFOR_CHILD Child,
+    __in PCYORI_STRING Line
+    )
+{
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    YORI_ALLOC_SIZE_T NewLength;
+    YORI_ALLOC_SIZE_T DesiredExtra;
+
+    CharsNeeded = Line->LengthInChars + 2;
+    if (Child->PrefixOutput) {
+        CharsNeeded = CharsNeeded + Child->Match.LengthInChars + 2;
+    }
+
+    if (Child->Output.LengthAllocated - Child->Output.LengthInChars < CharsNeeded) {
+        DesiredExtra = Child->Output.LengthInChars;
+        if (DesiredExtra < 4096) {
+            DesiredExtra = 4096;
+        }
+        NewLength = YoriLibIsAllocationExtendable(Child->Output.LengthInChars, CharsNeeded, CharsNeeded + DesiredExtra);
+        if (NewLength == 0) {
+            return FALSE;
+        }
+        if (!YoriLibReallocateString(&Child->Output, NewLength)) {
+            return FALSE;
+        }
+    }
+
+    if (Child->PrefixOutput) {
+        Child->Output.LengthInChars = Child->Output.LengthInChars +
+            YoriLibSPrintfS(&Child->Output.StartOfString[Child->Output.LengthInChars],
+                            Child->Output.LengthAllocated - Child->Output.LengthInChars,
+                            _T("%y: %y\n"),
+                            &Child->Match,
+                            Line);
+    } else {
+        Child->Output.LengthInChars = Child->Output.LengthInChars +
+            YoriLibSPrintfS(&Child->Output.StartOfString[Child->Output.LengthInChars],
+                            Child->Output.LengthAllocated - Child->Output.LengthInChars,
+                            _T("%y\n"),
+                            Line);
+    }
+
+    return TRUE;
+}
+
+/**
+ A worker thread function that reads lines of output from a child process.
+ Each line is either collected to be displayed when the child completes, or
+ displayed immediately with synchronization to ensure that each line is
+ written as a line.
+
+ @param Param Pointer to the FOR_CHILD structure describing the child
+        process.
+
+ @return Exit code for the thread.
+ */
+DWORD WINAPI
+ForPumpChildOutput(
+    __in LPVOID Param
+    )
+{
+    PFOR_CHILD Child = (PFOR_CHILD)Param;
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+
+    YoriLibInitEmptyString(&LineString);
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, Child->OutputPipe)) {
+            break;
+        }
+
+        if (Child->BufferOutput &&
+            ForCollectChildOutput(Child, &LineString)) {
+
+            continue;
+        }
+
+        WaitForSingleObject(Child->OutputMutex, INFINITE);
+        if (Child->PrefixOutput) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y: %y\n"), &Child->Match, &LineString);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &LineString);
+        }
+        ReleaseMutex(Child->OutputMutex);
+    }
+
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+
+    return 0;
+}
+
+/**
+ Arrange for the exec context to be notified when a child process exits.  If
+ a completion port is available, the child process is placed in a job object
+ which reports to it.
+
+ @param ExecContext Pointer to the for exec context.
+
+ @param Child Pointer to the child process which has just been launched.
+ */
+VOID
+ForMonitorChild(
+    __in PFOR_EXEC_CONTEXT ExecContext,
+    __in PFOR_CHILD Child
+    )
+{
+    if (ExecContext->CompletionPort == NULL) {
+        return;
+    }
+
+    //
+    //  The port needs to be associated before the process is assigned,
+    //  or the exit notification could be missed.
+    //
+
+    Child->JobObject = YoriLibCreateJobObject();
+    if (Child->JobObject != NULL) {
+        if (YoriLibAssociateJobObjectWithCompletionPort(Child->JobObject, ExecContext->CompletionPort, Child) &&
+            YoriLibAssignProcessToJobObject(Child->JobObject, Child->ProcessHandle)) {
+
+            return;
+        }
+
+        CloseHandle(Child->JobObject);
+        Child->JobObject = NULL;
+    }
+
+    //
+    //  Assigning a process to a job fails if the process has already
+    //  terminated, or if it is already within a job and the system doesn't
+    //  support nesting.  Either way, poll for its completion.
+    //
+
+    Child->Unmonitored = TRUE;
+    ExecContext->NumberUnmonitored++;
+}
+
+/**
+ Find a child process which has completed.  The caller must have checked
+ that at least one child process is running.
 
  @param ExecContext Pointer to the for exec context containing information
         about currently running processes.
+
+ @return Pointer to the child process which has completed.
  */
-VOID
-ForWaitForProcessToComplete(
+PFOR_CHILD
+ForFindCompletedChild(
     __in PFOR_EXEC_CONTEXT ExecContext
     )
 {
-    DWORD Result;
+    PFOR_CHILD Child;
     YORI_ALLOC_SIZE_T Index;
     YORI_ALLOC_SIZE_T Count;
+    DWORD Timeout;
+    DWORD Message;
+    PVOID Key;
+    DWORD_PTR Data;
+
+    if (ExecContext->CompletionPort == NULL) {
+        Count = 0;
+        for (Index = 0; Index < ExecContext->TargetConcurrentCount; Index++) {
+            Child = &ExecContext->Children[Index];
+            if (Child->ProcessHandle != NULL) {
+                ExecContext->HandleArray[Count] = Child->ProcessHandle;
+                ExecContext->SlotArray[Count] = Index;
+                Count++;
+            }
+        }
 
-    Result = WaitForMultipleObjectsEx(ExecContext->CurrentConcurrentCount, ExecContext->HandleArray, FALSE, INFINITE, FALSE);
+        ASSERT(Count == ExecContext->CurrentConcurrentCount);
+        Index = (YORI_ALLOC_SIZE_T)(WaitForMultipleObjectsEx(Count, ExecContext->HandleArray, FALSE, INFINITE, FALSE) - WAIT_OBJECT_0);
+        ASSERT(Index < Count);
+        return &ExecContext->Children[ExecContext->SlotArray[Index]];
+    }
 
-    ASSERT(Result < (WAIT_OBJECT_0 + ExecContext->CurrentConcurrentCount));
+    while (TRUE) {
+        Timeout = INFINITE;
+        if (ExecContext->NumberUnmonitored > 0) {
+            Timeout = FOR_UNMONITORED_CHILD_POLL_INTERVAL;
+        }
 
-    Index = (YORI_ALLOC_SIZE_T)(Result - WAIT_OBJECT_0);
+        if (YoriLibGetJobCompletionMessage(ExecContext->CompletionPort, Timeout, &Message, &Key, &Data)) {
+            Child = (PFOR_CHILD)Key;
 
-    ASSERT(Index < ExecContext->CurrentConcurrentCount);
+            //
+            //  Job objects report on every process within the job, which
+            //  includes anything the child launched.  Only the child itself
+            //  indicates the item is complete.  Notifications can also
+            //  arrive for a job which has been closed, which may refer to an
+            //  earlier child in the same slot, so check that the current
+            //  process really has terminated.
+            //
 
-    CloseHandle(ExecContext->HandleArray[Index]);
+            if ((Message == YORI_JOB_OBJECT_MSG_EXIT_PROCESS ||
+                 Message == YORI_JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS) &&
+                Child->JobObject != NULL &&
+                (DWORD)Data == Child->ProcessId &&
+                WaitForSingleObject(Child->ProcessHandle, 0) == WAIT_OBJECT_0) {
 
-    for (Count = Index; Count < ExecContext->CurrentConcurrentCount - 1; Count++) {
+                return Child;
+            }
 
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-        //
-        //  The "correct" annotation here would describe that HandleArray is
-        //  of TargetConcurrentCount elements, CurrentConcurrentCount of which
-        //  are readable, and CurrentConcurrentCount needs to be less than or
-        //  equal to TargetConcurrentCount.  This is something that I don't
-        //  see a way to express as of this writing.
-        //
-#pragma warning(suppress: 6001)
-#endif
-        ExecContext->HandleArray[Count] = ExecContext->HandleArray[Count + 1];
+            continue;
+        }
+
+        if (ExecContext->NumberUnmonitored > 0) {
+            for (Index = 0; Index < ExecContext->TargetConcurrentCount; Index++) {
+                Child = &ExecContext->Children[Index];
+                if (Child->ProcessHandle != NULL &&
+                    Child->Unmonitored &&
+                    WaitForSingleObject(Child->ProcessHandle, 0) == WAIT_OBJECT_0) {
+
+                    return Child;
+                }
+            }
+        }
+    }
+}
+
+/**
+ Clean up after a child process has completed, displaying any output that
+ was collected from it, and make its slot available for another child.
+
+ @param ExecContext Pointer to the for exec context.
+
+ @param Child Pointer to the child process which has completed.
+ */
+VOID
+ForCompleteChild(
+    __in PFOR_EXEC_CONTEXT ExecContext,
+    __in PFOR_CHILD Child
+    )
+{
+    //
+    //  The pump thread finishes once every process holding the pipe has
+    //  closed it.
+    //
+
+    if (Child->PumpThread != NULL) {
+        WaitForSingleObject(Child->PumpThread, INFINITE);
+        CloseHandle(Child->PumpThread);
+        Child->PumpThread = NULL;
     }
 
+    if (Child->OutputPipe != NULL) {
+        CloseHandle(Child->OutputPipe);
+        Child->OutputPipe = NULL;
+    }
+
+    if (Child->Output.LengthInChars > 0) {
+        WaitForSingleObject(Child->OutputMutex, INFINITE);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Child->Output);
+        ReleaseMutex(Child->OutputMutex);
+    }
+
+    if (Child->JobObject != NULL) {
+        CloseHandle(Child->JobObject);
+        Child->JobObject = NULL;
+    }
+
+    if (Child->Unmonitored) {
+        Child->Unmonitored = FALSE;
+        ExecContext->NumberUnmonitored--;
+    }
+
+    CloseHandle(Child->ProcessHandle);
+    Child->ProcessHandle = NULL;
+    Child->ProcessId = 0;
+
+    YoriLibFreeStringContents(&Child->Match);
+    YoriLibFreeStringContents(&Child->Output);
+
     ExecContext->CurrentConcurrentCount--;
 }
 
+/**
+ Wait for any single process to complete.
+
+ @param ExecContext Pointer to the for exec context containing information
+        about currently running processes.
+ */
+VOID
+ForWaitForProcessToComplete(
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    PFOR_CHILD Child;
+
+    ASSERT(ExecContext->CurrentConcurrentCount > 0);
+
+    Child = ForFindCompletedChild(ExecContext);
+    ForCompleteChild(ExecContext, Child);
+}
+
+/**
+ Wait for all outstanding child processes to complete and free resources
+ associated with the exec context.
+
+ @param ExecContext Pointer to the for exec context.
+ */
+VOID
+ForCleanupExecContext(
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    while (ExecContext->CurrentConcurrentCount > 0) {
+        ForWaitForProcessToComplete(ExecContext);
+    }
+
+    YoriLibFileFiltFreeFilter(&ExecContext->Filter);
+    YoriLibFreeStringContents(&ExecContext->DirectProgram);
+
+    if (ExecContext->Children != NULL) {
+        YoriLibFree(ExecContext->Children);
+        ExecContext->Children = NULL;
+    }
+
+    if (ExecContext->HandleArray != NULL) {
+        YoriLibFree(ExecContext->HandleArray);
+        ExecContext->HandleArray = NULL;
+    }
+
+    if (ExecContext->SlotArray != NULL) {
+        YoriLibFree(ExecContext->SlotArray);
+        ExecContext->SlotArray = NULL;
+    }
+
+    if (ExecContext->CompletionPort != NULL) {
+        CloseHandle(ExecContext->CompletionPort);
+        ExecContext->CompletionPort = NULL;
+    }
+
+    if (ExecContext->OutputMutex != NULL) {
+        CloseHandle(ExecContext->OutputMutex);
+        ExecContext->OutputMutex = NULL;
+    }
+}
+
 /**
  Add a quote to a substring within an argument.  This is used because the
  string may contain backquotes, where any quotes need to only surround the
@@ -576,6 +1015,90 @@ ForBreakArgumentsAsNeeded(
     return TRUE;
 }
 
+/**
+ Determine whether the template command can be executed by launching a
+ program directly, without a subshell to interpret it.  This is possible
+ if the command contains no shell operators or expansions, refers to a
+ program that doesn't depend on the match, isn't an alias, and resolves to
+ an executable image.  Launching directly halves the number of processes
+ created per item.  If this is possible, DirectProgram in the exec context
+ is populated with the full path to the program.
+
+ @param ExecContext Pointer to the for exec context, whose template arguments
+        have been populated.
+ */
+VOID
+ForCheckForDirectLaunch(
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+#ifdef YORI_BUILTIN
+    YORI_STRING Remaining;
+    YORI_STRING Expanded;
+    YORI_STRING FoundPath;
+    YORI_STRING Extension;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_ALLOC_SIZE_T Index;
+    TCHAR Char;
+
+    if (ExecContext->InvokeCmd || ExecContext->ArgC == 0) {
+        return;
+    }
+
+    for (Count = 0; Count < ExecContext->ArgC; Count++) {
+        YoriLibInitEmptyString(&Remaining);
+        Remaining.StartOfString = ExecContext->ArgV[Count].StartOfString;
+        Remaining.LengthInChars = ExecContext->ArgV[Count].LengthInChars;
+        for (Index = 0; Index < ExecContext->ArgV[Count].LengthInChars; Index++) {
+            Char = Remaining.StartOfString[0];
+            if (Char == '`' || Char == '%' || Char == '^' || Char == '!' ||
+                YoriLibShIsArgumentSeperator(&Remaining, NULL, NULL)) {
+
+                return;
+            }
+            Remaining.StartOfString = Remaining.StartOfString + 1;
+            Remaining.LengthInChars = Remaining.LengthInChars - 1;
+        }
+    }
+
+    if (YoriLibFindFirstMatchingSubstring(&ExecContext->ArgV[0], 1, ExecContext->SubstituteVariable, NULL)) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&Expanded);
+    if (YoriCallExpandAlias(&ExecContext->ArgV[0], &Expanded)) {
+        YoriCallFreeYoriString(&Expanded);
+        return;
+    }
+
+    //
+    //  The shell searches the path before its builtins, so anything found
+    //  here would be what the shell launches.  Only executables are
+    //  launched as processes; modules are loaded into the shell, and
+    //  scripts need an interpreter.
+    //
+
+    YoriLibInitEmptyString(&FoundPath);
+    if (!YoriLibLocateExecutableInPath(&ExecContext->ArgV[0], NULL, NULL, &FoundPath)) {
+        return;
+    }
+
+    if (FoundPath.LengthInChars >= 4) {
+        YoriLibInitEmptyString(&Extension);
+        Extension.StartOfString = &FoundPath.StartOfString[FoundPath.LengthInChars - 4];
+        Extension.LengthInChars = 4;
+        if (YoriLibCompareStringWithLiteralInsensitive(&Extension, _T(".exe")) == 0) {
+            memcpy(&ExecContext->DirectProgram, &FoundPath, sizeof(YORI_STRING));
+            return;
+        }
+    }
+
+    YoriLibFreeStringContents(&FoundPath);
+#else
+    UNREFERENCED_PARAMETER(ExecContext);
+#endif
+}
+
 /**
  Execute a new command in response to a newly matched element.
 
@@ -602,19 +1125,33 @@ ForExecuteCommand(
     PROCESS_INFORMATION ProcessInfo;
     STARTUPINFO StartupInfo;
     YORI_LIBSH_CMD_CONTEXT NewCmd;
+    PFOR_CHILD Child;
+    HANDLE OutputWrite;
+    BOOLEAN RunInProcess;
 
     YoriLibInitEmptyString(&CmdLine);
 
+    //
+    //  Commands can only run in process if they run one at a time and their
+    //  output doesn't need to be captured.  Otherwise, launch the program
+    //  directly if possible, and use a subshell if not.
+    //
+
+    RunInProcess = FALSE;
 #ifdef YORI_BUILTIN
     if (!ExecContext->InvokeCmd &&
-        ExecContext->TargetConcurrentCount == 1) {
+        ExecContext->TargetConcurrentCount == 1 &&
+        !ExecContext->BufferOutput &&
+        !ExecContext->PrefixOutput) {
+        RunInProcess = TRUE;
+    }
+#endif
+
+    if (RunInProcess || ExecContext->DirectProgram.LengthInChars > 0) {
         PrefixArgCount = 0;
     } else {
         PrefixArgCount = 2;
     }
-#else
-    PrefixArgCount = 2;
-#endif
 
     ArgsNeeded = ArgsNeeded + PrefixArgCount;
 
@@ -747,36 +1284,121 @@ ForExecuteCommand(
     //
     //  etc.
     //
+    //  When launching a program directly there is no shell to interpret
+    //  these, so the arguments are left intact and the program is invoked
+    //  by its full path.
+    //
 
-    ForBreakArgumentsAsNeeded(&NewCmd);
+    if (RunInProcess || PrefixArgCount > 0) {
+        ForBreakArgumentsAsNeeded(&NewCmd);
+    } else {
+        YoriLibFreeStringContents(&NewCmd.ArgV[0]);
+        YoriLibCloneString(&NewCmd.ArgV[0], &ExecContext->DirectProgram);
+        YoriLibShCheckIfArgNeedsQuotes(&NewCmd, 0);
+    }
 
     if (!YoriLibShBuildCmdlineFromCmdContext(&NewCmd, &CmdLine, FALSE, NULL, NULL)) {
         goto Cleanup;
     }
 
 #ifdef YORI_BUILTIN
-    if (PrefixArgCount == 0) {
+    if (RunInProcess) {
         YoriCallExecuteExpression(&CmdLine);
         goto Cleanup;
     }
 #endif
 
+    //
+    //  Find a free slot for the child.  There must be one, because once all
+    //  slots are used this function waits for one to become available.
+    //
+
+    Child = NULL;
+    for (Count = 0; Count < ExecContext->TargetConcurrentCount; Count++) {
+        if (ExecContext->Children[Count].ProcessHandle == NULL) {
+            Child = &ExecContext->Children[Count];
+            break;
+        }
+    }
+
+    ASSERT(Child != NULL);
+    if (Child == NULL) {
+        goto Cleanup;
+    }
+
     memset(&StartupInfo, 0, sizeof(StartupInfo));
     StartupInfo.cb = sizeof(StartupInfo);
+    OutputWrite = NULL;
+
+    if (ExecContext->BufferOutput || ExecContext->PrefixOutput) {
+        SECURITY_ATTRIBUTES SecurityAttributes;
+
+        if (!YoriLibAllocateString(&Child->Match, Match->LengthInChars + 1)) {
+            goto Cleanup;
+        }
+        memcpy(Child->Match.StartOfString, Match->StartOfString, Match->LengthInChars * sizeof(TCHAR));
+        Child->Match.StartOfString[Match->LengthInChars] = '\0';
+        Child->Match.LengthInChars = Match->LengthInChars;
+
+        ZeroMemory(&SecurityAttributes, sizeof(SecurityAttributes));
+        SecurityAttributes.nLength = sizeof(SecurityAttributes);
+        SecurityAttributes.bInheritHandle = TRUE;
+
+        if (!CreatePipe(&Child->OutputPipe, &OutputWrite, &SecurityAttributes, 0)) {
+            YoriLibFreeStringContents(&Child->Match);
+            goto Cleanup;
+        }
+
+        StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        StartupInfo.hStdOutput = OutputWrite;
+        StartupInfo.hStdError = OutputWrite;
+
+        Child->BufferOutput = ExecContext->BufferOutput;
+        Child->PrefixOutput = ExecContext->PrefixOutput;
+        Child->OutputMutex = ExecContext->OutputMutex;
+    }
 
     if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &StartupInfo, &ProcessInfo)) {
         DWORD LastError = GetLastError();
         LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: execution failed: %s"), ErrText);
         YoriLibFreeWinErrorText(ErrText);
+        if (OutputWrite != NULL) {
+            CloseHandle(OutputWrite);
+            CloseHandle(Child->OutputPipe);
+            Child->OutputPipe = NULL;
+            YoriLibFreeStringContents(&Child->Match);
+        }
         goto Cleanup;
     }
 
     CloseHandle(ProcessInfo.hThread);
 
-    ExecContext->HandleArray[ExecContext->CurrentConcurrentCount] = ProcessInfo.hProcess;
+    Child->ProcessHandle = ProcessInfo.hProcess;
+    Child->ProcessId = ProcessInfo.dwProcessId;
     ExecContext->CurrentConcurrentCount++;
 
+    //
+    //  Once the child has its copy of the write end, close this one so the
+    //  pump thread sees the pipe close when the child exits.  If the thread
+    //  can't be created, the output can't be read; let the child fail to
+    //  write rather than block.
+    //
+
+    if (OutputWrite != NULL) {
+        DWORD ThreadId;
+
+        CloseHandle(OutputWrite);
+        Child->PumpThread = CreateThread(NULL, 0, ForPumpChildOutput, Child, 0, &ThreadId);
+        if (Child->PumpThread == NULL) {
+            CloseHandle(Child->OutputPipe);
+            Child->OutputPipe = NULL;
+        }
+    }
+
+    ForMonitorChild(ExecContext, Child);
+
     if (ExecContext->CurrentConcurrentCount == ExecContext->TargetConcurrentCount) {
         ForWaitForProcessToComplete(ExecContext);
     }
@@ -924,6 +1546,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 StepMode = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("o")) == 0) {
+                ExecContext.BufferOutput = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
                 if (i + 1 < ArgC) {
                     YORI_MAX_SIGNED_T LlNumberProcesses = 0;
@@ -942,6 +1567,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 Recurse = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                ExecContext.PrefixOutput = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 ArgumentUnderstood = TRUE;
                 StartArg = i + 1;
@@ -1023,10 +1651,38 @@ ENTRYPOINT(
 
     ExecContext.ArgC = ArgC - CmdArg;
     ExecContext.ArgV = &ArgV[CmdArg];
-    ExecContext.HandleArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(HANDLE));
-    if (ExecContext.HandleArray == NULL) {
+    ForCheckForDirectLaunch(&ExecContext);
+
+    //
+    //  If child completion can be reported via a completion port, any number
+    //  of children can be waited on.  Otherwise, the number of children is
+    //  limited to the number of objects that can be waited on at once.
+    //
+
+    ExecContext.CompletionPort = YoriLibCreateJobCompletionPort();
+    if (ExecContext.CompletionPort == NULL) {
+        if (ExecContext.TargetConcurrentCount > MAXIMUM_WAIT_OBJECTS) {
+            ExecContext.TargetConcurrentCount = MAXIMUM_WAIT_OBJECTS;
+        }
+        ExecContext.HandleArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(HANDLE));
+        ExecContext.SlotArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(YORI_ALLOC_SIZE_T));
+        if (ExecContext.HandleArray == NULL || ExecContext.SlotArray == NULL) {
+            goto cleanup_and_exit;
+        }
+    }
+
+    ExecContext.Children = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(FOR_CHILD));
+    if (ExecContext.Children == NULL) {
         goto cleanup_and_exit;
     }
+    ZeroMemory(ExecContext.Children, ExecContext.TargetConcurrentCount * sizeof(FOR_CHILD));
+
+    if (ExecContext.BufferOutput || ExecContext.PrefixOutput) {
+        ExecContext.OutputMutex = CreateMutex(NULL, FALSE, NULL);
+        if (ExecContext.OutputMutex == NULL) {
+            goto cleanup_and_exit;
+        }
+    }
 
     MatchFlags = 0;
     if (MatchDirectories) {
@@ -1219,18 +1875,13 @@ ENTRYPOINT(
         }
     }
 
-    while (ExecContext.CurrentConcurrentCount > 0) {
-        ForWaitForProcessToComplete(&ExecContext);
-    }
-
-    YoriLibFileFiltFreeFilter(&ExecContext.Filter);
-    YoriLibFree(ExecContext.HandleArray);
+    ForCleanupExecContext(&ExecContext);
 
     return EXIT_SUCCESS;
 
 cleanup_and_exit:
 
-    YoriLibFileFiltFreeFilter(&ExecContext.Filter);
+    ForCleanupExecContext(&ExecContext);
 
     return EXIT_FAILURE;
 }
@@ -36,6 +36,7 @@ CHAR strFsCmpHelpText[] =
         "Test for file system conditions.\n"
         "\n"
         "FSCMP [-license] [-b] [-d | -e | -f | -i <condition> | -l] <file>\n"
+        "FSCMP [-license] -t <directory> <directory>\n"
         "\n"
         "   -b             Use basic search criteria\n"
         "   -d             Test if directory exists\n"
@@ -43,6 +44,18 @@ CHAR strFsCmpHelpText[] =
         "   -f             Test if file exists\n"
         "   -i             Test for a specified file metadata condition\n"
         "   -l             Test if symbolic link exists\n"
+        "   -t             Test if two directory trees are identical\n"
+        "\n"
+        " The -t option outputs one line per difference, consisting of a type\n"
+        " character, a tab, and the path relative to each tree.  Types are:\n"
+        "\n"
+        "   -              Object exists in the first tree only\n"
+        "   +              Object exists in the second tree only\n"
+        "   T              Object is a file in one tree and a directory in the other\n"
+        "   M              File contents differ\n"
+        "   E              File contents could not be compared\n"
+        "\n"
+        " Files with the same size and last write time are not read.\n"
         "\n"
         " The -i option will match files only if they meet criteria.  This is a\n"
         " semicolon delimited list of entries matching the following form:\n"
@@ -79,6 +92,7 @@ typedef enum _FSCMP_TEST_TYPE {
     FsCmpTestTypeFileExists = 3,
     FsCmpTestTypeLinkExists = 4,
     FsCmpTestTypeApplyFilter = 5,
+    FsCmpTestTypeTreesMatch = 6,
 } FSCMP_TEST_TYPE;
 
 /**
@@ -164,6 +178,631 @@ FsCmpFileFoundCallback(
     return TRUE;
 }
 
+/**
+ The size of each read when comparing the contents of two files.
+ */
+#define FSCMP_COMPARE_CHUNK_SIZE (1024 * 1024)
+
+/**
+ Information about a single object found when enumerating a tree.  The
+ object's full path follows the structure.
+ */
+typedef struct _FSCMP_TREE_ENTRY {
+
+    /**
+     The size of the file.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The last write time of the file.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The attributes of the file.
+     */
+    DWORD FileAttributes;
+
+    /**
+     The full path to the object, NULL terminated.  The allocation is sized
+     to contain the whole path.
+     */
+    TCHAR FullPath[1];
+} FSCMP_TREE_ENTRY, *PFSCMP_TREE_ENTRY;
+
+/**
+ The set of objects found within a single tree.
+ */
+typedef struct _FSCMP_TREE {
+
+    /**
+     The fully qualified path to the root of the tree.
+     */
+    YORI_STRING Root;
+
+    /**
+     The number of characters in each full path before the part that is
+     relative to the root of the tree.
+     */
+    YORI_ALLOC_SIZE_T RelativeOffset;
+
+    /**
+     An array of paths relative to the root of the tree.  Each string's
+     MemoryToFree refers to the FSCMP_TREE_ENTRY describing the object.
+     */
+    PYORI_STRING Entries;
+
+    /**
+     The number of elements in the Entries array which are populated.
+     */
+    YORI_ALLOC_SIZE_T EntryCount;
+
+    /**
+     The number of elements allocated in the Entries array.
+     */
+    YORI_ALLOC_SIZE_T EntriesAllocated;
+
+    /**
+     Set to TRUE if the tree could not be completely enumerated.
+     */
+    BOOLEAN Failed;
+} FSCMP_TREE, *PFSCMP_TREE;
+
+/**
+ Return the entry describing an object found within a tree.
+
+ @param RelativePath Pointer to the relative path of the object.
+
+ @return Pointer to the entry describing the object.
+ */
+PFSCMP_TREE_ENTRY
+FsCmpEntryFromRelativePath(
+    __in PYORI_STRING RelativePath
+    )
+{
+    return (PFSCMP_TREE_ENTRY)RelativePath->MemoryToFree;
+}
+
+/**
+ A callback that is invoked for each object found within a tree.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Pointer to the FSCMP_TREE being populated.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+FsCmpTreeFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PFSCMP_TREE Tree = (PFSCMP_TREE)Context;
+    PFSCMP_TREE_ENTRY Entry;
+    PYORI_STRING RelativePath;
+    YORI_MAX_UNSIGNED_T BytesNeeded;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    if (FilePath->LengthInChars <= Tree->RelativeOffset) {
+        return TRUE;
+    }
+
+    if (Tree->EntryCount == Tree->EntriesAllocated) {
+        PYORI_STRING NewEntries;
+        YORI_ALLOC_SIZE_T NewAllocated;
+
+        NewAllocated = Tree->EntriesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 1024;
+        }
+
+        BytesNeeded = (YORI_MAX_UNSIGNED_T)NewAllocated * sizeof(YORI_STRING);
+        if (!YoriLibIsSizeAllocatable(BytesNeeded)) {
+            Tree->Failed = TRUE;
+            return FALSE;
+        }
+
+        NewEntries = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesNeeded);
+        if (NewEntries == NULL) {
+            Tree->Failed = TRUE;
+            return FALSE;
+        }
+
+        if (Tree->EntryCount > 0) {
+            memcpy(NewEntries, Tree->Entries, Tree->EntryCount * sizeof(YORI_STRING));
+        }
+        if (Tree->Entries != NULL) {
+            YoriLibFree(Tree->Entries);
+        }
+        Tree->Entries = NewEntries;
+        Tree->EntriesAllocated = NewAllocated;
+    }
+
+    BytesNeeded = sizeof(FSCMP_TREE_ENTRY) + FilePath->LengthInChars * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesNeeded)) {
+        Tree->Failed = TRUE;
+        return FALSE;
+    }
+
+    Entry = YoriLibReferencedMalloc((YORI_ALLOC_SIZE_T)BytesNeeded);
+    if (Entry == NULL) {
+        Tree->Failed = TRUE;
+        return FALSE;
+    }
+
+    Entry->FileSize.LowPart = FileInfo->nFileSizeLow;
+    Entry->FileSize.HighPart = FileInfo->nFileSizeHigh;
+    Entry->LastWriteTime.dwLowDateTime = FileInfo->ftLastWriteTime.dwLowDateTime;
+    Entry->LastWriteTime.dwHighDateTime = FileInfo->ftLastWriteTime.dwHighDateTime;
+    Entry->FileAttributes = FileInfo->dwFileAttributes;
+    memcpy(Entry->FullPath, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    Entry->FullPath[FilePath->LengthInChars] = '\0';
+
+    RelativePath = &Tree->Entries[Tree->EntryCount];
+    YoriLibInitEmptyString(RelativePath);
+    RelativePath->MemoryToFree = Entry;
+    RelativePath->StartOfString = &Entry->FullPath[Tree->RelativeOffset];
+    RelativePath->LengthInChars = FilePath->LengthInChars - Tree->RelativeOffset;
+    Tree->EntryCount++;
+
+    return TRUE;
+}
+
+/**
+ A callback that is invoked when a directory within a tree cannot be
+ enumerated.
+
+ @param FilePath Pointer to the file path that could not be enumerated.
+
+ @param ErrorCode The Win32 error code describing the failure.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Pointer to the FSCMP_TREE being populated.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+FsCmpTreeFileEnumerateErrorCallback(
+    __in PYORI_STRING FilePath,
+    __in DWORD ErrorCode,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PFSCMP_TREE Tree = (PFSCMP_TREE)Context;
+    LPTSTR ErrText;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    ErrText = YoriLibGetWinErrorText(ErrorCode);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("fscmp: enumerate of %y failed: %s"), FilePath, ErrText);
+    YoriLibFreeWinErrorText(ErrText);
+    Tree->Failed = TRUE;
+    return TRUE;
+}
+
+/**
+ Enumerate all objects within a tree and sort them by relative path.  This
+ is invoked on its own thread so that both trees can be enumerated at the
+ same time, which matters when they are on different servers.
+
+ @param Context Pointer to the FSCMP_TREE to populate.
+
+ @return Zero.
+ */
+DWORD WINAPI
+FsCmpEnumerateTreeThread(
+    __in PVOID Context
+    )
+{
+    PFSCMP_TREE Tree = (PFSCMP_TREE)Context;
+    YORI_STRING FileSpec;
+    WORD MatchFlags;
+
+    if (!YoriLibAllocateString(&FileSpec, Tree->Root.LengthInChars + 3)) {
+        Tree->Failed = TRUE;
+        return 0;
+    }
+
+    if (Tree->Root.LengthInChars > 0 &&
+        YoriLibIsSep(Tree->Root.StartOfString[Tree->Root.LengthInChars - 1])) {
+
+        FileSpec.LengthInChars = YoriLibSPrintf(FileSpec.StartOfString, _T("%y*"), &Tree->Root);
+        Tree->RelativeOffset = Tree->Root.LengthInChars;
+    } else {
+        FileSpec.LengthInChars = YoriLibSPrintf(FileSpec.StartOfString, _T("%y\\*"), &Tree->Root);
+        Tree->RelativeOffset = Tree->Root.LengthInChars + 1;
+    }
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
+                 YORILIB_FILEENUM_RETURN_DIRECTORIES |
+                 YORILIB_FILEENUM_RECURSE_AFTER_RETURN |
+                 YORILIB_FILEENUM_BASIC_EXPANSION |
+                 YORILIB_FILEENUM_NO_LINK_TRAVERSE |
+                 YORILIB_FILEENUM_NO_SHORT_NAMES;
+
+    YoriLibForEachFile(&FileSpec, MatchFlags, 0, FsCmpTreeFileFoundCallback, FsCmpTreeFileEnumerateErrorCallback, Tree);
+    YoriLibFreeStringContents(&FileSpec);
+
+    YoriLibSortStringArray(Tree->Entries, Tree->EntryCount);
+    return 0;
+}
+
+/**
+ Free all objects found within a tree.
+
+ @param Tree Pointer to the tree to clean up.
+ */
+VOID
+FsCmpFreeTree(
+    __in PFSCMP_TREE Tree
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = 0; Index < Tree->EntryCount; Index++) {
+        YoriLibFreeStringContents(&Tree->Entries[Index]);
+    }
+
+    if (Tree->Entries != NULL) {
+        YoriLibFree(Tree->Entries);
+    }
+
+    YoriLibFreeStringContents(&Tree->Root);
+    Tree->Entries = NULL;
+    Tree->EntryCount = 0;
+    Tree->EntriesAllocated = 0;
+}
+
+/**
+ Compare the contents of two files which are known to be the same size.
+ Both files are read at the same time in chunks using overlapped IO, and
+ the next chunk is read from both while the current chunk is compared.
+
+ @param FirstPath Pointer to the full path to the first file.
+
+ @param SecondPath Pointer to the full path to the second file.
+
+ @param FileSize The size of both files.
+
+ @param Equal On successful completion, set to TRUE if the file contents
+        are identical, FALSE if they differ.
+
+ @return TRUE to indicate the files were compared, FALSE if they could not
+         be read.
+ */
+BOOL
+FsCmpCompareFileContents(
+    __in LPCTSTR FirstPath,
+    __in LPCTSTR SecondPath,
+    __in DWORDLONG FileSize,
+    __out PBOOLEAN Equal
+    )
+{
+    HANDLE Handles[2];
+    OVERLAPPED Overlapped[2][2];
+    PUCHAR Buffers[2][2];
+    PUCHAR ReadBuffer;
+    BOOLEAN Pending[2][2];
+    DWORDLONG Offset;
+    DWORD ThisLength;
+    DWORD NextLength;
+    DWORD BytesRead;
+    DWORD Side;
+    DWORD Index;
+    DWORD Current;
+    DWORD Next;
+    BOOL Result;
+
+    *Equal = TRUE;
+    Result = FALSE;
+    ReadBuffer = NULL;
+    ZeroMemory(Overlapped, sizeof(Overlapped));
+    ZeroMemory(Pending, sizeof(Pending));
+
+    Handles[0] = CreateFile(FirstPath,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+
+    Handles[1] = CreateFile(SecondPath,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+
+    if (Handles[0] == INVALID_HANDLE_VALUE || Handles[1] == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    if (FileSize == 0) {
+        Result = TRUE;
+        goto Exit;
+    }
+
+    ThisLength = FSCMP_COMPARE_CHUNK_SIZE;
+    if (FileSize < ThisLength) {
+        ThisLength = (DWORD)FileSize;
+    }
+
+    ReadBuffer = YoriLibMalloc(ThisLength * 4);
+    if (ReadBuffer == NULL) {
+        goto Exit;
+    }
+
+    for (Side = 0; Side < 2; Side++) {
+        for (Index = 0; Index < 2; Index++) {
+            Buffers[Side][Index] = ReadBuffer + ThisLength * (Side * 2 + Index);
+            Overlapped[Side][Index].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (Overlapped[Side][Index].hEvent == NULL) {
+                goto Exit;
+            }
+        }
+    }
+
+    //
+    //  Each iteration waits for the current chunk from both files, starts
+    //  reading the next chunk from both files, then compares the current
+    //  chunk.  Since both files are the same size, the reads are always
+    //  within the file and each completes in full.
+    //
+
+    Offset = 0;
+    Current = 0;
+    for (Side = 0; Side < 2; Side++) {
+        Overlapped[Side][Current].Offset = (DWORD)Offset;
+        Overlapped[Side][Current].OffsetHigh = (DWORD)(Offset >> 32);
+        if (!ReadFile(Handles[Side], Buffers[Side][Current], ThisLength, NULL, &Overlapped[Side][Current]) &&
+            GetLastError() != ERROR_IO_PENDING) {
+
+            goto Exit;
+        }
+        Pending[Side][Current] = TRUE;
+    }
+
+    while (ThisLength > 0) {
+        for (Side = 0; Side < 2; Side++) {
+            Pending[Side][Current] = FALSE;
+            if (!GetOverlappedResult(Handles[Side], &Overlapped[Side][Current], &BytesRead, TRUE) ||
+                BytesRead != ThisLength) {
+
+                goto Exit;
+            }
+        }
+
+        Offset = Offset + ThisLength;
+        NextLength = FSCMP_COMPARE_CHUNK_SIZE;
+        if (FileSize - Offset < NextLength) {
+            NextLength = (DWORD)(FileSize - Offset);
+        }
+
+        Next = (Current + 1) % 2;
+        if (NextLength > 0) {
+            for (Side = 0; Side < 2; Side++) {
+                Overlapped[Side][Next].Offset = (DWORD)Offset;
+                Overlapped[Side][Next].OffsetHigh = (DWORD)(Offset >> 32);
+                ResetEvent(Overlapped[Side][Next].hEvent);
+                if (!ReadFile(Handles[Side], Buffers[Side][Next], NextLength, NULL, &Overlapped[Side][Next]) &&
+                    GetLastError() != ERROR_IO_PENDING) {
+
+                    goto Exit;
+                }
+                Pending[Side][Next] = TRUE;
+            }
+        }
+
+        if (memcmp(Buffers[0][Current], Buffers[1][Current], ThisLength) != 0) {
+            *Equal = FALSE;
+            Result = TRUE;
+            goto Exit;
+        }
+
+        Current = Next;
+        ThisLength = NextLength;
+    }
+
+    Result = TRUE;
+
+Exit:
+
+    //
+    //  Any reads still in progress must finish before their buffers can be
+    //  freed.
+    //
+
+    for (Side = 0; Side < 2; Side++) {
+        for (Index = 0; Index < 2; Index++) {
+            if (Pending[Side][Index]) {
+                GetOverlappedResult(Handles[Side], &Overlapped[Side][Index], &BytesRead, TRUE);
+            }
+            if (Overlapped[Side][Index].hEvent != NULL) {
+                CloseHandle(Overlapped[Side][Index].hEvent);
+            }
+        }
+        if (Handles[Side] != INVALID_HANDLE_VALUE) {
+            CloseHandle(Handles[Side]);
+        }
+    }
+
+    if (ReadBuffer != NULL) {
+        YoriLibFree(ReadBuffer);
+    }
+
+    return Result;
+}
+
+/**
+ Output a single difference between two trees.
+
+ @param Type A character indicating the type of difference.
+
+ @param RelativePath Pointer to the path of the object relative to the root
+        of each tree.
+ */
+VOID
+FsCmpOutputDifference(
+    __in TCHAR Type,
+    __in PYORI_STRING RelativePath
+    )
+{
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%c\t%y\n"), Type, RelativePath);
+}
+
+/**
+ Compare two trees.  Both trees are enumerated concurrently and sorted, then
+ objects are matched by relative path.  Files whose size differs are
+ reported as different without reading them, and files whose size and last
+ write time are the same are assumed to be identical.  Only files with the
+ same size and a different write time have their contents compared.
+
+ @param FirstRoot Pointer to the user specified root of the first tree.
+
+ @param SecondRoot Pointer to the user specified root of the second tree.
+
+ @param TreesMatch On successful completion, set to TRUE if no differences
+        were found.
+
+ @return TRUE to indicate the trees were compared, FALSE on failure.
+ */
+BOOL
+FsCmpCompareTrees(
+    __in PYORI_STRING FirstRoot,
+    __in PYORI_STRING SecondRoot,
+    __out PBOOL TreesMatch
+    )
+{
+    FSCMP_TREE Trees[2];
+    HANDLE Threads[2];
+    PYORI_STRING FirstEntry;
+    PYORI_STRING SecondEntry;
+    PFSCMP_TREE_ENTRY FirstObject;
+    PFSCMP_TREE_ENTRY SecondObject;
+    YORI_ALLOC_SIZE_T FirstIndex;
+    YORI_ALLOC_SIZE_T SecondIndex;
+    DWORD Side;
+    BOOLEAN Equal;
+    BOOL Result;
+    int CompareResult;
+
+    *TreesMatch = TRUE;
+    Result = FALSE;
+    ZeroMemory(Trees, sizeof(Trees));
+    Threads[0] = NULL;
+    Threads[1] = NULL;
+
+    if (!YoriLibUserStringToSingleFilePath(FirstRoot, TRUE, &Trees[0].Root)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("fscmp: could not resolve %y\n"), FirstRoot);
+        goto Exit;
+    }
+
+    if (!YoriLibUserStringToSingleFilePath(SecondRoot, TRUE, &Trees[1].Root)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("fscmp: could not resolve %y\n"), SecondRoot);
+        goto Exit;
+    }
+
+    for (Side = 0; Side < 2; Side++) {
+        Threads[Side] = CreateThread(NULL, 0, FsCmpEnumerateTreeThread, &Trees[Side], 0, NULL);
+        if (Threads[Side] == NULL) {
+            FsCmpEnumerateTreeThread(&Trees[Side]);
+        }
+    }
+
+    for (Side = 0; Side < 2; Side++) {
+        if (Threads[Side] != NULL) {
+            WaitForSingleObject(Threads[Side], INFINITE);
+            CloseHandle(Threads[Side]);
+        }
+    }
+
+    if (Trees[0].Failed || Trees[1].Failed) {
+        goto Exit;
+    }
+
+    FirstIndex = 0;
+    SecondIndex = 0;
+    while (FirstIndex < Trees[0].EntryCount || SecondIndex < Trees[1].EntryCount) {
+
+        if (FirstIndex == Trees[0].EntryCount) {
+            CompareResult = 1;
+        } else if (SecondIndex == Trees[1].EntryCount) {
+            CompareResult = -1;
+        } else {
+            CompareResult = YoriLibCompareStringInsensitive(&Trees[0].Entries[FirstIndex], &Trees[1].Entries[SecondIndex]);
+        }
+
+        if (CompareResult < 0) {
+            FsCmpOutputDifference('-', &Trees[0].Entries[FirstIndex]);
+            *TreesMatch = FALSE;
+            FirstIndex++;
+            continue;
+        } else if (CompareResult > 0) {
+            FsCmpOutputDifference('+', &Trees[1].Entries[SecondIndex]);
+            *TreesMatch = FALSE;
+            SecondIndex++;
+            continue;
+        }
+
+        FirstEntry = &Trees[0].Entries[FirstIndex];
+        SecondEntry = &Trees[1].Entries[SecondIndex];
+        FirstObject = FsCmpEntryFromRelativePath(FirstEntry);
+        SecondObject = FsCmpEntryFromRelativePath(SecondEntry);
+        FirstIndex++;
+        SecondIndex++;
+
+        if ((FirstObject->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != (SecondObject->FileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            FsCmpOutputDifference('T', FirstEntry);
+            *TreesMatch = FALSE;
+            continue;
+        }
+
+        if (FirstObject->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+
+        if (FirstObject->FileSize.QuadPart != SecondObject->FileSize.QuadPart) {
+            FsCmpOutputDifference('M', FirstEntry);
+            *TreesMatch = FALSE;
+            continue;
+        }
+
+        if (FirstObject->LastWriteTime.dwLowDateTime == SecondObject->LastWriteTime.dwLowDateTime &&
+            FirstObject->LastWriteTime.dwHighDateTime == SecondObject->LastWriteTime.dwHighDateTime) {
+
+            continue;
+        }
+
+        if (!FsCmpCompareFileContents(FirstObject->FullPath, SecondObject->FullPath, FirstObject->FileSize.QuadPart, &Equal)) {
+            FsCmpOutputDifference('E', FirstEntry);
+            *TreesMatch = FALSE;
+        } else if (!Equal) {
+            FsCmpOutputDifference('M', FirstEntry);
+            *TreesMatch = FALSE;
+        }
+    }
+
+    Result = TRUE;
+
+Exit:
+    FsCmpFreeTree(&Trees[0]);
+    FsCmpFreeTree(&Trees[1]);
+    return Result;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the fscmp builtin command.
@@ -251,6 +890,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 FsCmpContext.TestType = FsCmpTestTypeLinkExists;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
+                FsCmpContext.TestType = FsCmpTestTypeTreesMatch;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 ArgumentUnderstood = TRUE;
                 StartArg = i + 1;
@@ -277,7 +919,17 @@ ENTRYPOINT(
         goto cleanup_and_exit;
     }
 
-    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES;
+    if (FsCmpContext.TestType == FsCmpTestTypeTreesMatch) {
+        if (StartArg + 2 != ArgC) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("fscmp: -t requires two directories\n"));
+            goto cleanup_and_exit;
+        }
+
+        FsCmpCompareTrees(&ArgV[StartArg], &ArgV[StartArg + 1], &FsCmpContext.ConditionMet);
+        goto cleanup_and_exit;
+    }
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_NO_SHORT_NAMES;
     if (BasicExpansion) {
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
     }
@@ -34,8 +34,10 @@ const
 CHAR strGetHelpText[] =
         "Fetches objects from HTTP and stores them in local files.\n"
         "\n"
-        "GET [-license] [-n] <url> <file>\n"
+        "GET [-license] [-h hash] [-j n] [-n] <url> <file>\n"
         "\n"
+        "   -h             Verify the download matches a SHA1 or SHA256 hash\n"
+        "   -j             Download using the specified number of connections\n"
         "   -n             Only download URL if newer than file\n";
 
 /**
@@ -90,6 +92,10 @@ ENTRYPOINT(
     YORI_STRING Arg;
     BOOLEAN NewerOnly = FALSE;
     SYSTEMTIME ExistingFileTime;
+    PYORI_STRING ExpectedHash = NULL;
+    DWORD ConnectionCount = 0;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -100,6 +106,20 @@ ENTRYPOINT(
             if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("?")) == 0) {
                 GetHelp();
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
+                if (i + 1 < ArgC) {
+                    ExpectedHash = &ArgV[i + 1];
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        ConnectionCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("n")) == 0) {
                 NewerOnly = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -169,10 +189,26 @@ ENTRYPOINT(
         YoriLibFreeStringContents(&NewFileName);
         return EXIT_FAILURE;
     }
-    Error = YoriLibUpdateBinaryFromUrl(ExistingUrlName,
-                                       &NewFileName,
-                                       &Agent,
-                                       NewerOnly?&ExistingFileTime:NULL);
+
+    //
+    //  Downloading over multiple connections requires range requests, and
+    //  hashes are verified as ranges arrive, so either option uses the
+    //  ranged download.
+    //
+
+    if (ConnectionCount > 0 || ExpectedHash != NULL) {
+        Error = YoriLibUpdateBinaryFromUrlInRanges(ExistingUrlName,
+                                                   &NewFileName,
+                                                   &Agent,
+                                                   ConnectionCount,
+                                                   NewerOnly?&ExistingFileTime:NULL,
+                                                   ExpectedHash);
+    } else {
+        Error = YoriLibUpdateBinaryFromUrl(ExistingUrlName,
+                                           &NewFileName,
+                                           &Agent,
+                                           NewerOnly?&ExistingFileTime:NULL);
+    }
     YoriLibFreeStringContents(&NewFileName);
     YoriLibFreeStringContents(&Agent);
     if (Error != YoriLibUpdErrorSuccess) {
@@ -32,6 +32,17 @@
  */
 #define MS_PRIMITIVE_PROVIDER L"Microsoft Primitive Provider"
 
+/**
+ The maximum number of algorithms that can be calculated in a single pass.
+ */
+#define HASH_MAX_ALGORITHMS 6
+
+/**
+ The maximum length of a single hash value, in bytes.  This is sufficient
+ for SHA512.
+ */
+#define HASH_MAX_LENGTH 64
+
 /**
  Help text to display to the user.
  */
@@ -40,12 +51,31 @@ CHAR strHashHelpText[] =
         "\n"
         "Hash a file.\n"
         "\n"
-        "HASH [-license] [-a <algorithm>] [-b] [-s] [<file>]\n"
+        "HASH [-license] [-a <algorithm>] [-b] [-j n] [-m] [-s] [<file>]\n"
+        "HASH [-license] [-a <algorithm>] [-f] -c <manifest>\n"
+        "HASH [-license] [-a <algorithm>] [-b] [-s] -d <file>...\n"
         "\n"
         "   -a <algorithm> Specify the hash algorithm. Supported algorithms:\n"
-        "                    MD4, MD5, SHA1, SHA256, SHA384, or SHA512\n"
+        "                    MD4, MD5, SHA1, SHA256, SHA384, SHA512, or XXH64\n"
+        "                    XXH64 is fast but not cryptographically secure\n"
+        "                  Can be specified multiple times to calculate several\n"
+        "                    hashes in one pass\n"
         "   -b             Use basic search criteria for files only\n"
-        "   -s             Hash files in subdirectories\n";
+        "   -c <manifest>  Verify files against a manifest\n"
+        "   -d             Find files with duplicate contents\n"
+        "   -f             When verifying, hash files even if unchanged since the\n"
+        "                    manifest was generated\n"
+        "   -j n           Hash files on the specified number of threads\n"
+        "   -m             Output a manifest containing each file's size,\n"
+        "                    timestamp and hash\n"
+        "   -s             Hash files in subdirectories\n"
+        "\n"
+        "When verifying, files whose size and timestamp match the manifest are\n"
+        "assumed unchanged and are not hashed unless -f is specified.\n"
+        "\n"
+        "When finding duplicates, only files with the same size are hashed, and\n"
+        "files larger than 128Kb are compared by their first and last 64Kb before\n"
+        "being hashed completely.  Empty files are not reported.\n";
 
 /**
  Display usage text to the user.
@@ -61,6 +91,120 @@ HashHelp(VOID)
     return TRUE;
 }
 
+/**
+ The implementation used to calculate a hash.
+ */
+typedef enum _HASH_ENGINE {
+    HashEngineCryptoApi = 0,
+    HashEngineBCrypt = 1,
+    HashEngineXxHash64 = 2
+} HASH_ENGINE;
+
+/**
+ A description of an algorithm that can be specified by the user.
+ */
+typedef struct _HASH_ALGORITHM {
+
+    /**
+     The name of the algorithm as specified by the user.
+     */
+    LPCTSTR Name;
+
+    /**
+     The algorithm in CALG_* format, or zero if CryptoAPI cannot calculate
+     this hash.
+     */
+    DWORD CryptAlgorithm;
+
+    /**
+     The algorithm identifier for BCrypt, or NULL if BCrypt cannot calculate
+     this hash.
+     */
+    LPCWSTR BCryptAlgorithm;
+} HASH_ALGORITHM, *PHASH_ALGORITHM;
+
+/**
+ A pointer to a constant algorithm description.
+ */
+typedef CONST HASH_ALGORITHM *PCHASH_ALGORITHM;
+
+/**
+ The set of algorithms that can be specified by the user.
+ */
+CONST HASH_ALGORITHM HashAlgorithms[] = {
+    {_T("MD4"),    CALG_MD4,     L"MD4"},
+    {_T("MD5"),    CALG_MD5,     L"MD5"},
+    {_T("SHA1"),   CALG_SHA1,    L"SHA1"},
+    {_T("SHA256"), CALG_SHA_256, L"SHA256"},
+    {_T("SHA384"), CALG_SHA_384, L"SHA384"},
+    {_T("SHA512"), CALG_SHA_512, L"SHA512"},
+    {_T("XXH64"),  0,            NULL}
+};
+
+/**
+ The index within HashAlgorithms of the algorithm to use if none is
+ specified.  This is SHA1.
+ */
+#define HASH_DEFAULT_ALGORITHM 2
+
+/**
+ The state of a single algorithm while hashing a single stream.
+ */
+typedef union _HASH_STATE {
+
+    /**
+     The CryptoAPI hash handle, if the algorithm is using CryptoAPI.
+     */
+    DWORD_PTR CryptHash;
+
+    /**
+     The BCrypt hash handle, if the algorithm is using BCrypt.
+     */
+    PVOID BCryptHash;
+
+    /**
+     The hash context, if the algorithm is XXH64.
+     */
+    YORILIB_XXHASH64_CONTEXT XxHash64;
+} HASH_STATE, *PHASH_STATE;
+
+/**
+ The number of bytes from the beginning and from the end of a file which are
+ hashed to determine whether it may be a duplicate of another file of the
+ same size.  Files no larger than twice this value are hashed completely.
+ */
+#define HASH_DUP_SAMPLE_SIZE (64 * 1024)
+
+/**
+ Information about a single file found when searching for duplicates.  This
+ is allocated for each nonempty file found, followed by its path.
+ */
+typedef struct _HASH_DUP_FILE {
+
+    /**
+     The size of the file.
+     */
+    DWORDLONG FileSize;
+
+    /**
+     The hex representation of the hash of the beginning and end of the file.
+     This is only populated if another file has the same size.
+     */
+    YORI_STRING SampleHash;
+
+    /**
+     The hex representation of the hash of the entire file.  This is only
+     populated if another file has the same size and sample hash.
+     */
+    YORI_STRING FullHash;
+
+    /**
+     The fully qualified, escaped path to the file.  The string is stored
+     immediately after this structure.
+     */
+    YORI_STRING FilePath;
+} HASH_DUP_FILE, *PHASH_DUP_FILE;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -87,197 +231,1667 @@ typedef struct _HASH_CONTEXT {
     DWORD SavedErrorThisArg;
 
     /**
-     The algorithm to use in CALG_* format.
+     The number of algorithms to calculate for each file.
+     */
+    DWORD AlgorithmCount;
+
+    /**
+     The algorithms to calculate.
+     */
+    PCHASH_ALGORITHM Algorithm[HASH_MAX_ALGORITHMS];
+
+    /**
+     The implementation used to calculate each algorithm.  BCrypt is used
+     where available, since it uses processor hash instructions where
+     present, and CryptoAPI is used on older systems.
+     */
+    HASH_ENGINE Engine[HASH_MAX_ALGORITHMS];
+
+    /**
+     For algorithms using BCrypt, the handle to the algorithm provider.
      */
-    DWORD Algorithm;
+    PVOID BCryptProvider[HASH_MAX_ALGORITHMS];
 
     /**
-     Pointer to a blob of memory containing the result of the hash calculation
-     for each file.
+     For algorithms using BCrypt, the number of bytes needed for each hash
+     object.
      */
-    PUCHAR HashBuffer;
+    DWORD BCryptObjectLength[HASH_MAX_ALGORITHMS];
 
     /**
-     Specifies the number of bytes in HashBuffer.
+     The total number of bytes needed for BCrypt hash objects for all
+     algorithms.
      */
-    YORI_ALLOC_SIZE_T HashLength;
+    YORI_ALLOC_SIZE_T BCryptObjectTotalLength;
 
     /**
-     Pointer to a buffer to read data from the file into.
+     Specifies the number of bytes in the result of each algorithm.
      */
-    PVOID ReadBuffer;
+    YORI_ALLOC_SIZE_T HashLength[HASH_MAX_ALGORITHMS];
 
     /**
-     Specifies the number of bytes in ReadBuffer.
+     Specifies the number of characters needed to display the result of all
+     algorithms, including separators and a NULL terminator.
+     */
+    YORI_ALLOC_SIZE_T HashStringLength;
+
+    /**
+     Specifies the number of bytes in each buffer used to read data from a
+     file.
      */
     YORI_ALLOC_SIZE_T ReadBufferLength;
 
     /**
-     A string which contains enough characters to contain the hex
-     representation of HashBuffer plus a NULL terminator.
+     The number of threads to hash files on.  If this is zero or one, files
+     are hashed on the enumerating thread.
      */
-    YORI_STRING HashString;
+    DWORD ThreadCount;
+
+    /**
+     A queue of files to hash on background threads.  This is only
+     initialized if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     A mutex synchronizing OutputList.
+     */
+    HANDLE OutputMutex;
+
+    /**
+     A list of files which have been found but whose results have not yet
+     been displayed, in the order they were found.  Files can complete in
+     any order, but results are displayed in this order.
+     */
+    YORI_LIST_ENTRY OutputList;
+
+    /**
+     If TRUE, output is in manifest form, containing the full path, size
+     and timestamp of each file, so it can be verified later.
+     */
+    BOOLEAN ManifestOutput;
+
+    /**
+     If TRUE, when verifying a manifest, files are hashed even if their size
+     and timestamp match the manifest.
+     */
+    BOOLEAN ForceVerify;
+
+    /**
+     If TRUE, files are collected so that files with duplicate contents can
+     be reported, rather than outputting the hash of each file.
+     */
+    BOOLEAN FindDuplicates;
+
+    /**
+     When finding duplicates, an array of pointers to each file found.
+     */
+    PHASH_DUP_FILE *DupFiles;
+
+    /**
+     The number of elements in DupFiles that are populated.
+     */
+    YORI_ALLOC_SIZE_T DupFileCount;
+
+    /**
+     The number of elements allocated in DupFiles.
+     */
+    YORI_ALLOC_SIZE_T DupFilesAllocated;
+
+    /**
+     The number of sets of duplicate files which have been displayed.
+     */
+    LONGLONG DupGroupsFound;
 
     /**
      Records the total number of files processed.
      */
     LONGLONG FilesFound;
 
-    /**
-     Records the total number of files processed within a single command line
-     argument.
-     */
-    LONGLONG FilesFoundThisArg;
+    /**
+     Records the total number of files processed within a single command line
+     argument.
+     */
+    LONGLONG FilesFoundThisArg;
+
+    /**
+     When verifying a manifest, the number of files which were hashed and
+     matched the manifest.
+     */
+    LONGLONG FilesVerified;
+
+    /**
+     When verifying a manifest, the number of files which were not hashed
+     because their size and timestamp matched the manifest.
+     */
+    LONGLONG FilesUnchanged;
+
+    /**
+     When verifying a manifest, the number of files whose hash did not match
+     the manifest.
+     */
+    LONGLONG FilesFailed;
+
+    /**
+     When verifying a manifest, the number of files in the manifest which
+     could not be opened.
+     */
+    LONGLONG FilesMissing;
+
+} HASH_CONTEXT, *PHASH_CONTEXT;
+
+/**
+ Information about a single file to hash.  When hashing files on background
+ threads, this is allocated for each file found and is freed once its result
+ has been displayed.
+ */
+typedef struct _HASH_FILE {
+
+    /**
+     The link within the work queue of files waiting to be hashed.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The link within the list of files waiting to display results.
+     */
+    YORI_LIST_ENTRY OutputList;
+
+    /**
+     A handle to the file opened for overlapped reads.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The name of the file to display.  This is a copy owned by this
+     structure.
+     */
+    YORI_STRING DisplayPath;
+
+    /**
+     The size of the file.  This is only populated when generating a
+     manifest.
+     */
+    DWORDLONG FileSize;
+
+    /**
+     The last write time of the file.  This is only populated when
+     generating a manifest.
+     */
+    DWORDLONG LastWriteTime;
+
+    /**
+     On successful completion, contains the hex representation of each
+     hash.
+     */
+    YORI_STRING HashString;
+
+    /**
+     Set to TRUE once the file has been processed.
+     */
+    BOOLEAN Complete;
+
+    /**
+     Set to TRUE if HashString contains a valid result.
+     */
+    BOOLEAN Succeeded;
+} HASH_FILE, *PHASH_FILE;
+
+/**
+ Determine whether a read error indicates that the end of the stream has been
+ reached.  Files return end of file, and pipes return broken pipe once the
+ writer has closed its handle.
+
+ @param Err The Win32 error code from the read.
+
+ @return TRUE if the error indicates the end of the stream, FALSE if it
+         indicates a failure.
+ */
+BOOL
+HashIsEndOfStream(
+    __in DWORD Err
+    )
+{
+    if (Err == ERROR_HANDLE_EOF || Err == ERROR_BROKEN_PIPE) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Read the next buffer from an incoming stream.  If the stream is opened for
+ overlapped IO, the read is initiated and may complete asynchronously.
+
+ @param hSource A handle to the incoming stream.
+
+ @param Overlapped Pointer to the overlapped structure to use, or NULL if
+        the stream is not opened for overlapped IO.
+
+ @param Offset The offset within the stream to read from.  This is only
+        meaningful for overlapped IO.
+
+ @param Buffer Pointer to the buffer to read into.
+
+ @param BufferLength The number of bytes to read.
+
+ @param BytesRead On completion, for synchronous IO, updated to contain the
+        number of bytes read.
+
+ @param Pending On completion, set to TRUE if an overlapped read was started
+        and must be waited for before the buffer is used.
+
+ @return TRUE to indicate the read succeeded or was started, FALSE if the
+         read failed.  Note that reaching the end of the stream is not
+         a failure, and is indicated by zero bytes being read.
+ */
+BOOL
+HashReadBuffer(
+    __in HANDLE hSource,
+    __in_opt LPOVERLAPPED Overlapped,
+    __in DWORDLONG Offset,
+    __out_bcount(BufferLength) PVOID Buffer,
+    __in DWORD BufferLength,
+    __out PDWORD BytesRead,
+    __out PBOOLEAN Pending
+    )
+{
+    *BytesRead = 0;
+    *Pending = FALSE;
+
+    if (Overlapped == NULL) {
+        if (!ReadFile(hSource, Buffer, BufferLength, BytesRead, NULL)) {
+            return HashIsEndOfStream(GetLastError());
+        }
+        return TRUE;
+    }
+
+    Overlapped->Offset = (DWORD)Offset;
+    Overlapped->OffsetHigh = (DWORD)(Offset >> 32);
+    ResetEvent(Overlapped->hEvent);
+    if (!ReadFile(hSource, Buffer, BufferLength, NULL, Overlapped)) {
+        if (GetLastError() != ERROR_IO_PENDING) {
+            return HashIsEndOfStream(GetLastError());
+        }
+    }
+
+    *Pending = TRUE;
+    return TRUE;
+}
+
+/**
+ Begin calculating a single algorithm over a stream.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @param State On successful completion, populated with the state of the
+        algorithm.
+
+ @param ObjectBuffer For algorithms using BCrypt, pointer to memory to hold
+        the hash object.  This must remain valid until the hash is
+        destroyed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashStartAlgorithm(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index,
+    __out PHASH_STATE State,
+    __in_opt PUCHAR ObjectBuffer
+    )
+{
+    switch(HashContext->Engine[Index]) {
+        case HashEngineCryptoApi:
+            if (!DllAdvApi32.pCryptCreateHash(HashContext->Provider, HashContext->Algorithm[Index]->CryptAlgorithm, 0, 0, &State->CryptHash)) {
+                return FALSE;
+            }
+            break;
+        case HashEngineBCrypt:
+            if (DllBCrypt.pBCryptCreateHash(HashContext->BCryptProvider[Index], &State->BCryptHash, ObjectBuffer, HashContext->BCryptObjectLength[Index], NULL, 0, 0) < 0) {
+                return FALSE;
+            }
+            break;
+        case HashEngineXxHash64:
+            YoriLibXxHash64Initialize(&State->XxHash64, 0);
+            break;
+    }
+
+    return TRUE;
+}
+
+/**
+ Add data to a single algorithm.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @param State Pointer to the state of the algorithm.
+
+ @param Buffer Pointer to the data to add.
+
+ @param BufferLength The number of bytes in Buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashAddData(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index,
+    __inout PHASH_STATE State,
+    __in_bcount(BufferLength) PUCHAR Buffer,
+    __in DWORD BufferLength
+    )
+{
+    switch(HashContext->Engine[Index]) {
+        case HashEngineCryptoApi:
+            if (!DllAdvApi32.pCryptHashData(State->CryptHash, Buffer, BufferLength, 0)) {
+                return FALSE;
+            }
+            break;
+        case HashEngineBCrypt:
+            if (DllBCrypt.pBCryptHashData(State->BCryptHash, Buffer, BufferLength, 0) < 0) {
+                return FALSE;
+            }
+            break;
+        case HashEngineXxHash64:
+            YoriLibXxHash64Update(&State->XxHash64, Buffer, BufferLength);
+            break;
+    }
+
+    return TRUE;
+}
+
+/**
+ Complete a single algorithm and return the resulting hash.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @param State Pointer to the state of the algorithm.
+
+ @param HashBuffer On successful completion, populated with the hash.  This
+        must be at least as long as the hash length of the algorithm.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashFinishAlgorithm(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index,
+    __inout PHASH_STATE State,
+    __out PUCHAR HashBuffer
+    )
+{
+    DWORD HashLength;
+    DWORDLONG Value;
+
+    HashLength = HashContext->HashLength[Index];
+    switch(HashContext->Engine[Index]) {
+        case HashEngineCryptoApi:
+            if (!DllAdvApi32.pCryptGetHashParam(State->CryptHash, HP_HASHVAL, HashBuffer, &HashLength, 0)) {
+                return FALSE;
+            }
+            break;
+        case HashEngineBCrypt:
+            if (DllBCrypt.pBCryptFinishHash(State->BCryptHash, HashBuffer, HashLength, 0) < 0) {
+                return FALSE;
+            }
+            break;
+        case HashEngineXxHash64:
+
+            //
+            //  The canonical representation of this hash is big endian.
+            //
+
+            Value = YoriLibXxHash64Finalize(&State->XxHash64);
+            for (HashLength = sizeof(Value); HashLength > 0; HashLength--) {
+                HashBuffer[HashLength - 1] = (UCHAR)Value;
+                Value = Value >> 8;
+            }
+            break;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free any resources associated with a single algorithm.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @param State Pointer to the state of the algorithm.
+ */
+VOID
+HashDestroyAlgorithm(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index,
+    __in PHASH_STATE State
+    )
+{
+    switch(HashContext->Engine[Index]) {
+        case HashEngineCryptoApi:
+            DllAdvApi32.pCryptDestroyHash(State->CryptHash);
+            break;
+        case HashEngineBCrypt:
+            DllBCrypt.pBCryptDestroyHash(State->BCryptHash);
+            break;
+        case HashEngineXxHash64:
+            break;
+    }
+}
+
+/**
+ Complete each algorithm and return the resulting hashes as a string.
+
+ @param HashContext Pointer to the hash context.
+
+ @param State Pointer to an array of the state of each algorithm.
+
+ @param HashString On successful completion, populated with the hex
+        representation of each hash, separated by spaces.  The caller should
+        free this with YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashFormatResult(
+    __in PHASH_CONTEXT HashContext,
+    __inout PHASH_STATE State,
+    __out PYORI_STRING HashString
+    )
+{
+    UCHAR HashBuffer[HASH_MAX_LENGTH];
+    YORI_STRING HashSubset;
+    DWORD Index;
+
+    if (!YoriLibAllocateString(HashString, HashContext->HashStringLength)) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (!HashFinishAlgorithm(HashContext, Index, &State[Index], HashBuffer)) {
+            YoriLibFreeStringContents(HashString);
+            return FALSE;
+        }
+
+        if (Index > 0) {
+            HashString->StartOfString[HashString->LengthInChars] = ' ';
+            HashString->LengthInChars++;
+        }
+
+        YoriLibInitEmptyString(&HashSubset);
+        HashSubset.StartOfString = &HashString->StartOfString[HashString->LengthInChars];
+        HashSubset.LengthAllocated = HashString->LengthAllocated - HashString->LengthInChars;
+        if (!YoriLibHexBufferToString(HashBuffer, HashContext->HashLength[Index], &HashSubset)) {
+            YoriLibFreeStringContents(HashString);
+            return FALSE;
+        }
+        HashString->LengthInChars = HashString->LengthInChars + HashSubset.LengthInChars;
+    }
+
+    return TRUE;
+}
+
+/**
+ Take a single incoming stream and calculate the hash of its contents with
+ each requested algorithm.  If the stream is opened for overlapped IO, two
+ buffers are used so the next read is in progress while the previous buffer
+ is being hashed.
+
+ @param hSource A handle to the incoming stream, which may be a file or a
+        pipe.
+
+ @param UseOverlapped TRUE if hSource was opened for overlapped IO.
+
+ @param HashContext Pointer to a context describing the actions to perform.
+
+ @param HashString On successful completion, populated with the hex
+        representation of each hash, separated by spaces.  The caller should
+        free this with YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashProcessStream(
+    __in HANDLE hSource,
+    __in BOOLEAN UseOverlapped,
+    __in PHASH_CONTEXT HashContext,
+    __out PYORI_STRING HashString
+    )
+{
+    DWORD Err;
+    HASH_STATE State[HASH_MAX_ALGORITHMS];
+    DWORD AlgorithmsStarted;
+    PUCHAR ObjectBuffer;
+    PUCHAR ObjectBufferOffset;
+    OVERLAPPED Overlapped[2];
+    LPOVERLAPPED CurrentOverlapped;
+    PUCHAR ReadBuffer;
+    PUCHAR Buffers[2];
+    DWORDLONG Offset;
+    DWORD BufferLength;
+    DWORD BytesRead;
+    DWORD Index;
+    DWORD Current;
+    DWORD Next;
+    DWORD NextBytesRead;
+    DWORD BufferCount;
+    DWORD FileSizeHigh;
+    DWORD FileSizeLow;
+    BOOLEAN Pending;
+
+    YoriLibInitEmptyString(HashString);
+    ZeroMemory(Overlapped, sizeof(Overlapped));
+    AlgorithmsStarted = 0;
+    ObjectBuffer = NULL;
+    ReadBuffer = NULL;
+    CurrentOverlapped = NULL;
+    Pending = FALSE;
+    NextBytesRead = 0;
+    Err = ERROR_SUCCESS;
+
+    if (HashContext->BCryptObjectTotalLength > 0) {
+        ObjectBuffer = YoriLibMalloc(HashContext->BCryptObjectTotalLength);
+        if (ObjectBuffer == NULL) {
+            Err = ERROR_NOT_ENOUGH_MEMORY;
+            goto Exit;
+        }
+    }
+
+    ObjectBufferOffset = ObjectBuffer;
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (!HashStartAlgorithm(HashContext, Index, &State[Index], ObjectBufferOffset)) {
+            Err = ERROR_INVALID_FUNCTION;
+            goto Exit;
+        }
+        AlgorithmsStarted++;
+        if (HashContext->Engine[Index] == HashEngineBCrypt) {
+            ObjectBufferOffset = ObjectBufferOffset + HashContext->BCryptObjectLength[Index];
+        }
+    }
+
+    //
+    //  For a regular file, there's no point allocating buffers larger than
+    //  the file, which is common when hashing many small files.  The file
+    //  is read in one request followed by a request indicating end of file.
+    //
+
+    BufferLength = HashContext->ReadBufferLength;
+    if (UseOverlapped && GetFileType(hSource) == FILE_TYPE_DISK) {
+        FileSizeLow = GetFileSize(hSource, &FileSizeHigh);
+        if ((FileSizeLow != INVALID_FILE_SIZE || GetLastError() == NO_ERROR) &&
+            FileSizeHigh == 0 &&
+            FileSizeLow < BufferLength) {
+
+            BufferLength = (FileSizeLow + 4096) & ~(4095);
+            if (BufferLength > HashContext->ReadBufferLength) {
+                BufferLength = HashContext->ReadBufferLength;
+            }
+        }
+    }
+
+    //
+    //  Synchronous IO only needs one buffer since it can't read and hash at
+    //  the same time.
+    //
+
+    BufferCount = 1;
+    if (UseOverlapped) {
+        BufferCount = 2;
+    }
+
+    ReadBuffer = YoriLibMalloc(BufferLength * BufferCount);
+    if (ReadBuffer == NULL) {
+        Err = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+    Buffers[0] = ReadBuffer;
+    Buffers[1] = ReadBuffer + BufferLength * (BufferCount - 1);
+
+    if (UseOverlapped) {
+        for (Index = 0; Index < 2; Index++) {
+            Overlapped[Index].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (Overlapped[Index].hEvent == NULL) {
+                Err = GetLastError();
+                goto Exit;
+            }
+        }
+        CurrentOverlapped = &Overlapped[0];
+    }
+
+    //
+    //  Start the first read.  For overlapped IO, each time a read completes
+    //  the next read is started into the other buffer before hashing the
+    //  one that completed, so only one read is outstanding at a time.
+    //
+
+    Offset = 0;
+    Current = 0;
+    if (!HashReadBuffer(hSource, CurrentOverlapped, Offset, Buffers[Current], BufferLength, &BytesRead, &Pending)) {
+        Err = GetLastError();
+        goto Exit;
+    }
+
+    while (TRUE) {
+        if (Pending) {
+            Pending = FALSE;
+            if (!GetOverlappedResult(hSource, CurrentOverlapped, &BytesRead, TRUE)) {
+                BytesRead = 0;
+                Err = GetLastError();
+                if (HashIsEndOfStream(Err)) {
+                    Err = ERROR_SUCCESS;
+                }
+            }
+        }
+
+        if (Err != ERROR_SUCCESS || BytesRead == 0) {
+            break;
+        }
+
+        Offset = Offset + BytesRead;
+        Next = (Current + 1) % 2;
+
+        if (UseOverlapped) {
+            CurrentOverlapped = &Overlapped[Next];
+            if (!HashReadBuffer(hSource, CurrentOverlapped, Offset, Buffers[Next], BufferLength, &NextBytesRead, &Pending)) {
+                Err = GetLastError();
+                break;
+            }
+        }
+
+        for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+            if (!HashAddData(HashContext, Index, &State[Index], Buffers[Current], BytesRead)) {
+                Err = ERROR_INVALID_FUNCTION;
+                break;
+            }
+        }
+
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        //
+        //  For overlapped IO, the read into the next buffer is in progress
+        //  or complete.  For synchronous IO, it can only be performed now
+        //  that the current buffer is hashed.
+        //
+
+        if (UseOverlapped) {
+            BytesRead = NextBytesRead;
+        } else if (!HashReadBuffer(hSource, NULL, Offset, Buffers[Next], BufferLength, &BytesRead, &Pending)) {
+            Err = GetLastError();
+            break;
+        }
+
+        Current = Next;
+    }
+
+    if (Err != ERROR_SUCCESS) {
+        goto Exit;
+    }
+
+    if (!HashFormatResult(HashContext, State, HashString)) {
+        Err = ERROR_INVALID_FUNCTION;
+        goto Exit;
+    }
+
+Exit:
+
+    //
+    //  If a read is still in progress, it must finish before its buffer can
+    //  be freed.
+    //
+
+    if (Pending) {
+        GetOverlappedResult(hSource, CurrentOverlapped, &BytesRead, TRUE);
+    }
+
+    for (Index = 0; Index < 2; Index++) {
+        if (Overlapped[Index].hEvent != NULL) {
+            CloseHandle(Overlapped[Index].hEvent);
+        }
+    }
+
+    if (ReadBuffer != NULL) {
+        YoriLibFree(ReadBuffer);
+    }
+
+    for (Index = 0; Index < AlgorithmsStarted; Index++) {
+        HashDestroyAlgorithm(HashContext, Index, &State[Index]);
+    }
+
+    if (ObjectBuffer != NULL) {
+        YoriLibFree(ObjectBuffer);
+    }
+
+    if (Err != ERROR_SUCCESS) {
+        YoriLibFreeStringContents(HashString);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Open a file for hashing.  The file is opened for overlapped IO so that
+ reads can proceed while previous data is being hashed.
+
+ @param FilePath Pointer to the fully qualified, escaped path to the file.
+
+ @return A handle to the file, or INVALID_HANDLE_VALUE on failure.
+ */
+HANDLE
+HashOpenFile(
+    __in PYORI_STRING FilePath
+    )
+{
+    return CreateFile(FilePath->StartOfString,
+                      GENERIC_READ,
+                      FILE_SHARE_READ | FILE_SHARE_DELETE,
+                      NULL,
+                      OPEN_EXISTING,
+                      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                      NULL);
+}
+
+/**
+ Query the size and last write time of an opened file.
+
+ @param FileHandle A handle to the file.
+
+ @param FileSize On successful completion, updated to contain the size of
+        the file.
+
+ @param LastWriteTime On successful completion, updated to contain the last
+        write time of the file in FILETIME units.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  On failure,
+         both values are set to zero.
+ */
+BOOL
+HashGetFileSizeAndTime(
+    __in HANDLE FileHandle,
+    __out PDWORDLONG FileSize,
+    __out PDWORDLONG LastWriteTime
+    )
+{
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+
+    if (!GetFileInformationByHandle(FileHandle, &FileInfo)) {
+        *FileSize = 0;
+        *LastWriteTime = 0;
+        return FALSE;
+    }
+
+    *FileSize = ((DWORDLONG)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+    *LastWriteTime = ((DWORDLONG)FileInfo.ftLastWriteTime.dwHighDateTime << 32) | FileInfo.ftLastWriteTime.dwLowDateTime;
+    return TRUE;
+}
+
+/**
+ Display the result of hashing a single file.
+
+ @param HashContext Pointer to the hash context, indicating the output
+        format.
+
+ @param HashString Pointer to the hex representation of the hash.
+
+ @param DisplayPath Pointer to the name of the file to display.
+
+ @param FileSize The size of the file, if generating a manifest.
+
+ @param LastWriteTime The last write time of the file, if generating a
+        manifest.
+ */
+VOID
+HashOutputResult(
+    __in PHASH_CONTEXT HashContext,
+    __in PYORI_STRING HashString,
+    __in PYORI_STRING DisplayPath,
+    __in DWORDLONG FileSize,
+    __in DWORDLONG LastWriteTime
+    )
+{
+    if (HashContext->ManifestOutput) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %lli %016llx %y\n"), HashString, FileSize, LastWriteTime, DisplayPath);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), HashString, DisplayPath);
+    }
+}
+
+/**
+ Mark a file as having been processed, and display the results of any files
+ which are complete and have no earlier files still in progress.  This
+ ensures that results are displayed in the order files were found even when
+ they are hashed concurrently.
+
+ @param HashContext Pointer to the hash context.
+
+ @param HashFile Pointer to the file which has been processed.
+ */
+VOID
+HashCompleteFile(
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_FILE HashFile
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PHASH_FILE OutputFile;
+
+    WaitForSingleObject(HashContext->OutputMutex, INFINITE);
+    HashFile->Complete = TRUE;
+
+    while (TRUE) {
+        ListEntry = YoriLibGetNextListEntry(&HashContext->OutputList, NULL);
+        if (ListEntry == NULL) {
+            break;
+        }
+
+        OutputFile = CONTAINING_RECORD(ListEntry, HASH_FILE, OutputList);
+        if (!OutputFile->Complete) {
+            break;
+        }
+
+        YoriLibRemoveListItem(&OutputFile->OutputList);
+        if (OutputFile->Succeeded) {
+            HashOutputResult(HashContext, &OutputFile->HashString, &OutputFile->DisplayPath, OutputFile->FileSize, OutputFile->LastWriteTime);
+        }
+        YoriLibFreeStringContents(&OutputFile->HashString);
+        YoriLibFree(OutputFile);
+    }
+
+    ReleaseMutex(HashContext->OutputMutex);
+}
+
+/**
+ Hash a single file on a background thread.
+
+ @param Context Pointer to the hash context.
+
+ @param Item Pointer to the work item embedded in a HASH_FILE.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be hashed.
+ */
+VOID
+HashFileWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PHASH_CONTEXT HashContext = (PHASH_CONTEXT)Context;
+    PHASH_FILE HashFile;
+
+    HashFile = CONTAINING_RECORD(Item, HASH_FILE, WorkItem);
+
+    if (!Cancelled) {
+        HashFile->Succeeded = (BOOLEAN)HashProcessStream(HashFile->FileHandle, TRUE, HashContext, &HashFile->HashString);
+    }
+
+    CloseHandle(HashFile->FileHandle);
+    HashFile->FileHandle = NULL;
+
+    HashCompleteFile(HashContext, HashFile);
+}
+
+/**
+ Queue a file to be hashed on a background thread.  The file is added to the
+ list of files whose results are pending display, so its result is displayed
+ after any files found before it.
+
+ @param HashContext Pointer to the hash context.
+
+ @param FileHandle A handle to the file, opened for overlapped IO.  This
+        function takes ownership of the handle.
+
+ @param DisplayPath Pointer to the name of the file to display.  This is
+        copied so the caller's string can be reused.
+
+ @param FileSize The size of the file, if generating a manifest.
+
+ @param LastWriteTime The last write time of the file, if generating a
+        manifest.
+ */
+VOID
+HashQueueFile(
+    __in PHASH_CONTEXT HashContext,
+    __in HANDLE FileHandle,
+    __in PYORI_STRING DisplayPath,
+    __in DWORDLONG FileSize,
+    __in DWORDLONG LastWriteTime
+    )
+{
+    PHASH_FILE HashFile;
+    YORI_ALLOC_SIZE_T AllocSize;
+
+    AllocSize = sizeof(HASH_FILE) + (DisplayPath->LengthInChars + 1) * sizeof(TCHAR);
+    HashFile = YoriLibMalloc(AllocSize);
+    if (HashFile == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: out of memory hashing %y\n"), DisplayPath);
+        CloseHandle(FileHandle);
+        return;
+    }
+
+    ZeroMemory(HashFile, sizeof(HASH_FILE));
+    HashFile->FileHandle = FileHandle;
+    HashFile->FileSize = FileSize;
+    HashFile->LastWriteTime = LastWriteTime;
+    YoriLibInitEmptyString(&HashFile->HashString);
+    YoriLibInitEmptyString(&HashFile->DisplayPath);
+    HashFile->DisplayPath.StartOfString = (LPTSTR)(HashFile + 1);
+    HashFile->DisplayPath.LengthInChars = DisplayPath->LengthInChars;
+    HashFile->DisplayPath.LengthAllocated = DisplayPath->LengthInChars + 1;
+    memcpy(HashFile->DisplayPath.StartOfString, DisplayPath->StartOfString, DisplayPath->LengthInChars * sizeof(TCHAR));
+    HashFile->DisplayPath.StartOfString[DisplayPath->LengthInChars] = '\0';
+
+    WaitForSingleObject(HashContext->OutputMutex, INFINITE);
+    YoriLibAppendList(&HashContext->OutputList, &HashFile->OutputList);
+    ReleaseMutex(HashContext->OutputMutex);
+
+    //
+    //  If the file can't be queued, process it here.  This still needs to
+    //  complete the file so that results are displayed in order.
+    //
+
+    if (!YoriLibQueueWorkItem(&HashContext->WorkQueue, &HashFile->WorkItem, TRUE)) {
+        HashFileWorker(HashContext, &HashFile->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+    }
+}
+
+/**
+ A callback that is invoked when a file is found within the tree root whose
+ hash is requested.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.  This can be NULL if the file
+        was not found by enumeration.
+
+ @param Depth Indicates the recursion depth.
+
+ @param Context Pointer to a context block specifying the hash to generate.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+HashFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PHASH_CONTEXT HashContext = (PHASH_CONTEXT)Context;
+    YORI_STRING RelativePathFrom;
+    YORI_STRING UnescapedPath;
+    YORI_STRING HashString;
+    PYORI_STRING DisplayPath;
+    HANDLE FileHandle;
+    DWORDLONG FileSize;
+    DWORDLONG LastWriteTime;
+    YORI_ALLOC_SIZE_T SlashesFound;
+    YORI_ALLOC_SIZE_T Index;
+
+    UNREFERENCED_PARAMETER(FileInfo);
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    YoriLibInitEmptyString(&RelativePathFrom);
+
+    SlashesFound = 0;
+    for (Index = FilePath->LengthInChars; Index > 0; Index--) {
+        if (FilePath->StartOfString[Index - 1] == '\\') {
+            SlashesFound++;
+            if (SlashesFound == Depth + 1) {
+                break;
+            }
+        }
+    }
+
+    ASSERT(Index > 0);
+    ASSERT(SlashesFound == Depth + 1);
+
+    RelativePathFrom.StartOfString = &FilePath->StartOfString[Index];
+    RelativePathFrom.LengthInChars = FilePath->LengthInChars - Index;
+
+    FileHandle = HashOpenFile(FilePath);
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        if (HashContext->SavedErrorThisArg == ERROR_SUCCESS) {
+            DWORD LastError = GetLastError();
+            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: open of %y failed: %s"), FilePath, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+        }
+        return TRUE;
+    }
+
+    HashContext->SavedErrorThisArg = ERROR_SUCCESS;
+    HashContext->FilesFound++;
+    HashContext->FilesFoundThisArg++;
+
+    //
+    //  A manifest needs to be verifiable from any directory, so it records
+    //  the full path along with the size and timestamp.
+    //
+
+    YoriLibInitEmptyString(&UnescapedPath);
+    DisplayPath = &RelativePathFrom;
+    FileSize = 0;
+    LastWriteTime = 0;
+    if (HashContext->ManifestOutput) {
+        DisplayPath = FilePath;
+        if (YoriLibUnescapePath(FilePath, &UnescapedPath)) {
+            DisplayPath = &UnescapedPath;
+        }
+        HashGetFileSizeAndTime(FileHandle, &FileSize, &LastWriteTime);
+    }
+
+    if (HashContext->ThreadCount > 1) {
+        HashQueueFile(HashContext, FileHandle, DisplayPath, FileSize, LastWriteTime);
+    } else {
+        if (HashProcessStream(FileHandle, TRUE, HashContext, &HashString)) {
+            HashOutputResult(HashContext, &HashString, DisplayPath, FileSize, LastWriteTime);
+            YoriLibFreeStringContents(&HashString);
+        }
+        CloseHandle(FileHandle);
+    }
+
+    YoriLibFreeStringContents(&UnescapedPath);
+    return TRUE;
+}
+
+
+/**
+ Display an error opening a file.
+
+ @param FilePath Pointer to the path of the file that could not be opened.
+ */
+VOID
+HashDupReportOpenFailure(
+    __in PYORI_STRING FilePath
+    )
+{
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    LastError = GetLastError();
+    ErrText = YoriLibGetWinErrorText(LastError);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: open of %y failed: %s"), FilePath, ErrText);
+    YoriLibFreeWinErrorText(ErrText);
+}
+
+/**
+ A callback that is invoked when a file is found when searching for
+ duplicates.  The file is recorded along with its size, but is not opened
+ unless its size is not known.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.  This can be NULL if the file
+        was not found by enumeration.
+
+ @param Depth Indicates the recursion depth.
+
+ @param Context Pointer to the hash context.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+HashDupFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PHASH_CONTEXT HashContext = (PHASH_CONTEXT)Context;
+    PHASH_DUP_FILE DupFile;
+    PHASH_DUP_FILE *NewDupFiles;
+    HANDLE FileHandle;
+    DWORDLONG FileSize;
+    DWORDLONG LastWriteTime;
+    YORI_ALLOC_SIZE_T NewAllocated;
+    YORI_MAX_UNSIGNED_T BytesRequired;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    if (FileInfo != NULL) {
+        FileSize = ((DWORDLONG)FileInfo->nFileSizeHigh << 32) | FileInfo->nFileSizeLow;
+    } else {
+        FileHandle = HashOpenFile(FilePath);
+        if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+            if (HashContext->SavedErrorThisArg == ERROR_SUCCESS) {
+                HashDupReportOpenFailure(FilePath);
+            }
+            return TRUE;
+        }
+        HashGetFileSizeAndTime(FileHandle, &FileSize, &LastWriteTime);
+        CloseHandle(FileHandle);
+    }
+
+    HashContext->SavedErrorThisArg = ERROR_SUCCESS;
+    HashContext->FilesFound++;
+    HashContext->FilesFoundThisArg++;
+
+    //
+    //  Every empty file has the same contents, so reporting them isn't
+    //  useful.
+    //
+
+    if (FileSize == 0) {
+        return TRUE;
+    }
+
+    if (HashContext->DupFileCount >= HashContext->DupFilesAllocated) {
+        NewAllocated = HashContext->DupFilesAllocated * 2;
+        if (NewAllocated < 0x1000) {
+            NewAllocated = 0x1000;
+        }
+
+        BytesRequired = NewAllocated;
+        BytesRequired = BytesRequired * sizeof(PHASH_DUP_FILE);
+        if (NewAllocated <= HashContext->DupFilesAllocated ||
+            !YoriLibIsSizeAllocatable(BytesRequired)) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: too many files\n"));
+            return FALSE;
+        }
+
+        NewDupFiles = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
+        if (NewDupFiles == NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: out of memory\n"));
+            return FALSE;
+        }
+
+        if (HashContext->DupFiles != NULL) {
+            memcpy(NewDupFiles, HashContext->DupFiles, HashContext->DupFileCount * sizeof(PHASH_DUP_FILE));
+            YoriLibFree(HashContext->DupFiles);
+        }
+
+        HashContext->DupFiles = NewDupFiles;
+        HashContext->DupFilesAllocated = NewAllocated;
+    }
+
+    DupFile = YoriLibMalloc(sizeof(HASH_DUP_FILE) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+    if (DupFile == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: out of memory\n"));
+        return FALSE;
+    }
+
+    DupFile->FileSize = FileSize;
+    YoriLibInitEmptyString(&DupFile->SampleHash);
+    YoriLibInitEmptyString(&DupFile->FullHash);
+    YoriLibInitEmptyString(&DupFile->FilePath);
+    DupFile->FilePath.StartOfString = (LPTSTR)(DupFile + 1);
+    DupFile->FilePath.LengthInChars = FilePath->LengthInChars;
+    DupFile->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+    memcpy(DupFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    DupFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+
+    HashContext->DupFiles[HashContext->DupFileCount] = DupFile;
+    HashContext->DupFileCount++;
+
+    return TRUE;
+}
+
+/**
+ Compare two files found when searching for duplicates.  Files are ordered
+ by size, then by the hash of their beginning and end, then by the hash of
+ their contents.  Hashes which have not been calculated compare as equal,
+ which is used to compare files on only the information known so far.
+
+ @param Left Pointer to the first file to compare.
+
+ @param Right Pointer to the second file to compare.
+
+ @return YORI_LIB_LESS_THAN, YORI_LIB_EQUAL or YORI_LIB_GREATER_THAN.
+ */
+DWORD
+HashDupCompareFiles(
+    __in PHASH_DUP_FILE Left,
+    __in PHASH_DUP_FILE Right
+    )
+{
+    int Result;
+
+    if (Left->FileSize < Right->FileSize) {
+        return YORI_LIB_LESS_THAN;
+    } else if (Left->FileSize > Right->FileSize) {
+        return YORI_LIB_GREATER_THAN;
+    }
+
+    Result = YoriLibCompareString(&Left->SampleHash, &Right->SampleHash);
+    if (Result == 0) {
+        Result = YoriLibCompareString(&Left->FullHash, &Right->FullHash);
+    }
+
+    if (Result < 0) {
+        return YORI_LIB_LESS_THAN;
+    } else if (Result > 0) {
+        return YORI_LIB_GREATER_THAN;
+    }
+    return YORI_LIB_EQUAL;
+}
+
+/**
+ Sort an array of files found when searching for duplicates.  This uses a
+ heap sort, which requires no additional memory or recursion regardless of
+ the number of files.
+
+ @param Files Pointer to the array of files to sort.
+
+ @param Count The number of elements in the array.
+ */
+VOID
+HashDupSortFiles(
+    __inout_ecount(Count) PHASH_DUP_FILE *Files,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    PHASH_DUP_FILE Swap;
+    YORI_ALLOC_SIZE_T Start;
+    YORI_ALLOC_SIZE_T End;
+    YORI_ALLOC_SIZE_T Root;
+    YORI_ALLOC_SIZE_T Child;
+
+    if (Count < 2) {
+        return;
+    }
+
+    Start = Count / 2;
+    End = Count;
+
+    while (End > 1) {
+
+        //
+        //  First build the heap.  Once built, move the largest element to
+        //  the end of the array and restore the heap over the remainder.
+        //
+
+        if (Start > 0) {
+            Start--;
+        } else {
+            End--;
+            Swap = Files[0];
+            Files[0] = Files[End];
+            Files[End] = Swap;
+        }
+
+        Root = Start;
+        while (TRUE) {
+            Child = Root * 2 + 1;
+            if (Child >= End) {
+                break;
+            }
+
+            if (Child + 1 < End &&
+                HashDupCompareFiles(Files[Child], Files[Child + 1]) == YORI_LIB_LESS_THAN) {
+                Child++;
+            }
 
-} HASH_CONTEXT, *PHASH_CONTEXT;
+            if (HashDupCompareFiles(Files[Root], Files[Child]) != YORI_LIB_LESS_THAN) {
+                break;
+            }
+
+            Swap = Files[Root];
+            Files[Root] = Files[Child];
+            Files[Child] = Swap;
+            Root = Child;
+        }
+    }
+}
 
 /**
- Take a single incoming stream and break it into pieces.
+ Calculate the hash of the beginning and end of a file.  Both regions are
+ read concurrently.  If the file is small enough, the entire file is hashed
+ instead, and the result is also used as the hash of its contents.
 
- @param hSource A handle to the incoming stream, which may be a file or a
-        pipe.
- 
- @param HashContext Pointer to a context describing the actions to perform.
+ @param HashContext Pointer to the hash context.
+
+ @param DupFile Pointer to the file to hash.  On successful completion, its
+        SampleHash is populated.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-HashProcessStream(
-    __in HANDLE hSource,
-    __in PHASH_CONTEXT HashContext
+HashDupSampleFile(
+    __in PHASH_CONTEXT HashContext,
+    __inout PHASH_DUP_FILE DupFile
     )
 {
-    DWORD Err;
-    DWORD_PTR hHash;
-    DWORD BytesRead;
-
-    HashContext->FilesFound++;
-    HashContext->FilesFoundThisArg++;
+    HASH_STATE State[HASH_MAX_ALGORITHMS];
+    OVERLAPPED Overlapped[2];
+    DWORD BytesRead[2];
+    BOOLEAN Pending[2];
+    DWORD AlgorithmsStarted;
+    PUCHAR ObjectBuffer;
+    PUCHAR ObjectBufferOffset;
+    PUCHAR ReadBuffer;
+    HANDLE FileHandle;
+    DWORD Index;
+    DWORD Region;
+    BOOL Result;
 
-    if (!DllAdvApi32.pCryptCreateHash(HashContext->Provider, HashContext->Algorithm, 0, 0, &hHash)) {
+    FileHandle = HashOpenFile(&DupFile->FilePath);
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        HashDupReportOpenFailure(&DupFile->FilePath);
         return FALSE;
     }
 
+    if (DupFile->FileSize <= 2 * HASH_DUP_SAMPLE_SIZE) {
+        Result = HashProcessStream(FileHandle, TRUE, HashContext, &DupFile->SampleHash);
+        CloseHandle(FileHandle);
+        if (Result) {
+            YoriLibCloneString(&DupFile->FullHash, &DupFile->SampleHash);
+        }
+        return Result;
+    }
 
-    Err = ERROR_SUCCESS;
-    while (TRUE) {
-        if (!ReadFile(hSource, HashContext->ReadBuffer, HashContext->ReadBufferLength, &BytesRead, NULL)) {
-            // MSFIX: Distinguish errors here better? EOF means success,
-            // read error means hash is wrong.  Could be reading from a pipe
-            // etc though
-            break;
+    ZeroMemory(Overlapped, sizeof(Overlapped));
+    ZeroMemory(Pending, sizeof(Pending));
+    AlgorithmsStarted = 0;
+    ObjectBuffer = NULL;
+    Result = FALSE;
+
+    ReadBuffer = YoriLibMalloc(2 * HASH_DUP_SAMPLE_SIZE);
+    if (ReadBuffer == NULL) {
+        goto Exit;
+    }
+
+    for (Region = 0; Region < 2; Region++) {
+        Overlapped[Region].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Overlapped[Region].hEvent == NULL) {
+            goto Exit;
         }
+    }
 
-        if (BytesRead == 0) {
-            break;
+    //
+    //  Issue both reads before waiting for either.
+    //
+
+    for (Region = 0; Region < 2; Region++) {
+        if (!HashReadBuffer(FileHandle,
+                            &Overlapped[Region],
+                            Region == 0? 0 : DupFile->FileSize - HASH_DUP_SAMPLE_SIZE,
+                            ReadBuffer + Region * HASH_DUP_SAMPLE_SIZE,
+                            HASH_DUP_SAMPLE_SIZE,
+                            &BytesRead[Region],
+                            &Pending[Region])) {
+            goto Exit;
         }
+    }
 
-        if (!DllAdvApi32.pCryptHashData(hHash, HashContext->ReadBuffer, BytesRead, 0)) {
-            Err = GetLastError();
-            break;
+    for (Region = 0; Region < 2; Region++) {
+        if (Pending[Region]) {
+            Pending[Region] = FALSE;
+            if (!GetOverlappedResult(FileHandle, &Overlapped[Region], &BytesRead[Region], TRUE)) {
+                BytesRead[Region] = 0;
+            }
         }
+    }
 
+    if (HashContext->BCryptObjectTotalLength > 0) {
+        ObjectBuffer = YoriLibMalloc(HashContext->BCryptObjectTotalLength);
+        if (ObjectBuffer == NULL) {
+            goto Exit;
+        }
     }
 
-    if (Err == ERROR_SUCCESS) {
-        DWORD HashLength;
-        HashLength = HashContext->HashLength;
-        if (DllAdvApi32.pCryptGetHashParam(hHash, HP_HASHVAL, HashContext->HashBuffer, &HashLength, 0)) {
-            if (!YoriLibHexBufferToString(HashContext->HashBuffer, HashContext->HashLength, &HashContext->HashString)) {
-                Err = !(ERROR_SUCCESS);
+    ObjectBufferOffset = ObjectBuffer;
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (!HashStartAlgorithm(HashContext, Index, &State[Index], ObjectBufferOffset)) {
+            goto Exit;
+        }
+        AlgorithmsStarted++;
+        if (HashContext->Engine[Index] == HashEngineBCrypt) {
+            ObjectBufferOffset = ObjectBufferOffset + HashContext->BCryptObjectLength[Index];
+        }
+
+        for (Region = 0; Region < 2; Region++) {
+            if (!HashAddData(HashContext, Index, &State[Index], ReadBuffer + Region * HASH_DUP_SAMPLE_SIZE, BytesRead[Region])) {
+                goto Exit;
             }
         }
     }
 
-    DllAdvApi32.pCryptDestroyHash(hHash);
+    Result = HashFormatResult(HashContext, State, &DupFile->SampleHash);
+
+Exit:
+
+    for (Region = 0; Region < 2; Region++) {
+        if (Pending[Region]) {
+            GetOverlappedResult(FileHandle, &Overlapped[Region], &BytesRead[Region], TRUE);
+        }
+        if (Overlapped[Region].hEvent != NULL) {
+            CloseHandle(Overlapped[Region].hEvent);
+        }
+    }
+
+    for (Index = 0; Index < AlgorithmsStarted; Index++) {
+        HashDestroyAlgorithm(HashContext, Index, &State[Index]);
+    }
+
+    if (ObjectBuffer != NULL) {
+        YoriLibFree(ObjectBuffer);
+    }
 
-    if (Err != STATUS_SUCCESS) {
+    if (ReadBuffer != NULL) {
+        YoriLibFree(ReadBuffer);
+    }
+
+    CloseHandle(FileHandle);
+    return Result;
+}
+
+/**
+ Calculate the hash of the entire contents of a file.
+
+ @param HashContext Pointer to the hash context.
+
+ @param DupFile Pointer to the file to hash.  On successful completion, its
+        FullHash is populated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashDupHashFile(
+    __in PHASH_CONTEXT HashContext,
+    __inout PHASH_DUP_FILE DupFile
+    )
+{
+    HANDLE FileHandle;
+    BOOL Result;
+
+    if (DupFile->FullHash.LengthInChars > 0) {
+        return TRUE;
+    }
+
+    FileHandle = HashOpenFile(&DupFile->FilePath);
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        HashDupReportOpenFailure(&DupFile->FilePath);
         return FALSE;
     }
 
-    return TRUE;
+    Result = HashProcessStream(FileHandle, TRUE, HashContext, &DupFile->FullHash);
+    CloseHandle(FileHandle);
+    return Result;
 }
 
 /**
- A callback that is invoked when a file is found within the tree root whose
- hash is requested.
+ A function which calculates a hash for a single file when searching for
+ duplicates.
+ */
+typedef BOOL HASH_DUP_HASH_FN(PHASH_CONTEXT, PHASH_DUP_FILE);
 
- @param FilePath Pointer to the file path that was found.
+/**
+ A pointer to a function which calculates a hash for a single file when
+ searching for duplicates.
+ */
+typedef HASH_DUP_HASH_FN *PHASH_DUP_HASH_FN;
 
- @param FileInfo Information about the file.  This can be NULL if the file
-        was not found by enumeration.
+/**
+ Calculate a hash for each file in a range, and sort the range so that files
+ with equal hashes are adjacent.  Files which could not be hashed are
+ removed from the range.
 
- @param Depth Indicates the recursion depth.
+ @param HashContext Pointer to the hash context.
 
- @param Context Pointer to a context block specifying the hash to generate.
+ @param Files Pointer to the range of files to hash.
 
- @return TRUE to continute enumerating, FALSE to abort.
+ @param Count The number of files in the range.
+
+ @param HashFn The function to calculate the hash for each file.
+
+ @return The number of files remaining in the range.
  */
-BOOL
-HashFileFoundCallback(
-    __in PYORI_STRING FilePath,
-    __in_opt PWIN32_FIND_DATA FileInfo,
-    __in DWORD Depth,
-    __in PVOID Context
+YORI_ALLOC_SIZE_T
+HashDupHashRange(
+    __in PHASH_CONTEXT HashContext,
+    __inout_ecount(Count) PHASH_DUP_FILE *Files,
+    __in YORI_ALLOC_SIZE_T Count,
+    __in PHASH_DUP_HASH_FN HashFn
     )
 {
-    PHASH_CONTEXT HashContext = (PHASH_CONTEXT)Context;
-    YORI_STRING RelativePathFrom;
-    HANDLE FileHandle;
-    YORI_ALLOC_SIZE_T SlashesFound;
+    PHASH_DUP_FILE Swap;
     YORI_ALLOC_SIZE_T Index;
 
-    UNREFERENCED_PARAMETER(FileInfo);
+    Index = 0;
+    while (Index < Count) {
+        if (YoriLibIsOperationCancelled()) {
+            return 0;
+        }
 
-    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+        if (HashFn(HashContext, Files[Index])) {
+            Index++;
+        } else {
+            Count--;
+            Swap = Files[Index];
+            Files[Index] = Files[Count];
+            Files[Count] = Swap;
+        }
+    }
 
-    YoriLibInitEmptyString(&RelativePathFrom);
+    HashDupSortFiles(Files, Count);
+    return Count;
+}
 
-    SlashesFound = 0;
-    for (Index = FilePath->LengthInChars; Index > 0; Index--) {
-        if (FilePath->StartOfString[Index - 1] == '\\') {
-            SlashesFound++;
-            if (SlashesFound == Depth + 1) {
+/**
+ Display a set of files with identical contents.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Files Pointer to the range of files with identical contents.
+
+ @param Count The number of files in the range.
+ */
+VOID
+HashDupOutputGroup(
+    __in PHASH_CONTEXT HashContext,
+    __in_ecount(Count) PHASH_DUP_FILE *Files,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    YORI_STRING UnescapedPath;
+    PYORI_STRING DisplayPath;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (HashContext->DupGroupsFound > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+    }
+    HashContext->DupGroupsFound++;
+
+    YoriLibInitEmptyString(&UnescapedPath);
+    for (Index = 0; Index < Count; Index++) {
+        DisplayPath = &Files[Index]->FilePath;
+        if (YoriLibUnescapePath(&Files[Index]->FilePath, &UnescapedPath)) {
+            DisplayPath = &UnescapedPath;
+        }
+        HashOutputResult(HashContext, &Files[Index]->FullHash, DisplayPath, 0, 0);
+    }
+    YoriLibFreeStringContents(&UnescapedPath);
+}
+
+/**
+ Display each set of files with identical contents among those found.  Files
+ are sorted by size, and only files sharing a size are hashed.  Within each
+ size, files are compared by a hash of their beginning and end, and only
+ those which still match have their entire contents hashed.
+
+ @param HashContext Pointer to the hash context containing the files found.
+ */
+VOID
+HashDupReport(
+    __in PHASH_CONTEXT HashContext
+    )
+{
+    PHASH_DUP_FILE *Files;
+    YORI_ALLOC_SIZE_T SizeStart;
+    YORI_ALLOC_SIZE_T SizeCount;
+    YORI_ALLOC_SIZE_T SampleStart;
+    YORI_ALLOC_SIZE_T SampleCount;
+    YORI_ALLOC_SIZE_T FullStart;
+    YORI_ALLOC_SIZE_T FullCount;
+    YORI_ALLOC_SIZE_T GroupCount;
+    YORI_ALLOC_SIZE_T Count;
+
+    HashDupSortFiles(HashContext->DupFiles, HashContext->DupFileCount);
+
+    SizeStart = 0;
+    while (SizeStart < HashContext->DupFileCount && !YoriLibIsOperationCancelled()) {
+        Files = &HashContext->DupFiles[SizeStart];
+        for (SizeCount = 1; SizeStart + SizeCount < HashContext->DupFileCount; SizeCount++) {
+            if (Files[SizeCount]->FileSize != Files[0]->FileSize) {
                 break;
             }
         }
-    }
+        SizeStart = SizeStart + SizeCount;
 
-    ASSERT(Index > 0);
-    ASSERT(SlashesFound == Depth + 1);
+        if (SizeCount < 2) {
+            continue;
+        }
 
-    RelativePathFrom.StartOfString = &FilePath->StartOfString[Index];
-    RelativePathFrom.LengthInChars = FilePath->LengthInChars - Index;
+        Count = HashDupHashRange(HashContext, Files, SizeCount, HashDupSampleFile);
+
+        SampleStart = 0;
+        while (SampleStart < Count) {
+            for (SampleCount = 1; SampleStart + SampleCount < Count; SampleCount++) {
+                if (YoriLibCompareString(&Files[SampleStart + SampleCount]->SampleHash, &Files[SampleStart]->SampleHash) != 0) {
+                    break;
+                }
+            }
 
-    FileHandle = CreateFile(FilePath->StartOfString,
-                            GENERIC_READ,
-                            FILE_SHARE_READ | FILE_SHARE_DELETE,
-                            NULL,
-                            OPEN_EXISTING,
-                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
-                            NULL);
+            if (SampleCount >= 2) {
+                FullCount = HashDupHashRange(HashContext, &Files[SampleStart], SampleCount, HashDupHashFile);
 
-    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
-        if (HashContext->SavedErrorThisArg == ERROR_SUCCESS) {
-            DWORD LastError = GetLastError();
-            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: open of %y failed: %s"), FilePath, ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-        }
-        return TRUE;
-    }
+                FullStart = 0;
+                while (FullStart < FullCount) {
+                    for (GroupCount = 1; FullStart + GroupCount < FullCount; GroupCount++) {
+                        if (YoriLibCompareString(&Files[SampleStart + FullStart + GroupCount]->FullHash, &Files[SampleStart + FullStart]->FullHash) != 0) {
+                            break;
+                        }
+                    }
 
-    HashContext->SavedErrorThisArg = ERROR_SUCCESS;
+                    if (GroupCount >= 2) {
+                        HashDupOutputGroup(HashContext, &Files[SampleStart + FullStart], GroupCount);
+                    }
+                    FullStart = FullStart + GroupCount;
+                }
+            }
 
-    if (HashProcessStream(FileHandle, HashContext)) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), &HashContext->HashString, &RelativePathFrom);
+            SampleStart = SampleStart + SampleCount;
+        }
     }
-
-    CloseHandle(FileHandle);
-    return TRUE;
 }
 
-
 /**
  Cleanup any internal allocations within the hash context.  The context
  itself is a stack allocation and is not freed.
@@ -290,18 +1904,33 @@ HashCleanupContext(
     )
 {
     BOOL Result;
+    DWORD Index;
+
+    YoriLibCleanupWorkQueue(&HashContext->WorkQueue);
 
-    if (HashContext->HashBuffer != NULL) {
-        YoriLibFree(HashContext->HashBuffer);
-        HashContext->HashBuffer = NULL;
+    if (HashContext->DupFiles != NULL) {
+        for (Index = 0; Index < HashContext->DupFileCount; Index++) {
+            YoriLibFreeStringContents(&HashContext->DupFiles[Index]->SampleHash);
+            YoriLibFreeStringContents(&HashContext->DupFiles[Index]->FullHash);
+            YoriLibFree(HashContext->DupFiles[Index]);
+        }
+        YoriLibFree(HashContext->DupFiles);
+        HashContext->DupFiles = NULL;
+        HashContext->DupFileCount = 0;
+        HashContext->DupFilesAllocated = 0;
     }
 
-    if (HashContext->ReadBuffer != NULL) {
-        YoriLibFree(HashContext->ReadBuffer);
-        HashContext->ReadBuffer = NULL;
+    if (HashContext->OutputMutex != NULL) {
+        CloseHandle(HashContext->OutputMutex);
+        HashContext->OutputMutex = NULL;
     }
 
-    YoriLibFreeStringContents(&HashContext->HashString);
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (HashContext->BCryptProvider[Index] != NULL) {
+            DllBCrypt.pBCryptCloseAlgorithmProvider(HashContext->BCryptProvider[Index], 0);
+            HashContext->BCryptProvider[Index] = NULL;
+        }
+    }
 
     if (HashContext->Provider != 0) {
         Result = DllAdvApi32.pCryptReleaseContext(HashContext->Provider, 0);
@@ -345,27 +1974,37 @@ CONST HASH_ACQUIRE_CONFIG HashAcquireConfigOptions[] = {
 };
 
 /**
- Allocate any internal allocations within the hash context needed for the
- specified hash algorithm.
+ Load the CryptoAPI provider, if it has not already been loaded.  This is
+ only needed for algorithms that cannot be calculated with BCrypt.
 
- @param HashContext Pointer to the hash context to initialize.
-
- @param Algorithm Specifies a CALG_* algorithm indicating the algorithm to
-        initialize.
+ @param HashContext Pointer to the hash context.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-HashInitializeContext(
-    __in PHASH_CONTEXT HashContext,
-    __in DWORD Algorithm
+HashAcquireCryptoApiProvider(
+    __in PHASH_CONTEXT HashContext
     )
 {
-    DWORD_PTR hHash;
     DWORD LastError;
     LPTSTR ErrText;
     DWORD Index;
-    DWORD HashLength;
+
+    if (HashContext->Provider != 0) {
+        return TRUE;
+    }
+
+    YoriLibLoadAdvApi32Functions();
+    if (DllAdvApi32.pCryptAcquireContextW == NULL ||
+        DllAdvApi32.pCryptCreateHash == NULL ||
+        DllAdvApi32.pCryptDestroyHash == NULL ||
+        DllAdvApi32.pCryptGetHashParam == NULL ||
+        DllAdvApi32.pCryptHashData == NULL ||
+        DllAdvApi32.pCryptReleaseContext == NULL) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: operating system support not present\n"));
+        return FALSE;
+    }
 
     LastError = ERROR_SUCCESS;
 
@@ -409,13 +2048,98 @@ HashInitializeContext(
         ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider not functional: %s\n"), ErrText);
         YoriLibFreeWinErrorText(ErrText);
-        HashCleanupContext(HashContext);
         return FALSE;
     }
 
-    if (!DllAdvApi32.pCryptCreateHash(HashContext->Provider, Algorithm, 0, 0, &hHash)) {
+    return TRUE;
+}
+
+/**
+ Attempt to open an algorithm with BCrypt.  BCrypt is available on Vista and
+ newer, and uses processor hash instructions when they are present.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @return TRUE to indicate the algorithm will be calculated with BCrypt,
+         FALSE if it should be calculated with CryptoAPI.
+ */
+BOOL
+HashOpenBCryptAlgorithm(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index
+    )
+{
+    DWORD HashLength;
+    DWORD ObjectLength;
+    DWORD BytesReturned;
+    PVOID Provider;
+
+    if (HashContext->Algorithm[Index]->BCryptAlgorithm == NULL ||
+        DllBCrypt.pBCryptCloseAlgorithmProvider == NULL ||
+        DllBCrypt.pBCryptCreateHash == NULL ||
+        DllBCrypt.pBCryptDestroyHash == NULL ||
+        DllBCrypt.pBCryptFinishHash == NULL ||
+        DllBCrypt.pBCryptGetProperty == NULL ||
+        DllBCrypt.pBCryptHashData == NULL ||
+        DllBCrypt.pBCryptOpenAlgorithmProvider == NULL) {
+
+        return FALSE;
+    }
+
+    if (DllBCrypt.pBCryptOpenAlgorithmProvider(&Provider, HashContext->Algorithm[Index]->BCryptAlgorithm, MS_PRIMITIVE_PROVIDER, 0) < 0) {
+        return FALSE;
+    }
+
+    if (DllBCrypt.pBCryptGetProperty(Provider, L"HashDigestLength", (PUCHAR)&HashLength, sizeof(HashLength), &BytesReturned, 0) < 0 ||
+        DllBCrypt.pBCryptGetProperty(Provider, L"ObjectLength", (PUCHAR)&ObjectLength, sizeof(ObjectLength), &BytesReturned, 0) < 0) {
+
+        DllBCrypt.pBCryptCloseAlgorithmProvider(Provider, 0);
+        return FALSE;
+    }
+
+    //
+    //  Hash objects for all algorithms are carved from a single allocation,
+    //  so keep each one aligned.
+    //
+
+    ObjectLength = (ObjectLength + 7) & ~(7);
+
+    HashContext->Engine[Index] = HashEngineBCrypt;
+    HashContext->BCryptProvider[Index] = Provider;
+    HashContext->BCryptObjectLength[Index] = ObjectLength;
+    HashContext->BCryptObjectTotalLength = HashContext->BCryptObjectTotalLength + ObjectLength;
+    HashContext->HashLength[Index] = (YORI_ALLOC_SIZE_T)HashLength;
+    return TRUE;
+}
+
+/**
+ Prepare an algorithm to be calculated with CryptoAPI.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Index The index of the algorithm within the hash context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashOpenCryptoApiAlgorithm(
+    __in PHASH_CONTEXT HashContext,
+    __in DWORD Index
+    )
+{
+    DWORD_PTR hHash;
+    DWORD LastError;
+    LPTSTR ErrText;
+    DWORD HashLength;
+
+    if (!HashAcquireCryptoApiProvider(HashContext)) {
+        return FALSE;
+    }
+
+    if (!DllAdvApi32.pCryptCreateHash(HashContext->Provider, HashContext->Algorithm[Index]->CryptAlgorithm, 0, 0, &hHash)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: operating system support not present\n"));
-        HashCleanupContext(HashContext);
         return FALSE;
     }
 
@@ -426,40 +2150,90 @@ HashInitializeContext(
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: could not determine hash length: %s\n"), ErrText);
             YoriLibFreeWinErrorText(ErrText);
             DllAdvApi32.pCryptDestroyHash(hHash);
-            HashCleanupContext(HashContext);
             return FALSE;
         }
     }
 
-    if (!YoriLibIsSizeAllocatable(HashLength)) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: hash length %i too large\n"), HashLength);
-        DllAdvApi32.pCryptDestroyHash(hHash);
-        HashCleanupContext(HashContext);
-        return FALSE;
-    }
-    HashContext->HashLength = (YORI_ALLOC_SIZE_T)HashLength;
-
     DllAdvApi32.pCryptDestroyHash(hHash);
 
-    HashContext->Algorithm = Algorithm;
+    HashContext->Engine[Index] = HashEngineCryptoApi;
+    HashContext->HashLength[Index] = (YORI_ALLOC_SIZE_T)HashLength;
+    return TRUE;
+}
 
-    HashContext->HashBuffer = YoriLibMalloc(HashContext->HashLength);
-    if (HashContext->HashBuffer == NULL) {
-        HashCleanupContext(HashContext);
-        return FALSE;
-    }
+/**
+ Allocate any internal allocations within the hash context needed for the
+ hash algorithms specified in the context.
 
-    if (!YoriLibAllocateString(&HashContext->HashString, HashContext->HashLength * 2 + 1)) {
-        HashCleanupContext(HashContext);
-        return FALSE;
+ @param HashContext Pointer to the hash context to initialize.  On input,
+        this contains the set of algorithms to calculate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashInitializeContext(
+    __in PHASH_CONTEXT HashContext
+    )
+{
+    DWORD Index;
+
+    YoriLibLoadBCryptFunctions();
+
+    //
+    //  Select an implementation for each algorithm, and determine the
+    //  length of each hash and the length of the string needed to display
+    //  all of them.
+    //
+
+    HashContext->HashStringLength = 0;
+    HashContext->BCryptObjectTotalLength = 0;
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (HashContext->Algorithm[Index]->CryptAlgorithm == 0 &&
+            HashContext->Algorithm[Index]->BCryptAlgorithm == NULL) {
+
+            HashContext->Engine[Index] = HashEngineXxHash64;
+            HashContext->HashLength[Index] = sizeof(DWORDLONG);
+
+        } else if (!HashOpenBCryptAlgorithm(HashContext, Index) &&
+                   !HashOpenCryptoApiAlgorithm(HashContext, Index)) {
+
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        if (HashContext->HashLength[Index] > HASH_MAX_LENGTH) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: hash length %i too large\n"), HashContext->HashLength[Index]);
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        HashContext->HashStringLength = HashContext->HashStringLength + HashContext->HashLength[Index] * 2 + 1;
     }
 
-    HashContext->ReadBufferLength = YoriLibMaximumAllocationInRange(60 * 1024, 1024 * 1024);
+    //
+    //  Overlapped reads use two buffers from a single allocation, so each
+    //  buffer can be up to half of the largest allocation.
+    //
 
-    HashContext->ReadBuffer = YoriLibMalloc(HashContext->ReadBufferLength);
-    if (HashContext->ReadBuffer == NULL) {
-        HashCleanupContext(HashContext);
-        return FALSE;
+    HashContext->ReadBufferLength = YoriLibMaximumAllocationInRange(60 * 1024, 2 * 1024 * 1024) / 2;
+
+    //
+    //  If hashing on multiple threads, results are displayed in the order
+    //  files were found, which requires tracking files in progress.
+    //
+
+    YoriLibInitializeListHead(&HashContext->OutputList);
+    if (HashContext->ThreadCount > 1) {
+        HashContext->OutputMutex = CreateMutex(NULL, FALSE, NULL);
+        if (HashContext->OutputMutex == NULL) {
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        if (!YoriLibInitializeWorkQueue(&HashContext->WorkQueue, (YORI_ALLOC_SIZE_T)HashContext->ThreadCount, 0, HashFileWorker, HashContext)) {
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
     }
 
     return TRUE;
@@ -526,6 +2300,276 @@ HashFileEnumerateErrorCallback(
 }
 
 
+/**
+ The prefix of the first line of a manifest, which is followed by the name
+ of the algorithm used to generate it.
+ */
+#define HASH_MANIFEST_HEADER _T("# hash ")
+
+/**
+ Split the next space delimited field from a manifest line.
+
+ @param Line Pointer to the remaining portion of the line.  On successful
+        completion, this is updated to refer to the text following the
+        field and its delimiter.
+
+ @param Field On successful completion, updated to refer to the field.
+
+ @return TRUE to indicate a field was found, FALSE if the line has no more
+         delimited fields.
+ */
+BOOL
+HashGetManifestField(
+    __inout PYORI_STRING Line,
+    __out PYORI_STRING Field
+    )
+{
+    LPTSTR Space;
+
+    Space = YoriLibFindLeftMostCharacter(Line, ' ');
+    if (Space == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Field);
+    Field->StartOfString = Line->StartOfString;
+    Field->LengthInChars = (YORI_ALLOC_SIZE_T)(Space - Line->StartOfString);
+
+    Line->StartOfString = Space + 1;
+    Line->LengthInChars = Line->LengthInChars - Field->LengthInChars - 1;
+    return TRUE;
+}
+
+/**
+ Verify a single entry from a manifest.  If the file's size and timestamp
+ match the manifest, it is assumed to be unchanged unless the user requested
+ every file be hashed.
+
+ @param HashContext Pointer to the hash context.
+
+ @param Line Pointer to the manifest line, containing the hash, size,
+        timestamp and path of the file.
+
+ @return TRUE if the line was well formed, FALSE if it was not.
+ */
+BOOL
+HashVerifyManifestEntry(
+    __in PHASH_CONTEXT HashContext,
+    __in PYORI_STRING Line
+    )
+{
+    YORI_STRING Remaining;
+    YORI_STRING ExpectedHash;
+    YORI_STRING Field;
+    YORI_STRING FullPath;
+    YORI_STRING HashString;
+    YORI_MAX_SIGNED_T ExpectedSize;
+    YORI_MAX_SIGNED_T ExpectedTime;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    DWORDLONG FileSize;
+    DWORDLONG LastWriteTime;
+    HANDLE FileHandle;
+
+    YoriLibInitEmptyString(&Remaining);
+    Remaining.StartOfString = Line->StartOfString;
+    Remaining.LengthInChars = Line->LengthInChars;
+
+    if (!HashGetManifestField(&Remaining, &ExpectedHash)) {
+        return FALSE;
+    }
+
+    if (!HashGetManifestField(&Remaining, &Field) ||
+        !YoriLibStringToNumberSpecifyBase(&Field, 10, FALSE, &ExpectedSize, &CharsConsumed) ||
+        CharsConsumed != Field.LengthInChars) {
+
+        return FALSE;
+    }
+
+    if (!HashGetManifestField(&Remaining, &Field) ||
+        !YoriLibStringToNumberSpecifyBase(&Field, 16, FALSE, &ExpectedTime, &CharsConsumed) ||
+        CharsConsumed != Field.LengthInChars ||
+        Remaining.LengthInChars == 0) {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FullPath);
+    if (!YoriLibUserStringToSingleFilePath(&Remaining, TRUE, &FullPath)) {
+        return FALSE;
+    }
+
+    FileHandle = HashOpenFile(&FullPath);
+    YoriLibFreeStringContents(&FullPath);
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        HashContext->FilesMissing++;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("MISSING %y\n"), &Remaining);
+        return TRUE;
+    }
+
+    HashContext->FilesFound++;
+
+    if (!HashContext->ForceVerify &&
+        HashGetFileSizeAndTime(FileHandle, &FileSize, &LastWriteTime) &&
+        FileSize == (DWORDLONG)ExpectedSize &&
+        LastWriteTime == (DWORDLONG)ExpectedTime) {
+
+        HashContext->FilesUnchanged++;
+        CloseHandle(FileHandle);
+        return TRUE;
+    }
+
+    if (HashProcessStream(FileHandle, TRUE, HashContext, &HashString) &&
+        YoriLibCompareStringInsensitive(&HashString, &ExpectedHash) == 0) {
+
+        HashContext->FilesVerified++;
+    } else {
+        HashContext->FilesFailed++;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("FAILED %y\n"), &Remaining);
+    }
+
+    YoriLibFreeStringContents(&HashString);
+    CloseHandle(FileHandle);
+    return TRUE;
+}
+
+/**
+ Verify the files described by a manifest.  The manifest indicates the
+ algorithm used to generate it, which is used unless the user specified an
+ algorithm explicitly.
+
+ @param HashContext Pointer to the hash context.  The context is initialized
+        by this function.
+
+ @param ManifestName Pointer to the name of the manifest as specified by the
+        user.
+
+ @return TRUE if every file in the manifest matched, FALSE if any did not
+         or the manifest could not be processed.
+ */
+BOOL
+HashVerifyManifest(
+    __in PHASH_CONTEXT HashContext,
+    __in PYORI_STRING ManifestName
+    )
+{
+    YORI_STRING FullPath;
+    YORI_STRING LineString;
+    YORI_STRING AlgorithmName;
+    YORI_STRING Header;
+    PVOID LineContext;
+    HANDLE hManifest;
+    DWORD Index;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&FullPath);
+    if (!YoriLibUserStringToSingleFilePath(ManifestName, TRUE, &FullPath)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: could not resolve %y\n"), ManifestName);
+        return FALSE;
+    }
+
+    hManifest = CreateFile(FullPath.StartOfString,
+                           GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                           NULL);
+
+    if (hManifest == INVALID_HANDLE_VALUE) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: open of %y failed: %s"), &FullPath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFreeStringContents(&FullPath);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&FullPath);
+    YoriLibInitEmptyString(&LineString);
+    LineContext = NULL;
+    Result = FALSE;
+
+    //
+    //  The first line indicates the algorithm.
+    //
+
+    YoriLibConstantString(&Header, HASH_MANIFEST_HEADER);
+    if (!YoriLibReadLineToString(&LineString, &LineContext, hManifest) ||
+        YoriLibCompareStringCount(&LineString, &Header, Header.LengthInChars) != 0) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: %y is not a manifest\n"), ManifestName);
+        goto Exit;
+    }
+
+    YoriLibInitEmptyString(&AlgorithmName);
+    AlgorithmName.StartOfString = &LineString.StartOfString[Header.LengthInChars];
+    AlgorithmName.LengthInChars = LineString.LengthInChars - Header.LengthInChars;
+
+    for (Index = 0; Index < sizeof(HashAlgorithms)/sizeof(HashAlgorithms[0]); Index++) {
+        if (YoriLibCompareStringWithLiteralInsensitive(&AlgorithmName, HashAlgorithms[Index].Name) == 0) {
+            break;
+        }
+    }
+
+    if (Index == sizeof(HashAlgorithms)/sizeof(HashAlgorithms[0])) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: manifest algorithm %y not recognized\n"), &AlgorithmName);
+        goto Exit;
+    }
+
+    if (HashContext->AlgorithmCount == 0) {
+        HashContext->Algorithm[0] = &HashAlgorithms[Index];
+        HashContext->AlgorithmCount = 1;
+    } else if (HashContext->AlgorithmCount > 1 || HashContext->Algorithm[0] != &HashAlgorithms[Index]) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: manifest was generated with %y\n"), &AlgorithmName);
+        goto Exit;
+    }
+
+    //
+    //  Verification hashes files as they are read from the manifest, so
+    //  doesn't use background threads.
+    //
+
+    HashContext->ThreadCount = 0;
+    if (!HashInitializeContext(HashContext)) {
+        goto Exit;
+    }
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hManifest)) {
+            break;
+        }
+
+        if (LineString.LengthInChars == 0) {
+            continue;
+        }
+
+        if (!HashVerifyManifestEntry(HashContext, &LineString)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: manifest line not understood, ignored: %y\n"), &LineString);
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%lli verified, %lli unchanged, %lli failed, %lli missing\n"),
+                  HashContext->FilesVerified,
+                  HashContext->FilesUnchanged,
+                  HashContext->FilesFailed,
+                  HashContext->FilesMissing);
+
+    if (HashContext->FilesFailed == 0 && HashContext->FilesMissing == 0) {
+        Result = TRUE;
+    }
+
+Exit:
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hManifest);
+    return Result;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the hash builtin command.
@@ -561,7 +2605,11 @@ ENTRYPOINT(
     BOOLEAN BasicEnumeration = FALSE;
     HASH_CONTEXT HashContext;
     YORI_STRING Arg;
-    DWORD Algorithm = CALG_SHA1;
+    YORI_STRING HashString;
+    PYORI_STRING ManifestToVerify = NULL;
+    LONGLONG llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    DWORD Index;
 
     ZeroMemory(&HashContext, sizeof(HashContext));
 
@@ -580,38 +2628,53 @@ ENTRYPOINT(
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
                 if (i + 1 < ArgC) {
-                    if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("MD4")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_MD4;
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("MD5")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_MD5;
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA1")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_SHA1;
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA256")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_SHA_256;
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA384")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_SHA_384;
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA512")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = CALG_SHA_512;
-                    } else {
-                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm not recognized.  Supported algorithms are MD4, MD5, SHA1, SHA256, SHA384, and SHA512\n"));
+                    for (Index = 0; Index < sizeof(HashAlgorithms)/sizeof(HashAlgorithms[0]); Index++) {
+                        if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], HashAlgorithms[Index].Name) == 0) {
+                            break;
+                        }
+                    }
+
+                    if (Index == sizeof(HashAlgorithms)/sizeof(HashAlgorithms[0])) {
+                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm not recognized.  Supported algorithms are MD4, MD5, SHA1, SHA256, SHA384, SHA512, and XXH64\n"));
+                        return EXIT_FAILURE;
+                    }
+
+                    if (HashContext.AlgorithmCount >= HASH_MAX_ALGORITHMS) {
+                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: too many algorithms specified\n"));
                         return EXIT_FAILURE;
                     }
+
+                    HashContext.Algorithm[HashContext.AlgorithmCount] = &HashAlgorithms[Index];
+                    HashContext.AlgorithmCount++;
+                    ArgumentUnderstood = TRUE;
+                    i++;
                 }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
+                if (i + 1 < ArgC) {
+                    ManifestToVerify = &ArgV[i + 1];
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
+                HashContext.FindDuplicates = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("f")) == 0) {
+                HashContext.ForceVerify = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        HashContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                HashContext.ManifestOutput = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 HashContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -631,19 +2694,58 @@ ENTRYPOINT(
         }
     }
 
-    YoriLibLoadAdvApi32Functions();
-    if (DllAdvApi32.pCryptAcquireContextW == NULL ||
-        DllAdvApi32.pCryptCreateHash == NULL ||
-        DllAdvApi32.pCryptDestroyHash == NULL ||
-        DllAdvApi32.pCryptGetHashParam == NULL ||
-        DllAdvApi32.pCryptHashData == NULL ||
-        DllAdvApi32.pCryptReleaseContext == NULL) {
+    //
+    //  Attempt to enable backup privilege so an administrator can access more
+    //  objects successfully.
+    //
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: operating system support not present\n"));
+    YoriLibEnableBackupPrivilege();
+
+    if (ManifestToVerify != NULL) {
+#if YORI_BUILTIN
+        YoriLibCancelEnable(FALSE);
+#endif
+        if (!HashVerifyManifest(&HashContext, ManifestToVerify)) {
+            HashCleanupContext(&HashContext);
+            return EXIT_FAILURE;
+        }
+        HashCleanupContext(&HashContext);
+        return EXIT_SUCCESS;
+    }
+
+    if (HashContext.AlgorithmCount == 0) {
+        HashContext.Algorithm[0] = &HashAlgorithms[HASH_DEFAULT_ALGORITHM];
+        HashContext.AlgorithmCount = 1;
+    }
+
+    //
+    //  A manifest records one hash per file so it can be verified later.
+    //
+
+    if (HashContext.ManifestOutput && HashContext.AlgorithmCount > 1) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: a manifest can only contain one algorithm\n"));
         return EXIT_FAILURE;
     }
 
-    if (!HashInitializeContext(&HashContext, Algorithm)) {
+    //
+    //  Duplicates are found by hashing only the files that need it after
+    //  all files have been found, so files are not hashed on background
+    //  threads as they are found.
+    //
+
+    if (HashContext.FindDuplicates) {
+        if (HashContext.ManifestOutput) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: a manifest cannot be generated when finding duplicates\n"));
+            return EXIT_FAILURE;
+        }
+        if (StartArg == 0 || StartArg == ArgC) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: no files specified to find duplicates\n"));
+            return EXIT_FAILURE;
+        }
+        HashContext.ThreadCount = 0;
+    }
+
+    if (!HashInitializeContext(&HashContext)) {
         return EXIT_FAILURE;
     }
 
@@ -651,13 +2753,6 @@ ENTRYPOINT(
     YoriLibCancelEnable(FALSE);
 #endif
 
-    //
-    //  Attempt to enable backup privilege so an administrator can access more
-    //  objects successfully.
-    //
-
-    YoriLibEnableBackupPrivilege();
-
     //
     //  If no file name is specified, use stdin; otherwise open
     //  the file and use that
@@ -670,18 +2765,27 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        if (!HashProcessStream(GetStdHandle(STD_INPUT_HANDLE), &HashContext)) {
+        HashContext.FilesFound++;
+        if (!HashProcessStream(GetStdHandle(STD_INPUT_HANDLE), FALSE, &HashContext, &HashString)) {
             HashCleanupContext(&HashContext);
             return EXIT_FAILURE;
         }
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &HashContext.HashString);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &HashString);
+        YoriLibFreeStringContents(&HashString);
     } else {
-        MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
+        MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS | YORILIB_FILEENUM_NO_SHORT_NAMES;
         if (BasicEnumeration) {
             MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
         }
         if (HashContext.Recursive) {
             MatchFlags |= YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_PRESERVE_WILD;
+            if (HashContext.FindDuplicates) {
+                MatchFlags |= YORILIB_FILEENUM_PARALLEL;
+            }
+        }
+
+        if (HashContext.ManifestOutput) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s%s\n"), HASH_MANIFEST_HEADER, HashContext.Algorithm[0]->Name);
         }
 
         for (i = StartArg; i < ArgC; i++) {
@@ -689,18 +2793,31 @@ ENTRYPOINT(
             HashContext.FilesFoundThisArg = 0;
             HashContext.SavedErrorThisArg = ERROR_SUCCESS;
 
-            YoriLibForEachStream(&ArgV[i],
-                                 MatchFlags,
-                                 0,
-                                 HashFileFoundCallback,
-                                 HashFileEnumerateErrorCallback,
-                                 &HashContext);
+            if (HashContext.FindDuplicates) {
+                YoriLibForEachFile(&ArgV[i],
+                                   MatchFlags,
+                                   0,
+                                   HashDupFileFoundCallback,
+                                   HashFileEnumerateErrorCallback,
+                                   &HashContext);
+            } else {
+                YoriLibForEachStream(&ArgV[i],
+                                     MatchFlags,
+                                     0,
+                                     HashFileFoundCallback,
+                                     HashFileEnumerateErrorCallback,
+                                     &HashContext);
+            }
 
             if (HashContext.FilesFoundThisArg == 0) {
                 YORI_STRING FullPath;
                 YoriLibInitEmptyString(&FullPath);
                 if (YoriLibUserStringToSingleFilePath(&ArgV[i], TRUE, &FullPath)) {
-                    HashFileFoundCallback(&FullPath, NULL, 0, &HashContext);
+                    if (HashContext.FindDuplicates) {
+                        HashDupFileFoundCallback(&FullPath, NULL, 0, &HashContext);
+                    } else {
+                        HashFileFoundCallback(&FullPath, NULL, 0, &HashContext);
+                    }
                     YoriLibFreeStringContents(&FullPath);
                 }
                 if (HashContext.SavedErrorThisArg != ERROR_SUCCESS) {
@@ -708,6 +2825,14 @@ ENTRYPOINT(
                 }
             }
         }
+
+        if (HashContext.ThreadCount > 1) {
+            YoriLibWaitForWorkQueue(&HashContext.WorkQueue);
+        }
+
+        if (HashContext.FindDuplicates) {
+            HashDupReport(&HashContext);
+        }
     }
 
     HashCleanupContext(&HashContext);
@@ -133,6 +133,7 @@ CHAR strHelpHelpText3[] =
         "INITOOL   Query or set values in INI files\n"
         "INTCMP    Compare two integer values\n"
         "JOB       Displays or updates background job status\n"
+        "JOBPOOL   Runs background jobs with a limit on how many execute at once\n"
         "KILL      Terminate one or more processes\n"
         "LINES     Count the number of lines in one or more files\n"
         "LSOF      Display which processes have a file in use\n"
@@ -37,12 +37,13 @@ CHAR strHexDumpHelpText[] =
         "\n"
         "Output the contents of one or more files in hex.\n"
         "\n"
-        "HEXDUMP [-license] [-b] [-d] [-g1|-g2|-g4|-g8|-i] [-hc] [-ho]\n"
+        "HEXDUMP [-license] [-b] [-d|-ds] [-g1|-g2|-g4|-g8|-i] [-hc] [-ho]\n"
         "        [-l length] [-o offset] [-bin|-r] [-s] [-w] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -bin           Process a stream of hex back into binary\n"
         "   -d             Display the differences between two files\n"
+        "   -ds            Display the ranges of offsets that differ between two files\n"
         "   -g             Number of bytes per display group\n"
         "   -hc            Hide character display\n"
         "   -ho            Hide offset within buffer\n"
@@ -132,6 +133,12 @@ typedef struct _HEXDUMP_CONTEXT {
      */
     BOOLEAN Recursive;
 
+    /**
+     If TRUE, when comparing two files, display the ranges of offsets that
+     differ rather than the differing data.
+     */
+    BOOLEAN DiffSummary;
+
 } HEXDUMP_CONTEXT, *PHEXDUMP_CONTEXT;
 
 /**
@@ -1015,6 +1022,278 @@ HexDumpBinaryProcessStream(
     return TRUE;
 }
 
+/**
+ The maximum number of bytes to read from a stream and format as a single
+ block.  Formatting a large block allows the output to be written with a
+ small number of large writes.
+ */
+#define HEXDUMP_BLOCK_SIZE (512 * 1024)
+
+/**
+ The minimum number of bytes to format on a single thread.  Below this, the
+ cost of handing the work to another thread is not worthwhile.
+ */
+#define HEXDUMP_MIN_CHUNK_SIZE (32 * 1024)
+
+/**
+ The maximum number of chunks that a single block is divided into.
+ */
+#define HEXDUMP_MAX_CHUNKS (HEXDUMP_BLOCK_SIZE / HEXDUMP_MIN_CHUNK_SIZE)
+
+/**
+ A part of a block of data which is formatted into text by a single thread.
+ */
+typedef struct _HEXDUMP_FORMAT_CHUNK {
+
+    /**
+     The work item used to format this chunk on a worker thread.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     Pointer to the data to format.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The offset of the data within the stream, used for display.
+     */
+    LONGLONG StartOfBufferOffset;
+
+    /**
+     The number of bytes to format.
+     */
+    YORI_ALLOC_SIZE_T BufferLength;
+
+    /**
+     TRUE if another chunk in the same block follows this one.
+     */
+    BOOLEAN MoreFollowing;
+
+    /**
+     Set to TRUE once the chunk has been formatted successfully.
+     */
+    BOOLEAN Succeeded;
+
+    /**
+     The text generated for this chunk.  This is retained and reused for
+     each block.
+     */
+    YORI_STRING Output;
+} HEXDUMP_FORMAT_CHUNK, *PHEXDUMP_FORMAT_CHUNK;
+
+/**
+ State used to format blocks of a stream, dividing each block across
+ multiple threads.
+ */
+typedef struct _HEXDUMP_FORMATTER {
+
+    /**
+     The work queue used to format chunks on other threads.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     TRUE if WorkQueue was initialized successfully and can be used.  If
+     FALSE, all chunks are formatted on the current thread.
+     */
+    BOOL QueueActive;
+
+    /**
+     The number of bytes to display per group.
+     */
+    DWORD BytesPerWord;
+
+    /**
+     Flags describing the format of the output.
+     */
+    DWORD DumpFlags;
+
+    /**
+     The chunks that each block is divided into.
+     */
+    HEXDUMP_FORMAT_CHUNK Chunks[HEXDUMP_MAX_CHUNKS];
+} HEXDUMP_FORMATTER, *PHEXDUMP_FORMATTER;
+
+/**
+ Format a single chunk of a block into text.  This may be invoked on a worker
+ thread or on the main thread.
+
+ @param Context Pointer to the formatter.
+
+ @param Item Pointer to the work item within the chunk to format.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the chunk
+        should not be formatted.
+ */
+VOID
+HexDumpFormatChunkWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PHEXDUMP_FORMATTER Formatter;
+    PHEXDUMP_FORMAT_CHUNK Chunk;
+
+    Formatter = (PHEXDUMP_FORMATTER)Context;
+    Chunk = CONTAINING_RECORD(Item, HEXDUMP_FORMAT_CHUNK, WorkItem);
+
+    Chunk->Output.LengthInChars = 0;
+    Chunk->Succeeded = FALSE;
+    if (Cancelled) {
+        return;
+    }
+
+    if (YoriLibHexDumpToString((LPCSTR)Chunk->Buffer, Chunk->StartOfBufferOffset, Chunk->BufferLength, Formatter->BytesPerWord, Formatter->DumpFlags, Chunk->MoreFollowing, &Chunk->Output)) {
+        Chunk->Succeeded = TRUE;
+    }
+}
+
+/**
+ Prepare a formatter for use.
+
+ @param Formatter Pointer to the formatter to initialize.
+
+ @param BytesPerWord The number of bytes to display per group.
+
+ @param DumpFlags Flags describing the format of the output.
+ */
+VOID
+HexDumpInitializeFormatter(
+    __out PHEXDUMP_FORMATTER Formatter,
+    __in DWORD BytesPerWord,
+    __in DWORD DumpFlags
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    ZeroMemory(Formatter, sizeof(HEXDUMP_FORMATTER));
+    Formatter->BytesPerWord = BytesPerWord;
+    Formatter->DumpFlags = DumpFlags;
+    for (Index = 0; Index < HEXDUMP_MAX_CHUNKS; Index++) {
+        YoriLibInitEmptyString(&Formatter->Chunks[Index].Output);
+    }
+
+    Formatter->QueueActive = YoriLibInitializeWorkQueue(&Formatter->WorkQueue, 0, HEXDUMP_MAX_CHUNKS, HexDumpFormatChunkWorker, Formatter);
+}
+
+/**
+ Free the work queue and buffers used by a formatter.
+
+ @param Formatter Pointer to the formatter to clean up.
+ */
+VOID
+HexDumpCleanupFormatter(
+    __inout PHEXDUMP_FORMATTER Formatter
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriLibCleanupWorkQueue(&Formatter->WorkQueue);
+    for (Index = 0; Index < HEXDUMP_MAX_CHUNKS; Index++) {
+        YoriLibFreeStringContents(&Formatter->Chunks[Index].Output);
+    }
+}
+
+/**
+ Format a block of data and write it to standard output.  The block is
+ divided into chunks on line boundaries, each chunk is formatted into its
+ own buffer, potentially concurrently, and the buffers are written in
+ order.
+
+ @param Formatter Pointer to the formatter.
+
+ @param Buffer Pointer to the data to display.
+
+ @param StartOfBufferOffset The offset of the data within the stream, used
+        for display.
+
+ @param BufferLength The number of bytes to display.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HexDumpFormatAndOutput(
+    __inout PHEXDUMP_FORMATTER Formatter,
+    __in PUCHAR Buffer,
+    __in LONGLONG StartOfBufferOffset,
+    __in YORI_ALLOC_SIZE_T BufferLength
+    )
+{
+    PHEXDUMP_FORMAT_CHUNK Chunk;
+    YORI_ALLOC_SIZE_T ChunkCount;
+    YORI_ALLOC_SIZE_T ChunkLength;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Offset;
+    BOOLEAN ItemsQueued;
+    HANDLE hOut;
+
+    ChunkCount = BufferLength / HEXDUMP_MIN_CHUNK_SIZE;
+    if (ChunkCount == 0 || !Formatter->QueueActive) {
+        ChunkCount = 1;
+    }
+    if (ChunkCount > HEXDUMP_MAX_CHUNKS) {
+        ChunkCount = HEXDUMP_MAX_CHUNKS;
+    }
+
+    //
+    //  Each chunk other than the last must contain complete lines so that
+    //  the offsets displayed by each are correct.
+    //
+
+    ChunkLength = BufferLength / ChunkCount;
+    ChunkLength = ChunkLength - (ChunkLength % YORI_LIB_HEXDUMP_BYTES_PER_LINE);
+
+    Offset = 0;
+    for (Index = 0; Index < ChunkCount; Index++) {
+        Chunk = &Formatter->Chunks[Index];
+        Chunk->Buffer = &Buffer[Offset];
+        Chunk->StartOfBufferOffset = StartOfBufferOffset + Offset;
+        if (Index + 1 == ChunkCount) {
+            Chunk->BufferLength = BufferLength - Offset;
+            Chunk->MoreFollowing = FALSE;
+        } else {
+            Chunk->BufferLength = ChunkLength;
+            Chunk->MoreFollowing = TRUE;
+        }
+        Offset = Offset + Chunk->BufferLength;
+    }
+
+    //
+    //  Hand all but the first chunk to worker threads, and format the first
+    //  chunk here.  Any chunk that cannot be queued is formatted here too.
+    //
+
+    ItemsQueued = FALSE;
+    for (Index = 1; Index < ChunkCount; Index++) {
+        Chunk = &Formatter->Chunks[Index];
+        if (YoriLibQueueWorkItem(&Formatter->WorkQueue, &Chunk->WorkItem, TRUE)) {
+            ItemsQueued = TRUE;
+        } else {
+            HexDumpFormatChunkWorker(Formatter, &Chunk->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+        }
+    }
+
+    HexDumpFormatChunkWorker(Formatter, &Formatter->Chunks[0].WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+
+    if (ItemsQueued) {
+        if (!YoriLibWaitForWorkQueue(&Formatter->WorkQueue)) {
+            return FALSE;
+        }
+    }
+
+    hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    for (Index = 0; Index < ChunkCount; Index++) {
+        Chunk = &Formatter->Chunks[Index];
+        if (!Chunk->Succeeded) {
+            return FALSE;
+        }
+        YoriLibOutputString(hOut, 0, &Chunk->Output);
+    }
+
+    return TRUE;
+}
 
 /**
  Process a single opened stream, enumerating through all lines and displaying
@@ -1044,11 +1323,12 @@ HexDumpProcessStream(
     DWORD SectorSize;
     LARGE_INTEGER StreamOffset;
     BOOLEAN LimitDisplayToEvenLine;
+    HEXDUMP_FORMATTER Formatter;
 
     HexDumpContext->FilesFound++;
     HexDumpContext->FilesFoundThisArg++;
 
-    BufferSize = YoriLibMaximumAllocationInRange(16 * 1024, 64 * 1024);
+    BufferSize = YoriLibMaximumAllocationInRange(16 * 1024, HEXDUMP_BLOCK_SIZE);
     Buffer = YoriLibMalloc(BufferSize);
     if (Buffer == NULL) {
         return FALSE;
@@ -1069,6 +1349,8 @@ HexDumpProcessStream(
         DisplayFlags |= YORI_LIB_HEX_FLAG_C_STYLE;
     }
 
+    HexDumpInitializeFormatter(&Formatter, HexDumpContext->BytesPerGroup, DisplayFlags);
+
     //
     //  If it's a file, start at the offset requested by the user.  If it's
     //  not a file (it's a pipe), the only way to move forward is by
@@ -1183,7 +1465,7 @@ HexDumpProcessStream(
         //
 
         if (LengthToDisplay > 0) {
-            if (!YoriLibHexDump((LPCSTR)&Buffer[BufferDisplayOffset], StreamOffset.QuadPart + BufferDisplayOffset, LengthToDisplay, HexDumpContext->BytesPerGroup, DisplayFlags)) {
+            if (!HexDumpFormatAndOutput(&Formatter, &Buffer[BufferDisplayOffset], StreamOffset.QuadPart + BufferDisplayOffset, LengthToDisplay)) {
                 break;
             }
         }
@@ -1215,6 +1497,7 @@ HexDumpProcessStream(
         }
     }
 
+    HexDumpCleanupFormatter(&Formatter);
     YoriLibFree(Buffer);
 
     return TRUE;
@@ -1480,6 +1763,118 @@ typedef struct _HEXDUMP_ONE_OBJECT {
     YORI_ALLOC_SIZE_T DisplayLength;
 } HEXDUMP_ONE_OBJECT, *PHEXDUMP_ONE_OBJECT;
 
+/**
+ The number of bytes to compare between two files before examining
+ individual lines.  Regions of this size which are identical are skipped
+ without any per line processing.  This must be a multiple of
+ YORI_LIB_HEXDUMP_BYTES_PER_LINE.
+ */
+#define HEXDUMP_DIFF_COMPARE_SIZE (64 * 1024)
+
+/**
+ A range of offsets which differ between two files, used when displaying a
+ summary of differences.
+ */
+typedef struct _HEXDUMP_DIFF_RANGE {
+
+    /**
+     The offset of the first differing byte in the range.
+     */
+    LONGLONG StartOffset;
+
+    /**
+     The offset immediately following the last differing byte in the range.
+     */
+    LONGLONG EndOffset;
+
+    /**
+     TRUE if a range has been found and not yet displayed.
+     */
+    BOOLEAN RangeActive;
+} HEXDUMP_DIFF_RANGE, *PHEXDUMP_DIFF_RANGE;
+
+/**
+ Display a range of differing offsets, if one has been found.
+
+ @param Range Pointer to the range to display.  On return, no range is
+        active.
+ */
+VOID
+HexDumpDiffFlushRange(
+    __inout PHEXDUMP_DIFF_RANGE Range
+    )
+{
+    LONGLONG LastOffset;
+
+    if (!Range->RangeActive) {
+        return;
+    }
+
+    LastOffset = Range->EndOffset - 1;
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%08x`%08x-%08x`%08x (%lli bytes)\n"),
+                  (DWORD)(Range->StartOffset >> 32),
+                  (DWORD)Range->StartOffset,
+                  (DWORD)(LastOffset >> 32),
+                  (DWORD)LastOffset,
+                  Range->EndOffset - Range->StartOffset);
+    Range->RangeActive = FALSE;
+}
+
+/**
+ Record the bytes which differ within a line that is known to contain a
+ difference.  Differing bytes which follow the current range extend it;
+ otherwise the current range is displayed and a new one started.
+
+ @param Range Pointer to the range of differences found so far.
+
+ @param LineOffset The offset of the line within the files.
+
+ @param Buffer1 Pointer to the line from the first file.
+
+ @param Buffer1Length The number of bytes available from the first file.
+
+ @param Buffer2 Pointer to the line from the second file.
+
+ @param Buffer2Length The number of bytes available from the second file.
+
+ @param LineLength The number of bytes in the line.  Bytes beyond the end
+        of either buffer are treated as differences.
+ */
+VOID
+HexDumpDiffRecordLine(
+    __inout PHEXDUMP_DIFF_RANGE Range,
+    __in LONGLONG LineOffset,
+    __in PUCHAR Buffer1,
+    __in YORI_ALLOC_SIZE_T Buffer1Length,
+    __in PUCHAR Buffer2,
+    __in YORI_ALLOC_SIZE_T Buffer2Length,
+    __in YORI_ALLOC_SIZE_T LineLength
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    LONGLONG ByteOffset;
+
+    for (Index = 0; Index < LineLength; Index++) {
+        if (Index < Buffer1Length &&
+            Index < Buffer2Length &&
+            Buffer1[Index] == Buffer2[Index]) {
+
+            continue;
+        }
+
+        ByteOffset = LineOffset + Index;
+        if (Range->RangeActive && Range->EndOffset == ByteOffset) {
+            Range->EndOffset++;
+        } else {
+            HexDumpDiffFlushRange(Range);
+            Range->StartOffset = ByteOffset;
+            Range->EndOffset = ByteOffset + 1;
+            Range->RangeActive = TRUE;
+        }
+    }
+}
+
 /**
  Display the differences between two files in hex form.
 
@@ -1503,13 +1898,15 @@ HexDumpDisplayDiff(
     YORI_ALLOC_SIZE_T BufferOffset;
     YORI_ALLOC_SIZE_T LengthToDisplay;
     YORI_ALLOC_SIZE_T LengthThisLine;
+    YORI_ALLOC_SIZE_T BlockEnd;
     DWORD DisplayFlags;
     LARGE_INTEGER StreamOffset;
     DWORD Count;
     BOOL Result = FALSE;
     BOOL LineDifference;
+    HEXDUMP_DIFF_RANGE DiffRange;
 
-    BufferSize = YoriLibMaximumAllocationInRange(16 * 1024, 64 * 1024);
+    BufferSize = YoriLibMaximumAllocationInRange(16 * 1024, 16 * HEXDUMP_DIFF_COMPARE_SIZE);
     DisplayFlags = 0;
     if (!HexDumpContext->HideOffset) {
         DisplayFlags |= YORI_LIB_HEX_FLAG_DISPLAY_LARGE_OFFSET;
@@ -1524,6 +1921,7 @@ HexDumpDisplayDiff(
     StreamOffset.QuadPart = HexDumpContext->OffsetToDisplay;
 
     ZeroMemory(Objects, sizeof(Objects));
+    ZeroMemory(&DiffRange, sizeof(DiffRange));
 
     for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
 
@@ -1641,57 +2039,95 @@ HexDumpDisplayDiff(
         while(BufferOffset < LengthToDisplay) {
 
             //
-            //  Check each line to see if it's different
+            //  Compare a large region at a time, and if it is identical in
+            //  both files, skip it without examining each line.  Typically
+            //  files being compared are mostly identical, so most data is
+            //  only processed here.
             //
 
-            LineDifference = FALSE;
-            if (LengthToDisplay - BufferOffset >= 16) {
-                LengthThisLine = 16;
-            } else {
-                LengthThisLine = LengthToDisplay - BufferOffset;
+            BlockEnd = LengthToDisplay;
+            if (BlockEnd - BufferOffset > HEXDUMP_DIFF_COMPARE_SIZE) {
+                BlockEnd = BufferOffset + HEXDUMP_DIFF_COMPARE_SIZE;
             }
-            for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
-                Objects[Count].DisplayLength = LengthThisLine;
-                if (BufferOffset + LengthThisLine > (YORI_ALLOC_SIZE_T)Objects[Count].BytesReturned) {
-                    LineDifference = TRUE;
-                    Objects[Count].DisplayLength = 0;
-                    if (Objects[Count].BytesReturned > BufferOffset) {
-                        Objects[Count].DisplayLength = (YORI_ALLOC_SIZE_T)Objects[0].BytesReturned - BufferOffset;
+
+            if (BlockEnd <= (YORI_ALLOC_SIZE_T)Objects[0].BytesReturned &&
+                BlockEnd <= (YORI_ALLOC_SIZE_T)Objects[1].BytesReturned &&
+                memcmp(&Objects[0].Buffer[BufferOffset], &Objects[1].Buffer[BufferOffset], BlockEnd - BufferOffset) == 0) {
+
+                BufferOffset = BlockEnd;
+                continue;
+            }
+
+            while(BufferOffset < BlockEnd) {
+
+                //
+                //  Check each line to see if it's different
+                //
+
+                LineDifference = FALSE;
+                if (BlockEnd - BufferOffset >= YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
+                    LengthThisLine = YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+                } else {
+                    LengthThisLine = BlockEnd - BufferOffset;
+                }
+                for (Count = 0; Count < sizeof(Objects)/sizeof(Objects[0]); Count++) {
+                    Objects[Count].DisplayLength = LengthThisLine;
+                    if (BufferOffset + LengthThisLine > (YORI_ALLOC_SIZE_T)Objects[Count].BytesReturned) {
+                        LineDifference = TRUE;
+                        Objects[Count].DisplayLength = 0;
+                        if (Objects[Count].BytesReturned > BufferOffset) {
+                            Objects[Count].DisplayLength = (YORI_ALLOC_SIZE_T)Objects[Count].BytesReturned - BufferOffset;
+                        }
                     }
                 }
-            }
 
-            if (!LineDifference &&
-                memcmp(&Objects[0].Buffer[BufferOffset], &Objects[1].Buffer[BufferOffset], LengthThisLine) != 0) {
-                LineDifference = TRUE;
-            }
+                if (!LineDifference &&
+                    memcmp(&Objects[0].Buffer[BufferOffset], &Objects[1].Buffer[BufferOffset], LengthThisLine) != 0) {
+                    LineDifference = TRUE;
+                }
 
-            //
-            //  If it's different, display it
-            //
+                //
+                //  If it's different, display it or record the range
+                //
 
-            if (LineDifference) {
-                if (!YoriLibHexDiff(StreamOffset.QuadPart + BufferOffset,
-                                    (LPCSTR)&Objects[0].Buffer[BufferOffset],
-                                    Objects[0].DisplayLength,
-                                    (LPCSTR)&Objects[1].Buffer[BufferOffset],
-                                    Objects[1].DisplayLength,
-                                    HexDumpContext->BytesPerGroup,
-                                    DisplayFlags)) {
-                    break;
+                if (LineDifference) {
+                    if (HexDumpContext->DiffSummary) {
+                        HexDumpDiffRecordLine(&DiffRange,
+                                              StreamOffset.QuadPart + BufferOffset,
+                                              &Objects[0].Buffer[BufferOffset],
+                                              Objects[0].DisplayLength,
+                                              &Objects[1].Buffer[BufferOffset],
+                                              Objects[1].DisplayLength,
+                                              LengthThisLine);
+                    } else if (!YoriLibHexDiff(StreamOffset.QuadPart + BufferOffset,
+                                               (LPCSTR)&Objects[0].Buffer[BufferOffset],
+                                               Objects[0].DisplayLength,
+                                               (LPCSTR)&Objects[1].Buffer[BufferOffset],
+                                               Objects[1].DisplayLength,
+                                               HexDumpContext->BytesPerGroup,
+                                               DisplayFlags)) {
+                        goto Exit;
+                    }
                 }
-            }
 
-            //
-            //  Move to the next line
-            //
+                //
+                //  Move to the next line
+                //
 
-            BufferOffset = BufferOffset + LengthThisLine;
+                BufferOffset = BufferOffset + LengthThisLine;
+            }
         }
 
         StreamOffset.QuadPart += LengthToDisplay;
+
+        if (YoriLibIsOperationCancelled()) {
+            goto Exit;
+        }
     }
 
+    HexDumpDiffFlushRange(&DiffRange);
+    Result = TRUE;
+
 Exit:
 
     //
@@ -1781,6 +2217,12 @@ ENTRYPOINT(
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 DiffMode = TRUE;
+                HexDumpContext.DiffSummary = FALSE;
+                HexDumpContext.CStyleInclude = FALSE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("ds")) == 0) {
+                DiffMode = TRUE;
+                HexDumpContext.DiffSummary = TRUE;
                 HexDumpContext.CStyleInclude = FALSE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("g1")) == 0) {
@@ -69,6 +69,25 @@ HexEditHelp(VOID)
     return TRUE;
 }
 
+/**
+ The size of a page of a large file.  When a large file is edited one window
+ at a time, windows start on a page boundary, and modified data is written
+ back in units of pages.
+ */
+#define HEXEDIT_PAGE_SIZE (64 * 1024)
+
+/**
+ The number of bytes to load into memory when editing a file that is larger
+ than this.  Files larger than this are edited one window at a time.
+ */
+#define HEXEDIT_WINDOW_SIZE (16 * 1024 * 1024)
+
+/**
+ The number of bytes to read from a large file at a time when searching
+ beyond the current window.  This is a multiple of HEXEDIT_PAGE_SIZE.
+ */
+#define HEXEDIT_SEARCH_CHUNK_SIZE (4 * 1024 * 1024)
+
 /**
  A context that records files found and being operated on in the current
  window.
@@ -110,6 +129,12 @@ typedef struct _HEXEDIT_CONTEXT {
      */
     YORI_ALLOC_SIZE_T DataLength;
 
+    /**
+     If Windowed is TRUE, the total size of the file, of which DataLength
+     bytes starting at DataOffset are currently being edited.
+     */
+    DWORDLONG FileSize;
+
     /**
      The data that was most recently searched for.
      */
@@ -120,6 +145,12 @@ typedef struct _HEXEDIT_CONTEXT {
      */
     YORI_ALLOC_SIZE_T SearchBufferLength;
 
+    /**
+     TRUE if the most recent search was cancelled by the user, so no
+     indication that data was not found should be displayed.
+     */
+    BOOLEAN SearchCancelled;
+
     /**
      The index of the edit menu.  This is used to check and uncheck menu
      items based on the state of the control.
@@ -210,6 +241,12 @@ typedef struct _HEXEDIT_CONTEXT {
      */
     BOOLEAN ReadOnly;
 
+    /**
+     TRUE if the file is too large to load into memory, so a window of it
+     is being edited.  Saving writes modified pages back into the file.
+     */
+    BOOLEAN Windowed;
+
 } HEXEDIT_CONTEXT, *PHEXEDIT_CONTEXT;
 
 /**
@@ -294,7 +331,9 @@ HexEditUpdateOpenedFileCaption(
  @param DataOffset Specifies the offset within the file to load the data.
 
  @param DataLength Specifies the number of bytes of data to load.  If zero,
-        the entire file or device contents are loaded.
+        the entire file or device contents are loaded, unless it is larger
+        than HEXEDIT_WINDOW_SIZE, in which case a window of it is loaded
+        starting from the page containing DataOffset.
 
  @return Win32 error code, including ERROR_SUCCESS to indicate success.
  */
@@ -314,6 +353,7 @@ HexEditLoadFile(
     PUCHAR Buffer;
     DWORD BytesRead;
     DWORD Err;
+    BOOLEAN Windowed;
 
     if (FileName->StartOfString == NULL) {
         return ERROR_INVALID_NAME;
@@ -332,27 +372,48 @@ HexEditLoadFile(
     //  probably should receive the size to access.
     //
 
+    Windowed = FALSE;
     if (DataLength == 0) {
         Err = YoriLibGetFileOrDeviceSize(hFile, &FileSize.QuadPart);
         if (Err != ERROR_SUCCESS) {
             CloseHandle(hFile);
             return Err;
         }
+
+        //
+        //  If the file is too large to edit in memory, load a window of it
+        //  starting from the page containing the requested offset.
+        //
+
+        if ((DWORDLONG)FileSize.QuadPart > HEXEDIT_WINDOW_SIZE) {
+            Windowed = TRUE;
+            if (DataOffset >= (DWORDLONG)FileSize.QuadPart) {
+                DataOffset = FileSize.QuadPart - 1;
+            }
+            DataOffset = DataOffset & ~((DWORDLONG)HEXEDIT_PAGE_SIZE - 1);
+            nFileSize = (YORI_MAX_SIGNED_T)(FileSize.QuadPart - DataOffset);
+            if (nFileSize > HEXEDIT_WINDOW_SIZE) {
+                nFileSize = HEXEDIT_WINDOW_SIZE;
+            }
+        } else {
+            nFileSize = (YORI_MAX_SIGNED_T)FileSize.QuadPart;
+        }
     } else {
-        FileSize.QuadPart = DataLength;
+        nFileSize = (YORI_MAX_SIGNED_T)DataLength;
     }
 
-    nFileSize = (YORI_MAX_SIGNED_T)FileSize.QuadPart;
     if (!YoriLibIsSizeAllocatable(nFileSize)) {
         CloseHandle(hFile);
         return ERROR_READ_FAULT;
     }
 
-    ReadLength = (YORI_ALLOC_SIZE_T)FileSize.QuadPart;
+    ReadLength = (YORI_ALLOC_SIZE_T)nFileSize;
 
     FileOffset.QuadPart = DataOffset;
     if (FileOffset.QuadPart != 0) {
-        if (!SetFilePointer(hFile, FileOffset.LowPart, &FileOffset.HighPart, FILE_BEGIN)) {
+        if (SetFilePointer(hFile, FileOffset.LowPart, &FileOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+            GetLastError() != NO_ERROR) {
+
             Err = GetLastError();
             CloseHandle(hFile);
             return Err;
@@ -398,10 +459,138 @@ HexEditLoadFile(
 
     HexEditContext->DataOffset = DataOffset;
     HexEditContext->DataLength = ReadLength;
+    HexEditContext->Windowed = Windowed;
+    if (Windowed) {
+        HexEditContext->FileSize = FileSize.QuadPart;
+        YoriWinHexEditSetDisplayOffset(HexEditContext->HexEdit, DataOffset);
+    } else {
+        HexEditContext->FileSize = 0;
+    }
 
     return ERROR_SUCCESS;
 }
 
+/**
+ Save the contents of the opened window back into the file or device it was
+ loaded from, by writing only the pages that have been modified.  This is
+ used for windows of large files and for devices, where the data being
+ edited is a range within a larger object.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param FileName Pointer to the name of the file or device to save.
+
+ @param Text On failure, updated to contain text describing the error.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+HexEditSaveInPlace(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in PYORI_STRING FileName,
+    __inout PYORI_STRING Text
+    )
+{
+    HANDLE WriteHandle;
+    PUCHAR Buffer;
+    YORI_ALLOC_SIZE_T BufferLength;
+    YORI_ALLOC_SIZE_T FirstByte;
+    YORI_ALLOC_SIZE_T BeyondLastByte;
+    YORI_ALLOC_SIZE_T PageOffset;
+    DWORD BytesToWrite;
+    DWORD BytesWritten;
+    DWORD FlagsAndAttributes;
+    LARGE_INTEGER FileOffset;
+    DWORD Err;
+    LPTSTR ErrText;
+
+    YoriWinHexEditGetDataNoCopy(HexEditContext->HexEdit, &Buffer, &BufferLength);
+
+    if (HexEditContext->DataLength != 0 &&
+        HexEditContext->DataLength != BufferLength) {
+
+        if (Buffer != NULL) {
+            YoriLibDereference(Buffer);
+        }
+        YoriLibYPrintf(Text, _T("Range length %i bytes does not match buffer length %i bytes"), HexEditContext->DataLength, BufferLength);
+        return FALSE;
+    }
+
+    if (!YoriWinHexEditGetModifiedRange(HexEditContext->HexEdit, &FirstByte, &BeyondLastByte)) {
+        if (Buffer != NULL) {
+            YoriLibDereference(Buffer);
+        }
+        return TRUE;
+    }
+
+    //
+    //  Expand the modified range to whole pages, which keeps writes to
+    //  devices sector aligned.
+    //
+
+    FirstByte = FirstByte & ~(HEXEDIT_PAGE_SIZE - 1);
+    if (BeyondLastByte > BufferLength) {
+        BeyondLastByte = BufferLength;
+    }
+
+    FlagsAndAttributes = FILE_ATTRIBUTE_NORMAL;
+    if (YoriLibIsFileNameDeviceName(FileName)) {
+        FlagsAndAttributes = FILE_FLAG_NO_BUFFERING;
+    }
+
+    WriteHandle = CreateFile(FileName->StartOfString,
+                             FILE_WRITE_DATA | FILE_WRITE_ATTRIBUTES | FILE_READ_ATTRIBUTES | SYNCHRONIZE,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             NULL,
+                             OPEN_EXISTING,
+                             FlagsAndAttributes,
+                             NULL);
+
+    if (WriteHandle == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibYPrintf(Text, _T("Could not open %y: %s"), FileName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        if (Buffer != NULL) {
+            YoriLibDereference(Buffer);
+        }
+        return FALSE;
+    }
+
+    for (PageOffset = FirstByte; PageOffset < BeyondLastByte; PageOffset = PageOffset + BytesToWrite) {
+        BytesToWrite = HEXEDIT_PAGE_SIZE;
+        if (BytesToWrite > BufferLength - PageOffset) {
+            BytesToWrite = BufferLength - PageOffset;
+        }
+
+        FileOffset.QuadPart = HexEditContext->DataOffset + PageOffset;
+        if (SetFilePointer(WriteHandle, FileOffset.LowPart, &FileOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+            GetLastError() != NO_ERROR) {
+
+            YoriLibYPrintf(Text, _T("Could not seek to offset 0x%llx"), HexEditContext->DataOffset + PageOffset);
+            CloseHandle(WriteHandle);
+            YoriLibDereference(Buffer);
+            return FALSE;
+        }
+
+        if (!WriteFile(WriteHandle, &Buffer[PageOffset], BytesToWrite, &BytesWritten, NULL)) {
+            Err = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Err);
+            YoriLibYPrintf(Text, _T("Could not write to %y: %s"), FileName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            CloseHandle(WriteHandle);
+            YoriLibDereference(Buffer);
+            return FALSE;
+        }
+    }
+
+    CloseHandle(WriteHandle);
+    if (Buffer != NULL) {
+        YoriLibDereference(Buffer);
+    }
+    return TRUE;
+}
+
 /**
  Save the contents of the opened window into a file.
 
@@ -466,6 +655,28 @@ HexEditSaveFile(
 
     ASSERT(YoriLibIsStringNullTerminated(FileName));
 
+    //
+    //  If saving a window of a large file, or a device, back to the same
+    //  location it was loaded from, only write the pages that changed.
+    //
+
+    if ((HexEditContext->Windowed || YoriLibIsFileNameDeviceName(FileName)) &&
+        HexEditContext->OpenFileName.StartOfString != NULL &&
+        YoriLibCompareStringInsensitive(FileName, &HexEditContext->OpenFileName) == 0 &&
+        DataOffset == HexEditContext->DataOffset) {
+
+        if (!HexEditSaveInPlace(HexEditContext, FileName, &Text)) {
+            goto DisplayErrorAndFail;
+        }
+
+        return TRUE;
+    }
+
+    if (HexEditContext->Windowed) {
+        YoriLibConstantString(&Text, _T("Cannot save a window of a large file to a different file"));
+        goto DisplayErrorAndFail;
+    }
+
     if (!YoriLibIsFileNameDeviceName(FileName)) {
 
         //
@@ -743,6 +954,10 @@ HexEditNewButtonClicked(
 
     YoriWinHexEditClear(HexEditContext->HexEdit);
     YoriLibFreeStringContents(&HexEditContext->OpenFileName);
+    HexEditContext->DataOffset = 0;
+    HexEditContext->DataLength = 0;
+    HexEditContext->FileSize = 0;
+    HexEditContext->Windowed = FALSE;
     HexEditUpdateOpenedFileCaption(HexEditContext);
     YoriWinHexEditSetModifyState(HexEditContext->HexEdit, FALSE);
 }
@@ -1232,28 +1447,56 @@ HexEditFindNextMemorySubset(
     )
 {
     YORI_ALLOC_SIZE_T BufferIndex;
-    YORI_ALLOC_SIZE_T SearchBufferIndex;
     YORI_ALLOC_SIZE_T EndIndex;
+    DWORD Pattern;
+    DWORD Word;
+    UCHAR FirstByte;
 
-    if (BufferOffset > BufferLength ||
+    if (SearchBufferLength == 0 ||
+        BufferOffset > BufferLength ||
         BufferLength - BufferOffset < SearchBufferLength) {
 
         return FALSE;
     }
 
     EndIndex = BufferLength - SearchBufferLength + 1;
+    FirstByte = SearchBuffer[0];
+    Pattern = (DWORD)FirstByte * 0x01010101;
 
-    for (BufferIndex = BufferOffset; BufferIndex < EndIndex; BufferIndex++) {
-        for (SearchBufferIndex = 0; SearchBufferIndex < SearchBufferLength; SearchBufferIndex++) {
-            if (Buffer[BufferIndex + SearchBufferIndex] != SearchBuffer[SearchBufferIndex]) {
-                break;
+    BufferIndex = BufferOffset;
+    while (BufferIndex < EndIndex) {
+
+        //
+        //  Skip four bytes at a time while none of them match the first
+        //  byte of the search buffer.  XORing with the pattern turns a
+        //  matching byte into zero, and the expression below is nonzero if
+        //  any byte in the word is zero.
+        //
+
+        if (EndIndex - BufferIndex >= sizeof(Word)) {
+            memcpy(&Word, &Buffer[BufferIndex], sizeof(Word));
+            Word = Word ^ Pattern;
+            if (((Word - 0x01010101) & ~Word & 0x80808080) == 0) {
+                BufferIndex = BufferIndex + sizeof(Word);
+                continue;
             }
         }
 
-        if (SearchBufferIndex == SearchBufferLength) {
+        //
+        //  Check the second byte before comparing the whole buffer, since
+        //  most first byte matches in binary data fail here.
+        //
+
+        if (Buffer[BufferIndex] == FirstByte &&
+            (SearchBufferLength == 1 ||
+             (Buffer[BufferIndex + 1] == SearchBuffer[1] &&
+              memcmp(&Buffer[BufferIndex + 2], &SearchBuffer[2], SearchBufferLength - 2) == 0))) {
+
             *FoundOffset = BufferIndex;
             return TRUE;
         }
+
+        BufferIndex++;
     }
 
     return FALSE;
@@ -1291,22 +1534,20 @@ HexEditFindPreviousMemorySubset(
     )
 {
     YORI_ALLOC_SIZE_T BufferIndex;
-    YORI_ALLOC_SIZE_T SearchBufferIndex;
+    UCHAR FirstByte;
 
-    if (BufferOffset > BufferLength ||
+    if (SearchBufferLength == 0 ||
+        BufferOffset > BufferLength ||
         BufferLength - BufferOffset < SearchBufferLength) {
 
         return FALSE;
     }
 
+    FirstByte = SearchBuffer[0];
     for (BufferIndex = BufferOffset; TRUE; BufferIndex--) {
-        for (SearchBufferIndex = 0; SearchBufferIndex < SearchBufferLength; SearchBufferIndex++) {
-            if (Buffer[BufferIndex + SearchBufferIndex] != SearchBuffer[SearchBufferIndex]) {
-                break;
-            }
-        }
+        if (Buffer[BufferIndex] == FirstByte &&
+            memcmp(&Buffer[BufferIndex + 1], &SearchBuffer[1], SearchBufferLength - 1) == 0) {
 
-        if (SearchBufferIndex == SearchBufferLength) {
             *FoundOffset = BufferIndex;
             return TRUE;
         }
@@ -1407,6 +1648,393 @@ HexEditFindNextFromPosition(
     return FALSE;
 }
 
+BOOLEAN
+HexEditMoveWindow(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl,
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG FileOffset
+    );
+
+VOID
+HexEditNotifyCursorMove(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl,
+    __in DWORDLONG BufferOffset,
+    __in DWORD BitShift
+    );
+
+/**
+ Check whether the user has pressed Escape to cancel a long running search.
+ Input is only peeked so that other keystrokes remain queued for the window
+ manager, unless Escape is found, in which case the input is discarded.
+
+ @return TRUE to indicate the search should be cancelled, FALSE to continue.
+ */
+BOOLEAN
+HexEditIsSearchCancelled(VOID)
+{
+    INPUT_RECORD InputRecords[16];
+    HANDLE hConIn;
+    DWORD RecordsRead;
+    DWORD Index;
+
+    hConIn = GetStdHandle(STD_INPUT_HANDLE);
+    if (!PeekConsoleInput(hConIn, InputRecords, sizeof(InputRecords)/sizeof(InputRecords[0]), &RecordsRead)) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < RecordsRead; Index++) {
+        if (InputRecords[Index].EventType == KEY_EVENT &&
+            InputRecords[Index].Event.KeyEvent.bKeyDown &&
+            InputRecords[Index].Event.KeyEvent.wVirtualKeyCode == VK_ESCAPE) {
+
+            FlushConsoleInputBuffer(hConIn);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Display the progress of a search beyond the current window in the status
+ bar.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param Searched The number of bytes searched so far.
+
+ @param Total The total number of bytes to search.
+ */
+VOID
+HexEditDisplaySearchProgress(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG Searched,
+    __in DWORDLONG Total
+    )
+{
+    YORI_STRING NewStatus;
+    DWORD Percent;
+
+    Percent = 100;
+    if (Total > 0 && Searched < Total) {
+        Percent = (DWORD)(Searched * 100 / Total);
+    }
+
+    YoriLibInitEmptyString(&NewStatus);
+    YoriLibYPrintf(&NewStatus, _T("Searching... %i%% (Esc to cancel)"), Percent);
+    YoriWinLabelSetCaption(HexEditContext->StatusBar, &NewStatus);
+    YoriLibFreeStringContents(&NewStatus);
+    YoriWinDisplayWindowContents(YoriWinGetControlParent(HexEditContext->HexEdit));
+}
+
+/**
+ Restore the status bar to display the cursor location after a search beyond
+ the current window has displayed progress.
+
+ @param HexEditContext Pointer to the hexedit context.
+ */
+VOID
+HexEditRestoreStatusAfterSearch(
+    __in PHEXEDIT_CONTEXT HexEditContext
+    )
+{
+    YORI_ALLOC_SIZE_T BufferOffset;
+    UCHAR BitShift;
+    BOOLEAN AsChar;
+
+    if (YoriWinHexEditGetCursorLocation(HexEditContext->HexEdit, &AsChar, &BufferOffset, &BitShift)) {
+        HexEditNotifyCursorMove(HexEditContext->HexEdit, BufferOffset, BitShift);
+    }
+}
+
+/**
+ Open the file being edited and allocate a buffer to search it in chunks.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param hFile On successful completion, updated to contain a handle to the
+        file.
+
+ @param Buffer On successful completion, updated to point to a buffer of
+        HEXEDIT_SEARCH_CHUNK_SIZE + HEXEDIT_PAGE_SIZE bytes.  This should be
+        freed with YoriLibFree.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+HexEditOpenFileForSearch(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __out PHANDLE hFile,
+    __out PUCHAR *Buffer
+    )
+{
+    HANDLE hLocalFile;
+    PUCHAR LocalBuffer;
+
+    if (HexEditContext->OpenFileName.StartOfString == NULL ||
+        HexEditContext->SearchBufferLength == 0 ||
+        HexEditContext->SearchBufferLength > HEXEDIT_SEARCH_CHUNK_SIZE - HEXEDIT_PAGE_SIZE) {
+
+        return FALSE;
+    }
+
+    hLocalFile = CreateFile(HexEditContext->OpenFileName.StartOfString, FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hLocalFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    LocalBuffer = YoriLibMalloc(HEXEDIT_SEARCH_CHUNK_SIZE + HEXEDIT_PAGE_SIZE);
+    if (LocalBuffer == NULL) {
+        CloseHandle(hLocalFile);
+        return FALSE;
+    }
+
+    *hFile = hLocalFile;
+    *Buffer = LocalBuffer;
+    return TRUE;
+}
+
+/**
+ Read a chunk of the file being searched.  Reads start on a page boundary
+ and are a multiple of the page size so that devices can be searched.
+
+ @param hFile Handle to the file.
+
+ @param ChunkOffset The offset within the file to read from.
+
+ @param Buffer Pointer to the buffer to read into.
+
+ @param ReadLength The number of bytes to read.
+
+ @param BytesRead On successful completion, updated to contain the number of
+        bytes read, which may be less than ReadLength at the end of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+HexEditReadSearchChunk(
+    __in HANDLE hFile,
+    __in DWORDLONG ChunkOffset,
+    __out_bcount(ReadLength) PUCHAR Buffer,
+    __in DWORD ReadLength,
+    __out PDWORD BytesRead
+    )
+{
+    LARGE_INTEGER FileOffset;
+
+    FileOffset.QuadPart = ChunkOffset;
+    if (SetFilePointer(hFile, FileOffset.LowPart, &FileOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+
+        return FALSE;
+    }
+
+    if (!ReadFile(hFile, Buffer, ReadLength, BytesRead, NULL)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ When editing a window of a large file, search the file on disk beyond the
+ current window for the next match.  The file is read in chunks, displaying
+ progress and allowing the user to cancel between chunks.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param StartOffset The offset within the file to start searching from.
+
+ @param MatchOffset On successful completion, updated to contain the offset
+        within the file of the match.
+
+ @return TRUE to indicate a match was found, FALSE if no match was found or
+         the search was cancelled.
+ */
+__success(return)
+BOOLEAN
+HexEditFindNextInFile(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG StartOffset,
+    __out PDWORDLONG MatchOffset
+    )
+{
+    HANDLE hFile;
+    PUCHAR Buffer;
+    DWORDLONG InitialOffset;
+    DWORDLONG ChunkOffset;
+    DWORD BytesRead;
+    YORI_ALLOC_SIZE_T FindOffset;
+    BOOLEAN Found;
+
+    if (!HexEditOpenFileForSearch(HexEditContext, &hFile, &Buffer)) {
+        return FALSE;
+    }
+
+    Found = FALSE;
+    InitialOffset = StartOffset;
+    while (StartOffset < HexEditContext->FileSize) {
+
+        HexEditDisplaySearchProgress(HexEditContext, StartOffset - InitialOffset, HexEditContext->FileSize - InitialOffset);
+        if (HexEditIsSearchCancelled()) {
+            HexEditContext->SearchCancelled = TRUE;
+            break;
+        }
+
+        ChunkOffset = StartOffset & ~((DWORDLONG)HEXEDIT_PAGE_SIZE - 1);
+        if (!HexEditReadSearchChunk(hFile, ChunkOffset, Buffer, HEXEDIT_SEARCH_CHUNK_SIZE, &BytesRead)) {
+            break;
+        }
+
+        if (HexEditFindNextMemorySubset(Buffer, BytesRead, (YORI_ALLOC_SIZE_T)(StartOffset - ChunkOffset), HexEditContext->SearchBuffer, HexEditContext->SearchBufferLength, &FindOffset)) {
+            *MatchOffset = ChunkOffset + FindOffset;
+            Found = TRUE;
+            break;
+        }
+
+        //
+        //  Stop at the end of the file.  Otherwise, the next chunk starts
+        //  at the first offset where the search data would not have fit
+        //  within this one.
+        //
+
+        if (BytesRead < HEXEDIT_SEARCH_CHUNK_SIZE) {
+            break;
+        }
+
+        StartOffset = ChunkOffset + BytesRead - HexEditContext->SearchBufferLength + 1;
+    }
+
+    YoriLibFree(Buffer);
+    CloseHandle(hFile);
+    return Found;
+}
+
+/**
+ When editing a window of a large file, search the file on disk before the
+ current window for the previous match.  The file is read in chunks,
+ displaying progress and allowing the user to cancel between chunks.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param EndOffset The offset within the file of the last location that a
+        match may start.
+
+ @param MatchOffset On successful completion, updated to contain the offset
+        within the file of the match.
+
+ @return TRUE to indicate a match was found, FALSE if no match was found or
+         the search was cancelled.
+ */
+__success(return)
+BOOLEAN
+HexEditFindPreviousInFile(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG EndOffset,
+    __out PDWORDLONG MatchOffset
+    )
+{
+    HANDLE hFile;
+    PUCHAR Buffer;
+    DWORDLONG InitialOffset;
+    DWORDLONG ChunkOffset;
+    DWORDLONG ChunkEnd;
+    DWORD ReadLength;
+    DWORD BytesRead;
+    YORI_ALLOC_SIZE_T FindOffset;
+    YORI_ALLOC_SIZE_T LastStart;
+    BOOLEAN Found;
+
+    if (!HexEditOpenFileForSearch(HexEditContext, &hFile, &Buffer)) {
+        return FALSE;
+    }
+
+    Found = FALSE;
+    InitialOffset = EndOffset;
+    while (TRUE) {
+
+        HexEditDisplaySearchProgress(HexEditContext, InitialOffset - EndOffset, InitialOffset + 1);
+        if (HexEditIsSearchCancelled()) {
+            HexEditContext->SearchCancelled = TRUE;
+            break;
+        }
+
+        //
+        //  Read a chunk ending with the last byte of a match starting at
+        //  EndOffset, rounded to whole pages.
+        //
+
+        ChunkEnd = EndOffset + HexEditContext->SearchBufferLength;
+        ChunkOffset = 0;
+        if (ChunkEnd > HEXEDIT_SEARCH_CHUNK_SIZE) {
+            ChunkOffset = (ChunkEnd - HEXEDIT_SEARCH_CHUNK_SIZE) & ~((DWORDLONG)HEXEDIT_PAGE_SIZE - 1);
+        }
+        ReadLength = (DWORD)(ChunkEnd - ChunkOffset);
+        ReadLength = (ReadLength + HEXEDIT_PAGE_SIZE - 1) & ~(HEXEDIT_PAGE_SIZE - 1);
+
+        if (!HexEditReadSearchChunk(hFile, ChunkOffset, Buffer, ReadLength, &BytesRead)) {
+            break;
+        }
+
+        if (BytesRead >= HexEditContext->SearchBufferLength) {
+            LastStart = (YORI_ALLOC_SIZE_T)(EndOffset - ChunkOffset);
+            if (LastStart > BytesRead - HexEditContext->SearchBufferLength) {
+                LastStart = BytesRead - HexEditContext->SearchBufferLength;
+            }
+
+            if (HexEditFindPreviousMemorySubset(Buffer, BytesRead, LastStart, HexEditContext->SearchBuffer, HexEditContext->SearchBufferLength, &FindOffset)) {
+                *MatchOffset = ChunkOffset + FindOffset;
+                Found = TRUE;
+                break;
+            }
+        }
+
+        if (ChunkOffset == 0) {
+            break;
+        }
+
+        EndOffset = ChunkOffset - 1;
+    }
+
+    YoriLibFree(Buffer);
+    CloseHandle(hFile);
+    return Found;
+}
+
+/**
+ Select a match found by searching the file beyond the current window,
+ loading the window containing it.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param MatchOffset The offset within the file of the match.
+
+ @return TRUE to indicate the match was selected, FALSE if the window could
+         not be loaded.
+ */
+BOOLEAN
+HexEditSelectMatchInFile(
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG MatchOffset
+    )
+{
+    YORI_ALLOC_SIZE_T FindOffset;
+    YORI_ALLOC_SIZE_T BufferOffset;
+    UCHAR BitShift;
+
+    if (!HexEditMoveWindow(HexEditContext->HexEdit, HexEditContext, MatchOffset)) {
+        return FALSE;
+    }
+
+    FindOffset = (YORI_ALLOC_SIZE_T)(MatchOffset - HexEditContext->DataOffset);
+    HexEditByteOffsetToBufferOffsetAndShift(HexEditContext, FindOffset, &BufferOffset, &BitShift);
+    YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, BufferOffset, BitShift);
+    YoriWinHexEditSetSelectionRange(HexEditContext->HexEdit, FindOffset, FindOffset + HexEditContext->SearchBufferLength - 1);
+    return TRUE;
+}
+
 /**
  Find the next search match from the cursor position.
 
@@ -1438,6 +2066,7 @@ HexEditFindNextFromCurrentPosition(
         BufferOffset = BufferOffset + 1;
     }
 
+    HexEditContext->SearchCancelled = FALSE;
     if (HexEditFindNextFromPosition(HexEditContext, BufferOffset, &FindOffset)) {
         HexEditByteOffsetToBufferOffsetAndShift(HexEditContext, FindOffset, &BufferOffset, &BitShift);
         YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, BufferOffset, BitShift);
@@ -1445,6 +2074,32 @@ HexEditFindNextFromCurrentPosition(
         return TRUE;
     }
 
+    //
+    //  If only a window of the file is loaded, continue searching the file
+    //  from the first offset that was not fully searched within the window.
+    //  Note this searches the file as it exists on disk.
+    //
+
+    if (HexEditContext->Windowed &&
+        HexEditContext->DataOffset + HexEditContext->DataLength < HexEditContext->FileSize) {
+
+        DWORDLONG FileMatchOffset;
+
+        if (HexEditContext->SearchBufferLength <= HexEditContext->DataLength &&
+            BufferOffset < HexEditContext->DataLength - HexEditContext->SearchBufferLength + 1) {
+
+            BufferOffset = HexEditContext->DataLength - HexEditContext->SearchBufferLength + 1;
+        }
+
+        if (HexEditFindNextInFile(HexEditContext, HexEditContext->DataOffset + BufferOffset, &FileMatchOffset) &&
+            HexEditSelectMatchInFile(HexEditContext, FileMatchOffset)) {
+
+            return TRUE;
+        }
+
+        HexEditRestoreStatusAfterSearch(HexEditContext);
+    }
+
     return FALSE;
 }
 
@@ -1475,6 +2130,7 @@ HexEditFindPreviousFromCurrentPosition(
     //  case, no match is found.
     //
 
+    HexEditContext->SearchCancelled = FALSE;
     if (Buffer == NULL) {
         return FALSE;
     }
@@ -1486,22 +2142,40 @@ HexEditFindPreviousFromCurrentPosition(
 
     BufferOffset = BufferOffset + (BitShift / 8);
 
-    if (BufferOffset == 0) {
+    if (BufferOffset == 0 && !HexEditContext->Windowed) {
         YoriLibDereference(Buffer);
         return FALSE;
     }
 
-    BufferOffset = BufferOffset - 1;
-
-    if (HexEditFindPreviousMemorySubset(Buffer, BufferLength, BufferOffset, HexEditContext->SearchBuffer, HexEditContext->SearchBufferLength, &FindOffset)) {
-        HexEditByteOffsetToBufferOffsetAndShift(HexEditContext, FindOffset, &BufferOffset, &BitShift);
-        YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, BufferOffset, BitShift);
-        YoriWinHexEditSetSelectionRange(HexEditContext->HexEdit, FindOffset, FindOffset + HexEditContext->SearchBufferLength - 1);
-        YoriLibDereference(Buffer);
-        return TRUE;
+    if (BufferOffset > 0) {
+        if (HexEditFindPreviousMemorySubset(Buffer, BufferLength, BufferOffset - 1, HexEditContext->SearchBuffer, HexEditContext->SearchBufferLength, &FindOffset)) {
+            HexEditByteOffsetToBufferOffsetAndShift(HexEditContext, FindOffset, &BufferOffset, &BitShift);
+            YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, BufferOffset, BitShift);
+            YoriWinHexEditSetSelectionRange(HexEditContext->HexEdit, FindOffset, FindOffset + HexEditContext->SearchBufferLength - 1);
+            YoriLibDereference(Buffer);
+            return TRUE;
+        }
     }
 
     YoriLibDereference(Buffer);
+
+    //
+    //  If only a window of the file is loaded, continue searching the file
+    //  before the window.  Note this searches the file as it exists on disk.
+    //
+
+    if (HexEditContext->Windowed && HexEditContext->DataOffset > 0) {
+        DWORDLONG FileMatchOffset;
+
+        if (HexEditFindPreviousInFile(HexEditContext, HexEditContext->DataOffset - 1, &FileMatchOffset) &&
+            HexEditSelectMatchInFile(HexEditContext, FileMatchOffset)) {
+
+            return TRUE;
+        }
+
+        HexEditRestoreStatusAfterSearch(HexEditContext);
+    }
+
     return FALSE;
 }
 
@@ -1547,7 +2221,9 @@ HexEditFindButtonClicked(
 
     HexEditContext->SearchBuffer = FindData;
     HexEditContext->SearchBufferLength = FindDataLength;
-    if (!HexEditFindNextFromCurrentPosition(HexEditContext, FALSE)) {
+    if (!HexEditFindNextFromCurrentPosition(HexEditContext, FALSE) &&
+        !HexEditContext->SearchCancelled) {
+
         YORI_STRING ButtonText[1];
         YORI_STRING Text;
 
@@ -1587,7 +2263,9 @@ HexEditFindNextButtonClicked(
         return;
     }
 
-    if (!HexEditFindNextFromCurrentPosition(HexEditContext, TRUE)) {
+    if (!HexEditFindNextFromCurrentPosition(HexEditContext, TRUE) &&
+        !HexEditContext->SearchCancelled) {
+
         YORI_STRING Title;
         YORI_STRING Text;
         YORI_STRING ButtonText[1];
@@ -1628,7 +2306,9 @@ HexEditFindPreviousButtonClicked(
         return;
     }
 
-    if (!HexEditFindPreviousFromCurrentPosition(HexEditContext)) {
+    if (!HexEditFindPreviousFromCurrentPosition(HexEditContext) &&
+        !HexEditContext->SearchCancelled) {
+
         YORI_STRING Title;
         YORI_STRING Text;
         YORI_STRING ButtonText[1];
@@ -1843,6 +2523,133 @@ HexEditChangeButtonClicked(
 }
 
 
+/**
+ When editing a window of a large file, load the window containing a
+ specified file offset, prompting to save changes to the current window
+ first.
+
+ @param Ctrl Pointer to the menu control indicating the action that
+        triggered the move.
+
+ @param HexEditContext Pointer to the hexedit context.
+
+ @param FileOffset The offset within the file to display.  This is clamped
+        to the end of the file.
+
+ @return TRUE if the window containing the offset is loaded, FALSE if it is
+         not.
+ */
+BOOLEAN
+HexEditMoveWindow(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl,
+    __in PHEXEDIT_CONTEXT HexEditContext,
+    __in DWORDLONG FileOffset
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    YORI_STRING Title;
+    YORI_STRING Text;
+    YORI_STRING ButtonText;
+    LPTSTR ErrText;
+    DWORD Err;
+
+    ASSERT(HexEditContext->Windowed);
+
+    if (FileOffset >= HexEditContext->FileSize) {
+        FileOffset = HexEditContext->FileSize - 1;
+    }
+
+    if (FileOffset >= HexEditContext->DataOffset &&
+        FileOffset < HexEditContext->DataOffset + HexEditContext->DataLength) {
+
+        YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, (YORI_ALLOC_SIZE_T)(FileOffset - HexEditContext->DataOffset), 0);
+        return TRUE;
+    }
+
+    if (!HexEditPromptForSaveIfModified(Ctrl, HexEditContext)) {
+        return FALSE;
+    }
+
+    Err = HexEditLoadFile(HexEditContext, &HexEditContext->OpenFileName, FileOffset, 0);
+    if (Err != ERROR_SUCCESS) {
+        Parent = YoriWinGetControlParent(HexEditContext->HexEdit);
+        ErrText = YoriLibGetWinErrorText(Err);
+        YoriLibInitEmptyString(&Text);
+        YoriLibYPrintf(&Text, _T("Could not read file: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibConstantString(&Title, _T("Go to"));
+        YoriLibConstantString(&ButtonText, _T("Ok"));
+        YoriDlgMessageBox(YoriWinGetWindowManagerHandle(Parent),
+                          &Title,
+                          &Text,
+                          1,
+                          &ButtonText,
+                          0,
+                          0);
+        YoriLibFreeStringContents(&Text);
+        return FALSE;
+    }
+
+    YoriWinHexEditSetReadOnly(HexEditContext->HexEdit, HexEditContext->ReadOnly);
+    YoriWinHexEditSetModifyState(HexEditContext->HexEdit, FALSE);
+    YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, (YORI_ALLOC_SIZE_T)(FileOffset - HexEditContext->DataOffset), 0);
+    return TRUE;
+}
+
+/**
+ A callback invoked when the next window menu item is invoked.
+
+ @param Ctrl Pointer to the menu bar control.
+ */
+VOID
+HexEditNextWindowButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    PHEXEDIT_CONTEXT HexEditContext;
+
+    Parent = YoriWinGetControlParent(Ctrl);
+    HexEditContext = YoriWinGetControlContext(Parent);
+
+    if (!HexEditContext->Windowed ||
+        HexEditContext->DataOffset + HexEditContext->DataLength >= HexEditContext->FileSize) {
+
+        return;
+    }
+
+    HexEditMoveWindow(Ctrl, HexEditContext, HexEditContext->DataOffset + HexEditContext->DataLength);
+}
+
+/**
+ A callback invoked when the previous window menu item is invoked.
+
+ @param Ctrl Pointer to the menu bar control.
+ */
+VOID
+HexEditPreviousWindowButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    PHEXEDIT_CONTEXT HexEditContext;
+    DWORDLONG NewOffset;
+
+    Parent = YoriWinGetControlParent(Ctrl);
+    HexEditContext = YoriWinGetControlContext(Parent);
+
+    if (!HexEditContext->Windowed || HexEditContext->DataOffset == 0) {
+        return;
+    }
+
+    NewOffset = 0;
+    if (HexEditContext->DataOffset > HEXEDIT_WINDOW_SIZE) {
+        NewOffset = HexEditContext->DataOffset - HEXEDIT_WINDOW_SIZE;
+    }
+
+    HexEditMoveWindow(Ctrl, HexEditContext, NewOffset);
+}
+
 /**
  A callback invoked when the go to menu item is invoked.
 
@@ -1886,6 +2693,17 @@ HexEditGoToButtonClicked(
             NewOffset = (YORI_MAX_UNSIGNED_T)SignedNewOffset;
         }
 
+        //
+        //  When editing a window of a large file, the offset refers to the
+        //  file, and may require a different window to be loaded.
+        //
+
+        if (HexEditContext->Windowed) {
+            HexEditMoveWindow(Ctrl, HexEditContext, NewOffset);
+            YoriLibFreeStringContents(&Text);
+            return;
+        }
+
         YoriWinHexEditSetCursorLocation(HexEditContext->HexEdit, FALSE, (YORI_ALLOC_SIZE_T)NewOffset, 0);
     }
 
@@ -2325,6 +3143,9 @@ HexEditNotifyCursorMove(
     HexEditContext = YoriWinGetControlContext(Parent);
 
     liBufferOffset.QuadPart = BufferOffset;
+    if (HexEditContext->Windowed) {
+        liBufferOffset.QuadPart = liBufferOffset.QuadPart + HexEditContext->DataOffset;
+    }
     YoriLibInitEmptyString(&NewStatus);
     YoriLibYPrintf(&NewStatus, _T("0x%08x`%08x "), liBufferOffset.HighPart, liBufferOffset.LowPart);
 
@@ -2359,7 +3180,7 @@ HexEditPopulateMenuBar(
 {
     YORI_WIN_MENU_ENTRY FileMenuEntries[8];
     YORI_WIN_MENU_ENTRY EditMenuEntries[4];
-    YORI_WIN_MENU_ENTRY SearchMenuEntries[6];
+    YORI_WIN_MENU_ENTRY SearchMenuEntries[9];
     YORI_WIN_MENU_ENTRY ViewMenuEntries[8];
     YORI_WIN_MENU_ENTRY ToolsMenuEntries[1];
     YORI_WIN_MENU_ENTRY HelpMenuEntries[1];
@@ -2464,6 +3285,19 @@ HexEditPopulateMenuBar(
     SearchMenuEntries[MenuIndex].NotifyCallback = HexEditGoToButtonClicked;
     MenuIndex++;
 
+    SearchMenuEntries[MenuIndex].Flags = YORI_WIN_MENU_ENTRY_SEPERATOR;
+    MenuIndex++;
+
+    YoriLibConstantString(&SearchMenuEntries[MenuIndex].Caption, _T("&Next Window"));
+    YoriLibConstantString(&SearchMenuEntries[MenuIndex].Hotkey, _T("F6"));
+    SearchMenuEntries[MenuIndex].NotifyCallback = HexEditNextWindowButtonClicked;
+    MenuIndex++;
+
+    YoriLibConstantString(&SearchMenuEntries[MenuIndex].Caption, _T("Pre&vious Window"));
+    YoriLibConstantString(&SearchMenuEntries[MenuIndex].Hotkey, _T("Shift+F6"));
+    SearchMenuEntries[MenuIndex].NotifyCallback = HexEditPreviousWindowButtonClicked;
+    MenuIndex++;
+
     ZeroMemory(&ViewMenuEntries, sizeof(ViewMenuEntries));
     MenuIndex = 0;
     HexEditContext->ViewBytesMenuIndex = MenuIndex;
@@ -95,6 +95,13 @@ typedef struct _HILITE_MATCH_CRITERIA {
      The color to apply to the line, in event of a match.
      */
     YORILIB_COLOR_ATTRIBUTES Color;
+
+    /**
+     A prepared matcher used to find MatchString within lines.  This is only
+     used for matches of type HiliteMatchTypeContains, and is only valid
+     while a stream is being processed.
+     */
+    YORI_LIB_SUBSTRING_MATCHER Matcher;
 } HILITE_MATCH_CRITERIA, *PHILITE_MATCH_CRITERIA;
 
 /**
@@ -215,25 +222,58 @@ HiliteGetNextMatch(
 }
 
 /**
- Process a stream and apply the hilite criteria before outputting to standard
- output.
+ Append a VT escape sequence to change the text color to an output string.
 
- @param hSource The incoming stream to highlight.
+ @param Output Pointer to the string to append to.  This string may be
+        reallocated.
 
- @param HiliteContext Pointer to a set of criteria to apply to the stream
-        before outputting.
+ @param Attribute The Win32 color to change to.
 
- @return TRUE for success, FALSE on failure.
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
+__success(return)
 BOOL
-HiliteProcessStream(
-    __in HANDLE hSource,
-    __in PHILITE_CONTEXT HiliteContext
+HiliteAppendColor(
+    __inout PYORI_STRING Output,
+    __in WORD Attribute
+    )
+{
+    TCHAR EscapeBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING Escape;
+
+    YoriLibInitEmptyString(&Escape);
+    Escape.StartOfString = EscapeBuffer;
+    Escape.LengthAllocated = sizeof(EscapeBuffer)/sizeof(EscapeBuffer[0]);
+
+    if (!YoriLibVtStringForTextAttribute(&Escape, 0, Attribute)) {
+        return FALSE;
+    }
+
+    return YoriLibStringConcatenate(Output, &Escape);
+}
+
+/**
+ Apply the hilite criteria to a single line, appending the text of the line
+ and any escape sequences needed to color it to an output string.  The
+ line ending is not appended.
+
+ @param HiliteContext Pointer to a set of criteria to apply to the line.
+
+ @param LineString Pointer to the line to process.
+
+ @param Output Pointer to a string to append the result to.  This string
+        may be reallocated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+HiliteProcessLine(
+    __in PHILITE_CONTEXT HiliteContext,
+    __in PYORI_STRING LineString,
+    __inout PYORI_STRING Output
     )
 {
-    PVOID LineContext = NULL;
-    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
-    YORI_STRING LineString;
     YORI_STRING Substring;
     YORI_STRING DisplayString;
     PHILITE_MATCH_CRITERIA MatchCriteria;
@@ -245,194 +285,287 @@ HiliteProcessStream(
     BOOLEAN AnyMatchFound;
     YORI_ALLOC_SIZE_T MatchOffset;
 
-    YoriLibInitEmptyString(&LineString);
     YoriLibInitEmptyString(&Substring);
     YoriLibInitEmptyString(&DisplayString);
     MatchOffset = 0;
 
-    HiliteContext->FilesFound++;
-
-    while (TRUE) {
-
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
-            break;
-        }
-
-        Substring.StartOfString = LineString.StartOfString;
-        Substring.LengthInChars = LineString.LengthInChars;
-        ColorToUse.Ctrl = HiliteContext->DefaultColor.Ctrl;
-        ColorToUse.Win32Attr = HiliteContext->DefaultColor.Win32Attr;
+    Substring.StartOfString = LineString->StartOfString;
+    Substring.LengthInChars = LineString->LengthInChars;
+    ColorToUse.Ctrl = HiliteContext->DefaultColor.Ctrl;
+    ColorToUse.Win32Attr = HiliteContext->DefaultColor.Win32Attr;
 
-        while (Substring.LengthInChars > 0) {
+    while (Substring.LengthInChars > 0) {
 
-            //
-            //  Enumerate through the matches and see if there is anything to
-            //  apply.  At the start of the line, enumerate the matches to
-            //  the beginning of lines; after that enumerate the matches that
-            //  could be in the middle of a line.
-            //
+        //
+        //  Enumerate through the matches and see if there is anything to
+        //  apply.  At the start of the line, enumerate the matches to
+        //  the beginning of lines; after that enumerate the matches that
+        //  could be in the middle of a line.
+        //
 
-            BestMatchCriteria = NULL;
-            BestMatchOffset = 0;
-            AnyMatchFound = FALSE;
-            if (Substring.StartOfString == LineString.StartOfString) {
-                ListHead = &HiliteContext->StartMatches;
-            } else {
-                ListHead = &HiliteContext->MiddleMatches;
-            }
-            MatchCriteria = NULL;
-            MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
-            while (MatchCriteria != NULL) {
-                MatchFound = FALSE;
-                if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
-                    if (HiliteContext->Insensitive) {
-                        if (YoriLibCompareStringInsensitiveCount(&Substring,
-                                                                 &MatchCriteria->MatchString,
-                                                                 MatchCriteria->MatchString.LengthInChars) == 0) {
-                            MatchFound = TRUE;
-                            MatchOffset = 0;
-                        }
-                    } else {
-                        if (YoriLibCompareStringCount(&Substring,
-                                                      &MatchCriteria->MatchString,
-                                                      MatchCriteria->MatchString.LengthInChars) == 0) {
-                            MatchFound = TRUE;
-                            MatchOffset = 0;
-                        }
+        BestMatchCriteria = NULL;
+        BestMatchOffset = 0;
+        AnyMatchFound = FALSE;
+        if (Substring.StartOfString == LineString->StartOfString) {
+            ListHead = &HiliteContext->StartMatches;
+        } else {
+            ListHead = &HiliteContext->MiddleMatches;
+        }
+        MatchCriteria = NULL;
+        MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+        while (MatchCriteria != NULL) {
+            MatchFound = FALSE;
+            if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
+                if (HiliteContext->Insensitive) {
+                    if (YoriLibCompareStringInsensitiveCount(&Substring,
+                                                             &MatchCriteria->MatchString,
+                                                             MatchCriteria->MatchString.LengthInChars) == 0) {
+                        MatchFound = TRUE;
+                        MatchOffset = 0;
                     }
-                } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
-                    YORI_STRING TailOfLine;
-
-                    if (Substring.LengthInChars >= MatchCriteria->MatchString.LengthInChars) {
-                        YoriLibInitEmptyString(&TailOfLine);
-                        TailOfLine.LengthInChars = MatchCriteria->MatchString.LengthInChars;
-                        TailOfLine.StartOfString = &Substring.StartOfString[Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars];
-
-                        if (HiliteContext->Insensitive) {
-                            if (YoriLibCompareStringInsensitive(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                                MatchFound = TRUE;
-                                MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
-                            }
-                        } else {
-                            if (YoriLibCompareString(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                                MatchFound = TRUE;
-                                MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
-                            }
-                        }
+                } else {
+                    if (YoriLibCompareStringCount(&Substring,
+                                                  &MatchCriteria->MatchString,
+                                                  MatchCriteria->MatchString.LengthInChars) == 0) {
+                        MatchFound = TRUE;
+                        MatchOffset = 0;
                     }
-                } else if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
+                }
+            } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
+                YORI_STRING TailOfLine;
+
+                if (Substring.LengthInChars >= MatchCriteria->MatchString.LengthInChars) {
+                    YoriLibInitEmptyString(&TailOfLine);
+                    TailOfLine.LengthInChars = MatchCriteria->MatchString.LengthInChars;
+                    TailOfLine.StartOfString = &Substring.StartOfString[Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars];
+
                     if (HiliteContext->Insensitive) {
-                        if (YoriLibFindFirstMatchingSubstringInsensitive(&Substring, 1, &MatchCriteria->MatchString, &MatchOffset)) {
+                        if (YoriLibCompareStringInsensitive(&TailOfLine, &MatchCriteria->MatchString) == 0) {
                             MatchFound = TRUE;
+                            MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
                         }
                     } else {
-                        if (YoriLibFindFirstMatchingSubstring(&Substring, 1, &MatchCriteria->MatchString, &MatchOffset)) {
+                        if (YoriLibCompareString(&TailOfLine, &MatchCriteria->MatchString) == 0) {
                             MatchFound = TRUE;
+                            MatchOffset = Substring.LengthInChars - MatchCriteria->MatchString.LengthInChars;
                         }
                     }
                 }
+            } else if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
+                if (YoriLibFindFirstMatchWithMatcher(&MatchCriteria->Matcher, &Substring, &MatchOffset)) {
+                    MatchFound = TRUE;
+                }
+            }
 
 
-                //
-                //  When highlighting specific terms, look for the first match
-                //  within the line.  That string should be processed first.
-                //  When not matching specific terms, just use the first found
-                //  match to highlight the entire line.
-                //
-
-                if (MatchFound) {
+            //
+            //  When highlighting specific terms, look for the first match
+            //  within the line.  That string should be processed first.
+            //  When not matching specific terms, just use the first found
+            //  match to highlight the entire line.
+            //
 
-                    if (!HiliteContext->HighlightMatchText) {
-                        BestMatchCriteria = MatchCriteria;
-                        BestMatchOffset = MatchOffset;
-                        break;
-                    }
+            if (MatchFound) {
 
-                    if (MatchCriteria->MatchString.LengthInChars > 0 &&
-                        (BestMatchCriteria == NULL || MatchOffset < BestMatchOffset)) {
-                        BestMatchCriteria = MatchCriteria;
-                        BestMatchOffset = MatchOffset;
-                    }
+                if (!HiliteContext->HighlightMatchText) {
+                    BestMatchCriteria = MatchCriteria;
+                    BestMatchOffset = MatchOffset;
+                    break;
                 }
 
-                MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+                if (MatchCriteria->MatchString.LengthInChars > 0 &&
+                    (BestMatchCriteria == NULL || MatchOffset < BestMatchOffset)) {
+                    BestMatchCriteria = MatchCriteria;
+                    BestMatchOffset = MatchOffset;
+                }
             }
 
-            //
-            //  If this is highlighting a search term only, display any
-            //  text before the match in regular color, then display the
-            //  match in the requested color.  If highlighting the whole
-            //  line, display all the text.  Then start searching again,
-            //  from all entries that can be in the middle of lines.
-            //
+            MatchCriteria = HiliteGetNextMatch(HiliteContext, &ListHead, MatchCriteria);
+        }
 
-            DisplayString.StartOfString = Substring.StartOfString;
-            DisplayString.LengthInChars = Substring.LengthInChars;
-            if (BestMatchCriteria != NULL) {
-                AnyMatchFound = TRUE;
-                if (HiliteContext->HighlightMatchText) {
-                    if (BestMatchOffset > 0) {
-                        DisplayString.LengthInChars = BestMatchOffset;
-                        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
-                        DisplayString.StartOfString = &Substring.StartOfString[BestMatchOffset];
-                        Substring.LengthInChars = Substring.LengthInChars - BestMatchOffset;
-                        Substring.StartOfString = &Substring.StartOfString[BestMatchOffset];
-                    }
-                    DisplayString.LengthInChars = BestMatchCriteria->MatchString.LengthInChars;
-                    //
-                    //  If searching for an empty string, treat it as not
-                    //  found and move to the next line.  This is only
-                    //  done when highlighting specific text; when
-                    //  highlighting an entire line, the empty string
-                    //  matches the line, and execution continues on the
-                    //  next line.
-                    //
-
-                    if (DisplayString.LengthInChars == 0) {
-                        ASSERT(BestMatchOffset == 0);
-                        break;
+        //
+        //  If this is highlighting a search term only, display any
+        //  text before the match in regular color, then display the
+        //  match in the requested color.  If highlighting the whole
+        //  line, display all the text.  Then start searching again,
+        //  from all entries that can be in the middle of lines.
+        //
+
+        DisplayString.StartOfString = Substring.StartOfString;
+        DisplayString.LengthInChars = Substring.LengthInChars;
+        if (BestMatchCriteria != NULL) {
+            AnyMatchFound = TRUE;
+            if (HiliteContext->HighlightMatchText) {
+                if (BestMatchOffset > 0) {
+                    DisplayString.LengthInChars = BestMatchOffset;
+                    if (!YoriLibStringConcatenate(Output, &DisplayString)) {
+                        return FALSE;
                     }
-                    ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
-                    ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
-                } else {
-                    ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
-                    ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
+                    DisplayString.StartOfString = &Substring.StartOfString[BestMatchOffset];
+                    Substring.LengthInChars = Substring.LengthInChars - BestMatchOffset;
+                    Substring.StartOfString = &Substring.StartOfString[BestMatchOffset];
                 }
+                DisplayString.LengthInChars = BestMatchCriteria->MatchString.LengthInChars;
+                //
+                //  If searching for an empty string, treat it as not
+                //  found and move to the next line.  This is only
+                //  done when highlighting specific text; when
+                //  highlighting an entire line, the empty string
+                //  matches the line, and execution continues on the
+                //  next line.
+                //
 
-                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, ColorToUse.Win32Attr);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
-                YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, HiliteContext->DefaultColor.Win32Attr);
-                Substring.StartOfString = &Substring.StartOfString[DisplayString.LengthInChars];
-                Substring.LengthInChars = Substring.LengthInChars - DisplayString.LengthInChars;
+                if (DisplayString.LengthInChars == 0) {
+                    ASSERT(BestMatchOffset == 0);
+                    break;
+                }
+                ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
+                ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
+            } else {
+                ColorToUse.Ctrl = BestMatchCriteria->Color.Ctrl;
+                ColorToUse.Win32Attr = BestMatchCriteria->Color.Win32Attr;
             }
 
-            //
-            //  If all matches have been navigated and the string hasn't
-            //  changed, no more matches were found, so move to the next line.
-            //
+            if (!HiliteAppendColor(Output, ColorToUse.Win32Attr) ||
+                !YoriLibStringConcatenate(Output, &DisplayString) ||
+                !HiliteAppendColor(Output, HiliteContext->DefaultColor.Win32Attr)) {
 
-            if (!AnyMatchFound) {
-                break;
+                return FALSE;
             }
+            Substring.StartOfString = &Substring.StartOfString[DisplayString.LengthInChars];
+            Substring.LengthInChars = Substring.LengthInChars - DisplayString.LengthInChars;
         }
 
         //
-        //  If no matches are found, display the line.
+        //  If all matches have been navigated and the string hasn't
+        //  changed, no more matches were found, so move to the next line.
         //
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Substring);
+        if (!AnyMatchFound) {
+            break;
+        }
+    }
 
-        //
-        //  Apply a newline if needed.
-        //
+    //
+    //  Append any text following the final match.
+    //
+
+    return YoriLibStringConcatenate(Output, &Substring);
+}
+
+/**
+ Apply the hilite criteria to a single line when processing a file on
+ multiple threads.  This appends the result and a line ending to the output
+ string.
+
+ @param Context Pointer to the hilite context.
+
+ @param Line Pointer to the line to process.
+
+ @param Output Pointer to a string to append the result to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+HiliteProcessLineInParallel(
+    __in PVOID Context,
+    __in PYORI_STRING Line,
+    __inout PYORI_STRING Output
+    )
+{
+    PHILITE_CONTEXT HiliteContext = (PHILITE_CONTEXT)Context;
+
+    if (!HiliteProcessLine(HiliteContext, Line, Output)) {
+        return FALSE;
+    }
+
+    return YoriLibStringConcatenateWithLiteral(Output, _T("\n"));
+}
+
+/**
+ Process a stream and apply the hilite criteria before outputting to standard
+ output.
+
+ @param hSource The incoming stream to highlight.
+
+ @param HiliteContext Pointer to a set of criteria to apply to the stream
+        before outputting.
+
+ @return TRUE for success, FALSE on failure.
+ */
+BOOL
+HiliteProcessStream(
+    __in HANDLE hSource,
+    __in PHILITE_CONTEXT HiliteContext
+    )
+{
+    PVOID LineContext = NULL;
+    CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    YORI_STRING LineString;
+    YORI_STRING OutputString;
+    PHILITE_MATCH_CRITERIA MatchCriteria;
+    PYORI_LIST_ENTRY ListEntry;
+
+    YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&OutputString);
+
+    HiliteContext->FilesFound++;
+
+    //
+    //  Prepare the strings that can be found in the middle of a line once,
+    //  rather than for every line.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&HiliteContext->MiddleMatches, NULL);
+    while (ListEntry != NULL) {
+        MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
+        YoriLibInitializeSubstringMatcher(&MatchCriteria->Matcher, 1, &MatchCriteria->MatchString, HiliteContext->Insensitive);
+        ListEntry = YoriLibGetNextListEntry(&HiliteContext->MiddleMatches, ListEntry);
+    }
+
+    //
+    //  Each line is highlighted independently, so large files can be
+    //  processed on multiple threads.  If that is not possible, process
+    //  the file here.
+    //
+
+    if (!YoriLibProcessLinesInParallel(hSource, HiliteProcessLineInParallel, HiliteContext)) {
+
+        while (TRUE) {
+
+            if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+                break;
+            }
+
+            OutputString.LengthInChars = 0;
+            if (!HiliteProcessLine(HiliteContext, &LineString, &OutputString)) {
+                break;
+            }
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &OutputString);
+
+            //
+            //  Apply a newline if needed.
+            //
 
-        if (LineString.LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            if (LineString.LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            }
         }
+
+        YoriLibLineReadCloseOrCache(LineContext);
     }
 
-    YoriLibLineReadCloseOrCache(LineContext);
     YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&OutputString);
+
+    ListEntry = YoriLibGetNextListEntry(&HiliteContext->MiddleMatches, NULL);
+    while (ListEntry != NULL) {
+        MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
+        YoriLibCleanupSubstringMatcher(&MatchCriteria->Matcher);
+        ListEntry = YoriLibGetNextListEntry(&HiliteContext->MiddleMatches, ListEntry);
+    }
 
     return TRUE;
 }
@@ -92,6 +92,343 @@ typedef struct _ICONV_CONTEXT {
 
 } ICONV_CONTEXT, *PICONV_CONTEXT;
 
+/**
+ The number of line views to request from the line reader at a time.
+ */
+#define ICONV_VIEWS_PER_READ (256)
+
+/**
+ The size of the buffer used to accumulate converted output before writing
+ it to the output device.
+ */
+#define ICONV_OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The maximum number of output bytes that a single input character can
+ generate.  A UTF16 character can require three bytes in UTF8, and an input
+ byte can require one UTF16 character, so four bytes is sufficient for any
+ supported conversion.
+ */
+#define ICONV_MAX_BYTES_PER_CHAR (4)
+
+/**
+ Copy UTF16 characters into an 8 bit buffer for as long as the characters
+ are in the ASCII range, which is represented identically in all supported
+ 8 bit output encodings.  The main loop examines four characters at a time
+ so the common case of entirely ASCII text has few branches.
+
+ @param Source Pointer to the UTF16 characters.
+
+ @param Length The number of characters in Source.
+
+ @param Target Pointer to the buffer to receive 8 bit characters.  This must
+        be at least Length bytes.
+
+ @return The number of characters copied.  If this is less than Length, the
+         character at this offset is not in the ASCII range.
+ */
+YORI_ALLOC_SIZE_T
+IconvNarrowAscii(
+    __in PWCHAR Source,
+    __in YORI_ALLOC_SIZE_T Length,
+    __out PUCHAR Target
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    Index = 0;
+    while (Index + 4 <= Length) {
+        if (((Source[Index] | Source[Index + 1] | Source[Index + 2] | Source[Index + 3]) & 0xFF80) != 0) {
+            break;
+        }
+        Target[Index] = (UCHAR)Source[Index];
+        Target[Index + 1] = (UCHAR)Source[Index + 1];
+        Target[Index + 2] = (UCHAR)Source[Index + 2];
+        Target[Index + 3] = (UCHAR)Source[Index + 3];
+        Index = Index + 4;
+    }
+
+    while (Index < Length && Source[Index] < 0x80) {
+        Target[Index] = (UCHAR)Source[Index];
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Widen 8 bit characters into UTF16 where each input byte corresponds to the
+ UTF16 character with the same value.
+
+ @param Source Pointer to the 8 bit characters.
+
+ @param Length The number of characters in Source.
+
+ @param Target Pointer to the buffer to receive UTF16 characters.  This must
+        be at least Length characters.  Note this buffer may not be aligned.
+ */
+VOID
+IconvWidenAscii(
+    __in PUCHAR Source,
+    __in YORI_ALLOC_SIZE_T Length,
+    __out PUCHAR Target
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = 0; Index + 4 <= Length; Index = Index + 4) {
+        Target[Index * 2] = Source[Index];
+        Target[Index * 2 + 1] = 0;
+        Target[Index * 2 + 2] = Source[Index + 1];
+        Target[Index * 2 + 3] = 0;
+        Target[Index * 2 + 4] = Source[Index + 2];
+        Target[Index * 2 + 5] = 0;
+        Target[Index * 2 + 6] = Source[Index + 3];
+        Target[Index * 2 + 7] = 0;
+    }
+
+    for (; Index < Length; Index++) {
+        Target[Index * 2] = Source[Index];
+        Target[Index * 2 + 1] = 0;
+    }
+}
+
+/**
+ Convert a single line from the input encoding into the output encoding,
+ appending it to an output buffer.  Lines that can be converted without
+ changing character values are copied directly; anything else is converted
+ through UTF16 using the system conversion routines.
+
+ @param View Pointer to the line view in the input encoding.
+
+ @param IconvContext Specifies the encodings to apply.
+
+ @param Target Pointer to the buffer to receive the line in output encoding.
+        This must be large enough for ICONV_MAX_BYTES_PER_CHAR bytes for
+        each character in the line.
+
+ @param ScratchString Pointer to a string that can be used to hold the line
+        in UTF16 form if it requires conversion.  This string is reallocated
+        as needed and should be freed by the caller.
+
+ @return The number of bytes written to Target.
+ */
+DWORD
+IconvConvertLineView(
+    __in PYORI_LIB_LINE_VIEW View,
+    __in PICONV_CONTEXT IconvContext,
+    __out PUCHAR Target,
+    __inout PYORI_STRING ScratchString
+    )
+{
+    YORI_ALLOC_SIZE_T CharsCopied;
+    YORI_ALLOC_SIZE_T BytesNeeded;
+    PWCHAR WideSource;
+
+    if (View->WideChars) {
+        WideSource = (PWCHAR)View->Buffer;
+        if (IconvContext->TargetEncoding == CP_UTF16) {
+            memcpy(Target, WideSource, View->LengthInChars * sizeof(WCHAR));
+            return View->LengthInChars * sizeof(WCHAR);
+        }
+
+        //
+        //  ASCII is only ever a single byte in output, so copy directly
+        //  until a character outside that range is found, then use the
+        //  system to convert the remainder.  An ASCII character can't be
+        //  part of a surrogate pair, so splitting here is safe.
+        //
+
+        CharsCopied = IconvNarrowAscii(WideSource, View->LengthInChars, Target);
+        if (CharsCopied == View->LengthInChars) {
+            return CharsCopied;
+        }
+
+        BytesNeeded = (YORI_ALLOC_SIZE_T)YoriLibGetMultibyteOutputSizeNeeded(&WideSource[CharsCopied], View->LengthInChars - CharsCopied);
+        YoriLibMultibyteOutput(&WideSource[CharsCopied], View->LengthInChars - CharsCopied, (LPSTR)&Target[CharsCopied], BytesNeeded);
+        return CharsCopied + BytesNeeded;
+    }
+
+    //
+    //  If the input and output are the same 8 bit encoding, the line only
+    //  needs its line ending changed.  If the input is entirely ASCII and
+    //  the output is ASCII compatible, it can also be copied directly.
+    //
+
+    if (IconvContext->TargetEncoding == IconvContext->SourceEncoding ||
+        (!View->NeedsConversion && IconvContext->TargetEncoding != CP_UTF16)) {
+
+        memcpy(Target, View->Buffer, View->LengthInChars);
+        return View->LengthInChars;
+    }
+
+    if (!View->NeedsConversion) {
+        IconvWidenAscii((PUCHAR)View->Buffer, View->LengthInChars, Target);
+        return View->LengthInChars * sizeof(WCHAR);
+    }
+
+    if (!YoriLibLineViewToString(View, ScratchString)) {
+        return 0;
+    }
+
+    BytesNeeded = (YORI_ALLOC_SIZE_T)YoriLibGetMultibyteOutputSizeNeeded(ScratchString->StartOfString, ScratchString->LengthInChars);
+    if (BytesNeeded > 0) {
+        YoriLibMultibyteOutput(ScratchString->StartOfString, ScratchString->LengthInChars, (LPSTR)Target, BytesNeeded);
+    }
+    return BytesNeeded;
+}
+
+/**
+ Write the contents of an output buffer to the output device.
+
+ @param hOutput Handle to the output device.
+
+ @param Buffer Pointer to the buffer to write.
+
+ @param Length The number of bytes in the buffer to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IconvWriteBuffer(
+    __in HANDLE hOutput,
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD BytesWritten;
+    DWORD Offset;
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    Offset = 0;
+    while (Offset < Length) {
+        if (!WriteFile(hOutput, &Buffer[Offset], Length - Offset, &BytesWritten, NULL) ||
+            BytesWritten == 0) {
+
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("iconv: write failed: %s"), ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            return FALSE;
+        }
+        Offset = Offset + BytesWritten;
+    }
+
+    return TRUE;
+}
+
+/**
+ Convert the encoding of an opened stream to an output device which is not
+ a console.  Lines are obtained in batches from the line reader without
+ copying, converted directly into a large output buffer, and written when
+ the buffer is full.  The caller is expected to have configured the input
+ and output encodings.
+
+ @param hSource Handle to the source.
+
+ @param hOutput Handle to the output device.
+
+ @param IconvContext Specifies the encodings to apply.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IconvProcessStreamBlocks(
+    __in HANDLE hSource,
+    __in HANDLE hOutput,
+    __in PICONV_CONTEXT IconvContext
+    )
+{
+    PVOID LineContext = NULL;
+    YORI_LIB_LINE_VIEW LineViews[ICONV_VIEWS_PER_READ];
+    YORI_ALLOC_SIZE_T ViewCount;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_STRING ScratchString;
+    UCHAR LineEndBytes[16];
+    DWORD LineEndLength;
+    PUCHAR Buffer;
+    DWORD BufferSize;
+    DWORD BufferUsed;
+    DWORD BytesNeeded;
+    PUCHAR NewBuffer;
+    BOOL Result;
+
+    //
+    //  Convert the line ending into the output encoding once.
+    //
+
+    LineEndLength = (DWORD)_tcslen(IconvContext->LineEnding);
+    LineEndLength = YoriLibGetMultibyteOutputSizeNeeded(IconvContext->LineEnding, (YORI_ALLOC_SIZE_T)LineEndLength);
+    if (LineEndLength > sizeof(LineEndBytes)) {
+        return FALSE;
+    }
+    YoriLibMultibyteOutput(IconvContext->LineEnding, (YORI_ALLOC_SIZE_T)_tcslen(IconvContext->LineEnding), (LPSTR)LineEndBytes, (YORI_ALLOC_SIZE_T)LineEndLength);
+
+    BufferSize = ICONV_OUTPUT_BUFFER_SIZE;
+    Buffer = YoriLibMalloc(BufferSize);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&ScratchString);
+    BufferUsed = 0;
+    Result = TRUE;
+
+    while (Result) {
+
+        if (!YoriLibReadLineViews(LineViews, ICONV_VIEWS_PER_READ, &ViewCount, &LineContext, hSource)) {
+            break;
+        }
+
+        for (Index = 0; Index < ViewCount; Index++) {
+
+            //
+            //  Ensure the buffer can hold the worst case expansion of this
+            //  line.  If it can't, write out what has been converted so
+            //  far, and if the line is larger than the buffer, enlarge
+            //  the buffer.
+            //
+
+            BytesNeeded = LineViews[Index].LengthInChars * ICONV_MAX_BYTES_PER_CHAR + LineEndLength;
+            if (BufferUsed + BytesNeeded > BufferSize) {
+                if (!IconvWriteBuffer(hOutput, Buffer, BufferUsed)) {
+                    Result = FALSE;
+                    break;
+                }
+                BufferUsed = 0;
+
+                if (BytesNeeded > BufferSize) {
+                    NewBuffer = YoriLibMalloc(BytesNeeded);
+                    if (NewBuffer == NULL) {
+                        Result = FALSE;
+                        break;
+                    }
+                    YoriLibFree(Buffer);
+                    Buffer = NewBuffer;
+                    BufferSize = BytesNeeded;
+                }
+            }
+
+            BufferUsed = BufferUsed + IconvConvertLineView(&LineViews[Index], IconvContext, &Buffer[BufferUsed], &ScratchString);
+            if (LineViews[Index].LineEnding != YoriLibLineEndingNone) {
+                memcpy(&Buffer[BufferUsed], LineEndBytes, LineEndLength);
+                BufferUsed = BufferUsed + LineEndLength;
+            }
+        }
+    }
+
+    if (Result && BufferUsed > 0) {
+        Result = IconvWriteBuffer(hOutput, Buffer, BufferUsed);
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&ScratchString);
+    YoriLibFree(Buffer);
+
+    return Result;
+}
+
 /**
  Convert the encoding of an opened stream by reading the source with the
  requested encoding, then writing to the destination with the requested
@@ -117,6 +454,8 @@ IconvProcessStream(
     LPTSTR OriginalLineEnding;
     BOOL TimeoutReached;
     YORI_LIB_LINE_ENDING LineEnding;
+    HANDLE hOutput;
+    DWORD ConsoleMode;
 
     IconvContext->FilesFound++;
 
@@ -128,6 +467,21 @@ IconvProcessStream(
     YoriLibSetMultibyteOutputEncoding(IconvContext->TargetEncoding);
     YoriLibVtSetLineEnding(IconvContext->LineEnding);
 
+    //
+    //  If the output is not a console, convert in bulk.  Console output
+    //  is converted line by line since its position affects whether a
+    //  line ending is needed.
+    //
+
+    hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (!GetConsoleMode(hOutput, &ConsoleMode)) {
+        IconvProcessStreamBlocks(hSource, hOutput, IconvContext);
+        YoriLibSetMultibyteInputEncoding(OriginalInputEncoding);
+        YoriLibSetMultibyteOutputEncoding(OriginalOutputEncoding);
+        YoriLibVtSetLineEnding(OriginalLineEnding);
+        return TRUE;
+    }
+
     YoriLibInitEmptyString(&LineString);
 
     while (TRUE) {
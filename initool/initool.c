@@ -36,17 +36,29 @@ CHAR strIniToolHelpText[] =
         "Query or set values in INI files.\n"
         "\n"
         "INITOOL [-license]\n"
+        "INITOOL -b <file> [<script>]\n"
         "INITOOL -d <file> <section> [<key>]\n"
         "INITOOL -l <file> <section>\n"
         "INITOOL -r <file> <section> <key>\n"
         "INITOOL -s <file>\n"
         "INITOOL -w <file> <section> <key> <value>\n"
         "\n"
+        "   -b             Apply commands from a script or standard input to an INI file\n"
         "   -d             Delete a specified key from an INI file\n"
         "   -l             List key/value pairs in a specified section from an INI file\n"
         "   -r             Read a specified key from an INI file\n"
         "   -s             List sections in an INI file\n"
-        "   -w             Write a specified value to an INI file\n";
+        "   -w             Write a specified value to an INI file\n"
+        "\n"
+        "With -b, the INI file is read once, each command is applied in memory, and\n"
+        "the file is written once if anything changed.  Each line of the script is\n"
+        "one of:\n"
+        "\n"
+        "   d <section> [<key>]\n"
+        "   l <section>\n"
+        "   r <section> <key>\n"
+        "   s\n"
+        "   w <section> <key> <value>\n";
 
 /**
  Display usage text to the user.
@@ -283,6 +295,1018 @@ IniToolWriteToIniFile(
     return TRUE;
 }
 
+/**
+ A single line within an INI file.
+ */
+typedef struct _INITOOL_INI_LINE {
+
+    /**
+     The list of lines within a section.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The text of the line, without any line ending.
+     */
+    YORI_STRING Line;
+
+    /**
+     If the line contains a key value pair, the key.  This refers to memory
+     within Line.  If the line is a comment or blank, this is empty.
+     */
+    YORI_STRING Key;
+
+    /**
+     If the line contains a key value pair, the value.  This refers to
+     memory within Line.
+     */
+    YORI_STRING Value;
+} INITOOL_INI_LINE, *PINITOOL_INI_LINE;
+
+/**
+ A section within an INI file.
+ */
+typedef struct _INITOOL_INI_SECTION {
+
+    /**
+     The list of sections within the INI file.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The text of the line containing the section header.  This is empty for
+     the lines at the start of the file which precede any section.
+     */
+    YORI_STRING HeaderLine;
+
+    /**
+     The name of the section.  This refers to memory within HeaderLine.
+     */
+    YORI_STRING Name;
+
+    /**
+     The list of INITOOL_INI_LINE entries following the section header.
+     */
+    YORI_LIST_ENTRY Lines;
+} INITOOL_INI_SECTION, *PINITOOL_INI_SECTION;
+
+/**
+ An INI file loaded into memory.  This allows many operations to be applied
+ while parsing the file once and writing it once.
+ */
+typedef struct _INITOOL_INI {
+
+    /**
+     The list of INITOOL_INI_SECTION entries in file order.
+     */
+    YORI_LIST_ENTRY Sections;
+
+    /**
+     The encoding of the file.
+     */
+    DWORD Encoding;
+
+    /**
+     TRUE if the file started with a byte order mark which should be
+     preserved when it is written.
+     */
+    BOOLEAN WriteBom;
+
+    /**
+     TRUE if the INI file has been changed since it was loaded.
+     */
+    BOOLEAN Modified;
+} INITOOL_INI, *PINITOOL_INI;
+
+/**
+ Remove spaces and tabs from the beginning and end of a string.
+
+ @param String Pointer to the string to trim.
+ */
+VOID
+IniToolTrimWhitespace(
+    __inout PYORI_STRING String
+    )
+{
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[0] == ' ' || String->StartOfString[0] == '\t')) {
+        String->StartOfString++;
+        String->LengthInChars--;
+    }
+
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[String->LengthInChars - 1] == ' ' ||
+            String->StartOfString[String->LengthInChars - 1] == '\t')) {
+        String->LengthInChars--;
+    }
+}
+
+/**
+ Allocate a line and parse it into a key and value if it contains one.
+
+ @param Text Pointer to the text of the line.
+
+ @return Pointer to the newly allocated line, or NULL on allocation failure.
+ */
+PINITOOL_INI_LINE
+IniToolAllocateLine(
+    __in PYORI_STRING Text
+    )
+{
+    PINITOOL_INI_LINE Line;
+    YORI_STRING Trimmed;
+    YORI_ALLOC_SIZE_T Index;
+
+    Line = YoriLibMalloc(sizeof(INITOOL_INI_LINE));
+    if (Line == NULL) {
+        return NULL;
+    }
+
+    if (!YoriLibAllocateString(&Line->Line, Text->LengthInChars + 1)) {
+        YoriLibFree(Line);
+        return NULL;
+    }
+
+    memcpy(Line->Line.StartOfString, Text->StartOfString, Text->LengthInChars * sizeof(TCHAR));
+    Line->Line.LengthInChars = Text->LengthInChars;
+    Line->Line.StartOfString[Line->Line.LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Line->Key);
+    YoriLibInitEmptyString(&Line->Value);
+
+    YoriLibInitEmptyString(&Trimmed);
+    Trimmed.StartOfString = Line->Line.StartOfString;
+    Trimmed.LengthInChars = Line->Line.LengthInChars;
+    IniToolTrimWhitespace(&Trimmed);
+    if (Trimmed.LengthInChars > 0 && Trimmed.StartOfString[0] == ';') {
+        return Line;
+    }
+
+    for (Index = 0; Index < Line->Line.LengthInChars; Index++) {
+        if (Line->Line.StartOfString[Index] == '=') {
+            Line->Key.StartOfString = Line->Line.StartOfString;
+            Line->Key.LengthInChars = Index;
+            IniToolTrimWhitespace(&Line->Key);
+
+            Line->Value.StartOfString = &Line->Line.StartOfString[Index + 1];
+            Line->Value.LengthInChars = Line->Line.LengthInChars - Index - 1;
+            IniToolTrimWhitespace(&Line->Value);
+            break;
+        }
+    }
+
+    return Line;
+}
+
+/**
+ Free a line within an INI file.
+
+ @param Line Pointer to the line to free.  This should have been removed from
+        any list.
+ */
+VOID
+IniToolFreeLine(
+    __in PINITOOL_INI_LINE Line
+    )
+{
+    YoriLibFreeStringContents(&Line->Line);
+    YoriLibFree(Line);
+}
+
+/**
+ Allocate a new section and append it to the end of the INI file.
+
+ @param Ini Pointer to the INI file.
+
+ @param HeaderText Optionally points to the text of the section header line.
+        If not specified, the section contains lines preceeding any section.
+
+ @return Pointer to the newly allocated section, or NULL on allocation
+         failure.
+ */
+PINITOOL_INI_SECTION
+IniToolAppendSection(
+    __in PINITOOL_INI Ini,
+    __in_opt PYORI_STRING HeaderText
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    YORI_ALLOC_SIZE_T Index;
+
+    Section = YoriLibMalloc(sizeof(INITOOL_INI_SECTION));
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    YoriLibInitEmptyString(&Section->HeaderLine);
+    YoriLibInitEmptyString(&Section->Name);
+    YoriLibInitializeListHead(&Section->Lines);
+
+    if (HeaderText != NULL) {
+        if (!YoriLibAllocateString(&Section->HeaderLine, HeaderText->LengthInChars + 1)) {
+            YoriLibFree(Section);
+            return NULL;
+        }
+
+        memcpy(Section->HeaderLine.StartOfString, HeaderText->StartOfString, HeaderText->LengthInChars * sizeof(TCHAR));
+        Section->HeaderLine.LengthInChars = HeaderText->LengthInChars;
+        Section->HeaderLine.StartOfString[Section->HeaderLine.LengthInChars] = '\0';
+
+        Section->Name.StartOfString = Section->HeaderLine.StartOfString;
+        Section->Name.LengthInChars = Section->HeaderLine.LengthInChars;
+        IniToolTrimWhitespace(&Section->Name);
+        if (Section->Name.LengthInChars > 0 && Section->Name.StartOfString[0] == '[') {
+            Section->Name.StartOfString++;
+            Section->Name.LengthInChars--;
+        }
+        for (Index = 0; Index < Section->Name.LengthInChars; Index++) {
+            if (Section->Name.StartOfString[Index] == ']') {
+                Section->Name.LengthInChars = Index;
+                break;
+            }
+        }
+        IniToolTrimWhitespace(&Section->Name);
+    }
+
+    YoriLibAppendList(&Ini->Sections, &Section->ListEntry);
+    return Section;
+}
+
+/**
+ Free a section and all of the lines within it.
+
+ @param Section Pointer to the section to free.  This should have been
+        removed from the INI file.
+ */
+VOID
+IniToolFreeSection(
+    __in PINITOOL_INI_SECTION Section
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PINITOOL_INI_LINE Line;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, INITOOL_INI_LINE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+        YoriLibRemoveListItem(&Line->ListEntry);
+        IniToolFreeLine(Line);
+    }
+
+    YoriLibFreeStringContents(&Section->HeaderLine);
+    YoriLibFree(Section);
+}
+
+/**
+ Free all sections within an INI file.
+
+ @param Ini Pointer to the INI file.
+ */
+VOID
+IniToolFreeIni(
+    __in PINITOOL_INI Ini
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PINITOOL_INI_SECTION Section;
+
+    ListEntry = YoriLibGetNextListEntry(&Ini->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, INITOOL_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Ini->Sections, ListEntry);
+        YoriLibRemoveListItem(&Section->ListEntry);
+        IniToolFreeSection(Section);
+    }
+}
+
+/**
+ Find a section within an INI file.  As with the profile APIs, names are
+ compared case insensitively and the first matching section is used.
+
+ @param Ini Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @return Pointer to the section, or NULL if it is not found.
+ */
+PINITOOL_INI_SECTION
+IniToolFindSection(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING SectionName
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PINITOOL_INI_SECTION Section;
+
+    ListEntry = YoriLibGetNextListEntry(&Ini->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, INITOOL_INI_SECTION, ListEntry);
+        if (Section->HeaderLine.LengthInChars > 0 &&
+            YoriLibCompareStringInsensitive(&Section->Name, SectionName) == 0) {
+            return Section;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Ini->Sections, ListEntry);
+    }
+
+    return NULL;
+}
+
+/**
+ Find a key within a section of an INI file.
+
+ @param Section Pointer to the section.
+
+ @param KeyName Pointer to the name of the key.
+
+ @return Pointer to the line containing the key, or NULL if it is not found.
+ */
+PINITOOL_INI_LINE
+IniToolFindKey(
+    __in PINITOOL_INI_SECTION Section,
+    __in PYORI_STRING KeyName
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PINITOOL_INI_LINE Line;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, INITOOL_INI_LINE, ListEntry);
+        if (Line->Key.LengthInChars > 0 &&
+            YoriLibCompareStringInsensitive(&Line->Key, KeyName) == 0) {
+            return Line;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+    }
+
+    return NULL;
+}
+
+/**
+ Load an INI file into memory.  A file which does not exist is treated as
+ empty, since writing to it will create it.
+
+ @param Ini Pointer to the INI file to populate.
+
+ @param FileName Pointer to the fully qualified file name.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolLoadIni(
+    __out PINITOOL_INI Ini,
+    __in PYORI_STRING FileName
+    )
+{
+    HANDLE hFile;
+    UCHAR Bom[3];
+    DWORD BytesRead;
+    DWORD SavedEncoding;
+    PVOID LineContext;
+    YORI_STRING LineString;
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE Line;
+    YORI_STRING Trimmed;
+    BOOL Result;
+
+    YoriLibInitializeListHead(&Ini->Sections);
+    Ini->Encoding = CP_ACP;
+    Ini->WriteBom = FALSE;
+    Ini->Modified = FALSE;
+
+    Section = IniToolAppendSection(Ini, NULL);
+    if (Section == NULL) {
+        return FALSE;
+    }
+
+    hFile = CreateFile(FileName->StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND) {
+            return TRUE;
+        }
+        IniToolFreeIni(Ini);
+        return FALSE;
+    }
+
+    //
+    //  The profile APIs treat files as ANSI unless they start with a byte
+    //  order mark.  Detect the encoding so the file can be written back in
+    //  the same form.
+    //
+
+    if (ReadFile(hFile, Bom, sizeof(Bom), &BytesRead, NULL)) {
+        if (BytesRead >= 2 && Bom[0] == 0xFF && Bom[1] == 0xFE) {
+            Ini->Encoding = CP_UTF16;
+            Ini->WriteBom = TRUE;
+        } else if (BytesRead >= 3 && Bom[0] == 0xEF && Bom[1] == 0xBB && Bom[2] == 0xBF) {
+            Ini->Encoding = CP_UTF8;
+            Ini->WriteBom = TRUE;
+        }
+    }
+    SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+
+    SavedEncoding = YoriLibGetMultibyteInputEncoding();
+    YoriLibSetMultibyteInputEncoding(Ini->Encoding);
+
+    Result = TRUE;
+    LineContext = NULL;
+    YoriLibInitEmptyString(&LineString);
+    while (YoriLibReadLineToString(&LineString, &LineContext, hFile)) {
+        YoriLibInitEmptyString(&Trimmed);
+        Trimmed.StartOfString = LineString.StartOfString;
+        Trimmed.LengthInChars = LineString.LengthInChars;
+        IniToolTrimWhitespace(&Trimmed);
+
+        if (Trimmed.LengthInChars > 0 && Trimmed.StartOfString[0] == '[') {
+            Section = IniToolAppendSection(Ini, &LineString);
+            if (Section == NULL) {
+                Result = FALSE;
+                break;
+            }
+        } else {
+            Line = IniToolAllocateLine(&LineString);
+            if (Line == NULL) {
+                Result = FALSE;
+                break;
+            }
+            YoriLibAppendList(&Section->Lines, &Line->ListEntry);
+        }
+    }
+
+    YoriLibSetMultibyteInputEncoding(SavedEncoding);
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hFile);
+
+    if (!Result) {
+        IniToolFreeIni(Ini);
+    }
+    return Result;
+}
+
+/**
+ Write a single line to an INI file being saved.
+
+ @param hFile Handle to the file.
+
+ @param Text Pointer to the text of the line, not including the line ending.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolWriteLine(
+    __in HANDLE hFile,
+    __in PYORI_STRING Text
+    )
+{
+    YORI_STRING Newline;
+
+    YoriLibConstantString(&Newline, _T("\r\n"));
+    if (Text->LengthInChars > 0 && !YoriLibOutputTextToMultibyteDevice(hFile, Text)) {
+        return FALSE;
+    }
+    return YoriLibOutputTextToMultibyteDevice(hFile, &Newline);
+}
+
+/**
+ Write an INI file from memory.  The contents are written to a temporary
+ file in the same directory which then replaces the original, so the file
+ is either fully updated or left unchanged.
+
+ @param Ini Pointer to the INI file.
+
+ @param FileName Pointer to the fully qualified file name.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolSaveIni(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING FileName
+    )
+{
+    YORI_STRING ParentDirectory;
+    YORI_STRING Prefix;
+    YORI_STRING TempFileName;
+    HANDLE TempHandle;
+    PYORI_LIST_ENTRY SectionEntry;
+    PYORI_LIST_ENTRY LineEntry;
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE Line;
+    YORI_ALLOC_SIZE_T Index;
+    DWORD SavedEncoding;
+    DWORD BytesWritten;
+    UCHAR BomBuffer[3];
+    DWORD BomLength;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&ParentDirectory);
+    for (Index = FileName->LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(FileName->StartOfString[Index - 1])) {
+            ParentDirectory.StartOfString = FileName->StartOfString;
+            ParentDirectory.LengthInChars = Index - 1;
+            break;
+        }
+    }
+
+    if (Index == 0) {
+        YoriLibConstantString(&ParentDirectory, _T("."));
+    }
+
+    YoriLibConstantString(&Prefix, _T("YINI"));
+
+    if (!YoriLibGetTempFileName(&ParentDirectory, &Prefix, &TempHandle, &TempFileName)) {
+        return FALSE;
+    }
+
+    Result = TRUE;
+    if (Ini->WriteBom) {
+        BomLength = 0;
+        if (Ini->Encoding == CP_UTF8) {
+            BomBuffer[0] = 0xEF;
+            BomBuffer[1] = 0xBB;
+            BomBuffer[2] = 0xBF;
+            BomLength = 3;
+        } else if (Ini->Encoding == CP_UTF16) {
+            BomBuffer[0] = 0xFF;
+            BomBuffer[1] = 0xFE;
+            BomLength = 2;
+        }
+
+        if (BomLength > 0 &&
+            !WriteFile(TempHandle, BomBuffer, BomLength, &BytesWritten, NULL)) {
+            Result = FALSE;
+        }
+    }
+
+    SavedEncoding = YoriLibGetMultibyteOutputEncoding();
+    YoriLibSetMultibyteOutputEncoding(Ini->Encoding);
+
+    SectionEntry = YoriLibGetNextListEntry(&Ini->Sections, NULL);
+    while (Result && SectionEntry != NULL) {
+        Section = CONTAINING_RECORD(SectionEntry, INITOOL_INI_SECTION, ListEntry);
+        if (Section->HeaderLine.LengthInChars > 0 &&
+            !IniToolWriteLine(TempHandle, &Section->HeaderLine)) {
+            Result = FALSE;
+            break;
+        }
+
+        LineEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+        while (LineEntry != NULL) {
+            Line = CONTAINING_RECORD(LineEntry, INITOOL_INI_LINE, ListEntry);
+            if (!IniToolWriteLine(TempHandle, &Line->Line)) {
+                Result = FALSE;
+                break;
+            }
+            LineEntry = YoriLibGetNextListEntry(&Section->Lines, LineEntry);
+        }
+        SectionEntry = YoriLibGetNextListEntry(&Ini->Sections, SectionEntry);
+    }
+
+    YoriLibSetMultibyteOutputEncoding(SavedEncoding);
+
+    if (Result && !FlushFileBuffers(TempHandle)) {
+        Result = FALSE;
+    }
+
+    CloseHandle(TempHandle);
+
+    //
+    //  Use ReplaceFile where possible to retain the attributes and security
+    //  of the original file, and fall back to a rename.
+    //
+
+    if (Result) {
+        Result = FALSE;
+        if (DllKernel32.pReplaceFileW != NULL &&
+            GetFileAttributes(FileName->StartOfString) != (DWORD)-1) {
+
+            Result = DllKernel32.pReplaceFileW(FileName->StartOfString, TempFileName.StartOfString, NULL, 0, NULL, NULL);
+        }
+
+        if (!Result) {
+            Result = MoveFileEx(TempFileName.StartOfString, FileName->StartOfString, MOVEFILE_REPLACE_EXISTING);
+        }
+    }
+
+    if (!Result) {
+        DeleteFile(TempFileName.StartOfString);
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+    return Result;
+}
+
+/**
+ Set a value in an INI file in memory, creating the section and key if they
+ do not exist.
+
+ @param Ini Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param KeyName Pointer to the name of the key.
+
+ @param Value Pointer to the value.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolSetValue(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING SectionName,
+    __in PYORI_STRING KeyName,
+    __in PYORI_STRING Value
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE ExistingLine;
+    PINITOOL_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY InsertAfter;
+    YORI_STRING Text;
+
+    Section = IniToolFindSection(Ini, SectionName);
+    if (Section == NULL) {
+        if (!YoriLibAllocateString(&Text, SectionName->LengthInChars + 3)) {
+            return FALSE;
+        }
+        Text.LengthInChars = YoriLibSPrintf(Text.StartOfString, _T("[%y]"), SectionName);
+        Section = IniToolAppendSection(Ini, &Text);
+        YoriLibFreeStringContents(&Text);
+        if (Section == NULL) {
+            return FALSE;
+        }
+    }
+
+    if (!YoriLibAllocateString(&Text, KeyName->LengthInChars + 1 + Value->LengthInChars + 1)) {
+        return FALSE;
+    }
+    Text.LengthInChars = YoriLibSPrintf(Text.StartOfString, _T("%y=%y"), KeyName, Value);
+    Line = IniToolAllocateLine(&Text);
+    YoriLibFreeStringContents(&Text);
+    if (Line == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Replace an existing key in place.  Otherwise add the key after the
+    //  last key in the section, so any trailing blank lines or comments
+    //  stay between this section and the next.
+    //
+
+    ExistingLine = IniToolFindKey(Section, KeyName);
+    if (ExistingLine != NULL) {
+        InsertAfter = &ExistingLine->ListEntry;
+    } else {
+        InsertAfter = &Section->Lines;
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+        while (ListEntry != NULL) {
+            if (CONTAINING_RECORD(ListEntry, INITOOL_INI_LINE, ListEntry)->Key.LengthInChars > 0) {
+                InsertAfter = ListEntry;
+            }
+            ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+        }
+    }
+
+    YoriLibInsertList(InsertAfter, &Line->ListEntry);
+    if (ExistingLine != NULL) {
+        YoriLibRemoveListItem(&ExistingLine->ListEntry);
+        IniToolFreeLine(ExistingLine);
+    }
+
+    Ini->Modified = TRUE;
+    return TRUE;
+}
+
+/**
+ Delete a key or an entire section from an INI file in memory.
+
+ @param Ini Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param KeyName Optionally points to the name of the key to delete.  If not
+        specified, the entire section is deleted.
+ */
+VOID
+IniToolDeleteValue(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING SectionName,
+    __in_opt PYORI_STRING KeyName
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE Line;
+
+    Section = IniToolFindSection(Ini, SectionName);
+    if (Section == NULL) {
+        return;
+    }
+
+    if (KeyName == NULL) {
+        YoriLibRemoveListItem(&Section->ListEntry);
+        IniToolFreeSection(Section);
+        Ini->Modified = TRUE;
+        return;
+    }
+
+    Line = IniToolFindKey(Section, KeyName);
+    if (Line != NULL) {
+        YoriLibRemoveListItem(&Line->ListEntry);
+        IniToolFreeLine(Line);
+        Ini->Modified = TRUE;
+    }
+}
+
+/**
+ Output a value from an INI file in memory.  As with the profile APIs, a
+ value enclosed in matching quotes is returned without them, and a value
+ that is not found is output as an empty line.
+
+ @param Ini Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section.
+
+ @param KeyName Pointer to the name of the key.
+ */
+VOID
+IniToolOutputValue(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING SectionName,
+    __in PYORI_STRING KeyName
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE Line;
+    YORI_STRING Value;
+
+    YoriLibInitEmptyString(&Value);
+    Section = IniToolFindSection(Ini, SectionName);
+    if (Section != NULL) {
+        Line = IniToolFindKey(Section, KeyName);
+        if (Line != NULL) {
+            Value.StartOfString = Line->Value.StartOfString;
+            Value.LengthInChars = Line->Value.LengthInChars;
+            if (Value.LengthInChars >= 2 &&
+                (Value.StartOfString[0] == '"' || Value.StartOfString[0] == '\'') &&
+                Value.StartOfString[Value.LengthInChars - 1] == Value.StartOfString[0]) {
+
+                Value.StartOfString++;
+                Value.LengthInChars -= 2;
+            }
+        }
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &Value);
+}
+
+/**
+ Output the key value pairs in a section of an INI file in memory.
+
+ @param Ini Pointer to the INI file.
+
+ @param SectionName Pointer to the name of the section.
+ */
+VOID
+IniToolOutputSection(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING SectionName
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    PINITOOL_INI_LINE Line;
+    PYORI_LIST_ENTRY ListEntry;
+
+    Section = IniToolFindSection(Ini, SectionName);
+    if (Section == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Section->Lines, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, INITOOL_INI_LINE, ListEntry);
+        if (Line->Key.LengthInChars > 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y=%y\n"), &Line->Key, &Line->Value);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Section->Lines, ListEntry);
+    }
+}
+
+/**
+ Output the names of all sections in an INI file in memory.
+
+ @param Ini Pointer to the INI file.
+ */
+VOID
+IniToolOutputSections(
+    __in PINITOOL_INI Ini
+    )
+{
+    PINITOOL_INI_SECTION Section;
+    PYORI_LIST_ENTRY ListEntry;
+
+    ListEntry = YoriLibGetNextListEntry(&Ini->Sections, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, INITOOL_INI_SECTION, ListEntry);
+        if (Section->HeaderLine.LengthInChars > 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &Section->Name);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Ini->Sections, ListEntry);
+    }
+}
+
+/**
+ Apply a single command from a batch script to an INI file in memory.
+ Commands take the same form as the command line, without the file name:
+
+   d <section> [<key>]
+   l <section>
+   r <section> <key>
+   s
+   w <section> <key> <value>
+
+ @param Ini Pointer to the INI file.
+
+ @param Command Pointer to the command line, which must be NULL terminated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolExecuteBatchCommand(
+    __in PINITOOL_INI Ini,
+    __in PYORI_STRING Command
+    )
+{
+    PYORI_STRING CmdArgV;
+    YORI_ALLOC_SIZE_T CmdArgC;
+    YORI_ALLOC_SIZE_T Index;
+    BOOL Result;
+
+    ASSERT(YoriLibIsStringNullTerminated(Command));
+
+    CmdArgV = YoriLibCmdlineToArgcArgv(Command->StartOfString, (YORI_ALLOC_SIZE_T)-1, FALSE, &CmdArgC);
+    if (CmdArgV == NULL) {
+        return FALSE;
+    }
+
+    Result = TRUE;
+    if (CmdArgC == 0) {
+        YoriLibDereference(CmdArgV);
+        return TRUE;
+    }
+
+    if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("w")) == 0 && CmdArgC == 4) {
+        Result = IniToolSetValue(Ini, &CmdArgV[1], &CmdArgV[2], &CmdArgV[3]);
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("r")) == 0 && CmdArgC == 3) {
+        IniToolOutputValue(Ini, &CmdArgV[1], &CmdArgV[2]);
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("d")) == 0 && CmdArgC == 3) {
+        IniToolDeleteValue(Ini, &CmdArgV[1], &CmdArgV[2]);
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("d")) == 0 && CmdArgC == 2) {
+        IniToolDeleteValue(Ini, &CmdArgV[1], NULL);
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("l")) == 0 && CmdArgC == 2) {
+        IniToolOutputSection(Ini, &CmdArgV[1]);
+    } else if (YoriLibCompareStringWithLiteralInsensitive(&CmdArgV[0], _T("s")) == 0 && CmdArgC == 1) {
+        IniToolOutputSections(Ini);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: command not understood: %y\n"), Command);
+        Result = FALSE;
+    }
+
+    for (Index = 0; Index < CmdArgC; Index++) {
+        YoriLibFreeStringContents(&CmdArgV[Index]);
+    }
+    YoriLibDereference(CmdArgV);
+    return Result;
+}
+
+/**
+ Load an INI file, apply a series of commands to it, and write it back once
+ if any command changed it.  This avoids the profile APIs reparsing and
+ rewriting the entire file for every key.
+
+ @param UserFileName Pointer to the file name of the INI file.
+
+ @param UserScriptName Optionally points to the file name containing
+        commands to apply.  If not specified, commands are read from
+        standard input.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolBatchIniFile(
+    __in PYORI_STRING UserFileName,
+    __in_opt PYORI_STRING UserScriptName
+    )
+{
+    YORI_STRING RealFileName;
+    YORI_STRING ScriptFileName;
+    YORI_STRING LineString;
+    YORI_STRING Trimmed;
+    INITOOL_INI Ini;
+    HANDLE hScript;
+    PVOID LineContext;
+    DWORD Mode;
+    BOOL Result;
+
+    if (!YoriLibUserStringToSingleFilePath(UserFileName, TRUE, &RealFileName)) {
+        return FALSE;
+    }
+
+    if (UserScriptName != NULL) {
+        if (!YoriLibUserStringToSingleFilePath(UserScriptName, TRUE, &ScriptFileName)) {
+            YoriLibFreeStringContents(&RealFileName);
+            return FALSE;
+        }
+
+        hScript = CreateFile(ScriptFileName.StartOfString,
+                             GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_DELETE,
+                             NULL,
+                             OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN,
+                             NULL);
+
+        if (hScript == INVALID_HANDLE_VALUE) {
+            LPTSTR ErrText = YoriLibGetWinErrorText(GetLastError());
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: open of %y failed: %s"), &ScriptFileName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            YoriLibFreeStringContents(&ScriptFileName);
+            YoriLibFreeStringContents(&RealFileName);
+            return FALSE;
+        }
+        YoriLibFreeStringContents(&ScriptFileName);
+    } else {
+        hScript = GetStdHandle(STD_INPUT_HANDLE);
+        if (GetConsoleMode(hScript, &Mode)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("No file or pipe for input\n"));
+            YoriLibFreeStringContents(&RealFileName);
+            return FALSE;
+        }
+    }
+
+    if (!IniToolLoadIni(&Ini, &RealFileName)) {
+        LPTSTR ErrText = YoriLibGetWinErrorText(GetLastError());
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: open of %y failed: %s"), &RealFileName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        if (UserScriptName != NULL) {
+            CloseHandle(hScript);
+        }
+        YoriLibFreeStringContents(&RealFileName);
+        return FALSE;
+    }
+
+    //
+    //  Blank lines and lines starting with # are ignored.  Processing stops
+    //  at the first command that fails, and nothing is written.
+    //
+
+    Result = TRUE;
+    LineContext = NULL;
+    YoriLibInitEmptyString(&LineString);
+    while (YoriLibReadLineToString(&LineString, &LineContext, hScript)) {
+        YoriLibInitEmptyString(&Trimmed);
+        Trimmed.StartOfString = LineString.StartOfString;
+        Trimmed.LengthInChars = LineString.LengthInChars;
+        IniToolTrimWhitespace(&Trimmed);
+        if (Trimmed.LengthInChars == 0 || Trimmed.StartOfString[0] == '#') {
+            continue;
+        }
+
+        if (!IniToolExecuteBatchCommand(&Ini, &LineString)) {
+            Result = FALSE;
+            break;
+        }
+    }
+
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    if (UserScriptName != NULL) {
+        CloseHandle(hScript);
+    }
+
+    if (Result && Ini.Modified) {
+        if (!IniToolSaveIni(&Ini, &RealFileName)) {
+            LPTSTR ErrText = YoriLibGetWinErrorText(GetLastError());
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: write of %y failed: %s"), &RealFileName, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            Result = FALSE;
+        }
+    }
+
+    IniToolFreeIni(&Ini);
+    YoriLibFreeStringContents(&RealFileName);
+    return Result;
+}
+
 /**
  A list of operations that the tool can perform.
  */
@@ -292,7 +1316,8 @@ typedef enum _INITOOL_OPERATION {
     IniToolOpReadValue = 2,
     IniToolOpDeleteValue = 3,
     IniToolOpListSection = 4,
-    IniToolOpListSections = 5
+    IniToolOpListSections = 5,
+    IniToolOpBatch = 6
 } INITOOL_OPERATION;
 
 #ifdef YORI_BUILTIN
@@ -344,6 +1369,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2018"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
+                Op = IniToolOpBatch;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 Op = IniToolOpDeleteValue;
                 ArgumentUnderstood = TRUE;
@@ -432,6 +1460,15 @@ ENTRYPOINT(
         if (!IniToolListSectionsFromIniFile(&ArgV[StartArg])) {
             return EXIT_FAILURE;
         }
+    } else if (Op == IniToolOpBatch) {
+        if (StartArg == 0 || StartArg + 1 > ArgC) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: missing argument\n"));
+            return EXIT_FAILURE;
+        }
+
+        if (!IniToolBatchIniFile(&ArgV[StartArg], (StartArg + 1 < ArgC)?&ArgV[StartArg + 1]:NULL)) {
+            return EXIT_FAILURE;
+        }
     }
 
     return EXIT_SUCCESS;
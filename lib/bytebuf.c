@@ -280,5 +280,438 @@ YoriLibByteBufferGetValidBytes(
     return Buffer->BytesPopulated;
 }
 
+/**
+ A single allocation within a chunk buffer.  The data immediately follows
+ this header.
+ */
+typedef struct _YORI_LIB_CHUNK_BUFFER_CHUNK {
+
+    /**
+     The link for this chunk within the buffer's list of chunks.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The number of bytes of data that can be stored in this chunk.
+     */
+    YORI_ALLOC_SIZE_T BytesAllocated;
+
+    /**
+     The number of bytes of data that are populated in this chunk.
+     */
+    YORI_ALLOC_SIZE_T BytesPopulated;
+
+} YORI_LIB_CHUNK_BUFFER_CHUNK, *PYORI_LIB_CHUNK_BUFFER_CHUNK;
+
+/**
+ The number of bytes to allocate in each chunk if the caller does not
+ specify a size.
+ */
+#define YORI_LIB_CHUNK_BUFFER_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ Return a pointer to the data within a chunk.
+ */
+#define YoriLibChunkBufferChunkData(Chunk) ((PUCHAR)((Chunk) + 1))
+
+/**
+ Initialize a chunk buffer.  Unlike a byte buffer, a chunk buffer grows by
+ adding new allocations to a list, so data that has already been written
+ is never moved.  The structure itself is owned by the caller.
+
+ @param Buffer Pointer to the buffer to initialize.
+
+ @param ChunkSize The number of bytes to allocate each time the buffer needs
+        to grow.  Can be zero to use a default size.
+
+ @return TRUE if the buffer is successfully initialized, FALSE if it is not.
+ */
+BOOL
+YoriLibChunkBufferInitialize(
+    __out PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T ChunkSize
+    )
+{
+    YoriLibInitializeListHead(&Buffer->Chunks);
+    Buffer->CurrentChunk = NULL;
+    Buffer->LookupChunk = NULL;
+    Buffer->LookupChunkOffset = 0;
+    Buffer->BytesPopulated = 0;
+
+    if (ChunkSize == 0) {
+        ChunkSize = YORI_LIB_CHUNK_BUFFER_DEFAULT_CHUNK_SIZE;
+    }
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)ChunkSize + sizeof(YORI_LIB_CHUNK_BUFFER_CHUNK))) {
+        return FALSE;
+    }
+
+    Buffer->ChunkSize = ChunkSize;
+    return TRUE;
+}
+
+/**
+ Free all allocations associated with a chunk buffer.
+
+ @param Buffer Pointer to the buffer to deallocate.
+ */
+VOID
+YoriLibChunkBufferCleanup(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, NULL);
+    while (ListEntry != NULL) {
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, ListEntry);
+        YoriLibRemoveListItem(&Chunk->ListEntry);
+        YoriLibFree(Chunk);
+    }
+
+    YoriLibChunkBufferInitialize(Buffer, Buffer->ChunkSize);
+}
+
+/**
+ Reset the buffer to prepare for reuse.  This retains any previous
+ allocations but indicates no valid contents within the buffer.
+
+ @param Buffer Pointer to the chunk buffer structure.
+ */
+VOID
+YoriLibChunkBufferReset(
+    __inout PYORI_LIB_CHUNK_BUFFER Buffer
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, NULL);
+    while (ListEntry != NULL) {
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        Chunk->BytesPopulated = 0;
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, ListEntry);
+    }
+
+    Buffer->CurrentChunk = NULL;
+    Buffer->LookupChunk = NULL;
+    Buffer->LookupChunkOffset = 0;
+    Buffer->BytesPopulated = 0;
+}
+
+/**
+ Get a pointer to the first invalid byte in the buffer so new data can be
+ written to it.  If the chunk currently being filled does not have enough
+ space, the next chunk is used, which may require a new allocation.  Any
+ space remaining in the previous chunk is not used.
+
+ @param Buffer Pointer to the chunk buffer structure.
+
+ @param MinimumLengthRequired Indicates the number of bytes that must be
+        available for newly valid data.
+
+ @param BytesAvailable On successful completion, optionally updated to
+        contain the number of bytes available in the buffer (ie., the number
+        of bytes that are invalid and can be written to.)
+
+ @return On successful completion, pointer to the buffer to write to.
+         Returns NULL on failure.
+ */
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetPointerToEnd(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T MinimumLengthRequired,
+    __out_opt PYORI_ALLOC_SIZE_T BytesAvailable
+    )
+{
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+    PYORI_LIB_CHUNK_BUFFER_CHUNK NewChunk;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY InsertAfter;
+    YORI_ALLOC_SIZE_T ChunkSize;
+
+    //
+    //  If the current chunk can hold the data, use it.
+    //
+
+    Chunk = NULL;
+    if (Buffer->CurrentChunk != NULL) {
+        Chunk = CONTAINING_RECORD(Buffer->CurrentChunk, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        if (Chunk->BytesAllocated - Chunk->BytesPopulated >= MinimumLengthRequired) {
+            goto Found;
+        }
+    }
+
+    //
+    //  Chunks after the current one are empty, left over from a previous
+    //  reset.  If the next one is large enough, use it, otherwise discard
+    //  it and allocate a new chunk in its place.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, Buffer->CurrentChunk);
+    if (ListEntry != NULL) {
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        ASSERT(Chunk->BytesPopulated == 0);
+        if (Chunk->BytesAllocated >= MinimumLengthRequired) {
+            Buffer->CurrentChunk = ListEntry;
+            goto Found;
+        }
+        YoriLibRemoveListItem(&Chunk->ListEntry);
+        YoriLibFree(Chunk);
+    }
+
+    ChunkSize = Buffer->ChunkSize;
+    if (ChunkSize < MinimumLengthRequired) {
+        ChunkSize = MinimumLengthRequired;
+    }
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)ChunkSize + sizeof(YORI_LIB_CHUNK_BUFFER_CHUNK))) {
+        return NULL;
+    }
+
+    NewChunk = YoriLibMalloc((YORI_ALLOC_SIZE_T)(ChunkSize + sizeof(YORI_LIB_CHUNK_BUFFER_CHUNK)));
+    if (NewChunk == NULL) {
+        return NULL;
+    }
+
+    NewChunk->BytesAllocated = ChunkSize;
+    NewChunk->BytesPopulated = 0;
+
+    InsertAfter = Buffer->CurrentChunk;
+    if (InsertAfter == NULL) {
+        InsertAfter = &Buffer->Chunks;
+    }
+    YoriLibInsertList(InsertAfter, &NewChunk->ListEntry);
+    Buffer->CurrentChunk = &NewChunk->ListEntry;
+    Chunk = NewChunk;
+
+Found:
+
+    if (BytesAvailable != NULL) {
+        *BytesAvailable = Chunk->BytesAllocated - Chunk->BytesPopulated;
+    }
+
+    return YoriLibAddToPointer(YoriLibChunkBufferChunkData(Chunk), Chunk->BytesPopulated);
+}
+
+/**
+ Indicate that the buffer has additional valid bytes.  These bytes must have
+ been written to the pointer most recently returned from
+ @ref YoriLibChunkBufferGetPointerToEnd .
+
+ @param Buffer Pointer to the chunk buffer structure.
+
+ @param NewBytesPopulated The number of newly valid bytes.  Note this is not
+        the total number of valid bytes.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  Failure implies
+         caller error where a caller is indicating more bytes to be valid than
+         the buffer contains.
+ */
+BOOLEAN
+YoriLibChunkBufferAddToPopulatedLength(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T NewBytesPopulated
+    )
+{
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+
+    if (Buffer->CurrentChunk == NULL) {
+        ASSERT(NewBytesPopulated == 0);
+        return (NewBytesPopulated == 0);
+    }
+
+    Chunk = CONTAINING_RECORD(Buffer->CurrentChunk, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+    ASSERT(NewBytesPopulated <= Chunk->BytesAllocated - Chunk->BytesPopulated);
+    if (NewBytesPopulated > Chunk->BytesAllocated - Chunk->BytesPopulated) {
+        return FALSE;
+    }
+
+    Chunk->BytesPopulated = Chunk->BytesPopulated + NewBytesPopulated;
+    Buffer->BytesPopulated = Buffer->BytesPopulated + NewBytesPopulated;
+    return TRUE;
+}
+
+/**
+ Get a pointer to data in the buffer that is already populated.  Because
+ the buffer is not contiguous, the returned range ends at the end of the
+ chunk containing the offset, and callers need to call again with a later
+ offset to find data in later chunks.  Sequential lookups are satisfied
+ without rescanning the chunk list.
+
+ @param Buffer Pointer to the chunk buffer structure.
+
+ @param BufferOffset Indicates the offset within the buffer to obtain a
+        pointer.
+
+ @param BytesAvailable On successful completion, optionally updated to
+        contain the number of contiguous valid bytes that can be read from
+        the returned pointer.
+
+ @return On successful completion, pointer to the buffer to read from.
+         Returns NULL on failure.
+ */
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetPointerToValidData(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_MAX_UNSIGNED_T BufferOffset,
+    __out_opt PYORI_ALLOC_SIZE_T BytesAvailable
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+    YORI_MAX_UNSIGNED_T ChunkOffset;
+    YORI_ALLOC_SIZE_T OffsetInChunk;
+
+    Chunk = NULL;
+    if (BufferOffset >= Buffer->BytesPopulated) {
+        return NULL;
+    }
+
+    ListEntry = Buffer->LookupChunk;
+    ChunkOffset = Buffer->LookupChunkOffset;
+    if (ListEntry == NULL || ChunkOffset > BufferOffset) {
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, NULL);
+        ChunkOffset = 0;
+    }
+
+    while (TRUE) {
+        ASSERT(ListEntry != NULL);
+        if (ListEntry == NULL) {
+            return NULL;
+        }
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        if (BufferOffset < ChunkOffset + Chunk->BytesPopulated) {
+            break;
+        }
+        ChunkOffset = ChunkOffset + Chunk->BytesPopulated;
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, ListEntry);
+    }
+
+    Buffer->LookupChunk = ListEntry;
+    Buffer->LookupChunkOffset = ChunkOffset;
+
+    OffsetInChunk = (YORI_ALLOC_SIZE_T)(BufferOffset - ChunkOffset);
+    if (BytesAvailable != NULL) {
+        *BytesAvailable = Chunk->BytesPopulated - OffsetInChunk;
+    }
+
+    return YoriLibAddToPointer(YoriLibChunkBufferChunkData(Chunk), OffsetInChunk);
+}
+
+/**
+ Enumerate the populated ranges within a chunk buffer in order.
+
+ @param Buffer Pointer to the chunk buffer structure.
+
+ @param Context On input, points to NULL to return the first range, or to
+        the value returned from a previous call to return the next range.
+        On successful completion, updated to refer to the returned range.
+
+ @param BytesAvailable On successful completion, updated to contain the
+        number of valid bytes in the returned range.
+
+ @return Pointer to the next range of valid data, or NULL if no further
+         data is present.
+ */
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetNextValidData(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __inout PVOID * Context,
+    __out PYORI_ALLOC_SIZE_T BytesAvailable
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_CHUNK_BUFFER_CHUNK Chunk;
+
+    Chunk = NULL;
+    ListEntry = *Context;
+    while (TRUE) {
+
+        //
+        //  Chunks after the current chunk are unused allocations from
+        //  before a reset.
+        //
+
+        if (ListEntry == Buffer->CurrentChunk && ListEntry != NULL) {
+            return NULL;
+        }
+
+        ListEntry = YoriLibGetNextListEntry(&Buffer->Chunks, ListEntry);
+        if (ListEntry == NULL || Buffer->CurrentChunk == NULL) {
+            return NULL;
+        }
+
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_CHUNK_BUFFER_CHUNK, ListEntry);
+        if (Chunk->BytesPopulated > 0) {
+            break;
+        }
+    }
+
+    *Context = ListEntry;
+    *BytesAvailable = Chunk->BytesPopulated;
+    return YoriLibChunkBufferChunkData(Chunk);
+}
+
+/**
+ Return the number of valid bytes that have been written to the buffer.
+
+ @param Buffer Pointer to the chunk buffer.
+
+ @return The number of valid bytes that have been written to the buffer.
+ */
+YORI_MAX_UNSIGNED_T
+YoriLibChunkBufferGetValidBytes(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer
+    )
+{
+    return Buffer->BytesPopulated;
+}
+
+/**
+ Write the entire contents of a chunk buffer to a handle.  Each chunk is
+ written directly from where it was received, so no data is copied.
+
+ @param Buffer Pointer to the chunk buffer.
+
+ @param hTarget Handle to write the data to.
+
+ @return TRUE to indicate all data was written, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibChunkBufferWriteToHandle(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in HANDLE hTarget
+    )
+{
+    PVOID Context;
+    PUCHAR Data;
+    YORI_ALLOC_SIZE_T BytesToWrite;
+    DWORD BytesWritten;
+
+    Context = NULL;
+    Data = YoriLibChunkBufferGetNextValidData(Buffer, &Context, &BytesToWrite);
+    while (Data != NULL) {
+        while (BytesToWrite > 0) {
+            if (!WriteFile(hTarget, Data, BytesToWrite, &BytesWritten, NULL) ||
+                BytesWritten == 0) {
+
+                return FALSE;
+            }
+
+            ASSERT(BytesWritten <= BytesToWrite);
+            Data = YoriLibAddToPointer(Data, BytesWritten);
+            BytesToWrite = BytesToWrite - BytesWritten;
+        }
+        Data = YoriLibChunkBufferGetNextValidData(Buffer, &Context, &BytesToWrite);
+    }
+
+    return TRUE;
+}
 
 // vim:sw=4:ts=4:et:
@@ -89,11 +89,119 @@ typedef struct _YORI_LIB_CAB_EXPAND_CONTEXT {
      */
     PYORI_STRING ErrorString;
 
+    /**
+     TRUE if files are being written by writer threads while decompression
+     continues.
+     */
+    BOOLEAN ParallelWrite;
+
+    /**
+     In parallel write mode, a mutex synchronizing updates to ErrorCode and
+     ErrorString and invocation of CompleteExtractCallback.
+     */
+    HANDLE Mutex;
+
+    /**
+     In parallel write mode, the queue of files waiting to be written.
+     */
+    YORILIB_WORK_QUEUE WriterQueue;
+
 } YORI_LIB_CAB_EXPAND_CONTEXT, *PYORI_LIB_CAB_EXPAND_CONTEXT;
 
+/**
+ The size of each buffer used to read ahead in files being added to a CAB.
+ */
+#define YORI_CAB_READ_AHEAD_BUFFER_SIZE (256 * 1024)
+
+/**
+ A single buffer used to read ahead in a file being added to a CAB.
+ */
+typedef struct _YORI_CAB_READ_AHEAD_BUFFER {
+
+    /**
+     The work item used to request the read from the reader thread.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The file to read from.
+     */
+    HANDLE hFile;
+
+    /**
+     An event signalled when the read has completed.
+     */
+    HANDLE CompleteEvent;
+
+    /**
+     The buffer to read into.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The number of bytes read into Buffer.
+     */
+    DWORD BytesRead;
+
+    /**
+     The number of bytes in Buffer that have been returned to FCI.
+     */
+    DWORD BytesConsumed;
+
+    /**
+     TRUE if the read succeeded, FALSE if it failed.
+     */
+    BOOLEAN Success;
+
+    /**
+     TRUE if a read has been requested and has not yet been waited for.
+     */
+    BOOLEAN Pending;
+} YORI_CAB_READ_AHEAD_BUFFER, *PYORI_CAB_READ_AHEAD_BUFFER;
+
+/**
+ State used to read ahead in a file being added to a CAB, so that reading
+ the next part of the file overlaps with compressing the current part.
+ */
+typedef struct _YORI_CAB_READ_AHEAD {
+
+    /**
+     A work queue with a single thread which performs reads.
+     */
+    YORILIB_WORK_QUEUE ReaderQueue;
+
+    /**
+     The file being read ahead, or INVALID_HANDLE_VALUE if no read ahead is
+     active.
+     */
+    HANDLE hFile;
+
+    /**
+     Two buffers.  While FCI consumes one, the other is being filled.
+     */
+    YORI_CAB_READ_AHEAD_BUFFER Buffers[2];
+
+    /**
+     The index of the buffer that FCI is consuming.
+     */
+    DWORD CurrentBuffer;
+
+    /**
+     TRUE once a read has returned less than a full buffer, indicating the
+     end of the file.
+     */
+    BOOLEAN EndOfFile;
+
+    /**
+     TRUE if the reader queue and buffers were successfully initialized.
+     */
+    BOOLEAN Initialized;
+} YORI_CAB_READ_AHEAD, *PYORI_CAB_READ_AHEAD;
+
 /**
  Context passed when adding files during compression operations.  Used here
- to indicate which encoding to use to interpret file names.
+ to indicate which encoding to use to interpret file names, and to read
+ ahead in the files being added.
  */
 typedef struct _YORI_CAB_ADD_CONTEXT {
 
@@ -113,6 +221,11 @@ typedef struct _YORI_CAB_ADD_CONTEXT {
      either.
      */
     BOOLEAN InCabNameIsUtf;
+
+    /**
+     State used to read ahead in the file currently being added.
+     */
+    YORI_CAB_READ_AHEAD ReadAhead;
 } YORI_CAB_ADD_CONTEXT, *PYORI_CAB_ADD_CONTEXT;
 
 /**
@@ -756,6 +869,266 @@ YoriLibCabFileOpenForExtract(
     return (DWORD_PTR)hFile;
 }
 
+/**
+ A work queue callback invoked on the reader thread to fill a read ahead
+ buffer.
+
+ @param Context Unused.
+
+ @param Item Pointer to the work item within the read ahead buffer.
+
+ @param Cancelled If TRUE, the operation has been cancelled, and the read is
+        failed without being performed.
+ */
+VOID
+YoriLibCabReadAheadWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORI_CAB_READ_AHEAD_BUFFER ReadBuffer;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    ReadBuffer = CONTAINING_RECORD(Item, YORI_CAB_READ_AHEAD_BUFFER, WorkItem);
+    ReadBuffer->BytesRead = 0;
+    ReadBuffer->BytesConsumed = 0;
+    ReadBuffer->Success = FALSE;
+    if (!Cancelled) {
+        ReadBuffer->Success = (BOOLEAN)ReadFile(ReadBuffer->hFile, ReadBuffer->Buffer, YORI_CAB_READ_AHEAD_BUFFER_SIZE, &ReadBuffer->BytesRead, NULL);
+    }
+    SetEvent(ReadBuffer->CompleteEvent);
+}
+
+/**
+ Request a read ahead buffer to be filled from the file being read ahead.
+ If the request cannot be queued, the read is performed synchronously.
+
+ @param ReadAhead Pointer to the read ahead state.
+
+ @param ReadBuffer Pointer to the buffer to fill.
+ */
+VOID
+YoriLibCabReadAheadQueue(
+    __in PYORI_CAB_READ_AHEAD ReadAhead,
+    __in PYORI_CAB_READ_AHEAD_BUFFER ReadBuffer
+    )
+{
+    ReadBuffer->hFile = ReadAhead->hFile;
+    ReadBuffer->Pending = TRUE;
+    ResetEvent(ReadBuffer->CompleteEvent);
+    if (!YoriLibQueueWorkItem(&ReadAhead->ReaderQueue, &ReadBuffer->WorkItem, TRUE)) {
+        YoriLibCabReadAheadWorker(NULL, &ReadBuffer->WorkItem, FALSE);
+    }
+}
+
+/**
+ Wait for any outstanding read to complete and stop reading ahead in the
+ current file.
+
+ @param ReadAhead Pointer to the read ahead state.
+
+ @return The number of bytes that have been read from the file but not
+         returned to FCI.
+ */
+DWORD
+YoriLibCabReadAheadStop(
+    __in PYORI_CAB_READ_AHEAD ReadAhead
+    )
+{
+    DWORD Index;
+    DWORD BytesUnconsumed;
+    PYORI_CAB_READ_AHEAD_BUFFER ReadBuffer;
+
+    BytesUnconsumed = 0;
+    for (Index = 0; Index < sizeof(ReadAhead->Buffers)/sizeof(ReadAhead->Buffers[0]); Index++) {
+        ReadBuffer = &ReadAhead->Buffers[Index];
+        if (ReadBuffer->Pending) {
+            WaitForSingleObject(ReadBuffer->CompleteEvent, INFINITE);
+            ReadBuffer->Pending = FALSE;
+        }
+        BytesUnconsumed = BytesUnconsumed + ReadBuffer->BytesRead - ReadBuffer->BytesConsumed;
+        ReadBuffer->BytesRead = 0;
+        ReadBuffer->BytesConsumed = 0;
+    }
+
+    ReadAhead->hFile = INVALID_HANDLE_VALUE;
+    return BytesUnconsumed;
+}
+
+/**
+ Start reading ahead in a file that is being added to a CAB.  Small files
+ are read synchronously since there's nothing to overlap.
+
+ @param ReadAhead Pointer to the read ahead state.
+
+ @param hFile The file to read ahead in.  The file must be positioned at its
+        beginning.
+
+ @param FileSize The size of the file, in bytes.
+ */
+VOID
+YoriLibCabReadAheadStart(
+    __in PYORI_CAB_READ_AHEAD ReadAhead,
+    __in HANDLE hFile,
+    __in DWORDLONG FileSize
+    )
+{
+    if (!ReadAhead->Initialized) {
+        return;
+    }
+
+    if (ReadAhead->hFile != INVALID_HANDLE_VALUE) {
+        YoriLibCabReadAheadStop(ReadAhead);
+    }
+
+    if (FileSize <= YORI_CAB_READ_AHEAD_BUFFER_SIZE) {
+        return;
+    }
+
+    //
+    //  The second buffer starts out empty, so the first read from FCI
+    //  switches to the first buffer and starts filling the second.
+    //
+
+    ReadAhead->hFile = hFile;
+    ReadAhead->EndOfFile = FALSE;
+    ReadAhead->CurrentBuffer = 1;
+    YoriLibCabReadAheadQueue(ReadAhead, &ReadAhead->Buffers[0]);
+}
+
+/**
+ Read from a file that is being read ahead.
+
+ @param ReadAhead Pointer to the read ahead state.
+
+ @param Buffer Pointer to a block of memory to place read data.
+
+ @param ByteCount The number of bytes to read.
+
+ @return The number of bytes actually read or -1 on failure.
+ */
+DWORD
+YoriLibCabReadAheadRead(
+    __in PYORI_CAB_READ_AHEAD ReadAhead,
+    __out PVOID Buffer,
+    __in DWORD ByteCount
+    )
+{
+    PYORI_CAB_READ_AHEAD_BUFFER ReadBuffer;
+    PYORI_CAB_READ_AHEAD_BUFFER NextBuffer;
+    DWORD BytesReturned;
+    DWORD BytesToCopy;
+
+    BytesReturned = 0;
+    while (BytesReturned < ByteCount) {
+        ReadBuffer = &ReadAhead->Buffers[ReadAhead->CurrentBuffer];
+        if (ReadBuffer->BytesConsumed < ReadBuffer->BytesRead) {
+            BytesToCopy = ReadBuffer->BytesRead - ReadBuffer->BytesConsumed;
+            if (BytesToCopy > ByteCount - BytesReturned) {
+                BytesToCopy = ByteCount - BytesReturned;
+            }
+            memcpy(YoriLibAddToPointer(Buffer, BytesReturned), &ReadBuffer->Buffer[ReadBuffer->BytesConsumed], BytesToCopy);
+            ReadBuffer->BytesConsumed = ReadBuffer->BytesConsumed + BytesToCopy;
+            BytesReturned = BytesReturned + BytesToCopy;
+            continue;
+        }
+
+        if (ReadAhead->EndOfFile) {
+            break;
+        }
+
+        //
+        //  The current buffer is exhausted.  Wait for the other buffer,
+        //  switch to it, and start refilling this one.
+        //
+
+        NextBuffer = &ReadAhead->Buffers[1 - ReadAhead->CurrentBuffer];
+        ASSERT(NextBuffer->Pending);
+        WaitForSingleObject(NextBuffer->CompleteEvent, INFINITE);
+        NextBuffer->Pending = FALSE;
+        if (!NextBuffer->Success) {
+            return (DWORD)-1;
+        }
+
+        ReadAhead->CurrentBuffer = 1 - ReadAhead->CurrentBuffer;
+        if (NextBuffer->BytesRead < YORI_CAB_READ_AHEAD_BUFFER_SIZE) {
+            ReadAhead->EndOfFile = TRUE;
+        } else {
+            YoriLibCabReadAheadQueue(ReadAhead, ReadBuffer);
+        }
+    }
+
+    return BytesReturned;
+}
+
+/**
+ Initialize the read ahead state for a CAB being created.  If this fails,
+ files are read synchronously.
+
+ @param ReadAhead Pointer to the read ahead state to initialize.
+ */
+VOID
+YoriLibCabReadAheadInitialize(
+    __out PYORI_CAB_READ_AHEAD ReadAhead
+    )
+{
+    DWORD Index;
+
+    ZeroMemory(ReadAhead, sizeof(YORI_CAB_READ_AHEAD));
+    ReadAhead->hFile = INVALID_HANDLE_VALUE;
+
+    if (!YoriLibInitializeWorkQueue(&ReadAhead->ReaderQueue, 1, 1, YoriLibCabReadAheadWorker, NULL)) {
+        return;
+    }
+
+    for (Index = 0; Index < sizeof(ReadAhead->Buffers)/sizeof(ReadAhead->Buffers[0]); Index++) {
+        ReadAhead->Buffers[Index].CompleteEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (ReadAhead->Buffers[Index].CompleteEvent == NULL) {
+            return;
+        }
+        ReadAhead->Buffers[Index].Buffer = YoriLibMalloc(YORI_CAB_READ_AHEAD_BUFFER_SIZE);
+        if (ReadAhead->Buffers[Index].Buffer == NULL) {
+            return;
+        }
+    }
+
+    ReadAhead->Initialized = TRUE;
+}
+
+/**
+ Free the read ahead state for a CAB being created.
+
+ @param ReadAhead Pointer to the read ahead state to free.
+ */
+VOID
+YoriLibCabReadAheadCleanup(
+    __inout PYORI_CAB_READ_AHEAD ReadAhead
+    )
+{
+    DWORD Index;
+
+    if (ReadAhead->hFile != INVALID_HANDLE_VALUE) {
+        YoriLibCabReadAheadStop(ReadAhead);
+    }
+
+    YoriLibCleanupWorkQueue(&ReadAhead->ReaderQueue);
+
+    for (Index = 0; Index < sizeof(ReadAhead->Buffers)/sizeof(ReadAhead->Buffers[0]); Index++) {
+        if (ReadAhead->Buffers[Index].CompleteEvent != NULL) {
+            CloseHandle(ReadAhead->Buffers[Index].CompleteEvent);
+            ReadAhead->Buffers[Index].CompleteEvent = NULL;
+        }
+        if (ReadAhead->Buffers[Index].Buffer != NULL) {
+            YoriLibFree(ReadAhead->Buffers[Index].Buffer);
+            ReadAhead->Buffers[Index].Buffer = NULL;
+        }
+    }
+
+    ReadAhead->Initialized = FALSE;
+}
+
 /**
  A callback invoked during FDICopy to read from a file.  Note that these
  callbacks always refer to the "current file position".
@@ -769,7 +1142,8 @@ YoriLibCabFileOpenForExtract(
  @param Err Optionally points to an integer which could be populated with
         extra error information.
 
- @param Context Optionally points to user context, which is currently unused.
+ @param Context Optionally points to user context.  When creating a CAB,
+        this is the add context, which may be reading ahead in this file.
 
  @return The number of bytes actually read or -1 on failure.
  */
@@ -783,8 +1157,15 @@ YoriLibCabFciFileRead(
     )
 {
     DWORD BytesRead;
+    PYORI_CAB_ADD_CONTEXT AddContext;
+
     UNREFERENCED_PARAMETER(Err);
-    UNREFERENCED_PARAMETER(Context);
+
+    AddContext = (PYORI_CAB_ADD_CONTEXT)Context;
+    if (AddContext != NULL && AddContext->ReadAhead.hFile == (HANDLE)FileHandle) {
+        return YoriLibCabReadAheadRead(&AddContext->ReadAhead, Buffer, ByteCount);
+    }
+
     if (!ReadFile((HANDLE)FileHandle,
                   Buffer,
                   ByteCount,
@@ -888,7 +1269,8 @@ YoriLibCabFdiFileWrite(
  @param Err Optionally points to an integer which could be populated with
         extra error information.
 
- @param Context Optionally points to user context, which is currently unused.
+ @param Context Optionally points to user context.  When creating a CAB,
+        this is the add context, which may be reading ahead in this file.
 
  @return Zero for success, nonzero to indicate an error.
  */
@@ -899,8 +1281,14 @@ YoriLibCabFciFileClose(
     __inout_opt PVOID Context
     )
 {
+    PYORI_CAB_ADD_CONTEXT AddContext;
+
     UNREFERENCED_PARAMETER(Err);
-    UNREFERENCED_PARAMETER(Context);
+
+    AddContext = (PYORI_CAB_ADD_CONTEXT)Context;
+    if (AddContext != NULL && AddContext->ReadAhead.hFile == (HANDLE)FileHandle) {
+        YoriLibCabReadAheadStop(&AddContext->ReadAhead);
+    }
 
     CloseHandle((HANDLE)FileHandle);
     return 0;
@@ -933,7 +1321,8 @@ YoriLibCabFdiFileClose(
  @param Err Optionally points to an integer which could be populated with
         extra error information.
 
- @param Context Optionally points to user context, which is currently unused.
+ @param Context Optionally points to user context.  When creating a CAB,
+        this is the add context, which may be reading ahead in this file.
 
  @return The new file position.
  */
@@ -947,9 +1336,24 @@ YoriLibCabFciFileSeek(
     )
 {
     DWORD NewPosition;
+    DWORD BytesUnconsumed;
+    PYORI_CAB_ADD_CONTEXT AddContext;
 
     UNREFERENCED_PARAMETER(Err);
-    UNREFERENCED_PARAMETER(Context);
+
+    //
+    //  If reading ahead, the file position is beyond the position FCI
+    //  expects.  Stop reading ahead and move back to where FCI thinks the
+    //  file is before applying the seek.
+    //
+
+    AddContext = (PYORI_CAB_ADD_CONTEXT)Context;
+    if (AddContext != NULL && AddContext->ReadAhead.hFile == (HANDLE)FileHandle) {
+        BytesUnconsumed = YoriLibCabReadAheadStop(&AddContext->ReadAhead);
+        if (BytesUnconsumed > 0) {
+            SetFilePointer((HANDLE)FileHandle, -(LONG)BytesUnconsumed, NULL, FILE_CURRENT);
+        }
+    }
 
     NewPosition = SetFilePointer((HANDLE)FileHandle,
                                  DistanceToMove,
@@ -1187,6 +1591,7 @@ YoriLibCabFciGetOpenInfo(
     DWORD_PTR Handle;
     BY_HANDLE_FILE_INFORMATION FileInfo;
     PYORI_CAB_ADD_CONTEXT AddContext;
+    LARGE_INTEGER liFileSize;
     WORD NewAttributes;
     DWORD Encoding;
 
@@ -1204,6 +1609,9 @@ YoriLibCabFciGetOpenInfo(
     }
 
     GetFileInformationByHandle((HANDLE)Handle, &FileInfo);
+    liFileSize.HighPart = FileInfo.nFileSizeHigh;
+    liFileSize.LowPart = FileInfo.nFileSizeLow;
+    YoriLibCabReadAheadStart(&AddContext->ReadAhead, (HANDLE)Handle, liFileSize.QuadPart);
     NewAttributes = (WORD)(FileInfo.dwFileAttributes & 0x3F);
     if (AddContext->InCabNameIsUtf) {
         NewAttributes = (WORD)(NewAttributes | YORI_CAB_NAME_IS_UTF);
@@ -1214,46 +1622,563 @@ YoriLibCabFciGetOpenInfo(
     return Handle;
 }
 
+/**
+ Files up to this size are decompressed into memory and written by a writer
+ thread when the parallel write mode is used.  Larger files are written
+ directly by the thread performing decompression.
+ */
+#define YORI_LIB_CAB_MAX_BUFFERED_FILE_SIZE (1024 * 1024)
 
 /**
- A callback invoked during FDICopy to indicate events and state encountered
- while processing the CAB file.
+ The number of writer threads used in the parallel write mode.
+ */
+#define YORI_LIB_CAB_WRITER_THREADS (4)
 
- @param NotifyType The type of the notification.
+/**
+ The number of decompressed files that can be waiting for a writer thread.
+ Together with YORI_LIB_CAB_MAX_BUFFERED_FILE_SIZE, this bounds the memory
+ used by the parallel write mode.
+ */
+#define YORI_LIB_CAB_WRITER_QUEUE_DEPTH (16)
 
- @param Notification Pointer to a block of memory defining additional state
-        associated with the notification.  The meaning of the fields in
-        this structure are NotificationType specific.  The original FDI.H
-        header is the best documentation for the notifications and expected
-        transformations that can occur in this routine (don't bother with
-        MSDN.)
- 
- @return Type specific result.  Typically zero means success, and -1 means
-         error, although this is not always true.
+/**
+ In parallel write mode, every handle returned to FDI refers to one of these
+ structures, which allows the callbacks to distinguish the cabinet being read
+ from files being extracted.
  */
-DWORD_PTR DIAMONDAPI
-YoriLibCabNotify(
-    __in CAB_CB_FDI_NOTIFYTYPE NotifyType,
-    __in PCAB_CB_FDI_NOTIFICATION Notification
-    )
-{
-    FILETIME TimeToSet;
-    LARGE_INTEGER liTemp;
-    TIME_ZONE_INFORMATION Tzi;
-    PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext;
-    YORI_STRING FullPath;
-    YORI_STRING FileName;
-    DWORD_PTR Handle;
-    DWORD Encoding;
+typedef struct _YORI_LIB_CAB_PARALLEL_FILE {
 
-    switch(NotifyType) {
-        case YoriLibCabNotifyCopyFile:
-            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
+    /**
+     The work item used to hand this file to a writer thread.
+     */
+    YORILIB_WORK_ITEM WorkItem;
 
-            Encoding = CP_ACP;
-            if (Notification->HalfAttributes & YORI_CAB_NAME_IS_UTF) {
-                Encoding = CP_UTF8;
-            }
+    /**
+     The file handle.  For files being extracted into Buffer, this is
+     INVALID_HANDLE_VALUE until a writer thread creates the file.
+     */
+    HANDLE hFile;
+
+    /**
+     The full path to the file being extracted.
+     */
+    YORI_STRING FullPath;
+
+    /**
+     The path to the file being extracted relative to the target directory.
+     */
+    YORI_STRING FileName;
+
+    /**
+     If the file is being extracted into memory, the buffer containing its
+     contents.  NULL if the file is being written directly.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The number of bytes allocated in Buffer.
+     */
+    DWORD BufferSize;
+
+    /**
+     The number of bytes populated in Buffer.
+     */
+    DWORD BytesPopulated;
+
+    /**
+     The time to apply to the file once it has been written.
+     */
+    FILETIME FileTime;
+
+    /**
+     The attributes to apply to the file once it has been written.
+     */
+    DWORD Attributes;
+
+} YORI_LIB_CAB_PARALLEL_FILE, *PYORI_LIB_CAB_PARALLEL_FILE;
+
+/**
+ Allocate a structure describing a file in parallel write mode.
+
+ @return Pointer to the allocated structure, or NULL on failure.
+ */
+PYORI_LIB_CAB_PARALLEL_FILE
+YoriLibCabAllocateParallelFile(VOID)
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ParallelFile = YoriLibMalloc(sizeof(YORI_LIB_CAB_PARALLEL_FILE));
+    if (ParallelFile == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(ParallelFile, sizeof(YORI_LIB_CAB_PARALLEL_FILE));
+    ParallelFile->hFile = INVALID_HANDLE_VALUE;
+    YoriLibInitEmptyString(&ParallelFile->FullPath);
+    YoriLibInitEmptyString(&ParallelFile->FileName);
+    return ParallelFile;
+}
+
+/**
+ Free a structure describing a file in parallel write mode, closing any
+ handle that remains open.
+
+ @param ParallelFile Pointer to the structure to free.
+ */
+VOID
+YoriLibCabFreeParallelFile(
+    __in PYORI_LIB_CAB_PARALLEL_FILE ParallelFile
+    )
+{
+    if (ParallelFile->hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(ParallelFile->hFile);
+    }
+    if (ParallelFile->Buffer != NULL) {
+        YoriLibFree(ParallelFile->Buffer);
+    }
+    YoriLibFreeStringContents(&ParallelFile->FullPath);
+    YoriLibFreeStringContents(&ParallelFile->FileName);
+    YoriLibFree(ParallelFile);
+}
+
+/**
+ A callback invoked during FDICopy in parallel write mode to open a file.
+ From observation this is only used to open the cabinet itself.
+
+ @param FileName A NULL terminated narrow string indicating the file name.
+
+ @param OFlag The open flags.
+
+ @param PMode No idea (per MSDN.)
+
+ @return Pointer to a parallel file structure cast to a file handle, or
+         INVALID_HANDLE_VALUE on failure.
+ */
+DWORD_PTR DIAMONDAPI
+YoriLibCabFdiParallelFileOpen(
+    __in LPSTR FileName,
+    __in INT OFlag,
+    __in INT PMode
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+    DWORD_PTR Handle;
+
+    ParallelFile = YoriLibCabAllocateParallelFile();
+    if (ParallelFile == NULL) {
+        return (DWORD_PTR)INVALID_HANDLE_VALUE;
+    }
+
+    Handle = YoriLibCabFdiFileOpen(FileName, OFlag, PMode);
+    if (Handle == (DWORD_PTR)INVALID_HANDLE_VALUE) {
+        YoriLibCabFreeParallelFile(ParallelFile);
+        return (DWORD_PTR)INVALID_HANDLE_VALUE;
+    }
+
+    ParallelFile->hFile = (HANDLE)Handle;
+    return (DWORD_PTR)ParallelFile;
+}
+
+/**
+ A callback invoked during FDICopy in parallel write mode to read from a
+ file.
+
+ @param FileHandle Pointer to a parallel file structure cast to a handle.
+
+ @param Buffer Pointer to a block of memory to place read data.
+
+ @param ByteCount The number of bytes to read.
+
+ @return The number of bytes actually read or -1 on failure.
+ */
+DWORD DIAMONDAPI
+YoriLibCabFdiParallelFileRead(
+    __in DWORD_PTR FileHandle,
+    __out PVOID Buffer,
+    __in DWORD ByteCount
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ParallelFile = (PYORI_LIB_CAB_PARALLEL_FILE)FileHandle;
+    return YoriLibCabFciFileRead((DWORD_PTR)ParallelFile->hFile, Buffer, ByteCount, NULL, NULL);
+}
+
+/**
+ A callback invoked during FDICopy in parallel write mode to write to a file.
+ If the file is being extracted into memory, data is appended to its buffer.
+
+ @param FileHandle Pointer to a parallel file structure cast to a handle.
+
+ @param Buffer Pointer to a block of memory containing data to write.
+
+ @param ByteCount The number of bytes to write.
+
+ @return The number of bytes actually written or -1 on failure.
+ */
+DWORD DIAMONDAPI
+YoriLibCabFdiParallelFileWrite(
+    __in DWORD_PTR FileHandle,
+    __in PVOID Buffer,
+    __in DWORD ByteCount
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ParallelFile = (PYORI_LIB_CAB_PARALLEL_FILE)FileHandle;
+    if (ParallelFile->Buffer == NULL) {
+        return YoriLibCabFciFileWrite((DWORD_PTR)ParallelFile->hFile, Buffer, ByteCount, NULL, NULL);
+    }
+
+    if (ByteCount > ParallelFile->BufferSize - ParallelFile->BytesPopulated) {
+        return (DWORD)-1;
+    }
+
+    memcpy(&ParallelFile->Buffer[ParallelFile->BytesPopulated], Buffer, ByteCount);
+    ParallelFile->BytesPopulated = ParallelFile->BytesPopulated + ByteCount;
+    return ByteCount;
+}
+
+/**
+ A callback invoked during FDICopy in parallel write mode to close a file.
+ Files being extracted are normally completed via the close notification;
+ this is only invoked for them if extraction is abandoned.
+
+ @param FileHandle Pointer to a parallel file structure cast to a handle.
+
+ @return Zero for success, nonzero to indicate an error.
+ */
+INT DIAMONDAPI
+YoriLibCabFdiParallelFileClose(
+    __in DWORD_PTR FileHandle
+    )
+{
+    YoriLibCabFreeParallelFile((PYORI_LIB_CAB_PARALLEL_FILE)FileHandle);
+    return 0;
+}
+
+/**
+ A callback invoked during FDICopy in parallel write mode to change current
+ file position.
+
+ @param FileHandle Pointer to a parallel file structure cast to a handle.
+
+ @param DistanceToMove The number of bytes to move.
+
+ @param SeekType The origin of the move.
+
+ @return The new file position.
+ */
+DWORD DIAMONDAPI
+YoriLibCabFdiParallelFileSeek(
+    __in DWORD_PTR FileHandle,
+    __in DWORD DistanceToMove,
+    __in INT SeekType
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ParallelFile = (PYORI_LIB_CAB_PARALLEL_FILE)FileHandle;
+    return YoriLibCabFciFileSeek((DWORD_PTR)ParallelFile->hFile, DistanceToMove, SeekType, NULL, NULL);
+}
+
+/**
+ Finish extracting a file in parallel write mode.  If the file was
+ decompressed into memory, this creates the file and writes its contents.
+ The file time and attributes are then applied and the user's completion
+ callback is invoked.  This is called on writer threads for buffered files
+ and on the decompression thread for files written directly.
+
+ @param ExpandContext Pointer to the expand context.
+
+ @param ParallelFile Pointer to the file to complete.  This is freed by this
+        function.
+ */
+VOID
+YoriLibCabCompleteParallelFile(
+    __in PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext,
+    __in PYORI_LIB_CAB_PARALLEL_FILE ParallelFile
+    )
+{
+    DWORD_PTR Handle;
+    DWORD BytesWritten;
+    DWORD Err;
+
+    if (ParallelFile->Buffer != NULL) {
+        WaitForSingleObject(ExpandContext->Mutex, INFINITE);
+        Handle = YoriLibCabFileOpenForExtract(&ParallelFile->FullPath, &ExpandContext->ErrorCode, ExpandContext->ErrorString);
+        ReleaseMutex(ExpandContext->Mutex);
+        if (Handle == (DWORD_PTR)INVALID_HANDLE_VALUE) {
+            YoriLibCabFreeParallelFile(ParallelFile);
+            return;
+        }
+        ParallelFile->hFile = (HANDLE)Handle;
+
+        if (!WriteFile(ParallelFile->hFile, ParallelFile->Buffer, ParallelFile->BytesPopulated, &BytesWritten, NULL) ||
+            BytesWritten != ParallelFile->BytesPopulated) {
+
+            Err = GetLastError();
+            WaitForSingleObject(ExpandContext->Mutex, INFINITE);
+            if (ExpandContext->ErrorCode == ERROR_SUCCESS) {
+                ExpandContext->ErrorCode = Err;
+                if (ExpandContext->ErrorString != NULL) {
+                    LPTSTR ErrText;
+                    ErrText = YoriLibGetWinErrorText(Err);
+                    YoriLibYPrintf(ExpandContext->ErrorString, _T("Error writing %y: %s"), &ParallelFile->FullPath, ErrText);
+                    YoriLibFreeWinErrorText(ErrText);
+                }
+            }
+            ReleaseMutex(ExpandContext->Mutex);
+            YoriLibCabFreeParallelFile(ParallelFile);
+            return;
+        }
+    }
+
+    SetFileTime(ParallelFile->hFile, &ParallelFile->FileTime, &ParallelFile->FileTime, &ParallelFile->FileTime);
+    CloseHandle(ParallelFile->hFile);
+    ParallelFile->hFile = INVALID_HANDLE_VALUE;
+
+    SetFileAttributes(ParallelFile->FullPath.StartOfString, ParallelFile->Attributes);
+
+    //
+    //  The user's callback is not expected to be reentrant, so only one
+    //  thread invokes it at a time.
+    //
+
+    if (ExpandContext->CompleteExtractCallback != NULL) {
+        WaitForSingleObject(ExpandContext->Mutex, INFINITE);
+        ExpandContext->CompleteExtractCallback(&ParallelFile->FullPath, &ParallelFile->FileName, ExpandContext->UserContext);
+        ReleaseMutex(ExpandContext->Mutex);
+    }
+
+    YoriLibCabFreeParallelFile(ParallelFile);
+}
+
+/**
+ A work queue callback invoked on a writer thread to write a file that has
+ been decompressed into memory.
+
+ @param Context Pointer to the expand context.
+
+ @param Item Pointer to the work item within the parallel file structure.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should be discarded.
+ */
+VOID
+YoriLibCabParallelWriteWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext;
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Context;
+    ParallelFile = CONTAINING_RECORD(Item, YORI_LIB_CAB_PARALLEL_FILE, WorkItem);
+
+    if (Cancelled) {
+        YoriLibCabFreeParallelFile(ParallelFile);
+        return;
+    }
+
+    YoriLibCabCompleteParallelFile(ExpandContext, ParallelFile);
+}
+
+/**
+ Convert the DOS date and time from a cabinet notification into an NT file
+ time, adjusting for the local time zone.
+
+ @param Notification Pointer to the notification describing the file.
+
+ @param FileTime On completion, updated to contain the file time.
+ */
+VOID
+YoriLibCabNotificationToFileTime(
+    __in PCAB_CB_FDI_NOTIFICATION Notification,
+    __out PFILETIME FileTime
+    )
+{
+    LARGE_INTEGER liTemp;
+    TIME_ZONE_INFORMATION Tzi;
+
+    if (GetTimeZoneInformation(&Tzi) == TIME_ZONE_ID_INVALID) {
+        Tzi.Bias = 0;
+    }
+
+    //
+    //  Convert the DOS time into a local time zone relative NT time
+    //
+
+    YoriLibDosDateTimeToFileTime(Notification->TinyDate, Notification->TinyTime, FileTime);
+
+    //
+    //  Apply the time zone bias adjustment to the NT time
+    //
+
+    liTemp.LowPart = FileTime->dwLowDateTime;
+    liTemp.HighPart = FileTime->dwHighDateTime;
+    liTemp.QuadPart = liTemp.QuadPart + ((DWORDLONG)Tzi.Bias) * 10 * 1000 * 1000 * 60;
+    FileTime->dwLowDateTime = liTemp.LowPart;
+    FileTime->dwHighDateTime = liTemp.HighPart;
+}
+
+/**
+ Process a notification that FDI has a file to extract in parallel write
+ mode.  Small files are decompressed into memory for a writer thread to
+ write; larger files are created immediately and written directly.
+
+ @param ExpandContext Pointer to the expand context.
+
+ @param Notification Pointer to the notification describing the file.
+
+ @return Pointer to a parallel file structure cast to a handle, zero to skip
+         the file, or -1 to abort extraction.
+ */
+DWORD_PTR
+YoriLibCabParallelCopyFile(
+    __in PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext,
+    __in PCAB_CB_FDI_NOTIFICATION Notification
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+    DWORD_PTR Handle;
+    DWORD Encoding;
+
+    //
+    //  If a writer thread has failed, stop decompressing.
+    //
+
+    if (ExpandContext->ErrorCode != ERROR_SUCCESS) {
+        return (DWORD_PTR)-1;
+    }
+
+    ParallelFile = YoriLibCabAllocateParallelFile();
+    if (ParallelFile == NULL) {
+        return (DWORD_PTR)-1;
+    }
+
+    Encoding = CP_ACP;
+    if (Notification->HalfAttributes & YORI_CAB_NAME_IS_UTF) {
+        Encoding = CP_UTF8;
+    }
+
+    if (!YoriLibCabBuildFileNames(ExpandContext->TargetDirectory, Notification->String1, Encoding, &ParallelFile->FullPath, &ParallelFile->FileName)) {
+        WaitForSingleObject(ExpandContext->Mutex, INFINITE);
+        ExpandContext->ErrorCode = ERROR_NOT_ENOUGH_MEMORY;
+        if (ExpandContext->ErrorString != NULL) {
+            YoriLibYPrintf(ExpandContext->ErrorString, _T("Could not build file name for directory %y CAB name %hs"), ExpandContext->TargetDirectory, Notification->String1);
+        }
+        ReleaseMutex(ExpandContext->Mutex);
+        YoriLibCabFreeParallelFile(ParallelFile);
+        return (DWORD_PTR)-1;
+    }
+
+    if (!YoriLibCabShouldIncludeFile(&ParallelFile->FileName, ExpandContext) ||
+        (ExpandContext->CommenceExtractCallback != NULL &&
+         !ExpandContext->CommenceExtractCallback(&ParallelFile->FullPath, &ParallelFile->FileName, ExpandContext->UserContext))) {
+
+        YoriLibCabFreeParallelFile(ParallelFile);
+        return 0;
+    }
+
+    //
+    //  For this notification, StructureSize is the uncompressed file size.
+    //
+
+    if (Notification->StructureSize <= YORI_LIB_CAB_MAX_BUFFERED_FILE_SIZE) {
+        ParallelFile->BufferSize = Notification->StructureSize;
+        ParallelFile->Buffer = YoriLibMalloc(ParallelFile->BufferSize + 1);
+        if (ParallelFile->Buffer != NULL) {
+            return (DWORD_PTR)ParallelFile;
+        }
+        ParallelFile->BufferSize = 0;
+    }
+
+    WaitForSingleObject(ExpandContext->Mutex, INFINITE);
+    Handle = YoriLibCabFileOpenForExtract(&ParallelFile->FullPath, &ExpandContext->ErrorCode, ExpandContext->ErrorString);
+    ReleaseMutex(ExpandContext->Mutex);
+
+    if (Handle == (DWORD_PTR)INVALID_HANDLE_VALUE) {
+        YoriLibCabFreeParallelFile(ParallelFile);
+        return (DWORD_PTR)INVALID_HANDLE_VALUE;
+    }
+
+    ParallelFile->hFile = (HANDLE)Handle;
+    return (DWORD_PTR)ParallelFile;
+}
+
+/**
+ Process a notification that FDI has finished decompressing a file in
+ parallel write mode.  Files decompressed into memory are queued to a writer
+ thread, waiting for space if the queue is full.
+
+ @param ExpandContext Pointer to the expand context.
+
+ @param Notification Pointer to the notification describing the file.
+ */
+VOID
+YoriLibCabParallelCloseFile(
+    __in PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext,
+    __in PCAB_CB_FDI_NOTIFICATION Notification
+    )
+{
+    PYORI_LIB_CAB_PARALLEL_FILE ParallelFile;
+
+    ParallelFile = (PYORI_LIB_CAB_PARALLEL_FILE)Notification->FileHandle;
+    YoriLibCabNotificationToFileTime(Notification, &ParallelFile->FileTime);
+    ParallelFile->Attributes = Notification->HalfAttributes;
+
+    if (ParallelFile->Buffer != NULL &&
+        YoriLibQueueWorkItem(&ExpandContext->WriterQueue, &ParallelFile->WorkItem, TRUE)) {
+
+        return;
+    }
+
+    YoriLibCabCompleteParallelFile(ExpandContext, ParallelFile);
+}
+
+/**
+ A callback invoked during FDICopy to indicate events and state encountered
+ while processing the CAB file.
+
+ @param NotifyType The type of the notification.
+
+ @param Notification Pointer to a block of memory defining additional state
+        associated with the notification.  The meaning of the fields in
+        this structure are NotificationType specific.  The original FDI.H
+        header is the best documentation for the notifications and expected
+        transformations that can occur in this routine (don't bother with
+        MSDN.)
+ 
+ @return Type specific result.  Typically zero means success, and -1 means
+         error, although this is not always true.
+ */
+DWORD_PTR DIAMONDAPI
+YoriLibCabNotify(
+    __in CAB_CB_FDI_NOTIFYTYPE NotifyType,
+    __in PCAB_CB_FDI_NOTIFICATION Notification
+    )
+{
+    FILETIME TimeToSet;
+    PYORI_LIB_CAB_EXPAND_CONTEXT ExpandContext;
+    YORI_STRING FullPath;
+    YORI_STRING FileName;
+    DWORD_PTR Handle;
+    DWORD Encoding;
+
+    switch(NotifyType) {
+        case YoriLibCabNotifyCopyFile:
+            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
+            if (ExpandContext->ParallelWrite) {
+                return YoriLibCabParallelCopyFile(ExpandContext, Notification);
+            }
+
+            Encoding = CP_ACP;
+            if (Notification->HalfAttributes & YORI_CAB_NAME_IS_UTF) {
+                Encoding = CP_UTF8;
+            }
 
             if (!YoriLibCabBuildFileNames(ExpandContext->TargetDirectory, Notification->String1, Encoding, &FullPath, &FileName)) {
                 ExpandContext->ErrorCode = ERROR_NOT_ENOUGH_MEMORY;
@@ -1277,30 +2202,17 @@ YoriLibCabNotify(
             YoriLibFreeStringContents(&FileName);
             return Handle;
         case YoriLibCabNotifyCloseFile:
-            if (GetTimeZoneInformation(&Tzi) == TIME_ZONE_ID_INVALID) {
-                Tzi.Bias = 0;
+            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
+            if (ExpandContext->ParallelWrite) {
+                YoriLibCabParallelCloseFile(ExpandContext, Notification);
+                return 1;
             }
 
-            //
-            //  Convert the DOS time into a local time zone relative NT time
-            //
-
-            YoriLibDosDateTimeToFileTime(Notification->TinyDate, Notification->TinyTime, &TimeToSet);
-
-            //
-            //  Apply the time zone bias adjustment to the NT time
-            //
-
-            liTemp.LowPart = TimeToSet.dwLowDateTime;
-            liTemp.HighPart = TimeToSet.dwHighDateTime;
-            liTemp.QuadPart = liTemp.QuadPart + ((DWORDLONG)Tzi.Bias) * 10 * 1000 * 1000 * 60;
-            TimeToSet.dwLowDateTime = liTemp.LowPart;
-            TimeToSet.dwHighDateTime = liTemp.HighPart;
-
             //
             //  Set the time on the file
             //
 
+            YoriLibCabNotificationToFileTime(Notification, &TimeToSet);
             SetFileTime((HANDLE)Notification->FileHandle, &TimeToSet, &TimeToSet, &TimeToSet);
             YoriLibCabFdiFileClose(Notification->FileHandle);
 
@@ -1309,7 +2221,6 @@ YoriLibCabNotify(
                 Encoding = CP_UTF8;
             }
 
-            ExpandContext = (PYORI_LIB_CAB_EXPAND_CONTEXT)Notification->Context;
             if (YoriLibCabBuildFileNames(ExpandContext->TargetDirectory, Notification->String1, Encoding, &FullPath, &FileName)) {
                 SetFileAttributes(FullPath.StartOfString, Notification->HalfAttributes);
 
@@ -1362,6 +2273,12 @@ YoriLibCabNotify(
  @param UserContext Optionally points to context to pass to
         CommenceExtractCallback and CompleteExtractCallback.
 
+ @param ExtractFlags Flags modifying the extraction.  If
+        YORI_LIB_CAB_EXTRACT_PARALLEL_WRITE is specified, files are written
+        by a pool of writer threads while decompression continues.  In this
+        mode CompleteExtractCallback is invoked on writer threads, although
+        never concurrently.
+
  @param ErrorCode Optionally points to a value to populate with the error code
         encountered in the extraction process.
 
@@ -1383,6 +2300,7 @@ YoriLibExtractCab(
     __in_opt PYORI_LIB_CAB_EXPAND_FILE_CALLBACK CommenceExtractCallback,
     __in_opt PYORI_LIB_CAB_EXPAND_FILE_CALLBACK CompleteExtractCallback,
     __in_opt PVOID UserContext,
+    __in DWORD ExtractFlags,
     __inout_opt PDWORD ErrorCode,
     __inout_opt PYORI_STRING ErrorString
     )
@@ -1431,6 +2349,24 @@ YoriLibExtractCab(
     ExpandContext.ErrorCode = ERROR_SUCCESS;
     ExpandContext.ErrorString = ErrorString;
 
+    //
+    //  If the parallel write mode can't be set up, extract files
+    //  synchronously.
+    //
+
+    if (ExtractFlags & YORI_LIB_CAB_EXTRACT_PARALLEL_WRITE) {
+        ExpandContext.Mutex = CreateMutex(NULL, FALSE, NULL);
+        if (ExpandContext.Mutex != NULL) {
+            if (YoriLibInitializeWorkQueue(&ExpandContext.WriterQueue, YORI_LIB_CAB_WRITER_THREADS, YORI_LIB_CAB_WRITER_QUEUE_DEPTH, YoriLibCabParallelWriteWorker, &ExpandContext)) {
+                ExpandContext.ParallelWrite = TRUE;
+            } else {
+                YoriLibCleanupWorkQueue(&ExpandContext.WriterQueue);
+                CloseHandle(ExpandContext.Mutex);
+                ExpandContext.Mutex = NULL;
+            }
+        }
+    }
+
     if (!YoriLibUserStringToSingleFilePath(CabFileName, FALSE, &FullCabFileName)) {
         if (ErrorCode != NULL) {
             *ErrorCode = GetLastError();
@@ -1438,7 +2374,7 @@ YoriLibExtractCab(
         if (ErrorString != NULL) {
             YoriLibYPrintf(ErrorString, _T("Cannot convert %y to full path"), CabFileName);
         }
-        return FALSE;
+        goto Exit;
     }
 
     if (!YoriLibUserStringToSingleFilePath(TargetDirectory, FALSE, &FullTargetDirectory)) {
@@ -1448,7 +2384,7 @@ YoriLibExtractCab(
         if (ErrorString != NULL) {
             YoriLibYPrintf(ErrorString, _T("Cannot convert %y to full path"), TargetDirectory);
         }
-        return FALSE;
+        goto Exit;
     }
 
     //
@@ -1499,15 +2435,27 @@ YoriLibExtractCab(
         goto Exit;
     }
 
-    hFdi = DllCabinet.pFdiCreate(YoriLibCabAlloc,
-                                 YoriLibCabFree,
-                                 YoriLibCabFdiFileOpen,
-                                 YoriLibCabFdiFileRead,
-                                 YoriLibCabFdiFileWrite,
-                                 YoriLibCabFdiFileClose,
-                                 YoriLibCabFdiFileSeek,
-                                 -1,
-                                 &CabErrors);
+    if (ExpandContext.ParallelWrite) {
+        hFdi = DllCabinet.pFdiCreate(YoriLibCabAlloc,
+                                     YoriLibCabFree,
+                                     YoriLibCabFdiParallelFileOpen,
+                                     YoriLibCabFdiParallelFileRead,
+                                     YoriLibCabFdiParallelFileWrite,
+                                     YoriLibCabFdiParallelFileClose,
+                                     YoriLibCabFdiParallelFileSeek,
+                                     -1,
+                                     &CabErrors);
+    } else {
+        hFdi = DllCabinet.pFdiCreate(YoriLibCabAlloc,
+                                     YoriLibCabFree,
+                                     YoriLibCabFdiFileOpen,
+                                     YoriLibCabFdiFileRead,
+                                     YoriLibCabFdiFileWrite,
+                                     YoriLibCabFdiFileClose,
+                                     YoriLibCabFdiFileSeek,
+                                     -1,
+                                     &CabErrors);
+    }
 
     if (hFdi == NULL) {
         if (ErrorCode != NULL && *ErrorCode == ERROR_SUCCESS) {
@@ -1528,15 +2476,39 @@ YoriLibExtractCab(
                              YoriLibCabNotify,
                              NULL,
                              &ExpandContext)) {
+        Error = GetLastError();
+        if (ExpandContext.ParallelWrite) {
+            YoriLibWaitForWorkQueue(&ExpandContext.WriterQueue);
+        }
         if (ErrorCode != NULL && *ErrorCode == ERROR_SUCCESS) {
-            *ErrorCode = GetLastError();
+            *ErrorCode = Error;
         }
         if (ErrorString != NULL && ErrorString->LengthInChars == 0) {
-            YoriLibYPrintf(ErrorString, _T("Error %i in pFdiCopy"), GetLastError());
+            YoriLibYPrintf(ErrorString, _T("Error %i in pFdiCopy"), Error);
         }
         goto Exit;
     }
 
+    //
+    //  In parallel write mode, files may still be being written.  Wait for
+    //  them and check whether any failed.
+    //
+
+    if (ExpandContext.ParallelWrite) {
+        if (!YoriLibWaitForWorkQueue(&ExpandContext.WriterQueue) &&
+            ExpandContext.ErrorCode == ERROR_SUCCESS) {
+
+            ExpandContext.ErrorCode = ERROR_CANCELLED;
+        }
+
+        if (ExpandContext.ErrorCode != ERROR_SUCCESS) {
+            if (ErrorCode != NULL && *ErrorCode == ERROR_SUCCESS) {
+                *ErrorCode = ExpandContext.ErrorCode;
+            }
+            goto Exit;
+        }
+    }
+
     Result = TRUE;
 Exit:
 
@@ -1544,6 +2516,11 @@ Exit:
         DllCabinet.pFdiDestroy(hFdi);
     }
 
+    if (ExpandContext.ParallelWrite) {
+        YoriLibCleanupWorkQueue(&ExpandContext.WriterQueue);
+        CloseHandle(ExpandContext.Mutex);
+    }
+
     YoriLibFreeStringContents(&FullCabFileName);
     YoriLibFreeStringContents(&FullTargetDirectory);
     if (AnsiCabParentDirectory != NULL) {
@@ -1626,6 +2603,7 @@ YoriLibCreateCab(
     }
 
     ZeroMemory(CabHandle, sizeof(YORI_CAB_HANDLE));
+    YoriLibCabReadAheadInitialize(&CabHandle->AddContext.ReadAhead);
 
     //
     //  We don't want to split data across multiple CABs.  This feature
@@ -1663,11 +2641,13 @@ YoriLibCreateCab(
                                       DefaultPtr);
 
     if (CharsCopied <= 0 || CharsCopied >= sizeof(CabHandle->CompressContext.CabPath)) {
+        YoriLibCabReadAheadCleanup(&CabHandle->AddContext.ReadAhead);
         YoriLibDereference(CabHandle);
         return FALSE;
     }
 
     if (DefaultUsed) {
+        YoriLibCabReadAheadCleanup(&CabHandle->AddContext.ReadAhead);
         YoriLibDereference(CabHandle);
         return FALSE;
     }
@@ -1687,6 +2667,7 @@ YoriLibCreateCab(
                                                  &CabHandle->AddContext);
 
     if (CabHandle->FciHandle == NULL) {
+        YoriLibCabReadAheadCleanup(&CabHandle->AddContext.ReadAhead);
         YoriLibDereference(CabHandle);
         return FALSE;
     }
@@ -1792,6 +2773,7 @@ YoriLibCloseCab(
         DllCabinet.pFciDestroy(CabHandle->FciHandle);
     }
 
+    YoriLibCabReadAheadCleanup(&CabHandle->AddContext.ReadAhead);
     YoriLibDereference(CabHandle);
 }
 
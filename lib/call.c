@@ -613,6 +613,53 @@ YoriCallGetAliasStrings(
     return pYoriApiGetAliasStrings(AliasStrings);
 }
 
+/**
+ Prototype for the @ref YoriApiGetCommandTimings function.
+ */
+typedef BOOL YORI_API_GET_COMMAND_TIMINGS(BOOL, PYORI_STRING);
+
+/**
+ Prototype for a pointer to the @ref YoriApiGetCommandTimings function.
+ */
+typedef YORI_API_GET_COMMAND_TIMINGS *PYORI_API_GET_COMMAND_TIMINGS;
+
+/**
+ Pointer to the @ref YoriApiGetCommandTimings function.
+ */
+PYORI_API_GET_COMMAND_TIMINGS pYoriApiGetCommandTimings;
+
+/**
+ Return a report describing the time spent in each phase of executing
+ commands in the Yori shell process.  This must be freed with a subsequent
+ call to @ref YoriCallFreeYoriString .
+
+ @param Reset If TRUE, discard collected timings after generating the
+        report.
+
+ @param Report On successful completion, populated with the report.
+
+ @return TRUE to indicate success, or FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriCallGetCommandTimings(
+    __in BOOL Reset,
+    __out PYORI_STRING Report
+    )
+{
+    if (pYoriApiGetCommandTimings == NULL) {
+        HMODULE hYori;
+
+        hYori = GetModuleHandle(NULL);
+        __analysis_assume(hYori != NULL);
+        pYoriApiGetCommandTimings = (PYORI_API_GET_COMMAND_TIMINGS)GetProcAddress(hYori, "YoriApiGetCommandTimings");
+        if (pYoriApiGetCommandTimings == NULL) {
+            return FALSE;
+        }
+    }
+    return pYoriApiGetCommandTimings(Reset, Report);
+}
+
 /**
  Prototype for the YoriApiGetEnvironmentVariable function.
  */
@@ -1449,6 +1496,55 @@ YoriCallTerminateJob(
     return pYoriApiTerminateJob(JobId);
 }
 
+/**
+ Prototype for the @ref YoriApiWaitForAnyJob function.
+ */
+typedef BOOL YORI_API_WAIT_FOR_ANY_JOB(DWORD, PDWORD, PDWORD);
+
+/**
+ Prototype for a pointer to the @ref YoriApiWaitForAnyJob function.
+ */
+typedef YORI_API_WAIT_FOR_ANY_JOB *PYORI_API_WAIT_FOR_ANY_JOB;
+
+/**
+ Pointer to the @ref YoriApiWaitForAnyJob function.
+ */
+PYORI_API_WAIT_FOR_ANY_JOB pYoriApiWaitForAnyJob;
+
+/**
+ Waits until any one of a set of jobs is no longer active.
+
+ @param JobCount The number of jobs in the JobIds array.
+
+ @param JobIds An array of job IDs to wait for.
+
+ @param CompletedJobId On successful completion, updated to contain the ID
+        of the job that completed.
+
+ @return TRUE to indicate a job completed, FALSE if the wait was cancelled
+         or failed.
+ */
+__success(return)
+BOOL
+YoriCallWaitForAnyJob(
+    __in DWORD JobCount,
+    __in_ecount(JobCount) PDWORD JobIds,
+    __out PDWORD CompletedJobId
+    )
+{
+    if (pYoriApiWaitForAnyJob == NULL) {
+        HMODULE hYori;
+
+        hYori = GetModuleHandle(NULL);
+        __analysis_assume(hYori != NULL);
+        pYoriApiWaitForAnyJob = (PYORI_API_WAIT_FOR_ANY_JOB)GetProcAddress(hYori, "YoriApiWaitForAnyJob");
+        if (pYoriApiWaitForAnyJob == NULL) {
+            return FALSE;
+        }
+    }
+    return pYoriApiWaitForAnyJob(JobCount, JobIds, CompletedJobId);
+}
+
 /**
  Prototype for the @ref YoriApiWaitForJob function.
  */
@@ -28,6 +28,19 @@
 #include <yorilib.h>
 
 
+/**
+ The maximum number of console cells to request from ReadConsoleOutput in a
+ single call.  Older consoles marshal the request through a 64Kb buffer and
+ fail requests larger than that, so this is kept comfortably below it.
+ */
+#define YORILIB_CSHOT_CELLS_PER_READ (8 * 1024)
+
+/**
+ The number of characters of output to accumulate before writing to the
+ target device.
+ */
+#define YORILIB_CSHOT_OUTPUT_CHARS (64 * 1024)
+
 /**
  Read contents from the console window and send the contents to a device.
 
@@ -38,23 +51,40 @@
 
  @param SkipCount Specifies the number of lines to skip.
 
+ @param Flags Specifies options for the capture.  If
+        YORILIB_REWRITE_CONSOLE_PLAIN_TEXT is set, no escapes are generated
+        and trailing spaces are removed from each line.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 YoriLibRewriteConsoleContents(
     __in HANDLE hTarget,
     __in DWORD LineCount,
-    __in DWORD SkipCount
+    __in DWORD SkipCount,
+    __in DWORD Flags
     )
 {
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     HANDLE hConsole;
     SMALL_RECT ReadWindow;
     PCHAR_INFO ReadBuffer;
+    PCHAR_INFO Line;
     COORD ReadBufferSize;
     COORD ReadBufferOffset;
-    DWORD LastAttribute;
-    WORD LineIndex;
+    DWORD LinesPerRead;
+    DWORD FirstLine;
+    DWORD LineIndex;
+    DWORD CharIndex;
+    DWORD CharsInLine;
+    DWORD CurrentMode;
+    WORD LastAttribute;
+    BOOLEAN AttributeValid;
+    BOOLEAN OutputNewlines;
+    BOOL Result;
+    YORI_STRING Output;
+    TCHAR EscapeStringBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
+    YORI_STRING EscapeString;
 
     hConsole = CreateFile(_T("CONOUT$"), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
     if (hConsole == INVALID_HANDLE_VALUE) {
@@ -84,71 +114,143 @@ YoriLibRewriteConsoleContents(
         return FALSE;
     }
 
-    ReadWindow.Left = 0;
-    ReadWindow.Right = (WORD)(ScreenInfo.dwSize.X - 1);
-    ReadWindow.Top = (WORD)(ScreenInfo.dwCursorPosition.Y - SkipCount - LineCount);
-    ReadWindow.Bottom = (WORD)(ScreenInfo.dwCursorPosition.Y - SkipCount - 1);
+    //
+    //  Read as many complete lines as fit in a single request.  Each
+    //  request used to be a single line, which for a full scrollback
+    //  meant thousands of round trips to the console.
+    //
 
-    ReadBufferSize.X = (WORD)(ReadWindow.Right - ReadWindow.Left + 1);
-    ReadBufferSize.Y = (WORD)(ReadWindow.Bottom - ReadWindow.Top + 1);
+    LinesPerRead = YORILIB_CSHOT_CELLS_PER_READ / ScreenInfo.dwSize.X;
+    if (LinesPerRead == 0) {
+        LinesPerRead = 1;
+    }
+    if (LinesPerRead > LineCount) {
+        LinesPerRead = LineCount;
+    }
 
-    ReadBuffer = YoriLibMalloc(ReadBufferSize.X * ReadBufferSize.Y * sizeof(CHAR_INFO));
+    ReadBuffer = YoriLibMalloc(ScreenInfo.dwSize.X * LinesPerRead * sizeof(CHAR_INFO));
     if (ReadBuffer == NULL) {
         CloseHandle(hConsole);
         return FALSE;
     }
 
-    ReadBufferOffset.X = 0;
-    ReadBufferOffset.Y = 0;
+    if (!YoriLibAllocateString(&Output, YORILIB_CSHOT_OUTPUT_CHARS)) {
+        YoriLibFree(ReadBuffer);
+        CloseHandle(hConsole);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&EscapeString);
+    EscapeString.StartOfString = EscapeStringBuffer;
+    EscapeString.LengthAllocated = sizeof(EscapeStringBuffer)/sizeof(EscapeStringBuffer[0]);
 
     //
-    //  ReadConsoleOutput fails if it's given a large request, so give it
-    //  a pile of small (one line) requests.
+    //  A console target wraps at the end of each line, so newlines are
+    //  only needed when writing to a file or pipe.
     //
 
-    for (LineIndex = 0; LineIndex < (WORD)ReadBufferSize.Y; LineIndex++) {
-        SMALL_RECT LineReadWindow;
-        COORD LineReadBufferSize;
+    OutputNewlines = TRUE;
+    if (GetConsoleMode(hTarget, &CurrentMode)) {
+        OutputNewlines = FALSE;
+    }
 
-        LineReadWindow.Left = ReadWindow.Left;
-        LineReadWindow.Right = ReadWindow.Right;
-        LineReadWindow.Top = (WORD)(ReadWindow.Top + LineIndex);
-        LineReadWindow.Bottom = LineReadWindow.Top;
+    Result = FALSE;
+    AttributeValid = FALSE;
+    LastAttribute = 0;
+    FirstLine = ScreenInfo.dwCursorPosition.Y - SkipCount - LineCount;
+    ReadBufferOffset.X = 0;
+    ReadBufferOffset.Y = 0;
 
-        LineReadBufferSize.X = ReadBufferSize.X;
-        LineReadBufferSize.Y = 1;
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex += ReadBufferSize.Y) {
 
-        if (!ReadConsoleOutput(hConsole, &ReadBuffer[LineIndex * ReadBufferSize.X], LineReadBufferSize, ReadBufferOffset, &LineReadWindow)) {
-            CloseHandle(hConsole);
-            YoriLibFree(ReadBuffer);
-            return FALSE;
+        ReadBufferSize.X = ScreenInfo.dwSize.X;
+        ReadBufferSize.Y = (SHORT)LinesPerRead;
+        if (LineCount - LineIndex < LinesPerRead) {
+            ReadBufferSize.Y = (SHORT)(LineCount - LineIndex);
         }
-    }
 
-    YoriLibVtSetConsoleTextAttributeOnDevice(hTarget, 0, 0, ReadBuffer[0].Attributes);
-    LastAttribute = ReadBuffer[0].Attributes;
+        ReadWindow.Left = 0;
+        ReadWindow.Right = (SHORT)(ReadBufferSize.X - 1);
+        ReadWindow.Top = (SHORT)(FirstLine + LineIndex);
+        ReadWindow.Bottom = (SHORT)(ReadWindow.Top + ReadBufferSize.Y - 1);
 
-    for (ReadBufferOffset.Y = 0; ReadBufferOffset.Y < ReadBufferSize.Y; ReadBufferOffset.Y++) {
-        DWORD CurrentMode;
+        if (!ReadConsoleOutput(hConsole, ReadBuffer, ReadBufferSize, ReadBufferOffset, &ReadWindow)) {
+            goto Exit;
+        }
 
-        for (ReadBufferOffset.X = 0; ReadBufferOffset.X < ReadBufferSize.X; ReadBufferOffset.X++) {
-            DWORD CellIndex;
+        for (ReadBufferOffset.Y = 0; ReadBufferOffset.Y < ReadBufferSize.Y; ReadBufferOffset.Y++) {
+            Line = &ReadBuffer[ReadBufferOffset.Y * ReadBufferSize.X];
+            CharsInLine = ReadBufferSize.X;
 
-            CellIndex = ReadBufferOffset.Y * ReadBufferSize.X + ReadBufferOffset.X;
+            if (Flags & YORILIB_REWRITE_CONSOLE_PLAIN_TEXT) {
+                while (CharsInLine > 0 && Line[CharsInLine - 1].Char.UnicodeChar == ' ') {
+                    CharsInLine--;
+                }
+            }
+
+            for (CharIndex = 0; CharIndex < CharsInLine; CharIndex++) {
+
+                //
+                //  Leave space for an escape, this character and a
+                //  newline before adding anything.
+                //
+
+                if (Output.LengthInChars + EscapeString.LengthAllocated + 3 > Output.LengthAllocated) {
+                    if (!YoriLibOutputString(hTarget, 0, &Output)) {
+                        goto Exit;
+                    }
+                    Output.LengthInChars = 0;
+                }
+
+                //
+                //  Only emit an escape when the attribute changes, so a run
+                //  of cells with the same color is a single escape followed
+                //  by its text.
+                //
+
+                if ((Flags & YORILIB_REWRITE_CONSOLE_PLAIN_TEXT) == 0 &&
+                    (!AttributeValid || Line[CharIndex].Attributes != LastAttribute)) {
+
+                    LastAttribute = Line[CharIndex].Attributes;
+                    AttributeValid = TRUE;
+                    YoriLibVtStringForTextAttribute(&EscapeString, 0, LastAttribute);
+                    memcpy(&Output.StartOfString[Output.LengthInChars], EscapeString.StartOfString, EscapeString.LengthInChars * sizeof(TCHAR));
+                    Output.LengthInChars = Output.LengthInChars + EscapeString.LengthInChars;
+                }
+
+                Output.StartOfString[Output.LengthInChars] = Line[CharIndex].Char.UnicodeChar;
+                Output.LengthInChars++;
+            }
 
-            if (ReadBuffer[CellIndex].Attributes != LastAttribute) {
-                YoriLibVtSetConsoleTextAttributeOnDevice(hTarget, 0, 0, ReadBuffer[CellIndex].Attributes);
-                LastAttribute = ReadBuffer[CellIndex].Attributes;
+            if (OutputNewlines) {
+                if (Output.LengthInChars + 2 > Output.LengthAllocated) {
+                    if (!YoriLibOutputString(hTarget, 0, &Output)) {
+                        goto Exit;
+                    }
+                    Output.LengthInChars = 0;
+                }
+                Output.StartOfString[Output.LengthInChars] = '\n';
+                Output.LengthInChars++;
             }
-            YoriLibOutputToDevice(hTarget, 0, _T("%c"), ReadBuffer[CellIndex].Char.UnicodeChar);
         }
-        if (!GetConsoleMode(hTarget, &CurrentMode)) {
-            YoriLibOutputToDevice(hTarget, 0, _T("\n"));
+
+        ReadBufferOffset.Y = 0;
+    }
+
+    if (Output.LengthInChars > 0) {
+        if (!YoriLibOutputString(hTarget, 0, &Output)) {
+            goto Exit;
         }
     }
 
+    Result = TRUE;
+
+Exit:
+    ASSERT(EscapeString.StartOfString == EscapeStringBuffer);
+    YoriLibFreeStringContents(&Output);
     YoriLibFree(ReadBuffer);
-    return TRUE;
+    CloseHandle(hConsole);
+    return Result;
 }
 
 /**
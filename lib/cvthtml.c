@@ -32,6 +32,12 @@
  */
 #define CVTVT_DEFAULT_COLOR (7)
 
+/**
+ The number of characters to allocate for a style sheet defining CSS classes
+ for each color.
+ */
+#define YORILIB_HTML_STYLE_SHEET_LENGTH (1024)
+
 /**
  Attempt to capture the current console font.  This is only available on
  newer systems.
@@ -155,7 +161,12 @@ YoriLibCaptureConsoleColorTable(
 /**
  Output to include at the beginning of any HTML stream.
  */
-CONST TCHAR YoriLibHtmlHeader[] = _T("<HTML><HEAD><TITLE>cvtvt output</TITLE></HEAD>");
+CONST TCHAR YoriLibHtmlHeader[] = _T("<HTML><HEAD><TITLE>cvtvt output</TITLE>");
+
+/**
+ Output to include at the end of the HTML head section.
+ */
+CONST TCHAR YoriLibHtmlHeaderEnd[] = _T("</HEAD>");
 
 /**
  Output to include at the beginning of any version 4 HTML body.
@@ -179,6 +190,47 @@ CONST TCHAR YoriLibHtmlVerHeaderEnd[] = _T(";\">");
  */
 CONST TCHAR YoriLibHtmlFooter[] = _T("</DIV></BODY></HTML>");
 
+/**
+ Generate a style sheet defining a CSS class for each foreground and
+ background color, so that text can refer to a color by class name rather
+ than describing it in each tag.  Foreground colors are named f0 through f15
+ and background colors b0 through b15.
+
+ @param StyleSheet Pointer to a buffer to populate with the style sheet.
+
+ @param BufferLength The length of StyleSheet, in characters.  This should
+        be at least YORILIB_HTML_STYLE_SHEET_LENGTH characters.
+
+ @param ColorTable Pointer to a color table describing how to convert the 16
+        colors into RGB.
+ */
+VOID
+YoriLibHtmlGenerateStyleSheet(
+    __out_ecount(BufferLength) LPTSTR StyleSheet,
+    __in YORI_ALLOC_SIZE_T BufferLength,
+    __in PDWORD ColorTable
+    )
+{
+    YORI_ALLOC_SIZE_T Offset;
+    DWORD Index;
+
+    Offset = (YORI_ALLOC_SIZE_T)YoriLibSPrintfS(StyleSheet, BufferLength, _T("<STYLE>"));
+    for (Index = 0; Index < 16; Index++) {
+        Offset = Offset + (YORI_ALLOC_SIZE_T)YoriLibSPrintfS(&StyleSheet[Offset],
+                                                             BufferLength - Offset,
+                                                             _T(".f%i{color:#%02x%02x%02x}.b%i{background-color:#%02x%02x%02x}"),
+                                                             Index,
+                                                             GetRValue(ColorTable[Index]),
+                                                             GetGValue(ColorTable[Index]),
+                                                             GetBValue(ColorTable[Index]),
+                                                             Index,
+                                                             GetRValue(ColorTable[Index]),
+                                                             GetGValue(ColorTable[Index]),
+                                                             GetBValue(ColorTable[Index]));
+    }
+    YoriLibSPrintfS(&StyleSheet[Offset], BufferLength - Offset, _T("</STYLE>"));
+}
+
 /**
  Generate a string of text for the current console font and state to commence
  an HTML output stream.
@@ -203,6 +255,7 @@ YoriLibHtmlGenerateInitialString(
     TCHAR szFontNames[LF_FACESIZE + 100];
     TCHAR szFontWeight[100];
     TCHAR szFontSize[100];
+    TCHAR szStyleSheet[YORILIB_HTML_STYLE_SHEET_LENGTH];
 
     if (!YoriLibCaptureConsoleFont(&FontInfo)) {
         FontInfo.FaceName[0] = '\0';
@@ -230,6 +283,12 @@ YoriLibHtmlGenerateInitialString(
 
     GenerateContext->TagOpen = FALSE;
     GenerateContext->UnderlineOn = FALSE;
+    GenerateContext->CurrentColor = 0;
+
+    szStyleSheet[0] = '\0';
+    if (GenerateContext->UseClasses && GenerateContext->HtmlVersion == 5) {
+        YoriLibHtmlGenerateStyleSheet(szStyleSheet, sizeof(szStyleSheet)/sizeof(szStyleSheet[0]), YoriLibDefaultColorTable);
+    }
 
     if (FontInfo.FontWeight >= 600) {
         GenerateContext->BoldOn = TRUE;
@@ -238,8 +297,10 @@ YoriLibHtmlGenerateInitialString(
     }
 
     YoriLibYPrintf(TextString,
-                   _T("%s%s%s%s%s%s%s"),
+                   _T("%s%s%s%s%s%s%s%s%s"),
                    YoriLibHtmlHeader,
+                   szStyleSheet,
+                   YoriLibHtmlHeaderEnd,
                    (GenerateContext->HtmlVersion == 4)?YoriLibHtmlVer4Header:YoriLibHtmlVer5Header,
                    szFontNames,
                    (GenerateContext->HtmlVersion == 5)?szFontWeight:_T(""),
@@ -543,12 +604,36 @@ YoriLibHtmlGenerateEscapeStringInternal(
             }
         }
 
+        //
+        //  Convert the color to a Windows color so that it maps into the
+        //  Windows colortable
+        //
+
+        NewColor = YoriLibAnsiToWindowsByte(NewColor);
+
+        //
+        //  If the new state matches the tag that is already open, there's
+        //  nothing to do.  Output commonly resets and reapplies the same
+        //  color, and closing and reopening the tag would bloat the output.
+        //
+
+        if (GenerateContext->TagOpen &&
+            GenerateContext->CurrentColor == NewColor &&
+            GenerateContext->UnderlineOn == NewUnderline) {
+
+            goto Done;
+        }
+
         if (GenerateContext->TagOpen) {
             if (GenerateContext->UnderlineOn) {
                 if (DestOffset + sizeof("</U>") - 1 < TextString->LengthAllocated) {
                     memcpy(&TextString->StartOfString[DestOffset], _T("</U>"), sizeof(_T("</U>")) - sizeof(TCHAR));
                 }
                 AddToDestOffset = sizeof("</U>") - 1;
+                DestOffset = YoriLibIsAllocationExtendable(DestOffset, AddToDestOffset, AddToDestOffset);
+                if (DestOffset == 0) {
+                    return FALSE;
+                }
             }
             if (GenerateContext->HtmlVersion == 4) {
                 if (DestOffset + sizeof("</FONT>") - 1 < TextString->LengthAllocated) {
@@ -570,13 +655,6 @@ YoriLibHtmlGenerateEscapeStringInternal(
             }
         }
 
-        //
-        //  Convert the color to a Windows color so that it maps into the
-        //  Windows colortable
-        //
-
-        NewColor = YoriLibAnsiToWindowsByte(NewColor);
-
         //
         //  Output the appropriate tag depending on the version the user wanted
         //
@@ -587,6 +665,11 @@ YoriLibHtmlGenerateEscapeStringInternal(
                                        GetRValue(ColorTableToUse[NewColor & 0xf]),
                                        GetGValue(ColorTableToUse[NewColor & 0xf]),
                                        GetBValue(ColorTableToUse[NewColor & 0xf]));
+        } else if (GenerateContext->UseClasses) {
+            SrcOffset = YoriLibSPrintf(NewTag,
+                                       _T("<SPAN CLASS=\"f%i b%i\">"),
+                                       NewColor & 0xf,
+                                       (NewColor & 0xf0) >> 4);
         } else {
             SrcOffset = YoriLibSPrintf(NewTag,
                                        _T("<SPAN STYLE=\"color:#%02x%02x%02x;background-color:#%02x%02x%02x\">"),
@@ -622,9 +705,12 @@ YoriLibHtmlGenerateEscapeStringInternal(
         }
 
         GenerateContext->UnderlineOn = NewUnderline;
+        GenerateContext->CurrentColor = NewColor;
         GenerateContext->TagOpen = TRUE;
     }
 
+Done:
+
     if (DestOffset < TextString->LengthAllocated) {
 #if defined(_MSC_VER) && (_MSC_VER >= 1700)
 #pragma warning(suppress: 6011) // Dereferencing NULL pointer; if LengthAllocated
@@ -737,6 +823,63 @@ YoriLibHtmlCvtAppendWithReallocate(
     return TRUE;
 }
 
+/**
+ Return a string describing the unused space at the end of a string, so that
+ text can be generated directly into it.
+
+ @param String Pointer to the string.
+
+ @param Tail On completion, updated to describe the unused space at the end
+        of String.  This string is not allocated.
+ */
+VOID
+YoriLibHtmlCvtGetTail(
+    __in PYORI_STRING String,
+    __out PYORI_STRING Tail
+    )
+{
+    YoriLibInitEmptyString(Tail);
+    if (String->StartOfString != NULL) {
+        Tail->StartOfString = &String->StartOfString[String->LengthInChars];
+        Tail->LengthAllocated = String->LengthAllocated - String->LengthInChars;
+    }
+}
+
+/**
+ Reallocate a string so that it has at least a specified number of unused
+ characters at the end.  The allocation grows geometrically so that repeated
+ small extensions are not expensive.
+
+ @param String Pointer to the string to extend.
+
+ @param CharsNeeded The number of unused characters needed at the end of the
+        string.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibHtmlCvtExtend(
+    __inout PYORI_STRING String,
+    __in YORI_ALLOC_SIZE_T CharsNeeded
+    )
+{
+    DWORD LengthNeeded;
+    YORI_ALLOC_SIZE_T AllocSize;
+
+    LengthNeeded = String->LengthInChars + CharsNeeded;
+    if (!YoriLibIsSizeAllocatable(LengthNeeded)) {
+        return FALSE;
+    }
+
+    AllocSize = YoriLibMaximumAllocationInRange(LengthNeeded, LengthNeeded * 4);
+    if (!YoriLibReallocateString(String, AllocSize)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Indicate the beginning of a stream and perform any initial output.
 
@@ -837,28 +980,28 @@ YoriLibHtmlCnvProcessAndOutputText(
 
     UNREFERENCED_PARAMETER(Context);
 
-    YoriLibInitEmptyString(&TextString);
-    BufferSizeNeeded = 0;
-    if (!YoriLibHtmlGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
-        return FALSE;
-    }
+    //
+    //  Generate directly into the unused space at the end of the HTML
+    //  buffer.  If it doesn't fit, extend the buffer and try again.
+    //
 
-    if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
-        return FALSE;
-    }
+    while (TRUE) {
+        YoriLibHtmlCvtGetTail(HtmlContext->HtmlText, &TextString);
+        BufferSizeNeeded = 0;
+        if (!YoriLibHtmlGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
+            return FALSE;
+        }
 
-    BufferSizeNeeded = 0;
-    if (!YoriLibHtmlGenerateTextString(&TextString, &BufferSizeNeeded, String)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
-    }
+        if (BufferSizeNeeded <= TextString.LengthAllocated) {
+            break;
+        }
 
-    if (!YoriLibHtmlCvtAppendWithReallocate(HtmlContext->HtmlText, &TextString)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
+        if (!YoriLibHtmlCvtExtend(HtmlContext->HtmlText, BufferSizeNeeded)) {
+            return FALSE;
+        }
     }
 
-    YoriLibFreeStringContents(&TextString);
+    HtmlContext->HtmlText->LengthInChars = HtmlContext->HtmlText->LengthInChars + TextString.LengthInChars;
     return TRUE;
 }
 
@@ -891,30 +1034,31 @@ YoriLibHtmlCnvProcessAndOutputEscape(
 
     UNREFERENCED_PARAMETER(Context);
 
-    memcpy(&DummyGenerateContext, &HtmlContext->GenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
-
-    YoriLibInitEmptyString(&TextString);
-    BufferSizeNeeded = 0;
-    if (!YoriLibHtmlGenerateEscapeStringInternal(&TextString, &BufferSizeNeeded, HtmlContext->ColorTable, String, &DummyGenerateContext)) {
-        return FALSE;
-    }
+    //
+    //  Generate directly into the unused space at the end of the HTML
+    //  buffer.  The generation state is only updated once the result has
+    //  fit.
+    //
 
-    if (!YoriLibAllocateString(&TextString, BufferSizeNeeded)) {
-        return FALSE;
-    }
+    while (TRUE) {
+        memcpy(&DummyGenerateContext, &HtmlContext->GenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
+        YoriLibHtmlCvtGetTail(HtmlContext->HtmlText, &TextString);
+        BufferSizeNeeded = 0;
+        if (!YoriLibHtmlGenerateEscapeStringInternal(&TextString, &BufferSizeNeeded, HtmlContext->ColorTable, String, &DummyGenerateContext)) {
+            return FALSE;
+        }
 
-    BufferSizeNeeded = 0;
-    if (!YoriLibHtmlGenerateEscapeStringInternal(&TextString, &BufferSizeNeeded, HtmlContext->ColorTable, String, &HtmlContext->GenerateContext)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
-    }
+        if (BufferSizeNeeded <= TextString.LengthAllocated) {
+            break;
+        }
 
-    if (!YoriLibHtmlCvtAppendWithReallocate(HtmlContext->HtmlText, &TextString)) {
-        YoriLibFreeStringContents(&TextString);
-        return FALSE;
+        if (!YoriLibHtmlCvtExtend(HtmlContext->HtmlText, BufferSizeNeeded)) {
+            return FALSE;
+        }
     }
 
-    YoriLibFreeStringContents(&TextString);
+    memcpy(&HtmlContext->GenerateContext, &DummyGenerateContext, sizeof(YORILIB_HTML_GENERATE_CONTEXT));
+    HtmlContext->HtmlText->LengthInChars = HtmlContext->HtmlText->LengthInChars + TextString.LengthInChars;
     return TRUE;
 }
 
@@ -959,6 +1103,7 @@ YoriLibHtmlConvertToHtmlFromVt(
         }
     }
     HtmlContext.GenerateContext.HtmlVersion = HtmlVersion;
+    HtmlContext.GenerateContext.UseClasses = FALSE;
 
     CallbackFunctions.InitializeStream = YoriLibHtmlCnvInitializeStream;
     CallbackFunctions.EndStream = YoriLibHtmlCnvEndStream;
@@ -145,9 +145,11 @@ YoriLibLoadNtDllFunctions(VOID)
     DllNtDll.pNtQueryObject = (PNT_QUERY_OBJECT)GetProcAddress(DllNtDll.hDll, "NtQueryObject");
     DllNtDll.pNtQuerySymbolicLinkObject = (PNT_QUERY_SYMBOLIC_LINK_OBJECT)GetProcAddress(DllNtDll.hDll, "NtQuerySymbolicLinkObject");
     DllNtDll.pNtQuerySystemInformation = (PNT_QUERY_SYSTEM_INFORMATION)GetProcAddress(DllNtDll.hDll, "NtQuerySystemInformation");
+    DllNtDll.pNtQuerySystemInformationEx = (PNT_QUERY_SYSTEM_INFORMATION_EX)GetProcAddress(DllNtDll.hDll, "NtQuerySystemInformationEx");
     DllNtDll.pNtSetInformationFile = (PNT_SET_INFORMATION_FILE)GetProcAddress(DllNtDll.hDll, "NtSetInformationFile");
     DllNtDll.pNtSystemDebugControl = (PNT_SYSTEM_DEBUG_CONTROL)GetProcAddress(DllNtDll.hDll, "NtSystemDebugControl");
     DllNtDll.pRtlGetLastNtStatus = (PRTL_GET_LAST_NT_STATUS)GetProcAddress(DllNtDll.hDll, "RtlGetLastNtStatus");
+    DllNtDll.pRtlUpcaseUnicodeChar = (PRTL_UPCASE_UNICODE_CHAR)GetProcAddress(DllNtDll.hDll, "RtlUpcaseUnicodeChar");
     return TRUE;
 }
 
@@ -166,8 +168,10 @@ CONST YORI_DLL_NAME_MAP DllKernel32Symbols[] = {
     {(FARPROC *)&DllKernel32.pCopyFileW, "CopyFileW"},
     {(FARPROC *)&DllKernel32.pCopyFileExW, "CopyFileExW"},
     {(FARPROC *)&DllKernel32.pCreateHardLinkW, "CreateHardLinkW"},
+    {(FARPROC *)&DllKernel32.pCreateIoCompletionPort, "CreateIoCompletionPort"},
     {(FARPROC *)&DllKernel32.pCreateJobObjectW, "CreateJobObjectW"},
     {(FARPROC *)&DllKernel32.pCreateSymbolicLinkW, "CreateSymbolicLinkW"},
+    {(FARPROC *)&DllKernel32.pFindFirstFileExW, "FindFirstFileExW"},
     {(FARPROC *)&DllKernel32.pFindFirstStreamW, "FindFirstStreamW"},
     {(FARPROC *)&DllKernel32.pFindFirstVolumeW, "FindFirstVolumeW"},
     {(FARPROC *)&DllKernel32.pFindNextStreamW, "FindNextStreamW"},
@@ -191,12 +195,14 @@ CONST YORI_DLL_NAME_MAP DllKernel32Symbols[] = {
     {(FARPROC *)&DllKernel32.pGetLogicalProcessorInformation, "GetLogicalProcessorInformation"},
     {(FARPROC *)&DllKernel32.pGetLogicalProcessorInformationEx, "GetLogicalProcessorInformationEx"},
     {(FARPROC *)&DllKernel32.pGetNativeSystemInfo, "GetNativeSystemInfo"},
+    {(FARPROC *)&DllKernel32.pGetNumaNodeProcessorMask, "GetNumaNodeProcessorMask"},
     {(FARPROC *)&DllKernel32.pGetPrivateProfileIntW, "GetPrivateProfileIntW"},
     {(FARPROC *)&DllKernel32.pGetPrivateProfileSectionW, "GetPrivateProfileSectionW"},
     {(FARPROC *)&DllKernel32.pGetPrivateProfileSectionNamesW, "GetPrivateProfileSectionNamesW"},
     {(FARPROC *)&DllKernel32.pGetPrivateProfileStringW, "GetPrivateProfileStringW"},
     {(FARPROC *)&DllKernel32.pGetProcessIoCounters, "GetProcessIoCounters"},
     {(FARPROC *)&DllKernel32.pGetProductInfo, "GetProductInfo"},
+    {(FARPROC *)&DllKernel32.pGetQueuedCompletionStatus, "GetQueuedCompletionStatus"},
     {(FARPROC *)&DllKernel32.pGetSystemPowerStatus, "GetSystemPowerStatus"},
     {(FARPROC *)&DllKernel32.pGetTickCount64, "GetTickCount64"},
     {(FARPROC *)&DllKernel32.pGetVersionExW, "GetVersionExW"},
@@ -213,8 +219,12 @@ CONST YORI_DLL_NAME_MAP DllKernel32Symbols[] = {
     {(FARPROC *)&DllKernel32.pLoadLibraryW, "LoadLibraryW"},
     {(FARPROC *)&DllKernel32.pLoadLibraryExW, "LoadLibraryExW"},
     {(FARPROC *)&DllKernel32.pOpenThread, "OpenThread"},
+    {(FARPROC *)&DllKernel32.pPostQueuedCompletionStatus, "PostQueuedCompletionStatus"},
+    {(FARPROC *)&DllKernel32.pPssCaptureSnapshot, "PssCaptureSnapshot"},
+    {(FARPROC *)&DllKernel32.pPssFreeSnapshot, "PssFreeSnapshot"},
     {(FARPROC *)&DllKernel32.pQueryFullProcessImageNameW, "QueryFullProcessImageNameW"},
     {(FARPROC *)&DllKernel32.pQueryInformationJobObject, "QueryInformationJobObject"},
+    {(FARPROC *)&DllKernel32.pReadDirectoryChangesW, "ReadDirectoryChangesW"},
     {(FARPROC *)&DllKernel32.pRegisterApplicationRestart, "RegisterApplicationRestart"},
     {(FARPROC *)&DllKernel32.pReplaceFileW, "ReplaceFileW"},
     {(FARPROC *)&DllKernel32.pRtlCaptureStackBackTrace, "RtlCaptureStackBackTrace"},
@@ -225,6 +235,7 @@ CONST YORI_DLL_NAME_MAP DllKernel32Symbols[] = {
     {(FARPROC *)&DllKernel32.pSetFileInformationByHandle, "SetFileInformationByHandle"},
     {(FARPROC *)&DllKernel32.pSetInformationJobObject, "SetInformationJobObject"},
     {(FARPROC *)&DllKernel32.pSetSystemPowerState, "SetSystemPowerState"},
+    {(FARPROC *)&DllKernel32.pWritePrivateProfileSectionW, "WritePrivateProfileSectionW"},
     {(FARPROC *)&DllKernel32.pWritePrivateProfileStringW, "WritePrivateProfileStringW"},
     {(FARPROC *)&DllKernel32.pWow64DisableWow64FsRedirection, "Wow64DisableWow64FsRedirection"},
     {(FARPROC *)&DllKernel32.pWow64GetThreadContext, "Wow64GetThreadContext"},
@@ -300,6 +311,40 @@ YoriLibLoadKernel32Functions(VOID)
     return TRUE;
 }
 
+/**
+ A structure containing pointers to bcrypt.dll functions that can be used if
+ they are found but programs do not have a hard dependency on.
+ */
+YORI_BCRYPT_FUNCTIONS DllBCrypt;
+
+/**
+ Load pointers to all optional bcrypt.dll functions.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibLoadBCryptFunctions(VOID)
+{
+    if (DllBCrypt.hDll != NULL) {
+        return TRUE;
+    }
+
+    DllBCrypt.hDll = YoriLibLoadLibraryFromSystemDirectory(_T("BCRYPT.DLL"));
+    if (DllBCrypt.hDll == NULL) {
+        return FALSE;
+    }
+
+    DllBCrypt.pBCryptCloseAlgorithmProvider = (PBCRYPT_CLOSE_ALGORITHM_PROVIDER)GetProcAddress(DllBCrypt.hDll, "BCryptCloseAlgorithmProvider");
+    DllBCrypt.pBCryptCreateHash = (PBCRYPT_CREATE_HASH)GetProcAddress(DllBCrypt.hDll, "BCryptCreateHash");
+    DllBCrypt.pBCryptDestroyHash = (PBCRYPT_DESTROY_HASH)GetProcAddress(DllBCrypt.hDll, "BCryptDestroyHash");
+    DllBCrypt.pBCryptFinishHash = (PBCRYPT_FINISH_HASH)GetProcAddress(DllBCrypt.hDll, "BCryptFinishHash");
+    DllBCrypt.pBCryptGetProperty = (PBCRYPT_GET_PROPERTY)GetProcAddress(DllBCrypt.hDll, "BCryptGetProperty");
+    DllBCrypt.pBCryptHashData = (PBCRYPT_HASH_DATA)GetProcAddress(DllBCrypt.hDll, "BCryptHashData");
+    DllBCrypt.pBCryptOpenAlgorithmProvider = (PBCRYPT_OPEN_ALGORITHM_PROVIDER)GetProcAddress(DllBCrypt.hDll, "BCryptOpenAlgorithmProvider");
+
+    return TRUE;
+}
+
 /**
  A structure containing pointers to crypt32.dll functions that can be used if
  they are found but programs do not have a hard dependency on.
@@ -66,6 +66,10 @@ CONST YORI_DLL_NAME_MAP DllAdvApi32Symbols[] = {
     {(FARPROC *)&DllAdvApi32.pCryptGetHashParam, "CryptGetHashParam"},
     {(FARPROC *)&DllAdvApi32.pCryptHashData, "CryptHashData"},
     {(FARPROC *)&DllAdvApi32.pCryptReleaseContext, "CryptReleaseContext"},
+    {(FARPROC *)&DllAdvApi32.pEventRegister, "EventRegister"},
+    {(FARPROC *)&DllAdvApi32.pEventSetInformation, "EventSetInformation"},
+    {(FARPROC *)&DllAdvApi32.pEventUnregister, "EventUnregister"},
+    {(FARPROC *)&DllAdvApi32.pEventWriteTransfer, "EventWriteTransfer"},
     {(FARPROC *)&DllAdvApi32.pFreeSid, "FreeSid"},
     {(FARPROC *)&DllAdvApi32.pGetFileSecurityW, "GetFileSecurityW"},
     {(FARPROC *)&DllAdvApi32.pGetLengthSid, "GetLengthSid"},
@@ -80,6 +84,7 @@ CONST YORI_DLL_NAME_MAP DllAdvApi32Symbols[] = {
     {(FARPROC *)&DllAdvApi32.pOpenProcessToken, "OpenProcessToken"},
     {(FARPROC *)&DllAdvApi32.pOpenThreadToken, "OpenThreadToken"},
     {(FARPROC *)&DllAdvApi32.pRegCloseKey, "RegCloseKey"},
+    {(FARPROC *)&DllAdvApi32.pRegCopyTreeW, "RegCopyTreeW"},
     {(FARPROC *)&DllAdvApi32.pRegCreateKeyExW, "RegCreateKeyExW"},
     {(FARPROC *)&DllAdvApi32.pRegDeleteKeyW, "RegDeleteKeyW"},
     {(FARPROC *)&DllAdvApi32.pRegDeleteValueW, "RegDeleteValueW"},
@@ -91,12 +91,14 @@ CONST YORI_DLL_NAME_MAP DllUser32Symbols[] = {
     {(FARPROC *)&DllUser32.pSetForegroundWindow, "SetForegroundWindow"},
     {(FARPROC *)&DllUser32.pSetShellWindow, "SetShellWindow"},
     {(FARPROC *)&DllUser32.pSetTaskmanWindow, "SetTaskmanWindow"},
+    {(FARPROC *)&DllUser32.pSetWinEventHook, "SetWinEventHook"},
     {(FARPROC *)&DllUser32.pSetWindowPos, "SetWindowPos"},
     {(FARPROC *)&DllUser32.pSetWindowTextW, "SetWindowTextW"},
     {(FARPROC *)&DllUser32.pShowWindow, "ShowWindow"},
     {(FARPROC *)&DllUser32.pShowWindowAsync, "ShowWindowAsync"},
     {(FARPROC *)&DllUser32.pSwitchToThisWindow, "SwitchToThisWindow"},
-    {(FARPROC *)&DllUser32.pTileWindows, "TileWindows"}
+    {(FARPROC *)&DllUser32.pTileWindows, "TileWindows"},
+    {(FARPROC *)&DllUser32.pUnhookWinEvent, "UnhookWinEvent"}
 };
 
 /**
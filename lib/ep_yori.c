@@ -62,11 +62,14 @@ VOID __cdecl CONSOLE_CRT_ENTRYPOINT(VOID)
         ExitProcess(EXIT_FAILURE);
     }
     ExitCode = CONSOLE_USER_ENTRYPOINT(ArgC, ArgV);
+    YoriLibDisableOutputBuffering();
+    YoriLibDisplayStatistics();
     for (Index = 0; Index < ArgC; Index++) {
         YoriLibFreeStringContents(&ArgV[Index]);
     }
     YoriLibDereference(ArgV);
 
+    YoriLibDisplayAllocationProfile();
     YoriLibDisplayMemoryUsage();
 
     ExitProcess(ExitCode);
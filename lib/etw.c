@@ -0,0 +1,351 @@
+/**
+ * @file lib/etw.c
+ *
+ * Yori lib ETW event provider
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+//
+//  Events are written in the TraceLogging format, where each event carries
+//  metadata describing its name and fields so no manifest needs to be
+//  registered on the system.  The TraceLogging headers are not present in
+//  the SDKs used to build this code, so the provider and event metadata are
+//  constructed here.  Since EventSetInformation is needed to tell ETW that
+//  the provider uses this format, the provider is only registered on
+//  Windows 8 and above, and on older systems every call is a no-op.
+//
+
+/**
+ The GUID for the Yori ETW provider.  A trace can capture events from this
+ provider with "wpr" or "xperf" by specifying
+ {8f4b2c6e-3a1d-4e7f-9b05-6c2d7e1a4f38}.
+ */
+CONST GUID YoriLibEtwProviderGuid = {0x8f4b2c6e, 0x3a1d, 0x4e7f, {0x9b, 0x05, 0x6c, 0x2d, 0x7e, 0x1a, 0x4f, 0x38}};
+
+/**
+ The provider metadata.  This consists of a 16 bit length, including the
+ length itself, followed by the NULL terminated UTF-8 provider name.
+ */
+CONST UCHAR YoriLibEtwProviderMetadata[] = {
+    sizeof("Yori") + sizeof(USHORT), 0,
+    'Y', 'o', 'r', 'i', '\0'
+};
+
+/**
+ The information class passed to EventSetInformation to supply provider
+ traits.
+ */
+#define YORI_ETW_SET_TRAITS (2)
+
+/**
+ The channel that TraceLogging events are logged to.
+ */
+#define YORI_ETW_CHANNEL_TRACELOGGING (11)
+
+/**
+ The level used for all events.  This corresponds to verbose.
+ */
+#define YORI_ETW_LEVEL_VERBOSE (5)
+
+/**
+ The descriptor type indicating the data is provider metadata.
+ */
+#define YORI_ETW_DATA_PROVIDER_METADATA (2)
+
+/**
+ The descriptor type indicating the data is event metadata.
+ */
+#define YORI_ETW_DATA_EVENT_METADATA (1)
+
+/**
+ The TraceLogging type for a string of UTF-16 characters preceded by a 16
+ bit length in bytes.
+ */
+#define YORI_ETW_TYPE_COUNTED_UTF16 (22)
+
+/**
+ The TraceLogging type for an unsigned 64 bit integer.
+ */
+#define YORI_ETW_TYPE_UINT64 (10)
+
+/**
+ The maximum size of the event metadata, which consists of a length, a tag,
+ the event name, and the two field descriptions.
+ */
+#define YORI_ETW_MAX_EVENT_METADATA (128)
+
+/**
+ A structure containing process global state for ETW support.
+ */
+typedef struct _YORI_LIB_ETW_STATE {
+
+    /**
+     The handle returned from EventRegister.  This is only meaningful if
+     Registered is TRUE.
+     */
+    DWORDLONG RegHandle;
+
+    /**
+     TRUE if the provider has been registered.
+     */
+    BOOLEAN Registered;
+
+    /**
+     TRUE if a consumer is currently listening to events from this
+     provider.  This is updated by ETW via the enable callback.
+     */
+    volatile BOOLEAN Enabled;
+} YORI_LIB_ETW_STATE, *PYORI_LIB_ETW_STATE;
+
+/**
+ Process global state for ETW support.
+ */
+YORI_LIB_ETW_STATE YoriLibEtwState;
+
+/**
+ A callback invoked by ETW when a consumer starts or stops listening to the
+ provider.
+
+ @param SourceId Pointer to the GUID of the session, unused.
+
+ @param IsEnabled Zero if the provider is being disabled, nonzero if it is
+        being enabled or is being asked to capture state.
+
+ @param Level The level requested by the consumer, unused.
+
+ @param MatchAnyKeyword The keywords requested by the consumer, unused.
+
+ @param MatchAllKeyword The keywords requested by the consumer, unused.
+
+ @param FilterData Pointer to filter data, unused.
+
+ @param CallbackContext Context supplied at registration time, unused.
+ */
+VOID WINAPI
+YoriLibEtwEnableCallback(
+    __in CONST GUID * SourceId,
+    __in ULONG IsEnabled,
+    __in UCHAR Level,
+    __in DWORDLONG MatchAnyKeyword,
+    __in DWORDLONG MatchAllKeyword,
+    __in_opt PVOID FilterData,
+    __in_opt PVOID CallbackContext
+    )
+{
+    UNREFERENCED_PARAMETER(SourceId);
+    UNREFERENCED_PARAMETER(Level);
+    UNREFERENCED_PARAMETER(MatchAnyKeyword);
+    UNREFERENCED_PARAMETER(MatchAllKeyword);
+    UNREFERENCED_PARAMETER(FilterData);
+    UNREFERENCED_PARAMETER(CallbackContext);
+
+    if (IsEnabled) {
+        YoriLibEtwState.Enabled = TRUE;
+    } else {
+        YoriLibEtwState.Enabled = FALSE;
+    }
+}
+
+/**
+ Register the Yori ETW provider so that events can be written.  Failure is
+ not fatal; it means events are discarded.
+
+ @return TRUE to indicate the provider was registered, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibEtwRegister(VOID)
+{
+    if (YoriLibEtwState.Registered) {
+        return TRUE;
+    }
+
+    YoriLibLoadAdvApi32Functions();
+    if (DllAdvApi32.pEventRegister == NULL ||
+        DllAdvApi32.pEventSetInformation == NULL ||
+        DllAdvApi32.pEventUnregister == NULL ||
+        DllAdvApi32.pEventWriteTransfer == NULL) {
+
+        return FALSE;
+    }
+
+    if (DllAdvApi32.pEventRegister(&YoriLibEtwProviderGuid, YoriLibEtwEnableCallback, NULL, &YoriLibEtwState.RegHandle) != ERROR_SUCCESS) {
+        return FALSE;
+    }
+
+    DllAdvApi32.pEventSetInformation(YoriLibEtwState.RegHandle, YORI_ETW_SET_TRAITS, (PVOID)YoriLibEtwProviderMetadata, sizeof(YoriLibEtwProviderMetadata));
+    YoriLibEtwState.Registered = TRUE;
+    return TRUE;
+}
+
+/**
+ Unregister the Yori ETW provider.  Events written after this point are
+ discarded.
+ */
+VOID
+YoriLibEtwUnregister(VOID)
+{
+    if (YoriLibEtwState.Registered) {
+        YoriLibEtwState.Enabled = FALSE;
+        YoriLibEtwState.Registered = FALSE;
+        DllAdvApi32.pEventUnregister(YoriLibEtwState.RegHandle);
+    }
+}
+
+/**
+ Returns TRUE if a consumer is listening to events from the Yori provider.
+ Callers can use this to avoid constructing event data that would be
+ discarded.
+
+ @return TRUE if events are being consumed, FALSE if not.
+ */
+BOOL
+YoriLibEtwIsEnabled(VOID)
+{
+    return YoriLibEtwState.Enabled;
+}
+
+/**
+ Append a NULL terminated ANSI string to the event metadata buffer,
+ truncating it if the buffer is full.
+
+ @param Buffer Pointer to the metadata buffer.
+
+ @param Offset On input, the offset within the buffer to write to.  On
+        output, updated to point after the string and its terminator.
+
+ @param String Pointer to the string to append.
+ */
+VOID
+YoriLibEtwAppendMetadataString(
+    __inout_ecount(YORI_ETW_MAX_EVENT_METADATA) PUCHAR Buffer,
+    __inout PDWORD Offset,
+    __in LPCSTR String
+    )
+{
+    DWORD Index;
+
+    Index = *Offset;
+    while (*String != '\0' && Index < YORI_ETW_MAX_EVENT_METADATA - 1) {
+        Buffer[Index] = (UCHAR)*String;
+        Index++;
+        String++;
+    }
+    Buffer[Index] = '\0';
+    Index++;
+    *Offset = Index;
+}
+
+/**
+ Write an event from the Yori provider.  Each event contains a string
+ describing the object being operated on and a numeric value whose meaning
+ depends on the event, such as a process ID or exit code.
+
+ @param EventName Pointer to the name of the event.  This should be a
+        short identifier such as "Parse".
+
+ @param Opcode Indicates whether this event marks the start of an activity,
+        the end of an activity, or a single point in time.
+
+ @param Detail Optionally points to a string describing the object being
+        operated on.
+
+ @param Value A numeric value to include with the event.
+ */
+VOID
+YoriLibEtwWriteEvent(
+    __in LPCSTR EventName,
+    __in UCHAR Opcode,
+    __in_opt PCYORI_STRING Detail,
+    __in DWORDLONG Value
+    )
+{
+    UCHAR EventMetadata[YORI_ETW_MAX_EVENT_METADATA];
+    YORI_EVENT_DESCRIPTOR EventDescriptor;
+    YORI_EVENT_DATA_DESCRIPTOR Data[5];
+    DWORD Offset;
+    USHORT DetailLength;
+
+    if (!YoriLibEtwState.Enabled) {
+        return;
+    }
+
+    //
+    //  The event metadata is a 16 bit length, a byte of tags, the event
+    //  name, and the name and type of each field.  Leave room for the two
+    //  fixed field descriptions when placing the event name.
+    //
+
+    Offset = sizeof(USHORT);
+    EventMetadata[Offset] = 0;
+    Offset++;
+    YoriLibEtwAppendMetadataString(EventMetadata, &Offset, EventName);
+    if (Offset > YORI_ETW_MAX_EVENT_METADATA - 16) {
+        Offset = YORI_ETW_MAX_EVENT_METADATA - 16;
+        EventMetadata[Offset - 1] = '\0';
+    }
+    YoriLibEtwAppendMetadataString(EventMetadata, &Offset, "Detail");
+    EventMetadata[Offset] = YORI_ETW_TYPE_COUNTED_UTF16;
+    Offset++;
+    YoriLibEtwAppendMetadataString(EventMetadata, &Offset, "Value");
+    EventMetadata[Offset] = YORI_ETW_TYPE_UINT64;
+    Offset++;
+    EventMetadata[0] = (UCHAR)(Offset & 0xFF);
+    EventMetadata[1] = (UCHAR)(Offset >> 8);
+
+    ZeroMemory(&EventDescriptor, sizeof(EventDescriptor));
+    EventDescriptor.Channel = YORI_ETW_CHANNEL_TRACELOGGING;
+    EventDescriptor.Level = YORI_ETW_LEVEL_VERBOSE;
+    EventDescriptor.Opcode = Opcode;
+
+    DetailLength = 0;
+    if (Detail != NULL) {
+        if (Detail->LengthInChars > 0x7FFF) {
+            DetailLength = 0x7FFF * sizeof(TCHAR);
+        } else {
+            DetailLength = (USHORT)(Detail->LengthInChars * sizeof(TCHAR));
+        }
+    }
+
+    ZeroMemory(Data, sizeof(Data));
+    Data[0].Ptr = (DWORDLONG)(DWORD_PTR)YoriLibEtwProviderMetadata;
+    Data[0].Size = sizeof(YoriLibEtwProviderMetadata);
+    Data[0].Type = YORI_ETW_DATA_PROVIDER_METADATA;
+    Data[1].Ptr = (DWORDLONG)(DWORD_PTR)EventMetadata;
+    Data[1].Size = Offset;
+    Data[1].Type = YORI_ETW_DATA_EVENT_METADATA;
+    Data[2].Ptr = (DWORDLONG)(DWORD_PTR)&DetailLength;
+    Data[2].Size = sizeof(DetailLength);
+    if (DetailLength > 0) {
+        Data[3].Ptr = (DWORDLONG)(DWORD_PTR)Detail->StartOfString;
+    }
+    Data[3].Size = DetailLength;
+    Data[4].Ptr = (DWORDLONG)(DWORD_PTR)&Value;
+    Data[4].Size = sizeof(Value);
+
+    DllAdvApi32.pEventWriteTransfer(YoriLibEtwState.RegHandle, &EventDescriptor, NULL, NULL, sizeof(Data)/sizeof(Data[0]), Data);
+}
+
+// vim:sw=4:ts=4:et:
@@ -34,9 +34,9 @@
 typedef struct _YORILIB_PENDING_ACTION {
 
     /**
-     A list of files requiring compression.
+     The work queue item for this file.
      */
-    YORI_LIST_ENTRY CompressList;
+    YORILIB_WORK_ITEM WorkItem;
 
     /**
      The file name to compress.
@@ -51,6 +51,46 @@ typedef struct _YORILIB_PENDING_ACTION {
 
 } YORILIB_PENDING_ACTION, *PYORILIB_PENDING_ACTION;
 
+/**
+ The outcome of processing a single file, used to update the progress of a
+ compress context.
+ */
+typedef enum _YORILIB_COMPRESS_OUTCOME {
+    YoriLibCompressOutcomeCompressed = 0,
+    YoriLibCompressOutcomeDecompressed = 1,
+    YoriLibCompressOutcomeNotBeneficial = 2,
+    YoriLibCompressOutcomeSkipped = 3,
+    YoriLibCompressOutcomeFailed = 4
+} YORILIB_COMPRESS_OUTCOME;
+
+/**
+ The default size, in bytes, below which files are not compressed.  File
+ system compression works by storing the data in fewer allocation units, so
+ for files that are very small the possibility and quantity of allocation
+ units reclaimed can't justify the overhead.
+ */
+#define YORILIB_COMPRESS_DEFAULT_MINIMUM_SIZE (10 * 1024)
+
+/**
+ The number of files with a given extension which must have been compressed
+ before the ratio achieved is used to skip further files with the extension.
+ */
+#define YORILIB_COMPRESS_MIN_SAMPLES (8)
+
+/**
+ Files with an extension are skipped once files with the extension have
+ been compressed to no less than this percentage of their original size.
+ This is typical of file formats which are already compressed.
+ */
+#define YORILIB_COMPRESS_SKIP_PERCENTAGE (95)
+
+VOID
+YoriLibCompressWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    );
+
 /**
  Set up the compress context to contain support for the compression thread pool.
 
@@ -69,35 +109,15 @@ YoriLibInitializeCompressContext(
     )
 {
     SYSTEM_INFO SystemInfo;
-    GetSystemInfo(&SystemInfo);
+    YORI_ALLOC_SIZE_T MaxThreads;
 
     CompressContext->CompressionAlgorithm = CompressionAlgorithm;
+    CompressContext->ExtensionCount = 0;
+    ZeroMemory(&CompressContext->Progress, sizeof(CompressContext->Progress));
+    CompressContext->Progress.StartTime = YoriLibGetSystemTimeAsInteger();
 
-    //
-    //  Create threads equal to the number of CPUs.  The system can compress
-    //  chunks of data on background threads, so this is just the number of
-    //  threads initiating work.  Unfortunately, the call to CreateFile
-    //  after copy has a tendency to block, so we need this to be part of
-    //  the threadpool to prevent bottlenecking the copy.
-    //
-
-    CompressContext->MaxThreads = (YORI_ALLOC_SIZE_T)SystemInfo.dwNumberOfProcessors;
-    if (CompressContext->MaxThreads < 1) {
-        CompressContext->MaxThreads = 1;
-    }
-    if (CompressContext->MaxThreads > 32) {
-        CompressContext->MaxThreads = 32;
-    }
-
-    YoriLibInitializeListHead(&CompressContext->PendingList);
-    CompressContext->WorkerWaitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-    if (CompressContext->WorkerWaitEvent == NULL) {
-        return FALSE;
-    }
-
-    CompressContext->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (CompressContext->WorkerShutdownEvent == NULL) {
-        return FALSE;
+    if (CompressContext->MinimumFileSize == 0) {
+        CompressContext->MinimumFileSize = YORILIB_COMPRESS_DEFAULT_MINIMUM_SIZE;
     }
 
     CompressContext->Mutex = CreateMutex(NULL, FALSE, NULL);
@@ -105,19 +125,36 @@ YoriLibInitializeCompressContext(
         return FALSE;
     }
 
-    CompressContext->Threads = YoriLibMalloc(sizeof(HANDLE) * CompressContext->MaxThreads);
-    if (CompressContext->Threads == NULL) {
-        return FALSE;
+    //
+    //  Unless the caller specified otherwise, create threads equal to the
+    //  number of CPUs.  The system can compress chunks of data on background
+    //  threads, so this is just the number of threads initiating work.
+    //  Unfortunately, the call to CreateFile after copy has a tendency to
+    //  block, so we need this to be part of the threadpool to prevent
+    //  bottlenecking the copy.
+    //
+
+    MaxThreads = CompressContext->ThreadCount;
+    if (MaxThreads == 0) {
+        GetSystemInfo(&SystemInfo);
+        MaxThreads = (YORI_ALLOC_SIZE_T)SystemInfo.dwNumberOfProcessors;
+        if (MaxThreads < 1) {
+            MaxThreads = 1;
+        }
+        if (MaxThreads > 32) {
+            MaxThreads = 32;
+        }
     }
 
-    return TRUE;
+    return YoriLibInitializeWorkQueue(&CompressContext->WorkQueue, MaxThreads, 0, YoriLibCompressWorkItem, CompressContext);
 }
 
 /**
  Free the internal allocations and state of a compress context.  This
  also includes waiting for all outstanding compression tasks to complete.
  Note the CompressContext allocation itself is not freed, since this is
- typically on the stack.
+ typically on the stack.  Since no more work is outstanding, the progress
+ counters in the context can be read directly after this call.
 
  @param CompressContext Pointer to the compress context to clean up.
  */
@@ -126,58 +163,266 @@ YoriLibFreeCompressContext(
     __in PYORILIB_COMPRESS_CONTEXT CompressContext
     )
 {
-    if (CompressContext->ThreadsAllocated > 0) {
-        DWORD Index;
-        SetEvent(CompressContext->WorkerShutdownEvent);
-        WaitForMultipleObjectsEx(CompressContext->ThreadsAllocated, CompressContext->Threads, TRUE, INFINITE, FALSE);
-        for (Index = 0; Index < CompressContext->ThreadsAllocated; Index++) {
-            CloseHandle(CompressContext->Threads[Index]);
-            CompressContext->Threads[Index] = NULL;
+    YoriLibCleanupWorkQueue(&CompressContext->WorkQueue);
+    if (CompressContext->Mutex != NULL) {
+        CloseHandle(CompressContext->Mutex);
+        CompressContext->Mutex = NULL;
+    }
+}
+
+/**
+ Find the extension of a file whose compression ratio can be tracked.
+
+ @param FileName Pointer to the file name.
+
+ @param Extension On successful completion, updated to point to the
+        extension within FileName, not including the period.
+
+ @return TRUE to indicate the file has an extension that can be tracked,
+         FALSE if it does not.
+ */
+__success(return)
+BOOLEAN
+YoriLibCompressGetExtension(
+    __in PYORI_STRING FileName,
+    __out PYORI_STRING Extension
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = FileName->LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(FileName->StartOfString[Index - 1])) {
+            return FALSE;
+        }
+        if (FileName->StartOfString[Index - 1] == '.') {
+            break;
         }
-        ASSERT(YoriLibIsListEmpty(&CompressContext->PendingList));
     }
-    if (CompressContext->WorkerWaitEvent != NULL) {
-        CloseHandle(CompressContext->WorkerWaitEvent);
-        CompressContext->WorkerWaitEvent = NULL;
+
+    if (Index == 0 ||
+        Index == FileName->LengthInChars ||
+        FileName->LengthInChars - Index >= YORILIB_COMPRESS_MAX_EXTENSION_LENGTH) {
+
+        return FALSE;
     }
-    if (CompressContext->WorkerShutdownEvent != NULL) {
-        CloseHandle(CompressContext->WorkerShutdownEvent);
-        CompressContext->WorkerShutdownEvent = NULL;
+
+    YoriLibInitEmptyString(Extension);
+    Extension->StartOfString = &FileName->StartOfString[Index];
+    Extension->LengthInChars = FileName->LengthInChars - Index;
+    return TRUE;
+}
+
+/**
+ Find the compression ratio record for a file extension.  This must be
+ called with the compress context mutex held.
+
+ @param CompressContext Pointer to the compress context.
+
+ @param Extension Pointer to the extension to find.
+
+ @param Create If TRUE, and the extension is not already tracked, a new
+        record is created if space allows.
+
+ @return Pointer to the record, or NULL if the extension is not tracked.
+ */
+PYORILIB_COMPRESS_EXTENSION_STATS
+YoriLibCompressFindExtensionStats(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __in PYORI_STRING Extension,
+    __in BOOLEAN Create
+    )
+{
+    DWORD Index;
+    YORI_STRING Existing;
+    PYORILIB_COMPRESS_EXTENSION_STATS Stats;
+
+    for (Index = 0; Index < CompressContext->ExtensionCount; Index++) {
+        Stats = &CompressContext->ExtensionStats[Index];
+        YoriLibConstantString(&Existing, Stats->Extension);
+        if (YoriLibCompareStringInsensitive(&Existing, Extension) == 0) {
+            return Stats;
+        }
+    }
+
+    if (!Create || CompressContext->ExtensionCount >= YORILIB_COMPRESS_MAX_EXTENSIONS) {
+        return NULL;
+    }
+
+    ASSERT(Extension->LengthInChars < YORILIB_COMPRESS_MAX_EXTENSION_LENGTH);
+    Stats = &CompressContext->ExtensionStats[CompressContext->ExtensionCount];
+    ZeroMemory(Stats, sizeof(YORILIB_COMPRESS_EXTENSION_STATS));
+    memcpy(Stats->Extension, Extension->StartOfString, Extension->LengthInChars * sizeof(TCHAR));
+    Stats->Extension[Extension->LengthInChars] = '\0';
+    CompressContext->ExtensionCount++;
+    return Stats;
+}
+
+/**
+ Check whether previous files with the same extension as a file have
+ compressed well enough to justify compressing this one.
+
+ @param CompressContext Pointer to the compress context.
+
+ @param FileName Pointer to the name of the file to check.
+
+ @return TRUE if the file should be compressed, FALSE if previous files
+         with the same extension did not benefit from compression.
+ */
+BOOLEAN
+YoriLibCompressIsExtensionBeneficial(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __in PYORI_STRING FileName
+    )
+{
+    YORI_STRING Extension;
+    PYORILIB_COMPRESS_EXTENSION_STATS Stats;
+    BOOLEAN Beneficial;
+
+    if (!YoriLibCompressGetExtension(FileName, &Extension)) {
+        return TRUE;
+    }
+
+    Beneficial = TRUE;
+    WaitForSingleObject(CompressContext->Mutex, INFINITE);
+    Stats = YoriLibCompressFindExtensionStats(CompressContext, &Extension, FALSE);
+    if (Stats != NULL &&
+        Stats->FilesSampled >= YORILIB_COMPRESS_MIN_SAMPLES &&
+        Stats->CompressedSize * 100 >= Stats->OriginalSize * YORILIB_COMPRESS_SKIP_PERCENTAGE) {
+
+        Beneficial = FALSE;
+    }
+    ReleaseMutex(CompressContext->Mutex);
+
+    return Beneficial;
+}
+
+/**
+ Update the progress of a compress context after processing a file.
+
+ @param CompressContext Pointer to the compress context.
+
+ @param FileName Pointer to the name of the file that was processed.
+
+ @param Outcome Indicates the result of processing the file.
+
+ @param OriginalSize The size of the file before processing.
+
+ @param StoredSize The size of the file after compression.  This is only
+        meaningful if the file was compressed.
+ */
+VOID
+YoriLibCompressRecordOutcome(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __in PYORI_STRING FileName,
+    __in YORILIB_COMPRESS_OUTCOME Outcome,
+    __in DWORDLONG OriginalSize,
+    __in DWORDLONG StoredSize
+    )
+{
+    YORI_STRING Extension;
+    PYORILIB_COMPRESS_EXTENSION_STATS Stats;
+
+    WaitForSingleObject(CompressContext->Mutex, INFINITE);
+
+    if (Outcome == YoriLibCompressOutcomeCompressed ||
+        Outcome == YoriLibCompressOutcomeNotBeneficial) {
+
+        if (YoriLibCompressGetExtension(FileName, &Extension)) {
+            Stats = YoriLibCompressFindExtensionStats(CompressContext, &Extension, TRUE);
+            if (Stats != NULL) {
+                Stats->FilesSampled++;
+                Stats->OriginalSize = Stats->OriginalSize + OriginalSize;
+                Stats->CompressedSize = Stats->CompressedSize + StoredSize;
+            }
+        }
     }
+
+    if (Outcome == YoriLibCompressOutcomeCompressed) {
+        CompressContext->Progress.FilesProcessed++;
+        CompressContext->Progress.BytesProcessed = CompressContext->Progress.BytesProcessed + OriginalSize;
+        CompressContext->Progress.BytesStored = CompressContext->Progress.BytesStored + StoredSize;
+    } else if (Outcome == YoriLibCompressOutcomeDecompressed) {
+        CompressContext->Progress.FilesProcessed++;
+        CompressContext->Progress.BytesProcessed = CompressContext->Progress.BytesProcessed + OriginalSize;
+    } else if (Outcome == YoriLibCompressOutcomeFailed) {
+        CompressContext->Progress.FilesFailed++;
+    } else {
+        CompressContext->Progress.FilesSkipped++;
+    }
+
+    ReleaseMutex(CompressContext->Mutex);
+}
+
+/**
+ Return the progress of a compress context.  This can be called while files
+ are being processed by background threads.
+
+ @param CompressContext Pointer to the compress context.
+
+ @param Progress On completion, populated with the progress counters of the
+        compress context.
+ */
+VOID
+YoriLibGetCompressProgress(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __out PYORILIB_COMPRESS_PROGRESS Progress
+    )
+{
     if (CompressContext->Mutex != NULL) {
-        CloseHandle(CompressContext->Mutex);
-        CompressContext->Mutex = NULL;
+        WaitForSingleObject(CompressContext->Mutex, INFINITE);
     }
-    if (CompressContext->Threads != NULL) {
-        YoriLibFree(CompressContext->Threads);
-        CompressContext->Threads = NULL;
+    memcpy(Progress, &CompressContext->Progress, sizeof(YORILIB_COMPRESS_PROGRESS));
+    if (CompressContext->Mutex != NULL) {
+        ReleaseMutex(CompressContext->Mutex);
     }
 }
 
 /**
  Compress a single file.  This can be called on worker threads, or occasionally
- on the main thread if the worker threads are backlogged.
+ on the main thread if the worker threads are backlogged.  Files which are
+ already compressed, are too small to benefit, or have an extension that
+ previously did not compress well are skipped.
+
+ @param CompressContext Pointer to the compress context specifying the
+        compression algorithm and recording progress.
 
  @param PendingAction Pointer to the object that needs to be compressed.
         This structure is deallocated within this function.
 
- @param CompressionAlgorithm Specifies the compression algorithm to compress
-        the file with.
- 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 YoriLibCompressSingleFile(
-    __in PYORILIB_PENDING_ACTION PendingAction,
-    __in YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __in PYORILIB_PENDING_ACTION PendingAction
     )
 {
     HANDLE DestFileHandle;
     DWORD AccessRequired;
     BY_HANDLE_FILE_INFORMATION FileInfo;
     DWORD BytesReturned;
+    DWORD Err;
     BOOL Result = FALSE;
-    BOOL CompressFile = TRUE;
+    YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm;
+    YORILIB_COMPRESS_OUTCOME Outcome;
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER StoredSize;
+
+    CompressionAlgorithm = CompressContext->CompressionAlgorithm;
+    Outcome = YoriLibCompressOutcomeFailed;
+    FileSize.QuadPart = 0;
+    StoredSize.QuadPart = 0;
+
+    //
+    //  If previous files with this extension didn't compress meaningfully,
+    //  this one probably won't either, so don't bother opening it.
+    //
+
+    if (!YoriLibCompressIsExtensionBeneficial(CompressContext, &PendingAction->FileName)) {
+        YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, YoriLibCompressOutcomeSkipped, 0, 0);
+        YoriLibFree(PendingAction);
+        return TRUE;
+    }
 
     //
     //  In order to compress system files, we can't open for write access.
@@ -199,6 +444,7 @@ YoriLibCompressSingleFile(
                                 NULL);
 
     if (DestFileHandle == INVALID_HANDLE_VALUE) {
+        YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, YoriLibCompressOutcomeFailed, 0, 0);
         YoriLibFree(PendingAction);
         return FALSE;
     }
@@ -214,9 +460,14 @@ YoriLibCompressSingleFile(
         goto Exit;
     }
 
+    FileSize.HighPart = FileInfo.nFileSizeHigh;
+    FileSize.LowPart = FileInfo.nFileSizeLow;
+
     if (FileInfo.nFileSizeHigh == 0 &&
-        FileInfo.nFileSizeLow < 10 * 1024) {
+        FileInfo.nFileSizeLow < CompressContext->MinimumFileSize) {
 
+        Outcome = YoriLibCompressOutcomeSkipped;
+        Result = TRUE;
         goto Exit;
     }
 
@@ -224,6 +475,16 @@ YoriLibCompressSingleFile(
     if (CompressionAlgorithm.NtfsAlgorithm != 0) {
         USHORT Algorithm = (USHORT)CompressionAlgorithm.NtfsAlgorithm;
 
+        //
+        //  If the file is already NTFS compressed, there's nothing to do.
+        //
+
+        if (FileInfo.dwFileAttributes & FILE_ATTRIBUTE_COMPRESSED) {
+            Outcome = YoriLibCompressOutcomeSkipped;
+            Result = TRUE;
+            goto Exit;
+        }
+
         Result = DeviceIoControl(DestFileHandle,
                                  FSCTL_SET_COMPRESSION,
                                  &Algorithm,
@@ -256,25 +517,49 @@ YoriLibCompressSingleFile(
                 CompressInfo.FileInfo.Version == 1 &&
                 CompressInfo.FileInfo.Algorithm == CompressionAlgorithm.WofAlgorithm) {
 
-                CompressFile = FALSE;
+                Outcome = YoriLibCompressOutcomeSkipped;
+                goto Exit;
             }
         }
 
-        if (CompressFile) {
-            ZeroMemory(&CompressInfo, sizeof(CompressInfo));
-            CompressInfo.WofInfo.Version = 1;
-            CompressInfo.WofInfo.Provider = WOF_PROVIDER_FILE;
-            CompressInfo.FileInfo.Version = 1;
-            CompressInfo.FileInfo.Algorithm = CompressionAlgorithm.WofAlgorithm;
-
-            Result = DeviceIoControl(DestFileHandle,
-                                     FSCTL_SET_EXTERNAL_BACKING,
-                                     &CompressInfo,
-                                     sizeof(CompressInfo),
-                                     NULL,
-                                     0,
-                                     &BytesReturned,
-                                     NULL);
+        ZeroMemory(&CompressInfo, sizeof(CompressInfo));
+        CompressInfo.WofInfo.Version = 1;
+        CompressInfo.WofInfo.Provider = WOF_PROVIDER_FILE;
+        CompressInfo.FileInfo.Version = 1;
+        CompressInfo.FileInfo.Algorithm = CompressionAlgorithm.WofAlgorithm;
+
+        Result = DeviceIoControl(DestFileHandle,
+                                 FSCTL_SET_EXTERNAL_BACKING,
+                                 &CompressInfo,
+                                 sizeof(CompressInfo),
+                                 NULL,
+                                 0,
+                                 &BytesReturned,
+                                 NULL);
+    }
+
+    //
+    //  Record how much space the file uses now so that the ratio for files
+    //  of this type can be tracked.  If the file system indicated that
+    //  compression wouldn't help, record that too, since it says the same
+    //  thing about files of this type.
+    //
+
+    if (Result) {
+        Outcome = YoriLibCompressOutcomeCompressed;
+        StoredSize.QuadPart = FileSize.QuadPart;
+        if (DllKernel32.pGetCompressedFileSizeW != NULL) {
+            StoredSize.LowPart = DllKernel32.pGetCompressedFileSizeW(PendingAction->FileName.StartOfString, (PDWORD)&StoredSize.HighPart);
+            if (StoredSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+                StoredSize.QuadPart = FileSize.QuadPart;
+            }
+        }
+    } else {
+        Err = GetLastError();
+        if (Err == ERROR_COMPRESSION_NOT_BENEFICIAL) {
+            Outcome = YoriLibCompressOutcomeNotBeneficial;
+            StoredSize.QuadPart = FileSize.QuadPart;
+            Result = TRUE;
         }
     }
 
@@ -282,6 +567,7 @@ Exit:
     if (DestFileHandle != NULL) {
         CloseHandle(DestFileHandle);
     }
+    YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, Outcome, FileSize.QuadPart, StoredSize.QuadPart);
     YoriLibFree(PendingAction);
     return Result;
 }
@@ -290,6 +576,8 @@ Exit:
  Decompress a single file.  This can be called on worker threads, or
  occasionally on the main thread if the worker threads are backlogged.
 
+ @param CompressContext Pointer to the compress context recording progress.
+
  @param PendingAction Pointer to the object that needs to be decompressed.
         This structure is deallocated within this function.
 
@@ -297,6 +585,7 @@ Exit:
  */
 BOOL
 YoriLibDecompressSingleFile(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
     __in PYORILIB_PENDING_ACTION PendingAction
     )
 {
@@ -306,6 +595,8 @@ YoriLibDecompressSingleFile(
     BOOL LocalResult;
     USHORT Algorithm = 0;
     HANDLE DestFileHandle;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    LARGE_INTEGER FileSize;
 
     //
     //  Normally WOF will decompress if a file is opened for FILE_WRITE_DATA
@@ -349,10 +640,17 @@ YoriLibDecompressSingleFile(
     }
 
     if (DestFileHandle == INVALID_HANDLE_VALUE) {
+        YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, YoriLibCompressOutcomeFailed, 0, 0);
         YoriLibFree(PendingAction);
         return FALSE;
     }
 
+    FileSize.QuadPart = 0;
+    if (GetFileInformationByHandle(DestFileHandle, &FileInfo)) {
+        FileSize.HighPart = FileInfo.nFileSizeHigh;
+        FileSize.LowPart = FileInfo.nFileSizeLow;
+    }
+
     if ((AccessRequired & FILE_WRITE_DATA) != 0) {
         LocalResult = DeviceIoControl(DestFileHandle,
                                       FSCTL_SET_COMPRESSION,
@@ -404,129 +702,46 @@ YoriLibDecompressSingleFile(
     }
 
     CloseHandle(DestFileHandle);
+    if (GlobalResult) {
+        YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, YoriLibCompressOutcomeDecompressed, FileSize.QuadPart, 0);
+    } else {
+        YoriLibCompressRecordOutcome(CompressContext, &PendingAction->FileName, YoriLibCompressOutcomeFailed, 0, 0);
+    }
     YoriLibFree(PendingAction);
     return GlobalResult;
 }
 
 
 /**
- A background thread which will attempt to compress any items that it finds on
- a list of files requiring compression.
+ Compress or decompress a single file on a worker thread.
 
  @param Context Pointer to the compress context.
 
- @return TRUE to indicate success, FALSE to indicate one or more compression
-         operations failed.
+ @param Item Pointer to the work item within the pending action.  The
+        pending action is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be processed.
  */
-DWORD WINAPI
-YoriLibCompressWorker(
-    __in LPVOID Context
+VOID
+YoriLibCompressWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
     )
 {
     PYORILIB_COMPRESS_CONTEXT CompressContext = (PYORILIB_COMPRESS_CONTEXT)Context;
-    DWORD FoundEvent;
     PYORILIB_PENDING_ACTION PendingAction;
-    BOOL Result = TRUE;
-
-    while (TRUE) {
-
-        //
-        //  Wait for an indication of more work or shutdown.
-        //
-
-        FoundEvent = WaitForMultipleObjectsEx(2, &CompressContext->WorkerWaitEvent, FALSE, INFINITE, FALSE);
-
-        //
-        //  Process any queued work.
-        //
-
-        while (TRUE) {
-            WaitForSingleObject(CompressContext->Mutex, INFINITE);
-            if (!YoriLibIsListEmpty(&CompressContext->PendingList)) {
-                PendingAction = CONTAINING_RECORD(CompressContext->PendingList.Next, YORILIB_PENDING_ACTION, CompressList);
-                ASSERT(CompressContext->ItemsQueued > 0);
-                CompressContext->ItemsQueued--;
-                YoriLibRemoveListItem(&PendingAction->CompressList);
-                ReleaseMutex(CompressContext->Mutex);
-
-                if (PendingAction->Compress) {
-                    if (!YoriLibCompressSingleFile(PendingAction, CompressContext->CompressionAlgorithm)) {
-                        Result = FALSE;
-                    }
-                } else {
-                    if (!YoriLibDecompressSingleFile(PendingAction)) {
-                        Result = FALSE;
-                    }
-                }
-
-            } else {
-                ASSERT(CompressContext->ItemsQueued == 0);
-                ReleaseMutex(CompressContext->Mutex);
-                break;
-            }
-        }
-
-        //
-        //  If shutdown was requested, terminate the thread.
-        //
-
-        if (FoundEvent == (WAIT_OBJECT_0 + 1)) {
-            break;
-        }
-    }
 
-    return Result;
-}
-
-/**
- Add a pending action to the queue of items to be performed by background
- threads.  If the background threads already have an excessively large
- queue of work, this function returns FALSE to indicate it should be
- completed by the foreground thread.
-
- @param CompressContext Pointer to the compress context describing the state
-        of background threads.
-
- @param PendingAction Pointer to the action to perform.
-
- @return TRUE if the action was queued to be processed by background threads,
-         or FALSE if it should be completed by the foreground thread.
- */
-BOOL
-YoriLibAddToBackgroundCompressQueue(
-    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
-    __in PYORILIB_PENDING_ACTION PendingAction
-    )
-{
-    BOOL Result = FALSE;
-    DWORD ThreadId;
+    PendingAction = CONTAINING_RECORD(Item, YORILIB_PENDING_ACTION, WorkItem);
 
-    WaitForSingleObject(CompressContext->Mutex, INFINITE);
-    if (CompressContext->ThreadsAllocated == 0 ||
-        (CompressContext->ItemsQueued > CompressContext->ThreadsAllocated * 2 &&
-         CompressContext->ThreadsAllocated < CompressContext->MaxThreads)) {
-
-        CompressContext->Threads[CompressContext->ThreadsAllocated] = CreateThread(NULL, 0, YoriLibCompressWorker, CompressContext, 0, &ThreadId);
-        if (CompressContext->Threads[CompressContext->ThreadsAllocated] != NULL) {
-            CompressContext->ThreadsAllocated++;
-            if (CompressContext->Verbose) {
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Created compression thread %i\n"), CompressContext->ThreadsAllocated);
-            }
-        }
-    }
-
-    if (CompressContext->ThreadsAllocated > 0 &&
-        CompressContext->ItemsQueued < CompressContext->MaxThreads * 2) {
-
-        YoriLibAppendList(&CompressContext->PendingList, &PendingAction->CompressList);
-        CompressContext->ItemsQueued++;
-        Result = TRUE;
+    if (Cancelled) {
+        YoriLibFree(PendingAction);
+    } else if (PendingAction->Compress) {
+        YoriLibCompressSingleFile(CompressContext, PendingAction);
+    } else {
+        YoriLibDecompressSingleFile(CompressContext, PendingAction);
     }
-
-    ReleaseMutex(CompressContext->Mutex);
-
-    SetEvent(CompressContext->WorkerWaitEvent);
-    return Result;
 }
 
 /**
@@ -563,7 +778,7 @@ YoriLibCompressFileInBackground(
     PendingAction->FileName.LengthAllocated = FileName->LengthInChars + 1;
     memcpy(PendingAction->FileName.StartOfString, FileName->StartOfString, (FileName->LengthInChars + 1) * sizeof(TCHAR));
 
-    if (YoriLibAddToBackgroundCompressQueue(CompressContext, PendingAction)) {
+    if (YoriLibQueueWorkItem(&CompressContext->WorkQueue, &PendingAction->WorkItem, FALSE)) {
         PendingAction = NULL;
     }
 
@@ -580,7 +795,7 @@ YoriLibCompressFileInBackground(
         if (CompressContext->Verbose) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Compressing %y on main thread for back pressure\n"), FileName);
         }
-        if (!YoriLibCompressSingleFile(PendingAction, CompressContext->CompressionAlgorithm)) {
+        if (!YoriLibCompressSingleFile(CompressContext, PendingAction)) {
             Result = FALSE;
         }
     }
@@ -622,7 +837,7 @@ YoriLibDecompressFileInBackground(
     PendingAction->FileName.LengthAllocated = FileName->LengthInChars + 1;
     memcpy(PendingAction->FileName.StartOfString, FileName->StartOfString, (FileName->LengthInChars + 1) * sizeof(TCHAR));
 
-    if (YoriLibAddToBackgroundCompressQueue(CompressContext, PendingAction)) {
+    if (YoriLibQueueWorkItem(&CompressContext->WorkQueue, &PendingAction->WorkItem, FALSE)) {
         PendingAction = NULL;
     }
 
@@ -639,7 +854,7 @@ YoriLibDecompressFileInBackground(
         if (CompressContext->Verbose) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Decompressing %y on main thread for back pressure\n"), FileName);
         }
-        if (!YoriLibDecompressSingleFile(PendingAction)) {
+        if (!YoriLibDecompressSingleFile(CompressContext, PendingAction)) {
             Result = FALSE;
         }
     }
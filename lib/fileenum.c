@@ -27,6 +27,296 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+/**
+ The number of bytes to allocate initially when collecting the contents of
+ a directory on a worker thread.  This is doubled as needed.
+ */
+#define YORILIB_FOREACHFILE_LISTING_INITIAL_SIZE (16 * 1024)
+
+/**
+ The maximum number of directory listings that can be queued, in progress,
+ or complete and waiting for the enumerating thread at any one time.  This
+ bounds the amount of memory used by workers enumerating ahead of the
+ enumerating thread.
+ */
+#define YORILIB_FOREACHFILE_MAX_LISTINGS (1024)
+
+/**
+ The minimum number of worker threads to use when enumerating in parallel.
+ Enumeration is typically bound by the latency of the file system rather
+ than processor time, so this many threads are useful even on machines with
+ fewer processors.
+ */
+#define YORILIB_FOREACHFILE_MIN_THREADS (4)
+
+/**
+ The maximum number of worker threads to use when enumerating in parallel.
+ */
+#define YORILIB_FOREACHFILE_MAX_THREADS (16)
+
+/**
+ A compact form of a single directory entry collected by a worker thread.
+ This is followed by the file name and short file name, neither of which
+ are NULL terminated.
+ */
+typedef struct _YORILIB_FOREACHFILE_ENTRY {
+
+    /**
+     The length of this entry in bytes, including the names that follow it
+     and any padding needed to align the next entry.
+     */
+    DWORD EntryLength;
+
+    /**
+     The attributes of the object.
+     */
+    DWORD FileAttributes;
+
+    /**
+     The time the object was created.
+     */
+    FILETIME CreationTime;
+
+    /**
+     The time the object was last accessed.
+     */
+    FILETIME LastAccessTime;
+
+    /**
+     The time the object was last written.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The high 32 bits of the size of the object.
+     */
+    DWORD FileSizeHigh;
+
+    /**
+     The low 32 bits of the size of the object.
+     */
+    DWORD FileSizeLow;
+
+    /**
+     The reparse tag of the object, if it is a reparse point.
+     */
+    DWORD Reserved0;
+
+    /**
+     Reserved for future use by the system.
+     */
+    DWORD Reserved1;
+
+    /**
+     The length of the file name that follows this structure, in
+     characters.
+     */
+    WORD FileNameLength;
+
+    /**
+     The length of the short file name that follows the file name, in
+     characters.
+     */
+    WORD AlternateFileNameLength;
+} YORILIB_FOREACHFILE_ENTRY, *PYORILIB_FOREACHFILE_ENTRY;
+
+/**
+ The state of a directory listing which may be collected by a worker
+ thread.
+ */
+typedef enum _YORILIB_FOREACHFILE_ITEM_STATE {
+    YoriLibForEachFileItemQueued = 0,
+    YoriLibForEachFileItemInProgress = 1,
+    YoriLibForEachFileItemComplete = 2
+} YORILIB_FOREACHFILE_ITEM_STATE;
+
+/**
+ A single unit of work for a parallel enumerate.  When callbacks are
+ delivered in order, this describes the contents of a directory that is
+ collected by a worker thread ahead of the enumerating thread needing it.
+ When callbacks are unordered, this describes a subdirectory tree which a
+ worker thread enumerates in its entirety.
+ */
+typedef struct _YORILIB_FOREACHFILE_WORK_ITEM {
+
+    /**
+     The link of this item within the list of items waiting for a worker
+     thread.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     For a directory listing, the entry within the hash table of listings
+     which allows the enumerating thread to find it.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     For a directory listing, the search string to pass to FindFirstFile.
+     For a subdirectory tree, the criteria to enumerate.
+     */
+    YORI_STRING Path;
+
+    /**
+     For a subdirectory tree, the depth of the tree's root.
+     */
+    DWORD Depth;
+
+    /**
+     For a directory listing, the error encountered while collecting it,
+     or ERROR_SUCCESS if it was collected successfully.
+     */
+    DWORD Error;
+
+    /**
+     For a directory listing, a buffer containing an array of variable
+     sized YORILIB_FOREACHFILE_ENTRY structures.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The size of Buffer, in bytes.
+     */
+    DWORD BufferLength;
+
+    /**
+     The number of bytes in Buffer that contain entries.
+     */
+    DWORD BufferUsed;
+
+    /**
+     For a directory listing, whether it is waiting for a worker, being
+     collected, or complete.
+     */
+    YORILIB_FOREACHFILE_ITEM_STATE State;
+
+    /**
+     TRUE if this item describes a subdirectory tree, FALSE if it
+     describes a directory listing.
+     */
+    BOOLEAN Subtree;
+} YORILIB_FOREACHFILE_WORK_ITEM, *PYORILIB_FOREACHFILE_WORK_ITEM;
+
+/**
+ State for a parallel enumerate, shared between the enumerating thread and
+ the worker threads.
+ */
+typedef struct _YORILIB_FOREACHFILE_PARALLEL {
+
+    /**
+     A mutex synchronizing the fields in this structure and the state of
+     work items.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled when worker threads should terminate.  This must
+     immediately precede WorkerWaitSemaphore so both can be waited on
+     together.
+     */
+    HANDLE WorkerShutdownEvent;
+
+    /**
+     A semaphore released once for each work item inserted into the pending
+     list.
+     */
+    HANDLE WorkerWaitSemaphore;
+
+    /**
+     An event signalled when a worker completes a work item.  This is used
+     by the enumerating thread to wait for a listing that is being
+     collected, or for subdirectory trees to complete.
+     */
+    HANDLE CompleteEvent;
+
+    /**
+     An array of handles to worker threads.
+     */
+    PHANDLE Threads;
+
+    /**
+     The maximum number of worker threads.  This corresponds to the size of
+     the Threads array.
+     */
+    DWORD MaxThreads;
+
+    /**
+     The number of worker threads that have been created.
+     */
+    DWORD ThreadsAllocated;
+
+    /**
+     The number of worker threads that are not currently processing a work
+     item.
+     */
+    DWORD IdleThreads;
+
+    /**
+     The list of work items waiting for a worker thread.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     The number of items in PendingList.
+     */
+    DWORD ItemsQueued;
+
+    /**
+     A hash table of directory listings, indexed by search string, which
+     have not yet been consumed by the enumerating thread.
+     */
+    PYORI_HASH_TABLE Listings;
+
+    /**
+     The number of entries in the Listings hash table.
+     */
+    DWORD ListingCount;
+
+    /**
+     The number of subdirectory trees which have been queued and have not
+     yet completed.
+     */
+    DWORD SubtreesOutstanding;
+
+    /**
+     When preserving the wildcard across subdirectories, the wildcard to
+     apply to each subdirectory.
+     */
+    YORI_STRING Wild;
+
+    /**
+     The caller's match flags.
+     */
+    WORD MatchFlags;
+
+    /**
+     TRUE if callbacks can be invoked on any thread in any order.  FALSE if
+     callbacks are invoked on the calling thread in the same order as a
+     serial enumerate.
+     */
+    BOOLEAN Unordered;
+
+    /**
+     Set to TRUE if the enumerate should stop as soon as possible, because a
+     callback failed or the enumerate is being torn down.
+     */
+    BOOLEAN Abort;
+
+    /**
+     The caller's callback to invoke on each match.
+     */
+    PYORILIB_FILE_ENUM_FN Callback;
+
+    /**
+     The caller's callback to invoke if a directory cannot be enumerated.
+     */
+    PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback;
+
+    /**
+     The caller's context to pass to callbacks.
+     */
+    PVOID Context;
+} YORILIB_FOREACHFILE_PARALLEL, *PYORILIB_FOREACHFILE_PARALLEL;
 
 /**
  A dynamically allocated structure so as to avoid putting excessive load
@@ -40,98 +330,942 @@ typedef struct _YORILIB_FOREACHFILE_CONTEXT {
      */
     YORI_STRING EffectiveFileSpec;
 
-    /**
-     A fully qualified path to the directory being enumerated.  This is
-     calculated once to ensure any objects found within the directory can
-     have a full path generated by simple appends, without recalculation.
-     */
-    YORI_STRING ParentFullPath;
+    /**
+     A fully qualified path to the directory being enumerated.  This is
+     calculated once to ensure any objects found within the directory can
+     have a full path generated by simple appends, without recalculation.
+     */
+    YORI_STRING ParentFullPath;
+
+    /**
+     A buffer to hold the path of any object found in the directory,
+     generated via ParentFullPath above and the name of any object found
+     via enumerate.
+     */
+    YORI_STRING FullPath;
+
+    /**
+     The number of phases in the enumerate.  Enumerations within a single
+     directory only require a single phase, but recursive enumerates require
+     a phase to operate on the current directory and a phase to recurse into
+     any subdirectories.
+     */
+    WORD NumberPhases;
+
+    /**
+     Indicates the current phase number being used.  Note that for recursive
+     operations, recursion may occur before or after the directory being
+     processed, so this number does not by itself indicate the operation
+     being performed.
+     */
+    WORD CurrentPhase;
+
+    /**
+     The number of characters in EffectiveFileSpec to the final slash. A
+     seperator may not be specified in EffectiveFileSpec, so this is only
+     meaningful if the local FinalSlashFound is set.
+     */
+    YORI_ALLOC_SIZE_T CharsToFinalSlash;
+
+    /**
+     Specifies an enumeration criteria to use if recursively invoking one of
+     the enumeration functions to operate on a subdirectory.
+     */
+    YORI_STRING RecurseCriteria;
+
+    /**
+     The result of the Win32 FindFirstFile operation for the current
+     file.
+     */
+    WIN32_FIND_DATA FileInfo;
+
+    /**
+     When enumerating in parallel, a directory listing collected by a worker
+     thread that is currently being returned in place of FindNextFile.
+     */
+    PYORILIB_FOREACHFILE_WORK_ITEM Listing;
+
+    /**
+     The offset in bytes of the current entry within Listing.
+     */
+    DWORD ListingOffset;
+
+    /**
+     A listing that was returned in a previous phase, retained in case the
+     next phase issues the same search.
+     */
+    PYORILIB_FOREACHFILE_WORK_ITEM SavedListing;
+
+    /**
+     TRUE if the current search is finding subdirectories to recurse into,
+     so listings of those subdirectories should be queued to worker
+     threads.
+     */
+    BOOLEAN QueueChildListings;
+
+    /**
+     TRUE if the current search does not need to return short file names,
+     because the caller does not use them or because the search is only
+     finding subdirectories to recurse into.
+     */
+    BOOLEAN NoShortNames;
+
+} YORILIB_FOREACHFILE_CONTEXT, *PYORILIB_FOREACHFILE_CONTEXT;
+
+/**
+ If a string contains a directory that ends with a seperator, and it's not
+ referring to a drive root, remove the seperator.
+
+ This can be thought of as a mini version of @ref YoriLibFindEffectiveRoot .
+ Unlike that function, this one has to run on purely relative paths that
+ haven't been converted to their full form, where seperators could go
+ either way, where relative components are still present.  Also, it doesn't
+ need to deal with UNC paths because a share and a root are equivalent;
+ there's no concept of "current directory on UNC share" which is the meaning
+ if a trailing seperator is removed from a drive.
+
+ @param String The string to inspect and potentially trim if a trailing
+        seperator is present.
+ */
+VOID
+YoriLibTruncateTrailingSeperatorIfBenign(
+    __inout PYORI_STRING String
+    )
+{
+    //
+    //  Trim trailing slashes, except if the string is just a slash, or if
+    //  the slash follows a drive letter and colon, in which case it's
+    //  meaningful.
+    //
+
+    if (String->LengthInChars > 1 &&
+        YoriLibIsSep(String->StartOfString[String->LengthInChars - 1])) {
+
+        if (YoriLibIsPrefixedDriveLetterWithColonAndSlash(String)) {
+            if (String->LengthInChars >= sizeof("\\\\?\\c:\\")) {
+                String->LengthInChars--;
+            }
+        } else if (YoriLibIsDriveLetterWithColonAndSlash(String)) {
+            if (String->LengthInChars >= sizeof("c:\\")) {
+                String->LengthInChars--;
+            }
+        } else {
+            String->LengthInChars--;
+        }
+    }
+}
+
+__success(return)
+BOOL
+YoriLibForEachFileEnum(
+    __in PYORI_STRING FileSpec,
+    __in WORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
+    );
+
+/**
+ Issue a search for objects matching a search string.  On systems that
+ support it, the directory is read in larger buffers, which reduces the
+ number of requests to the file system for large directories.  If short
+ file names are not needed, they are not requested, which avoids the file
+ system generating or retrieving them.
+
+ @param SearchPath The search string, which must be NULL terminated.
+
+ @param NoShortNames TRUE if cAlternateFileName is not needed.  If TRUE,
+        it may be returned as an empty string.
+
+ @param FileInfo On successful completion, populated with the first match.
+
+ @return A handle to pass to FindNextFile and FindClose, or
+         INVALID_HANDLE_VALUE on failure.
+ */
+HANDLE
+YoriLibForEachFileFindFirstFile(
+    __in PYORI_STRING SearchPath,
+    __in BOOLEAN NoShortNames,
+    __out PWIN32_FIND_DATA FileInfo
+    )
+{
+    DWORD MajorVersion;
+    DWORD MinorVersion;
+    DWORD BuildNumber;
+    DWORD InfoLevel;
+
+    ASSERT(YoriLibIsStringNullTerminated(SearchPath));
+
+    if (YoriLibStats.Enabled) {
+        InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.DirectorySearches);
+    }
+
+    //
+    //  Older systems fail requests for large fetch or basic information,
+    //  so only use FindFirstFileEx on Windows 7 and above.
+    //
+
+    if (DllKernel32.pFindFirstFileExW != NULL) {
+        YoriLibGetOsVersion(&MajorVersion, &MinorVersion, &BuildNumber);
+        if (MajorVersion > 6 || (MajorVersion == 6 && MinorVersion >= 1)) {
+            InfoLevel = YORI_FIND_EX_INFO_STANDARD;
+            if (NoShortNames) {
+                InfoLevel = YORI_FIND_EX_INFO_BASIC;
+            }
+            return DllKernel32.pFindFirstFileExW(SearchPath->StartOfString,
+                                                 InfoLevel,
+                                                 FileInfo,
+                                                 YORI_FIND_EX_SEARCH_NAME_MATCH,
+                                                 NULL,
+                                                 YORI_FIND_FIRST_EX_LARGE_FETCH);
+        }
+    }
+
+    return FindFirstFile(SearchPath->StartOfString, FileInfo);
+}
+
+/**
+ Free a work item used for a parallel enumerate.  The work item must not be
+ in the pending list or the hash table of listings.
+
+ @param Item Pointer to the work item to free.
+ */
+VOID
+YoriLibForEachFileFreeWorkItem(
+    __in PYORILIB_FOREACHFILE_WORK_ITEM Item
+    )
+{
+    if (Item->Buffer != NULL) {
+        YoriLibFree(Item->Buffer);
+    }
+    YoriLibFreeStringContents(&Item->Path);
+    YoriLibFree(Item);
+}
+
+/**
+ Process a single work item on the current thread.  This is normally called
+ on a worker thread, but can also be called on the enumerating thread when
+ it is waiting for subdirectory trees to complete.  The item must have been
+ removed from the pending list.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param Item Pointer to the work item to process.
+ */
+VOID
+YoriLibForEachFileProcessWorkItem(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_WORK_ITEM Item
+    );
+
+/**
+ A worker thread for a parallel enumerate.  It processes work items until
+ told to terminate.
+
+ @param Context Pointer to the parallel enumerate state.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriLibForEachFileWorker(
+    __in LPVOID Context
+    )
+{
+    PYORILIB_FOREACHFILE_PARALLEL Parallel = (PYORILIB_FOREACHFILE_PARALLEL)Context;
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+    DWORD FoundEvent;
+
+    while (TRUE) {
+
+        //
+        //  Wait for an indication of more work or shutdown.  Shutdown is
+        //  first so that it is processed even if work is still queued.
+        //
+
+        FoundEvent = WaitForMultipleObjectsEx(2, &Parallel->WorkerShutdownEvent, FALSE, INFINITE, FALSE);
+        if (FoundEvent != WAIT_OBJECT_0 + 1) {
+            break;
+        }
+
+        //
+        //  The enumerating thread may have taken the item that this thread
+        //  was woken for, so the list may be empty.
+        //
+
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        if (YoriLibIsListEmpty(&Parallel->PendingList)) {
+            ReleaseMutex(Parallel->Mutex);
+            continue;
+        }
+
+        Item = CONTAINING_RECORD(Parallel->PendingList.Next, YORILIB_FOREACHFILE_WORK_ITEM, PendingList);
+        YoriLibRemoveListItem(&Item->PendingList);
+        ASSERT(Parallel->ItemsQueued > 0);
+        Parallel->ItemsQueued--;
+        Parallel->IdleThreads--;
+        Item->State = YoriLibForEachFileItemInProgress;
+        ReleaseMutex(Parallel->Mutex);
+
+        YoriLibForEachFileProcessWorkItem(Parallel, Item);
+
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        Parallel->IdleThreads++;
+        ReleaseMutex(Parallel->Mutex);
+    }
+
+    return 0;
+}
+
+/**
+ Insert a work item into the pending list, creating a new worker thread if
+ there are more items than idle workers.  This must be called with the
+ mutex held.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param Item Pointer to the work item to queue.
+ */
+VOID
+YoriLibForEachFileQueueWorkItemLocked(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_WORK_ITEM Item
+    )
+{
+    DWORD ThreadId;
+
+    Item->State = YoriLibForEachFileItemQueued;
+    YoriLibAppendList(&Parallel->PendingList, &Item->PendingList);
+    Parallel->ItemsQueued++;
+
+    //
+    //  If thread creation fails, the item stays queued.  The enumerating
+    //  thread will take it when it is needed.
+    //
+
+    if (Parallel->ItemsQueued > Parallel->IdleThreads &&
+        Parallel->ThreadsAllocated < Parallel->MaxThreads) {
+
+        Parallel->Threads[Parallel->ThreadsAllocated] = CreateThread(NULL, 0, YoriLibForEachFileWorker, Parallel, 0, &ThreadId);
+        if (Parallel->Threads[Parallel->ThreadsAllocated] != NULL) {
+            Parallel->ThreadsAllocated++;
+            Parallel->IdleThreads++;
+        }
+    }
+
+    ReleaseSemaphore(Parallel->WorkerWaitSemaphore, 1, NULL);
+}
+
+/**
+ Queue a directory listing to be collected by a worker thread, unless one
+ is already queued for the same search string or too many listings are
+ outstanding.  This must be called with the mutex held.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param Prefix The parent directory, including a trailing seperator.
+
+ @param FileName The name of the child directory within the parent.
+
+ @param Pattern The search pattern to apply within the child directory.
+ */
+VOID
+YoriLibForEachFileQueueListingLocked(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORI_STRING Prefix,
+    __in LPCTSTR FileName,
+    __in PYORI_STRING Pattern
+    )
+{
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+    YORI_ALLOC_SIZE_T FileNameLength;
+    YORI_ALLOC_SIZE_T PathLength;
+
+    if (Parallel->Abort ||
+        Parallel->ListingCount >= YORILIB_FOREACHFILE_MAX_LISTINGS) {
+
+        return;
+    }
+
+    FileNameLength = (YORI_ALLOC_SIZE_T)_tcslen(FileName);
+    PathLength = Prefix->LengthInChars + FileNameLength + 1 + Pattern->LengthInChars;
+
+    Item = YoriLibMalloc(sizeof(YORILIB_FOREACHFILE_WORK_ITEM));
+    if (Item == NULL) {
+        return;
+    }
+
+    ZeroMemory(Item, sizeof(YORILIB_FOREACHFILE_WORK_ITEM));
+    if (!YoriLibAllocateString(&Item->Path, PathLength + 1)) {
+        YoriLibFree(Item);
+        return;
+    }
+
+    Item->Path.LengthInChars = YoriLibSPrintfS(Item->Path.StartOfString,
+                                               Item->Path.LengthAllocated,
+                                               _T("%y%s\\%y"),
+                                               Prefix,
+                                               FileName,
+                                               Pattern);
+
+    if (YoriLibHashLookupByKey(Parallel->Listings, &Item->Path) != NULL) {
+        YoriLibForEachFileFreeWorkItem(Item);
+        return;
+    }
+
+    YoriLibHashInsertByKey(Parallel->Listings, &Item->Path, Item, &Item->HashEntry);
+    Parallel->ListingCount++;
+    YoriLibForEachFileQueueWorkItemLocked(Parallel, Item);
+}
+
+/**
+ When enumerating in order, queue listings for the searches that a serial
+ enumerate will issue when recursing into a directory entry, so that they
+ can be collected by worker threads before the enumerating thread reaches
+ them.  Strings are generated to match the ones the enumerating thread
+ will construct; if they do not match, the listing is never used and the
+ enumerating thread searches the directory itself.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param SearchPath The search string that returned the entry.
+
+ @param FileInfo The entry, which may describe a directory to recurse into.
+ */
+VOID
+YoriLibForEachFileQueueChildListings(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORI_STRING SearchPath,
+    __in PWIN32_FIND_DATA FileInfo
+    )
+{
+    YORI_STRING Prefix;
+    YORI_STRING Pattern;
+    YORI_STRING AllFiles;
+
+    if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 ||
+        _tcscmp(FileInfo->cFileName, _T(".")) == 0 ||
+        _tcscmp(FileInfo->cFileName, _T("..")) == 0) {
+
+        return;
+    }
+
+    if ((Parallel->MatchFlags & YORILIB_FILEENUM_NO_LINK_TRAVERSE) != 0 &&
+        (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0 &&
+        (FileInfo->dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT ||
+         FileInfo->dwReserved0 == IO_REPARSE_TAG_SYMLINK)) {
+
+        return;
+    }
+
+    //
+    //  Split the search string into the directory and the search pattern.
+    //
+
+    YoriLibInitEmptyString(&Prefix);
+    Prefix.StartOfString = SearchPath->StartOfString;
+    Prefix.LengthInChars = SearchPath->LengthInChars;
+    while (Prefix.LengthInChars > 0) {
+        if (YoriLibIsSep(Prefix.StartOfString[Prefix.LengthInChars - 1])) {
+            break;
+        }
+        Prefix.LengthInChars--;
+    }
+
+    if (Prefix.LengthInChars == 0) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&Pattern);
+    Pattern.StartOfString = &SearchPath->StartOfString[Prefix.LengthInChars];
+    Pattern.LengthInChars = SearchPath->LengthInChars - Prefix.LengthInChars;
+
+    YoriLibConstantString(&AllFiles, _T("*"));
+
+    //
+    //  When preserving the wildcard, only the search for all files is used
+    //  to find subdirectories.  Each subdirectory is searched twice, once
+    //  to find its subdirectories and again to apply the wildcard.
+    //
+
+    if ((Parallel->MatchFlags & YORILIB_FILEENUM_RECURSE_PRESERVE_WILD) != 0 &&
+        YoriLibCompareString(&Pattern, &AllFiles) != 0) {
+
+        return;
+    }
+
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    YoriLibForEachFileQueueListingLocked(Parallel, &Prefix, FileInfo->cFileName, &AllFiles);
+    if ((Parallel->MatchFlags & YORILIB_FILEENUM_RECURSE_PRESERVE_WILD) != 0 &&
+        Parallel->Wild.LengthInChars > 0 &&
+        YoriLibCompareString(&Parallel->Wild, &AllFiles) != 0) {
+
+        YoriLibForEachFileQueueListingLocked(Parallel, &Prefix, FileInfo->cFileName, &Parallel->Wild);
+    }
+    ReleaseMutex(Parallel->Mutex);
+}
+
+/**
+ Append a directory entry to a listing being collected by a worker thread.
+
+ @param Item Pointer to the listing.
+
+ @param FileInfo Pointer to the directory entry to append.
+
+ @return TRUE to indicate success, FALSE to indicate allocation failure.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileAppendEntry(
+    __in PYORILIB_FOREACHFILE_WORK_ITEM Item,
+    __in PWIN32_FIND_DATA FileInfo
+    )
+{
+    PYORILIB_FOREACHFILE_ENTRY Entry;
+    PUCHAR NewBuffer;
+    DWORD NewLength;
+    DWORD EntryLength;
+    WORD FileNameLength;
+    WORD AlternateFileNameLength;
+    LPTSTR Names;
+
+    FileNameLength = (WORD)_tcslen(FileInfo->cFileName);
+    AlternateFileNameLength = (WORD)_tcslen(FileInfo->cAlternateFileName);
+    EntryLength = sizeof(YORILIB_FOREACHFILE_ENTRY) + (FileNameLength + AlternateFileNameLength) * sizeof(TCHAR);
+    EntryLength = (EntryLength + sizeof(DWORDLONG) - 1) & ~(sizeof(DWORDLONG) - 1);
+
+    if (Item->BufferUsed + EntryLength > Item->BufferLength) {
+        NewLength = Item->BufferLength;
+        if (NewLength == 0) {
+            NewLength = YORILIB_FOREACHFILE_LISTING_INITIAL_SIZE;
+        }
+        while (Item->BufferUsed + EntryLength > NewLength) {
+            NewLength = NewLength * 2;
+        }
+
+        if (!YoriLibIsSizeAllocatable(NewLength)) {
+            return FALSE;
+        }
+
+        NewBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)NewLength);
+        if (NewBuffer == NULL) {
+            return FALSE;
+        }
+
+        if (Item->Buffer != NULL) {
+            memcpy(NewBuffer, Item->Buffer, Item->BufferUsed);
+            YoriLibFree(Item->Buffer);
+        }
+        Item->Buffer = NewBuffer;
+        Item->BufferLength = NewLength;
+    }
+
+    Entry = (PYORILIB_FOREACHFILE_ENTRY)&Item->Buffer[Item->BufferUsed];
+    Entry->EntryLength = EntryLength;
+    Entry->FileAttributes = FileInfo->dwFileAttributes;
+    Entry->CreationTime = FileInfo->ftCreationTime;
+    Entry->LastAccessTime = FileInfo->ftLastAccessTime;
+    Entry->LastWriteTime = FileInfo->ftLastWriteTime;
+    Entry->FileSizeHigh = FileInfo->nFileSizeHigh;
+    Entry->FileSizeLow = FileInfo->nFileSizeLow;
+    Entry->Reserved0 = FileInfo->dwReserved0;
+    Entry->Reserved1 = FileInfo->dwReserved1;
+    Entry->FileNameLength = FileNameLength;
+    Entry->AlternateFileNameLength = AlternateFileNameLength;
+
+    Names = (LPTSTR)(Entry + 1);
+    memcpy(Names, FileInfo->cFileName, FileNameLength * sizeof(TCHAR));
+    memcpy(&Names[FileNameLength], FileInfo->cAlternateFileName, AlternateFileNameLength * sizeof(TCHAR));
+
+    Item->BufferUsed = Item->BufferUsed + EntryLength;
+    return TRUE;
+}
+
+/**
+ Process a single work item on the current thread.  This is normally called
+ on a worker thread, but can also be called on the enumerating thread when
+ it is waiting for subdirectory trees to complete.  The item must have been
+ removed from the pending list.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param Item Pointer to the work item to process.
+ */
+VOID
+YoriLibForEachFileProcessWorkItem(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_WORK_ITEM Item
+    )
+{
+    WIN32_FIND_DATA FileInfo;
+    HANDLE hFind;
+    BOOLEAN NoShortNames;
+
+    if (Item->Subtree) {
+        if (!Parallel->Abort) {
+            if (!YoriLibForEachFileEnum(&Item->Path, Parallel->MatchFlags, Item->Depth, Parallel->Callback, Parallel->ErrorCallback, Parallel->Context, Parallel)) {
+                Parallel->Abort = TRUE;
+            }
+        }
+
+        YoriLibForEachFileFreeWorkItem(Item);
+
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        ASSERT(Parallel->SubtreesOutstanding > 0);
+        Parallel->SubtreesOutstanding--;
+        ReleaseMutex(Parallel->Mutex);
+        SetEvent(Parallel->CompleteEvent);
+        return;
+    }
+
+    Item->Error = ERROR_SUCCESS;
+    NoShortNames = FALSE;
+    if ((Parallel->MatchFlags & YORILIB_FILEENUM_NO_SHORT_NAMES) != 0) {
+        NoShortNames = TRUE;
+    }
+    hFind = YoriLibForEachFileFindFirstFile(&Item->Path, NoShortNames, &FileInfo);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        Item->Error = GetLastError();
+    } else {
+        do {
+            if (!YoriLibForEachFileAppendEntry(Item, &FileInfo)) {
+                Item->Error = ERROR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+
+            YoriLibForEachFileQueueChildListings(Parallel, &Item->Path, &FileInfo);
+
+            if (YoriLibStats.Enabled) {
+                InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.DirectoryReads);
+            }
+
+        } while (!Parallel->Abort && FindNextFile(hFind, &FileInfo));
+
+        FindClose(hFind);
+    }
+
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    Item->State = YoriLibForEachFileItemComplete;
+    ReleaseMutex(Parallel->Mutex);
+    SetEvent(Parallel->CompleteEvent);
+}
+
+/**
+ When callbacks can be delivered in any order, offer a subdirectory tree to
+ a worker thread instead of recursing into it on the current thread.  The
+ tree is only handed off if a worker is available to take it, so that
+ threads which are already busy continue to recurse depth first.
+
+ @param Parallel Pointer to the parallel enumerate state.
+
+ @param RecurseCriteria The criteria to enumerate within the subdirectory.
+        This must be a referenced string.
+
+ @param Depth The recursion depth of the subdirectory.
+
+ @return TRUE if the subdirectory tree was queued to a worker thread, FALSE
+         if the caller should recurse into it.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileQueueSubtree(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORI_STRING RecurseCriteria,
+    __in DWORD Depth
+    )
+{
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    if (Parallel->ItemsQueued >= Parallel->IdleThreads &&
+        Parallel->ThreadsAllocated >= Parallel->MaxThreads) {
+
+        ReleaseMutex(Parallel->Mutex);
+        return FALSE;
+    }
+
+    Item = YoriLibMalloc(sizeof(YORILIB_FOREACHFILE_WORK_ITEM));
+    if (Item == NULL) {
+        ReleaseMutex(Parallel->Mutex);
+        return FALSE;
+    }
+
+    ZeroMemory(Item, sizeof(YORILIB_FOREACHFILE_WORK_ITEM));
+    YoriLibCloneString(&Item->Path, RecurseCriteria);
+    Item->Depth = Depth;
+    Item->Subtree = TRUE;
+    Parallel->SubtreesOutstanding++;
+    YoriLibForEachFileQueueWorkItemLocked(Parallel, Item);
+    ReleaseMutex(Parallel->Mutex);
+
+    return TRUE;
+}
+
+/**
+ When callbacks can be delivered in any order, wait for all subdirectory
+ trees handed to worker threads to complete.  The calling thread processes
+ any trees that are still queued rather than waiting for a worker.
+
+ @param Parallel Pointer to the parallel enumerate state.
+ */
+VOID
+YoriLibForEachFileWaitForSubtrees(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel
+    )
+{
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    while (TRUE) {
+        if (!YoriLibIsListEmpty(&Parallel->PendingList)) {
+            Item = CONTAINING_RECORD(Parallel->PendingList.Next, YORILIB_FOREACHFILE_WORK_ITEM, PendingList);
+            YoriLibRemoveListItem(&Item->PendingList);
+            Parallel->ItemsQueued--;
+            ReleaseMutex(Parallel->Mutex);
+
+            YoriLibForEachFileProcessWorkItem(Parallel, Item);
+
+            WaitForSingleObject(Parallel->Mutex, INFINITE);
+            continue;
+        }
+
+        if (Parallel->SubtreesOutstanding == 0) {
+            break;
+        }
+
+        ReleaseMutex(Parallel->Mutex);
+        WaitForSingleObject(Parallel->CompleteEvent, INFINITE);
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+    }
+    ReleaseMutex(Parallel->Mutex);
+}
+
+/**
+ Populate the find data in an enumerate context from the current entry in
+ a directory listing collected by a worker thread.
+
+ @param ForEachContext Pointer to the enumerate context, which refers to a
+        listing and an offset within it.
+ */
+VOID
+YoriLibForEachFileLoadListingEntry(
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext
+    )
+{
+    PYORILIB_FOREACHFILE_ENTRY Entry;
+    PWIN32_FIND_DATA FileInfo;
+    LPTSTR Names;
+
+    Entry = (PYORILIB_FOREACHFILE_ENTRY)&ForEachContext->Listing->Buffer[ForEachContext->ListingOffset];
+    FileInfo = &ForEachContext->FileInfo;
+
+    FileInfo->dwFileAttributes = Entry->FileAttributes;
+    FileInfo->ftCreationTime = Entry->CreationTime;
+    FileInfo->ftLastAccessTime = Entry->LastAccessTime;
+    FileInfo->ftLastWriteTime = Entry->LastWriteTime;
+    FileInfo->nFileSizeHigh = Entry->FileSizeHigh;
+    FileInfo->nFileSizeLow = Entry->FileSizeLow;
+    FileInfo->dwReserved0 = Entry->Reserved0;
+    FileInfo->dwReserved1 = Entry->Reserved1;
+
+    Names = (LPTSTR)(Entry + 1);
+    memcpy(FileInfo->cFileName, Names, Entry->FileNameLength * sizeof(TCHAR));
+    FileInfo->cFileName[Entry->FileNameLength] = '\0';
+    memcpy(FileInfo->cAlternateFileName, &Names[Entry->FileNameLength], Entry->AlternateFileNameLength * sizeof(TCHAR));
+    FileInfo->cAlternateFileName[Entry->AlternateFileNameLength] = '\0';
+}
+
+/**
+ Begin searching for objects matching the search string in an enumerate
+ context.  For a serial enumerate this is FindFirstFile.  When enumerating
+ in parallel in order, this uses a listing collected by a worker thread if
+ one is available.
+
+ @param ForEachContext Pointer to the enumerate context.  FullPath contains
+        the search string, and FileInfo is populated with the first match.
+
+ @param Parallel Optionally points to the parallel enumerate state.
+
+ @return A handle to pass to @ref YoriLibForEachFileFindNext and
+         @ref YoriLibForEachFileFindClose , or INVALID_HANDLE_VALUE on
+         failure with the error available from GetLastError.
+ */
+HANDLE
+YoriLibForEachFileFindFirst(
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
+    )
+{
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+    PYORI_HASH_ENTRY HashEntry;
+    HANDLE hFind;
+    DWORD Error;
+
+    ASSERT(ForEachContext->Listing == NULL);
+
+    //
+    //  If a listing from the previous phase was retained because it has
+    //  the same search string, use it again.
+    //
+
+    Item = ForEachContext->SavedListing;
+    ForEachContext->SavedListing = NULL;
+    if (Item != NULL &&
+        YoriLibCompareString(&Item->Path, &ForEachContext->FullPath) != 0) {
+
+        YoriLibForEachFileFreeWorkItem(Item);
+        Item = NULL;
+    }
+
+    if (Item == NULL && Parallel != NULL && !Parallel->Unordered) {
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        HashEntry = YoriLibHashLookupByKey(Parallel->Listings, &ForEachContext->FullPath);
+        if (HashEntry != NULL) {
+            Item = HashEntry->Context;
+            YoriLibHashRemoveByEntry(&Item->HashEntry);
+            Parallel->ListingCount--;
+
+            //
+            //  If no worker has started on this listing, searching here is
+            //  faster than waiting for one.  Otherwise wait for the worker
+            //  to finish.
+            //
+
+            if (Item->State == YoriLibForEachFileItemQueued) {
+                YoriLibRemoveListItem(&Item->PendingList);
+                Parallel->ItemsQueued--;
+                ReleaseMutex(Parallel->Mutex);
+                YoriLibForEachFileFreeWorkItem(Item);
+                Item = NULL;
+            } else {
+                while (Item->State != YoriLibForEachFileItemComplete) {
+                    ReleaseMutex(Parallel->Mutex);
+                    WaitForSingleObject(Parallel->CompleteEvent, INFINITE);
+                    WaitForSingleObject(Parallel->Mutex, INFINITE);
+                }
+                ReleaseMutex(Parallel->Mutex);
+            }
+        } else {
+            ReleaseMutex(Parallel->Mutex);
+        }
+
+        //
+        //  If the worker could not allocate memory for the listing, fall
+        //  back to searching here.  Other errors are returned as if the
+        //  search had been issued here.
+        //
+
+        if (Item != NULL && Item->Error != ERROR_SUCCESS) {
+            Error = Item->Error;
+            YoriLibForEachFileFreeWorkItem(Item);
+            Item = NULL;
+            if (Error != ERROR_NOT_ENOUGH_MEMORY) {
+                SetLastError(Error);
+                return INVALID_HANDLE_VALUE;
+            }
+        }
+    }
+
+    if (Item != NULL) {
+        ASSERT(Item->BufferUsed > 0);
+        ForEachContext->Listing = Item;
+        ForEachContext->ListingOffset = 0;
+        YoriLibForEachFileLoadListingEntry(ForEachContext);
+        return (HANDLE)Item;
+    }
+
+    hFind = YoriLibForEachFileFindFirstFile(&ForEachContext->FullPath, ForEachContext->NoShortNames, &ForEachContext->FileInfo);
+    if (hFind != INVALID_HANDLE_VALUE &&
+        ForEachContext->QueueChildListings &&
+        Parallel != NULL &&
+        !Parallel->Unordered) {
+
+        YoriLibForEachFileQueueChildListings(Parallel, &ForEachContext->FullPath, &ForEachContext->FileInfo);
+    }
+
+    return hFind;
+}
+
+/**
+ Continue searching for objects matching the search string in an enumerate
+ context.
+
+ @param ForEachContext Pointer to the enumerate context.  FileInfo is
+        populated with the next match.
+
+ @param Parallel Optionally points to the parallel enumerate state.
 
-    /**
-     A buffer to hold the path of any object found in the directory,
-     generated via ParentFullPath above and the name of any object found
-     via enumerate.
-     */
-    YORI_STRING FullPath;
+ @param hFind The handle returned from @ref YoriLibForEachFileFindFirst .
 
-    /**
-     The number of phases in the enumerate.  Enumerations within a single
-     directory only require a single phase, but recursive enumerates require
-     a phase to operate on the current directory and a phase to recurse into
-     any subdirectories.
-     */
-    WORD NumberPhases;
+ @return TRUE if another match was found, FALSE if there are no more
+         matches.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileFindNext(
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in HANDLE hFind
+    )
+{
+    PYORILIB_FOREACHFILE_ENTRY Entry;
 
-    /**
-     Indicates the current phase number being used.  Note that for recursive
-     operations, recursion may occur before or after the directory being
-     processed, so this number does not by itself indicate the operation
-     being performed.
-     */
-    WORD CurrentPhase;
+    if (ForEachContext->Listing != NULL) {
+        Entry = (PYORILIB_FOREACHFILE_ENTRY)&ForEachContext->Listing->Buffer[ForEachContext->ListingOffset];
+        ForEachContext->ListingOffset = ForEachContext->ListingOffset + Entry->EntryLength;
+        if (ForEachContext->ListingOffset >= ForEachContext->Listing->BufferUsed) {
+            SetLastError(ERROR_NO_MORE_FILES);
+            return FALSE;
+        }
+        YoriLibForEachFileLoadListingEntry(ForEachContext);
+        return TRUE;
+    }
 
-    /**
-     The number of characters in EffectiveFileSpec to the final slash. A
-     seperator may not be specified in EffectiveFileSpec, so this is only
-     meaningful if the local FinalSlashFound is set.
-     */
-    YORI_ALLOC_SIZE_T CharsToFinalSlash;
+    if (YoriLibStats.Enabled) {
+        InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.DirectoryReads);
+    }
 
-    /**
-     Specifies an enumeration criteria to use if recursively invoking one of
-     the enumeration functions to operate on a subdirectory.
-     */
-    YORI_STRING RecurseCriteria;
+    if (!FindNextFile(hFind, &ForEachContext->FileInfo)) {
+        return FALSE;
+    }
 
-    /**
-     The result of the Win32 FindFirstFile operation for the current
-     file.
-     */
-    WIN32_FIND_DATA FileInfo;
+    if (ForEachContext->QueueChildListings &&
+        Parallel != NULL &&
+        !Parallel->Unordered) {
 
-} YORILIB_FOREACHFILE_CONTEXT, *PYORILIB_FOREACHFILE_CONTEXT;
+        YoriLibForEachFileQueueChildListings(Parallel, &ForEachContext->FullPath, &ForEachContext->FileInfo);
+    }
+
+    return TRUE;
+}
 
 /**
- If a string contains a directory that ends with a seperator, and it's not
- referring to a drive root, remove the seperator.
+ Complete searching for objects in an enumerate context.  If a listing was
+ used and further phases remain, it is retained in case the next phase
+ issues the same search.
 
- This can be thought of as a mini version of @ref YoriLibFindEffectiveRoot .
- Unlike that function, this one has to run on purely relative paths that
- haven't been converted to their full form, where seperators could go
- either way, where relative components are still present.  Also, it doesn't
- need to deal with UNC paths because a share and a root are equivalent;
- there's no concept of "current directory on UNC share" which is the meaning
- if a trailing seperator is removed from a drive.
+ @param ForEachContext Pointer to the enumerate context.
 
- @param String The string to inspect and potentially trim if a trailing
-        seperator is present.
+ @param hFind The handle returned from @ref YoriLibForEachFileFindFirst .
  */
 VOID
-YoriLibTruncateTrailingSeperatorIfBenign(
-    __inout PYORI_STRING String
+YoriLibForEachFileFindClose(
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext,
+    __in HANDLE hFind
     )
 {
-    //
-    //  Trim trailing slashes, except if the string is just a slash, or if
-    //  the slash follows a drive letter and colon, in which case it's
-    //  meaningful.
-    //
-
-    if (String->LengthInChars > 1 &&
-        YoriLibIsSep(String->StartOfString[String->LengthInChars - 1])) {
-
-        if (YoriLibIsPrefixedDriveLetterWithColonAndSlash(String)) {
-            if (String->LengthInChars >= sizeof("\\\\?\\c:\\")) {
-                String->LengthInChars--;
-            }
-        } else if (YoriLibIsDriveLetterWithColonAndSlash(String)) {
-            if (String->LengthInChars >= sizeof("c:\\")) {
-                String->LengthInChars--;
-            }
+    if (ForEachContext->Listing != NULL) {
+        if (ForEachContext->CurrentPhase + 1 < ForEachContext->NumberPhases) {
+            ForEachContext->SavedListing = ForEachContext->Listing;
         } else {
-            String->LengthInChars--;
+            YoriLibForEachFileFreeWorkItem(ForEachContext->Listing);
         }
+        ForEachContext->Listing = NULL;
+        return;
     }
+
+    FindClose(hFind);
 }
 
 /**
@@ -152,6 +1286,10 @@ YoriLibTruncateTrailingSeperatorIfBenign(
         about failures and wants to silently continue.
 
  @param Context Caller provided context to pass to the callback.
+
+ @param Parallel Optionally points to the state of a parallel enumerate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
@@ -161,7 +1299,8 @@ YoriLibForEachFileEnum(
     __in DWORD Depth,
     __in PYORILIB_FILE_ENUM_FN Callback,
     __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
-    __in_opt PVOID Context
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
     )
 {
     HANDLE hFind;
@@ -171,6 +1310,7 @@ YoriLibForEachFileEnum(
     BOOLEAN Result;
     BOOLEAN RecursePhase;
     BOOLEAN IsLink;
+    BOOLEAN HandedOff;
     BOOLEAN TrailingSlashInParentComponent;
     PYORILIB_FOREACHFILE_CONTEXT ForEachContext = NULL;
 
@@ -186,6 +1326,9 @@ YoriLibForEachFileEnum(
         return FALSE;
     }
     YoriLibInitEmptyString(&ForEachContext->RecurseCriteria);
+    ForEachContext->Listing = NULL;
+    ForEachContext->SavedListing = NULL;
+    ForEachContext->QueueChildListings = FALSE;
 
     //
     //  This is currently only needed for the GetFileAttributes call.  It may
@@ -303,6 +1446,33 @@ YoriLibForEachFileEnum(
         }
     }
 
+    //
+    //  When enumerating in parallel and preserving the wildcard, remember
+    //  the wildcard so workers can apply it to subdirectories ahead of the
+    //  enumerate reaching them.
+    //
+
+    if (Depth == 0 &&
+        Parallel != NULL &&
+        !Parallel->Unordered &&
+        (MatchFlags & YORILIB_FILEENUM_RECURSE_PRESERVE_WILD) != 0) {
+
+        YORI_STRING Wild;
+
+        YoriLibInitEmptyString(&Wild);
+        Wild.StartOfString = &ForEachContext->EffectiveFileSpec.StartOfString[ForEachContext->CharsToFinalSlash];
+        Wild.LengthInChars = ForEachContext->EffectiveFileSpec.LengthInChars - ForEachContext->CharsToFinalSlash;
+
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        YoriLibFreeStringContents(&Parallel->Wild);
+        if (YoriLibAllocateString(&Parallel->Wild, Wild.LengthInChars + 1)) {
+            memcpy(Parallel->Wild.StartOfString, Wild.StartOfString, Wild.LengthInChars * sizeof(TCHAR));
+            Parallel->Wild.StartOfString[Wild.LengthInChars] = '\0';
+            Parallel->Wild.LengthInChars = Wild.LengthInChars;
+        }
+        ReleaseMutex(Parallel->Mutex);
+    }
+
     ForEachContext->NumberPhases = 1;
     if ((MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) != 0) {
         ForEachContext->NumberPhases++;
@@ -374,6 +1544,18 @@ YoriLibForEachFileEnum(
             }
         }
 
+        ForEachContext->QueueChildListings = RecursePhase;
+
+        //
+        //  Searches that only find subdirectories to recurse into never
+        //  report objects to the caller, so never need short names.
+        //
+
+        ForEachContext->NoShortNames = RecursePhase;
+        if ((MatchFlags & YORILIB_FILEENUM_NO_SHORT_NAMES) != 0) {
+            ForEachContext->NoShortNames = TRUE;
+        }
+
         //
         //  If we're recursing but should apply the file match pattern on
         //  every subdirectory, brew up a new search criteria now for "*"
@@ -388,7 +1570,7 @@ YoriLibForEachFileEnum(
                                 ForEachContext->FullPath.LengthAllocated,
                                 _T("%y\\*"),
                                 &ForEachContext->ParentFullPath);
-            hFind = FindFirstFile(ForEachContext->FullPath.StartOfString, &ForEachContext->FileInfo);
+            hFind = YoriLibForEachFileFindFirst(ForEachContext, Parallel);
         } else {
             if (FinalSlashFound) {
 
@@ -439,7 +1621,7 @@ YoriLibForEachFileEnum(
                                         &ForEachContext->EffectiveFileSpec);
                 }
             }
-            hFind = FindFirstFile(ForEachContext->FullPath.StartOfString, &ForEachContext->FileInfo);
+            hFind = YoriLibForEachFileFindFirst(ForEachContext, Parallel);
 
             //
             //  If we can't enumerate it because it's a volume root, cook up
@@ -526,6 +1708,11 @@ YoriLibForEachFileEnum(
                     RecursePhase &&
                     !IsLink) {
 
+                    if (Parallel != NULL && Parallel->Abort) {
+                        Result = FALSE;
+                        break;
+                    }
+
                     YORI_ALLOC_SIZE_T FileNameLen = (YORI_ALLOC_SIZE_T)_tcslen(ForEachContext->FileInfo.cFileName);
                     YORI_ALLOC_SIZE_T WildLength = 2;
 
@@ -574,7 +1761,18 @@ YoriLibForEachFileEnum(
                         ForEachContext->RecurseCriteria.StartOfString[ForEachContext->RecurseCriteria.LengthInChars] = '\0';
                     }
 
-                    if (!YoriLibForEachFileEnum(&ForEachContext->RecurseCriteria, MatchFlags, Depth + 1, Callback, ErrorCallback, Context)) {
+                    //
+                    //  If callbacks can be delivered in any order, try to
+                    //  hand the subdirectory to an idle worker thread.
+                    //
+
+                    HandedOff = FALSE;
+                    if (Parallel != NULL && Parallel->Unordered) {
+                        HandedOff = YoriLibForEachFileQueueSubtree(Parallel, &ForEachContext->RecurseCriteria, Depth + 1);
+                    }
+
+                    if (!HandedOff &&
+                        !YoriLibForEachFileEnum(&ForEachContext->RecurseCriteria, MatchFlags, Depth + 1, Callback, ErrorCallback, Context, Parallel)) {
                         Result = FALSE;
                         break;
                     }
@@ -618,6 +1816,10 @@ YoriLibForEachFileEnum(
                         }
                     }
 
+                    if (YoriLibStats.Enabled) {
+                        InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.FilesEnumerated);
+                    }
+
                     if (!Callback(&ForEachContext->FullPath, &ForEachContext->FileInfo, Depth, Context)) {
                         Result = FALSE;
                         break;
@@ -627,14 +1829,19 @@ YoriLibForEachFileEnum(
                         Result = FALSE;
                         break;
                     }
+
+                    if (Parallel != NULL && Parallel->Abort) {
+                        Result = FALSE;
+                        break;
+                    }
                 }
 
-            } while (hFind != INVALID_HANDLE_VALUE && hFind != NULL && FindNextFile(hFind, &ForEachContext->FileInfo));
+            } while (hFind != INVALID_HANDLE_VALUE && hFind != NULL && YoriLibForEachFileFindNext(ForEachContext, Parallel, hFind));
 
             YoriLibFreeStringContents(&ForEachContext->RecurseCriteria);
 
             if (hFind != NULL && hFind != INVALID_HANDLE_VALUE) {
-                FindClose(hFind);
+                YoriLibForEachFileFindClose(ForEachContext, hFind);
             }
 
             if (Result == FALSE) {
@@ -643,6 +1850,10 @@ YoriLibForEachFileEnum(
         }
     }
 
+    if (ForEachContext->SavedListing != NULL) {
+        YoriLibForEachFileFreeWorkItem(ForEachContext->SavedListing);
+    }
+
     YoriLibFreeStringContents(&ForEachContext->EffectiveFileSpec);
     YoriLibFreeStringContents(&ForEachContext->ParentFullPath);
     YoriLibFreeStringContents(&ForEachContext->FullPath);
@@ -672,17 +1883,20 @@ YoriLibForEachFileEnum(
 
  @param Context Caller provided context to pass to the callback.
 
+ @param Parallel Optionally points to the state of a parallel enumerate.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriLibForEachFile(
+YoriLibForEachFileExpand(
     __in PYORI_STRING FileSpec,
     __in WORD MatchFlags,
     __in DWORD Depth,
     __in PYORILIB_FILE_ENUM_FN Callback,
     __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
-    __in_opt PVOID Context
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
     )
 {
     YORI_STRING BeforeOperator;
@@ -694,7 +1908,7 @@ YoriLibForEachFile(
     BOOL SingleCharMode;
 
     if (MatchFlags & YORILIB_FILEENUM_BASIC_EXPANSION) {
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     SingleCharMode = FALSE;
@@ -709,12 +1923,12 @@ YoriLibForEachFile(
 
         if (YoriLibExpandHomeDirectories(FileSpec, &NewFileSpec)) {
             BOOL Result;
-            Result = YoriLibForEachFileEnum(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+            Result = YoriLibForEachFileEnum(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
             YoriLibFreeStringContents(&NewFileSpec);
             return Result;
         }
 
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     YoriLibInitEmptyString(&BeforeOperator);
@@ -733,7 +1947,7 @@ YoriLibForEachFile(
 
     CharsToOperator = YoriLibCountStringNotContainingChars(&SubstituteValues, SingleCharMode?_T("]"):_T("}"));
     if (CharsToOperator == SubstituteValues.LengthInChars) {
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     AfterOperator.StartOfString = &SubstituteValues.StartOfString[CharsToOperator + 1];
@@ -753,7 +1967,7 @@ YoriLibForEachFile(
 
             YoriLibYPrintf(&NewFileSpec, _T("%y%y%y"), &BeforeOperator, &MatchValue, &AfterOperator);
 
-            if (!YoriLibForEachFile(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context)) {
+            if (!YoriLibForEachFileExpand(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel)) {
                 YoriLibFreeStringContents(&NewFileSpec);
                 return FALSE;
             }
@@ -780,7 +1994,7 @@ YoriLibForEachFile(
 
             YoriLibYPrintf(&NewFileSpec, _T("%y%y%y"), &BeforeOperator, &MatchValue, &AfterOperator);
 
-            if (!YoriLibForEachFile(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context)) {
+            if (!YoriLibForEachFileExpand(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel)) {
                 YoriLibFreeStringContents(&NewFileSpec);
                 return FALSE;
             }
@@ -799,6 +2013,251 @@ YoriLibForEachFile(
     return TRUE;
 }
 
+/**
+ Prepare the state for a parallel enumerate.
+
+ @param Parallel Pointer to the parallel enumerate state to initialize.
+
+ @param MatchFlags The caller's match flags.
+
+ @param Callback The callback to invoke on each match.
+
+ @param ErrorCallback Optionally points to a function to invoke if a
+        directory cannot be enumerated.
+
+ @param Context Caller provided context to pass to the callback.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  On failure,
+         the caller should call @ref YoriLibForEachFileCleanupParallel .
+ */
+__success(return)
+BOOL
+YoriLibForEachFileInitializeParallel(
+    __out PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in WORD MatchFlags,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context
+    )
+{
+    SYSTEM_INFO SystemInfo;
+
+    ZeroMemory(Parallel, sizeof(YORILIB_FOREACHFILE_PARALLEL));
+    YoriLibInitializeListHead(&Parallel->PendingList);
+    YoriLibInitEmptyString(&Parallel->Wild);
+    Parallel->MatchFlags = MatchFlags;
+    Parallel->Callback = Callback;
+    Parallel->ErrorCallback = ErrorCallback;
+    Parallel->Context = Context;
+    if ((MatchFlags & YORILIB_FILEENUM_PARALLEL_UNORDERED) != 0) {
+        Parallel->Unordered = TRUE;
+    }
+
+    GetSystemInfo(&SystemInfo);
+    Parallel->MaxThreads = SystemInfo.dwNumberOfProcessors;
+    if (Parallel->MaxThreads < YORILIB_FOREACHFILE_MIN_THREADS) {
+        Parallel->MaxThreads = YORILIB_FOREACHFILE_MIN_THREADS;
+    }
+    if (Parallel->MaxThreads > YORILIB_FOREACHFILE_MAX_THREADS) {
+        Parallel->MaxThreads = YORILIB_FOREACHFILE_MAX_THREADS;
+    }
+
+    Parallel->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (Parallel->Mutex == NULL) {
+        return FALSE;
+    }
+
+    Parallel->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Parallel->WorkerShutdownEvent == NULL) {
+        return FALSE;
+    }
+
+    Parallel->WorkerWaitSemaphore = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    if (Parallel->WorkerWaitSemaphore == NULL) {
+        return FALSE;
+    }
+
+    Parallel->CompleteEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (Parallel->CompleteEvent == NULL) {
+        return FALSE;
+    }
+
+    Parallel->Listings = YoriLibAllocateHashTable(YORILIB_FOREACHFILE_MAX_LISTINGS);
+    if (Parallel->Listings == NULL) {
+        return FALSE;
+    }
+
+    Parallel->Threads = YoriLibMalloc(sizeof(HANDLE) * Parallel->MaxThreads);
+    if (Parallel->Threads == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Tear down the state for a parallel enumerate.  This stops and waits for
+ all worker threads and frees any listings that were not consumed.  Note
+ the Parallel allocation itself is not freed, since this is typically on
+ the stack.
+
+ @param Parallel Pointer to the parallel enumerate state.
+ */
+VOID
+YoriLibForEachFileCleanupParallel(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel
+    )
+{
+    PYORILIB_FOREACHFILE_WORK_ITEM Item;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_ALLOC_SIZE_T BucketIndex;
+    DWORD Index;
+
+    Parallel->Abort = TRUE;
+
+    if (Parallel->ThreadsAllocated > 0) {
+        SetEvent(Parallel->WorkerShutdownEvent);
+        WaitForMultipleObjectsEx(Parallel->ThreadsAllocated, Parallel->Threads, TRUE, INFINITE, FALSE);
+        for (Index = 0; Index < Parallel->ThreadsAllocated; Index++) {
+            CloseHandle(Parallel->Threads[Index]);
+            Parallel->Threads[Index] = NULL;
+        }
+    }
+
+    //
+    //  Every listing is in the hash table, and queued listings are also in
+    //  the pending list.  Subdirectory trees have all completed by this
+    //  point.
+    //
+
+    if (Parallel->Listings != NULL) {
+        for (BucketIndex = 0; BucketIndex < Parallel->Listings->NumberBuckets; BucketIndex++) {
+            while (TRUE) {
+                ListEntry = YoriLibGetNextListEntry(&Parallel->Listings->Buckets[BucketIndex].ListHead, NULL);
+                if (ListEntry == NULL) {
+                    break;
+                }
+                Item = (PYORILIB_FOREACHFILE_WORK_ITEM)CONTAINING_RECORD(ListEntry, YORI_HASH_ENTRY, ListEntry)->Context;
+                YoriLibHashRemoveByEntry(&Item->HashEntry);
+                if (Item->State == YoriLibForEachFileItemQueued) {
+                    YoriLibRemoveListItem(&Item->PendingList);
+                }
+                YoriLibForEachFileFreeWorkItem(Item);
+            }
+        }
+        YoriLibFreeEmptyHashTable(Parallel->Listings);
+        Parallel->Listings = NULL;
+    }
+
+    ASSERT(YoriLibIsListEmpty(&Parallel->PendingList));
+    YoriLibFreeStringContents(&Parallel->Wild);
+
+    if (Parallel->CompleteEvent != NULL) {
+        CloseHandle(Parallel->CompleteEvent);
+        Parallel->CompleteEvent = NULL;
+    }
+    if (Parallel->WorkerWaitSemaphore != NULL) {
+        CloseHandle(Parallel->WorkerWaitSemaphore);
+        Parallel->WorkerWaitSemaphore = NULL;
+    }
+    if (Parallel->WorkerShutdownEvent != NULL) {
+        CloseHandle(Parallel->WorkerShutdownEvent);
+        Parallel->WorkerShutdownEvent = NULL;
+    }
+    if (Parallel->Mutex != NULL) {
+        CloseHandle(Parallel->Mutex);
+        Parallel->Mutex = NULL;
+    }
+    if (Parallel->Threads != NULL) {
+        YoriLibFree(Parallel->Threads);
+        Parallel->Threads = NULL;
+    }
+}
+
+/**
+ Enumerate the set of possible files matching a user specified pattern.
+ This function is responsible for expanding Yori defined sequences, including
+ {}, [], and ~ operators.
+
+ If YORILIB_FILEENUM_PARALLEL is specified with a recursive enumerate,
+ subdirectories are enumerated concurrently by a bounded pool of worker
+ threads.  By default callbacks are still invoked on the calling thread in
+ the same order as a serial enumerate.  If
+ YORILIB_FILEENUM_PARALLEL_UNORDERED is also specified, callbacks are
+ invoked on any thread, concurrently and in no particular order.  If the
+ worker threads cannot be set up, the enumerate proceeds serially.
+
+ If YORILIB_FILEENUM_VOLUME_SCAN is specified and the request describes the
+ recursive contents of an NTFS volume root, the names are obtained from the
+ volume's master file table instead.
+
+ @param FileSpec The user provided file specification to enumerate matches on.
+
+ @param MatchFlags Specifies the behavior of the match, including whether
+        it should be applied recursively and the recursing behavior.
+
+ @param Depth Indicates the current recursion depth.  If this function is
+        reentered, this value is incremented.
+
+ @param Callback The callback to invoke on each match.
+
+ @param ErrorCallback Optionally points to a function to invoke if a
+        directory cannot be enumerated.  If NULL, the caller does not care
+        about failures and wants to silently continue.
+
+ @param Context Caller provided context to pass to the callback.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibForEachFile(
+    __in PYORI_STRING FileSpec,
+    __in WORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context
+    )
+{
+    YORILIB_FOREACHFILE_PARALLEL Parallel;
+    BOOL Result;
+
+    YoriLibLoadKernel32Functions();
+
+    if ((MatchFlags & YORILIB_FILEENUM_VOLUME_SCAN) != 0 &&
+        YoriLibForEachFileOnVolume(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, &Result)) {
+
+        return Result;
+    }
+
+    if ((MatchFlags & YORILIB_FILEENUM_PARALLEL) == 0 ||
+        (MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) == 0) {
+
+        return YoriLibForEachFileExpand(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, NULL);
+    }
+
+    if (!YoriLibForEachFileInitializeParallel(&Parallel, MatchFlags, Callback, ErrorCallback, Context)) {
+        YoriLibForEachFileCleanupParallel(&Parallel);
+        return YoriLibForEachFileExpand(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, NULL);
+    }
+
+    Result = YoriLibForEachFileExpand(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, &Parallel);
+
+    if (Parallel.Unordered) {
+        if (!Result) {
+            Parallel.Abort = TRUE;
+        }
+        YoriLibForEachFileWaitForSubtrees(&Parallel);
+        if (Parallel.Abort) {
+            Result = FALSE;
+        }
+    }
+
+    YoriLibForEachFileCleanupParallel(&Parallel);
+    return Result;
+}
+
 /**
  Compare a file name against a wildcard criteria to see if it matches.
 
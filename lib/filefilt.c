@@ -48,6 +48,27 @@ CHAR strFileFiltHelpText[] =
         "\n"
         " Valid attributes are:\n";
 
+/**
+ The option can be evaluated from directory enumeration data alone.
+ */
+#define YORI_LIB_FILE_FILT_COST_FIND_DATA  0
+
+/**
+ The option requires the file to be opened or queried by name.
+ */
+#define YORI_LIB_FILE_FILT_COST_METADATA   1
+
+/**
+ The option requires the file contents to be read.
+ */
+#define YORI_LIB_FILE_FILT_COST_CONTENTS   2
+
+/**
+ The option requires loading a version resource or resolving an account,
+ which are far more expensive than reading a few bytes of the file.
+ */
+#define YORI_LIB_FILE_FILT_COST_EXPENSIVE  3
+
 /**
  A single option that files can be filtered against.
  */
@@ -86,6 +107,13 @@ typedef struct _YORI_LIB_FILE_FILT_FILTER_OPT {
      A string containing a description for the option.
      */
     CHAR Help[24];
+
+    /**
+     The relative cost of collecting the data for the option, as one of the
+     YORI_LIB_FILE_FILT_COST_* values.  Filters evaluate cheaper options
+     first so that expensive ones are only collected for files that pass.
+     */
+    DWORD Cost;
 } YORI_LIB_FILE_FILT_FILTER_OPT, *PYORI_LIB_FILE_FILT_FILTER_OPT;
 
 /**
@@ -102,131 +130,163 @@ CONST YORI_LIB_FILE_FILT_FILTER_OPT
 YoriLibFileFiltFilterOptions[] = {
     {_T("ac"),                               YoriLibCollectAllocatedRangeCount,
      YoriLibCompareAllocatedRangeCount,      NULL,
-     YoriLibGenerateAllocatedRangeCount,     "allocated range count"},
+     YoriLibGenerateAllocatedRangeCount,     "allocated range count",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("ad"),                               YoriLibCollectAccessTime,
      YoriLibCompareAccessDate,               NULL,
-     YoriLibGenerateAccessDate,              "access date"},
+     YoriLibGenerateAccessDate,              "access date",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("ar"),                               YoriLibCollectArch,
      YoriLibCompareArch,                     NULL,
-     YoriLibGenerateArch,                    "CPU architecture"},
+     YoriLibGenerateArch,                    "CPU architecture",
+     YORI_LIB_FILE_FILT_COST_CONTENTS},
 
     {_T("as"),                               YoriLibCollectAllocationSize,
      YoriLibCompareAllocationSize,           NULL,
-     YoriLibGenerateAllocationSize,          "allocation size"},
+     YoriLibGenerateAllocationSize,          "allocation size",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("at"),                               YoriLibCollectAccessTime,
      YoriLibCompareAccessTime,               NULL,
-     YoriLibGenerateAccessTime,              "access time"},
+     YoriLibGenerateAccessTime,              "access time",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("ca"),                               YoriLibCollectCompressionAlgorithm,
      YoriLibCompareCompressionAlgorithm,     NULL,
-     YoriLibGenerateCompressionAlgorithm,    "compression algorithm"},
+     YoriLibGenerateCompressionAlgorithm,    "compression algorithm",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("cd"),                               YoriLibCollectCreateTime,
      YoriLibCompareCreateDate,               NULL,
-     YoriLibGenerateCreateDate,              "create date"},
+     YoriLibGenerateCreateDate,              "create date",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("ci"),                               YoriLibCollectCaseSensitivity,
      YoriLibCompareCaseSensitivity,          NULL,
-     YoriLibGenerateCaseSensitivity,         "case insensitivity"},
+     YoriLibGenerateCaseSensitivity,         "case insensitivity",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("cs"),                               YoriLibCollectCompressedFileSize,
      YoriLibCompareCompressedFileSize,       NULL,
-     YoriLibGenerateCompressedFileSize,      "compressed size"},
+     YoriLibGenerateCompressedFileSize,      "compressed size",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("ct"),                               YoriLibCollectCreateTime,
      YoriLibCompareCreateTime,               NULL,
-     YoriLibGenerateCreateTime,              "create time"},
+     YoriLibGenerateCreateTime,              "create time",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("de"),                               YoriLibCollectDescription,
      YoriLibCompareDescription,              NULL,
-     YoriLibGenerateDescription,             "description"},
+     YoriLibGenerateDescription,             "description",
+     YORI_LIB_FILE_FILT_COST_EXPENSIVE},
 
     {_T("dr"),                               YoriLibCollectFileAttributes,
      YoriLibCompareDirectory,                NULL,
-     YoriLibGenerateDirectory,               "directory"},
+     YoriLibGenerateDirectory,               "directory",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("ep"),                               YoriLibCollectEffectivePermissions,
      YoriLibCompareEffectivePermissions,     YoriLibBitwiseEffectivePermissions,
-     YoriLibGenerateEffectivePermissions,    "effective permissions"},
+     YoriLibGenerateEffectivePermissions,    "effective permissions",
+     YORI_LIB_FILE_FILT_COST_EXPENSIVE},
 
     {_T("fa"),                               YoriLibCollectFileAttributes,
      YoriLibCompareFileAttributes,           YoriLibBitwiseFileAttributes,
-     YoriLibGenerateFileAttributes,          "file attributes"},
+     YoriLibGenerateFileAttributes,          "file attributes",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("fc"),                               YoriLibCollectFragmentCount,
      YoriLibCompareFragmentCount,            NULL,
-     YoriLibGenerateFragmentCount,           "fragment count"},
+     YoriLibGenerateFragmentCount,           "fragment count",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("fe"),                               YoriLibCollectFileName,
      YoriLibCompareFileExtension,            NULL,
-     YoriLibGenerateFileExtension,           "file extension"},
+     YoriLibGenerateFileExtension,           "file extension",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("fi"),                               YoriLibCollectFileId,
      YoriLibCompareFileId,                   NULL,
-     YoriLibGenerateFileId,                  "file id"},
+     YoriLibGenerateFileId,                  "file id",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("fn"),                               YoriLibCollectFileName,
      YoriLibCompareFileName,                 YoriLibBitwiseFileName,
-     YoriLibGenerateFileName,                "file name"},
+     YoriLibGenerateFileName,                "file name",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("fs"),                               YoriLibCollectFileSize,
      YoriLibCompareFileSize,                 NULL,
-     YoriLibGenerateFileSize,                "file size"},
+     YoriLibGenerateFileSize,                "file size",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("fv"),                               YoriLibCollectFileVersionString,
      YoriLibCompareFileVersionString,        NULL,
-     YoriLibGenerateFileVersionString,       "file version string"},
+     YoriLibGenerateFileVersionString,       "file version string",
+     YORI_LIB_FILE_FILT_COST_EXPENSIVE},
 
     {_T("lc"),                               YoriLibCollectLinkCount,
      YoriLibCompareLinkCount,                NULL,
-     YoriLibGenerateLinkCount,               "link count"},
+     YoriLibGenerateLinkCount,               "link count",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("oi"),                               YoriLibCollectObjectId,
      YoriLibCompareObjectId,                 NULL,
-     YoriLibGenerateObjectId,                "object id"},
+     YoriLibGenerateObjectId,                "object id",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("os"),                               YoriLibCollectOsVersion,
      YoriLibCompareOsVersion,                NULL,
-     YoriLibGenerateOsVersion,               "minimum OS version"},
+     YoriLibGenerateOsVersion,               "minimum OS version",
+     YORI_LIB_FILE_FILT_COST_CONTENTS},
 
     {_T("ow"),                               YoriLibCollectOwner,
      YoriLibCompareOwner,                    NULL,
-     YoriLibGenerateOwner,                   "owner"},
+     YoriLibGenerateOwner,                   "owner",
+     YORI_LIB_FILE_FILT_COST_EXPENSIVE},
 
     {_T("rt"),                               YoriLibCollectReparseTag,
      YoriLibCompareReparseTag,               NULL,
-     YoriLibGenerateReparseTag,              "reparse tag"},
+     YoriLibGenerateReparseTag,              "reparse tag",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("sc"),                               YoriLibCollectStreamCount,
      YoriLibCompareStreamCount,              NULL,
-     YoriLibGenerateStreamCount,             "stream count"},
+     YoriLibGenerateStreamCount,             "stream count",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("sn"),                               YoriLibCollectShortName,
      YoriLibCompareShortName,                NULL,
-     YoriLibGenerateShortName,               "short name"},
+     YoriLibGenerateShortName,               "short name",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("ss"),                               YoriLibCollectSubsystem,
      YoriLibCompareSubsystem,                NULL,
-     YoriLibGenerateSubsystem,               "subsystem"},
+     YoriLibGenerateSubsystem,               "subsystem",
+     YORI_LIB_FILE_FILT_COST_CONTENTS},
 
     {_T("us"),                               YoriLibCollectUsn,
      YoriLibCompareUsn,                      NULL,
-     YoriLibGenerateUsn,                     "USN"},
+     YoriLibGenerateUsn,                     "USN",
+     YORI_LIB_FILE_FILT_COST_METADATA},
 
     {_T("vr"),                               YoriLibCollectVersion,
      YoriLibCompareVersion,                  NULL,
-     YoriLibGenerateVersion,                 "version"},
+     YoriLibGenerateVersion,                 "version",
+     YORI_LIB_FILE_FILT_COST_EXPENSIVE},
 
     {_T("wd"),                               YoriLibCollectWriteTime,
      YoriLibCompareWriteDate,                NULL,
-     YoriLibGenerateWriteDate,               "write date"},
+     YoriLibGenerateWriteDate,               "write date",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 
     {_T("wt"),                               YoriLibCollectWriteTime,
      YoriLibCompareWriteTime,                NULL,
-     YoriLibGenerateWriteTime,               "write time"},
+     YoriLibGenerateWriteTime,               "write time",
+     YORI_LIB_FILE_FILT_COST_FIND_DATA},
 };
 
 /**
@@ -358,6 +418,7 @@ YoriLibFileFiltParseFilterOperator(
     }
 
     Criteria->CollectFn = MatchedOption->CollectFn;
+    Criteria->Cost = MatchedOption->Cost;
 
     //
     //  If we fail to capture this, ignore it and move on to the
@@ -552,6 +613,34 @@ YoriLibFileFiltParseColorElement(
     return TRUE;
 }
 
+/**
+ Copy a criteria to a new location.  The comparison entry may contain a
+ pointer to within itself, which needs to refer to the new copy.
+
+ @param Dest Pointer to the location to copy the criteria to.
+
+ @param Src Pointer to the criteria to copy.
+
+ @param AllocationSize Specifies the size, in bytes, of each criteria.
+ */
+VOID
+YoriLibFileFiltCopyCriteria(
+    __out PVOID Dest,
+    __in PYORI_LIB_FILE_FILT_MATCH_CRITERIA Src,
+    __in YORI_ALLOC_SIZE_T AllocationSize
+    )
+{
+    PYORI_LIB_FILE_FILT_MATCH_CRITERIA DestCriteria;
+
+    DestCriteria = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)Dest;
+    memcpy(DestCriteria, Src, AllocationSize);
+
+    if (Src->CompareEntry.Extension >= Src->CompareEntry.FileName &&
+        Src->CompareEntry.Extension <= &Src->CompareEntry.FileName[MAX_PATH - 1]) {
+
+        DestCriteria->CompareEntry.Extension = DestCriteria->CompareEntry.FileName + (Src->CompareEntry.Extension - Src->CompareEntry.FileName);
+    }
+}
 
 /**
  A callback function which can be invoked to parse each element in a
@@ -582,6 +671,10 @@ typedef YORI_LIB_FILE_FILT_PARSE_FN *PYORI_LIB_FILE_FILT_PARSE_FN;
  @param AllocationSize Specifies the size, in bytes, needed for each element
         generated.
 
+ @param OrderByCost If TRUE, all criteria must be satisfied for a match so
+        criteria can be reordered to evaluate the cheapest first.  If FALSE,
+        criteria are evaluated in the order specified.
+
  @param ErrorSubstring On failure, updated to point to the part of the user's
         expression that caused the failure.
 
@@ -594,6 +687,7 @@ YoriLibFileFiltParseFilterStringInternal(
     __in PYORI_STRING FilterString,
     __in PYORI_LIB_FILE_FILT_PARSE_FN Fn,
     __in YORI_ALLOC_SIZE_T AllocationSize,
+    __in BOOLEAN OrderByCost,
     __out _On_failure_(_Post_valid_) PYORI_STRING ErrorSubstring
     )
 {
@@ -604,6 +698,7 @@ YoriLibFileFiltParseFilterStringInternal(
     LPTSTR NextStart;
     YORI_ALLOC_SIZE_T ElementCount;
     DWORD Index;
+    DWORD Count;
     DWORD Phase;
 
     ASSERT(AllocationSize >= sizeof(YORI_LIB_FILE_FILT_MATCH_CRITERIA));
@@ -635,26 +730,6 @@ YoriLibFileFiltParseFilterStringInternal(
                         YoriLibFree(Criteria);
                         return FALSE;
                     }
-
-                    //
-                    //  At the expense of being N^2, check if a previous
-                    //  item is already collecting the same data.  If it
-                    //  is, don't collect anything by this item.  The
-                    //  hope is this filter chain is executed across
-                    //  multiple files so the cost of this check will be
-                    //  outweighed by the operations it eliminates.
-                    //
-
-                    if (ThisElement->CollectFn != NULL) {
-                        PYORI_LIB_FILE_FILT_MATCH_CRITERIA PreviousElement;
-                        for (Index = 0; Index < ElementCount; Index++) {
-                            PreviousElement = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)YoriLibAddToPointer(Criteria, Index * AllocationSize);
-                            if (ThisElement->CollectFn == PreviousElement->CollectFn) {
-                                ThisElement->CollectFn = NULL;
-                                break;
-                            }
-                        }
-                    }
                 }
                 ElementCount++;
             }
@@ -687,6 +762,60 @@ YoriLibFileFiltParseFilterStringInternal(
         }
     }
 
+    //
+    //  If the order of criteria doesn't change the result, evaluate the
+    //  cheapest criteria first.  A file that fails a criteria doesn't need
+    //  to have data collected for any later criteria, so this avoids
+    //  expensive collection for files that a cheap criteria would reject.
+    //  Criteria of equal cost remain in the order the user specified.
+    //
+
+    if (OrderByCost && ElementCount > 1) {
+        PYORI_LIB_FILE_FILT_MATCH_CRITERIA Ordered;
+        DWORD Cost;
+
+        Ordered = YoriLibMalloc(ElementCount * AllocationSize);
+        if (Ordered != NULL) {
+            Count = 0;
+            for (Cost = YORI_LIB_FILE_FILT_COST_FIND_DATA; Cost <= YORI_LIB_FILE_FILT_COST_EXPENSIVE; Cost++) {
+                for (Index = 0; Index < ElementCount; Index++) {
+                    ThisElement = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)YoriLibAddToPointer(Criteria, Index * AllocationSize);
+                    if (ThisElement->Cost == Cost) {
+                        YoriLibFileFiltCopyCriteria(YoriLibAddToPointer(Ordered, Count * AllocationSize), ThisElement, AllocationSize);
+                        Count++;
+                    }
+                }
+            }
+            ASSERT(Count == ElementCount);
+            YoriLibFree(Criteria);
+            Criteria = Ordered;
+        }
+    }
+
+    //
+    //  At the expense of being N^2, check if a previous item is already
+    //  collecting the same data.  If it is, don't collect anything by this
+    //  item.  The hope is this filter chain is executed across multiple
+    //  files so the cost of this check will be outweighed by the operations
+    //  it eliminates.  This is done once the order of evaluation is final so
+    //  that data is collected by the first criteria that needs it.
+    //
+
+    for (Count = 1; Count < ElementCount; Count++) {
+        PYORI_LIB_FILE_FILT_MATCH_CRITERIA PreviousElement;
+        ThisElement = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)YoriLibAddToPointer(Criteria, Count * AllocationSize);
+        if (ThisElement->CollectFn == NULL) {
+            continue;
+        }
+        for (Index = 0; Index < Count; Index++) {
+            PreviousElement = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)YoriLibAddToPointer(Criteria, Index * AllocationSize);
+            if (ThisElement->CollectFn == PreviousElement->CollectFn) {
+                ThisElement->CollectFn = NULL;
+                break;
+            }
+        }
+    }
+
     Filter->Criteria = Criteria;
     Filter->ElementSize = AllocationSize;
     Filter->NumberCriteria = ElementCount;
@@ -716,7 +845,7 @@ YoriLibFileFiltParseFilterString(
     __out _On_failure_(_Post_valid_) PYORI_STRING ErrorSubstring
     )
 {
-    return YoriLibFileFiltParseFilterStringInternal(Filter, FilterString, YoriLibFileFiltParseFilterElement, sizeof(YORI_LIB_FILE_FILT_MATCH_CRITERIA), ErrorSubstring);
+    return YoriLibFileFiltParseFilterStringInternal(Filter, FilterString, YoriLibFileFiltParseFilterElement, sizeof(YORI_LIB_FILE_FILT_MATCH_CRITERIA), TRUE, ErrorSubstring);
 }
 
 /**
@@ -743,7 +872,7 @@ YoriLibFileFiltParseColorString(
     __out _On_failure_(_Post_valid_) PYORI_STRING ErrorSubstring
     )
 {
-    return YoriLibFileFiltParseFilterStringInternal(Filter, ColorString, YoriLibFileFiltParseColorElement, sizeof(YORI_LIB_FILE_FILT_COLOR_CRITERIA), ErrorSubstring);
+    return YoriLibFileFiltParseFilterStringInternal(Filter, ColorString, YoriLibFileFiltParseColorElement, sizeof(YORI_LIB_FILE_FILT_COLOR_CRITERIA), FALSE, ErrorSubstring);
 }
 
 /**
@@ -772,8 +901,10 @@ YoriLibFileFiltCheckFilterMatch(
 {
     DWORD Count;
     YORI_FILE_INFO CompareEntry;
+    YORILIB_COLLECT_SESSION Session;
     PYORI_LIB_FILE_FILT_MATCH_CRITERIA CriteriaArray;
     PYORI_LIB_FILE_FILT_MATCH_CRITERIA Criteria;
+    BOOL Result;
 
     if (Filter->NumberCriteria == 0) {
         return TRUE;
@@ -781,21 +912,34 @@ YoriLibFileFiltCheckFilterMatch(
 
     ZeroMemory(&CompareEntry, sizeof(CompareEntry));
 
+    //
+    //  Multiple criteria may need a handle to the file.  Share one between
+    //  them rather than opening the file for each.
+    //
+
+    YoriLibInitializeCollectSession(&Session);
+    YoriLibBeginCollectSession(&Session, &CompareEntry);
+
+    Result = TRUE;
     CriteriaArray = (PYORI_LIB_FILE_FILT_MATCH_CRITERIA)Filter->Criteria;
     for (Count = 0; Count < Filter->NumberCriteria; Count++) {
         Criteria = &CriteriaArray[Count];
         if (Criteria->CollectFn != NULL &&
             !Criteria->CollectFn(&CompareEntry, FileInfo, FilePath)) {
 
-            return FALSE;
+            Result = FALSE;
+            break;
         }
 
         if (!Criteria->TruthStates[Criteria->CompareFn(&CompareEntry, &Criteria->CompareEntry)]) {
-            return FALSE;
+            Result = FALSE;
+            break;
         }
     }
 
-    return TRUE;
+    YoriLibEndCollectSession(&Session, &CompareEntry);
+
+    return Result;
 }
 
 /**
@@ -831,8 +975,11 @@ YoriLibFileFiltCheckColorMatch(
     PYORI_LIB_FILE_FILT_COLOR_CRITERIA ThisApply;
     PYORI_LIB_FILE_FILT_COLOR_CRITERIA ColorsToApply;
     YORI_FILE_INFO CompareEntry;
+    YORILIB_COLLECT_SESSION Session;
 
     ZeroMemory(&CompareEntry, sizeof(CompareEntry));
+    YoriLibInitializeCollectSession(&Session);
+    YoriLibBeginCollectSession(&Session, &CompareEntry);
 
     ThisAttribute.Ctrl = YORILIB_ATTRCTRL_WINDOW_BG | YORILIB_ATTRCTRL_WINDOW_FG;
     ThisAttribute.Win32Attr = 0;
@@ -856,6 +1003,7 @@ YoriLibFileFiltCheckColorMatch(
         if (ThisApply->Match.CollectFn != NULL &&
             !ThisApply->Match.CollectFn(&CompareEntry, FileInfo, FilePath)) {
 
+            YoriLibEndCollectSession(&Session, &CompareEntry);
             return FALSE;
         }
 
@@ -872,6 +1020,7 @@ YoriLibFileFiltCheckColorMatch(
 
                 Attribute->Ctrl = ThisAttribute.Ctrl;
                 Attribute->Win32Attr = ThisAttribute.Win32Attr;
+                YoriLibEndCollectSession(&Session, &CompareEntry);
                 return TRUE;
             }
 
@@ -879,6 +1028,8 @@ YoriLibFileFiltCheckColorMatch(
         }
     }
 
+    YoriLibEndCollectSession(&Session, &CompareEntry);
+
     //
     //  We do let the user explicitly request black on black, but
     //  if we ended the search due to unbounded continues, return
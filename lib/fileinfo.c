@@ -192,6 +192,169 @@ YoriLibCopyFileName(
 }
 
 
+/**
+ Initialize a collection session.  A session can be used for any number of
+ files, and retains knowledge of the access required by collectors between
+ files.
+
+ @param Session Pointer to the session to initialize.
+ */
+VOID
+YoriLibInitializeCollectSession(
+    __out PYORILIB_COLLECT_SESSION Session
+    )
+{
+    Session->FileHandle = NULL;
+    Session->HandleAccess = 0;
+    Session->DesiredAccess = 0;
+    Session->SharedOpenFailed = FALSE;
+    Session->CacheRecordLookedUp = FALSE;
+    Session->MetadataCache = NULL;
+    Session->CacheRecord = NULL;
+}
+
+/**
+ Indicate that collectors are about to populate information about a file.
+ Collectors invoked on the entry until YoriLibEndCollectSession is called
+ will share a single handle to the file where possible.
+
+ @param Session Pointer to the session.
+
+ @param Entry Pointer to the entry which is about to be populated.
+ */
+VOID
+YoriLibBeginCollectSession(
+    __inout PYORILIB_COLLECT_SESSION Session,
+    __inout PYORI_FILE_INFO Entry
+    )
+{
+    ASSERT(Session->FileHandle == NULL);
+    Session->SharedOpenFailed = FALSE;
+    Session->CacheRecordLookedUp = FALSE;
+    Session->CacheRecord = NULL;
+    Entry->Session = Session;
+}
+
+/**
+ Indicate that collectors have finished populating information about a file.
+ Any handle opened for the file is closed.  The access collectors required
+ is retained so the next file can be opened once with all of it.
+
+ @param Session Pointer to the session.
+
+ @param Entry Pointer to the entry which has been populated.
+ */
+VOID
+YoriLibEndCollectSession(
+    __inout PYORILIB_COLLECT_SESSION Session,
+    __inout PYORI_FILE_INFO Entry
+    )
+{
+    if (Session->FileHandle != NULL) {
+        CloseHandle(Session->FileHandle);
+        Session->FileHandle = NULL;
+        Session->HandleAccess = 0;
+    }
+    Entry->Session = NULL;
+}
+
+/**
+ Open a file on behalf of a collector.  If the entry has a collection
+ session, a handle already opened for another collector is returned if it
+ has the requested access, and if a new handle is needed it is opened with
+ the access needed by every collector seen so far.
+
+ @param Entry The directory entry being populated.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param DesiredAccess The access required by the collector.
+
+ @return A handle to the file, or INVALID_HANDLE_VALUE on failure.  The
+         handle should be released with YoriLibCollectCloseFile.
+ */
+HANDLE
+YoriLibCollectOpenFile(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __in DWORD DesiredAccess
+    )
+{
+    PYORILIB_COLLECT_SESSION Session;
+    HANDLE hFile;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    Session = Entry->Session;
+    if (Session != NULL && !Session->SharedOpenFailed) {
+        if (Session->FileHandle != NULL &&
+            (Session->HandleAccess & DesiredAccess) == DesiredAccess) {
+
+            return Session->FileHandle;
+        }
+
+        if (Session->FileHandle != NULL) {
+            CloseHandle(Session->FileHandle);
+            Session->FileHandle = NULL;
+            Session->HandleAccess = 0;
+        }
+
+        Session->DesiredAccess |= DesiredAccess;
+
+        hFile = CreateFile(FullPath->StartOfString,
+                           Session->DesiredAccess,
+                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
+                           NULL);
+
+        if (hFile != INVALID_HANDLE_VALUE) {
+            Session->FileHandle = hFile;
+            Session->HandleAccess = Session->DesiredAccess;
+            return hFile;
+        }
+
+        //
+        //  If the file can't be opened with everything, fall back to
+        //  opening it with only what each collector needs.
+        //
+
+        Session->SharedOpenFailed = TRUE;
+    }
+
+    hFile = CreateFile(FullPath->StartOfString,
+                       DesiredAccess,
+                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
+                       NULL);
+
+    return hFile;
+}
+
+/**
+ Release a handle returned from YoriLibCollectOpenFile.  If the handle is
+ owned by the entry's collection session it remains open for use by later
+ collectors.
+
+ @param Entry The directory entry being populated.
+
+ @param FileHandle The handle to release.
+ */
+VOID
+YoriLibCollectCloseFile(
+    __in PYORI_FILE_INFO Entry,
+    __in HANDLE FileHandle
+    )
+{
+    if (Entry->Session != NULL && Entry->Session->FileHandle == FileHandle) {
+        return;
+    }
+    CloseHandle(FileHandle);
+}
+
 /**
  Collect information from a directory enumerate and full file name relating
  to the file's access time.
@@ -246,13 +409,7 @@ YoriLibCollectAllocatedRangeCount (
     Entry->AllocatedRangeCount.HighPart = 0;
     Entry->AllocatedRangeCount.LowPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES|FILE_READ_DATA,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES|FILE_READ_DATA);
 
     if (hFile != INVALID_HANDLE_VALUE) {
 
@@ -310,7 +467,7 @@ YoriLibCollectAllocatedRangeCount (
             }
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -342,13 +499,7 @@ YoriLibCollectAllocationSize (
 
         HANDLE hFile;
 
-        hFile = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                           NULL);
+        hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
         if (hFile != INVALID_HANDLE_VALUE) {
             FILE_STANDARD_INFO StandardInfo;
@@ -358,7 +509,7 @@ YoriLibCollectAllocationSize (
                 RealAllocSize = TRUE;
             }
 
-            CloseHandle(hFile);
+            YoriLibCollectCloseFile(Entry, hFile);
         }
     }
 
@@ -474,6 +625,13 @@ YoriLibCapturePeHeaders (
             }
         }
         CloseHandle(hFileRead);
+
+        //
+        //  Indicate that the file was examined and is not a PE, as opposed
+        //  to the file not being accessible.
+        //
+
+        SetLastError(ERROR_BAD_EXE_FORMAT);
     }
     return FALSE;
 }
@@ -505,6 +663,307 @@ YoriLibIsExecutableGui(
     return FALSE;
 }
 
+/**
+ Populate the fields of a metadata record which are derived from an
+ executable's PE headers.  If the file is not a PE, the fields are zeroed.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param Record Pointer to the record to populate.
+
+ @return TRUE if the record describes the file, including the case where the
+         file is not a PE, or FALSE if the file could not be examined and the
+         result should not be retained.
+ */
+BOOL
+YoriLibCapturePeFields(
+    __in PYORI_STRING FullPath,
+    __out PYORILIB_METADATA_CACHE_RECORD Record
+    )
+{
+    YORILIB_PE_HEADERS PeHeaders;
+
+    Record->Architecture = 0;
+    Record->Subsystem = 0;
+    Record->OsVersionHigh = 0;
+    Record->OsVersionLow = 0;
+
+    if (!YoriLibCapturePeHeaders(FullPath, &PeHeaders)) {
+        if (GetLastError() == ERROR_BAD_EXE_FORMAT) {
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    Record->Architecture = PeHeaders.ImageHeader.Machine;
+    Record->Subsystem = PeHeaders.OptionalHeader.Subsystem;
+    Record->OsVersionHigh = PeHeaders.OptionalHeader.MajorSubsystemVersion;
+    Record->OsVersionLow = PeHeaders.OptionalHeader.MinorSubsystemVersion;
+
+    return TRUE;
+}
+
+/**
+ Copy a string from an executable's version resource into a fixed size
+ buffer, truncating if necessary.
+
+ @param VersionBuffer Pointer to the version resource.
+
+ @param TranslationBlock Pointer to the language and code page of the
+        string table to query.
+
+ @param ValueName The name of the value to query.
+
+ @param Dest Pointer to the buffer to populate.
+
+ @param DestSizeInBytes The size of Dest, in bytes.
+ */
+VOID
+YoriLibCaptureVersionString(
+    __in PVOID VersionBuffer,
+    __in PWORD TranslationBlock,
+    __in LPCTSTR ValueName,
+    __out_bcount(DestSizeInBytes) LPTSTR Dest,
+    __in DWORD DestSizeInBytes
+    )
+{
+    TCHAR LanguageBlockToFind[sizeof("\\StringFileInfo\\01234567\\FileDescription")];
+    LPTSTR Value;
+    DWORD BytesToCopy;
+    DWORD Junk;
+
+    Dest[0] = '\0';
+
+    YoriLibSPrintf(LanguageBlockToFind, _T("\\StringFileInfo\\%04x%04x\\%s"), TranslationBlock[0], TranslationBlock[1], ValueName);
+    if (DllVersion.pVerQueryValueW(VersionBuffer, LanguageBlockToFind, (PVOID*)&Value, (PUINT)&Junk)) {
+        BytesToCopy = Junk * sizeof(TCHAR);
+        if (BytesToCopy > DestSizeInBytes - sizeof(TCHAR)) {
+            BytesToCopy = DestSizeInBytes - sizeof(TCHAR);
+        }
+        memcpy(Dest, Value, BytesToCopy);
+        Dest[BytesToCopy / sizeof(TCHAR)] = '\0';
+    }
+}
+
+/**
+ Populate the fields of a metadata record which are derived from an
+ executable's version resource.  The resource is loaded once for all of
+ them.  If the file has no version resource, the fields are zeroed.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param Record Pointer to the record to populate.
+
+ @return TRUE if the record describes the file, including the case where the
+         file has no version resource, or FALSE if the file could not be
+         examined and the result should not be retained.
+ */
+BOOL
+YoriLibCaptureVersionFields(
+    __in PYORI_STRING FullPath,
+    __out PYORILIB_METADATA_CACHE_RECORD Record
+    )
+{
+    DWORD Junk;
+    DWORD Err;
+    PVOID Buffer;
+    YORI_ALLOC_SIZE_T VerSize;
+    PWORD TranslationBlock;
+    VS_FIXEDFILEINFO * RootBlock;
+    TCHAR BlockString[sizeof("\\VarFileInfo\\Translation")];
+
+    Record->FileVersion.QuadPart = 0;
+    Record->FileVersionFlags = 0;
+    Record->Description[0] = '\0';
+    Record->FileVersionString[0] = '\0';
+
+    YoriLibLoadVersionFunctions();
+
+    if (DllVersion.pGetFileVersionInfoSizeW == NULL ||
+        DllVersion.pGetFileVersionInfoW == NULL ||
+        DllVersion.pVerQueryValueW == NULL) {
+
+        return FALSE;
+    }
+
+    VerSize = (YORI_ALLOC_SIZE_T)DllVersion.pGetFileVersionInfoSizeW(FullPath->StartOfString, &Junk);
+    if (VerSize == 0) {
+        Err = GetLastError();
+        if (Err == ERROR_RESOURCE_DATA_NOT_FOUND ||
+            Err == ERROR_RESOURCE_TYPE_NOT_FOUND ||
+            Err == ERROR_RESOURCE_NAME_NOT_FOUND ||
+            Err == ERROR_RESOURCE_LANG_NOT_FOUND ||
+            Err == ERROR_BAD_EXE_FORMAT) {
+
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(VerSize);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    if (!DllVersion.pGetFileVersionInfoW(FullPath->StartOfString, 0, VerSize, Buffer)) {
+        YoriLibFree(Buffer);
+        return FALSE;
+    }
+
+    //
+    //  Old versions of version.dll modify this buffer while parsing
+    //  it, so we need to give them a writable stack based copy
+    //
+
+    YoriLibSPrintf(BlockString, _T("\\"));
+    if (DllVersion.pVerQueryValueW(Buffer, BlockString, (PVOID*)&RootBlock, (PUINT)&Junk)) {
+        Record->FileVersion.HighPart = RootBlock->dwFileVersionMS;
+        Record->FileVersion.LowPart = RootBlock->dwFileVersionLS;
+        Record->FileVersionFlags = RootBlock->dwFileFlags & RootBlock->dwFileFlagsMask;
+    }
+
+    YoriLibSPrintf(BlockString, _T("\\VarFileInfo\\Translation"));
+    if (DllVersion.pVerQueryValueW(Buffer, BlockString, (PVOID*)&TranslationBlock, (PUINT)&Junk) && Junk >= 2 * sizeof(WORD)) {
+        YoriLibCaptureVersionString(Buffer, TranslationBlock, _T("FileDescription"), Record->Description, sizeof(Record->Description));
+        YoriLibCaptureVersionString(Buffer, TranslationBlock, _T("FileVersion"), Record->FileVersionString, sizeof(Record->FileVersionString));
+    }
+
+    YoriLibFree(Buffer);
+    return TRUE;
+}
+
+/**
+ Find the persistent metadata cache record for the file being collected.
+ The record is only looked up once per file, and is shared by all
+ collectors whose data it contains.
+
+ @param Entry The directory entry being populated.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @return Pointer to the record, or NULL if the entry's collection session
+         has no cache or the file cannot be cached.
+ */
+PYORILIB_METADATA_CACHE_RECORD
+YoriLibCollectGetCacheRecord(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath
+    )
+{
+    PYORILIB_COLLECT_SESSION Session;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    LARGE_INTEGER FileId;
+    LARGE_INTEGER LastWriteTime;
+    HANDLE hFile;
+
+    Session = Entry->Session;
+    if (Session == NULL || Session->MetadataCache == NULL) {
+        return NULL;
+    }
+
+    if (Session->CacheRecordLookedUp) {
+        return Session->CacheRecord;
+    }
+
+    Session->CacheRecordLookedUp = TRUE;
+
+    //
+    //  Use the volume, file ID and write time from the file itself rather
+    //  than the entry, since those columns may not have been collected.
+    //
+
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    if (GetFileInformationByHandle(hFile, &FileInfo) &&
+        (FileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        FileId.HighPart = FileInfo.nFileIndexHigh;
+        FileId.LowPart = FileInfo.nFileIndexLow;
+        LastWriteTime.HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
+        LastWriteTime.LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
+
+        Session->CacheRecord = YoriLibMetadataCacheLookup(Session->MetadataCache,
+                                                          FileInfo.dwVolumeSerialNumber,
+                                                          &FileId,
+                                                          &LastWriteTime);
+    }
+
+    YoriLibCollectCloseFile(Entry, hFile);
+    return Session->CacheRecord;
+}
+
+/**
+ Populate fields in a directory entry which are derived from the contents
+ of an executable.  If the entry's collection session has a persistent
+ cache, fields are obtained from it if the file has not changed since they
+ were captured, and are added to it if not.
+
+ @param Entry The directory entry to populate.
+
+ @param FullPath Pointer to a string to the full file name.
+
+ @param Fields A combination of YORILIB_METADATA_CACHE_* flags indicating
+        the groups of fields to populate.
+ */
+VOID
+YoriLibCollectExecutableInfo(
+    __inout PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __in DWORD Fields
+    )
+{
+    YORILIB_METADATA_CACHE_RECORD LocalRecord;
+    PYORILIB_METADATA_CACHE_RECORD Record;
+    DWORD FieldsCaptured;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    Record = YoriLibCollectGetCacheRecord(Entry, FullPath);
+    if (Record == NULL) {
+        Record = &LocalRecord;
+        LocalRecord.ValidFields = 0;
+    }
+
+    FieldsCaptured = 0;
+    if ((Fields & YORILIB_METADATA_CACHE_PE_HEADERS) != 0 &&
+        (Record->ValidFields & YORILIB_METADATA_CACHE_PE_HEADERS) == 0) {
+
+        if (YoriLibCapturePeFields(FullPath, Record)) {
+            FieldsCaptured = FieldsCaptured | YORILIB_METADATA_CACHE_PE_HEADERS;
+        }
+    }
+
+    if ((Fields & YORILIB_METADATA_CACHE_VERSION) != 0 &&
+        (Record->ValidFields & YORILIB_METADATA_CACHE_VERSION) == 0) {
+
+        if (YoriLibCaptureVersionFields(FullPath, Record)) {
+            FieldsCaptured = FieldsCaptured | YORILIB_METADATA_CACHE_VERSION;
+        }
+    }
+
+    if (FieldsCaptured != 0 && Record != &LocalRecord) {
+        Record->ValidFields = Record->ValidFields | FieldsCaptured;
+        YoriLibMetadataCacheRecordUpdated(Record);
+    }
+
+    if (Fields & YORILIB_METADATA_CACHE_PE_HEADERS) {
+        Entry->Architecture = Record->Architecture;
+        Entry->Subsystem = Record->Subsystem;
+        Entry->OsVersionHigh = Record->OsVersionHigh;
+        Entry->OsVersionLow = Record->OsVersionLow;
+    }
+
+    if (Fields & YORILIB_METADATA_CACHE_VERSION) {
+        Entry->FileVersion.QuadPart = Record->FileVersion.QuadPart;
+        Entry->FileVersionFlags = Record->FileVersionFlags;
+        memcpy(Entry->Description, Record->Description, sizeof(Entry->Description));
+        memcpy(Entry->FileVersionString, Record->FileVersionString, sizeof(Entry->FileVersionString));
+    }
+}
+
 /**
  Collect information from a directory enumerate and full file name relating
  to the executable's architecture.
@@ -524,20 +983,9 @@ YoriLibCollectArch (
     __in PYORI_STRING FullPath
     )
 {
-    YORILIB_PE_HEADERS PeHeaders;
-
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
     UNREFERENCED_PARAMETER(FindData);
 
-    Entry->OsVersionHigh = 0;
-    Entry->OsVersionLow = 0;
-
-    if (YoriLibCapturePeHeaders(FullPath, &PeHeaders)) {
-
-        Entry->Architecture = PeHeaders.ImageHeader.Machine;
-    }
-
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_PE_HEADERS);
     return TRUE;
 }
 
@@ -570,13 +1018,7 @@ YoriLibCollectCaseSensitivity (
         return TRUE;
     }
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
 
@@ -589,7 +1031,7 @@ YoriLibCollectCaseSensitivity (
             }
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -622,13 +1064,7 @@ YoriLibCollectCompressionAlgorithm (
 
     Entry->CompressionAlgorithm = YoriLibCompressionNone;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
 
@@ -674,7 +1110,7 @@ YoriLibCollectCompressionAlgorithm (
             }
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -761,56 +1197,9 @@ YoriLibCollectDescription (
     __in PYORI_STRING FullPath
     )
 {
-    DWORD Junk;
-    PVOID Buffer;
-    YORI_ALLOC_SIZE_T VerSize;
-    PWORD TranslationBlock;
-
     UNREFERENCED_PARAMETER(FindData);
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
-    Entry->Description[0] = '\0';
-
-    YoriLibLoadVersionFunctions();
-
-    if (DllVersion.pGetFileVersionInfoSizeW == NULL ||
-        DllVersion.pGetFileVersionInfoW == NULL ||
-        DllVersion.pVerQueryValueW == NULL) {
-
-        return TRUE;
-    }
-
-    VerSize = (YORI_ALLOC_SIZE_T)DllVersion.pGetFileVersionInfoSizeW(FullPath->StartOfString, &Junk);
-
-    Buffer = YoriLibMalloc(VerSize);
-    if (Buffer != NULL) {
-        if (DllVersion.pGetFileVersionInfoW(FullPath->StartOfString, 0, VerSize, Buffer)) {
-            TCHAR TranslationBlockString[sizeof("\\VarFileInfo\\Translation")];
-
-            //
-            //  Old versions of version.dll modify this buffer while parsing
-            //  it, so we need to give them a writable stack based copy
-            //
-
-            YoriLibSPrintf(TranslationBlockString, _T("\\VarFileInfo\\Translation"));
-            if (DllVersion.pVerQueryValueW(Buffer, TranslationBlockString, (PVOID*)&TranslationBlock, (PUINT)&Junk) && Junk >= 2 * sizeof(WORD)) {
 
-                TCHAR LanguageBlockToFind[sizeof("\\StringFileInfo\\01234567\\FileDescription")];
-                LPTSTR Description;
-
-                YoriLibSPrintf(LanguageBlockToFind, _T("\\StringFileInfo\\%04x%04x\\FileDescription"), TranslationBlock[0], TranslationBlock[1]);
-                if (DllVersion.pVerQueryValueW(Buffer, LanguageBlockToFind, (PVOID*)&Description, (PUINT)&Junk)) {
-                    DWORD BytesToCopy = Junk * sizeof(TCHAR);
-                    if (BytesToCopy > sizeof(Entry->Description) - sizeof(TCHAR)) {
-                        BytesToCopy = sizeof(Entry->Description) - sizeof(TCHAR);
-                    }
-                    memcpy(Entry->Description, Description, BytesToCopy);
-                    Entry->Description[BytesToCopy / sizeof(TCHAR)] = '\0';
-                }
-            }
-        }
-        YoriLibFree(Buffer);
-    }
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_VERSION);
     return TRUE;
 }
 
@@ -1034,13 +1423,7 @@ YoriLibCollectFileId (
 
     Entry->FileId.QuadPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
         BY_HANDLE_FILE_INFORMATION FileInfo;
@@ -1050,7 +1433,7 @@ YoriLibCollectFileId (
             Entry->FileId.HighPart = FileInfo.nFileIndexHigh;
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -1139,56 +1522,9 @@ YoriLibCollectFileVersionString (
     __in PYORI_STRING FullPath
     )
 {
-    DWORD Junk;
-    PVOID Buffer;
-    YORI_ALLOC_SIZE_T VerSize;
-    PWORD TranslationBlock;
-
     UNREFERENCED_PARAMETER(FindData);
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
-    Entry->FileVersionString[0] = '\0';
-
-    YoriLibLoadVersionFunctions();
-
-    if (DllVersion.pGetFileVersionInfoSizeW == NULL ||
-        DllVersion.pGetFileVersionInfoW == NULL ||
-        DllVersion.pVerQueryValueW == NULL) {
-
-        return TRUE;
-    }
-
-    VerSize = (YORI_ALLOC_SIZE_T)DllVersion.pGetFileVersionInfoSizeW(FullPath->StartOfString, &Junk);
-
-    Buffer = YoriLibMalloc(VerSize);
-    if (Buffer != NULL) {
-        if (DllVersion.pGetFileVersionInfoW(FullPath->StartOfString, 0, VerSize, Buffer)) {
-            TCHAR TranslationBlockString[sizeof("\\VarFileInfo\\Translation")];
-
-            //
-            //  Old versions of version.dll modify this buffer while parsing
-            //  it, so we need to give them a writable stack based copy
-            //
-
-            YoriLibSPrintf(TranslationBlockString, _T("\\VarFileInfo\\Translation"));
-            if (DllVersion.pVerQueryValueW(Buffer, TranslationBlockString, (PVOID*)&TranslationBlock, (PUINT)&Junk) && Junk >= 2 * sizeof(WORD)) {
 
-                TCHAR LanguageBlockToFind[sizeof("\\StringFileInfo\\01234567\\FileVersion")];
-                LPTSTR FileVersionString;
-
-                YoriLibSPrintf(LanguageBlockToFind, _T("\\StringFileInfo\\%04x%04x\\FileVersion"), TranslationBlock[0], TranslationBlock[1]);
-                if (DllVersion.pVerQueryValueW(Buffer, LanguageBlockToFind, (PVOID*)&FileVersionString, (PUINT)&Junk)) {
-                    DWORD BytesToCopy = Junk * sizeof(TCHAR);
-                    if (BytesToCopy > sizeof(Entry->FileVersionString) - sizeof(TCHAR)) {
-                        BytesToCopy = sizeof(Entry->FileVersionString) - sizeof(TCHAR);
-                    }
-                    memcpy(Entry->FileVersionString, FileVersionString, BytesToCopy);
-                    Entry->FileVersionString[BytesToCopy / sizeof(TCHAR)] = '\0';
-                }
-            }
-        }
-        YoriLibFree(Buffer);
-    }
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_VERSION);
     return TRUE;
 }
 
@@ -1220,13 +1556,7 @@ YoriLibCollectFragmentCount (
     Entry->FragmentCount.HighPart = 0;
     Entry->FragmentCount.LowPart = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
 
@@ -1282,7 +1612,7 @@ YoriLibCollectFragmentCount (
             StartBuffer.StartingVcn.QuadPart = u.Extents.Extents[u.Extents.ExtentCount - 1].NextVcn.QuadPart;
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -1313,13 +1643,7 @@ YoriLibCollectLinkCount (
 
     Entry->LinkCount = 0;
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
         BY_HANDLE_FILE_INFORMATION FileInfo;
@@ -1328,7 +1652,7 @@ YoriLibCollectLinkCount (
             Entry->LinkCount = FileInfo.nNumberOfLinks;
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -1361,19 +1685,13 @@ YoriLibCollectObjectId (
 
     ZeroMemory(&Entry->ObjectId, sizeof(Entry->ObjectId));
 
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
         if (DeviceIoControl(hFile, FSCTL_GET_OBJECT_ID, NULL, 0, &Buffer, sizeof(Buffer), &BytesReturned, NULL)) {
             memcpy(&Entry->ObjectId, &Buffer.ObjectId, sizeof(Buffer.ObjectId));
         }
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -1397,20 +1715,9 @@ YoriLibCollectOsVersion (
     __in PYORI_STRING FullPath
     )
 {
-    YORILIB_PE_HEADERS PeHeaders;
-
     UNREFERENCED_PARAMETER(FindData);
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
-    Entry->OsVersionHigh = 0;
-    Entry->OsVersionLow = 0;
-
-    if (YoriLibCapturePeHeaders(FullPath, &PeHeaders)) {
-
-        Entry->OsVersionHigh = PeHeaders.OptionalHeader.MajorSubsystemVersion;
-        Entry->OsVersionLow = PeHeaders.OptionalHeader.MinorSubsystemVersion;
-    }
 
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_PE_HEADERS);
     return TRUE;
 }
 
@@ -1563,18 +1870,9 @@ YoriLibCollectSubsystem (
     __in PYORI_STRING FullPath
     )
 {
-    YORILIB_PE_HEADERS PeHeaders;
-
     UNREFERENCED_PARAMETER(FindData);
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
-    Entry->Subsystem = 0;
-
-    if (YoriLibCapturePeHeaders(FullPath, &PeHeaders)) {
-
-        Entry->Subsystem = PeHeaders.OptionalHeader.Subsystem;
-    }
 
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_PE_HEADERS);
     return TRUE;
 }
 
@@ -1649,13 +1947,7 @@ YoriLibCollectUsn (
     ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
     Entry->Usn.QuadPart = 0;
-    hFile = CreateFile(FullPath->StartOfString,
-                       FILE_READ_ATTRIBUTES,
-                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                       NULL,
-                       OPEN_EXISTING,
-                       FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT|FILE_FLAG_OPEN_NO_RECALL,
-                       NULL);
+    hFile = YoriLibCollectOpenFile(Entry, FullPath, FILE_READ_ATTRIBUTES);
 
     if (hFile != INVALID_HANDLE_VALUE) {
 
@@ -1669,7 +1961,7 @@ YoriLibCollectUsn (
             Entry->Usn.QuadPart = s1.UsnRecord.Usn;
         }
 
-        CloseHandle(hFile);
+        YoriLibCollectCloseFile(Entry, hFile);
     }
     return TRUE;
 }
@@ -1693,47 +1985,9 @@ YoriLibCollectVersion (
     __in PYORI_STRING FullPath
     )
 {
-    DWORD Junk;
-    PVOID Buffer;
-    YORI_ALLOC_SIZE_T VerSize;
-    VS_FIXEDFILEINFO * RootBlock;
-
     UNREFERENCED_PARAMETER(FindData);
-    ASSERT(YoriLibIsStringNullTerminated(FullPath));
-
-    Entry->FileVersion.QuadPart = 0;
-    Entry->FileVersionFlags = 0;
-
-    YoriLibLoadVersionFunctions();
-
-    if (DllVersion.pGetFileVersionInfoSizeW == NULL ||
-        DllVersion.pGetFileVersionInfoW == NULL ||
-        DllVersion.pVerQueryValueW == NULL) {
-
-        return TRUE;
-    }
-
-    VerSize = (YORI_ALLOC_SIZE_T)DllVersion.pGetFileVersionInfoSizeW(FullPath->StartOfString, &Junk);
-
-    Buffer = YoriLibMalloc(VerSize);
-    if (Buffer != NULL) {
-        if (DllVersion.pGetFileVersionInfoW(FullPath->StartOfString, 0, VerSize, Buffer)) {
-            TCHAR BlockString[sizeof("\\")];
-
-            //
-            //  Old versions of version.dll modify this buffer while parsing
-            //  it, so we need to give them a writable stack based copy
-            //
 
-            YoriLibSPrintf(BlockString, _T("\\"));
-            if (DllVersion.pVerQueryValueW(Buffer, BlockString, (PVOID*)&RootBlock, (PUINT)&Junk)) {
-                Entry->FileVersion.HighPart = RootBlock->dwFileVersionMS;
-                Entry->FileVersion.LowPart = RootBlock->dwFileVersionLS;
-                Entry->FileVersionFlags = RootBlock->dwFileFlags & RootBlock->dwFileFlagsMask;
-            }
-        }
-        YoriLibFree(Buffer);
-    }
+    YoriLibCollectExecutableInfo(Entry, FullPath, YORILIB_METADATA_CACHE_VERSION);
     return TRUE;
 }
 
@@ -591,11 +591,13 @@ YoriLibGetFullPathDeterminePathType(
         This can be reallocated in this function if it is insufficient to
         hold the result; if this occurs, FreeOnFailure is set to TRUE.
 
- @param FreeOnFailure Pointer to a boolean to be set to TRUE if the Buffer
-        was reallocated in this function.  If this occurs, later failure will
-        cause the reallocated buffer to be freed.  This allows a caller to use
-        an initialized but not allocated string and only receive an allocated
-        string on success.
+ @param FreeOnFailure Optionally points to a boolean to be set to TRUE if
+        the Buffer was reallocated in this function.  If this occurs, later
+        failure will cause the reallocated buffer to be freed.  This allows a
+        caller to use an initialized but not allocated string and only
+        receive an allocated string on success.  If NULL, the Buffer is never
+        reallocated, and ERROR_INSUFFICIENT_BUFFER is returned if it is too
+        small.
 
  @return A win32 error code, or ERROR_SUCCESS to indicate successful
          completion.
@@ -607,7 +609,7 @@ YoriLibFullPathMergeRootWithRelative(
     __in BOOL ReturnEscapedPath,
     __inout PYORI_LIB_FULL_PATH_TYPE PathType,
     __inout PYORI_STRING Buffer,
-    __inout PBOOLEAN FreeOnFailure
+    __inout_opt PBOOLEAN FreeOnFailure
     )
 {
     YORI_STRING CurrentDirectory;
@@ -722,6 +724,9 @@ YoriLibFullPathMergeRootWithRelative(
     }
 
     if (Result > Buffer->LengthAllocated) {
+        if (FreeOnFailure == NULL) {
+            return ERROR_INSUFFICIENT_BUFFER;
+        }
         YoriLibFreeStringContents(Buffer);
         if (!YoriLibAllocateString(Buffer, Result)) {
             YoriLibFreeStringContents(&CurrentDirectory);
@@ -830,11 +835,13 @@ YoriLibFullPathMergeRootWithRelative(
         This can be reallocated in this function if it is insufficient to
         hold the result; if this occurs, FreeOnFailure is set to TRUE.
 
- @param FreeOnFailure Pointer to a boolean to be set to TRUE if the Buffer
-        was reallocated in this function.  If this occurs, later failure will
-        cause the reallocated buffer to be freed.  This allows a caller to use
-        an initialized but not allocated string and only receive an allocated
-        string on success.
+ @param FreeOnFailure Optionally points to a boolean to be set to TRUE if
+        the Buffer was reallocated in this function.  If this occurs, later
+        failure will cause the reallocated buffer to be freed.  This allows a
+        caller to use an initialized but not allocated string and only
+        receive an allocated string on success.  If NULL, the Buffer is never
+        reallocated, and ERROR_INSUFFICIENT_BUFFER is returned if it is too
+        small.
 
  @return A win32 error code, or ERROR_SUCCESS to indicate successful
          completion.
@@ -845,7 +852,7 @@ YoriLibFullPathNormalize(
     __in BOOL ReturnEscapedPath,
     __inout PYORI_LIB_FULL_PATH_TYPE PathType,
     __inout PYORI_STRING Buffer,
-    __inout PBOOLEAN FreeOnFailure
+    __inout_opt PBOOLEAN FreeOnFailure
     )
 {
     YORI_ALLOC_SIZE_T Result;
@@ -866,6 +873,9 @@ YoriLibFullPathNormalize(
     }
 
     if (Result > Buffer->LengthAllocated) {
+        if (FreeOnFailure == NULL) {
+            return ERROR_INSUFFICIENT_BUFFER;
+        }
         YoriLibFreeStringContents(Buffer);
         if (!YoriLibAllocateString(Buffer, Result)) {
             return ERROR_NOT_ENOUGH_MEMORY;
@@ -1214,22 +1224,103 @@ YoriLibGetFullPathSquashRelativeComponents(
 }
 
 /**
- Private implementation of GetFullPathName.  This function will convert paths
- into their \\?\ (MAX_PATH exceeding) form, applying all of the necessary
- transformations.  This function will update a YORI_STRING, including
- allocating if necessary, to contain a buffer containing the path.  If this
- function allocates the buffer, the caller is expected to free this by calling
- @ref YoriLibFreeStringContents.
+ The number of characters in a buffer on the stack that holds the current
+ directory while a relative path is resolved.  Longer directories are held
+ in an allocation instead.
+ */
+#define YORI_LIB_FULL_PATH_STACK_CHARS (MAX_PATH + 1)
+
+/**
+ Find the directory that a relative path should be resolved against.  This
+ is the current directory, or for a drive relative path on a drive other
+ than the current one, the current directory of that drive.  The directory
+ is returned in a buffer supplied by the caller when it fits, so resolving
+ most relative paths does not need to allocate.
+
+ @param FileName Pointer to the path being resolved.
+
+ @param PathType Pointer to information describing the type of the path.
+
+ @param StackBuffer Pointer to a buffer of YORI_LIB_FULL_PATH_STACK_CHARS
+        characters to hold the directory if it fits.
+
+ @param CurrentDirectory On successful completion, updated to contain the
+        directory.  This may refer to StackBuffer or to an allocation; the
+        caller should free it with @ref YoriLibFreeStringContents in either
+        case.
+
+ @return A win32 error code, or ERROR_SUCCESS to indicate successful
+         completion.
+ */
+__success(return == ERROR_SUCCESS)
+DWORD
+YoriLibFullPathGetRelativeRoot(
+    __in PYORI_STRING FileName,
+    __in PYORI_LIB_FULL_PATH_TYPE PathType,
+    __out_ecount(YORI_LIB_FULL_PATH_STACK_CHARS) LPTSTR StackBuffer,
+    __out PYORI_STRING CurrentDirectory
+    )
+{
+    DWORD Length;
+
+    YoriLibInitEmptyString(CurrentDirectory);
+    CurrentDirectory->StartOfString = StackBuffer;
+    CurrentDirectory->LengthAllocated = YORI_LIB_FULL_PATH_STACK_CHARS;
+
+    Length = GetCurrentDirectory(CurrentDirectory->LengthAllocated, CurrentDirectory->StartOfString);
+    if (Length >= CurrentDirectory->LengthAllocated) {
+        if (!YoriLibAllocateString(CurrentDirectory, (YORI_ALLOC_SIZE_T)Length)) {
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+        Length = GetCurrentDirectory(CurrentDirectory->LengthAllocated, CurrentDirectory->StartOfString);
+        if (Length >= CurrentDirectory->LengthAllocated) {
+            YoriLibFreeStringContents(CurrentDirectory);
+            return ERROR_INSUFFICIENT_BUFFER;
+        }
+    }
+
+    if (Length == 0) {
+        Length = GetLastError();
+        YoriLibFreeStringContents(CurrentDirectory);
+        return Length;
+    }
+
+    CurrentDirectory->LengthInChars = (YORI_ALLOC_SIZE_T)Length;
+
+    //
+    //  If it's drive relative, and it's relative to a different drive,
+    //  get the current directory of the requested drive.  This is less
+    //  common, so it is allowed to allocate.
+    //
+
+    if (PathType->Flags.DriveRelativePath &&
+        YoriLibUpcaseChar(CurrentDirectory->StartOfString[0]) != YoriLibUpcaseChar(FileName->StartOfString[0])) {
+
+        YoriLibFreeStringContents(CurrentDirectory);
+        if (!YoriLibGetCurrentDirectoryOnDrive(FileName->StartOfString[0], CurrentDirectory)) {
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/**
+ Resolve a path to its full form, optionally allowing the buffer to be
+ reallocated.  This is the common implementation of
+ @ref YoriLibGetFullPathNameReturnAllocation and
+ @ref YoriLibGetFullPathNameToBuffer .
 
  @param FileName The file name to resolve to a full path form.
 
  @param ReturnEscapedPath If TRUE, the returned path is in \\?\ form.
         If FALSE, it is in regular Win32 form.
 
- @param Buffer On successful completion, updated to point to a newly
-        allocated buffer containing the full path form of the file name.
-        Note this is returned as a NULL terminated YORI_STRING, suitable
-        for use in YORI_STRING or NULL terminated functions.
+ @param AllowAllocation If TRUE, Buffer can be reallocated if it is too
+        small.  If FALSE, the function fails with ERROR_INSUFFICIENT_BUFFER.
+
+ @param Buffer On successful completion, updated to contain the full path
+        form of the file name.
 
  @param lpFilePart If specified, on successful completion, updated to point
         to the beginning of the file name component of the path, in the same
@@ -1239,9 +1330,10 @@ YoriLibGetFullPathSquashRelativeComponents(
  */
 __success(return)
 BOOL
-YoriLibGetFullPathNameReturnAllocation(
+YoriLibGetFullPathNameInternal(
     __in PYORI_STRING FileName,
     __in BOOL ReturnEscapedPath,
+    __in BOOLEAN AllowAllocation,
     __inout PYORI_STRING Buffer,
     __deref_opt_out_opt LPTSTR* lpFilePart
     )
@@ -1260,11 +1352,17 @@ YoriLibGetFullPathNameReturnAllocation(
 
     YORI_LIB_FULL_PATH_TYPE PathType;
     BOOLEAN FreeOnFailure = FALSE;
+    PBOOLEAN FreeOnFailurePtr;
 
     YORI_STRING StartOfRelativePath;
 
     DWORD Result;
 
+    FreeOnFailurePtr = NULL;
+    if (AllowAllocation) {
+        FreeOnFailurePtr = &FreeOnFailure;
+    }
+
     Result = YoriLibGetFullPathDeterminePathType(FileName,
                                                  &PathType,
                                                  &StartOfRelativePath);
@@ -1284,45 +1382,20 @@ YoriLibGetFullPathNameReturnAllocation(
         PathType.Flags.AbsoluteWithoutDrive) {
 
         YORI_STRING CurrentDirectory;
-        YORI_ALLOC_SIZE_T CurrentDirectoryLength;
+        TCHAR CurrentDirectoryBuffer[YORI_LIB_FULL_PATH_STACK_CHARS];
 
-        CurrentDirectoryLength = (YORI_ALLOC_SIZE_T)GetCurrentDirectory(0, NULL);
-        if (!YoriLibAllocateString(&CurrentDirectory, CurrentDirectoryLength)) {
-            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
-            return FALSE;
-        }
-
-        Result = GetCurrentDirectory(CurrentDirectory.LengthAllocated, CurrentDirectory.StartOfString);
-        if (Result == 0 || Result >= CurrentDirectory.LengthAllocated) {
-            YoriLibFreeStringContents(&CurrentDirectory);
+        Result = YoriLibFullPathGetRelativeRoot(FileName, &PathType, CurrentDirectoryBuffer, &CurrentDirectory);
+        if (Result != ERROR_SUCCESS) {
+            SetLastError(Result);
             return FALSE;
         }
 
-        CurrentDirectory.LengthInChars = (YORI_ALLOC_SIZE_T)Result;
-
-        //
-        //  If it's drive relative, and it's relative to a different drive,
-        //  get the current directory of the requested drive.
-        //
-
-        if (PathType.Flags.DriveRelativePath) {
-            if (CurrentDirectory.LengthInChars == 0 ||
-                YoriLibUpcaseChar(CurrentDirectory.StartOfString[0]) != YoriLibUpcaseChar(FileName->StartOfString[0])) {
-
-                YoriLibFreeStringContents(&CurrentDirectory);
-                if (!YoriLibGetCurrentDirectoryOnDrive(FileName->StartOfString[0], &CurrentDirectory)) {
-                    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
-                    return FALSE;
-                }
-            }
-        }
-
         Result = YoriLibFullPathMergeRootWithRelative(&CurrentDirectory,
                                                       &StartOfRelativePath,
                                                       ReturnEscapedPath,
                                                       &PathType,
                                                       Buffer,
-                                                      &FreeOnFailure);
+                                                      FreeOnFailurePtr);
         YoriLibFreeStringContents(&CurrentDirectory);
 
     } else {
@@ -1331,7 +1404,7 @@ YoriLibGetFullPathNameReturnAllocation(
                                           ReturnEscapedPath,
                                           &PathType,
                                           Buffer,
-                                          &FreeOnFailure);
+                                          FreeOnFailurePtr);
 
     }
 
@@ -1356,6 +1429,76 @@ YoriLibGetFullPathNameReturnAllocation(
     return TRUE;
 }
 
+/**
+ Private implementation of GetFullPathName.  This function will convert paths
+ into their \\?\ (MAX_PATH exceeding) form, applying all of the necessary
+ transformations.  This function will update a YORI_STRING, including
+ allocating if necessary, to contain a buffer containing the path.  If this
+ function allocates the buffer, the caller is expected to free this by calling
+ @ref YoriLibFreeStringContents.
+
+ @param FileName The file name to resolve to a full path form.
+
+ @param ReturnEscapedPath If TRUE, the returned path is in \\?\ form.
+        If FALSE, it is in regular Win32 form.
+
+ @param Buffer On successful completion, updated to point to a newly
+        allocated buffer containing the full path form of the file name.
+        Note this is returned as a NULL terminated YORI_STRING, suitable
+        for use in YORI_STRING or NULL terminated functions.
+
+ @param lpFilePart If specified, on successful completion, updated to point
+        to the beginning of the file name component of the path, in the same
+        allocation as lpBuffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibGetFullPathNameReturnAllocation(
+    __in PYORI_STRING FileName,
+    __in BOOL ReturnEscapedPath,
+    __inout PYORI_STRING Buffer,
+    __deref_opt_out_opt LPTSTR* lpFilePart
+    )
+{
+    return YoriLibGetFullPathNameInternal(FileName, ReturnEscapedPath, TRUE, Buffer, lpFilePart);
+}
+
+/**
+ Resolve a path to its full form into a buffer supplied by the caller.  This
+ behaves like @ref YoriLibGetFullPathNameReturnAllocation except that the
+ buffer is never reallocated, so a caller resolving many paths can use a
+ single buffer, including one on the stack.  If the buffer is too small, the
+ function fails with ERROR_INSUFFICIENT_BUFFER and the caller can fall back
+ to @ref YoriLibGetFullPathNameReturnAllocation .
+
+ @param FileName The file name to resolve to a full path form.
+
+ @param ReturnEscapedPath If TRUE, the returned path is in \\?\ form.
+        If FALSE, it is in regular Win32 form.
+
+ @param Buffer Pointer to a string whose buffer is populated with the NULL
+        terminated full path form of the file name.
+
+ @param lpFilePart If specified, on successful completion, updated to point
+        to the beginning of the file name component of the path, within
+        Buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibGetFullPathNameToBuffer(
+    __in PYORI_STRING FileName,
+    __in BOOL ReturnEscapedPath,
+    __inout PYORI_STRING Buffer,
+    __deref_opt_out_opt LPTSTR* lpFilePart
+    )
+{
+    return YoriLibGetFullPathNameInternal(FileName, ReturnEscapedPath, FALSE, Buffer, lpFilePart);
+}
+
 /**
  GetFullPathName where the "current" directory is specified.  Note that this
  version cannot traverse across drives without looking at the current
@@ -2107,6 +2250,278 @@ YoriLibUnescapePath(
     return TRUE;
 }
 
+/**
+ The number of characters that can be held in each string of the volume
+ cache.  Paths or volume names longer than this are not cached.
+ */
+#define YORI_LIB_VOLUME_CACHE_CHARS (MAX_PATH)
+
+/**
+ A cache of the most recent volume lookup.  Resolving a path to its volume
+ requires the system to inspect each component of the path, and querying
+ the volume requires opening it, which for UNC paths are network round
+ trips.  Tools tend to ask about the same path or volume repeatedly, so the
+ most recent answer is retained for the life of the process.
+ */
+typedef struct _YORI_LIB_VOLUME_CACHE {
+
+    /**
+     The number of characters in Path.  Zero if no path is cached.
+     */
+    YORI_ALLOC_SIZE_T PathLength;
+
+    /**
+     The number of characters in VolumeName.  Zero if no volume is cached.
+     */
+    YORI_ALLOC_SIZE_T VolumeNameLength;
+
+    /**
+     TRUE if MaxComponentLength and FileSystemFlags have been queried for
+     VolumeName.
+     */
+    BOOLEAN CapabilitiesValid;
+
+    /**
+     The maximum length of a file name component on the volume.
+     */
+    DWORD MaxComponentLength;
+
+    /**
+     The file system flags of the volume.
+     */
+    DWORD FileSystemFlags;
+
+    /**
+     The most recent full path that was resolved to a volume.
+     */
+    TCHAR Path[YORI_LIB_VOLUME_CACHE_CHARS];
+
+    /**
+     The volume name that Path resolved to, without a trailing separator.
+     */
+    TCHAR VolumeName[YORI_LIB_VOLUME_CACHE_CHARS];
+} YORI_LIB_VOLUME_CACHE, *PYORI_LIB_VOLUME_CACHE;
+
+/**
+ The volume cache for the process.
+ */
+YORI_LIB_VOLUME_CACHE YoriLibVolumeCache;
+
+/**
+ Nonzero if a thread is currently using the volume cache.  Threads that find
+ the cache in use bypass it rather than waiting.
+ */
+LONG YoriLibVolumeCacheInUse;
+
+/**
+ Attempt to take exclusive use of the volume cache.
+
+ @return TRUE if the cache is now owned by the caller, who must call
+         @ref YoriLibReleaseVolumeCache , or FALSE if another thread is using
+         the cache.
+ */
+BOOLEAN
+YoriLibAcquireVolumeCache(VOID)
+{
+    if (InterlockedExchange((INTERLOCKED_VOLATILE LONG *)&YoriLibVolumeCacheInUse, 1) == 0) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Release exclusive use of the volume cache.
+ */
+VOID
+YoriLibReleaseVolumeCache(VOID)
+{
+    InterlockedExchange((INTERLOCKED_VOLATILE LONG *)&YoriLibVolumeCacheInUse, 0);
+}
+
+/**
+ Look up the volume that a full path was previously resolved to.
+
+ @param FileName Pointer to the full path.
+
+ @param VolumeName Pointer to a string to populate with the volume name if
+        it is in the cache.  This is only populated if it is large enough
+        to hold the result.
+
+ @return TRUE if the volume name was found and returned, FALSE if it was
+         not.
+ */
+BOOLEAN
+YoriLibVolumeCacheLookupPath(
+    __in PCYORI_STRING FileName,
+    __inout PYORI_STRING VolumeName
+    )
+{
+    YORI_STRING CachedPath;
+    BOOLEAN Found;
+
+    if (!YoriLibAcquireVolumeCache()) {
+        return FALSE;
+    }
+
+    Found = FALSE;
+    YoriLibInitEmptyString(&CachedPath);
+    CachedPath.StartOfString = YoriLibVolumeCache.Path;
+    CachedPath.LengthInChars = YoriLibVolumeCache.PathLength;
+
+    if (YoriLibVolumeCache.PathLength > 0 &&
+        YoriLibVolumeCache.VolumeNameLength < VolumeName->LengthAllocated &&
+        YoriLibCompareStringInsensitive(&CachedPath, FileName) == 0) {
+
+        memcpy(VolumeName->StartOfString, YoriLibVolumeCache.VolumeName, YoriLibVolumeCache.VolumeNameLength * sizeof(TCHAR));
+        VolumeName->LengthInChars = YoriLibVolumeCache.VolumeNameLength;
+        VolumeName->StartOfString[VolumeName->LengthInChars] = '\0';
+        Found = TRUE;
+    }
+
+    YoriLibReleaseVolumeCache();
+    return Found;
+}
+
+/**
+ Record the volume that a full path resolved to.  If the volume differs from
+ the one previously cached, any cached volume capabilities are discarded.
+
+ @param FileName Pointer to the full path.
+
+ @param VolumeName Pointer to the volume name, without a trailing separator.
+ */
+VOID
+YoriLibVolumeCacheUpdatePath(
+    __in PCYORI_STRING FileName,
+    __in PCYORI_STRING VolumeName
+    )
+{
+    YORI_STRING CachedVolumeName;
+
+    if (FileName->LengthInChars >= YORI_LIB_VOLUME_CACHE_CHARS ||
+        VolumeName->LengthInChars >= YORI_LIB_VOLUME_CACHE_CHARS ||
+        VolumeName->LengthInChars == 0) {
+
+        return;
+    }
+
+    if (!YoriLibAcquireVolumeCache()) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&CachedVolumeName);
+    CachedVolumeName.StartOfString = YoriLibVolumeCache.VolumeName;
+    CachedVolumeName.LengthInChars = YoriLibVolumeCache.VolumeNameLength;
+
+    if (YoriLibCompareStringInsensitive(&CachedVolumeName, VolumeName) != 0) {
+        memcpy(YoriLibVolumeCache.VolumeName, VolumeName->StartOfString, VolumeName->LengthInChars * sizeof(TCHAR));
+        YoriLibVolumeCache.VolumeNameLength = VolumeName->LengthInChars;
+        YoriLibVolumeCache.CapabilitiesValid = FALSE;
+    }
+
+    memcpy(YoriLibVolumeCache.Path, FileName->StartOfString, FileName->LengthInChars * sizeof(TCHAR));
+    YoriLibVolumeCache.PathLength = FileName->LengthInChars;
+
+    YoriLibReleaseVolumeCache();
+}
+
+/**
+ Query the maximum component length and file system flags of a volume,
+ using the cached result if the volume has been queried before.
+
+ @param VolumeName Pointer to the volume name, as returned by
+        @ref YoriLibGetVolumePathName .  This must be NULL terminated and
+        have space for a trailing separator to be added.
+
+ @param MaxComponentLength On successful completion, updated to contain the
+        maximum length of a file name component on the volume.
+
+ @param FileSystemFlags On successful completion, updated to contain the file
+        system flags of the volume.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibGetVolumeCapabilities(
+    __inout PYORI_STRING VolumeName,
+    __out PDWORD MaxComponentLength,
+    __out PDWORD FileSystemFlags
+    )
+{
+    YORI_STRING CachedVolumeName;
+    YORI_ALLOC_SIZE_T VolumeNameLength;
+    DWORD ShortSerialNumber;
+    BOOL Result;
+
+    VolumeNameLength = VolumeName->LengthInChars;
+
+    if (YoriLibAcquireVolumeCache()) {
+        YoriLibInitEmptyString(&CachedVolumeName);
+        CachedVolumeName.StartOfString = YoriLibVolumeCache.VolumeName;
+        CachedVolumeName.LengthInChars = YoriLibVolumeCache.VolumeNameLength;
+        if (YoriLibVolumeCache.CapabilitiesValid &&
+            YoriLibCompareStringInsensitive(&CachedVolumeName, VolumeName) == 0) {
+
+            *MaxComponentLength = YoriLibVolumeCache.MaxComponentLength;
+            *FileSystemFlags = YoriLibVolumeCache.FileSystemFlags;
+            YoriLibReleaseVolumeCache();
+            return TRUE;
+        }
+        YoriLibReleaseVolumeCache();
+    }
+
+    //
+    //  GetVolumeInformation wants a name with a trailing backslash.  Add one
+    //  if needed.
+    //
+
+    if (VolumeName->LengthInChars > 0 &&
+        VolumeName->LengthInChars + 1 < VolumeName->LengthAllocated &&
+        VolumeName->StartOfString[VolumeName->LengthInChars - 1] != '\\') {
+
+        VolumeName->StartOfString[VolumeName->LengthInChars] = '\\';
+        VolumeName->StartOfString[VolumeName->LengthInChars + 1] = '\0';
+        VolumeName->LengthInChars++;
+    }
+
+    Result = GetVolumeInformation(VolumeName->StartOfString,
+                                  NULL,
+                                  0,
+                                  &ShortSerialNumber,
+                                  MaxComponentLength,
+                                  FileSystemFlags,
+                                  NULL,
+                                  0);
+
+    VolumeName->LengthInChars = VolumeNameLength;
+    VolumeName->StartOfString[VolumeName->LengthInChars] = '\0';
+
+    if (!Result) {
+        return FALSE;
+    }
+
+    if (VolumeNameLength > 0 &&
+        VolumeNameLength < YORI_LIB_VOLUME_CACHE_CHARS &&
+        YoriLibAcquireVolumeCache()) {
+
+        YoriLibInitEmptyString(&CachedVolumeName);
+        CachedVolumeName.StartOfString = YoriLibVolumeCache.VolumeName;
+        CachedVolumeName.LengthInChars = YoriLibVolumeCache.VolumeNameLength;
+        if (YoriLibCompareStringInsensitive(&CachedVolumeName, VolumeName) != 0) {
+            memcpy(YoriLibVolumeCache.VolumeName, VolumeName->StartOfString, VolumeNameLength * sizeof(TCHAR));
+            YoriLibVolumeCache.VolumeNameLength = VolumeNameLength;
+            YoriLibVolumeCache.PathLength = 0;
+        }
+        YoriLibVolumeCache.MaxComponentLength = *MaxComponentLength;
+        YoriLibVolumeCache.FileSystemFlags = *FileSystemFlags;
+        YoriLibVolumeCache.CapabilitiesValid = TRUE;
+        YoriLibReleaseVolumeCache();
+    }
+
+    return TRUE;
+}
+
 /**
  Return the volume name of the volume that is hosting a particular file.  This
  is normally done via the Win32 GetVolumePathName API, which was added in
@@ -2163,6 +2578,10 @@ YoriLibGetVolumePathName(
     //
 
     if (DllKernel32.pGetVolumePathNameW != NULL) {
+        if (YoriLibVolumeCacheLookupPath(FileName, VolumeName)) {
+            return TRUE;
+        }
+
         if (!DllKernel32.pGetVolumePathNameW(FileName->StartOfString, VolumeName->StartOfString, VolumeName->LengthAllocated)) {
             if (FreeOnFailure) {
                 YoriLibFreeStringContents(VolumeName);
@@ -2216,6 +2635,8 @@ YoriLibGetVolumePathName(
             VolumeName->LengthInChars--;
             VolumeName->StartOfString[VolumeName->LengthInChars] = '\0';
         }
+
+        YoriLibVolumeCacheUpdatePath(FileName, VolumeName);
         return TRUE;
     }
 
@@ -2290,29 +2711,16 @@ YoriLibPathSupportsLongNames(
     __out PBOOLEAN LongNameSupport
     )
 {
-    YORI_STRING VolumeLabel;
-    YORI_STRING FsName;
     YORI_STRING FullPathName;
     YORI_STRING VolRootName;
-    DWORD ShortSerialNumber;
     DWORD Capabilities;
     DWORD MaxComponentLength;
     BOOLEAN Result;
 
-    YoriLibInitEmptyString(&VolumeLabel);
-    YoriLibInitEmptyString(&FsName);
     YoriLibInitEmptyString(&FullPathName);
     YoriLibInitEmptyString(&VolRootName);
     Result = FALSE;
 
-    if (!YoriLibAllocateString(&VolumeLabel, 256)) {
-        goto Exit;
-    }
-
-    if (!YoriLibAllocateString(&FsName, 256)) {
-        goto Exit;
-    }
-
     if (!YoriLibUserStringToSingleFilePath(PathName, TRUE, &FullPathName)) {
         goto Exit;
     }
@@ -2333,28 +2741,7 @@ YoriLibPathSupportsLongNames(
         goto Exit;
     }
 
-    //
-    //  GetVolumeInformation wants a name with a trailing backslash.  Add one
-    //  if needed.
-    //
-
-    if (VolRootName.LengthInChars > 0 &&
-        VolRootName.LengthInChars + 1 < VolRootName.LengthAllocated &&
-        VolRootName.StartOfString[VolRootName.LengthInChars - 1] != '\\') {
-
-        VolRootName.StartOfString[VolRootName.LengthInChars] = '\\';
-        VolRootName.StartOfString[VolRootName.LengthInChars + 1] = '\0';
-        VolRootName.LengthInChars++;
-    }
-
-    if (GetVolumeInformation(VolRootName.StartOfString,
-                             VolumeLabel.StartOfString,
-                             VolumeLabel.LengthAllocated,
-                             &ShortSerialNumber,
-                             &MaxComponentLength,
-                             &Capabilities,
-                             FsName.StartOfString,
-                             FsName.LengthAllocated)) {
+    if (YoriLibGetVolumeCapabilities(&VolRootName, &MaxComponentLength, &Capabilities)) {
 
         Result = TRUE;
         if (MaxComponentLength >= 255) {
@@ -2367,8 +2754,6 @@ YoriLibPathSupportsLongNames(
 Exit:
     YoriLibFreeStringContents(&FullPathName);
     YoriLibFreeStringContents(&VolRootName);
-    YoriLibFreeStringContents(&FsName);
-    YoriLibFreeStringContents(&VolumeLabel);
 
     return Result;
 }
@@ -29,85 +29,218 @@
 
 
 /**
- Query whether the current process is running as part of the specified group.
+ The largest size of a SID, in bytes.  This is a revision, count, and
+ identifier authority, followed by up to 15 subauthorities.
+ */
+#define YORI_LIB_GROUP_MAX_SID_SIZE (8 + 15 * sizeof(DWORD))
 
- @param GroupName The group name to check whether the process is running with
-        the group in its token.
+/**
+ Storage for a single SID.
+ */
+typedef union _YORI_LIB_GROUP_SID {
 
- @param IsMember On successful completion, set to TRUE to indicate the process
-        is running in the context of the specified group, FALSE if not.
+    /**
+     The SID.
+     */
+    SID Sid;
 
- @return TRUE to indicate success, FALSE to indicate failure.
+    /**
+     Storage large enough for any SID.
+     */
+    UCHAR Storage[YORI_LIB_GROUP_MAX_SID_SIZE];
+} YORI_LIB_GROUP_SID, *PYORI_LIB_GROUP_SID;
+
+/**
+ Information about a single group whose SID has been resolved.  The group
+ name, if any, follows this structure in the same allocation.
  */
-__success(return)
-BOOL
-YoriLibIsCurrentUserInGroup(
-    __in PYORI_STRING GroupName,
-    __out PBOOL IsMember
-    )
-{
-    union {
-        SID Sid;
-        UCHAR Storage[512];
-    } Sid;
-    TCHAR Domain[256];
-    DWORD SidSize;
-    DWORD DomainNameSize;
-    SID_NAME_USE Use;
+typedef struct _YORI_LIB_GROUP_CACHE_ENTRY {
 
-    ASSERT(YoriLibIsStringNullTerminated(GroupName));
+    /**
+     The entry within the list of cached groups.
+     */
+    YORI_LIST_ENTRY ListEntry;
 
-    YoriLibLoadAdvApi32Functions();
+    /**
+     The name of the group.  This is empty for a well known group.
+     */
+    YORI_STRING GroupName;
 
-    if (DllAdvApi32.pLookupAccountNameW == NULL ||
-        DllAdvApi32.pCheckTokenMembership == NULL) {
+    /**
+     The well known group identifier.  This is zero for a named group.
+     */
+    DWORD GroupId;
 
-        return FALSE;
+    /**
+     TRUE if IsMember is valid.  This is cleared by
+     @ref YoriLibFlushGroupCache , which retains the SID.
+     */
+    BOOLEAN MembershipKnown;
+
+    /**
+     TRUE if the process token contains the group.
+     */
+    BOOL IsMember;
+
+    /**
+     The SID of the group.
+     */
+    YORI_LIB_GROUP_SID Sid;
+} YORI_LIB_GROUP_CACHE_ENTRY, *PYORI_LIB_GROUP_CACHE_ENTRY;
+
+/**
+ Process global state for the group cache.
+ */
+typedef struct _YORI_LIB_GROUP_CACHE {
+
+    /**
+     A mutex synchronizing access to the cache.  If NULL, the cache has not
+     been enabled.
+     */
+    HANDLE Mutex;
+
+    /**
+     The list of cached groups.
+     */
+    YORI_LIST_ENTRY Groups;
+} YORI_LIB_GROUP_CACHE, *PYORI_LIB_GROUP_CACHE;
+
+/**
+ Process global state for the group cache.
+ */
+YORI_LIB_GROUP_CACHE YoriLibGroupCache;
+
+/**
+ Enable caching of group SIDs and group membership.  Once enabled, the SID
+ for each group is resolved once, which avoids repeated name lookups that
+ may need to contact a domain controller, and the result of checking the
+ process token for the group is retained until @ref YoriLibFlushGroupCache
+ is called.  This is intended for long running processes which check group
+ membership repeatedly, and should be called before any other threads
+ query group membership.  The caller should call
+ @ref YoriLibCleanupGroupCache before exiting.
+
+ @return TRUE to indicate the cache was enabled, FALSE if it was not.
+ */
+BOOL
+YoriLibEnableGroupCache(VOID)
+{
+    if (YoriLibGroupCache.Mutex != NULL) {
+        return TRUE;
     }
 
-    SidSize = sizeof(Sid);
-    DomainNameSize = sizeof(Domain);
+    YoriLibInitializeListHead(&YoriLibGroupCache.Groups);
 
-    if (!DllAdvApi32.pLookupAccountNameW(NULL, GroupName->StartOfString, &Sid, &SidSize, Domain, &DomainNameSize, &Use)) {
+    YoriLibGroupCache.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriLibGroupCache.Mutex == NULL) {
         return FALSE;
     }
 
-    if (Use != SidTypeGroup && Use != SidTypeWellKnownGroup && Use != SidTypeAlias) {
-        return FALSE;
+    return TRUE;
+}
+
+/**
+ Discard cached group membership, so that the next query checks the process
+ token again.  Resolved SIDs are retained, since they do not depend on the
+ token.  This should be called if the groups enabled in the token may have
+ changed.
+ */
+VOID
+YoriLibFlushGroupCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_GROUP_CACHE_ENTRY Entry;
+
+    if (YoriLibGroupCache.Mutex == NULL) {
+        return;
     }
 
-    if (!DllAdvApi32.pCheckTokenMembership(NULL, &Sid.Sid, IsMember)) {
-        return FALSE;
+    WaitForSingleObject(YoriLibGroupCache.Mutex, INFINITE);
+    ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORI_LIB_GROUP_CACHE_ENTRY, ListEntry);
+        Entry->MembershipKnown = FALSE;
+        ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, ListEntry);
     }
+    ReleaseMutex(YoriLibGroupCache.Mutex);
+}
 
-    return TRUE;
+/**
+ Free all state associated with the group cache.
+ */
+VOID
+YoriLibCleanupGroupCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_GROUP_CACHE_ENTRY Entry;
+
+    if (YoriLibGroupCache.Mutex == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORI_LIB_GROUP_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, ListEntry);
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibFree(Entry);
+    }
+
+    CloseHandle(YoriLibGroupCache.Mutex);
+    YoriLibGroupCache.Mutex = NULL;
 }
 
 /**
- Query whether the current process is running as part of the specified group.
+ Resolve the SID of a group.
 
- @param GroupId The well known group identifier to check whether the process
-        is running with the group in its token.
+ @param GroupName If specified, the name of the group to resolve.  This must
+        be NULL terminated.
 
- @param IsMember On successful completion, set to TRUE to indicate the process
-        is running in the context of the specified group, FALSE if not.
+ @param GroupId If GroupName is not specified, the well known group
+        identifier to resolve.
+
+ @param GroupSid On successful completion, populated with the SID of the
+        group.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriLibIsCurrentUserInWellKnownGroup(
+YoriLibResolveGroupSid(
+    __in_opt PYORI_STRING GroupName,
     __in DWORD GroupId,
-    __out PBOOL IsMember
+    __out PYORI_LIB_GROUP_SID GroupSid
     )
 {
+    TCHAR Domain[256];
+    DWORD SidSize;
+    DWORD DomainNameSize;
+    SID_NAME_USE Use;
     PSID Sid;
     SID_IDENTIFIER_AUTHORITY NtAuthority = SECURITY_NT_AUTHORITY;
 
-    YoriLibLoadAdvApi32Functions();
+    if (GroupName != NULL) {
+        ASSERT(YoriLibIsStringNullTerminated(GroupName));
+
+        if (DllAdvApi32.pLookupAccountNameW == NULL) {
+            return FALSE;
+        }
+
+        SidSize = sizeof(YORI_LIB_GROUP_SID);
+        DomainNameSize = sizeof(Domain)/sizeof(Domain[0]);
+
+        if (!DllAdvApi32.pLookupAccountNameW(NULL, GroupName->StartOfString, &GroupSid->Sid, &SidSize, Domain, &DomainNameSize, &Use)) {
+            return FALSE;
+        }
+
+        if (Use != SidTypeGroup && Use != SidTypeWellKnownGroup && Use != SidTypeAlias) {
+            return FALSE;
+        }
+
+        return TRUE;
+    }
 
     if (DllAdvApi32.pAllocateAndInitializeSid == NULL ||
-        DllAdvApi32.pCheckTokenMembership == NULL ||
         DllAdvApi32.pFreeSid == NULL) {
 
         return FALSE;
@@ -128,13 +261,258 @@ YoriLibIsCurrentUserInWellKnownGroup(
         return FALSE;
     }
 
-    if (!DllAdvApi32.pCheckTokenMembership(NULL, Sid, IsMember)) {
-        DllAdvApi32.pFreeSid(Sid);
+    SidSize = FIELD_OFFSET(SID, SubAuthority) + ((SID *)Sid)->SubAuthorityCount * sizeof(DWORD);
+    ASSERT(SidSize <= sizeof(YORI_LIB_GROUP_SID));
+    memcpy(GroupSid->Storage, Sid, SidSize);
+    DllAdvApi32.pFreeSid(Sid);
+
+    return TRUE;
+}
+
+/**
+ Find a group in the group cache, resolving its SID and adding it to the
+ cache if it is not already present.  The caller must hold the cache mutex.
+
+ @param GroupName If specified, the name of the group to find.  This must be
+        NULL terminated.
+
+ @param GroupId If GroupName is not specified, the well known group
+        identifier to find.
+
+ @return Pointer to the cache entry, or NULL if the group could not be
+         resolved or the entry could not be allocated.
+ */
+PYORI_LIB_GROUP_CACHE_ENTRY
+YoriLibGetGroupCacheEntry(
+    __in_opt PYORI_STRING GroupName,
+    __in DWORD GroupId
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_GROUP_CACHE_ENTRY Entry;
+    YORI_ALLOC_SIZE_T NameLength;
+
+    ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORI_LIB_GROUP_CACHE_ENTRY, ListEntry);
+        if (GroupName != NULL) {
+            if (Entry->GroupName.LengthInChars > 0 &&
+                YoriLibCompareStringInsensitive(&Entry->GroupName, GroupName) == 0) {
+
+                return Entry;
+            }
+        } else if (Entry->GroupName.LengthInChars == 0 &&
+                   Entry->GroupId == GroupId) {
+
+            return Entry;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriLibGroupCache.Groups, ListEntry);
+    }
+
+    NameLength = 0;
+    if (GroupName != NULL) {
+        NameLength = GroupName->LengthInChars + 1;
+    }
+
+    Entry = YoriLibMalloc(sizeof(YORI_LIB_GROUP_CACHE_ENTRY) + NameLength * sizeof(TCHAR));
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    YoriLibInitEmptyString(&Entry->GroupName);
+    if (GroupName != NULL) {
+        Entry->GroupName.StartOfString = (LPTSTR)(Entry + 1);
+        memcpy(Entry->GroupName.StartOfString, GroupName->StartOfString, GroupName->LengthInChars * sizeof(TCHAR));
+        Entry->GroupName.StartOfString[GroupName->LengthInChars] = '\0';
+        Entry->GroupName.LengthInChars = GroupName->LengthInChars;
+        Entry->GroupId = 0;
+    } else {
+        Entry->GroupId = GroupId;
+    }
+    Entry->MembershipKnown = FALSE;
+    Entry->IsMember = FALSE;
+
+    if (!YoriLibResolveGroupSid((GroupName != NULL)?&Entry->GroupName:NULL, GroupId, &Entry->Sid)) {
+        YoriLibFree(Entry);
+        return NULL;
+    }
+
+    YoriLibAppendList(&YoriLibGroupCache.Groups, &Entry->ListEntry);
+    return Entry;
+}
+
+/**
+ Query whether a token contains the specified group, consulting the group
+ cache if it is enabled.
+
+ @param TokenHandle Optionally points to an impersonation token to check.  If
+        NULL, the token of the current thread or process is used.
+
+ @param GroupName If specified, the name of the group to check.  This must be
+        NULL terminated.
+
+ @param GroupId If GroupName is not specified, the well known group
+        identifier to check.
+
+ @param IsMember On successful completion, set to TRUE to indicate the token
+        contains the group, FALSE if not.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibCheckGroupMembership(
+    __in_opt HANDLE TokenHandle,
+    __in_opt PYORI_STRING GroupName,
+    __in DWORD GroupId,
+    __out PBOOL IsMember
+    )
+{
+    YORI_LIB_GROUP_SID Sid;
+    PYORI_LIB_GROUP_CACHE_ENTRY Entry;
+    BOOL Result;
+
+    YoriLibLoadAdvApi32Functions();
+
+    if (DllAdvApi32.pCheckTokenMembership == NULL) {
         return FALSE;
     }
 
-    DllAdvApi32.pFreeSid(Sid);
-    return TRUE;
+    if (YoriLibGroupCache.Mutex == NULL) {
+        if (!YoriLibResolveGroupSid(GroupName, GroupId, &Sid)) {
+            return FALSE;
+        }
+
+        return DllAdvApi32.pCheckTokenMembership(TokenHandle, &Sid.Sid, IsMember);
+    }
+
+    Result = FALSE;
+    WaitForSingleObject(YoriLibGroupCache.Mutex, INFINITE);
+    Entry = YoriLibGetGroupCacheEntry(GroupName, GroupId);
+    if (Entry != NULL) {
+        if (!Entry->MembershipKnown) {
+            if (DllAdvApi32.pCheckTokenMembership(TokenHandle, &Entry->Sid.Sid, &Entry->IsMember)) {
+                Entry->MembershipKnown = TRUE;
+            }
+        }
+
+        if (Entry->MembershipKnown) {
+            *IsMember = Entry->IsMember;
+            Result = TRUE;
+        }
+    }
+    ReleaseMutex(YoriLibGroupCache.Mutex);
+
+    return Result;
+}
+
+/**
+ Query whether the current process is running as part of the specified group.
+
+ @param GroupName The group name to check whether the process is running with
+        the group in its token.
+
+ @param IsMember On successful completion, set to TRUE to indicate the process
+        is running in the context of the specified group, FALSE if not.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIsCurrentUserInGroup(
+    __in PYORI_STRING GroupName,
+    __out PBOOL IsMember
+    )
+{
+    return YoriLibCheckGroupMembership(NULL, GroupName, 0, IsMember);
+}
+
+/**
+ Query whether the current process is running as part of each of a set of
+ groups.  When more than one group needs to be checked against the token,
+ an impersonation token is created once and used for every check, rather
+ than each check duplicating the process token.
+
+ @param GroupNames An array of group names to check.  Each must be NULL
+        terminated.
+
+ @param Count The number of elements in the GroupNames and IsMember arrays.
+
+ @param IsMember On successful completion, each element is set to TRUE to
+        indicate the process is running in the context of the corresponding
+        group, FALSE if not.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  Failure to
+         resolve any group is treated as failure.
+ */
+__success(return)
+BOOL
+YoriLibIsCurrentUserInGroups(
+    __in_ecount(Count) PYORI_STRING GroupNames,
+    __in YORI_ALLOC_SIZE_T Count,
+    __out_ecount(Count) PBOOL IsMember
+    )
+{
+    HANDLE TokenHandle;
+    YORI_ALLOC_SIZE_T Index;
+    BOOL Result;
+
+    YoriLibLoadAdvApi32Functions();
+
+    //
+    //  Obtain an impersonation token for the process, then revert
+    //  immediately so the thread is not left impersonating while names are
+    //  resolved.  If this fails, each check obtains its own token.
+    //
+
+    TokenHandle = NULL;
+    if (Count > 1 &&
+        DllAdvApi32.pImpersonateSelf != NULL &&
+        DllAdvApi32.pOpenThreadToken != NULL &&
+        DllAdvApi32.pRevertToSelf != NULL) {
+
+        if (DllAdvApi32.pImpersonateSelf(SecurityIdentification)) {
+            if (!DllAdvApi32.pOpenThreadToken(GetCurrentThread(), TOKEN_QUERY | TOKEN_DUPLICATE, TRUE, &TokenHandle)) {
+                TokenHandle = NULL;
+            }
+            DllAdvApi32.pRevertToSelf();
+        }
+    }
+
+    Result = TRUE;
+    for (Index = 0; Index < Count; Index++) {
+        if (!YoriLibCheckGroupMembership(TokenHandle, &GroupNames[Index], 0, &IsMember[Index])) {
+            Result = FALSE;
+            break;
+        }
+    }
+
+    if (TokenHandle != NULL) {
+        CloseHandle(TokenHandle);
+    }
+
+    return Result;
+}
+
+/**
+ Query whether the current process is running as part of the specified group.
+
+ @param GroupId The well known group identifier to check whether the process
+        is running with the group in its token.
+
+ @param IsMember On successful completion, set to TRUE to indicate the process
+        is running in the context of the specified group, FALSE if not.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIsCurrentUserInWellKnownGroup(
+    __in DWORD GroupId,
+    __out PBOOL IsMember
+    )
+{
+    return YoriLibCheckGroupMembership(NULL, NULL, GroupId, IsMember);
 }
 
 // vim:sw=4:ts=4:et:
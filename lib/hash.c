@@ -124,29 +124,212 @@ YoriLibHashString32(
 }
 
 /**
- Hash a yori string into a 16 bit hash value.
+ Construct a 64 bit constant from two 32 bit halves, since older compilers
+ do not support 64 bit literals.
+ */
+#define YORI_HASH64_CONSTANT(High, Low) ((((DWORDLONG)(High)) << 32) | (DWORDLONG)(Low))
+
+/**
+ The first multiplier used by the 64 bit string hash.
+ */
+#define YORI_HASH64_PRIME1 YORI_HASH64_CONSTANT(0x9E3779B1, 0x85EBCA87)
+
+/**
+ The second multiplier used by the 64 bit string hash.
+ */
+#define YORI_HASH64_PRIME2 YORI_HASH64_CONSTANT(0xC2B2AE3D, 0x27D4EB4F)
+
+/**
+ The third multiplier used by the 64 bit string hash.
+ */
+#define YORI_HASH64_PRIME3 YORI_HASH64_CONSTANT(0x165667B1, 0x9E3779F9)
+
+/**
+ The fourth multiplier used by the 64 bit string hash.
+ */
+#define YORI_HASH64_PRIME4 YORI_HASH64_CONSTANT(0x85EBCA77, 0xC2B2AE63)
+
+/**
+ Rotate a 64 bit value left by a specified number of bits.
+ */
+#define YORI_HASH64_ROTL(Value, Bits) (((Value) << (Bits)) | ((Value) >> (64 - (Bits))))
+
+/**
+ A mask of the bits in four packed characters which are set only if one of
+ the characters is outside of the ASCII range.
+ */
+#define YORI_HASH64_NON_ASCII_MASK YORI_HASH64_CONSTANT(0xFF80FF80, 0xFF80FF80)
+
+/**
+ The high bit of each of four packed characters.
+ */
+#define YORI_HASH64_LANE_HIGH_BITS YORI_HASH64_CONSTANT(0x80008000, 0x80008000)
+
+/**
+ Convert any lowercase characters in four packed ASCII characters to
+ uppercase without examining each character individually.  Adding a bias to
+ each 16 bit lane sets the lane's high bit if the character is at or above
+ a bound; characters at or above 'a' but not above 'z' are lowercase, and
+ subtracting 0x20 from those lanes converts them to uppercase.  This
+ requires that each character is below 0x80, which the caller must check.
+
+ @param Chars Four packed characters.
+
+ @return The four packed characters with lowercase characters converted to
+         uppercase.
+ */
+DWORDLONG
+YoriLibHash64UpcaseAsciiLanes(
+    __in DWORDLONG Chars
+    )
+{
+    DWORDLONG AtLeastA;
+    DWORDLONG AboveZ;
+    DWORDLONG IsLower;
+
+    AtLeastA = Chars + YORI_HASH64_CONSTANT(0x7F9F7F9F, 0x7F9F7F9F);
+    AboveZ = Chars + YORI_HASH64_CONSTANT(0x7F857F85, 0x7F857F85);
+    IsLower = AtLeastA & ~AboveZ & YORI_HASH64_LANE_HIGH_BITS;
+
+    return Chars - (IsLower >> 10);
+}
+
+/**
+ Hash a yori string into a 64 bit hash value.  Characters are consumed four
+ at a time, and each group is mixed into the hash with a multiply and
+ rotate.  The result is avalanched so that all bits depend on all input,
+ so any subset of the bits can be used to select a bucket.
+
+ @param InitialHash The starting value to use for the hash.
+
+ @param String The string to generate a hash for.
+
+ @param Insensitive If TRUE, characters are upcased before hashing so that
+        strings which compare equal insensitively have the same hash.  ASCII
+        characters are upcased four at a time; groups containing other
+        characters are upcased individually.
+
+ @return A 64 bit hash value for the string.
+ */
+DWORDLONG
+YoriLibHashString64Worker(
+    __in DWORDLONG InitialHash,
+    __in PCYORI_STRING String,
+    __in BOOLEAN Insensitive
+    )
+{
+    DWORDLONG Hash;
+    DWORDLONG Chars;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Remaining;
+    LPTSTR Src;
+
+    Hash = InitialHash + YORI_HASH64_PRIME3 + String->LengthInChars;
+    Src = String->StartOfString;
+    Remaining = String->LengthInChars;
+
+    while (Remaining >= 4) {
+        Chars = (DWORDLONG)(WORD)Src[0] |
+                ((DWORDLONG)(WORD)Src[1] << 16) |
+                ((DWORDLONG)(WORD)Src[2] << 32) |
+                ((DWORDLONG)(WORD)Src[3] << 48);
+
+        if (Insensitive) {
+            if ((Chars & YORI_HASH64_NON_ASCII_MASK) == 0) {
+                Chars = YoriLibHash64UpcaseAsciiLanes(Chars);
+            } else {
+                Chars = (DWORDLONG)(WORD)YoriLibUpcaseChar(Src[0]) |
+                        ((DWORDLONG)(WORD)YoriLibUpcaseChar(Src[1]) << 16) |
+                        ((DWORDLONG)(WORD)YoriLibUpcaseChar(Src[2]) << 32) |
+                        ((DWORDLONG)(WORD)YoriLibUpcaseChar(Src[3]) << 48);
+            }
+        }
+
+        Chars = Chars * YORI_HASH64_PRIME2;
+        Chars = YORI_HASH64_ROTL(Chars, 31);
+        Chars = Chars * YORI_HASH64_PRIME1;
+        Hash = Hash ^ Chars;
+        Hash = YORI_HASH64_ROTL(Hash, 27) * YORI_HASH64_PRIME1 + YORI_HASH64_PRIME4;
+
+        Src = Src + 4;
+        Remaining = Remaining - 4;
+    }
+
+    for (Index = 0; Index < Remaining; Index++) {
+        if (Insensitive) {
+            Chars = (WORD)YoriLibUpcaseChar(Src[Index]);
+        } else {
+            Chars = (WORD)Src[Index];
+        }
+        Hash = Hash ^ (Chars * YORI_HASH64_PRIME1);
+        Hash = YORI_HASH64_ROTL(Hash, 11) * YORI_HASH64_PRIME2;
+    }
+
+    Hash = Hash ^ (Hash >> 33);
+    Hash = Hash * YORI_HASH64_PRIME2;
+    Hash = Hash ^ (Hash >> 29);
+    Hash = Hash * YORI_HASH64_PRIME3;
+    Hash = Hash ^ (Hash >> 32);
+
+    return Hash;
+}
+
+/**
+ Hash a yori string into a 64 bit hash value, where strings that differ
+ only by case have different hashes.
+
+ @param InitialHash The starting value to use for the hash.
 
  @param String The string to generate a hash for.
 
- @return A 16 bit hash value for the string.
+ @return A 64 bit hash value for the string.
  */
-WORD
-YoriLibHashString(
+DWORDLONG
+YoriLibHashString64(
+    __in DWORDLONG InitialHash,
     __in PCYORI_STRING String
     )
 {
-    DWORD Hash;
-    Hash = YoriLibHashString32(0, String);
+    return YoriLibHashString64Worker(InitialHash, String, FALSE);
+}
 
-    //
-    //  Move some high bits into the low bits since the low bits
-    //  will likely be used as a bucket index.  Note we're moving
-    //  bits 16 here and 3 above (ie., not divisible and won't
-    //  cancel out.)
-    //
+/**
+ Hash a yori string into a 64 bit hash value, where strings that differ
+ only by case have the same hash.
+
+ @param InitialHash The starting value to use for the hash.
+
+ @param String The string to generate a hash for.
+
+ @return A 64 bit hash value for the string.
+ */
+DWORDLONG
+YoriLibHashStringInsensitive64(
+    __in DWORDLONG InitialHash,
+    __in PCYORI_STRING String
+    )
+{
+    return YoriLibHashString64Worker(InitialHash, String, TRUE);
+}
+
+/**
+ Hash a yori string insensitively for use in a hash table.  This combines
+ both halves of the 64 bit hash so that every bit contributes to bucket
+ selection.
+
+ @param String The string to generate a hash for.
 
-    Hash = Hash ^ (Hash >> 16);
-    return (WORD)Hash;
+ @return A 32 bit hash value for the string.
+ */
+DWORD
+YoriLibHashStringForTable(
+    __in PCYORI_STRING String
+    )
+{
+    DWORDLONG Hash;
+
+    Hash = YoriLibHashStringInsensitive64(0, String);
+    return (DWORD)(Hash >> 32) ^ (DWORD)Hash;
 }
 
 /**
@@ -170,7 +353,7 @@ YoriLibHashInsertByKey(
     __out PYORI_HASH_ENTRY HashEntry
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
+    DWORD BucketIndex = YoriLibHashStringForTable(KeyString) % HashTable->NumberBuckets;
 
     YoriLibCloneString(&HashEntry->Key, KeyString);
     HashEntry->Context = Context;
@@ -193,7 +376,7 @@ YoriLibHashLookupByKey(
     __in PCYORI_STRING KeyString
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
+    DWORD BucketIndex = YoriLibHashStringForTable(KeyString) % HashTable->NumberBuckets;
     PYORI_LIST_ENTRY ListEntry;
     PYORI_HASH_ENTRY HashEntry;
 
@@ -251,4 +434,358 @@ YoriLibHashRemoveByKey(
     return Entry;
 }
 
+/**
+ The base 2 logarithm of the minimum number of slots in a growable hash
+ table.
+ */
+#define YORI_GROWABLE_HASH_MINIMUM_SLOT_BITS (4)
+
+/**
+ The base 2 logarithm of the maximum number of slots in a growable hash
+ table.
+ */
+#define YORI_GROWABLE_HASH_MAXIMUM_SLOT_BITS (24)
+
+/**
+ Determine the slot that an entry with the specified hash would ideally be
+ placed in.  The low bits of the string hash are not well distributed, so
+ this multiplies by a large odd constant and uses the high bits of the
+ result.
+
+ @param HashTable Pointer to the hash table.
+
+ @param Hash The 32 bit hash of the key.
+
+ @return The index of the slot.
+ */
+YORI_ALLOC_SIZE_T
+YoriLibGrowableHashHomeSlot(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in DWORD Hash
+    )
+{
+    return (YORI_ALLOC_SIZE_T)((DWORD)(Hash * 0x9E3779B1) >> (32 - HashTable->SlotBits));
+}
+
+/**
+ Allocate an array of empty slots for a growable hash table.
+
+ @param SlotBits The base 2 logarithm of the number of slots to allocate.
+
+ @return Pointer to the array of slots, or NULL on allocation failure.
+ */
+PYORI_GROWABLE_HASH_SLOT
+YoriLibAllocateGrowableHashSlots(
+    __in DWORD SlotBits
+    )
+{
+    DWORD SizeNeeded;
+    PYORI_GROWABLE_HASH_SLOT Slots;
+
+    if (SlotBits > YORI_GROWABLE_HASH_MAXIMUM_SLOT_BITS) {
+        return NULL;
+    }
+
+    SizeNeeded = ((DWORD)1 << SlotBits) * sizeof(YORI_GROWABLE_HASH_SLOT);
+    if (!YoriLibIsSizeAllocatable(SizeNeeded)) {
+        return NULL;
+    }
+
+    Slots = YoriLibMalloc((YORI_ALLOC_SIZE_T)SizeNeeded);
+    if (Slots == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Slots, SizeNeeded);
+    return Slots;
+}
+
+/**
+ Allocate an empty growable hash table.
+
+ @param InitialEntries The number of entries the caller expects to insert.
+        The table will grow beyond this if needed.
+
+ @return On successful completion, points to the resulting hash table.
+         On allocation failure, returns NULL.
+ */
+PYORI_GROWABLE_HASH_TABLE
+YoriLibAllocateGrowableHashTable(
+    __in YORI_ALLOC_SIZE_T InitialEntries
+    )
+{
+    PYORI_GROWABLE_HASH_TABLE HashTable;
+    DWORD SlotBits;
+
+    //
+    //  Find a table size which can hold the requested number of entries
+    //  without exceeding three quarters full.
+    //
+
+    SlotBits = YORI_GROWABLE_HASH_MINIMUM_SLOT_BITS;
+    while (SlotBits < YORI_GROWABLE_HASH_MAXIMUM_SLOT_BITS &&
+           ((DWORD)1 << SlotBits) / 4 * 3 < InitialEntries) {
+
+        SlotBits++;
+    }
+
+    HashTable = YoriLibMalloc(sizeof(YORI_GROWABLE_HASH_TABLE));
+    if (HashTable == NULL) {
+        return NULL;
+    }
+
+    HashTable->Slots = YoriLibAllocateGrowableHashSlots(SlotBits);
+    if (HashTable->Slots == NULL) {
+        YoriLibFree(HashTable);
+        return NULL;
+    }
+
+    HashTable->SlotBits = SlotBits;
+    HashTable->NumberSlots = (YORI_ALLOC_SIZE_T)((DWORD)1 << SlotBits);
+    HashTable->NumberEntries = 0;
+
+    return HashTable;
+}
+
+/**
+ Free a growable hash table.  This assumes the caller has already removed
+ and performed all necessary cleanup for any objects within it.
+
+ @param HashTable Pointer to the hash table to deallocate.
+ */
+VOID
+YoriLibFreeEmptyGrowableHashTable(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable
+    )
+{
+    ASSERT(HashTable->NumberEntries == 0);
+    YoriLibFree(HashTable->Slots);
+    YoriLibFree(HashTable);
+}
+
+/**
+ Double the number of slots in a growable hash table, moving all existing
+ entries into the new slots.  Because the hash of each entry is recorded,
+ this does not need to look at any keys.
+
+ @param HashTable Pointer to the hash table.
+
+ @return TRUE to indicate the table was grown, FALSE if it could not be.
+ */
+__success(return)
+BOOLEAN
+YoriLibGrowGrowableHashTable(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable
+    )
+{
+    PYORI_GROWABLE_HASH_SLOT OldSlots;
+    PYORI_GROWABLE_HASH_SLOT NewSlots;
+    YORI_ALLOC_SIZE_T OldNumberSlots;
+    YORI_ALLOC_SIZE_T OldIndex;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Mask;
+
+    NewSlots = YoriLibAllocateGrowableHashSlots(HashTable->SlotBits + 1);
+    if (NewSlots == NULL) {
+        return FALSE;
+    }
+
+    OldSlots = HashTable->Slots;
+    OldNumberSlots = HashTable->NumberSlots;
+
+    HashTable->Slots = NewSlots;
+    HashTable->SlotBits = HashTable->SlotBits + 1;
+    HashTable->NumberSlots = (YORI_ALLOC_SIZE_T)((DWORD)1 << HashTable->SlotBits);
+    Mask = HashTable->NumberSlots - 1;
+
+    for (OldIndex = 0; OldIndex < OldNumberSlots; OldIndex++) {
+        if (OldSlots[OldIndex].Entry != NULL) {
+            Index = YoriLibGrowableHashHomeSlot(HashTable, OldSlots[OldIndex].Hash);
+            while (NewSlots[Index].Entry != NULL) {
+                Index = (Index + 1) & Mask;
+            }
+            NewSlots[Index].Hash = OldSlots[OldIndex].Hash;
+            NewSlots[Index].Entry = OldSlots[OldIndex].Entry;
+        }
+    }
+
+    YoriLibFree(OldSlots);
+    return TRUE;
+}
+
+/**
+ Insert an object with a string based key into a growable hash table.  The
+ caller is expected to have checked that no entry with this key exists.
+
+ @param HashTable The hash table to insert the object into.
+
+ @param KeyString Pointer to a Yori string describing the key for the
+        entry.
+
+ @param Context Pointer to a blob of data which is meaningful to the caller.
+
+ @param HashEntry On successful completion, populated with structures
+        describing the entry within the hash table.
+
+ @return TRUE to indicate the entry was inserted, FALSE if the table is
+         full and could not be grown.
+ */
+__success(return)
+BOOLEAN
+YoriLibGrowableHashInsertByKey(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PYORI_STRING KeyString,
+    __in PVOID Context,
+    __out PYORI_HASH_ENTRY HashEntry
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Mask;
+    DWORD Hash;
+
+    //
+    //  If the table would become more than three quarters full, try to
+    //  grow it.  If that fails, keep using the existing table as long as
+    //  one slot remains empty so that lookups terminate.
+    //
+
+    if (HashTable->NumberEntries + 1 > HashTable->NumberSlots / 4 * 3) {
+        if (!YoriLibGrowGrowableHashTable(HashTable) &&
+            HashTable->NumberEntries + 1 >= HashTable->NumberSlots) {
+
+            return FALSE;
+        }
+    }
+
+    Hash = YoriLibHashStringForTable(KeyString);
+    Mask = HashTable->NumberSlots - 1;
+    Index = YoriLibGrowableHashHomeSlot(HashTable, Hash);
+    while (HashTable->Slots[Index].Entry != NULL) {
+        Index = (Index + 1) & Mask;
+    }
+
+    YoriLibCloneString(&HashEntry->Key, KeyString);
+    HashEntry->Context = Context;
+    YoriLibInitializeListHead(&HashEntry->ListEntry);
+
+    HashTable->Slots[Index].Hash = Hash;
+    HashTable->Slots[Index].Entry = HashEntry;
+    HashTable->NumberEntries++;
+
+    return TRUE;
+}
+
+/**
+ Locate an object within a growable hash table by a specified key.
+
+ @param HashTable Pointer to the hash table to search for the object.
+
+ @param KeyString Pointer to the key to identify the object.
+
+ @return Pointer to the entry within the hash table if a match is found.
+         If no match is found, returns NULL.
+ */
+PYORI_HASH_ENTRY
+YoriLibGrowableHashLookupByKey(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PCYORI_STRING KeyString
+    )
+{
+    PYORI_GROWABLE_HASH_SLOT Slot;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Mask;
+    DWORD Hash;
+
+    //
+    //  The hash is calculated from upcased characters, so keys which
+    //  compare equal insensitively always have the same hash.
+    //
+
+    Hash = YoriLibHashStringForTable(KeyString);
+    Mask = HashTable->NumberSlots - 1;
+    Index = YoriLibGrowableHashHomeSlot(HashTable, Hash);
+
+    while (TRUE) {
+        Slot = &HashTable->Slots[Index];
+        if (Slot->Entry == NULL) {
+            break;
+        }
+        if (Slot->Hash == Hash &&
+            YoriLibCompareStringInsensitive(KeyString, &Slot->Entry->Key) == 0) {
+
+            return Slot->Entry;
+        }
+        Index = (Index + 1) & Mask;
+    }
+
+    return NULL;
+}
+
+/**
+ Remove an entry from a growable hash table.  This routine assumes the entry
+ must already be inserted into the hash table.  Entries following it are
+ moved back so that no markers for deleted entries are needed.
+
+ @param HashTable Pointer to the hash table containing the entry.
+
+ @param HashEntry The entry to remove.
+ */
+VOID
+YoriLibGrowableHashRemoveByEntry(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PYORI_HASH_ENTRY HashEntry
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Next;
+    YORI_ALLOC_SIZE_T Home;
+    YORI_ALLOC_SIZE_T Mask;
+    BOOLEAN HomeInRange;
+
+    Mask = HashTable->NumberSlots - 1;
+    Index = YoriLibGrowableHashHomeSlot(HashTable, YoriLibHashStringForTable(&HashEntry->Key));
+    while (HashTable->Slots[Index].Entry != HashEntry) {
+        ASSERT(HashTable->Slots[Index].Entry != NULL);
+        if (HashTable->Slots[Index].Entry == NULL) {
+            return;
+        }
+        Index = (Index + 1) & Mask;
+    }
+
+    HashTable->Slots[Index].Entry = NULL;
+    HashTable->NumberEntries--;
+
+    //
+    //  An entry later in the same run can move into the empty slot unless
+    //  its home slot is after the empty slot, since moving it would place
+    //  it before its home where it could not be found.
+    //
+
+    Next = (Index + 1) & Mask;
+    while (HashTable->Slots[Next].Entry != NULL) {
+        Home = YoriLibGrowableHashHomeSlot(HashTable, HashTable->Slots[Next].Hash);
+        HomeInRange = FALSE;
+        if (Index <= Next) {
+            if (Home > Index && Home <= Next) {
+                HomeInRange = TRUE;
+            }
+        } else {
+            if (Home > Index || Home <= Next) {
+                HomeInRange = TRUE;
+            }
+        }
+
+        if (!HomeInRange) {
+            HashTable->Slots[Index].Hash = HashTable->Slots[Next].Hash;
+            HashTable->Slots[Index].Entry = HashTable->Slots[Next].Entry;
+            HashTable->Slots[Next].Entry = NULL;
+            Index = Next;
+        }
+
+        Next = (Next + 1) & Mask;
+    }
+
+    YoriLibFreeStringContents(&HashEntry->Key);
+}
+
 // vim:sw=4:ts=4:et:
@@ -77,49 +77,36 @@ YoriLibHexByteCStyle(
     __in BOOLEAN MoreFollowing
     )
 {
-    UCHAR WordToDisplay = 0;
+    UCHAR WordToDisplay;
     DWORD WordIndex;
-    BOOL DisplayWord;
     YORI_ALLOC_SIZE_T OutputIndex = 0;
-    YORI_STRING Subset;
 
     if (BytesToDisplay > YORI_LIB_HEXDUMP_BYTES_PER_LINE) {
         return FALSE;
     }
 
-    Subset.StartOfString = &Output->StartOfString[OutputIndex];
-    Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
-    Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                           Subset.LengthAllocated,
-                                           _T("        "));
-    OutputIndex = OutputIndex + Subset.LengthInChars;
+    //
+    //  This is generated directly from the digit table rather than via
+    //  printf since it is used to convert very large files.
+    //
 
-    for (WordIndex = 0; WordIndex < YORI_LIB_HEXDUMP_BYTES_PER_LINE / sizeof(WordToDisplay); WordIndex++) {
+    for (WordIndex = 0; WordIndex < 8 && OutputIndex < Output->LengthAllocated; WordIndex++) {
+        Output->StartOfString[OutputIndex++] = ' ';
+    }
 
-        WordToDisplay = 0;
-        DisplayWord = FALSE;
+    for (WordIndex = 0; WordIndex < BytesToDisplay; WordIndex++) {
 
-        if (WordIndex * sizeof(WordToDisplay) < BytesToDisplay) {
-            DisplayWord = TRUE;
-            WordToDisplay = (UCHAR)Buffer[WordIndex];
+        if (OutputIndex + 4 > Output->LengthAllocated) {
+            break;
         }
 
-        if (DisplayWord) {
-            Subset.StartOfString = &Output->StartOfString[OutputIndex];
-            Subset.LengthAllocated = Output->LengthAllocated - OutputIndex;
+        WordToDisplay = Buffer[WordIndex];
+        Output->StartOfString[OutputIndex++] = HEX_DIGIT_FROM_VALUE(WordToDisplay >> 4);
+        Output->StartOfString[OutputIndex++] = HEX_DIGIT_FROM_VALUE(WordToDisplay);
 
-            if (WordIndex + 1 == BytesToDisplay && !MoreFollowing) {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%02x"),
-                                                       WordToDisplay);
-            } else {
-                Subset.LengthInChars = YoriLibSPrintfS(Subset.StartOfString,
-                                                       Subset.LengthAllocated,
-                                                       _T("%02x, "),
-                                                       WordToDisplay);
-            }
-            OutputIndex = OutputIndex + Subset.LengthInChars;
+        if (WordIndex + 1 < BytesToDisplay || MoreFollowing) {
+            Output->StartOfString[OutputIndex++] = ',';
+            Output->StartOfString[OutputIndex++] = ' ';
         }
     }
     Output->LengthInChars = OutputIndex;
@@ -889,6 +876,116 @@ YoriLibHexDump(
     return TRUE;
 }
 
+/**
+ The number of characters to reserve for each line generated by
+ YoriLibHexDumpToString.  Since these lines are never hilighted, this is much
+ smaller than the worst case used when displaying to a console: a 64 bit
+ offset takes 19 chars, C style output takes 72, characters take 17, and a
+ newline.  The remainder allows for the slack each line formatter requires
+ before it will write a word.
+ */
+#define YORI_LIB_HEXDUMP_CHARS_PER_PLAIN_LINE 128
+
+/**
+ Generate a buffer in hex format and append the result to a caller supplied
+ string.  This allows a caller to format a large buffer into a single string
+ that can be written in one operation, or to format different parts of a
+ buffer concurrently.  The string is reallocated if it is not large enough
+ to contain the result, so a caller that reuses the string across calls
+ will only allocate when the amount of data increases.
+
+ @param Buffer Pointer to the buffer to generate.
+
+ @param StartOfBufferOffset If the buffer displayed to this call is part of
+        a larger logical stream of data, this value indicates the offset of
+        this buffer within the larger logical stream.  This is used for
+        display only.
+
+ @param BufferLength The length of the buffer, in bytes.
+
+ @param BytesPerWord The number of bytes to display at a time.
+
+ @param DumpFlags Flags for the operation.
+
+ @param MoreFollowing If TRUE, more data follows this buffer, so C style
+        output should terminate the final line with a comma.
+
+ @param Output Pointer to a string to append the generated text to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibHexDumpToString(
+    __in LPCSTR Buffer,
+    __in LONGLONG StartOfBufferOffset,
+    __in YORI_ALLOC_SIZE_T BufferLength,
+    __in DWORD BytesPerWord,
+    __in DWORD DumpFlags,
+    __in BOOLEAN MoreFollowing,
+    __inout PYORI_STRING Output
+    )
+{
+    YORI_ALLOC_SIZE_T LineCount;
+    YORI_ALLOC_SIZE_T LineIndex;
+    YORI_MAX_UNSIGNED_T CharsNeeded;
+    LONGLONG DisplayBufferOffset;
+    YORI_STRING LineBuffer;
+    PUCHAR CurrentBuffer;
+    YORI_ALLOC_SIZE_T BufferRemaining;
+    BOOLEAN MoreFollowingLine;
+
+    if (BytesPerWord != 1 && BytesPerWord != 2 && BytesPerWord != 4 && BytesPerWord != 8) {
+        return FALSE;
+    }
+
+    LineCount = (YORI_ALLOC_SIZE_T)((BufferLength + YORI_LIB_HEXDUMP_BYTES_PER_LINE - 1) / YORI_LIB_HEXDUMP_BYTES_PER_LINE);
+
+    CharsNeeded = LineCount;
+    CharsNeeded = CharsNeeded * YORI_LIB_HEXDUMP_CHARS_PER_PLAIN_LINE + Output->LengthInChars;
+    if (!YoriLibIsSizeAllocatable(CharsNeeded * sizeof(TCHAR))) {
+        return FALSE;
+    }
+
+    if (Output->LengthAllocated < CharsNeeded) {
+        if (!YoriLibReallocateString(Output, (YORI_ALLOC_SIZE_T)CharsNeeded)) {
+            return FALSE;
+        }
+    }
+
+    YoriLibInitEmptyString(&LineBuffer);
+    DisplayBufferOffset = StartOfBufferOffset;
+    CurrentBuffer = (PUCHAR)Buffer;
+    BufferRemaining = BufferLength;
+    MoreFollowingLine = TRUE;
+
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex++) {
+
+        if (LineIndex + 1 == LineCount) {
+            MoreFollowingLine = MoreFollowing;
+        }
+
+        LineBuffer.StartOfString = &Output->StartOfString[Output->LengthInChars];
+        LineBuffer.LengthInChars = 0;
+        LineBuffer.LengthAllocated = YORI_LIB_HEXDUMP_CHARS_PER_PLAIN_LINE;
+
+        YoriLibHexLineToString(CurrentBuffer, DisplayBufferOffset, BufferRemaining, BytesPerWord, DumpFlags, MoreFollowingLine, &LineBuffer);
+
+        if (LineBuffer.LengthInChars < LineBuffer.LengthAllocated) {
+            LineBuffer.StartOfString[LineBuffer.LengthInChars] = '\n';
+            LineBuffer.LengthInChars++;
+        }
+
+        Output->LengthInChars = Output->LengthInChars + LineBuffer.LengthInChars;
+
+        CurrentBuffer = YoriLibAddToPointer(CurrentBuffer, YORI_LIB_HEXDUMP_BYTES_PER_LINE);
+        BufferRemaining = BufferRemaining - YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+        DisplayBufferOffset = DisplayBufferOffset + YORI_LIB_HEXDUMP_BYTES_PER_LINE;
+    }
+
+    return TRUE;
+}
+
 /**
  Display two buffers side by side in hex format.
 
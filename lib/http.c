@@ -27,6 +27,38 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+/**
+ The initial size of the buffer used to receive data from the server.  This
+ buffer holds response headers and any body data that has been received but
+ not yet returned to the caller.
+ */
+#define YORI_LIB_HTTP_RECEIVE_BUFFER_SIZE (64 * 1024)
+
+/**
+ The minimum number of bytes to request from each receive call into the
+ receive buffer.
+ */
+#define YORI_LIB_HTTP_MINIMUM_RECEIVE_SIZE (4 * 1024)
+
+/**
+ The maximum size of response headers.  Servers returning more than this are
+ considered malformed, which prevents a malicious server from causing
+ unbounded memory growth.
+ */
+#define YORI_LIB_HTTP_MAXIMUM_HEADER_SIZE (64 * 1024)
+
+/**
+ The maximum size of a single line describing a chunk in a chunked response.
+ */
+#define YORI_LIB_HTTP_MAXIMUM_CHUNK_LINE_SIZE (4 * 1024)
+
+/**
+ The maximum number of body bytes to discard from a redirect response in
+ order to allow the connection to be reused.  If the redirect body is larger
+ than this, the connection is closed instead.
+ */
+#define YORI_LIB_HTTP_MAXIMUM_DRAIN_SIZE (64 * 1024)
+
 /**
  The type of the handle.  This occurs because the WinInet interface returns an
  HINTERNET for many APIs but it means different things in different contexts.
@@ -37,6 +69,15 @@ typedef enum _YORI_LIB_INTERNET_HANDLE_TYPE {
     YoriLibUrlHandle = 2
 } YORI_LIB_INTERNET_HANDLE_TYPE;
 
+/**
+ The way the server indicates the end of the response body.
+ */
+typedef enum _YORI_LIB_HTTP_BODY_TYPE {
+    YoriLibHttpBodyUntilClose = 0,
+    YoriLibHttpBodyContentLength = 1,
+    YoriLibHttpBodyChunked = 2
+} YORI_LIB_HTTP_BODY_TYPE;
+
 /**
  Information describing each response header in an HTTP response.
  */
@@ -84,6 +125,18 @@ typedef struct _YORI_LIB_INTERNET_HANDLE {
              agent, being the only value supported with YoriLibInternetOpen.
              */
             YORI_STRING UserAgent;
+
+            /**
+             A connection from a previous request that completed with the
+             server indicating it can be reused.  INVALID_SOCKET if no
+             connection is available for reuse.
+             */
+            SOCKET CachedSocket;
+
+            /**
+             The host that CachedSocket is connected to.
+             */
+            YORI_STRING CachedHost;
         } Internet;
         struct {
 
@@ -106,7 +159,20 @@ typedef struct _YORI_LIB_INTERNET_HANDLE {
             YORI_STRING UserRequestHeaders;
 
             /**
-             The byte buffer containing the response from the server.
+             The connection to the server, or INVALID_SOCKET if no
+             connection is active.
+             */
+            SOCKET Socket;
+
+            /**
+             The host that Socket is connected to.
+             */
+            YORI_STRING Host;
+
+            /**
+             The byte buffer containing data received from the server that
+             has not yet been returned to the caller.  Initially this
+             contains the response headers.
              */
             YORI_LIB_BYTE_BUFFER ByteBuffer;
 
@@ -116,7 +182,8 @@ typedef struct _YORI_LIB_INTERNET_HANDLE {
             YORI_LIST_ENTRY HttpResponseHeaders;
 
             /**
-             The current offset within the buffer for InternetRead requests.
+             The number of body bytes returned to the caller via
+             InternetRead requests.
              */
             DWORDLONG CurrentReadOffset;
 
@@ -125,6 +192,41 @@ typedef struct _YORI_LIB_INTERNET_HANDLE {
              */
             DWORD HttpBodyOffset;
 
+            /**
+             The offset within ByteBuffer of the next byte that has not been
+             consumed.
+             */
+            DWORD BufferReadOffset;
+
+            /**
+             The way the server indicates the end of the response body.
+             */
+            YORI_LIB_HTTP_BODY_TYPE BodyType;
+
+            /**
+             For Content-Length responses, the number of body bytes not yet
+             returned to the caller.  For chunked responses, the number of
+             bytes remaining in the current chunk.
+             */
+            DWORDLONG BodyBytesRemaining;
+
+            /**
+             TRUE once the entire response body has been received.
+             */
+            BOOLEAN BodyComplete;
+
+            /**
+             TRUE if the line break following chunk data has not yet been
+             consumed.
+             */
+            BOOLEAN ChunkLineBreakPending;
+
+            /**
+             TRUE if the server indicated that the connection can be used
+             for another request once this response is complete.
+             */
+            BOOLEAN KeepAlive;
+
             /**
              Once the response has been processed, the major version of the
              HTTP response.
@@ -221,6 +323,7 @@ YoriLibInternetOpen(
 
     ZeroMemory(Handle, sizeof(YORI_LIB_INTERNET_HANDLE));
     Handle->HandleType = YoriLibInternetHandle;
+    Handle->u.Internet.CachedSocket = INVALID_SOCKET;
 
     if (UserAgent != NULL) {
         Length = (YORI_ALLOC_SIZE_T)_tcslen(UserAgent);
@@ -238,6 +341,48 @@ YoriLibInternetOpen(
     return Handle;
 }
 
+/**
+ Release the connection associated with a Url handle.  If the response has
+ been completely received and the server indicated the connection can be
+ kept alive, the connection is handed to the Internet handle so a later
+ request to the same host can reuse it.  Otherwise it is closed.
+
+ @param UrlRequest Pointer to the URL handle.
+ */
+VOID
+YoriLibHttpReleaseConnection(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest
+    )
+{
+    PYORI_LIB_INTERNET_HANDLE InternetHandle;
+
+    if (UrlRequest->u.Url.Socket == INVALID_SOCKET) {
+        YoriLibFreeStringContents(&UrlRequest->u.Url.Host);
+        return;
+    }
+
+    InternetHandle = UrlRequest->u.Url.InternetHandle;
+
+    if (UrlRequest->u.Url.BodyComplete &&
+        UrlRequest->u.Url.KeepAlive &&
+        UrlRequest->u.Url.BufferReadOffset == UrlRequest->u.Url.ByteBuffer.BytesPopulated) {
+
+        if (InternetHandle->u.Internet.CachedSocket != INVALID_SOCKET) {
+            DllWsock32.pclosesocket(InternetHandle->u.Internet.CachedSocket);
+            YoriLibFreeStringContents(&InternetHandle->u.Internet.CachedHost);
+        }
+
+        InternetHandle->u.Internet.CachedSocket = UrlRequest->u.Url.Socket;
+        memcpy(&InternetHandle->u.Internet.CachedHost, &UrlRequest->u.Url.Host, sizeof(YORI_STRING));
+        YoriLibInitEmptyString(&UrlRequest->u.Url.Host);
+    } else {
+        DllWsock32.pclosesocket(UrlRequest->u.Url.Socket);
+        YoriLibFreeStringContents(&UrlRequest->u.Url.Host);
+    }
+
+    UrlRequest->u.Url.Socket = INVALID_SOCKET;
+}
+
 /**
  Clean up a Url handle to prepare for reuse.  The same handle can be used for
  multiple requests due to HTTP redirects.
@@ -252,7 +397,16 @@ YoriLibHttpResetUrlRequest(
     PYORI_LIST_ENTRY ListEntry;
     PYORI_LIB_HTTP_HEADER_LINE ResponseLine;
 
+    YoriLibHttpReleaseConnection(UrlRequest);
     YoriLibByteBufferReset(&UrlRequest->u.Url.ByteBuffer);
+    UrlRequest->u.Url.BufferReadOffset = 0;
+    UrlRequest->u.Url.HttpBodyOffset = 0;
+    UrlRequest->u.Url.CurrentReadOffset = 0;
+    UrlRequest->u.Url.BodyType = YoriLibHttpBodyUntilClose;
+    UrlRequest->u.Url.BodyBytesRemaining = 0;
+    UrlRequest->u.Url.BodyComplete = FALSE;
+    UrlRequest->u.Url.ChunkLineBreakPending = FALSE;
+    UrlRequest->u.Url.KeepAlive = FALSE;
 
     ListEntry = NULL;
     ListEntry = YoriLibGetNextListEntry(&UrlRequest->u.Url.HttpResponseHeaders, NULL);
@@ -297,6 +451,11 @@ YoriLibInternetCloseHandle(
 
     if (Handle->HandleType == YoriLibInternetHandle) {
         YoriLibFreeStringContents(&Handle->u.Internet.UserAgent);
+        if (Handle->u.Internet.CachedSocket != INVALID_SOCKET) {
+            DllWsock32.pclosesocket(Handle->u.Internet.CachedSocket);
+            Handle->u.Internet.CachedSocket = INVALID_SOCKET;
+        }
+        YoriLibFreeStringContents(&Handle->u.Internet.CachedHost);
         DllWsock32.pWSACleanup();
     } else if (Handle->HandleType == YoriLibUrlHandle) {
         YoriLibHttpResetUrlRequest(Handle);
@@ -383,10 +542,8 @@ YoriLibHttpProcessResponseHeaders(
     LineLengthInChars = 0;
 
     //
-    //  MSFIX: Should impose some fairly arbitrary limit on the maximum
-    //  size of headers.  This is because we don't want to limit the size
-    //  of the HTTP payload needlessly, but still want to be robust to
-    //  malicious input trying to cause this to overflow or degrade.
+    //  The caller has already verified that the buffer contains the end of
+    //  the headers, and limited them to YORI_LIB_HTTP_MAXIMUM_HEADER_SIZE.
     //
 
     for (Index = 0; Index < UrlRequest->u.Url.ByteBuffer.BytesPopulated; Index++) {
@@ -469,6 +626,7 @@ YoriLibHttpProcessResponseHeaders(
            (UrlRequest->u.Url.ByteBuffer.Buffer[Index] != '\n' &&
             UrlRequest->u.Url.ByteBuffer.Buffer[Index] != '\r'));
     UrlRequest->u.Url.CurrentReadOffset = 0;
+    UrlRequest->u.Url.BufferReadOffset = Index;
 
     ListEntry = YoriLibGetNextListEntry(&UrlRequest->u.Url.HttpResponseHeaders, NULL);
     if (ListEntry == NULL) {
@@ -548,8 +706,340 @@ YoriLibHttpProcessResponseHeaders(
 }
 
 /**
- Connect to a specified URL, download contents, parse headers, and redirect as
- necessary.
+ Receive more data from the server into the receive buffer.  Any data that
+ has already been consumed is discarded from the buffer first, so the buffer
+ only grows if the caller needs to retain a large amount of unconsumed data.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @param BytesReceived On successful completion, updated to contain the number
+        of bytes received.  Zero indicates the server closed the connection.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibHttpFillBuffer(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest,
+    __out PDWORD BytesReceived
+    )
+{
+    PYORI_LIB_BYTE_BUFFER ByteBuffer;
+    PUCHAR Buffer;
+    YORI_ALLOC_SIZE_T BytesAvailable;
+    DWORD BytesUnconsumed;
+    INT Length;
+
+    ByteBuffer = &UrlRequest->u.Url.ByteBuffer;
+
+    if (UrlRequest->u.Url.BufferReadOffset > 0) {
+        BytesUnconsumed = (DWORD)(ByteBuffer->BytesPopulated - UrlRequest->u.Url.BufferReadOffset);
+        if (BytesUnconsumed > 0) {
+            memmove(ByteBuffer->Buffer, &ByteBuffer->Buffer[UrlRequest->u.Url.BufferReadOffset], BytesUnconsumed);
+        }
+        ByteBuffer->BytesPopulated = BytesUnconsumed;
+        UrlRequest->u.Url.BufferReadOffset = 0;
+    }
+
+    Buffer = YoriLibByteBufferGetPointerToEnd(ByteBuffer, YORI_LIB_HTTP_MINIMUM_RECEIVE_SIZE, &BytesAvailable);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    Length = DllWsock32.precv(UrlRequest->u.Url.Socket, Buffer, (DWORD)BytesAvailable, 0);
+    if (Length < 0) {
+        return FALSE;
+    }
+
+    YoriLibByteBufferAddToPopulatedLength(ByteBuffer, Length);
+    *BytesReceived = (DWORD)Length;
+    return TRUE;
+}
+
+/**
+ Check whether a buffer contains the complete set of response headers.  This
+ uses the same line break rules as @ref YoriLibHttpProcessResponseHeaders .
+
+ @param Buffer Pointer to the data received from the server.
+
+ @param BufferLength The number of bytes in Buffer.
+
+ @return TRUE if the buffer contains an empty line terminating the headers,
+         FALSE if more data is needed.
+ */
+BOOLEAN
+YoriLibHttpBufferContainsEndOfHeaders(
+    __in PUCHAR Buffer,
+    __in DWORD BufferLength
+    )
+{
+    DWORD Index;
+    DWORD LineLengthInChars;
+
+    LineLengthInChars = 0;
+    for (Index = 0; Index < BufferLength; Index++) {
+        if (Buffer[Index] == '\r' || Buffer[Index] == '\n') {
+
+            //
+            //  If the buffer ends in \r, it's not yet known whether a \n
+            //  follows, so more data is needed before deciding.
+            //
+
+            if (Buffer[Index] == '\r') {
+                if (Index + 1 >= BufferLength) {
+                    return FALSE;
+                }
+                if (Buffer[Index + 1] == '\n') {
+                    Index = Index + 1;
+                }
+            }
+
+            if (LineLengthInChars == 0) {
+                return TRUE;
+            }
+            LineLengthInChars = 0;
+        } else {
+            LineLengthInChars++;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Once response headers have been parsed, determine how the end of the body
+ will be indicated and whether the connection can be reused afterwards.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @return TRUE to indicate success, FALSE to indicate a malformed response.
+ */
+BOOLEAN
+YoriLibHttpPrepareResponseBody(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest
+    )
+{
+    PYORI_LIB_HTTP_HEADER_LINE ResponseLine;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+
+    //
+    //  HTTP/1.1 connections persist unless the server says otherwise.
+    //  HTTP/1.0 connections close unless the server says otherwise.
+    //
+
+    ResponseLine = YoriLibHttpFindResponseHeader(UrlRequest, _T("Connection"));
+    if (UrlRequest->u.Url.HttpMinorVersion >= 1) {
+        UrlRequest->u.Url.KeepAlive = TRUE;
+        if (ResponseLine != NULL &&
+            YoriLibCompareStringWithLiteralInsensitive(&ResponseLine->Value, _T("close")) == 0) {
+            UrlRequest->u.Url.KeepAlive = FALSE;
+        }
+    } else {
+        UrlRequest->u.Url.KeepAlive = FALSE;
+        if (ResponseLine != NULL &&
+            YoriLibCompareStringWithLiteralInsensitive(&ResponseLine->Value, _T("keep-alive")) == 0) {
+            UrlRequest->u.Url.KeepAlive = TRUE;
+        }
+    }
+
+    UrlRequest->u.Url.BodyBytesRemaining = 0;
+    UrlRequest->u.Url.BodyComplete = FALSE;
+    UrlRequest->u.Url.ChunkLineBreakPending = FALSE;
+
+    //
+    //  These responses never have a body, regardless of headers.  304 is
+    //  returned in response to If-Modified-Since requests.
+    //
+
+    if (UrlRequest->u.Url.HttpStatusCode == 204 ||
+        UrlRequest->u.Url.HttpStatusCode == 304 ||
+        (UrlRequest->u.Url.HttpStatusCode >= 100 && UrlRequest->u.Url.HttpStatusCode < 200)) {
+
+        UrlRequest->u.Url.BodyType = YoriLibHttpBodyContentLength;
+        UrlRequest->u.Url.BodyComplete = TRUE;
+        return TRUE;
+    }
+
+    ResponseLine = YoriLibHttpFindResponseHeader(UrlRequest, _T("Transfer-Encoding"));
+    if (ResponseLine != NULL &&
+        YoriLibCompareStringWithLiteralInsensitive(&ResponseLine->Value, _T("chunked")) == 0) {
+
+        UrlRequest->u.Url.BodyType = YoriLibHttpBodyChunked;
+        return TRUE;
+    }
+
+    ResponseLine = YoriLibHttpFindResponseHeader(UrlRequest, _T("Content-Length"));
+    if (ResponseLine != NULL && ResponseLine->Value.LengthInChars > 0) {
+        if (!YoriLibStringToNumberSpecifyBase(&ResponseLine->Value, 10, FALSE, &llTemp, &CharsConsumed) ||
+            CharsConsumed == 0 ||
+            llTemp < 0) {
+
+            return FALSE;
+        }
+
+        UrlRequest->u.Url.BodyType = YoriLibHttpBodyContentLength;
+        UrlRequest->u.Url.BodyBytesRemaining = (DWORDLONG)llTemp;
+        if (llTemp == 0) {
+            UrlRequest->u.Url.BodyComplete = TRUE;
+        }
+        return TRUE;
+    }
+
+    //
+    //  With no indication of length, the body continues until the server
+    //  closes the connection, so the connection can't be reused.
+    //
+
+    UrlRequest->u.Url.BodyType = YoriLibHttpBodyUntilClose;
+    UrlRequest->u.Url.KeepAlive = FALSE;
+    return TRUE;
+}
+
+/**
+ Obtain a connection to a host.  If the Internet handle has a connection to
+ the same host from a previous request, that connection is used; otherwise
+ a new connection is established.
+
+ @param UrlRequest Pointer to the URL handle.  On successful completion, the
+        Socket and Host members are populated.
+
+ @param HostName The name of the host to connect to.
+
+ @param ReusedConnection On successful completion, set to TRUE if the
+        connection was previously used for another request, meaning the
+        server may have closed it in the meantime.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibHttpConnect(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest,
+    __in PYORI_STRING HostName,
+    __out PBOOLEAN ReusedConnection
+    )
+{
+    PYORI_LIB_INTERNET_HANDLE InternetHandle;
+    struct hostent * addr;
+    struct sockaddr_in sin;
+    UCHAR * AnsiBuffer;
+    SOCKET s;
+
+    InternetHandle = UrlRequest->u.Url.InternetHandle;
+
+    ASSERT(UrlRequest->u.Url.Socket == INVALID_SOCKET);
+    YoriLibFreeStringContents(&UrlRequest->u.Url.Host);
+
+    if (InternetHandle->u.Internet.CachedSocket != INVALID_SOCKET &&
+        YoriLibCompareStringInsensitive(&InternetHandle->u.Internet.CachedHost, HostName) == 0) {
+
+        UrlRequest->u.Url.Socket = InternetHandle->u.Internet.CachedSocket;
+        memcpy(&UrlRequest->u.Url.Host, &InternetHandle->u.Internet.CachedHost, sizeof(YORI_STRING));
+        InternetHandle->u.Internet.CachedSocket = INVALID_SOCKET;
+        YoriLibInitEmptyString(&InternetHandle->u.Internet.CachedHost);
+        *ReusedConnection = TRUE;
+        return TRUE;
+    }
+
+    AnsiBuffer = YoriLibMalloc(HostName->LengthInChars + 1);
+    if (AnsiBuffer == NULL) {
+        return FALSE;
+    }
+
+    YoriLibSPrintfA(AnsiBuffer, "%y", HostName);
+    addr = DllWsock32.pgethostbyname(AnsiBuffer);
+    YoriLibFree(AnsiBuffer);
+    if (addr == NULL || addr->h_addrtype != AF_INET || addr->h_length != sizeof(DWORD)) {
+        return FALSE;
+    }
+
+    s = DllWsock32.psocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET) {
+        return FALSE;
+    }
+
+    ZeroMemory(&sin, sizeof(sin));
+
+    // MSFIX Probably should parse the port from the host name
+    sin.sin_family = AF_INET;
+    sin.sin_port = 0x5000; // 80, in hex, in big endian
+    memcpy(&sin.sin_addr.s_addr, addr->h_addr, addr->h_length);
+
+    if (DllWsock32.pconnect(s, &sin, sizeof(sin)) != 0) {
+        DllWsock32.pclosesocket(s);
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&UrlRequest->u.Url.Host, HostName->LengthInChars + 1)) {
+        DllWsock32.pclosesocket(s);
+        return FALSE;
+    }
+
+    memcpy(UrlRequest->u.Url.Host.StartOfString, HostName->StartOfString, HostName->LengthInChars * sizeof(TCHAR));
+    UrlRequest->u.Url.Host.LengthInChars = HostName->LengthInChars;
+    UrlRequest->u.Url.Host.StartOfString[HostName->LengthInChars] = '\0';
+
+    UrlRequest->u.Url.Socket = s;
+    *ReusedConnection = FALSE;
+    return TRUE;
+}
+
+/**
+ Send a request on the connection associated with a URL handle and receive
+ the response headers.  Any body data received along with the headers is
+ retained in the receive buffer.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @param AnsiRequest Pointer to the request to send.
+
+ @param RequestLength The length of the request, in bytes.
+
+ @return TRUE to indicate the complete set of headers was received, FALSE to
+         indicate failure.
+ */
+BOOLEAN
+YoriLibHttpSendRequestReceiveHeaders(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest,
+    __in UCHAR * AnsiRequest,
+    __in DWORD RequestLength
+    )
+{
+    DWORD BytesReceived;
+
+    if (DllWsock32.psend(UrlRequest->u.Url.Socket, AnsiRequest, RequestLength, 0) != (int)RequestLength) {
+        return FALSE;
+    }
+
+    YoriLibByteBufferReset(&UrlRequest->u.Url.ByteBuffer);
+    UrlRequest->u.Url.BufferReadOffset = 0;
+
+    while (TRUE) {
+        if (!YoriLibHttpFillBuffer(UrlRequest, &BytesReceived)) {
+            return FALSE;
+        }
+
+        if (BytesReceived == 0) {
+            return FALSE;
+        }
+
+        if (YoriLibHttpBufferContainsEndOfHeaders(UrlRequest->u.Url.ByteBuffer.Buffer, (DWORD)UrlRequest->u.Url.ByteBuffer.BytesPopulated)) {
+            break;
+        }
+
+        if (UrlRequest->u.Url.ByteBuffer.BytesPopulated > YORI_LIB_HTTP_MAXIMUM_HEADER_SIZE) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Connect to a specified URL, send the request, and parse the response
+ headers.  The response body is not received here; it is received as the
+ caller reads it via @ref YoriLibInternetReadFile .
 
  @param UrlRequest Pointer to a URL handle containing a URL to connect to.
 
@@ -568,17 +1058,9 @@ YoriLibHttpProcessUrlRequest(
     YORI_STRING HostSubset;
     YORI_STRING Request;
     LPCTSTR EndOfHost;
-    struct hostent * addr;
-    struct sockaddr_in sin;
     UCHAR * AnsiBuffer;
-    SOCKET s;
-    DWORD Length;
-    DWORD TotalLength;
-    YORI_ALLOC_SIZE_T BytesRemaining;
-
-    //
-    //  MSFIX Implement this
-    //
+    BOOLEAN ReusedConnection;
+    BOOLEAN Success;
 
     YoriLibInitEmptyString(RedirectUrl);
 
@@ -601,11 +1083,19 @@ YoriLibHttpProcessUrlRequest(
         return FALSE;
     }
 
+    //
+    //  User supplied headers have had trailing newlines removed, so a line
+    //  break is only needed if any were supplied.  Emitting one otherwise
+    //  would terminate the request headers early.
+    //
+
     YoriLibInitEmptyString(&Request);
     YoriLibYPrintf(&Request,
-                   _T("GET %s HTTP/1.0\r\n%y\r\nUser-Agent: %y(YoriWinInet %i.%02i)\r\n\r\n"),
+                   _T("GET %s HTTP/1.1\r\nHost: %y\r\n%y%sUser-Agent: %y(YoriWinInet %i.%02i)\r\nConnection: keep-alive\r\n\r\n"),
                    EndOfHost,
+                   &HostSubset,
                    &UrlRequest->u.Url.UserRequestHeaders,
+                   UrlRequest->u.Url.UserRequestHeaders.LengthInChars > 0?_T("\r\n"):_T(""),
                    &UrlRequest->u.Url.InternetHandle->u.Internet.UserAgent,
                    YORI_VER_MAJOR, YORI_VER_MINOR);
 
@@ -613,76 +1103,48 @@ YoriLibHttpProcessUrlRequest(
         return FALSE;
     }
 
-    AnsiBuffer = YoriLibMalloc(HostSubset.LengthInChars + 1);
+    AnsiBuffer = YoriLibMalloc(Request.LengthInChars + 1);
     if (AnsiBuffer == NULL) {
         YoriLibFreeStringContents(&Request);
         return FALSE;
     }
 
-    YoriLibSPrintfA(AnsiBuffer, "%y", &HostSubset);
-    addr = DllWsock32.pgethostbyname(AnsiBuffer);
-    if (addr == NULL || addr->h_addrtype != AF_INET || addr->h_length != sizeof(DWORD)) {
-        YoriLibFree(AnsiBuffer);
-        YoriLibFreeStringContents(&Request);
-        return FALSE;
-    }
-
-    YoriLibFree(AnsiBuffer);
-
-    s = DllWsock32.psocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == INVALID_SOCKET) {
-        YoriLibFreeStringContents(&Request);
-        return FALSE;
-    }
-
-    ZeroMemory(&sin, sizeof(sin));
+    YoriLibSPrintfA(AnsiBuffer, "%y", &Request);
 
-    // MSFIX Probably should parse the port from the host name
-    sin.sin_family = AF_INET;
-    sin.sin_port = 0x5000; // 80, in hex, in big endian
-    memcpy(&sin.sin_addr.s_addr, addr->h_addr, addr->h_length);
+    //
+    //  If a reused connection fails before any response arrives, the server
+    //  most likely closed it while idle.  Retry once on a new connection.
+    //
 
-    if (DllWsock32.pconnect(s, &sin, sizeof(sin)) != 0) {
-        YoriLibFreeStringContents(&Request);
-        DllWsock32.pclosesocket(s);
-        return FALSE;
-    }
+    Success = FALSE;
+    if (YoriLibHttpConnect(UrlRequest, &HostSubset, &ReusedConnection)) {
+        Success = YoriLibHttpSendRequestReceiveHeaders(UrlRequest, AnsiBuffer, Request.LengthInChars);
+        if (!Success &&
+            ReusedConnection &&
+            UrlRequest->u.Url.ByteBuffer.BytesPopulated == 0) {
 
-    AnsiBuffer = YoriLibMalloc(Request.LengthInChars + 1);
-    if (AnsiBuffer == NULL) {
-        YoriLibFreeStringContents(&Request);
-        DllWsock32.pclosesocket(s);
-        return FALSE;
-    }
-
-    YoriLibSPrintfA(AnsiBuffer, "%y", &Request);
-    if (DllWsock32.psend(s, AnsiBuffer, Request.LengthInChars, 0) != (int)Request.LengthInChars) {
-        YoriLibFree(AnsiBuffer);
-        YoriLibFreeStringContents(&Request);
-        DllWsock32.pclosesocket(s);
-        return FALSE;
+            YoriLibHttpReleaseConnection(UrlRequest);
+            if (YoriLibHttpConnect(UrlRequest, &HostSubset, &ReusedConnection)) {
+                Success = YoriLibHttpSendRequestReceiveHeaders(UrlRequest, AnsiBuffer, Request.LengthInChars);
+            }
+        }
     }
 
     YoriLibFreeStringContents(&Request);
     YoriLibFree(AnsiBuffer);
 
-    YoriLibByteBufferReset(&UrlRequest->u.Url.ByteBuffer);
-    TotalLength = 0;
-    while(TRUE) {
-        AnsiBuffer = YoriLibByteBufferGetPointerToEnd(&UrlRequest->u.Url.ByteBuffer, 256 * 1024, &BytesRemaining);
-        Length = DllWsock32.precv(s, AnsiBuffer, (DWORD)BytesRemaining, 0);
-        if (Length == 0) {
-            break;
-        }
-        YoriLibByteBufferAddToPopulatedLength(&UrlRequest->u.Url.ByteBuffer, Length);
+    if (!Success) {
+        return FALSE;
     }
 
-    DllWsock32.pclosesocket(s);
-
     if (!YoriLibHttpProcessResponseHeaders(UrlRequest, RedirectUrl)) {
         return FALSE;
     }
 
+    if (!YoriLibHttpPrepareResponseBody(UrlRequest)) {
+        return FALSE;
+    }
+
     // YoriLibHttpOutputUrlResponse(UrlRequest);
 
     return TRUE;
@@ -854,7 +1316,277 @@ YoriLibHttpMergeRedirectUrl(
 }
 
 /**
- Opens a specified URL resource.  This includes downloading all contents.
+ Read a single line from the server, used to parse chunk sizes and trailers
+ in a chunked response.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @param Line On successful completion, updated to point to the start of the
+        line within the receive buffer.  This is only valid until the next
+        data is received.
+
+ @param LineLength On successful completion, updated to contain the length
+        of the line in bytes, excluding any line break.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibHttpReadLine(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest,
+    __out PUCHAR *Line,
+    __out PDWORD LineLength
+    )
+{
+    PUCHAR Start;
+    DWORD BytesAvailable;
+    DWORD BytesReceived;
+    DWORD Index;
+
+    while (TRUE) {
+        Start = &UrlRequest->u.Url.ByteBuffer.Buffer[UrlRequest->u.Url.BufferReadOffset];
+        BytesAvailable = (DWORD)(UrlRequest->u.Url.ByteBuffer.BytesPopulated - UrlRequest->u.Url.BufferReadOffset);
+
+        for (Index = 0; Index < BytesAvailable; Index++) {
+            if (Start[Index] == '\n') {
+                *Line = Start;
+                *LineLength = Index;
+                if (Index > 0 && Start[Index - 1] == '\r') {
+                    *LineLength = Index - 1;
+                }
+                UrlRequest->u.Url.BufferReadOffset = UrlRequest->u.Url.BufferReadOffset + Index + 1;
+                return TRUE;
+            }
+        }
+
+        if (BytesAvailable > YORI_LIB_HTTP_MAXIMUM_CHUNK_LINE_SIZE) {
+            return FALSE;
+        }
+
+        if (!YoriLibHttpFillBuffer(UrlRequest, &BytesReceived) ||
+            BytesReceived == 0) {
+
+            return FALSE;
+        }
+    }
+}
+
+/**
+ Read the line describing the next chunk of a chunked response.  If this is
+ the final chunk, any trailing headers are consumed and the body is marked
+ as complete.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibHttpReadChunkHeader(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest
+    )
+{
+    PUCHAR Line;
+    DWORD LineLength;
+    DWORD Index;
+    DWORDLONG ChunkSize;
+    UCHAR Char;
+    UCHAR Digit;
+
+    //
+    //  Each chunk's data is followed by a line break before the next chunk
+    //  header.
+    //
+
+    if (UrlRequest->u.Url.ChunkLineBreakPending) {
+        if (!YoriLibHttpReadLine(UrlRequest, &Line, &LineLength) ||
+            LineLength != 0) {
+
+            return FALSE;
+        }
+        UrlRequest->u.Url.ChunkLineBreakPending = FALSE;
+    }
+
+    if (!YoriLibHttpReadLine(UrlRequest, &Line, &LineLength)) {
+        return FALSE;
+    }
+
+    //
+    //  The chunk size is in hex, optionally followed by extensions which
+    //  are ignored.
+    //
+
+    ChunkSize = 0;
+    for (Index = 0; Index < LineLength; Index++) {
+        Char = Line[Index];
+        if (Char >= '0' && Char <= '9') {
+            Digit = (UCHAR)(Char - '0');
+        } else if (Char >= 'a' && Char <= 'f') {
+            Digit = (UCHAR)(Char - 'a' + 10);
+        } else if (Char >= 'A' && Char <= 'F') {
+            Digit = (UCHAR)(Char - 'A' + 10);
+        } else {
+            break;
+        }
+
+        if ((ChunkSize >> 60) != 0) {
+            return FALSE;
+        }
+        ChunkSize = (ChunkSize << 4) + Digit;
+    }
+
+    if (Index == 0) {
+        return FALSE;
+    }
+
+    if (ChunkSize > 0) {
+        UrlRequest->u.Url.BodyBytesRemaining = ChunkSize;
+        return TRUE;
+    }
+
+    //
+    //  The final chunk is followed by optional trailers and an empty line.
+    //
+
+    do {
+        if (!YoriLibHttpReadLine(UrlRequest, &Line, &LineLength)) {
+            return FALSE;
+        }
+    } while (LineLength != 0);
+
+    UrlRequest->u.Url.BodyComplete = TRUE;
+    return TRUE;
+}
+
+/**
+ Read the next part of the response body.  Data that has already been
+ received is returned first; once that is exhausted, data is received from
+ the server directly into the caller's buffer.
+
+ @param UrlRequest Pointer to the URL handle.
+
+ @param Buffer On successful completion, updated to contain body data.
+
+ @param BytesToRead The maximum number of bytes that can be read into Buffer.
+
+ @param BytesRead On successful completion, updated to contain the number of
+        bytes read into Buffer.  Zero indicates the end of the body.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibHttpReadBody(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest,
+    __out_bcount(BytesToRead) PUCHAR Buffer,
+    __in DWORD BytesToRead,
+    __out PDWORD BytesRead
+    )
+{
+    DWORD BytesToCopy;
+    DWORD BytesAvailable;
+    INT Length;
+
+    *BytesRead = 0;
+
+    while (!UrlRequest->u.Url.BodyComplete &&
+           UrlRequest->u.Url.BodyType == YoriLibHttpBodyChunked &&
+           UrlRequest->u.Url.BodyBytesRemaining == 0) {
+
+        if (!YoriLibHttpReadChunkHeader(UrlRequest)) {
+            return FALSE;
+        }
+    }
+
+    if (UrlRequest->u.Url.BodyComplete || BytesToRead == 0) {
+        return TRUE;
+    }
+
+    BytesToCopy = BytesToRead;
+    if (UrlRequest->u.Url.BodyType != YoriLibHttpBodyUntilClose &&
+        BytesToCopy > UrlRequest->u.Url.BodyBytesRemaining) {
+
+        BytesToCopy = (DWORD)UrlRequest->u.Url.BodyBytesRemaining;
+    }
+
+    BytesAvailable = (DWORD)(UrlRequest->u.Url.ByteBuffer.BytesPopulated - UrlRequest->u.Url.BufferReadOffset);
+    if (BytesAvailable > 0) {
+        if (BytesToCopy > BytesAvailable) {
+            BytesToCopy = BytesAvailable;
+        }
+        memcpy(Buffer, &UrlRequest->u.Url.ByteBuffer.Buffer[UrlRequest->u.Url.BufferReadOffset], BytesToCopy);
+        UrlRequest->u.Url.BufferReadOffset = UrlRequest->u.Url.BufferReadOffset + BytesToCopy;
+    } else {
+        Length = DllWsock32.precv(UrlRequest->u.Url.Socket, Buffer, BytesToCopy, 0);
+        if (Length < 0) {
+            return FALSE;
+        }
+
+        //
+        //  If the server closes the connection, that's the end of the body
+        //  if no length was specified, or a truncated response otherwise.
+        //
+
+        if (Length == 0) {
+            if (UrlRequest->u.Url.BodyType == YoriLibHttpBodyUntilClose) {
+                UrlRequest->u.Url.BodyComplete = TRUE;
+                return TRUE;
+            }
+            return FALSE;
+        }
+        BytesToCopy = (DWORD)Length;
+    }
+
+    if (UrlRequest->u.Url.BodyType != YoriLibHttpBodyUntilClose) {
+        UrlRequest->u.Url.BodyBytesRemaining = UrlRequest->u.Url.BodyBytesRemaining - BytesToCopy;
+        if (UrlRequest->u.Url.BodyBytesRemaining == 0) {
+            if (UrlRequest->u.Url.BodyType == YoriLibHttpBodyContentLength) {
+                UrlRequest->u.Url.BodyComplete = TRUE;
+            } else {
+                UrlRequest->u.Url.ChunkLineBreakPending = TRUE;
+            }
+        }
+    }
+
+    UrlRequest->u.Url.CurrentReadOffset = UrlRequest->u.Url.CurrentReadOffset + BytesToCopy;
+    *BytesRead = BytesToCopy;
+    return TRUE;
+}
+
+/**
+ Discard the body of a response which is not returned to the caller, such
+ as a redirect, so that the connection can be reused for the next request.
+ If the body is large, it is left unread and the connection will be closed.
+
+ @param UrlRequest Pointer to the URL handle.
+ */
+VOID
+YoriLibHttpDrainBody(
+    __inout PYORI_LIB_INTERNET_HANDLE UrlRequest
+    )
+{
+    UCHAR Discard[1024];
+    DWORD BytesRead;
+    DWORD TotalBytesRead;
+
+    if (!UrlRequest->u.Url.KeepAlive) {
+        return;
+    }
+
+    TotalBytesRead = 0;
+    while (!UrlRequest->u.Url.BodyComplete &&
+           TotalBytesRead < YORI_LIB_HTTP_MAXIMUM_DRAIN_SIZE) {
+
+        if (!YoriLibHttpReadBody(UrlRequest, Discard, sizeof(Discard), &BytesRead)) {
+            return;
+        }
+        TotalBytesRead = TotalBytesRead + BytesRead;
+    }
+}
+
+/**
+ Opens a specified URL resource.  This sends the request and receives the
+ response headers, following any redirects.  The body is received as the
+ caller reads it with @ref YoriLibInternetReadFile .
 
  @param hInternet Handle to an internet resource opened with
         @ref YoriLibInternetOpen .
@@ -906,6 +1638,7 @@ YoriLibInternetOpenUrl(
 
     ZeroMemory(UrlHandle, sizeof(YORI_LIB_INTERNET_HANDLE));
     UrlHandle->HandleType = YoriLibUrlHandle;
+    UrlHandle->u.Url.Socket = INVALID_SOCKET;
     YoriLibInitializeListHead(&UrlHandle->u.Url.HttpResponseHeaders);
 
     Length = (YORI_ALLOC_SIZE_T)_tcslen(Url);
@@ -928,7 +1661,7 @@ YoriLibInternetOpenUrl(
     YoriLibTrimTrailingNewlines(&UrlHandle->u.Url.UserRequestHeaders);
     UrlHandle->u.Url.InternetHandle = Handle;
 
-    if (!YoriLibByteBufferInitialize(&UrlHandle->u.Url.ByteBuffer, 1024 * 1024)) {
+    if (!YoriLibByteBufferInitialize(&UrlHandle->u.Url.ByteBuffer, YORI_LIB_HTTP_RECEIVE_BUFFER_SIZE)) {
         YoriLibInternetCloseHandle(UrlHandle);
         return NULL;
     }
@@ -945,6 +1678,8 @@ YoriLibInternetOpenUrl(
             break;
         }
 
+        YoriLibHttpDrainBody(UrlHandle);
+
         YoriLibInitEmptyString(&RedirectUrl);
         if (!YoriLibHttpMergeRedirectUrl(&UrlHandle->u.Url.Url, &LocationHeader, &RedirectUrl)) {
             YoriLibFreeStringContents(&LocationHeader);
@@ -988,9 +1723,6 @@ YoriLibInternetReadFile(
     )
 {
     PYORI_LIB_INTERNET_HANDLE UrlHandle;
-    DWORDLONG BufferOffset;
-    DWORD BytesToCopy;
-    PUCHAR Source;
 
     UrlHandle = (PYORI_LIB_INTERNET_HANDLE)hRequest;
 
@@ -998,24 +1730,10 @@ YoriLibInternetReadFile(
         return FALSE;
     }
 
-    BufferOffset = UrlHandle->u.Url.HttpBodyOffset;
-    BufferOffset = BufferOffset + UrlHandle->u.Url.CurrentReadOffset;
-
-    BytesToCopy = BytesToRead;
-    if (BufferOffset + BytesToCopy > UrlHandle->u.Url.ByteBuffer.BytesPopulated) {
-        BytesToCopy = (DWORD)(UrlHandle->u.Url.ByteBuffer.BytesPopulated - BufferOffset);
-    }
-
-    if (BytesToCopy == 0) {
-        *BytesRead = 0;
-        return TRUE;
+    if (!YoriLibHttpReadBody(UrlHandle, Buffer, BytesToRead, BytesRead)) {
+        return FALSE;
     }
 
-    Source = YoriLibAddToPointer(UrlHandle->u.Url.ByteBuffer.Buffer, BufferOffset);
-    memcpy(Buffer, Source, BytesToCopy);
-    *BytesRead = BytesToCopy;
-
-    UrlHandle->u.Url.CurrentReadOffset = UrlHandle->u.Url.CurrentReadOffset + BytesToCopy;
     return TRUE;
 }
 
@@ -0,0 +1,289 @@
+/**
+ * @file lib/intern.c
+ *
+ * Yori shared string pool
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ A single string within a string pool.  The characters of the string
+ immediately follow this structure, and the allocation is referenced by
+ each caller that holds a copy of the string.
+ */
+typedef struct _YORI_LIB_STRING_POOL_ENTRY {
+
+    /**
+     The next entry in the same bucket.
+     */
+    struct _YORI_LIB_STRING_POOL_ENTRY * Next;
+
+    /**
+     The hash of the string, retained so that buckets can be redistributed
+     without rehashing and most mismatches are found without comparing
+     strings.
+     */
+    DWORD Hash;
+
+    /**
+     The string contents.  MemoryToFree refers to this entry.
+     */
+    YORI_STRING String;
+
+} YORI_LIB_STRING_POOL_ENTRY;
+
+/**
+ Pointer to a single string within a string pool.
+ */
+typedef YORI_LIB_STRING_POOL_ENTRY *PYORI_LIB_STRING_POOL_ENTRY;
+
+/**
+ Allocate an array of empty buckets for a string pool.
+
+ @param NumberBuckets The number of buckets to allocate.
+
+ @return Pointer to the bucket array, or NULL on allocation failure.
+ */
+PYORI_LIB_STRING_POOL_ENTRY *
+YoriLibAllocateStringPoolBuckets(
+    __in YORI_ALLOC_SIZE_T NumberBuckets
+    )
+{
+    PYORI_LIB_STRING_POOL_ENTRY * Buckets;
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)NumberBuckets * sizeof(PYORI_LIB_STRING_POOL_ENTRY))) {
+        return NULL;
+    }
+
+    Buckets = YoriLibMalloc(NumberBuckets * sizeof(PYORI_LIB_STRING_POOL_ENTRY));
+    if (Buckets == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Buckets, NumberBuckets * sizeof(PYORI_LIB_STRING_POOL_ENTRY));
+    return Buckets;
+}
+
+/**
+ Allocate a string pool.  A string pool stores a single copy of each unique
+ string that is inserted into it, so callers which repeatedly encounter the
+ same names can share one allocation rather than holding one each.
+
+ @param InitialEntries The number of strings the pool is expected to hold.
+        The pool grows as needed if more are inserted.
+
+ @return Pointer to the string pool, or NULL on allocation failure.
+ */
+PYORI_LIB_STRING_POOL
+YoriLibAllocateStringPool(
+    __in YORI_ALLOC_SIZE_T InitialEntries
+    )
+{
+    PYORI_LIB_STRING_POOL Pool;
+    YORI_ALLOC_SIZE_T NumberBuckets;
+
+    NumberBuckets = 16;
+    while (NumberBuckets < InitialEntries && NumberBuckets < 0x40000000) {
+        NumberBuckets = NumberBuckets * 2;
+    }
+
+    Pool = YoriLibMalloc(sizeof(YORI_LIB_STRING_POOL));
+    if (Pool == NULL) {
+        return NULL;
+    }
+
+    Pool->Buckets = YoriLibAllocateStringPoolBuckets(NumberBuckets);
+    if (Pool->Buckets == NULL) {
+        YoriLibFree(Pool);
+        return NULL;
+    }
+
+    Pool->NumberBuckets = NumberBuckets;
+    Pool->NumberEntries = 0;
+    Pool->CharsStored = 0;
+    Pool->CharsShared = 0;
+    return Pool;
+}
+
+/**
+ Free a string pool.  Strings previously returned from the pool remain
+ valid, since each holds its own reference, but later requests for the
+ same string will no longer share them.
+
+ @param Pool Pointer to the string pool to free.
+ */
+VOID
+YoriLibFreeStringPool(
+    __in PYORI_LIB_STRING_POOL Pool
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    PYORI_LIB_STRING_POOL_ENTRY Entry;
+    PYORI_LIB_STRING_POOL_ENTRY Next;
+
+    for (Index = 0; Index < Pool->NumberBuckets; Index++) {
+        Entry = Pool->Buckets[Index];
+        while (Entry != NULL) {
+            Next = Entry->Next;
+            YoriLibDereference(Entry);
+            Entry = Next;
+        }
+    }
+
+    YoriLibFree(Pool->Buckets);
+    YoriLibFree(Pool);
+}
+
+/**
+ Double the number of buckets in a string pool.  Failure is not fatal; the
+ pool continues to function with longer chains.
+
+ @param Pool Pointer to the string pool.
+ */
+VOID
+YoriLibGrowStringPool(
+    __in PYORI_LIB_STRING_POOL Pool
+    )
+{
+    PYORI_LIB_STRING_POOL_ENTRY * NewBuckets;
+    PYORI_LIB_STRING_POOL_ENTRY Entry;
+    PYORI_LIB_STRING_POOL_ENTRY Next;
+    YORI_ALLOC_SIZE_T NewNumberBuckets;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T NewIndex;
+
+    if (Pool->NumberBuckets >= 0x40000000) {
+        return;
+    }
+
+    NewNumberBuckets = Pool->NumberBuckets * 2;
+    NewBuckets = YoriLibAllocateStringPoolBuckets(NewNumberBuckets);
+    if (NewBuckets == NULL) {
+        return;
+    }
+
+    for (Index = 0; Index < Pool->NumberBuckets; Index++) {
+        Entry = Pool->Buckets[Index];
+        while (Entry != NULL) {
+            Next = Entry->Next;
+            NewIndex = Entry->Hash & (NewNumberBuckets - 1);
+            Entry->Next = NewBuckets[NewIndex];
+            NewBuckets[NewIndex] = Entry;
+            Entry = Next;
+        }
+    }
+
+    YoriLibFree(Pool->Buckets);
+    Pool->Buckets = NewBuckets;
+    Pool->NumberBuckets = NewNumberBuckets;
+}
+
+/**
+ Return a pooled copy of a string.  If the pool already contains a string
+ with identical contents, a reference to that copy is returned; otherwise a
+ new copy is made and added to the pool.  Comparison is case sensitive.
+ Because identical strings share storage, two strings returned from the
+ same pool are equal if and only if they have the same StartOfString and
+ length, which can be tested with @ref YoriLibIsSamePooledString .
+
+ @param Pool Pointer to the string pool.
+
+ @param Source Pointer to the string to find or insert.
+
+ @param Pooled On successful completion, populated with a string that
+        refers to the pooled copy.  The caller should free this with
+        @ref YoriLibFreeStringContents when it is no longer needed.  The
+        string is NULL terminated and must not be modified.
+
+ @return TRUE to indicate success, FALSE on allocation failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibInternString(
+    __in PYORI_LIB_STRING_POOL Pool,
+    __in PCYORI_STRING Source,
+    __out PYORI_STRING Pooled
+    )
+{
+    PYORI_LIB_STRING_POOL_ENTRY Entry;
+    DWORDLONG Hash64;
+    DWORD Hash;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_MAX_UNSIGNED_T BytesNeeded;
+
+    Hash64 = YoriLibHashString64(0, Source);
+    Hash = (DWORD)(Hash64 >> 32) ^ (DWORD)Hash64;
+    Index = Hash & (Pool->NumberBuckets - 1);
+
+    Entry = Pool->Buckets[Index];
+    while (Entry != NULL) {
+        if (Entry->Hash == Hash &&
+            YoriLibCompareString(&Entry->String, Source) == 0) {
+
+            YoriLibCloneString(Pooled, &Entry->String);
+            Pool->CharsShared = Pool->CharsShared + Source->LengthInChars;
+            return TRUE;
+        }
+        Entry = Entry->Next;
+    }
+
+    BytesNeeded = sizeof(YORI_LIB_STRING_POOL_ENTRY) + ((YORI_MAX_UNSIGNED_T)Source->LengthInChars + 1) * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesNeeded)) {
+        return FALSE;
+    }
+
+    Entry = YoriLibReferencedMalloc((YORI_ALLOC_SIZE_T)BytesNeeded);
+    if (Entry == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Entry->String);
+    Entry->String.StartOfString = (LPTSTR)(Entry + 1);
+    memcpy(Entry->String.StartOfString, Source->StartOfString, Source->LengthInChars * sizeof(TCHAR));
+    Entry->String.StartOfString[Source->LengthInChars] = '\0';
+    Entry->String.LengthInChars = Source->LengthInChars;
+    Entry->String.LengthAllocated = Source->LengthInChars + 1;
+    Entry->String.MemoryToFree = Entry;
+    Entry->Hash = Hash;
+
+    //
+    //  The pool holds the reference from the allocation, and the caller
+    //  receives a new one.
+    //
+
+    Entry->Next = Pool->Buckets[Index];
+    Pool->Buckets[Index] = Entry;
+    Pool->NumberEntries++;
+    Pool->CharsStored = Pool->CharsStored + Source->LengthInChars;
+
+    YoriLibCloneString(Pooled, &Entry->String);
+
+    if (Pool->NumberEntries > Pool->NumberBuckets) {
+        YoriLibGrowStringPool(Pool);
+    }
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -74,13 +74,227 @@ YoriLibLimitJobObjectPriority(
     )
 {
     YORI_JOB_BASIC_LIMIT_INFORMATION LimitInfo;
+    DWORD BytesReturned;
+
     if (DllKernel32.pSetInformationJobObject == NULL) {
         return FALSE;
     }
-    ZeroMemory(&LimitInfo, sizeof(LimitInfo));
-    LimitInfo.Flags = 0x20;
+
+    //
+    //  Preserve any other limits that have already been applied.
+    //
+
+    if (DllKernel32.pQueryInformationJobObject == NULL ||
+        !DllKernel32.pQueryInformationJobObject(hJob, YORI_JOB_OBJECT_BASIC_LIMIT_INFORMATION, &LimitInfo, sizeof(LimitInfo), &BytesReturned)) {
+
+        ZeroMemory(&LimitInfo, sizeof(LimitInfo));
+    }
+    LimitInfo.Flags |= YORI_JOB_OBJECT_LIMIT_PRIORITY_CLASS;
     LimitInfo.Priority = Priority;
-    return DllKernel32.pSetInformationJobObject(hJob, 2, &LimitInfo, sizeof(LimitInfo));
+    return DllKernel32.pSetInformationJobObject(hJob, YORI_JOB_OBJECT_BASIC_LIMIT_INFORMATION, &LimitInfo, sizeof(LimitInfo));
+}
+
+/**
+ Set the processors that processes in a job object may execute on.  If this
+ functionality is not supported by the host OS, returns FALSE.
+
+ @param hJob Handle to the job object.
+
+ @param Affinity A mask of processors within the current processor group.
+
+ @return TRUE on success, FALSE on failure.
+ */
+BOOL
+YoriLibLimitJobObjectAffinity(
+    __in HANDLE hJob,
+    __in DWORD_PTR Affinity
+    )
+{
+    YORI_JOB_BASIC_LIMIT_INFORMATION LimitInfo;
+    DWORD BytesReturned;
+
+    if (DllKernel32.pSetInformationJobObject == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Preserve any other limits that have already been applied.
+    //
+
+    if (DllKernel32.pQueryInformationJobObject == NULL ||
+        !DllKernel32.pQueryInformationJobObject(hJob, YORI_JOB_OBJECT_BASIC_LIMIT_INFORMATION, &LimitInfo, sizeof(LimitInfo), &BytesReturned)) {
+
+        ZeroMemory(&LimitInfo, sizeof(LimitInfo));
+    }
+    LimitInfo.Flags |= YORI_JOB_OBJECT_LIMIT_AFFINITY;
+    LimitInfo.Affinity = Affinity;
+    return DllKernel32.pSetInformationJobObject(hJob, YORI_JOB_OBJECT_BASIC_LIMIT_INFORMATION, &LimitInfo, sizeof(LimitInfo));
+}
+
+/**
+ Limit the processor time that processes in a job object may consume, as a
+ hard cap.  This is only supported on Windows 8 and above; if it is not
+ supported by the host OS, returns FALSE.
+
+ @param hJob Handle to the job object.
+
+ @param CpuRate The portion of processor time the job may consume, in
+        hundredths of a percent, across all processors in the system.
+
+ @return TRUE on success, FALSE on failure.
+ */
+BOOL
+YoriLibLimitJobObjectCpuRate(
+    __in HANDLE hJob,
+    __in DWORD CpuRate
+    )
+{
+    YORI_JOB_CPU_RATE_CONTROL_INFORMATION RateInfo;
+
+    if (DllKernel32.pSetInformationJobObject == NULL) {
+        return FALSE;
+    }
+
+    if (CpuRate == 0 || CpuRate > 10000) {
+        return FALSE;
+    }
+
+    ZeroMemory(&RateInfo, sizeof(RateInfo));
+    RateInfo.ControlFlags = YORI_JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | YORI_JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+    RateInfo.CpuRate = CpuRate;
+    return DllKernel32.pSetInformationJobObject(hJob, YORI_JOB_OBJECT_CPU_RATE_CONTROL_INFORMATION, &RateInfo, sizeof(RateInfo));
+}
+
+
+/**
+ Create a completion port that can receive notifications from job objects.
+ If the functionality is not supported by the host OS, returns NULL.
+
+ @return Handle to a completion port, or NULL on failure.
+ */
+HANDLE
+YoriLibCreateJobCompletionPort(VOID)
+{
+    if (DllKernel32.pCreateIoCompletionPort == NULL ||
+        DllKernel32.pGetQueuedCompletionStatus == NULL ||
+        DllKernel32.pPostQueuedCompletionStatus == NULL ||
+        DllKernel32.pSetInformationJobObject == NULL ||
+        DllKernel32.pCreateJobObjectW == NULL ||
+        DllKernel32.pAssignProcessToJobObject == NULL) {
+
+        return NULL;
+    }
+    return DllKernel32.pCreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+}
+
+/**
+ Associate a job object with a completion port, so that notifications about
+ processes within the job are delivered to the completion port.  If this
+ functionality is not supported by the host OS, returns FALSE.
+
+ @param hJob Handle to the job object.
+
+ @param hPort Handle to a completion port returned from
+        YoriLibCreateJobCompletionPort.
+
+ @param Key A caller defined context pointer which is returned with each
+        message from this job object.
+
+ @return TRUE on success, FALSE on failure.
+ */
+BOOL
+YoriLibAssociateJobObjectWithCompletionPort(
+    __in HANDLE hJob,
+    __in HANDLE hPort,
+    __in PVOID Key
+    )
+{
+    YORI_JOB_ASSOCIATE_COMPLETION_PORT AssociateInfo;
+    if (DllKernel32.pSetInformationJobObject == NULL) {
+        return FALSE;
+    }
+    AssociateInfo.Key = Key;
+    AssociateInfo.Port = hPort;
+    return DllKernel32.pSetInformationJobObject(hJob, YORI_JOB_OBJECT_ASSOCIATE_COMPLETION_PORT_INFORMATION, &AssociateInfo, sizeof(AssociateInfo));
+}
+
+/**
+ Wait for a message to arrive on a job completion port.
+
+ @param hPort Handle to the completion port.
+
+ @param Timeout The maximum amount of time to wait, in milliseconds, or
+        INFINITE.
+
+ @param Message On successful completion, updated to contain the message
+        identifier.  For job objects this is one of the
+        YORI_JOB_OBJECT_MSG_* values.
+
+ @param Key On successful completion, updated to contain the context pointer
+        that was supplied when the job was associated with the port.
+
+ @param Data On successful completion, updated to contain message specific
+        data.  For process messages this is the process identifier.
+
+ @return TRUE to indicate a message was received, FALSE if the wait timed
+         out or failed.
+ */
+__success(return)
+BOOL
+YoriLibGetJobCompletionMessage(
+    __in HANDLE hPort,
+    __in DWORD Timeout,
+    __out PDWORD Message,
+    __out PVOID *Key,
+    __out PDWORD_PTR Data
+    )
+{
+    DWORD_PTR LocalKey;
+    LPOVERLAPPED Overlapped;
+
+    if (DllKernel32.pGetQueuedCompletionStatus == NULL) {
+        return FALSE;
+    }
+
+    Overlapped = NULL;
+    LocalKey = 0;
+    if (!DllKernel32.pGetQueuedCompletionStatus(hPort, Message, &LocalKey, &Overlapped, Timeout)) {
+        return FALSE;
+    }
+
+    *Key = (PVOID)LocalKey;
+    *Data = (DWORD_PTR)Overlapped;
+    return TRUE;
+}
+
+/**
+ Queue a caller defined message to a job completion port.  This allows the
+ caller to process events that did not originate from a job object in the
+ same loop as those that did.
+
+ @param hPort Handle to the completion port.
+
+ @param Message The message identifier.  Callers should use values that do
+        not collide with YORI_JOB_OBJECT_MSG_* values.
+
+ @param Key The context pointer to return with the message.
+
+ @param Data Message specific data to return with the message.
+
+ @return TRUE on success, FALSE on failure.
+ */
+BOOL
+YoriLibPostJobCompletionMessage(
+    __in HANDLE hPort,
+    __in DWORD Message,
+    __in PVOID Key,
+    __in DWORD_PTR Data
+    )
+{
+    if (DllKernel32.pPostQueuedCompletionStatus == NULL) {
+        return FALSE;
+    }
+    return DllKernel32.pPostQueuedCompletionStatus(hPort, Message, (DWORD_PTR)Key, (LPOVERLAPPED)Data);
 }
 
 // vim:sw=4:ts=4:et:
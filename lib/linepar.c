@@ -0,0 +1,711 @@
+/**
+ * @file lib/linepar.c
+ *
+ * Yori processing of lines from large files on multiple threads
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The number of bytes to read from the file for each chunk.  A chunk is
+ extended beyond this if it does not contain a complete line.
+ */
+#define YORI_LIB_PARALLEL_LINE_CHUNK_SIZE (1024 * 1024)
+
+/**
+ The minimum number of bytes remaining in a file for it to be processed on
+ multiple threads.  Smaller files are processed faster by the caller on a
+ single thread.
+ */
+#define YORI_LIB_PARALLEL_LINE_MINIMUM (4 * 1024 * 1024)
+
+/**
+ A range of a file consisting of complete lines, which is processed on a
+ worker thread and whose output is written in file order.
+ */
+typedef struct _YORI_LIB_PARALLEL_LINE_CHUNK {
+
+    /**
+     The work item used to process this chunk on a worker thread.  This
+     must be the first member so the chunk can be found from the item.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The link within the list of chunks which have been read and whose
+     output has not yet been written, in file order.
+     */
+    YORI_LIST_ENTRY OrderList;
+
+    /**
+     An event signalled once a worker thread has finished with the chunk.
+     */
+    HANDLE CompleteEvent;
+
+    /**
+     The data read from the file.  This may contain a partial line after
+     BytesInChunk, which is carried into the next chunk.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The size of the Buffer allocation, in bytes.
+     */
+    DWORD BufferSize;
+
+    /**
+     The number of bytes in Buffer which have been read from the file.
+     */
+    DWORD BytesInBuffer;
+
+    /**
+     The offset within Buffer of the first byte to process.  This is
+     nonzero if the chunk starts with a byte order mark.
+     */
+    DWORD StartOffset;
+
+    /**
+     The number of bytes in Buffer which form complete lines to process.
+     */
+    DWORD BytesInChunk;
+
+    /**
+     The output generated by processing the lines in this chunk.
+     */
+    YORI_STRING Output;
+
+    /**
+     Set to TRUE if every line in the chunk was processed successfully.
+     */
+    BOOLEAN Succeeded;
+} YORI_LIB_PARALLEL_LINE_CHUNK, *PYORI_LIB_PARALLEL_LINE_CHUNK;
+
+/**
+ State shared between all chunks while processing a file.
+ */
+typedef struct _YORI_LIB_PARALLEL_LINE_CONTEXT {
+
+    /**
+     The function to invoke for each line.
+     */
+    PYORI_LIB_PARALLEL_LINE_FN Function;
+
+    /**
+     The context to pass to Function.
+     */
+    PVOID Context;
+
+    /**
+     If TRUE, the input consists of 16 bit characters.
+     */
+    BOOLEAN ReadWChars;
+
+    /**
+     If TRUE, the input encoding represents characters below 0x80 as single
+     bytes with the same value as the UTF16 character.
+     */
+    BOOLEAN InputAsciiCompatible;
+} YORI_LIB_PARALLEL_LINE_CONTEXT, *PYORI_LIB_PARALLEL_LINE_CONTEXT;
+
+/**
+ Find the offset within a buffer immediately following the last complete
+ line.  Chunks are split after a line feed where possible, so that a
+ carriage return and line feed pair is never divided.  If the buffer has no
+ line feed, it is split after the last carriage return that is known not to
+ be followed by a line feed.
+
+ @param ParallelContext Pointer to the context describing the encoding.
+
+ @param Buffer Pointer to the buffer to search.
+
+ @param Length The number of bytes in the buffer.
+
+ @return The number of bytes which form complete lines, which is zero if
+         the buffer does not contain a complete line.
+ */
+DWORD
+YoriLibParallelLineFindChunkEnd(
+    __in PYORI_LIB_PARALLEL_LINE_CONTEXT ParallelContext,
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD CharCount;
+    DWORD LastCr;
+    PWCHAR WideBuffer;
+
+    LastCr = 0;
+    if (ParallelContext->ReadWChars) {
+        WideBuffer = (PWCHAR)Buffer;
+        CharCount = Length / sizeof(WCHAR);
+        for (Index = CharCount; Index > 0; Index--) {
+            if (WideBuffer[Index - 1] == 0xA) {
+                return Index * sizeof(WCHAR);
+            }
+            if (LastCr == 0 && WideBuffer[Index - 1] == 0xD && Index < CharCount) {
+                LastCr = Index * sizeof(WCHAR);
+            }
+        }
+    } else {
+        for (Index = Length; Index > 0; Index--) {
+            if (Buffer[Index - 1] == 0xA) {
+                return Index;
+            }
+            if (LastCr == 0 && Buffer[Index - 1] == 0xD && Index < Length) {
+                LastCr = Index;
+            }
+        }
+    }
+
+    return LastCr;
+}
+
+/**
+ Ensure a chunk's output string has space for the output of a line.  The
+ output of a chunk is built by appending each line, so the string grows
+ geometrically to avoid copying it for each line.
+
+ @param Output Pointer to the chunk's output string.
+
+ @param LineLength The length of the line about to be processed, in
+        characters.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibParallelLineReserveOutput(
+    __inout PYORI_STRING Output,
+    __in YORI_ALLOC_SIZE_T LineLength
+    )
+{
+    DWORD LengthRequired;
+    DWORD LengthToAllocate;
+
+    LengthRequired = Output->LengthInChars + LineLength * 2 + 0x100;
+    if (LengthRequired <= Output->LengthAllocated) {
+        return TRUE;
+    }
+
+    LengthToAllocate = Output->LengthAllocated * 2;
+    if (LengthToAllocate < LengthRequired) {
+        LengthToAllocate = LengthRequired;
+    }
+
+    if (!YoriLibIsSizeAllocatable(LengthToAllocate)) {
+        LengthToAllocate = LengthRequired;
+        if (!YoriLibIsSizeAllocatable(LengthToAllocate)) {
+            return FALSE;
+        }
+    }
+
+    return YoriLibReallocateString(Output, (YORI_ALLOC_SIZE_T)LengthToAllocate);
+}
+
+/**
+ Process each line within a chunk, accumulating the output for the chunk.
+ This is invoked on a worker thread, or on the main thread if a worker
+ could not be used.  The chunk remains owned by the main thread, which is
+ notified via the chunk's event.
+
+ @param Context Pointer to the parallel line context.
+
+ @param Item Pointer to the work item within the chunk.
+
+ @param Cancelled If TRUE, the operation has been cancelled, and the lines
+        should not be processed.
+ */
+VOID
+YoriLibParallelLineWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORI_LIB_PARALLEL_LINE_CONTEXT ParallelContext;
+    PYORI_LIB_PARALLEL_LINE_CHUNK Chunk;
+    YORI_LIB_LINE_VIEW View;
+    YORI_STRING LineString;
+    PUCHAR Buffer;
+    PWCHAR WideBuffer;
+    DWORD Offset;
+    DWORD End;
+    DWORD Length;
+    BOOLEAN HighBitsFound;
+
+    ParallelContext = (PYORI_LIB_PARALLEL_LINE_CONTEXT)Context;
+    Chunk = CONTAINING_RECORD(Item, YORI_LIB_PARALLEL_LINE_CHUNK, WorkItem);
+    Chunk->Succeeded = FALSE;
+
+    if (Cancelled) {
+        SetEvent(Chunk->CompleteEvent);
+        return;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+    View.WideChars = ParallelContext->ReadWChars;
+
+    //
+    //  Offsets are in characters of the input encoding.
+    //
+
+    if (ParallelContext->ReadWChars) {
+        WideBuffer = (PWCHAR)YoriLibAddToPointer(Chunk->Buffer, Chunk->StartOffset);
+        Buffer = NULL;
+        Length = (Chunk->BytesInChunk - Chunk->StartOffset) / sizeof(WCHAR);
+    } else {
+        Buffer = &Chunk->Buffer[Chunk->StartOffset];
+        WideBuffer = NULL;
+        Length = Chunk->BytesInChunk - Chunk->StartOffset;
+    }
+
+    Offset = 0;
+    Chunk->Succeeded = TRUE;
+    while (Offset < Length) {
+        HighBitsFound = FALSE;
+        if (WideBuffer != NULL) {
+            for (End = Offset; End < Length; End++) {
+                if (WideBuffer[End] == 0xD || WideBuffer[End] == 0xA) {
+                    break;
+                }
+            }
+            View.Buffer = &WideBuffer[Offset];
+        } else {
+            End = Offset + YoriLibLineReadFindLineEnd(&Buffer[Offset], (YORI_ALLOC_SIZE_T)(Length - Offset), &HighBitsFound);
+            View.Buffer = &Buffer[Offset];
+        }
+
+        View.LengthInChars = (YORI_ALLOC_SIZE_T)(End - Offset);
+        View.LineEnding = YoriLibLineEndingNone;
+        View.NeedsConversion = FALSE;
+        if (!ParallelContext->ReadWChars &&
+            (HighBitsFound || !ParallelContext->InputAsciiCompatible)) {
+
+            View.NeedsConversion = TRUE;
+        }
+
+        if (!YoriLibLineViewToString(&View, &LineString) ||
+            !YoriLibParallelLineReserveOutput(&Chunk->Output, LineString.LengthInChars) ||
+            !ParallelContext->Function(ParallelContext->Context, &LineString, &Chunk->Output)) {
+
+            Chunk->Succeeded = FALSE;
+            break;
+        }
+
+        //
+        //  Move past the line ending.  A carriage return followed by a line
+        //  feed is a single line ending.
+        //
+
+        if (End < Length) {
+            if (WideBuffer != NULL) {
+                if (WideBuffer[End] == 0xD && End + 1 < Length && WideBuffer[End + 1] == 0xA) {
+                    End++;
+                }
+            } else {
+                if (Buffer[End] == 0xD && End + 1 < Length && Buffer[End + 1] == 0xA) {
+                    End++;
+                }
+            }
+            End++;
+        }
+        Offset = End;
+    }
+
+    YoriLibFreeStringContents(&LineString);
+    SetEvent(Chunk->CompleteEvent);
+}
+
+/**
+ Free a chunk and its allocations.  The chunk must not be in use by a
+ worker thread.
+
+ @param Chunk Pointer to the chunk to free.
+ */
+VOID
+YoriLibParallelLineFreeChunk(
+    __in PYORI_LIB_PARALLEL_LINE_CHUNK Chunk
+    )
+{
+    if (Chunk->CompleteEvent != NULL) {
+        CloseHandle(Chunk->CompleteEvent);
+    }
+    if (Chunk->Buffer != NULL) {
+        YoriLibFree(Chunk->Buffer);
+    }
+    YoriLibFreeStringContents(&Chunk->Output);
+    YoriLibFree(Chunk);
+}
+
+/**
+ Allocate a chunk, copying any partial line from the previous chunk into
+ the start of its buffer.
+
+ @param Previous Optionally points to the previous chunk, whose data after
+        the complete lines is carried into this chunk.
+
+ @return Pointer to the chunk, or NULL on allocation failure.
+ */
+PYORI_LIB_PARALLEL_LINE_CHUNK
+YoriLibParallelLineAllocateChunk(
+    __in_opt PYORI_LIB_PARALLEL_LINE_CHUNK Previous
+    )
+{
+    PYORI_LIB_PARALLEL_LINE_CHUNK Chunk;
+    DWORD CarryBytes;
+
+    Chunk = YoriLibMalloc(sizeof(YORI_LIB_PARALLEL_LINE_CHUNK));
+    if (Chunk == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Chunk, sizeof(YORI_LIB_PARALLEL_LINE_CHUNK));
+    YoriLibInitEmptyString(&Chunk->Output);
+
+    CarryBytes = 0;
+    if (Previous != NULL) {
+        CarryBytes = Previous->BytesInBuffer - Previous->BytesInChunk;
+    }
+
+    Chunk->BufferSize = YORI_LIB_PARALLEL_LINE_CHUNK_SIZE;
+    if (Chunk->BufferSize < CarryBytes * 2) {
+        Chunk->BufferSize = CarryBytes * 2;
+    }
+
+    Chunk->CompleteEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Chunk->CompleteEvent == NULL) {
+        YoriLibParallelLineFreeChunk(Chunk);
+        return NULL;
+    }
+
+    if (!YoriLibIsSizeAllocatable(Chunk->BufferSize)) {
+        YoriLibParallelLineFreeChunk(Chunk);
+        return NULL;
+    }
+
+    Chunk->Buffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)Chunk->BufferSize);
+    if (Chunk->Buffer == NULL) {
+        YoriLibParallelLineFreeChunk(Chunk);
+        return NULL;
+    }
+
+    if (CarryBytes > 0) {
+        memcpy(Chunk->Buffer, &Previous->Buffer[Previous->BytesInChunk], CarryBytes);
+        Chunk->BytesInBuffer = CarryBytes;
+    }
+
+    return Chunk;
+}
+
+/**
+ Fill a chunk with data from the file until it contains at least one
+ complete line or the end of the file is reached.  If the buffer fills
+ without containing a complete line, it is reallocated to be larger.
+
+ @param ParallelContext Pointer to the context describing the encoding.
+
+ @param Chunk Pointer to the chunk to fill.
+
+ @param FileHandle The file to read from.
+
+ @param EndOfFile On completion, set to TRUE if the end of the file has been
+        reached.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibParallelLineFillChunk(
+    __in PYORI_LIB_PARALLEL_LINE_CONTEXT ParallelContext,
+    __in PYORI_LIB_PARALLEL_LINE_CHUNK Chunk,
+    __in HANDLE FileHandle,
+    __out PBOOLEAN EndOfFile
+    )
+{
+    DWORD BytesRead;
+    DWORD NewBufferSize;
+    PUCHAR NewBuffer;
+
+    *EndOfFile = FALSE;
+
+    while (TRUE) {
+        if (Chunk->BytesInBuffer == Chunk->BufferSize) {
+            NewBufferSize = Chunk->BufferSize * 2;
+            if (NewBufferSize < Chunk->BufferSize ||
+                !YoriLibIsSizeAllocatable(NewBufferSize)) {
+
+                return FALSE;
+            }
+            NewBuffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)NewBufferSize);
+            if (NewBuffer == NULL) {
+                return FALSE;
+            }
+            memcpy(NewBuffer, Chunk->Buffer, Chunk->BytesInBuffer);
+            YoriLibFree(Chunk->Buffer);
+            Chunk->Buffer = NewBuffer;
+            Chunk->BufferSize = NewBufferSize;
+        }
+
+        BytesRead = 0;
+        if (!ReadFile(FileHandle, &Chunk->Buffer[Chunk->BytesInBuffer], Chunk->BufferSize - Chunk->BytesInBuffer, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            *EndOfFile = TRUE;
+            Chunk->BytesInChunk = Chunk->BytesInBuffer;
+            if (ParallelContext->ReadWChars) {
+                Chunk->BytesInChunk = Chunk->BytesInChunk & ~(sizeof(WCHAR) - 1);
+            }
+            return TRUE;
+        }
+
+        Chunk->BytesInBuffer = Chunk->BytesInBuffer + BytesRead;
+        Chunk->BytesInChunk = YoriLibParallelLineFindChunkEnd(ParallelContext, Chunk->Buffer, Chunk->BytesInBuffer);
+        if (Chunk->BytesInChunk > 0) {
+            return TRUE;
+        }
+    }
+}
+
+/**
+ Wait for the oldest chunk to be processed, write its output, and free it.
+
+ @param ChunkList Pointer to the list of chunks in file order.
+
+ @param OutputFailed Pointer to a flag which is set if any chunk could not
+        be processed.  Once set, no further output is written, so that the
+        output never omits data from the middle of the file.
+ */
+VOID
+YoriLibParallelLineCompleteOldestChunk(
+    __in PYORI_LIST_ENTRY ChunkList,
+    __inout PBOOLEAN OutputFailed
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_PARALLEL_LINE_CHUNK Chunk;
+
+    ListEntry = YoriLibGetNextListEntry(ChunkList, NULL);
+    ASSERT(ListEntry != NULL);
+    Chunk = CONTAINING_RECORD(ListEntry, YORI_LIB_PARALLEL_LINE_CHUNK, OrderList);
+    WaitForSingleObject(Chunk->CompleteEvent, INFINITE);
+
+    if (!Chunk->Succeeded) {
+        *OutputFailed = TRUE;
+    }
+
+    if (!(*OutputFailed) && Chunk->Output.LengthInChars > 0) {
+        YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), YORI_LIB_OUTPUT_STDOUT, &Chunk->Output);
+    }
+
+    YoriLibRemoveListItem(&Chunk->OrderList);
+    YoriLibParallelLineFreeChunk(Chunk);
+}
+
+/**
+ Process the lines in a file on multiple threads.  The file is divided into
+ chunks which each end on a line boundary, the chunks are processed on
+ worker threads, and the output of each chunk is written to standard output
+ in file order.
+
+ This is only used when it is likely to be beneficial and cannot change the
+ output: the file must be a disk file large enough to divide into several
+ chunks, the system must have more than one processor, and standard output
+ must not be a console, since the function has no way to query the console
+ state as each line is generated.  If these conditions are not met, this
+ returns FALSE without consuming any input and the caller should process the
+ file on the current thread.
+
+ @param FileHandle The file to process, positioned at the first byte to
+        process.
+
+ @param Function The function to invoke for each line.  This is invoked on
+        multiple threads concurrently, so it must not modify state shared
+        between lines.  It appends any output for the line, including a
+        line ending, to the supplied output string.
+
+ @param Context Caller specified context to pass to Function.
+
+ @return TRUE to indicate the file was processed.  FALSE to indicate the
+         file was not processed and the caller should process it instead.
+ */
+__success(return)
+BOOL
+YoriLibProcessLinesInParallel(
+    __in HANDLE FileHandle,
+    __in PYORI_LIB_PARALLEL_LINE_FN Function,
+    __in_opt PVOID Context
+    )
+{
+    YORI_LIB_PARALLEL_LINE_CONTEXT ParallelContext;
+    YORILIB_WORK_QUEUE WorkQueue;
+    YORI_LIST_ENTRY ChunkList;
+    PYORI_LIB_PARALLEL_LINE_CHUNK Chunk;
+    PYORI_LIB_PARALLEL_LINE_CHUNK Previous;
+    YORI_ALLOC_SIZE_T ChunksOutstanding;
+    YORI_ALLOC_SIZE_T MaxChunksOutstanding;
+    LARGE_INTEGER Position;
+    LARGE_INTEGER FileSize;
+    SYSTEM_INFO SystemInfo;
+    DWORD ConsoleMode;
+    BOOLEAN EndOfFile;
+    BOOLEAN FirstChunk;
+    BOOLEAN OutputFailed;
+    BOOLEAN Incomplete;
+
+    if (GetFileType(FileHandle) != FILE_TYPE_DISK) {
+        return FALSE;
+    }
+
+    if (GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &ConsoleMode)) {
+        return FALSE;
+    }
+
+    GetSystemInfo(&SystemInfo);
+    if (SystemInfo.dwNumberOfProcessors < 2) {
+        return FALSE;
+    }
+
+    Position.HighPart = 0;
+    Position.LowPart = SetFilePointer(FileHandle, 0, &Position.HighPart, FILE_CURRENT);
+    if (Position.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    FileSize.HighPart = 0;
+    FileSize.LowPart = GetFileSize(FileHandle, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    if (FileSize.QuadPart < Position.QuadPart + YORI_LIB_PARALLEL_LINE_MINIMUM) {
+        return FALSE;
+    }
+
+    ParallelContext.Function = Function;
+    ParallelContext.Context = Context;
+    ParallelContext.ReadWChars = FALSE;
+    ParallelContext.InputAsciiCompatible = FALSE;
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        ParallelContext.ReadWChars = TRUE;
+    } else if (YoriLibGetMultibyteInputEncoding() == CP_UTF8) {
+        ParallelContext.InputAsciiCompatible = TRUE;
+    }
+
+    //
+    //  UTF16 input is scanned as an array of 16 bit characters, so the
+    //  data must start on a 16 bit boundary.
+    //
+
+    if (ParallelContext.ReadWChars && (Position.LowPart % sizeof(WCHAR)) != 0) {
+        return FALSE;
+    }
+
+    //
+    //  The first chunk is read before any threads are created, so if it
+    //  cannot be allocated the caller can still process the file.
+    //
+
+    Chunk = YoriLibParallelLineAllocateChunk(NULL);
+    if (Chunk == NULL) {
+        return FALSE;
+    }
+
+    if (!YoriLibInitializeWorkQueue(&WorkQueue, 0, 0, YoriLibParallelLineWorker, &ParallelContext)) {
+        YoriLibCleanupWorkQueue(&WorkQueue);
+        YoriLibParallelLineFreeChunk(Chunk);
+        return FALSE;
+    }
+
+    //
+    //  Allow each thread to have a chunk in progress and another waiting,
+    //  plus chunks which have completed but are waiting for an earlier
+    //  chunk to be written.
+    //
+
+    MaxChunksOutstanding = WorkQueue.MaxThreads * 4;
+    ChunksOutstanding = 0;
+    OutputFailed = FALSE;
+    Incomplete = FALSE;
+    FirstChunk = TRUE;
+    YoriLibInitializeListHead(&ChunkList);
+
+    EndOfFile = FALSE;
+    while (TRUE) {
+        if (!YoriLibParallelLineFillChunk(&ParallelContext, Chunk, FileHandle, &EndOfFile)) {
+            YoriLibParallelLineFreeChunk(Chunk);
+            Incomplete = TRUE;
+            break;
+        }
+
+        if (FirstChunk && Position.QuadPart == 0) {
+            Chunk->StartOffset = YoriLibBytesInBom(Chunk->Buffer, Chunk->BytesInChunk);
+        }
+        FirstChunk = FALSE;
+
+        YoriLibAppendList(&ChunkList, &Chunk->OrderList);
+        ChunksOutstanding++;
+
+        if (!YoriLibQueueWorkItem(&WorkQueue, &Chunk->WorkItem, TRUE)) {
+            YoriLibParallelLineWorker(&ParallelContext, &Chunk->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+        }
+
+        if (EndOfFile || YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        //
+        //  The previous chunk's partial line is copied into the next chunk.
+        //  The worker only examines the complete lines, so this can occur
+        //  while the previous chunk is being processed.
+        //
+
+        Previous = Chunk;
+        Chunk = YoriLibParallelLineAllocateChunk(Previous);
+        if (Chunk == NULL) {
+            Incomplete = TRUE;
+            break;
+        }
+
+        while (ChunksOutstanding >= MaxChunksOutstanding) {
+            YoriLibParallelLineCompleteOldestChunk(&ChunkList, &OutputFailed);
+            ChunksOutstanding--;
+        }
+    }
+
+    while (ChunksOutstanding > 0) {
+        YoriLibParallelLineCompleteOldestChunk(&ChunkList, &OutputFailed);
+        ChunksOutstanding--;
+    }
+
+    YoriLibCleanupWorkQueue(&WorkQueue);
+
+    if ((OutputFailed || Incomplete) && !YoriLibIsOperationCancelled()) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Could not process all lines in file\n"));
+    }
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
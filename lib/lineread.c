@@ -27,6 +27,20 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+/**
+ The number of bytes of a disk file to map at a time when reading lines
+ from a mapped view.  The longest line that can be returned from a view is
+ this size less the allocation granularity.
+ */
+#define YORI_LIB_LINE_READ_MAP_WINDOW (4 * 1024 * 1024)
+
+/**
+ The minimum number of bytes remaining in a disk file for the file to be
+ read through a mapped view.  Smaller files are read into a buffer, which
+ has lower setup cost.
+ */
+#define YORI_LIB_LINE_READ_MAP_MINIMUM (256 * 1024)
+
 /**
  Context to be passed between repeated line read calls to contain data
  that doesn't constitute a whole line but cannot be left in the incoming
@@ -66,6 +80,51 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
      */
     DWORD FileType;
 
+    /**
+     A handle to a mapping of the file when lines are being read from a
+     mapped view rather than via ReadFile.  NULL if the file is not mapped.
+     */
+    HANDLE MappingHandle;
+
+    /**
+     Pointer to the currently mapped view of the file, or NULL if no view
+     is mapped.
+     */
+    PUCHAR MappedView;
+
+    /**
+     The number of bytes in MappedView.
+     */
+    DWORD MappedViewLength;
+
+    /**
+     The offset within the file of the start of MappedView.
+     */
+    LONGLONG MappedViewOffset;
+
+    /**
+     The offset within the file of the data that has not yet been returned
+     from the mapping.
+     */
+    LONGLONG MappedOffset;
+
+    /**
+     The size of the file when the mapping was created.
+     */
+    LONGLONG MappedFileSize;
+
+    /**
+     The granularity that mapped views must be aligned to.
+     */
+    DWORD MapGranularity;
+
+    /**
+     If TRUE, the input encoding represents characters below 0x80 as single
+     bytes with the same value as the UTF16 character, so lines of these
+     characters can be widened without calling the conversion routine.
+     */
+    BOOLEAN InputAsciiCompatible;
+
     /**
      If TRUE, the read operation is performed on 16 bit characters.  If FALSE,
      the input contains 8 bit characters.  Unlike most other encodings, this
@@ -314,9 +373,573 @@ YoriLibReadLineAllocateContext(VOID)
     }
     ReadContext->PreviousBuffer = NULL;
     ReadContext->LengthOfBuffer = 0;
+    ReadContext->MappingHandle = NULL;
+    ReadContext->MappedView = NULL;
     return ReadContext;
 }
 
+/**
+ Scan an 8 bit buffer for the first carriage return or line feed.  Data is
+ examined a machine word at a time, so that lines can be located without
+ testing each byte individually.  This is written in portable C rather than
+ processor specific vector instructions so that it can be used with every
+ supported compiler and architecture.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of bytes in the buffer.
+
+ @param HighBitsFound On completion, set to TRUE if any byte preceding the
+        line ending has its high bit set.  This value is not modified if no
+        such byte is found, allowing a caller to accumulate the result across
+        multiple calls.
+
+ @return The offset of the first carriage return or line feed, or Length if
+         the buffer contains neither.
+ */
+YORI_ALLOC_SIZE_T
+YoriLibLineReadFindLineEnd(
+    __in PUCHAR Buffer,
+    __in YORI_ALLOC_SIZE_T Length,
+    __inout PBOOLEAN HighBitsFound
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    DWORD_PTR LowBytes;
+    DWORD_PTR HighBytes;
+    DWORD_PTR CrBytes;
+    DWORD_PTR LfBytes;
+    DWORD_PTR Word;
+    DWORD_PTR Test;
+    DWORD_PTR Accumulated;
+    UCHAR AccumulatedByte;
+
+    //
+    //  Construct constants containing a repeated byte value in every byte
+    //  of a machine word, so this works for 32 and 64 bit words.
+    //
+
+    LowBytes = ((DWORD_PTR)-1) / 0xFF;
+    HighBytes = LowBytes * 0x80;
+    CrBytes = LowBytes * 0x0D;
+    LfBytes = LowBytes * 0x0A;
+
+    Accumulated = 0;
+    AccumulatedByte = 0;
+    Index = 0;
+
+    //
+    //  Check individual bytes until the buffer is aligned.
+    //
+
+    while (Index < Length && ((DWORD_PTR)&Buffer[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            goto Found;
+        }
+        AccumulatedByte = (UCHAR)(AccumulatedByte | Buffer[Index]);
+        Index++;
+    }
+
+    //
+    //  Check a word at a time.  XORing the word with a repeated CR or LF
+    //  value produces a zero byte wherever that character is present, and
+    //  (Value - LowBytes) & ~Value & HighBytes is nonzero if and only if
+    //  Value contains a zero byte.
+    //
+
+    while (Index + sizeof(DWORD_PTR) <= Length) {
+        Word = *(DWORD_PTR *)&Buffer[Index];
+        Test = Word ^ CrBytes;
+        if (((Test - LowBytes) & ~Test & HighBytes) != 0) {
+            break;
+        }
+        Test = Word ^ LfBytes;
+        if (((Test - LowBytes) & ~Test & HighBytes) != 0) {
+            break;
+        }
+        Accumulated = Accumulated | Word;
+        Index = Index + sizeof(DWORD_PTR);
+    }
+
+    //
+    //  Check the remaining bytes, including the word containing the line
+    //  ending if one was found.
+    //
+
+    while (Index < Length) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            break;
+        }
+        AccumulatedByte = (UCHAR)(AccumulatedByte | Buffer[Index]);
+        Index++;
+    }
+
+Found:
+
+    if ((Accumulated & HighBytes) != 0 || (AccumulatedByte & 0x80) != 0) {
+        *HighBitsFound = TRUE;
+    }
+
+    return Index;
+}
+
+/**
+ Copy a line described by a line view into a user specified buffer.  UTF16
+ input and input consisting only of ASCII characters in an encoding where
+ they are represented as single bytes are copied directly, and anything
+ else is converted via YoriLibCopyLineToUserBufferW.
+
+ @param View Pointer to the line view to copy.
+
+ @param UserString The user provided string to populate with a line.  This
+        will be reallocated if it is not large enough.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibLineViewToString(
+    __in PYORI_LIB_LINE_VIEW View,
+    __inout PYORI_STRING UserString
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    PUCHAR SourceBuffer;
+
+    if (View->NeedsConversion) {
+        return YoriLibCopyLineToUserBufferW(UserString, (LPSTR)View->Buffer, View->LengthInChars);
+    }
+
+    if (View->LengthInChars + 1 > UserString->LengthAllocated) {
+        UserString->LengthInChars = 0;
+        if (!YoriLibReallocateString(UserString, View->LengthInChars + 1 + 64)) {
+            return FALSE;
+        }
+    }
+
+    if (View->WideChars) {
+        memcpy(UserString->StartOfString, View->Buffer, View->LengthInChars * sizeof(WCHAR));
+    } else {
+        SourceBuffer = (PUCHAR)View->Buffer;
+        for (Index = 0; Index < View->LengthInChars; Index++) {
+            UserString->StartOfString[Index] = SourceBuffer[Index];
+        }
+    }
+
+    UserString->LengthInChars = View->LengthInChars;
+    UserString->StartOfString[UserString->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Return the number of UTF16 characters that a line view would contain once
+ converted into host encoding.  This does not require the line to be
+ converted unless it contains characters that are not represented directly.
+
+ @param View Pointer to the line view.
+
+ @return The number of UTF16 characters in the line.
+ */
+YORI_ALLOC_SIZE_T
+YoriLibLineViewLengthInChars(
+    __in PYORI_LIB_LINE_VIEW View
+    )
+{
+    if (View->NeedsConversion && View->LengthInChars > 0) {
+        return (YORI_ALLOC_SIZE_T)YoriLibGetMultibyteInputSizeNeeded((LPCSTR)View->Buffer, View->LengthInChars);
+    }
+
+    return View->LengthInChars;
+}
+
+/**
+ Return a line that has been located in an input buffer.  If the caller
+ requested a line view, the view is updated to refer to the line in the
+ input buffer.  Otherwise, the line is copied into the user's string.
+
+ @param ReadContext Pointer to the line read context.
+
+ @param UserString The user provided string to populate with a line.
+
+ @param View Optionally points to a line view to populate instead of
+        copying the line into UserString.
+
+ @param SourceBuffer Pointer to the line within the input buffer.
+
+ @param CharsToCopy The number of characters in the line.  Note this may
+        mean 8 bit or 16 bit characters depending on input encoding.
+
+ @param HighBitsFound TRUE if any byte within the line has its high bit
+        set, meaning it cannot be widened directly.
+
+ @param LineEnding Specifies the line ending that terminated the line.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibLineReadReturnLine(
+    __in PYORI_LIB_LINE_READ_CONTEXT ReadContext,
+    __inout PYORI_STRING UserString,
+    __out_opt PYORI_LIB_LINE_VIEW View,
+    __in PVOID SourceBuffer,
+    __in YORI_ALLOC_SIZE_T CharsToCopy,
+    __in BOOLEAN HighBitsFound,
+    __in YORI_LIB_LINE_ENDING LineEnding
+    )
+{
+    YORI_LIB_LINE_VIEW LocalView;
+
+    LocalView.Buffer = SourceBuffer;
+    LocalView.LengthInChars = CharsToCopy;
+    LocalView.LineEnding = LineEnding;
+    LocalView.WideChars = ReadContext->ReadWChars;
+    LocalView.NeedsConversion = FALSE;
+    if (!ReadContext->ReadWChars &&
+        (HighBitsFound || !ReadContext->InputAsciiCompatible)) {
+
+        LocalView.NeedsConversion = TRUE;
+    }
+
+    if (View != NULL) {
+        memcpy(View, &LocalView, sizeof(YORI_LIB_LINE_VIEW));
+        return TRUE;
+    }
+
+    return YoriLibLineViewToString(&LocalView, UserString);
+}
+
+/**
+ Stop reading a file through a mapped view.  If a file handle is specified,
+ the file position is updated to refer to the data that has not yet been
+ returned, so that reading can continue with ReadFile.
+
+ @param ReadContext Pointer to the line read context.
+
+ @param FileHandle Optionally specifies the file being read.
+ */
+VOID
+YoriLibLineReadStopMapping(
+    __in PYORI_LIB_LINE_READ_CONTEXT ReadContext,
+    __in_opt HANDLE FileHandle
+    )
+{
+    LARGE_INTEGER Position;
+
+    if (ReadContext->MappedView != NULL) {
+        UnmapViewOfFile(ReadContext->MappedView);
+        ReadContext->MappedView = NULL;
+    }
+
+    if (ReadContext->MappingHandle != NULL) {
+        CloseHandle(ReadContext->MappingHandle);
+        ReadContext->MappingHandle = NULL;
+
+        if (FileHandle != NULL) {
+            Position.QuadPart = ReadContext->MappedOffset;
+            SetFilePointer(FileHandle, Position.LowPart, &Position.HighPart, FILE_BEGIN);
+        }
+    }
+}
+
+/**
+ Attempt to read a disk file through a mapped view rather than via
+ ReadFile.  This avoids copying data into an intermediate buffer before
+ copying each line to the caller.  If the file cannot be mapped, the
+ caller continues to use ReadFile.
+
+ @param ReadContext Pointer to the line read context.
+
+ @param FileHandle Specifies the file being read.
+ */
+VOID
+YoriLibLineReadStartMapping(
+    __in PYORI_LIB_LINE_READ_CONTEXT ReadContext,
+    __in HANDLE FileHandle
+    )
+{
+    LARGE_INTEGER Position;
+    LARGE_INTEGER FileSize;
+    SYSTEM_INFO SystemInfo;
+
+    Position.HighPart = 0;
+    Position.LowPart = SetFilePointer(FileHandle, 0, &Position.HighPart, FILE_CURRENT);
+    if (Position.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) {
+        return;
+    }
+
+    FileSize.HighPart = 0;
+    FileSize.LowPart = GetFileSize(FileHandle, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return;
+    }
+
+    if (FileSize.QuadPart < Position.QuadPart + YORI_LIB_LINE_READ_MAP_MINIMUM) {
+        return;
+    }
+
+    //
+    //  UTF16 input is scanned as an array of 16 bit characters, so the
+    //  data must start on a 16 bit boundary.
+    //
+
+    if (ReadContext->ReadWChars && (Position.LowPart % sizeof(WCHAR)) != 0) {
+        return;
+    }
+
+    GetSystemInfo(&SystemInfo);
+    if (SystemInfo.dwAllocationGranularity == 0 ||
+        SystemInfo.dwAllocationGranularity >= YORI_LIB_LINE_READ_MAP_WINDOW / 2) {
+
+        return;
+    }
+
+    ReadContext->MappingHandle = CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (ReadContext->MappingHandle == NULL) {
+        return;
+    }
+
+    ReadContext->MapGranularity = SystemInfo.dwAllocationGranularity;
+    ReadContext->MappedOffset = Position.QuadPart;
+    ReadContext->MappedFileSize = FileSize.QuadPart;
+    ReadContext->MappedViewOffset = 0;
+    ReadContext->MappedViewLength = 0;
+    ReadContext->MappedView = NULL;
+}
+
+/**
+ Map a view of the file which starts at or before the data that has not yet
+ been returned.
+
+ @param ReadContext Pointer to the line read context.
+
+ @return TRUE to indicate a view was mapped, FALSE if it could not be.
+ */
+__success(return)
+BOOL
+YoriLibLineReadMapWindow(
+    __in PYORI_LIB_LINE_READ_CONTEXT ReadContext
+    )
+{
+    LARGE_INTEGER ViewOffset;
+    LONGLONG ViewLength;
+
+    if (ReadContext->MappedView != NULL) {
+        UnmapViewOfFile(ReadContext->MappedView);
+        ReadContext->MappedView = NULL;
+    }
+
+    ViewOffset.QuadPart = ReadContext->MappedOffset - (ReadContext->MappedOffset % ReadContext->MapGranularity);
+    ViewLength = ReadContext->MappedFileSize - ViewOffset.QuadPart;
+    if (ViewLength > YORI_LIB_LINE_READ_MAP_WINDOW) {
+        ViewLength = YORI_LIB_LINE_READ_MAP_WINDOW;
+    }
+
+    ReadContext->MappedView = MapViewOfFile(ReadContext->MappingHandle,
+                                            FILE_MAP_READ,
+                                            ViewOffset.HighPart,
+                                            ViewOffset.LowPart,
+                                            (SIZE_T)ViewLength);
+
+    if (ReadContext->MappedView == NULL) {
+        return FALSE;
+    }
+
+    ReadContext->MappedViewOffset = ViewOffset.QuadPart;
+    ReadContext->MappedViewLength = (DWORD)ViewLength;
+
+    //
+    //  Views overlap where a line spans them, so only count the data beyond
+    //  what has already been returned.
+    //
+
+    if (YoriLibStats.Enabled) {
+        YoriLibStatisticsRecordRead((DWORD)(ViewLength - (ReadContext->MappedOffset - ViewOffset.QuadPart)));
+    }
+    return TRUE;
+}
+
+/**
+ Attempt to return the next line of a file from a mapped view.  If a
+ complete line cannot be found within the file as it was when mapped, the
+ mapping is torn down and the file position is updated so that the caller
+ can continue with ReadFile.  This allows a final line without a line
+ ending, or data appended to the file afterwards, to be handled in the
+ same way as for a file that was never mapped.
+
+ @param ReadContext Pointer to the line read context.
+
+ @param UserString The user provided string to populate with a line.
+
+ @param FileHandle Specifies the file being read.
+
+ @param LineEnding On successful completion, set to indicate the string of
+        characters used to terminate the line.
+
+ @param View Optionally points to a line view to populate instead of
+        copying the line into UserString.
+
+ @param CurrentViewOnly If TRUE, only return a line if it is within the
+        currently mapped view.  If it is not, return FALSE without changing
+        the view, so that previously returned line views remain valid.
+
+ @return TRUE to indicate a line was returned.  FALSE to indicate the caller
+         should continue with ReadFile, unless the context has been marked
+         as terminated due to allocation failure or CurrentViewOnly is TRUE.
+ */
+__success(return)
+BOOL
+YoriLibReadLineFromMapping(
+    __in PYORI_LIB_LINE_READ_CONTEXT ReadContext,
+    __inout PYORI_STRING UserString,
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_LINE_ENDING LineEnding,
+    __out_opt PYORI_LIB_LINE_VIEW View,
+    __in BOOLEAN CurrentViewOnly
+    )
+{
+    PUCHAR Buffer;
+    PWCHAR WideBuffer;
+    YORI_ALLOC_SIZE_T CharsRemaining;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_ALLOC_SIZE_T CharsToCopy;
+    YORI_ALLOC_SIZE_T CharsToSkip;
+    YORI_ALLOC_SIZE_T CharSize;
+    LONGLONG ViewEnd;
+    YORI_LIB_LINE_ENDING LocalLineEnding;
+    BOOLEAN HighBitsFound;
+    BOOLEAN LineFound;
+
+    CharSize = sizeof(UCHAR);
+    if (ReadContext->ReadWChars) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    while (TRUE) {
+
+        if (ReadContext->MappedOffset >= ReadContext->MappedFileSize) {
+            break;
+        }
+
+        if (ReadContext->MappedView == NULL ||
+            ReadContext->MappedOffset < ReadContext->MappedViewOffset ||
+            ReadContext->MappedOffset >= ReadContext->MappedViewOffset + ReadContext->MappedViewLength) {
+
+            if (CurrentViewOnly) {
+                return FALSE;
+            }
+
+            if (!YoriLibLineReadMapWindow(ReadContext)) {
+                break;
+            }
+        }
+
+        ViewEnd = ReadContext->MappedViewOffset + ReadContext->MappedViewLength;
+        Buffer = ReadContext->MappedView + (DWORD)(ReadContext->MappedOffset - ReadContext->MappedViewOffset);
+        CharsRemaining = (YORI_ALLOC_SIZE_T)((ViewEnd - ReadContext->MappedOffset) / CharSize);
+        WideBuffer = (PWCHAR)Buffer;
+
+        //
+        //  Scan for a line ending.  While scanning 8 bit input, record
+        //  whether any character needs conversion.
+        //
+
+        LineFound = FALSE;
+        HighBitsFound = FALSE;
+        LocalLineEnding = YoriLibLineEndingNone;
+        Count = 0;
+        if (ReadContext->ReadWChars) {
+            for (Count = 0; Count < CharsRemaining; Count++) {
+                if (WideBuffer[Count] == 0xD || WideBuffer[Count] == 0xA) {
+                    LineFound = TRUE;
+                    break;
+                }
+            }
+        } else {
+            Count = YoriLibLineReadFindLineEnd(Buffer, CharsRemaining, &HighBitsFound);
+            if (Count < CharsRemaining) {
+                LineFound = TRUE;
+            }
+        }
+
+        CharsToCopy = Count;
+        if (LineFound) {
+            LocalLineEnding = YoriLibLineEndingLF;
+            if ((ReadContext->ReadWChars && WideBuffer[Count] == 0xD) ||
+                (!ReadContext->ReadWChars && Buffer[Count] == 0xD)) {
+
+                LocalLineEnding = YoriLibLineEndingCR;
+
+                //
+                //  If the carriage return is the final character in the
+                //  view, whether it is followed by a line feed is not yet
+                //  known.
+                //
+
+                if (Count + 1 >= CharsRemaining) {
+                    LineFound = FALSE;
+                } else if ((ReadContext->ReadWChars && WideBuffer[Count + 1] == 0xA) ||
+                           (!ReadContext->ReadWChars && Buffer[Count + 1] == 0xA)) {
+                    Count++;
+                    LocalLineEnding = YoriLibLineEndingCRLF;
+                }
+            }
+            Count++;
+        }
+
+        if (!LineFound) {
+
+            if (CurrentViewOnly) {
+                return FALSE;
+            }
+
+            //
+            //  If the view ends before the file does and does not start
+            //  with this line, map a view starting from this line and
+            //  look again.  Otherwise the line is at the end of the file
+            //  or is too long for a view, so let ReadFile handle it.
+            //
+
+            if (ViewEnd < ReadContext->MappedFileSize &&
+                ReadContext->MappedViewOffset + ReadContext->MapGranularity <= ReadContext->MappedOffset) {
+
+                if (!YoriLibLineReadMapWindow(ReadContext)) {
+                    break;
+                }
+                continue;
+            }
+            break;
+        }
+
+        CharsToSkip = 0;
+        if (ReadContext->LinesRead == 0) {
+            CharsToSkip = YoriLibBytesInBom(Buffer, CharsToCopy * CharSize);
+            if (CharsToSkip > 0) {
+                CharsToSkip = CharsToSkip / CharSize;
+                CharsToCopy = CharsToCopy - CharsToSkip;
+            }
+        }
+
+        if (!YoriLibLineReadReturnLine(ReadContext, UserString, View, Buffer + CharsToSkip * CharSize, CharsToCopy, HighBitsFound, LocalLineEnding)) {
+            UserString->LengthInChars = 0;
+            *LineEnding = YoriLibLineEndingNone;
+            ReadContext->Terminated = TRUE;
+            YoriLibLineReadStopMapping(ReadContext, NULL);
+            return FALSE;
+        }
+
+        ReadContext->MappedOffset = ReadContext->MappedOffset + Count * CharSize;
+        ReadContext->LinesRead++;
+        *LineEnding = LocalLineEnding;
+        return TRUE;
+    }
+
+    if (!CurrentViewOnly) {
+        YoriLibLineReadStopMapping(ReadContext, FileHandle);
+    }
+    return FALSE;
+}
+
 /**
  Close a line read context, and store it in the cache if there is an
  available slot for it.  After using this routine, a caller is expected to
@@ -329,6 +952,10 @@ YoriLibLineReadCloseOrCache(
     __in_opt PVOID Context
     )
 {
+    if (Context != NULL) {
+        YoriLibLineReadStopMapping((PYORI_LIB_LINE_READ_CONTEXT)Context, NULL);
+    }
+
     if (YoriLibIsInterlockedCompareExchangePointerAvailable()) {
         PYORI_LIB_LINE_READ_CONTEXT ReadContext = (PYORI_LIB_LINE_READ_CONTEXT)Context;
         PYORI_LIB_LINE_READ_CONTEXT OldContext;
@@ -380,7 +1007,8 @@ YoriLibLineReadCleanupCache(VOID)
 
 
 /**
- Read a line from an input stream.
+ Read a line from an input stream, either copying it into a caller's string
+ or returning a view of it within the line read context's buffer.
 
  @param UserString Pointer to a string to be updated to contain data for a
         line.  This must be initialized by the caller and the caller's buffer
@@ -413,17 +1041,30 @@ YoriLibLineReadCleanupCache(VOID)
         the timeout value in MaximumDelay was reached.  If MaximumDelay is
         INFINITE, this cannot happen.
 
- @return Pointer to the Line buffer for success, NULL on failure.
+ @param View Optionally points to a line view to populate instead of
+        copying the line into UserString.  The view refers to memory owned
+        by the line read context and remains valid until the next call.
+
+ @param BufferedOnly If TRUE, only return a line if it is already complete
+        within data that has been read.  If no such line exists, return
+        FALSE without reading or moving data, so that previously returned
+        line views remain valid.
+
+ @return TRUE to indicate a line was returned, FALSE on failure or if no
+         more lines are available.
  */
-PVOID
-YoriLibReadLineToStringEx(
-    __in PYORI_STRING UserString,
+__success(return)
+BOOL
+YoriLibReadLineWorker(
+    __inout PYORI_STRING UserString,
     __inout PVOID * Context,
     __in BOOL ReturnFinalNonTerminatedLine,
     __in DWORD MaximumDelay,
     __in HANDLE FileHandle,
     __out PYORI_LIB_LINE_ENDING LineEnding,
-    __out PBOOL TimeoutReached
+    __out PBOOL TimeoutReached,
+    __out_opt PYORI_LIB_LINE_VIEW View,
+    __in BOOLEAN BufferedOnly
     )
 {
     PYORI_LIB_LINE_READ_CONTEXT ReadContext;
@@ -454,7 +1095,7 @@ YoriLibReadLineToStringEx(
         if (ReadContext == NULL) {
             UserString->LengthInChars = 0;
             *LineEnding = YoriLibLineEndingNone;
-            return NULL;
+            return FALSE;
         }
         *Context = ReadContext;
         ReadContext->BytesInBuffer = 0;
@@ -466,11 +1107,33 @@ YoriLibReadLineToStringEx(
         } else {
             ReadContext->ReadWChars = FALSE;
         }
+        ReadContext->InputAsciiCompatible = FALSE;
+        if (YoriLibGetMultibyteInputEncoding() == CP_UTF8) {
+            ReadContext->InputAsciiCompatible = TRUE;
+        }
         ReadContext->Terminated = FALSE;
+        if (ReadContext->FileType == FILE_TYPE_DISK) {
+            YoriLibLineReadStartMapping(ReadContext, FileHandle);
+        }
     } else {
         ReadContext = *Context;
         if (ReadContext->Terminated) {
-            return NULL;
+            return FALSE;
+        }
+    }
+
+    //
+    //  If the file is mapped, try to find the next line in the mapped view.
+    //  If this cannot find a complete line, the mapping is torn down and
+    //  the file is read from the same point via ReadFile below.
+    //
+
+    if (ReadContext->MappingHandle != NULL) {
+        if (YoriLibReadLineFromMapping(ReadContext, UserString, FileHandle, LineEnding, View, BufferedOnly)) {
+            return TRUE;
+        }
+        if (ReadContext->Terminated || BufferedOnly) {
+            return FALSE;
         }
     }
 
@@ -498,7 +1161,7 @@ YoriLibReadLineToStringEx(
             UserString->LengthInChars = 0;
             *LineEnding = YoriLibLineEndingNone;
             ReadContext->Terminated = TRUE;
-            return NULL;
+            return FALSE;
         }
     }
 
@@ -551,25 +1214,31 @@ YoriLibReadLineToStringEx(
                                 CharsToCopy = CharsToCopy - CharsToSkip;
                             }
                         }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&WideBuffer[CharsToSkip], CharsToCopy)) {
+                        if (YoriLibLineReadReturnLine(ReadContext, UserString, View, &WideBuffer[CharsToSkip], CharsToCopy, FALSE, LocalLineEnding)) {
                             ReadContext->CurrentBufferOffset = ReadContext->CurrentBufferOffset + Count * sizeof(WCHAR);
                             ReadContext->LinesRead++;
                             *LineEnding = LocalLineEnding;
-                            return UserString->StartOfString;
+                            return TRUE;
                         } else {
                             UserString->LengthInChars = 0;
                             *LineEnding = YoriLibLineEndingNone;
                             ReadContext->Terminated = TRUE;
-                            return NULL;
+                            return FALSE;
                         }
                     }
                 }
             }
         } else {
             PUCHAR Buffer = YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->CurrentBufferOffset);
+            BOOLEAN HighBitsFound = FALSE;
             CharsRemaining = ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset;
             for (Count = 0; Count < CharsRemaining; Count++) {
 
+                Count = Count + YoriLibLineReadFindLineEnd(&Buffer[Count], CharsRemaining - Count, &HighBitsFound);
+                if (Count >= CharsRemaining) {
+                    break;
+                }
+
                 if (Buffer[Count] == 0xD ||
                     Buffer[Count] == 0xA) {
 
@@ -602,22 +1271,34 @@ YoriLibReadLineToStringEx(
                                 CharsToCopy = CharsToCopy - CharsToSkip;
                             }
                         }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&Buffer[CharsToSkip], CharsToCopy)) {
+                        if (YoriLibLineReadReturnLine(ReadContext, UserString, View, &Buffer[CharsToSkip], CharsToCopy, HighBitsFound, LocalLineEnding)) {
                             ReadContext->CurrentBufferOffset = ReadContext->CurrentBufferOffset + Count;
                             ReadContext->LinesRead++;
                             *LineEnding = LocalLineEnding;
-                            return UserString->StartOfString;
+                            return TRUE;
                         } else {
                             UserString->LengthInChars = 0;
                             *LineEnding = YoriLibLineEndingNone;
                             ReadContext->Terminated = TRUE;
-                            return NULL;
+                            return FALSE;
                         }
                     }
                 }
             }
         }
 
+        //
+        //  If the caller only wants lines that are already in the buffer,
+        //  stop here.  Moving or reading data would invalidate any line
+        //  views that have already been returned.
+        //
+
+        if (BufferedOnly) {
+            UserString->LengthInChars = 0;
+            *LineEnding = YoriLibLineEndingNone;
+            return FALSE;
+        }
+
         //
         //  We haven't found any lines.  Move the contents that are still
         //  unprocessed to the front of the buffer.
@@ -642,7 +1323,7 @@ YoriLibReadLineToStringEx(
             UserString->LengthInChars = 0;
             *LineEnding = YoriLibLineEndingNone;
             ReadContext->Terminated = TRUE;
-            return NULL;
+            return FALSE;
         }
 
         //
@@ -744,6 +1425,9 @@ YoriLibReadLineToStringEx(
             while(TRUE) {
                 if (ReadFile(FileHandle, YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->BytesInBuffer), BytesToRead, &BytesRead, NULL)) {
                     LastError = ERROR_SUCCESS;
+                    if (YoriLibStats.Enabled) {
+                        YoriLibStatisticsRecordRead(BytesRead);
+                    }
                     break;
                 }
 
@@ -821,16 +1505,16 @@ YoriLibReadLineToStringEx(
                     if (ReadContext->ReadWChars) {
                         CharsToCopy = CharsToCopy / sizeof(WCHAR);
                     }
-                    if (YoriLibCopyLineToUserBufferW(UserString, &ReadContext->PreviousBuffer[CharsToSkip], CharsToCopy)) {
+                    if (YoriLibLineReadReturnLine(ReadContext, UserString, View, &ReadContext->PreviousBuffer[CharsToSkip], CharsToCopy, TRUE, YoriLibLineEndingNone)) {
                         ReadContext->BytesInBuffer = 0;
                         *LineEnding = YoriLibLineEndingNone;
-                        return UserString->StartOfString;
+                        return TRUE;
                     }
                 }
             }
             UserString->LengthInChars = 0;
             *LineEnding = YoriLibLineEndingNone;
-            return NULL;
+            return FALSE;
         }
 
         ReadContext->BytesInBuffer = ReadContext->BytesInBuffer + (YORI_ALLOC_SIZE_T)BytesRead;
@@ -838,6 +1522,60 @@ YoriLibReadLineToStringEx(
     } while(TRUE);
 }
 
+/**
+ Read a line from an input stream.
+
+ @param UserString Pointer to a string to be updated to contain data for a
+        line.  This must be initialized by the caller and the caller's buffer
+        will be used if it is large enough.  If not, this function may
+        reallocate the string to point to a new buffer.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param ReturnFinalNonTerminatedLine If TRUE, treat any line at the end of the
+        stream without a line ending character to be a line to return.  If
+        FALSE, assume new input could arrive that means we just haven't
+        observed the line break yet.
+
+ @param MaximumDelay Specifies the maximum amount of time to wait for a
+        complete line.  This value can be INFINITE or a specified number of
+        milliseconds.  If the timeout value is reached, TimeoutReached will
+        be set to true and the function will return NULL.
+
+ @param FileHandle Specifies the handle to the file to read the line from.
+
+ @param LineEnding On successful completion, set to indicate the string of
+        characters used to terminate the line.  Can be YoriLibLineEndingNone
+        to indicate no line end was found, which can happen if
+        ReturnFinalNonTerminatedLine is TRUE or MaximumDelay is less than
+        infinite and a partial line was found.
+
+ @param TimeoutReached On successful completion, set to TRUE to indicate that
+        the timeout value in MaximumDelay was reached.  If MaximumDelay is
+        INFINITE, this cannot happen.
+
+ @return Pointer to the Line buffer for success, NULL on failure.
+ */
+PVOID
+YoriLibReadLineToStringEx(
+    __in PYORI_STRING UserString,
+    __inout PVOID * Context,
+    __in BOOL ReturnFinalNonTerminatedLine,
+    __in DWORD MaximumDelay,
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_LINE_ENDING LineEnding,
+    __out PBOOL TimeoutReached
+    )
+{
+    if (!YoriLibReadLineWorker(UserString, Context, ReturnFinalNonTerminatedLine, MaximumDelay, FileHandle, LineEnding, TimeoutReached, NULL, FALSE)) {
+        return NULL;
+    }
+
+    return UserString->StartOfString;
+}
+
 /**
  Read a line from an input stream.
 
@@ -867,6 +1605,99 @@ YoriLibReadLineToString(
     return YoriLibReadLineToStringEx(UserString, Context, TRUE, INFINITE, FileHandle, &LineEnding, &TimeoutReached);
 }
 
+/**
+ Read a line from an input stream without copying it.  The returned view
+ refers to the line within the line read context's buffer in the input
+ encoding, and remains valid until the next call using the same context.
+ This allows callers that only need to count or skip lines to avoid
+ converting and copying each line.  A view can be converted to a string
+ with YoriLibLineViewToString as needed.
+
+ @param View On successful completion, updated to describe the line.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param FileHandle Specifies the handle to the file to read the line from.
+
+ @return TRUE to indicate a line was returned, FALSE on failure or if no
+         more lines are available.
+ */
+__success(return)
+BOOL
+YoriLibReadLineView(
+    __out PYORI_LIB_LINE_VIEW View,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    )
+{
+    YORI_STRING UnusedString;
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
+
+    YoriLibInitEmptyString(&UnusedString);
+    return YoriLibReadLineWorker(&UnusedString, Context, TRUE, INFINITE, FileHandle, &LineEnding, &TimeoutReached, View, FALSE);
+}
+
+/**
+ Read a batch of lines from an input stream without copying them.  This
+ waits for at least one line, then returns as many further lines as are
+ already complete within the data that has been read, up to the size of
+ the caller's array.  The returned views refer to the line read context's
+ buffer and remain valid until the next call using the same context.
+
+ @param Views Pointer to an array of line views to populate.
+
+ @param MaximumViews The number of elements in the Views array.
+
+ @param ViewsReturned On successful completion, set to the number of
+        elements in the Views array that were populated.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param FileHandle Specifies the handle to the file to read the lines from.
+
+ @return TRUE to indicate one or more lines were returned, FALSE on failure
+         or if no more lines are available.
+ */
+__success(return)
+BOOL
+YoriLibReadLineViews(
+    __out_ecount(MaximumViews) PYORI_LIB_LINE_VIEW Views,
+    __in YORI_ALLOC_SIZE_T MaximumViews,
+    __out PYORI_ALLOC_SIZE_T ViewsReturned,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    )
+{
+    YORI_STRING UnusedString;
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
+    YORI_ALLOC_SIZE_T Count;
+
+    *ViewsReturned = 0;
+    if (MaximumViews == 0) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&UnusedString);
+    if (!YoriLibReadLineWorker(&UnusedString, Context, TRUE, INFINITE, FileHandle, &LineEnding, &TimeoutReached, &Views[0], FALSE)) {
+        return FALSE;
+    }
+
+    for (Count = 1; Count < MaximumViews; Count++) {
+        if (!YoriLibReadLineWorker(&UnusedString, Context, TRUE, INFINITE, FileHandle, &LineEnding, &TimeoutReached, &Views[Count], TRUE)) {
+            break;
+        }
+    }
+
+    *ViewsReturned = Count;
+    return TRUE;
+}
+
 /**
  Free any context allocated by YoriLibReadLineFromFile .
 
@@ -879,6 +1710,7 @@ YoriLibLineReadClose(
 {
     PYORI_LIB_LINE_READ_CONTEXT ReadContext = (PYORI_LIB_LINE_READ_CONTEXT)Context;
     if (ReadContext != NULL) {
+        YoriLibLineReadStopMapping(ReadContext, NULL);
         if (ReadContext->PreviousBuffer != NULL) {
             YoriLibFree(ReadContext->PreviousBuffer);
         }
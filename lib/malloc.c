@@ -27,6 +27,393 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+/**
+ The number of stack frames recorded for each sampled allocation when
+ profiling allocations.  Allocations are frequently made via string or
+ referenced allocation helpers, so more than one frame is needed to
+ identify the code responsible.
+ */
+#define YORI_ALLOC_PROFILE_FRAMES (4)
+
+/**
+ The number of distinct call sites that the allocation profiler can record.
+ Allocations from call sites beyond this are counted but not attributed.
+ */
+#define YORI_ALLOC_PROFILE_SITES (4096)
+
+/**
+ The number of call sites to display in an allocation profile report.
+ */
+#define YORI_ALLOC_PROFILE_REPORT_SITES (50)
+
+/**
+ Information about allocations made from a single call site.
+ */
+typedef struct _YORI_ALLOC_PROFILE_SITE {
+
+    /**
+     The return addresses identifying the call site, starting with the
+     caller of the allocation routine.
+     */
+    PVOID Frames[YORI_ALLOC_PROFILE_FRAMES];
+
+    /**
+     When using the special heap, the function that allocated the memory.
+     NULL otherwise.
+     */
+    LPCSTR Function;
+
+    /**
+     When using the special heap, the source file that allocated the
+     memory.  NULL otherwise.
+     */
+    LPCSTR File;
+
+    /**
+     When using the special heap, the line number that allocated the
+     memory.  Zero otherwise.
+     */
+    DWORD Line;
+
+    /**
+     The number of allocations sampled from this call site.
+     */
+    DWORD Count;
+
+    /**
+     The number of bytes in allocations sampled from this call site.
+     */
+    DWORDLONG Bytes;
+} YORI_ALLOC_PROFILE_SITE, *PYORI_ALLOC_PROFILE_SITE;
+
+/**
+ Process global state for the allocation profiler.
+ */
+typedef struct _YORI_ALLOC_PROFILE_GLOBAL {
+
+    /**
+     TRUE once the profiler has checked whether it should be enabled.
+     */
+    BOOLEAN Initialized;
+
+    /**
+     One allocation in this many is recorded.  Zero if profiling is not
+     enabled.
+     */
+    DWORD SampleInterval;
+
+    /**
+     The number of allocations remaining until the next one is recorded.
+     This is not synchronized, so under concurrency sampling is approximate.
+     */
+    DWORD AllocationsUntilSample;
+
+    /**
+     A mutex synchronizing updates to the call site table.
+     */
+    HANDLE Mutex;
+
+    /**
+     An array of YORI_ALLOC_PROFILE_SITES call sites, used as an open
+     addressing hash table.
+     */
+    PYORI_ALLOC_PROFILE_SITE Sites;
+
+    /**
+     The number of entries in Sites that are in use.
+     */
+    DWORD SitesUsed;
+
+    /**
+     The number of sampled allocations that could not be attributed to a
+     call site because the table was full.
+     */
+    DWORD SamplesDropped;
+
+    /**
+     The total number of allocations sampled.
+     */
+    DWORD SamplesTaken;
+} YORI_ALLOC_PROFILE_GLOBAL, *PYORI_ALLOC_PROFILE_GLOBAL;
+
+/**
+ Process global state for the allocation profiler.
+ */
+YORI_ALLOC_PROFILE_GLOBAL YoriLibAllocProfile;
+
+/**
+ Check whether allocation profiling has been requested by setting the
+ YORI_ALLOC_PROFILE environment variable to a sampling interval, and if so,
+ prepare to record allocations.  This is performed on the first allocation,
+ which is expected to occur before any other threads are created.
+ */
+VOID
+YoriLibAllocProfileInitialize(VOID)
+{
+    TCHAR ValueBuffer[16];
+    YORI_STRING Value;
+    YORI_MAX_SIGNED_T SampleInterval;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    DWORD ValueLength;
+
+    YoriLibAllocProfile.Initialized = TRUE;
+
+    ValueLength = GetEnvironmentVariable(_T("YORI_ALLOC_PROFILE"), ValueBuffer, sizeof(ValueBuffer)/sizeof(ValueBuffer[0]));
+    if (ValueLength == 0 || ValueLength >= sizeof(ValueBuffer)/sizeof(ValueBuffer[0])) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&Value);
+    Value.StartOfString = ValueBuffer;
+    Value.LengthInChars = (YORI_ALLOC_SIZE_T)ValueLength;
+
+    if (!YoriLibStringToNumber(&Value, TRUE, &SampleInterval, &CharsConsumed) ||
+        CharsConsumed == 0 ||
+        SampleInterval <= 0) {
+
+        return;
+    }
+
+    YoriLibAllocProfile.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriLibAllocProfile.Mutex == NULL) {
+        return;
+    }
+
+    //
+    //  This table is allocated from the process heap directly so that it is
+    //  not itself recorded.
+    //
+
+    YoriLibAllocProfile.Sites = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, YORI_ALLOC_PROFILE_SITES * sizeof(YORI_ALLOC_PROFILE_SITE));
+    if (YoriLibAllocProfile.Sites == NULL) {
+        CloseHandle(YoriLibAllocProfile.Mutex);
+        YoriLibAllocProfile.Mutex = NULL;
+        return;
+    }
+
+    YoriLibAllocProfile.SampleInterval = (DWORD)SampleInterval;
+    YoriLibAllocProfile.AllocationsUntilSample = 1;
+}
+
+/**
+ Record an allocation in the allocation profile, if profiling is enabled
+ and this allocation is selected for sampling.  This is expected to be
+ called directly from the allocation routine, so that the frames it
+ captures begin with the caller of the allocation routine.
+
+ @param Bytes The number of bytes allocated.
+
+ @param Function When using the special heap, the function that allocated
+        the memory.
+
+ @param File When using the special heap, the source file that allocated
+        the memory.
+
+ @param Line When using the special heap, the line number that allocated
+        the memory.
+ */
+VOID
+YoriLibAllocProfileRecord(
+    __in YORI_ALLOC_SIZE_T Bytes,
+    __in_opt LPCSTR Function,
+    __in_opt LPCSTR File,
+    __in DWORD Line
+    )
+{
+    PVOID Frames[YORI_ALLOC_PROFILE_FRAMES];
+    PYORI_ALLOC_PROFILE_SITE Site;
+    DWORD_PTR Hash;
+    DWORD Index;
+    DWORD Probe;
+
+    if (!YoriLibAllocProfile.Initialized) {
+        YoriLibAllocProfileInitialize();
+    }
+
+    if (YoriLibAllocProfile.SampleInterval == 0) {
+        return;
+    }
+
+    if (YoriLibAllocProfile.AllocationsUntilSample > 1) {
+        YoriLibAllocProfile.AllocationsUntilSample--;
+        return;
+    }
+    YoriLibAllocProfile.AllocationsUntilSample = YoriLibAllocProfile.SampleInterval;
+
+    ZeroMemory(Frames, sizeof(Frames));
+    if (DllKernel32.pRtlCaptureStackBackTrace != NULL) {
+        DllKernel32.pRtlCaptureStackBackTrace(2, YORI_ALLOC_PROFILE_FRAMES, Frames, NULL);
+    }
+
+    Hash = Line;
+    for (Index = 0; Index < YORI_ALLOC_PROFILE_FRAMES; Index++) {
+        Hash = Hash * 31 + (DWORD_PTR)Frames[Index];
+    }
+
+    WaitForSingleObject(YoriLibAllocProfile.Mutex, INFINITE);
+    YoriLibAllocProfile.SamplesTaken++;
+
+    Index = (DWORD)(Hash % YORI_ALLOC_PROFILE_SITES);
+    Site = NULL;
+    for (Probe = 0; Probe < YORI_ALLOC_PROFILE_SITES; Probe++) {
+        Site = &YoriLibAllocProfile.Sites[Index];
+        if (Site->Count == 0) {
+            if (YoriLibAllocProfile.SitesUsed >= YORI_ALLOC_PROFILE_SITES * 3 / 4) {
+                Site = NULL;
+                break;
+            }
+            memcpy(Site->Frames, Frames, sizeof(Frames));
+            Site->Function = Function;
+            Site->File = File;
+            Site->Line = Line;
+            YoriLibAllocProfile.SitesUsed++;
+            break;
+        }
+
+        if (memcmp(Site->Frames, Frames, sizeof(Frames)) == 0 &&
+            Site->Function == Function &&
+            Site->File == File &&
+            Site->Line == Line) {
+
+            break;
+        }
+
+        Index = (Index + 1) % YORI_ALLOC_PROFILE_SITES;
+        Site = NULL;
+    }
+
+    if (Site != NULL) {
+        Site->Count++;
+        Site->Bytes = Site->Bytes + Bytes;
+    } else {
+        YoriLibAllocProfile.SamplesDropped++;
+    }
+
+    ReleaseMutex(YoriLibAllocProfile.Mutex);
+}
+
+/**
+ Display a single frame from an allocation call site, as the name of the
+ module containing it and an offset within that module.
+
+ @param Frame The return address to display.
+ */
+VOID
+YoriLibAllocProfileDisplayFrame(
+    __in PVOID Frame
+    )
+{
+    MEMORY_BASIC_INFORMATION MemoryInfo;
+    TCHAR ModuleName[MAX_PATH];
+    DWORD Length;
+    DWORD Index;
+    LPTSTR FinalComponent;
+
+    FinalComponent = NULL;
+    if (VirtualQuery(Frame, &MemoryInfo, sizeof(MemoryInfo)) != 0 &&
+        MemoryInfo.AllocationBase != NULL) {
+
+        Length = GetModuleFileName((HMODULE)MemoryInfo.AllocationBase, ModuleName, sizeof(ModuleName)/sizeof(ModuleName[0]));
+        if (Length > 0 && Length < sizeof(ModuleName)/sizeof(ModuleName[0])) {
+            FinalComponent = ModuleName;
+            for (Index = 0; Index < Length; Index++) {
+                if (ModuleName[Index] == '\\') {
+                    FinalComponent = &ModuleName[Index + 1];
+                }
+            }
+        }
+    }
+
+    if (FinalComponent != NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("    %s+0x%x\n"),
+                      FinalComponent,
+                      (DWORD)((DWORD_PTR)Frame - (DWORD_PTR)MemoryInfo.AllocationBase));
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("    %p\n"), Frame);
+    }
+}
+
+/**
+ If allocation profiling was enabled by setting the YORI_ALLOC_PROFILE
+ environment variable, display the call sites responsible for the most
+ allocated bytes.  Counts are scaled by the sampling interval to estimate
+ the total for each call site.  When profiling is not enabled, does nothing.
+ */
+VOID
+YoriLibDisplayAllocationProfile(VOID)
+{
+    PYORI_ALLOC_PROFILE_SITE Site;
+    PYORI_ALLOC_PROFILE_SITE BestSite;
+    DWORD SampleInterval;
+    DWORD Index;
+    DWORD FrameIndex;
+    DWORD Reported;
+
+    SampleInterval = YoriLibAllocProfile.SampleInterval;
+    if (SampleInterval == 0) {
+        return;
+    }
+
+    //
+    //  Stop sampling while reporting, since displaying output allocates.
+    //
+
+    WaitForSingleObject(YoriLibAllocProfile.Mutex, INFINITE);
+    YoriLibAllocProfile.SampleInterval = 0;
+    ReleaseMutex(YoriLibAllocProfile.Mutex);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                  _T("Allocation profile: %i samples, one per %i allocations, %i call sites, %i unattributed\n"),
+                  YoriLibAllocProfile.SamplesTaken,
+                  SampleInterval,
+                  YoriLibAllocProfile.SitesUsed,
+                  YoriLibAllocProfile.SamplesDropped);
+
+    //
+    //  Report the sites with the most bytes first.  Each reported site is
+    //  marked by clearing its count so it is not selected again.
+    //
+
+    for (Reported = 0; Reported < YORI_ALLOC_PROFILE_REPORT_SITES; Reported++) {
+        BestSite = NULL;
+        for (Index = 0; Index < YORI_ALLOC_PROFILE_SITES; Index++) {
+            Site = &YoriLibAllocProfile.Sites[Index];
+            if (Site->Count > 0 &&
+                (BestSite == NULL || Site->Bytes > BestSite->Bytes)) {
+
+                BestSite = Site;
+            }
+        }
+
+        if (BestSite == NULL) {
+            break;
+        }
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("%lli bytes in %lli allocations"),
+                      (LONGLONG)(BestSite->Bytes * SampleInterval),
+                      (LONGLONG)BestSite->Count * SampleInterval);
+        if (BestSite->Function != NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                          _T(" from %hs (%hs:%i)"),
+                          BestSite->Function,
+                          BestSite->File,
+                          BestSite->Line);
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n"));
+
+        for (FrameIndex = 0; FrameIndex < YORI_ALLOC_PROFILE_FRAMES; FrameIndex++) {
+            if (BestSite->Frames[FrameIndex] == NULL) {
+                break;
+            }
+            YoriLibAllocProfileDisplayFrame(BestSite->Frames[FrameIndex]);
+        }
+
+        BestSite->Count = 0;
+    }
+}
+
 #if YORI_SPECIAL_HEAP
 
 #if YORI_MAX_ALLOC_SIZE < ((DWORD)-1)
@@ -157,6 +544,10 @@ YoriLibMalloc(
     )
 {
     PVOID Alloc;
+    YoriLibAllocProfileRecord(Bytes, NULL, NULL, 0);
+    if (YoriLibStats.Enabled) {
+        YoriLibStatisticsRecordAllocation(Bytes);
+    }
     Alloc = HeapAlloc(GetProcessHeap(), 0, Bytes);
     return Alloc;
 }
@@ -203,6 +594,11 @@ YoriLibMallocSpecialHeap(
     YORI_SPECIAL_ALLOC_SIZE_T Alignment = sizeof(UCHAR);
 #endif
 
+    YoriLibAllocProfileRecord(Bytes, Function, File, Line);
+    if (YoriLibStats.Enabled) {
+        YoriLibStatisticsRecordAllocation(Bytes);
+    }
+
     StackSize = 0;
     if (DllKernel32.pRtlCaptureStackBackTrace != NULL) {
         StackSize = sizeof(PVOID) * YORI_SPECIAL_HEAP_STACK_FRAMES;
@@ -391,12 +787,26 @@ YoriLibDisplayMemoryUsage(VOID)
  */
 typedef struct _YORILIB_REFERENCED_MALLOC_HEADER {
 
+    /**
+     If the allocation was made from an arena, points to the header of the
+     arena chunk containing it.  References on the allocation are applied
+     to the chunk, which is freed when all allocations within it and the
+     arena have released their references.  NULL for allocations made
+     directly from the heap.
+     */
+    struct _YORILIB_REFERENCED_MALLOC_HEADER *Chunk;
+
     /**
      The number of references on the allocation.
      */
     ULONG ReferenceCount;
 } YORILIB_REFERENCED_MALLOC_HEADER, *PYORILIB_REFERENCED_MALLOC_HEADER;
 
+/**
+ The default number of bytes in each chunk of an arena.
+ */
+#define YORILIB_ARENA_DEFAULT_CHUNK_SIZE (4096)
+
 #if !YORI_SPECIAL_HEAP
 /**
  Allocate a block of memory that can be reference counted and will be freed
@@ -418,6 +828,7 @@ YoriLibReferencedMalloc(
         return NULL;
     }
 
+    Header->Chunk = NULL;
     Header->ReferenceCount = 1;
 
     return (PVOID)(Header + 1);
@@ -455,6 +866,7 @@ YoriLibReferencedMallocSpecialHeap(
         return NULL;
     }
 
+    Header->Chunk = NULL;
     Header->ReferenceCount = 1;
 
     return (PVOID)(Header + 1);
@@ -474,6 +886,10 @@ YoriLibReference(
     PYORILIB_REFERENCED_MALLOC_HEADER Header;
 
     Header = (PYORILIB_REFERENCED_MALLOC_HEADER)Allocation - 1;
+    if (Header->Chunk != NULL) {
+        InterlockedIncrement((LONG *)&Header->Chunk->ReferenceCount);
+        return;
+    }
     Header->ReferenceCount++;
 }
 
@@ -491,12 +907,320 @@ YoriLibDereference(
     PYORILIB_REFERENCED_MALLOC_HEADER Header;
 
     Header = (PYORILIB_REFERENCED_MALLOC_HEADER)Allocation - 1;
+    if (Header->Chunk != NULL) {
+        if (InterlockedDecrement((LONG *)&Header->Chunk->ReferenceCount) == 0) {
+            YoriLibFree(Header->Chunk);
+        }
+        return;
+    }
     Header->ReferenceCount--;
     if (Header->ReferenceCount == 0) {
         YoriLibFree(Header);
     }
 }
 
+/**
+ Prepare an arena for use.  An arena allocates many small reference counted
+ allocations from larger chunks, so that allocations which are expected to
+ be released together do not each require a heap allocation.
+
+ Allocations from an arena are used in the same way as allocations from
+ @ref YoriLibReferencedMalloc , including @ref YoriLibReference and
+ @ref YoriLibDereference , and can outlive the arena.  A chunk is returned
+ to the heap once the arena has moved on from it and every allocation within
+ it has been dereferenced.
+
+ @param Arena Pointer to the arena to initialize.
+
+ @param ChunkSize The number of bytes to allocate from the heap at a time.
+        If zero, a default size is used.
+ */
+VOID
+YoriLibInitializeArena(
+    __out PYORI_LIB_ARENA Arena,
+    __in YORI_ALLOC_SIZE_T ChunkSize
+    )
+{
+    Arena->CurrentChunk = NULL;
+    Arena->BytesUsed = 0;
+    Arena->ChunkSize = ChunkSize;
+    if (Arena->ChunkSize == 0) {
+        Arena->ChunkSize = YORILIB_ARENA_DEFAULT_CHUNK_SIZE;
+    }
+}
+
+/**
+ Release the arena's reference on its current chunk.  The chunk is freed
+ when all allocations within it have also been dereferenced.
+
+ @param Arena Pointer to the arena.
+ */
+VOID
+YoriLibArenaReleaseChunk(
+    __inout PYORI_LIB_ARENA Arena
+    )
+{
+    PYORILIB_REFERENCED_MALLOC_HEADER Chunk;
+
+    Chunk = Arena->CurrentChunk;
+    if (Chunk != NULL) {
+        if (InterlockedDecrement((LONG *)&Chunk->ReferenceCount) == 0) {
+            YoriLibFree(Chunk);
+        }
+        Arena->CurrentChunk = NULL;
+        Arena->BytesUsed = 0;
+    }
+}
+
+/**
+ Allocate a block of memory from an arena that can be reference counted.
+ The allocation is not freed until its final dereference, but the memory is
+ only returned to the heap when all other allocations in the same chunk
+ have also been released.
+
+ @param Arena Pointer to the arena to allocate from.
+
+ @param Bytes The number of bytes to allocate.
+
+ @return Pointer to the allocated block of memory, or NULL on failure.
+ */
+PVOID
+YoriLibArenaReferencedMalloc(
+    __inout PYORI_LIB_ARENA Arena,
+    __in YORI_ALLOC_SIZE_T Bytes
+    )
+{
+#if YORI_SPECIAL_HEAP
+
+    //
+    //  When the special heap is in use, allocate each block seperately so
+    //  that it can detect any misuse.
+    //
+
+    UNREFERENCED_PARAMETER(Arena);
+    return YoriLibReferencedMalloc(Bytes);
+#else
+    PYORILIB_REFERENCED_MALLOC_HEADER Chunk;
+    PYORILIB_REFERENCED_MALLOC_HEADER Header;
+    YORI_ALLOC_SIZE_T BytesNeeded;
+
+    //
+    //  Large allocations would waste much of a chunk, so allocate them
+    //  directly.
+    //
+
+    if (Bytes > Arena->ChunkSize / 4) {
+        return YoriLibReferencedMalloc(Bytes);
+    }
+
+    //
+    //  Round each allocation so that the following header is aligned.
+    //
+
+    BytesNeeded = sizeof(YORILIB_REFERENCED_MALLOC_HEADER) + Bytes;
+    BytesNeeded = (YORI_ALLOC_SIZE_T)((BytesNeeded + sizeof(YORILIB_REFERENCED_MALLOC_HEADER) - 1) & ~(sizeof(YORILIB_REFERENCED_MALLOC_HEADER) - 1));
+
+    if (Arena->CurrentChunk == NULL ||
+        Arena->BytesUsed + BytesNeeded > Arena->ChunkSize) {
+
+        Chunk = YoriLibMalloc(sizeof(YORILIB_REFERENCED_MALLOC_HEADER) + Arena->ChunkSize);
+        if (Chunk == NULL) {
+            return NULL;
+        }
+
+        Chunk->Chunk = NULL;
+        Chunk->ReferenceCount = 1;
+
+        YoriLibArenaReleaseChunk(Arena);
+        Arena->CurrentChunk = Chunk;
+        Arena->BytesUsed = 0;
+    }
+
+    Chunk = Arena->CurrentChunk;
+    Header = YoriLibAddToPointer(Chunk + 1, Arena->BytesUsed);
+    Header->Chunk = Chunk;
+    Header->ReferenceCount = 0;
+    InterlockedIncrement((LONG *)&Chunk->ReferenceCount);
+    Arena->BytesUsed = Arena->BytesUsed + BytesNeeded;
+
+    return (PVOID)(Header + 1);
+#endif
+}
+
+/**
+ Allocate a Yori string from an arena.  The string can be used, referenced
+ and freed in the same way as a string from @ref YoriLibAllocateString .
+
+ @param Arena Pointer to the arena to allocate from.
+
+ @param String Pointer to the string to allocate.
+
+ @param CharsToAllocate The number of characters to allocate in the string.
+
+ @return TRUE to indicate the allocate was successful, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibArenaAllocateString(
+    __inout PYORI_LIB_ARENA Arena,
+    __out PYORI_STRING String,
+    __in YORI_ALLOC_SIZE_T CharsToAllocate
+    )
+{
+    YoriLibInitEmptyString(String);
+    if (CharsToAllocate > YORI_MAX_ALLOC_SIZE / sizeof(TCHAR)) {
+        return FALSE;
+    }
+    String->MemoryToFree = YoriLibArenaReferencedMalloc(Arena, CharsToAllocate * sizeof(TCHAR));
+    if (String->MemoryToFree == NULL) {
+        return FALSE;
+    }
+    String->LengthAllocated = CharsToAllocate;
+    String->StartOfString = String->MemoryToFree;
+    return TRUE;
+}
+
+/**
+ Stop allocating from an arena.  Any memory that is not referenced by an
+ allocation from the arena is returned to the heap.  Allocations from the
+ arena remain valid until they are dereferenced.
+
+ @param Arena Pointer to the arena.
+ */
+VOID
+YoriLibCleanupArena(
+    __inout PYORI_LIB_ARENA Arena
+    )
+{
+    YoriLibArenaReleaseChunk(Arena);
+}
+
+/**
+ The number of elements that a slab allocator attempts to place in each
+ chunk.
+ */
+#define YORILIB_SLAB_ELEMENTS_PER_CHUNK (0x100)
+
+/**
+ Prepare a slab allocator for use.  A slab allocator hands out fixed sized
+ elements from larger chunks.  Element sizes are rounded up to a size class,
+ so structures of similar size can share an allocator.  Elements are
+ reference counted allocations that are released with
+ @ref YoriLibSlabFree , and can outlive the allocator.  Allocations can be
+ made from multiple threads concurrently.
+
+ @param Slab Pointer to the slab allocator to initialize.
+
+ @param ElementSize The size of each element, in bytes.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibInitializeSlab(
+    __out PYORI_LIB_SLAB_ALLOC Slab,
+    __in YORI_ALLOC_SIZE_T ElementSize
+    )
+{
+    YORI_ALLOC_SIZE_T BytesPerElement;
+    YORI_ALLOC_SIZE_T ChunkSize;
+
+    Slab->ElementsAllocated = 0;
+    Slab->ChunksAllocated = 0;
+
+    //
+    //  Round the element to its size class, and calculate the space each
+    //  element consumes within a chunk including its header.
+    //
+
+    ElementSize = (YORI_ALLOC_SIZE_T)((ElementSize + YORI_LIB_SLAB_SIZE_CLASS - 1) & ~(YORI_LIB_SLAB_SIZE_CLASS - 1));
+    Slab->ElementSize = ElementSize;
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)(ElementSize + sizeof(YORILIB_REFERENCED_MALLOC_HEADER)) * YORILIB_SLAB_ELEMENTS_PER_CHUNK)) {
+        return FALSE;
+    }
+
+    BytesPerElement = ElementSize + sizeof(YORILIB_REFERENCED_MALLOC_HEADER);
+    ChunkSize = YoriLibMaximumAllocationInRange(BytesPerElement * 4, BytesPerElement * YORILIB_SLAB_ELEMENTS_PER_CHUNK);
+    if (ChunkSize == 0) {
+        return FALSE;
+    }
+
+    YoriLibInitializeArena(&Slab->Arena, ChunkSize);
+    InitializeCriticalSection(&Slab->Lock);
+    return TRUE;
+}
+
+/**
+ Allocate an element from a slab allocator.
+
+ @param Slab Pointer to the slab allocator.
+
+ @param SizeInBytes The size of the structure the caller requires.  This
+        must not exceed the element size of the allocator.
+
+ @return Pointer to the newly allocated element, or NULL on failure.
+ */
+PVOID
+YoriLibSlabAlloc(
+    __in PYORI_LIB_SLAB_ALLOC Slab,
+    __in YORI_ALLOC_SIZE_T SizeInBytes
+    )
+{
+    PVOID Element;
+    PVOID PreviousChunk;
+
+    ASSERT(SizeInBytes <= Slab->ElementSize);
+    if (SizeInBytes > Slab->ElementSize) {
+        return NULL;
+    }
+
+    EnterCriticalSection(&Slab->Lock);
+    PreviousChunk = Slab->Arena.CurrentChunk;
+    Element = YoriLibArenaReferencedMalloc(&Slab->Arena, Slab->ElementSize);
+    if (Element != NULL) {
+        Slab->ElementsAllocated++;
+        if (Slab->Arena.CurrentChunk != PreviousChunk) {
+            Slab->ChunksAllocated++;
+        }
+    }
+    LeaveCriticalSection(&Slab->Lock);
+
+    return Element;
+}
+
+/**
+ Free an element that was previously allocated from a slab allocator.  The
+ chunk containing the element is returned to the heap when all of its
+ elements have been freed and the allocator has moved to a later chunk or
+ been cleaned up.
+
+ @param Element Pointer to the element to free.
+ */
+VOID
+YoriLibSlabFree(
+    __in PVOID Element
+    )
+{
+    YoriLibDereference(Element);
+}
+
+/**
+ Stop allocating from a slab allocator, returning any memory in the current
+ chunk that has not been allocated to the heap once all of its elements are
+ freed.  Elements that have already been allocated remain valid until they
+ are freed.
+
+ @param Slab Pointer to the slab allocator.
+ */
+VOID
+YoriLibCleanupSlab(
+    __inout PYORI_LIB_SLAB_ALLOC Slab
+    )
+{
+    YoriLibCleanupArena(&Slab->Arena);
+    DeleteCriticalSection(&Slab->Lock);
+}
+
 /*
 The optimizer does a good job at condensing the function below, but
 unfortunately early optimizers get it wrong.
@@ -0,0 +1,652 @@
+/**
+ * @file lib/metacach.c
+ *
+ * Yori persistent cache of file metadata that is expensive to collect
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The directory, relative to the user's profile, where cache files are
+ stored.  Each volume is described by a separate file named by its serial
+ number.
+ */
+#define YORILIB_METADATA_CACHE_DIRECTORY _T("~LOCALAPPDATA\\Yori\\MetadataCache")
+
+/**
+ The signature at the start of each cache file.
+ */
+#define YORILIB_METADATA_CACHE_SIGNATURE 0x43444d59
+
+/**
+ The version of the cache file format.  Files with any other version are
+ ignored and rewritten when saved.
+ */
+#define YORILIB_METADATA_CACHE_FORMAT 1
+
+/**
+ The number of bytes of records to write to a cache file in each call to
+ WriteFile.
+ */
+#define YORILIB_METADATA_CACHE_WRITE_BUFFER_SIZE (64 * 1024)
+
+/**
+ The header at the start of each cache file.  It is followed by RecordCount
+ records.
+ */
+typedef struct _YORILIB_METADATA_CACHE_FILE_HEADER {
+
+    /**
+     Set to YORILIB_METADATA_CACHE_SIGNATURE.
+     */
+    DWORD Signature;
+
+    /**
+     Set to YORILIB_METADATA_CACHE_FORMAT.
+     */
+    DWORD Format;
+
+    /**
+     The size of each record in bytes.  This allows a file written by a
+     build with a different record layout to be detected and discarded.
+     */
+    DWORD RecordSize;
+
+    /**
+     The number of records following the header.
+     */
+    DWORD RecordCount;
+} YORILIB_METADATA_CACHE_FILE_HEADER, *PYORILIB_METADATA_CACHE_FILE_HEADER;
+
+/**
+ The cached records for a single volume.
+ */
+typedef struct _YORILIB_METADATA_CACHE_VOLUME {
+
+    /**
+     The link of this volume within the cache's list of volumes.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The serial number of the volume.
+     */
+    DWORD VolumeSerialNumber;
+
+    /**
+     Set to TRUE if any record has been modified since the volume was
+     loaded, indicating it needs to be written back.
+     */
+    BOOLEAN Dirty;
+
+    /**
+     A hash table of records on the volume, keyed by file ID.
+     */
+    PYORI_GROWABLE_HASH_TABLE Table;
+
+    /**
+     A list of every record on the volume, used to enumerate records when
+     saving or cleaning up.
+     */
+    YORI_LIST_ENTRY Entries;
+} YORILIB_METADATA_CACHE_VOLUME, *PYORILIB_METADATA_CACHE_VOLUME;
+
+/**
+ A single record within a volume.
+ */
+typedef struct _YORILIB_METADATA_CACHE_ENTRY {
+
+    /**
+     The link of this entry within the volume's list of entries.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry within the volume's hash table.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The volume containing this entry.
+     */
+    PYORILIB_METADATA_CACHE_VOLUME Volume;
+
+    /**
+     The cached data.
+     */
+    YORILIB_METADATA_CACHE_RECORD Record;
+
+    /**
+     The hash table key, which is the file ID in hex.
+     */
+    TCHAR Key[17];
+} YORILIB_METADATA_CACHE_ENTRY, *PYORILIB_METADATA_CACHE_ENTRY;
+
+/**
+ Prepare a metadata cache for use.  Volumes are not loaded until a file on
+ them is looked up.
+
+ @param Cache Pointer to the cache to initialize.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  On failure,
+         the cache must not be used.
+ */
+__success(return)
+BOOL
+YoriLibInitializeMetadataCache(
+    __out PYORILIB_METADATA_CACHE Cache
+    )
+{
+    YORI_STRING RelativePath;
+
+    YoriLibInitEmptyString(&Cache->Directory);
+    YoriLibInitializeListHead(&Cache->Volumes);
+
+    YoriLibConstantString(&RelativePath, YORILIB_METADATA_CACHE_DIRECTORY);
+    if (!YoriLibUserStringToSingleFilePath(&RelativePath, TRUE, &Cache->Directory)) {
+        return FALSE;
+    }
+
+    if (!YoriLibCreateDirectoryAndParents(&Cache->Directory) &&
+        GetLastError() != ERROR_ALREADY_EXISTS) {
+
+        if ((GetFileAttributes(Cache->Directory.StartOfString) & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            YoriLibFreeStringContents(&Cache->Directory);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Build the full path to the cache file for a volume.
+
+ @param Cache Pointer to the cache.
+
+ @param VolumeSerialNumber The serial number of the volume.
+
+ @param FileName On successful completion, populated with the path to the
+        cache file.  The caller should free this with
+        YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibMetadataCacheVolumeFileName(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in DWORD VolumeSerialNumber,
+    __out PYORI_STRING FileName
+    )
+{
+    YoriLibInitEmptyString(FileName);
+    YoriLibYPrintf(FileName, _T("%y\\%08x.dat"), &Cache->Directory, VolumeSerialNumber);
+    if (FileName->StartOfString == NULL) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ Add a record to a volume.
+
+ @param Volume Pointer to the volume.
+
+ @param FileId The file ID of the record.
+
+ @return Pointer to the newly added entry, with a zeroed record other than
+         its file ID, or NULL on allocation failure.
+ */
+PYORILIB_METADATA_CACHE_ENTRY
+YoriLibMetadataCacheAddEntry(
+    __in PYORILIB_METADATA_CACHE_VOLUME Volume,
+    __in PLARGE_INTEGER FileId
+    )
+{
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+    YORI_STRING Key;
+
+    CacheEntry = YoriLibMalloc(sizeof(YORILIB_METADATA_CACHE_ENTRY));
+    if (CacheEntry == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(CacheEntry, sizeof(YORILIB_METADATA_CACHE_ENTRY));
+    CacheEntry->Volume = Volume;
+    CacheEntry->Record.FileId.QuadPart = FileId->QuadPart;
+
+    YoriLibSPrintf(CacheEntry->Key, _T("%016llx"), FileId->QuadPart);
+    YoriLibInitEmptyString(&Key);
+    Key.StartOfString = CacheEntry->Key;
+    Key.LengthInChars = 16;
+    Key.LengthAllocated = sizeof(CacheEntry->Key)/sizeof(CacheEntry->Key[0]);
+
+    if (!YoriLibGrowableHashInsertByKey(Volume->Table, &Key, CacheEntry, &CacheEntry->HashEntry)) {
+        YoriLibFree(CacheEntry);
+        return NULL;
+    }
+
+    YoriLibAppendList(&Volume->Entries, &CacheEntry->ListEntry);
+    return CacheEntry;
+}
+
+/**
+ Load the records for a volume from its cache file.  If the file does not
+ exist or is not valid, the volume is left empty.
+
+ @param Cache Pointer to the cache.
+
+ @param Volume Pointer to the volume, which has an empty table.
+ */
+VOID
+YoriLibMetadataCacheLoadVolume(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in PYORILIB_METADATA_CACHE_VOLUME Volume
+    )
+{
+    YORILIB_METADATA_CACHE_FILE_HEADER Header;
+    PYORILIB_METADATA_CACHE_RECORD Records;
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+    YORI_MAX_UNSIGNED_T BytesRequired;
+    YORI_STRING FileName;
+    DWORD BytesRead;
+    DWORD Index;
+    HANDLE hFile;
+
+    if (!YoriLibMetadataCacheVolumeFileName(Cache, Volume->VolumeSerialNumber, &FileName)) {
+        return;
+    }
+
+    hFile = CreateFile(FileName.StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ|FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+
+    YoriLibFreeStringContents(&FileName);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    if (!ReadFile(hFile, &Header, sizeof(Header), &BytesRead, NULL) ||
+        BytesRead != sizeof(Header) ||
+        Header.Signature != YORILIB_METADATA_CACHE_SIGNATURE ||
+        Header.Format != YORILIB_METADATA_CACHE_FORMAT ||
+        Header.RecordSize != sizeof(YORILIB_METADATA_CACHE_RECORD)) {
+
+        CloseHandle(hFile);
+        return;
+    }
+
+    BytesRequired = (YORI_MAX_UNSIGNED_T)Header.RecordCount * sizeof(YORILIB_METADATA_CACHE_RECORD);
+    if (Header.RecordCount == 0 ||
+        BytesRequired > (DWORD)-1 ||
+        !YoriLibIsSizeAllocatable(BytesRequired)) {
+
+        CloseHandle(hFile);
+        return;
+    }
+
+    Records = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
+    if (Records == NULL) {
+        CloseHandle(hFile);
+        return;
+    }
+
+    if (!ReadFile(hFile, Records, (DWORD)BytesRequired, &BytesRead, NULL) ||
+        BytesRead != BytesRequired) {
+
+        YoriLibFree(Records);
+        CloseHandle(hFile);
+        return;
+    }
+
+    CloseHandle(hFile);
+
+    for (Index = 0; Index < Header.RecordCount; Index++) {
+        CacheEntry = YoriLibMetadataCacheAddEntry(Volume, &Records[Index].FileId);
+        if (CacheEntry == NULL) {
+            break;
+        }
+        memcpy(&CacheEntry->Record, &Records[Index], sizeof(YORILIB_METADATA_CACHE_RECORD));
+        CacheEntry->Record.Description[sizeof(CacheEntry->Record.Description)/sizeof(TCHAR) - 1] = '\0';
+        CacheEntry->Record.FileVersionString[sizeof(CacheEntry->Record.FileVersionString)/sizeof(TCHAR) - 1] = '\0';
+    }
+
+    YoriLibFree(Records);
+}
+
+/**
+ Find the volume within the cache with the specified serial number, loading
+ it from disk if it has not been used yet.
+
+ @param Cache Pointer to the cache.
+
+ @param VolumeSerialNumber The serial number of the volume.
+
+ @return Pointer to the volume, or NULL on allocation failure.
+ */
+PYORILIB_METADATA_CACHE_VOLUME
+YoriLibMetadataCacheGetVolume(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in DWORD VolumeSerialNumber
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORILIB_METADATA_CACHE_VOLUME Volume;
+
+    ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, NULL);
+    while (ListEntry != NULL) {
+        Volume = CONTAINING_RECORD(ListEntry, YORILIB_METADATA_CACHE_VOLUME, ListEntry);
+        if (Volume->VolumeSerialNumber == VolumeSerialNumber) {
+            return Volume;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, ListEntry);
+    }
+
+    Volume = YoriLibMalloc(sizeof(YORILIB_METADATA_CACHE_VOLUME));
+    if (Volume == NULL) {
+        return NULL;
+    }
+
+    Volume->Table = YoriLibAllocateGrowableHashTable(1024);
+    if (Volume->Table == NULL) {
+        YoriLibFree(Volume);
+        return NULL;
+    }
+
+    Volume->VolumeSerialNumber = VolumeSerialNumber;
+    Volume->Dirty = FALSE;
+    YoriLibInitializeListHead(&Volume->Entries);
+    YoriLibAppendList(&Cache->Volumes, &Volume->ListEntry);
+
+    YoriLibMetadataCacheLoadVolume(Cache, Volume);
+
+    return Volume;
+}
+
+/**
+ Find the cached record for a file.  If the file has no record, or the
+ record describes an earlier version of the file, an empty record is
+ returned which the caller can populate.
+
+ @param Cache Pointer to the cache.
+
+ @param VolumeSerialNumber The serial number of the volume containing the
+        file.
+
+ @param FileId The file system's identifier for the file.
+
+ @param LastWriteTime The time the file was last written.  Records for any
+        other write time are discarded.
+
+ @return Pointer to the record, or NULL on allocation failure.  If the
+         caller populates any fields of the record it should call
+         YoriLibMetadataCacheRecordUpdated.
+ */
+PYORILIB_METADATA_CACHE_RECORD
+YoriLibMetadataCacheLookup(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in DWORD VolumeSerialNumber,
+    __in PLARGE_INTEGER FileId,
+    __in PLARGE_INTEGER LastWriteTime
+    )
+{
+    PYORILIB_METADATA_CACHE_VOLUME Volume;
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+    PYORI_HASH_ENTRY HashEntry;
+    TCHAR KeyBuffer[17];
+    YORI_STRING Key;
+
+    Volume = YoriLibMetadataCacheGetVolume(Cache, VolumeSerialNumber);
+    if (Volume == NULL) {
+        return NULL;
+    }
+
+    YoriLibSPrintf(KeyBuffer, _T("%016llx"), FileId->QuadPart);
+    YoriLibConstantString(&Key, KeyBuffer);
+
+    HashEntry = YoriLibGrowableHashLookupByKey(Volume->Table, &Key);
+    if (HashEntry != NULL) {
+        CacheEntry = HashEntry->Context;
+        if (CacheEntry->Record.LastWriteTime.QuadPart != LastWriteTime->QuadPart) {
+            ZeroMemory(&CacheEntry->Record, sizeof(YORILIB_METADATA_CACHE_RECORD));
+            CacheEntry->Record.FileId.QuadPart = FileId->QuadPart;
+            CacheEntry->Record.LastWriteTime.QuadPart = LastWriteTime->QuadPart;
+        }
+        return &CacheEntry->Record;
+    }
+
+    CacheEntry = YoriLibMetadataCacheAddEntry(Volume, FileId);
+    if (CacheEntry == NULL) {
+        return NULL;
+    }
+
+    CacheEntry->Record.LastWriteTime.QuadPart = LastWriteTime->QuadPart;
+    return &CacheEntry->Record;
+}
+
+/**
+ Indicate that a record returned from YoriLibMetadataCacheLookup has been
+ populated and should be written back when the cache is saved.
+
+ @param Record Pointer to the record.
+ */
+VOID
+YoriLibMetadataCacheRecordUpdated(
+    __in PYORILIB_METADATA_CACHE_RECORD Record
+    )
+{
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+
+    CacheEntry = CONTAINING_RECORD(Record, YORILIB_METADATA_CACHE_ENTRY, Record);
+    CacheEntry->Volume->Dirty = TRUE;
+}
+
+/**
+ Write the records for a single volume to its cache file.
+
+ @param Cache Pointer to the cache.
+
+ @param Volume Pointer to the volume to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibMetadataCacheSaveVolume(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in PYORILIB_METADATA_CACHE_VOLUME Volume
+    )
+{
+    YORILIB_METADATA_CACHE_FILE_HEADER Header;
+    PYORILIB_METADATA_CACHE_RECORD Buffer;
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING FileName;
+    DWORD RecordsPerBuffer;
+    DWORD RecordsInBuffer;
+    DWORD BytesWritten;
+    BOOL Success;
+    HANDLE hFile;
+
+    RecordsPerBuffer = YORILIB_METADATA_CACHE_WRITE_BUFFER_SIZE / sizeof(YORILIB_METADATA_CACHE_RECORD);
+    Buffer = YoriLibMalloc(RecordsPerBuffer * sizeof(YORILIB_METADATA_CACHE_RECORD));
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    if (!YoriLibMetadataCacheVolumeFileName(Cache, Volume->VolumeSerialNumber, &FileName)) {
+        YoriLibFree(Buffer);
+        return FALSE;
+    }
+
+    hFile = CreateFile(FileName.StartOfString,
+                       GENERIC_WRITE,
+                       FILE_SHARE_READ|FILE_SHARE_DELETE,
+                       NULL,
+                       CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        YoriLibFreeStringContents(&FileName);
+        YoriLibFree(Buffer);
+        return FALSE;
+    }
+
+    //
+    //  Records that were looked up but never populated, because no
+    //  collector could obtain anything for the file, are not saved.
+    //
+
+    Header.Signature = YORILIB_METADATA_CACHE_SIGNATURE;
+    Header.Format = YORILIB_METADATA_CACHE_FORMAT;
+    Header.RecordSize = sizeof(YORILIB_METADATA_CACHE_RECORD);
+    Header.RecordCount = 0;
+
+    ListEntry = YoriLibGetNextListEntry(&Volume->Entries, NULL);
+    while (ListEntry != NULL) {
+        CacheEntry = CONTAINING_RECORD(ListEntry, YORILIB_METADATA_CACHE_ENTRY, ListEntry);
+        if (CacheEntry->Record.ValidFields != 0) {
+            Header.RecordCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Volume->Entries, ListEntry);
+    }
+
+    Success = WriteFile(hFile, &Header, sizeof(Header), &BytesWritten, NULL);
+
+    RecordsInBuffer = 0;
+    ListEntry = YoriLibGetNextListEntry(&Volume->Entries, NULL);
+    while (Success && ListEntry != NULL) {
+        CacheEntry = CONTAINING_RECORD(ListEntry, YORILIB_METADATA_CACHE_ENTRY, ListEntry);
+        if (CacheEntry->Record.ValidFields != 0) {
+            memcpy(&Buffer[RecordsInBuffer], &CacheEntry->Record, sizeof(YORILIB_METADATA_CACHE_RECORD));
+            RecordsInBuffer++;
+            if (RecordsInBuffer == RecordsPerBuffer) {
+                Success = WriteFile(hFile, Buffer, RecordsInBuffer * sizeof(YORILIB_METADATA_CACHE_RECORD), &BytesWritten, NULL);
+                RecordsInBuffer = 0;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&Volume->Entries, ListEntry);
+    }
+
+    if (Success && RecordsInBuffer > 0) {
+        Success = WriteFile(hFile, Buffer, RecordsInBuffer * sizeof(YORILIB_METADATA_CACHE_RECORD), &BytesWritten, NULL);
+    }
+
+    CloseHandle(hFile);
+
+    //
+    //  A partially written file would be discarded when loaded since its
+    //  length would not match the header, but deleting it avoids reading
+    //  it at all.
+    //
+
+    if (!Success) {
+        DeleteFile(FileName.StartOfString);
+    }
+
+    YoriLibFreeStringContents(&FileName);
+    YoriLibFree(Buffer);
+    return Success;
+}
+
+/**
+ Write every volume whose records have changed back to disk.
+
+ @param Cache Pointer to the cache.
+
+ @return TRUE if all modified volumes were written, FALSE if any could not
+         be written.
+ */
+BOOL
+YoriLibSaveMetadataCache(
+    __in PYORILIB_METADATA_CACHE Cache
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORILIB_METADATA_CACHE_VOLUME Volume;
+    BOOL Result;
+
+    Result = TRUE;
+    ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, NULL);
+    while (ListEntry != NULL) {
+        Volume = CONTAINING_RECORD(ListEntry, YORILIB_METADATA_CACHE_VOLUME, ListEntry);
+        if (Volume->Dirty) {
+            if (YoriLibMetadataCacheSaveVolume(Cache, Volume)) {
+                Volume->Dirty = FALSE;
+            } else {
+                Result = FALSE;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, ListEntry);
+    }
+
+    return Result;
+}
+
+/**
+ Free all memory associated with a metadata cache.  Changes are not saved;
+ callers wanting to retain them should call YoriLibSaveMetadataCache first.
+
+ @param Cache Pointer to the cache.
+ */
+VOID
+YoriLibCleanupMetadataCache(
+    __in PYORILIB_METADATA_CACHE Cache
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY EntryListEntry;
+    PYORILIB_METADATA_CACHE_VOLUME Volume;
+    PYORILIB_METADATA_CACHE_ENTRY CacheEntry;
+
+    ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, NULL);
+    while (ListEntry != NULL) {
+        Volume = CONTAINING_RECORD(ListEntry, YORILIB_METADATA_CACHE_VOLUME, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Cache->Volumes, ListEntry);
+
+        EntryListEntry = YoriLibGetNextListEntry(&Volume->Entries, NULL);
+        while (EntryListEntry != NULL) {
+            CacheEntry = CONTAINING_RECORD(EntryListEntry, YORILIB_METADATA_CACHE_ENTRY, ListEntry);
+            EntryListEntry = YoriLibGetNextListEntry(&Volume->Entries, EntryListEntry);
+
+            YoriLibGrowableHashRemoveByEntry(Volume->Table, &CacheEntry->HashEntry);
+            YoriLibRemoveListItem(&CacheEntry->ListEntry);
+            YoriLibFree(CacheEntry);
+        }
+
+        YoriLibFreeEmptyGrowableHashTable(Volume->Table);
+        YoriLibRemoveListItem(&Volume->ListEntry);
+        YoriLibFree(Volume);
+    }
+
+    YoriLibFreeStringContents(&Cache->Directory);
+}
+
+// vim:sw=4:ts=4:et:
@@ -122,12 +122,12 @@ YoriLibForEachObjectEnum(
     DWORD EnumContext;
     DWORD BytesReturned;
     BOOLEAN Restart;
+    BOOLEAN Aborted;
 
     YORI_STRING FullObjectName;
     YORI_STRING ObjectName;
     YORI_STRING ObjectType;
 
-    UNREFERENCED_PARAMETER(Callback);
     UNREFERENCED_PARAMETER(MatchFlags);
 
     if (DllNtDll.pNtOpenDirectoryObject == NULL ||
@@ -165,16 +165,19 @@ YoriLibForEachObjectEnum(
 
     EnumContext = 0;
     Restart = TRUE;
+    Aborted = FALSE;
     YoriLibInitEmptyString(&FullObjectName);
     YoriLibInitEmptyString(&ObjectName);
     YoriLibInitEmptyString(&ObjectType);
     NameOnlyOffset = 0;
 
     //
-    //  Loop filling a buffer with entries, then processing the entries
+    //  Loop filling a buffer with entries, then processing the entries.
+    //  Each call returns as many entries as fit in the buffer.  If the
+    //  callback asks to stop, don't request any more.
     //
 
-    while (TRUE) {
+    while (!Aborted) {
         NtStatus = DllNtDll.pNtQueryDirectoryObject(DirHandle, Buffer, BufferSize, FALSE, Restart, &EnumContext, &BytesReturned);
 
         //
@@ -250,6 +253,7 @@ YoriLibForEachObjectEnum(
             FullObjectName.StartOfString[FullObjectName.LengthInChars] = '\0';
 
             if (!Callback(&FullObjectName, &ObjectName, &ObjectType, Context)) {
+                Aborted = TRUE;
                 break;
             }
             Entry++;
@@ -461,6 +461,619 @@ YoriLibPathFreePathExtComponents(
     YoriLibFree(PathExtComponents);
 }
 
+/**
+ The maximum number of directories whose contents are retained in the
+ locate cache.  When this is exceeded, the least recently used directory is
+ discarded.
+ */
+#define YORI_LIB_PATH_LOCATE_CACHE_DIRECTORIES (128)
+
+/**
+ The contents of a single directory retained in the locate cache.  Only the
+ names of files with an extension in PATHEXT are retained.
+ */
+typedef struct _YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY {
+
+    /**
+     The link within the list of cached directories, ordered from least to
+     most recently used.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry within the hash table of cached directories, keyed by the
+     directory name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     A change notification handle for the directory, signalled when a file
+     is added, removed or renamed.  If this could not be created, this is
+     NULL and LastWriteTime is used to detect changes instead.
+     */
+    HANDLE ChangeHandle;
+
+    /**
+     The last write time of the directory when its contents were read.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     A hash table of file names in the directory.
+     */
+    PYORI_HASH_TABLE Names;
+
+    /**
+     An array of NameCount hash entries inserted into Names.
+     */
+    PYORI_HASH_ENTRY NameEntries;
+
+    /**
+     The number of elements in NameEntries.
+     */
+    YORI_ALLOC_SIZE_T NameCount;
+} YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY, *PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY;
+
+/**
+ Process global state for the locate cache.
+ */
+typedef struct _YORI_LIB_PATH_LOCATE_CACHE {
+
+    /**
+     A mutex synchronizing access to the cache.  If NULL, the cache has not
+     been enabled.
+     */
+    HANDLE Mutex;
+
+    /**
+     A hash table of cached directories, keyed by directory name.
+     */
+    PYORI_HASH_TABLE Directories;
+
+    /**
+     The list of cached directories, ordered from least to most recently
+     used.
+     */
+    YORI_LIST_ENTRY DirectoryList;
+
+    /**
+     The number of directories in DirectoryList.
+     */
+    YORI_ALLOC_SIZE_T DirectoryCount;
+
+    /**
+     The set of extensions, seperated by semicolons, that were used to
+     select which names to retain.  If this changes, the cache is flushed.
+     */
+    YORI_STRING PathExt;
+} YORI_LIB_PATH_LOCATE_CACHE, *PYORI_LIB_PATH_LOCATE_CACHE;
+
+/**
+ Process global state for the locate cache.
+ */
+YORI_LIB_PATH_LOCATE_CACHE YoriLibPathLocateCache;
+
+/**
+ Enable caching of directory contents for path searches.  Once enabled,
+ searches for an exact file name in a fully specified directory consult a
+ cached list of the directory's executable files, which is refreshed when
+ the directory changes.  This is intended for long running processes which
+ search the path repeatedly, and should be called before any other threads
+ perform path searches.  The caller should call
+ @ref YoriLibPathCleanupLocateCache before exiting.
+
+ @return TRUE to indicate the cache was enabled, FALSE if it was not.
+ */
+BOOL
+YoriLibPathEnableLocateCache(VOID)
+{
+    if (YoriLibPathLocateCache.Mutex != NULL) {
+        return TRUE;
+    }
+
+    YoriLibPathLocateCache.Directories = YoriLibAllocateHashTable(YORI_LIB_PATH_LOCATE_CACHE_DIRECTORIES / 2);
+    if (YoriLibPathLocateCache.Directories == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitializeListHead(&YoriLibPathLocateCache.DirectoryList);
+    YoriLibPathLocateCache.DirectoryCount = 0;
+    YoriLibInitEmptyString(&YoriLibPathLocateCache.PathExt);
+
+    YoriLibPathLocateCache.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriLibPathLocateCache.Mutex == NULL) {
+        YoriLibFreeEmptyHashTable(YoriLibPathLocateCache.Directories);
+        YoriLibPathLocateCache.Directories = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free a cached directory.  The directory must already be removed from the
+ cache.
+
+ @param Directory Pointer to the directory to free.
+ */
+VOID
+YoriLibPathFreeLocateCacheDirectory(
+    __in PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (Directory->ChangeHandle != NULL) {
+        FindCloseChangeNotification(Directory->ChangeHandle);
+    }
+
+    if (Directory->NameEntries != NULL) {
+        for (Index = 0; Index < Directory->NameCount; Index++) {
+            YoriLibHashRemoveByEntry(&Directory->NameEntries[Index]);
+        }
+        YoriLibFree(Directory->NameEntries);
+    }
+
+    if (Directory->Names != NULL) {
+        YoriLibFreeEmptyHashTable(Directory->Names);
+    }
+
+    YoriLibFree(Directory);
+}
+
+/**
+ Remove a directory from the locate cache and free it.  The caller must hold
+ the cache mutex.
+
+ @param Directory Pointer to the directory to remove.
+ */
+VOID
+YoriLibPathRemoveLocateCacheDirectory(
+    __in PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory
+    )
+{
+    YoriLibRemoveListItem(&Directory->ListEntry);
+    YoriLibHashRemoveByEntry(&Directory->HashEntry);
+    ASSERT(YoriLibPathLocateCache.DirectoryCount > 0);
+    YoriLibPathLocateCache.DirectoryCount--;
+    YoriLibPathFreeLocateCacheDirectory(Directory);
+}
+
+/**
+ Remove every directory from the locate cache.  The caller must hold the
+ cache mutex.
+ */
+VOID
+YoriLibPathFlushLocateCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory;
+
+    ListEntry = YoriLibGetNextListEntry(&YoriLibPathLocateCache.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriLibPathLocateCache.DirectoryList, ListEntry);
+        YoriLibPathRemoveLocateCacheDirectory(Directory);
+    }
+}
+
+/**
+ Free all state associated with the locate cache.
+ */
+VOID
+YoriLibPathCleanupLocateCache(VOID)
+{
+    if (YoriLibPathLocateCache.Mutex == NULL) {
+        return;
+    }
+
+    YoriLibPathFlushLocateCache();
+    YoriLibFreeEmptyHashTable(YoriLibPathLocateCache.Directories);
+    YoriLibPathLocateCache.Directories = NULL;
+    YoriLibFreeStringContents(&YoriLibPathLocateCache.PathExt);
+    CloseHandle(YoriLibPathLocateCache.Mutex);
+    YoriLibPathLocateCache.Mutex = NULL;
+}
+
+/**
+ Return TRUE if a file name ends in one of the extensions being searched
+ for.
+
+ @param FileName Pointer to the file name.
+
+ @param PathExtData Points to an array of file name extensions.
+
+ @param PathExtCount The number of elements in PathExtData.
+
+ @return TRUE if the file name has an extension in PathExtData, FALSE if it
+         does not.
+ */
+BOOLEAN
+YoriLibPathHasPathExtExtension(
+    __in LPCTSTR FileName,
+    __in PYORI_PATHEXT_COMPONENT PathExtData,
+    __in YORI_ALLOC_SIZE_T PathExtCount
+    )
+{
+    YORI_ALLOC_SIZE_T FileNameLen;
+    YORI_ALLOC_SIZE_T Count;
+
+    FileNameLen = (YORI_ALLOC_SIZE_T)_tcslen(FileName);
+    for (Count = 0; Count < PathExtCount; Count++) {
+        if (FileNameLen > PathExtData[Count].Extension.LengthInChars &&
+            _tcsnicmp(PathExtData[Count].Extension.StartOfString,
+                      &FileName[FileNameLen - PathExtData[Count].Extension.LengthInChars],
+                      PathExtData[Count].Extension.LengthInChars) == 0) {
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Read the names of files in a directory with an extension being searched
+ for, and construct a cached directory from them.
+
+ @param SearchPath The directory to read.
+
+ @param PathExtData Points to an array of file name extensions.
+
+ @param PathExtCount The number of elements in PathExtData.
+
+ @return On successful completion, a newly allocated cached directory which
+         is not yet inserted into the cache.  NULL on failure.
+ */
+__success(return != NULL)
+PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY
+YoriLibPathLoadLocateCacheDirectory(
+    __in PYORI_STRING SearchPath,
+    __in PYORI_PATHEXT_COMPONENT PathExtData,
+    __in YORI_ALLOC_SIZE_T PathExtCount
+    )
+{
+    PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory;
+    WIN32_FILE_ATTRIBUTE_DATA DirectoryInfo;
+    WIN32_FIND_DATA FindData;
+    YORI_STRING SearchName;
+    YORI_STRING NameBuffer;
+    YORI_STRING Name;
+    YORI_ALLOC_SIZE_T FileNameLen;
+    YORI_ALLOC_SIZE_T Offset;
+    YORI_ALLOC_SIZE_T Index;
+    HANDLE hFind;
+
+    if (!YoriLibAllocateString(&SearchName, SearchPath->LengthInChars + sizeof("\\*"))) {
+        return NULL;
+    }
+
+    SearchName.LengthInChars = YoriLibSPrintfS(SearchName.StartOfString, SearchName.LengthAllocated, _T("%y"), SearchPath);
+    if (!GetFileAttributesEx(SearchName.StartOfString, GetFileExInfoStandard, &DirectoryInfo) ||
+        (DirectoryInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+
+        YoriLibFreeStringContents(&SearchName);
+        return NULL;
+    }
+
+    Directory = YoriLibMalloc(sizeof(YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY));
+    if (Directory == NULL) {
+        YoriLibFreeStringContents(&SearchName);
+        return NULL;
+    }
+
+    ZeroMemory(Directory, sizeof(YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY));
+    Directory->LastWriteTime = DirectoryInfo.ftLastWriteTime;
+
+    //
+    //  Register for changes before reading the directory so that any change
+    //  made while reading it is detected on the next lookup.
+    //
+
+    Directory->ChangeHandle = FindFirstChangeNotification(SearchName.StartOfString, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (Directory->ChangeHandle == INVALID_HANDLE_VALUE) {
+        Directory->ChangeHandle = NULL;
+    }
+
+    if (YoriLibIsSep(SearchPath->StartOfString[SearchPath->LengthInChars - 1])) {
+        SearchName.LengthInChars = YoriLibSPrintfS(SearchName.StartOfString, SearchName.LengthAllocated, _T("%y*"), SearchPath);
+    } else {
+        SearchName.LengthInChars = YoriLibSPrintfS(SearchName.StartOfString, SearchName.LengthAllocated, _T("%y\\*"), SearchPath);
+    }
+
+    //
+    //  Collect matching names into a single buffer, each followed by a
+    //  terminator.
+    //
+
+    YoriLibInitEmptyString(&NameBuffer);
+    hFind = FindFirstNonDirectoryFile(SearchName.StartOfString, &FindData);
+    YoriLibFreeStringContents(&SearchName);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (!YoriLibPathHasPathExtExtension(FindData.cFileName, PathExtData, PathExtCount)) {
+                continue;
+            }
+
+            FileNameLen = (YORI_ALLOC_SIZE_T)_tcslen(FindData.cFileName);
+            if (NameBuffer.LengthInChars + FileNameLen + 1 > NameBuffer.LengthAllocated) {
+                if (!YoriLibReallocateString(&NameBuffer, (NameBuffer.LengthAllocated + FileNameLen + 1) * 2 + 0x100)) {
+                    FindClose(hFind);
+                    YoriLibFreeStringContents(&NameBuffer);
+                    YoriLibPathFreeLocateCacheDirectory(Directory);
+                    return NULL;
+                }
+            }
+
+            memcpy(&NameBuffer.StartOfString[NameBuffer.LengthInChars], FindData.cFileName, (FileNameLen + 1) * sizeof(TCHAR));
+            NameBuffer.LengthInChars = NameBuffer.LengthInChars + FileNameLen + 1;
+            Directory->NameCount++;
+
+        } while (FindNextNonDirectoryFile(hFind, &FindData));
+
+        FindClose(hFind);
+    }
+
+    Directory->Names = YoriLibAllocateHashTable(Directory->NameCount / 2 + 1);
+    if (Directory->Names == NULL) {
+        YoriLibFreeStringContents(&NameBuffer);
+        Directory->NameCount = 0;
+        YoriLibPathFreeLocateCacheDirectory(Directory);
+        return NULL;
+    }
+
+    if (Directory->NameCount > 0) {
+        Directory->NameEntries = YoriLibMalloc(Directory->NameCount * sizeof(YORI_HASH_ENTRY));
+        if (Directory->NameEntries == NULL) {
+            YoriLibFreeStringContents(&NameBuffer);
+            Directory->NameCount = 0;
+            YoriLibPathFreeLocateCacheDirectory(Directory);
+            return NULL;
+        }
+    }
+
+    //
+    //  Each key references the name buffer, so inserting doesn't allocate.
+    //
+
+    Offset = 0;
+    YoriLibInitEmptyString(&Name);
+    Name.MemoryToFree = NameBuffer.MemoryToFree;
+    for (Index = 0; Index < Directory->NameCount; Index++) {
+        Name.StartOfString = &NameBuffer.StartOfString[Offset];
+        Name.LengthInChars = (YORI_ALLOC_SIZE_T)_tcslen(Name.StartOfString);
+        Name.LengthAllocated = Name.LengthInChars + 1;
+        YoriLibHashInsertByKey(Directory->Names, &Name, Directory, &Directory->NameEntries[Index]);
+        Offset = Offset + Name.LengthInChars + 1;
+    }
+
+    YoriLibFreeStringContents(&NameBuffer);
+    return Directory;
+}
+
+/**
+ Check whether a cached directory still describes the directory's contents.
+
+ @param Directory Pointer to the cached directory.
+
+ @param SearchPath The directory name.
+
+ @return TRUE if the cached directory is current, FALSE if it should be
+         discarded.
+ */
+BOOLEAN
+YoriLibPathIsLocateCacheDirectoryCurrent(
+    __in PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING SearchPath
+    )
+{
+    WIN32_FILE_ATTRIBUTE_DATA DirectoryInfo;
+    YORI_STRING DirectoryName;
+    BOOL Success;
+
+    if (Directory->ChangeHandle != NULL) {
+        if (WaitForSingleObject(Directory->ChangeHandle, 0) == WAIT_OBJECT_0) {
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (!YoriLibAllocateString(&DirectoryName, SearchPath->LengthInChars + 1)) {
+        return FALSE;
+    }
+    DirectoryName.LengthInChars = YoriLibSPrintfS(DirectoryName.StartOfString, DirectoryName.LengthAllocated, _T("%y"), SearchPath);
+    Success = GetFileAttributesEx(DirectoryName.StartOfString, GetFileExInfoStandard, &DirectoryInfo);
+    YoriLibFreeStringContents(&DirectoryName);
+
+    if (!Success ||
+        CompareFileTime(&DirectoryInfo.ftLastWriteTime, &Directory->LastWriteTime) != 0) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Check whether the extensions being searched for are the ones the cache was
+ populated with.  If not, flush the cache and record the new extensions.
+ The caller must hold the cache mutex.
+
+ @param PathExtData Points to an array of file name extensions.
+
+ @param PathExtCount The number of elements in PathExtData.
+
+ @return TRUE if the cache can be used with these extensions, FALSE if it
+         cannot.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathCheckLocateCachePathExt(
+    __in PYORI_PATHEXT_COMPONENT PathExtData,
+    __in YORI_ALLOC_SIZE_T PathExtCount
+    )
+{
+    YORI_STRING PathExt;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_ALLOC_SIZE_T Length;
+
+    Length = 0;
+    for (Count = 0; Count < PathExtCount; Count++) {
+        Length = Length + PathExtData[Count].Extension.LengthInChars + 1;
+    }
+
+    if (!YoriLibAllocateString(&PathExt, Length + 1)) {
+        return FALSE;
+    }
+
+    for (Count = 0; Count < PathExtCount; Count++) {
+        memcpy(&PathExt.StartOfString[PathExt.LengthInChars],
+               PathExtData[Count].Extension.StartOfString,
+               PathExtData[Count].Extension.LengthInChars * sizeof(TCHAR));
+        PathExt.LengthInChars = PathExt.LengthInChars + PathExtData[Count].Extension.LengthInChars;
+        PathExt.StartOfString[PathExt.LengthInChars] = ';';
+        PathExt.LengthInChars++;
+    }
+    PathExt.StartOfString[PathExt.LengthInChars] = '\0';
+
+    if (YoriLibCompareStringInsensitive(&PathExt, &YoriLibPathLocateCache.PathExt) != 0) {
+        YoriLibPathFlushLocateCache();
+        YoriLibFreeStringContents(&YoriLibPathLocateCache.PathExt);
+        memcpy(&YoriLibPathLocateCache.PathExt, &PathExt, sizeof(YORI_STRING));
+    } else {
+        YoriLibFreeStringContents(&PathExt);
+    }
+
+    return TRUE;
+}
+
+/**
+ Search for a file with each of a set of extensions in a directory using the
+ locate cache.
+
+ @param FileName Pointer to the base file name to search for.
+
+ @param SearchPath The directory to search through for matches.
+
+ @param PathExtData Points to an array of file name extensions to search for.
+        On successful completion, the Found member of each is updated.
+
+ @param PathExtCount The number of elements in PathExtData.
+
+ @param PathExtMatches Points to an array of PathExtCount find data
+        structures.  On successful completion, the cFileName member of each
+        element for an extension which was found is populated.
+
+ @return TRUE to indicate the search was performed from the cache, FALSE if
+         the caller should search the directory.
+ */
+__success(return)
+BOOLEAN
+YoriLibPathLocateFromCache(
+    __in PYORI_STRING FileName,
+    __in PYORI_STRING SearchPath,
+    __inout PYORI_PATHEXT_COMPONENT PathExtData,
+    __in YORI_ALLOC_SIZE_T PathExtCount,
+    __out PWIN32_FIND_DATA PathExtMatches
+    )
+{
+    PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY Directory;
+    PYORI_HASH_ENTRY HashEntry;
+    YORI_STRING CandidateName;
+    TCHAR CandidateBuffer[MAX_PATH];
+    YORI_ALLOC_SIZE_T Count;
+
+    if (YoriLibPathLocateCache.Mutex == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Only cache directories whose name doesn't depend on the current
+    //  directory.
+    //
+
+    if (!YoriLibIsDriveLetterWithColonAndSlash(SearchPath) &&
+        !YoriLibIsFullPathUnc(SearchPath) &&
+        !YoriLibIsPathPrefixed(SearchPath)) {
+
+        return FALSE;
+    }
+
+    if (FileName->LengthInChars >= MAX_PATH) {
+        return FALSE;
+    }
+
+    WaitForSingleObject(YoriLibPathLocateCache.Mutex, INFINITE);
+
+    if (!YoriLibPathCheckLocateCachePathExt(PathExtData, PathExtCount)) {
+        ReleaseMutex(YoriLibPathLocateCache.Mutex);
+        return FALSE;
+    }
+
+    Directory = NULL;
+    HashEntry = YoriLibHashLookupByKey(YoriLibPathLocateCache.Directories, SearchPath);
+    if (HashEntry != NULL) {
+        Directory = HashEntry->Context;
+        if (YoriLibPathIsLocateCacheDirectoryCurrent(Directory, SearchPath)) {
+            YoriLibRemoveListItem(&Directory->ListEntry);
+            YoriLibAppendList(&YoriLibPathLocateCache.DirectoryList, &Directory->ListEntry);
+        } else {
+            YoriLibPathRemoveLocateCacheDirectory(Directory);
+            Directory = NULL;
+        }
+    }
+
+    if (Directory == NULL) {
+        Directory = YoriLibPathLoadLocateCacheDirectory(SearchPath, PathExtData, PathExtCount);
+        if (Directory == NULL) {
+            ReleaseMutex(YoriLibPathLocateCache.Mutex);
+            return FALSE;
+        }
+
+        if (YoriLibPathLocateCache.DirectoryCount >= YORI_LIB_PATH_LOCATE_CACHE_DIRECTORIES) {
+            PYORI_LIB_PATH_LOCATE_CACHE_DIRECTORY OldestDirectory;
+            OldestDirectory = CONTAINING_RECORD(YoriLibPathLocateCache.DirectoryList.Next, YORI_LIB_PATH_LOCATE_CACHE_DIRECTORY, ListEntry);
+            YoriLibPathRemoveLocateCacheDirectory(OldestDirectory);
+        }
+
+        YoriLibHashInsertByKey(YoriLibPathLocateCache.Directories, SearchPath, Directory, &Directory->HashEntry);
+        YoriLibAppendList(&YoriLibPathLocateCache.DirectoryList, &Directory->ListEntry);
+        YoriLibPathLocateCache.DirectoryCount++;
+    }
+
+    //
+    //  Look up the file name with each extension.  The name returned is
+    //  the name as it is recorded in the directory.
+    //
+
+    CandidateName.MemoryToFree = NULL;
+    CandidateName.StartOfString = CandidateBuffer;
+    CandidateName.LengthAllocated = MAX_PATH;
+
+    for (Count = 0; Count < PathExtCount; Count++) {
+        PathExtData[Count].Found = FALSE;
+        if (FileName->LengthInChars + PathExtData[Count].Extension.LengthInChars >= MAX_PATH) {
+            continue;
+        }
+
+        memcpy(CandidateName.StartOfString, FileName->StartOfString, FileName->LengthInChars * sizeof(TCHAR));
+        memcpy(&CandidateName.StartOfString[FileName->LengthInChars],
+               PathExtData[Count].Extension.StartOfString,
+               PathExtData[Count].Extension.LengthInChars * sizeof(TCHAR));
+        CandidateName.LengthInChars = FileName->LengthInChars + PathExtData[Count].Extension.LengthInChars;
+
+        HashEntry = YoriLibHashLookupByKey(Directory->Names, &CandidateName);
+        if (HashEntry != NULL) {
+            PathExtData[Count].Found = TRUE;
+            memcpy(PathExtMatches[Count].cFileName, HashEntry->Key.StartOfString, HashEntry->Key.LengthInChars * sizeof(TCHAR));
+            PathExtMatches[Count].cFileName[HashEntry->Key.LengthInChars] = '\0';
+        }
+    }
+
+    ReleaseMutex(YoriLibPathLocateCache.Mutex);
+    return TRUE;
+}
+
 /**
  Search through a single path matching against desired file extensions.
 
@@ -606,6 +1219,17 @@ YoriLibLocateFileExtensionsInOnePath(
     SearchName.LengthInChars = SearchName.LengthInChars + FileName->LengthInChars;
     ASSERT(SearchName.LengthInChars < SearchName.LengthAllocated);
 
+    //
+    //  If the caller wants an exact name, see if the directory contents are
+    //  cached.
+    //
+
+    if (!PartialMatchOkay &&
+        YoriLibPathLocateFromCache(FileName, SearchPath, PathExtData, PathExtCount, PathExtMatches)) {
+
+        goto ReportMatches;
+    }
+
     //
     //  Before we start searching, indicate that we haven't found anything.
     //
@@ -693,6 +1317,8 @@ YoriLibLocateFileExtensionsInOnePath(
 
     FindClose(hFind);
 
+ReportMatches:
+
     if (MatchAllCallback != NULL) {
         for (Count = 0; Count < PathExtCount; Count++) {
             if (PathExtData[Count].Found) {
@@ -148,6 +148,38 @@ YoriLibYPrintfInternal(
 {
     YORI_SIGNED_ALLOC_SIZE_T required_len;
     YORI_SIGNED_ALLOC_SIZE_T out_len;
+    TCHAR StackBuffer[256];
+
+    //
+    //  Attempt to format the result in a single pass, either directly into
+    //  the existing buffer or into a stack buffer if no buffer exists.
+    //  Callers that repeatedly format into the same string will find the
+    //  buffer is already large enough.  Only if this fails is the format
+    //  string processed to count its length.
+    //
+
+    if (Dest->LengthAllocated > 0) {
+        out_len = YoriLibVSPrintf(Dest->StartOfString, Dest->LengthAllocated, szFmt, marker);
+        if (out_len >= 0) {
+            Dest->LengthInChars = out_len;
+            return out_len;
+        }
+    } else {
+        out_len = YoriLibVSPrintf(StackBuffer, sizeof(StackBuffer)/sizeof(StackBuffer[0]), szFmt, marker);
+        if (out_len >= 0) {
+            YoriLibFreeStringContents(Dest);
+            Dest->MemoryToFree = YoriLibReferencedMalloc((out_len + 1) * sizeof(TCHAR));
+            if (Dest->MemoryToFree == NULL) {
+                return -1;
+            }
+
+            Dest->StartOfString = Dest->MemoryToFree;
+            Dest->LengthAllocated = out_len + 1;
+            memcpy(Dest->StartOfString, StackBuffer, (out_len + 1) * sizeof(TCHAR));
+            Dest->LengthInChars = out_len;
+            return out_len;
+        }
+    }
 
     required_len = YoriLibVSPrintfSize(szFmt, marker);
     if (required_len < 0) {
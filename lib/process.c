@@ -28,51 +28,74 @@
 #include "yorilib.h"
 
 /**
- Load information about all processes currently executing in the system.
-
- @param ProcessInfo On successful completion, updated to point to a list of
-        processes executing within the system.  The caller is expected to
-        free this with YoriLibFree.
+ Load information about all processes currently executing in the system,
+ reusing a buffer from a previous call if it is large enough.  This allows
+ callers that repeatedly sample the process list to avoid reallocating and
+ retrying the query each time.
+
+ @param ProcessInfo On input, optionally points to a buffer returned from a
+        previous call to this function.  On successful completion, updated to
+        point to a list of processes executing within the system, which may
+        or may not be the same buffer.  On failure, the buffer is freed and
+        this is set to NULL.  The caller is expected to free any buffer with
+        YoriLibFree.
+
+ @param BufferSize On input, the size of any buffer provided in ProcessInfo,
+        in bytes.  On output, updated to contain the size of the buffer
+        returned in ProcessInfo.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriLibGetSystemProcessList(
-    __out PYORI_SYSTEM_PROCESS_INFORMATION *ProcessInfo
+YoriLibRefreshSystemProcessList(
+    __inout PYORI_SYSTEM_PROCESS_INFORMATION *ProcessInfo,
+    __inout PYORI_ALLOC_SIZE_T BufferSize
     )
 {
-    PYORI_SYSTEM_PROCESS_INFORMATION LocalProcessInfo = NULL;
+    PYORI_SYSTEM_PROCESS_INFORMATION LocalProcessInfo;
     DWORD BytesReturned;
     YORI_ALLOC_SIZE_T BytesAllocated;
     LONG Status;
 
-    if (DllNtDll.pNtQuerySystemInformation == NULL) {
-        return FALSE;
+    LocalProcessInfo = *ProcessInfo;
+    BytesAllocated = *BufferSize;
+    if (LocalProcessInfo == NULL) {
+        BytesAllocated = 0;
     }
 
-    BytesAllocated = 0;
-
-    do {
+    *ProcessInfo = NULL;
+    *BufferSize = 0;
 
+    if (DllNtDll.pNtQuerySystemInformation == NULL) {
         if (LocalProcessInfo != NULL) {
             YoriLibFree(LocalProcessInfo);
         }
+        return FALSE;
+    }
 
-        if (BytesAllocated == 0) {
-            BytesAllocated = 60 * 1024;
-        } else if (BytesAllocated <= 15 * 1024 * 1024 && YoriLibIsSizeAllocatable(BytesAllocated * 4)) {
-            BytesAllocated = BytesAllocated * 4;
-        } else {
-            return FALSE;
-        }
+    do {
 
-        LocalProcessInfo = YoriLibMalloc(BytesAllocated);
         if (LocalProcessInfo == NULL) {
-            return FALSE;
+            if (BytesAllocated == 0) {
+                BytesAllocated = 60 * 1024;
+            } else if (BytesAllocated <= 15 * 1024 * 1024 && YoriLibIsSizeAllocatable(BytesAllocated * 4)) {
+                BytesAllocated = BytesAllocated * 4;
+            } else {
+                return FALSE;
+            }
+
+            LocalProcessInfo = YoriLibMalloc(BytesAllocated);
+            if (LocalProcessInfo == NULL) {
+                return FALSE;
+            }
         }
 
         Status = DllNtDll.pNtQuerySystemInformation(SystemProcessInformation, LocalProcessInfo, BytesAllocated, &BytesReturned);
+        if (Status == STATUS_INFO_LENGTH_MISMATCH) {
+            YoriLibFree(LocalProcessInfo);
+            LocalProcessInfo = NULL;
+        }
     } while (Status == STATUS_INFO_LENGTH_MISMATCH);
 
 
@@ -87,9 +110,32 @@ YoriLibGetSystemProcessList(
     }
 
     *ProcessInfo = LocalProcessInfo;
+    *BufferSize = BytesAllocated;
     return TRUE;
 }
 
+/**
+ Load information about all processes currently executing in the system.
+
+ @param ProcessInfo On successful completion, updated to point to a list of
+        processes executing within the system.  The caller is expected to
+        free this with YoriLibFree.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibGetSystemProcessList(
+    __out PYORI_SYSTEM_PROCESS_INFORMATION *ProcessInfo
+    )
+{
+    YORI_ALLOC_SIZE_T BufferSize;
+
+    *ProcessInfo = NULL;
+    BufferSize = 0;
+    return YoriLibRefreshSystemProcessList(ProcessInfo, &BufferSize);
+}
+
 /**
  Load information about all handles currently open in the system.
 
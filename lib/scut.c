@@ -229,10 +229,726 @@ Exit:
 }
 
 /**
- Load the path to an icon resource from a specified shortcut file.
+ The size of the header at the start of a shortcut file.
+ */
+#define YORI_LIB_SHORTCUT_HEADER_SIZE           (0x4C)
+
+/**
+ The largest shortcut file that will be parsed directly.  Shortcuts are
+ normally a few kilobytes.
+ */
+#define YORI_LIB_SHORTCUT_MAX_FILE_SIZE         (1024 * 1024)
+
+/**
+ The shortcut contains a shell item ID list for the target.
+ */
+#define YORI_LIB_SHORTCUT_HAS_ID_LIST           (0x00000001)
+
+/**
+ The shortcut contains information about the volume and path of the target.
+ */
+#define YORI_LIB_SHORTCUT_HAS_LINK_INFO         (0x00000002)
+
+/**
+ The shortcut contains a description string.
+ */
+#define YORI_LIB_SHORTCUT_HAS_NAME              (0x00000004)
+
+/**
+ The shortcut contains a relative path string.
+ */
+#define YORI_LIB_SHORTCUT_HAS_RELATIVE_PATH     (0x00000008)
+
+/**
+ The shortcut contains a working directory string.
+ */
+#define YORI_LIB_SHORTCUT_HAS_WORKING_DIR       (0x00000010)
+
+/**
+ The shortcut contains an arguments string.
+ */
+#define YORI_LIB_SHORTCUT_HAS_ARGUMENTS         (0x00000020)
+
+/**
+ The shortcut contains an icon location string.
+ */
+#define YORI_LIB_SHORTCUT_HAS_ICON_LOCATION     (0x00000040)
+
+/**
+ Strings in the shortcut are UTF-16 rather than the ANSI code page.
+ */
+#define YORI_LIB_SHORTCUT_IS_UNICODE            (0x00000080)
+
+/**
+ Information about the volume and path of the target should be ignored.
+ */
+#define YORI_LIB_SHORTCUT_FORCE_NO_LINK_INFO    (0x00000100)
+
+/**
+ The shortcut contains a target path with environment variables.
+ */
+#define YORI_LIB_SHORTCUT_HAS_EXP_STRING        (0x00000200)
+
+/**
+ The shortcut contains an icon path with environment variables.
+ */
+#define YORI_LIB_SHORTCUT_HAS_EXP_ICON          (0x00004000)
+
+/**
+ The link info contains a local path to the target.
+ */
+#define YORI_LIB_SHORTCUT_LINK_INFO_LOCAL       (0x00000001)
+
+/**
+ The link info contains a network path to the target.
+ */
+#define YORI_LIB_SHORTCUT_LINK_INFO_NETWORK     (0x00000002)
+
+/**
+ The signature of an extra data block containing a target path with
+ environment variables.
+ */
+#define YORI_LIB_SHORTCUT_ENVIRONMENT_SIG       (0xA0000001)
+
+/**
+ The signature of an extra data block containing an icon path with
+ environment variables.
+ */
+#define YORI_LIB_SHORTCUT_ICON_ENVIRONMENT_SIG  (0xA0000007)
+
+/**
+ The size of an extra data block containing a path with environment
+ variables.  This is the size and signature, followed by an ANSI path of
+ MAX_PATH characters and a Unicode path of MAX_PATH characters.
+ */
+#define YORI_LIB_SHORTCUT_ENVIRONMENT_SIZE      (8 + 260 + 260 * sizeof(WCHAR))
+
+/**
+ Read a DWORD from a possibly unaligned offset within a shortcut file.
+
+ @param Buffer Pointer to the contents of the shortcut file.
+
+ @param Offset The offset of the value within the buffer.  The caller must
+        ensure four bytes are present at this offset.
+
+ @return The value.
+ */
+DWORD
+YoriLibShortcutReadDword(
+    __in PUCHAR Buffer,
+    __in DWORD Offset
+    )
+{
+    DWORD Value;
+    memcpy(&Value, &Buffer[Offset], sizeof(DWORD));
+    return Value;
+}
+
+/**
+ Read a WORD from a possibly unaligned offset within a shortcut file.
+
+ @param Buffer Pointer to the contents of the shortcut file.
+
+ @param Offset The offset of the value within the buffer.  The caller must
+        ensure two bytes are present at this offset.
+
+ @return The value.
+ */
+WORD
+YoriLibShortcutReadWord(
+    __in PUCHAR Buffer,
+    __in DWORD Offset
+    )
+{
+    WORD Value;
+    memcpy(&Value, &Buffer[Offset], sizeof(WORD));
+    return Value;
+}
+
+/**
+ Copy a string from a shortcut file into a newly allocated string.  The
+ string in the shortcut is either in the ANSI code page or is UTF-16, and
+ is either NULL terminated or has a maximum length.
+
+ @param Buffer Pointer to the contents of the shortcut file.
+
+ @param BufferLength The number of bytes in Buffer.
+
+ @param Offset The offset of the string within the buffer.
+
+ @param MaxChars The maximum number of characters in the string.  The string
+        ends at this length or at a NULL character, whichever is first.
+
+ @param IsUnicode TRUE if the string is UTF-16, FALSE if it is in the ANSI
+        code page.
+
+ @param String On successful completion, populated with a newly allocated
+        string.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShortcutCopyString(
+    __in PUCHAR Buffer,
+    __in DWORD BufferLength,
+    __in DWORD Offset,
+    __in DWORD MaxChars,
+    __in BOOLEAN IsUnicode,
+    __out PYORI_STRING String
+    )
+{
+    DWORD CharSize;
+    DWORD CharCount;
+    WCHAR Char;
+
+    YoriLibInitEmptyString(String);
+
+    if (Offset >= BufferLength) {
+        return FALSE;
+    }
+
+    CharSize = IsUnicode?sizeof(WCHAR):sizeof(CHAR);
+
+    for (CharCount = 0; CharCount < MaxChars; CharCount++) {
+        if (Offset + (CharCount + 1) * CharSize > BufferLength) {
+            break;
+        }
+        if (IsUnicode) {
+            memcpy(&Char, &Buffer[Offset + CharCount * CharSize], sizeof(WCHAR));
+        } else {
+            Char = Buffer[Offset + CharCount];
+        }
+        if (Char == '\0') {
+            break;
+        }
+    }
+
+    if (CharCount == 0) {
+        return TRUE;
+    }
+
+    if (IsUnicode) {
+        if (!YoriLibAllocateString(String, (YORI_ALLOC_SIZE_T)(CharCount + 1))) {
+            return FALSE;
+        }
+        memcpy(String->StartOfString, &Buffer[Offset], CharCount * sizeof(WCHAR));
+        String->LengthInChars = (YORI_ALLOC_SIZE_T)CharCount;
+    } else {
+        INT Converted;
+        Converted = MultiByteToWideChar(CP_ACP, 0, (LPCSTR)&Buffer[Offset], (INT)CharCount, NULL, 0);
+        if (Converted <= 0) {
+            return FALSE;
+        }
+        if (!YoriLibAllocateString(String, (YORI_ALLOC_SIZE_T)(Converted + 1))) {
+            return FALSE;
+        }
+        String->LengthInChars = (YORI_ALLOC_SIZE_T)MultiByteToWideChar(CP_ACP, 0, (LPCSTR)&Buffer[Offset], (INT)CharCount, String->StartOfString, Converted);
+    }
+
+    String->StartOfString[String->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Combine a base path and a suffix from the link info of a shortcut into a
+ single path.  On success the base path is replaced with the combined path.
+
+ @param BasePath Pointer to the base path.  On successful completion, this is
+        freed and replaced with the combined path.
+
+ @param Suffix Pointer to the suffix.
+
+ @param AddSeperator TRUE if a seperator should be inserted between the base
+        path and suffix if neither supplies one.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShortcutAppendSuffix(
+    __inout PYORI_STRING BasePath,
+    __in PYORI_STRING Suffix,
+    __in BOOLEAN AddSeperator
+    )
+{
+    YORI_STRING Combined;
+    BOOLEAN NeedSeperator;
+
+    if (Suffix->LengthInChars == 0) {
+        return TRUE;
+    }
+
+    NeedSeperator = FALSE;
+    if (AddSeperator &&
+        BasePath->LengthInChars > 0 &&
+        !YoriLibIsSep(BasePath->StartOfString[BasePath->LengthInChars - 1]) &&
+        !YoriLibIsSep(Suffix->StartOfString[0])) {
+
+        NeedSeperator = TRUE;
+    }
+
+    if (!YoriLibAllocateString(&Combined, (YORI_ALLOC_SIZE_T)(BasePath->LengthInChars + Suffix->LengthInChars + 2))) {
+        return FALSE;
+    }
+
+    Combined.LengthInChars = YoriLibSPrintf(Combined.StartOfString, _T("%y%s%y"), BasePath, NeedSeperator?_T("\\"):_T(""), Suffix);
+    YoriLibFreeStringContents(BasePath);
+    memcpy(BasePath, &Combined, sizeof(YORI_STRING));
+    return TRUE;
+}
+
+/**
+ Parse the link info structure within a shortcut file to find the path to
+ the target.
+
+ @param Buffer Pointer to the contents of the shortcut file.
+
+ @param BufferLength The number of bytes in Buffer.
+
+ @param Offset The offset of the link info structure within the buffer.
+
+ @param LinkInfoSize The number of bytes in the link info structure.
+
+ @param Target On successful completion, populated with the path to the
+        target, or an empty string if the link info does not describe one.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShortcutParseLinkInfo(
+    __in PUCHAR Buffer,
+    __in DWORD BufferLength,
+    __in DWORD Offset,
+    __in DWORD LinkInfoSize,
+    __out PYORI_STRING Target
+    )
+{
+    DWORD HeaderSize;
+    DWORD Flags;
+    DWORD BasePathOffset;
+    DWORD NetworkOffset;
+    DWORD SuffixOffset;
+    DWORD NetNameOffset;
+    BOOLEAN SuffixUnicode;
+    BOOLEAN BaseUnicode;
+    BOOLEAN IsNetwork;
+    YORI_STRING Suffix;
+    DWORD End;
+
+    YoriLibInitEmptyString(Target);
+
+    End = Offset + LinkInfoSize;
+    if (LinkInfoSize < 0x1C || End > BufferLength || End < Offset) {
+        return FALSE;
+    }
+
+    HeaderSize = YoriLibShortcutReadDword(Buffer, Offset + 4);
+    Flags = YoriLibShortcutReadDword(Buffer, Offset + 8);
+    BasePathOffset = YoriLibShortcutReadDword(Buffer, Offset + 16);
+    NetworkOffset = YoriLibShortcutReadDword(Buffer, Offset + 20);
+    SuffixOffset = YoriLibShortcutReadDword(Buffer, Offset + 24);
+    BaseUnicode = FALSE;
+    SuffixUnicode = FALSE;
+
+    //
+    //  Newer shortcuts may contain Unicode versions of the paths, which are
+    //  preferred since the ANSI versions depend on the code page.
+    //
+
+    if (HeaderSize >= 0x24 && LinkInfoSize >= 0x24) {
+        if ((Flags & YORI_LIB_SHORTCUT_LINK_INFO_LOCAL) != 0) {
+            BasePathOffset = YoriLibShortcutReadDword(Buffer, Offset + 28);
+            BaseUnicode = TRUE;
+        }
+        SuffixOffset = YoriLibShortcutReadDword(Buffer, Offset + 32);
+        SuffixUnicode = TRUE;
+    }
+
+    IsNetwork = FALSE;
+    if ((Flags & YORI_LIB_SHORTCUT_LINK_INFO_LOCAL) != 0) {
+        if (!YoriLibShortcutCopyString(Buffer, End, Offset + BasePathOffset, LinkInfoSize, BaseUnicode, Target)) {
+            return FALSE;
+        }
+    } else if ((Flags & YORI_LIB_SHORTCUT_LINK_INFO_NETWORK) != 0) {
+
+        //
+        //  The common network relative link contains its own header, with
+        //  an optional Unicode share name.
+        //
+
+        NetworkOffset = Offset + NetworkOffset;
+        if (NetworkOffset + 0x14 > End) {
+            return FALSE;
+        }
+        NetNameOffset = YoriLibShortcutReadDword(Buffer, NetworkOffset + 8);
+        BaseUnicode = FALSE;
+        if (NetNameOffset > 0x14 && NetworkOffset + 0x1C <= End) {
+            NetNameOffset = YoriLibShortcutReadDword(Buffer, NetworkOffset + 20);
+            BaseUnicode = TRUE;
+        }
+        if (!YoriLibShortcutCopyString(Buffer, End, NetworkOffset + NetNameOffset, LinkInfoSize, BaseUnicode, Target)) {
+            return FALSE;
+        }
+        IsNetwork = TRUE;
+    } else {
+        return TRUE;
+    }
+
+    if (!YoriLibShortcutCopyString(Buffer, End, Offset + SuffixOffset, LinkInfoSize, SuffixUnicode, &Suffix)) {
+        YoriLibFreeStringContents(Target);
+        return FALSE;
+    }
+
+    if (!YoriLibShortcutAppendSuffix(Target, &Suffix, IsNetwork)) {
+        YoriLibFreeStringContents(&Suffix);
+        YoriLibFreeStringContents(Target);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&Suffix);
+    return TRUE;
+}
+
+/**
+ Free the strings within a shortcut information structure.
+
+ @param Info Pointer to the shortcut information to free.
+ */
+VOID
+YoriLibFreeShortcutInfo(
+    __inout PYORI_LIB_SHORTCUT_INFO Info
+    )
+{
+    YoriLibFreeStringContents(&Info->Target);
+    YoriLibFreeStringContents(&Info->Arguments);
+    YoriLibFreeStringContents(&Info->Description);
+    YoriLibFreeStringContents(&Info->WorkingDirectory);
+    YoriLibFreeStringContents(&Info->RelativePath);
+    YoriLibFreeStringContents(&Info->IconPath);
+}
+
+/**
+ Read the metadata from a shortcut file by parsing the file directly.  This
+ avoids creating a COM object for each shortcut, which is significantly
+ faster when many shortcuts need to be read, but it cannot resolve a
+ shortcut whose target is only described by a shell item ID list.  In that
+ case the Target string is empty and the caller may fall back to
+ IShellLink.
+
+ @param ShortcutFileName Pointer to the shortcut file to parse.
+
+ @param Info On successful completion, populated with information about the
+        shortcut.  The caller should free this with
+        @ref YoriLibFreeShortcutInfo .
+
+ @return TRUE to indicate success, FALSE to indicate failure, including if
+         the file is not a shortcut.
+ */
+__success(return)
+BOOL
+YoriLibParseShortcut(
+    __in PYORI_STRING ShortcutFileName,
+    __out PYORI_LIB_SHORTCUT_INFO Info
+    )
+{
+    HANDLE FileHandle;
+    PUCHAR Buffer;
+    DWORD BufferLength;
+    DWORD BytesRead;
+    DWORD FileSizeHigh;
+    DWORD Offset;
+    DWORD Flags;
+    DWORD BlockSize;
+    DWORD BlockSignature;
+    DWORD Index;
+    DWORD CharCount;
+    BOOLEAN IsUnicode;
+    BOOL Result;
+    YORI_STRING EnvString;
+    PYORI_STRING Strings[5];
+    DWORD StringFlags[5];
+
+    ASSERT(YoriLibIsStringNullTerminated(ShortcutFileName));
+
+    ZeroMemory(Info, sizeof(YORI_LIB_SHORTCUT_INFO));
+    YoriLibInitEmptyString(&Info->Target);
+    YoriLibInitEmptyString(&Info->Arguments);
+    YoriLibInitEmptyString(&Info->Description);
+    YoriLibInitEmptyString(&Info->WorkingDirectory);
+    YoriLibInitEmptyString(&Info->RelativePath);
+    YoriLibInitEmptyString(&Info->IconPath);
+
+    FileHandle = CreateFile(ShortcutFileName->StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    BufferLength = GetFileSize(FileHandle, &FileSizeHigh);
+    if (BufferLength == INVALID_FILE_SIZE ||
+        FileSizeHigh != 0 ||
+        BufferLength < YORI_LIB_SHORTCUT_HEADER_SIZE ||
+        BufferLength > YORI_LIB_SHORTCUT_MAX_FILE_SIZE) {
+
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(BufferLength);
+    if (Buffer == NULL) {
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    if (!ReadFile(FileHandle, Buffer, BufferLength, &BytesRead, NULL) ||
+        BytesRead != BufferLength) {
+
+        YoriLibFree(Buffer);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    CloseHandle(FileHandle);
+
+    Result = FALSE;
+
+    //
+    //  Check the header size and class identifier.
+    //
+
+    if (YoriLibShortcutReadDword(Buffer, 0) != YORI_LIB_SHORTCUT_HEADER_SIZE ||
+        memcmp(&Buffer[4], &CLSID_ShellLink, sizeof(GUID)) != 0) {
+
+        goto Exit;
+    }
+
+    Flags = YoriLibShortcutReadDword(Buffer, 20);
+    Info->IconIndex = YoriLibShortcutReadDword(Buffer, 56);
+    Info->ShowCommand = YoriLibShortcutReadDword(Buffer, 60);
+    Info->Hotkey = YoriLibShortcutReadWord(Buffer, 64);
+    IsUnicode = (BOOLEAN)((Flags & YORI_LIB_SHORTCUT_IS_UNICODE) != 0);
+    Offset = YORI_LIB_SHORTCUT_HEADER_SIZE;
+
+    //
+    //  Skip the shell item ID list, which can only be interpreted by the
+    //  shell.
+    //
+
+    if (Flags & YORI_LIB_SHORTCUT_HAS_ID_LIST) {
+        if (Offset + sizeof(WORD) > BufferLength) {
+            goto Exit;
+        }
+        Offset = Offset + sizeof(WORD) + YoriLibShortcutReadWord(Buffer, Offset);
+    }
+
+    if (Flags & YORI_LIB_SHORTCUT_HAS_LINK_INFO) {
+        if (Offset + sizeof(DWORD) > BufferLength) {
+            goto Exit;
+        }
+        BlockSize = YoriLibShortcutReadDword(Buffer, Offset);
+        if ((Flags & YORI_LIB_SHORTCUT_FORCE_NO_LINK_INFO) == 0) {
+            if (!YoriLibShortcutParseLinkInfo(Buffer, BufferLength, Offset, BlockSize, &Info->Target)) {
+                goto Exit;
+            }
+        }
+        Offset = Offset + BlockSize;
+    }
+
+    //
+    //  String data follows in a fixed order, with each string present only
+    //  if the corresponding flag is set.
+    //
+
+    Strings[0] = &Info->Description;
+    StringFlags[0] = YORI_LIB_SHORTCUT_HAS_NAME;
+    Strings[1] = &Info->RelativePath;
+    StringFlags[1] = YORI_LIB_SHORTCUT_HAS_RELATIVE_PATH;
+    Strings[2] = &Info->WorkingDirectory;
+    StringFlags[2] = YORI_LIB_SHORTCUT_HAS_WORKING_DIR;
+    Strings[3] = &Info->Arguments;
+    StringFlags[3] = YORI_LIB_SHORTCUT_HAS_ARGUMENTS;
+    Strings[4] = &Info->IconPath;
+    StringFlags[4] = YORI_LIB_SHORTCUT_HAS_ICON_LOCATION;
+
+    for (Index = 0; Index < sizeof(Strings)/sizeof(Strings[0]); Index++) {
+        if ((Flags & StringFlags[Index]) == 0) {
+            continue;
+        }
+        if (Offset + sizeof(WORD) > BufferLength) {
+            goto Exit;
+        }
+        CharCount = YoriLibShortcutReadWord(Buffer, Offset);
+        Offset = Offset + sizeof(WORD);
+        if (!YoriLibShortcutCopyString(Buffer, BufferLength, Offset, CharCount, IsUnicode, Strings[Index])) {
+            if (CharCount > 0) {
+                goto Exit;
+            }
+        }
+        Offset = Offset + CharCount * (IsUnicode?sizeof(WCHAR):sizeof(CHAR));
+    }
+
+    //
+    //  Extra data blocks may contain paths with environment variables which
+    //  take precedence over the target and icon location above.
+    //
+
+    while (Offset + 2 * sizeof(DWORD) <= BufferLength) {
+        BlockSize = YoriLibShortcutReadDword(Buffer, Offset);
+        if (BlockSize < 2 * sizeof(DWORD) || Offset + BlockSize > BufferLength) {
+            break;
+        }
+        BlockSignature = YoriLibShortcutReadDword(Buffer, Offset + 4);
+        if (BlockSize >= YORI_LIB_SHORTCUT_ENVIRONMENT_SIZE &&
+            ((BlockSignature == YORI_LIB_SHORTCUT_ENVIRONMENT_SIG && (Flags & YORI_LIB_SHORTCUT_HAS_EXP_STRING)) ||
+             (BlockSignature == YORI_LIB_SHORTCUT_ICON_ENVIRONMENT_SIG && (Flags & YORI_LIB_SHORTCUT_HAS_EXP_ICON)))) {
+
+            if (YoriLibShortcutCopyString(Buffer, Offset + BlockSize, Offset + 8 + 260, 260, TRUE, &EnvString) &&
+                EnvString.LengthInChars > 0) {
+
+                if (BlockSignature == YORI_LIB_SHORTCUT_ENVIRONMENT_SIG) {
+                    YoriLibFreeStringContents(&Info->Target);
+                    memcpy(&Info->Target, &EnvString, sizeof(YORI_STRING));
+                } else {
+                    YoriLibFreeStringContents(&Info->IconPath);
+                    memcpy(&Info->IconPath, &EnvString, sizeof(YORI_STRING));
+                }
+            }
+        }
+        Offset = Offset + BlockSize;
+    }
+
+    Result = TRUE;
+
+Exit:
+    YoriLibFree(Buffer);
+    if (!Result) {
+        YoriLibFreeShortcutInfo(Info);
+    }
+    return Result;
+}
+
+/**
+ Prepare a shortcut session for use.  A session allows the COM objects used
+ to read shortcuts to be created once and used for many shortcuts, rather
+ than being created for each one.  The objects are created on first use, so
+ a session that is never needed costs nothing.  A session can only be used
+ on the thread that initialized it.
+
+ @param Session Pointer to the session to initialize.
+ */
+VOID
+YoriLibInitializeShortcutSession(
+    __out PYORI_LIB_SHORTCUT_SESSION Session
+    )
+{
+    Session->ShellLink = NULL;
+    Session->PersistFile = NULL;
+}
+
+/**
+ Release the COM objects used by a shortcut session.
+
+ @param Session Pointer to the session to clean up.
+ */
+VOID
+YoriLibCleanupShortcutSession(
+    __inout PYORI_LIB_SHORTCUT_SESSION Session
+    )
+{
+    if (Session->PersistFile != NULL) {
+        Session->PersistFile->lpVtbl->Release(Session->PersistFile);
+        Session->PersistFile = NULL;
+    }
+
+    if (Session->ShellLink != NULL) {
+        Session->ShellLink->Vtbl->Release(Session->ShellLink);
+        Session->ShellLink = NULL;
+    }
+}
+
+/**
+ Obtain the COM objects used to read a shortcut, creating them if needed.
+ If a session is specified, objects created previously are reused, and any
+ new objects are retained in the session.  If not, the caller must release
+ the objects.
+
+ @param Session Optionally points to a shortcut session.
+
+ @param ShellLink On successful completion, populated with a pointer to an
+        IShellLinkW interface.
+
+ @param PersistFile On successful completion, populated with a pointer to an
+        IPersistFile interface on the same object.
+
+ @return HRESULT including S_OK to indicate success, or appropriate failure.
+ */
+__success(return == S_OK)
+HRESULT
+YoriLibGetShortcutObjects(
+    __in_opt PYORI_LIB_SHORTCUT_SESSION Session,
+    __out IShellLinkW **ShellLink,
+    __out IPersistFile **PersistFile
+    )
+{
+    IShellLinkW *Scut = NULL;
+    IPersistFile *ScutFile = NULL;
+    HRESULT hRes;
+
+    if (Session != NULL && Session->ShellLink != NULL) {
+        *ShellLink = Session->ShellLink;
+        *PersistFile = Session->PersistFile;
+        return S_OK;
+    }
+
+    YoriLibLoadOle32Functions();
+    if (DllOle32.pCoCreateInstance == NULL || DllOle32.pCoInitialize == NULL) {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_FUNCTION);
+    }
+
+    hRes = DllOle32.pCoInitialize(NULL);
+    if (!SUCCEEDED(hRes)) {
+        return hRes;
+    }
+
+    hRes = DllOle32.pCoCreateInstance(&CLSID_ShellLink, NULL, CLSCTX_INPROC_SERVER, &IID_IShellLinkW, (void **)&Scut);
+    if (!SUCCEEDED(hRes)) {
+        return hRes;
+    }
+
+    hRes = Scut->Vtbl->QueryInterface(Scut, &IID_IPersistFile, (void **)&ScutFile);
+    if (!SUCCEEDED(hRes)) {
+        Scut->Vtbl->Release(Scut);
+        return hRes;
+    }
+
+    if (Session != NULL) {
+        Session->ShellLink = Scut;
+        Session->PersistFile = ScutFile;
+    }
+
+    *ShellLink = Scut;
+    *PersistFile = ScutFile;
+    return S_OK;
+}
+
+/**
+ Load the path to an icon resource from a specified shortcut file.  The
+ shortcut file is parsed directly where possible, and IShellLink is only
+ used for shortcuts that the parser cannot resolve.
 
  @param ShortcutFileName Pointer to the shortcut file to resolve.
 
+ @param Session Optionally points to a shortcut session.  When loading many
+        shortcuts, a session allows any COM objects to be reused.
+
  @param IconPath On successful completion, populated with a path to a file
         containing the icon to display.
 
@@ -245,12 +961,14 @@ __success(return)
 BOOL
 YoriLibLoadShortcutIconPath(
     __in PYORI_STRING ShortcutFileName,
+    __in_opt PYORI_LIB_SHORTCUT_SESSION Session,
     __out PYORI_STRING IconPath,
     __out PDWORD IconIndex
     )
 {
     YORI_STRING IconLocation;
     YORI_STRING ExpandedLocation;
+    YORI_LIB_SHORTCUT_INFO Info;
     DWORD LocalIconIndex;
     IShellLinkW *Scut = NULL;
     IPersistFile *ScutFile = NULL;
@@ -260,29 +978,37 @@ YoriLibLoadShortcutIconPath(
 
     ASSERT(YoriLibIsStringNullTerminated(ShortcutFileName));
 
-    YoriLibLoadShell32Functions();
-    YoriLibLoadOle32Functions();
-    if (DllOle32.pCoCreateInstance == NULL || DllOle32.pCoInitialize == NULL) {
-        return FALSE;
-    }
-
-    hRes = DllOle32.pCoInitialize(NULL);
-    if (!SUCCEEDED(hRes)) {
-        return FALSE;
-    }
-
-    hRes = DllOle32.pCoCreateInstance(&CLSID_ShellLink, NULL, CLSCTX_INPROC_SERVER, &IID_IShellLinkW, (void **)&Scut);
-    if (!SUCCEEDED(hRes)) {
-        return FALSE;
-    }
-
     YoriLibInitEmptyString(&IconLocation);
     YoriLibInitEmptyString(&ExpandedLocation);
     LocalIconIndex = 0;
 
-    hRes = Scut->Vtbl->QueryInterface(Scut, &IID_IPersistFile, (void **)&ScutFile);
+    //
+    //  Try to read the shortcut without involving COM.  If the shortcut has
+    //  an icon location use it, otherwise use the target.  If neither can
+    //  be found, the target is probably a shell namespace object, so let
+    //  the shell resolve it.
+    //
+
+    if (YoriLibParseShortcut(ShortcutFileName, &Info)) {
+        if (Info.IconPath.LengthInChars > 0) {
+            memcpy(&IconLocation, &Info.IconPath, sizeof(YORI_STRING));
+            YoriLibInitEmptyString(&Info.IconPath);
+            LocalIconIndex = Info.IconIndex;
+        } else if (Info.Target.LengthInChars > 0) {
+            memcpy(&IconLocation, &Info.Target, sizeof(YORI_STRING));
+            YoriLibInitEmptyString(&Info.Target);
+        }
+        YoriLibFreeShortcutInfo(&Info);
+
+        if (IconLocation.LengthInChars > 0) {
+            goto Expand;
+        }
+    }
+
+    YoriLibLoadShell32Functions();
+    hRes = YoriLibGetShortcutObjects(Session, &Scut, &ScutFile);
     if (!SUCCEEDED(hRes)) {
-        goto Exit;
+        return FALSE;
     }
 
     hRes = ScutFile->lpVtbl->Load(ScutFile, ShortcutFileName->StartOfString, 0);
@@ -361,6 +1087,8 @@ YoriLibLoadShortcutIconPath(
         goto Exit;
     }
 
+Expand:
+
     //
     //  Newer versions of Windows expand the environment variables in the
     //  shortcut by default.  Older versions require us to do it manually
@@ -392,14 +1120,21 @@ Exit:
     YoriLibFreeStringContents(&IconLocation);
     YoriLibFreeStringContents(&ExpandedLocation);
 
-    if (ScutFile != NULL) {
-        ScutFile->lpVtbl->Release(ScutFile);
-        ScutFile = NULL;
-    }
+    //
+    //  If the objects belong to a session, leave them for the next
+    //  shortcut.
+    //
 
-    if (Scut != NULL) {
-        Scut->Vtbl->Release(Scut);
-        Scut = NULL;
+    if (Session == NULL) {
+        if (ScutFile != NULL) {
+            ScutFile->lpVtbl->Release(ScutFile);
+            ScutFile = NULL;
+        }
+
+        if (Scut != NULL) {
+            Scut->Vtbl->Release(Scut);
+            Scut = NULL;
+        }
     }
 
     return Result;
@@ -318,8 +318,17 @@ YoriLibReadConsoleOutputAttributeForSelection(
 }
 
 /**
- Nano doesn't implement ReadConsoleOutputCharacter, so fall back to
- ReadConsoleOutput.
+ The maximum number of console cells to request from ReadConsoleOutput in a
+ single call when reading a region.  Older consoles marshal the request
+ through a 64Kb buffer and fail requests larger than that.
+ */
+#define YORILIB_SELECTION_CELLS_PER_READ (8 * 1024)
+
+/**
+ Read the characters in a rectangular region of the console.  Rather than
+ issuing a request per line, each request covers as many complete lines as
+ fit within YORILIB_SELECTION_CELLS_PER_READ cells.  This uses
+ ReadConsoleOutput because Nano doesn't implement ReadConsoleOutputCharacter.
 
  @param Selection Pointer to the selection which may contain a previous
         allocation for this routine to use, and may be populated with a new
@@ -327,39 +336,49 @@ YoriLibReadConsoleOutputAttributeForSelection(
 
  @param hConsole Handle to the console output.
 
- @param lpCharacter Pointer to an array of TCHARs that is populated with
-        characters inside this routine.
-
- @param nLength The number of console cells and characters to populate.
-
- @param dwReadCoord The console buffer coordinates to start reading
-        characters from.
+ @param lpCharacter Pointer to an array of TCHARs that is populated with the
+        characters in the region, one line after another.  This must be
+        large enough to hold the width of the region multiplied by its
+        height.
 
- @param lpNumberOfCharsRead On successful completion, updated to contain the
-        number of characters successfully read.
+ @param Region Pointer to the region of the console buffer to read.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriLibReadConsoleOutputCharacterForSelection(
+YoriLibReadConsoleRegionCharactersForSelection(
     __in PYORILIB_SELECTION Selection,
     __in HANDLE hConsole,
-    __out_ecount(nLength) LPTSTR lpCharacter,
-    __in DWORD nLength,
-    __in COORD dwReadCoord,
-    __out LPDWORD lpNumberOfCharsRead
+    __out LPTSTR lpCharacter,
+    __in PSMALL_RECT Region
     )
 {
     PCHAR_INFO CharInfo;
     SMALL_RECT ReadRegion;
     COORD dwBufferSize;
     COORD dwBufferCoord;
+    DWORD LineLength;
+    DWORD LineCount;
+    DWORD LinesPerRead;
+    DWORD LineIndex;
     DWORD dwIndex;
+    DWORD dwCellCount;
     DWORD dwAllocSize;
 
-    if (nLength > Selection->TempCharInfoBufferSize) {
-        dwAllocSize = nLength * 2;
+    LineLength = Region->Right - Region->Left + 1;
+    LineCount = Region->Bottom - Region->Top + 1;
+
+    LinesPerRead = YORILIB_SELECTION_CELLS_PER_READ / LineLength;
+    if (LinesPerRead == 0) {
+        LinesPerRead = 1;
+    }
+    if (LinesPerRead > LineCount) {
+        LinesPerRead = LineCount;
+    }
+
+    if (LineLength * LinesPerRead > Selection->TempCharInfoBufferSize) {
+        dwAllocSize = LineLength * LinesPerRead;
         if (dwAllocSize < 0x100) {
             dwAllocSize = 0x100;
         }
@@ -382,33 +401,36 @@ YoriLibReadConsoleOutputCharacterForSelection(
     }
 
     CharInfo = Selection->TempCharInfoBuffer;
-
-    dwBufferSize.X = (SHORT)nLength;
-    dwBufferSize.Y = 1;
     dwBufferCoord.X = 0;
     dwBufferCoord.Y = 0;
-    ReadRegion.Left = dwReadCoord.X;
-    ReadRegion.Top = dwReadCoord.Y;
-    ReadRegion.Right = (SHORT)(dwReadCoord.X + nLength - 1);
-    ReadRegion.Bottom = dwReadCoord.Y;
 
-    if (!ReadConsoleOutput(hConsole, CharInfo, dwBufferSize, dwBufferCoord, &ReadRegion)) {
-        return FALSE;
-    }
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex += dwBufferSize.Y) {
+        dwBufferSize.X = (SHORT)LineLength;
+        dwBufferSize.Y = (SHORT)LinesPerRead;
+        if (LineCount - LineIndex < LinesPerRead) {
+            dwBufferSize.Y = (SHORT)(LineCount - LineIndex);
+        }
 
-    for (dwIndex = 0; dwIndex < nLength; dwIndex++) {
-        lpCharacter[dwIndex] = CharInfo[dwIndex].Char.UnicodeChar;
-    }
+        ReadRegion.Left = Region->Left;
+        ReadRegion.Right = Region->Right;
+        ReadRegion.Top = (SHORT)(Region->Top + LineIndex);
+        ReadRegion.Bottom = (SHORT)(ReadRegion.Top + dwBufferSize.Y - 1);
+
+        if (!ReadConsoleOutput(hConsole, CharInfo, dwBufferSize, dwBufferCoord, &ReadRegion)) {
+            return FALSE;
+        }
 
-    if (lpNumberOfCharsRead != NULL) {
-        *lpNumberOfCharsRead = ReadRegion.Right - ReadRegion.Left + 1;
+        dwCellCount = LineLength * dwBufferSize.Y;
+        for (dwIndex = 0; dwIndex < dwCellCount; dwIndex++) {
+            lpCharacter[dwIndex] = CharInfo[dwIndex].Char.UnicodeChar;
+        }
+        lpCharacter += dwCellCount;
     }
 
     return TRUE;
 }
 
 
-
 /**
  Return the selection color to use.  On Vista and newer systems this is the
  console popup color, which is what quickedit would do.  On Nano server,
@@ -1397,6 +1419,7 @@ YoriLibCopySelectionIfPresent(
     SHORT LineCount;
     SHORT LineIndex;
     LPTSTR TextWritePoint;
+    LPTSTR RawText;
     COORD StartPoint;
     DWORD CharsWritten;
     HANDLE ConsoleHandle;
@@ -1449,44 +1472,33 @@ YoriLibCopySelectionIfPresent(
     }
 
     //
-    //  In the first pass, copy all of the text, including trailing spaces.
-    //  This version will be used to construct the rich text form.
+    //  Read all of the text, including trailing spaces, into the end of the
+    //  buffer.  This version will be used to construct the rich text form.
+    //  The plain text form is built afterwards by moving each line towards
+    //  the start of the buffer, so the console is only read once.  Since
+    //  the raw text starts two chars per line into the buffer, a line with
+    //  its newline never overwrites text that has not yet been moved.
     //
 
-    TextWritePoint = TextToCopy.StartOfString;
-    for (LineIndex = Selection->CurrentlySelected.Top; LineIndex <= Selection->CurrentlySelected.Bottom; LineIndex++) {
-        StartPoint.X = Selection->CurrentlySelected.Left;
-        StartPoint.Y = LineIndex;
-
-        YoriLibReadConsoleOutputCharacterForSelection(Selection, ConsoleHandle, TextWritePoint, LineLength, StartPoint, &CharsWritten);
-
-        TextWritePoint += LineLength;
+    RawText = TextToCopy.StartOfString + 2 * LineCount;
+    if (!YoriLibReadConsoleRegionCharactersForSelection(Selection, ConsoleHandle, RawText, &Selection->CurrentlySelected)) {
+        YoriLibFreeStringContents(&TextToCopy);
+        return FALSE;
     }
 
-    TextToCopy.LengthInChars = (YORI_ALLOC_SIZE_T)(TextWritePoint - TextToCopy.StartOfString);
-
-    StartPoint.X = (SHORT)(Selection->CurrentlySelected.Right - Selection->CurrentlySelected.Left + 1);
-    StartPoint.Y = (SHORT)(Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top + 1);
+    StartPoint.X = LineLength;
+    StartPoint.Y = LineCount;
 
     //
-    //  If the system clipboard is not available and clipboard support is
-    //  emulated within the process, only plain text is supported.  If the
-    //  system clipboard is available, build RTF and HTML forms.
+    //  If the system clipboard is available, combine the captured text with
+    //  previously saved attributes into a VT100 stream.  This will turn into
+    //  HTML and RTF.  If clipboard support is emulated within the process,
+    //  only plain text is supported.
     //
 
-    if (!YoriLibIsSystemClipboardAvailable()) {
-        if (YoriLibCopyTextWithProcessFallback(&TextToCopy)) {
-            YoriLibFreeStringContents(&TextToCopy);
-            return TRUE;
-        }
-    } else {
-
-        //
-        //  Combine the captured text with previously saved attributes into a
-        //  VT100 stream.  This will turn into HTML and RTF.
-        //
+    YoriLibInitEmptyString(&VtText);
+    if (YoriLibIsSystemClipboardAvailable()) {
 
-        YoriLibInitEmptyString(&VtText);
         ZeroMemory(&Attributes, sizeof(Attributes));
 
         YoriLibCreateNewAttributeBufferFromPreviousBuffer(Selection,
@@ -1502,48 +1514,55 @@ YoriLibCopySelectionIfPresent(
             return FALSE;
         }
 
-        if (!YoriLibGenerateVtStringFromConsoleBuffers(&VtText, StartPoint, TextToCopy.StartOfString, Attributes.AttributeArray)) {
+        if (!YoriLibGenerateVtStringFromConsoleBuffers(&VtText, StartPoint, RawText, Attributes.AttributeArray)) {
             YoriLibFree(Attributes.AttributeArray);
             YoriLibFreeStringContents(&TextToCopy);
             return FALSE;
         }
 
         YoriLibFree(Attributes.AttributeArray);
+    }
 
-        //
-        //  In the second pass, copy all of the text, truncating trailing spaces.
-        //  This version will be used to construct the plain text form.
-        //
-
-        TextWritePoint = TextToCopy.StartOfString;
-        for (LineIndex = Selection->CurrentlySelected.Top; LineIndex <= Selection->CurrentlySelected.Bottom; LineIndex++) {
-            StartPoint.X = Selection->CurrentlySelected.Left;
-            StartPoint.Y = LineIndex;
+    //
+    //  Build the plain text form, truncating trailing spaces.
+    //
 
-            YoriLibReadConsoleOutputCharacterForSelection(Selection, ConsoleHandle, TextWritePoint, LineLength, StartPoint, &CharsWritten);
-            while (CharsWritten > 0) {
-                if (TextWritePoint[CharsWritten - 1] != ' ') {
-                    break;
-                }
-                CharsWritten--;
+    TextWritePoint = TextToCopy.StartOfString;
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex++) {
+        CharsWritten = LineLength;
+        while (CharsWritten > 0) {
+            if (RawText[CharsWritten - 1] != ' ') {
+                break;
             }
-            TextWritePoint += CharsWritten;
-
-            TextWritePoint[0] = '\r';
-            TextWritePoint++;
-            TextWritePoint[0] = '\n';
-            TextWritePoint++;
+            CharsWritten--;
         }
 
-        TextToCopy.LengthInChars = (YORI_ALLOC_SIZE_T)(TextWritePoint - TextToCopy.StartOfString);
+        memmove(TextWritePoint, RawText, CharsWritten * sizeof(TCHAR));
+        TextWritePoint += CharsWritten;
+        RawText += LineLength;
 
-        //
-        //  Remove the final CRLF
-        //
+        TextWritePoint[0] = '\r';
+        TextWritePoint++;
+        TextWritePoint[0] = '\n';
+        TextWritePoint++;
+    }
+
+    TextToCopy.LengthInChars = (YORI_ALLOC_SIZE_T)(TextWritePoint - TextToCopy.StartOfString);
+
+    //
+    //  Remove the final CRLF
+    //
 
-        if (TextToCopy.LengthInChars >= 2) {
-            TextToCopy.LengthInChars -= 2;
+    if (TextToCopy.LengthInChars >= 2) {
+        TextToCopy.LengthInChars -= 2;
+    }
+
+    if (!YoriLibIsSystemClipboardAvailable()) {
+        if (YoriLibCopyTextWithProcessFallback(&TextToCopy)) {
+            YoriLibFreeStringContents(&TextToCopy);
+            return TRUE;
         }
+    } else {
 
         //
         //  Convert the VT100 form into HTML and RTF, and free it
@@ -0,0 +1,197 @@
+/**
+ * @file lib/stats.c
+ *
+ * Yori lib performance statistics
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ Process global performance statistics.  Counters are only updated when
+ Enabled is TRUE.
+ */
+YORI_LIB_STATS YoriLibStats;
+
+/**
+ Begin collecting performance statistics.  This is called by a program
+ which has been asked to display statistics, typically via a -stats
+ option.  The statistics are displayed when the program returns from its
+ entrypoint.  Any previously collected statistics are discarded.
+ */
+VOID
+YoriLibEnableStatistics(VOID)
+{
+    ZeroMemory(&YoriLibStats, sizeof(YoriLibStats));
+    YoriLibStats.StartTime = YoriLibGetSystemTimeAsInteger();
+    YoriLibStats.Enabled = TRUE;
+}
+
+/**
+ Indicate that a program is beginning a new phase of its processing, so
+ that the time spent in each phase can be displayed.  The previous phase,
+ if any, ends when this one begins.  When statistics are not enabled, or
+ the maximum number of phases has been reached, does nothing.
+
+ @param Name Pointer to a constant string describing the phase.  This must
+        remain valid until statistics are displayed.
+ */
+VOID
+YoriLibBeginStatisticsPhase(
+    __in LPCTSTR Name
+    )
+{
+    PYORI_LIB_STATS_PHASE Phase;
+
+    if (!YoriLibStats.Enabled ||
+        YoriLibStats.PhaseCount >= YORI_LIB_STATS_MAX_PHASES) {
+
+        return;
+    }
+
+    Phase = &YoriLibStats.Phases[YoriLibStats.PhaseCount];
+    Phase->Name = Name;
+    Phase->StartTime = YoriLibGetSystemTimeAsInteger();
+    YoriLibStats.PhaseCount++;
+}
+
+/**
+ Record a read from a file.  The caller is expected to check that
+ statistics are enabled first, so that no call is made when they are not.
+
+ @param Bytes The number of bytes read.
+ */
+VOID
+YoriLibStatisticsRecordRead(
+    __in DWORD Bytes
+    )
+{
+    InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.ReadCalls);
+    YoriLibStats.BytesRead = YoriLibStats.BytesRead + Bytes;
+}
+
+/**
+ Record a write to a file or device.  The caller is expected to check that
+ statistics are enabled first, so that no call is made when they are not.
+
+ @param Bytes The number of bytes written.
+ */
+VOID
+YoriLibStatisticsRecordWrite(
+    __in DWORD Bytes
+    )
+{
+    InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.WriteCalls);
+    YoriLibStats.BytesWritten = YoriLibStats.BytesWritten + Bytes;
+}
+
+/**
+ Record a memory allocation.  The caller is expected to check that
+ statistics are enabled first, so that no call is made when they are not.
+
+ @param Bytes The number of bytes allocated.
+ */
+VOID
+YoriLibStatisticsRecordAllocation(
+    __in YORI_ALLOC_SIZE_T Bytes
+    )
+{
+    InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&YoriLibStats.Allocations);
+    YoriLibStats.BytesAllocated = YoriLibStats.BytesAllocated + Bytes;
+}
+
+/**
+ Display a time interval in milliseconds.
+
+ @param Label Pointer to a constant string describing the interval.
+
+ @param Interval The interval, in 100ns units.
+ */
+VOID
+YoriLibDisplayStatisticsTime(
+    __in LPCTSTR Label,
+    __in LONGLONG Interval
+    )
+{
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("  %-24s %lli ms\n"), Label, Interval / (10 * 1000));
+}
+
+/**
+ Display collected performance statistics and stop collecting them.  When
+ statistics are not enabled, does nothing.
+ */
+VOID
+YoriLibDisplayStatistics(VOID)
+{
+    LONGLONG EndTime;
+    LONGLONG PhaseEndTime;
+    DWORD Index;
+
+    if (!YoriLibStats.Enabled) {
+        return;
+    }
+
+    //
+    //  Stop collecting before displaying, since displaying writes output
+    //  and allocates.
+    //
+
+    EndTime = YoriLibGetSystemTimeAsInteger();
+    YoriLibStats.Enabled = FALSE;
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Statistics:\n"));
+    YoriLibDisplayStatisticsTime(_T("Elapsed time:"), EndTime - YoriLibStats.StartTime);
+    for (Index = 0; Index < YoriLibStats.PhaseCount; Index++) {
+        if (Index + 1 < YoriLibStats.PhaseCount) {
+            PhaseEndTime = YoriLibStats.Phases[Index + 1].StartTime;
+        } else {
+            PhaseEndTime = EndTime;
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                      _T("  Phase %-18s %lli ms\n"),
+                      YoriLibStats.Phases[Index].Name,
+                      (PhaseEndTime - YoriLibStats.Phases[Index].StartTime) / (10 * 1000));
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                  _T("  Files enumerated:        %i\n")
+                  _T("  Directory searches:      %i\n")
+                  _T("  Directory reads:         %i\n")
+                  _T("  Read calls:              %i\n")
+                  _T("  Bytes read:              %lli\n")
+                  _T("  Write calls:             %i\n")
+                  _T("  Bytes written:           %lli\n")
+                  _T("  Allocations:             %i\n")
+                  _T("  Bytes allocated:         %lli\n"),
+                  YoriLibStats.FilesEnumerated,
+                  YoriLibStats.DirectorySearches,
+                  YoriLibStats.DirectoryReads,
+                  YoriLibStats.ReadCalls,
+                  YoriLibStats.BytesRead,
+                  YoriLibStats.WriteCalls,
+                  YoriLibStats.BytesWritten,
+                  YoriLibStats.Allocations,
+                  YoriLibStats.BytesAllocated);
+}
+
+// vim:sw=4:ts=4:et:
@@ -822,7 +822,69 @@ YoriLibCompareStringWithLiteral(
 }
 
 /**
- Convert a single english character to its uppercase form.
+ The first character whose uppercase form is cached in
+ @ref YoriLibUpcaseTable .  Characters below this are ASCII and are
+ converted arithmetically.
+ */
+#define YORI_LIB_UPCASE_TABLE_FIRST_CHAR (0x80)
+
+/**
+ The number of characters whose uppercase form is cached.  This covers
+ Latin-1, Latin Extended, IPA, Greek and Cyrillic, which are the non-ASCII
+ characters most commonly found in file names.
+ */
+#define YORI_LIB_UPCASE_TABLE_SIZE (0x500 - YORI_LIB_UPCASE_TABLE_FIRST_CHAR)
+
+/**
+ A cache of the uppercase forms of non-ASCII characters, similar to the
+ $UpCase table that NTFS uses.  An entry of zero indicates the uppercase
+ form has not been determined yet.  Since no character in this range has an
+ uppercase form of zero, each entry can be populated by any thread without
+ synchronization.
+ */
+TCHAR YoriLibUpcaseTable[YORI_LIB_UPCASE_TABLE_SIZE];
+
+/**
+ Convert a single character outside of the ASCII range to its uppercase
+ form.  This uses the system's case mapping, which is the same mapping file
+ systems use to compare names.  If the system does not provide one, the
+ character is returned unchanged.
+
+ @param c The character to convert.
+
+ @return The uppercase form of the character.
+ */
+TCHAR
+YoriLibUpcaseNonAsciiChar(
+    __in TCHAR c
+    )
+{
+    TCHAR Upcased;
+    YORI_ALLOC_SIZE_T TableIndex;
+
+    TableIndex = (YORI_ALLOC_SIZE_T)(c - YORI_LIB_UPCASE_TABLE_FIRST_CHAR);
+    if (TableIndex < YORI_LIB_UPCASE_TABLE_SIZE) {
+        Upcased = YoriLibUpcaseTable[TableIndex];
+        if (Upcased != 0) {
+            return Upcased;
+        }
+    }
+
+    Upcased = c;
+    YoriLibLoadNtDllFunctions();
+    if (DllNtDll.pRtlUpcaseUnicodeChar != NULL) {
+        Upcased = DllNtDll.pRtlUpcaseUnicodeChar(c);
+    }
+
+    if (TableIndex < YORI_LIB_UPCASE_TABLE_SIZE) {
+        YoriLibUpcaseTable[TableIndex] = Upcased;
+    }
+
+    return Upcased;
+}
+
+/**
+ Convert a single character to its uppercase form.
 
  @param c The character to convert.
 
@@ -833,10 +895,54 @@ YoriLibUpcaseChar(
     __in TCHAR c
     )
 {
-    if (c >= 'a' && c <= 'z') {
-        return (TCHAR)(c - 'a' + 'A');
+    if (c < YORI_LIB_UPCASE_TABLE_FIRST_CHAR) {
+        if (c >= 'a' && c <= 'z') {
+            return (TCHAR)(c - 'a' + 'A');
+        }
+        return c;
     }
-    return c;
+    return YoriLibUpcaseNonAsciiChar(c);
+}
+
+/**
+ Count the number of leading characters that are identical between two
+ buffers, up to a specified maximum.  On architectures which support
+ unaligned loads this compares a pointer sized word at a time.  Since
+ identical characters are also equal without regard to case, insensitive
+ comparisons use this to skip over matching runs without converting case.
+
+ @param Str1 Pointer to the first buffer of characters.
+
+ @param Str2 Pointer to the second buffer of characters.
+
+ @param MaxCount The number of characters to compare.
+
+ @return The number of identical characters.
+ */
+YORI_ALLOC_SIZE_T
+YoriLibCountIdenticalChars(
+    __in_ecount(MaxCount) LPCTSTR Str1,
+    __in_ecount(MaxCount) LPCTSTR Str2,
+    __in YORI_ALLOC_SIZE_T MaxCount
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    Index = 0;
+
+#if defined(_M_IX86) || defined(_M_AMD64) || defined(_M_ARM64)
+    while (MaxCount - Index >= sizeof(DWORD_PTR) / sizeof(TCHAR) &&
+           *(DWORD_PTR *)&Str1[Index] == *(DWORD_PTR *)&Str2[Index]) {
+
+        Index = Index + sizeof(DWORD_PTR) / sizeof(TCHAR);
+    }
+#endif
+
+    while (Index < MaxCount && Str1[Index] == Str2[Index]) {
+        Index++;
+    }
+
+    return Index;
 }
 
 /**
@@ -863,6 +969,8 @@ YoriLibCompareStringWithLiteralInsensitiveCount(
     )
 {
     YORI_ALLOC_SIZE_T Index = 0;
+    TCHAR Char1;
+    TCHAR Char2;
 
     if (count == 0) {
         return 0;
@@ -880,10 +988,16 @@ YoriLibCompareStringWithLiteralInsensitiveCount(
             return 1;
         }
 
-        if (YoriLibUpcaseChar(Str1->StartOfString[Index]) < YoriLibUpcaseChar(str2[Index])) {
-            return -1;
-        } else if (YoriLibUpcaseChar(Str1->StartOfString[Index]) > YoriLibUpcaseChar(str2[Index])) {
-            return 1;
+        Char1 = Str1->StartOfString[Index];
+        Char2 = str2[Index];
+        if (Char1 != Char2) {
+            Char1 = YoriLibUpcaseChar(Char1);
+            Char2 = YoriLibUpcaseChar(Char2);
+            if (Char1 < Char2) {
+                return -1;
+            } else if (Char1 > Char2) {
+                return 1;
+            }
         }
 
         Index++;
@@ -939,37 +1053,31 @@ YoriLibCompareStringCount(
     __in YORI_ALLOC_SIZE_T count
     )
 {
-    YORI_ALLOC_SIZE_T Index = 0;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T MaxCount;
 
-    if (count == 0) {
-        return 0;
+    MaxCount = count;
+    if (MaxCount > Str1->LengthInChars) {
+        MaxCount = Str1->LengthInChars;
+    }
+    if (MaxCount > Str2->LengthInChars) {
+        MaxCount = Str2->LengthInChars;
     }
 
-    while(TRUE) {
-
-        if (Index == Str1->LengthInChars) {
-            if (Index == Str2->LengthInChars) {
-                return 0;
-            } else {
-                return -1;
-            }
-        } else if (Index == Str2->LengthInChars) {
-            return 1;
-        }
-
+    Index = YoriLibCountIdenticalChars(Str1->StartOfString, Str2->StartOfString, MaxCount);
+    if (Index < MaxCount) {
         if (Str1->StartOfString[Index] < Str2->StartOfString[Index]) {
             return -1;
-        } else if (Str1->StartOfString[Index] > Str2->StartOfString[Index]) {
-            return 1;
         }
+        return 1;
+    }
 
-        Index++;
-
-        if (Index == count) {
-            return 0;
-        }
+    if (Index == count || Str1->LengthInChars == Str2->LengthInChars) {
+        return 0;
+    } else if (Index == Str1->LengthInChars) {
+        return -1;
     }
-    return 0;
+    return 1;
 }
 
 /**
@@ -1017,37 +1125,43 @@ YoriLibCompareStringInsensitiveCount(
     __in YORI_ALLOC_SIZE_T count
     )
 {
-    YORI_ALLOC_SIZE_T Index = 0;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T MaxCount;
+    TCHAR Char1;
+    TCHAR Char2;
 
-    if (count == 0) {
-        return 0;
+    MaxCount = count;
+    if (MaxCount > Str1->LengthInChars) {
+        MaxCount = Str1->LengthInChars;
+    }
+    if (MaxCount > Str2->LengthInChars) {
+        MaxCount = Str2->LengthInChars;
     }
 
+    Index = 0;
     while(TRUE) {
-
-        if (Index == Str1->LengthInChars) {
-            if (Index == Str2->LengthInChars) {
-                return 0;
-            } else {
-                return -1;
-            }
-        } else if (Index == Str2->LengthInChars) {
-            return 1;
+        Index = Index + YoriLibCountIdenticalChars(&Str1->StartOfString[Index], &Str2->StartOfString[Index], MaxCount - Index);
+        if (Index == MaxCount) {
+            break;
         }
 
-        if (YoriLibUpcaseChar(Str1->StartOfString[Index]) < YoriLibUpcaseChar(Str2->StartOfString[Index])) {
+        Char1 = YoriLibUpcaseChar(Str1->StartOfString[Index]);
+        Char2 = YoriLibUpcaseChar(Str2->StartOfString[Index]);
+        if (Char1 < Char2) {
             return -1;
-        } else if (YoriLibUpcaseChar(Str1->StartOfString[Index]) > YoriLibUpcaseChar(Str2->StartOfString[Index])) {
+        } else if (Char1 > Char2) {
             return 1;
         }
 
         Index++;
+    }
 
-        if (Index == count) {
-            return 0;
-        }
+    if (Index == count || Str1->LengthInChars == Str2->LengthInChars) {
+        return 0;
+    } else if (Index == Str1->LengthInChars) {
+        return -1;
     }
-    return 0;
+    return 1;
 }
 
 /**
@@ -1087,18 +1201,14 @@ YoriLibCountStringMatchingChars(
     __in PYORI_STRING Str2
     )
 {
-    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T MaxCount;
 
-    Index = 0;
-
-    while (Index < Str1->LengthInChars &&
-           Index < Str2->LengthInChars &&
-           Str1->StartOfString[Index] == Str2->StartOfString[Index]) {
-
-        Index++;
+    MaxCount = Str1->LengthInChars;
+    if (MaxCount > Str2->LengthInChars) {
+        MaxCount = Str2->LengthInChars;
     }
 
-    return Index;
+    return YoriLibCountIdenticalChars(Str1->StartOfString, Str2->StartOfString, MaxCount);
 }
 
 /**
@@ -1118,13 +1228,21 @@ YoriLibCountStringMatchingCharsInsensitive(
     )
 {
     YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T MaxCount;
 
-    Index = 0;
+    MaxCount = Str1->LengthInChars;
+    if (MaxCount > Str2->LengthInChars) {
+        MaxCount = Str2->LengthInChars;
+    }
 
-    while (Index < Str1->LengthInChars &&
-           Index < Str2->LengthInChars &&
-           YoriLibUpcaseChar(Str1->StartOfString[Index]) == YoriLibUpcaseChar(Str2->StartOfString[Index])) {
+    Index = 0;
+    while(TRUE) {
+        Index = Index + YoriLibCountIdenticalChars(&Str1->StartOfString[Index], &Str2->StartOfString[Index], MaxCount - Index);
+        if (Index == MaxCount ||
+            YoriLibUpcaseChar(Str1->StartOfString[Index]) != YoriLibUpcaseChar(Str2->StartOfString[Index])) {
 
+            break;
+        }
         Index++;
     }
 
@@ -1263,6 +1381,18 @@ YoriLibFindFirstMatchingSubstring(
 
     while (RemainingString.LengthInChars > 0) {
         for (CheckCount = 0; CheckCount < NumberMatches; CheckCount++) {
+
+            //
+            //  Check the first character before calling to compare the
+            //  whole string, since most positions will not match.
+            //
+
+            if (MatchArray[CheckCount].LengthInChars > 0 &&
+                MatchArray[CheckCount].StartOfString[0] != RemainingString.StartOfString[0]) {
+
+                continue;
+            }
+
             if (YoriLibCompareStringCount(&RemainingString, &MatchArray[CheckCount], MatchArray[CheckCount].LengthInChars) == 0) {
                 if (StringOffsetOfMatch != NULL) {
                     *StringOffsetOfMatch = String->LengthInChars - RemainingString.LengthInChars;
@@ -1310,13 +1440,27 @@ YoriLibFindFirstMatchingSubstringInsensitive(
 {
     YORI_STRING RemainingString;
     YORI_ALLOC_SIZE_T CheckCount;
+    TCHAR FirstChar;
 
     YoriLibInitEmptyString(&RemainingString);
     RemainingString.StartOfString = String->StartOfString;
     RemainingString.LengthInChars = String->LengthInChars;
 
     while (RemainingString.LengthInChars > 0) {
+        FirstChar = YoriLibUpcaseChar(RemainingString.StartOfString[0]);
         for (CheckCount = 0; CheckCount < NumberMatches; CheckCount++) {
+
+            //
+            //  Check the first character before calling to compare the
+            //  whole string, since most positions will not match.
+            //
+
+            if (MatchArray[CheckCount].LengthInChars > 0 &&
+                YoriLibUpcaseChar(MatchArray[CheckCount].StartOfString[0]) != FirstChar) {
+
+                continue;
+            }
+
             if (YoriLibCompareStringInsensitiveCount(&RemainingString, &MatchArray[CheckCount], MatchArray[CheckCount].LengthInChars) == 0) {
                 if (StringOffsetOfMatch != NULL) {
                     *StringOffsetOfMatch = String->LengthInChars - RemainingString.LengthInChars;
@@ -1447,6 +1591,199 @@ YoriLibFindLastMatchingSubstringInsensitive(
     return NULL;
 }
 
+/**
+ Prepare a substring matcher to search for a set of strings.  The matcher
+ groups the strings by their first character, so that when searching, each
+ position in the string being searched is compared only against strings
+ that could match at that position.  Callers are expected to prepare a
+ matcher once for a set of strings and use it to search many strings.
+
+ If memory cannot be allocated, the matcher is still usable, and searches
+ are performed without the benefit of grouping.
+
+ @param Matcher Pointer to the matcher to prepare.  This should be cleaned
+        up with YoriLibCleanupSubstringMatcher.
+
+ @param NumberMatches The number of substrings to look for.
+
+ @param MatchArray An array of strings corresponding to the matches to
+        look for.  This array is referenced by the matcher and must remain
+        unchanged until the matcher is cleaned up.
+
+ @param Insensitive TRUE if matches should be found without regard to case,
+        FALSE if they should be found case sensitively.
+ */
+VOID
+YoriLibInitializeSubstringMatcher(
+    __out PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in YORI_ALLOC_SIZE_T NumberMatches,
+    __in PYORI_STRING MatchArray,
+    __in BOOLEAN Insensitive
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Bucket;
+    TCHAR FirstChar;
+
+    Matcher->MatchArray = MatchArray;
+    Matcher->NumberMatches = NumberMatches;
+    Matcher->Insensitive = Insensitive;
+    Matcher->BucketEntries = NULL;
+    Matcher->MinimumLength = 0;
+
+    //
+    //  An empty string matches at the first character, which does not
+    //  fit the grouping by first character, so search without grouping.
+    //
+
+    for (Index = 0; Index < NumberMatches; Index++) {
+        if (MatchArray[Index].LengthInChars == 0) {
+            return;
+        }
+        if (Index == 0 || MatchArray[Index].LengthInChars < Matcher->MinimumLength) {
+            Matcher->MinimumLength = MatchArray[Index].LengthInChars;
+        }
+    }
+
+    if (NumberMatches == 0) {
+        return;
+    }
+
+    Matcher->BucketEntries = YoriLibMalloc(NumberMatches * sizeof(YORI_ALLOC_SIZE_T));
+    if (Matcher->BucketEntries == NULL) {
+        return;
+    }
+
+    //
+    //  Count the number of strings in each bucket, then convert the counts
+    //  to the offset of the end of each bucket.  Populating buckets in
+    //  reverse order leaves each entry at the start of its bucket, with
+    //  strings in each bucket in their original order.
+    //
+
+    ZeroMemory(Matcher->BucketStart, sizeof(Matcher->BucketStart));
+    for (Index = 0; Index < NumberMatches; Index++) {
+        FirstChar = MatchArray[Index].StartOfString[0];
+        if (Insensitive) {
+            FirstChar = YoriLibUpcaseChar(FirstChar);
+        }
+        Bucket = FirstChar % YORI_LIB_SUBSTRING_MATCHER_BUCKETS;
+        Matcher->BucketStart[Bucket]++;
+    }
+
+    for (Bucket = 1; Bucket <= YORI_LIB_SUBSTRING_MATCHER_BUCKETS; Bucket++) {
+        Matcher->BucketStart[Bucket] = Matcher->BucketStart[Bucket] + Matcher->BucketStart[Bucket - 1];
+    }
+
+    for (Index = NumberMatches; Index > 0; Index--) {
+        FirstChar = MatchArray[Index - 1].StartOfString[0];
+        if (Insensitive) {
+            FirstChar = YoriLibUpcaseChar(FirstChar);
+        }
+        Bucket = FirstChar % YORI_LIB_SUBSTRING_MATCHER_BUCKETS;
+        Matcher->BucketStart[Bucket]--;
+        Matcher->BucketEntries[Matcher->BucketStart[Bucket]] = Index - 1;
+    }
+}
+
+/**
+ Free any memory allocated by YoriLibInitializeSubstringMatcher.
+
+ @param Matcher Pointer to the matcher to clean up.
+ */
+VOID
+YoriLibCleanupSubstringMatcher(
+    __inout PYORI_LIB_SUBSTRING_MATCHER Matcher
+    )
+{
+    if (Matcher->BucketEntries != NULL) {
+        YoriLibFree(Matcher->BucketEntries);
+        Matcher->BucketEntries = NULL;
+    }
+}
+
+/**
+ Search through a string looking to see if any substrings described by a
+ prepared matcher can be located.  Returns the first match in offset from
+ the beginning of the string order.  If more than one substring matches at
+ that offset, the first in the matcher's array is returned, which is the same
+ result as YoriLibFindFirstMatchingSubstring or
+ YoriLibFindFirstMatchingSubstringInsensitive.
+
+ @param Matcher Pointer to a matcher prepared with
+        YoriLibInitializeSubstringMatcher.
+
+ @param String The string to search through.
+
+ @param StringOffsetOfMatch On successful completion, returns the offset
+        within the string of the match.
+
+ @return If a match is found, returns a pointer to the entry in the
+         matcher's array corresponding to the substring that was matched.
+         If no match is found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindFirstMatchWithMatcher(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PCYORI_STRING String,
+    __out_opt PYORI_ALLOC_SIZE_T StringOffsetOfMatch
+    )
+{
+    YORI_STRING RemainingString;
+    PYORI_STRING Match;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Entry;
+    YORI_ALLOC_SIZE_T Bucket;
+    TCHAR FirstChar;
+
+    if (Matcher->BucketEntries == NULL) {
+        if (Matcher->Insensitive) {
+            return YoriLibFindFirstMatchingSubstringInsensitive(String, Matcher->NumberMatches, Matcher->MatchArray, StringOffsetOfMatch);
+        }
+        return YoriLibFindFirstMatchingSubstring(String, Matcher->NumberMatches, Matcher->MatchArray, StringOffsetOfMatch);
+    }
+
+    YoriLibInitEmptyString(&RemainingString);
+
+    for (Index = 0; Index + Matcher->MinimumLength <= String->LengthInChars; Index++) {
+        FirstChar = String->StartOfString[Index];
+        if (Matcher->Insensitive) {
+            FirstChar = YoriLibUpcaseChar(FirstChar);
+        }
+        Bucket = FirstChar % YORI_LIB_SUBSTRING_MATCHER_BUCKETS;
+
+        for (Entry = Matcher->BucketStart[Bucket]; Entry < Matcher->BucketStart[Bucket + 1]; Entry++) {
+            Match = &Matcher->MatchArray[Matcher->BucketEntries[Entry]];
+            if (Match->LengthInChars > String->LengthInChars - Index) {
+                continue;
+            }
+
+            RemainingString.StartOfString = &String->StartOfString[Index];
+            RemainingString.LengthInChars = Match->LengthInChars;
+
+            if (Matcher->Insensitive) {
+                if (YoriLibCompareStringInsensitive(&RemainingString, Match) != 0) {
+                    continue;
+                }
+            } else {
+                if (YoriLibCompareString(&RemainingString, Match) != 0) {
+                    continue;
+                }
+            }
+
+            if (StringOffsetOfMatch != NULL) {
+                *StringOffsetOfMatch = Index;
+            }
+            return Match;
+        }
+    }
+
+    if (StringOffsetOfMatch != NULL) {
+        *StringOffsetOfMatch = 0;
+    }
+    return NULL;
+}
+
 /**
  Search through a string finding the leftmost instance of a character.  If
  no match is found, return NULL.
@@ -1960,15 +2297,16 @@ YoriLibSwapStrings(
 }
 
 /**
- Sort an array of strings.  This is currently implemented using a handrolled
- quicksort.
+ Sort an array of strings using a handrolled quicksort.  This requires no
+ additional memory, so it is used if the merge sort in
+ @ref YoriLibSortStringArray cannot allocate its buffers.
 
  @param StringArray Pointer to an array of strings.
 
  @param Count The number of elements in the array.
  */
 VOID
-YoriLibSortStringArray(
+YoriLibQuickSortStringArray(
     __in_ecount(Count) PYORI_STRING StringArray,
     __in YORI_ALLOC_SIZE_T Count
     )
@@ -2067,10 +2405,10 @@ YoriLibSortStringArray(
 
     if (FirstOffset && (Count - FirstOffset)) {
         if (FirstOffset > 0) {
-            YoriLibSortStringArray(StringArray, FirstOffset);
+            YoriLibQuickSortStringArray(StringArray, FirstOffset);
         }
         if ((Count - FirstOffset) > 0) {
-            YoriLibSortStringArray(&StringArray[FirstOffset], Count - FirstOffset);
+            YoriLibQuickSortStringArray(&StringArray[FirstOffset], Count - FirstOffset);
         }
     }
 
@@ -2085,6 +2423,378 @@ YoriLibSortStringArray(
     ASSERT (Index == Count - 1);
 }
 
+/**
+ An entry in the array being sorted by @ref YoriLibSortStringArray .  Each
+ entry caches a key derived from the start of the string, so most
+ comparisons can be resolved without examining the string itself.
+ */
+typedef struct _YORI_LIB_SORT_ENTRY {
+
+    /**
+     The first four characters of the string, upcased, with the first
+     character in the most significant bits.  Strings shorter than four
+     characters are padded with zero, so comparing two keys gives the same
+     result as comparing the first four characters of the strings.
+     */
+    DWORDLONG Key;
+
+    /**
+     The string being sorted.
+     */
+    YORI_STRING String;
+} YORI_LIB_SORT_ENTRY, *PYORI_LIB_SORT_ENTRY;
+
+/**
+ The number of entries below which a range is sorted with an insertion sort
+ rather than being divided further.
+ */
+#define YORI_LIB_SORT_INSERTION_THRESHOLD (16)
+
+/**
+ The number of entries below which the array is sorted on the calling
+ thread.  Above this, ranges are sorted concurrently on a work queue.
+ */
+#define YORI_LIB_SORT_PARALLEL_THRESHOLD (0x4000)
+
+/**
+ The maximum number of ranges that can be sorted concurrently.
+ */
+#define YORI_LIB_SORT_MAX_RANGES (16)
+
+/**
+ Compare two sort entries without regard to case.
+
+ @param Entry1 Pointer to the first entry.
+
+ @param Entry2 Pointer to the second entry.
+
+ @return Zero for equality; -1 if the first is less than the second; 1 if
+         the first is greater than the second.
+ */
+int
+YoriLibCompareSortEntries(
+    __in PYORI_LIB_SORT_ENTRY Entry1,
+    __in PYORI_LIB_SORT_ENTRY Entry2
+    )
+{
+    if (Entry1->Key < Entry2->Key) {
+        return -1;
+    } else if (Entry1->Key > Entry2->Key) {
+        return 1;
+    }
+    return YoriLibCompareStringInsensitive(&Entry1->String, &Entry2->String);
+}
+
+/**
+ Merge two adjacent sorted ranges of sort entries into a single sorted
+ range.  Where entries compare equal, the entry from the first range is
+ placed first, so the merge is stable.
+
+ @param Entries Pointer to the first range, which is immediately followed
+        by the second range.
+
+ @param Scratch Pointer to a buffer with space for at least FirstCount
+        entries.
+
+ @param FirstCount The number of entries in the first range.
+
+ @param Count The total number of entries in both ranges.
+ */
+VOID
+YoriLibMergeSortEntries(
+    __inout_ecount(Count) PYORI_LIB_SORT_ENTRY Entries,
+    __out_ecount(FirstCount) PYORI_LIB_SORT_ENTRY Scratch,
+    __in YORI_ALLOC_SIZE_T FirstCount,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    YORI_ALLOC_SIZE_T FirstIndex;
+    YORI_ALLOC_SIZE_T SecondIndex;
+    YORI_ALLOC_SIZE_T DestIndex;
+
+    //
+    //  If the ranges are already in order there's nothing to do.  This
+    //  makes sorting already sorted input linear.
+    //
+
+    if (FirstCount == 0 ||
+        FirstCount == Count ||
+        YoriLibCompareSortEntries(&Entries[FirstCount - 1], &Entries[FirstCount]) <= 0) {
+
+        return;
+    }
+
+    memcpy(Scratch, Entries, FirstCount * sizeof(YORI_LIB_SORT_ENTRY));
+
+    FirstIndex = 0;
+    SecondIndex = FirstCount;
+    DestIndex = 0;
+
+    while (FirstIndex < FirstCount && SecondIndex < Count) {
+        if (YoriLibCompareSortEntries(&Entries[SecondIndex], &Scratch[FirstIndex]) < 0) {
+            memcpy(&Entries[DestIndex], &Entries[SecondIndex], sizeof(YORI_LIB_SORT_ENTRY));
+            SecondIndex++;
+        } else {
+            memcpy(&Entries[DestIndex], &Scratch[FirstIndex], sizeof(YORI_LIB_SORT_ENTRY));
+            FirstIndex++;
+        }
+        DestIndex++;
+    }
+
+    //
+    //  Anything remaining in the second range is already in place.
+    //
+
+    if (FirstIndex < FirstCount) {
+        memcpy(&Entries[DestIndex], &Scratch[FirstIndex], (FirstCount - FirstIndex) * sizeof(YORI_LIB_SORT_ENTRY));
+    }
+}
+
+/**
+ Sort a range of sort entries with a stable merge sort.
+
+ @param Entries Pointer to the entries to sort.
+
+ @param Scratch Pointer to a buffer with space for at least half of Count
+        entries.
+
+ @param Count The number of entries to sort.
+ */
+VOID
+YoriLibSortEntries(
+    __inout_ecount(Count) PYORI_LIB_SORT_ENTRY Entries,
+    __inout PYORI_LIB_SORT_ENTRY Scratch,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T InsertIndex;
+    YORI_ALLOC_SIZE_T Half;
+    YORI_LIB_SORT_ENTRY Entry;
+
+    if (Count <= YORI_LIB_SORT_INSERTION_THRESHOLD) {
+        for (Index = 1; Index < Count; Index++) {
+            if (YoriLibCompareSortEntries(&Entries[Index - 1], &Entries[Index]) <= 0) {
+                continue;
+            }
+            memcpy(&Entry, &Entries[Index], sizeof(YORI_LIB_SORT_ENTRY));
+            InsertIndex = Index;
+            while (InsertIndex > 0 && YoriLibCompareSortEntries(&Entries[InsertIndex - 1], &Entry) > 0) {
+                memcpy(&Entries[InsertIndex], &Entries[InsertIndex - 1], sizeof(YORI_LIB_SORT_ENTRY));
+                InsertIndex--;
+            }
+            memcpy(&Entries[InsertIndex], &Entry, sizeof(YORI_LIB_SORT_ENTRY));
+        }
+        return;
+    }
+
+    Half = Count / 2;
+    YoriLibSortEntries(Entries, Scratch, Half);
+    YoriLibSortEntries(&Entries[Half], Scratch, Count - Half);
+    YoriLibMergeSortEntries(Entries, Scratch, Half, Count);
+}
+
+/**
+ A range of sort entries to be sorted on a work queue.
+ */
+typedef struct _YORI_LIB_SORT_RANGE {
+
+    /**
+     The work item used to queue this range.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     Pointer to the first entry in the range.
+     */
+    PYORI_LIB_SORT_ENTRY Entries;
+
+    /**
+     Pointer to scratch space for this range, with space for at least half
+     of Count entries.
+     */
+    PYORI_LIB_SORT_ENTRY Scratch;
+
+    /**
+     The number of entries in the range.
+     */
+    YORI_ALLOC_SIZE_T Count;
+} YORI_LIB_SORT_RANGE, *PYORI_LIB_SORT_RANGE;
+
+/**
+ Sort a single range of entries on a work queue thread.
+
+ @param Context Ignored.
+
+ @param Item Pointer to the work item embedded in the range to sort.
+
+ @param Cancelled If TRUE, the user has cancelled the operation.  The
+        range is sorted regardless, since the caller cannot return an array
+        that is partially sorted.
+ */
+VOID
+YoriLibSortRangeWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORI_LIB_SORT_RANGE Range;
+
+    UNREFERENCED_PARAMETER(Context);
+    UNREFERENCED_PARAMETER(Cancelled);
+
+    Range = CONTAINING_RECORD(Item, YORI_LIB_SORT_RANGE, WorkItem);
+    YoriLibSortEntries(Range->Entries, Range->Scratch, Range->Count);
+}
+
+/**
+ Sort a large array of entries by dividing it into ranges which are sorted
+ concurrently, then merging the ranges on the calling thread.  If threads
+ cannot be created, any range that could not be queued is sorted on the
+ calling thread.
+
+ @param Entries Pointer to the entries to sort.
+
+ @param Scratch Pointer to scratch space with space for Count entries.
+
+ @param Count The number of entries to sort.
+ */
+VOID
+YoriLibParallelSortEntries(
+    __inout_ecount(Count) PYORI_LIB_SORT_ENTRY Entries,
+    __inout_ecount(Count) PYORI_LIB_SORT_ENTRY Scratch,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    YORI_LIB_SORT_RANGE Ranges[YORI_LIB_SORT_MAX_RANGES];
+    YORILIB_WORK_QUEUE WorkQueue;
+    SYSTEM_INFO SystemInfo;
+    YORI_ALLOC_SIZE_T RangeCount;
+    YORI_ALLOC_SIZE_T RangeSize;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Offset;
+    YORI_ALLOC_SIZE_T MergedCount;
+    BOOLEAN QueueActive;
+
+    GetSystemInfo(&SystemInfo);
+    RangeCount = (YORI_ALLOC_SIZE_T)SystemInfo.dwNumberOfProcessors;
+    if (RangeCount > YORI_LIB_SORT_MAX_RANGES) {
+        RangeCount = YORI_LIB_SORT_MAX_RANGES;
+    }
+
+    if (RangeCount <= 1) {
+        YoriLibSortEntries(Entries, Scratch, Count);
+        return;
+    }
+
+    //
+    //  Each range gets its own region of the scratch buffer so that ranges
+    //  can be sorted concurrently.
+    //
+
+    RangeSize = (Count + RangeCount - 1) / RangeCount;
+    Offset = 0;
+    for (Index = 0; Index < RangeCount; Index++) {
+        Ranges[Index].Entries = &Entries[Offset];
+        Ranges[Index].Scratch = &Scratch[Offset];
+        Ranges[Index].Count = RangeSize;
+        if (Offset + RangeSize > Count) {
+            Ranges[Index].Count = Count - Offset;
+        }
+        Offset = Offset + Ranges[Index].Count;
+    }
+
+    ZeroMemory(&WorkQueue, sizeof(WorkQueue));
+    QueueActive = (BOOLEAN)YoriLibInitializeWorkQueue(&WorkQueue, RangeCount, RangeCount, YoriLibSortRangeWorker, NULL);
+
+    for (Index = 0; Index < RangeCount; Index++) {
+        if (!QueueActive || !YoriLibQueueWorkItem(&WorkQueue, &Ranges[Index].WorkItem, TRUE)) {
+            YoriLibSortEntries(Ranges[Index].Entries, Ranges[Index].Scratch, Ranges[Index].Count);
+        }
+    }
+
+    if (QueueActive) {
+        YoriLibWaitForWorkQueue(&WorkQueue);
+    }
+    YoriLibCleanupWorkQueue(&WorkQueue);
+
+    //
+    //  Merge each range into the sorted prefix.  The scratch buffer is no
+    //  longer being used by the ranges so it can be used for the merge.
+    //
+
+    MergedCount = Ranges[0].Count;
+    for (Index = 1; Index < RangeCount; Index++) {
+        YoriLibMergeSortEntries(Entries, Scratch, MergedCount, MergedCount + Ranges[Index].Count);
+        MergedCount = MergedCount + Ranges[Index].Count;
+    }
+}
+
+/**
+ Sort an array of strings without regard to case.  This is a stable merge
+ sort, so strings which compare equal retain their original order.  A key
+ containing the first characters of each string is computed once so that
+ most comparisons can avoid examining the strings.  Large arrays are divided
+ into ranges which are sorted concurrently.
+
+ @param StringArray Pointer to an array of strings.
+
+ @param Count The number of elements in the array.
+ */
+VOID
+YoriLibSortStringArray(
+    __in_ecount(Count) PYORI_STRING StringArray,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    PYORI_LIB_SORT_ENTRY Entries;
+    PYORI_LIB_SORT_ENTRY Scratch;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T CharIndex;
+    DWORDLONG Key;
+
+    if (Count <= 1) {
+        return;
+    }
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)Count * 2 * sizeof(YORI_LIB_SORT_ENTRY))) {
+        YoriLibQuickSortStringArray(StringArray, Count);
+        return;
+    }
+
+    Entries = YoriLibMalloc((YORI_ALLOC_SIZE_T)(Count * 2 * sizeof(YORI_LIB_SORT_ENTRY)));
+    if (Entries == NULL) {
+        YoriLibQuickSortStringArray(StringArray, Count);
+        return;
+    }
+    Scratch = &Entries[Count];
+
+    for (Index = 0; Index < Count; Index++) {
+        Key = 0;
+        for (CharIndex = 0; CharIndex < 4; CharIndex++) {
+            Key = Key << 16;
+            if (CharIndex < StringArray[Index].LengthInChars) {
+                Key = Key | YoriLibUpcaseChar(StringArray[Index].StartOfString[CharIndex]);
+            }
+        }
+        Entries[Index].Key = Key;
+        memcpy(&Entries[Index].String, &StringArray[Index], sizeof(YORI_STRING));
+    }
+
+    if (Count >= YORI_LIB_SORT_PARALLEL_THRESHOLD) {
+        YoriLibParallelSortEntries(Entries, Scratch, Count);
+    } else {
+        YoriLibSortEntries(Entries, Scratch, Count);
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+        memcpy(&StringArray[Index], &Entries[Index].String, sizeof(YORI_STRING));
+    }
+
+    YoriLibFree(Entries);
+}
+
 /**
  Concatenate one yori string to an existing yori string.  Note the first
  string may be reallocated within this routine and the caller is expected to
@@ -39,7 +39,8 @@ YoriLibUpdErrorStrings[] = {
     _T("Could not read data from server"),
     _T("Data read from server is incorrect"),
     _T("Could not write data to temporary local file"),
-    _T("Could not replace existing file with new file")
+    _T("Could not replace existing file with new file"),
+    _T("Could not calculate hash of data")
 };
 
 /**
@@ -229,6 +230,255 @@ LPCSTR YoriLibMonthNames[] = {
 #define UPDATE_READ_SIZE (60 * 1024)
 #endif
 
+/**
+ The number of times to attempt a download which fails while reading data.
+ Each attempt after the first resumes from the data already received if the
+ server supports it.
+ */
+#define UPDATE_ATTEMPT_COUNT (4)
+
+/**
+ Information about a local file which is receiving downloaded data.  If the
+ download fails and the server indicated which version of the object it was
+ sending, the file is retained so a later attempt can request the remaining
+ data only.
+ */
+typedef struct _YORI_LIB_UPDATE_PARTIAL {
+
+    /**
+     The full path to the local file.
+     */
+    YORI_STRING FileName;
+
+    /**
+     A handle to the local file, opened for read and write.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The number of bytes already in the local file which can be resumed
+     from.  If zero, the entire object is requested.
+     */
+    LARGE_INTEGER ResumeOffset;
+
+    /**
+     The last modified time of the object on the server.  This is only
+     meaningful if Resumable is TRUE, and is used to ensure that data is only
+     appended to a file containing the same version of the object.
+     */
+    SYSTEMTIME LastModified;
+
+    /**
+     TRUE if the server has described the object such that the data received
+     so far can be resumed by a later request.
+     */
+    BOOLEAN Resumable;
+} YORI_LIB_UPDATE_PARTIAL, *PYORI_LIB_UPDATE_PARTIAL;
+
+/**
+ Open the local file to receive downloaded data.  The name of this file is
+ derived from the Url, so if a previous attempt to download the same Url was
+ interrupted, the data it received is found here and can be resumed.  If the
+ file is in use by another download, a unique temporary file is used instead
+ which cannot be resumed.
+
+ @param Url The Url being downloaded.
+
+ @param Partial On successful completion, populated with information about
+        the local file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibUpdateOpenPartialFile(
+    __in PCYORI_STRING Url,
+    __out PYORI_LIB_UPDATE_PARTIAL Partial
+    )
+{
+    YORI_STRING TempPath;
+    YORI_STRING PrefixString;
+    FILETIME LastWriteTime;
+
+    ZeroMemory(Partial, sizeof(YORI_LIB_UPDATE_PARTIAL));
+    Partial->FileHandle = INVALID_HANDLE_VALUE;
+
+    if (!YoriLibGetTempPath(&TempPath, 0)) {
+        return FALSE;
+    }
+
+    //
+    //  GetTempPath returns a string with a trailing backslash.  Use an 8.3
+    //  compatible name so this works on any file system.
+    //
+
+    YoriLibYPrintf(&Partial->FileName, _T("%y%08x.upd"), &TempPath, YoriLibHashString32(0, Url));
+    if (Partial->FileName.LengthInChars == 0) {
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+
+    Partial->FileHandle = CreateFile(Partial->FileName.StartOfString,
+                                     GENERIC_READ | GENERIC_WRITE,
+                                     FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                     NULL,
+                                     OPEN_ALWAYS,
+                                     FILE_ATTRIBUTE_NORMAL,
+                                     NULL);
+
+    if (Partial->FileHandle != INVALID_HANDLE_VALUE) {
+        YoriLibFreeStringContents(&TempPath);
+
+        Partial->ResumeOffset.LowPart = GetFileSize(Partial->FileHandle, (LPDWORD)&Partial->ResumeOffset.HighPart);
+        if (Partial->ResumeOffset.LowPart == INVALID_FILE_SIZE &&
+            GetLastError() != NO_ERROR) {
+
+            Partial->ResumeOffset.QuadPart = 0;
+        }
+
+        //
+        //  The last write time of a retained file is the last modified time
+        //  of the object on the server when the file was written.
+        //
+
+        if (Partial->ResumeOffset.QuadPart > 0 &&
+            GetFileTime(Partial->FileHandle, NULL, NULL, &LastWriteTime) &&
+            FileTimeToSystemTime(&LastWriteTime, &Partial->LastModified)) {
+
+            Partial->Resumable = TRUE;
+        } else {
+            Partial->ResumeOffset.QuadPart = 0;
+        }
+
+        return TRUE;
+    }
+
+    YoriLibFreeStringContents(&Partial->FileName);
+
+    YoriLibConstantString(&PrefixString, _T("UPD"));
+    if (!YoriLibGetTempFileName(&TempPath, &PrefixString, &Partial->FileHandle, &Partial->FileName)) {
+        YoriLibFreeStringContents(&TempPath);
+        Partial->FileHandle = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&TempPath);
+    return TRUE;
+}
+
+/**
+ Prepare the local file to receive data once the server has responded to a
+ request.
+
+ @param Partial Pointer to information about the local file.
+
+ @param HttpStatus The HTTP status code returned by the server.  206 indicates
+        the server is returning data following the data already in the local
+        file.  200 indicates the server is returning the entire object.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibUpdatePreparePartialFile(
+    __in PYORI_LIB_UPDATE_PARTIAL Partial,
+    __in DWORD HttpStatus
+    )
+{
+    LARGE_INTEGER NewPosition;
+
+    if (HttpStatus == 206) {
+        if (Partial->ResumeOffset.QuadPart == 0) {
+            return FALSE;
+        }
+        NewPosition.QuadPart = 0;
+        NewPosition.LowPart = SetFilePointer(Partial->FileHandle, 0, &NewPosition.HighPart, FILE_END);
+        if (NewPosition.QuadPart != Partial->ResumeOffset.QuadPart) {
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    //
+    //  The server is sending the whole object, either because it doesn't
+    //  support ranges or because the object has changed.  Discard anything
+    //  received previously.
+    //
+
+    Partial->Resumable = FALSE;
+    Partial->ResumeOffset.QuadPart = 0;
+    if (SetFilePointer(Partial->FileHandle, 0, NULL, FILE_BEGIN) != 0 ||
+        !SetEndOfFile(Partial->FileHandle)) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Close the local file receiving downloaded data.
+
+ @param Partial Pointer to information about the local file.
+
+ @param Retain If TRUE, the file should be retained so a later download can
+        resume from it.  The file is only retained if the server described
+        the object so that resuming is safe.  If FALSE, the file is deleted.
+ */
+VOID
+YoriLibUpdateClosePartialFile(
+    __in PYORI_LIB_UPDATE_PARTIAL Partial,
+    __in BOOLEAN Retain
+    )
+{
+    FILETIME LastWriteTime;
+
+    if (Partial->FileHandle != INVALID_HANDLE_VALUE) {
+        if (Retain &&
+            Partial->Resumable &&
+            SystemTimeToFileTime(&Partial->LastModified, &LastWriteTime) &&
+            SetFileTime(Partial->FileHandle, NULL, NULL, &LastWriteTime)) {
+
+            CloseHandle(Partial->FileHandle);
+        } else {
+            CloseHandle(Partial->FileHandle);
+            DeleteFile(Partial->FileName.StartOfString);
+        }
+        Partial->FileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    YoriLibFreeStringContents(&Partial->FileName);
+}
+
+/**
+ Generate an HTTP header containing a date.
+
+ @param HeaderName The name of the header, not including the colon.
+
+ @param Time The time to include in the header, in UTC.
+
+ @param Header On successful completion, updated to contain the header,
+        including a trailing carriage return and line feed.
+ */
+VOID
+YoriLibUpdateBuildDateHeader(
+    __in LPCTSTR HeaderName,
+    __in PSYSTEMTIME Time,
+    __inout PYORI_STRING Header
+    )
+{
+    YoriLibYPrintf(Header,
+                   _T("%s: %hs, %02i %hs %04i %02i:%02i:%02i GMT\r\n"),
+                   HeaderName,
+                   YoriLibDayNames[Time->wDayOfWeek],
+                   Time->wDay,
+                   YoriLibMonthNames[Time->wMonth - 1],
+                   Time->wYear,
+                   Time->wHour,
+                   Time->wMinute,
+                   Time->wSecond);
+}
+
 /**
  Construct the HTTP headers to attach to the request.  This code is shared
  between WinInet and WinHttp.
@@ -238,6 +488,10 @@ LPCSTR YoriLibMonthNames[] = {
  @param IfModifiedSince Optionally points to a timestamp where only newer
         resources should be downloaded.
 
+ @param Partial Optionally points to a local file containing data from an
+        earlier attempt.  If this contains resumable data, only data beyond
+        it is requested, provided the object on the server is unchanged.
+
  @param OutputHeader On successful completion, populated with a newly
         allocated string containing all of the necessary HTTP headers.
 
@@ -256,6 +510,7 @@ BOOLEAN
 YoriLibUpdateBuildHttpHeaders(
     __in PCYORI_STRING Url,
     __in_opt PSYSTEMTIME IfModifiedSince,
+    __in_opt PYORI_LIB_UPDATE_PARTIAL Partial,
     __out PYORI_STRING OutputHeader,
     __out PYORI_STRING HostSubset,
     __out LPTSTR *ObjectSubset
@@ -264,6 +519,8 @@ YoriLibUpdateBuildHttpHeaders(
     LPTSTR EndOfHost;
     YORI_STRING HostHeader;
     YORI_STRING IfModifiedSinceHeader;
+    YORI_STRING RangeHeader;
+    YORI_STRING IfRangeHeader;
     YORI_STRING CombinedHeader;
     YORI_STRING ProtocolDelimiter;
     YORI_ALLOC_SIZE_T StartOfHost;
@@ -301,28 +558,33 @@ YoriLibUpdateBuildHttpHeaders(
 
     YoriLibInitEmptyString(&IfModifiedSinceHeader);
     if (IfModifiedSince != NULL) {
-        YoriLibYPrintf(&IfModifiedSinceHeader,
-                       _T("If-Modified-Since: %hs, %02i %hs %04i %02i:%02i:%02i GMT\r\n"),
-                       YoriLibDayNames[IfModifiedSince->wDayOfWeek],
-                       IfModifiedSince->wDay,
-                       YoriLibMonthNames[IfModifiedSince->wMonth - 1],
-                       IfModifiedSince->wYear,
-                       IfModifiedSince->wHour,
-                       IfModifiedSince->wMinute,
-                       IfModifiedSince->wSecond);
+        YoriLibUpdateBuildDateHeader(_T("If-Modified-Since"), IfModifiedSince, &IfModifiedSinceHeader);
     }
 
+    //
+    //  If an earlier attempt received part of the object, request the
+    //  remainder.  If-Range means the server will return the entire object
+    //  if it has changed since the earlier attempt.
+    //
+
+    YoriLibInitEmptyString(&RangeHeader);
+    YoriLibInitEmptyString(&IfRangeHeader);
+    if (Partial != NULL &&
+        Partial->Resumable &&
+        Partial->ResumeOffset.QuadPart > 0) {
+
+        YoriLibYPrintf(&RangeHeader, _T("Range: bytes=%lli-\r\n"), Partial->ResumeOffset.QuadPart);
+        YoriLibUpdateBuildDateHeader(_T("If-Range"), &Partial->LastModified, &IfRangeHeader);
+    }
 
     //
-    //  Merge headers.  If we have only one or the other, this is just a
-    //  reference with no allocation.
+    //  Merge headers.  If we have only one, this is just a reference with no
+    //  allocation.
     //
 
     YoriLibInitEmptyString(&CombinedHeader);
-    if (IfModifiedSinceHeader.LengthInChars > 0 && HostHeader.LengthInChars > 0) {
-        YoriLibYPrintf(&CombinedHeader, _T("%y%y"), &HostHeader, &IfModifiedSinceHeader);
-    } else if (IfModifiedSinceHeader.LengthInChars > 0) {
-        YoriLibCloneString(&CombinedHeader, &IfModifiedSinceHeader);
+    if (IfModifiedSinceHeader.LengthInChars > 0 || RangeHeader.LengthInChars > 0) {
+        YoriLibYPrintf(&CombinedHeader, _T("%y%y%y%y"), &HostHeader, &IfModifiedSinceHeader, &RangeHeader, &IfRangeHeader);
     } else if (HostHeader.LengthInChars > 0) {
         YoriLibCloneString(&CombinedHeader, &HostHeader);
     }
@@ -333,6 +595,8 @@ YoriLibUpdateBuildHttpHeaders(
 
     YoriLibFreeStringContents(&HostHeader);
     YoriLibFreeStringContents(&IfModifiedSinceHeader);
+    YoriLibFreeStringContents(&RangeHeader);
+    YoriLibFreeStringContents(&IfRangeHeader);
 
     memcpy(OutputHeader, &CombinedHeader, sizeof(YORI_STRING));
     return TRUE;
@@ -373,10 +637,9 @@ YoriLibUpdateBinaryFromUrlWinInet(
     PUCHAR NewBinaryData = NULL;
     DWORD ErrorBufferSize = 0;
     DWORD ActualBinarySize;
-    YORI_STRING TempName;
-    YORI_STRING TempPath;
-    YORI_STRING PrefixString;
-    HANDLE hTempFile = INVALID_HANDLE_VALUE;
+    YORI_LIB_UPDATE_PARTIAL Partial;
+    SYSTEMTIME LastModified;
+    DWORD LastModifiedSize;
     BOOL SuccessfullyComplete = FALSE;
     BOOL WinInetOnlySupportsAnsi = FALSE;
     DWORD dwError;
@@ -389,8 +652,8 @@ YoriLibUpdateBinaryFromUrlWinInet(
     ASSERT(YoriLibIsStringNullTerminated(Agent));
     ASSERT(TargetName == NULL || YoriLibIsStringNullTerminated(TargetName));
 
-    YoriLibInitEmptyString(&TempName);
-    YoriLibInitEmptyString(&TempPath);
+    ZeroMemory(&Partial, sizeof(Partial));
+    Partial.FileHandle = INVALID_HANDLE_VALUE;
 
     //
     //  Open an internet connection with default proxy settings.
@@ -467,7 +730,12 @@ YoriLibUpdateBinaryFromUrlWinInet(
         goto Exit;
     }
 
-    if (!YoriLibUpdateBuildHttpHeaders(Url, IfModifiedSince, &CombinedHeader, &HostSubset, &ObjectName)) {
+    if (!YoriLibUpdateOpenPartialFile(Url, &Partial)) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    if (!YoriLibUpdateBuildHttpHeaders(Url, IfModifiedSince, &Partial, &CombinedHeader, &HostSubset, &ObjectName)) {
         Return = YoriLibUpdErrorInetInit;
         goto Exit;
     }
@@ -585,26 +853,58 @@ YoriLibUpdateBinaryFromUrlWinInet(
         }
     }
 
-    if (dwError != 200) {
+    //
+    //  If the range requested from an earlier attempt can't be satisfied,
+    //  the data from that attempt isn't useful.  Discard it so that another
+    //  attempt can fetch the whole object.
+    //
+
+    if (dwError == 416) {
+        Partial.Resumable = FALSE;
+        Return = YoriLibUpdErrorInetRead;
+        goto Exit;
+    }
+
+    if (dwError != 200 && dwError != 206) {
         if (dwError != 304 || IfModifiedSince == NULL) {
             Return = YoriLibUpdErrorInetConnect;
         }
         goto Exit;
     }
 
-    //
-    //  Create a temporary file to hold the contents.
-    //
-
-    if (!YoriLibGetTempPath(&TempPath, 0)) {
+    if (!YoriLibUpdatePreparePartialFile(&Partial, dwError)) {
         Return = YoriLibUpdErrorFileWrite;
         goto Exit;
     }
 
-    YoriLibConstantString(&PrefixString, _T("UPD"));
-    if (!YoriLibGetTempFileName(&TempPath, &PrefixString, &hTempFile, &TempName)) {
-        Return = YoriLibUpdErrorFileWrite;
-        goto Exit;
+    //
+    //  If the server is sending the whole object and indicates when it was
+    //  last modified, data received can be resumed if this attempt fails.
+    //
+
+    if (dwError == 200) {
+        LastModifiedSize = sizeof(LastModified);
+        if (WinInetOnlySupportsAnsi) {
+            if (Dll->pHttpQueryInfoA(NewBinary,
+                                     HTTP_QUERY_FLAG_SYSTEMTIME | HTTP_QUERY_LAST_MODIFIED,
+                                     &LastModified,
+                                     &LastModifiedSize,
+                                     NULL)) {
+
+                memcpy(&Partial.LastModified, &LastModified, sizeof(SYSTEMTIME));
+                Partial.Resumable = TRUE;
+            }
+        } else {
+            if (Dll->pHttpQueryInfoW(NewBinary,
+                                     HTTP_QUERY_FLAG_SYSTEMTIME | HTTP_QUERY_LAST_MODIFIED,
+                                     &LastModified,
+                                     &LastModifiedSize,
+                                     NULL)) {
+
+                memcpy(&Partial.LastModified, &LastModified, sizeof(SYSTEMTIME));
+                Partial.Resumable = TRUE;
+            }
+        }
     }
 
     NewBinaryData = YoriLibMalloc(UPDATE_READ_SIZE);
@@ -626,7 +926,7 @@ YoriLibUpdateBinaryFromUrlWinInet(
             break;
         }
 
-        if (!WriteFile(hTempFile, NewBinaryData, ActualBinarySize, &DataWritten, NULL) ||
+        if (!WriteFile(Partial.FileHandle, NewBinaryData, ActualBinarySize, &DataWritten, NULL) ||
             DataWritten != ActualBinarySize) {
 
             Return = YoriLibUpdErrorFileWrite;
@@ -650,8 +950,8 @@ YoriLibUpdateBinaryFromUrlWinInet(
     //
 
     if (TargetName == NULL) {
-        SetFilePointer(hTempFile, 0, NULL, FILE_BEGIN);
-        if (!ReadFile(hTempFile, NewBinaryData, 2, &ActualBinarySize, NULL) ||
+        SetFilePointer(Partial.FileHandle, 0, NULL, FILE_BEGIN);
+        if (!ReadFile(Partial.FileHandle, NewBinaryData, 2, &ActualBinarySize, NULL) ||
             ActualBinarySize != 2 ||
             NewBinaryData[0] != 'M' ||
             NewBinaryData[1] != 'Z' ) {
@@ -665,14 +965,15 @@ YoriLibUpdateBinaryFromUrlWinInet(
     //  Now update the binary with the local file.
     //
 
-    CloseHandle(hTempFile);
+    CloseHandle(Partial.FileHandle);
     YoriLibFree(NewBinaryData);
     NewBinaryData = NULL;
-    hTempFile = INVALID_HANDLE_VALUE;
+    Partial.FileHandle = INVALID_HANDLE_VALUE;
 
-    if (YoriLibUpdateBinaryFromFile(TargetName, &TempName)) {
+    if (YoriLibUpdateBinaryFromFile(TargetName, &Partial.FileName)) {
         Return = YoriLibUpdErrorSuccess;
     } else {
+        DeleteFile(Partial.FileName.StartOfString);
         Return = YoriLibUpdErrorFileReplace;
     }
 
@@ -682,13 +983,15 @@ Exit:
         YoriLibFree(NewBinaryData);
     }
 
-    if (hTempFile != INVALID_HANDLE_VALUE) {
-        CloseHandle(hTempFile);
-        DeleteFile(TempName.StartOfString);
-    }
+    //
+    //  If the connection failed, keep any data received so a later attempt
+    //  can resume from it.
+    //
+
+    YoriLibUpdateClosePartialFile(&Partial,
+                                  (BOOLEAN)(Return == YoriLibUpdErrorInetConnect ||
+                                            Return == YoriLibUpdErrorInetRead));
 
-    YoriLibFreeStringContents(&TempPath);
-    YoriLibFreeStringContents(&TempName);
 
     if (NewBinary != NULL) {
         Dll->pInternetCloseHandle(NewBinary);
@@ -734,10 +1037,9 @@ YoriLibUpdateBinaryFromUrlWinHttp(
     LPTSTR HostName;
     LPTSTR ObjectName;
     DWORD dwError;
-    YORI_STRING TempName;
-    YORI_STRING TempPath;
-    YORI_STRING PrefixString;
-    HANDLE hTempFile = INVALID_HANDLE_VALUE;
+    YORI_LIB_UPDATE_PARTIAL Partial;
+    SYSTEMTIME LastModified;
+    DWORD LastModifiedSize;
     PUCHAR NewBinaryData = NULL;
     DWORD ActualBinarySize;
     DWORD ErrorBufferSize = 0;
@@ -748,8 +1050,8 @@ YoriLibUpdateBinaryFromUrlWinHttp(
     ASSERT(TargetName == NULL || YoriLibIsStringNullTerminated(TargetName));
 
     YoriLibInitEmptyString(&CombinedHeader);
-    YoriLibInitEmptyString(&TempName);
-    YoriLibInitEmptyString(&TempPath);
+    ZeroMemory(&Partial, sizeof(Partial));
+    Partial.FileHandle = INVALID_HANDLE_VALUE;
 
     //
     //  Open an internet connection with default proxy settings.
@@ -767,7 +1069,12 @@ YoriLibUpdateBinaryFromUrlWinHttp(
     }
 
     YoriLibInitEmptyString(&CombinedHeader);
-    if (!YoriLibUpdateBuildHttpHeaders(Url, IfModifiedSince, &CombinedHeader, &HostSubset, &ObjectName)) {
+    if (!YoriLibUpdateOpenPartialFile(Url, &Partial)) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    if (!YoriLibUpdateBuildHttpHeaders(Url, IfModifiedSince, &Partial, &CombinedHeader, &HostSubset, &ObjectName)) {
         Return = YoriLibUpdErrorInetInit;
         goto Exit;
     }
@@ -818,26 +1125,47 @@ YoriLibUpdateBinaryFromUrlWinHttp(
         goto Exit;
     }
 
-    if (dwError != 200) {
+    //
+    //  If the range requested from an earlier attempt can't be satisfied,
+    //  the data from that attempt isn't useful.  Discard it so that another
+    //  attempt can fetch the whole object.
+    //
+
+    if (dwError == 416) {
+        Partial.Resumable = FALSE;
+        Return = YoriLibUpdErrorInetRead;
+        goto Exit;
+    }
+
+    if (dwError != 200 && dwError != 206) {
         if (dwError != 304 || IfModifiedSince == NULL) {
             Return = YoriLibUpdErrorInetConnect;
         }
         goto Exit;
     }
 
-    //
-    //  Create a temporary file to hold the contents.
-    //
-
-    if (!YoriLibGetTempPath(&TempPath, 0)) {
+    if (!YoriLibUpdatePreparePartialFile(&Partial, dwError)) {
         Return = YoriLibUpdErrorFileWrite;
         goto Exit;
     }
 
-    YoriLibConstantString(&PrefixString, _T("UPD"));
-    if (!YoriLibGetTempFileName(&TempPath, &PrefixString, &hTempFile, &TempName)) {
-        Return = YoriLibUpdErrorFileWrite;
-        goto Exit;
+    //
+    //  If the server is sending the whole object and indicates when it was
+    //  last modified, data received can be resumed if this attempt fails.
+    //
+
+    if (dwError == 200) {
+        LastModifiedSize = sizeof(LastModified);
+        if (DllWinHttp.pWinHttpQueryHeaders(hRequest,
+                                            HTTP_QUERY_FLAG_SYSTEMTIME | HTTP_QUERY_LAST_MODIFIED,
+                                            NULL,
+                                            &LastModified,
+                                            &LastModifiedSize,
+                                            NULL)) {
+
+            memcpy(&Partial.LastModified, &LastModified, sizeof(SYSTEMTIME));
+            Partial.Resumable = TRUE;
+        }
     }
 
     NewBinaryData = YoriLibMalloc(UPDATE_READ_SIZE);
@@ -859,7 +1187,7 @@ YoriLibUpdateBinaryFromUrlWinHttp(
             break;
         }
 
-        if (!WriteFile(hTempFile, NewBinaryData, ActualBinarySize, &DataWritten, NULL) ||
+        if (!WriteFile(Partial.FileHandle, NewBinaryData, ActualBinarySize, &DataWritten, NULL) ||
             DataWritten != ActualBinarySize) {
 
             Return = YoriLibUpdErrorFileWrite;
@@ -883,8 +1211,8 @@ YoriLibUpdateBinaryFromUrlWinHttp(
     //
 
     if (TargetName == NULL) {
-        SetFilePointer(hTempFile, 0, NULL, FILE_BEGIN);
-        if (!ReadFile(hTempFile, NewBinaryData, 2, &ActualBinarySize, NULL) ||
+        SetFilePointer(Partial.FileHandle, 0, NULL, FILE_BEGIN);
+        if (!ReadFile(Partial.FileHandle, NewBinaryData, 2, &ActualBinarySize, NULL) ||
             ActualBinarySize != 2 ||
             NewBinaryData[0] != 'M' ||
             NewBinaryData[1] != 'Z' ) {
@@ -898,10 +1226,11 @@ YoriLibUpdateBinaryFromUrlWinHttp(
     //  Now update the binary with the local file.
     //
 
-    CloseHandle(hTempFile);
-    hTempFile = INVALID_HANDLE_VALUE;
+    CloseHandle(Partial.FileHandle);
+    Partial.FileHandle = INVALID_HANDLE_VALUE;
 
-    if (!YoriLibUpdateBinaryFromFile(TargetName, &TempName)) {
+    if (!YoriLibUpdateBinaryFromFile(TargetName, &Partial.FileName)) {
+        DeleteFile(Partial.FileName.StartOfString);
         Return = YoriLibUpdErrorFileReplace;
     }
 
@@ -911,14 +1240,16 @@ Exit:
         YoriLibFree(NewBinaryData);
     }
 
-    if (hTempFile != INVALID_HANDLE_VALUE) {
-        CloseHandle(hTempFile);
-        DeleteFile(TempName.StartOfString);
-    }
+    //
+    //  If the connection failed, keep any data received so a later attempt
+    //  can resume from it.
+    //
+
+    YoriLibUpdateClosePartialFile(&Partial,
+                                  (BOOLEAN)(Return == YoriLibUpdErrorInetConnect ||
+                                            Return == YoriLibUpdErrorInetRead));
 
     YoriLibFreeStringContents(&CombinedHeader);
-    YoriLibFreeStringContents(&TempPath);
-    YoriLibFreeStringContents(&TempName);
 
     if (hConnect != NULL) {
         DllWinHttp.pWinHttpCloseHandle(hConnect);
@@ -936,7 +1267,8 @@ Exit:
 }
 
 /**
- Download a file from the internet and store it in a local location.
+ Download a file from the internet and store it in a local location using
+ the best available HTTP implementation.  This makes a single attempt.
 
  @param Url The Url to download the file from.
 
@@ -951,7 +1283,7 @@ Exit:
  @return An update error code indicating success or appropriate error.
  */
 YORI_LIB_UPDATE_ERROR
-YoriLibUpdateBinaryFromUrl(
+YoriLibUpdateBinaryFromUrlOnce(
     __in PCYORI_STRING Url,
     __in_opt PCYORI_STRING TargetName,
     __in PCYORI_STRING Agent,
@@ -1015,6 +1347,1076 @@ YoriLibUpdateBinaryFromUrl(
     return YoriLibUpdateBinaryFromUrlWinInet(&StubWinInet, Url, TargetName, Agent, IfModifiedSince);
 }
 
+/**
+ Download a file from the internet and store it in a local location.  If
+ the connection fails while data is being received, the download is
+ retried, requesting only the data not yet received.
+
+ @param Url The Url to download the file from.
+
+ @param TargetName If specified, the local location to store the file.
+        If not specified, the current executable name is used.
+
+ @param Agent The user agent to report to the remote web server.
+
+ @param IfModifiedSince If specified, indicates a timestamp where a new
+        object should only be downloaded if it is newer.
+
+ @return An update error code indicating success or appropriate error.
+ */
+YORI_LIB_UPDATE_ERROR
+YoriLibUpdateBinaryFromUrl(
+    __in PCYORI_STRING Url,
+    __in_opt PCYORI_STRING TargetName,
+    __in PCYORI_STRING Agent,
+    __in_opt PSYSTEMTIME IfModifiedSince
+    )
+{
+    YORI_LIB_UPDATE_ERROR Return = YoriLibUpdErrorInetInit;
+    DWORD Attempt;
+
+    //
+    //  A download which fails while reading data leaves the data received
+    //  so far, so each retry only needs to fetch what remains.
+    //
+
+    for (Attempt = 0; Attempt < UPDATE_ATTEMPT_COUNT; Attempt++) {
+        Return = YoriLibUpdateBinaryFromUrlOnce(Url, TargetName, Agent, IfModifiedSince);
+        if (Return != YoriLibUpdErrorInetRead) {
+            break;
+        }
+    }
+
+    return Return;
+}
+
+/**
+ The number of bytes requested by each range request when downloading an
+ object over multiple connections.
+ */
+#define UPDATE_RANGE_SIZE (16 * UPDATE_READ_SIZE)
+
+/**
+ The largest hash, in bytes, that can be used to verify a download.  This
+ corresponds to SHA256.
+ */
+#define UPDATE_MAX_HASH_SIZE (32)
+
+/**
+ A region of an object to download over a single connection.
+ */
+typedef struct _YORI_LIB_UPDATE_RANGE {
+
+    /**
+     The work queue item for this range.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The offset of the range within the object, and within the local file.
+     */
+    LARGE_INTEGER Offset;
+
+    /**
+     The number of bytes in the range.  If zero, the server does not support
+     ranges and this range refers to the entire object, whose length is not
+     known until it has been received.
+     */
+    LARGE_INTEGER Length;
+
+    /**
+     The number of bytes received for this range.  This is only meaningful
+     once Complete is set.
+     */
+    LARGE_INTEGER BytesReceived;
+
+    /**
+     Set to TRUE once all data for this range has been written to the local
+     file.
+     */
+    volatile LONG Complete;
+} YORI_LIB_UPDATE_RANGE, *PYORI_LIB_UPDATE_RANGE;
+
+/**
+ State shared between the threads downloading ranges of a single object.
+ */
+typedef struct _YORI_LIB_UPDATE_RANGE_CONTEXT {
+
+    /**
+     The Url being downloaded.
+     */
+    PCYORI_STRING Url;
+
+    /**
+     The WinInet session handle.  WinInet allows this to be used for
+     concurrent requests from multiple threads.
+     */
+    PVOID hInternet;
+
+    /**
+     The Host: header to include in each request.
+     */
+    YORI_STRING HostHeader;
+
+    /**
+     An If-Range: header to include in each range request, so that if the
+     object changes during the download the server will not return a range
+     of the new object.  This is empty if the server did not indicate when
+     the object was last modified.
+     */
+    YORI_STRING IfRangeHeader;
+
+    /**
+     A handle to the local file, opened for overlapped I/O.  The file has
+     been extended to the size of the object so each range can be written
+     to its final location as it arrives.
+     */
+    HANDLE FileHandle;
+
+    /**
+     An auto reset event signalled whenever a range completes or fails.
+     */
+    HANDLE RangeCompleteEvent;
+
+    /**
+     An error encountered by any range, or YoriLibUpdErrorSuccess if no
+     error has occurred.
+     */
+    volatile LONG Error;
+
+    /**
+     The queue of ranges to download.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     An array of ranges which collectively describe the object.
+     */
+    PYORI_LIB_UPDATE_RANGE Ranges;
+
+    /**
+     The number of elements in the Ranges array.
+     */
+    YORI_ALLOC_SIZE_T RangeCount;
+} YORI_LIB_UPDATE_RANGE_CONTEXT, *PYORI_LIB_UPDATE_RANGE_CONTEXT;
+
+/**
+ Wait for an overlapped write to the local file to complete.
+
+ @param FileHandle Handle to the local file.
+
+ @param Overlapped Pointer to the overlapped structure used for the write.
+
+ @param BytesExpected The number of bytes the write should have written.
+
+ @return TRUE to indicate the write completed successfully, FALSE to
+         indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibUpdateWaitForWrite(
+    __in HANDLE FileHandle,
+    __in LPOVERLAPPED Overlapped,
+    __in DWORD BytesExpected
+    )
+{
+    DWORD BytesWritten;
+
+    if (!GetOverlappedResult(FileHandle, Overlapped, &BytesWritten, TRUE) ||
+        BytesWritten != BytesExpected) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Download a single range of an object and write it to the corresponding
+ location in the local file.  Two buffers are used so that data can be
+ received into one while the other is being written.
+
+ @param RangeContext Pointer to the state shared between the threads
+        downloading the object.
+
+ @param Range Pointer to the range to download.
+
+ @return An update error code indicating success or appropriate error.
+ */
+YORI_LIB_UPDATE_ERROR
+YoriLibUpdateFetchRange(
+    __in PYORI_LIB_UPDATE_RANGE_CONTEXT RangeContext,
+    __in PYORI_LIB_UPDATE_RANGE Range
+    )
+{
+    PVOID hRequest;
+    PUCHAR Buffers[2];
+    OVERLAPPED Overlapped[2];
+    DWORD BytesToWrite[2];
+    BOOLEAN WritePending[2];
+    DWORD Index;
+    DWORD Current;
+    DWORD BytesRead;
+    DWORD HttpStatus;
+    DWORD HttpStatusSize;
+    DWORD ExpectedStatus;
+    LARGE_INTEGER Offset;
+    YORI_STRING Header;
+    YORI_LIB_UPDATE_ERROR Return;
+
+    Range->BytesReceived.QuadPart = 0;
+    hRequest = NULL;
+    ZeroMemory(Overlapped, sizeof(Overlapped));
+    for (Index = 0; Index < 2; Index++) {
+        Buffers[Index] = NULL;
+        WritePending[Index] = FALSE;
+        BytesToWrite[Index] = 0;
+    }
+
+    YoriLibInitEmptyString(&Header);
+    if (Range->Length.QuadPart > 0) {
+        YoriLibYPrintf(&Header,
+                       _T("%yRange: bytes=%lli-%lli\r\n%y"),
+                       &RangeContext->HostHeader,
+                       Range->Offset.QuadPart,
+                       Range->Offset.QuadPart + Range->Length.QuadPart - 1,
+                       &RangeContext->IfRangeHeader);
+        ExpectedStatus = 206;
+    } else {
+        YoriLibYPrintf(&Header, _T("%y"), &RangeContext->HostHeader);
+        ExpectedStatus = 200;
+    }
+
+    if (Header.StartOfString == NULL) {
+        return YoriLibUpdErrorInetInit;
+    }
+
+    Return = YoriLibUpdErrorSuccess;
+    for (Index = 0; Index < 2; Index++) {
+        Buffers[Index] = YoriLibMalloc(UPDATE_READ_SIZE);
+        Overlapped[Index].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Buffers[Index] == NULL || Overlapped[Index].hEvent == NULL) {
+            Return = YoriLibUpdErrorFileWrite;
+            goto Exit;
+        }
+    }
+
+    hRequest = DllWinInet.pInternetOpenUrlW(RangeContext->hInternet,
+                                            RangeContext->Url->StartOfString,
+                                            Header.StartOfString,
+                                            Header.LengthInChars,
+                                            0,
+                                            0);
+    if (hRequest == NULL) {
+        Return = YoriLibUpdErrorInetConnect;
+        goto Exit;
+    }
+
+    HttpStatus = 0;
+    HttpStatusSize = sizeof(HttpStatus);
+    if (!DllWinInet.pHttpQueryInfoW(hRequest,
+                                    HTTP_QUERY_FLAG_NUMBER | HTTP_QUERY_STATUS_CODE,
+                                    &HttpStatus,
+                                    &HttpStatusSize,
+                                    NULL) ||
+        HttpStatus != ExpectedStatus) {
+
+        Return = YoriLibUpdErrorInetConnect;
+        goto Exit;
+    }
+
+    //
+    //  Before receiving into a buffer, wait for any earlier write from that
+    //  buffer to complete.  This allows the network and disk to be busy at
+    //  the same time.
+    //
+
+    Offset.QuadPart = Range->Offset.QuadPart;
+    Current = 0;
+    while (TRUE) {
+        if (WritePending[Current]) {
+            WritePending[Current] = FALSE;
+            if (!YoriLibUpdateWaitForWrite(RangeContext->FileHandle, &Overlapped[Current], BytesToWrite[Current])) {
+                Return = YoriLibUpdErrorFileWrite;
+                break;
+            }
+        }
+
+        if (!DllWinInet.pInternetReadFile(hRequest, Buffers[Current], UPDATE_READ_SIZE, &BytesRead)) {
+            Return = YoriLibUpdErrorInetRead;
+            break;
+        }
+
+        if (BytesRead == 0) {
+            break;
+        }
+
+        if (Range->Length.QuadPart > 0 &&
+            Range->BytesReceived.QuadPart + BytesRead > Range->Length.QuadPart) {
+
+            Return = YoriLibUpdErrorInetContents;
+            break;
+        }
+
+        Overlapped[Current].Offset = Offset.LowPart;
+        Overlapped[Current].OffsetHigh = Offset.HighPart;
+        BytesToWrite[Current] = BytesRead;
+        if (!WriteFile(RangeContext->FileHandle, Buffers[Current], BytesRead, NULL, &Overlapped[Current]) &&
+            GetLastError() != ERROR_IO_PENDING) {
+
+            Return = YoriLibUpdErrorFileWrite;
+            break;
+        }
+        WritePending[Current] = TRUE;
+
+        Offset.QuadPart = Offset.QuadPart + BytesRead;
+        Range->BytesReceived.QuadPart = Range->BytesReceived.QuadPart + BytesRead;
+        Current = Current ^ 1;
+    }
+
+    //
+    //  The buffers can't be freed until the writes using them are complete.
+    //
+
+    for (Index = 0; Index < 2; Index++) {
+        if (WritePending[Index]) {
+            if (!YoriLibUpdateWaitForWrite(RangeContext->FileHandle, &Overlapped[Index], BytesToWrite[Index]) &&
+                Return == YoriLibUpdErrorSuccess) {
+
+                Return = YoriLibUpdErrorFileWrite;
+            }
+        }
+    }
+
+    if (Return == YoriLibUpdErrorSuccess &&
+        Range->Length.QuadPart > 0 &&
+        Range->BytesReceived.QuadPart != Range->Length.QuadPart) {
+
+        Return = YoriLibUpdErrorInetRead;
+    }
+
+Exit:
+
+    if (hRequest != NULL) {
+        DllWinInet.pInternetCloseHandle(hRequest);
+    }
+
+    for (Index = 0; Index < 2; Index++) {
+        if (Buffers[Index] != NULL) {
+            YoriLibFree(Buffers[Index]);
+        }
+        if (Overlapped[Index].hEvent != NULL) {
+            CloseHandle(Overlapped[Index].hEvent);
+        }
+    }
+
+    YoriLibFreeStringContents(&Header);
+    return Return;
+}
+
+/**
+ Download a single range on a work queue thread.  If the range fails it is
+ retried from the beginning, since the data for the range is not written
+ anywhere that would allow resuming it.
+
+ @param Context Pointer to the state shared between the threads downloading
+        the object.
+
+ @param Item Pointer to the work item within the range.  Ranges are owned by
+        the shared state and are not deallocated here.
+
+ @param Cancelled If TRUE, the download has failed and this range should not
+        be fetched.
+ */
+VOID
+YoriLibUpdateRangeWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORI_LIB_UPDATE_RANGE_CONTEXT RangeContext;
+    PYORI_LIB_UPDATE_RANGE Range;
+    YORI_LIB_UPDATE_ERROR Error;
+    DWORD Attempt;
+
+    RangeContext = (PYORI_LIB_UPDATE_RANGE_CONTEXT)Context;
+    Range = CONTAINING_RECORD(Item, YORI_LIB_UPDATE_RANGE, WorkItem);
+
+    if (Cancelled || RangeContext->Error != YoriLibUpdErrorSuccess) {
+        return;
+    }
+
+    Error = YoriLibUpdErrorInetRead;
+    for (Attempt = 0; Attempt < UPDATE_ATTEMPT_COUNT; Attempt++) {
+        Error = YoriLibUpdateFetchRange(RangeContext, Range);
+        if (Error == YoriLibUpdErrorSuccess ||
+            Error == YoriLibUpdErrorFileWrite ||
+            RangeContext->Error != YoriLibUpdErrorSuccess) {
+
+            break;
+        }
+    }
+
+    if (Error == YoriLibUpdErrorSuccess) {
+        InterlockedExchange(&Range->Complete, TRUE);
+    } else if (RangeContext->Error == YoriLibUpdErrorSuccess) {
+
+        //
+        //  If multiple ranges fail concurrently, any of their errors is
+        //  sufficient to report.
+        //
+
+        InterlockedExchange(&RangeContext->Error, Error);
+    }
+
+    SetEvent(RangeContext->RangeCompleteEvent);
+}
+
+/**
+ Send an initial request for the first byte of an object to determine its
+ size and whether the server supports range requests.
+
+ @param RangeContext Pointer to the state shared between the threads
+        downloading the object.  On successful completion, the If-Range
+        header is populated if the server indicated when the object was last
+        modified.
+
+ @param IfModifiedSince If specified, indicates a timestamp where a new
+        object should only be downloaded if it is newer.
+
+ @param ObjectSize On successful completion, updated to contain the size of
+        the object.  This is zero if the server does not support range
+        requests or did not indicate the size.
+
+ @param NotModified On successful completion, set to TRUE if the object has
+        not been modified since IfModifiedSince.
+
+ @return An update error code indicating success or appropriate error.
+ */
+YORI_LIB_UPDATE_ERROR
+YoriLibUpdateQueryObjectSize(
+    __in PYORI_LIB_UPDATE_RANGE_CONTEXT RangeContext,
+    __in_opt PSYSTEMTIME IfModifiedSince,
+    __out PLARGE_INTEGER ObjectSize,
+    __out PBOOLEAN NotModified
+    )
+{
+    PVOID hRequest;
+    YORI_STRING Header;
+    YORI_STRING IfModifiedSinceHeader;
+    YORI_STRING ContentRange;
+    TCHAR ContentRangeBuffer[64];
+    DWORD BufferSize;
+    DWORD HttpStatus;
+    SYSTEMTIME LastModified;
+    LPTSTR Separator;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+
+    ObjectSize->QuadPart = 0;
+    *NotModified = FALSE;
+
+    YoriLibInitEmptyString(&IfModifiedSinceHeader);
+    if (IfModifiedSince != NULL) {
+        YoriLibUpdateBuildDateHeader(_T("If-Modified-Since"), IfModifiedSince, &IfModifiedSinceHeader);
+    }
+
+    YoriLibInitEmptyString(&Header);
+    YoriLibYPrintf(&Header, _T("%y%yRange: bytes=0-0\r\n"), &RangeContext->HostHeader, &IfModifiedSinceHeader);
+    YoriLibFreeStringContents(&IfModifiedSinceHeader);
+    if (Header.StartOfString == NULL) {
+        return YoriLibUpdErrorInetInit;
+    }
+
+    hRequest = DllWinInet.pInternetOpenUrlW(RangeContext->hInternet,
+                                            RangeContext->Url->StartOfString,
+                                            Header.StartOfString,
+                                            Header.LengthInChars,
+                                            0,
+                                            0);
+    YoriLibFreeStringContents(&Header);
+    if (hRequest == NULL) {
+        return YoriLibUpdErrorInetConnect;
+    }
+
+    HttpStatus = 0;
+    BufferSize = sizeof(HttpStatus);
+    if (!DllWinInet.pHttpQueryInfoW(hRequest,
+                                    HTTP_QUERY_FLAG_NUMBER | HTTP_QUERY_STATUS_CODE,
+                                    &HttpStatus,
+                                    &BufferSize,
+                                    NULL)) {
+
+        DllWinInet.pInternetCloseHandle(hRequest);
+        return YoriLibUpdErrorInetConnect;
+    }
+
+    if (HttpStatus == 304 && IfModifiedSince != NULL) {
+        *NotModified = TRUE;
+        DllWinInet.pInternetCloseHandle(hRequest);
+        return YoriLibUpdErrorSuccess;
+    }
+
+    //
+    //  A server which doesn't support ranges returns the whole object, and
+    //  a zero length object can't satisfy any range.  In both cases the
+    //  object is downloaded over a single connection.  Closing this request
+    //  abandons any data the server is sending.
+    //
+
+    if (HttpStatus == 200 || HttpStatus == 416) {
+        DllWinInet.pInternetCloseHandle(hRequest);
+        return YoriLibUpdErrorSuccess;
+    }
+
+    if (HttpStatus != 206) {
+        DllWinInet.pInternetCloseHandle(hRequest);
+        return YoriLibUpdErrorInetConnect;
+    }
+
+    //
+    //  The Content-Range header is in the form "bytes 0-0/<size>".  If the
+    //  size is not known, the server can return "*", which will fail to
+    //  parse and the object is downloaded over a single connection.
+    //
+
+    BufferSize = sizeof(ContentRangeBuffer) - sizeof(TCHAR);
+    if (DllWinInet.pHttpQueryInfoW(hRequest,
+                                   HTTP_QUERY_CONTENT_RANGE,
+                                   ContentRangeBuffer,
+                                   &BufferSize,
+                                   NULL)) {
+
+        YoriLibInitEmptyString(&ContentRange);
+        ContentRange.StartOfString = ContentRangeBuffer;
+        ContentRange.LengthInChars = (YORI_ALLOC_SIZE_T)(BufferSize / sizeof(TCHAR));
+        Separator = YoriLibFindRightMostCharacter(&ContentRange, '/');
+        if (Separator != NULL) {
+            ContentRange.LengthInChars = (YORI_ALLOC_SIZE_T)(ContentRange.LengthInChars - (Separator - ContentRange.StartOfString + 1));
+            ContentRange.StartOfString = Separator + 1;
+            if (YoriLibStringToNumber(&ContentRange, FALSE, &llTemp, &CharsConsumed) &&
+                CharsConsumed > 0 &&
+                llTemp > 0) {
+
+                ObjectSize->QuadPart = llTemp;
+            }
+        }
+    }
+
+    BufferSize = sizeof(LastModified);
+    if (ObjectSize->QuadPart > 0 &&
+        DllWinInet.pHttpQueryInfoW(hRequest,
+                                   HTTP_QUERY_FLAG_SYSTEMTIME | HTTP_QUERY_LAST_MODIFIED,
+                                   &LastModified,
+                                   &BufferSize,
+                                   NULL)) {
+
+        YoriLibUpdateBuildDateHeader(_T("If-Range"), &LastModified, &RangeContext->IfRangeHeader);
+    }
+
+    DllWinInet.pInternetCloseHandle(hRequest);
+    return YoriLibUpdErrorSuccess;
+}
+
+/**
+ Read a completed range back from the local file and add it to a hash.
+
+ @param RangeContext Pointer to the state shared between the threads
+        downloading the object.
+
+ @param Range Pointer to the completed range.
+
+ @param hHash The hash to add the range's data to.
+
+ @param Buffer Pointer to a buffer of UPDATE_READ_SIZE bytes.
+
+ @param Event A manual reset event to use for overlapped reads.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibUpdateHashRange(
+    __in PYORI_LIB_UPDATE_RANGE_CONTEXT RangeContext,
+    __in PYORI_LIB_UPDATE_RANGE Range,
+    __in DWORD_PTR hHash,
+    __in PUCHAR Buffer,
+    __in HANDLE Event
+    )
+{
+    OVERLAPPED Overlapped;
+    LARGE_INTEGER Offset;
+    LARGE_INTEGER Remaining;
+    DWORD BytesToRead;
+    DWORD BytesRead;
+
+    Offset.QuadPart = Range->Offset.QuadPart;
+    Remaining.QuadPart = Range->BytesReceived.QuadPart;
+
+    while (Remaining.QuadPart > 0) {
+        BytesToRead = UPDATE_READ_SIZE;
+        if (Remaining.QuadPart < BytesToRead) {
+            BytesToRead = Remaining.LowPart;
+        }
+
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.Offset = Offset.LowPart;
+        Overlapped.OffsetHigh = Offset.HighPart;
+        Overlapped.hEvent = Event;
+
+        if (!ReadFile(RangeContext->FileHandle, Buffer, BytesToRead, NULL, &Overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+
+            return FALSE;
+        }
+
+        if (!GetOverlappedResult(RangeContext->FileHandle, &Overlapped, &BytesRead, TRUE) ||
+            BytesRead != BytesToRead) {
+
+            return FALSE;
+        }
+
+        if (!DllAdvApi32.pCryptHashData(hHash, Buffer, BytesRead, 0)) {
+            return FALSE;
+        }
+
+        Offset.QuadPart = Offset.QuadPart + BytesRead;
+        Remaining.QuadPart = Remaining.QuadPart - BytesRead;
+    }
+
+    return TRUE;
+}
+
+/**
+ Prepare a hash to verify downloaded data against an expected value.
+
+ @param ExpectedHash Pointer to a string containing the expected hash in
+        hex.  A 40 character string is a SHA1 hash and a 64 character string
+        is a SHA256 hash.
+
+ @param ExpectedHashValue On successful completion, populated with the
+        expected hash in binary form.
+
+ @param ExpectedHashLength On successful completion, updated to contain the
+        number of bytes in the expected hash.
+
+ @param hProv On successful completion, updated to contain a handle to the
+        crypto provider.
+
+ @param hHash On successful completion, updated to contain a handle to the
+        hash.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibUpdateCreateHash(
+    __in PCYORI_STRING ExpectedHash,
+    __out_ecount(UPDATE_MAX_HASH_SIZE) PUCHAR ExpectedHashValue,
+    __out PDWORD ExpectedHashLength,
+    __out PDWORD_PTR hProv,
+    __out PDWORD_PTR hHash
+    )
+{
+    DWORD Algorithm;
+    YORI_STRING HashString;
+
+    *hProv = 0;
+    *hHash = 0;
+
+    if (ExpectedHash->LengthInChars == 40) {
+        Algorithm = CALG_SHA1;
+    } else if (ExpectedHash->LengthInChars == 64) {
+        Algorithm = CALG_SHA_256;
+    } else {
+        return FALSE;
+    }
+
+    *ExpectedHashLength = ExpectedHash->LengthInChars / 2;
+    YoriLibInitEmptyString(&HashString);
+    HashString.StartOfString = ExpectedHash->StartOfString;
+    HashString.LengthInChars = ExpectedHash->LengthInChars;
+    if (!YoriLibStringToHexBuffer(&HashString, ExpectedHashValue, (YORI_ALLOC_SIZE_T)*ExpectedHashLength)) {
+        return FALSE;
+    }
+
+    YoriLibLoadAdvApi32Functions();
+    if (DllAdvApi32.pCryptAcquireContextW == NULL ||
+        DllAdvApi32.pCryptCreateHash == NULL ||
+        DllAdvApi32.pCryptDestroyHash == NULL ||
+        DllAdvApi32.pCryptGetHashParam == NULL ||
+        DllAdvApi32.pCryptHashData == NULL ||
+        DllAdvApi32.pCryptReleaseContext == NULL) {
+
+        return FALSE;
+    }
+
+    //
+    //  SHA256 requires the AES provider.  SHA1 is supported by the base
+    //  provider on systems that predate it.
+    //
+
+    if (!DllAdvApi32.pCryptAcquireContextW(hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)) {
+        if (Algorithm != CALG_SHA1 ||
+            !DllAdvApi32.pCryptAcquireContextW(hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
+
+            *hProv = 0;
+            return FALSE;
+        }
+    }
+
+    if (!DllAdvApi32.pCryptCreateHash(*hProv, Algorithm, 0, 0, hHash)) {
+        DllAdvApi32.pCryptReleaseContext(*hProv, 0);
+        *hProv = 0;
+        *hHash = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Download a file from the internet over multiple concurrent connections and
+ store it in a local location.  The object is divided into ranges which are
+ fetched by a pool of threads and written directly to their final location
+ in a preallocated file.  If an expected hash is supplied, ranges are added
+ to the hash in order as they complete, so verification proceeds while the
+ remainder of the object is being received.  If the server does not support
+ range requests, the object is downloaded over a single connection.  This
+ requires the Unicode WinInet functions.
+
+ @param Url The Url to download the file from.
+
+ @param TargetName The local location to store the file, as a full path.
+
+ @param Agent The user agent to report to the remote web server.
+
+ @param ConnectionCount The maximum number of concurrent connections to use.
+
+ @param IfModifiedSince If specified, indicates a timestamp where a new
+        object should only be downloaded if it is newer.
+
+ @param ExpectedHash If specified, points to a SHA1 or SHA256 hash in hex
+        which the downloaded object must match.
+
+ @return An update error code indicating success or appropriate error.
+ */
+YORI_LIB_UPDATE_ERROR
+YoriLibUpdateBinaryFromUrlInRanges(
+    __in PCYORI_STRING Url,
+    __in PCYORI_STRING TargetName,
+    __in PCYORI_STRING Agent,
+    __in DWORD ConnectionCount,
+    __in_opt PSYSTEMTIME IfModifiedSince,
+    __in_opt PCYORI_STRING ExpectedHash
+    )
+{
+    YORI_LIB_UPDATE_RANGE_CONTEXT RangeContext;
+    YORI_LIB_UPDATE_ERROR Return;
+    YORI_STRING HostSubset;
+    YORI_STRING ParentDirectory;
+    YORI_STRING PrefixString;
+    YORI_STRING TempFileName;
+    LPTSTR ObjectName;
+    LPTSTR FinalBackslash;
+    LARGE_INTEGER ObjectSize;
+    BOOLEAN NotModified;
+    BOOLEAN QueueInitialized;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T NextRangeToHash;
+    UCHAR ExpectedHashValue[UPDATE_MAX_HASH_SIZE];
+    UCHAR ActualHashValue[UPDATE_MAX_HASH_SIZE];
+    DWORD ExpectedHashLength;
+    DWORD HashLength;
+    DWORD_PTR hProv;
+    DWORD_PTR hHash;
+    PUCHAR HashBuffer;
+    HANDLE HashEvent;
+
+    ASSERT(YoriLibIsStringNullTerminated(Url));
+    ASSERT(YoriLibIsStringNullTerminated(Agent));
+    ASSERT(YoriLibIsStringNullTerminated(TargetName));
+
+    ZeroMemory(&RangeContext, sizeof(RangeContext));
+    RangeContext.Url = Url;
+    RangeContext.FileHandle = INVALID_HANDLE_VALUE;
+    RangeContext.Error = YoriLibUpdErrorSuccess;
+    YoriLibInitEmptyString(&TempFileName);
+    QueueInitialized = FALSE;
+    ExpectedHashLength = 0;
+    hProv = 0;
+    hHash = 0;
+    HashBuffer = NULL;
+    HashEvent = NULL;
+
+    if (ExpectedHash != NULL) {
+        if (!YoriLibUpdateCreateHash(ExpectedHash, ExpectedHashValue, &ExpectedHashLength, &hProv, &hHash)) {
+            Return = YoriLibUpdErrorHash;
+            goto Exit;
+        }
+
+        HashBuffer = YoriLibMalloc(UPDATE_READ_SIZE);
+        HashEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (HashBuffer == NULL || HashEvent == NULL) {
+            Return = YoriLibUpdErrorHash;
+            goto Exit;
+        }
+    }
+
+    YoriLibLoadWinInetFunctions();
+    if (DllWinInet.pInternetOpenW == NULL ||
+        DllWinInet.pInternetOpenUrlW == NULL ||
+        DllWinInet.pHttpQueryInfoW == NULL ||
+        DllWinInet.pInternetReadFile == NULL ||
+        DllWinInet.pInternetCloseHandle == NULL) {
+
+        Return = YoriLibUpdErrorInetInit;
+        goto Exit;
+    }
+
+    RangeContext.hInternet = DllWinInet.pInternetOpenW(Agent->StartOfString, 0, NULL, NULL, 0);
+    if (RangeContext.hInternet == NULL) {
+        Return = YoriLibUpdErrorInetInit;
+        goto Exit;
+    }
+
+    if (!YoriLibUpdateBuildHttpHeaders(Url, NULL, NULL, &RangeContext.HostHeader, &HostSubset, &ObjectName)) {
+        Return = YoriLibUpdErrorInetInit;
+        goto Exit;
+    }
+
+    Return = YoriLibUpdateQueryObjectSize(&RangeContext, IfModifiedSince, &ObjectSize, &NotModified);
+    if (Return != YoriLibUpdErrorSuccess || NotModified) {
+        goto Exit;
+    }
+
+    //
+    //  Create the local file alongside the target so that replacing the
+    //  target doesn't need to copy it between volumes.
+    //
+
+    FinalBackslash = YoriLibFindRightMostCharacter(TargetName, '\\');
+    if (FinalBackslash == NULL) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    YoriLibInitEmptyString(&ParentDirectory);
+    ParentDirectory.StartOfString = TargetName->StartOfString;
+    ParentDirectory.LengthInChars = (YORI_ALLOC_SIZE_T)(FinalBackslash - TargetName->StartOfString);
+
+    YoriLibConstantString(&PrefixString, _T("UPD"));
+    if (!YoriLibGetTempFileName(&ParentDirectory, &PrefixString, NULL, &TempFileName)) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    RangeContext.FileHandle = CreateFile(TempFileName.StartOfString,
+                                         GENERIC_READ | GENERIC_WRITE,
+                                         FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                         NULL,
+                                         OPEN_EXISTING,
+                                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+                                         NULL);
+    if (RangeContext.FileHandle == INVALID_HANDLE_VALUE) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    //
+    //  If the size is known, extend the file to it now so each range can be
+    //  written in place and the file system can allocate it contiguously.
+    //  Otherwise, a single range describes the whole object.
+    //
+
+    if (ObjectSize.QuadPart > 0) {
+        LARGE_INTEGER RangeCount;
+
+        RangeCount.QuadPart = (ObjectSize.QuadPart + UPDATE_RANGE_SIZE - 1) / UPDATE_RANGE_SIZE;
+        if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)RangeCount.QuadPart * sizeof(YORI_LIB_UPDATE_RANGE))) {
+            Return = YoriLibUpdErrorFileWrite;
+            goto Exit;
+        }
+        RangeContext.RangeCount = (YORI_ALLOC_SIZE_T)RangeCount.QuadPart;
+
+        if (SetFilePointer(RangeContext.FileHandle, ObjectSize.LowPart, &ObjectSize.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+            GetLastError() != NO_ERROR) {
+
+            Return = YoriLibUpdErrorFileWrite;
+            goto Exit;
+        }
+
+        if (!SetEndOfFile(RangeContext.FileHandle)) {
+            Return = YoriLibUpdErrorFileWrite;
+            goto Exit;
+        }
+    } else {
+        RangeContext.RangeCount = 1;
+    }
+
+    RangeContext.Ranges = YoriLibMalloc(RangeContext.RangeCount * sizeof(YORI_LIB_UPDATE_RANGE));
+    if (RangeContext.Ranges == NULL) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    ZeroMemory(RangeContext.Ranges, RangeContext.RangeCount * sizeof(YORI_LIB_UPDATE_RANGE));
+    for (Index = 0; Index < RangeContext.RangeCount; Index++) {
+        RangeContext.Ranges[Index].Offset.QuadPart = (LONGLONG)Index * UPDATE_RANGE_SIZE;
+        if (ObjectSize.QuadPart > 0) {
+            RangeContext.Ranges[Index].Length.QuadPart = ObjectSize.QuadPart - RangeContext.Ranges[Index].Offset.QuadPart;
+            if (RangeContext.Ranges[Index].Length.QuadPart > UPDATE_RANGE_SIZE) {
+                RangeContext.Ranges[Index].Length.QuadPart = UPDATE_RANGE_SIZE;
+            }
+        }
+    }
+
+    RangeContext.RangeCompleteEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (RangeContext.RangeCompleteEvent == NULL) {
+        Return = YoriLibUpdErrorFileWrite;
+        goto Exit;
+    }
+
+    if (ConnectionCount == 0) {
+        ConnectionCount = 1;
+    }
+
+    if (ConnectionCount > RangeContext.RangeCount) {
+        ConnectionCount = RangeContext.RangeCount;
+    }
+
+    if (!YoriLibInitializeWorkQueue(&RangeContext.WorkQueue, (YORI_ALLOC_SIZE_T)ConnectionCount, 0, YoriLibUpdateRangeWorker, &RangeContext)) {
+        Return = YoriLibUpdErrorInetInit;
+        goto Exit;
+    }
+    QueueInitialized = TRUE;
+
+    for (Index = 0; Index < RangeContext.RangeCount; Index++) {
+        if (!YoriLibQueueWorkItem(&RangeContext.WorkQueue, &RangeContext.Ranges[Index].WorkItem, TRUE)) {
+            InterlockedExchange(&RangeContext.Error, YoriLibUpdErrorInetInit);
+            break;
+        }
+    }
+
+    //
+    //  Ranges are generally completed in the order they were queued.  Wait
+    //  for each in order, and if verifying a hash, add it to the hash while
+    //  later ranges are still being received.
+    //
+
+    NextRangeToHash = 0;
+    while (NextRangeToHash < RangeContext.RangeCount &&
+           RangeContext.Error == YoriLibUpdErrorSuccess) {
+
+        if (!RangeContext.Ranges[NextRangeToHash].Complete) {
+            WaitForSingleObject(RangeContext.RangeCompleteEvent, INFINITE);
+            continue;
+        }
+
+        if (hHash != 0 &&
+            !YoriLibUpdateHashRange(&RangeContext, &RangeContext.Ranges[NextRangeToHash], hHash, HashBuffer, HashEvent)) {
+
+            InterlockedExchange(&RangeContext.Error, YoriLibUpdErrorHash);
+            break;
+        }
+
+        NextRangeToHash++;
+    }
+
+    if (RangeContext.Error != YoriLibUpdErrorSuccess) {
+        YoriLibCancelWorkQueue(&RangeContext.WorkQueue);
+    }
+
+    YoriLibWaitForWorkQueue(&RangeContext.WorkQueue);
+    YoriLibCleanupWorkQueue(&RangeContext.WorkQueue);
+    QueueInitialized = FALSE;
+
+    Return = (YORI_LIB_UPDATE_ERROR)RangeContext.Error;
+    if (Return != YoriLibUpdErrorSuccess) {
+        goto Exit;
+    }
+
+    if (hHash != 0) {
+        HashLength = sizeof(ActualHashValue);
+        if (!DllAdvApi32.pCryptGetHashParam(hHash, HP_HASHVAL, ActualHashValue, &HashLength, 0) ||
+            HashLength != ExpectedHashLength) {
+
+            Return = YoriLibUpdErrorHash;
+            goto Exit;
+        }
+
+        if (memcmp(ActualHashValue, ExpectedHashValue, ExpectedHashLength) != 0) {
+            Return = YoriLibUpdErrorInetContents;
+            goto Exit;
+        }
+    }
+
+    //
+    //  Now update the target with the local file.
+    //
+
+    CloseHandle(RangeContext.FileHandle);
+    RangeContext.FileHandle = INVALID_HANDLE_VALUE;
+
+    if (!YoriLibUpdateBinaryFromFile(TargetName, &TempFileName)) {
+        Return = YoriLibUpdErrorFileReplace;
+        goto Exit;
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+
+Exit:
+
+    if (QueueInitialized) {
+        YoriLibCancelWorkQueue(&RangeContext.WorkQueue);
+        YoriLibWaitForWorkQueue(&RangeContext.WorkQueue);
+        YoriLibCleanupWorkQueue(&RangeContext.WorkQueue);
+    }
+
+    if (RangeContext.FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(RangeContext.FileHandle);
+    }
+
+    if (TempFileName.LengthInChars > 0) {
+        DeleteFile(TempFileName.StartOfString);
+        YoriLibFreeStringContents(&TempFileName);
+    }
+
+    if (RangeContext.Ranges != NULL) {
+        YoriLibFree(RangeContext.Ranges);
+    }
+
+    if (RangeContext.RangeCompleteEvent != NULL) {
+        CloseHandle(RangeContext.RangeCompleteEvent);
+    }
+
+    YoriLibFreeStringContents(&RangeContext.HostHeader);
+    YoriLibFreeStringContents(&RangeContext.IfRangeHeader);
+
+    if (RangeContext.hInternet != NULL) {
+        DllWinInet.pInternetCloseHandle(RangeContext.hInternet);
+    }
+
+    if (HashEvent != NULL) {
+        CloseHandle(HashEvent);
+    }
+
+    if (HashBuffer != NULL) {
+        YoriLibFree(HashBuffer);
+    }
+
+    if (hHash != 0) {
+        DllAdvApi32.pCryptDestroyHash(hHash);
+    }
+
+    if (hProv != 0) {
+        DllAdvApi32.pCryptReleaseContext(hProv, 0);
+    }
+
+    return Return;
+}
+
 /**
  Returns a constant (not allocated) string corresponding to the specified
  update error code.
@@ -0,0 +1,1322 @@
+/**
+ * @file lib/volenum.c
+ *
+ * Yori whole volume enumeration from the master file table
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The size of the buffer used to receive records from the volume.
+ */
+#define YORILIB_VOLENUM_BUFFER_SIZE          (64 * 1024)
+
+/**
+ The maximum length of a path that can be reported, in characters.
+ */
+#define YORILIB_VOLENUM_MAX_PATH             (0x7FFF)
+
+/**
+ The portion of a file reference number that describes the index of the
+ file record within the master file table.  The remaining bits contain a
+ sequence number.
+ */
+#define YORILIB_VOLENUM_INDEX_MASK           ((((DWORDLONG)1) << 48) - 1)
+
+/**
+ The number of file records at the start of the master file table reserved
+ for file system metadata.  These are not visible to a directory enumerate.
+ */
+#define YORILIB_VOLENUM_RESERVED_RECORDS     (16)
+
+/**
+ A value indicating no entry in a list of entries.
+ */
+#define YORILIB_VOLENUM_NO_ENTRY             ((DWORD)-1)
+
+/**
+ The signature at the start of every in use file record.
+ */
+#define YORILIB_VOLENUM_FILE_SIGNATURE       (0x454C4946)
+
+/**
+ The flag in a file record header indicating the record is in use.
+ */
+#define YORILIB_VOLENUM_RECORD_IN_USE        (0x0001)
+
+/**
+ The attribute type code for standard information.
+ */
+#define YORILIB_VOLENUM_ATTR_STANDARD_INFO   (0x10)
+
+/**
+ The attribute type code for an attribute list, indicating the file's
+ attributes extend beyond its base file record.
+ */
+#define YORILIB_VOLENUM_ATTR_ATTRIBUTE_LIST  (0x20)
+
+/**
+ The attribute type code for file data.
+ */
+#define YORILIB_VOLENUM_ATTR_DATA            (0x80)
+
+/**
+ The attribute type code for a reparse point.
+ */
+#define YORILIB_VOLENUM_ATTR_REPARSE_POINT   (0xC0)
+
+/**
+ The attribute type code marking the end of a file record.
+ */
+#define YORILIB_VOLENUM_ATTR_END             (0xFFFFFFFF)
+
+/**
+ Input to FSCTL_ENUM_USN_DATA.  This is defined here because the name and
+ layout differ between compilation environments.
+ */
+typedef struct _YORILIB_VOLENUM_MFT_ENUM_DATA {
+
+    /**
+     The file reference number to resume the enumerate from.
+     */
+    DWORDLONG StartFileReferenceNumber;
+
+    /**
+     The lowest USN of records to return.
+     */
+    LONGLONG LowUsn;
+
+    /**
+     The highest USN of records to return.
+     */
+    LONGLONG HighUsn;
+} YORILIB_VOLENUM_MFT_ENUM_DATA, *PYORILIB_VOLENUM_MFT_ENUM_DATA;
+
+/**
+ The header of an NTFS file record.
+ */
+typedef struct _YORILIB_VOLENUM_FILE_RECORD {
+
+    /**
+     The signature of the record, which is 'FILE' for a valid record.
+     */
+    DWORD Signature;
+
+    /**
+     The offset to the update sequence array.
+     */
+    WORD UpdateSequenceOffset;
+
+    /**
+     The number of entries in the update sequence array.
+     */
+    WORD UpdateSequenceCount;
+
+    /**
+     The log sequence number of the last change to the record.
+     */
+    LONGLONG Lsn;
+
+    /**
+     The sequence number of the record, which forms the upper bits of the
+     file reference number.
+     */
+    WORD SequenceNumber;
+
+    /**
+     The number of names referring to the file.
+     */
+    WORD LinkCount;
+
+    /**
+     The offset in bytes from the start of the record to the first
+     attribute.
+     */
+    WORD FirstAttributeOffset;
+
+    /**
+     Flags for the record, including whether it is in use.
+     */
+    WORD Flags;
+
+    /**
+     The number of bytes in the record that contain data.
+     */
+    DWORD BytesInUse;
+
+    /**
+     The number of bytes allocated for the record.
+     */
+    DWORD BytesAllocated;
+
+    /**
+     If this record is an extension of another record, the file reference
+     number of the base record.
+     */
+    DWORDLONG BaseFileRecord;
+} YORILIB_VOLENUM_FILE_RECORD, *PYORILIB_VOLENUM_FILE_RECORD;
+
+/**
+ The header of an attribute within an NTFS file record.
+ */
+typedef struct _YORILIB_VOLENUM_ATTRIBUTE {
+
+    /**
+     The type of the attribute.
+     */
+    DWORD TypeCode;
+
+    /**
+     The length of this attribute within the file record, in bytes.
+     */
+    DWORD RecordLength;
+
+    /**
+     Zero if the attribute value is contained in the file record, nonzero if
+     it is stored in clusters elsewhere on the volume.
+     */
+    UCHAR FormCode;
+
+    /**
+     The length of the attribute name, in characters.
+     */
+    UCHAR NameLength;
+
+    /**
+     The offset from the start of the attribute to its name.
+     */
+    WORD NameOffset;
+
+    /**
+     Flags for the attribute.
+     */
+    WORD Flags;
+
+    /**
+     An identifier for the attribute within the file record.
+     */
+    WORD Instance;
+
+    /**
+     Information that depends on whether the attribute is resident.
+     */
+    union {
+
+        /**
+         Information for an attribute contained in the file record.
+         */
+        struct {
+
+            /**
+             The length of the value in bytes.
+             */
+            DWORD ValueLength;
+
+            /**
+             The offset from the start of the attribute to the value.
+             */
+            WORD ValueOffset;
+
+            /**
+             Flags for the resident value.
+             */
+            UCHAR ResidentFlags;
+
+            /**
+             Reserved.
+             */
+            UCHAR Reserved;
+        } Resident;
+
+        /**
+         Information for an attribute stored elsewhere on the volume.
+         */
+        struct {
+
+            /**
+             The first cluster described by this attribute record.  Only
+             the record describing cluster zero contains valid sizes.
+             */
+            LONGLONG LowestVcn;
+
+            /**
+             The last cluster described by this attribute record.
+             */
+            LONGLONG HighestVcn;
+
+            /**
+             The offset from the start of the attribute to its mapping
+             pairs.
+             */
+            WORD MappingPairsOffset;
+
+            /**
+             The compression unit of the attribute.
+             */
+            UCHAR CompressionUnit;
+
+            /**
+             Reserved.
+             */
+            UCHAR Reserved[5];
+
+            /**
+             The number of bytes allocated to the attribute.
+             */
+            LONGLONG AllocatedLength;
+
+            /**
+             The size of the attribute in bytes.
+             */
+            LONGLONG FileSize;
+
+            /**
+             The number of bytes of the attribute that contain valid data.
+             */
+            LONGLONG ValidDataLength;
+        } Nonresident;
+    } Form;
+} YORILIB_VOLENUM_ATTRIBUTE, *PYORILIB_VOLENUM_ATTRIBUTE;
+
+/**
+ The value of the standard information attribute.
+ */
+typedef struct _YORILIB_VOLENUM_STANDARD_INFO {
+
+    /**
+     The time the file was created.
+     */
+    LARGE_INTEGER CreationTime;
+
+    /**
+     The time the file data was last written.
+     */
+    LARGE_INTEGER LastModificationTime;
+
+    /**
+     The time the file record was last changed.
+     */
+    LARGE_INTEGER LastChangeTime;
+
+    /**
+     The time the file was last accessed.
+     */
+    LARGE_INTEGER LastAccessTime;
+
+    /**
+     The attributes of the file.
+     */
+    DWORD FileAttributes;
+} YORILIB_VOLENUM_STANDARD_INFO, *PYORILIB_VOLENUM_STANDARD_INFO;
+
+/**
+ Information about a single file found on the volume.
+ */
+typedef struct _YORILIB_VOLENUM_ENTRY {
+
+    /**
+     The file reference number of the file.
+     */
+    DWORDLONG FileReferenceNumber;
+
+    /**
+     The file reference number of the directory containing the file.
+     */
+    DWORDLONG ParentFileReferenceNumber;
+
+    /**
+     The attributes of the file.
+     */
+    DWORD FileAttributes;
+
+    /**
+     The offset within the name buffer to the file name, in characters.
+     */
+    DWORD NameOffset;
+
+    /**
+     The index of the first entry within this directory, or
+     YORILIB_VOLENUM_NO_ENTRY.
+     */
+    DWORD FirstChild;
+
+    /**
+     The index of the next entry within the same directory, or
+     YORILIB_VOLENUM_NO_ENTRY.
+     */
+    DWORD NextSibling;
+
+    /**
+     The length of the file name, in characters.
+     */
+    WORD NameLength;
+} YORILIB_VOLENUM_ENTRY, *PYORILIB_VOLENUM_ENTRY;
+
+/**
+ State for a single whole volume enumerate.
+ */
+typedef struct _YORILIB_VOLENUM_CONTEXT {
+
+    /**
+     A handle to the volume.
+     */
+    HANDLE hVolume;
+
+    /**
+     The file reference number of the root directory.
+     */
+    DWORDLONG RootFileReferenceNumber;
+
+    /**
+     The size of a file record on the volume, in bytes.
+     */
+    DWORD BytesPerFileRecord;
+
+    /**
+     An array of entries found on the volume, sorted by file record index.
+     */
+    PYORILIB_VOLENUM_ENTRY Entries;
+
+    /**
+     The number of entries populated in the Entries array.
+     */
+    DWORD EntryCount;
+
+    /**
+     The number of entries allocated in the Entries array.
+     */
+    DWORD EntriesAllocated;
+
+    /**
+     The index of the first entry within the root directory, or
+     YORILIB_VOLENUM_NO_ENTRY.
+     */
+    DWORD RootFirstChild;
+
+    /**
+     A buffer containing the names of every entry, without terminators.
+     */
+    YORI_STRING Names;
+
+    /**
+     A buffer containing the path of the object being reported.
+     */
+    YORI_STRING Path;
+
+    /**
+     A buffer to receive a file record from the volume.
+     */
+    PNTFS_FILE_RECORD_OUTPUT_BUFFER RecordOutput;
+
+    /**
+     The size of RecordOutput, in bytes.
+     */
+    DWORD RecordOutputLength;
+
+    /**
+     An aligned copy of the most recently returned file record.
+     */
+    PYORILIB_VOLENUM_FILE_RECORD Record;
+
+    /**
+     The flags for the enumerate.
+     */
+    WORD MatchFlags;
+
+    /**
+     The callback to invoke on each match.
+     */
+    PYORILIB_FILE_ENUM_FN Callback;
+
+    /**
+     The callback to invoke on an error.
+     */
+    PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback;
+
+    /**
+     Caller provided context to pass to callbacks.
+     */
+    PVOID Context;
+
+    /**
+     Information about the object being reported.
+     */
+    WIN32_FIND_DATA FindData;
+} YORILIB_VOLENUM_CONTEXT, *PYORILIB_VOLENUM_CONTEXT;
+
+/**
+ Free any allocations contained in a volume enumerate context.
+
+ @param VolContext Pointer to the context to clean up.
+ */
+VOID
+YoriLibVolEnumCleanup(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext
+    )
+{
+    if (VolContext->hVolume != INVALID_HANDLE_VALUE) {
+        CloseHandle(VolContext->hVolume);
+        VolContext->hVolume = INVALID_HANDLE_VALUE;
+    }
+    if (VolContext->Entries != NULL) {
+        YoriLibFree(VolContext->Entries);
+        VolContext->Entries = NULL;
+    }
+    if (VolContext->RecordOutput != NULL) {
+        YoriLibFree(VolContext->RecordOutput);
+        VolContext->RecordOutput = NULL;
+    }
+    if (VolContext->Record != NULL) {
+        YoriLibFree(VolContext->Record);
+        VolContext->Record = NULL;
+    }
+    YoriLibFreeStringContents(&VolContext->Names);
+    YoriLibFreeStringContents(&VolContext->Path);
+}
+
+/**
+ Add a USN record describing a file on the volume to the set of entries.
+
+ @param VolContext Pointer to the volume enumerate context.
+
+ @param UsnRecord Pointer to the record describing the file.
+
+ @return TRUE to indicate the record was added or was safely ignored, FALSE
+         to indicate the volume cannot be enumerated this way.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumAddRecord(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in PUSN_RECORD UsnRecord
+    )
+{
+    PYORILIB_VOLENUM_ENTRY Entry;
+    DWORDLONG Index;
+    DWORD NameLength;
+
+    //
+    //  The names of each entry are located by looking up parents by index,
+    //  which requires records to arrive in master file table order.
+    //
+
+    Index = UsnRecord->FileReferenceNumber & YORILIB_VOLENUM_INDEX_MASK;
+    if (VolContext->EntryCount > 0 &&
+        (VolContext->Entries[VolContext->EntryCount - 1].FileReferenceNumber & YORILIB_VOLENUM_INDEX_MASK) >= Index) {
+
+        return FALSE;
+    }
+
+    if (Index < YORILIB_VOLENUM_RESERVED_RECORDS ||
+        UsnRecord->FileReferenceNumber == VolContext->RootFileReferenceNumber) {
+
+        return TRUE;
+    }
+
+    NameLength = UsnRecord->FileNameLength / sizeof(WCHAR);
+    if (NameLength == 0 || NameLength >= MAX_PATH) {
+        return TRUE;
+    }
+
+    if (VolContext->EntryCount >= VolContext->EntriesAllocated) {
+        PYORILIB_VOLENUM_ENTRY NewEntries;
+        DWORD NewAllocated;
+
+        NewAllocated = VolContext->EntriesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 0x4000;
+        }
+
+        if (NewAllocated <= VolContext->EntriesAllocated ||
+            NewAllocated > YORI_MAX_ALLOC_SIZE / sizeof(YORILIB_VOLENUM_ENTRY)) {
+            return FALSE;
+        }
+
+        NewEntries = YoriLibMalloc((YORI_ALLOC_SIZE_T)(NewAllocated * sizeof(YORILIB_VOLENUM_ENTRY)));
+        if (NewEntries == NULL) {
+            return FALSE;
+        }
+
+        if (VolContext->Entries != NULL) {
+            memcpy(NewEntries, VolContext->Entries, VolContext->EntryCount * sizeof(YORILIB_VOLENUM_ENTRY));
+            YoriLibFree(VolContext->Entries);
+        }
+        VolContext->Entries = NewEntries;
+        VolContext->EntriesAllocated = NewAllocated;
+    }
+
+    if (VolContext->Names.LengthInChars + NameLength > VolContext->Names.LengthAllocated) {
+        YORI_ALLOC_SIZE_T NewLength;
+
+        NewLength = VolContext->Names.LengthAllocated * 2;
+        if (NewLength < VolContext->Names.LengthAllocated + NameLength) {
+            NewLength = VolContext->Names.LengthAllocated + NameLength + 0x10000;
+        }
+
+        if (NewLength <= VolContext->Names.LengthAllocated ||
+            NewLength > YORI_MAX_ALLOC_SIZE / sizeof(TCHAR)) {
+            return FALSE;
+        }
+
+        if (!YoriLibReallocateString(&VolContext->Names, NewLength)) {
+            return FALSE;
+        }
+    }
+
+    Entry = &VolContext->Entries[VolContext->EntryCount];
+    Entry->FileReferenceNumber = UsnRecord->FileReferenceNumber;
+    Entry->ParentFileReferenceNumber = UsnRecord->ParentFileReferenceNumber;
+    Entry->FileAttributes = UsnRecord->FileAttributes;
+    Entry->NameOffset = VolContext->Names.LengthInChars;
+    Entry->NameLength = (WORD)NameLength;
+    Entry->FirstChild = YORILIB_VOLENUM_NO_ENTRY;
+    Entry->NextSibling = YORILIB_VOLENUM_NO_ENTRY;
+
+    memcpy(&VolContext->Names.StartOfString[VolContext->Names.LengthInChars],
+           (PUCHAR)UsnRecord + UsnRecord->FileNameOffset,
+           NameLength * sizeof(WCHAR));
+    VolContext->Names.LengthInChars = VolContext->Names.LengthInChars + NameLength;
+    VolContext->EntryCount++;
+
+    return TRUE;
+}
+
+/**
+ Read the names and parent directories of every file on the volume from the
+ master file table.
+
+ @param VolContext Pointer to the volume enumerate context.
+
+ @return TRUE to indicate success, FALSE to indicate the volume cannot be
+         enumerated this way.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumReadVolume(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext
+    )
+{
+    YORILIB_VOLENUM_MFT_ENUM_DATA EnumData;
+    PUCHAR Buffer;
+    PUSN_RECORD UsnRecord;
+    DWORD BytesReturned;
+    DWORD Offset;
+
+    Buffer = YoriLibMalloc(YORILIB_VOLENUM_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    EnumData.StartFileReferenceNumber = 0;
+    EnumData.LowUsn = 0;
+    EnumData.HighUsn = (LONGLONG)(((DWORDLONG)-1) >> 1);
+
+    while (TRUE) {
+        if (!DeviceIoControl(VolContext->hVolume, FSCTL_ENUM_USN_DATA, &EnumData, sizeof(EnumData), Buffer, YORILIB_VOLENUM_BUFFER_SIZE, &BytesReturned, NULL)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            YoriLibFree(Buffer);
+            return FALSE;
+        }
+
+        if (BytesReturned < sizeof(DWORDLONG)) {
+            break;
+        }
+
+        //
+        //  The output starts with the file reference number to resume
+        //  from, followed by a set of records.
+        //
+
+        Offset = sizeof(DWORDLONG);
+        while (Offset + FIELD_OFFSET(USN_RECORD, FileName) <= BytesReturned) {
+            UsnRecord = (PUSN_RECORD)(Buffer + Offset);
+            if (UsnRecord->RecordLength < FIELD_OFFSET(USN_RECORD, FileName) ||
+                Offset + UsnRecord->RecordLength > BytesReturned ||
+                UsnRecord->MajorVersion != 2 ||
+                (DWORD)UsnRecord->FileNameOffset + UsnRecord->FileNameLength > UsnRecord->RecordLength) {
+
+                YoriLibFree(Buffer);
+                return FALSE;
+            }
+
+            if (!YoriLibVolEnumAddRecord(VolContext, UsnRecord)) {
+                YoriLibFree(Buffer);
+                return FALSE;
+            }
+
+            Offset = Offset + UsnRecord->RecordLength;
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            YoriLibFree(Buffer);
+            return FALSE;
+        }
+
+        EnumData.StartFileReferenceNumber = *(PDWORDLONG)Buffer;
+    }
+
+    YoriLibFree(Buffer);
+    return TRUE;
+}
+
+/**
+ Find the entry describing a file from its file reference number.
+
+ @param VolContext Pointer to the volume enumerate context.
+
+ @param FileReferenceNumber The file reference number to find.
+
+ @return The index of the entry, or YORILIB_VOLENUM_NO_ENTRY if no entry
+         describes the file.
+ */
+DWORD
+YoriLibVolEnumFindEntry(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in DWORDLONG FileReferenceNumber
+    )
+{
+    DWORDLONG Index;
+    DWORDLONG EntryIndex;
+    DWORD Start;
+    DWORD End;
+    DWORD Middle;
+
+    Index = FileReferenceNumber & YORILIB_VOLENUM_INDEX_MASK;
+    Start = 0;
+    End = VolContext->EntryCount;
+
+    while (Start < End) {
+        Middle = Start + (End - Start) / 2;
+        EntryIndex = VolContext->Entries[Middle].FileReferenceNumber & YORILIB_VOLENUM_INDEX_MASK;
+        if (EntryIndex == Index) {
+
+            //
+            //  If the sequence number differs, the parent was deleted and
+            //  the record reused, so this is not the parent.
+            //
+
+            if (VolContext->Entries[Middle].FileReferenceNumber != FileReferenceNumber) {
+                return YORILIB_VOLENUM_NO_ENTRY;
+            }
+            return Middle;
+        } else if (EntryIndex < Index) {
+            Start = Middle + 1;
+        } else {
+            End = Middle;
+        }
+    }
+
+    return YORILIB_VOLENUM_NO_ENTRY;
+}
+
+/**
+ Link every entry into the list of entries belonging to its parent
+ directory.  Entries are processed in reverse so that each list is in master
+ file table order.  Entries whose parent cannot be found are not reachable
+ from the root and are never reported.
+
+ @param VolContext Pointer to the volume enumerate context.
+ */
+VOID
+YoriLibVolEnumLinkEntries(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext
+    )
+{
+    PYORILIB_VOLENUM_ENTRY Entry;
+    DWORD Index;
+    DWORD Parent;
+
+    VolContext->RootFirstChild = YORILIB_VOLENUM_NO_ENTRY;
+
+    for (Index = VolContext->EntryCount; Index > 0; Index--) {
+        Entry = &VolContext->Entries[Index - 1];
+        if (Entry->ParentFileReferenceNumber == VolContext->RootFileReferenceNumber) {
+            Entry->NextSibling = VolContext->RootFirstChild;
+            VolContext->RootFirstChild = Index - 1;
+        } else {
+            Parent = YoriLibVolEnumFindEntry(VolContext, Entry->ParentFileReferenceNumber);
+            if (Parent != YORILIB_VOLENUM_NO_ENTRY &&
+                Parent != Index - 1 &&
+                (VolContext->Entries[Parent].FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+
+                Entry->NextSibling = VolContext->Entries[Parent].FirstChild;
+                VolContext->Entries[Parent].FirstChild = Index - 1;
+            }
+        }
+    }
+}
+
+/**
+ Populate the times, size and reparse tag of an entry from its file record.
+
+ @param VolContext Pointer to the volume enumerate context.  On successful
+        completion, the FindData member is updated.
+
+ @param Entry Pointer to the entry to query.
+
+ @return TRUE to indicate the information was found, FALSE if it could not
+         be determined from the base file record.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumReadFileRecord(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in PYORILIB_VOLENUM_ENTRY Entry
+    )
+{
+    NTFS_FILE_RECORD_INPUT_BUFFER Input;
+    PYORILIB_VOLENUM_FILE_RECORD Record;
+    PYORILIB_VOLENUM_ATTRIBUTE Attribute;
+    PYORILIB_VOLENUM_STANDARD_INFO StandardInfo;
+    DWORD BytesReturned;
+    DWORD RecordLength;
+    DWORD Offset;
+    BOOLEAN FoundStandardInfo;
+    BOOLEAN FoundData;
+    BOOLEAN FoundReparse;
+    LARGE_INTEGER FileSize;
+
+    Input.FileReferenceNumber.QuadPart = (LONGLONG)(Entry->FileReferenceNumber & YORILIB_VOLENUM_INDEX_MASK);
+    if (!DeviceIoControl(VolContext->hVolume, FSCTL_GET_NTFS_FILE_RECORD, &Input, sizeof(Input), VolContext->RecordOutput, VolContext->RecordOutputLength, &BytesReturned, NULL)) {
+        return FALSE;
+    }
+
+    //
+    //  If the record is not in use, the file system returns the next lower
+    //  record, so check this is the record that was requested.
+    //
+
+    if (BytesReturned < FIELD_OFFSET(NTFS_FILE_RECORD_OUTPUT_BUFFER, FileRecordBuffer) ||
+        ((DWORDLONG)VolContext->RecordOutput->FileReferenceNumber.QuadPart & YORILIB_VOLENUM_INDEX_MASK) != Input.FileReferenceNumber.QuadPart) {
+        return FALSE;
+    }
+
+    RecordLength = VolContext->RecordOutput->FileRecordLength;
+    if (RecordLength > VolContext->BytesPerFileRecord ||
+        RecordLength > BytesReturned - FIELD_OFFSET(NTFS_FILE_RECORD_OUTPUT_BUFFER, FileRecordBuffer) ||
+        RecordLength < sizeof(YORILIB_VOLENUM_FILE_RECORD)) {
+        return FALSE;
+    }
+
+    Record = VolContext->Record;
+    memcpy(Record, VolContext->RecordOutput->FileRecordBuffer, RecordLength);
+
+    if (Record->Signature != YORILIB_VOLENUM_FILE_SIGNATURE ||
+        (Record->Flags & YORILIB_VOLENUM_RECORD_IN_USE) == 0 ||
+        Record->SequenceNumber != (WORD)(Entry->FileReferenceNumber >> 48)) {
+        return FALSE;
+    }
+
+    if (Record->BytesInUse < RecordLength) {
+        RecordLength = Record->BytesInUse;
+    }
+
+    FoundStandardInfo = FALSE;
+    FoundData = FALSE;
+    FoundReparse = FALSE;
+    FileSize.QuadPart = 0;
+    VolContext->FindData.dwReserved0 = 0;
+
+    Offset = Record->FirstAttributeOffset;
+    while (Offset + 2 * sizeof(DWORD) <= RecordLength) {
+        Attribute = (PYORILIB_VOLENUM_ATTRIBUTE)((PUCHAR)Record + Offset);
+        if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_END) {
+            break;
+        }
+
+        if (Attribute->RecordLength < FIELD_OFFSET(YORILIB_VOLENUM_ATTRIBUTE, Form) ||
+            Offset + Attribute->RecordLength > RecordLength) {
+            return FALSE;
+        }
+
+        //
+        //  If the attributes don't fit in one record, the ones needed may be
+        //  in another record, so let the caller ask the file system.
+        //
+
+        if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_ATTRIBUTE_LIST) {
+            return FALSE;
+        }
+
+        if (Attribute->FormCode == 0) {
+            if (Attribute->RecordLength < FIELD_OFFSET(YORILIB_VOLENUM_ATTRIBUTE, Form.Resident.ResidentFlags) ||
+                (DWORD)Attribute->Form.Resident.ValueOffset + Attribute->Form.Resident.ValueLength > Attribute->RecordLength) {
+                return FALSE;
+            }
+
+            if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_STANDARD_INFO &&
+                Attribute->Form.Resident.ValueLength >= FIELD_OFFSET(YORILIB_VOLENUM_STANDARD_INFO, FileAttributes)) {
+
+                StandardInfo = (PYORILIB_VOLENUM_STANDARD_INFO)((PUCHAR)Attribute + Attribute->Form.Resident.ValueOffset);
+                VolContext->FindData.ftCreationTime.dwLowDateTime = StandardInfo->CreationTime.LowPart;
+                VolContext->FindData.ftCreationTime.dwHighDateTime = StandardInfo->CreationTime.HighPart;
+                VolContext->FindData.ftLastWriteTime.dwLowDateTime = StandardInfo->LastModificationTime.LowPart;
+                VolContext->FindData.ftLastWriteTime.dwHighDateTime = StandardInfo->LastModificationTime.HighPart;
+                VolContext->FindData.ftLastAccessTime.dwLowDateTime = StandardInfo->LastAccessTime.LowPart;
+                VolContext->FindData.ftLastAccessTime.dwHighDateTime = StandardInfo->LastAccessTime.HighPart;
+                FoundStandardInfo = TRUE;
+            } else if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_DATA &&
+                       Attribute->NameLength == 0) {
+
+                FileSize.QuadPart = Attribute->Form.Resident.ValueLength;
+                FoundData = TRUE;
+            } else if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_REPARSE_POINT &&
+                       Attribute->Form.Resident.ValueLength >= sizeof(DWORD)) {
+
+                VolContext->FindData.dwReserved0 = *(PDWORD)((PUCHAR)Attribute + Attribute->Form.Resident.ValueOffset);
+                FoundReparse = TRUE;
+            }
+        } else {
+            if (Attribute->RecordLength < FIELD_OFFSET(YORILIB_VOLENUM_ATTRIBUTE, Form.Nonresident.ValidDataLength)) {
+                return FALSE;
+            }
+
+            if (Attribute->TypeCode == YORILIB_VOLENUM_ATTR_DATA &&
+                Attribute->NameLength == 0 &&
+                Attribute->Form.Nonresident.LowestVcn == 0) {
+
+                FileSize.QuadPart = Attribute->Form.Nonresident.FileSize;
+                FoundData = TRUE;
+            }
+        }
+
+        Offset = Offset + Attribute->RecordLength;
+    }
+
+    if (!FoundStandardInfo) {
+        return FALSE;
+    }
+
+    if ((Entry->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && !FoundData) {
+        return FALSE;
+    }
+
+    if ((Entry->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0 && !FoundReparse) {
+        return FALSE;
+    }
+
+    VolContext->FindData.nFileSizeHigh = FileSize.HighPart;
+    VolContext->FindData.nFileSizeLow = FileSize.LowPart;
+    return TRUE;
+}
+
+/**
+ Report a single entry to the caller's callback.
+
+ @param VolContext Pointer to the volume enumerate context.  The Path member
+        contains the full path to the entry.
+
+ @param Entry Pointer to the entry to report.
+
+ @param Depth The recursion depth to report.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumReportEntry(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in PYORILIB_VOLENUM_ENTRY Entry,
+    __in DWORD Depth
+    )
+{
+    ZeroMemory(&VolContext->FindData, sizeof(VolContext->FindData));
+    VolContext->FindData.dwFileAttributes = Entry->FileAttributes;
+    memcpy(VolContext->FindData.cFileName,
+           &VolContext->Names.StartOfString[Entry->NameOffset],
+           Entry->NameLength * sizeof(TCHAR));
+    VolContext->FindData.cFileName[Entry->NameLength] = '\0';
+
+    //
+    //  If the base file record doesn't describe the file, ask the file
+    //  system.  If that fails too, the object is still reported with the
+    //  information the master file table enumerate provided, as a
+    //  directory enumerate would have found it.
+    //
+
+    if (!YoriLibVolEnumReadFileRecord(VolContext, Entry)) {
+        YoriLibUpdateFindDataFromFileInformation(&VolContext->FindData, VolContext->Path.StartOfString, FALSE);
+    }
+
+    if (!VolContext->Callback(&VolContext->Path, &VolContext->FindData, Depth, VolContext->Context)) {
+        return FALSE;
+    }
+
+    if (YoriLibIsOperationCancelled()) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Report the contents of a directory, and recursively its subdirectories,
+ in the same order as a directory enumerate would.
+
+ @param VolContext Pointer to the volume enumerate context.  The Path member
+        contains the full path to the directory including a trailing
+        separator.
+
+ @param FirstChild The index of the first entry within the directory.
+
+ @param Depth The recursion depth to report for objects in this directory.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumWalkDirectory(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in DWORD FirstChild,
+    __in DWORD Depth
+    )
+{
+    PYORILIB_VOLENUM_ENTRY Entry;
+    YORI_ALLOC_SIZE_T ParentLength;
+    DWORD Index;
+    DWORD Phase;
+    DWORD NumberPhases;
+    DWORD RecursePhaseIndex;
+    BOOLEAN ReportObject;
+
+    //
+    //  Mirror the phases of a directory enumerate: recursing before
+    //  returning unless the caller only asked to recurse after returning.
+    //
+
+    NumberPhases = 2;
+    RecursePhaseIndex = 0;
+    if ((VolContext->MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) == YORILIB_FILEENUM_RECURSE_AFTER_RETURN) {
+        RecursePhaseIndex = 1;
+    }
+
+    ParentLength = VolContext->Path.LengthInChars;
+
+    for (Phase = 0; Phase < NumberPhases; Phase++) {
+        Index = FirstChild;
+        while (Index != YORILIB_VOLENUM_NO_ENTRY) {
+            Entry = &VolContext->Entries[Index];
+            Index = Entry->NextSibling;
+
+            //
+            //  Leave space for a trailing separator and terminator.
+            //
+
+            if (ParentLength + Entry->NameLength + 2 > VolContext->Path.LengthAllocated) {
+                if (Phase == RecursePhaseIndex && VolContext->ErrorCallback != NULL) {
+                    VolContext->Path.StartOfString[ParentLength] = '\0';
+                    if (!VolContext->ErrorCallback(&VolContext->Path, ERROR_FILENAME_EXCED_RANGE, Depth, VolContext->Context)) {
+                        return FALSE;
+                    }
+                }
+                continue;
+            }
+
+            memcpy(&VolContext->Path.StartOfString[ParentLength],
+                   &VolContext->Names.StartOfString[Entry->NameOffset],
+                   Entry->NameLength * sizeof(TCHAR));
+            VolContext->Path.LengthInChars = ParentLength + Entry->NameLength;
+            VolContext->Path.StartOfString[VolContext->Path.LengthInChars] = '\0';
+
+            if (Phase == RecursePhaseIndex) {
+                if ((Entry->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                    VolContext->Path.StartOfString[VolContext->Path.LengthInChars] = '\\';
+                    VolContext->Path.LengthInChars++;
+                    VolContext->Path.StartOfString[VolContext->Path.LengthInChars] = '\0';
+                    if (!YoriLibVolEnumWalkDirectory(VolContext, Entry->FirstChild, Depth + 1)) {
+                        return FALSE;
+                    }
+                }
+            } else {
+                if ((Entry->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                    ReportObject = (BOOLEAN)((VolContext->MatchFlags & YORILIB_FILEENUM_RETURN_DIRECTORIES) != 0);
+                } else {
+                    ReportObject = (BOOLEAN)((VolContext->MatchFlags & YORILIB_FILEENUM_RETURN_FILES) != 0);
+                }
+
+                if (ReportObject &&
+                    !YoriLibVolEnumReportEntry(VolContext, Entry, Depth)) {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    VolContext->Path.LengthInChars = ParentLength;
+    VolContext->Path.StartOfString[ParentLength] = '\0';
+    return TRUE;
+}
+
+/**
+ Open the volume and prepare to enumerate it from its master file table.
+
+ @param VolContext Pointer to the volume enumerate context.
+
+ @param DriveLetter The drive letter of the volume.
+
+ @return TRUE to indicate the volume can be enumerated this way, FALSE if
+         it cannot.
+ */
+__success(return)
+BOOLEAN
+YoriLibVolEnumOpenVolume(
+    __in PYORILIB_VOLENUM_CONTEXT VolContext,
+    __in TCHAR DriveLetter
+    )
+{
+    NTFS_VOLUME_DATA_BUFFER VolumeData;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    TCHAR VolumePath[sizeof("\\\\.\\X:")];
+    HANDLE hRoot;
+    DWORD BytesReturned;
+
+    YoriLibSPrintfS(VolumePath, sizeof(VolumePath)/sizeof(VolumePath[0]), _T("\\\\.\\%c:"), DriveLetter);
+
+    VolContext->hVolume = CreateFile(VolumePath,
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                                     NULL,
+                                     OPEN_EXISTING,
+                                     0,
+                                     NULL);
+
+    if (VolContext->hVolume == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    //
+    //  This only succeeds on NTFS, which is the only file system whose
+    //  records are interpreted here.
+    //
+
+    if (!DeviceIoControl(VolContext->hVolume, FSCTL_GET_NTFS_VOLUME_DATA, NULL, 0, &VolumeData, sizeof(VolumeData), &BytesReturned, NULL)) {
+        return FALSE;
+    }
+
+    if (VolumeData.BytesPerFileRecordSegment < sizeof(YORILIB_VOLENUM_FILE_RECORD) ||
+        VolumeData.BytesPerFileRecordSegment > YORILIB_VOLENUM_BUFFER_SIZE) {
+        return FALSE;
+    }
+
+    VolContext->BytesPerFileRecord = VolumeData.BytesPerFileRecordSegment;
+    VolContext->RecordOutputLength = FIELD_OFFSET(NTFS_FILE_RECORD_OUTPUT_BUFFER, FileRecordBuffer) + VolContext->BytesPerFileRecord;
+    VolContext->RecordOutput = YoriLibMalloc(VolContext->RecordOutputLength);
+    if (VolContext->RecordOutput == NULL) {
+        return FALSE;
+    }
+
+    VolContext->Record = YoriLibMalloc(VolContext->BytesPerFileRecord);
+    if (VolContext->Record == NULL) {
+        return FALSE;
+    }
+
+    hRoot = CreateFile(VolContext->Path.StartOfString,
+                       FILE_READ_ATTRIBUTES,
+                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_BACKUP_SEMANTICS,
+                       NULL);
+
+    if (hRoot == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (!GetFileInformationByHandle(hRoot, &FileInfo)) {
+        CloseHandle(hRoot);
+        return FALSE;
+    }
+    CloseHandle(hRoot);
+
+    VolContext->RootFileReferenceNumber = ((DWORDLONG)FileInfo.nFileIndexHigh << 32) | FileInfo.nFileIndexLow;
+    return TRUE;
+}
+
+/**
+ Attempt to enumerate the recursive contents of an NTFS volume root by
+ reading every name from the master file table in a single pass, rather
+ than enumerating each directory.  This only handles requests that can be
+ answered exactly the way a directory enumerate would, and only when the
+ volume can be opened, which typically requires elevation.  Objects are
+ reported in the same phase order as a directory enumerate, although
+ objects within a directory are ordered by file record rather than name,
+ and a file with multiple hard links is reported under one of its names.
+
+ @param FileSpec The user provided file specification to enumerate matches
+        on.
+
+ @param MatchFlags Specifies the behavior of the match, including whether
+        it should be applied recursively and the recursing behavior.
+
+ @param Depth Indicates the current recursion depth.
+
+ @param Callback The callback to invoke on each match.
+
+ @param ErrorCallback Optionally points to a function to invoke if an
+        object cannot be reported.
+
+ @param Context Caller provided context to pass to the callback.
+
+ @param Result On successful completion, updated to indicate the result of
+        the enumerate, as would be returned from YoriLibForEachFile.
+
+ @return TRUE to indicate the request was handled and Result is valid, FALSE
+         to indicate the caller should enumerate the request another way.
+ */
+BOOLEAN
+YoriLibForEachFileOnVolume(
+    __in PYORI_STRING FileSpec,
+    __in WORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context,
+    __out PBOOL Result
+    )
+{
+    YORILIB_VOLENUM_CONTEXT VolContext;
+    YORI_STRING FullPath;
+    BOOLEAN ReportRoot;
+    BOOLEAN Success;
+    DWORD ContentsDepth;
+
+    //
+    //  Entries for mount points and links have no children in the master
+    //  file table, so this can only match a directory enumerate that
+    //  doesn't traverse links.
+    //
+
+    if ((MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) == 0 ||
+        (MatchFlags & YORILIB_FILEENUM_NO_LINK_TRAVERSE) == 0 ||
+        (MatchFlags & YORILIB_FILEENUM_INCLUDE_DOTFILES) != 0) {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FullPath);
+    if (!YoriLibGetFullPathNameReturnAllocation(FileSpec, TRUE, &FullPath, NULL)) {
+        return FALSE;
+    }
+
+    //
+    //  Accept X:\* which reports the volume contents, or X:\ which reports
+    //  the root and its contents unless the caller asked for directory
+    //  contents.
+    //
+
+    ReportRoot = FALSE;
+    ContentsDepth = Depth;
+    if (FullPath.LengthInChars == sizeof("\\\\?\\X:\\*") - 1 &&
+        FullPath.StartOfString[FullPath.LengthInChars - 1] == '*') {
+
+        FullPath.LengthInChars--;
+        FullPath.StartOfString[FullPath.LengthInChars] = '\0';
+    } else if (FullPath.LengthInChars == sizeof("\\\\?\\X:\\") - 1 &&
+               (MatchFlags & YORILIB_FILEENUM_DIRECTORY_CONTENTS) == 0) {
+
+        ReportRoot = TRUE;
+        ContentsDepth = Depth + 1;
+    }
+
+    if (FullPath.LengthInChars != sizeof("\\\\?\\X:\\") - 1 ||
+        !YoriLibIsPrefixedDriveLetterWithColonAndSlash(&FullPath)) {
+
+        YoriLibFreeStringContents(&FullPath);
+        return FALSE;
+    }
+
+    ZeroMemory(&VolContext, sizeof(VolContext));
+    VolContext.hVolume = INVALID_HANDLE_VALUE;
+    VolContext.MatchFlags = MatchFlags;
+    VolContext.Callback = Callback;
+    VolContext.ErrorCallback = ErrorCallback;
+    VolContext.Context = Context;
+    YoriLibInitEmptyString(&VolContext.Names);
+    YoriLibInitEmptyString(&VolContext.Path);
+
+    if (!YoriLibAllocateString(&VolContext.Path, YORILIB_VOLENUM_MAX_PATH + 1)) {
+        YoriLibFreeStringContents(&FullPath);
+        return FALSE;
+    }
+
+    memcpy(VolContext.Path.StartOfString, FullPath.StartOfString, FullPath.LengthInChars * sizeof(TCHAR));
+    VolContext.Path.LengthInChars = FullPath.LengthInChars;
+    VolContext.Path.StartOfString[VolContext.Path.LengthInChars] = '\0';
+
+    if (!YoriLibVolEnumOpenVolume(&VolContext, FullPath.StartOfString[4]) ||
+        !YoriLibVolEnumReadVolume(&VolContext)) {
+
+        YoriLibVolEnumCleanup(&VolContext);
+        YoriLibFreeStringContents(&FullPath);
+
+        //
+        //  If the user cancelled while reading the volume, don't start
+        //  again with a directory enumerate.
+        //
+
+        if (YoriLibIsOperationCancelled()) {
+            *Result = FALSE;
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    YoriLibVolEnumLinkEntries(&VolContext);
+
+    Success = TRUE;
+    if (ReportRoot &&
+        (MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) == YORILIB_FILEENUM_RECURSE_AFTER_RETURN) {
+
+        ZeroMemory(&VolContext.FindData, sizeof(VolContext.FindData));
+        if ((MatchFlags & YORILIB_FILEENUM_RETURN_DIRECTORIES) != 0 &&
+            YoriLibUpdateFindDataFromFileInformation(&VolContext.FindData, FullPath.StartOfString, FALSE)) {
+
+            Success = (BOOLEAN)Callback(&FullPath, &VolContext.FindData, Depth, Context);
+        }
+        ReportRoot = FALSE;
+    }
+
+    if (Success) {
+        Success = YoriLibVolEnumWalkDirectory(&VolContext, VolContext.RootFirstChild, ContentsDepth);
+    }
+
+    if (Success && ReportRoot) {
+        ZeroMemory(&VolContext.FindData, sizeof(VolContext.FindData));
+        if ((MatchFlags & YORILIB_FILEENUM_RETURN_DIRECTORIES) != 0 &&
+            YoriLibUpdateFindDataFromFileInformation(&VolContext.FindData, FullPath.StartOfString, FALSE)) {
+
+            Success = (BOOLEAN)Callback(&FullPath, &VolContext.FindData, Depth, Context);
+        }
+    }
+
+    YoriLibVolEnumCleanup(&VolContext);
+    YoriLibFreeStringContents(&FullPath);
+
+    *Result = Success;
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
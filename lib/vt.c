@@ -62,6 +62,57 @@ BOOLEAN YoriLibVtResetColorSet;
  */
 LPTSTR YoriLibVtLineEnding = _T("\r\n");
 
+/**
+ The maximum number of characters to hold in the output buffer before
+ writing them to the output device.
+ */
+#define YORI_LIB_OUTPUT_BUFFER_MAX_CHARS (16 * 1024)
+
+/**
+ The maximum number of lines to hold in the output buffer before writing
+ them to the output device.  This ensures output remains responsive when
+ displayed interactively.
+ */
+#define YORI_LIB_OUTPUT_BUFFER_MAX_LINES (64)
+
+/**
+ Output which has been generated by the process but not yet written to the
+ output device.  Buffering output allows many small writes, including their
+ escape sequences, to be processed as a single stream, which is largely
+ bound by the number of calls made to the output device.  Note this is not
+ synchronized, so output buffering should only be used by processes that
+ generate output from a single thread.
+ */
+typedef struct _YORI_LIB_OUTPUT_BUFFER {
+
+    /**
+     The handle whose output is being buffered, or NULL if output is not
+     being buffered.
+     */
+    HANDLE hOutput;
+
+    /**
+     The flags describing how to process VT sequences in the buffered text.
+     */
+    DWORD Flags;
+
+    /**
+     The number of lines of text in the buffer.
+     */
+    DWORD LineCount;
+
+    /**
+     The buffered text, which has not yet been processed for VT sequences.
+     */
+    YORI_STRING Text;
+} YORI_LIB_OUTPUT_BUFFER, *PYORI_LIB_OUTPUT_BUFFER;
+
+/**
+ Output which has been generated by the process but not yet written to the
+ output device.
+ */
+YORI_LIB_OUTPUT_BUFFER YoriLibOutputBuffer;
+
 /**
  Set the default color for the process.  The default color is the one that
  will be used when a reset command is issued to the terminal.  For most
@@ -171,6 +222,9 @@ YoriLibOutputTextToMultibyteDevice(
                                    AnsiBytesNeeded);
 
             Result = WriteFile(hOutput, AnsiBuf, AnsiBytesNeeded, &BytesTransferred, NULL);
+            if (Result && YoriLibStats.Enabled) {
+                YoriLibStatisticsRecordWrite(BytesTransferred);
+            }
 
             if (AnsiBuf != AnsiStackBuf) {
                 YoriLibFree(AnsiBuf);
@@ -185,6 +239,9 @@ YoriLibOutputTextToMultibyteDevice(
                        String->LengthInChars*sizeof(TCHAR),
                        &BytesTransferred,
                        NULL);
+    if (Result && YoriLibStats.Enabled) {
+        YoriLibStatisticsRecordWrite(BytesTransferred);
+    }
 #endif
     return Result;
 }
@@ -335,11 +392,15 @@ YoriLibConsoleProcessAndOutputText(
     DWORD BytesTransferred;
     UNREFERENCED_PARAMETER(Context);
 
-    WriteConsole(hOutput,
-                 String->StartOfString,
-                 String->LengthInChars,
-                 &BytesTransferred,
-                 NULL);
+    if (WriteConsole(hOutput,
+                     String->StartOfString,
+                     String->LengthInChars,
+                     &BytesTransferred,
+                     NULL) &&
+        YoriLibStats.Enabled) {
+
+        YoriLibStatisticsRecordWrite(BytesTransferred * sizeof(TCHAR));
+    }
     return TRUE;
 }
 
@@ -617,7 +678,15 @@ YoriLibConsoleProcessAndOutputEscape(
     }
 
     if (YoriLibVtFinalColorFromSequence(NewColor, String, &NewColor)) {
-        SetConsoleTextAttribute(hOutput, NewColor);
+
+        //
+        //  If the color is already known to be active, there's no need to
+        //  tell the console about it again.
+        //
+
+        if (NeedExistingColor || NewColor != LOWORD(PreviousAttributes)) {
+            SetConsoleTextAttribute(hOutput, NewColor);
+        }
         *Context = ((1 << 16) | NewColor);
     }
     return TRUE;
@@ -1141,6 +1210,200 @@ YoriLibProcessVtEscapesOnNewStream(
     return Result;
 }
 
+/**
+ Initialize callback functions to the set that is appropriate for the
+ specified output device and flags.
+
+ @param hOut The output stream that the callback functions will write to.
+
+ @param Flags Flags, indicating behavior.
+
+ @param Callbacks On completion, populated with the callback functions.
+ */
+VOID
+YoriLibOutputSelectFunctions(
+    __in HANDLE hOut,
+    __in DWORD Flags,
+    __out PYORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks
+    )
+{
+    DWORD CurrentMode;
+
+    //
+    //  Check if we're writing to a console supporting color or a file
+    //  that doesn't
+    //
+
+    if (hOut == YORI_LIB_DEBUGGER_HANDLE) {
+        YoriLibDebuggerSetFunctions(Callbacks);
+    } else if (GetConsoleMode(hOut, &CurrentMode)) {
+        if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
+            YoriLibConsoleNoEscapeSetFunctions(Callbacks);
+        } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
+            YoriLibConsoleIncludeEscapeSetFunctions(Callbacks);
+        } else {
+            YoriLibConsoleSetFunctions(Callbacks);
+        }
+    } else if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
+        YoriLibUtf8TextNoEscapesSetFunctions(Callbacks);
+    } else {
+        YoriLibUtf8TextWithEscapesSetFunctions(Callbacks);
+    }
+}
+
+/**
+ Write any buffered output to the output device.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibFlushOutputBuffer(VOID)
+{
+    YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
+    BOOL Result;
+
+    if (YoriLibOutputBuffer.Text.LengthInChars == 0) {
+        return TRUE;
+    }
+
+    YoriLibOutputSelectFunctions(YoriLibOutputBuffer.hOutput, YoriLibOutputBuffer.Flags, &Callbacks);
+    Result = YoriLibProcessVtEscapesOnNewStream(YoriLibOutputBuffer.Text.StartOfString,
+                                                YoriLibOutputBuffer.Text.LengthInChars,
+                                                YoriLibOutputBuffer.hOutput,
+                                                &Callbacks);
+
+    YoriLibOutputBuffer.Text.LengthInChars = 0;
+    YoriLibOutputBuffer.LineCount = 0;
+    return Result;
+}
+
+/**
+ Start buffering output to a standard output stream.  While output is
+ buffered, text sent to the stream is held and written in large pieces.
+ The buffer is written when it becomes full, when output is sent to a
+ different stream, when @ref YoriLibFlushOutputBuffer is called, or when
+ @ref YoriLibDisableOutputBuffering is called.  Applications are
+ expected to call @ref YoriLibDisableOutputBuffering before returning.
+
+ @param Flags Flags, indicating the output stream to buffer.
+
+ @return TRUE to indicate output is being buffered, FALSE if it is not.
+ */
+BOOL
+YoriLibEnableOutputBuffering(
+    __in DWORD Flags
+    )
+{
+    HANDLE hOut;
+
+    if ((Flags & YORI_LIB_OUTPUT_DEBUG) != 0) {
+        return FALSE;
+    }
+
+    if ((Flags & YORI_LIB_OUTPUT_STDERR) != 0) {
+        hOut = GetStdHandle(STD_ERROR_HANDLE);
+    } else {
+        hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    }
+
+    if (hOut == NULL || hOut == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (YoriLibOutputBuffer.hOutput != NULL) {
+        YoriLibFlushOutputBuffer();
+    }
+
+    if (YoriLibOutputBuffer.Text.LengthAllocated == 0) {
+        if (!YoriLibAllocateString(&YoriLibOutputBuffer.Text, YORI_LIB_OUTPUT_BUFFER_MAX_CHARS)) {
+            return FALSE;
+        }
+    }
+
+    YoriLibOutputBuffer.hOutput = hOut;
+    YoriLibOutputBuffer.Flags = 0;
+    YoriLibOutputBuffer.LineCount = 0;
+    return TRUE;
+}
+
+/**
+ Write any buffered output to the output device and stop buffering output.
+ This can be called if output is not being buffered.
+ */
+VOID
+YoriLibDisableOutputBuffering(VOID)
+{
+    if (YoriLibOutputBuffer.hOutput != NULL) {
+        YoriLibFlushOutputBuffer();
+        YoriLibOutputBuffer.hOutput = NULL;
+    }
+    YoriLibFreeStringContents(&YoriLibOutputBuffer.Text);
+}
+
+/**
+ Attempt to add output to the output buffer.  If the output is for a
+ different device, any buffered output is written first so that output
+ appears in the order it was generated.
+
+ @param hOut The output stream that the text is destined for.
+
+ @param Flags Flags, indicating behavior.
+
+ @param String The text to output.
+
+ @return TRUE to indicate the text has been buffered, or FALSE if the caller
+         should write it to the output device.
+ */
+BOOL
+YoriLibAddToOutputBuffer(
+    __in HANDLE hOut,
+    __in DWORD Flags,
+    __in PCYORI_STRING String
+    )
+{
+    DWORD VtFlags;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (YoriLibOutputBuffer.hOutput == NULL) {
+        return FALSE;
+    }
+
+    if (hOut != YoriLibOutputBuffer.hOutput) {
+        YoriLibFlushOutputBuffer();
+        return FALSE;
+    }
+
+    VtFlags = Flags & (YORI_LIB_OUTPUT_STRIP_VT | YORI_LIB_OUTPUT_PASSTHROUGH_VT);
+    if (VtFlags != YoriLibOutputBuffer.Flags) {
+        YoriLibFlushOutputBuffer();
+        YoriLibOutputBuffer.Flags = VtFlags;
+    }
+
+    if (String->LengthInChars > YoriLibOutputBuffer.Text.LengthAllocated - YoriLibOutputBuffer.Text.LengthInChars) {
+        YoriLibFlushOutputBuffer();
+        if (String->LengthInChars > YoriLibOutputBuffer.Text.LengthAllocated) {
+            return FALSE;
+        }
+    }
+
+    memcpy(&YoriLibOutputBuffer.Text.StartOfString[YoriLibOutputBuffer.Text.LengthInChars],
+           String->StartOfString,
+           String->LengthInChars * sizeof(TCHAR));
+    YoriLibOutputBuffer.Text.LengthInChars = YoriLibOutputBuffer.Text.LengthInChars + String->LengthInChars;
+
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        if (String->StartOfString[Index] == '\n') {
+            YoriLibOutputBuffer.LineCount++;
+        }
+    }
+
+    if (YoriLibOutputBuffer.LineCount >= YORI_LIB_OUTPUT_BUFFER_MAX_LINES) {
+        YoriLibFlushOutputBuffer();
+    }
+
+    return TRUE;
+}
+
 /**
  Output a printf-style formatted string to the specified output stream.
 
@@ -1171,34 +1434,13 @@ YoriLibOutputInternal(
     TCHAR stack_buf[64];
     TCHAR * buf;
     YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
-    DWORD CurrentMode;
+    YORI_STRING BufferedString;
     BOOL Result;
 
 #ifdef __WATCOMC__
     savedmarker[0] = marker[0];
 #endif
 
-    //
-    //  Check if we're writing to a console supporting color or a file
-    //  that doesn't
-    //
-
-    if (hOut == YORI_LIB_DEBUGGER_HANDLE) {
-        YoriLibDebuggerSetFunctions(&Callbacks);
-    } else if (GetConsoleMode(hOut, &CurrentMode)) {
-        if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
-            YoriLibConsoleNoEscapeSetFunctions(&Callbacks);
-        } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
-            YoriLibConsoleIncludeEscapeSetFunctions(&Callbacks);
-        } else {
-            YoriLibConsoleSetFunctions(&Callbacks);
-        }
-    } else if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
-        YoriLibUtf8TextNoEscapesSetFunctions(&Callbacks);
-    } else {
-        YoriLibUtf8TextWithEscapesSetFunctions(&Callbacks);
-    }
-
     len = YoriLibVSPrintfSize(szFmt, marker);
 
     if (len>(YORI_SIGNED_ALLOC_SIZE_T)(sizeof(stack_buf)/sizeof(stack_buf[0]))) {
@@ -1214,7 +1456,17 @@ YoriLibOutputInternal(
     len = YoriLibVSPrintf(buf, len, szFmt, marker);
 
     __analysis_assume(hOut != 0);
-    Result = YoriLibProcessVtEscapesOnNewStream(buf, len, hOut, &Callbacks);
+
+    YoriLibInitEmptyString(&BufferedString);
+    BufferedString.StartOfString = buf;
+    BufferedString.LengthInChars = (YORI_ALLOC_SIZE_T)len;
+
+    if (YoriLibAddToOutputBuffer(hOut, Flags, &BufferedString)) {
+        Result = TRUE;
+    } else {
+        YoriLibOutputSelectFunctions(hOut, Flags, &Callbacks);
+        Result = YoriLibProcessVtEscapesOnNewStream(buf, len, hOut, &Callbacks);
+    }
 
     if (buf != stack_buf) {
         YoriLibFree(buf);
@@ -1280,28 +1532,13 @@ YoriLibOutputString(
     )
 {
     YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
-    DWORD CurrentMode;
     BOOL Result;
 
-    //
-    //  Check if we're writing to a console supporting color or a file
-    //  that doesn't
-    //
-
-    if (GetConsoleMode(hOut, &CurrentMode)) {
-        if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
-            YoriLibConsoleNoEscapeSetFunctions(&Callbacks);
-        } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
-            YoriLibConsoleIncludeEscapeSetFunctions(&Callbacks);
-        } else {
-            YoriLibConsoleSetFunctions(&Callbacks);
-        }
-    } else if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
-        YoriLibUtf8TextNoEscapesSetFunctions(&Callbacks);
-    } else {
-        YoriLibUtf8TextWithEscapesSetFunctions(&Callbacks);
+    if (YoriLibAddToOutputBuffer(hOut, Flags, String)) {
+        return TRUE;
     }
 
+    YoriLibOutputSelectFunctions(hOut, Flags, &Callbacks);
     Result = YoriLibProcessVtEscapesOnNewStream(String->StartOfString, String->LengthInChars, hOut, &Callbacks);
 
     return Result;
@@ -1632,6 +1869,7 @@ YoriLibQueryConsoleCapabilities(
     YORI_STRING SubString;
     LPTSTR NextSeperator;
     DWORD Mode;
+    TCHAR TermBuffer[64];
 
     if (GetConsoleMode(OutputHandle, &Mode)) {
         if (SupportsColor != NULL) {
@@ -1673,10 +1911,14 @@ YoriLibQueryConsoleCapabilities(
     }
 
     //
-    //  Load any user specified support from the environment.
+    //  Load any user specified support from the environment.  This is
+    //  called for redirected output, potentially repeatedly, and the value
+    //  is normally short, so try to use a stack buffer.
     //
 
     YoriLibInitEmptyString(&TermString);
+    TermString.StartOfString = TermBuffer;
+    TermString.LengthAllocated = sizeof(TermBuffer)/sizeof(TermBuffer[0]);
     if (!YoriLibAllocateAndGetEnvironmentVariable(_T("YORITERM"), &TermString)) {
         return TRUE;
     }
@@ -0,0 +1,381 @@
+/**
+ * @file lib/workq.c
+ *
+ * Yori bounded work queue processed by a pool of threads
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ Initialize a work queue.  Worker threads are created on demand as items
+ are queued.
+
+ @param WorkQueue Pointer to the work queue to initialize.
+
+ @param MaxThreads The maximum number of worker threads.  If zero, this is
+        the number of processors in the system.
+
+ @param MaxItemsQueued The maximum number of items that can be waiting to be
+        processed before callers are throttled.  If zero, this is twice the
+        number of threads.
+
+ @param Function The function to invoke for each item.
+
+ @param Context Caller provided context to pass to Function.
+
+ @return TRUE to indicate the work queue was initialized, FALSE if it was
+         not.  The caller should call YoriLibCleanupWorkQueue in either
+         case.
+ */
+__success(return)
+BOOL
+YoriLibInitializeWorkQueue(
+    __out PYORILIB_WORK_QUEUE WorkQueue,
+    __in YORI_ALLOC_SIZE_T MaxThreads,
+    __in YORI_ALLOC_SIZE_T MaxItemsQueued,
+    __in PYORILIB_WORK_ITEM_FN Function,
+    __in_opt PVOID Context
+    )
+{
+    ZeroMemory(WorkQueue, sizeof(YORILIB_WORK_QUEUE));
+    YoriLibInitializeListHead(&WorkQueue->PendingList);
+    WorkQueue->Function = Function;
+    WorkQueue->Context = Context;
+
+    if (MaxThreads == 0) {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        MaxThreads = (YORI_ALLOC_SIZE_T)SystemInfo.dwNumberOfProcessors;
+    }
+
+    //
+    //  Threads are waited on together during cleanup, which limits how many
+    //  there can be.
+    //
+
+    if (MaxThreads < 1) {
+        MaxThreads = 1;
+    }
+    if (MaxThreads > MAXIMUM_WAIT_OBJECTS) {
+        MaxThreads = MAXIMUM_WAIT_OBJECTS;
+    }
+    WorkQueue->MaxThreads = MaxThreads;
+
+    if (MaxItemsQueued == 0) {
+        MaxItemsQueued = MaxThreads * 2;
+    }
+    WorkQueue->MaxItemsQueued = MaxItemsQueued;
+
+    WorkQueue->WorkerWaitSemaphore = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    if (WorkQueue->WorkerWaitSemaphore == NULL) {
+        return FALSE;
+    }
+
+    WorkQueue->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (WorkQueue->WorkerShutdownEvent == NULL) {
+        return FALSE;
+    }
+
+    WorkQueue->SpaceAvailableEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (WorkQueue->SpaceAvailableEvent == NULL) {
+        return FALSE;
+    }
+
+    WorkQueue->IdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (WorkQueue->IdleEvent == NULL) {
+        return FALSE;
+    }
+
+    WorkQueue->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (WorkQueue->Mutex == NULL) {
+        return FALSE;
+    }
+
+    WorkQueue->Threads = YoriLibMalloc(sizeof(HANDLE) * WorkQueue->MaxThreads);
+    if (WorkQueue->Threads == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free the internal allocations and state of a work queue.  This waits for
+ all queued items to be processed.  Note the WorkQueue allocation itself is
+ not freed, since this is typically on the stack.
+
+ @param WorkQueue Pointer to the work queue to clean up.
+ */
+VOID
+YoriLibCleanupWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (WorkQueue->ThreadsAllocated > 0) {
+        SetEvent(WorkQueue->WorkerShutdownEvent);
+        WaitForMultipleObjectsEx(WorkQueue->ThreadsAllocated, WorkQueue->Threads, TRUE, INFINITE, FALSE);
+        for (Index = 0; Index < WorkQueue->ThreadsAllocated; Index++) {
+            CloseHandle(WorkQueue->Threads[Index]);
+            WorkQueue->Threads[Index] = NULL;
+        }
+        WorkQueue->ThreadsAllocated = 0;
+        ASSERT(YoriLibIsListEmpty(&WorkQueue->PendingList));
+    }
+    if (WorkQueue->WorkerWaitSemaphore != NULL) {
+        CloseHandle(WorkQueue->WorkerWaitSemaphore);
+        WorkQueue->WorkerWaitSemaphore = NULL;
+    }
+    if (WorkQueue->WorkerShutdownEvent != NULL) {
+        CloseHandle(WorkQueue->WorkerShutdownEvent);
+        WorkQueue->WorkerShutdownEvent = NULL;
+    }
+    if (WorkQueue->SpaceAvailableEvent != NULL) {
+        CloseHandle(WorkQueue->SpaceAvailableEvent);
+        WorkQueue->SpaceAvailableEvent = NULL;
+    }
+    if (WorkQueue->IdleEvent != NULL) {
+        CloseHandle(WorkQueue->IdleEvent);
+        WorkQueue->IdleEvent = NULL;
+    }
+    if (WorkQueue->Mutex != NULL) {
+        CloseHandle(WorkQueue->Mutex);
+        WorkQueue->Mutex = NULL;
+    }
+    if (WorkQueue->Threads != NULL) {
+        YoriLibFree(WorkQueue->Threads);
+        WorkQueue->Threads = NULL;
+    }
+}
+
+/**
+ A worker thread which processes items from a work queue until the queue is
+ shut down.
+
+ @param Context Pointer to the work queue.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriLibWorkQueueWorker(
+    __in LPVOID Context
+    )
+{
+    PYORILIB_WORK_QUEUE WorkQueue = (PYORILIB_WORK_QUEUE)Context;
+    PYORILIB_WORK_ITEM Item;
+    BOOLEAN Cancelled;
+    DWORD FoundEvent;
+
+    while (TRUE) {
+
+        //
+        //  Wait for an item or shutdown.  Since the semaphore is first, any
+        //  queued items are processed before shutdown is observed.
+        //
+
+        FoundEvent = WaitForMultipleObjectsEx(2, &WorkQueue->WorkerWaitSemaphore, FALSE, INFINITE, FALSE);
+        if (FoundEvent != WAIT_OBJECT_0) {
+            break;
+        }
+
+        WaitForSingleObject(WorkQueue->Mutex, INFINITE);
+        ASSERT(!YoriLibIsListEmpty(&WorkQueue->PendingList));
+        Item = CONTAINING_RECORD(WorkQueue->PendingList.Next, YORILIB_WORK_ITEM, PendingList);
+        YoriLibRemoveListItem(&Item->PendingList);
+        ASSERT(WorkQueue->ItemsQueued > 0);
+        WorkQueue->ItemsQueued--;
+        SetEvent(WorkQueue->SpaceAvailableEvent);
+
+        if (!WorkQueue->Cancelled && YoriLibIsOperationCancelled()) {
+            WorkQueue->Cancelled = TRUE;
+        }
+        Cancelled = WorkQueue->Cancelled;
+        ReleaseMutex(WorkQueue->Mutex);
+
+        WorkQueue->Function(WorkQueue->Context, Item, Cancelled);
+
+        WaitForSingleObject(WorkQueue->Mutex, INFINITE);
+        ASSERT(WorkQueue->ItemsOutstanding > 0);
+        WorkQueue->ItemsOutstanding--;
+        if (WorkQueue->ItemsOutstanding == 0) {
+            SetEvent(WorkQueue->IdleEvent);
+        }
+        ReleaseMutex(WorkQueue->Mutex);
+    }
+
+    return 0;
+}
+
+/**
+ Add an item to a work queue.  If the queue is full and WaitForSpace is
+ TRUE, this waits for space to become available, providing back pressure
+ so the caller cannot generate work faster than it is processed.
+
+ @param WorkQueue Pointer to the work queue.
+
+ @param Item Pointer to the item to queue.  If this function returns TRUE,
+        the item is owned by the work queue.
+
+ @param WaitForSpace If TRUE, wait for space in the queue if it is full.  If
+        FALSE, return immediately if the queue is full.
+
+ @return TRUE to indicate the item was queued.  FALSE to indicate it was not
+         queued, because the queue is full and WaitForSpace is FALSE, because
+         no worker thread could be created, or because the operation was
+         cancelled.  In all of these cases the caller still owns the item,
+         and may process it on the current thread unless the operation was
+         cancelled.
+ */
+__success(return)
+BOOL
+YoriLibQueueWorkItem(
+    __in PYORILIB_WORK_QUEUE WorkQueue,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN WaitForSpace
+    )
+{
+    HANDLE WaitHandles[2];
+    DWORD HandleCount;
+    DWORD ThreadId;
+
+    WaitHandles[0] = WorkQueue->SpaceAvailableEvent;
+    HandleCount = 1;
+    WaitHandles[1] = YoriLibCancelGetEvent();
+    if (WaitHandles[1] != NULL) {
+        HandleCount++;
+    }
+
+    while (TRUE) {
+        WaitForSingleObject(WorkQueue->Mutex, INFINITE);
+
+        if (WorkQueue->Cancelled || YoriLibIsOperationCancelled()) {
+            WorkQueue->Cancelled = TRUE;
+            ReleaseMutex(WorkQueue->Mutex);
+            return FALSE;
+        }
+
+        //
+        //  Add a thread if there are none or the existing ones are falling
+        //  behind.
+        //
+
+        if (WorkQueue->ThreadsAllocated < WorkQueue->MaxThreads &&
+            (WorkQueue->ThreadsAllocated == 0 ||
+             WorkQueue->ItemsQueued >= WorkQueue->ThreadsAllocated)) {
+
+            WorkQueue->Threads[WorkQueue->ThreadsAllocated] = CreateThread(NULL, 0, YoriLibWorkQueueWorker, WorkQueue, 0, &ThreadId);
+            if (WorkQueue->Threads[WorkQueue->ThreadsAllocated] != NULL) {
+                WorkQueue->ThreadsAllocated++;
+            }
+        }
+
+        if (WorkQueue->ThreadsAllocated == 0) {
+            ReleaseMutex(WorkQueue->Mutex);
+            return FALSE;
+        }
+
+        if (WorkQueue->ItemsQueued < WorkQueue->MaxItemsQueued) {
+            YoriLibAppendList(&WorkQueue->PendingList, &Item->PendingList);
+            WorkQueue->ItemsQueued++;
+            WorkQueue->ItemsOutstanding++;
+            ResetEvent(WorkQueue->IdleEvent);
+            if (WorkQueue->ItemsQueued >= WorkQueue->MaxItemsQueued) {
+                ResetEvent(WorkQueue->SpaceAvailableEvent);
+            }
+            ReleaseMutex(WorkQueue->Mutex);
+            ReleaseSemaphore(WorkQueue->WorkerWaitSemaphore, 1, NULL);
+            return TRUE;
+        }
+
+        ResetEvent(WorkQueue->SpaceAvailableEvent);
+        ReleaseMutex(WorkQueue->Mutex);
+
+        if (!WaitForSpace) {
+            return FALSE;
+        }
+
+        WaitForMultipleObjectsEx(HandleCount, WaitHandles, FALSE, INFINITE, FALSE);
+    }
+}
+
+/**
+ Indicate that the operation a work queue is performing has been cancelled.
+ Items which have not yet started are passed to the work function as
+ cancelled, and no more items can be queued.
+
+ @param WorkQueue Pointer to the work queue.
+ */
+VOID
+YoriLibCancelWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    )
+{
+    WaitForSingleObject(WorkQueue->Mutex, INFINITE);
+    WorkQueue->Cancelled = TRUE;
+    ReleaseMutex(WorkQueue->Mutex);
+}
+
+/**
+ Wait for all items queued to a work queue to be processed.  If the user
+ cancels the operation while waiting, remaining items are passed to the
+ work function as cancelled and this waits for them to be released.
+
+ @param WorkQueue Pointer to the work queue.
+
+ @return TRUE to indicate all items were processed, FALSE to indicate the
+         operation was cancelled.
+ */
+__success(return)
+BOOL
+YoriLibWaitForWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    )
+{
+    HANDLE WaitHandles[2];
+    DWORD HandleCount;
+    DWORD FoundEvent;
+    BOOL Result;
+
+    WaitHandles[0] = WorkQueue->IdleEvent;
+    HandleCount = 1;
+    WaitHandles[1] = YoriLibCancelGetEvent();
+    if (WaitHandles[1] != NULL) {
+        HandleCount++;
+    }
+
+    FoundEvent = WaitForMultipleObjectsEx(HandleCount, WaitHandles, FALSE, INFINITE, FALSE);
+    if (FoundEvent != WAIT_OBJECT_0) {
+        YoriLibCancelWorkQueue(WorkQueue);
+        WaitForSingleObject(WorkQueue->IdleEvent, INFINITE);
+    }
+
+    WaitForSingleObject(WorkQueue->Mutex, INFINITE);
+    Result = !WorkQueue->Cancelled;
+    ReleaseMutex(WorkQueue->Mutex);
+
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
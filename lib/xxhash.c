@@ -0,0 +1,300 @@
+/**
+ * @file lib/xxhash.c
+ *
+ * Yori fast non-cryptographic 64 bit hash
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ Construct a 64 bit constant from two 32 bit halves.  This avoids relying on
+ compiler specific suffixes for 64 bit literals.
+ */
+#define XXH64_CONSTANT(High, Low) ((((DWORDLONG)(High)) << 32) | (DWORDLONG)(Low))
+
+/**
+ The first prime used by the algorithm.
+ */
+#define XXH64_PRIME1 XXH64_CONSTANT(0x9E3779B1, 0x85EBCA87)
+
+/**
+ The second prime used by the algorithm.
+ */
+#define XXH64_PRIME2 XXH64_CONSTANT(0xC2B2AE3D, 0x27D4EB4F)
+
+/**
+ The third prime used by the algorithm.
+ */
+#define XXH64_PRIME3 XXH64_CONSTANT(0x165667B1, 0x9E3779F9)
+
+/**
+ The fourth prime used by the algorithm.
+ */
+#define XXH64_PRIME4 XXH64_CONSTANT(0x85EBCA77, 0xC2B2AE63)
+
+/**
+ The fifth prime used by the algorithm.
+ */
+#define XXH64_PRIME5 XXH64_CONSTANT(0x27D4EB2F, 0x165667C5)
+
+/**
+ Rotate a 64 bit value left by the specified number of bits.
+ */
+#define XXH64_ROTL(Value, Bits) (((Value) << (Bits)) | ((Value) >> (64 - (Bits))))
+
+/**
+ Read a 64 bit little endian value from a possibly unaligned buffer.
+
+ @param Buffer Pointer to the buffer.
+
+ @return The value.
+ */
+DWORDLONG
+YoriLibXxHash64Read64(
+    __in PUCHAR Buffer
+    )
+{
+    DWORDLONG Value;
+    memcpy(&Value, Buffer, sizeof(Value));
+    return Value;
+}
+
+/**
+ Read a 32 bit little endian value from a possibly unaligned buffer.
+
+ @param Buffer Pointer to the buffer.
+
+ @return The value.
+ */
+DWORD
+YoriLibXxHash64Read32(
+    __in PUCHAR Buffer
+    )
+{
+    DWORD Value;
+    memcpy(&Value, Buffer, sizeof(Value));
+    return Value;
+}
+
+/**
+ Mix a 64 bit stripe of input into an accumulator.
+
+ @param Accumulator The current value of the accumulator.
+
+ @param Input The input to mix.
+
+ @return The updated accumulator.
+ */
+DWORDLONG
+YoriLibXxHash64Round(
+    __in DWORDLONG Accumulator,
+    __in DWORDLONG Input
+    )
+{
+    Accumulator = Accumulator + Input * XXH64_PRIME2;
+    Accumulator = XXH64_ROTL(Accumulator, 31);
+    Accumulator = Accumulator * XXH64_PRIME1;
+    return Accumulator;
+}
+
+/**
+ Merge one of the four accumulators into the final hash value.
+
+ @param Hash The current hash value.
+
+ @param Accumulator The accumulator to merge.
+
+ @return The updated hash value.
+ */
+DWORDLONG
+YoriLibXxHash64MergeRound(
+    __in DWORDLONG Hash,
+    __in DWORDLONG Accumulator
+    )
+{
+    Hash = Hash ^ YoriLibXxHash64Round(0, Accumulator);
+    Hash = Hash * XXH64_PRIME1 + XXH64_PRIME4;
+    return Hash;
+}
+
+/**
+ Initialize a context to calculate a 64 bit hash.  This hash is very fast
+ and well distributed, making it suitable for detecting changes and finding
+ duplicates, but it is not cryptographically secure.
+
+ @param Context Pointer to the context to initialize.
+
+ @param Seed A seed value.  Hashes are only comparable with other hashes
+        generated with the same seed, which is typically zero.
+ */
+VOID
+YoriLibXxHash64Initialize(
+    __out PYORILIB_XXHASH64_CONTEXT Context,
+    __in DWORDLONG Seed
+    )
+{
+    ZeroMemory(Context, sizeof(YORILIB_XXHASH64_CONTEXT));
+    Context->Seed = Seed;
+    Context->Accumulator[0] = Seed + XXH64_PRIME1 + XXH64_PRIME2;
+    Context->Accumulator[1] = Seed + XXH64_PRIME2;
+    Context->Accumulator[2] = Seed;
+    Context->Accumulator[3] = Seed - XXH64_PRIME1;
+}
+
+/**
+ Add data to a 64 bit hash.  Data is processed in 32 byte stripes, and any
+ partial stripe is retained in the context until more data arrives or the
+ hash is finalized.
+
+ @param Context Pointer to the hash context.
+
+ @param Buffer Pointer to the data to add.
+
+ @param BufferLength The number of bytes in Buffer.
+ */
+VOID
+YoriLibXxHash64Update(
+    __inout PYORILIB_XXHASH64_CONTEXT Context,
+    __in_bcount(BufferLength) PVOID Buffer,
+    __in DWORD BufferLength
+    )
+{
+    PUCHAR Input;
+    DWORD BytesToCopy;
+
+    Input = (PUCHAR)Buffer;
+    Context->TotalLength = Context->TotalLength + BufferLength;
+
+    //
+    //  If there's a partial stripe from a previous call, fill it first.
+    //
+
+    if (Context->BufferLength > 0) {
+        BytesToCopy = sizeof(Context->Buffer) - Context->BufferLength;
+        if (BytesToCopy > BufferLength) {
+            BytesToCopy = BufferLength;
+        }
+        memcpy(&Context->Buffer[Context->BufferLength], Input, BytesToCopy);
+        Context->BufferLength = Context->BufferLength + BytesToCopy;
+        Input = Input + BytesToCopy;
+        BufferLength = BufferLength - BytesToCopy;
+
+        if (Context->BufferLength < sizeof(Context->Buffer)) {
+            return;
+        }
+
+        Context->Accumulator[0] = YoriLibXxHash64Round(Context->Accumulator[0], YoriLibXxHash64Read64(&Context->Buffer[0]));
+        Context->Accumulator[1] = YoriLibXxHash64Round(Context->Accumulator[1], YoriLibXxHash64Read64(&Context->Buffer[8]));
+        Context->Accumulator[2] = YoriLibXxHash64Round(Context->Accumulator[2], YoriLibXxHash64Read64(&Context->Buffer[16]));
+        Context->Accumulator[3] = YoriLibXxHash64Round(Context->Accumulator[3], YoriLibXxHash64Read64(&Context->Buffer[24]));
+        Context->BufferLength = 0;
+    }
+
+    //
+    //  Process whole stripes directly from the caller's buffer.
+    //
+
+    while (BufferLength >= sizeof(Context->Buffer)) {
+        Context->Accumulator[0] = YoriLibXxHash64Round(Context->Accumulator[0], YoriLibXxHash64Read64(&Input[0]));
+        Context->Accumulator[1] = YoriLibXxHash64Round(Context->Accumulator[1], YoriLibXxHash64Read64(&Input[8]));
+        Context->Accumulator[2] = YoriLibXxHash64Round(Context->Accumulator[2], YoriLibXxHash64Read64(&Input[16]));
+        Context->Accumulator[3] = YoriLibXxHash64Round(Context->Accumulator[3], YoriLibXxHash64Read64(&Input[24]));
+        Input = Input + sizeof(Context->Buffer);
+        BufferLength = BufferLength - sizeof(Context->Buffer);
+    }
+
+    if (BufferLength > 0) {
+        memcpy(Context->Buffer, Input, BufferLength);
+        Context->BufferLength = BufferLength;
+    }
+}
+
+/**
+ Complete a 64 bit hash and return its value.  The context cannot be used
+ for further updates after this call.
+
+ @param Context Pointer to the hash context.
+
+ @return The hash value.
+ */
+DWORDLONG
+YoriLibXxHash64Finalize(
+    __in PYORILIB_XXHASH64_CONTEXT Context
+    )
+{
+    DWORDLONG Hash;
+    DWORD Offset;
+
+    if (Context->TotalLength >= sizeof(Context->Buffer)) {
+        Hash = XXH64_ROTL(Context->Accumulator[0], 1) +
+               XXH64_ROTL(Context->Accumulator[1], 7) +
+               XXH64_ROTL(Context->Accumulator[2], 12) +
+               XXH64_ROTL(Context->Accumulator[3], 18);
+        Hash = YoriLibXxHash64MergeRound(Hash, Context->Accumulator[0]);
+        Hash = YoriLibXxHash64MergeRound(Hash, Context->Accumulator[1]);
+        Hash = YoriLibXxHash64MergeRound(Hash, Context->Accumulator[2]);
+        Hash = YoriLibXxHash64MergeRound(Hash, Context->Accumulator[3]);
+    } else {
+        Hash = Context->Seed + XXH64_PRIME5;
+    }
+
+    Hash = Hash + Context->TotalLength;
+
+    //
+    //  Mix in the remaining partial stripe.
+    //
+
+    Offset = 0;
+    while (Offset + 8 <= Context->BufferLength) {
+        Hash = Hash ^ YoriLibXxHash64Round(0, YoriLibXxHash64Read64(&Context->Buffer[Offset]));
+        Hash = XXH64_ROTL(Hash, 27) * XXH64_PRIME1 + XXH64_PRIME4;
+        Offset = Offset + 8;
+    }
+
+    if (Offset + 4 <= Context->BufferLength) {
+        Hash = Hash ^ ((DWORDLONG)YoriLibXxHash64Read32(&Context->Buffer[Offset]) * XXH64_PRIME1);
+        Hash = XXH64_ROTL(Hash, 23) * XXH64_PRIME2 + XXH64_PRIME3;
+        Offset = Offset + 4;
+    }
+
+    while (Offset < Context->BufferLength) {
+        Hash = Hash ^ ((DWORDLONG)Context->Buffer[Offset] * XXH64_PRIME5);
+        Hash = XXH64_ROTL(Hash, 11) * XXH64_PRIME1;
+        Offset++;
+    }
+
+    //
+    //  Final avalanche so every input bit affects every output bit.
+    //
+
+    Hash = Hash ^ (Hash >> 33);
+    Hash = Hash * XXH64_PRIME2;
+    Hash = Hash ^ (Hash >> 29);
+    Hash = Hash * XXH64_PRIME3;
+    Hash = Hash ^ (Hash >> 32);
+
+    return Hash;
+}
+
+// vim:sw=4:ts=4:et:
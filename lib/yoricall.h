@@ -95,6 +95,12 @@ YoriCallGetAliasStrings(
     __out PYORI_STRING AliasStrings
     );
 
+BOOL
+YoriCallGetCommandTimings(
+    __in BOOL Reset,
+    __out PYORI_STRING Report
+    );
+
 BOOL
 YoriCallGetEnvironmentVariable(
     __in PYORI_STRING VariableName,
@@ -199,6 +205,14 @@ YoriCallTerminateJob(
     __in DWORD JobId
     );
 
+__success(return)
+BOOL
+YoriCallWaitForAnyJob(
+    __in DWORD JobCount,
+    __in_ecount(JobCount) PDWORD JobIds,
+    __out PDWORD CompletedJobId
+    );
+
 VOID
 YoriCallWaitForJob(
     __in DWORD JobId
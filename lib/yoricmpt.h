@@ -191,6 +191,14 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #define ERROR_OLD_WIN_VERSION 1150
 #endif
 
+#ifndef ERROR_COMPRESSION_NOT_BENEFICIAL
+/**
+ Define for the error indicating that a file was not compressed because
+ compressing it would not save space.
+ */
+#define ERROR_COMPRESSION_NOT_BENEFICIAL 344
+#endif
+
 #ifndef PROCESS_QUERY_LIMITED_INFORMATION
 /**
  Definition for opening processes with very limited access for compilation
@@ -223,6 +231,14 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #define DIRECTORY_QUERY (0x0001)
 #endif
 
+#ifndef DIRECTORY_TRAVERSE
+/**
+ The security flag indicating a request to open an object manager directory
+ so that objects within it can be opened relative to it.
+ */
+#define DIRECTORY_TRAVERSE (0x0002)
+#endif
+
 #ifndef STATUS_SUCCESS
 /**
  If not defined by the current compilation environment, the NTSTATUS code
@@ -1041,6 +1057,12 @@ typedef struct _YORI_LIB_PEB64 {
  */
 #define SystemProcessInformation (5)
 
+/**
+ Definition of the system processor performance information enumeration
+ class for NtQuerySystemInformation .
+ */
+#define SystemProcessorPerformanceInformation (8)
+
 /**
  Definition of the system handle information enumeration class for
  NtQuerySystemInformation .
@@ -1054,6 +1076,45 @@ typedef struct _YORI_LIB_PEB64 {
 #define SystemExtendedHandleInformation (64)
 
 
+/**
+ Information returned about every logical processor in a processor group.
+ */
+typedef struct _YORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION {
+
+    /**
+     The amount of time the processor has been idle.
+     */
+    LARGE_INTEGER IdleTime;
+
+    /**
+     The amount of time the processor has spent in kernel mode.  This
+     includes idle time, DPC time and interrupt time.
+     */
+    LARGE_INTEGER KernelTime;
+
+    /**
+     The amount of time the processor has spent in user mode.
+     */
+    LARGE_INTEGER UserTime;
+
+    /**
+     The amount of time the processor has spent processing deferred procedure
+     calls.
+     */
+    LARGE_INTEGER DpcTime;
+
+    /**
+     The amount of time the processor has spent processing interrupts.
+     */
+    LARGE_INTEGER InterruptTime;
+
+    /**
+     The number of interrupts the processor has processed.
+     */
+    ULONG InterruptCount;
+
+} YORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION, *PYORI_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION;
+
 /**
  Information returned about every process in the system.
  */
@@ -1150,9 +1211,37 @@ typedef struct _YORI_SYSTEM_PROCESS_INFORMATION {
     PVOID Reserved6[2];
 
     /**
-     Ignored in this application.
+     The number of read operations performed by the process.  This field is
+     only present on Windows 2000 and above.
+     */
+    LARGE_INTEGER ReadOperationCount;
+
+    /**
+     The number of write operations performed by the process.
+     */
+    LARGE_INTEGER WriteOperationCount;
+
+    /**
+     The number of operations performed by the process that are neither
+     reads nor writes.
+     */
+    LARGE_INTEGER OtherOperationCount;
+
+    /**
+     The number of bytes read by the process.
+     */
+    LARGE_INTEGER ReadTransferCount;
+
+    /**
+     The number of bytes written by the process.
+     */
+    LARGE_INTEGER WriteTransferCount;
+
+    /**
+     The number of bytes transferred by the process in operations that are
+     neither reads nor writes.
      */
-    LARGE_INTEGER Reserved7[6];
+    LARGE_INTEGER OtherTransferCount;
 
 } YORI_SYSTEM_PROCESS_INFORMATION, *PYORI_SYSTEM_PROCESS_INFORMATION;
 
@@ -2234,6 +2323,73 @@ typedef struct _YORI_SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX {
 #define PROCESS_MODE_BACKGROUND_BEGIN 0x00100000
 #endif
 
+#ifndef PSS_CAPTURE_VA_CLONE
+/**
+ Capture a copy on write clone of the address space of a process when
+ capturing a process snapshot.
+ */
+#define PSS_CAPTURE_VA_CLONE                         0x00000001
+
+/**
+ Capture the handle table of a process when capturing a process snapshot.
+ */
+#define PSS_CAPTURE_HANDLES                          0x00000004
+
+/**
+ Capture the names of handles when capturing a process snapshot.
+ */
+#define PSS_CAPTURE_HANDLE_NAME_INFORMATION          0x00000008
+
+/**
+ Capture basic information about handles when capturing a process snapshot.
+ */
+#define PSS_CAPTURE_HANDLE_BASIC_INFORMATION         0x00000010
+
+/**
+ Capture type specific information about handles when capturing a process
+ snapshot.
+ */
+#define PSS_CAPTURE_HANDLE_TYPE_SPECIFIC_INFORMATION 0x00000020
+
+/**
+ Capture the handle trace when capturing a process snapshot.
+ */
+#define PSS_CAPTURE_HANDLE_TRACE                     0x00000040
+
+/**
+ Capture the threads of a process when capturing a process snapshot.
+ */
+#define PSS_CAPTURE_THREADS                          0x00000080
+
+/**
+ Capture the register context of each thread when capturing a process
+ snapshot.
+ */
+#define PSS_CAPTURE_THREAD_CONTEXT                   0x00000100
+
+/**
+ Capture extended register state of each thread when capturing a process
+ snapshot.
+ */
+#define PSS_CAPTURE_THREAD_CONTEXT_EXTENDED          0x00000200
+
+/**
+ Create the clone process used for a snapshot outside of any job that the
+ target process is in.
+ */
+#define PSS_CREATE_BREAKAWAY_OPTIONAL                0x04000000
+
+/**
+ Allocate snapshot buffers with virtual memory rather than the heap.
+ */
+#define PSS_CREATE_USE_VM_ALLOCATIONS                0x20000000
+
+/**
+ Release the section used to transfer snapshot data once it has been read.
+ */
+#define PSS_CREATE_RELEASE_SECTION                   0x80000000
+#endif
+
 #ifndef INVALID_LCN
 /**
  A value describing an invalid LCN (region not allocated) for compilation
@@ -2577,6 +2733,14 @@ typedef struct _YORI_REPARSE_DATA_BUFFER {
 #define COMPRESSION_FORMAT_LZNT1        (0x0002)
 #endif
 
+#ifndef FSCTL_SET_SPARSE
+/**
+ Specifies the FSCTL_SET_SPARSE numerical representation if the compilation
+ environment doesn't provide it.
+ */
+#define FSCTL_SET_SPARSE                 CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 49, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#endif
+
 #ifndef FSCTL_GET_NTFS_VOLUME_DATA
 /**
  Specifies the FSCTL_GET_NTFS_VOLUME_DATA numerical representation if the
@@ -2755,6 +2919,51 @@ typedef REFS_VOLUME_DATA_BUFFER *PREFS_VOLUME_DATA_BUFFER;
 
 #endif
 
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+/**
+ Specifies the FSCTL_DUPLICATE_EXTENTS_TO_FILE numerical representation if
+ the compilation environment doesn't provide it.
+ */
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE  CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA)
+
+/**
+ Information passed to FSCTL_DUPLICATE_EXTENTS_TO_FILE.  The FSCTL is sent
+ to the target, and references the source by handle.
+ */
+typedef struct _DUPLICATE_EXTENTS_DATA {
+
+    /**
+     A handle to the source file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The offset within the source file to clone from, in bytes.
+     */
+    LARGE_INTEGER SourceFileOffset;
+
+    /**
+     The offset within the target file to clone to, in bytes.
+     */
+    LARGE_INTEGER TargetFileOffset;
+
+    /**
+     The number of bytes to clone.
+     */
+    LARGE_INTEGER ByteCount;
+
+} DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+
+#endif
+
+#ifndef FILE_SUPPORTS_BLOCK_REFCOUNTING
+/**
+ Specifies the volume flag indicating that file extents can be shared
+ between files if the compilation environment doesn't provide it.
+ */
+#define FILE_SUPPORTS_BLOCK_REFCOUNTING  (0x08000000)
+#endif
+
 #ifndef FSCTL_GET_RETRIEVAL_POINTERS
 /**
  Specifies the FSCTL_GET_RETRIEVAL_POINTERS numerical representation if the
@@ -2818,6 +3027,58 @@ typedef struct RETRIEVAL_POINTERS_BUFFER {
 } RETRIEVAL_POINTERS_BUFFER, *PRETRIEVAL_POINTERS_BUFFER;
 #endif
 
+#ifndef FSCTL_GET_VOLUME_BITMAP
+/**
+ Specifies the FSCTL_GET_VOLUME_BITMAP numerical representation if the
+ compilation environment doesn't provide it.
+ */
+#define FSCTL_GET_VOLUME_BITMAP          CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 27,  METHOD_NEITHER, FILE_ANY_ACCESS)
+
+/**
+ Specifies information required to request the allocation bitmap of a
+ volume.
+ */
+typedef struct {
+
+    /**
+     Specifies the cluster within the volume where bitmap information is
+     requested.
+     */
+    LARGE_INTEGER StartingLcn;
+
+} STARTING_LCN_INPUT_BUFFER;
+
+/**
+ Pointer to information required to request the allocation bitmap of a
+ volume.
+ */
+typedef STARTING_LCN_INPUT_BUFFER *PSTARTING_LCN_INPUT_BUFFER;
+
+/**
+ A buffer returned when querying the allocation bitmap of a volume.  Defined
+ here for when the compilation environment doesn't define it.
+ */
+typedef struct {
+
+    /**
+     The cluster described by the first bit in Buffer.
+     */
+    LARGE_INTEGER StartingLcn;
+
+    /**
+     The number of clusters from StartingLcn to the end of the volume.  Note
+     this can describe more clusters than were returned in Buffer.
+     */
+    LARGE_INTEGER BitmapSize;
+
+    /**
+     A bitmap with one bit per cluster, set if the cluster is in use.
+     */
+    BYTE Buffer[1];
+
+} VOLUME_BITMAP_BUFFER, *PVOLUME_BITMAP_BUFFER;
+#endif
+
 #ifndef FSCTL_QUERY_ALLOCATED_RANGES
 /**
  Specifies the FSCTL_QUERY_ALLOCATED_RANGES numerical representation if the
@@ -3031,6 +3292,73 @@ typedef USN_JOURNAL_DATA *PUSN_JOURNAL_DATA;
 
 #endif
 
+#ifndef FSCTL_ENUM_USN_DATA
+
+/**
+ Specifies the FSCTL_ENUM_USN_DATA numerical representation if the
+ compilation environment doesn't provide it.
+ */
+#define FSCTL_ENUM_USN_DATA             CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 44,  METHOD_NEITHER, FILE_ANY_ACCESS)
+#endif
+
+#ifndef FSCTL_GET_NTFS_FILE_RECORD
+
+/**
+ Specifies the FSCTL_GET_NTFS_FILE_RECORD numerical representation if the
+ compilation environment doesn't provide it.
+ */
+#define FSCTL_GET_NTFS_FILE_RECORD      CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 26,  METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+/**
+ Input to FSCTL_GET_NTFS_FILE_RECORD where the compiler doesn't define it.
+ */
+typedef struct {
+
+    /**
+     The file reference number of the file record to return.  The returned
+     record may be the next lower in use record if this one is not in use.
+     */
+    LARGE_INTEGER FileReferenceNumber;
+
+} NTFS_FILE_RECORD_INPUT_BUFFER;
+
+/**
+ Pointer to input to FSCTL_GET_NTFS_FILE_RECORD where the compiler doesn't
+ define it.
+ */
+typedef NTFS_FILE_RECORD_INPUT_BUFFER *PNTFS_FILE_RECORD_INPUT_BUFFER;
+
+/**
+ Information returned from FSCTL_GET_NTFS_FILE_RECORD where the compiler
+ doesn't define it.
+ */
+typedef struct {
+
+    /**
+     The file reference number of the file record that was returned.
+     */
+    LARGE_INTEGER FileReferenceNumber;
+
+    /**
+     The length of the file record, in bytes.
+     */
+    DWORD FileRecordLength;
+
+    /**
+     The contents of the file record.
+     */
+    BYTE FileRecordBuffer[1];
+
+} NTFS_FILE_RECORD_OUTPUT_BUFFER;
+
+/**
+ Pointer to information returned from FSCTL_GET_NTFS_FILE_RECORD where the
+ compiler doesn't define it.
+ */
+typedef NTFS_FILE_RECORD_OUTPUT_BUFFER *PNTFS_FILE_RECORD_OUTPUT_BUFFER;
+
+#endif
+
 
 #ifndef FSCTL_GET_EXTERNAL_BACKING
 
@@ -3248,6 +3576,89 @@ typedef struct _FILE_DISPOSITION_INFO {
  */
 #define FileDispositionInfo (0x000000004)
 
+/**
+ A structure describing a single entry within a directory, including its
+ allocation size, provided here for when the compilation environment doesn't
+ provide it.
+ */
+typedef struct _FILE_FULL_DIR_INFO {
+
+    /**
+     The offset in bytes from this entry to the next entry, or zero if this
+     is the final entry in the buffer.
+     */
+    DWORD NextEntryOffset;
+
+    /**
+     The byte offset of the entry within the parent directory.  This is
+     not meaningful on all file systems.
+     */
+    DWORD FileIndex;
+
+    /**
+     The time the object was created.
+     */
+    LARGE_INTEGER CreationTime;
+
+    /**
+     The time the object was last accessed.
+     */
+    LARGE_INTEGER LastAccessTime;
+
+    /**
+     The time the object was last written.
+     */
+    LARGE_INTEGER LastWriteTime;
+
+    /**
+     The time the object's metadata was last changed.
+     */
+    LARGE_INTEGER ChangeTime;
+
+    /**
+     The size of the object's default stream, in bytes.
+     */
+    LARGE_INTEGER EndOfFile;
+
+    /**
+     The space allocated by the file system for the object's default
+     stream, in bytes.
+     */
+    LARGE_INTEGER AllocationSize;
+
+    /**
+     The attributes of the object.
+     */
+    DWORD FileAttributes;
+
+    /**
+     The length of the file name, in bytes.
+     */
+    DWORD FileNameLength;
+
+    /**
+     The size of the extended attributes of the object.  For reparse points,
+     this contains the reparse tag.
+     */
+    DWORD EaSize;
+
+    /**
+     The file name, which is not NULL terminated.
+     */
+    WCHAR FileName[1];
+} FILE_FULL_DIR_INFO, *PFILE_FULL_DIR_INFO;
+
+/**
+ The identifier of the request type that returns the above structure.
+ */
+#define FileFullDirectoryInfo        (0x00000000E)
+
+/**
+ The identifier of the request type that returns the above structure,
+ starting from the beginning of the directory.
+ */
+#define FileFullDirectoryRestartInfo (0x00000000F)
+
 #endif
 
 #ifndef FILE_DISPOSITION_FLAG_DELETE
@@ -3955,9 +4366,9 @@ typedef struct _YORI_JOB_BASIC_LIMIT_INFORMATION {
     DWORD Unused5;
 
     /**
-     Field not needed/supported by YoriLib.
+     The processor affinity to assign to processes in the job.
      */
-    SIZE_T Unused6;
+    SIZE_T Affinity;
 
     /**
      The base process priority to assign to the job.
@@ -3971,23 +4382,200 @@ typedef struct _YORI_JOB_BASIC_LIMIT_INFORMATION {
 } YORI_JOB_BASIC_LIMIT_INFORMATION, *PYORI_JOB_BASIC_LIMIT_INFORMATION;
 
 /**
- Information specifying how to associate a job object handle with a completion
- port.
+ Counts of IO performed by a job.
  */
-typedef struct _YORI_JOB_ASSOCIATE_COMPLETION_PORT {
+typedef struct _YORI_JOB_IO_COUNTERS {
 
     /**
-     A context pointer to associate with messages arriving on the completion
-     port.
+     The number of read operations performed.
      */
-    PVOID Key;
+    DWORDLONG ReadOperationCount;
 
     /**
-     The completion port to associate the job object with.
+     The number of write operations performed.
      */
-    HANDLE Port;
-} YORI_JOB_ASSOCIATE_COMPLETION_PORT, *PYORI_JOB_ASSOCIATE_COMPLETION_PORT;
-
+    DWORDLONG WriteOperationCount;
+
+    /**
+     The number of operations performed that are neither reads nor writes.
+     */
+    DWORDLONG OtherOperationCount;
+
+    /**
+     The number of bytes read.
+     */
+    DWORDLONG ReadTransferCount;
+
+    /**
+     The number of bytes written.
+     */
+    DWORDLONG WriteTransferCount;
+
+    /**
+     The number of bytes transferred in operations that are neither reads
+     nor writes.
+     */
+    DWORDLONG OtherTransferCount;
+} YORI_JOB_IO_COUNTERS, *PYORI_JOB_IO_COUNTERS;
+
+/**
+ The information class to query basic and IO accounting information from a
+ job.
+ */
+#define YORI_JOB_OBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION 8
+
+/**
+ Structure to query basic and IO accounting information from a job.
+ */
+typedef struct _YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION {
+
+    /**
+     Processor time and process counts for the job.
+     */
+    YORI_JOB_BASIC_ACCOUNTING_INFORMATION BasicInfo;
+
+    /**
+     IO performed by the job.
+     */
+    YORI_JOB_IO_COUNTERS IoInfo;
+} YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION, *PYORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION;
+
+/**
+ The information class to query extended limit information from a job.
+ */
+#define YORI_JOB_OBJECT_EXTENDED_LIMIT_INFORMATION 9
+
+/**
+ Structure to query extended limit information from a job, which includes
+ the peak memory usage of the job.
+ */
+typedef struct _YORI_JOB_EXTENDED_LIMIT_INFORMATION {
+
+    /**
+     Basic limits on the job.
+     */
+    YORI_JOB_BASIC_LIMIT_INFORMATION BasicLimitInformation;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    YORI_JOB_IO_COUNTERS Unused1;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    SIZE_T Unused2;
+
+    /**
+     Field not needed/supported by YoriLib.
+     */
+    SIZE_T Unused3;
+
+    /**
+     The largest amount of memory committed by any single process in the
+     job.
+     */
+    SIZE_T PeakProcessMemoryUsed;
+
+    /**
+     The largest amount of memory committed by all processes in the job at
+     any one time.
+     */
+    SIZE_T PeakJobMemoryUsed;
+} YORI_JOB_EXTENDED_LIMIT_INFORMATION, *PYORI_JOB_EXTENDED_LIMIT_INFORMATION;
+
+/**
+ The information class to query or set basic limits on a job.
+ */
+#define YORI_JOB_OBJECT_BASIC_LIMIT_INFORMATION 2
+
+/**
+ A flag indicating that the Affinity field of basic limit information is
+ valid.
+ */
+#define YORI_JOB_OBJECT_LIMIT_AFFINITY 0x10
+
+/**
+ A flag indicating that the Priority field of basic limit information is
+ valid.
+ */
+#define YORI_JOB_OBJECT_LIMIT_PRIORITY_CLASS 0x20
+
+/**
+ The information class to set the CPU rate of a job.  This is supported on
+ Windows 8 and above.
+ */
+#define YORI_JOB_OBJECT_CPU_RATE_CONTROL_INFORMATION 15
+
+/**
+ A flag indicating that the CPU rate of a job should be controlled.
+ */
+#define YORI_JOB_OBJECT_CPU_RATE_CONTROL_ENABLE 0x1
+
+/**
+ A flag indicating that the CPU rate of a job is a hard limit, so the job
+ cannot exceed the rate even if processors would otherwise be idle.
+ */
+#define YORI_JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP 0x4
+
+/**
+ Structure to set the CPU rate of a job.
+ */
+typedef struct _YORI_JOB_CPU_RATE_CONTROL_INFORMATION {
+
+    /**
+     Flags indicating how the CPU rate should be controlled.
+     */
+    DWORD ControlFlags;
+
+    /**
+     The portion of processor cycles the job may use, in hundredths of a
+     percent.
+     */
+    DWORD CpuRate;
+} YORI_JOB_CPU_RATE_CONTROL_INFORMATION, *PYORI_JOB_CPU_RATE_CONTROL_INFORMATION;
+
+/**
+ Information specifying how to associate a job object handle with a completion
+ port.
+ */
+typedef struct _YORI_JOB_ASSOCIATE_COMPLETION_PORT {
+
+    /**
+     A context pointer to associate with messages arriving on the completion
+     port.
+     */
+    PVOID Key;
+
+    /**
+     The completion port to associate the job object with.
+     */
+    HANDLE Port;
+} YORI_JOB_ASSOCIATE_COMPLETION_PORT, *PYORI_JOB_ASSOCIATE_COMPLETION_PORT;
+
+/**
+ The information class to associate a job object with a completion port.
+ */
+#define YORI_JOB_OBJECT_ASSOCIATE_COMPLETION_PORT_INFORMATION 7
+
+/**
+ A message delivered to a job completion port when the last process in the
+ job terminates.
+ */
+#define YORI_JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO               4
+
+/**
+ A message delivered to a job completion port when a process in the job
+ terminates.
+ */
+#define YORI_JOB_OBJECT_MSG_EXIT_PROCESS                      7
+
+/**
+ A message delivered to a job completion port when a process in the job
+ terminates due to an unhandled exception.
+ */
+#define YORI_JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS             8
+
 
 #ifndef SYMBOLIC_LINK_FLAG_DIRECTORY
 /**
@@ -4338,6 +4926,78 @@ typedef struct _YORI_SYSTEM_POWER_STATUS {
 #define HSHELL_MONITORCHANGED 16
 #endif
 
+#ifndef EVENT_SYSTEM_FOREGROUND
+/**
+ A definition for EVENT_SYSTEM_FOREGROUND if it is not defined by the current
+ compilation environment.
+ */
+#define EVENT_SYSTEM_FOREGROUND 0x0003
+#endif
+
+#ifndef EVENT_OBJECT_DESTROY
+/**
+ A definition for EVENT_OBJECT_DESTROY if it is not defined by the current
+ compilation environment.
+ */
+#define EVENT_OBJECT_DESTROY 0x8001
+#endif
+
+#ifndef EVENT_OBJECT_SHOW
+/**
+ A definition for EVENT_OBJECT_SHOW if it is not defined by the current
+ compilation environment.
+ */
+#define EVENT_OBJECT_SHOW 0x8002
+#endif
+
+#ifndef EVENT_OBJECT_HIDE
+/**
+ A definition for EVENT_OBJECT_HIDE if it is not defined by the current
+ compilation environment.
+ */
+#define EVENT_OBJECT_HIDE 0x8003
+#endif
+
+#ifndef EVENT_OBJECT_NAMECHANGE
+/**
+ A definition for EVENT_OBJECT_NAMECHANGE if it is not defined by the current
+ compilation environment.
+ */
+#define EVENT_OBJECT_NAMECHANGE 0x800C
+#endif
+
+#ifndef WINEVENT_OUTOFCONTEXT
+/**
+ A definition for WINEVENT_OUTOFCONTEXT if it is not defined by the current
+ compilation environment.
+ */
+#define WINEVENT_OUTOFCONTEXT 0x0000
+#endif
+
+#ifndef WINEVENT_SKIPOWNPROCESS
+/**
+ A definition for WINEVENT_SKIPOWNPROCESS if it is not defined by the
+ current compilation environment.
+ */
+#define WINEVENT_SKIPOWNPROCESS 0x0002
+#endif
+
+#ifndef OBJID_WINDOW
+/**
+ A definition for OBJID_WINDOW if it is not defined by the current
+ compilation environment.
+ */
+#define OBJID_WINDOW ((LONG)0x00000000)
+#endif
+
+#ifndef CHILDID_SELF
+/**
+ A definition for CHILDID_SELF if it is not defined by the current
+ compilation environment.
+ */
+#define CHILDID_SELF 0
+#endif
+
 #ifndef ARW_HIDE
 /**
  If not defined by the compilation environment, the flag that minimized
@@ -6918,6 +7578,30 @@ typedef struct _RESIZE_VIRTUAL_DISK_PARAMETERS {
 #define HTTP_QUERY_STATUS_CODE (0x13)
 #endif
 
+#ifndef HTTP_QUERY_FLAG_SYSTEMTIME
+/**
+ The flag indicating an HTTP header query wants the value returned as a
+ SYSTEMTIME, if not defined by the current compilation environment.
+ */
+#define HTTP_QUERY_FLAG_SYSTEMTIME 0x40000000
+#endif
+
+#ifndef HTTP_QUERY_LAST_MODIFIED
+/**
+ The flag indicating an HTTP header query wants the Last-Modified header, if
+ not defined by the current compilation environment.
+ */
+#define HTTP_QUERY_LAST_MODIFIED (0x0b)
+#endif
+
+#ifndef HTTP_QUERY_CONTENT_RANGE
+/**
+ The flag indicating an HTTP header query wants the Content-Range header, if
+ not defined by the current compilation environment.
+ */
+#define HTTP_QUERY_CONTENT_RANGE (0x44)
+#endif
+
 /**
  The maximum number of PHY types that can be returned for a single network.
  */
@@ -7364,6 +8048,18 @@ NT_QUERY_SYSTEM_INFORMATION(DWORD, PVOID, DWORD, PDWORD);
  */
 typedef NT_QUERY_SYSTEM_INFORMATION *PNT_QUERY_SYSTEM_INFORMATION;
 
+/**
+ A prototype for the NtQuerySystemInformationEx function.
+ */
+typedef
+LONG WINAPI
+NT_QUERY_SYSTEM_INFORMATION_EX(DWORD, PVOID, DWORD, PVOID, DWORD, PDWORD);
+
+/**
+ A prototype for a pointer to the NtQuerySystemInformationEx function.
+ */
+typedef NT_QUERY_SYSTEM_INFORMATION_EX *PNT_QUERY_SYSTEM_INFORMATION_EX;
+
 /**
  A prototype for the NtSetInformationFile function.
  */
@@ -7400,6 +8096,18 @@ RTL_GET_LAST_NT_STATUS(VOID);
  */
 typedef RTL_GET_LAST_NT_STATUS *PRTL_GET_LAST_NT_STATUS;
 
+/**
+ A prototype for the RtlUpcaseUnicodeChar function.
+ */
+typedef
+WCHAR WINAPI
+RTL_UPCASE_UNICODE_CHAR(WCHAR);
+
+/**
+ A prototype for a pointer to the RtlUpcaseUnicodeChar function.
+ */
+typedef RTL_UPCASE_UNICODE_CHAR *PRTL_UPCASE_UNICODE_CHAR;
+
 /**
  A structure containing optional function pointers to ntdll.dll exported
  functions which programs can operate without having hard dependencies on.
@@ -7465,6 +8173,12 @@ typedef struct _YORI_NTDLL_FUNCTIONS {
      */
     PNT_QUERY_SYSTEM_INFORMATION pNtQuerySystemInformation;
 
+    /**
+     If it's available on the current system, a pointer to
+     NtQuerySystemInformationEx.
+     */
+    PNT_QUERY_SYSTEM_INFORMATION_EX pNtQuerySystemInformationEx;
+
     /**
      If it's available on the current system, a pointer to
      NtSetInformationFile.
@@ -7483,6 +8197,12 @@ typedef struct _YORI_NTDLL_FUNCTIONS {
      */
     PRTL_GET_LAST_NT_STATUS pRtlGetLastNtStatus;
 
+    /**
+     If it's available on the current system, a pointer to
+     RtlUpcaseUnicodeChar.
+     */
+    PRTL_UPCASE_UNICODE_CHAR pRtlUpcaseUnicodeChar;
+
 } YORI_NTDLL_FUNCTIONS, *PYORI_NTDLL_FUNCTIONS;
 
 extern YORI_NTDLL_FUNCTIONS DllNtDll;
@@ -7550,6 +8270,18 @@ CREATE_HARD_LINKW(LPWSTR, LPWSTR, PVOID);
  */
 typedef CREATE_HARD_LINKW *PCREATE_HARD_LINKW;
 
+/**
+ A prototype for the CreateIoCompletionPort function.
+ */
+typedef
+HANDLE WINAPI
+CREATE_IO_COMPLETION_PORT(HANDLE, HANDLE, DWORD_PTR, DWORD);
+
+/**
+ A prototype for a pointer to the CreateIoCompletionPort function.
+ */
+typedef CREATE_IO_COMPLETION_PORT *PCREATE_IO_COMPLETION_PORT;
+
 /**
  A prototype for the CreateJobObjectW function.
  */
@@ -7574,6 +8306,42 @@ CREATE_SYMBOLIC_LINKW(LPTSTR, LPTSTR, DWORD);
  */
 typedef CREATE_SYMBOLIC_LINKW *PCREATE_SYMBOLIC_LINKW;
 
+/**
+ The FindFirstFileEx information level that returns all information,
+ including short file names.
+ */
+#define YORI_FIND_EX_INFO_STANDARD        (0)
+
+/**
+ The FindFirstFileEx information level that does not return short file
+ names.  This is only supported on Windows 7 and above.
+ */
+#define YORI_FIND_EX_INFO_BASIC           (1)
+
+/**
+ The FindFirstFileEx search operation that matches names against the
+ specified pattern.
+ */
+#define YORI_FIND_EX_SEARCH_NAME_MATCH    (0)
+
+/**
+ A FindFirstFileEx flag indicating the directory should be queried using a
+ larger buffer.  This is only supported on Windows 7 and above.
+ */
+#define YORI_FIND_FIRST_EX_LARGE_FETCH    (0x00000002)
+
+/**
+ A prototype for the FindFirstFileExW function.
+ */
+typedef
+HANDLE WINAPI
+FIND_FIRST_FILE_EXW(LPCWSTR, DWORD, LPVOID, DWORD, LPVOID, DWORD);
+
+/**
+ A prototype for a pointer to the FindFirstFileExW function.
+ */
+typedef FIND_FIRST_FILE_EXW *PFIND_FIRST_FILE_EXW;
+
 /**
  A prototype for the FindFirstStreamW function.
  */
@@ -7838,6 +8606,18 @@ GET_LOGICAL_PROCESSOR_INFORMATION_EX(YORI_LOGICAL_PROCESSOR_RELATIONSHIP, PYORI_
  */
 typedef GET_LOGICAL_PROCESSOR_INFORMATION_EX *PGET_LOGICAL_PROCESSOR_INFORMATION_EX;
 
+/**
+ A prototype for the GetNumaNodeProcessorMask function.
+ */
+typedef
+BOOL WINAPI
+GET_NUMA_NODE_PROCESSOR_MASK(UCHAR, PULONGLONG);
+
+/**
+ A prototype for a pointer to the GetNumaNodeProcessorMask function.
+ */
+typedef GET_NUMA_NODE_PROCESSOR_MASK *PGET_NUMA_NODE_PROCESSOR_MASK;
+
 /**
  A prototype for the GetNativeSystemInfo function.
  */
@@ -7922,6 +8702,18 @@ GET_PRODUCT_INFO(DWORD, DWORD, DWORD, DWORD, PDWORD);
  */
 typedef GET_PRODUCT_INFO *PGET_PRODUCT_INFO;
 
+/**
+ A prototype for the GetQueuedCompletionStatus function.
+ */
+typedef
+BOOL WINAPI
+GET_QUEUED_COMPLETION_STATUS(HANDLE, LPDWORD, PDWORD_PTR, LPOVERLAPPED *, DWORD);
+
+/**
+ A prototype for a pointer to the GetQueuedCompletionStatus function.
+ */
+typedef GET_QUEUED_COMPLETION_STATUS *PGET_QUEUED_COMPLETION_STATUS;
+
 /**
  A prototype for the GetSystemPowerStatus function.
  */
@@ -8115,50 +8907,98 @@ OPEN_THREAD(DWORD, BOOL, DWORD);
 typedef OPEN_THREAD *POPEN_THREAD;
 
 /**
- A prototype for the QueryFullProcessImageNameW function.
+ A prototype for the PostQueuedCompletionStatus function.
  */
 typedef
 BOOL WINAPI
-QUERY_FULL_PROCESS_IMAGE_NAMEW(HANDLE, DWORD, LPTSTR, PDWORD);
+POST_QUEUED_COMPLETION_STATUS(HANDLE, DWORD, DWORD_PTR, LPOVERLAPPED);
 
 /**
- A prototype for a pointer to the the QueryFullProcessImageNameW function.
+ A prototype for a pointer to the PostQueuedCompletionStatus function.
  */
-typedef QUERY_FULL_PROCESS_IMAGE_NAMEW *PQUERY_FULL_PROCESS_IMAGE_NAMEW;
+typedef POST_QUEUED_COMPLETION_STATUS *PPOST_QUEUED_COMPLETION_STATUS;
 
 /**
- A prototype for the QueryInformationJobObject function.
+ A prototype for the PssCaptureSnapshot function.
  */
 typedef
-BOOL WINAPI
-QUERY_INFORMATION_JOB_OBJECT(HANDLE, DWORD, PVOID, DWORD, LPDWORD);
+DWORD WINAPI
+PSS_CAPTURE_SNAPSHOT(HANDLE, DWORD, DWORD, PHANDLE);
 
 /**
- A prototype for a pointer to the QueryInformationJobObject function.
+ A prototype for a pointer to the PssCaptureSnapshot function.
  */
-typedef QUERY_INFORMATION_JOB_OBJECT *PQUERY_INFORMATION_JOB_OBJECT;
+typedef PSS_CAPTURE_SNAPSHOT *PPSS_CAPTURE_SNAPSHOT;
 
 /**
- A prototype for the RegisterApplicationRestart function.
+ A prototype for the PssFreeSnapshot function.
  */
 typedef
-LONG WINAPI
-REGISTER_APPLICATION_RESTART(LPCWSTR, DWORD);
+DWORD WINAPI
+PSS_FREE_SNAPSHOT(HANDLE, HANDLE);
 
 /**
- A prototype for a pointer to the RegisterApplicationRestart function.
+ A prototype for a pointer to the PssFreeSnapshot function.
  */
-typedef REGISTER_APPLICATION_RESTART *PREGISTER_APPLICATION_RESTART;
+typedef PSS_FREE_SNAPSHOT *PPSS_FREE_SNAPSHOT;
 
 /**
- A prototype for the ReplaceFileW function.
+ A prototype for the QueryFullProcessImageNameW function.
  */
 typedef
 BOOL WINAPI
-REPLACE_FILEW(LPCWSTR, LPCWSTR, LPCWSTR, DWORD, LPVOID, LPVOID);
+QUERY_FULL_PROCESS_IMAGE_NAMEW(HANDLE, DWORD, LPTSTR, PDWORD);
 
 /**
- A prototype for a pointer to the ReplaceFileW function.
+ A prototype for a pointer to the the QueryFullProcessImageNameW function.
+ */
+typedef QUERY_FULL_PROCESS_IMAGE_NAMEW *PQUERY_FULL_PROCESS_IMAGE_NAMEW;
+
+/**
+ A prototype for the QueryInformationJobObject function.
+ */
+typedef
+BOOL WINAPI
+QUERY_INFORMATION_JOB_OBJECT(HANDLE, DWORD, PVOID, DWORD, LPDWORD);
+
+/**
+ A prototype for a pointer to the QueryInformationJobObject function.
+ */
+typedef QUERY_INFORMATION_JOB_OBJECT *PQUERY_INFORMATION_JOB_OBJECT;
+
+/**
+ A prototype for the ReadDirectoryChangesW function.
+ */
+typedef
+BOOL WINAPI
+READ_DIRECTORY_CHANGESW(HANDLE, LPVOID, DWORD, BOOL, DWORD, LPDWORD, LPOVERLAPPED, LPOVERLAPPED_COMPLETION_ROUTINE);
+
+/**
+ A prototype for a pointer to the ReadDirectoryChangesW function.
+ */
+typedef READ_DIRECTORY_CHANGESW *PREAD_DIRECTORY_CHANGESW;
+
+/**
+ A prototype for the RegisterApplicationRestart function.
+ */
+typedef
+LONG WINAPI
+REGISTER_APPLICATION_RESTART(LPCWSTR, DWORD);
+
+/**
+ A prototype for a pointer to the RegisterApplicationRestart function.
+ */
+typedef REGISTER_APPLICATION_RESTART *PREGISTER_APPLICATION_RESTART;
+
+/**
+ A prototype for the ReplaceFileW function.
+ */
+typedef
+BOOL WINAPI
+REPLACE_FILEW(LPCWSTR, LPCWSTR, LPCWSTR, DWORD, LPVOID, LPVOID);
+
+/**
+ A prototype for a pointer to the ReplaceFileW function.
  */
 typedef REPLACE_FILEW *PREPLACE_FILEW;
 
@@ -8258,6 +9098,18 @@ SET_SYSTEM_POWER_STATE(BOOL, BOOL);
  */
 typedef SET_SYSTEM_POWER_STATE *PSET_SYSTEM_POWER_STATE;
 
+/**
+ A prototype for the WritePrivateProfileSectionW function.
+ */
+typedef
+BOOL WINAPI
+WRITE_PRIVATE_PROFILE_SECTIONW(LPCWSTR, LPCWSTR, LPCWSTR);
+
+/**
+ A prototype for a pointer to the WritePrivateProfileSectionW function.
+ */
+typedef WRITE_PRIVATE_PROFILE_SECTIONW *PWRITE_PRIVATE_PROFILE_SECTIONW;
+
 /**
  A prototype for the WritePrivateProfileStringW function.
  */
@@ -8352,6 +9204,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PCREATE_HARD_LINKW pCreateHardLinkW;
 
+    /**
+     If it's available on the current system, a pointer to CreateIoCompletionPort.
+     */
+    PCREATE_IO_COMPLETION_PORT pCreateIoCompletionPort;
+
     /**
      If it's available on the current system, a pointer to CreateJobObjectW.
      */
@@ -8362,6 +9219,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PCREATE_SYMBOLIC_LINKW pCreateSymbolicLinkW;
 
+    /**
+     If it's available on the current system, a pointer to FindFirstFileExW.
+     */
+    PFIND_FIRST_FILE_EXW pFindFirstFileExW;
+
     /**
      If it's available on the current system, a pointer to FindFirstStreamW.
      */
@@ -8477,6 +9339,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PGET_NATIVE_SYSTEM_INFO pGetNativeSystemInfo;
 
+    /**
+     If it's available on the current system, a pointer to GetNumaNodeProcessorMask.
+     */
+    PGET_NUMA_NODE_PROCESSOR_MASK pGetNumaNodeProcessorMask;
+
     /**
      If it's available on the current system, a pointer to GetPrivateProfileIntW.
      */
@@ -8507,6 +9374,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PGET_PRODUCT_INFO pGetProductInfo;
 
+    /**
+     If it's available on the current system, a pointer to GetQueuedCompletionStatus.
+     */
+    PGET_QUEUED_COMPLETION_STATUS pGetQueuedCompletionStatus;
+
     /**
      If it's available on the current system, a pointer to GetSystemPowerStatus.
      */
@@ -8587,6 +9459,21 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     POPEN_THREAD pOpenThread;
 
+    /**
+     If it's available on the current system, a pointer to PostQueuedCompletionStatus.
+     */
+    PPOST_QUEUED_COMPLETION_STATUS pPostQueuedCompletionStatus;
+
+    /**
+     If it's available on the current system, a pointer to PssCaptureSnapshot.
+     */
+    PPSS_CAPTURE_SNAPSHOT pPssCaptureSnapshot;
+
+    /**
+     If it's available on the current system, a pointer to PssFreeSnapshot.
+     */
+    PPSS_FREE_SNAPSHOT pPssFreeSnapshot;
+
     /**
      If it's available on the current system, a pointer to QueryFullProcessImageNameW.
      */
@@ -8597,6 +9484,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PQUERY_INFORMATION_JOB_OBJECT pQueryInformationJobObject;
 
+    /**
+     If it's available on the current system, a pointer to ReadDirectoryChangesW.
+     */
+    PREAD_DIRECTORY_CHANGESW pReadDirectoryChangesW;
+
     /**
      If it's available on the current system, a pointer to RegisterApplicationRestart.
      */
@@ -8647,6 +9539,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PSET_SYSTEM_POWER_STATE pSetSystemPowerState;
 
+    /**
+     If it's available on the current system, a pointer to WritePrivateProfileSectionW.
+     */
+    PWRITE_PRIVATE_PROFILE_SECTIONW pWritePrivateProfileSectionW;
+
     /**
      If it's available on the current system, a pointer to WritePrivateProfileStringW.
      */
@@ -8814,6 +9711,149 @@ CRYPT_RELEASE_CONTEXT(DWORD_PTR, DWORD);
  */
 typedef CRYPT_RELEASE_CONTEXT *PCRYPT_RELEASE_CONTEXT;
 
+/**
+ A description of an event written to an ETW provider.  This is a local
+ definition of EVENT_DESCRIPTOR, which is not present in older SDKs.
+ */
+typedef struct _YORI_EVENT_DESCRIPTOR {
+
+    /**
+     An identifier for the event.  TraceLogging events use zero and are
+     identified by name instead.
+     */
+    USHORT Id;
+
+    /**
+     The version of the event.
+     */
+    UCHAR Version;
+
+    /**
+     The channel to log the event to.
+     */
+    UCHAR Channel;
+
+    /**
+     The severity of the event.
+     */
+    UCHAR Level;
+
+    /**
+     The operation being described, such as the start or end of an activity.
+     */
+    UCHAR Opcode;
+
+    /**
+     The task the event is part of.
+     */
+    USHORT Task;
+
+    /**
+     A bitmask of categories that the event belongs to.
+     */
+    DWORDLONG Keyword;
+} YORI_EVENT_DESCRIPTOR, *PYORI_EVENT_DESCRIPTOR;
+
+/**
+ A pointer to a constant event descriptor.
+ */
+typedef YORI_EVENT_DESCRIPTOR CONST *PCYORI_EVENT_DESCRIPTOR;
+
+/**
+ A description of one block of data supplied with an ETW event.  This is a
+ local definition of EVENT_DATA_DESCRIPTOR.
+ */
+typedef struct _YORI_EVENT_DATA_DESCRIPTOR {
+
+    /**
+     Pointer to the data, always expressed as a 64 bit value.
+     */
+    DWORDLONG Ptr;
+
+    /**
+     The number of bytes of data.
+     */
+    ULONG Size;
+
+    /**
+     Indicates whether the data is an event payload, event metadata, or
+     provider metadata.
+     */
+    UCHAR Type;
+
+    /**
+     Reserved, must be zero.
+     */
+    UCHAR Reserved1;
+
+    /**
+     Reserved, must be zero.
+     */
+    USHORT Reserved2;
+} YORI_EVENT_DATA_DESCRIPTOR, *PYORI_EVENT_DATA_DESCRIPTOR;
+
+/**
+ Prototype for a callback invoked when an ETW consumer enables or disables
+ a provider.
+ */
+typedef
+VOID WINAPI
+YORI_ETW_ENABLE_CALLBACK(CONST GUID *, ULONG, UCHAR, DWORDLONG, DWORDLONG, PVOID, PVOID);
+
+/**
+ Prototype for a pointer to a callback invoked when an ETW consumer enables
+ or disables a provider.
+ */
+typedef YORI_ETW_ENABLE_CALLBACK *PYORI_ETW_ENABLE_CALLBACK;
+
+/**
+ Prototype for the EventRegister function.
+ */
+typedef
+ULONG WINAPI
+EVENT_REGISTER(CONST GUID *, PYORI_ETW_ENABLE_CALLBACK, PVOID, PDWORDLONG);
+
+/**
+ Prototype for a pointer to the EventRegister function.
+ */
+typedef EVENT_REGISTER *PEVENT_REGISTER;
+
+/**
+ Prototype for the EventSetInformation function.
+ */
+typedef
+ULONG WINAPI
+EVENT_SET_INFORMATION(DWORDLONG, DWORD, PVOID, ULONG);
+
+/**
+ Prototype for a pointer to the EventSetInformation function.
+ */
+typedef EVENT_SET_INFORMATION *PEVENT_SET_INFORMATION;
+
+/**
+ Prototype for the EventUnregister function.
+ */
+typedef
+ULONG WINAPI
+EVENT_UNREGISTER(DWORDLONG);
+
+/**
+ Prototype for a pointer to the EventUnregister function.
+ */
+typedef EVENT_UNREGISTER *PEVENT_UNREGISTER;
+
+/**
+ Prototype for the EventWriteTransfer function.
+ */
+typedef
+ULONG WINAPI
+EVENT_WRITE_TRANSFER(DWORDLONG, PCYORI_EVENT_DESCRIPTOR, CONST GUID *, CONST GUID *, ULONG, PYORI_EVENT_DATA_DESCRIPTOR);
+
+/**
+ Prototype for a pointer to the EventWriteTransfer function.
+ */
+typedef EVENT_WRITE_TRANSFER *PEVENT_WRITE_TRANSFER;
+
 /**
  Prototype for the FreeSid function.
  */
@@ -8982,6 +10022,18 @@ REG_CLOSE_KEY(HANDLE);
  */
 typedef REG_CLOSE_KEY *PREG_CLOSE_KEY;
 
+/**
+ A prototype for the RegCopyTreeW function.
+ */
+typedef
+LONG WINAPI
+REG_COPY_TREEW(HKEY, LPCWSTR, HKEY);
+
+/**
+ A prototype for a pointer to the RegCopyTreeW function.
+ */
+typedef REG_COPY_TREEW *PREG_COPY_TREEW;
+
 /**
  A prototype for the RegCreateKeyExW function.
  */
@@ -9244,6 +10296,26 @@ typedef struct _YORI_ADVAPI32_FUNCTIONS {
      */
     PCRYPT_RELEASE_CONTEXT pCryptReleaseContext;
 
+    /**
+     If it's available on the current system, a pointer to EventRegister.
+     */
+    PEVENT_REGISTER pEventRegister;
+
+    /**
+     If it's available on the current system, a pointer to EventSetInformation.
+     */
+    PEVENT_SET_INFORMATION pEventSetInformation;
+
+    /**
+     If it's available on the current system, a pointer to EventUnregister.
+     */
+    PEVENT_UNREGISTER pEventUnregister;
+
+    /**
+     If it's available on the current system, a pointer to EventWriteTransfer.
+     */
+    PEVENT_WRITE_TRANSFER pEventWriteTransfer;
+
     /**
      If it's available on the current system, a pointer to FreeSid.
      */
@@ -9314,6 +10386,11 @@ typedef struct _YORI_ADVAPI32_FUNCTIONS {
      */
     PREG_CLOSE_KEY pRegCloseKey;
 
+    /**
+     If it's available on the current system, a pointer to RegCopyTreeW.
+     */
+    PREG_COPY_TREEW pRegCopyTreeW;
+
     /**
      If it's available on the current system, a pointer to RegCreateKeyExW.
      */
@@ -9395,6 +10472,141 @@ typedef struct _YORI_ADVAPI32_FUNCTIONS {
 
 extern YORI_ADVAPI32_FUNCTIONS DllAdvApi32;
 
+/**
+ A prototype for the BCryptCloseAlgorithmProvider function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_CLOSE_ALGORITHM_PROVIDER(PVOID, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptCloseAlgorithmProvider function.
+ */
+typedef BCRYPT_CLOSE_ALGORITHM_PROVIDER *PBCRYPT_CLOSE_ALGORITHM_PROVIDER;
+
+/**
+ A prototype for the BCryptCreateHash function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_CREATE_HASH(PVOID, PVOID *, PUCHAR, DWORD, PUCHAR, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptCreateHash function.
+ */
+typedef BCRYPT_CREATE_HASH *PBCRYPT_CREATE_HASH;
+
+/**
+ A prototype for the BCryptDestroyHash function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_DESTROY_HASH(PVOID);
+
+/**
+ A prototype for a pointer to the BCryptDestroyHash function.
+ */
+typedef BCRYPT_DESTROY_HASH *PBCRYPT_DESTROY_HASH;
+
+/**
+ A prototype for the BCryptFinishHash function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_FINISH_HASH(PVOID, PUCHAR, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptFinishHash function.
+ */
+typedef BCRYPT_FINISH_HASH *PBCRYPT_FINISH_HASH;
+
+/**
+ A prototype for the BCryptGetProperty function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_GET_PROPERTY(PVOID, LPCWSTR, PUCHAR, DWORD, PDWORD, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptGetProperty function.
+ */
+typedef BCRYPT_GET_PROPERTY *PBCRYPT_GET_PROPERTY;
+
+/**
+ A prototype for the BCryptHashData function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_HASH_DATA(PVOID, PUCHAR, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptHashData function.
+ */
+typedef BCRYPT_HASH_DATA *PBCRYPT_HASH_DATA;
+
+/**
+ A prototype for the BCryptOpenAlgorithmProvider function.
+ */
+typedef
+LONG WINAPI
+BCRYPT_OPEN_ALGORITHM_PROVIDER(PVOID *, LPCWSTR, LPCWSTR, DWORD);
+
+/**
+ A prototype for a pointer to the BCryptOpenAlgorithmProvider function.
+ */
+typedef BCRYPT_OPEN_ALGORITHM_PROVIDER *PBCRYPT_OPEN_ALGORITHM_PROVIDER;
+
+/**
+ A structure containing optional function pointers to bcrypt.dll exported
+ functions which programs can operate without having hard dependencies on.
+ */
+typedef struct _YORI_BCRYPT_FUNCTIONS {
+    /**
+     A handle to the Dll module.
+     */
+    HINSTANCE hDll;
+
+    /**
+     If it's available on the current system, a pointer to
+     BCryptCloseAlgorithmProvider.
+     */
+    PBCRYPT_CLOSE_ALGORITHM_PROVIDER pBCryptCloseAlgorithmProvider;
+
+    /**
+     If it's available on the current system, a pointer to BCryptCreateHash.
+     */
+    PBCRYPT_CREATE_HASH pBCryptCreateHash;
+
+    /**
+     If it's available on the current system, a pointer to BCryptDestroyHash.
+     */
+    PBCRYPT_DESTROY_HASH pBCryptDestroyHash;
+
+    /**
+     If it's available on the current system, a pointer to BCryptFinishHash.
+     */
+    PBCRYPT_FINISH_HASH pBCryptFinishHash;
+
+    /**
+     If it's available on the current system, a pointer to BCryptGetProperty.
+     */
+    PBCRYPT_GET_PROPERTY pBCryptGetProperty;
+
+    /**
+     If it's available on the current system, a pointer to BCryptHashData.
+     */
+    PBCRYPT_HASH_DATA pBCryptHashData;
+
+    /**
+     If it's available on the current system, a pointer to
+     BCryptOpenAlgorithmProvider.
+     */
+    PBCRYPT_OPEN_ALGORITHM_PROVIDER pBCryptOpenAlgorithmProvider;
+
+} YORI_BCRYPT_FUNCTIONS, *PYORI_BCRYPT_FUNCTIONS;
+
+extern YORI_BCRYPT_FUNCTIONS DllBCrypt;
+
 /**
  A prototype for the FDICreate function.
  */
@@ -9673,6 +10885,68 @@ MINI_DUMP_WRITE_DUMP(HANDLE, DWORD, HANDLE, DWORD, PVOID, PVOID, PVOID);
  */
 typedef MINI_DUMP_WRITE_DUMP *PMINI_DUMP_WRITE_DUMP;
 
+/**
+ The callback type asking whether the handle passed to MiniDumpWriteDump
+ refers to a process snapshot rather than a process.
+ */
+#define YORI_MINIDUMP_IS_PROCESS_SNAPSHOT_CALLBACK (16)
+
+#pragma pack(push, 4)
+
+/**
+ The leading fields of the information passed to a MiniDumpWriteDump
+ callback.  The remainder of the structure depends on CallbackType and is
+ not described here.
+ */
+typedef struct _YORI_MINIDUMP_CALLBACK_INPUT {
+
+    /**
+     The identifier of the process being dumped.
+     */
+    ULONG ProcessId;
+
+    /**
+     The handle passed to MiniDumpWriteDump.
+     */
+    HANDLE ProcessHandle;
+
+    /**
+     The type of the callback.
+     */
+    ULONG CallbackType;
+} YORI_MINIDUMP_CALLBACK_INPUT, *PYORI_MINIDUMP_CALLBACK_INPUT;
+
+/**
+ The leading field of the information returned from a MiniDumpWriteDump
+ callback.  This is a union in the full definition, and only the status
+ result is described here.
+ */
+typedef struct _YORI_MINIDUMP_CALLBACK_OUTPUT {
+
+    /**
+     The result of the callback, for callback types that return one.
+     */
+    HRESULT Status;
+} YORI_MINIDUMP_CALLBACK_OUTPUT, *PYORI_MINIDUMP_CALLBACK_OUTPUT;
+
+/**
+ A callback to invoke while writing a minidump.
+ */
+typedef struct _YORI_MINIDUMP_CALLBACK_INFORMATION {
+
+    /**
+     Pointer to the callback function.
+     */
+    PVOID CallbackRoutine;
+
+    /**
+     A context to pass to the callback function.
+     */
+    PVOID CallbackParam;
+} YORI_MINIDUMP_CALLBACK_INFORMATION, *PYORI_MINIDUMP_CALLBACK_INFORMATION;
+
+#pragma pack(pop)
+
 /**
  A structure containing optional function pointers to dbghelp.dll exported
  functions which programs can operate without having hard dependencies on.
@@ -10596,6 +11870,31 @@ SET_TASKMAN_WINDOW(HWND);
  */
 typedef SET_TASKMAN_WINDOW *PSET_TASKMAN_WINDOW;
 
+/**
+ A prototype for a callback function invoked by SetWinEventHook.
+ */
+typedef
+VOID CALLBACK
+YORI_WIN_EVENT_PROC(HANDLE, DWORD, HWND, LONG, LONG, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to a callback function invoked by
+ SetWinEventHook.
+ */
+typedef YORI_WIN_EVENT_PROC *PYORI_WIN_EVENT_PROC;
+
+/**
+ A prototype for the SetWinEventHook function.
+ */
+typedef
+HANDLE WINAPI
+SET_WIN_EVENT_HOOK(DWORD, DWORD, HMODULE, PYORI_WIN_EVENT_PROC, DWORD, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to the SetWinEventHook function.
+ */
+typedef SET_WIN_EVENT_HOOK *PSET_WIN_EVENT_HOOK;
+
 /**
  A prototype for the SetWindowPos function.
  */
@@ -10668,6 +11967,18 @@ TILE_WINDOWS(HWND, UINT, RECT*, UINT, HWND*);
  */
 typedef TILE_WINDOWS *PTILE_WINDOWS;
 
+/**
+ A prototype for the UnhookWinEvent function.
+ */
+typedef
+BOOL WINAPI
+UNHOOK_WIN_EVENT(HANDLE);
+
+/**
+ A prototype for a pointer to the UnhookWinEvent function.
+ */
+typedef UNHOOK_WIN_EVENT *PUNHOOK_WIN_EVENT;
+
 /**
  A structure containing optional function pointers to user32.dll exported
  functions which programs can operate without having hard dependencies on.
@@ -10863,6 +12174,11 @@ typedef struct _YORI_USER32_FUNCTIONS {
      */
     PSET_TASKMAN_WINDOW pSetTaskmanWindow;
 
+    /**
+     If it's available on the current system, a pointer to SetWinEventHook.
+     */
+    PSET_WIN_EVENT_HOOK pSetWinEventHook;
+
     /**
      If it's available on the current system, a pointer to SetWindowPos.
      */
@@ -10893,6 +12209,11 @@ typedef struct _YORI_USER32_FUNCTIONS {
      */
     PTILE_WINDOWS pTileWindows;
 
+    /**
+     If it's available on the current system, a pointer to UnhookWinEvent.
+     */
+    PUNHOOK_WIN_EVENT pUnhookWinEvent;
+
 } YORI_USER32_FUNCTIONS, *PYORI_USER32_FUNCTIONS;
 
 extern YORI_USER32_FUNCTIONS DllUser32;
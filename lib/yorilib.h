@@ -194,6 +194,47 @@ typedef struct _YORI_LIB_BYTE_BUFFER {
 
 } YORI_LIB_BYTE_BUFFER, *PYORI_LIB_BYTE_BUFFER;
 
+/**
+ A buffer for a single data stream which is composed of a list of separate
+ allocations, so that growing the buffer never moves data that has already
+ been written.
+ */
+typedef struct _YORI_LIB_CHUNK_BUFFER {
+
+    /**
+     The list of allocations that make up the buffer.
+     */
+    YORI_LIST_ENTRY Chunks;
+
+    /**
+     The chunk that new data is being written to, or NULL if no data has
+     been written.  Any chunks after this one are empty.
+     */
+    PYORI_LIST_ENTRY CurrentChunk;
+
+    /**
+     The chunk that satisfied the most recent request for valid data, so
+     that sequential requests do not need to scan from the beginning.
+     */
+    PYORI_LIST_ENTRY LookupChunk;
+
+    /**
+     The offset within the stream of the first byte of LookupChunk.
+     */
+    YORI_MAX_UNSIGNED_T LookupChunkOffset;
+
+    /**
+     The number of bytes populated with data across all chunks.
+     */
+    YORI_MAX_UNSIGNED_T BytesPopulated;
+
+    /**
+     The number of bytes to allocate each time the buffer is extended.
+     */
+    YORI_ALLOC_SIZE_T ChunkSize;
+
+} YORI_LIB_CHUNK_BUFFER, *PYORI_LIB_CHUNK_BUFFER;
+
 /**
  A structure describing an entry that is an element of a hash table.
  */
@@ -243,6 +284,243 @@ typedef struct _YORI_HASH_TABLE {
     PYORI_HASH_BUCKET Buckets;
 } YORI_HASH_TABLE, *PYORI_HASH_TABLE;
 
+/**
+ A structure describing a slot in a growable hash table.  The hash of the
+ key is stored alongside a pointer to the entry so that most slots which
+ do not match can be skipped without comparing strings.
+ */
+typedef struct _YORI_GROWABLE_HASH_SLOT {
+
+    /**
+     The 32 bit hash of the key of the entry in this slot.
+     */
+    DWORD Hash;
+
+    /**
+     Pointer to the entry in this slot, or NULL if the slot is empty.
+     */
+    PYORI_HASH_ENTRY Entry;
+} YORI_GROWABLE_HASH_SLOT, *PYORI_GROWABLE_HASH_SLOT;
+
+/**
+ A structure describing a growable hash table.  Entries are stored in an
+ array of slots using linear probing, and the array is doubled in size
+ when it becomes three quarters full.  Entries use the same structure as
+ other hash tables, but the ListEntry member is not used.
+ */
+typedef struct _YORI_GROWABLE_HASH_TABLE {
+
+    /**
+     The number of slots in the hash table.  This is always a power of
+     two.
+     */
+    YORI_ALLOC_SIZE_T NumberSlots;
+
+    /**
+     The number of entries currently inserted into the hash table.
+     */
+    YORI_ALLOC_SIZE_T NumberEntries;
+
+    /**
+     The base 2 logarithm of NumberSlots.
+     */
+    DWORD SlotBits;
+
+    /**
+     An array of NumberSlots slots.
+     */
+    PYORI_GROWABLE_HASH_SLOT Slots;
+} YORI_GROWABLE_HASH_TABLE, *PYORI_GROWABLE_HASH_TABLE;
+
+/**
+ A pool of unique strings.  Each distinct string is stored once, and
+ callers receive referenced copies which share the pooled storage.
+ */
+typedef struct _YORI_LIB_STRING_POOL {
+
+    /**
+     The number of buckets.  This is always a power of two.
+     */
+    YORI_ALLOC_SIZE_T NumberBuckets;
+
+    /**
+     The number of unique strings in the pool.
+     */
+    YORI_ALLOC_SIZE_T NumberEntries;
+
+    /**
+     The number of characters stored in the pool.
+     */
+    YORI_MAX_UNSIGNED_T CharsStored;
+
+    /**
+     The number of characters that were satisfied from an existing string
+     in the pool rather than requiring a new allocation.
+     */
+    YORI_MAX_UNSIGNED_T CharsShared;
+
+    /**
+     An array of NumberBuckets singly linked chains of entries.
+     */
+    struct _YORI_LIB_STRING_POOL_ENTRY ** Buckets;
+} YORI_LIB_STRING_POOL, *PYORI_LIB_STRING_POOL;
+
+/**
+ A single item of work to be performed by a work queue.  Callers embed this
+ in a larger structure describing the work.
+ */
+typedef struct _YORILIB_WORK_ITEM {
+
+    /**
+     The link within the list of items waiting to be processed.
+     */
+    YORI_LIST_ENTRY PendingList;
+} YORILIB_WORK_ITEM, *PYORILIB_WORK_ITEM;
+
+/**
+ A function to process a single item of work.  This is invoked on a worker
+ thread, and is responsible for freeing the item.
+
+ @param Context The context that was supplied when the work queue was
+        initialized.
+
+ @param Item Pointer to the item to process.
+
+ @param Cancelled If TRUE, the operation has been cancelled, and the item
+        should be freed without performing the work.
+ */
+typedef
+VOID
+YORILIB_WORK_ITEM_FN(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    );
+
+/**
+ A pointer to a function to process a single item of work.
+ */
+typedef YORILIB_WORK_ITEM_FN *PYORILIB_WORK_ITEM_FN;
+
+/**
+ A pool of threads processing a bounded queue of work items.
+ */
+typedef struct _YORILIB_WORK_QUEUE {
+
+    /**
+     The list of items waiting to be processed.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     A mutex to synchronize the list and counters.
+     */
+    HANDLE Mutex;
+
+    /**
+     A semaphore signalled once for each item inserted into the list.
+     */
+    HANDLE WorkerWaitSemaphore;
+
+    /**
+     An event signalled when worker threads should complete outstanding
+     work then terminate.  This must immediately follow WorkerWaitSemaphore
+     so that workers can wait on both.
+     */
+    HANDLE WorkerShutdownEvent;
+
+    /**
+     An event signalled when the list has space for more items.
+     */
+    HANDLE SpaceAvailableEvent;
+
+    /**
+     An event signalled when no items are queued or being processed.
+     */
+    HANDLE IdleEvent;
+
+    /**
+     An array of handles to worker threads.
+     */
+    PHANDLE Threads;
+
+    /**
+     The function to invoke on each item.
+     */
+    PYORILIB_WORK_ITEM_FN Function;
+
+    /**
+     The context to pass to Function.
+     */
+    PVOID Context;
+
+    /**
+     The maximum number of worker threads.  This corresponds to the size of
+     the Threads array.
+     */
+    YORI_ALLOC_SIZE_T MaxThreads;
+
+    /**
+     The number of worker threads created.  This is less than or equal to
+     MaxThreads.
+     */
+    YORI_ALLOC_SIZE_T ThreadsAllocated;
+
+    /**
+     The maximum number of items that can be waiting in the list.
+     */
+    YORI_ALLOC_SIZE_T MaxItemsQueued;
+
+    /**
+     The number of items currently waiting in the list.
+     */
+    YORI_ALLOC_SIZE_T ItemsQueued;
+
+    /**
+     The number of items waiting in the list or being processed.
+     */
+    YORI_ALLOC_SIZE_T ItemsOutstanding;
+
+    /**
+     Set to TRUE once the operation has been cancelled.  Items processed
+     after this point are passed to Function as cancelled.
+     */
+    BOOLEAN Cancelled;
+} YORILIB_WORK_QUEUE, *PYORILIB_WORK_QUEUE;
+
+/**
+ State used to calculate a fast non-cryptographic 64 bit hash over data
+ supplied in any number of pieces.
+ */
+typedef struct _YORILIB_XXHASH64_CONTEXT {
+
+    /**
+     The four accumulators, each of which processes one 64 bit lane of each
+     32 byte stripe.
+     */
+    DWORDLONG Accumulator[4];
+
+    /**
+     The total number of bytes added to the hash.
+     */
+    DWORDLONG TotalLength;
+
+    /**
+     The seed the hash was initialized with.
+     */
+    DWORDLONG Seed;
+
+    /**
+     A partial stripe which has not yet been processed.
+     */
+    UCHAR Buffer[32];
+
+    /**
+     The number of bytes in Buffer.
+     */
+    DWORD BufferLength;
+} YORILIB_XXHASH64_CONTEXT, *PYORILIB_XXHASH64_CONTEXT;
+
 #pragma pack(push, 1)
 
 /**
@@ -298,6 +576,152 @@ typedef enum {
     YoriLibCompressionXpress16k
 } YoriLibCompressionAlgorithms;
 
+/**
+ Set in a metadata cache record's ValidFields if the fields derived from the
+ executable's PE headers are valid.
+ */
+#define YORILIB_METADATA_CACHE_PE_HEADERS 0x00000001
+
+/**
+ Set in a metadata cache record's ValidFields if the fields derived from the
+ executable's version resource are valid.
+ */
+#define YORILIB_METADATA_CACHE_VERSION    0x00000002
+
+/**
+ Information about a file which is expensive to collect and is retained in
+ a persistent cache.  This structure is written to disk, so changes to it
+ invalidate existing caches.
+ */
+typedef struct _YORILIB_METADATA_CACHE_RECORD {
+
+    /**
+     The file system's identifier for the file.
+     */
+    LARGE_INTEGER FileId;
+
+    /**
+     The time the file was last written when this record was populated.
+     */
+    LARGE_INTEGER LastWriteTime;
+
+    /**
+     The version of the executable from its version resource.
+     */
+    LARGE_INTEGER FileVersion;
+
+    /**
+     A combination of YORILIB_METADATA_CACHE_* flags indicating which groups
+     of fields are populated.
+     */
+    DWORD ValidFields;
+
+    /**
+     The flags from the executable's version resource.
+     */
+    DWORD FileVersionFlags;
+
+    /**
+     The CPU architecture the executable was built for.
+     */
+    WORD Architecture;
+
+    /**
+     The subsystem the executable was built for.
+     */
+    WORD Subsystem;
+
+    /**
+     The major subsystem version of the executable.
+     */
+    WORD OsVersionHigh;
+
+    /**
+     The minor subsystem version of the executable.
+     */
+    WORD OsVersionLow;
+
+    /**
+     The file description from the executable's version resource.
+     */
+    TCHAR Description[65];
+
+    /**
+     The file version string from the executable's version resource.
+     */
+    TCHAR FileVersionString[33];
+} YORILIB_METADATA_CACHE_RECORD, *PYORILIB_METADATA_CACHE_RECORD;
+
+/**
+ A persistent cache of file metadata, stored as one file per volume.
+ Volumes are loaded when a file on them is first looked up.
+ */
+typedef struct _YORILIB_METADATA_CACHE {
+
+    /**
+     The directory containing cache files.
+     */
+    YORI_STRING Directory;
+
+    /**
+     A list of volumes which have been loaded.
+     */
+    YORI_LIST_ENTRY Volumes;
+} YORILIB_METADATA_CACHE, *PYORILIB_METADATA_CACHE;
+
+/**
+ State shared by the collection functions while information about a single
+ file is being captured.  Many collectors need a handle to the file, and
+ opening the file once for all of them is much cheaper than opening it once
+ per collector.  The access mask is retained across files so that once any
+ file has required a given access, later files are opened once with every
+ access they are likely to need.
+ */
+typedef struct _YORILIB_COLLECT_SESSION {
+
+    /**
+     A handle to the file currently being collected, or NULL if no handle
+     has been opened for it yet.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The access that FileHandle was opened with.
+     */
+    DWORD HandleAccess;
+
+    /**
+     The union of all access that collectors have requested.  This is not
+     reset between files.
+     */
+    DWORD DesiredAccess;
+
+    /**
+     Set to TRUE if opening the current file with DesiredAccess failed.  In
+     this case collectors open private handles with only the access they
+     need, since the file may permit some access but not others.
+     */
+    BOOLEAN SharedOpenFailed;
+
+    /**
+     Set to TRUE once CacheRecord has been looked up for the current file,
+     so that it is looked up at most once even if no record is available.
+     */
+    BOOLEAN CacheRecordLookedUp;
+
+    /**
+     Optionally points to a persistent cache used to avoid re-parsing
+     executables that have not changed since they were last seen.
+     */
+    PYORILIB_METADATA_CACHE MetadataCache;
+
+    /**
+     The record within MetadataCache for the current file, or NULL if the
+     record has not been looked up or is not available.
+     */
+    PYORILIB_METADATA_CACHE_RECORD CacheRecord;
+} YORILIB_COLLECT_SESSION, *PYORILIB_COLLECT_SESSION;
+
 /**
  Information about a single file.  This is typically only partially populated
  depending on the information of interest to the user.  Note this is expected
@@ -465,16 +889,24 @@ typedef struct _YORI_FILE_INFO {
     TCHAR         ShortFileName[14];
 
     /**
-     The file name, possibly including stream information.  This should really
-     be MAX_FILE_AND_STREAM_NAME characters.  Note this refers to file name
-     only, not path.
+     Pointer to the extension within the file name string.
      */
-    TCHAR         FileName[MAX_PATH];
+    TCHAR *       Extension;
 
     /**
-     Pointer to the extension within the file name string.
+     Pointer to a collection session that collectors can use to share a
+     handle to the file.  This is only valid while the entry is being
+     populated and is NULL otherwise.
      */
-    TCHAR *       Extension;
+    PYORILIB_COLLECT_SESSION Session;
+
+    /**
+     The file name, possibly including stream information.  This should really
+     be MAX_FILE_AND_STREAM_NAME characters.  Note this refers to file name
+     only, not path.  This is the final member so that callers storing many
+     entries can store only the characters used by the name.
+     */
+    TCHAR         FileName[MAX_PATH];
 } YORI_FILE_INFO, *PYORI_FILE_INFO;
 
 /**
@@ -620,6 +1052,63 @@ YoriLibByteBufferGetValidBytes(
     __in PYORI_LIB_BYTE_BUFFER Buffer
     );
 
+BOOL
+YoriLibChunkBufferInitialize(
+    __out PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T ChunkSize
+    );
+
+VOID
+YoriLibChunkBufferCleanup(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer
+    );
+
+VOID
+YoriLibChunkBufferReset(
+    __inout PYORI_LIB_CHUNK_BUFFER Buffer
+    );
+
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetPointerToEnd(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T MinimumLengthRequired,
+    __out_opt PYORI_ALLOC_SIZE_T BytesAvailable
+    );
+
+BOOLEAN
+YoriLibChunkBufferAddToPopulatedLength(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_ALLOC_SIZE_T NewBytesPopulated
+    );
+
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetPointerToValidData(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in YORI_MAX_UNSIGNED_T BufferOffset,
+    __out_opt PYORI_ALLOC_SIZE_T BytesAvailable
+    );
+
+__success(return != NULL)
+PUCHAR
+YoriLibChunkBufferGetNextValidData(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __inout PVOID * Context,
+    __out PYORI_ALLOC_SIZE_T BytesAvailable
+    );
+
+YORI_MAX_UNSIGNED_T
+YoriLibChunkBufferGetValidBytes(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer
+    );
+
+BOOLEAN
+YoriLibChunkBufferWriteToHandle(
+    __in PYORI_LIB_CHUNK_BUFFER Buffer,
+    __in HANDLE hTarget
+    );
+
 // *** CABINET.C ***
 
 /**
@@ -638,6 +1127,12 @@ YORI_LIB_CAB_EXPAND_FILE_CALLBACK(
  */
 typedef YORI_LIB_CAB_EXPAND_FILE_CALLBACK *PYORI_LIB_CAB_EXPAND_FILE_CALLBACK;
 
+/**
+ Flag to YoriLibExtractCab indicating that files should be written by a pool
+ of writer threads while decompression continues.
+ */
+#define YORI_LIB_CAB_EXTRACT_PARALLEL_WRITE (0x00000001)
+
 __success(return)
 BOOL
 YoriLibExtractCab(
@@ -651,6 +1146,7 @@ YoriLibExtractCab(
     __in_opt PYORI_LIB_CAB_EXPAND_FILE_CALLBACK CommenceExtractCallback,
     __in_opt PYORI_LIB_CAB_EXPAND_FILE_CALLBACK CompleteExtractCallback,
     __in_opt PVOID UserContext,
+    __in DWORD ExtractFlags,
     __inout_opt PDWORD ErrorCode,
     __inout_opt PYORI_STRING ErrorString
     );
@@ -988,11 +1484,18 @@ YoriLibQueryCpuCount(
 
 // *** CSHOT.C ***
 
+/**
+ Capture console contents as plain text, without escapes and without
+ trailing spaces on each line.
+ */
+#define YORILIB_REWRITE_CONSOLE_PLAIN_TEXT 0x0001
+
 BOOL
 YoriLibRewriteConsoleContents(
     __in HANDLE hTarget,
     __in DWORD LineCount,
-    __in DWORD SkipCount
+    __in DWORD SkipCount,
+    __in DWORD Flags
     );
 
 BOOL
@@ -1105,6 +1608,18 @@ typedef struct _YORILIB_HTML_GENERATE_CONTEXT {
      While parsing, TRUE if bold is in effect.
      */
     BOOLEAN BoldOn;
+
+    /**
+     If TRUE, HTML5 output refers to colors via CSS classes defined once in
+     the document header rather than specifying styles for each tag.
+     */
+    BOOLEAN UseClasses;
+
+    /**
+     While parsing, the Win32 color attribute of the currently open tag.
+     This is only meaningful if TagOpen is TRUE.
+     */
+    WORD CurrentColor;
 } YORILIB_HTML_GENERATE_CONTEXT, *PYORILIB_HTML_GENERATE_CONTEXT;
 
 extern DWORD YoriLibDefaultColorTable[];
@@ -1269,6 +1784,9 @@ YoriLibLoadKernel32Functions(VOID);
 BOOL
 YoriLibLoadAdvApi32Functions(VOID);
 
+BOOL
+YoriLibLoadBCryptFunctions(VOID);
+
 BOOL
 YoriLibLoadCabinetFunctions(VOID);
 
@@ -1410,6 +1928,41 @@ YoriLibRemoveEnvironmentComponent(
     __in PYORI_STRING ComponentToRemove
     );
 
+// *** ETW.C ***
+
+/**
+ An ETW event that describes a single point in time.
+ */
+#define YORI_ETW_OPCODE_INFO  (0)
+
+/**
+ An ETW event that marks the beginning of an activity.
+ */
+#define YORI_ETW_OPCODE_START (1)
+
+/**
+ An ETW event that marks the end of an activity.
+ */
+#define YORI_ETW_OPCODE_STOP  (2)
+
+__success(return)
+BOOL
+YoriLibEtwRegister(VOID);
+
+VOID
+YoriLibEtwUnregister(VOID);
+
+BOOL
+YoriLibEtwIsEnabled(VOID);
+
+VOID
+YoriLibEtwWriteEvent(
+    __in LPCSTR EventName,
+    __in UCHAR Opcode,
+    __in_opt PCYORI_STRING Detail,
+    __in DWORDLONG Value
+    );
+
 // *** FILECOMP.C ***
 
 /**
@@ -1434,36 +1987,99 @@ typedef union _YORILIB_COMPRESS_ALGORITHM {
 } YORILIB_COMPRESS_ALGORITHM;
 
 /**
- Context describing a background pool of threads and list of work that can
- compress individual files.
+ The maximum number of file extensions whose compression ratios are tracked
+ in order to skip files which are unlikely to benefit from compression.
  */
-typedef struct _YORILIB_COMPRESS_CONTEXT {
+#define YORILIB_COMPRESS_MAX_EXTENSIONS (64)
+
+/**
+ The maximum length of a file extension whose compression ratio can be
+ tracked, in characters, including a NULL terminator.
+ */
+#define YORILIB_COMPRESS_MAX_EXTENSION_LENGTH (8)
+
+/**
+ The compression ratio achieved by previous files with a particular
+ extension.
+ */
+typedef struct _YORILIB_COMPRESS_EXTENSION_STATS {
+
     /**
-     The list of files requiring compression.
+     The extension, not including the period, and NULL terminated.
      */
-    YORI_LIST_ENTRY PendingList;
+    TCHAR Extension[YORILIB_COMPRESS_MAX_EXTENSION_LENGTH];
 
     /**
-     A mutex to synchronize the list of files requiring compression.
+     The number of files with this extension that compression has been
+     attempted on.
      */
-    HANDLE Mutex;
+    DWORD FilesSampled;
 
     /**
-     An event signalled when there is a file to be compressed inserted into
-     the list.
+     The total size of files with this extension before compression.
      */
-    HANDLE WorkerWaitEvent;
+    DWORDLONG OriginalSize;
 
     /**
-     An event signalled when compression threads should complete outstanding
-     work then terminate.
+     The total size of files with this extension after compression.
      */
-    HANDLE WorkerShutdownEvent;
+    DWORDLONG CompressedSize;
+} YORILIB_COMPRESS_EXTENSION_STATS, *PYORILIB_COMPRESS_EXTENSION_STATS;
+
+/**
+ Counters describing the progress of a compress context.
+ */
+typedef struct _YORILIB_COMPRESS_PROGRESS {
 
     /**
-     An array of handles to threads allocated to compress file contents.
+     The number of files that have been compressed or decompressed.
      */
-    PHANDLE Threads;
+    DWORDLONG FilesProcessed;
+
+    /**
+     The number of files which were not compressed because they were already
+     compressed or were unlikely to benefit from compression.
+     */
+    DWORDLONG FilesSkipped;
+
+    /**
+     The number of files that could not be compressed or decompressed.
+     */
+    DWORDLONG FilesFailed;
+
+    /**
+     The total size of files that have been compressed or decompressed.
+     */
+    DWORDLONG BytesProcessed;
+
+    /**
+     The total size of files that have been compressed, after compression.
+     */
+    DWORDLONG BytesStored;
+
+    /**
+     The system time, in 100ns units, when the context was initialized.
+     */
+    LONGLONG StartTime;
+} YORILIB_COMPRESS_PROGRESS, *PYORILIB_COMPRESS_PROGRESS;
+
+/**
+ Context describing a background pool of threads and list of work that can
+ compress individual files.
+ */
+typedef struct _YORILIB_COMPRESS_CONTEXT {
+
+    /**
+     The queue of files requiring compression, processed by background
+     threads.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     A mutex synchronizing Progress and ExtensionStats, which are updated by
+     background threads.
+     */
+    HANDLE Mutex;
 
     /**
      If the target should be written as compressed, this specifies the
@@ -1472,27 +2088,37 @@ typedef struct _YORILIB_COMPRESS_CONTEXT {
     YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm;
 
     /**
-     The maximum number of compress threads.  This corresponds to the size of
-     the Threads array.
+     The number of threads to compress files with.  If zero when the
+     context is initialized, one thread is used for each processor.
      */
-    YORI_ALLOC_SIZE_T MaxThreads;
+    YORI_ALLOC_SIZE_T ThreadCount;
 
     /**
-     The number of threads allocated to compress file contents.  This is
-     less than or equal to MaxThreads.
+     Files smaller than this number of bytes are not compressed.  If zero
+     when the context is initialized, a default is used.
      */
-    YORI_ALLOC_SIZE_T ThreadsAllocated;
+    DWORD MinimumFileSize;
 
     /**
-     The number of items currently queued in the list.
+     The number of entries in ExtensionStats that are in use.
      */
-    YORI_ALLOC_SIZE_T ItemsQueued;
+    DWORD ExtensionCount;
 
     /**
-     If TRUE, output is generated describing thread creation and throttling.
+     If TRUE, output is generated describing throttling.
      */
     BOOL Verbose;
 
+    /**
+     Counters describing the files processed so far.
+     */
+    YORILIB_COMPRESS_PROGRESS Progress;
+
+    /**
+     The compression ratio achieved for each file extension so far.
+     */
+    YORILIB_COMPRESS_EXTENSION_STATS ExtensionStats[YORILIB_COMPRESS_MAX_EXTENSIONS];
+
 } YORILIB_COMPRESS_CONTEXT, *PYORILIB_COMPRESS_CONTEXT;
 
 BOOL
@@ -1523,6 +2149,12 @@ YoriLibGetWofVersionAvailable(
     __in PYORI_STRING FileName
     );
 
+VOID
+YoriLibGetCompressProgress(
+    __in PYORILIB_COMPRESS_CONTEXT CompressContext,
+    __out PYORILIB_COMPRESS_PROGRESS Progress
+    );
+
 // *** FILEENUM.C ***
 
 /**
@@ -1589,13 +2221,45 @@ typedef YORILIB_FILE_ENUM_FN *PYORILIB_FILE_ENUM_FN;
 /**
  Include dot and dotdot files during enumerate.
  */
-#define YORILIB_FILEENUM_INCLUDE_DOTFILES        0x00000080
+#define YORILIB_FILEENUM_INCLUDE_DOTFILES        0x00000080
+
+/**
+ If the top level object is a directory, enumerate its children without
+ requiring explicit wildcards.
+ */
+#define YORILIB_FILEENUM_DIRECTORY_CONTENTS      0x00000100
+
+/**
+ When recursing, enumerate subdirectories concurrently using a pool of
+ worker threads.  Callbacks are invoked on the calling thread in the same
+ order as a serial enumerate.  Since directories can be enumerated before
+ callbacks for earlier objects are invoked, this should not be used by
+ callers that modify the tree being enumerated.
+ */
+#define YORILIB_FILEENUM_PARALLEL                0x00000200
+
+/**
+ In conjunction with YORILIB_FILEENUM_PARALLEL, allow callbacks to be
+ invoked on worker threads in any order.  Callbacks may execute
+ concurrently, so they must synchronize access to any shared state.  No
+ ordering is provided between a directory and objects within it.
+ */
+#define YORILIB_FILEENUM_PARALLEL_UNORDERED      0x00000400
+
+/**
+ Indicates the caller does not use the short file name returned in
+ cAlternateFileName.  Where supported, this allows the system to skip
+ generating or retrieving short names during enumeration.
+ */
+#define YORILIB_FILEENUM_NO_SHORT_NAMES          0x00000800
 
 /**
- If the top level object is a directory, enumerate its children without
- requiring explicit wildcards.
+ When enumerating the entire contents of an NTFS volume root, attempt to
+ read all names from the master file table in a single pass rather than
+ enumerating each directory.  This requires the ability to open the volume
+ and falls back to regular enumeration if that is not possible.
  */
-#define YORILIB_FILEENUM_DIRECTORY_CONTENTS      0x00000100
+#define YORILIB_FILEENUM_VOLUME_SCAN             0x00001000
 
 __success(return)
 BOOL
@@ -1681,6 +2345,12 @@ typedef struct _YORI_LIB_FILE_FILT_MATCH_CRITERIA {
      */
     BOOL TruthStates[3];
 
+    /**
+     The relative cost of collecting the data needed to evaluate this
+     criteria.  Lower values are cheaper.
+     */
+    DWORD Cost;
+
     /**
      A dummy directory entry containing values to compare against.  This is
      used to allow all compare functions to operate on two directory entries.
@@ -1833,6 +2503,36 @@ YoriLibIsExecutableGui(
     __in PYORI_STRING FullPath
     );
 
+VOID
+YoriLibInitializeCollectSession(
+    __out PYORILIB_COLLECT_SESSION Session
+    );
+
+VOID
+YoriLibBeginCollectSession(
+    __inout PYORILIB_COLLECT_SESSION Session,
+    __inout PYORI_FILE_INFO Entry
+    );
+
+VOID
+YoriLibEndCollectSession(
+    __inout PYORILIB_COLLECT_SESSION Session,
+    __inout PYORI_FILE_INFO Entry
+    );
+
+HANDLE
+YoriLibCollectOpenFile(
+    __in PYORI_FILE_INFO Entry,
+    __in PYORI_STRING FullPath,
+    __in DWORD DesiredAccess
+    );
+
+VOID
+YoriLibCollectCloseFile(
+    __in PYORI_FILE_INFO Entry,
+    __in HANDLE FileHandle
+    );
+
 BOOL
 YoriLibCollectAccessTime (
     __inout PYORI_FILE_INFO Entry,
@@ -2508,6 +3208,15 @@ YoriLibGetFullPathNameReturnAllocation(
     __deref_opt_out_opt LPTSTR* lpFilePart
     );
 
+__success(return)
+BOOL
+YoriLibGetFullPathNameToBuffer(
+    __in PYORI_STRING FileName,
+    __in BOOL ReturnEscapedPath,
+    __inout PYORI_STRING Buffer,
+    __deref_opt_out_opt LPTSTR* lpFilePart
+    );
+
 __success(return)
 BOOL
 YoriLibGetFullPathNameRelativeTo(
@@ -2560,6 +3269,14 @@ YoriLibGetVolumePathName(
     __inout PYORI_STRING VolumeName
     );
 
+__success(return)
+BOOLEAN
+YoriLibGetVolumeCapabilities(
+    __inout PYORI_STRING VolumeName,
+    __out PDWORD MaxComponentLength,
+    __out PDWORD FileSystemFlags
+    );
+
 __success(return)
 BOOLEAN
 YoriLibPathSupportsLongNames(
@@ -2599,6 +3316,15 @@ YoriLibGetDiskFreeSpace(
 
 // *** GROUP.C ***
 
+BOOL
+YoriLibEnableGroupCache(VOID);
+
+VOID
+YoriLibFlushGroupCache(VOID);
+
+VOID
+YoriLibCleanupGroupCache(VOID);
+
 __success(return)
 BOOL
 YoriLibIsCurrentUserInGroup(
@@ -2606,6 +3332,14 @@ YoriLibIsCurrentUserInGroup(
     __out PBOOL IsMember
     );
 
+__success(return)
+BOOL
+YoriLibIsCurrentUserInGroups(
+    __in_ecount(Count) PYORI_STRING GroupNames,
+    __in YORI_ALLOC_SIZE_T Count,
+    __out_ecount(Count) PBOOL IsMember
+    );
+
 __success(return)
 BOOL
 YoriLibIsCurrentUserInWellKnownGroup(
@@ -2621,6 +3355,18 @@ YoriLibHashString32(
     __in PCYORI_STRING String
     );
 
+DWORDLONG
+YoriLibHashString64(
+    __in DWORDLONG InitialHash,
+    __in PCYORI_STRING String
+    );
+
+DWORDLONG
+YoriLibHashStringInsensitive64(
+    __in DWORDLONG InitialHash,
+    __in PCYORI_STRING String
+    );
+
 PYORI_HASH_TABLE
 YoriLibAllocateHashTable(
     __in YORI_ALLOC_SIZE_T NumberBuckets
@@ -2656,6 +3402,37 @@ YoriLibHashRemoveByKey(
     __in PYORI_STRING KeyString
     );
 
+PYORI_GROWABLE_HASH_TABLE
+YoriLibAllocateGrowableHashTable(
+    __in YORI_ALLOC_SIZE_T InitialEntries
+    );
+
+VOID
+YoriLibFreeEmptyGrowableHashTable(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable
+    );
+
+__success(return)
+BOOLEAN
+YoriLibGrowableHashInsertByKey(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PYORI_STRING KeyString,
+    __in PVOID Context,
+    __out PYORI_HASH_ENTRY HashEntry
+    );
+
+PYORI_HASH_ENTRY
+YoriLibGrowableHashLookupByKey(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PCYORI_STRING KeyString
+    );
+
+VOID
+YoriLibGrowableHashRemoveByEntry(
+    __in PYORI_GROWABLE_HASH_TABLE HashTable,
+    __in PYORI_HASH_ENTRY HashEntry
+    );
+
 // *** HEXDUMP.C ***
 
 /**
@@ -2703,6 +3480,18 @@ YoriLibHexDump(
     __in DWORD DumpFlags
     );
 
+__success(return)
+BOOL
+YoriLibHexDumpToString(
+    __in LPCSTR Buffer,
+    __in LONGLONG StartOfBufferOffset,
+    __in YORI_ALLOC_SIZE_T BufferLength,
+    __in DWORD BytesPerWord,
+    __in DWORD DumpFlags,
+    __in BOOLEAN MoreFollowing,
+    __inout PYORI_STRING Output
+    );
+
 BOOL
 YoriLibHexDiff(
     __in LONGLONG StartOfBufferOffset,
@@ -2846,6 +3635,34 @@ YoriLibMultibyteInput(
     __in YORI_ALLOC_SIZE_T OutputBufferLength
     );
 
+// *** INTERN.C ***
+
+/**
+ Returns TRUE if two strings returned from the same string pool have the
+ same contents.  Since the pool stores each unique string once, this does
+ not need to compare the characters.
+ */
+#define YoriLibIsSamePooledString(S1, S2) \
+    ((S1)->StartOfString == (S2)->StartOfString && (S1)->LengthInChars == (S2)->LengthInChars)
+
+PYORI_LIB_STRING_POOL
+YoriLibAllocateStringPool(
+    __in YORI_ALLOC_SIZE_T InitialEntries
+    );
+
+VOID
+YoriLibFreeStringPool(
+    __in PYORI_LIB_STRING_POOL Pool
+    );
+
+__success(return)
+BOOLEAN
+YoriLibInternString(
+    __in PYORI_LIB_STRING_POOL Pool,
+    __in PCYORI_STRING Source,
+    __out PYORI_STRING Pooled
+    );
+
 // *** JOBOBJ.C ***
 
 HANDLE
@@ -2863,6 +3680,46 @@ YoriLibLimitJobObjectPriority(
     __in DWORD Priority
     );
 
+BOOL
+YoriLibLimitJobObjectAffinity(
+    __in HANDLE hJob,
+    __in DWORD_PTR Affinity
+    );
+
+BOOL
+YoriLibLimitJobObjectCpuRate(
+    __in HANDLE hJob,
+    __in DWORD CpuRate
+    );
+
+HANDLE
+YoriLibCreateJobCompletionPort(VOID);
+
+BOOL
+YoriLibAssociateJobObjectWithCompletionPort(
+    __in HANDLE hJob,
+    __in HANDLE hPort,
+    __in PVOID Key
+    );
+
+__success(return)
+BOOL
+YoriLibGetJobCompletionMessage(
+    __in HANDLE hPort,
+    __in DWORD Timeout,
+    __out PDWORD Message,
+    __out PVOID *Key,
+    __out PDWORD_PTR Data
+    );
+
+BOOL
+YoriLibPostJobCompletionMessage(
+    __in HANDLE hPort,
+    __in DWORD Message,
+    __in PVOID Key,
+    __in DWORD_PTR Data
+    );
+
 // *** LICENSE.C ***
 
 BOOL
@@ -2876,6 +3733,43 @@ YoriLibDisplayMitLicense(
     __in LPCTSTR CopyrightYear
     );
 
+// *** LINEPAR.C ***
+
+/**
+ A function invoked for each line when processing lines on multiple
+ threads.  This is invoked concurrently on multiple threads.
+
+ @param Context The context supplied by the caller.
+
+ @param Line Pointer to the line, without its line ending.
+
+ @param Output Pointer to a string to append output for the line to.
+        This string may be reallocated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+typedef
+BOOL
+YORI_LIB_PARALLEL_LINE_FN(
+    __in PVOID Context,
+    __in PYORI_STRING Line,
+    __inout PYORI_STRING Output
+    );
+
+/**
+ A pointer to a function invoked for each line when processing lines on
+ multiple threads.
+ */
+typedef YORI_LIB_PARALLEL_LINE_FN *PYORI_LIB_PARALLEL_LINE_FN;
+
+__success(return)
+BOOL
+YoriLibProcessLinesInParallel(
+    __in HANDLE FileHandle,
+    __in PYORI_LIB_PARALLEL_LINE_FN Function,
+    __in_opt PVOID Context
+    );
+
 // *** LINEREAD.C ***
 
 /**
@@ -2893,6 +3787,57 @@ typedef enum _YORI_LIB_LINE_ENDING {
  */
 typedef YORI_LIB_LINE_ENDING *PYORI_LIB_LINE_ENDING;
 
+/**
+ A description of a line within a line read context's buffer, returned
+ without copying or converting the line.  This remains valid until the next
+ call to read a line with the same context.
+ */
+typedef struct _YORI_LIB_LINE_VIEW {
+
+    /**
+     Pointer to the start of the line in input encoding.  This is an array
+     of WCHARs if WideChars is TRUE, or an array of bytes otherwise.
+     */
+    PVOID Buffer;
+
+    /**
+     The number of characters in the line in input encoding, excluding the
+     line ending.
+     */
+    YORI_ALLOC_SIZE_T LengthInChars;
+
+    /**
+     The line ending that terminated the line.
+     */
+    YORI_LIB_LINE_ENDING LineEnding;
+
+    /**
+     TRUE if the line is in UTF16 encoding, FALSE if it is in an 8 bit
+     encoding.
+     */
+    BOOLEAN WideChars;
+
+    /**
+     TRUE if the line contains characters that need to be converted to be
+     represented in UTF16.  If FALSE, each input character corresponds to
+     one UTF16 character with the same value.
+     */
+    BOOLEAN NeedsConversion;
+} YORI_LIB_LINE_VIEW, *PYORI_LIB_LINE_VIEW;
+
+UCHAR
+YoriLibBytesInBom(
+    __in PUCHAR StringToCheck,
+    __in DWORD BytesInString
+    );
+
+YORI_ALLOC_SIZE_T
+YoriLibLineReadFindLineEnd(
+    __in PUCHAR Buffer,
+    __in YORI_ALLOC_SIZE_T Length,
+    __inout PBOOLEAN HighBitsFound
+    );
+
 PVOID
 YoriLibReadLineToString(
     __in PYORI_STRING UserString,
@@ -2911,6 +3856,36 @@ YoriLibReadLineToStringEx(
     __out PBOOL TimeoutReached
     );
 
+__success(return)
+BOOL
+YoriLibReadLineView(
+    __out PYORI_LIB_LINE_VIEW View,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    );
+
+__success(return)
+BOOL
+YoriLibReadLineViews(
+    __out_ecount(MaximumViews) PYORI_LIB_LINE_VIEW Views,
+    __in YORI_ALLOC_SIZE_T MaximumViews,
+    __out PYORI_ALLOC_SIZE_T ViewsReturned,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    );
+
+__success(return)
+BOOL
+YoriLibLineViewToString(
+    __in PYORI_LIB_LINE_VIEW View,
+    __inout PYORI_STRING UserString
+    );
+
+YORI_ALLOC_SIZE_T
+YoriLibLineViewLengthInChars(
+    __in PYORI_LIB_LINE_VIEW View
+    );
+
 VOID
 YoriLibLineReadClose(
     __in_opt PVOID Context
@@ -3008,23 +3983,135 @@ YoriLibMalloc(
     );
 
 PVOID
-YoriLibReferencedMalloc(
-    __in YORI_ALLOC_SIZE_T Bytes
+YoriLibReferencedMalloc(
+    __in YORI_ALLOC_SIZE_T Bytes
+    );
+#endif
+
+VOID
+YoriLibFree(
+    __in PVOID Ptr
+    );
+
+VOID
+YoriLibDisplayMemoryUsage(VOID);
+
+VOID
+YoriLibDisplayAllocationProfile(VOID);
+
+
+VOID
+YoriLibReference(
+    __in PVOID Allocation
+    );
+
+/**
+ A region that allocates many small reference counted allocations from
+ larger heap allocations.
+ */
+typedef struct _YORI_LIB_ARENA {
+
+    /**
+     The chunk that allocations are currently being made from, or NULL if
+     no chunk has been allocated.
+     */
+    PVOID CurrentChunk;
+
+    /**
+     The number of bytes in each chunk.
+     */
+    YORI_ALLOC_SIZE_T ChunkSize;
+
+    /**
+     The number of bytes in the current chunk that have been allocated.
+     */
+    YORI_ALLOC_SIZE_T BytesUsed;
+} YORI_LIB_ARENA, *PYORI_LIB_ARENA;
+
+VOID
+YoriLibInitializeArena(
+    __out PYORI_LIB_ARENA Arena,
+    __in YORI_ALLOC_SIZE_T ChunkSize
+    );
+
+PVOID
+YoriLibArenaReferencedMalloc(
+    __inout PYORI_LIB_ARENA Arena,
+    __in YORI_ALLOC_SIZE_T Bytes
+    );
+
+__success(return)
+BOOL
+YoriLibArenaAllocateString(
+    __inout PYORI_LIB_ARENA Arena,
+    __out PYORI_STRING String,
+    __in YORI_ALLOC_SIZE_T CharsToAllocate
+    );
+
+VOID
+YoriLibCleanupArena(
+    __inout PYORI_LIB_ARENA Arena
+    );
+
+/**
+ The granularity of element sizes in a slab allocator.  Requested sizes are
+ rounded up to a multiple of this value.
+ */
+#define YORI_LIB_SLAB_SIZE_CLASS (16)
+
+/**
+ An allocator for many fixed sized, reference counted elements.
+ */
+typedef struct _YORI_LIB_SLAB_ALLOC {
+
+    /**
+     The arena that chunks of elements are allocated from.
+     */
+    YORI_LIB_ARENA Arena;
+
+    /**
+     Synchronization for allocations from multiple threads.
+     */
+    CRITICAL_SECTION Lock;
+
+    /**
+     The size of each element, rounded to a size class.
+     */
+    YORI_ALLOC_SIZE_T ElementSize;
+
+    /**
+     The number of elements that have been allocated, for debugging and
+     performance analysis.
+     */
+    DWORD ElementsAllocated;
+
+    /**
+     The number of chunks that have been allocated from the heap, for
+     debugging and performance analysis.
+     */
+    DWORD ChunksAllocated;
+} YORI_LIB_SLAB_ALLOC, *PYORI_LIB_SLAB_ALLOC;
+
+BOOLEAN
+YoriLibInitializeSlab(
+    __out PYORI_LIB_SLAB_ALLOC Slab,
+    __in YORI_ALLOC_SIZE_T ElementSize
+    );
+
+PVOID
+YoriLibSlabAlloc(
+    __in PYORI_LIB_SLAB_ALLOC Slab,
+    __in YORI_ALLOC_SIZE_T SizeInBytes
     );
-#endif
 
 VOID
-YoriLibFree(
-    __in PVOID Ptr
+YoriLibSlabFree(
+    __in PVOID Element
     );
 
 VOID
-YoriLibDisplayMemoryUsage(VOID);
-
-
-VOID
-YoriLibReference(
-    __in PVOID Allocation
+YoriLibCleanupSlab(
+    __inout PYORI_LIB_SLAB_ALLOC Slab
     );
 
 VOID
@@ -3050,6 +4137,37 @@ YoriLibIsAllocationExtendable(
     __in YORI_ALLOC_SIZE_T DesiredExtraSize
     );
 
+// *** METACACH.C ***
+
+__success(return)
+BOOL
+YoriLibInitializeMetadataCache(
+    __out PYORILIB_METADATA_CACHE Cache
+    );
+
+PYORILIB_METADATA_CACHE_RECORD
+YoriLibMetadataCacheLookup(
+    __in PYORILIB_METADATA_CACHE Cache,
+    __in DWORD VolumeSerialNumber,
+    __in PLARGE_INTEGER FileId,
+    __in PLARGE_INTEGER LastWriteTime
+    );
+
+VOID
+YoriLibMetadataCacheRecordUpdated(
+    __in PYORILIB_METADATA_CACHE_RECORD Record
+    );
+
+BOOL
+YoriLibSaveMetadataCache(
+    __in PYORILIB_METADATA_CACHE Cache
+    );
+
+VOID
+YoriLibCleanupMetadataCache(
+    __in PYORILIB_METADATA_CACHE Cache
+    );
+
 // *** MOVEFILE.C ***
 
 DWORD
@@ -3206,6 +4324,12 @@ typedef BOOL YORI_LIB_PATH_MATCH_FN(PYORI_STRING Match, PVOID Context);
  */
 typedef YORI_LIB_PATH_MATCH_FN *PYORI_LIB_PATH_MATCH_FN;
 
+BOOL
+YoriLibPathEnableLocateCache(VOID);
+
+VOID
+YoriLibPathCleanupLocateCache(VOID);
+
 __success(return)
 BOOL
 YoriLibPathLocateKnownExtensionUnknownLocation(
@@ -3364,6 +4488,13 @@ YoriLibGetSystemProcessList(
     __out PYORI_SYSTEM_PROCESS_INFORMATION *ProcessInfo
     );
 
+__success(return)
+BOOL
+YoriLibRefreshSystemProcessList(
+    __inout PYORI_SYSTEM_PROCESS_INFORMATION *ProcessInfo,
+    __inout PYORI_ALLOC_SIZE_T BufferSize
+    );
+
 __success(return)
 BOOL
 YoriLibGetSystemHandlesList(
@@ -3443,6 +4574,81 @@ YoriLibSavePopupColorToScheme(
 
 // *** SCUT.C ***
 
+/**
+ Information about a shortcut obtained by parsing the shortcut file
+ directly.
+ */
+typedef struct _YORI_LIB_SHORTCUT_INFO {
+
+    /**
+     The path to the target of the shortcut.  This may contain environment
+     variables.  It is empty if the target can only be described by the
+     shell.
+     */
+    YORI_STRING Target;
+
+    /**
+     Arguments to pass to the target.
+     */
+    YORI_STRING Arguments;
+
+    /**
+     The description of the shortcut.
+     */
+    YORI_STRING Description;
+
+    /**
+     The directory to use when launching the target.
+     */
+    YORI_STRING WorkingDirectory;
+
+    /**
+     The path to the target relative to the shortcut.
+     */
+    YORI_STRING RelativePath;
+
+    /**
+     The path to the file containing the icon for the shortcut.  This may
+     contain environment variables.  It is empty if the shortcut should
+     use the icon of its target.
+     */
+    YORI_STRING IconPath;
+
+    /**
+     The index of the icon within IconPath.
+     */
+    DWORD IconIndex;
+
+    /**
+     The ShowWindow state to launch the target in.
+     */
+    DWORD ShowCommand;
+
+    /**
+     The hotkey to launch the shortcut.
+     */
+    WORD Hotkey;
+
+} YORI_LIB_SHORTCUT_INFO, *PYORI_LIB_SHORTCUT_INFO;
+
+/**
+ A set of COM objects that can be reused to read many shortcuts.
+ */
+typedef struct _YORI_LIB_SHORTCUT_SESSION {
+
+    /**
+     The shell link object, or NULL if it has not been created.
+     */
+    IShellLinkW *ShellLink;
+
+    /**
+     The file interface on the shell link object, or NULL if it has not been
+     created.
+     */
+    IPersistFile *PersistFile;
+
+} YORI_LIB_SHORTCUT_SESSION, *PYORI_LIB_SHORTCUT_SESSION;
+
 __success(return)
 BOOL
 YoriLibCreateShortcut(
@@ -3464,6 +4670,7 @@ __success(return)
 BOOL
 YoriLibLoadShortcutIconPath(
     __in PYORI_STRING ShortcutFileName,
+    __in_opt PYORI_LIB_SHORTCUT_SESSION Session,
     __out PYORI_STRING IconPath,
     __out PDWORD IconIndex
     );
@@ -3479,6 +4686,28 @@ YoriLibExecuteShortcut(
 PISHELLLINKDATALIST_CONSOLE_PROPS
 YoriLibAllocateDefaultConsoleProperties(VOID);
 
+VOID
+YoriLibFreeShortcutInfo(
+    __inout PYORI_LIB_SHORTCUT_INFO Info
+    );
+
+__success(return)
+BOOL
+YoriLibParseShortcut(
+    __in PYORI_STRING ShortcutFileName,
+    __out PYORI_LIB_SHORTCUT_INFO Info
+    );
+
+VOID
+YoriLibInitializeShortcutSession(
+    __out PYORI_LIB_SHORTCUT_SESSION Session
+    );
+
+VOID
+YoriLibCleanupShortcutSession(
+    __inout PYORI_LIB_SHORTCUT_SESSION Session
+    );
+
 // *** SELECT.C ***
 
 /**
@@ -3688,6 +4917,131 @@ YoriLibSetSelectionColor(
     __in WORD SelectionColor
     );
 
+// *** STATS.C ***
+
+/**
+ The maximum number of processing phases whose times can be recorded.
+ */
+#define YORI_LIB_STATS_MAX_PHASES (8)
+
+/**
+ A phase of a program's processing whose time is recorded.
+ */
+typedef struct _YORI_LIB_STATS_PHASE {
+
+    /**
+     A constant string describing the phase.
+     */
+    LPCTSTR Name;
+
+    /**
+     The system time when the phase began.
+     */
+    LONGLONG StartTime;
+} YORI_LIB_STATS_PHASE, *PYORI_LIB_STATS_PHASE;
+
+/**
+ Performance statistics collected for a program which has requested them.
+ Counts are updated atomically, but byte totals are not, so they can be
+ approximate when multiple threads perform I/O or allocate concurrently.
+ */
+typedef struct _YORI_LIB_STATS {
+
+    /**
+     TRUE if statistics are being collected.
+     */
+    BOOLEAN Enabled;
+
+    /**
+     The number of processing phases recorded in Phases.
+     */
+    DWORD PhaseCount;
+
+    /**
+     The number of files and directories returned by file enumeration.
+     */
+    DWORD FilesEnumerated;
+
+    /**
+     The number of directory searches started by file enumeration.
+     */
+    DWORD DirectorySearches;
+
+    /**
+     The number of calls to read further entries from a directory search.
+     */
+    DWORD DirectoryReads;
+
+    /**
+     The number of reads issued by the line reader, including mapping views
+     of a file.
+     */
+    DWORD ReadCalls;
+
+    /**
+     The number of writes issued when outputting text.
+     */
+    DWORD WriteCalls;
+
+    /**
+     The number of memory allocations.
+     */
+    DWORD Allocations;
+
+    /**
+     The number of bytes read by the line reader.
+     */
+    DWORDLONG BytesRead;
+
+    /**
+     The number of bytes written when outputting text.
+     */
+    DWORDLONG BytesWritten;
+
+    /**
+     The number of bytes allocated.
+     */
+    DWORDLONG BytesAllocated;
+
+    /**
+     The system time when statistics collection began.
+     */
+    LONGLONG StartTime;
+
+    /**
+     The processing phases that have been recorded.
+     */
+    YORI_LIB_STATS_PHASE Phases[YORI_LIB_STATS_MAX_PHASES];
+} YORI_LIB_STATS, *PYORI_LIB_STATS;
+
+extern YORI_LIB_STATS YoriLibStats;
+
+VOID
+YoriLibEnableStatistics(VOID);
+
+VOID
+YoriLibBeginStatisticsPhase(
+    __in LPCTSTR Name
+    );
+
+VOID
+YoriLibStatisticsRecordRead(
+    __in DWORD Bytes
+    );
+
+VOID
+YoriLibStatisticsRecordWrite(
+    __in DWORD Bytes
+    );
+
+VOID
+YoriLibStatisticsRecordAllocation(
+    __in YORI_ALLOC_SIZE_T Bytes
+    );
+
+VOID
+YoriLibDisplayStatistics(VOID);
+
 // *** STRARRAY.C ***
 
 VOID
@@ -3884,6 +5238,13 @@ YoriLibCompareStringCount(
     __in YORI_ALLOC_SIZE_T count
     );
 
+YORI_ALLOC_SIZE_T
+YoriLibCountIdenticalChars(
+    __in_ecount(MaxCount) LPCTSTR Str1,
+    __in_ecount(MaxCount) LPCTSTR Str2,
+    __in YORI_ALLOC_SIZE_T MaxCount
+    );
+
 YORI_ALLOC_SIZE_T
 YoriLibCountStringMatchingChars(
     __in PYORI_STRING Str1,
@@ -3946,6 +5307,72 @@ YoriLibFindLastMatchingSubstringInsensitive(
     __out_opt PYORI_ALLOC_SIZE_T StringOffsetOfMatch
     );
 
+/**
+ The number of groups that a substring matcher divides strings into based
+ on their first character.
+ */
+#define YORI_LIB_SUBSTRING_MATCHER_BUCKETS (256)
+
+/**
+ A prepared set of strings to search for, allowing many strings to be
+ searched without comparing every position against every string.
+ */
+typedef struct _YORI_LIB_SUBSTRING_MATCHER {
+
+    /**
+     The array of strings to search for.
+     */
+    PYORI_STRING MatchArray;
+
+    /**
+     The number of elements in MatchArray.
+     */
+    YORI_ALLOC_SIZE_T NumberMatches;
+
+    /**
+     The length of the shortest string in MatchArray.
+     */
+    YORI_ALLOC_SIZE_T MinimumLength;
+
+    /**
+     An array of indexes into MatchArray, ordered by bucket.  If this is
+     NULL, searches are performed without grouping strings into buckets.
+     */
+    PYORI_ALLOC_SIZE_T BucketEntries;
+
+    /**
+     For each bucket, the index within BucketEntries of its first entry.
+     The final element contains the total number of entries, so the end of
+     each bucket is the start of the next.
+     */
+    YORI_ALLOC_SIZE_T BucketStart[YORI_LIB_SUBSTRING_MATCHER_BUCKETS + 1];
+
+    /**
+     TRUE if matches should be found without regard to case.
+     */
+    BOOLEAN Insensitive;
+} YORI_LIB_SUBSTRING_MATCHER, *PYORI_LIB_SUBSTRING_MATCHER;
+
+VOID
+YoriLibInitializeSubstringMatcher(
+    __out PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in YORI_ALLOC_SIZE_T NumberMatches,
+    __in PYORI_STRING MatchArray,
+    __in BOOLEAN Insensitive
+    );
+
+VOID
+YoriLibCleanupSubstringMatcher(
+    __inout PYORI_LIB_SUBSTRING_MATCHER Matcher
+    );
+
+PYORI_STRING
+YoriLibFindFirstMatchWithMatcher(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PCYORI_STRING String,
+    __out_opt PYORI_ALLOC_SIZE_T StringOffsetOfMatch
+    );
+
 LPTSTR
 YoriLibFindLeftMostCharacter(
     __in PCYORI_STRING String,
@@ -4086,6 +5513,7 @@ typedef enum {
     YoriLibUpdErrorInetContents,
     YoriLibUpdErrorFileWrite,
     YoriLibUpdErrorFileReplace,
+    YoriLibUpdErrorHash,
     YoriLibUpdErrorMax
 } YORI_LIB_UPDATE_ERROR;
 
@@ -4097,6 +5525,16 @@ YoriLibUpdateBinaryFromUrl(
     __in_opt PSYSTEMTIME IfModifiedSince
     );
 
+YORI_LIB_UPDATE_ERROR
+YoriLibUpdateBinaryFromUrlInRanges(
+    __in PCYORI_STRING Url,
+    __in PCYORI_STRING TargetName,
+    __in PCYORI_STRING Agent,
+    __in DWORD ConnectionCount,
+    __in_opt PSYSTEMTIME IfModifiedSince,
+    __in_opt PCYORI_STRING ExpectedHash
+    );
+
 LPCTSTR
 YoriLibUpdateErrorString(
     __in YORI_LIB_UPDATE_ERROR Error
@@ -4221,6 +5659,19 @@ YoriLibShellExecuteInstanceToError(
     __in_opt HINSTANCE hInst
     );
 
+// *** VOLENUM.C ***
+
+BOOLEAN
+YoriLibForEachFileOnVolume(
+    __in PYORI_STRING FileSpec,
+    __in WORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context,
+    __out PBOOL Result
+    );
+
 // *** VT.C ***
 
 /**
@@ -4391,6 +5842,17 @@ YoriLibOutputString(
     __in PYORI_STRING String
     );
 
+BOOL
+YoriLibEnableOutputBuffering(
+    __in DWORD Flags
+    );
+
+BOOL
+YoriLibFlushOutputBuffer(VOID);
+
+VOID
+YoriLibDisableOutputBuffering(VOID);
+
 BOOL
 YoriLibVtSetConsoleTextAttributeOnDevice(
     __in HANDLE hOut,
@@ -4457,6 +5919,61 @@ YoriLibQueryConsoleCapabilities(
     __out_opt PBOOL SupportsAutoLineWrap
     );
 
+// *** WORKQ.C ***
+
+__success(return)
+BOOL
+YoriLibInitializeWorkQueue(
+    __out PYORILIB_WORK_QUEUE WorkQueue,
+    __in YORI_ALLOC_SIZE_T MaxThreads,
+    __in YORI_ALLOC_SIZE_T MaxItemsQueued,
+    __in PYORILIB_WORK_ITEM_FN Function,
+    __in_opt PVOID Context
+    );
+
+VOID
+YoriLibCleanupWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    );
+
+__success(return)
+BOOL
+YoriLibQueueWorkItem(
+    __in PYORILIB_WORK_QUEUE WorkQueue,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN WaitForSpace
+    );
+
+__success(return)
+BOOL
+YoriLibWaitForWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    );
+
+VOID
+YoriLibCancelWorkQueue(
+    __in PYORILIB_WORK_QUEUE WorkQueue
+    );
+
+// *** XXHASH.C ***
+
+VOID
+YoriLibXxHash64Initialize(
+    __out PYORILIB_XXHASH64_CONTEXT Context,
+    __in DWORDLONG Seed
+    );
+
+VOID
+YoriLibXxHash64Update(
+    __inout PYORILIB_XXHASH64_CONTEXT Context,
+    __in_bcount(BufferLength) PVOID Buffer,
+    __in DWORD BufferLength
+    );
+
+DWORDLONG
+YoriLibXxHash64Finalize(
+    __in PYORILIB_XXHASH64_CONTEXT Context
+    );
 
 // MSFIX Out of order here
 
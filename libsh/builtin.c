@@ -39,10 +39,25 @@ typedef struct _YORI_LIBSH_BUILTIN_GLOBAL {
     YORI_LIST_ENTRY LoadedModules;
 
     /**
-     Hash table of builtin callbacks currently registered with Yori.
+     Hash table of builtin callbacks currently registered with Yori.  This
+     only contains callbacks registered dynamically; callbacks from the
+     static table are found by searching StaticCallbacks.
      */
     PYORI_HASH_TABLE Hash;
 
+    /**
+     An array of callbacks describing builtins statically linked into the
+     program, sorted by name.  This is allocated as a single block and is
+     searched with a binary search, so programs with a large set of
+     builtins do not need to populate a hash table on startup.
+     */
+    PYORI_LIBSH_BUILTIN_CALLBACK StaticCallbacks;
+
+    /**
+     The number of elements in the StaticCallbacks array.
+     */
+    YORI_ALLOC_SIZE_T StaticCallbackCount;
+
     /**
      A list of unload functions to invoke.  These are only for code statically
      linked into the shell executable, not loadable modules.  Once added, a
@@ -304,6 +319,145 @@ YoriLibShBuiltinRegister(
     return TRUE;
 }
 
+/**
+ Register a table of builtin commands that are statically linked into the
+ program.  The table must be sorted by command name and terminated with an
+ entry containing a NULL command name.  The command names in the table are
+ referenced rather than copied, so the table must remain valid for the life
+ of the process.  This is expected to be called once on startup, before
+ any builtins are registered dynamically, so that dynamic registrations can
+ override the statically linked ones.
+
+ @param Table Pointer to the table of builtin commands.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShBuiltinRegisterStaticTable(
+    __in YORI_LIBSH_BUILTIN_NAME_MAPPING CONST *Table
+    )
+{
+    PYORI_LIBSH_BUILTIN_CALLBACK NewCallback;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (YoriLibShBuiltinGlobal.StaticCallbacks != NULL) {
+        return FALSE;
+    }
+
+    if (YoriLibShBuiltinGlobal.BuiltinCallbacks.Next == NULL) {
+        YoriLibInitializeListHead(&YoriLibShBuiltinGlobal.BuiltinCallbacks);
+    }
+
+    Count = 0;
+    while (Table[Count].CommandName != NULL) {
+        Count++;
+    }
+
+    if (Count == 0) {
+        return TRUE;
+    }
+
+    NewCallback = YoriLibMalloc(Count * sizeof(YORI_LIBSH_BUILTIN_CALLBACK));
+    if (NewCallback == NULL) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+        YoriLibConstantString(&NewCallback[Index].BuiltinName, Table[Index].CommandName);
+        NewCallback[Index].BuiltInFn = Table[Index].BuiltinFn;
+        NewCallback[Index].ReferencedModule = NULL;
+
+#if DBG
+        if (Index > 0) {
+            ASSERT(YoriLibCompareStringInsensitive(&NewCallback[Index - 1].BuiltinName, &NewCallback[Index].BuiltinName) < 0);
+        }
+#endif
+
+        //
+        //  Insert at the front of the list so the order of enumeration
+        //  matches what it would be if each entry had been registered
+        //  individually.
+        //
+
+        YoriLibInsertList(&YoriLibShBuiltinGlobal.BuiltinCallbacks, &NewCallback[Index].ListEntry);
+    }
+
+    YoriLibShBuiltinGlobal.StaticCallbacks = NewCallback;
+    YoriLibShBuiltinGlobal.StaticCallbackCount = Count;
+    return TRUE;
+}
+
+/**
+ Search the table of statically linked builtins for a command by case
+ insensitive name.  Entries that have been unregistered are retained in the
+ table with no function, and are not returned.
+
+ @param Name Pointer to the name of the function to look up.
+
+ @return Pointer to the context describing this builtin function, or NULL if
+         it is not found.
+ */
+PYORI_LIBSH_BUILTIN_CALLBACK
+YoriLibShLookupStaticBuiltinByName(
+    __in PYORI_STRING Name
+    )
+{
+    YORI_ALLOC_SIZE_T Start;
+    YORI_ALLOC_SIZE_T End;
+    YORI_ALLOC_SIZE_T Middle;
+    int CompareResult;
+    PYORI_LIBSH_BUILTIN_CALLBACK Callback;
+
+    Start = 0;
+    End = YoriLibShBuiltinGlobal.StaticCallbackCount;
+    while (Start < End) {
+        Middle = Start + (End - Start) / 2;
+        Callback = &YoriLibShBuiltinGlobal.StaticCallbacks[Middle];
+        CompareResult = YoriLibCompareStringInsensitive(Name, &Callback->BuiltinName);
+        if (CompareResult == 0) {
+            if (Callback->BuiltInFn == NULL) {
+                return NULL;
+            }
+            return Callback;
+        } else if (CompareResult < 0) {
+            End = Middle;
+        } else {
+            Start = Middle + 1;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Returns TRUE if the specified callback is an element of the table of
+ statically linked builtins, indicating it was not separately allocated.
+
+ @param Callback Pointer to the callback to check.
+
+ @return TRUE if the callback is part of the static table, FALSE if it was
+         dynamically registered.
+ */
+BOOLEAN
+YoriLibShIsStaticBuiltin(
+    __in PYORI_LIBSH_BUILTIN_CALLBACK Callback
+    )
+{
+    if (YoriLibShBuiltinGlobal.StaticCallbacks == NULL) {
+        return FALSE;
+    }
+
+    if (Callback >= YoriLibShBuiltinGlobal.StaticCallbacks &&
+        Callback < &YoriLibShBuiltinGlobal.StaticCallbacks[YoriLibShBuiltinGlobal.StaticCallbackCount]) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 /**
  Dissociate a previously associated builtin command such that the function is
  no longer invoked in response to the command.
@@ -327,10 +481,6 @@ YoriLibShBuiltinUnregister(
 
     UNREFERENCED_PARAMETER(CallbackFn);
 
-    if (YoriLibShBuiltinGlobal.Hash == NULL) {
-        return FALSE;
-    }
-
     if (YoriLibShBuiltinGlobal.Hash != NULL) {
         HashEntry = YoriLibHashRemoveByKey(YoriLibShBuiltinGlobal.Hash, BuiltinCmd);
         if (HashEntry != NULL) {
@@ -343,9 +493,23 @@ YoriLibShBuiltinUnregister(
             }
             YoriLibFreeStringContents(&Callback->BuiltinName);
             YoriLibDereference(Callback);
+            return FALSE;
         }
     }
 
+    //
+    //  Entries in the static table are not freed individually.  Remove them
+    //  from the list so they are not enumerated, and clear the function so
+    //  lookups no longer find them.
+    //
+
+    Callback = YoriLibShLookupStaticBuiltinByName(BuiltinCmd);
+    if (Callback != NULL) {
+        ASSERT(CallbackFn == Callback->BuiltInFn);
+        YoriLibRemoveListItem(&Callback->ListEntry);
+        Callback->BuiltInFn = NULL;
+    }
+
     return FALSE;
 }
 
@@ -365,19 +529,28 @@ YoriLibShBuiltinUnregisterAll(VOID)
         while (ListEntry != NULL) {
             Callback = CONTAINING_RECORD(ListEntry, YORI_LIBSH_BUILTIN_CALLBACK, ListEntry);
             YoriLibRemoveListItem(&Callback->ListEntry);
-            YoriLibHashRemoveByEntry(&Callback->HashEntry);
-            if (Callback->ReferencedModule != NULL) {
-                YoriLibShReleaseDll(Callback->ReferencedModule);
-                Callback->ReferencedModule = NULL;
+            if (!YoriLibShIsStaticBuiltin(Callback)) {
+                YoriLibHashRemoveByEntry(&Callback->HashEntry);
+                if (Callback->ReferencedModule != NULL) {
+                    YoriLibShReleaseDll(Callback->ReferencedModule);
+                    Callback->ReferencedModule = NULL;
+                }
+                YoriLibFreeStringContents(&Callback->BuiltinName);
+                YoriLibDereference(Callback);
             }
-            YoriLibFreeStringContents(&Callback->BuiltinName);
-            YoriLibDereference(Callback);
             ListEntry = YoriLibGetNextListEntry(&YoriLibShBuiltinGlobal.BuiltinCallbacks, NULL);
         }
     }
 
     if (YoriLibShBuiltinGlobal.Hash != NULL) {
         YoriLibFreeEmptyHashTable(YoriLibShBuiltinGlobal.Hash);
+        YoriLibShBuiltinGlobal.Hash = NULL;
+    }
+
+    if (YoriLibShBuiltinGlobal.StaticCallbacks != NULL) {
+        YoriLibFree(YoriLibShBuiltinGlobal.StaticCallbacks);
+        YoriLibShBuiltinGlobal.StaticCallbacks = NULL;
+        YoriLibShBuiltinGlobal.StaticCallbackCount = 0;
     }
 
     if (YoriLibShBuiltinGlobal.UnloadCallbacks.Next != NULL) {
@@ -438,16 +611,19 @@ YoriLibShLookupBuiltinByName(
 {
     PYORI_HASH_ENTRY HashEntry;
 
-    if (YoriLibShBuiltinGlobal.Hash == NULL) {
-        return NULL;
-    }
+    //
+    //  Dynamically registered builtins take precedence over statically
+    //  linked ones, so check them first.
+    //
 
-    HashEntry = YoriLibHashLookupByKey(YoriLibShBuiltinGlobal.Hash, Name);
-    if (HashEntry == NULL) {
-        return NULL;
+    if (YoriLibShBuiltinGlobal.Hash != NULL) {
+        HashEntry = YoriLibHashLookupByKey(YoriLibShBuiltinGlobal.Hash, Name);
+        if (HashEntry != NULL) {
+            return (PYORI_LIBSH_BUILTIN_CALLBACK)HashEntry->Context;
+        }
     }
 
-    return (PYORI_LIBSH_BUILTIN_CALLBACK)HashEntry->Context;
+    return YoriLibShLookupStaticBuiltinByName(Name);
 }
 
 /**
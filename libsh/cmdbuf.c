@@ -28,6 +28,63 @@
 #include <yorilib.h>
 #include <yorish.h>
 
+/**
+ The size of the first chunk of data allocated for a buffered stream.  Most
+ buffered streams are backquote expressions with little output.
+ */
+#define YORI_LIBSH_PROCESS_BUFFER_INITIAL_CHUNK (1024)
+
+/**
+ The largest size of a single chunk of data allocated for a buffered stream.
+ Each chunk is four times larger than the previous one until this size is
+ reached.
+ */
+#define YORI_LIBSH_PROCESS_BUFFER_MAX_CHUNK (1024 * 1024)
+
+/**
+ The largest number of bytes to write to a pipe in a single operation when
+ forwarding buffered data.
+ */
+#define YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE (64 * 1024)
+
+/**
+ The default size of the pipe used to collect buffered output from a
+ process, in bytes.  This can be overridden with the YORIPIPEBUFFERSIZE
+ environment variable.
+ */
+#define YORI_LIBSH_DEFAULT_BUFFER_PIPE_SIZE (64 * 1024)
+
+/**
+ The default number of bytes of output from a process to hold in memory.
+ Beyond this, output is written to a temporary file.  This can be
+ overridden with the YORIBUFFERLIMIT environment variable.
+ */
+#define YORI_LIBSH_DEFAULT_BUFFER_MEMORY_LIMIT (16 * 1024 * 1024)
+
+/**
+ A single contiguous allocation of data within a buffered stream.  A stream
+ consists of a list of chunks, so that growing the stream does not require
+ copying data that has already been received.  The data follows this
+ structure in the same allocation.
+ */
+typedef struct _YORI_LIBSH_PROCESS_BUFFER_CHUNK {
+
+    /**
+     The link within the list of chunks for the stream.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The number of bytes of data that can be stored in this chunk.
+     */
+    YORI_ALLOC_SIZE_T BytesAllocated;
+
+    /**
+     The number of bytes of data populated within this chunk.
+     */
+    YORI_ALLOC_SIZE_T BytesPopulated;
+} YORI_LIBSH_PROCESS_BUFFER_CHUNK, *PYORI_LIBSH_PROCESS_BUFFER_CHUNK;
+
 /**
  A buffer for a single data stream.  A process may have a different buffered
  data stream for stdout as well as stderr.
@@ -35,12 +92,14 @@
 typedef struct _YORI_LIBSH_PROCESS_BUFFER {
 
     /**
-     The number of bytes currently allocated to this buffer.
+     The number of bytes currently allocated to this buffer, across all
+     chunks.
      */
     YORI_ALLOC_SIZE_T BytesAllocated;
 
     /**
-     The number of bytes populated with data in this buffer.
+     The number of bytes populated with data in this buffer, across all
+     chunks.
      */
     YORI_ALLOC_SIZE_T BytesPopulated;
 
@@ -71,9 +130,50 @@ typedef struct _YORI_LIBSH_PROCESS_BUFFER {
     DWORD BytesSent;
 
     /**
-     The data buffer.
+     The list of chunks containing data.  Chunks are only added by the
+     buffer pump thread while holding Mutex, and are not freed until the
+     buffer is freed.  Data within a chunk is appended but never modified,
+     so a populated range remains valid while the buffer exists.
      */
-    PCHAR Buffer;
+    YORI_LIST_ENTRY Chunks;
+
+    /**
+     The final chunk in the list, which is the chunk that new data is read
+     into.
+     */
+    PYORI_LIBSH_PROCESS_BUFFER_CHUNK CurrentChunk;
+
+    /**
+     The maximum number of bytes to allocate in chunks.  When this is
+     reached, further data is written to a temporary file.
+     */
+    YORI_ALLOC_SIZE_T MemoryLimit;
+
+    /**
+     The number of bytes populated in chunks.  If no data has been written
+     to a temporary file, this is the same as BytesPopulated.  Otherwise,
+     bytes from this offset onwards are in the temporary file.
+     */
+    YORI_ALLOC_SIZE_T BytesInMemory;
+
+    /**
+     A handle to a temporary file containing data beyond MemoryLimit, or
+     NULL if no data has been written to a temporary file.  The file is
+     deleted when this handle is closed.
+     */
+    HANDLE hSpillFile;
+
+    /**
+     A buffer used by the buffer pump thread to read data which will be
+     written to the temporary file.
+     */
+    PCHAR SpillReadBuffer;
+
+    /**
+     A buffer used while holding Mutex to read data from the temporary file
+     before it is written elsewhere.
+     */
+    PCHAR SpillTransferBuffer;
 
 } YORI_LIBSH_PROCESS_BUFFER, *PYORI_LIBSH_PROCESS_BUFFER;
 
@@ -141,6 +241,342 @@ AcquireMutex(
     WaitForSingleObject(Mutex, INFINITE);
 }
 
+/**
+ Return the size of the pipe to use when collecting buffered output from a
+ process.  This is large so that a process outputting a lot of data does not
+ wait for the shell to collect each small portion.
+
+ @return The size of the pipe, in bytes.
+ */
+DWORD
+YoriLibShGetBufferPipeSize(VOID)
+{
+    YORI_MAX_SIGNED_T PipeSize;
+
+    if (!YoriLibGetEnvironmentVariableAsNumber(_T("YORIPIPEBUFFERSIZE"), &PipeSize) ||
+        PipeSize <= 0) {
+
+        return YORI_LIBSH_DEFAULT_BUFFER_PIPE_SIZE;
+    }
+
+    if (PipeSize < 4096) {
+        PipeSize = 4096;
+    } else if (PipeSize > 16 * 1024 * 1024) {
+        PipeSize = 16 * 1024 * 1024;
+    }
+
+    return (DWORD)PipeSize;
+}
+
+/**
+ Return the number of bytes of output from a process to hold in memory before
+ writing further output to a temporary file.
+
+ @return The number of bytes to hold in memory.
+ */
+YORI_ALLOC_SIZE_T
+YoriLibShGetBufferMemoryLimit(VOID)
+{
+    YORI_MAX_SIGNED_T MemoryLimit;
+
+    if (!YoriLibGetEnvironmentVariableAsNumber(_T("YORIBUFFERLIMIT"), &MemoryLimit) ||
+        MemoryLimit <= 0) {
+
+        return YORI_LIBSH_DEFAULT_BUFFER_MEMORY_LIMIT;
+    }
+
+    if (MemoryLimit < YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE) {
+        MemoryLimit = YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE;
+    } else if ((YORI_MAX_UNSIGNED_T)MemoryLimit > YORI_MAX_ALLOC_SIZE) {
+        MemoryLimit = YORI_MAX_ALLOC_SIZE;
+    }
+
+    return (YORI_ALLOC_SIZE_T)MemoryLimit;
+}
+
+/**
+ Create a temporary file to hold data from a buffered stream once the stream
+ has reached its memory limit.  The caller is expected to hold the buffer's
+ mutex.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @return TRUE to indicate the temporary file was created, FALSE if it was
+         not.
+ */
+__success(return)
+BOOL
+YoriLibShStartProcessBufferSpill(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer
+    )
+{
+    YORI_STRING TempPath;
+    YORI_STRING TempFileName;
+    YORI_STRING Prefix;
+    HANDLE hFile;
+
+    ASSERT(ThisBuffer->hSpillFile == NULL);
+
+    ThisBuffer->SpillReadBuffer = YoriLibMalloc(YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE * 2);
+    if (ThisBuffer->SpillReadBuffer == NULL) {
+        return FALSE;
+    }
+    ThisBuffer->SpillTransferBuffer = ThisBuffer->SpillReadBuffer + YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE;
+
+    if (!YoriLibGetTempPath(&TempPath, 0)) {
+        return FALSE;
+    }
+
+    //
+    //  Find a unique name, then reopen it so that it is deleted when the
+    //  buffer is freed, or if the shell exits.
+    //
+
+    YoriLibConstantString(&Prefix, _T("YSB"));
+    if (!YoriLibGetTempFileName(&TempPath, &Prefix, NULL, &TempFileName)) {
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+    YoriLibFreeStringContents(&TempPath);
+
+    hFile = CreateFile(TempFileName.StartOfString,
+                       GENERIC_READ | GENERIC_WRITE,
+                       FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        DeleteFile(TempFileName.StartOfString);
+        YoriLibFreeStringContents(&TempFileName);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&TempFileName);
+    ThisBuffer->hSpillFile = hFile;
+    return TRUE;
+}
+
+/**
+ Read data from the temporary file associated with a buffered stream.  The
+ caller is expected to hold the buffer's mutex.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @param Offset The offset within the stream, in bytes.  This must be at or
+        beyond the data held in memory.
+
+ @param Buffer Pointer to a buffer to receive the data.
+
+ @param BytesToRead The number of bytes to read.
+
+ @return TRUE to indicate the data was read, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibShReadProcessBufferSpill(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer,
+    __in DWORD Offset,
+    __out_bcount(BytesToRead) PVOID Buffer,
+    __in DWORD BytesToRead
+    )
+{
+    DWORD BytesRead;
+
+    ASSERT(Offset >= ThisBuffer->BytesInMemory);
+    ASSERT(Offset + BytesToRead <= ThisBuffer->BytesPopulated);
+
+    if (SetFilePointer(ThisBuffer->hSpillFile, Offset - ThisBuffer->BytesInMemory, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER) {
+        return FALSE;
+    }
+
+    if (!ReadFile(ThisBuffer->hSpillFile, Buffer, BytesToRead, &BytesRead, NULL) ||
+        BytesRead != BytesToRead) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Append data which has been read into the spill read buffer to the temporary
+ file associated with a buffered stream.  The caller is expected to hold the
+ buffer's mutex.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @param BytesToWrite The number of bytes to append.
+
+ @return TRUE to indicate the data was appended, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibShAppendProcessBufferSpill(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer,
+    __in DWORD BytesToWrite
+    )
+{
+    DWORD BytesWritten;
+
+    if (BytesToWrite > YORI_MAX_ALLOC_SIZE - ThisBuffer->BytesPopulated) {
+        return FALSE;
+    }
+
+    if (SetFilePointer(ThisBuffer->hSpillFile, ThisBuffer->BytesPopulated - ThisBuffer->BytesInMemory, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER) {
+        return FALSE;
+    }
+
+    if (!WriteFile(ThisBuffer->hSpillFile, ThisBuffer->SpillReadBuffer, BytesToWrite, &BytesWritten, NULL) ||
+        BytesWritten != BytesToWrite) {
+
+        return FALSE;
+    }
+
+    ThisBuffer->BytesPopulated = ThisBuffer->BytesPopulated + (YORI_ALLOC_SIZE_T)BytesToWrite;
+    return TRUE;
+}
+
+/**
+ Allocate a new chunk and append it to the end of a buffered stream.  The
+ caller is expected to hold the buffer's mutex if any other thread may be
+ accessing the buffer.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @param BytesToAllocate The number of bytes of data to allocate.
+
+ @return TRUE to indicate the chunk was allocated, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibShAddProcessBufferChunk(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer,
+    __in YORI_ALLOC_SIZE_T BytesToAllocate
+    )
+{
+    PYORI_LIBSH_PROCESS_BUFFER_CHUNK Chunk;
+
+    if (!YoriLibIsSizeAllocatable(sizeof(YORI_LIBSH_PROCESS_BUFFER_CHUNK) + (YORI_MAX_UNSIGNED_T)BytesToAllocate)) {
+        return FALSE;
+    }
+
+    Chunk = YoriLibMalloc((YORI_ALLOC_SIZE_T)(sizeof(YORI_LIBSH_PROCESS_BUFFER_CHUNK) + BytesToAllocate));
+    if (Chunk == NULL) {
+        return FALSE;
+    }
+
+    Chunk->BytesAllocated = BytesToAllocate;
+    Chunk->BytesPopulated = 0;
+    YoriLibAppendList(&ThisBuffer->Chunks, &Chunk->ListEntry);
+    ThisBuffer->CurrentChunk = Chunk;
+    ThisBuffer->BytesAllocated = ThisBuffer->BytesAllocated + BytesToAllocate;
+
+    return TRUE;
+}
+
+/**
+ Find the populated data at a specified offset within a buffered stream.
+ The caller is expected to hold the buffer's mutex.  This only returns data
+ held in memory; data in a temporary file must be read with
+ YoriLibShReadProcessBufferSpill.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @param Offset The offset within the stream, in bytes.  This must be less
+        than the number of bytes populated.
+
+ @param BytesAvailable On successful completion, updated to contain the
+        number of contiguous populated bytes at the returned pointer.
+
+ @return Pointer to the data, or NULL if the offset is not populated.
+ */
+PVOID
+YoriLibShGetProcessBufferData(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer,
+    __in DWORD Offset,
+    __out PDWORD BytesAvailable
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIBSH_PROCESS_BUFFER_CHUNK Chunk;
+    DWORD ChunkOffset;
+
+    ChunkOffset = Offset;
+    ListEntry = YoriLibGetNextListEntry(&ThisBuffer->Chunks, NULL);
+    while (ListEntry != NULL) {
+        Chunk = CONTAINING_RECORD(ListEntry, YORI_LIBSH_PROCESS_BUFFER_CHUNK, ListEntry);
+        if (ChunkOffset < Chunk->BytesPopulated) {
+            *BytesAvailable = Chunk->BytesPopulated - ChunkOffset;
+            return YoriLibAddToPointer(Chunk + 1, ChunkOffset);
+        }
+        ChunkOffset = ChunkOffset - Chunk->BytesPopulated;
+        ListEntry = YoriLibGetNextListEntry(&ThisBuffer->Chunks, ListEntry);
+    }
+
+    *BytesAvailable = 0;
+    return NULL;
+}
+
+/**
+ Write populated data from a buffered stream to a handle.  The caller is
+ expected to hold the buffer's mutex.
+
+ @param ThisBuffer Pointer to the buffered stream.
+
+ @param Handle The handle to write data to.
+
+ @param Offset The offset within the stream of the data to write.
+
+ @param BytesWritten On successful completion, updated to contain the number
+        of bytes written.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShWriteProcessBufferData(
+    __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer,
+    __in HANDLE Handle,
+    __in DWORD Offset,
+    __out PDWORD BytesWritten
+    )
+{
+    PVOID Data;
+    DWORD BytesToWrite;
+
+    if (Offset >= ThisBuffer->BytesInMemory) {
+        if (Offset >= ThisBuffer->BytesPopulated) {
+            *BytesWritten = 0;
+            return TRUE;
+        }
+
+        BytesToWrite = ThisBuffer->BytesPopulated - Offset;
+        if (BytesToWrite > YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE) {
+            BytesToWrite = YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE;
+        }
+
+        if (!YoriLibShReadProcessBufferSpill(ThisBuffer, Offset, ThisBuffer->SpillTransferBuffer, BytesToWrite)) {
+            return FALSE;
+        }
+
+        Data = ThisBuffer->SpillTransferBuffer;
+    } else {
+        Data = YoriLibShGetProcessBufferData(ThisBuffer, Offset, &BytesToWrite);
+        if (Data == NULL) {
+            *BytesWritten = 0;
+            return TRUE;
+        }
+
+        if (BytesToWrite > YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE) {
+            BytesToWrite = YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE;
+        }
+    }
+
+    return WriteFile(Handle, Data, BytesToWrite, BytesWritten, NULL);
+}
+
 /**
  Free structures associated with a single input stream.
 
@@ -151,8 +587,29 @@ YoriLibShFreeProcessBuffer(
     __in PYORI_LIBSH_PROCESS_BUFFER ThisBuffer
     )
 {
-    if (ThisBuffer->Buffer != NULL) {
-        YoriLibFree(ThisBuffer->Buffer);
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIBSH_PROCESS_BUFFER_CHUNK Chunk;
+
+    if (ThisBuffer->Chunks.Next != NULL) {
+        ListEntry = YoriLibGetNextListEntry(&ThisBuffer->Chunks, NULL);
+        while (ListEntry != NULL) {
+            Chunk = CONTAINING_RECORD(ListEntry, YORI_LIBSH_PROCESS_BUFFER_CHUNK, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&ThisBuffer->Chunks, ListEntry);
+            YoriLibRemoveListItem(&Chunk->ListEntry);
+            YoriLibFree(Chunk);
+        }
+        ThisBuffer->CurrentChunk = NULL;
+    }
+
+    if (ThisBuffer->hSpillFile != NULL) {
+        CloseHandle(ThisBuffer->hSpillFile);
+        ThisBuffer->hSpillFile = NULL;
+    }
+
+    if (ThisBuffer->SpillReadBuffer != NULL) {
+        YoriLibFree(ThisBuffer->SpillReadBuffer);
+        ThisBuffer->SpillReadBuffer = NULL;
+        ThisBuffer->SpillTransferBuffer = NULL;
     }
     if (ThisBuffer->hMirror != NULL) {
         CloseHandle(ThisBuffer->hMirror);
@@ -200,22 +657,15 @@ YoriLibShCmdBufferPumpToNextProcess(
     PYORI_LIBSH_PROCESS_BUFFER ThisBuffer = (PYORI_LIBSH_PROCESS_BUFFER)Param;
     DWORD BytesSent = 0;
     DWORD BytesWritten;
-    DWORD BytesToWrite;
 
     while (TRUE) {
 
-        BytesToWrite = 4096;
-        AcquireMutex(ThisBuffer->Mutex);
-        if (BytesSent + BytesToWrite > ThisBuffer->BytesPopulated) {
-            BytesToWrite = ThisBuffer->BytesPopulated - BytesSent;
+        if (BytesSent >= ThisBuffer->BytesPopulated) {
+            break;
         }
 
-        if (WriteFile(ThisBuffer->hSource,
-                      YoriLibAddToPointer(ThisBuffer->Buffer, BytesSent),
-                      BytesToWrite,
-                      &BytesWritten,
-                      NULL)) {
-
+        AcquireMutex(ThisBuffer->Mutex);
+        if (YoriLibShWriteProcessBufferData(ThisBuffer, ThisBuffer->hSource, BytesSent, &BytesWritten)) {
             BytesSent += BytesWritten;
         } else {
             ReleaseMutex(ThisBuffer->Mutex);
@@ -250,14 +700,34 @@ YoriLibShCmdBufferPump(
     )
 {
     PYORI_LIBSH_PROCESS_BUFFER ThisBuffer = (PYORI_LIBSH_PROCESS_BUFFER)Param;
+    PYORI_LIBSH_PROCESS_BUFFER_CHUNK Chunk;
+    PVOID ReadBuffer;
+    DWORD BytesToRead;
     DWORD BytesRead;
     HANDLE hTemp;
 
     while (ThisBuffer->hSource != NULL) {
 
+        //
+        //  Read directly into the unpopulated portion of the current chunk.
+        //  Only this thread modifies the chunk, and other threads only
+        //  access the populated portion, so no lock is needed.  If the
+        //  memory limit has been reached, read into the spill buffer, which
+        //  is also only used by this thread.
+        //
+
+        Chunk = ThisBuffer->CurrentChunk;
+        if (ThisBuffer->hSpillFile != NULL) {
+            ReadBuffer = ThisBuffer->SpillReadBuffer;
+            BytesToRead = YORI_LIBSH_PROCESS_BUFFER_WRITE_SIZE;
+        } else {
+            ReadBuffer = YoriLibAddToPointer(Chunk + 1, Chunk->BytesPopulated);
+            BytesToRead = Chunk->BytesAllocated - Chunk->BytesPopulated;
+        }
+
         if (ReadFile(ThisBuffer->hSource,
-                     YoriLibAddToPointer(ThisBuffer->Buffer, ThisBuffer->BytesPopulated),
-                     ThisBuffer->BytesAllocated - ThisBuffer->BytesPopulated,
+                     ReadBuffer,
+                     BytesToRead,
                      &BytesRead,
                      NULL)) {
 
@@ -267,27 +737,50 @@ YoriLibShCmdBufferPump(
                 break;
             }
 
-            ThisBuffer->BytesPopulated = ThisBuffer->BytesPopulated + (YORI_ALLOC_SIZE_T)BytesRead;
-            ASSERT(ThisBuffer->BytesPopulated <= ThisBuffer->BytesAllocated);
-            if (ThisBuffer->BytesPopulated >= ThisBuffer->BytesAllocated) {
-                YORI_ALLOC_SIZE_T NewBytesAllocated;
-                PCHAR NewBuffer;
-
-                if (ThisBuffer->BytesAllocated >= YORI_MAX_ALLOC_SIZE) {
+            if (ThisBuffer->hSpillFile != NULL) {
+                if (!YoriLibShAppendProcessBufferSpill(ThisBuffer, BytesRead)) {
                     break;
                 }
-
-                NewBytesAllocated = ThisBuffer->BytesAllocated * 4;
-
-                NewBuffer = YoriLibMalloc(NewBytesAllocated);
-                if (NewBuffer == NULL) {
-                    break;
+            } else {
+                Chunk->BytesPopulated = Chunk->BytesPopulated + (YORI_ALLOC_SIZE_T)BytesRead;
+                ThisBuffer->BytesPopulated = ThisBuffer->BytesPopulated + (YORI_ALLOC_SIZE_T)BytesRead;
+                ThisBuffer->BytesInMemory = ThisBuffer->BytesPopulated;
+                ASSERT(Chunk->BytesPopulated <= Chunk->BytesAllocated);
+                if (Chunk->BytesPopulated >= Chunk->BytesAllocated) {
+                    YORI_ALLOC_SIZE_T NewBytesAllocated;
+
+                    //
+                    //  If the memory limit has been reached, send further
+                    //  data to a temporary file so that a process generating
+                    //  a large amount of output doesn't consume all memory
+                    //  in the shell.
+                    //
+
+                    if (ThisBuffer->BytesAllocated >= ThisBuffer->MemoryLimit) {
+                        if (!YoriLibShStartProcessBufferSpill(ThisBuffer)) {
+                            break;
+                        }
+                    } else {
+
+                        //
+                        //  Add a new chunk rather than growing the existing
+                        //  one, so data already received is never copied.
+                        //
+
+                        NewBytesAllocated = YORI_LIBSH_PROCESS_BUFFER_MAX_CHUNK;
+                        if (Chunk->BytesAllocated < YORI_LIBSH_PROCESS_BUFFER_MAX_CHUNK / 4) {
+                            NewBytesAllocated = Chunk->BytesAllocated * 4;
+                        }
+
+                        if (NewBytesAllocated > ThisBuffer->MemoryLimit - ThisBuffer->BytesAllocated) {
+                            NewBytesAllocated = ThisBuffer->MemoryLimit - ThisBuffer->BytesAllocated;
+                        }
+
+                        if (!YoriLibShAddProcessBufferChunk(ThisBuffer, NewBytesAllocated)) {
+                            break;
+                        }
+                    }
                 }
-
-                memcpy(NewBuffer, ThisBuffer->Buffer, ThisBuffer->BytesAllocated);
-                YoriLibFree(ThisBuffer->Buffer);
-                ThisBuffer->Buffer = NewBuffer;
-                ThisBuffer->BytesAllocated = NewBytesAllocated;
             }
         } else {
             DWORD LastError = GetLastError();
@@ -309,19 +802,9 @@ YoriLibShCmdBufferPump(
 
         if (ThisBuffer->hMirror != NULL) {
             while (ThisBuffer->BytesSent < ThisBuffer->BytesPopulated) {
-                DWORD BytesToWrite;
                 DWORD BytesWritten;
-                BytesToWrite = 4096;
-                if (ThisBuffer->BytesSent + BytesToWrite > ThisBuffer->BytesPopulated) {
-                    BytesToWrite = ThisBuffer->BytesPopulated - ThisBuffer->BytesSent;
-                }
-
-                if (WriteFile(ThisBuffer->hMirror,
-                              YoriLibAddToPointer(ThisBuffer->Buffer, ThisBuffer->BytesSent),
-                              BytesToWrite,
-                              &BytesWritten,
-                              NULL)) {
 
+                if (YoriLibShWriteProcessBufferData(ThisBuffer, ThisBuffer->hMirror, ThisBuffer->BytesSent, &BytesWritten)) {
                     ThisBuffer->BytesSent += BytesWritten;
                 } else {
                     hTemp = ThisBuffer->hMirror;
@@ -368,9 +851,12 @@ YoriLibShAllocateSingleProcessBuffer(
     __out PYORI_LIBSH_PROCESS_BUFFER Buffer
     )
 {
-    Buffer->BytesAllocated = 1024;
-    Buffer->Buffer = YoriLibMalloc(Buffer->BytesAllocated);
-    if (Buffer->Buffer == NULL) {
+    YoriLibInitializeListHead(&Buffer->Chunks);
+    Buffer->BytesAllocated = 0;
+    Buffer->BytesPopulated = 0;
+    Buffer->BytesInMemory = 0;
+    Buffer->MemoryLimit = YoriLibShGetBufferMemoryLimit();
+    if (!YoriLibShAddProcessBufferChunk(Buffer, YORI_LIBSH_PROCESS_BUFFER_INITIAL_CHUNK)) {
         return FALSE;
     }
 
@@ -631,29 +1117,76 @@ YoriLibShGetProcessBuffer(
     )
 {
     YORI_ALLOC_SIZE_T LengthNeeded;
+    PVOID Data;
+    PCHAR MergedData;
+    DWORD BytesAvailable;
+    DWORD Offset;
 
-    if (ThisBuffer->Buffer == NULL) {
+    if (ThisBuffer->Chunks.Next == NULL) {
         return FALSE;
     }
 
     AcquireMutex(ThisBuffer->Mutex);
 
-    LengthNeeded = YoriLibGetMultibyteInputSizeNeeded(ThisBuffer->Buffer, ThisBuffer->BytesPopulated);
-    if (LengthNeeded == 0 && ThisBuffer->BytesPopulated == 0) {
+    if (ThisBuffer->BytesPopulated == 0) {
         ReleaseMutex(ThisBuffer->Mutex);
         YoriLibInitEmptyString(String);
         return TRUE;
     }
 
+    //
+    //  If the data spans multiple chunks or a temporary file, combine it so
+    //  that characters which cross a chunk boundary are converted correctly.
+    //
+
+    MergedData = NULL;
+    Data = YoriLibShGetProcessBufferData(ThisBuffer, 0, &BytesAvailable);
+    if (BytesAvailable < ThisBuffer->BytesPopulated) {
+        MergedData = YoriLibMalloc(ThisBuffer->BytesPopulated);
+        if (MergedData == NULL) {
+            ReleaseMutex(ThisBuffer->Mutex);
+            return FALSE;
+        }
+
+        Offset = 0;
+        while (Offset < ThisBuffer->BytesInMemory) {
+            Data = YoriLibShGetProcessBufferData(ThisBuffer, Offset, &BytesAvailable);
+            ASSERT(Data != NULL);
+            if (Data == NULL) {
+                break;
+            }
+            memcpy(&MergedData[Offset], Data, BytesAvailable);
+            Offset = Offset + BytesAvailable;
+        }
+
+        if (Offset < ThisBuffer->BytesPopulated &&
+            !YoriLibShReadProcessBufferSpill(ThisBuffer, Offset, &MergedData[Offset], ThisBuffer->BytesPopulated - Offset)) {
+
+            ReleaseMutex(ThisBuffer->Mutex);
+            YoriLibFree(MergedData);
+            return FALSE;
+        }
+        Data = MergedData;
+    }
+
+    LengthNeeded = YoriLibGetMultibyteInputSizeNeeded(Data, ThisBuffer->BytesPopulated);
+
     if (!YoriLibAllocateString(String, LengthNeeded)) {
         ReleaseMutex(ThisBuffer->Mutex);
+        if (MergedData != NULL) {
+            YoriLibFree(MergedData);
+        }
         return FALSE;
     }
 
-    YoriLibMultibyteInput(ThisBuffer->Buffer, ThisBuffer->BytesPopulated, String->StartOfString, String->LengthAllocated);
+    YoriLibMultibyteInput(Data, ThisBuffer->BytesPopulated, String->StartOfString, String->LengthAllocated);
     String->LengthInChars = LengthNeeded;
     ReleaseMutex(ThisBuffer->Mutex);
 
+    if (MergedData != NULL) {
+        YoriLibFree(MergedData);
+    }
+
     return TRUE;
 }
 
@@ -924,7 +1457,7 @@ YoriLibShPipeProcessBuffers(
     //
 
     if (hPipeOutput != NULL) {
-        if (ThisBufferNonOpaque->OutputBuffer.Buffer != NULL) {
+        if (ThisBufferNonOpaque->OutputBuffer.Chunks.Next != NULL) {
             HaveOutput = TRUE;
         } else {
             return FALSE;
@@ -932,7 +1465,7 @@ YoriLibShPipeProcessBuffers(
     }
 
     if (hPipeErrors != NULL) {
-        if (ThisBufferNonOpaque->ErrorBuffer.Buffer != NULL) {
+        if (ThisBufferNonOpaque->ErrorBuffer.Chunks.Next != NULL) {
             HaveErrors = TRUE;
         } else {
             return FALSE;
@@ -293,7 +293,7 @@ YoriLibShInitializeRedirection(
         HANDLE ReadHandle;
         HANDLE WriteHandle;
         HANDLE NewHandle;
-        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, YoriLibShGetBufferPipeSize())) {
 
             if (!YoriLibMakeInheritableHandle(WriteHandle, &NewHandle)) {
                 Error = GetLastError();
@@ -364,7 +364,7 @@ YoriLibShInitializeRedirection(
         HANDLE ReadHandle;
         HANDLE WriteHandle;
         HANDLE NewHandle;
-        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, 0)) {
+        if (CreatePipe(&ReadHandle, &WriteHandle, NULL, YoriLibShGetBufferPipeSize())) {
 
             if (!YoriLibMakeInheritableHandle(WriteHandle, &NewHandle)) {
                 Error = GetLastError();
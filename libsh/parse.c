@@ -138,9 +138,13 @@ YoriLibShIsArgumentSeperator(
 }
 
 /**
- Allocate the ArgV and ArgContexts arrays within a CmdContext.  Optionally the
- caller can request additional bytes to be in this allocation, and if so, this
- routine will output a pointer to the additional payload.
+ Allocate the ArgV and ArgContexts arrays within a CmdContext, optionally
+ from an arena.  Optionally the caller can request additional bytes to be in
+ this allocation, and if so, this routine will output a pointer to the
+ additional payload.
+
+ @param Arena Optionally points to an arena to allocate from.  If NULL, the
+        arrays are allocated from the heap.
 
  @param CmdContext Pointer to the CmdContext whose arrays should be allocated.
 
@@ -156,7 +160,8 @@ YoriLibShIsArgumentSeperator(
  */
 __success(return)
 BOOLEAN
-YoriLibShAllocateArgCount(
+YoriLibShAllocateArgCountFromArena(
+    __inout_opt PYORI_LIB_ARENA Arena,
     __out PYORI_LIBSH_CMD_CONTEXT CmdContext,
     __in YORI_ALLOC_SIZE_T ArgCount,
     __in YORI_ALLOC_SIZE_T ExtraByteCount,
@@ -164,8 +169,14 @@ YoriLibShAllocateArgCount(
     )
 {
     PVOID MemoryToFree;
-    MemoryToFree = YoriLibReferencedMalloc((ArgCount * (sizeof(YORI_STRING) + sizeof(YORI_LIBSH_ARG_CONTEXT))) +
-                                                       ExtraByteCount);
+    YORI_ALLOC_SIZE_T BytesNeeded;
+
+    BytesNeeded = (ArgCount * (sizeof(YORI_STRING) + sizeof(YORI_LIBSH_ARG_CONTEXT))) + ExtraByteCount;
+    if (Arena != NULL) {
+        MemoryToFree = YoriLibArenaReferencedMalloc(Arena, BytesNeeded);
+    } else {
+        MemoryToFree = YoriLibReferencedMalloc(BytesNeeded);
+    }
     if (MemoryToFree == NULL) {
         return FALSE;
     }
@@ -180,10 +191,6 @@ YoriLibShAllocateArgCount(
     CmdContext->ArgContexts = (PYORI_LIBSH_ARG_CONTEXT)YoriLibAddToPointer(CmdContext->ArgV, ArgCount * sizeof(YORI_STRING));
     CmdContext->MemoryToFreeArgContexts = MemoryToFree;
 
-    //
-    //  MSFIX: No explicit reference on ExtraData - is it needed?
-    //
-
     if (ExtraData != NULL) {
         if (ExtraByteCount != 0) {
             *ExtraData = YoriLibAddToPointer(CmdContext->ArgContexts, ArgCount * sizeof(YORI_LIBSH_ARG_CONTEXT));
@@ -195,6 +202,39 @@ YoriLibShAllocateArgCount(
     return TRUE;
 }
 
+/**
+ Allocate the ArgV and ArgContexts arrays within a CmdContext.  Optionally the
+ caller can request additional bytes to be in this allocation, and if so, this
+ routine will output a pointer to the additional payload.
+
+ @param CmdContext Pointer to the CmdContext whose arrays should be allocated.
+
+ @param ArgCount Specifies the number of arguments to allocate.
+
+ @param ExtraByteCount Specifies the number of extra bytes to include in the
+        allocation.  If this is nonzero, the ExtraData argument is mandatory.
+
+ @param ExtraData Pointer to a pointer that will receive the location of the
+        extra allocation, if ExtraByteCount is nonzero.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriLibShAllocateArgCount(
+    __out PYORI_LIBSH_CMD_CONTEXT CmdContext,
+    __in YORI_ALLOC_SIZE_T ArgCount,
+    __in YORI_ALLOC_SIZE_T ExtraByteCount,
+    __out_opt PVOID *ExtraData
+    )
+{
+    //
+    //  MSFIX: No explicit reference on ExtraData - is it needed?
+    //
+
+    return YoriLibShAllocateArgCountFromArena(NULL, CmdContext, ArgCount, ExtraByteCount, ExtraData);
+}
+
 /**
  Remove spaces from the beginning of a Yori string.  Note this implies
  advancing the StartOfString pointer, so a caller cannot assume this
@@ -1339,9 +1379,37 @@ YoriLibShRemoveEscapesFromArgCArgV(
     YORI_ALLOC_SIZE_T ArgIndex;
     YORI_ALLOC_SIZE_T CharIndex;
     YORI_ALLOC_SIZE_T DestIndex;
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    YORI_ALLOC_SIZE_T BufferOffset;
     BOOLEAN EscapeFound;
     PYORI_STRING ThisArg;
+    YORI_STRING Buffer;
 
+    //
+    //  Find the space needed for every argument that contains an escape,
+    //  so that they can all be placed in a single allocation.
+    //
+
+    CharsNeeded = 0;
+    for (ArgIndex = 0; ArgIndex < ArgC; ArgIndex++) {
+        ThisArg = &ArgV[ArgIndex];
+        for (CharIndex = 0; CharIndex < ThisArg->LengthInChars; CharIndex++) {
+            if (YoriLibIsEscapeChar(ThisArg->StartOfString[CharIndex])) {
+                CharsNeeded = CharsNeeded + ThisArg->LengthInChars + 1;
+                break;
+            }
+        }
+    }
+
+    if (CharsNeeded == 0) {
+        return TRUE;
+    }
+
+    if (!YoriLibAllocateString(&Buffer, CharsNeeded)) {
+        return FALSE;
+    }
+
+    BufferOffset = 0;
     for (ArgIndex = 0; ArgIndex < ArgC; ArgIndex++) {
         ThisArg = &ArgV[ArgIndex];
 
@@ -1364,9 +1432,12 @@ YoriLibShRemoveEscapesFromArgCArgV(
         if (EscapeFound) {
             YORI_STRING NewArg;
 
-            if (!YoriLibAllocateString(&NewArg, ThisArg->LengthInChars + 1)) {
-                return FALSE;
-            }
+            YoriLibInitEmptyString(&NewArg);
+            YoriLibReference(Buffer.MemoryToFree);
+            NewArg.MemoryToFree = Buffer.MemoryToFree;
+            NewArg.StartOfString = &Buffer.StartOfString[BufferOffset];
+            NewArg.LengthAllocated = ThisArg->LengthInChars + 1;
+            BufferOffset = BufferOffset + NewArg.LengthAllocated;
 
             for (CharIndex = 0, DestIndex = 0; CharIndex < ThisArg->LengthInChars; CharIndex++, DestIndex++) {
                 if (YoriLibIsEscapeChar(ThisArg->StartOfString[CharIndex])) {
@@ -1387,6 +1458,7 @@ YoriLibShRemoveEscapesFromArgCArgV(
         }
     }
 
+    YoriLibFreeStringContents(&Buffer);
     return TRUE;
 }
 
@@ -1473,10 +1545,35 @@ YoriLibShCopyCmdContext(
     __out PYORI_LIBSH_CMD_CONTEXT DestCmdContext,
     __in PYORI_LIBSH_CMD_CONTEXT SrcCmdContext
     )
+{
+    return YoriLibShCopyCmdContextFromArena(NULL, DestCmdContext, SrcCmdContext);
+}
+
+/**
+ Perform a deep copy of a command context, allocating the new argument array
+ from an arena.  Any arguments from the source are referenced.
+
+ @param Arena Optionally points to an arena to allocate from.  If NULL, the
+        argument array is allocated from the heap.
+
+ @param DestCmdContext Pointer to the command context to populate with contents
+        from the source.
+
+ @param SrcCmdContext Pointer to the source command context.
+
+ @return TRUE to indicate success, or FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibShCopyCmdContextFromArena(
+    __inout_opt PYORI_LIB_ARENA Arena,
+    __out PYORI_LIBSH_CMD_CONTEXT DestCmdContext,
+    __in PYORI_LIBSH_CMD_CONTEXT SrcCmdContext
+    )
 {
     YORI_ALLOC_SIZE_T Count;
 
-    if (!YoriLibShAllocateArgCount(DestCmdContext, SrcCmdContext->ArgC, 0, NULL)) {
+    if (!YoriLibShAllocateArgCountFromArena(Arena, DestCmdContext, SrcCmdContext->ArgC, 0, NULL)) {
         return FALSE;
     }
 
@@ -1790,6 +1887,9 @@ YoriLibShCheckForDeviceNameAndDuplicate(
  different programs, as well as redirection information for the
  program being parsed.
 
+ @param Arena Optionally points to an arena to allocate the program's
+        arguments from.  If NULL, they are allocated from the heap.
+
  @param CmdContext Pointer to a raw series of arguments to parse for
         and individual program's execution.
 
@@ -1819,6 +1919,7 @@ YoriLibShCheckForDeviceNameAndDuplicate(
 __success(return > 0)
 YORI_ALLOC_SIZE_T
 YoriLibShParseCmdContextToExecContext(
+    __inout_opt PYORI_LIB_ARENA Arena,
     __in PYORI_LIBSH_CMD_CONTEXT CmdContext,
     __in YORI_ALLOC_SIZE_T InitialArgument,
     __out PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext,
@@ -1877,7 +1978,7 @@ YoriLibShParseCmdContextToExecContext(
 
     ArgumentsConsumed = Count - InitialArgument;
 
-    if (!YoriLibShAllocateArgCount(&ExecContext->CmdToExec, ArgumentsConsumed, 0, NULL)) {
+    if (!YoriLibShAllocateArgCountFromArena(Arena, &ExecContext->CmdToExec, ArgumentsConsumed, 0, NULL)) {
         return 0;
     }
     ExecContext->CmdToExec.ArgC = 0;
@@ -2124,7 +2225,7 @@ YoriLibShDereferenceExecContext(
     if (InterlockedDecrement((LONG *)&ExecContext->ReferenceCount) == 0) {
         YoriLibShFreeExecContext(ExecContext);
         if (Deallocate) {
-            YoriLibFree(ExecContext);
+            YoriLibDereference(ExecContext);
         }
     }
 }
@@ -2208,6 +2309,7 @@ YoriLibShParseCmdContextToExecPlan(
     BOOLEAN FoundProgramMatch;
     YORI_ALLOC_SIZE_T LocalCurrentArgIndex;
     YORI_ALLOC_SIZE_T LocalCurrentArgOffset;
+    YORI_LIB_ARENA Arena;
 
     if (CmdContext->ArgC == 0) {
         return FALSE;
@@ -2232,11 +2334,19 @@ YoriLibShParseCmdContextToExecPlan(
     ZeroMemory(ExecPlan, sizeof(YORI_LIBSH_EXEC_PLAN));
     FoundProgramMatch = FALSE;
 
+    //
+    //  The programs within a plan, and their arguments, are typically freed
+    //  together, so allocate them from an arena rather than individually.
+    //
+
+    YoriLibInitializeArena(&Arena, 0);
+
     //
     //  First, turn the entire CmdContext into an ExecContext.
     //
 
-    if (!YoriLibShCopyCmdContext(&ExecPlan->EntireCmd.CmdToExec, CmdContext)) {
+    if (!YoriLibShCopyCmdContextFromArena(&Arena, &ExecPlan->EntireCmd.CmdToExec, CmdContext)) {
+        YoriLibCleanupArena(&Arena);
         YoriLibShFreeExecPlan(ExecPlan);
         return FALSE;
     }
@@ -2246,15 +2356,17 @@ YoriLibShParseCmdContextToExecPlan(
 
     while (CurrentArg < CmdContext->ArgC) {
 
-        ThisProgram = YoriLibMalloc(sizeof(YORI_LIBSH_SINGLE_EXEC_CONTEXT));
+        ThisProgram = YoriLibArenaReferencedMalloc(&Arena, sizeof(YORI_LIBSH_SINGLE_EXEC_CONTEXT));
         if (ThisProgram == NULL) {
+            YoriLibCleanupArena(&Arena);
             YoriLibShFreeExecPlan(ExecPlan);
             return FALSE;
         }
 
-        ArgsConsumed = YoriLibShParseCmdContextToExecContext(CmdContext, CurrentArg, ThisProgram, &LocalCurrentArgIsForProgram, &LocalCurrentArgIndex, &LocalCurrentArgOffset);
+        ArgsConsumed = YoriLibShParseCmdContextToExecContext(&Arena, CmdContext, CurrentArg, ThisProgram, &LocalCurrentArgIsForProgram, &LocalCurrentArgIndex, &LocalCurrentArgOffset);
         if (ArgsConsumed == 0) {
             YoriLibShDereferenceExecContext(ThisProgram, TRUE);
+            YoriLibCleanupArena(&Arena);
             YoriLibShFreeExecPlan(ExecPlan);
             return FALSE;
         }
@@ -2405,6 +2517,7 @@ YoriLibShParseCmdContextToExecPlan(
         }
     }
 
+    YoriLibCleanupArena(&Arena);
     return TRUE;
 }
 
@@ -2850,6 +2963,85 @@ YoriLibShFindNextBackquoteSubstring(
     return FALSE;
 }
 
+/**
+ Search through a string and return all of the backquote substrings to
+ execute, provided that none of them are nested within another and all of
+ them are complete.  In this case each substring can be executed without
+ depending on the result of any other.  If any substring is nested or
+ incomplete, or there are more substrings than the caller can accept, this
+ function returns FALSE and the caller is expected to use
+ @ref YoriLibShFindNextBackquoteSubstring instead.
+
+ @param String Pointer to the string to process.
+
+ @param MaxSubsets The number of elements in the Subsets and CharsInPrefix
+        arrays.
+
+ @param Subsets On successful completion, populated with each substring to
+        execute, in the order they occur within String.  These share an
+        allocation with String, are not referenced, and are not NULL
+        terminated.
+
+ @param CharsInPrefix On successful completion, populated with the number of
+        characters before each substring that were used to indicate its
+        commencement.
+
+ @param SubsetCount On successful completion, updated to indicate the number
+        of substrings found.
+
+ @return TRUE if the string consists of independent substrings, FALSE if it
+         does not.
+ */
+__success(return)
+BOOL
+YoriLibShFindIndependentBackquoteSubstrings(
+    __in PYORI_STRING String,
+    __in YORI_ALLOC_SIZE_T MaxSubsets,
+    __out_ecount(MaxSubsets) PYORI_STRING Subsets,
+    __out_ecount(MaxSubsets) PYORI_ALLOC_SIZE_T CharsInPrefix,
+    __out PYORI_ALLOC_SIZE_T SubsetCount
+    )
+{
+    YORI_LIBSH_BACKQUOTE_CONTEXT BackquoteContext;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIBSH_BACKQUOTE_ENTRY BackquoteEntry;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (!YoriLibShParseBackquoteSubstrings(String, &BackquoteContext)) {
+        return FALSE;
+    }
+
+    if (BackquoteContext.MaxDepth != 1 ||
+        BackquoteContext.MatchCount > MaxSubsets) {
+
+        YoriLibShFreeBackquoteContext(&BackquoteContext);
+        return FALSE;
+    }
+
+    Index = 0;
+    ListEntry = YoriLibGetNextListEntry(&BackquoteContext.MatchList, NULL);
+    while (ListEntry != NULL) {
+        BackquoteEntry = CONTAINING_RECORD(ListEntry, YORI_LIBSH_BACKQUOTE_ENTRY, MatchList);
+        if (!BackquoteEntry->Terminated) {
+            YoriLibShFreeBackquoteContext(&BackquoteContext);
+            return FALSE;
+        }
+
+        memcpy(&Subsets[Index], &BackquoteEntry->String, sizeof(YORI_STRING));
+        if (BackquoteEntry->NewStyleMatch) {
+            CharsInPrefix[Index] = 2;
+        } else {
+            CharsInPrefix[Index] = 1;
+        }
+        Index++;
+        ListEntry = YoriLibGetNextListEntry(&BackquoteContext.MatchList, ListEntry);
+    }
+
+    *SubsetCount = Index;
+    YoriLibShFreeBackquoteContext(&BackquoteContext);
+    return TRUE;
+}
+
 /**
  Given a string and a current selected offset within the string, find the
  "best" backquote substring for tab completion.  This means the innermost
@@ -512,6 +512,24 @@ typedef struct _YORI_LIBSH_BUILTIN_CALLBACK {
 
 } YORI_LIBSH_BUILTIN_CALLBACK, *PYORI_LIBSH_BUILTIN_CALLBACK;
 
+/**
+ A structure defining a mapping between a command name and a function to
+ execute.  Tables of these are compiled into a program to describe the
+ builtin commands that it statically links.
+ */
+typedef struct _YORI_LIBSH_BUILTIN_NAME_MAPPING {
+
+    /**
+     The command name.
+     */
+    LPTSTR CommandName;
+
+    /**
+     Pointer to the function to execute.
+     */
+    PYORI_CMD_BUILTIN BuiltinFn;
+} YORI_LIBSH_BUILTIN_NAME_MAPPING, *PYORI_LIBSH_BUILTIN_NAME_MAPPING;
+
 // *** BUILTIN.C ***
 
 PYORI_LIBSH_LOADED_MODULE
@@ -554,6 +572,12 @@ YoriLibShBuiltinRegister(
     __in PYORI_CMD_BUILTIN CallbackFn
     );
 
+__success(return)
+BOOL
+YoriLibShBuiltinRegisterStaticTable(
+    __in YORI_LIBSH_BUILTIN_NAME_MAPPING CONST *Table
+    );
+
 __success(return)
 BOOL
 YoriLibShBuiltinUnregister(
@@ -572,6 +596,9 @@ YoriLibShSetUnloadRoutine(
 
 // *** CMDBUF.C ***
 
+DWORD
+YoriLibShGetBufferPipeSize(VOID);
+
 __success(return)
 BOOL
 YoriLibShCreateNewProcessBuffer(
@@ -687,6 +714,16 @@ YoriLibShAllocateArgCount(
     __out_opt PVOID *ExtraData
     );
 
+__success(return)
+BOOLEAN
+YoriLibShAllocateArgCountFromArena(
+    __inout_opt PYORI_LIB_ARENA Arena,
+    __out PYORI_LIBSH_CMD_CONTEXT CmdContext,
+    __in YORI_ALLOC_SIZE_T ArgCount,
+    __in YORI_ALLOC_SIZE_T ExtraByteCount,
+    __out_opt PVOID *ExtraData
+    );
+
 __success(return)
 BOOLEAN
 YoriLibShBuildCmdlineFromCmdContext(
@@ -710,6 +747,14 @@ YoriLibShCopyCmdContext(
     __in PYORI_LIBSH_CMD_CONTEXT SrcCmdContext
     );
 
+__success(return)
+BOOL
+YoriLibShCopyCmdContextFromArena(
+    __inout_opt PYORI_LIB_ARENA Arena,
+    __out PYORI_LIBSH_CMD_CONTEXT DestCmdContext,
+    __in PYORI_LIBSH_CMD_CONTEXT SrcCmdContext
+    );
+
 VOID
 YoriLibShCopyArg(
     __in PYORI_LIBSH_CMD_CONTEXT SrcCmdContext,
@@ -740,6 +785,16 @@ YoriLibShFindBestBackquoteSubstringAtOffset(
     __out PYORI_STRING CurrentSubset
     );
 
+__success(return)
+BOOL
+YoriLibShFindIndependentBackquoteSubstrings(
+    __in PYORI_STRING String,
+    __in YORI_ALLOC_SIZE_T MaxSubsets,
+    __out_ecount(MaxSubsets) PYORI_STRING Subsets,
+    __out_ecount(MaxSubsets) PYORI_ALLOC_SIZE_T CharsInPrefix,
+    __out PYORI_ALLOC_SIZE_T SubsetCount
+    );
+
 __success(return)
 BOOL
 YoriLibShFindNextBackquoteSubstring(
@@ -153,6 +153,26 @@ typedef struct _YORI_WIN_CTRL_HEX_EDIT {
      */
     YORI_ALLOC_SIZE_T LastDirtyLine;
 
+    /**
+     The first byte in the buffer that has been modified since the modify
+     state was last reset.  If this is not less than BeyondLastModifiedByte,
+     no bytes have been modified.
+     */
+    YORI_ALLOC_SIZE_T FirstModifiedByte;
+
+    /**
+     The byte beyond the last byte in the buffer that has been modified since
+     the modify state was last reset.
+     */
+    YORI_ALLOC_SIZE_T BeyondLastModifiedByte;
+
+    /**
+     The offset to add to the buffer offset when displaying offsets.  This
+     allows the buffer to contain a window of a larger object, where
+     displayed offsets describe the location within that object.
+     */
+    DWORDLONG DisplayOffset;
+
     /**
      Specifies the selection state of text within the multiline edit control.
      This is encapsulated into a structure purely for readability.
@@ -1461,10 +1481,10 @@ YoriWinHexEditPaintSingleLine(
 
         if (HexEdit->OffsetWidth == 64) {
             DWORDLONG LongOffset;
-            LongOffset = Offset;
+            LongOffset = HexEdit->DisplayOffset + Offset;
             String.LengthInChars = YoriLibSPrintfS(String.StartOfString, String.LengthAllocated, _T("%08x`%08x: "), (DWORD)(LongOffset >> 32), (DWORD)LongOffset);
         } else if (HexEdit->OffsetWidth == 32) {
-            String.LengthInChars = YoriLibSPrintfS(String.StartOfString, String.LengthAllocated, _T("%08x: "), Offset);
+            String.LengthInChars = YoriLibSPrintfS(String.StartOfString, String.LengthAllocated, _T("%08x: "), (DWORD)(HexEdit->DisplayOffset + Offset));
         }
 
         for (ColumnIndex = 0; ColumnIndex < String.LengthInChars; ColumnIndex++) {
@@ -1973,6 +1993,7 @@ YoriWinHexEditDeleteCell(
         case YoriWinHexEditCellTypeHexDigit:
             if (BitShift == 0) {
                 if (BufferOffset < HexEdit->BufferValid) {
+                    YoriWinHexEditExpandModifiedRange(HexEdit, BufferOffset, HexEdit->BufferValid);
                     BytesToCopy = HexEdit->BufferValid - BufferOffset;
                     if (BytesToCopy > HexEdit->BytesPerWord) {
                         BytesToCopy = BytesToCopy - HexEdit->BytesPerWord;
@@ -1999,6 +2020,7 @@ YoriWinHexEditDeleteCell(
                 InputChar = *Cell;
                 InputChar = (UCHAR)(InputChar & ~(BitMask));
                 *Cell = InputChar;
+                YoriWinHexEditExpandModifiedRange(HexEdit, BufferOffset, BufferOffset + 1);
 
                 YoriWinHexEditNextCellSameType(HexEdit, CellType, BufferOffset, BitShift, &CurrentLine, &CurrentCharOffset);
             }
@@ -2006,6 +2028,7 @@ YoriWinHexEditDeleteCell(
             break;
         case YoriWinHexEditCellTypeCharValue:
             if (BufferOffset < HexEdit->BufferValid) {
+                YoriWinHexEditExpandModifiedRange(HexEdit, BufferOffset, HexEdit->BufferValid);
                 BytesToCopy = HexEdit->BufferValid - BufferOffset;
                 if (BytesToCopy > 1) {
                     BytesToCopy = BytesToCopy - 1;
@@ -2027,6 +2050,41 @@ YoriWinHexEditDeleteCell(
     return TRUE;
 }
 
+/**
+ Expand the range of bytes that have been modified to include a new range.
+
+ @param HexEdit Pointer to the hex edit control.
+
+ @param FirstByte The first byte that has been modified.
+
+ @param BeyondLastByte The byte beyond the last byte that has been modified.
+ */
+VOID
+YoriWinHexEditExpandModifiedRange(
+    __in PYORI_WIN_CTRL_HEX_EDIT HexEdit,
+    __in YORI_ALLOC_SIZE_T FirstByte,
+    __in YORI_ALLOC_SIZE_T BeyondLastByte
+    )
+{
+    if (FirstByte >= BeyondLastByte) {
+        return;
+    }
+
+    if (HexEdit->FirstModifiedByte >= HexEdit->BeyondLastModifiedByte) {
+        HexEdit->FirstModifiedByte = FirstByte;
+        HexEdit->BeyondLastModifiedByte = BeyondLastByte;
+        return;
+    }
+
+    if (FirstByte < HexEdit->FirstModifiedByte) {
+        HexEdit->FirstModifiedByte = FirstByte;
+    }
+
+    if (BeyondLastByte > HexEdit->BeyondLastModifiedByte) {
+        HexEdit->BeyondLastModifiedByte = BeyondLastByte;
+    }
+}
+
 /**
  Ensure the buffer has enough space for a specified buffer size.  This may
  reallocate the buffer if required.
@@ -2112,6 +2170,7 @@ YoriWinHexEditEnsureBufferValid(
         return FALSE;
     }
     ZeroMemory(YoriLibAddToPointer(HexEdit->Buffer, HexEdit->BufferValid), (DWORD)(NewBufferLength - HexEdit->BufferValid));
+    YoriWinHexEditExpandModifiedRange(HexEdit, HexEdit->BufferValid, NewBufferLength);
     HexEdit->BufferValid = NewBufferLength;
     return TRUE;
 }
@@ -2156,6 +2215,7 @@ YoriWinHexEditInsertSpaceInBuffer(
 
     ZeroMemory(&HexEdit->Buffer[BufferOffset], BytesToInsert);
     HexEdit->BufferValid = HexEdit->BufferValid + BytesToInsert;
+    YoriWinHexEditExpandModifiedRange(HexEdit, BufferOffset, HexEdit->BufferValid);
     ASSERT(HexEdit->BufferValid <= HexEdit->BufferAllocated);
 
     return TRUE;
@@ -2275,6 +2335,7 @@ YoriWinHexEditInsertCell(
             InputChar = (UCHAR)(InputChar & ~(BitMask));
             InputChar = (UCHAR)(InputChar | (NewNibble << EditBitShift));
             *Cell = InputChar;
+            YoriWinHexEditExpandModifiedRange(HexEdit, EditBufferOffset, EditBufferOffset + 1);
             CellUpdated = TRUE;
 
             break;
@@ -2402,6 +2463,7 @@ YoriWinHexEditOverwriteCell(
             InputChar = (UCHAR)(InputChar & ~(BitMask));
             InputChar = (UCHAR)(InputChar | (NewNibble << EditBitShift));
             *Cell = InputChar;
+            YoriWinHexEditExpandModifiedRange(HexEdit, EditBufferOffset, EditBufferOffset + 1);
             CellUpdated = TRUE;
 
             break;
@@ -2415,6 +2477,7 @@ YoriWinHexEditOverwriteCell(
             }
             Cell = YoriLibAddToPointer(HexEdit->Buffer, EditBufferOffset);
             *Cell = InputChar;
+            YoriWinHexEditExpandModifiedRange(HexEdit, EditBufferOffset, EditBufferOffset + 1);
             CellUpdated = TRUE;
             break;
     }
@@ -2471,6 +2534,8 @@ YoriWinHexEditSetDataNoCopy(
     HexEdit->Buffer = NewBuffer;
     HexEdit->BufferAllocated = NewBufferAllocated;
     HexEdit->BufferValid = NewBufferValid;
+    HexEdit->FirstModifiedByte = 0;
+    HexEdit->BeyondLastModifiedByte = 0;
 
     //
     //  Mark the whole range as dirty.  We didn't bother to count how many
@@ -3275,6 +3340,9 @@ YoriWinHexEditClear(
     }
     HexEdit->BufferAllocated = 0;
     HexEdit->BufferValid = 0;
+    HexEdit->FirstModifiedByte = 0;
+    HexEdit->BeyondLastModifiedByte = 0;
+    HexEdit->DisplayOffset = 0;
 
     HexEdit->ViewportTop = 0;
     HexEdit->ViewportLeft = 0;
@@ -3356,6 +3424,10 @@ YoriWinHexEditSetModifyState(
 
     PreviousValue = HexEdit->UserModified;
     HexEdit->UserModified = ModifyState;
+    if (!ModifyState) {
+        HexEdit->FirstModifiedByte = 0;
+        HexEdit->BeyondLastModifiedByte = 0;
+    }
     return PreviousValue;
 }
 
@@ -3383,6 +3455,72 @@ YoriWinHexEditGetModifyState(
     return HexEdit->UserModified;
 }
 
+/**
+ Return the range of bytes within the control that have been modified since
+ the last time @ref YoriWinHexEditSetModifyState indicated that no user
+ modification has occurred.  If bytes were inserted or removed, the range
+ extends to the end of the buffer.
+
+ @param CtrlHandle Pointer to the hex edit control.
+
+ @param FirstByte On successful completion, updated to contain the first
+        modified byte.
+
+ @param BeyondLastByte On successful completion, updated to contain the byte
+        beyond the last modified byte.  This can exceed the current buffer
+        length if data was removed.
+
+ @return TRUE if any bytes have been modified, FALSE if none have.
+ */
+__success(return)
+BOOLEAN
+YoriWinHexEditGetModifiedRange(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __out PYORI_ALLOC_SIZE_T FirstByte,
+    __out PYORI_ALLOC_SIZE_T BeyondLastByte
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_HEX_EDIT HexEdit;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    HexEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_HEX_EDIT, Ctrl);
+
+    if (HexEdit->FirstModifiedByte >= HexEdit->BeyondLastModifiedByte) {
+        return FALSE;
+    }
+
+    *FirstByte = HexEdit->FirstModifiedByte;
+    *BeyondLastByte = HexEdit->BeyondLastModifiedByte;
+    return TRUE;
+}
+
+/**
+ Set the offset to add to buffer offsets when displaying them.  This is used
+ when the control contains a window of a larger object so that displayed
+ offsets refer to the location within the object.
+
+ @param CtrlHandle Pointer to the hex edit control.
+
+ @param DisplayOffset The offset of the first byte in the buffer.
+ */
+VOID
+YoriWinHexEditSetDisplayOffset(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in DWORDLONG DisplayOffset
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_HEX_EDIT HexEdit;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    HexEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_HEX_EDIT, Ctrl);
+
+    HexEdit->DisplayOffset = DisplayOffset;
+    YoriWinHexEditExpandDirtyRange(HexEdit, 0, (YORI_ALLOC_SIZE_T)-1);
+    YoriWinHexEditPaint(HexEdit);
+}
+
 /**
  Set a function to call when the cursor location changes.
 
@@ -3685,6 +3823,7 @@ YoriWinHexEditDeleteData(
         LengthToRemove = HexEdit->BufferValid - DataOffset;
     }
 
+    YoriWinHexEditExpandModifiedRange(HexEdit, DataOffset, HexEdit->BufferValid);
     if (HexEdit->BufferValid > DataOffset + LengthToRemove) {
         memmove(&HexEdit->Buffer[DataOffset],
                 &HexEdit->Buffer[DataOffset + LengthToRemove],
@@ -3781,6 +3920,7 @@ YoriWinHexEditReplaceData(
     memmove(&HexEdit->Buffer[DataOffset],
             Data,
             (DWORD)Length);
+    YoriWinHexEditExpandModifiedRange(HexEdit, DataOffset, DataOffset + Length);
 
     FirstDirtyLine = (YORI_ALLOC_SIZE_T)(DataOffset / HexEdit->BytesPerLine);
     LastDirtyLine = (YORI_ALLOC_SIZE_T)((DataOffset + Length) / HexEdit->BytesPerLine);
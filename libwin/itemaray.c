@@ -228,7 +228,7 @@ YoriWinItemArrayAddItems(
 
     LengthInChars = 0;
     for (Index = 0; Index < NumNewItems; Index++) {
-        LengthInChars += (NewItems[Index].LengthInChars + 1) * sizeof(TCHAR);
+        LengthInChars += NewItems[Index].LengthInChars + 1;
     }
 
     if (!YoriWinItemArrayEnsureSpaceForStrings(ItemArray, LengthInChars)) {
@@ -289,7 +289,7 @@ YoriWinItemArrayAddItemArray(
 
     LengthInChars = 0;
     for (Index = 0; Index < NewItems->Count; Index++) {
-        LengthInChars += (NewItems->Items[Index].String.LengthInChars + 1) * sizeof(TCHAR);
+        LengthInChars += NewItems->Items[Index].String.LengthInChars + 1;
     }
 
     if (!YoriWinItemArrayEnsureSpaceForStrings(ItemArray, LengthInChars)) {
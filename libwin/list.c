@@ -29,6 +29,19 @@
 #include "yoriwin.h"
 #include "winpriv.h"
 
+/**
+ The maximum number of characters that can be typed to locate an item in
+ the list.
+ */
+#define YORI_WIN_LIST_TYPE_AHEAD_MAX (32)
+
+/**
+ The time in milliseconds between characters typed to locate an item for
+ the characters to be combined into a single search.  After this time, a
+ new search starts with the next character.
+ */
+#define YORI_WIN_LIST_TYPE_AHEAD_TIMEOUT (1000)
+
 
 /**
  A structure describing the contents of a list control.
@@ -55,6 +68,35 @@ typedef struct _YORI_WIN_CTRL_LIST {
      */
     YORI_WIN_ITEM_ARRAY ItemArray;
 
+    /**
+     If non-NULL, the list is virtual: items are not stored in ItemArray,
+     and this function is invoked to obtain the text of each item as it is
+     needed.
+     */
+    PYORI_WIN_LIST_GET_ITEM_TEXT GetVirtualItemText;
+
+    /**
+     The number of items in a virtual list.
+     */
+    YORI_ALLOC_SIZE_T VirtualItemCount;
+
+    /**
+     The tick count when a character was last typed to locate an item.
+     */
+    DWORD LastTypeAheadTick;
+
+    /**
+     The number of characters in TypeAheadBuffer.
+     */
+    YORI_ALLOC_SIZE_T TypeAheadLength;
+
+    /**
+     The characters typed to locate an item.  Characters typed in quick
+     succession are combined so that an item can be located by a prefix
+     rather than only its first character.
+     */
+    TCHAR TypeAheadBuffer[YORI_WIN_LIST_TYPE_AHEAD_MAX];
+
     /**
      The index within ItemArray of the first array element to display in the
      list
@@ -111,8 +153,74 @@ typedef struct _YORI_WIN_CTRL_LIST {
      */
     BOOLEAN DisplayBorder;
 
+    /**
+     If TRUE, the items in a virtual list are sorted case insensitively, so
+     items can be located by binary search.
+     */
+    BOOLEAN VirtualItemsSorted;
+
 } YORI_WIN_CTRL_LIST, *PYORI_WIN_CTRL_LIST;
 
+/**
+ Return the number of items in the list, whether they are stored in the
+ control or provided by a virtual item source.
+
+ @param List Pointer to the list control.
+
+ @return The number of items in the list.
+ */
+YORI_ALLOC_SIZE_T
+YoriWinListGetCount(
+    __in PYORI_WIN_CTRL_LIST List
+    )
+{
+    if (List->GetVirtualItemText != NULL) {
+        return List->VirtualItemCount;
+    }
+    return List->ItemArray.Count;
+}
+
+/**
+ Obtain the text of an item in the list, whether it is stored in the control
+ or provided by a virtual item source.
+
+ @param List Pointer to the list control.
+
+ @param Index Specifies the item to obtain text for.
+
+ @param Text On successful completion, updated to refer to the text of the
+        item.  The caller should free this with
+        @ref YoriLibFreeStringContents .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListGetItemString(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in YORI_ALLOC_SIZE_T Index,
+    __out PYORI_STRING Text
+    )
+{
+    YoriLibInitEmptyString(Text);
+
+    if (Index >= YoriWinListGetCount(List)) {
+        return FALSE;
+    }
+
+    if (List->GetVirtualItemText != NULL) {
+        if (!List->GetVirtualItemText(&List->Ctrl, Index, Text)) {
+            YoriLibFreeStringContents(Text);
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    Text->StartOfString = List->ItemArray.Items[Index].String.StartOfString;
+    Text->LengthInChars = List->ItemArray.Items[Index].String.LengthInChars;
+    return TRUE;
+}
+
 /**
  Move the first displayed option in the list to ensure that the currently
  selected item is within the display.
@@ -138,8 +246,8 @@ YoriWinListEnsureActiveItemVisible(
         ElementCountToDisplay = ClientSize.Y;
     }
 
-    if (List->ItemArray.Count < ElementCountToDisplay) {
-        ElementCountToDisplay = (WORD)List->ItemArray.Count;
+    if (YoriWinListGetCount(List) < ElementCountToDisplay) {
+        ElementCountToDisplay = (WORD)YoriWinListGetCount(List);
     }
 
     if (List->ActiveOption < List->FirstDisplayedOption) {
@@ -147,12 +255,12 @@ YoriWinListEnsureActiveItemVisible(
     }
 
     if (List->FirstDisplayedOption > 0 &&
-        List->FirstDisplayedOption + ElementCountToDisplay > List->ItemArray.Count) {
+        List->FirstDisplayedOption + ElementCountToDisplay > YoriWinListGetCount(List)) {
 
-        if (List->ItemArray.Count < ElementCountToDisplay) {
+        if (YoriWinListGetCount(List) < ElementCountToDisplay) {
             List->FirstDisplayedOption = 0;
         } else {
-            List->FirstDisplayedOption = (WORD)(List->ItemArray.Count - ElementCountToDisplay);
+            List->FirstDisplayedOption = (WORD)(YoriWinListGetCount(List) - ElementCountToDisplay);
         }
     }
 
@@ -182,19 +290,23 @@ YoriWinListPaintVerticalList(
     WORD ElementCountToDisplay;
     WORD Attributes;
     WORD WindowAttributes;
-    PYORI_WIN_ITEM_ENTRY Element;
+    YORI_ALLOC_SIZE_T ItemIndex;
+    YORI_STRING ItemText;
     COORD ClientSize;
 
     WindowAttributes = List->Ctrl.DefaultAttributes;
     YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
     ElementCountToDisplay = ClientSize.Y;
 
-    if (List->ItemArray.Count < ElementCountToDisplay) {
-        ElementCountToDisplay = (WORD)List->ItemArray.Count;
+    if (YoriWinListGetCount(List) < ElementCountToDisplay) {
+        ElementCountToDisplay = (WORD)YoriWinListGetCount(List);
     }
 
     for (RowIndex = 0; RowIndex < ElementCountToDisplay; RowIndex++) {
-        Element = &List->ItemArray.Items[List->FirstDisplayedOption + RowIndex];
+        ItemIndex = List->FirstDisplayedOption + RowIndex;
+        if (!YoriWinListGetItemString(List, ItemIndex, &ItemText)) {
+            YoriLibInitEmptyString(&ItemText);
+        }
         Attributes = WindowAttributes;
         if (List->ItemActive &&
             RowIndex + List->FirstDisplayedOption == List->ActiveOption) {
@@ -203,17 +315,17 @@ YoriWinListPaintVerticalList(
         }
         if (List->MultiSelect) {
             CharsToDisplay = (WORD)(ClientSize.X - 2);
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
-            if (Element->Flags & YORI_WIN_ITEM_SELECTED) {
+            if (List->ItemArray.Items[ItemIndex].Flags & YORI_WIN_ITEM_SELECTED) {
                 YoriWinSetControlClientCell(&List->Ctrl, 0, RowIndex, '*', Attributes);
             } else {
                 YoriWinSetControlClientCell(&List->Ctrl, 0, RowIndex, ' ', Attributes);
             }
             YoriWinSetControlClientCell(&List->Ctrl, 1, RowIndex, ' ', Attributes);
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < ClientSize.X - 2; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellIndex + 2), RowIndex, ' ', Attributes);
@@ -221,16 +333,18 @@ YoriWinListPaintVerticalList(
 
         } else {
             CharsToDisplay = ClientSize.X;
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < ClientSize.X; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, CellIndex, RowIndex, ' ', Attributes);
             }
         }
+
+        YoriLibFreeStringContents(&ItemText);
     }
 
     //
@@ -245,8 +359,8 @@ YoriWinListPaintVerticalList(
 
     if (List->VScrollCtrl) {
         DWORD MaximumTopValue;
-        if (List->ItemArray.Count > (DWORD)ClientSize.Y) {
-            MaximumTopValue = List->ItemArray.Count - ClientSize.Y;
+        if (YoriWinListGetCount(List) > (DWORD)ClientSize.Y) {
+            MaximumTopValue = YoriWinListGetCount(List) - ClientSize.Y;
         } else {
             MaximumTopValue = 0;
         }
@@ -292,19 +406,23 @@ YoriWinListPaintHorizontalList(
     WORD ElementCountToDisplay;
     WORD Attributes;
     WORD WindowAttributes;
-    PYORI_WIN_ITEM_ENTRY Element;
+    YORI_ALLOC_SIZE_T ItemIndex;
+    YORI_STRING ItemText;
     COORD ClientSize;
 
     WindowAttributes = List->Ctrl.DefaultAttributes;
     YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
     ElementCountToDisplay = (WORD)(ClientSize.X / List->HorizontalItemWidth);
 
-    if (List->ItemArray.Count < ElementCountToDisplay) {
-        ElementCountToDisplay = (WORD)List->ItemArray.Count;
+    if (YoriWinListGetCount(List) < ElementCountToDisplay) {
+        ElementCountToDisplay = (WORD)YoriWinListGetCount(List);
     }
 
     for (RowIndex = 0; RowIndex < ElementCountToDisplay; RowIndex++) {
-        Element = &List->ItemArray.Items[List->FirstDisplayedOption + RowIndex];
+        ItemIndex = List->FirstDisplayedOption + RowIndex;
+        if (!YoriWinListGetItemString(List, ItemIndex, &ItemText)) {
+            YoriLibInitEmptyString(&ItemText);
+        }
         CellOffset = (WORD)(List->HorizontalItemWidth * RowIndex);
         Attributes = WindowAttributes;
         if (List->ItemActive &&
@@ -314,18 +432,18 @@ YoriWinListPaintHorizontalList(
         }
         if (List->MultiSelect) {
             CharsToDisplay = (WORD)(List->HorizontalItemWidth - 4);
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
             YoriWinSetControlClientCell(&List->Ctrl, CellOffset, 0, ' ', Attributes);
-            if (Element->Flags & YORI_WIN_ITEM_SELECTED) {
+            if (List->ItemArray.Items[ItemIndex].Flags & YORI_WIN_ITEM_SELECTED) {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + 1), 0, '*', Attributes);
             } else {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + 1), 0, ' ', Attributes);
             }
             YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + 2), 0, ' ', Attributes);
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 3), 0, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 3), 0, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < List->HorizontalItemWidth - 3; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 3), 0, ' ', Attributes);
@@ -333,17 +451,19 @@ YoriWinListPaintHorizontalList(
 
         } else {
             CharsToDisplay = (WORD)(List->HorizontalItemWidth - 2);
-            if (CharsToDisplay > Element->String.LengthInChars) {
-                CharsToDisplay = (WORD)Element->String.LengthInChars;
+            if (CharsToDisplay > ItemText.LengthInChars) {
+                CharsToDisplay = (WORD)ItemText.LengthInChars;
             }
             YoriWinSetControlClientCell(&List->Ctrl, CellOffset, 0, ' ', Attributes);
             for (CellIndex = 0; CellIndex < CharsToDisplay; CellIndex++) {
-                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 1), 0, Element->String.StartOfString[CellIndex], Attributes);
+                YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 1), 0, ItemText.StartOfString[CellIndex], Attributes);
             }
             for (;CellIndex < List->HorizontalItemWidth - 1; CellIndex++) {
                 YoriWinSetControlClientCell(&List->Ctrl, (WORD)(CellOffset + CellIndex + 1), 0, ' ', Attributes);
             }
         }
+
+        YoriLibFreeStringContents(&ItemText);
     }
 
     //
@@ -412,6 +532,7 @@ YoriWinListClearAllItems(
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
     YoriWinItemArrayCleanup(&List->ItemArray);
+    List->VirtualItemCount = 0;
     List->FirstDisplayedOption = 0;
     List->ActiveOption = 0;
     if (List->ItemActive) {
@@ -449,16 +570,16 @@ YoriWinListNotifyScrollChange(
     ElementCountToDisplay = ClientSize.Y;
 
     ScrollValue = YoriWinScrollBarGetPosition(ScrollCtrl);
-    ASSERT(ScrollValue <= List->ItemArray.Count);
-    if (ScrollValue + ElementCountToDisplay > List->ItemArray.Count) {
-        if (List->ItemArray.Count >= ElementCountToDisplay) {
-            List->FirstDisplayedOption = List->ItemArray.Count - ElementCountToDisplay;
+    ASSERT(ScrollValue <= YoriWinListGetCount(List));
+    if (ScrollValue + ElementCountToDisplay > YoriWinListGetCount(List)) {
+        if (YoriWinListGetCount(List) >= ElementCountToDisplay) {
+            List->FirstDisplayedOption = YoriWinListGetCount(List) - ElementCountToDisplay;
         } else {
             List->FirstDisplayedOption = 0;
         }
     } else {
 
-        if (ScrollValue < List->ItemArray.Count) {
+        if (ScrollValue < YoriWinListGetCount(List)) {
             List->FirstDisplayedOption = (YORI_ALLOC_SIZE_T)ScrollValue;
         }
     }
@@ -496,9 +617,9 @@ YoriWinListNotifyMouseWheel(
             List->FirstDisplayedOption = List->FirstDisplayedOption - LinesToMove;
         }
     } else {
-        if (List->FirstDisplayedOption + LinesToMove + ElementCountToDisplay > List->ItemArray.Count) {
-            if (List->ItemArray.Count >= ElementCountToDisplay) {
-                List->FirstDisplayedOption = List->ItemArray.Count - ElementCountToDisplay;
+        if (List->FirstDisplayedOption + LinesToMove + ElementCountToDisplay > YoriWinListGetCount(List)) {
+            if (YoriWinListGetCount(List) >= ElementCountToDisplay) {
+                List->FirstDisplayedOption = YoriWinListGetCount(List) - ElementCountToDisplay;
             } else {
                 List->FirstDisplayedOption = 0;
             }
@@ -541,7 +662,7 @@ YoriWinListGetItemSelectedByMouseLocation(
         ItemRelativeToFirstDisplayed = MousePos.Y;
     }
 
-    if (ItemRelativeToFirstDisplayed + List->FirstDisplayedOption < List->ItemArray.Count) {
+    if (ItemRelativeToFirstDisplayed + List->FirstDisplayedOption < YoriWinListGetCount(List)) {
         *SelectedItem = ItemRelativeToFirstDisplayed + List->FirstDisplayedOption;
         return TRUE;
     }
@@ -549,9 +670,104 @@ YoriWinListGetItemSelectedByMouseLocation(
     return FALSE;
 }
 
+/**
+ Determine whether an item in the list begins with a specified prefix,
+ compared case insensitively.
+
+ @param List Pointer to the list control.
+
+ @param Index Specifies the item to check.
+
+ @param Prefix Pointer to the prefix to check for.
+
+ @return TRUE to indicate the item begins with the prefix, FALSE if it does
+         not.
+ */
+BOOLEAN
+YoriWinListItemMatchesPrefix(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in YORI_ALLOC_SIZE_T Index,
+    __in PYORI_STRING Prefix
+    )
+{
+    YORI_STRING ItemText;
+    BOOLEAN Match;
+
+    if (!YoriWinListGetItemString(List, Index, &ItemText)) {
+        return FALSE;
+    }
+
+    Match = FALSE;
+    if (ItemText.LengthInChars >= Prefix->LengthInChars &&
+        YoriLibCompareStringInsensitiveCount(&ItemText, Prefix, Prefix->LengthInChars) == 0) {
+
+        Match = TRUE;
+    }
+
+    YoriLibFreeStringContents(&ItemText);
+    return Match;
+}
+
+/**
+ Locate the first item in a sorted virtual list that begins with a specified
+ prefix by binary search, so that only a small number of items need to be
+ requested from the item source.
+
+ @param List Pointer to the list control.
+
+ @param Prefix Pointer to the prefix to search for.
+
+ @param FoundIndex On successful completion, populated with the index of the
+        first item that begins with the prefix.
+
+ @return TRUE to indicate a matching item was found, FALSE if it was not.
+ */
+__success(return)
+BOOLEAN
+YoriWinListFindSortedItemByPrefix(
+    __in PYORI_WIN_CTRL_LIST List,
+    __in PYORI_STRING Prefix,
+    __out PYORI_ALLOC_SIZE_T FoundIndex
+    )
+{
+    YORI_ALLOC_SIZE_T Low;
+    YORI_ALLOC_SIZE_T High;
+    YORI_ALLOC_SIZE_T Mid;
+    YORI_STRING ItemText;
+    int CompareResult;
+
+    Low = 0;
+    High = YoriWinListGetCount(List);
+
+    while (Low < High) {
+        Mid = Low + (High - Low) / 2;
+        if (!YoriWinListGetItemString(List, Mid, &ItemText)) {
+            return FALSE;
+        }
+        CompareResult = YoriLibCompareStringInsensitiveCount(&ItemText, Prefix, Prefix->LengthInChars);
+        YoriLibFreeStringContents(&ItemText);
+
+        if (CompareResult < 0) {
+            Low = Mid + 1;
+        } else {
+            High = Mid;
+        }
+    }
+
+    if (YoriWinListItemMatchesPrefix(List, Low, Prefix)) {
+        *FoundIndex = Low;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 /**
  Given a user pressed character, look for an item in the list that starts with
- the character.  This might get smarter for consecutive characters someday.
+ the characters typed.  Characters typed in quick succession are combined, so
+ typing a word locates the first item beginning with that word.  Typing a
+ single character repeatedly moves between items starting with that
+ character.
 
  @param List Pointer to the list control.
 
@@ -567,50 +783,89 @@ YoriWinListFindItemByChar(
     )
 {
     YORI_ALLOC_SIZE_T Index;
-    PYORI_WIN_ITEM_ENTRY Element;
-    TCHAR UpcaseChar;
+    YORI_ALLOC_SIZE_T Offset;
+    YORI_ALLOC_SIZE_T StartIndex;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_STRING Prefix;
+    DWORD CurrentTick;
 
-    UpcaseChar = YoriLibUpcaseChar(Char);
+    //
+    //  If the previous character was typed recently, add this one to the
+    //  search.  Otherwise, start a new search.
+    //
+
+    CurrentTick = GetTickCount();
+    if (List->TypeAheadLength > 0 &&
+        List->TypeAheadLength < YORI_WIN_LIST_TYPE_AHEAD_MAX &&
+        CurrentTick - List->LastTypeAheadTick < YORI_WIN_LIST_TYPE_AHEAD_TIMEOUT) {
+
+        List->TypeAheadBuffer[List->TypeAheadLength] = Char;
+        List->TypeAheadLength++;
+    } else {
+        List->TypeAheadBuffer[0] = Char;
+        List->TypeAheadLength = 1;
+    }
+    List->LastTypeAheadTick = CurrentTick;
+
+    YoriLibInitEmptyString(&Prefix);
+    Prefix.StartOfString = List->TypeAheadBuffer;
+    Prefix.LengthInChars = List->TypeAheadLength;
+
+    Count = YoriWinListGetCount(List);
+    if (Count == 0) {
+        return FALSE;
+    }
 
     //
     //  If nothing is selected, search from the top.  If something is
-    //  selected, start from one after that, and wrap from the top if
-    //  nothing is found.
+    //  selected and this is a new search, start from one after that so
+    //  repeated presses move through matching items.  If this is
+    //  continuing a search, the current item may still match.  Wrap from
+    //  the top if nothing is found.
     //
 
     if (!List->ItemActive) {
+        StartIndex = 0;
+    } else if (List->TypeAheadLength == 1) {
+        StartIndex = List->ActiveOption + 1;
+    } else {
+        StartIndex = List->ActiveOption;
+    }
 
-        for (Index = 0; Index < List->ItemArray.Count; Index++) {
-            Element = &List->ItemArray.Items[Index];
-            if (Element->String.LengthInChars > 0 &&
-                UpcaseChar == YoriLibUpcaseChar(Element->String.StartOfString[0])) {
-
-                List->ItemActive = TRUE;
-                List->ActiveOption = Index;
-                return TRUE;
-            }
-        }
+    if (StartIndex >= Count) {
+        StartIndex = 0;
+    }
 
-    } else {
+    if (YoriWinListItemMatchesPrefix(List, StartIndex, &Prefix)) {
+        List->ItemActive = TRUE;
+        List->ActiveOption = StartIndex;
+        return TRUE;
+    }
 
-        for (Index = List->ActiveOption + 1; Index < List->ItemArray.Count; Index++) {
-            Element = &List->ItemArray.Items[Index];
-            if (Element->String.LengthInChars > 0 &&
-                UpcaseChar == YoriLibUpcaseChar(Element->String.StartOfString[0])) {
+    //
+    //  If the items are known to be sorted, the first match can be found
+    //  without examining every item.
+    //
 
-                List->ActiveOption = Index;
-                return TRUE;
-            }
+    if (List->GetVirtualItemText != NULL && List->VirtualItemsSorted) {
+        if (YoriWinListFindSortedItemByPrefix(List, &Prefix, &Index)) {
+            List->ItemActive = TRUE;
+            List->ActiveOption = Index;
+            return TRUE;
         }
+        return FALSE;
+    }
 
-        for (Index = 0; Index <= List->ActiveOption; Index++) {
-            Element = &List->ItemArray.Items[Index];
-            if (Element->String.LengthInChars > 0 &&
-                UpcaseChar == YoriLibUpcaseChar(Element->String.StartOfString[0])) {
+    for (Offset = 1; Offset < Count; Offset++) {
+        Index = StartIndex + Offset;
+        if (Index >= Count) {
+            Index = Index - Count;
+        }
 
-                List->ActiveOption = Index;
-                return TRUE;
-            }
+        if (YoriWinListItemMatchesPrefix(List, Index, &Prefix)) {
+            List->ItemActive = TRUE;
+            List->ActiveOption = Index;
+            return TRUE;
         }
     }
 
@@ -656,7 +911,7 @@ YoriWinListEventHandler(
                             }
                             YoriWinListPaint(List);
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                         YoriWinListEnsureActiveItemVisible(List);
@@ -668,7 +923,7 @@ YoriWinListEventHandler(
                 } else if (Event->KeyDown.VirtualKeyCode == VK_DOWN ||
                     (List->HorizontalDisplay && Event->KeyDown.VirtualKeyCode == VK_RIGHT)) {
                     if (List->ItemActive) {
-                        if (List->ActiveOption + 1 < List->ItemArray.Count) {
+                        if (List->ActiveOption + 1 < YoriWinListGetCount(List)) {
                             List->ActiveOption++;
                             YoriWinListEnsureActiveItemVisible(List);
                             if (List->SelectionChangeCallback) {
@@ -676,7 +931,7 @@ YoriWinListEventHandler(
                             }
                             YoriWinListPaint(List);
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                         YoriWinListEnsureActiveItemVisible(List);
@@ -698,7 +953,7 @@ YoriWinListEventHandler(
                         } else {
                             List->ActiveOption = 0;
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                     }
@@ -714,14 +969,14 @@ YoriWinListEventHandler(
                         YoriWinGetControlClientSize(&List->Ctrl, &ClientSize);
                         ElementCountToDisplay = ClientSize.Y;
                         if (List->ActiveOption < List->FirstDisplayedOption + ElementCountToDisplay - 1 &&
-                            List->FirstDisplayedOption + ElementCountToDisplay - 1 < List->ItemArray.Count) {
+                            List->FirstDisplayedOption + ElementCountToDisplay - 1 < YoriWinListGetCount(List)) {
                             List->ActiveOption = List->FirstDisplayedOption + ElementCountToDisplay - 1;
-                        } else if (List->ActiveOption + ElementCountToDisplay < List->ItemArray.Count) {
+                        } else if (List->ActiveOption + ElementCountToDisplay < YoriWinListGetCount(List)) {
                             List->ActiveOption = List->ActiveOption + ElementCountToDisplay;
                         } else {
-                            List->ActiveOption = List->ItemArray.Count - 1;
+                            List->ActiveOption = YoriWinListGetCount(List) - 1;
                         }
-                    } else if (List->ItemArray.Count > 0) {
+                    } else if (YoriWinListGetCount(List) > 0) {
                         List->ItemActive = TRUE;
                         List->ActiveOption = 0;
                     }
@@ -747,7 +1002,7 @@ YoriWinListEventHandler(
                            List->MultiSelect) {
                     PYORI_WIN_ITEM_ENTRY Element;
 
-                    ASSERT(List->ActiveOption < List->ItemArray.Count);
+                    ASSERT(List->ActiveOption < YoriWinListGetCount(List));
                     Element = &List->ItemArray.Items[List->ActiveOption];
                     Element->Flags = Element->Flags ^ YORI_WIN_ITEM_SELECTED;
                     if (List->SelectionChangeCallback) {
@@ -875,7 +1130,7 @@ YoriWinListGetItemCount(
     PYORI_WIN_CTRL_LIST List;
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
-    return List->ItemArray.Count;
+    return YoriWinListGetCount(List);
 }
 
 /**
@@ -927,7 +1182,7 @@ YoriWinListSetActiveOption(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (ActiveOption < List->ItemArray.Count) {
+    if (ActiveOption < YoriWinListGetCount(List)) {
         List->ItemActive = TRUE;
         List->ActiveOption = ActiveOption;
         YoriWinListEnsureActiveItemVisible(List);
@@ -963,7 +1218,7 @@ YoriWinListIsOptionSelected(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (Index < List->ItemArray.Count) {
+    if (Index < YoriWinListGetCount(List)) {
         if (List->MultiSelect) {
             if (List->ItemArray.Items[Index].Flags & YORI_WIN_ITEM_SELECTED) {
                 return TRUE;
@@ -1004,6 +1259,10 @@ YoriWinListAddItems(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
+    if (List->GetVirtualItemText != NULL) {
+        return FALSE;
+    }
+
     if (!YoriWinItemArrayAddItems(&List->ItemArray, ListOptions, NumberOptions)) {
         return FALSE;
     }
@@ -1035,6 +1294,10 @@ YoriWinListAddItemArray(
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
+    if (List->GetVirtualItemText != NULL) {
+        return FALSE;
+    }
+
     if (!YoriWinItemArrayAddItemArray(&List->ItemArray, NewItems)) {
         return FALSE;
     }
@@ -1066,20 +1329,19 @@ YoriWinListGetItemText(
 {
     PYORI_WIN_CTRL Ctrl;
     PYORI_WIN_CTRL_LIST List;
-    PYORI_STRING Source;
+    YORI_STRING Source;
 
     Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
     List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
 
-    if (Index >= List->ItemArray.Count) {
+    if (!YoriWinListGetItemString(List, Index, &Source)) {
         return FALSE;
     }
 
-    Source = &List->ItemArray.Items[Index].String;
-
-    if (Text->LengthAllocated < Source->LengthInChars + 1) {
+    if (Text->LengthAllocated < Source.LengthInChars + 1) {
         YORI_STRING NewString;
-        if (!YoriLibAllocateString(&NewString, Source->LengthInChars + 1)) {
+        if (!YoriLibAllocateString(&NewString, Source.LengthInChars + 1)) {
+            YoriLibFreeStringContents(&Source);
             return FALSE;
         }
 
@@ -1087,9 +1349,116 @@ YoriWinListGetItemText(
         memcpy(Text, &NewString, sizeof(YORI_STRING));
     }
 
-    memcpy(Text->StartOfString, Source->StartOfString, Source->LengthInChars * sizeof(TCHAR));
-    Text->LengthInChars = Source->LengthInChars;
-    Text->StartOfString[Source->LengthInChars] = '\0';
+    memcpy(Text->StartOfString, Source.StartOfString, Source.LengthInChars * sizeof(TCHAR));
+    Text->LengthInChars = Source.LengthInChars;
+    Text->StartOfString[Source.LengthInChars] = '\0';
+    YoriLibFreeStringContents(&Source);
+    return TRUE;
+}
+
+/**
+ Configure a list control to obtain items from a caller supplied function
+ rather than storing them in the control.  The function is invoked only for
+ items being displayed or searched, so lists with very large numbers of items
+ can be populated without allocating or copying each item.  Any items
+ previously added to the control are removed.  Virtual lists do not support
+ multiple selection.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param GetItemText Pointer to a function to invoke to obtain the text of an
+        item.  If NULL, the list reverts to storing items in the control.
+
+ @param ItemCount Specifies the number of items in the list.
+
+ @param ItemsSorted If TRUE, the items are sorted case insensitively,
+        allowing items to be located by binary search.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListSetVirtualItemSource(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in_opt PYORI_WIN_LIST_GET_ITEM_TEXT GetItemText,
+    __in YORI_ALLOC_SIZE_T ItemCount,
+    __in BOOLEAN ItemsSorted
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_LIST List;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
+
+    if (GetItemText != NULL && List->MultiSelect) {
+        return FALSE;
+    }
+
+    YoriWinItemArrayCleanup(&List->ItemArray);
+    List->GetVirtualItemText = GetItemText;
+    List->VirtualItemsSorted = ItemsSorted;
+    if (GetItemText != NULL) {
+        List->VirtualItemCount = ItemCount;
+    } else {
+        List->VirtualItemCount = 0;
+    }
+    List->TypeAheadLength = 0;
+    List->FirstDisplayedOption = 0;
+    List->ActiveOption = 0;
+    if (List->ItemActive) {
+        List->ItemActive = FALSE;
+        if (List->SelectionChangeCallback) {
+            List->SelectionChangeCallback(&List->Ctrl);
+        }
+    }
+    YoriWinListPaint(List);
+    return TRUE;
+}
+
+/**
+ Update the number of items in a virtual list control, typically because the
+ caller has obtained more items.  The control redisplays the items that are
+ visible.
+
+ @param CtrlHandle Pointer to the list control.
+
+ @param ItemCount Specifies the new number of items in the list.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinListSetVirtualItemCount(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in YORI_ALLOC_SIZE_T ItemCount
+    )
+{
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_WIN_CTRL_LIST List;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    List = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_LIST, Ctrl);
+
+    if (List->GetVirtualItemText == NULL) {
+        return FALSE;
+    }
+
+    List->VirtualItemCount = ItemCount;
+    if (List->FirstDisplayedOption >= ItemCount) {
+        List->FirstDisplayedOption = 0;
+    }
+
+    if (List->ItemActive && List->ActiveOption >= ItemCount) {
+        List->ActiveOption = 0;
+        List->ItemActive = FALSE;
+        if (List->SelectionChangeCallback) {
+            List->SelectionChangeCallback(&List->Ctrl);
+        }
+    }
+
+    YoriWinListEnsureActiveItemVisible(List);
+    YoriWinListPaint(List);
     return TRUE;
 }
 
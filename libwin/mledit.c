@@ -261,7 +261,9 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
     YORI_STRING Caption;
 
     /**
-     An array of lines corresponding to lines within a file.
+     An array of lines corresponding to lines within a file.  The array
+     contains a gap of unused entries, so a line index must be translated
+     with YoriWinMultilineEditGetLine before accessing it.
      */
     PYORI_STRING LineArray;
 
@@ -270,6 +272,20 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
      */
     YORI_ALLOC_SIZE_T LinesAllocated;
 
+    /**
+     The index within LineArray of the first unused entry.  Lines are
+     inserted and deleted by moving the gap to the point of the change, so
+     repeated edits in one region only move the lines between the previous
+     and current edit rather than every line to the end of the file.
+     */
+    YORI_ALLOC_SIZE_T GapStart;
+
+    /**
+     The number of unused entries in LineArray starting at GapStart.  This
+     is always LinesAllocated - LinesPopulated.
+     */
+    YORI_ALLOC_SIZE_T GapLength;
+
     /**
      The number of lines populated with text within LineArray.
      */
@@ -285,6 +301,13 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
      */
     YORI_LIST_ENTRY Redo;
 
+    /**
+     While a set of changes is being combined into a single undo operation,
+     points to the undo entry that was most recent when the group started, or
+     to the Undo list head if there was none.  NULL if no group is active.
+     */
+    PYORI_LIST_ENTRY UndoGroupBoundary;
+
     /**
      The index within LineArray that is displayed at the top of the control.
      */
@@ -488,6 +511,65 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
 
 } YORI_WIN_CTRL_MULTILINE_EDIT, *PYORI_WIN_CTRL_MULTILINE_EDIT;
 
+//
+//  =========================================
+//  LINE ARRAY FUNCTIONS
+//  =========================================
+//
+
+/**
+ Return a pointer to a line within the line array, skipping over the gap.
+
+ @param MultilineEdit Pointer to the multiline edit control.
+
+ @param LineIndex The index of the line to return.
+
+ @return Pointer to the line.
+ */
+PYORI_STRING
+YoriWinMultilineEditGetLine(
+    __in PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit,
+    __in YORI_ALLOC_SIZE_T LineIndex
+    )
+{
+    if (LineIndex >= MultilineEdit->GapStart) {
+        LineIndex = LineIndex + MultilineEdit->GapLength;
+    }
+    return &MultilineEdit->LineArray[LineIndex];
+}
+
+/**
+ Move the gap within the line array so that it begins at the specified line
+ index.  Only the lines between the current and new gap locations are moved.
+
+ @param MultilineEdit Pointer to the multiline edit control.
+
+ @param NewGapStart The line index that the gap should start at.  This can
+        be equal to LinesPopulated to move the gap to the end.
+ */
+VOID
+YoriWinMultilineEditMoveGap(
+    __in PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit,
+    __in YORI_ALLOC_SIZE_T NewGapStart
+    )
+{
+    ASSERT(NewGapStart <= MultilineEdit->LinesPopulated);
+
+    if (MultilineEdit->GapLength > 0) {
+        if (NewGapStart < MultilineEdit->GapStart) {
+            memmove(&MultilineEdit->LineArray[NewGapStart + MultilineEdit->GapLength],
+                    &MultilineEdit->LineArray[NewGapStart],
+                    (MultilineEdit->GapStart - NewGapStart) * sizeof(YORI_STRING));
+        } else if (NewGapStart > MultilineEdit->GapStart) {
+            memmove(&MultilineEdit->LineArray[MultilineEdit->GapStart],
+                    &MultilineEdit->LineArray[MultilineEdit->GapStart + MultilineEdit->GapLength],
+                    (NewGapStart - MultilineEdit->GapStart) * sizeof(YORI_STRING));
+        }
+    }
+
+    MultilineEdit->GapStart = NewGapStart;
+}
+
 //
 //  =========================================
 //  DISPLAY FUNCTIONS
@@ -564,7 +646,7 @@ YoriWinMultilineEditFindCursorCharFromDisplayChar(
 
     DoubleWideCharSupported = YoriWinMultilineEditIsDoubleWideCharSupported(MultilineEdit);
 
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     CurrentDisplayIndex = 0;
     for (CharIndex = 0; CharIndex < Line->LengthInChars; CharIndex++) {
@@ -640,7 +722,7 @@ YoriWinMultilineEditFindDisplayCharFromCursorChar(
 
     DoubleWideCharSupported = YoriWinMultilineEditIsDoubleWideCharSupported(MultilineEdit);
 
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     CurrentDisplayIndex = 0;
     for (CharIndex = 0; CharIndex < Line->LengthInChars; CharIndex++) {
@@ -909,7 +991,7 @@ YoriWinMultilineEditGenerateDisplayLine(
 
     ASSERT(LineIndex < MultilineEdit->LinesPopulated);
 
-    SourceLine = &MultilineEdit->LineArray[LineIndex];
+    SourceLine = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     //
     //  MSFIX This needs to return a "remainder" to say the number of
@@ -1490,6 +1572,10 @@ YoriWinMultilineEditClearUndo(
             ListHead = NULL;
         }
     }
+
+    if (MultilineEdit->UndoGroupBoundary != NULL) {
+        MultilineEdit->UndoGroupBoundary = &MultilineEdit->Undo;
+    }
 }
 
 /**
@@ -1649,8 +1735,13 @@ YoriWinMultilineEditGetUndoRecordForOperation(
 
     *NewRangeBeforeExistingRange = FALSE;
 
+    //
+    //  If a group of changes has just started, the most recent record
+    //  belongs to an earlier operation and must not be extended.
+    //
+
     ListEntry = YoriLibGetNextListEntry(&MultilineEdit->Undo, NULL);
-    if (ListEntry != NULL) {
+    if (ListEntry != NULL && ListEntry != MultilineEdit->UndoGroupBoundary) {
         Undo = CONTAINING_RECORD(ListEntry, YORI_WIN_CTRL_MULTILINE_EDIT_UNDO, ListEntry);
         if (Undo->Op != Op) {
             Undo = NULL;
@@ -2286,26 +2377,26 @@ YoriWinMultilineEditGetTextRangeLength(
     if (FirstLine == LastLine) {
         ASSERT(LastCharOffset >= FirstCharOffset);
         CharsInRange = 0;
-        if (FirstCharOffset >= MultilineEdit->LineArray[FirstLine].LengthInChars) {
+        if (FirstCharOffset >= YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars) {
             CharsInRange = 0;
-        } else if (LastCharOffset >= MultilineEdit->LineArray[FirstLine].LengthInChars) {
-            CharsInRange = MultilineEdit->LineArray[FirstLine].LengthInChars - FirstCharOffset;
+        } else if (LastCharOffset >= YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars) {
+            CharsInRange = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars - FirstCharOffset;
         } else {
             CharsInRange = LastCharOffset - FirstCharOffset;
         }
     } else {
         LinesInRange = LastLine - FirstLine;
         CharsInRange = 0;
-        if (FirstCharOffset < MultilineEdit->LineArray[FirstLine].LengthInChars) {
-            CharsInRange += MultilineEdit->LineArray[FirstLine].LengthInChars - FirstCharOffset;
+        if (FirstCharOffset < YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars) {
+            CharsInRange += YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars - FirstCharOffset;
         }
         for (LineIndex = FirstLine + 1; LineIndex < LastLine; LineIndex++) {
-            CharsInRange += MultilineEdit->LineArray[LineIndex].LengthInChars;
+            CharsInRange += YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars;
         }
-        if (LastCharOffset < MultilineEdit->LineArray[LineIndex].LengthInChars) {
+        if (LastCharOffset < YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars) {
             CharsInRange += LastCharOffset;
         } else {
-            CharsInRange += MultilineEdit->LineArray[LineIndex].LengthInChars;
+            CharsInRange += YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars;
         }
         CharsInRange += LinesInRange * NewlineLength;
     }
@@ -2337,7 +2428,7 @@ YoriWinMultilineEditGetIndentationOnLine(
     YORI_ALLOC_SIZE_T Index;
 
     YoriLibInitEmptyString(Indent);
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
     for (Index = 0; Index < Line->LengthInChars; Index++) {
         if (Line->StartOfString[Index] != ' ' &&
             Line->StartOfString[Index] != '\t') {
@@ -2447,7 +2538,7 @@ YoriWinMultilineEditPopulateTextRange(
     PYORI_STRING Line;
     LPTSTR Ptr;
 
-    Line = &MultilineEdit->LineArray[FirstLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
 
     if (FirstLine == LastLine) {
         if (FirstCharOffset > Line->LengthInChars) {
@@ -2472,18 +2563,18 @@ YoriWinMultilineEditPopulateTextRange(
             memcpy(Ptr, NewlineString->StartOfString, NewlineString->LengthInChars * sizeof(TCHAR));
             Ptr += NewlineString->LengthInChars;
             memcpy(Ptr,
-                   MultilineEdit->LineArray[LineIndex].StartOfString,
-                   MultilineEdit->LineArray[LineIndex].LengthInChars * sizeof(TCHAR));
-            Ptr += MultilineEdit->LineArray[LineIndex].LengthInChars;
+                   YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->StartOfString,
+                   YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars * sizeof(TCHAR));
+            Ptr += YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars;
         }
         memcpy(Ptr, NewlineString->StartOfString, NewlineString->LengthInChars * sizeof(TCHAR));
         Ptr += NewlineString->LengthInChars;
-        if (LastCharOffset < MultilineEdit->LineArray[LastLine].LengthInChars) {
+        if (LastCharOffset < YoriWinMultilineEditGetLine(MultilineEdit, LastLine)->LengthInChars) {
             CharsInRange = LastCharOffset;
         } else {
-            CharsInRange = MultilineEdit->LineArray[LastLine].LengthInChars;
+            CharsInRange = YoriWinMultilineEditGetLine(MultilineEdit, LastLine)->LengthInChars;
         }
-        memcpy(Ptr, MultilineEdit->LineArray[LastLine].StartOfString, CharsInRange * sizeof(TCHAR));
+        memcpy(Ptr, YoriWinMultilineEditGetLine(MultilineEdit, LastLine)->StartOfString, CharsInRange * sizeof(TCHAR));
         Ptr += LastCharOffset;
 
         SelectedText->LengthInChars = (YORI_ALLOC_SIZE_T)(Ptr - SelectedText->StartOfString);
@@ -2616,7 +2707,6 @@ YoriWinMultilineEditDeleteTextRange(
     YORI_ALLOC_SIZE_T CharsToCopy;
     YORI_ALLOC_SIZE_T CharsToDelete;
     YORI_ALLOC_SIZE_T LinesToDelete;
-    YORI_ALLOC_SIZE_T LinesToCopy;
     YORI_ALLOC_SIZE_T FirstLineIndexToKeep;
     YORI_ALLOC_SIZE_T LineIndexToDelete;
     PYORI_STRING Line;
@@ -2691,7 +2781,7 @@ YoriWinMultilineEditDeleteTextRange(
         }
     }
 
-    Line = &MultilineEdit->LineArray[FirstLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
 
     //
     //  If the selection is one line, this is a simple case, because no
@@ -2728,7 +2818,7 @@ YoriWinMultilineEditDeleteTextRange(
     ASSERT(LastLine < MultilineEdit->LinesPopulated ||
            (LastLine == MultilineEdit->LinesPopulated && LastCharOffset == 0));
     if (LastLine < MultilineEdit->LinesPopulated) {
-        FinalLine = &MultilineEdit->LineArray[LastLine];
+        FinalLine = YoriWinMultilineEditGetLine(MultilineEdit, LastLine);
     } else {
         FinalLine = NULL;
     }
@@ -2797,20 +2887,19 @@ YoriWinMultilineEditDeleteTextRange(
     }
 
     for (LineIndexToDelete = 0; LineIndexToDelete < LinesToDelete; LineIndexToDelete++) {
-        YoriLibFreeStringContents(&MultilineEdit->LineArray[FirstLine + 1 + LineIndexToDelete]);
+        YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, FirstLine + 1 + LineIndexToDelete));
     }
 
-    FirstLineIndexToKeep = FirstLine + 1 + LinesToDelete;
-    if (FirstLineIndexToKeep < MultilineEdit->LinesPopulated) {
-        LinesToCopy = MultilineEdit->LinesPopulated - FirstLineIndexToKeep;
-    } else {
-        LinesToCopy = 0;
-    }
+    //
+    //  Move the gap to the first line being kept, and extend it backwards
+    //  to include the deleted lines.
+    //
 
-    if (LinesToCopy > 0) {
-        memmove(&MultilineEdit->LineArray[FirstLine + 1],
-                &MultilineEdit->LineArray[FirstLine + 1 + LinesToDelete],
-                LinesToCopy * sizeof(YORI_STRING));
+    FirstLineIndexToKeep = FirstLine + 1 + LinesToDelete;
+    if (LinesToDelete > 0) {
+        YoriWinMultilineEditMoveGap(MultilineEdit, FirstLineIndexToKeep);
+        MultilineEdit->GapStart = MultilineEdit->GapStart - LinesToDelete;
+        MultilineEdit->GapLength = MultilineEdit->GapLength + LinesToDelete;
     }
 
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, FirstLine, MultilineEdit->LinesPopulated);
@@ -2924,13 +3013,27 @@ YoriWinMultilineEditReallocateLineArray(
         return FALSE;
     }
 
+    //
+    //  Copy the lines before the gap to the start of the new array and the
+    //  lines after the gap to the end, so all new entries extend the gap.
+    //
+
     if (MultilineEdit->LinesPopulated > 0) {
-        memcpy(NewLineArray, MultilineEdit->LineArray, MultilineEdit->LinesPopulated * sizeof(YORI_STRING));
+        memcpy(NewLineArray, MultilineEdit->LineArray, MultilineEdit->GapStart * sizeof(YORI_STRING));
+        memcpy(&NewLineArray[NewLineCount - (MultilineEdit->LinesPopulated - MultilineEdit->GapStart)],
+               &MultilineEdit->LineArray[MultilineEdit->GapStart + MultilineEdit->GapLength],
+               (MultilineEdit->LinesPopulated - MultilineEdit->GapStart) * sizeof(YORI_STRING));
+    } else {
+        MultilineEdit->GapStart = 0;
+    }
+
+    if (MultilineEdit->LineArray != NULL) {
         YoriLibDereference(MultilineEdit->LineArray);
     }
 
     MultilineEdit->LineArray = NewLineArray;
     MultilineEdit->LinesAllocated = NewLineCount;
+    MultilineEdit->GapLength = NewLineCount - MultilineEdit->LinesPopulated;
     return TRUE;
 }
 
@@ -2970,7 +3073,7 @@ YoriWinMultilineEditTrimAutoIndent(
         return FALSE;
     }
 
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     ASSERT(Line->LengthInChars == MultilineEdit->AutoIndentSourceLength);
     ASSERT(Line->LengthInChars != 0);
@@ -3062,18 +3165,21 @@ YoriWinMultilineEditInsertLines(
         SourceLine = FirstLine;
         TargetLine = SourceLine + LineCount + 1;
     }
-    if (SourceLine < MultilineEdit->LinesPopulated) {
-        DWORD LinesToMove;
-        LinesToMove = MultilineEdit->LinesPopulated - SourceLine;
-        memmove(&MultilineEdit->LineArray[TargetLine],
-                &MultilineEdit->LineArray[SourceLine],
-                LinesToMove * sizeof(YORI_STRING));
-    }
+    //
+    //  Move the gap to the insertion point and take the new lines from the
+    //  front of it.
+    //
+
+    YoriWinMultilineEditMoveGap(MultilineEdit, SourceLine);
+    ASSERT(MultilineEdit->GapLength >= TargetLine - SourceLine);
 
     for (Index = SourceLine; Index < TargetLine; Index++) {
         YoriLibInitEmptyString(&MultilineEdit->LineArray[Index]);
     }
 
+    MultilineEdit->GapStart = TargetLine;
+    MultilineEdit->GapLength = MultilineEdit->GapLength - (TargetLine - SourceLine);
+
     MultilineEdit->LinesPopulated = (YORI_ALLOC_SIZE_T)LinesRequired;
     return TRUE;
 }
@@ -3176,7 +3282,7 @@ YoriWinMultilineEditInsertTextRange(
 
         if (AutoIndentLeadingString.LengthInChars > 0 && Text->LengthInChars > 0) {
             TCHAR FirstChar;
-            Line = &MultilineEdit->LineArray[FirstLine];
+            Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
             FirstChar = Text->StartOfString[0];
             if (AutoIndentLeadingString.LengthInChars == Line->LengthInChars &&
                 (FirstChar == '\n' || FirstChar == '\r')) {
@@ -3209,7 +3315,7 @@ YoriWinMultilineEditInsertTextRange(
 
     YoriLibInitEmptyString(&TrailingPortionOfFirstLine);
     if (FirstLine < MultilineEdit->LinesPopulated) {
-        Line = &MultilineEdit->LineArray[FirstLine];
+        Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
         if (FirstCharOffset < Line->LengthInChars) {
             ASSERT(Line->MemoryToFree != NULL);
             YoriLibReference(Line->MemoryToFree);
@@ -3261,7 +3367,7 @@ YoriWinMultilineEditInsertTextRange(
                     CharsLastLine = CharsThisLine;
                 }
             } else {
-                Line = &MultilineEdit->LineArray[FirstLine + LineIndex];
+                Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine + LineIndex);
                 ASSERT(Line->LengthInChars == 0);
                 CharsNeeded = CharsThisLine;
                 if (LineIndex == LineCount) {
@@ -3370,7 +3476,7 @@ YoriWinMultilineEditInsertTextRange(
         ASSERT(AutoIndentLeadingString.StartOfString == NULL);
     }
 
-    Line = &MultilineEdit->LineArray[FirstLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
     if (FirstCharOffset + CharsFirstLine + TrailingPortionOfFirstLine.LengthInChars > Line->LengthAllocated) {
         if (!YoriLibReallocateString(Line, FirstCharOffset + CharsFirstLine + TrailingPortionOfFirstLine.LengthInChars + YORI_WIN_MULTILINE_EDIT_LINE_PADDING)) {
             YoriLibFreeStringContents(&TrailingPortionOfFirstLine);
@@ -3424,7 +3530,7 @@ YoriWinMultilineEditInsertTextRange(
         //
 
         if (TruncateFirstLine) {
-            Line = &MultilineEdit->LineArray[FirstLine];
+            Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
             YoriWinMultilineEditDeleteTextRange(MultilineEdit,
                                                 TRUE,
                                                 FALSE,
@@ -3530,7 +3636,7 @@ YoriWinMultilineEditOverwriteTextRange(
             //
 
             if (Undo->u.OverwriteText.Text.StartOfString == NULL) {
-                Line = &MultilineEdit->LineArray[FirstLine];
+                Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine);
                 if (!YoriLibCopyString(&Undo->u.OverwriteText.Text, Line)) {
                     return FALSE;
                 }
@@ -3608,7 +3714,7 @@ YoriWinMultilineEditOverwriteTextRange(
                 StartOffsetThisLine = FirstCharOffset;
             }
 
-            Line = &MultilineEdit->LineArray[FirstLine + LineIndex];
+            Line = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine + LineIndex);
             CharsNeeded = StartOffsetThisLine + CharsThisLine;
             if (Line->LengthAllocated < CharsNeeded) {
                 YoriLibFreeStringContents(Line);
@@ -3636,7 +3742,7 @@ YoriWinMultilineEditOverwriteTextRange(
                 Line->LengthInChars = StartOffsetThisLine + CharsThisLine;
             } else if (MoveTrailingTextToNextLine && Line->LengthInChars > StartOffsetThisLine + CharsThisLine) {
                 PYORI_STRING NextLine;
-                NextLine = &MultilineEdit->LineArray[FirstLine + LineIndex + 1];
+                NextLine = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine + LineIndex + 1);
                 ASSERT(NextLine->LengthInChars == 0);
                 CharsNeeded = Line->LengthInChars - (StartOffsetThisLine + CharsThisLine);
                 if (NextLine->LengthAllocated < CharsNeeded) {
@@ -3768,7 +3874,10 @@ YoriWinMultilineEditAppendLinesNoDataCopy(
         }
     }
 
+    YoriWinMultilineEditMoveGap(MultilineEdit, MultilineEdit->LinesPopulated);
     memcpy(&MultilineEdit->LineArray[MultilineEdit->LinesPopulated], NewLines, NewLineCount * sizeof(YORI_STRING));
+    MultilineEdit->GapStart = MultilineEdit->GapStart + NewLineCount;
+    MultilineEdit->GapLength = MultilineEdit->GapLength - NewLineCount;
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, MultilineEdit->LinesPopulated, MultilineEdit->LinesPopulated + NewLineCount);
     MultilineEdit->LinesPopulated = MultilineEdit->LinesPopulated + NewLineCount;
 
@@ -3776,6 +3885,153 @@ YoriWinMultilineEditAppendLinesNoDataCopy(
     return TRUE;
 }
 
+/**
+ Indicate that the following changes to a multiline edit control should be
+ undone as a single operation.  Groups cannot be nested.  The caller is
+ expected to call @ref YoriWinMultilineEditEndUndoGroup once the changes are
+ complete.
+
+ @param CtrlHandle Pointer to the multiline edit control.
+ */
+VOID
+YoriWinMultilineEditBeginUndoGroup(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle
+    )
+{
+    PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit;
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_LIST_ENTRY ListEntry;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    MultilineEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_MULTILINE_EDIT, Ctrl);
+
+    ASSERT(MultilineEdit->UndoGroupBoundary == NULL);
+
+    ListEntry = YoriLibGetNextListEntry(&MultilineEdit->Undo, NULL);
+    if (ListEntry == NULL) {
+        ListEntry = &MultilineEdit->Undo;
+    }
+    MultilineEdit->UndoGroupBoundary = ListEntry;
+}
+
+/**
+ Complete a group of changes started with
+ @ref YoriWinMultilineEditBeginUndoGroup .  Each undo record created since the
+ group started is chained to the one before it, so a single undo reverts all
+ of them.
+
+ @param CtrlHandle Pointer to the multiline edit control.
+ */
+VOID
+YoriWinMultilineEditEndUndoGroup(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle
+    )
+{
+    PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit;
+    PYORI_WIN_CTRL Ctrl;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY NextEntry;
+    PYORI_WIN_CTRL_MULTILINE_EDIT_UNDO Undo;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    MultilineEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_MULTILINE_EDIT, Ctrl);
+
+    ASSERT(MultilineEdit->UndoGroupBoundary != NULL);
+
+    ListEntry = YoriLibGetNextListEntry(&MultilineEdit->Undo, NULL);
+    while (ListEntry != NULL && ListEntry != MultilineEdit->UndoGroupBoundary) {
+        NextEntry = YoriLibGetNextListEntry(&MultilineEdit->Undo, ListEntry);
+        if (NextEntry == NULL || NextEntry == MultilineEdit->UndoGroupBoundary) {
+            break;
+        }
+        Undo = CONTAINING_RECORD(ListEntry, YORI_WIN_CTRL_MULTILINE_EDIT_UNDO, ListEntry);
+        Undo->ChainWithNext = TRUE;
+        ListEntry = NextEntry;
+    }
+
+    MultilineEdit->UndoGroupBoundary = NULL;
+}
+
+/**
+ Replace a range of text in a multiline edit control with new text.  Unlike
+ operations at the cursor, this does not move the cursor, alter the viewport,
+ or repaint the control, which allows a caller to perform many replacements
+ and update the display once.  The caller is expected to position the cursor
+ when complete.
+
+ @param CtrlHandle Pointer to the multiline edit control.
+
+ @param FirstLine Specifies the line containing the first character to
+        replace.
+
+ @param FirstCharOffset Specifies the offset within FirstLine of the first
+        character to replace.
+
+ @param LastLine Specifies the line containing the last character to replace.
+
+ @param LastCharOffset Specifies the offset beyond the last character to
+        replace.
+
+ @param Text Pointer to the text to insert in place of the range.  This may
+        be empty, in which case the range is deleted.
+
+ @param NewLastLine On successful completion, populated with the line
+        containing the end of the newly inserted text.
+
+ @param NewLastCharOffset On successful completion, populated with the offset
+        beyond the newly inserted text.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinMultilineEditReplaceTextRange(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in YORI_ALLOC_SIZE_T FirstLine,
+    __in YORI_ALLOC_SIZE_T FirstCharOffset,
+    __in YORI_ALLOC_SIZE_T LastLine,
+    __in YORI_ALLOC_SIZE_T LastCharOffset,
+    __in PYORI_STRING Text,
+    __out PYORI_ALLOC_SIZE_T NewLastLine,
+    __out PYORI_ALLOC_SIZE_T NewLastCharOffset
+    )
+{
+    PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit;
+    PYORI_WIN_CTRL Ctrl;
+
+    Ctrl = (PYORI_WIN_CTRL)CtrlHandle;
+    MultilineEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_MULTILINE_EDIT, Ctrl);
+
+    YoriWinMultilineEditClearSelection(MultilineEdit);
+
+    if (FirstLine != LastLine || FirstCharOffset != LastCharOffset) {
+        if (!YoriWinMultilineEditDeleteTextRange(MultilineEdit,
+                                                 FALSE,
+                                                 FALSE,
+                                                 FALSE,
+                                                 FirstLine,
+                                                 FirstCharOffset,
+                                                 LastLine,
+                                                 LastCharOffset)) {
+            return FALSE;
+        }
+    }
+
+    if (Text->LengthInChars == 0) {
+        *NewLastLine = FirstLine;
+        *NewLastCharOffset = FirstCharOffset;
+        return TRUE;
+    }
+
+    return YoriWinMultilineEditInsertTextRange(MultilineEdit,
+                                               FALSE,
+                                               FirstLine,
+                                               FirstCharOffset,
+                                               Text,
+                                               NewLastLine,
+                                               NewLastCharOffset);
+}
+
 /**
  If a selection is currently active, delete all text in the selection.
  This implies deleting multiple lines, and/or merging the end of one line
@@ -3903,8 +4159,8 @@ YoriWinMultilineEditCheckSelectionState(
     } else {
         ASSERT(Selection->LastLine != Selection->FirstLine || Selection->FirstCharOffset < Selection->LastCharOffset);
     }
-    ASSERT(Selection->FirstCharOffset <= MultilineEdit->LineArray[Selection->FirstLine].LengthInChars);
-    ASSERT(Selection->LastCharOffset <= MultilineEdit->LineArray[Selection->LastLine].LengthInChars);
+    ASSERT(Selection->FirstCharOffset <= YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine)->LengthInChars);
+    ASSERT(Selection->LastCharOffset <= YoriWinMultilineEditGetLine(MultilineEdit, Selection->LastLine)->LengthInChars);
 }
 
 /**
@@ -3963,13 +4219,13 @@ YoriWinMultilineEditStartSelectionAtCursor(
         } else if (EffectiveCursorLine >= MultilineEdit->LinesPopulated) {
 
             EffectiveCursorLine = MultilineEdit->LinesPopulated - 1;
-            EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+            EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
 
         }
 
         if (EffectiveCursorLine < MultilineEdit->LinesPopulated) {
-            if (EffectiveCursorOffset > MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars) {
-                EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+            if (EffectiveCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars) {
+                EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
             }
         }
 
@@ -4080,11 +4336,11 @@ YoriWinMultilineEditExtendSelectionToCursor(
     EffectiveCursorOffset = MultilineEdit->CursorOffset;
     if (EffectiveCursorLine >= MultilineEdit->LinesPopulated) {
         EffectiveCursorLine = MultilineEdit->LinesPopulated - 1;
-        EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+        EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
     }
 
-    if (EffectiveCursorOffset > MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars) {
-        EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+    if (EffectiveCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars) {
+        EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
     }
 
     if (EffectiveCursorLine < AnchorLine) {
@@ -4382,7 +4638,7 @@ YoriWinMultilineEditPasteText(
     if (MultilineEdit->AutoIndentApplied &&
         MultilineEdit->CursorLine == MultilineEdit->AutoIndentAppliedLine) {
 
-        Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+        Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
         for (Index = 0;
              Index < Line->LengthInChars &&
@@ -4651,11 +4907,13 @@ YoriWinMultilineEditClear(
     YoriWinMultilineEditClearSelection(MultilineEdit);
 
     for (Index = 0; Index < MultilineEdit->LinesPopulated; Index++) {
-        YoriLibFreeStringContents(&MultilineEdit->LineArray[Index]);
+        YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, Index));
     }
     YoriWinMultilineEditClearUndo(MultilineEdit);
 
     MultilineEdit->LinesPopulated = 0;
+    MultilineEdit->GapStart = 0;
+    MultilineEdit->GapLength = MultilineEdit->LinesAllocated;
     MultilineEdit->ViewportTop = 0;
     MultilineEdit->ViewportLeft = 0;
 
@@ -4792,7 +5050,7 @@ YoriWinMultilineEditGetLineByIndex(
         return NULL;
     }
 
-    return &MultilineEdit->LineArray[Index];
+    return YoriWinMultilineEditGetLine(MultilineEdit, Index);
 }
 
 /**
@@ -4949,9 +5207,9 @@ YoriWinMultilineEditSetTraditionalNavigation(
     YoriWinMultilineEditClearDesiredDisplayOffset(MultilineEdit);
     if (!MultilineEdit->TraditionalEditNavigation) {
         if (MultilineEdit->CursorLine < MultilineEdit->LinesPopulated) {
-            if (MultilineEdit->CursorOffset > MultilineEdit->LineArray[MultilineEdit->CursorLine].LengthInChars) {
+            if (MultilineEdit->CursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine)->LengthInChars) {
                 YoriWinMultilineEditSetCursorLocationInternal(MultilineEdit,
-                                                              MultilineEdit->LineArray[MultilineEdit->CursorLine].LengthInChars,
+                                                              YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine)->LengthInChars,
                                                               MultilineEdit->CursorLine);
             }
         }
@@ -5111,7 +5369,7 @@ YoriWinMultilineEditBackspace(
         return YoriWinMultilineEditDeleteSelection(&MultilineEdit->Ctrl);
     }
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
     LastLine = MultilineEdit->CursorLine;
     LastCharOffset = MultilineEdit->CursorOffset;
@@ -5145,7 +5403,7 @@ YoriWinMultilineEditBackspace(
         }
 
         FirstLine = MultilineEdit->CursorLine - 1;
-        FirstCharOffset = MultilineEdit->LineArray[FirstLine].LengthInChars;
+        FirstCharOffset = YoriWinMultilineEditGetLine(MultilineEdit, FirstLine)->LengthInChars;
     } else {
         FirstLine = LastLine;
         FirstCharOffset = LastCharOffset - 1;
@@ -5193,7 +5451,7 @@ YoriWinMultilineEditDelete(
         return YoriWinMultilineEditDeleteSelection(&MultilineEdit->Ctrl);
     }
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
     FirstLine = MultilineEdit->CursorLine;
     FirstCharOffset = MultilineEdit->CursorOffset;
@@ -5456,7 +5714,7 @@ YoriWinMultilineEditNotifyDoubleClick(
         //  If it's beyond the end of the line, there's nothing to select.
         //
 
-        Line = &MultilineEdit->LineArray[NewCursorLine];
+        Line = YoriWinMultilineEditGetLine(MultilineEdit, NewCursorLine);
         if (NewCursorChar >= Line->LengthInChars) {
             return;
         }
@@ -5632,8 +5890,8 @@ YoriWinMultilineEditScrollForMouseSelect(
     if (!MultilineEdit->TraditionalEditNavigation) {
         if (MultilineEdit->LinesPopulated > 0) {
             ASSERT(NewCursorLine < MultilineEdit->LinesPopulated);
-            if (NewCursorOffset > MultilineEdit->LineArray[NewCursorLine].LengthInChars) {
-                NewCursorOffset = MultilineEdit->LineArray[NewCursorLine].LengthInChars;
+            if (NewCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, NewCursorLine)->LengthInChars) {
+                NewCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, NewCursorLine)->LengthInChars;
             }
         }
     }
@@ -5770,7 +6028,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedKey(
             if (MultilineEdit->CursorOffset == 0) {
                 ASSERT(!MultilineEdit->TraditionalEditNavigation);
                 NewCursorLine = NewCursorLine - 1;
-                NewCursorOffset = MultilineEdit->LineArray[NewCursorLine].LengthInChars;
+                NewCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, NewCursorLine)->LengthInChars;
                 YoriWinMultilineEditTrimAutoIndent(MultilineEdit, MultilineEdit->CursorLine, 0);
             } else {
                 NewCursorOffset = MultilineEdit->CursorOffset - 1;
@@ -5788,7 +6046,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedKey(
     } else if (Event->KeyDown.VirtualKeyCode == VK_RIGHT) {
         if (MultilineEdit->TraditionalEditNavigation ||
             (MultilineEdit->CursorLine < MultilineEdit->LinesPopulated &&
-             MultilineEdit->CursorOffset < MultilineEdit->LineArray[MultilineEdit->CursorLine].LengthInChars) ||
+             MultilineEdit->CursorOffset < YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine)->LengthInChars) ||
             MultilineEdit->CursorLine + 1 < MultilineEdit->LinesPopulated) {
 
             if (Event->KeyDown.CtrlMask & SHIFT_PRESSED) {
@@ -5800,7 +6058,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedKey(
             NewCursorOffset = MultilineEdit->CursorOffset + 1;
             if (!MultilineEdit->TraditionalEditNavigation) {
                 if ((NewCursorLine < MultilineEdit->LinesPopulated &&
-                     NewCursorOffset > MultilineEdit->LineArray[NewCursorLine].LengthInChars)) {
+                     NewCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, NewCursorLine)->LengthInChars)) {
 
                     NewCursorLine = NewCursorLine + 1;
                     NewCursorOffset = 0;
@@ -5842,7 +6100,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedKey(
             YoriWinMultilineEditClearSelection(MultilineEdit);
         }
         if (MultilineEdit->CursorLine < MultilineEdit->LinesPopulated) {
-            FinalChar = MultilineEdit->LineArray[MultilineEdit->CursorLine].LengthInChars;
+            FinalChar = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine)->LengthInChars;
         }
         if (MultilineEdit->CursorOffset != FinalChar) {
             YoriWinMultilineEditSetCursorLocationInternal(MultilineEdit, FinalChar, MultilineEdit->CursorLine);
@@ -6012,7 +6270,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedCtrlKey(
             YoriWinMultilineEditClearSelection(MultilineEdit);
         }
         if (MultilineEdit->LinesPopulated > 0) {
-            FinalChar = MultilineEdit->LineArray[MultilineEdit->LinesPopulated - 1].LengthInChars;
+            FinalChar = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->LinesPopulated - 1)->LengthInChars;
             if (MultilineEdit->CursorLine != MultilineEdit->LinesPopulated - 1 ||
                 MultilineEdit->CursorOffset != FinalChar) {
 
@@ -6041,7 +6299,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedCtrlKey(
                 YORI_STRING WhitespaceChars = YORILIB_CONSTANT_STRING(_T(" -\t"));
                 PYORI_STRING Line;
 
-                Line = &MultilineEdit->LineArray[ProbeLine];
+                Line = YoriWinMultilineEditGetLine(MultilineEdit, ProbeLine);
                 Index = ProbeOffset;
                 if (Index > Line->LengthInChars) {
                     Index = Line->LengthInChars;
@@ -6053,7 +6311,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedCtrlKey(
                 }
                 if (Index == 0 && ProbeLine > 0) {
                     ProbeLine--;
-                    ProbeOffset = MultilineEdit->LineArray[ProbeLine].LengthInChars;
+                    ProbeOffset = YoriWinMultilineEditGetLine(MultilineEdit, ProbeLine)->LengthInChars;
                     continue;
                 }
                 while(Index > 0 &&
@@ -6090,7 +6348,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedCtrlKey(
                 YORI_STRING WhitespaceChars = YORILIB_CONSTANT_STRING(_T(" -\t"));
                 PYORI_STRING Line;
 
-                Line = &MultilineEdit->LineArray[ProbeLine];
+                Line = YoriWinMultilineEditGetLine(MultilineEdit, ProbeLine);
                 Index = ProbeOffset;
                 if (Index > Line->LengthInChars) {
                     Index = Line->LengthInChars;
@@ -6154,7 +6412,7 @@ YoriWinMultilineEditEventHandler(
         case YoriWinEventParentDestroyed:
             YoriWinMultilineEditClearUndo(MultilineEdit);
             for (Index = 0; Index < MultilineEdit->LinesPopulated; Index++) {
-                YoriLibFreeStringContents(&MultilineEdit->LineArray[Index]);
+                YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, Index));
             }
             if (MultilineEdit->LineArray != NULL) {
                 YoriLibDereference(MultilineEdit->LineArray);
@@ -6212,7 +6470,7 @@ YoriWinMultilineEditEventHandler(
                                                                   0,
                                                                   0,
                                                                   MultilineEdit->LinesPopulated - 1,
-                                                                  MultilineEdit->LineArray[MultilineEdit->LinesPopulated - 1].LengthInChars);
+                                                                  YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->LinesPopulated - 1)->LengthInChars);
                         }
                         return TRUE;
                     } else if (Event->KeyDown.VirtualKeyCode == 'C') {
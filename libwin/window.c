@@ -111,6 +111,18 @@ typedef struct _YORI_WIN_WINDOW {
      */
     PYORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE WindowManagerResizeNotifyCallback;
 
+    /**
+     Optionally points to a callback function to invoke periodically while
+     the window is processing input.
+     */
+    PYORI_WIN_NOTIFY PeriodicNotifyCallback;
+
+    /**
+     The timer used to invoke PeriodicNotifyCallback.  This is NULL if no
+     periodic callback is registered.
+     */
+    PYORI_WIN_CTRL_HANDLE PeriodicTimer;
+
     /**
      An array of callbacks that can be invoked when particular events occur
      in the window, which were not processed by any control on the window.
@@ -729,6 +741,11 @@ YoriWinDestroyWindow(
 
     YoriWinMgrNotifyWindowDestroy(Window->WinMgrHandle, Window);
 
+    if (Window->PeriodicTimer != NULL) {
+        YoriWinMgrFreeTimer(Window->PeriodicTimer);
+        Window->PeriodicTimer = NULL;
+    }
+
     if (Window->Contents != NULL) {
         YoriLibFree(Window->Contents);
         Window->Contents = NULL;
@@ -1987,6 +2004,51 @@ YoriWinSetWindowManagerResizeNotifyCallback(
     return TRUE;
 }
 
+/**
+ Set a callback to invoke periodically while the window is processing input.
+ This allows an application to perform incremental work, such as consuming
+ the results of a background operation, on the thread that owns the window.
+ Only one periodic callback can be registered per window.
+
+ @param WindowHandle Pointer to the window to invoke a callback from.
+
+ @param PeriodicInterval The interval between invocations, in milliseconds.
+
+ @param NotifyCallback A function to invoke periodically.  If NULL, any
+        existing periodic callback is removed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriWinSetPeriodicNotifyCallback(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle,
+    __in DWORD PeriodicInterval,
+    __in_opt PYORI_WIN_NOTIFY NotifyCallback
+    )
+{
+    PYORI_WIN_WINDOW Window;
+    Window = (PYORI_WIN_WINDOW)WindowHandle;
+
+    if (Window->PeriodicTimer != NULL) {
+        YoriWinMgrFreeTimer(Window->PeriodicTimer);
+        Window->PeriodicTimer = NULL;
+    }
+
+    Window->PeriodicNotifyCallback = NULL;
+
+    if (NotifyCallback == NULL) {
+        return TRUE;
+    }
+
+    Window->PeriodicTimer = YoriWinMgrAllocateRecurringTimer(Window->WinMgrHandle, &Window->Ctrl, PeriodicInterval);
+    if (Window->PeriodicTimer == NULL) {
+        return FALSE;
+    }
+
+    Window->PeriodicNotifyCallback = NotifyCallback;
+    return TRUE;
+}
+
 /**
  Set a callback to be invoked when an event occurs on the window that is not
  explicitly handled by a control.  As of this writing, only one callback can
@@ -2467,6 +2529,12 @@ YoriWinNotifyEvent(
         if (Window->WindowManagerResizeNotifyCallback != NULL) {
             Window->WindowManagerResizeNotifyCallback(Window, &Event->WindowManagerResize.OldWinMgrDimensions, &Event->WindowManagerResize.NewWinMgrDimensions);
         }
+    } else if (Event->EventType == YoriWinEventTimer) {
+        if (Event->Timer.Timer == Window->PeriodicTimer &&
+            Window->PeriodicNotifyCallback != NULL) {
+
+            Window->PeriodicNotifyCallback(Window);
+        }
     }
 
     if (Window->CustomNotifications != NULL &&
@@ -40,6 +40,41 @@
  */
 #define YORI_WIN_SHADOW_HEIGHT (1)
 
+/**
+ The approximate cost, in cells, of issuing an additional write to the
+ console.  When two dirty rows could be combined into a single rectangle,
+ they are combined if doing so writes no more than this many unchanged cells.
+ Each write is a round trip to the console, which is expensive when the
+ console is remote.
+ */
+#define YORI_WIN_MGR_WRITE_OVERHEAD_CELLS (64)
+
+/**
+ The minimum time, in milliseconds, between writes to the console while
+ input is waiting to be processed.  When input arrives faster than it can be
+ displayed, intermediate states are not written, and the display is updated
+ once the input has been processed or this time has elapsed.
+ */
+#define YORI_WIN_MGR_MIN_DISPLAY_INTERVAL (16)
+
+/**
+ The range of cells on a single row of the display which have changed and
+ need to be written to the console.  If Right is less than Left, the row
+ has not changed.
+ */
+typedef struct _YORI_WIN_MGR_DIRTY_ROW {
+
+    /**
+     The leftmost cell on the row which has changed.
+     */
+    SHORT Left;
+
+    /**
+     The rightmost cell on the row which has changed.
+     */
+    SHORT Right;
+} YORI_WIN_MGR_DIRTY_ROW, *PYORI_WIN_MGR_DIRTY_ROW;
+
 /**
  A timer that can be attached to the window manager.
  */
@@ -178,6 +213,20 @@ typedef struct _YORI_WIN_WINDOW_MANAGER {
      */
     SMALL_RECT DirtyRect;
 
+    /**
+     An array with one entry per row of the Contents buffer, describing the
+     range of each row which has changed since it was last displayed.  This
+     allows changes in different parts of the display to be written as
+     separate regions rather than one rectangle covering all of them.  If
+     this is NULL, DirtyRect is used for the entire display.
+     */
+    PYORI_WIN_MGR_DIRTY_ROW DirtyRows;
+
+    /**
+     The number of entries in the DirtyRows array.
+     */
+    SHORT DirtyRowCount;
+
     /**
      The current state of the cursor on the display.  If the active window
      changes or if it moves the cursor, this will be compared to the new
@@ -219,6 +268,11 @@ typedef struct _YORI_WIN_WINDOW_MANAGER {
      */
     DWORD SavedConsoleInputMode;
 
+    /**
+     The tick count when the display was last written to the console.
+     */
+    DWORD LastDisplayTick;
+
     /**
      Set to TRUE to indicate all mouse press events should be sent to one
      specific window (MouseButtonOwningWindow) regardless of the mouse
@@ -437,6 +491,46 @@ YoriWinMgrRestorePreviousContents(
     }
 }
 
+/**
+ Allocate the array describing which part of each row of the display has
+ changed.  Failure is not fatal: if the array cannot be allocated, the
+ window manager falls back to tracking a single rectangle for the whole
+ display.
+
+ @param WinMgr Pointer to the window manager.
+
+ @param RowCount The number of rows in the display.
+ */
+VOID
+YoriWinMgrAllocateDirtyRows(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr,
+    __in SHORT RowCount
+    )
+{
+    SHORT Index;
+
+    if (WinMgr->DirtyRows != NULL) {
+        YoriLibFree(WinMgr->DirtyRows);
+        WinMgr->DirtyRows = NULL;
+        WinMgr->DirtyRowCount = 0;
+    }
+
+    if (RowCount <= 0) {
+        return;
+    }
+
+    WinMgr->DirtyRows = YoriLibMalloc(RowCount * sizeof(YORI_WIN_MGR_DIRTY_ROW));
+    if (WinMgr->DirtyRows == NULL) {
+        return;
+    }
+
+    WinMgr->DirtyRowCount = RowCount;
+    for (Index = 0; Index < RowCount; Index++) {
+        WinMgr->DirtyRows[Index].Left = 1;
+        WinMgr->DirtyRows[Index].Right = 0;
+    }
+}
+
 /**
  Close and free the window manager.
 
@@ -460,6 +554,11 @@ YoriWinCloseWindowManager(
         WinMgr->Contents = NULL;
     }
 
+    if (WinMgr->DirtyRows != NULL) {
+        YoriLibFree(WinMgr->DirtyRows);
+        WinMgr->DirtyRows = NULL;
+    }
+
     if (WinMgr->HaveSavedScreenBufferInfo) {
         COORD NewCursorPosition;
         NewCursorPosition.X = (SHORT)(WinMgr->SavedScreenBufferInfo.srWindow.Left + WinMgr->SavedCursorPosition.X);
@@ -554,10 +653,13 @@ YoriWinOpenWindowManager(
     WinMgr->hConOriginal = NULL;
     WinMgr->SavedContents = NULL;
     WinMgr->Contents = NULL;
+    WinMgr->DirtyRows = NULL;
+    WinMgr->DirtyRowCount = 0;
     YoriLibInitializeListHead(&WinMgr->TimerList);
     YoriLibInitializeListHead(&WinMgr->ZOrderList);
     WinMgr->DisplayDirty = FALSE;
     WinMgr->UpdateCursor = FALSE;
+    WinMgr->LastDisplayTick = 0;
     WinMgr->SavedCursorPosition.X = 0;
     WinMgr->SavedCursorPosition.Y = 0;
     WinMgr->PreviousObservedMouseButtonState = 0;
@@ -662,6 +764,8 @@ YoriWinOpenWindowManager(
         WinMgr->Contents[CellIndex].Char.UnicodeChar = WinMgr->SavedContents[CellIndex].Char.UnicodeChar;
     }
 
+    YoriWinMgrAllocateDirtyRows(WinMgr, BufferSize.Y);
+
     //
     //  Probe for Conhostv2 by asking for a flag that only it supports.
     //  Conhostv2 reports coordinates differently (correctly) for mouse
@@ -1556,6 +1660,53 @@ YoriWinMgrExpandDirtyToPoint(
             WinMgr->DirtyRect.Bottom = Point.Y;
         }
     }
+
+    if (Point.Y < WinMgr->DirtyRowCount) {
+        PYORI_WIN_MGR_DIRTY_ROW Row;
+
+        Row = &WinMgr->DirtyRows[Point.Y];
+        if (Row->Right < Row->Left) {
+            Row->Left = Point.X;
+            Row->Right = Point.X;
+        } else if (Point.X < Row->Left) {
+            Row->Left = Point.X;
+        } else if (Point.X > Row->Right) {
+            Row->Right = Point.X;
+        }
+    }
+}
+
+/**
+ Indicate that the entire display needs to be written to the console,
+ regardless of whether the contents of any cell have changed.  This is used
+ when the contents of the console are no longer known, such as after a
+ resize.
+
+ @param WinMgr Pointer to the window manager.
+ */
+VOID
+YoriWinMgrExpandDirtyToDisplay(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr
+    )
+{
+    COORD BufferSize;
+    SHORT Index;
+
+    YoriWinGetWinMgrDimensions(WinMgr, &BufferSize);
+    if (BufferSize.X <= 0 || BufferSize.Y <= 0) {
+        return;
+    }
+
+    WinMgr->DisplayDirty = TRUE;
+    WinMgr->DirtyRect.Left = 0;
+    WinMgr->DirtyRect.Top = 0;
+    WinMgr->DirtyRect.Right = (SHORT)(BufferSize.X - 1);
+    WinMgr->DirtyRect.Bottom = (SHORT)(BufferSize.Y - 1);
+
+    for (Index = 0; Index < WinMgr->DirtyRowCount; Index++) {
+        WinMgr->DirtyRows[Index].Left = 0;
+        WinMgr->DirtyRows[Index].Right = (SHORT)(BufferSize.X - 1);
+    }
 }
 
 /**
@@ -1734,6 +1885,220 @@ YoriWinMgrRegenerateRegion(
     }
 }
 
+/**
+ Write a rectangle from the staged display into the console.
+
+ @param WinMgr Pointer to the window manager.
+
+ @param BufferSize The dimensions of the staged display.
+
+ @param WinMgrPos The location of the window manager within the console
+        screen buffer.
+
+ @param Rect The region of the staged display to write, in window manager
+        coordinates.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinMgrWriteDisplayRect(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr,
+    __in COORD BufferSize,
+    __in PCSMALL_RECT WinMgrPos,
+    __in PCSMALL_RECT Rect
+    )
+{
+    COORD BufferPosition;
+    SMALL_RECT RedrawWindow;
+
+    BufferPosition.X = Rect->Left;
+    BufferPosition.Y = Rect->Top;
+
+    RedrawWindow.Left = (SHORT)(Rect->Left + WinMgrPos->Left);
+    RedrawWindow.Right = (SHORT)(Rect->Right + WinMgrPos->Left);
+    RedrawWindow.Top = (SHORT)(Rect->Top + WinMgrPos->Top);
+    RedrawWindow.Bottom = (SHORT)(Rect->Bottom + WinMgrPos->Top);
+
+    if (!WriteConsoleOutput(WinMgr->hConOut, WinMgr->Contents, BufferSize, BufferPosition, &RedrawWindow)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write the regions of the staged display that have changed into the console.
+ Rather than writing a single rectangle containing every change, each row
+ records its own changed range, and consecutive rows are combined into one
+ rectangle only when that writes fewer cells than issuing a separate write.
+ This means a change at the top of the display and another at the bottom
+ are written as two small regions, not the entire display.
+
+ @param WinMgr Pointer to the window manager.
+
+ @param BufferSize The dimensions of the staged display.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+YoriWinMgrWriteDirtyRegions(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr,
+    __in COORD BufferSize
+    )
+{
+    PYORI_WIN_MGR_DIRTY_ROW Row;
+    SMALL_RECT WinMgrPos;
+    SMALL_RECT Rect;
+    SHORT LineIndex;
+    SHORT MergedLeft;
+    SHORT MergedRight;
+    DWORD SeparateCells;
+    DWORD MergedCells;
+    BOOLEAN HaveRect;
+
+    YoriWinGetWinMgrLocation(WinMgr, &WinMgrPos);
+
+    //
+    //  If per row tracking isn't available, write the bounding rectangle.
+    //
+
+    if (WinMgr->DirtyRows == NULL ||
+        WinMgr->DirtyRect.Bottom >= WinMgr->DirtyRowCount) {
+
+        if (!YoriWinMgrWriteDisplayRect(WinMgr, BufferSize, &WinMgrPos, &WinMgr->DirtyRect)) {
+            return FALSE;
+        }
+
+        for (LineIndex = 0; LineIndex < WinMgr->DirtyRowCount; LineIndex++) {
+            WinMgr->DirtyRows[LineIndex].Left = 1;
+            WinMgr->DirtyRows[LineIndex].Right = 0;
+        }
+
+        WinMgr->DisplayDirty = FALSE;
+        return TRUE;
+    }
+
+    HaveRect = FALSE;
+    Rect.Left = 0;
+    Rect.Top = 0;
+    Rect.Right = 0;
+    Rect.Bottom = 0;
+
+    for (LineIndex = WinMgr->DirtyRect.Top; LineIndex <= WinMgr->DirtyRect.Bottom; LineIndex++) {
+        Row = &WinMgr->DirtyRows[LineIndex];
+
+        //
+        //  An unchanged row ends any rectangle being accumulated.
+        //
+
+        if (Row->Right < Row->Left) {
+            if (HaveRect) {
+                if (!YoriWinMgrWriteDisplayRect(WinMgr, BufferSize, &WinMgrPos, &Rect)) {
+                    YoriWinMgrExpandDirtyToDisplay(WinMgr);
+                    return FALSE;
+                }
+                HaveRect = FALSE;
+            }
+            continue;
+        }
+
+        //
+        //  Check whether extending the current rectangle to include this
+        //  row writes fewer cells than writing this row separately.
+        //
+
+        if (HaveRect) {
+            MergedLeft = Rect.Left;
+            if (Row->Left < MergedLeft) {
+                MergedLeft = Row->Left;
+            }
+            MergedRight = Rect.Right;
+            if (Row->Right > MergedRight) {
+                MergedRight = Row->Right;
+            }
+
+            SeparateCells = (DWORD)(Rect.Right - Rect.Left + 1) * (DWORD)(Rect.Bottom - Rect.Top + 1);
+            SeparateCells = SeparateCells + (DWORD)(Row->Right - Row->Left + 1) + YORI_WIN_MGR_WRITE_OVERHEAD_CELLS;
+            MergedCells = (DWORD)(MergedRight - MergedLeft + 1) * (DWORD)(LineIndex - Rect.Top + 1);
+
+            if (MergedCells <= SeparateCells) {
+                Rect.Left = MergedLeft;
+                Rect.Right = MergedRight;
+                Rect.Bottom = LineIndex;
+            } else {
+                if (!YoriWinMgrWriteDisplayRect(WinMgr, BufferSize, &WinMgrPos, &Rect)) {
+                    YoriWinMgrExpandDirtyToDisplay(WinMgr);
+                    return FALSE;
+                }
+                HaveRect = FALSE;
+            }
+        }
+
+        if (!HaveRect) {
+            Rect.Left = Row->Left;
+            Rect.Right = Row->Right;
+            Rect.Top = LineIndex;
+            Rect.Bottom = LineIndex;
+            HaveRect = TRUE;
+        }
+
+        Row->Left = 1;
+        Row->Right = 0;
+    }
+
+    if (HaveRect) {
+        if (!YoriWinMgrWriteDisplayRect(WinMgr, BufferSize, &WinMgrPos, &Rect)) {
+            YoriWinMgrExpandDirtyToDisplay(WinMgr);
+            return FALSE;
+        }
+    }
+
+    WinMgr->DisplayDirty = FALSE;
+    return TRUE;
+}
+
+/**
+ Determine whether writing the staged display to the console should be
+ skipped for now.  This occurs when the display was written very recently
+ and more input is already waiting, since that input is likely to change
+ the display again.  The display is written once the input has been
+ processed, because the input loop only waits once no input remains.
+
+ @param WinMgr Pointer to the window manager.
+
+ @return TRUE to indicate the display should not be written now, FALSE to
+         indicate it should be written.
+ */
+BOOLEAN
+YoriWinMgrShouldDeferDisplay(
+    __in PYORI_WIN_WINDOW_MANAGER WinMgr
+    )
+{
+    DWORD EventsPending;
+
+    //
+    //  If no windows are present, the window manager is restoring the
+    //  console before exiting, so write immediately.
+    //
+
+    if (YoriLibIsListEmpty(&WinMgr->ZOrderList)) {
+        return FALSE;
+    }
+
+    if (GetTickCount() - WinMgr->LastDisplayTick >= YORI_WIN_MGR_MIN_DISPLAY_INTERVAL) {
+        return FALSE;
+    }
+
+    if (!GetNumberOfConsoleInputEvents(WinMgr->hConIn, &EventsPending) ||
+        EventsPending == 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Display the contents of the staged display into the console.  Generating
  this display is done via @ref YoriWinMgrRegenerateRegion .
@@ -1748,14 +2113,16 @@ YoriWinMgrDisplayContents(
     )
 {
     PYORI_WIN_WINDOW_MANAGER WinMgr = (PYORI_WIN_WINDOW_MANAGER)WinMgrHandle;
-    COORD BufferPosition;
     COORD BufferSize;
     SMALL_RECT WinMgrPos;
-    SMALL_RECT RedrawWindow;
     PYORI_LIST_ENTRY ListEntry;
     PYORI_WIN_WINDOW_HANDLE WindowHandle;
     YORI_WIN_CURSOR_STATE NewCursorState;
 
+    if (YoriWinMgrShouldDeferDisplay(WinMgr)) {
+        return TRUE;
+    }
+
     YoriWinGetWinMgrDimensions(WinMgr, &BufferSize);
 
     //
@@ -1768,25 +2135,13 @@ YoriWinMgrDisplayContents(
 
     if (WinMgr->DisplayDirty && YoriLibIsNanoServer()) {
 
-        YoriWinGetWinMgrLocation(WinMgr, &WinMgrPos);
-
-        BufferPosition.X = WinMgr->DirtyRect.Left;
-        BufferPosition.Y = WinMgr->DirtyRect.Top;
-
-        RedrawWindow.Left = (SHORT)(WinMgr->DirtyRect.Left + WinMgrPos.Left);
-        RedrawWindow.Right = (SHORT)(WinMgr->DirtyRect.Right + WinMgrPos.Left);
-        RedrawWindow.Top = (SHORT)(WinMgr->DirtyRect.Top + WinMgrPos.Top);
-        RedrawWindow.Bottom = (SHORT)(WinMgr->DirtyRect.Bottom + WinMgrPos.Top);
-
-        if (!WriteConsoleOutput(WinMgr->hConOut, WinMgr->Contents, BufferSize, BufferPosition, &RedrawWindow)) {
+        if (!YoriWinMgrWriteDirtyRegions(WinMgr, BufferSize)) {
             return FALSE;
         }
 
         if (YoriLibIsNanoServer() && WinMgr->DisplayedCursorState.Visible) {
             WinMgr->UpdateCursor = TRUE;
         }
-
-        WinMgr->DisplayDirty = FALSE;
     }
 
     //
@@ -1877,24 +2232,12 @@ YoriWinMgrDisplayContents(
     //
 
     if (WinMgr->DisplayDirty) {
-
-        YoriWinGetWinMgrLocation(WinMgr, &WinMgrPos);
-
-        BufferPosition.X = WinMgr->DirtyRect.Left;
-        BufferPosition.Y = WinMgr->DirtyRect.Top;
-
-        RedrawWindow.Left = (SHORT)(WinMgr->DirtyRect.Left + WinMgrPos.Left);
-        RedrawWindow.Right = (SHORT)(WinMgr->DirtyRect.Right + WinMgrPos.Left);
-        RedrawWindow.Top = (SHORT)(WinMgr->DirtyRect.Top + WinMgrPos.Top);
-        RedrawWindow.Bottom = (SHORT)(WinMgr->DirtyRect.Bottom + WinMgrPos.Top);
-
-        if (!WriteConsoleOutput(WinMgr->hConOut, WinMgr->Contents, BufferSize, BufferPosition, &RedrawWindow)) {
+        if (!YoriWinMgrWriteDirtyRegions(WinMgr, BufferSize)) {
             return FALSE;
         }
-
-        WinMgr->DisplayDirty = FALSE;
     }
 
+    WinMgr->LastDisplayTick = GetTickCount();
     return TRUE;
 }
 
@@ -2472,6 +2815,7 @@ YoriWinMgrProcessExpiredTimers(
     PYORI_WIN_TIMER Timer;
     PYORI_LIST_ENTRY ListEntry;
     LONGLONG CurrentTime;
+    LONGLONG IntervalInNtUnits;
     YORI_WIN_EVENT Event;
 
     if (!YoriLibIsListEmpty(&WinMgr->TimerList)) {
@@ -2492,6 +2836,21 @@ YoriWinMgrProcessExpiredTimers(
                 Timer->NotifyCtrl->NotifyEventFn(Timer->NotifyCtrl, &Event);
                 Timer->PeriodsExpired++;
                 YoriWinMgrCalculateNextExpiration(Timer);
+
+                //
+                //  If processing was delayed so that multiple periods have
+                //  elapsed, deliver one event for all of them rather than
+                //  one event per period on successive passes.
+                //
+
+                if (Timer->ExpirationTime < CurrentTime) {
+                    IntervalInNtUnits = Timer->PeriodicIntervalInMs;
+                    IntervalInNtUnits = IntervalInNtUnits * 1000 * 10;
+                    if (IntervalInNtUnits > 0) {
+                        Timer->PeriodsExpired = Timer->PeriodsExpired + (DWORD)((CurrentTime - Timer->ExpirationTime) / IntervalInNtUnits) + 1;
+                        YoriWinMgrCalculateNextExpiration(Timer);
+                    }
+                }
             }
         }
     }
@@ -3054,6 +3413,7 @@ YoriWinMgrProcessBufferSizeEvent(
             YoriLibFree(WinMgr->Contents);
         }
         WinMgr->Contents = NewAllocation;
+        YoriWinMgrAllocateDirtyRows(WinMgr, NewSize.Y);
 
         //
         //  From the bottom of the stack to the top of the stack, show all
@@ -3114,6 +3474,52 @@ YoriWinMgrProcessBufferSizeEvent(
     NewRect.Bottom = (SHORT)(NewSize.Y - 1);
 
     YoriWinMgrRegenerateRegion(WinMgr, &NewRect);
+
+    //
+    //  The new display buffer was not initialized from the console, and the
+    //  console may have reflowed its contents, so comparing cells against it
+    //  doesn't indicate what the console is displaying.  Write everything.
+    //
+
+    if (NewAllocation != NULL) {
+        YoriWinMgrExpandDirtyToDisplay(WinMgr);
+    }
+}
+
+/**
+ Determine whether a mouse move event can be discarded because it is
+ followed by another mouse move event with the same button and key state.
+
+ @param InputRecord Pointer to the event to check.
+
+ @param NextInputRecord Pointer to the event immediately following
+        InputRecord.
+
+ @return TRUE to indicate InputRecord can be discarded, FALSE to indicate it
+         must be processed.
+ */
+BOOLEAN
+YoriWinMgrIsCoalescableMouseMove(
+    __in PINPUT_RECORD InputRecord,
+    __in PINPUT_RECORD NextInputRecord
+    )
+{
+    if (InputRecord->EventType != MOUSE_EVENT ||
+        NextInputRecord->EventType != MOUSE_EVENT) {
+        return FALSE;
+    }
+
+    if (InputRecord->Event.MouseEvent.dwEventFlags != MOUSE_MOVED ||
+        NextInputRecord->Event.MouseEvent.dwEventFlags != MOUSE_MOVED) {
+        return FALSE;
+    }
+
+    if (InputRecord->Event.MouseEvent.dwButtonState != NextInputRecord->Event.MouseEvent.dwButtonState ||
+        InputRecord->Event.MouseEvent.dwControlKeyState != NextInputRecord->Event.MouseEvent.dwControlKeyState) {
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 /**
@@ -3132,7 +3538,7 @@ YoriWinMgrProcessAllEvents(
 {
     HANDLE hConIn;
     HANDLE hConOut;
-    INPUT_RECORD InputRecords[10];
+    INPUT_RECORD InputRecords[32];
     PINPUT_RECORD InputRecord;
     PYORI_WIN_WINDOW_MANAGER WinMgr;
     DWORD ActuallyRead;
@@ -3203,6 +3609,17 @@ YoriWinMgrProcessAllEvents(
 
         for (Index = 0; Index < ActuallyRead; Index++) {
             InputRecord = &InputRecords[Index];
+
+            //
+            //  If the mouse moved and the next event is another move with
+            //  the same buttons and keys, only the final position matters.
+            //
+
+            if (Index + 1 < ActuallyRead &&
+                YoriWinMgrIsCoalescableMouseMove(InputRecord, &InputRecords[Index + 1])) {
+                continue;
+            }
+
             if (InputRecord->EventType == KEY_EVENT) {
                 YoriWinMgrProcessKeyEvent(WinMgr, InputRecord);
             } else if (InputRecord->EventType == MOUSE_EVENT) {
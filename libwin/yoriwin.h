@@ -344,6 +344,14 @@ YoriWinHexEditDeleteSelection(
     __in PYORI_WIN_CTRL_HANDLE HexEdit
     );
 
+__success(return)
+BOOLEAN
+YoriWinHexEditGetModifiedRange(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __out PYORI_ALLOC_SIZE_T FirstByte,
+    __out PYORI_ALLOC_SIZE_T BeyondLastByte
+    );
+
 BOOLEAN
 YoriWinHexEditGetModifyState(
     __in PYORI_WIN_CTRL_HANDLE CtrlHandle
@@ -394,6 +402,12 @@ YoriWinHexEditSetDataNoCopy(
     __in YORI_ALLOC_SIZE_T NewBufferValid
     );
 
+VOID
+YoriWinHexEditSetDisplayOffset(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in DWORDLONG DisplayOffset
+    );
+
 BOOLEAN
 YoriWinHexEditSetModifyState(
     __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
@@ -596,6 +610,20 @@ YoriWinLabelReposition(
 
 // LIST.C
 
+/**
+ A function prototype that is invoked by a virtual list control to obtain
+ the text of an item.  The text may refer to memory owned by the caller that
+ remains valid until the next call, or may be allocated, in which case the
+ list control frees it.
+ */
+typedef BOOLEAN YORI_WIN_LIST_GET_ITEM_TEXT(PYORI_WIN_CTRL_HANDLE, YORI_ALLOC_SIZE_T, PYORI_STRING);
+
+/**
+ A pointer to a function that is invoked by a virtual list control to obtain
+ the text of an item.
+ */
+typedef YORI_WIN_LIST_GET_ITEM_TEXT *PYORI_WIN_LIST_GET_ITEM_TEXT;
+
 /**
  The list should display a vertical scroll bar.
  */
@@ -673,6 +701,22 @@ YoriWinListGetItemText(
     __inout PYORI_STRING Text
     );
 
+__success(return)
+BOOLEAN
+YoriWinListSetVirtualItemSource(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in_opt PYORI_WIN_LIST_GET_ITEM_TEXT GetItemText,
+    __in YORI_ALLOC_SIZE_T ItemCount,
+    __in BOOLEAN ItemsSorted
+    );
+
+__success(return)
+BOOLEAN
+YoriWinListSetVirtualItemCount(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in YORI_ALLOC_SIZE_T ItemCount
+    );
+
 BOOLEAN
 YoriWinListReposition(
     __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
@@ -843,6 +887,29 @@ YoriWinMultilineEditDeleteSelection(
     __in PYORI_WIN_CTRL_HANDLE CtrlHandle
     );
 
+VOID
+YoriWinMultilineEditBeginUndoGroup(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle
+    );
+
+VOID
+YoriWinMultilineEditEndUndoGroup(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle
+    );
+
+__success(return)
+BOOLEAN
+YoriWinMultilineEditReplaceTextRange(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in YORI_ALLOC_SIZE_T FirstLine,
+    __in YORI_ALLOC_SIZE_T FirstCharOffset,
+    __in YORI_ALLOC_SIZE_T LastLine,
+    __in YORI_ALLOC_SIZE_T LastCharOffset,
+    __in PYORI_STRING Text,
+    __out PYORI_ALLOC_SIZE_T NewLastLine,
+    __out PYORI_ALLOC_SIZE_T NewLastCharOffset
+    );
+
 __success(return)
 BOOLEAN
 YoriWinMultilineEditGetSelectedText(
@@ -1118,6 +1185,13 @@ YoriWinSetWindowManagerResizeNotifyCallback(
     __in PYORI_WIN_NOTIFY_WINDOW_MANAGER_RESIZE NotifyCallback
     );
 
+BOOLEAN
+YoriWinSetPeriodicNotifyCallback(
+    __in PYORI_WIN_WINDOW_HANDLE WindowHandle,
+    __in DWORD PeriodicInterval,
+    __in_opt PYORI_WIN_NOTIFY NotifyCallback
+    );
+
 PYORI_WIN_WINDOW_MANAGER_HANDLE
 YoriWinGetWindowManagerHandle(
     __in PYORI_WIN_WINDOW_HANDLE WindowHandle
@@ -35,11 +35,13 @@ CHAR strLinesHelpText[] =
         "\n"
         "Count the number of lines in one or more files.\n"
         "\n"
-        "LINES [-license] [-b] [-l] [-s] [-t] [<file>...]\n"
+        "LINES [-license] [-b] [-j n] [-l] [-s] [-stats] [-t] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -j             Count files on the specified number of threads\n"
         "   -l             Display line length statistics\n"
         "   -s             Process files from all subdirectories\n"
+        "   -stats         Display performance statistics on completion\n"
         "   -t             Display total line count of all files\n";
 
 /**
@@ -56,6 +58,11 @@ LinesHelp(VOID)
     return TRUE;
 }
 
+/**
+ The number of line views to request from the line reader at a time.
+ */
+#define LINES_VIEWS_PER_READ (64)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -122,6 +129,43 @@ typedef struct _LINES_CONTEXT {
      Records the total number of lines processed for all files.
      */
     YORI_MAX_SIGNED_T TotalLinesFound;
+
+    /**
+     The number of threads to use when counting files.  Zero indicates one
+     thread per processor, and one indicates files are counted by the
+     enumerating thread.  This is forced to one when displaying line length
+     statistics, which require examining each line.
+     */
+    DWORD ThreadCount;
+
+    /**
+     A buffer used to read files when counting lines on the enumerating
+     thread without examining line lengths.
+     */
+    PUCHAR CountBuffer;
+
+    /**
+     The queue of files to count on background threads.  This is only used
+     if ThreadCount is not one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     The list of files queued to background threads which have not yet been
+     displayed, in the order they were found.
+     */
+    YORI_LIST_ENTRY PendingFiles;
+
+    /**
+     The number of files on the PendingFiles list.
+     */
+    YORI_ALLOC_SIZE_T PendingFileCount;
+
+    /**
+     An auto reset event signalled whenever a background thread completes a
+     file.
+     */
+    HANDLE FileCompleteEvent;
 } LINES_CONTEXT, *PLINES_CONTEXT;
 
 /**
@@ -140,11 +184,12 @@ LinesProcessStream(
     )
 {
     PVOID LineContext = NULL;
-    YORI_STRING LineString;
+    YORI_LIB_LINE_VIEW LineViews[LINES_VIEWS_PER_READ];
+    YORI_ALLOC_SIZE_T ViewCount;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T LineLength;
     BOOLEAN OneLineFound;
 
-    YoriLibInitEmptyString(&LineString);
-
     LinesContext->FilesFound++;
     LinesContext->FilesFoundThisArg++;
     LinesContext->FileLinesFound = 0;
@@ -153,31 +198,605 @@ LinesProcessStream(
     LinesContext->FileTotalChars = 0;
     OneLineFound = FALSE;
 
+    //
+    //  Lines are examined in place within the line reader's buffer, since
+    //  only their lengths are needed.
+    //
+
     while (TRUE) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        if (!YoriLibReadLineViews(LineViews, LINES_VIEWS_PER_READ, &ViewCount, &LineContext, hSource)) {
             break;
         }
 
-        LinesContext->FileLinesFound++;
-        LinesContext->FileTotalChars = LinesContext->FileTotalChars + LineString.LengthInChars;
-        if (LineString.LengthInChars > LinesContext->FileLongestLine) {
-            LinesContext->FileLongestLine = LineString.LengthInChars;
-        }
+        LinesContext->FileLinesFound = LinesContext->FileLinesFound + ViewCount;
 
-        if (!OneLineFound || LineString.LengthInChars < LinesContext->FileShortestLine) {
-            LinesContext->FileShortestLine = LineString.LengthInChars;
-            OneLineFound = TRUE;
+        for (Index = 0; Index < ViewCount; Index++) {
+            LineLength = YoriLibLineViewLengthInChars(&LineViews[Index]);
+            LinesContext->FileTotalChars = LinesContext->FileTotalChars + LineLength;
+            if (LineLength > LinesContext->FileLongestLine) {
+                LinesContext->FileLongestLine = LineLength;
+            }
+
+            if (!OneLineFound || LineLength < LinesContext->FileShortestLine) {
+                LinesContext->FileShortestLine = LineLength;
+                OneLineFound = TRUE;
+            }
         }
     }
 
     YoriLibLineReadCloseOrCache(LineContext);
-    YoriLibFreeStringContents(&LineString);
 
     LinesContext->TotalLinesFound += LinesContext->FileLinesFound;
     return TRUE;
 }
 
+/**
+ The number of bytes to read from a file at a time when counting lines
+ without examining their contents.
+ */
+#define LINES_COUNT_BLOCK_SIZE (64 * 1024)
+
+/**
+ The maximum number of files which can be counted but not yet displayed.
+ Files are displayed in the order they were found, so if an early file is
+ slow to count, enumeration pauses once this many later files are waiting.
+ */
+#define LINES_MAX_PENDING_FILES (1024)
+
+/**
+ State carried from one block of a file to the next while counting line
+ endings.
+ */
+typedef struct _LINES_COUNT_STATE {
+
+    /**
+     The number of line endings found so far.  A carriage return, a line
+     feed, or a carriage return followed by a line feed each count as one.
+     */
+    YORI_MAX_UNSIGNED_T LineEndings;
+
+    /**
+     TRUE if the final character examined was a carriage return, so a line
+     feed at the beginning of the next block is part of the same line
+     ending.
+     */
+    BOOLEAN PreviousCharWasCr;
+
+    /**
+     TRUE if characters were found after the final line ending, meaning the
+     file ends with a line that has no line ending.
+     */
+    BOOLEAN PartialLine;
+} LINES_COUNT_STATE, *PLINES_COUNT_STATE;
+
+/**
+ A single file whose lines are being counted on a background thread.
+ */
+typedef struct _LINES_FILE_ITEM {
+
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The link within the list of files waiting to be displayed, in the order
+     they were found.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     Fully qualified path to the file.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The number of lines found in the file.
+     */
+    YORI_MAX_SIGNED_T LinesFound;
+
+    /**
+     ERROR_SUCCESS if the file was counted, or the error that prevented it
+     from being counted.
+     */
+    DWORD Error;
+
+    /**
+     Set to TRUE once the file has been counted or has failed.
+     */
+    volatile LONG Complete;
+} LINES_FILE_ITEM, *PLINES_FILE_ITEM;
+
+/**
+ Count the line endings within a block of data.  This examines a machine
+ word at a time, locating every carriage return and line feed within the
+ word at once, and accumulating counts for each character position which
+ are only summed periodically.
+
+ @param Buffer Pointer to the block of data.  This is expected to be
+        aligned to a machine word.
+
+ @param Length The number of bytes in the block.
+
+ @param CharSize The number of bytes per character, which is 2 for UTF16
+        input and 1 for all other encodings.
+
+ @param State Pointer to the state carried between blocks, which is updated
+        to include the line endings in this block.
+ */
+VOID
+LinesCountLineEndings(
+    __in PUCHAR Buffer,
+    __in DWORD Length,
+    __in DWORD CharSize,
+    __inout PLINES_COUNT_STATE State
+    )
+{
+    DWORD_PTR LowLanes;
+    DWORD_PTR HighLanes;
+    DWORD_PTR ValueLanes;
+    DWORD_PTR CrLanes;
+    DWORD_PTR LfLanes;
+    DWORD_PTR LaneMask;
+    DWORD_PTR Word;
+    DWORD_PTR Test;
+    DWORD_PTR CrFound;
+    DWORD_PTR LfFound;
+    DWORD_PTR PairFound;
+    DWORD_PTR Carry;
+    DWORD_PTR Accumulated;
+    DWORD LaneBits;
+    DWORD Shift;
+    DWORD Index;
+    DWORD WordsAccumulated;
+    DWORD Char;
+
+    if (Length < CharSize) {
+        return;
+    }
+
+    //
+    //  Construct constants containing a repeated character value in every
+    //  character of a machine word, so this works for 32 and 64 bit words
+    //  and for 8 and 16 bit characters.
+    //
+
+    LaneBits = CharSize * 8;
+    if (CharSize == 1) {
+        LowLanes = ((DWORD_PTR)-1) / 0xFF;
+    } else {
+        LowLanes = ((DWORD_PTR)-1) / 0xFFFF;
+    }
+    HighLanes = LowLanes << (LaneBits - 1);
+    ValueLanes = ~HighLanes;
+    CrLanes = LowLanes * 0x0D;
+    LfLanes = LowLanes * 0x0A;
+    LaneMask = (((DWORD_PTR)1) << LaneBits) - 1;
+
+    Carry = 0;
+    if (State->PreviousCharWasCr) {
+        Carry = ((DWORD_PTR)1) << (LaneBits - 1);
+    }
+
+    Accumulated = 0;
+    WordsAccumulated = 0;
+    Index = 0;
+
+    while (Index + sizeof(DWORD_PTR) <= Length) {
+        Word = *(DWORD_PTR *)&Buffer[Index];
+
+        //
+        //  XORing the word with a repeated CR or LF value produces a zero
+        //  character wherever that character is present.  Adding to the low
+        //  bits of each character sets its high bit unless the character is
+        //  zero, without carrying into the next character.
+        //
+
+        Test = Word ^ CrLanes;
+        CrFound = ~(((Test & ValueLanes) + ValueLanes) | Test) & HighLanes;
+        Test = Word ^ LfLanes;
+        LfFound = ~(((Test & ValueLanes) + ValueLanes) | Test) & HighLanes;
+
+        //
+        //  A line feed immediately following a carriage return is part of
+        //  the same line ending, including if the carriage return was the
+        //  final character of the previous word.
+        //
+
+        PairFound = ((CrFound << LaneBits) | Carry) & LfFound;
+        Carry = CrFound >> (sizeof(DWORD_PTR) * 8 - LaneBits);
+
+        //
+        //  Each character position can only count one line ending per word,
+        //  so positions can accumulate for 255 words before they need to be
+        //  summed.
+        //
+
+        Accumulated = Accumulated + (((CrFound | LfFound) ^ PairFound) >> (LaneBits - 1));
+        WordsAccumulated++;
+        if (WordsAccumulated == 0xFF) {
+            for (Shift = 0; Shift < sizeof(DWORD_PTR) * 8; Shift = Shift + LaneBits) {
+                State->LineEndings = State->LineEndings + ((Accumulated >> Shift) & LaneMask);
+            }
+            Accumulated = 0;
+            WordsAccumulated = 0;
+        }
+
+        Index = Index + sizeof(DWORD_PTR);
+    }
+
+    for (Shift = 0; Shift < sizeof(DWORD_PTR) * 8; Shift = Shift + LaneBits) {
+        State->LineEndings = State->LineEndings + ((Accumulated >> Shift) & LaneMask);
+    }
+
+    State->PreviousCharWasCr = (BOOLEAN)(Carry != 0);
+
+    //
+    //  Check any characters following the final complete word.
+    //
+
+    while (Index + CharSize <= Length) {
+        if (CharSize == 1) {
+            Char = Buffer[Index];
+        } else {
+            Char = *(PWORD)&Buffer[Index];
+        }
+
+        if (Char == 0x0D) {
+            State->LineEndings++;
+            State->PreviousCharWasCr = TRUE;
+        } else {
+            if (Char == 0x0A && !State->PreviousCharWasCr) {
+                State->LineEndings++;
+            }
+            State->PreviousCharWasCr = FALSE;
+        }
+
+        Index = Index + CharSize;
+    }
+
+    //
+    //  Record whether the block ends partway through a line.  Only the
+    //  final block of the file determines whether there is a final line
+    //  without a line ending.
+    //
+
+    Index = (Length / CharSize - 1) * CharSize;
+    if (CharSize == 1) {
+        Char = Buffer[Index];
+    } else {
+        Char = *(PWORD)&Buffer[Index];
+    }
+
+    if (Char == 0x0D || Char == 0x0A) {
+        State->PartialLine = FALSE;
+    } else {
+        State->PartialLine = TRUE;
+    }
+}
+
+/**
+ Count the lines in a file by counting line endings in blocks read from the
+ file, without converting or examining the lines themselves.  This counts
+ lines the same way as the line reader, where the final line does not need
+ a line ending.
+
+ @param FilePath Pointer to the fully qualified path to the file.
+
+ @param Buffer Pointer to a buffer of LINES_COUNT_BLOCK_SIZE bytes to read
+        into.
+
+ @param LinesFound On successful completion, updated to contain the number
+        of lines in the file.
+
+ @return ERROR_SUCCESS to indicate success, or a Win32 error code to
+         indicate failure.
+ */
+DWORD
+LinesCountFile(
+    __in PYORI_STRING FilePath,
+    __in PUCHAR Buffer,
+    __out PYORI_MAX_SIGNED_T LinesFound
+    )
+{
+    HANDLE FileHandle;
+    LINES_COUNT_STATE State;
+    DWORD BytesRead;
+    DWORD CharSize;
+    DWORD Encoding;
+    DWORD Error;
+    BOOLEAN FirstBlock;
+
+    *LinesFound = 0;
+
+    FileHandle = CreateFile(FilePath->StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        return GetLastError();
+    }
+
+    Encoding = YoriLibGetMultibyteInputEncoding();
+    CharSize = 1;
+    if (Encoding == CP_UTF16) {
+        CharSize = 2;
+    }
+
+    ZeroMemory(&State, sizeof(State));
+    Error = ERROR_SUCCESS;
+    FirstBlock = TRUE;
+
+    while (TRUE) {
+        if (!ReadFile(FileHandle, Buffer, LINES_COUNT_BLOCK_SIZE, &BytesRead, NULL)) {
+            Error = GetLastError();
+            break;
+        }
+
+        if (BytesRead == 0) {
+            break;
+        }
+
+        //
+        //  A byte order mark contains no line endings, but a file
+        //  containing only a byte order mark contains no lines.
+        //
+
+        if (FirstBlock) {
+            FirstBlock = FALSE;
+            if (Encoding == CP_UTF8 &&
+                BytesRead == 3 &&
+                Buffer[0] == 0xEF &&
+                Buffer[1] == 0xBB &&
+                Buffer[2] == 0xBF) {
+
+                continue;
+            }
+
+            if (Encoding == CP_UTF16 &&
+                BytesRead == 2 &&
+                Buffer[0] == 0xFF &&
+                Buffer[1] == 0xFE) {
+
+                continue;
+            }
+        }
+
+        LinesCountLineEndings(Buffer, BytesRead, CharSize, &State);
+    }
+
+    CloseHandle(FileHandle);
+
+    *LinesFound = (YORI_MAX_SIGNED_T)State.LineEndings;
+    if (State.PartialLine) {
+        (*LinesFound)++;
+    }
+
+    return Error;
+}
+
+/**
+ Display the line count for a single file.
+
+ @param LinesContext Pointer to the context containing the line count
+        information for the file.
+
+ @param FilePath Pointer to the fully qualified path to the file.
+ */
+VOID
+LinesOutputFileResult(
+    __in PLINES_CONTEXT LinesContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    YORI_STRING StringFormOfLineCount;
+    YORI_STRING UnescapedFilePath;
+    TCHAR StackBuffer[16];
+
+    YoriLibInitEmptyString(&StringFormOfLineCount);
+    StringFormOfLineCount.StartOfString = StackBuffer;
+    StringFormOfLineCount.LengthAllocated = sizeof(StackBuffer)/sizeof(StackBuffer[0]);
+    YoriLibNumberToString(&StringFormOfLineCount, LinesContext->FileLinesFound, 10, 3, ',');
+    YoriLibInitEmptyString(&UnescapedFilePath);
+    YoriLibUnescapePath(FilePath, &UnescapedFilePath);
+    if (LinesContext->DisplayLengthStats == FALSE) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%16y %y\n"), &StringFormOfLineCount, &UnescapedFilePath);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%16y %6lli %6lli %6lli %y\n"),
+                      &StringFormOfLineCount,
+                      LinesContext->FileShortestLine,
+                      LinesContext->FileTotalChars / LinesContext->FileLinesFound,
+                      LinesContext->FileLongestLine,
+                      &UnescapedFilePath);
+    }
+    YoriLibFreeStringContents(&StringFormOfLineCount);
+    YoriLibFreeStringContents(&UnescapedFilePath);
+}
+
+/**
+ Record the line count for a file that was counted without examining line
+ lengths, and display it if requested.
+
+ @param LinesContext Pointer to the context to record line count
+        information.
+
+ @param FilePath Pointer to the fully qualified path to the file.
+
+ @param LinesFound The number of lines in the file.
+
+ @param Error ERROR_SUCCESS if the file was counted, or the error that
+        prevented it from being counted.
+ */
+VOID
+LinesRecordFileResult(
+    __in PLINES_CONTEXT LinesContext,
+    __in PYORI_STRING FilePath,
+    __in YORI_MAX_SIGNED_T LinesFound,
+    __in DWORD Error
+    )
+{
+    LPTSTR ErrText;
+
+    if (Error != ERROR_SUCCESS) {
+        ErrText = YoriLibGetWinErrorText(Error);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("lines: read of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return;
+    }
+
+    LinesContext->FilesFound++;
+    LinesContext->FileLinesFound = LinesFound;
+    LinesContext->TotalLinesFound += LinesFound;
+
+    if (!LinesContext->SummaryOnly) {
+        LinesOutputFileResult(LinesContext, FilePath);
+    }
+}
+
+/**
+ Count the lines in a single file on a background thread.
+
+ @param Context Pointer to the lines context.
+
+ @param Item Pointer to the work item within the file item.  The file item
+        remains on the list of files waiting to be displayed, and is
+        deallocated once it has been displayed.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be counted.
+ */
+VOID
+LinesWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PLINES_CONTEXT LinesContext = (PLINES_CONTEXT)Context;
+    PLINES_FILE_ITEM FileItem;
+    PUCHAR Buffer;
+
+    FileItem = CONTAINING_RECORD(Item, LINES_FILE_ITEM, WorkItem);
+
+    if (Cancelled) {
+        FileItem->Error = ERROR_CANCELLED;
+    } else {
+        Buffer = YoriLibMalloc(LINES_COUNT_BLOCK_SIZE);
+        if (Buffer == NULL) {
+            FileItem->Error = ERROR_NOT_ENOUGH_MEMORY;
+        } else {
+            FileItem->Error = LinesCountFile(&FileItem->FilePath, Buffer, &FileItem->LinesFound);
+            YoriLibFree(Buffer);
+        }
+    }
+
+    InterlockedExchange(&FileItem->Complete, TRUE);
+    SetEvent(LinesContext->FileCompleteEvent);
+}
+
+/**
+ Display files that have been counted on background threads, in the order
+ they were found.
+
+ @param LinesContext Pointer to the lines context.
+
+ @param MaximumPending The number of files which can remain waiting to be
+        displayed.  If more files than this are waiting, this function waits
+        for earlier files to be counted.  If zero, this function waits for
+        all files.
+ */
+VOID
+LinesDisplayCompletedFiles(
+    __in PLINES_CONTEXT LinesContext,
+    __in YORI_ALLOC_SIZE_T MaximumPending
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PLINES_FILE_ITEM FileItem;
+
+    while (TRUE) {
+        ListEntry = YoriLibGetNextListEntry(&LinesContext->PendingFiles, NULL);
+        if (ListEntry == NULL) {
+            break;
+        }
+
+        FileItem = CONTAINING_RECORD(ListEntry, LINES_FILE_ITEM, PendingList);
+        if (!FileItem->Complete) {
+            if (LinesContext->PendingFileCount <= MaximumPending) {
+                break;
+            }
+            WaitForSingleObject(LinesContext->FileCompleteEvent, INFINITE);
+            continue;
+        }
+
+        YoriLibRemoveListItem(&FileItem->PendingList);
+        LinesContext->PendingFileCount--;
+
+        if (FileItem->Error != ERROR_CANCELLED) {
+            LinesRecordFileResult(LinesContext, &FileItem->FilePath, FileItem->LinesFound, FileItem->Error);
+        }
+
+        YoriLibFreeStringContents(&FileItem->FilePath);
+        YoriLibFree(FileItem);
+    }
+}
+
+/**
+ Attempt to count the lines in a file on a background thread.
+
+ @param LinesContext Pointer to the lines context.
+
+ @param FilePath Pointer to the fully qualified file path.
+
+ @return TRUE if the file was queued for a background thread, FALSE if it
+         was not and should be counted by the caller.
+ */
+BOOL
+LinesQueueFile(
+    __in PLINES_CONTEXT LinesContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PLINES_FILE_ITEM FileItem;
+
+    FileItem = YoriLibMalloc(sizeof(LINES_FILE_ITEM));
+    if (FileItem == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(FileItem, sizeof(LINES_FILE_ITEM));
+
+    //
+    //  The file name is a buffer owned by the enumerator which will be
+    //  reused for the next file, so it needs to be copied.
+    //
+
+    if (!YoriLibCopyString(&FileItem->FilePath, FilePath)) {
+        YoriLibFree(FileItem);
+        return FALSE;
+    }
+
+    YoriLibAppendList(&LinesContext->PendingFiles, &FileItem->PendingList);
+    LinesContext->PendingFileCount++;
+
+    if (!YoriLibQueueWorkItem(&LinesContext->WorkQueue, &FileItem->WorkItem, TRUE)) {
+        YoriLibRemoveListItem(&FileItem->PendingList);
+        LinesContext->PendingFileCount--;
+        YoriLibFreeStringContents(&FileItem->FilePath);
+        YoriLibFree(FileItem);
+        return FALSE;
+    }
+
+    LinesDisplayCompletedFiles(LinesContext, LINES_MAX_PENDING_FILES);
+    return TRUE;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -212,6 +831,50 @@ LinesFileFoundCallback(
     if (FileInfo == NULL ||
         (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
 
+        //
+        //  If line lengths aren't needed, count line endings directly from
+        //  the file, on a background thread if possible.
+        //
+
+        if (!LinesContext->DisplayLengthStats) {
+            YORI_MAX_SIGNED_T LinesFound;
+            DWORD Error;
+
+            if (LinesContext->ThreadCount != 1) {
+                if (FileInfo != NULL) {
+                    if (LinesQueueFile(LinesContext, FilePath)) {
+                        LinesContext->SavedErrorThisArg = ERROR_SUCCESS;
+                        LinesContext->FilesFoundThisArg++;
+                        return TRUE;
+                    }
+                    if (LinesContext->WorkQueue.Cancelled) {
+                        return FALSE;
+                    }
+                }
+
+                //
+                //  Files counted on this thread must be displayed after
+                //  files that have already been queued.
+                //
+
+                LinesDisplayCompletedFiles(LinesContext, 0);
+            }
+
+            Error = LinesCountFile(FilePath, LinesContext->CountBuffer, &LinesFound);
+            if (Error != ERROR_SUCCESS &&
+                LinesContext->SavedErrorThisArg != ERROR_SUCCESS) {
+
+                return TRUE;
+            }
+
+            if (Error == ERROR_SUCCESS) {
+                LinesContext->SavedErrorThisArg = ERROR_SUCCESS;
+                LinesContext->FilesFoundThisArg++;
+            }
+            LinesRecordFileResult(LinesContext, FilePath, LinesFound, Error);
+            return TRUE;
+        }
+
         FileHandle = CreateFile(FilePath->StartOfString,
                                 GENERIC_READ,
                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
@@ -234,29 +897,7 @@ LinesFileFoundCallback(
         LinesProcessStream(FileHandle, LinesContext);
 
         if (!LinesContext->SummaryOnly) {
-            YORI_STRING StringFormOfLineCount;
-            YORI_STRING UnescapedFilePath;
-            TCHAR StackBuffer[16];
-
-            YoriLibInitEmptyString(&StringFormOfLineCount);
-            StringFormOfLineCount.StartOfString = StackBuffer;
-            StringFormOfLineCount.LengthAllocated = sizeof(StackBuffer)/sizeof(StackBuffer[0]);
-            YoriLibNumberToString(&StringFormOfLineCount, LinesContext->FileLinesFound, 10, 3, ',');
-            YoriLibInitEmptyString(&UnescapedFilePath);
-            YoriLibUnescapePath(FilePath, &UnescapedFilePath);
-            if (LinesContext->DisplayLengthStats == FALSE) {
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%16y %y\n"), &StringFormOfLineCount, &UnescapedFilePath);
-            } else {
-                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
-                              _T("%16y %6lli %6lli %6lli %y\n"),
-                              &StringFormOfLineCount,
-                              LinesContext->FileShortestLine,
-                              LinesContext->FileTotalChars / LinesContext->FileLinesFound,
-                              LinesContext->FileLongestLine,
-                              &UnescapedFilePath);
-            }
-            YoriLibFreeStringContents(&StringFormOfLineCount);
-            YoriLibFreeStringContents(&UnescapedFilePath);
+            LinesOutputFileResult(LinesContext, FilePath);
         }
 
         CloseHandle(FileHandle);
@@ -361,8 +1002,11 @@ ENTRYPOINT(
     BOOLEAN BasicEnumeration = FALSE;
     LINES_CONTEXT LinesContext;
     YORI_STRING Arg;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     ZeroMemory(&LinesContext, sizeof(LinesContext));
+    YoriLibInitializeListHead(&LinesContext.PendingFiles);
 
     for (i = 1; i < ArgC; i++) {
 
@@ -380,12 +1024,23 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        LinesContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 LinesContext.DisplayLengthStats = TRUE;
                 ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 LinesContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("stats")) == 0) {
+                YoriLibEnableStatistics();
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("t")) == 0) {
                 LinesContext.SummaryOnly = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -439,6 +1094,34 @@ ENTRYPOINT(
             MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
         }
 
+        //
+        //  Line length statistics require the line reader, which is used on
+        //  the enumerating thread.  Otherwise allocate a buffer for counting
+        //  on this thread, which is used if files can't be queued, and
+        //  start the queue.
+        //
+
+        if (LinesContext.DisplayLengthStats) {
+            LinesContext.ThreadCount = 1;
+        } else {
+            LinesContext.CountBuffer = YoriLibMalloc(LINES_COUNT_BLOCK_SIZE);
+            if (LinesContext.CountBuffer == NULL) {
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (LinesContext.ThreadCount != 1) {
+            LinesContext.FileCompleteEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+            if (LinesContext.FileCompleteEvent == NULL) {
+                LinesContext.ThreadCount = 1;
+            } else if (!YoriLibInitializeWorkQueue(&LinesContext.WorkQueue, (YORI_ALLOC_SIZE_T)LinesContext.ThreadCount, 0, LinesWorkItem, &LinesContext)) {
+                YoriLibCleanupWorkQueue(&LinesContext.WorkQueue);
+                CloseHandle(LinesContext.FileCompleteEvent);
+                LinesContext.FileCompleteEvent = NULL;
+                LinesContext.ThreadCount = 1;
+            }
+        }
+
         for (i = StartArg; i < ArgC; i++) {
 
             LinesContext.FilesFoundThisArg = 0;
@@ -463,6 +1146,17 @@ ENTRYPOINT(
                 }
             }
         }
+
+        if (LinesContext.ThreadCount != 1) {
+            YoriLibWaitForWorkQueue(&LinesContext.WorkQueue);
+            LinesDisplayCompletedFiles(&LinesContext, 0);
+            YoriLibCleanupWorkQueue(&LinesContext.WorkQueue);
+            CloseHandle(LinesContext.FileCompleteEvent);
+        }
+
+        if (LinesContext.CountBuffer != NULL) {
+            YoriLibFree(LinesContext.CountBuffer);
+        }
     }
 
 #if !YORI_BUILTIN
@@ -54,6 +54,25 @@ LsofHelp(VOID)
     return TRUE;
 }
 
+/**
+ The name of a process that has been resolved previously, so that processes
+ which have many files open are only queried once.
+ */
+typedef struct _LSOF_PROCESS_NAME {
+
+    /**
+     The process identifier.
+     */
+    DWORD_PTR ProcessId;
+
+    /**
+     The full path to the process image, or an empty string if it could not
+     be determined.
+     */
+    YORI_STRING ProcessName;
+
+} LSOF_PROCESS_NAME, *PLSOF_PROCESS_NAME;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -76,8 +95,127 @@ typedef struct _LSOF_CONTEXT {
      */
     PFILE_PROCESS_IDS_USING_FILE_INFORMATION Buffer;
 
+    /**
+     An array of process names that have been resolved previously.
+     */
+    PLSOF_PROCESS_NAME ProcessNames;
+
+    /**
+     The number of elements in ProcessNames that are populated.
+     */
+    YORI_ALLOC_SIZE_T ProcessNameCount;
+
+    /**
+     The number of elements allocated in ProcessNames.
+     */
+    YORI_ALLOC_SIZE_T ProcessNamesAllocated;
+
 } LSOF_CONTEXT, *PLSOF_CONTEXT;
 
+/**
+ Find the image name of a process, using a previously resolved name if the
+ process has been seen before.
+
+ @param LsofContext Pointer to the lsof context containing previously
+        resolved names.
+
+ @param ProcessId The process identifier.
+
+ @return Pointer to the process name.  This may be an empty string if the
+         name could not be determined.  This string is owned by the
+         context.
+ */
+PYORI_STRING
+LsofGetProcessName(
+    __in PLSOF_CONTEXT LsofContext,
+    __in DWORD_PTR ProcessId
+    )
+{
+    HANDLE ProcessHandle;
+    DWORD ProcessNameSize;
+    YORI_ALLOC_SIZE_T Index;
+    PLSOF_PROCESS_NAME Entry;
+    static YORI_STRING EmptyName;
+
+    for (Index = 0; Index < LsofContext->ProcessNameCount; Index++) {
+        if (LsofContext->ProcessNames[Index].ProcessId == ProcessId) {
+            return &LsofContext->ProcessNames[Index].ProcessName;
+        }
+    }
+
+    if (LsofContext->ProcessNameCount >= LsofContext->ProcessNamesAllocated) {
+        PLSOF_PROCESS_NAME NewProcessNames;
+        YORI_ALLOC_SIZE_T NewAllocated;
+
+        NewAllocated = LsofContext->ProcessNamesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 32;
+        }
+
+        if (!YoriLibIsSizeAllocatable(NewAllocated * sizeof(LSOF_PROCESS_NAME))) {
+            YoriLibInitEmptyString(&EmptyName);
+            return &EmptyName;
+        }
+
+        NewProcessNames = YoriLibMalloc(NewAllocated * sizeof(LSOF_PROCESS_NAME));
+        if (NewProcessNames == NULL) {
+            YoriLibInitEmptyString(&EmptyName);
+            return &EmptyName;
+        }
+
+        if (LsofContext->ProcessNames != NULL) {
+            memcpy(NewProcessNames, LsofContext->ProcessNames, LsofContext->ProcessNameCount * sizeof(LSOF_PROCESS_NAME));
+            YoriLibFree(LsofContext->ProcessNames);
+        }
+
+        LsofContext->ProcessNames = NewProcessNames;
+        LsofContext->ProcessNamesAllocated = NewAllocated;
+    }
+
+    Entry = &LsofContext->ProcessNames[LsofContext->ProcessNameCount];
+    Entry->ProcessId = ProcessId;
+    YoriLibInitEmptyString(&Entry->ProcessName);
+    LsofContext->ProcessNameCount++;
+
+    ProcessHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)ProcessId);
+    if (ProcessHandle != NULL) {
+        if (YoriLibAllocateString(&Entry->ProcessName, 300)) {
+            ProcessNameSize = Entry->ProcessName.LengthAllocated;
+            if (DllKernel32.pQueryFullProcessImageNameW(ProcessHandle, 0, Entry->ProcessName.StartOfString, &ProcessNameSize)) {
+                Entry->ProcessName.LengthInChars = (YORI_ALLOC_SIZE_T)ProcessNameSize;
+            }
+        }
+        CloseHandle(ProcessHandle);
+    }
+
+    return &Entry->ProcessName;
+}
+
+/**
+ Free any process names that were resolved while processing files.
+
+ @param LsofContext Pointer to the lsof context.
+ */
+VOID
+LsofFreeProcessNames(
+    __in PLSOF_CONTEXT LsofContext
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = 0; Index < LsofContext->ProcessNameCount; Index++) {
+        YoriLibFreeStringContents(&LsofContext->ProcessNames[Index].ProcessName);
+    }
+
+    if (LsofContext->ProcessNames != NULL) {
+        YoriLibFree(LsofContext->ProcessNames);
+        LsofContext->ProcessNames = NULL;
+    }
+
+    LsofContext->ProcessNameCount = 0;
+    LsofContext->ProcessNamesAllocated = 0;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -137,20 +275,35 @@ LsofFileFoundCallback(
         return TRUE;
     }
 
-    Status = DllNtDll.pNtQueryInformationFile(FileHandle, &IoStatus, LsofContext->Buffer, LsofContext->BufferLength, FileProcessIdsUsingFileInformation);
+    do {
+        Status = DllNtDll.pNtQueryInformationFile(FileHandle, &IoStatus, LsofContext->Buffer, LsofContext->BufferLength, FileProcessIdsUsingFileInformation);
+
+        //
+        //  If many processes have the file open, the buffer may not be large
+        //  enough.  Grow it and try again.
+        //
+
+        if (Status == STATUS_INFO_LENGTH_MISMATCH &&
+            LsofContext->BufferLength < 1024 * 1024 &&
+            YoriLibIsSizeAllocatable(LsofContext->BufferLength * 4)) {
+
+            PFILE_PROCESS_IDS_USING_FILE_INFORMATION NewBuffer;
+
+            NewBuffer = YoriLibMalloc(LsofContext->BufferLength * 4);
+            if (NewBuffer == NULL) {
+                break;
+            }
+            YoriLibFree(LsofContext->Buffer);
+            LsofContext->Buffer = NewBuffer;
+            LsofContext->BufferLength = LsofContext->BufferLength * 4;
+            continue;
+        }
+        break;
+    } while(TRUE);
+
     if (Status == 0) {
         for (Index = 0; Index < LsofContext->Buffer->NumberOfProcesses; Index++) {
-            HANDLE ProcessHandle;
-            TCHAR ProcessName[300];
-            DWORD ProcessNameSize;
-
-            ProcessName[0] = '\0';
-            ProcessNameSize = sizeof(ProcessName)/sizeof(ProcessName[0]);
-            ProcessHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)LsofContext->Buffer->ProcessIds[Index]);
-            if (ProcessHandle != NULL) {
-                DllKernel32.pQueryFullProcessImageNameW(ProcessHandle, 0, ProcessName, &ProcessNameSize);
-            }
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%10i %s\n"), LsofContext->Buffer->ProcessIds[Index], ProcessName);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%10i %y\n"), LsofContext->Buffer->ProcessIds[Index], LsofGetProcessName(LsofContext, LsofContext->Buffer->ProcessIds[Index]));
         }
     } else {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("lsof: query of %y failed: %08x"), FilePath, Status);
@@ -160,6 +313,24 @@ LsofFileFoundCallback(
     return TRUE;
 }
 
+/**
+ Values recorded for each object type index to indicate whether handles of
+ that type refer to files.  Unknown types are determined by querying a
+ handle of that type.
+ */
+typedef enum _LSOF_OBJECT_TYPE_STATE {
+    LsofObjectTypeUnknown = 0,
+    LsofObjectTypeFile = 1,
+    LsofObjectTypeNotFile = 2
+} LSOF_OBJECT_TYPE_STATE;
+
+/**
+ The number of object type indexes whose state is remembered.  Systems
+ typically have far fewer object types than this; any handles with a type
+ index beyond this are queried individually.
+ */
+#define LSOF_OBJECT_TYPE_STATE_COUNT (256)
+
 /**
  Display information about handles opened for all processes.
 
@@ -182,9 +353,12 @@ LsofDumpHandles(VOID)
     DWORD LengthReturned;
     HANDLE ProcessHandle;
     DWORD LastPid;
+    BOOLEAN IsFile;
+    UCHAR ObjectTypeState[LSOF_OBJECT_TYPE_STATE_COUNT];
 
     ProcessHandle = INVALID_HANDLE_VALUE;
     LastPid = 0;
+    ZeroMemory(ObjectTypeState, sizeof(ObjectTypeState));
 
     YoriLibLoadPsapiFunctions();
 
@@ -259,6 +433,17 @@ LsofDumpHandles(VOID)
             }
         }
 
+        //
+        //  If the type of this handle is already known not to be a file,
+        //  there's no need to duplicate it.
+        //
+
+        if (ThisHandle->ObjectType < LSOF_OBJECT_TYPE_STATE_COUNT &&
+            ObjectTypeState[ThisHandle->ObjectType] == LsofObjectTypeNotFile) {
+
+            continue;
+        }
+
         if (ProcessHandle != NULL) {
 
             ObjectName->Name.LengthInBytes = 0;
@@ -270,26 +455,40 @@ LsofDumpHandles(VOID)
             //
 
             LocalProcessHandle = INVALID_HANDLE_VALUE;
-            if (DuplicateHandle(ProcessHandle, (HANDLE)ThisHandle->HandleValue, GetCurrentProcess(), &LocalProcessHandle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
-                DllNtDll.pNtQueryObject(LocalProcessHandle, 1, ObjectName, ObjectNameLength, &LengthReturned);
-                DllNtDll.pNtQueryObject(LocalProcessHandle, 2, ObjectType, ObjectTypeLength, &LengthReturned);
-            } else {
-                LocalProcessHandle = INVALID_HANDLE_VALUE;
+            if (!DuplicateHandle(ProcessHandle, (HANDLE)ThisHandle->HandleValue, GetCurrentProcess(), &LocalProcessHandle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+                continue;
             }
 
             //
-            //  Convert any output into strings for display
+            //  Determine the type of the handle if it's not known already,
+            //  and remember it for later handles of the same type.
             //
 
-            YoriLibInitEmptyString(&ObjectNameString);
-            if (ObjectName->Name.LengthInBytes > 0) {
-                ObjectNameString.LengthInChars = ObjectName->Name.LengthInBytes / sizeof(WCHAR);
-                ObjectNameString.StartOfString = ObjectName->Name.Buffer;
-            }
-            YoriLibInitEmptyString(&ObjectTypeString);
-            if (ObjectType->TypeName.LengthInBytes > 0) {
-                ObjectTypeString.LengthInChars = ObjectType->TypeName.LengthInBytes / sizeof(WCHAR);
-                ObjectTypeString.StartOfString = ObjectType->TypeName.Buffer;
+            IsFile = FALSE;
+            if (ThisHandle->ObjectType < LSOF_OBJECT_TYPE_STATE_COUNT &&
+                ObjectTypeState[ThisHandle->ObjectType] == LsofObjectTypeFile) {
+
+                IsFile = TRUE;
+            } else {
+                DllNtDll.pNtQueryObject(LocalProcessHandle, 2, ObjectType, ObjectTypeLength, &LengthReturned);
+
+                YoriLibInitEmptyString(&ObjectTypeString);
+                if (ObjectType->TypeName.LengthInBytes > 0) {
+                    ObjectTypeString.LengthInChars = ObjectType->TypeName.LengthInBytes / sizeof(WCHAR);
+                    ObjectTypeString.StartOfString = ObjectType->TypeName.Buffer;
+
+                    if (YoriLibCompareStringWithLiteralInsensitive(&ObjectTypeString, _T("File")) == 0) {
+                        IsFile = TRUE;
+                    }
+
+                    if (ThisHandle->ObjectType < LSOF_OBJECT_TYPE_STATE_COUNT) {
+                        if (IsFile) {
+                            ObjectTypeState[ThisHandle->ObjectType] = LsofObjectTypeFile;
+                        } else {
+                            ObjectTypeState[ThisHandle->ObjectType] = LsofObjectTypeNotFile;
+                        }
+                    }
+                }
             }
 
             //
@@ -297,15 +496,15 @@ LsofDumpHandles(VOID)
             //  program.
             //
 
-            if (YoriLibCompareStringWithLiteralInsensitive(&ObjectTypeString, _T("File")) == 0) {
+            if (IsFile) {
 
                 PYORI_STRING NameToDisplay;
 
-                NameToDisplay = &ObjectNameString;
+                NameToDisplay = NULL;
 
                 //
                 //  If it's possible to get a Win32 path name, display that.
-                //  Otherwise, use what we have.
+                //  Otherwise, use the native object name.
                 //
 
                 ModuleNameString.LengthInChars = 0;
@@ -323,16 +522,31 @@ LsofDumpHandles(VOID)
                     }
                 }
 
+                if (NameToDisplay == NULL) {
+                    DllNtDll.pNtQueryObject(LocalProcessHandle, 1, ObjectName, ObjectNameLength, &LengthReturned);
+
+                    YoriLibInitEmptyString(&ObjectNameString);
+                    if (ObjectName->Name.LengthInBytes > 0) {
+                        ObjectNameString.LengthInChars = ObjectName->Name.LengthInBytes / sizeof(WCHAR);
+                        ObjectNameString.StartOfString = ObjectName->Name.Buffer;
+                    }
+                    NameToDisplay = &ObjectNameString;
+                }
+
 
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Handle %lli Object %p  %y\n"), ThisHandle->HandleValue, ThisHandle->Object, NameToDisplay);
             }
 
-            if (LocalProcessHandle != INVALID_HANDLE_VALUE) {
-                CloseHandle(LocalProcessHandle);
-            }
+            CloseHandle(LocalProcessHandle);
         }
     }
 
+    if (ProcessHandle != INVALID_HANDLE_VALUE &&
+        ProcessHandle != NULL) {
+
+        CloseHandle(ProcessHandle);
+    }
+
     YoriLibFreeStringContents(&ModuleNameString);
     YoriLibFree(ObjectType);
     YoriLibFree(ObjectName);
@@ -468,6 +682,7 @@ ENTRYPOINT(
         }
 
         YoriLibFree(LsofContext.Buffer);
+        LsofFreeProcessNames(&LsofContext);
     }
 
     return EXIT_SUCCESS;
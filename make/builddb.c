@@ -0,0 +1,1039 @@
+/**
+ * @file make/builddb.c
+ *
+ * Yori shell make persistent build state for fast no-op builds
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ The version of the build state file format.  If the format changes, this
+ should be incremented so that older files are ignored.
+ */
+#define MAKE_BUILDDB_VERSION (1)
+
+/**
+ A single file whose state was observed when evaluating the build.
+ */
+typedef struct _MAKE_BUILDDB_FILE {
+
+    /**
+     The hash entry.  Key is the file name component, without any path.
+     Paired with MAKE_BUILDDB_DIRECTORY::Files .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all files within a directory, used to facilitate bulk
+     delete.  Paired with MAKE_BUILDDB_DIRECTORY::FileList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The last write time of the file.  This is zero for directories.  This
+     is only meaningful if Exists is TRUE.
+     */
+    LARGE_INTEGER ModifiedTime;
+
+    /**
+     TRUE if the file existed when it was observed.
+     */
+    BOOLEAN Exists;
+
+    /**
+     TRUE if the file has been found when validating a directory.
+     */
+    BOOLEAN Found;
+
+} MAKE_BUILDDB_FILE, *PMAKE_BUILDDB_FILE;
+
+/**
+ A single directory containing files whose state was observed when
+ evaluating the build.
+ */
+typedef struct _MAKE_BUILDDB_DIRECTORY {
+
+    /**
+     The hash entry.  Key is the fully qualified directory name.  Paired with
+     MAKE_BUILDDB::Directories .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all directories, used to facilitate bulk delete.  Paired
+     with MAKE_BUILDDB::DirectoryList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A hash table of files within this directory, indexed by file name.
+     */
+    PYORI_HASH_TABLE Files;
+
+    /**
+     A list of files within this directory.  Paired with
+     MAKE_BUILDDB_FILE::ListEntry .
+     */
+    YORI_LIST_ENTRY FileList;
+
+    /**
+     The last write time of the directory.  This changes when any file is
+     created, deleted or renamed within it, which indicates that inference
+     rules may resolve differently.
+     */
+    LARGE_INTEGER ModifiedTime;
+
+} MAKE_BUILDDB_DIRECTORY, *PMAKE_BUILDDB_DIRECTORY;
+
+/**
+ The set of files and directories that determined the result of a build.
+ */
+typedef struct _MAKE_BUILDDB {
+
+    /**
+     A hash table of directories, indexed by fully qualified name.
+     */
+    PYORI_HASH_TABLE Directories;
+
+    /**
+     A list of directories.  Paired with MAKE_BUILDDB_DIRECTORY::ListEntry .
+     */
+    YORI_LIST_ENTRY DirectoryList;
+
+} MAKE_BUILDDB, *PMAKE_BUILDDB;
+
+/**
+ Record the state of a file that was used to determine what to build.  This
+ is used to determine whether the build graph from a previous build is
+ still valid.
+
+ @param MakeContext Pointer to the context.
+
+ @param FileName Pointer to the fully qualified file name.
+
+ @param ModifiedTime The last write time of the file.
+ */
+VOID
+MakeBuildDbRecordInputTime(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName,
+    __in LARGE_INTEGER ModifiedTime
+    )
+{
+    PMAKE_BUILDDB_INPUT Input;
+
+    if (MakeContext->BuildDbInputs == NULL) {
+        return;
+    }
+
+    if (YoriLibHashLookupByKey(MakeContext->BuildDbInputs, FileName) != NULL) {
+        return;
+    }
+
+    Input = YoriLibMalloc(sizeof(MAKE_BUILDDB_INPUT));
+    if (Input == NULL) {
+        MakeContext->BuildDbIncomplete = TRUE;
+        return;
+    }
+
+    Input->ModifiedTime.QuadPart = ModifiedTime.QuadPart;
+
+    YoriLibHashInsertByKey(MakeContext->BuildDbInputs, FileName, Input, &Input->HashEntry);
+    YoriLibAppendList(&MakeContext->BuildDbInputList, &Input->ListEntry);
+}
+
+/**
+ Record that a file has been read in order to construct the build graph.
+ This is used to determine whether the build graph from a previous build is
+ still valid.
+
+ @param MakeContext Pointer to the context.
+
+ @param FileName Pointer to the fully qualified file name.
+
+ @param hFile Handle to the opened file.
+ */
+VOID
+MakeBuildDbRecordInput(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName,
+    __in HANDLE hFile
+    )
+{
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    LARGE_INTEGER ModifiedTime;
+
+    if (MakeContext->BuildDbInputs == NULL) {
+        return;
+    }
+
+    if (GetFileInformationByHandle(hFile, &FileInfo)) {
+        ModifiedTime.LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
+        ModifiedTime.HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
+    } else {
+        MakeContext->BuildDbIncomplete = TRUE;
+        ModifiedTime.QuadPart = 0;
+    }
+
+    MakeBuildDbRecordInputTime(MakeContext, FileName, ModifiedTime);
+}
+
+/**
+ Free all recorded inputs.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeDeleteAllBuildDbInputs(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_BUILDDB_INPUT Input;
+
+    if (MakeContext->BuildDbInputs == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbInputList, NULL);
+    while (ListEntry != NULL) {
+        Input = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_INPUT, ListEntry);
+        YoriLibRemoveListItem(&Input->ListEntry);
+        YoriLibHashRemoveByEntry(&Input->HashEntry);
+        YoriLibFree(Input);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbInputList, NULL);
+    }
+
+    YoriLibFreeEmptyHashTable(MakeContext->BuildDbInputs);
+    MakeContext->BuildDbInputs = NULL;
+}
+
+/**
+ Split a fully qualified path into its directory and file name components.
+
+ @param Path Pointer to the fully qualified path.
+
+ @param DirectoryName On successful completion, updated to point to the
+        directory component of the path.  This is not NULL terminated.
+
+ @param FileName On successful completion, updated to point to the file
+        name component of the path.
+
+ @return TRUE to indicate the path was split, FALSE if it does not refer to
+         an object within a directory.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbSplitPath(
+    __in PYORI_STRING Path,
+    __out PYORI_STRING DirectoryName,
+    __out PYORI_STRING FileName
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriLibInitEmptyString(DirectoryName);
+    YoriLibInitEmptyString(FileName);
+
+    for (Index = Path->LengthInChars; Index > 0; Index--) {
+        if (Path->StartOfString[Index - 1] == '\\') {
+            break;
+        }
+    }
+
+    if (Index <= 1 || Index == Path->LengthInChars) {
+        return FALSE;
+    }
+
+    DirectoryName->StartOfString = Path->StartOfString;
+    DirectoryName->LengthInChars = Index - 1;
+    FileName->StartOfString = &Path->StartOfString[Index];
+    FileName->LengthInChars = Path->LengthInChars - Index;
+    return TRUE;
+}
+
+/**
+ Find the directory structure for a specified directory, allocating one if
+ it does not exist yet.
+
+ @param BuildDb Pointer to the build state.
+
+ @param DirectoryName Pointer to the fully qualified directory name.
+
+ @return Pointer to the directory structure, or NULL on allocation failure.
+ */
+PMAKE_BUILDDB_DIRECTORY
+MakeBuildDbLookupDirectory(
+    __in PMAKE_BUILDDB BuildDb,
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_BUILDDB_DIRECTORY Directory;
+
+    HashEntry = YoriLibHashLookupByKey(BuildDb->Directories, DirectoryName);
+    if (HashEntry != NULL) {
+        return HashEntry->Context;
+    }
+
+    Directory = YoriLibMalloc(sizeof(MAKE_BUILDDB_DIRECTORY));
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    Directory->Files = YoriLibAllocateHashTable(50);
+    if (Directory->Files == NULL) {
+        YoriLibFree(Directory);
+        return NULL;
+    }
+
+    YoriLibInitializeListHead(&Directory->FileList);
+    Directory->ModifiedTime.QuadPart = 0;
+
+    YoriLibHashInsertByKey(BuildDb->Directories, DirectoryName, Directory, &Directory->HashEntry);
+    YoriLibAppendList(&BuildDb->DirectoryList, &Directory->ListEntry);
+    return Directory;
+}
+
+/**
+ Add a file to a directory within the build state.  If the file is already
+ known, the existing state is retained.
+
+ @param Directory Pointer to the directory.
+
+ @param FileName Pointer to the file name component.
+
+ @param Exists TRUE if the file exists.
+
+ @param ModifiedTime The last write time of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeBuildDbAddFile(
+    __in PMAKE_BUILDDB_DIRECTORY Directory,
+    __in PYORI_STRING FileName,
+    __in BOOLEAN Exists,
+    __in LARGE_INTEGER ModifiedTime
+    )
+{
+    PMAKE_BUILDDB_FILE File;
+
+    if (YoriLibHashLookupByKey(Directory->Files, FileName) != NULL) {
+        return TRUE;
+    }
+
+    File = YoriLibMalloc(sizeof(MAKE_BUILDDB_FILE));
+    if (File == NULL) {
+        return FALSE;
+    }
+
+    File->Exists = Exists;
+    File->Found = FALSE;
+    File->ModifiedTime.QuadPart = 0;
+    if (Exists) {
+        File->ModifiedTime.QuadPart = ModifiedTime.QuadPart;
+    }
+
+    YoriLibHashInsertByKey(Directory->Files, FileName, File, &File->HashEntry);
+    YoriLibAppendList(&Directory->FileList, &File->ListEntry);
+    return TRUE;
+}
+
+/**
+ Free all state within a build state structure.
+
+ @param BuildDb Pointer to the build state.
+ */
+VOID
+MakeBuildDbCleanup(
+    __in PMAKE_BUILDDB BuildDb
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY FileEntry;
+    PMAKE_BUILDDB_DIRECTORY Directory;
+    PMAKE_BUILDDB_FILE File;
+
+    if (BuildDb->Directories == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&BuildDb->DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_DIRECTORY, ListEntry);
+        FileEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        while (FileEntry != NULL) {
+            File = CONTAINING_RECORD(FileEntry, MAKE_BUILDDB_FILE, ListEntry);
+            YoriLibRemoveListItem(&File->ListEntry);
+            YoriLibHashRemoveByEntry(&File->HashEntry);
+            YoriLibFree(File);
+            FileEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        }
+        YoriLibFreeEmptyHashTable(Directory->Files);
+        YoriLibRemoveListItem(&Directory->ListEntry);
+        YoriLibHashRemoveByEntry(&Directory->HashEntry);
+        YoriLibFree(Directory);
+        ListEntry = YoriLibGetNextListEntry(&BuildDb->DirectoryList, NULL);
+    }
+
+    YoriLibFreeEmptyHashTable(BuildDb->Directories);
+    BuildDb->Directories = NULL;
+}
+
+/**
+ Query the last write time of a directory.
+
+ @param DirectoryName Pointer to the fully qualified directory name.
+
+ @param ModifiedTime On successful completion, updated to contain the last
+        write time of the directory.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbQueryDirectoryTime(
+    __in PYORI_STRING DirectoryName,
+    __out PLARGE_INTEGER ModifiedTime
+    )
+{
+    YORI_STRING OpenName;
+    HANDLE DirHandle;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    BOOLEAN Result;
+
+    //
+    //  Always add a trailing seperator so that drive roots are opened as
+    //  directories rather than volumes.
+    //
+
+    if (!YoriLibAllocateString(&OpenName, DirectoryName->LengthInChars + sizeof("\\"))) {
+        return FALSE;
+    }
+
+    OpenName.LengthInChars = YoriLibSPrintf(OpenName.StartOfString, _T("%y\\"), DirectoryName);
+
+    DirHandle = CreateFile(OpenName.StartOfString,
+                           FILE_READ_ATTRIBUTES | FILE_READ_DATA,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           FILE_FLAG_BACKUP_SEMANTICS,
+                           NULL);
+
+    YoriLibFreeStringContents(&OpenName);
+    if (DirHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (GetFileInformationByHandle(DirHandle, &FileInfo)) {
+        ModifiedTime->LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
+        ModifiedTime->HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
+        Result = TRUE;
+    }
+
+    CloseHandle(DirHandle);
+    return Result;
+}
+
+/**
+ Generate the lines which describe the conditions the build was performed
+ under.  A previous build is only valid if these match exactly.
+
+ @param MakeContext Pointer to the context.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @param ArgLine On successful completion, updated to contain a newly
+        allocated string describing the arguments to the build.
+
+ @param EnvLine On successful completion, updated to contain a newly
+        allocated string describing the environment of the build.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbGetConditions(
+    __in PMAKE_CONTEXT MakeContext,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[],
+    __out PYORI_STRING ArgLine,
+    __out PYORI_STRING EnvLine
+    )
+{
+    YORI_STRING CmdLine;
+    YORI_STRING Env;
+
+    if (!MakeContext->EnvHashCalculated) {
+        if (!YoriLibGetEnvironmentStrings(&Env)) {
+            return FALSE;
+        }
+
+        MakeContext->EnvHash = YoriLibHashString32(0, &Env);
+        MakeContext->EnvHashCalculated = TRUE;
+
+        YoriLibFreeStringContents(&Env);
+    }
+
+    YoriLibInitEmptyString(&CmdLine);
+    if (ArgC > 1) {
+        if (!YoriLibBuildCmdlineFromArgcArgv(ArgC - 1, &ArgV[1], TRUE, FALSE, &CmdLine)) {
+            return FALSE;
+        }
+    }
+
+    if (!YoriLibAllocateString(ArgLine, CmdLine.LengthInChars + sizeof("A:"))) {
+        YoriLibFreeStringContents(&CmdLine);
+        return FALSE;
+    }
+
+    ArgLine->LengthInChars = YoriLibSPrintf(ArgLine->StartOfString, _T("A:%y"), &CmdLine);
+    YoriLibFreeStringContents(&CmdLine);
+
+    if (!YoriLibAllocateString(EnvLine, sizeof("E:12345678"))) {
+        YoriLibFreeStringContents(ArgLine);
+        return FALSE;
+    }
+
+    EnvLine->LengthInChars = YoriLibSPrintf(EnvLine->StartOfString, _T("E:%08x"), MakeContext->EnvHash);
+    return TRUE;
+}
+
+/**
+ Parse a line from the build state file consisting of a timestamp followed
+ by a name.
+
+ @param Line Pointer to the line, after any leading line type.
+
+ @param ModifiedTime On successful completion, updated to contain the
+        timestamp.
+
+ @param Name On successful completion, updated to point to the name within
+        the line.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbParseTimeAndName(
+    __in PYORI_STRING Line,
+    __out PLARGE_INTEGER ModifiedTime,
+    __out PYORI_STRING Name
+    )
+{
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+
+    if (!YoriLibStringToNumber(Line, FALSE, &llTemp, &CharsConsumed) ||
+        CharsConsumed == 0 ||
+        CharsConsumed + 1 >= Line->LengthInChars ||
+        Line->StartOfString[CharsConsumed] != ':') {
+
+        return FALSE;
+    }
+
+    ModifiedTime->QuadPart = llTemp;
+    YoriLibInitEmptyString(Name);
+    Name->StartOfString = &Line->StartOfString[CharsConsumed + 1];
+    Name->LengthInChars = Line->LengthInChars - CharsConsumed - 1;
+    return TRUE;
+}
+
+/**
+ Load a build state file into memory.
+
+ @param MakeContext Pointer to the context.
+
+ @param hDb Handle to the opened build state file.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @param BuildDb Pointer to the build state to populate.
+
+ @return TRUE to indicate the file was loaded and was generated under the
+         same conditions as the current build.  FALSE if the file could not
+         be loaded or describes a different build.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbLoad(
+    __in PMAKE_CONTEXT MakeContext,
+    __in HANDLE hDb,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[],
+    __inout PMAKE_BUILDDB BuildDb
+    )
+{
+    YORI_STRING LineString;
+    YORI_STRING Substring;
+    YORI_STRING Name;
+    YORI_STRING ArgLine;
+    YORI_STRING EnvLine;
+    YORI_STRING VersionLine;
+    TCHAR VersionBuffer[16];
+    LARGE_INTEGER ModifiedTime;
+    PMAKE_BUILDDB_DIRECTORY Directory;
+    PVOID LineContext;
+    DWORD LineNumber;
+    BOOLEAN Result;
+
+    if (!MakeBuildDbGetConditions(MakeContext, ArgC, ArgV, &ArgLine, &EnvLine)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&VersionLine);
+    VersionLine.StartOfString = VersionBuffer;
+    VersionLine.LengthAllocated = sizeof(VersionBuffer)/sizeof(VersionBuffer[0]);
+    VersionLine.LengthInChars = YoriLibSPrintf(VersionBuffer, _T("V:%i"), MAKE_BUILDDB_VERSION);
+
+    YoriLibInitEmptyString(&LineString);
+    LineContext = NULL;
+    LineNumber = 0;
+    Directory = NULL;
+    Result = FALSE;
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hDb)) {
+            Result = (LineNumber > 3);
+            break;
+        }
+
+        LineNumber++;
+
+        //
+        //  The first three lines describe the conditions of the build and
+        //  must match exactly.
+        //
+
+        if (LineNumber == 1) {
+            if (YoriLibCompareString(&LineString, &VersionLine) != 0) {
+                break;
+            }
+            continue;
+        } else if (LineNumber == 2) {
+            if (YoriLibCompareString(&LineString, &ArgLine) != 0) {
+                break;
+            }
+            continue;
+        } else if (LineNumber == 3) {
+            if (YoriLibCompareString(&LineString, &EnvLine) != 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (LineString.LengthInChars < 2 || LineString.StartOfString[1] != ':') {
+            break;
+        }
+
+        YoriLibInitEmptyString(&Substring);
+        Substring.StartOfString = &LineString.StartOfString[2];
+        Substring.LengthInChars = LineString.LengthInChars - 2;
+
+        //
+        //  D:<time>:<directory> introduces a directory, F:<time>:<file>
+        //  describes an existing file in the most recent directory, and
+        //  N:<file> describes a file in the most recent directory that does
+        //  not exist.
+        //
+
+        if (LineString.StartOfString[0] == 'D') {
+            if (!MakeBuildDbParseTimeAndName(&Substring, &ModifiedTime, &Name)) {
+                break;
+            }
+            Directory = MakeBuildDbLookupDirectory(BuildDb, &Name);
+            if (Directory == NULL) {
+                break;
+            }
+            Directory->ModifiedTime.QuadPart = ModifiedTime.QuadPart;
+        } else if (LineString.StartOfString[0] == 'F') {
+            if (Directory == NULL ||
+                !MakeBuildDbParseTimeAndName(&Substring, &ModifiedTime, &Name) ||
+                !MakeBuildDbAddFile(Directory, &Name, TRUE, ModifiedTime)) {
+
+                break;
+            }
+        } else if (LineString.StartOfString[0] == 'N') {
+            ModifiedTime.QuadPart = 0;
+            if (Directory == NULL ||
+                Substring.LengthInChars == 0 ||
+                !MakeBuildDbAddFile(Directory, &Substring, FALSE, ModifiedTime)) {
+
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&ArgLine);
+    YoriLibFreeStringContents(&EnvLine);
+    return Result;
+}
+
+/**
+ Check whether all files within a directory are in the same state as when
+ the build state was recorded.
+
+ @param Directory Pointer to the directory to check.
+
+ @return TRUE if the directory and all files within it are unchanged, FALSE
+         if anything has changed or could not be checked.
+ */
+BOOLEAN
+MakeBuildDbIsDirectoryCurrent(
+    __in PMAKE_BUILDDB_DIRECTORY Directory
+    )
+{
+    YORI_STRING SearchString;
+    YORI_STRING FileName;
+    LARGE_INTEGER ModifiedTime;
+    WIN32_FIND_DATA FindData;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_BUILDDB_FILE File;
+    HANDLE hFind;
+    BOOLEAN Result;
+
+    if (!MakeBuildDbQueryDirectoryTime(&Directory->HashEntry.Key, &ModifiedTime) ||
+        ModifiedTime.QuadPart != Directory->ModifiedTime.QuadPart) {
+
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&SearchString, Directory->HashEntry.Key.LengthInChars + sizeof("\\*"))) {
+        return FALSE;
+    }
+
+    SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y\\*"), &Directory->HashEntry.Key);
+
+    hFind = FindFirstFile(SearchString.StartOfString, &FindData);
+    YoriLibFreeStringContents(&SearchString);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    Result = TRUE;
+    YoriLibInitEmptyString(&FileName);
+    do {
+        YoriLibConstantString(&FileName, FindData.cFileName);
+        HashEntry = YoriLibHashLookupByKey(Directory->Files, &FileName);
+        if (HashEntry != NULL) {
+            File = HashEntry->Context;
+            File->Found = TRUE;
+            if (!File->Exists) {
+                Result = FALSE;
+                break;
+            }
+
+            ModifiedTime.QuadPart = 0;
+            if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+                ModifiedTime.LowPart = FindData.ftLastWriteTime.dwLowDateTime;
+                ModifiedTime.HighPart = FindData.ftLastWriteTime.dwHighDateTime;
+            }
+
+            if (ModifiedTime.QuadPart != File->ModifiedTime.QuadPart) {
+                Result = FALSE;
+                break;
+            }
+        }
+    } while (FindNextFile(hFind, &FindData));
+
+    if (Result && GetLastError() != ERROR_NO_MORE_FILES) {
+        Result = FALSE;
+    }
+
+    FindClose(hFind);
+
+    //
+    //  Any file that existed previously must have been found.  Files that
+    //  are referred to by a short name will not be found, so a build that
+    //  depends on them will always be fully evaluated.
+    //
+
+    if (Result) {
+        ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        while (ListEntry != NULL) {
+            File = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_FILE, ListEntry);
+            if (File->Exists && !File->Found) {
+                Result = FALSE;
+                break;
+            }
+            ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Check whether a previous invocation with the same arguments and
+ environment found nothing to build, and no file it depended on has changed
+ since.  If so, this invocation would also find nothing to build, so there
+ is no need to process any makefile.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @return TRUE if the build is known to be current, FALSE if it needs to be
+         evaluated.
+ */
+BOOLEAN
+MakeIsBuildDbCurrent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    MAKE_BUILDDB BuildDb;
+    YORI_STRING DbFileName;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_BUILDDB_DIRECTORY Directory;
+    HANDLE hDb;
+    BOOLEAN Result;
+
+    if (!MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prd"), &DbFileName)) {
+        return FALSE;
+    }
+
+    hDb = CreateFile(DbFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    YoriLibFreeStringContents(&DbFileName);
+    if (hDb == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    YoriLibInitializeListHead(&BuildDb.DirectoryList);
+    BuildDb.Directories = YoriLibAllocateHashTable(250);
+    if (BuildDb.Directories == NULL) {
+        CloseHandle(hDb);
+        return FALSE;
+    }
+
+    Result = MakeBuildDbLoad(MakeContext, hDb, ArgC, ArgV, &BuildDb);
+    CloseHandle(hDb);
+
+    if (Result) {
+        ListEntry = YoriLibGetNextListEntry(&BuildDb.DirectoryList, NULL);
+        while (ListEntry != NULL) {
+            Directory = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_DIRECTORY, ListEntry);
+            if (!MakeBuildDbIsDirectoryCurrent(Directory)) {
+                Result = FALSE;
+                break;
+            }
+            ListEntry = YoriLibGetNextListEntry(&BuildDb.DirectoryList, ListEntry);
+        }
+    }
+
+    MakeBuildDbCleanup(&BuildDb);
+    return Result;
+}
+
+/**
+ Delete any build state from a previous build.  This is used when the
+ current build has performed work, so the state from a previous build no
+ longer describes the tree.
+
+ @param MakeFileName Pointer to the file name of the makefile.
+ */
+VOID
+MakeDeleteBuildDb(
+    __in PYORI_STRING MakeFileName
+    )
+{
+    YORI_STRING DbFileName;
+
+    if (MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prd"), &DbFileName)) {
+        DeleteFile(DbFileName.StartOfString);
+        YoriLibFreeStringContents(&DbFileName);
+    }
+}
+
+/**
+ Record the state of every file that was used to determine that there was
+ nothing to build, so that a later invocation can skip processing makefiles
+ if none of them have changed.  This includes every makefile that was
+ read, every target whose timestamp was examined, and the directories
+ containing them.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+ */
+VOID
+MakeSaveBuildDb(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    MAKE_BUILDDB BuildDb;
+    YORI_STRING DbFileName;
+    YORI_STRING ArgLine;
+    YORI_STRING EnvLine;
+    YORI_STRING DirectoryName;
+    YORI_STRING FileName;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY FileEntry;
+    PMAKE_BUILDDB_INPUT Input;
+    PMAKE_BUILDDB_DIRECTORY Directory;
+    PMAKE_BUILDDB_FILE File;
+    PMAKE_TARGET Target;
+    HANDLE hDb;
+    BOOLEAN Result;
+
+    if (MakeContext->BuildDbInputs == NULL) {
+        return;
+    }
+
+    if (MakeContext->BuildDbIncomplete) {
+        MakeDeleteBuildDb(MakeFileName);
+        return;
+    }
+
+    YoriLibInitializeListHead(&BuildDb.DirectoryList);
+    BuildDb.Directories = YoriLibAllocateHashTable(250);
+    if (BuildDb.Directories == NULL) {
+        MakeDeleteBuildDb(MakeFileName);
+        return;
+    }
+
+    hDb = INVALID_HANDLE_VALUE;
+    YoriLibInitEmptyString(&ArgLine);
+    YoriLibInitEmptyString(&EnvLine);
+    Result = FALSE;
+
+    if (!MakeBuildDbGetConditions(MakeContext, ArgC, ArgV, &ArgLine, &EnvLine)) {
+        goto Exit;
+    }
+
+    //
+    //  Open the file before querying directory timestamps, so creating it
+    //  doesn't invalidate the directory that contains it.
+    //
+
+    if (!MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prd"), &DbFileName)) {
+        goto Exit;
+    }
+
+    hDb = CreateFile(DbFileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    YoriLibFreeStringContents(&DbFileName);
+    if (hDb == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbInputList, NULL);
+    while (ListEntry != NULL) {
+        Input = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_INPUT, ListEntry);
+        if (!MakeBuildDbSplitPath(&Input->HashEntry.Key, &DirectoryName, &FileName)) {
+            goto Exit;
+        }
+        Directory = MakeBuildDbLookupDirectory(&BuildDb, &DirectoryName);
+        if (Directory == NULL ||
+            !MakeBuildDbAddFile(Directory, &FileName, TRUE, Input->ModifiedTime)) {
+
+            goto Exit;
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbInputList, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, ListEntry);
+        if (Target->FileProbed && !Target->InferenceRulePseudoTarget) {
+            if (!MakeBuildDbSplitPath(&Target->HashEntry.Key, &DirectoryName, &FileName)) {
+                goto Exit;
+            }
+            Directory = MakeBuildDbLookupDirectory(&BuildDb, &DirectoryName);
+            if (Directory == NULL ||
+                !MakeBuildDbAddFile(Directory, &FileName, Target->FileExists, Target->ModifiedTime)) {
+
+                goto Exit;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, ListEntry);
+    }
+
+    YoriLibOutputToDevice(hDb, 0, _T("V:%i\n%y\n%y\n"), MAKE_BUILDDB_VERSION, &ArgLine, &EnvLine);
+
+    ListEntry = YoriLibGetNextListEntry(&BuildDb.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_BUILDDB_DIRECTORY, ListEntry);
+        if (!MakeBuildDbQueryDirectoryTime(&Directory->HashEntry.Key, &Directory->ModifiedTime)) {
+            goto Exit;
+        }
+
+        YoriLibOutputToDevice(hDb, 0, _T("D:%lli:%y\n"), Directory->ModifiedTime.QuadPart, &Directory->HashEntry.Key);
+
+        FileEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        while (FileEntry != NULL) {
+            File = CONTAINING_RECORD(FileEntry, MAKE_BUILDDB_FILE, ListEntry);
+            if (File->Exists) {
+                YoriLibOutputToDevice(hDb, 0, _T("F:%lli:%y\n"), File->ModifiedTime.QuadPart, &File->HashEntry.Key);
+            } else {
+                YoriLibOutputToDevice(hDb, 0, _T("N:%y\n"), &File->HashEntry.Key);
+            }
+            FileEntry = YoriLibGetNextListEntry(&Directory->FileList, FileEntry);
+        }
+        ListEntry = YoriLibGetNextListEntry(&BuildDb.DirectoryList, ListEntry);
+    }
+
+    Result = TRUE;
+
+Exit:
+    if (hDb != INVALID_HANDLE_VALUE) {
+        CloseHandle(hDb);
+    }
+
+    if (!Result) {
+        MakeDeleteBuildDb(MakeFileName);
+    }
+
+    YoriLibFreeStringContents(&ArgLine);
+    YoriLibFreeStringContents(&EnvLine);
+    MakeBuildDbCleanup(&BuildDb);
+}
+
+// vim:sw=4:ts=4:et:
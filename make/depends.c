@@ -0,0 +1,586 @@
+/**
+ * @file make/depends.c
+ *
+ * Yori shell make header dependencies discovered from recipe output
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ The prefix that the Microsoft compiler writes before each file it includes
+ when invoked with /showIncludes.  Nested includes are indicated by extra
+ spaces after the prefix.
+ */
+#define MAKE_SHOW_INCLUDES_PREFIX _T("Note: including file:")
+
+/**
+ Find the header dependency entry for a target, optionally allocating one
+ if it does not exist yet.
+
+ @param MakeContext Pointer to the context.
+
+ @param TargetName Pointer to the fully qualified name of the target.
+
+ @param Create TRUE to allocate an entry if none exists.
+
+ @return Pointer to the entry, or NULL if none exists or allocation failed.
+ */
+PMAKE_HEADER_DEPENDENCY_ENTRY
+MakeLookupHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING TargetName,
+    __in BOOLEAN Create
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->HeaderDependencies, TargetName);
+    if (HashEntry != NULL) {
+        return HashEntry->Context;
+    }
+
+    if (!Create) {
+        return NULL;
+    }
+
+    Entry = YoriLibMalloc(sizeof(MAKE_HEADER_DEPENDENCY_ENTRY));
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Entry, sizeof(MAKE_HEADER_DEPENDENCY_ENTRY));
+    YoriLibInitEmptyString(&Entry->Headers);
+
+    YoriLibHashInsertByKey(MakeContext->HeaderDependencies, TargetName, Entry, &Entry->HashEntry);
+    YoriLibAppendList(&MakeContext->HeaderDependencyList, &Entry->ListEntry);
+    return Entry;
+}
+
+/**
+ Free a single header dependency entry.
+
+ @param Entry Pointer to the entry to free.
+ */
+VOID
+MakeFreeHeaderDependencies(
+    __in PMAKE_HEADER_DEPENDENCY_ENTRY Entry
+    )
+{
+    YoriLibRemoveListItem(&Entry->ListEntry);
+    YoriLibHashRemoveByEntry(&Entry->HashEntry);
+    YoriLibFreeStringContents(&Entry->Headers);
+    YoriLibFree(Entry);
+}
+
+/**
+ Add a header to the set of headers that a target depends upon.
+
+ @param Entry Pointer to the entry for the target.
+
+ @param Header Pointer to the fully qualified name of the header.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeAddHeaderDependency(
+    __in PMAKE_HEADER_DEPENDENCY_ENTRY Entry,
+    __in PYORI_STRING Header
+    )
+{
+    YORI_ALLOC_SIZE_T CharsNeeded;
+
+    CharsNeeded = Entry->Headers.LengthInChars + Header->LengthInChars + 1;
+    if (CharsNeeded > Entry->Headers.LengthAllocated) {
+        if (!YoriLibReallocateString(&Entry->Headers, CharsNeeded * 2)) {
+            return FALSE;
+        }
+    }
+
+    memcpy(&Entry->Headers.StartOfString[Entry->Headers.LengthInChars], Header->StartOfString, Header->LengthInChars * sizeof(TCHAR));
+    Entry->Headers.LengthInChars = Entry->Headers.LengthInChars + Header->LengthInChars;
+    Entry->Headers.StartOfString[Entry->Headers.LengthInChars] = '\n';
+    Entry->Headers.LengthInChars++;
+    return TRUE;
+}
+
+/**
+ Return the next header from a set of headers that a target depends upon.
+
+ @param Entry Pointer to the entry for the target.
+
+ @param Header On input, points to the previous header, or an empty string
+        to return the first header.  On output, updated to point to the
+        next header.
+
+ @return TRUE if a header was returned, FALSE if there are no more headers.
+ */
+BOOLEAN
+MakeGetNextHeaderDependency(
+    __in PMAKE_HEADER_DEPENDENCY_ENTRY Entry,
+    __inout PYORI_STRING Header
+    )
+{
+    YORI_ALLOC_SIZE_T Offset;
+    YORI_ALLOC_SIZE_T Index;
+
+    Offset = 0;
+    if (Header->StartOfString != NULL) {
+        Offset = (YORI_ALLOC_SIZE_T)(Header->StartOfString - Entry->Headers.StartOfString) + Header->LengthInChars + 1;
+    }
+
+    if (Offset >= Entry->Headers.LengthInChars) {
+        return FALSE;
+    }
+
+    for (Index = Offset; Index < Entry->Headers.LengthInChars; Index++) {
+        if (Entry->Headers.StartOfString[Index] == '\n') {
+            break;
+        }
+    }
+
+    Header->StartOfString = &Entry->Headers.StartOfString[Offset];
+    Header->LengthInChars = Index - Offset;
+    return TRUE;
+}
+
+/**
+ Load header dependencies discovered in previous builds.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.
+ */
+VOID
+MakeLoadHeaderDependencies(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    )
+{
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+    YORI_STRING DepsFileName;
+    YORI_STRING LineString;
+    YORI_STRING Substring;
+    HANDLE hDeps;
+    PVOID LineContext = NULL;
+
+    if (MakeContext->HeaderDependencies == NULL) {
+        return;
+    }
+
+    if (!MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prh"), &DepsFileName)) {
+        return;
+    }
+
+    hDeps = CreateFile(DepsFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    YoriLibFreeStringContents(&DepsFileName);
+    if (hDeps == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+    Entry = NULL;
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hDeps)) {
+            break;
+        }
+
+        //
+        //  T:<target> introduces a target, and H:<header> describes a
+        //  header that the most recent target depends on.
+        //
+
+        if (LineString.LengthInChars < 3 || LineString.StartOfString[1] != ':') {
+            break;
+        }
+
+        YoriLibInitEmptyString(&Substring);
+        Substring.StartOfString = &LineString.StartOfString[2];
+        Substring.LengthInChars = LineString.LengthInChars - 2;
+
+        if (LineString.StartOfString[0] == 'T') {
+
+            //
+            //  Copy the target name so the hash package has an allocation
+            //  that won't go away
+            //
+
+            if (!YoriLibCopyString(&DepsFileName, &Substring)) {
+                break;
+            }
+            Entry = MakeLookupHeaderDependencies(MakeContext, &DepsFileName, TRUE);
+            YoriLibFreeStringContents(&DepsFileName);
+            if (Entry == NULL) {
+                break;
+            }
+        } else if (LineString.StartOfString[0] == 'H') {
+            if (Entry == NULL ||
+                !MakeAddHeaderDependency(Entry, &Substring)) {
+
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hDeps);
+}
+
+/**
+ Deallocate all header dependencies and, if any changed during this build,
+ write them to a file for use by later builds.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.
+ */
+VOID
+MakeSaveAndDeleteHeaderDependencies(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+    YORI_STRING DepsFileName;
+    YORI_STRING Header;
+    HANDLE hDeps;
+
+    if (MakeContext->HeaderDependencies == NULL) {
+        return;
+    }
+
+    hDeps = NULL;
+    if (MakeContext->HeaderDependenciesChanged &&
+        MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prh"), &DepsFileName)) {
+
+        hDeps = CreateFile(DepsFileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hDeps == INVALID_HANDLE_VALUE) {
+            hDeps = NULL;
+        }
+        YoriLibFreeStringContents(&DepsFileName);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->HeaderDependencyList, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_HEADER_DEPENDENCY_ENTRY, ListEntry);
+
+        if (hDeps != NULL && Entry->Headers.LengthInChars > 0) {
+            YoriLibOutputToDevice(hDeps, 0, _T("T:%y\n"), &Entry->HashEntry.Key);
+            YoriLibInitEmptyString(&Header);
+            while (MakeGetNextHeaderDependency(Entry, &Header)) {
+                YoriLibOutputToDevice(hDeps, 0, _T("H:%y\n"), &Header);
+            }
+        }
+        MakeFreeHeaderDependencies(Entry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->HeaderDependencyList, NULL);
+    }
+    YoriLibFreeEmptyHashTable(MakeContext->HeaderDependencies);
+    MakeContext->HeaderDependencies = NULL;
+
+    if (hDeps != NULL) {
+        CloseHandle(hDeps);
+    }
+}
+
+/**
+ Scan the output of a recipe command for headers reported by the compiler.
+ Each header is recorded as a dependency of the target, and the lines
+ describing headers are removed from the output so they are not displayed.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target whose recipe generated the output.
+
+ @param CurrentDirectory Pointer to the directory the command executed in,
+        used to resolve any relative header names.
+
+ @param ProcessOutput Pointer to the output of the command.  On completion,
+        this is updated to exclude lines describing headers.
+ */
+VOID
+MakeCaptureHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __in PYORI_STRING CurrentDirectory,
+    __inout PYORI_STRING ProcessOutput
+    )
+{
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+    YORI_STRING Line;
+    YORI_STRING Header;
+    YORI_STRING FullHeader;
+    YORI_ALLOC_SIZE_T ReadIndex;
+    YORI_ALLOC_SIZE_T WriteIndex;
+    YORI_ALLOC_SIZE_T LineEnd;
+    YORI_ALLOC_SIZE_T NextLine;
+    YORI_ALLOC_SIZE_T PrefixLength;
+
+    if (MakeContext->HeaderDependencies == NULL) {
+        return;
+    }
+
+    PrefixLength = sizeof(MAKE_SHOW_INCLUDES_PREFIX)/sizeof(TCHAR) - 1;
+    Entry = NULL;
+    ReadIndex = 0;
+    WriteIndex = 0;
+
+    while (ReadIndex < ProcessOutput->LengthInChars) {
+
+        for (LineEnd = ReadIndex; LineEnd < ProcessOutput->LengthInChars; LineEnd++) {
+            if (ProcessOutput->StartOfString[LineEnd] == '\r' ||
+                ProcessOutput->StartOfString[LineEnd] == '\n') {
+
+                break;
+            }
+        }
+
+        NextLine = LineEnd;
+        if (NextLine < ProcessOutput->LengthInChars && ProcessOutput->StartOfString[NextLine] == '\r') {
+            NextLine++;
+        }
+        if (NextLine < ProcessOutput->LengthInChars && ProcessOutput->StartOfString[NextLine] == '\n') {
+            NextLine++;
+        }
+
+        YoriLibInitEmptyString(&Line);
+        Line.StartOfString = &ProcessOutput->StartOfString[ReadIndex];
+        Line.LengthInChars = LineEnd - ReadIndex;
+
+        if (YoriLibCompareStringWithLiteralCount(&Line, MAKE_SHOW_INCLUDES_PREFIX, PrefixLength) == 0) {
+
+            YoriLibInitEmptyString(&Header);
+            Header.StartOfString = &Line.StartOfString[PrefixLength];
+            Header.LengthInChars = Line.LengthInChars - PrefixLength;
+            YoriLibTrimSpaces(&Header);
+
+            //
+            //  The first header reported for a target in this build
+            //  replaces anything recorded by previous builds.
+            //
+
+            if (Entry == NULL && Header.LengthInChars > 0) {
+                Entry = MakeLookupHeaderDependencies(MakeContext, &Target->HashEntry.Key, TRUE);
+                if (Entry != NULL && !Entry->Captured) {
+                    Entry->Headers.LengthInChars = 0;
+                    Entry->Captured = TRUE;
+                    MakeContext->HeaderDependenciesChanged = TRUE;
+                }
+            }
+
+            YoriLibInitEmptyString(&FullHeader);
+            if (Entry != NULL &&
+                Header.LengthInChars > 0 &&
+                YoriLibGetFullPathNameRelativeTo(CurrentDirectory, &Header, FALSE, &FullHeader, NULL)) {
+
+                MakeAddHeaderDependency(Entry, &FullHeader);
+                YoriLibFreeStringContents(&FullHeader);
+            }
+
+        } else {
+            if (WriteIndex != ReadIndex) {
+                memmove(&ProcessOutput->StartOfString[WriteIndex],
+                        &ProcessOutput->StartOfString[ReadIndex],
+                        (NextLine - ReadIndex) * sizeof(TCHAR));
+            }
+            WriteIndex = WriteIndex + NextLine - ReadIndex;
+        }
+
+        ReadIndex = NextLine;
+    }
+
+    ProcessOutput->LengthInChars = WriteIndex;
+}
+
+/**
+ Indicate that the recipe for a target has completed successfully.  If the
+ recipe did not report any headers, any headers recorded by a previous
+ build no longer apply.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target whose recipe has completed.
+ */
+VOID
+MakeCompleteHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+
+    if (MakeContext->HeaderDependencies == NULL) {
+        return;
+    }
+
+    Entry = MakeLookupHeaderDependencies(MakeContext, &Target->HashEntry.Key, FALSE);
+    if (Entry != NULL && !Entry->Captured) {
+        MakeFreeHeaderDependencies(Entry);
+        MakeContext->HeaderDependenciesChanged = TRUE;
+    }
+}
+
+/**
+ Check whether any header that a target depended on in a previous build has
+ changed, indicating the target should be rebuilt.  Headers which are
+ themselves targets are added to the build graph so that they are built
+ before the target that includes them.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target to check.
+
+ @param RebuildRequired On successful completion, set to TRUE if a header
+        indicates that the target should be rebuilt.  This is not modified
+        if no header requires the target to be rebuilt.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeCheckHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __inout PBOOLEAN RebuildRequired
+    )
+{
+    PMAKE_HEADER_DEPENDENCY_ENTRY Entry;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET_DEPENDENCY Dependency;
+    PMAKE_TARGET Parent;
+    PYORI_STRING FileToProbe;
+    YORI_STRING Header;
+    YORI_STRING HeaderCopy;
+    LARGE_INTEGER ModifiedTime;
+
+    if (MakeContext->HeaderDependencies == NULL || !Target->FileExists) {
+        return TRUE;
+    }
+
+    Entry = MakeLookupHeaderDependencies(MakeContext, &Target->HashEntry.Key, FALSE);
+    if (Entry == NULL) {
+        return TRUE;
+    }
+
+    FileToProbe = &MakeContext->FilesToProbe[0];
+
+    YoriLibInitEmptyString(&Header);
+    while (MakeGetNextHeaderDependency(Entry, &Header)) {
+
+        HashEntry = YoriLibGrowableHashLookupByKey(MakeContext->Targets, &Header);
+        if (HashEntry != NULL) {
+            Parent = HashEntry->Context;
+
+            //
+            //  If the makefile already describes this dependency, it has
+            //  been evaluated already.
+            //
+
+            ListEntry = YoriLibGetNextListEntry(&Target->ParentDependents, NULL);
+            while (ListEntry != NULL) {
+                Dependency = CONTAINING_RECORD(ListEntry, MAKE_TARGET_DEPENDENCY, ChildDependents);
+                if (Dependency->Parent == Parent) {
+                    break;
+                }
+                ListEntry = YoriLibGetNextListEntry(&Target->ParentDependents, ListEntry);
+            }
+
+            if (ListEntry != NULL || Parent->InferenceRulePseudoTarget) {
+                continue;
+            }
+
+            if (!MakeCreateParentChildDependency(MakeContext, Parent, Target)) {
+                return FALSE;
+            }
+
+            if (!MakeDetermineDependenciesForTarget(MakeContext, Parent)) {
+                return FALSE;
+            }
+
+            if (Parent->RebuildRequired) {
+                Target->NumberParentsToBuild = Target->NumberParentsToBuild + 1;
+                *RebuildRequired = TRUE;
+            }
+
+            MakeProbeTargetFile(Parent);
+            if (!Parent->FileExists || Parent->ModifiedTime.QuadPart > Target->ModifiedTime.QuadPart) {
+                *RebuildRequired = TRUE;
+            }
+            continue;
+        }
+
+        //
+        //  Once the target is known to need rebuilding, headers which are
+        //  not targets can't change the outcome.
+        //
+
+        if (*RebuildRequired) {
+            continue;
+        }
+
+        if (Header.LengthInChars + 1 > FileToProbe->LengthAllocated) {
+            if (!YoriLibReallocateStringWithoutPreservingContents(FileToProbe, (Header.LengthInChars + 1) * 2)) {
+                return FALSE;
+            }
+        }
+
+        memcpy(FileToProbe->StartOfString, Header.StartOfString, Header.LengthInChars * sizeof(TCHAR));
+        FileToProbe->StartOfString[Header.LengthInChars] = '\0';
+        FileToProbe->LengthInChars = Header.LengthInChars;
+
+        //
+        //  A header that no longer exists means the target was built
+        //  against a different set of headers than it would be now.
+        //
+
+        if (!MakeProbeFileTime(MakeContext, FileToProbe, &ModifiedTime) ||
+            ModifiedTime.QuadPart > Target->ModifiedTime.QuadPart) {
+
+            *RebuildRequired = TRUE;
+        } else if (MakeContext->BuildDbInputs != NULL) {
+
+            //
+            //  The probe buffer is reused, so give the build state a copy
+            //  of the name that won't change.
+            //
+
+            if (YoriLibCopyString(&HeaderCopy, FileToProbe)) {
+                MakeBuildDbRecordInputTime(MakeContext, &HeaderCopy, ModifiedTime);
+                YoriLibFreeStringContents(&HeaderCopy);
+            } else {
+                MakeContext->BuildDbIncomplete = TRUE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -43,10 +43,45 @@ typedef struct _MAKE_CHILD_RECIPE {
     BOOLEAN CmdContextPresent;
 
     /**
-     Indicates the job identifier.
+     Set to TRUE to indicate that this structure is currently assigned to a
+     target.  FALSE indicates it is available for reuse.
+     */
+    BOOLEAN InUse;
+
+    /**
+     Set to TRUE to indicate that the child process could not be associated
+     with a job object, so completion must be detected by polling the
+     process handle.
+     */
+    BOOLEAN Unmonitored;
+
+    /**
+     Set to TRUE to indicate that this recipe occupies a remote slot, so
+     each of its commands is executed via the remote launcher.
+     */
+    BOOLEAN Remote;
+
+    /**
+     Indicates the job identifier.  This is the index of this structure
+     within the scheduler's array, and is stable for as long as the
+     structure is in use.
      */
     DWORD JobId;
 
+    /**
+     The process identifier of the child process.  Used to determine which
+     job object notifications refer to this child process as opposed to
+     any processes it has launched.
+     */
+    DWORD ProcessId;
+
+    /**
+     A job object containing the child process, whose notifications are
+     delivered to the scheduler's completion port.  NULL if no job object is
+     in use.
+     */
+    HANDLE JobObject;
+
     /**
      The current directory for this recipe.
      */
@@ -62,6 +97,18 @@ typedef struct _MAKE_CHILD_RECIPE {
      */
     PMAKE_CMD_TO_EXEC Cmd;
 
+    /**
+     The time the first command for the target was launched.  Used to
+     record how long the recipe takes to execute.
+     */
+    LARGE_INTEGER RecipeStartTime;
+
+    /**
+     The time the current command within the target was launched.  Used to
+     record the command in a trace.
+     */
+    LARGE_INTEGER CmdStartTime;
+
     /**
      A handle to a child process to wait for completion.  This is the same
      value as embedded in the ExecPlan and is replicated here only to make
@@ -80,6 +127,86 @@ typedef struct _MAKE_CHILD_RECIPE {
     YORI_LIBSH_EXEC_PLAN ExecPlan;
 } MAKE_CHILD_RECIPE, *PMAKE_CHILD_RECIPE;
 
+/**
+ A message posted to the completion port by this program to indicate that a
+ command completed without creating a child process.  This value is chosen
+ to not collide with any job object message.
+ */
+#define MAKE_CHILD_MSG_SYNCHRONOUS_COMPLETION (0x10000)
+
+/**
+ The interval in milliseconds to check for completion of child processes
+ that could not be associated with a job object.  This can occur if ymake
+ is itself running within a job on a system that does not support nested
+ jobs.
+ */
+#define MAKE_UNMONITORED_CHILD_POLL_INTERVAL  (20)
+
+/**
+ State used to track the set of concurrently executing child recipes.
+ */
+typedef struct _MAKE_CHILD_SCHEDULER {
+
+    /**
+     A completion port which receives notifications from job objects
+     containing child processes.  If NULL, the system does not support
+     this and child processes are waited on via WaitForMultipleObjects,
+     which limits the number of concurrent children.
+     */
+    HANDLE CompletionPort;
+
+    /**
+     An array of MAKE_CHILD_RECIPE structures, one for each child process
+     that can execute concurrently.  Elements are not moved once allocated,
+     so pointers to them can be used as completion keys.
+     */
+    PMAKE_CHILD_RECIPE ChildRecipeArray;
+
+    /**
+     A stack of indexes into ChildRecipeArray which are not in use.
+     */
+    PYORI_ALLOC_SIZE_T FreeSlots;
+
+    /**
+     The number of elements in the FreeSlots stack.
+     */
+    YORI_ALLOC_SIZE_T NumberFreeSlots;
+
+    /**
+     The number of entries in ChildRecipeArray.
+     */
+    YORI_ALLOC_SIZE_T NumberSlots;
+
+    /**
+     The number of entries in ChildRecipeArray which are in use.
+     */
+    YORI_ALLOC_SIZE_T NumberActive;
+
+    /**
+     The number of entries in ChildRecipeArray which are in use by recipes
+     executing via the remote launcher.  These are included in NumberActive.
+     */
+    YORI_ALLOC_SIZE_T NumberRemoteActive;
+
+    /**
+     The number of child processes which are executing without a job
+     object, so their completion must be polled.
+     */
+    YORI_ALLOC_SIZE_T NumberUnmonitored;
+
+    /**
+     When no completion port is in use, an array of handles to wait for.
+     */
+    HANDLE *ProcessHandleArray;
+
+    /**
+     When no completion port is in use, an array of indexes into
+     ChildRecipeArray corresponding to each entry in ProcessHandleArray.
+     */
+    PYORI_ALLOC_SIZE_T ProcessSlotArray;
+
+} MAKE_CHILD_SCHEDULER, *PMAKE_CHILD_SCHEDULER;
+
 /**
  Attempt to set the temporary directory for this process to match the
  specified JobId, creating the directory if it does not exist.
@@ -99,26 +226,24 @@ MakeSetTemporaryDirectory(
     __in DWORD JobId
     )
 {
-    DWORDLONG TestMask;
     YORI_STRING JobTempPath;
 
-    ASSERT(JobId < MakeContext->NumberProcesses);
-    TestMask = 1;
-    TestMask = TestMask << JobId;
+    ASSERT(JobId < MakeContext->NumberProcesses + MakeContext->NumberRemoteProcesses);
+    ASSERT(MakeContext->TempDirectoriesCreated != NULL);
 
-    if (!YoriLibAllocateString(&JobTempPath, MakeContext->TempPath.LengthInChars + sizeof("\\YMAKE12"))) {
+    if (!YoriLibAllocateString(&JobTempPath, MakeContext->TempPath.LengthInChars + sizeof("\\YMAKE4294967295"))) {
         return FALSE;
     }
 
     JobTempPath.LengthInChars = YoriLibSPrintf(JobTempPath.StartOfString, _T("%y\\YMAKE%i"), &MakeContext->TempPath, JobId);
 
-    if ((MakeContext->TempDirectoriesCreated & TestMask) == 0) {
+    if (!MakeContext->TempDirectoriesCreated[JobId]) {
         if (!YoriLibCreateDirectoryAndParents(&JobTempPath)) {
             YoriLibFreeStringContents(&JobTempPath);
             return FALSE;
         }
 
-        MakeContext->TempDirectoriesCreated = MakeContext->TempDirectoriesCreated | TestMask;
+        MakeContext->TempDirectoriesCreated[JobId] = TRUE;
     }
 
     if (!SetEnvironmentVariable(_T("TEMP"), JobTempPath.StartOfString)) {
@@ -148,94 +273,305 @@ MakeCleanupTemporaryDirectories(
     )
 {
     DWORD Probe;
-    DWORDLONG TestMask;
     YORI_STRING TempPath;
 
-    if (!YoriLibAllocateString(&TempPath, MakeContext->TempPath.LengthInChars + sizeof("\\YMAKE12"))) {
+    if (MakeContext->TempDirectoriesCreated == NULL) {
         return;
     }
 
-    for (Probe = 0; Probe < MakeContext->NumberProcesses; Probe++) {
-        TestMask = 1;
-        TestMask = TestMask << Probe;
-        if ((MakeContext->TempDirectoriesCreated & TestMask) != 0) {
-            TempPath.LengthInChars = YoriLibSPrintf(TempPath.StartOfString, _T("%y\\YMAKE%i"), &MakeContext->TempPath, Probe);
-            RemoveDirectory(TempPath.StartOfString);
+    if (YoriLibAllocateString(&TempPath, MakeContext->TempPath.LengthInChars + sizeof("\\YMAKE4294967295"))) {
+        for (Probe = 0; Probe < MakeContext->NumberProcesses + MakeContext->NumberRemoteProcesses; Probe++) {
+            if (MakeContext->TempDirectoriesCreated[Probe]) {
+                TempPath.LengthInChars = YoriLibSPrintf(TempPath.StartOfString, _T("%y\\YMAKE%i"), &MakeContext->TempPath, Probe);
+                RemoveDirectory(TempPath.StartOfString);
+            }
         }
+
+        YoriLibFreeStringContents(&TempPath);
     }
 
-    YoriLibFreeStringContents(&TempPath);
+    YoriLibFree(MakeContext->TempDirectoriesCreated);
+    MakeContext->TempDirectoriesCreated = NULL;
 }
 
 /**
- Allocate a job identifier for the child process.  This is a number between
- zero to the maximum number of child processes minus one.  Because of the
- limit in the number of child processes, one of these values should always
- be available.
+ The list of commands to invoke via cmd /c without trying to spawn an
+ external process.
+ */
+CONST LPTSTR
+MakePuntToCmd[] = {
+    _T("COPY"),
+    _T("DEL"),
+    _T("ERASE"),
+    _T("FOR"),
+    _T("IF"),
+    _T("MOVE"),
+    _T("REN"),
+    _T("TYPE")
+};
 
- @param MakeContext Pointer to the make context.
+/**
+ Declaration for the Yori copy builtin, used to execute CMD compatible COPY
+ commands in process.
+ */
+YORI_CMD_BUILTIN YoriCmd_YCOPY;
 
- @return The job identifier.
+/**
+ Declaration for the Yori erase builtin, used to execute CMD compatible DEL
+ and ERASE commands in process.
  */
-DWORD
-MakeAllocateJobId(
-    __in PMAKE_CONTEXT MakeContext
+YORI_CMD_BUILTIN YoriCmd_YERASE;
+
+/**
+ Inspect the arguments to a COPY, DEL or ERASE command and determine whether
+ the Yori implementation of the command would perform the same operation
+ that CMD would.  If so, optionally construct the arguments that the Yori
+ implementation should be invoked with.
+
+ CMD options are only recognized with a forward slash.  Options which only
+ suppress prompts (COPY /Y, DEL /Q) or force deletion of read only files
+ (DEL /F, which the Yori implementation always does) are dropped, DEL /S is
+ translated, and COPY /B is accepted since it is the default for files.
+ Anything else, including concatenation via '+', is left to CMD.  Basic
+ enumeration is always requested so that wildcards are interpreted the way
+ CMD would interpret them.
+
+ @param ArgC The number of arguments to the CMD command.
+
+ @param ArgV The array of arguments to the CMD command.
+
+ @param NewArgC On successful completion, optionally updated to contain the
+        number of arguments to pass to the Yori implementation.
+
+ @param NewArgV On successful completion, optionally updated to point to an
+        array of arguments to pass to the Yori implementation.  The strings
+        within the array refer to the strings in ArgV and are not
+        referenced.  The array should be freed with YoriLibFree.
+
+ @return TRUE to indicate the command can be executed in process, FALSE if
+         it should be executed by CMD.
+ */
+__success(return)
+BOOLEAN
+MakeTranslateCmdArgsForInProc(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[],
+    __out_opt PYORI_ALLOC_SIZE_T NewArgC,
+    __out_opt PYORI_STRING *NewArgV
     )
 {
-    DWORD Probe;
-    DWORDLONG TestMask;
-
-    for (Probe = 0; Probe < MakeContext->NumberProcesses; Probe++) {
-        TestMask = 1;
-        TestMask = TestMask << Probe;
-        if ((MakeContext->JobIdsAllocated & TestMask) == 0) {
-            MakeContext->JobIdsAllocated = MakeContext->JobIdsAllocated | TestMask;
-            MakeSetTemporaryDirectory(MakeContext, Probe);
-            return Probe;
+    BOOLEAN IsCopy;
+    BOOLEAN Recursive;
+    YORI_ALLOC_SIZE_T FileCount;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T OutIndex;
+    YORI_STRING Arg;
+    PYORI_STRING OutArgV;
+
+    if (ArgC < 2) {
+        return FALSE;
+    }
+
+    IsCopy = FALSE;
+    if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[0], _T("COPY")) == 0) {
+        IsCopy = TRUE;
+    }
+
+    Recursive = FALSE;
+    FileCount = 0;
+
+    for (Index = 1; Index < ArgC; Index++) {
+        if (ArgV[Index].LengthInChars > 0 &&
+            ArgV[Index].StartOfString[0] == '/') {
+
+            YoriLibInitEmptyString(&Arg);
+            Arg.StartOfString = &ArgV[Index].StartOfString[1];
+            Arg.LengthInChars = ArgV[Index].LengthInChars - 1;
+
+            if (IsCopy) {
+                if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) != 0 &&
+                    YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("y")) != 0) {
+
+                    return FALSE;
+                }
+            } else {
+                if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                    Recursive = TRUE;
+                } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("f")) != 0 &&
+                           YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("q")) != 0) {
+
+                    return FALSE;
+                }
+            }
+        } else {
+
+            //
+            //  COPY has no way to indicate the end of options, so a file
+            //  that looks like a Yori option must go to CMD.
+            //
+
+            if (IsCopy) {
+                if (ArgV[Index].LengthInChars > 0 &&
+                    ArgV[Index].StartOfString[0] == '-') {
+
+                    return FALSE;
+                }
+                if (YoriLibFindLeftMostCharacter(&ArgV[Index], '+') != NULL) {
+                    return FALSE;
+                }
+            }
+            FileCount++;
+        }
+    }
+
+    if (FileCount == 0) {
+        return FALSE;
+    }
+
+    if (NewArgV == NULL) {
+        return TRUE;
+    }
+
+    //
+    //  The new arguments consist of the command name, basic enumeration,
+    //  optionally recursion, an end of options marker for erase, and the
+    //  files.
+    //
+
+    OutArgV = YoriLibMalloc((ArgC + 3) * sizeof(YORI_STRING));
+    if (OutArgV == NULL) {
+        return FALSE;
+    }
+
+    memcpy(&OutArgV[0], &ArgV[0], sizeof(YORI_STRING));
+    OutIndex = 1;
+    YoriLibConstantString(&OutArgV[OutIndex], _T("-b"));
+    OutIndex++;
+    if (Recursive) {
+        YoriLibConstantString(&OutArgV[OutIndex], _T("-s"));
+        OutIndex++;
+    }
+    if (!IsCopy) {
+        YoriLibConstantString(&OutArgV[OutIndex], _T("--"));
+        OutIndex++;
+    }
+
+    for (Index = 1; Index < ArgC; Index++) {
+        if (ArgV[Index].LengthInChars > 0 &&
+            ArgV[Index].StartOfString[0] == '/') {
+
+            continue;
         }
+        memcpy(&OutArgV[OutIndex], &ArgV[Index], sizeof(YORI_STRING));
+        OutIndex++;
     }
 
-    ASSERT(Probe < MakeContext->NumberProcesses);
-    return Probe;
+    *NewArgV = OutArgV;
+    if (NewArgC != NULL) {
+        *NewArgC = OutIndex;
+    }
+
+    return TRUE;
 }
 
 /**
- Free a job identifier that was previously associated with a child process.
+ Determine whether a command which has been found as a builtin can be
+ executed in process.  Most builtins always can, but COPY, DEL and ERASE
+ are CMD commands which are only executed in process when their arguments
+ have the same meaning to the Yori implementation, and were previously
+ handled by CMD so any plan containing more than one command continues to
+ go to CMD.
 
- @param MakeContext Pointer to the make context.
+ @param ExecPlan Pointer to the parsed plan for the recipe command.
 
- @param JobId The job identifier.
+ @return TRUE to indicate the builtin can be executed in process, FALSE if
+         the command should be handled by CMD.
  */
-VOID
-MakeFreeJobId(
-    __in PMAKE_CONTEXT MakeContext,
-    __in DWORD JobId
+BOOLEAN
+MakeCanExecuteBuiltinInProc(
+    __in PYORI_LIBSH_EXEC_PLAN ExecPlan
     )
 {
-    DWORDLONG TestMask;
+    PYORI_LIBSH_CMD_CONTEXT CmdContext;
+
+    CmdContext = &ExecPlan->FirstCmd->CmdToExec;
+
+    if (YoriLibCompareStringWithLiteralInsensitive(&CmdContext->ArgV[0], _T("COPY")) != 0 &&
+        YoriLibCompareStringWithLiteralInsensitive(&CmdContext->ArgV[0], _T("DEL")) != 0 &&
+        YoriLibCompareStringWithLiteralInsensitive(&CmdContext->ArgV[0], _T("ERASE")) != 0) {
 
-    ASSERT(JobId < MakeContext->NumberProcesses);
+        return TRUE;
+    }
+
+    if (ExecPlan->NumberCommands > 1) {
+        return FALSE;
+    }
 
-    TestMask = 1;
-    TestMask = TestMask << JobId;
-    ASSERT(MakeContext->JobIdsAllocated & TestMask);
-    MakeContext->JobIdsAllocated = MakeContext->JobIdsAllocated & ~(TestMask);
+    return MakeTranslateCmdArgsForInProc(CmdContext->ArgC, CmdContext->ArgV, NULL, NULL);
 }
 
 /**
- The list of commands to invoke via cmd /c without trying to spawn an
- external process.
+ Execute a CMD compatible COPY command in process by translating its
+ arguments for the Yori copy implementation.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @return ExitCode, zero for success, nonzero for failure.
  */
-CONST LPTSTR
-MakePuntToCmd[] = {
-    _T("COPY"),
-    _T("ERASE"),
-    _T("FOR"),
-    _T("IF"),
-    _T("MOVE"),
-    _T("REN"),
-    _T("TYPE")
-};
+DWORD
+YORI_BUILTIN_FN
+MakeBuiltinCopy(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    YORI_ALLOC_SIZE_T NewArgC;
+    PYORI_STRING NewArgV;
+    DWORD Result;
+
+    if (!MakeTranslateCmdArgsForInProc(ArgC, ArgV, &NewArgC, &NewArgV)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("copy: arguments not supported in process\n"));
+        return EXIT_FAILURE;
+    }
+
+    Result = YoriCmd_YCOPY(NewArgC, NewArgV);
+    YoriLibFree(NewArgV);
+    return Result;
+}
+
+/**
+ Execute a CMD compatible DEL or ERASE command in process by translating its
+ arguments for the Yori erase implementation.  CMD indicates success when
+ files cannot be found or cannot be deleted, and makefiles depend on this to
+ clean up files which may not exist, so this function does the same.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @return ExitCode, zero for success, nonzero for failure.
+ */
+DWORD
+YORI_BUILTIN_FN
+MakeBuiltinErase(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    YORI_ALLOC_SIZE_T NewArgC;
+    PYORI_STRING NewArgV;
+
+    if (!MakeTranslateCmdArgsForInProc(ArgC, ArgV, &NewArgC, &NewArgV)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("erase: arguments not supported in process\n"));
+        return EXIT_FAILURE;
+    }
+
+    YoriCmd_YERASE(NewArgC, NewArgV);
+    YoriLibFree(NewArgV);
+    return EXIT_SUCCESS;
+}
 
 /**
  Return TRUE if there are more commands to execute as part of constructing
@@ -527,6 +863,8 @@ MakeLaunchNextCmd(
     ZeroMemory(&si, sizeof(si));
     si.cb = sizeof(si);
 
+    QueryPerformanceCounter(&ChildRecipe->CmdStartTime);
+
     CmdToExec = CONTAINING_RECORD(ListEntry, MAKE_CMD_TO_EXEC, ListEntry);
     if (CmdToExec->DisplayCmd && !MakeContext->SilentCommandLaunching) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &CmdToExec->Cmd);
@@ -537,6 +875,19 @@ MakeLaunchNextCmd(
     CmdToParse.StartOfString = CmdToExec->Cmd.StartOfString;
     CmdToParse.LengthInChars = CmdToExec->Cmd.LengthInChars;
 
+    //
+    //  If the recipe is in a remote slot, hand the command to the launcher,
+    //  which is responsible for executing it on a build agent and
+    //  returning its outputs.
+    //
+
+    if (ChildRecipe->Remote && CmdToExec->Remote) {
+        if (!YoriLibAllocateString(&CmdToParse, MakeContext->RemoteLauncher.LengthInChars + 1 + CmdToExec->Cmd.LengthInChars + 1)) {
+            return FALSE;
+        }
+        CmdToParse.LengthInChars = YoriLibSPrintf(CmdToParse.StartOfString, _T("%y %y"), &MakeContext->RemoteLauncher, &CmdToExec->Cmd);
+    }
+
     //
     //  Check if this command is a builtin, and if so, execute it inline
     //
@@ -584,6 +935,12 @@ MakeLaunchNextCmd(
                 PYORI_LIBSH_BUILTIN_CALLBACK Callback;
 
                 Callback = YoriLibShLookupBuiltinByName(&ExecContext->CmdToExec.ArgV[0]);
+                if (Callback != NULL &&
+                    !MakeCanExecuteBuiltinInProc(&ChildRecipe->ExecPlan)) {
+
+                    Callback = NULL;
+                }
+
                 if (Callback) {
 
                     SetCurrentDirectory(ChildRecipe->CurrentDirectory.StartOfString);
@@ -689,14 +1046,15 @@ MakeLaunchNextCmd(
         }
     }
 
-    ChildRecipe->JobId = MakeAllocateJobId(MakeContext);
+    MakeSetTemporaryDirectory(MakeContext, ChildRecipe->JobId);
 
+    YoriLibEtwWriteEvent("Launch", YORI_ETW_OPCODE_START, &CmdToParse, ChildRecipe->JobId);
     Error = YoriLibShCreateProcess(ExecContext,
                                    ChildRecipe->CurrentDirectory.StartOfString,
                                    &FailedInRedirection);
+    YoriLibEtwWriteEvent("Launch", YORI_ETW_OPCODE_STOP, &ChildRecipe->Target->HashEntry.Key, ExecContext->dwProcessId);
 
     if (Error != ERROR_SUCCESS) {
-        MakeFreeJobId(MakeContext, ChildRecipe->JobId);
         ChildRecipe->ProcessHandle = NULL;
         if (!CmdToExec->IgnoreErrors) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Failure to launch:\n%y\n"), &CmdToParse);
@@ -708,6 +1066,7 @@ MakeLaunchNextCmd(
         CloseHandle(ExecContext->hPrimaryThread);
         ExecContext->hPrimaryThread = NULL;
         ChildRecipe->ProcessHandle = ExecContext->hProcess;
+        ChildRecipe->ProcessId = ExecContext->dwProcessId;
         YoriLibShCommenceProcessBuffersIfNeeded(ExecContext);
     }
     YoriLibFreeStringContents(&CmdToParse);
@@ -787,6 +1146,7 @@ MakeLaunchNextTarget(
 
     ChildRecipe->Target = Target;
     ChildRecipe->Cmd = NULL;
+    QueryPerformanceCounter(&ChildRecipe->RecipeStartTime);
 
     //
     //  The previous recipe should have been cleaned up.
@@ -844,7 +1204,7 @@ MakeUpdateDependenciesForTarget(
             Dependency->Child->NumberParentsToBuild--;
             if (Dependency->Child->NumberParentsToBuild == 0) {
                 YoriLibRemoveListItem(&Dependency->Child->RebuildList);
-                YoriLibAppendList(&MakeContext->TargetsReady, &Dependency->Child->RebuildList);
+                MakeInsertReadyTarget(MakeContext, Dependency->Child);
             }
         }
         ListEntry = YoriLibGetNextListEntry(&Target->ChildDependents, ListEntry);
@@ -872,6 +1232,7 @@ MakeProcessCompletion(
     DWORD ExitCode;
     PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
     YORI_STRING ProcessOutput;
+    LARGE_INTEGER EndTime;
     BOOLEAN Result;
     BOOLEAN RestoreColor;
     WORD DefaultColor;
@@ -883,8 +1244,10 @@ MakeProcessCompletion(
     //
     //  Ideally this would wait for the process buffer threads rather than
     //  wait for process termination, then get here and wait for the process
-    //  buffer threads.  Unfortunately since there are two threads and we're
-    //  hitting the 64 object wait limit, it seems like the lesser evil.
+    //  buffer threads.  Process termination is what job objects report, and
+    //  when job objects are not available, waiting on two threads per child
+    //  would halve the number of children under the 64 object wait limit,
+    //  so it seems like the lesser evil.
     //
 
     if (ChildRecipe->ProcessHandle != NULL) {
@@ -921,6 +1284,7 @@ MakeProcessCompletion(
         if (ExecContext->StdOutType == StdOutTypeBuffer) {
             YoriLibShWaitForProcessBufferToFinalize(ExecContext->StdOut.Buffer.ProcessBuffers);
             if (YoriLibShGetProcessOutputBuffer(ExecContext->StdOut.Buffer.ProcessBuffers, &ProcessOutput)) {
+                MakeCaptureHeaderDependencies(MakeContext, ChildRecipe->Target, &ChildRecipe->CurrentDirectory, &ProcessOutput);
                 if (ProcessOutput.LengthInChars > 0) {
                     YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &ProcessOutput);
                 }
@@ -946,9 +1310,20 @@ MakeProcessCompletion(
 
         ASSERT(ChildRecipe->CmdContextPresent);
         ChildRecipe->ProcessHandle = NULL;
-        MakeFreeJobId(MakeContext, ChildRecipe->JobId);
     }
 
+    YoriLibEtwWriteEvent("Complete", YORI_ETW_OPCODE_INFO, &ChildRecipe->Target->HashEntry.Key, ExitCode);
+
+    QueryPerformanceCounter(&EndTime);
+    MakeTraceRecordEvent(MakeContext,
+                         _T("command"),
+                         &ChildRecipe->Cmd->Cmd,
+                         ChildRecipe->JobId + 1,
+                         &ChildRecipe->CmdStartTime,
+                         &EndTime,
+                         &ChildRecipe->Target->HashEntry.Key,
+                         ExitCode);
+
     MakeFreeCmdContextIfNecessary(ChildRecipe);
 
     return Result;
@@ -957,7 +1332,8 @@ MakeProcessCompletion(
 
 /**
  Remove all targets that are in the front of the ready queue but really have
- no actions to perform.
+ no actions to perform, either because they have no recipe or because their
+ output could be restored from the output cache.
 
  MSFIX This process should probably occur earlier, when a target moves from
  waiting it can move directly to completed if there is nothing to do.  This
@@ -983,7 +1359,9 @@ MakeCompleteReadyWithNoRecipe(
     ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
     while (ListEntry != NULL) {
         Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
-        if (YoriLibIsListEmpty(&Target->ExecCmds)) {
+        if (YoriLibIsListEmpty(&Target->ExecCmds) ||
+            MakeRestoreTargetFromCache(MakeContext, Target)) {
+
             RemovedItem = TRUE;
             MakeUpdateDependenciesForTarget(MakeContext, Target);
         } else {
@@ -995,6 +1373,428 @@ MakeCompleteReadyWithNoRecipe(
     return RemovedItem;
 }
 
+/**
+ Find the first ready target whose recipe can be executed in a remote slot.
+
+ @param MakeContext Pointer to the context.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @return Pointer to the target, or NULL if no remote slot is available or no
+         ready target can use one.
+ */
+PMAKE_TARGET
+MakeFindReadyRemoteTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_CHILD_SCHEDULER Scheduler
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET Target;
+
+    if (Scheduler->NumberRemoteActive >= MakeContext->NumberRemoteProcesses) {
+        return NULL;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        if (Target->RemoteEligible) {
+            return Target;
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, ListEntry);
+    }
+
+    return NULL;
+}
+
+/**
+ Determine whether another target can be launched now.  Any ready target can
+ use a free local slot, but a remote slot can only be used by a ready target
+ whose recipe is hermetic.
+
+ @param MakeContext Pointer to the context.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @return TRUE if a target can be launched, FALSE if the scheduler must wait
+         for a child to complete first.
+ */
+BOOLEAN
+MakeCanLaunchReadyTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_CHILD_SCHEDULER Scheduler
+    )
+{
+    if (YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
+        return FALSE;
+    }
+
+    if (Scheduler->NumberActive - Scheduler->NumberRemoteActive < MakeContext->NumberProcesses) {
+        return TRUE;
+    }
+
+    if (MakeFindReadyRemoteTarget(MakeContext, Scheduler) != NULL) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Prepare the scheduler to track concurrently executing child recipes.  If
+ the system supports job objects and completion ports, any number of child
+ processes can execute concurrently.  If not, the number of processes is
+ limited by WaitForMultipleObjects.
+
+ @param MakeContext Pointer to the context.  Note the number of processes
+        may be reduced if the system cannot support the requested number.
+
+ @param Scheduler Pointer to the scheduler to initialize.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeInitializeChildScheduler(
+    __inout PMAKE_CONTEXT MakeContext,
+    __out PMAKE_CHILD_SCHEDULER Scheduler
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T NumberSlots;
+
+    ZeroMemory(Scheduler, sizeof(MAKE_CHILD_SCHEDULER));
+
+    Scheduler->CompletionPort = YoriLibCreateJobCompletionPort();
+
+    //
+    //  Without a completion port, WaitForMultipleObjects has a limit of 64
+    //  things to wait for, so this program can't have more than 64 children.
+    //  Local slots are preserved in preference to remote ones.
+    //
+
+    if (Scheduler->CompletionPort == NULL) {
+        if (MakeContext->NumberProcesses > MAXIMUM_WAIT_OBJECTS) {
+            MakeContext->NumberProcesses = MAXIMUM_WAIT_OBJECTS;
+        }
+        if (MakeContext->NumberRemoteProcesses > MAXIMUM_WAIT_OBJECTS - MakeContext->NumberProcesses) {
+            MakeContext->NumberRemoteProcesses = MAXIMUM_WAIT_OBJECTS - MakeContext->NumberProcesses;
+        }
+    }
+
+    NumberSlots = MakeContext->NumberProcesses + MakeContext->NumberRemoteProcesses;
+
+    Scheduler->ChildRecipeArray = YoriLibMalloc(NumberSlots * sizeof(MAKE_CHILD_RECIPE));
+    Scheduler->FreeSlots = YoriLibMalloc(NumberSlots * sizeof(YORI_ALLOC_SIZE_T));
+    if (Scheduler->ChildRecipeArray == NULL || Scheduler->FreeSlots == NULL) {
+        goto Failure;
+    }
+
+    if (Scheduler->CompletionPort == NULL) {
+        Scheduler->ProcessHandleArray = YoriLibMalloc(NumberSlots * sizeof(HANDLE));
+        Scheduler->ProcessSlotArray = YoriLibMalloc(NumberSlots * sizeof(YORI_ALLOC_SIZE_T));
+        if (Scheduler->ProcessHandleArray == NULL || Scheduler->ProcessSlotArray == NULL) {
+            goto Failure;
+        }
+    }
+
+    if (MakeContext->TempDirectoriesCreated == NULL) {
+        MakeContext->TempDirectoriesCreated = YoriLibMalloc(NumberSlots * sizeof(BOOLEAN));
+        if (MakeContext->TempDirectoriesCreated == NULL) {
+            goto Failure;
+        }
+        ZeroMemory(MakeContext->TempDirectoriesCreated, NumberSlots * sizeof(BOOLEAN));
+    }
+
+    ZeroMemory(Scheduler->ChildRecipeArray, NumberSlots * sizeof(MAKE_CHILD_RECIPE));
+
+    //
+    //  Push free slots in reverse order so the lowest job identifiers are
+    //  used first.
+    //
+
+    for (Index = 0; Index < NumberSlots; Index++) {
+        Scheduler->ChildRecipeArray[Index].JobId = Index;
+        Scheduler->FreeSlots[Index] = NumberSlots - Index - 1;
+    }
+    Scheduler->NumberFreeSlots = NumberSlots;
+    Scheduler->NumberSlots = NumberSlots;
+
+    return TRUE;
+
+Failure:
+
+    if (Scheduler->ChildRecipeArray != NULL) {
+        YoriLibFree(Scheduler->ChildRecipeArray);
+    }
+    if (Scheduler->FreeSlots != NULL) {
+        YoriLibFree(Scheduler->FreeSlots);
+    }
+    if (Scheduler->ProcessHandleArray != NULL) {
+        YoriLibFree(Scheduler->ProcessHandleArray);
+    }
+    if (Scheduler->ProcessSlotArray != NULL) {
+        YoriLibFree(Scheduler->ProcessSlotArray);
+    }
+    if (Scheduler->CompletionPort != NULL) {
+        CloseHandle(Scheduler->CompletionPort);
+    }
+    ZeroMemory(Scheduler, sizeof(MAKE_CHILD_SCHEDULER));
+    return FALSE;
+}
+
+/**
+ Free resources associated with a child scheduler.  All child recipes should
+ have completed before calling this function.
+
+ @param Scheduler Pointer to the scheduler to clean up.
+ */
+VOID
+MakeCleanupChildScheduler(
+    __in PMAKE_CHILD_SCHEDULER Scheduler
+    )
+{
+    ASSERT(Scheduler->NumberActive == 0);
+
+    YoriLibFree(Scheduler->ChildRecipeArray);
+    YoriLibFree(Scheduler->FreeSlots);
+    if (Scheduler->ProcessHandleArray != NULL) {
+        YoriLibFree(Scheduler->ProcessHandleArray);
+    }
+    if (Scheduler->ProcessSlotArray != NULL) {
+        YoriLibFree(Scheduler->ProcessSlotArray);
+    }
+    if (Scheduler->CompletionPort != NULL) {
+        CloseHandle(Scheduler->CompletionPort);
+    }
+}
+
+/**
+ Allocate a child recipe structure from the scheduler.  The caller must have
+ checked that fewer than the maximum number of children are active.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @param Remote TRUE if the recipe will execute via the remote launcher,
+        FALSE if it will execute locally.
+
+ @return Pointer to an unused child recipe structure.
+ */
+PMAKE_CHILD_RECIPE
+MakeAllocateChildSlot(
+    __in PMAKE_CHILD_SCHEDULER Scheduler,
+    __in BOOLEAN Remote
+    )
+{
+    PMAKE_CHILD_RECIPE ChildRecipe;
+
+    ASSERT(Scheduler->NumberFreeSlots > 0);
+    Scheduler->NumberFreeSlots--;
+    ChildRecipe = &Scheduler->ChildRecipeArray[Scheduler->FreeSlots[Scheduler->NumberFreeSlots]];
+    ASSERT(!ChildRecipe->InUse);
+    ChildRecipe->InUse = TRUE;
+    ChildRecipe->Remote = Remote;
+    Scheduler->NumberActive++;
+    if (Remote) {
+        Scheduler->NumberRemoteActive++;
+    }
+    return ChildRecipe;
+}
+
+/**
+ Return a child recipe structure to the scheduler so that it can be used for
+ a later target.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @param ChildRecipe Pointer to the child recipe structure to return.
+ */
+VOID
+MakeFreeChildSlot(
+    __in PMAKE_CHILD_SCHEDULER Scheduler,
+    __in PMAKE_CHILD_RECIPE ChildRecipe
+    )
+{
+    DWORD JobId;
+
+    ASSERT(ChildRecipe->InUse);
+    ASSERT(ChildRecipe->JobObject == NULL);
+    ASSERT(!ChildRecipe->Unmonitored);
+
+    JobId = ChildRecipe->JobId;
+    if (ChildRecipe->Remote) {
+        Scheduler->NumberRemoteActive--;
+    }
+    ZeroMemory(ChildRecipe, sizeof(MAKE_CHILD_RECIPE));
+    ChildRecipe->JobId = JobId;
+
+    Scheduler->FreeSlots[Scheduler->NumberFreeSlots] = JobId;
+    Scheduler->NumberFreeSlots++;
+    Scheduler->NumberActive--;
+}
+
+/**
+ After a command has been launched for a child recipe, arrange for the
+ scheduler to be notified when it completes.  If the command completed
+ synchronously, a completion is queued immediately.  Otherwise, the child
+ process is placed in a job object that reports to the completion port.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @param ChildRecipe Pointer to the child recipe that has launched a command.
+ */
+VOID
+MakeMonitorChild(
+    __in PMAKE_CHILD_SCHEDULER Scheduler,
+    __in PMAKE_CHILD_RECIPE ChildRecipe
+    )
+{
+    ASSERT(ChildRecipe->JobObject == NULL);
+    ASSERT(!ChildRecipe->Unmonitored);
+
+    if (Scheduler->CompletionPort == NULL) {
+        return;
+    }
+
+    if (ChildRecipe->ProcessHandle != NULL) {
+
+        //
+        //  The port needs to be associated before the process is assigned,
+        //  or the exit notification could be missed.
+        //
+
+        ChildRecipe->JobObject = YoriLibCreateJobObject();
+        if (ChildRecipe->JobObject != NULL) {
+            if (YoriLibAssociateJobObjectWithCompletionPort(ChildRecipe->JobObject, Scheduler->CompletionPort, ChildRecipe) &&
+                YoriLibAssignProcessToJobObject(ChildRecipe->JobObject, ChildRecipe->ProcessHandle)) {
+
+                return;
+            }
+
+            CloseHandle(ChildRecipe->JobObject);
+            ChildRecipe->JobObject = NULL;
+        }
+
+        //
+        //  Assigning a process to a job fails if the process has already
+        //  terminated, or if it is already within a job and the system
+        //  doesn't support nesting.  In the first case, it's complete now.
+        //  In the second, it needs to be polled.
+        //
+
+        if (WaitForSingleObject(ChildRecipe->ProcessHandle, 0) != WAIT_OBJECT_0) {
+            ChildRecipe->Unmonitored = TRUE;
+            Scheduler->NumberUnmonitored++;
+            return;
+        }
+    }
+
+    YoriLibPostJobCompletionMessage(Scheduler->CompletionPort, MAKE_CHILD_MSG_SYNCHRONOUS_COMPLETION, ChildRecipe, 0);
+}
+
+/**
+ Wait for any active child recipe to complete its current command.  The
+ caller must have checked that at least one child recipe is active.
+
+ @param Scheduler Pointer to the scheduler.
+
+ @return Pointer to the child recipe whose command has completed.
+ */
+PMAKE_CHILD_RECIPE
+MakeWaitForChildCompletion(
+    __in PMAKE_CHILD_SCHEDULER Scheduler
+    )
+{
+    PMAKE_CHILD_RECIPE ChildRecipe;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Count;
+    DWORD Timeout;
+    DWORD Message;
+    PVOID Key;
+    DWORD_PTR Data;
+
+    ASSERT(Scheduler->NumberActive > 0);
+
+    //
+    //  Without a completion port, scan for any child which completed
+    //  synchronously, and if none are found, wait for a process to
+    //  complete.
+    //
+
+    if (Scheduler->CompletionPort == NULL) {
+        Count = 0;
+        for (Index = 0; Index < Scheduler->NumberSlots; Index++) {
+            ChildRecipe = &Scheduler->ChildRecipeArray[Index];
+            if (ChildRecipe->InUse) {
+                if (ChildRecipe->ProcessHandle == NULL) {
+                    return ChildRecipe;
+                }
+                Scheduler->ProcessHandleArray[Count] = ChildRecipe->ProcessHandle;
+                Scheduler->ProcessSlotArray[Count] = Index;
+                Count++;
+            }
+        }
+
+        ASSERT(Count == Scheduler->NumberActive);
+        Index = (YORI_ALLOC_SIZE_T)(WaitForMultipleObjectsEx(Count, Scheduler->ProcessHandleArray, FALSE, INFINITE, FALSE) - WAIT_OBJECT_0);
+        ASSERT(Index < Count);
+        return &Scheduler->ChildRecipeArray[Scheduler->ProcessSlotArray[Index]];
+    }
+
+    while (TRUE) {
+        Timeout = INFINITE;
+        if (Scheduler->NumberUnmonitored > 0) {
+            Timeout = MAKE_UNMONITORED_CHILD_POLL_INTERVAL;
+        }
+
+        if (YoriLibGetJobCompletionMessage(Scheduler->CompletionPort, Timeout, &Message, &Key, &Data)) {
+            ChildRecipe = (PMAKE_CHILD_RECIPE)Key;
+            ASSERT(ChildRecipe->InUse);
+
+            if (Message == MAKE_CHILD_MSG_SYNCHRONOUS_COMPLETION) {
+                return ChildRecipe;
+            }
+
+            //
+            //  Job objects report on every process within the job, which
+            //  includes anything the child launched.  Only the child itself
+            //  indicates the command is complete.  Notifications can also
+            //  arrive for a job which has been closed, which may refer to a
+            //  process from an earlier command, so check that the current
+            //  process really has terminated.
+            //
+
+            if ((Message == YORI_JOB_OBJECT_MSG_EXIT_PROCESS ||
+                 Message == YORI_JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS) &&
+                ChildRecipe->JobObject != NULL &&
+                (DWORD)Data == ChildRecipe->ProcessId &&
+                WaitForSingleObject(ChildRecipe->ProcessHandle, 0) == WAIT_OBJECT_0) {
+
+                CloseHandle(ChildRecipe->JobObject);
+                ChildRecipe->JobObject = NULL;
+                return ChildRecipe;
+            }
+
+            continue;
+        }
+
+        if (Scheduler->NumberUnmonitored > 0) {
+            for (Index = 0; Index < Scheduler->NumberSlots; Index++) {
+                ChildRecipe = &Scheduler->ChildRecipeArray[Index];
+                if (ChildRecipe->InUse &&
+                    ChildRecipe->Unmonitored &&
+                    WaitForSingleObject(ChildRecipe->ProcessHandle, 0) == WAIT_OBJECT_0) {
+
+                    ChildRecipe->Unmonitored = FALSE;
+                    Scheduler->NumberUnmonitored--;
+                    return ChildRecipe;
+                }
+            }
+        }
+    }
+}
+
 /**
  Execute commands required to build the requested target.
 
@@ -1007,49 +1807,62 @@ MakeExecuteRequiredTargets(
     __in PMAKE_CONTEXT MakeContext
     )
 {
-
-    YORI_ALLOC_SIZE_T NumberActiveProcesses;
-    DWORD Index;
-    HANDLE *ProcessHandleArray;
-    PMAKE_CHILD_RECIPE ChildRecipeArray;
+    MAKE_CHILD_SCHEDULER Scheduler;
+    PMAKE_CHILD_RECIPE ChildRecipe;
+    PMAKE_TARGET RemoteTarget;
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER EndTime;
     BOOLEAN Result;
+    BOOLEAN Remote;
     BOOLEAN MoveToNextTarget;
     BOOLEAN TargetFailureObserved;
 
-    NumberActiveProcesses = 0;
     TargetFailureObserved = FALSE;
 
-    ProcessHandleArray = YoriLibMalloc(MakeContext->NumberProcesses * sizeof(HANDLE));
-    if (ProcessHandleArray == NULL) {
+    if (!MakeInitializeChildScheduler(MakeContext, &Scheduler)) {
         return FALSE;
     }
 
-    ZeroMemory(ProcessHandleArray, MakeContext->NumberProcesses * sizeof(HANDLE));
-
-    ChildRecipeArray = YoriLibMalloc(MakeContext->NumberProcesses * sizeof(MAKE_CHILD_RECIPE));
-    if (ChildRecipeArray == NULL) {
-        YoriLibFree(ProcessHandleArray);
-        return FALSE;
-    }
-
-    ZeroMemory(ChildRecipeArray, MakeContext->NumberProcesses * sizeof(MAKE_CHILD_RECIPE));
+    QueryPerformanceFrequency(&Frequency);
     Result = TRUE;
 
     while (TRUE) {
 
-        while (NumberActiveProcesses < MakeContext->NumberProcesses && !YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
+        while (!YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
+
+            //
+            //  Local slots can execute any target, so fill those first.
+            //  Once they are busy, remote slots can execute a hermetic
+            //  target, which is moved to the front of the ready list even if
+            //  it is not on the critical path, because the alternative is
+            //  leaving the remote slot idle.
+            //
+
+            Remote = FALSE;
+            if (Scheduler.NumberActive - Scheduler.NumberRemoteActive >= MakeContext->NumberProcesses) {
+                RemoteTarget = MakeFindReadyRemoteTarget(MakeContext, &Scheduler);
+                if (RemoteTarget == NULL) {
+                    break;
+                }
+                YoriLibRemoveListItem(&RemoteTarget->RebuildList);
+                YoriLibInsertList(&MakeContext->TargetsReady, &RemoteTarget->RebuildList);
+                Remote = TRUE;
+            }
+
             if (!MakeCompleteReadyWithNoRecipe(MakeContext)) {
-                if (!MakeLaunchNextTarget(MakeContext, &ChildRecipeArray[NumberActiveProcesses])) {
+                ChildRecipe = MakeAllocateChildSlot(&Scheduler, Remote);
+                if (!MakeLaunchNextTarget(MakeContext, ChildRecipe)) {
+                    MakeFreeChildSlot(&Scheduler, ChildRecipe);
                     Result = FALSE;
                     goto Drain;
                 }
-                NumberActiveProcesses++;
+                MakeMonitorChild(&Scheduler, ChildRecipe);
             }
         }
 
-        while (NumberActiveProcesses == MakeContext->NumberProcesses || YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
+        while (!MakeCanLaunchReadyTarget(MakeContext, &Scheduler)) {
 
-            if (NumberActiveProcesses == 0) {
+            if (Scheduler.NumberActive == 0) {
                 break;
             }
 
@@ -1057,22 +1870,12 @@ MakeExecuteRequiredTargets(
             //  A process handle can be NULL if either a command failed to
             //  launch but was prefixed with - indicating failures should be
             //  ignored; or if it's a builtin command that completed
-            //  synchronously.  In either case rather than wait, just process
-            //  as if this command completed and move to the next command or
-            //  target.
+            //  synchronously.  In either case the scheduler will return it
+            //  as if this command completed so processing can move to the
+            //  next command or target.
             //
 
-            for (Index = 0; Index < NumberActiveProcesses; Index++) {
-                ProcessHandleArray[Index] = ChildRecipeArray[Index].ProcessHandle;
-                if (ProcessHandleArray[Index] == NULL) {
-                    break;
-                }
-            }
-
-            if (Index == NumberActiveProcesses) {
-                Index = WaitForMultipleObjectsEx(NumberActiveProcesses, ProcessHandleArray, FALSE, INFINITE, FALSE);
-                Index = Index - WAIT_OBJECT_0;
-            }
+            ChildRecipe = MakeWaitForChildCompletion(&Scheduler);
 
             //
             //  Check if the process succeeded.  If so, and there are more
@@ -1080,47 +1883,47 @@ MakeExecuteRequiredTargets(
             //
 
             MoveToNextTarget = TRUE;
-            Result = MakeProcessCompletion(MakeContext, &ChildRecipeArray[Index]);
+            Result = MakeProcessCompletion(MakeContext, ChildRecipe);
             if (Result) {
-                if (MakeDoesTargetHaveMoreCommands(&ChildRecipeArray[Index])) {
-                    if (MakeLaunchNextCmd(MakeContext, &ChildRecipeArray[Index])) {
+                if (MakeDoesTargetHaveMoreCommands(ChildRecipe)) {
+                    if (MakeLaunchNextCmd(MakeContext, ChildRecipe)) {
                         MoveToNextTarget = FALSE;
+                        MakeMonitorChild(&Scheduler, ChildRecipe);
                     } else {
                         Result = FALSE;
                     }
                 } else {
-                    MakeRecipeCompletion(MakeContext, &ChildRecipeArray[Index]);
+                    MakeRecipeCompletion(MakeContext, ChildRecipe);
                 }
             }
 
             //
-            //  If we are moving to the next target, overwrite this child
-            //  process with the executing ones, and launch a new target.
-            //  If we failed, we still need to move up all of the executing
-            //  ones to facilitate drain.
+            //  If we are moving to the next target, return this child to the
+            //  scheduler so it can be used to launch a new target.
             //
 
             if (MoveToNextTarget) {
                 if (Result) {
-                    MakeUpdateDependenciesForTarget(MakeContext, ChildRecipeArray[Index].Target);
+                    QueryPerformanceCounter(&EndTime);
+                    MakeRecordTargetDuration(MakeContext,
+                                             ChildRecipe->Target,
+                                             (DWORD)((EndTime.QuadPart - ChildRecipe->RecipeStartTime.QuadPart) * 1000 / Frequency.QuadPart));
+                    MakeTraceRecordEvent(MakeContext,
+                                         _T("target"),
+                                         &ChildRecipe->Target->HashEntry.Key,
+                                         ChildRecipe->JobId + 1,
+                                         &ChildRecipe->RecipeStartTime,
+                                         &EndTime,
+                                         NULL,
+                                         EXIT_SUCCESS);
+                    MakeSaveTargetToCache(MakeContext, ChildRecipe->Target);
+                    MakeCompleteHeaderDependencies(MakeContext, ChildRecipe->Target);
+                    MakeUpdateDependenciesForTarget(MakeContext, ChildRecipe->Target);
                 } else {
-                    MakeRecipeCompletion(MakeContext, &ChildRecipeArray[Index]);
+                    MakeRecipeCompletion(MakeContext, ChildRecipe);
                 }
 
-                if (NumberActiveProcesses > (YORI_ALLOC_SIZE_T)(Index + 1)) {
-                    memmove(&ChildRecipeArray[Index],
-                            &ChildRecipeArray[Index + 1],
-                            (NumberActiveProcesses - Index - 1) * sizeof(MAKE_CHILD_RECIPE));
-                }
-
-                NumberActiveProcesses--;
-
-                //
-                //  Everything in the final entry has been moved to earlier
-                //  entries, so the final entry is uninitialized.
-                //
-
-                ZeroMemory(&ChildRecipeArray[NumberActiveProcesses], sizeof(MAKE_CHILD_RECIPE));
+                MakeFreeChildSlot(&Scheduler, ChildRecipe);
             }
 
             if (Result == FALSE) {
@@ -1138,7 +1941,7 @@ MakeExecuteRequiredTargets(
         //  be anything left to do or something is horribly wrong.
         //
 
-        if (NumberActiveProcesses == 0 && YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
+        if (Scheduler.NumberActive == 0 && YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
             ASSERT(MakeContext->KeepGoing || YoriLibIsListEmpty(&MakeContext->TargetsWaiting));
             break;
         }
@@ -1150,40 +1953,14 @@ MakeExecuteRequiredTargets(
 
 Drain:
 
-    while (NumberActiveProcesses > 0) {
-        for (Index = 0; Index < NumberActiveProcesses; Index++) {
-            if (ChildRecipeArray[Index].ProcessHandle == NULL) {
-                break;
-            }
-            ProcessHandleArray[Index] = ChildRecipeArray[Index].ProcessHandle;
-        }
-
-        //
-        //  If all have active processes, wait for one to complete, then clean
-        //  up the one that did.  If Index != NumberActiveProcesses, it means
-        //  no handle was found above, so there's nothing to wait for, and
-        //  the entry needs to be cleaned up.
-        //
-
-        if (Index == NumberActiveProcesses) {
-            Index = WaitForMultipleObjectsEx(NumberActiveProcesses, ProcessHandleArray, FALSE, INFINITE, FALSE);
-            Index = Index - WAIT_OBJECT_0;
-        }
-
-        MakeProcessCompletion(MakeContext, &ChildRecipeArray[Index]);
-        MakeRecipeCompletion(MakeContext, &ChildRecipeArray[Index]);
-
-        if (NumberActiveProcesses > Index + 1) {
-            memmove(&ChildRecipeArray[Index],
-                    &ChildRecipeArray[Index + 1],
-                    (NumberActiveProcesses - Index - 1) * sizeof(MAKE_CHILD_RECIPE));
-        }
-
-        NumberActiveProcesses--;
+    while (Scheduler.NumberActive > 0) {
+        ChildRecipe = MakeWaitForChildCompletion(&Scheduler);
+        MakeProcessCompletion(MakeContext, ChildRecipe);
+        MakeRecipeCompletion(MakeContext, ChildRecipe);
+        MakeFreeChildSlot(&Scheduler, ChildRecipe);
     }
 
-    YoriLibFree(ChildRecipeArray);
-    YoriLibFree(ProcessHandleArray);
+    MakeCleanupChildScheduler(&Scheduler);
 
     return Result;
 }
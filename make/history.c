@@ -0,0 +1,411 @@
+/**
+ * @file make/history.c
+ *
+ * Yori shell make recipe duration history and critical path ordering
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ The duration to assume for a target with a recipe when no history is
+ available and no other target has history to derive an average from.
+ This value is arbitrary; it causes the critical path to be based on the
+ number of recipes along it.
+ */
+#define MAKE_DEFAULT_RECIPE_DURATION (1)
+
+/**
+ Load previously recorded recipe durations from the history file.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.  If this
+        contains a string, it will be used as the base name for the history
+        file.
+ */
+VOID
+MakeLoadTargetDurationHistory(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    )
+{
+    PMAKE_TARGET_DURATION_ENTRY Entry;
+    YORI_STRING HistoryFileName;
+    YORI_STRING Key;
+    YORI_STRING LineString;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    YORI_MAX_SIGNED_T llTemp;
+    DWORDLONG TotalDuration;
+    DWORD EntryCount;
+    HANDLE hHistory;
+    PVOID LineContext = NULL;
+
+    if (MakeContext->TargetDurations == NULL) {
+        return;
+    }
+
+    if (!MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prt"), &HistoryFileName)) {
+        return;
+    }
+
+    hHistory = CreateFile(HistoryFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    YoriLibFreeStringContents(&HistoryFileName);
+    if (hHistory == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+    TotalDuration = 0;
+    EntryCount = 0;
+
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hHistory)) {
+            break;
+        }
+
+        //
+        //  The format of each line is expected to be:
+        //  DurationInMs:TargetName
+        //
+
+        if (!YoriLibStringToNumber(&LineString, FALSE, &llTemp, &CharsConsumed) ||
+            CharsConsumed == 0 ||
+            CharsConsumed + 1 >= LineString.LengthInChars ||
+            LineString.StartOfString[CharsConsumed] != ':') {
+
+            break;
+        }
+
+        Entry = YoriLibMalloc(sizeof(MAKE_TARGET_DURATION_ENTRY));
+        if (Entry == NULL) {
+            break;
+        }
+
+        ZeroMemory(Entry, sizeof(MAKE_TARGET_DURATION_ENTRY));
+        Entry->Duration = (DWORD)llTemp;
+
+        //
+        //  Copy the trailing portion of the line so the hash package has
+        //  an allocation that won't go away
+        //
+
+        if (!YoriLibAllocateString(&Key, LineString.LengthInChars - CharsConsumed)) {
+            YoriLibFree(Entry);
+            break;
+        }
+
+        Key.LengthInChars = LineString.LengthInChars - CharsConsumed - 1;
+        memcpy(Key.StartOfString, &LineString.StartOfString[CharsConsumed + 1], Key.LengthInChars * sizeof(TCHAR));
+        Key.StartOfString[Key.LengthInChars] = '\0';
+
+        if (YoriLibHashLookupByKey(MakeContext->TargetDurations, &Key) == NULL) {
+            YoriLibHashInsertByKey(MakeContext->TargetDurations, &Key, Entry, &Entry->HashEntry);
+            YoriLibAppendList(&MakeContext->TargetDurationList, &Entry->ListEntry);
+            TotalDuration = TotalDuration + Entry->Duration;
+            EntryCount++;
+        } else {
+            YoriLibFree(Entry);
+        }
+
+        YoriLibFreeStringContents(&Key);
+    }
+
+    if (EntryCount > 0) {
+        MakeContext->AverageTargetDuration = (DWORD)(TotalDuration / EntryCount);
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hHistory);
+}
+
+/**
+ Deallocate all recipe duration history and optionally write it to a file.
+
+ @param MakeContext Pointer to the context.
+
+ @param MakeFileName Pointer to the file name of the makefile.  If this
+        contains a string, it will be used as the base name for the history
+        file.
+ */
+VOID
+MakeSaveAndDeleteTargetDurationHistory(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET_DURATION_ENTRY Entry;
+    YORI_STRING HistoryFileName;
+    HANDLE hHistory;
+
+    if (MakeContext->TargetDurations == NULL) {
+        return;
+    }
+
+    hHistory = NULL;
+    if (!YoriLibIsListEmpty(&MakeContext->TargetDurationList) &&
+        MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".prt"), &HistoryFileName)) {
+
+        hHistory = CreateFile(HistoryFileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hHistory == INVALID_HANDLE_VALUE) {
+            hHistory = NULL;
+        }
+        YoriLibFreeStringContents(&HistoryFileName);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetDurationList, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_TARGET_DURATION_ENTRY, ListEntry);
+
+        if (hHistory != NULL) {
+            YoriLibOutputToDevice(hHistory, 0, _T("%i:%y\n"), Entry->Duration, &Entry->HashEntry.Key);
+        }
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibHashRemoveByEntry(&Entry->HashEntry);
+        YoriLibFree(Entry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetDurationList, NULL);
+    }
+    YoriLibFreeEmptyHashTable(MakeContext->TargetDurations);
+    MakeContext->TargetDurations = NULL;
+
+    if (hHistory != NULL) {
+        CloseHandle(hHistory);
+    }
+}
+
+/**
+ Record the time taken to execute the recipe for a target, so that it can
+ be used to order execution in a later build.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target whose recipe has completed.
+
+ @param Duration The time taken to execute the recipe, in milliseconds.
+ */
+VOID
+MakeRecordTargetDuration(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __in DWORD Duration
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_TARGET_DURATION_ENTRY Entry;
+
+    if (MakeContext->TargetDurations == NULL) {
+        return;
+    }
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->TargetDurations, &Target->HashEntry.Key);
+    if (HashEntry != NULL) {
+        Entry = CONTAINING_RECORD(HashEntry, MAKE_TARGET_DURATION_ENTRY, HashEntry);
+        Entry->Duration = Duration;
+        return;
+    }
+
+    Entry = YoriLibMalloc(sizeof(MAKE_TARGET_DURATION_ENTRY));
+    if (Entry == NULL) {
+        return;
+    }
+
+    ZeroMemory(Entry, sizeof(MAKE_TARGET_DURATION_ENTRY));
+    Entry->Duration = Duration;
+
+    YoriLibHashInsertByKey(MakeContext->TargetDurations, &Target->HashEntry.Key, Entry, &Entry->HashEntry);
+    YoriLibAppendList(&MakeContext->TargetDurationList, &Entry->ListEntry);
+}
+
+/**
+ Return the expected time to execute the recipe for a single target.  If
+ the target has been built previously, this is the time it took then.  If
+ not, an average of other targets is used.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @return The expected duration of the recipe.
+ */
+DWORD
+MakeGetExpectedTargetDuration(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_TARGET_DURATION_ENTRY Entry;
+
+    if (YoriLibIsListEmpty(&Target->ExecCmds)) {
+        return 0;
+    }
+
+    if (MakeContext->TargetDurations != NULL) {
+        HashEntry = YoriLibHashLookupByKey(MakeContext->TargetDurations, &Target->HashEntry.Key);
+        if (HashEntry != NULL) {
+            Entry = CONTAINING_RECORD(HashEntry, MAKE_TARGET_DURATION_ENTRY, HashEntry);
+            return Entry->Duration;
+        }
+    }
+
+    if (MakeContext->AverageTargetDuration != 0) {
+        return MakeContext->AverageTargetDuration;
+    }
+
+    return MAKE_DEFAULT_RECIPE_DURATION;
+}
+
+/**
+ Calculate the critical path for a target, being the expected time to
+ execute this target and the longest chain of targets that depend on it.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @return The critical path duration for the target.
+ */
+DWORDLONG
+MakeCalculateCriticalPathForTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET_DEPENDENCY Dependency;
+    DWORDLONG LongestChild;
+    DWORDLONG ChildPath;
+
+    if (Target->CriticalPathCalculated) {
+        return Target->CriticalPathDuration;
+    }
+
+    LongestChild = 0;
+    ListEntry = YoriLibGetNextListEntry(&Target->ChildDependents, NULL);
+    while (ListEntry != NULL) {
+        Dependency = CONTAINING_RECORD(ListEntry, MAKE_TARGET_DEPENDENCY, ParentDependents);
+        if (Dependency->Child->RebuildRequired) {
+            ChildPath = MakeCalculateCriticalPathForTarget(MakeContext, Dependency->Child);
+            if (ChildPath > LongestChild) {
+                LongestChild = ChildPath;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&Target->ChildDependents, ListEntry);
+    }
+
+    Target->CriticalPathDuration = LongestChild + MakeGetExpectedTargetDuration(MakeContext, Target);
+    Target->CriticalPathCalculated = TRUE;
+    return Target->CriticalPathDuration;
+}
+
+/**
+ Insert a target into the ready list, ordered such that targets with the
+ longest critical path are executed first.  Targets with equal critical
+ paths are executed in the order they became ready.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target which is ready to execute.
+ */
+VOID
+MakeInsertReadyTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET Existing;
+
+    //
+    //  Search from the tail since targets with similar paths, such as
+    //  many compilation steps feeding one link, are common and can be
+    //  appended without traversing the list.
+    //
+
+    ListEntry = YoriLibGetPreviousListEntry(&MakeContext->TargetsReady, NULL);
+    while (ListEntry != NULL) {
+        Existing = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        if (Existing->CriticalPathDuration >= Target->CriticalPathDuration) {
+            break;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&MakeContext->TargetsReady, ListEntry);
+    }
+
+    if (ListEntry == NULL) {
+        YoriLibInsertList(&MakeContext->TargetsReady, &Target->RebuildList);
+    } else {
+        YoriLibInsertList(ListEntry, &Target->RebuildList);
+    }
+}
+
+/**
+ Calculate the critical path for all targets requiring rebuild, and order
+ the ready list so the targets with the longest critical path are executed
+ first.  This is performed once the dependency graph is complete.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeCalculateCriticalPaths(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    YORI_LIST_ENTRY Unsorted;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET Target;
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsWaiting, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        MakeCalculateCriticalPathForTarget(MakeContext, Target);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsWaiting, ListEntry);
+    }
+
+    //
+    //  Move everything from the ready list to a temporary list, then
+    //  reinsert in sorted order.
+    //
+
+    YoriLibInitializeListHead(&Unsorted);
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
+    while (ListEntry != NULL) {
+        YoriLibRemoveListItem(ListEntry);
+        YoriLibAppendList(&Unsorted, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Unsorted, NULL);
+    while (ListEntry != NULL) {
+        YoriLibRemoveListItem(ListEntry);
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        MakeCalculateCriticalPathForTarget(MakeContext, Target);
+        MakeInsertReadyTarget(MakeContext, Target);
+        ListEntry = YoriLibGetNextListEntry(&Unsorted, NULL);
+    }
+}
+
+// vim:sw=4:ts=4:et:
@@ -37,17 +37,24 @@ CHAR strMakeHelpText[] =
         "\n"
         "Execute makefiles.\n"
         "\n"
-        "YMAKE [-license] [-f file] [-j n] [-m] [-perf] [-pru] [-s] [var=value] [target]\n"
+        "YMAKE [-license] [-cache dir] [-deps] [-f file] [-j n] [-jr n] [-m] [-perf] [-prefetch] [-pru] [-prushare file] [-remote cmd] [-s] [-trace file] [var=value] [target]\n"
         "\n"
         "   --             Treat all further arguments as display parameters\n"
+        "   -cache         Restore and save target outputs in a content addressed cache\n"
+        "   -deps          Record headers reported by /showIncludes and rebuild when they change\n"
         "   -f             Name of the makefile to use, default YMkFile or Makefile\n"
         "   -j             The number of child processes, default number of processors+1\n"
+        "   -jr            With -remote, the number of remote recipes, default same as -j\n"
         "   -k             Keep executing jobs after errors\n"
         "   -m             Perform tasks at low priority\n"
         "   -mm            Perform tasks at very low priority\n"
         "   -perf          Display how much time was spent in each phase of processing\n"
-        "   -pru           Keep a cache of preprocessor recently executed results\n"
-        "   -s             Silently launch child processes\n";
+        "   -prefetch      Read subdirectory makefiles on background threads\n"
+        "   -pru           Keep a cache of preprocessor results, recipe durations and build state\n"
+        "   -prushare      With -pru, share preprocessor results with other makefiles via file\n"
+        "   -remote        Execute recipes whose commands are all prefixed with ^ via cmd\n"
+        "   -s             Silently launch child processes\n"
+        "   -trace         Write the time spent in each phase and command to a trace file\n";
 
 
 /**
@@ -86,8 +93,13 @@ typedef struct _MAKE_DEFAULT_MACRO {
  to skip that extra parameter when parsing variables or targets.
  */
 CONST YORI_STRING MakeArgsWithParameter[] = {
+    YORILIB_CONSTANT_STRING(_T("cache")),
     YORILIB_CONSTANT_STRING(_T("f")),
-    YORILIB_CONSTANT_STRING(_T("j"))
+    YORILIB_CONSTANT_STRING(_T("j")),
+    YORILIB_CONSTANT_STRING(_T("jr")),
+    YORILIB_CONSTANT_STRING(_T("prushare")),
+    YORILIB_CONSTANT_STRING(_T("remote")),
+    YORILIB_CONSTANT_STRING(_T("trace"))
 };
 
 /**
@@ -104,20 +116,10 @@ CONST MAKE_DEFAULT_MACRO MakeDefaultMacros[] = {
 
 /**
  A structure defining a mapping between a command name and a function to
- execute.  This is used to populate builtin commands.
+ execute.  This is used to populate builtin commands, and tables of these
+ must be sorted by command name.
  */
-typedef struct _MAKE_BUILTIN_NAME_MAPPING {
-
-    /**
-     The command name.
-     */
-    LPTSTR CommandName;
-
-    /**
-     Pointer to the function to execute.
-     */
-    PYORI_CMD_BUILTIN BuiltinFn;
-} MAKE_BUILTIN_NAME_MAPPING, *PMAKE_BUILTIN_NAME_MAPPING;
+typedef YORI_LIBSH_BUILTIN_NAME_MAPPING MAKE_BUILTIN_NAME_MAPPING, *PMAKE_BUILTIN_NAME_MAPPING;
 
 /**
  Declaration for the builtin command.
@@ -144,7 +146,10 @@ YORI_CMD_BUILTIN YoriCmd_YRMDIR;
  */
 CONST MAKE_BUILTIN_NAME_MAPPING
 MakeBuiltinCmds[] = {
+    {_T("COPY"),      MakeBuiltinCopy},
+    {_T("DEL"),       MakeBuiltinErase},
     {_T("ECHO"),      YoriCmd_YECHO},
+    {_T("ERASE"),     MakeBuiltinErase},
     {_T("MKDIR"),     YoriCmd_YMKDIR},
     {_T("REM"),       YoriCmd_REM},
     {_T("RMDIR"),     YoriCmd_YRMDIR},
@@ -359,6 +364,8 @@ ENTRYPOINT(
     YORI_STRING FullFileName;
     LARGE_INTEGER StartTime;
     LARGE_INTEGER EndTime;
+    LARGE_INTEGER PhaseStartTime;
+    LARGE_INTEGER PhaseEndTime;
     HANDLE hStream;
     YORI_STRING Arg;
     YORI_STRING RootDir;
@@ -367,6 +374,7 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T CharsConsumed;
     MAKE_PRIORITY Priority;
     BOOLEAN ExplicitTargetFound;
+    BOOLEAN NothingToBuild;
     WORD PerformanceProcessors;
     WORD EfficiencyProcessors;
 
@@ -381,23 +389,29 @@ ENTRYPOINT(
     YoriLibInitializeListHead(&MakeContext.TargetsReady);
     YoriLibInitializeListHead(&MakeContext.TargetsWaiting);
     YoriLibInitializeListHead(&MakeContext.PreprocessorCacheList);
+    YoriLibInitializeListHead(&MakeContext.SpeculativeProbeList);
+    YoriLibInitializeListHead(&MakeContext.TargetDurationList);
+    YoriLibInitializeListHead(&MakeContext.BuildDbInputList);
+    YoriLibInitializeListHead(&MakeContext.DirectoryListingList);
+    YoriLibInitializeListHead(&MakeContext.HeaderDependencyList);
     YoriLibInitEmptyString(&FullFileName);
-    Priority = MakePriorityNormal;
-    ExplicitTargetFound = FALSE;
 
-    {
-        MAKE_BUILTIN_NAME_MAPPING CONST *BuiltinNameMapping = MakeBuiltinCmds;
+    if (!YoriLibInitializeSlab(&MakeContext.TargetAllocator, sizeof(MAKE_TARGET))) {
+        return EXIT_FAILURE;
+    }
 
-        while (BuiltinNameMapping->CommandName != NULL) {
-            YORI_STRING YsCommandName;
+    if (!YoriLibInitializeSlab(&MakeContext.DependencyAllocator, sizeof(MAKE_TARGET_DEPENDENCY))) {
+        YoriLibCleanupSlab(&MakeContext.TargetAllocator);
+        return EXIT_FAILURE;
+    }
 
-            YoriLibConstantString(&YsCommandName, BuiltinNameMapping->CommandName);
-            if (!YoriLibShBuiltinRegister(&YsCommandName, BuiltinNameMapping->BuiltinFn)) {
-                Result = EXIT_FAILURE;
-                goto Cleanup;
-            }
-            BuiltinNameMapping++;
-        }
+    Priority = MakePriorityNormal;
+    ExplicitTargetFound = FALSE;
+    YoriLibEtwRegister();
+
+    if (!YoriLibShBuiltinRegisterStaticTable(MakeBuiltinCmds)) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
     }
 
     CharsConsumed = (YORI_ALLOC_SIZE_T)GetCurrentDirectory(0, NULL);
@@ -443,12 +457,18 @@ ENTRYPOINT(
         goto Cleanup;
     }
 
-    MakeContext.Targets = YoriLibAllocateHashTable(4000);
+    MakeContext.Targets = YoriLibAllocateGrowableHashTable(4000);
     if (MakeContext.Targets == NULL) {
         Result = EXIT_FAILURE;
         goto Cleanup;
     }
 
+    MakeContext.Names = YoriLibAllocateStringPool(4000);
+    if (MakeContext.Names == NULL) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
+    }
+
     for (i = 1; i < ArgC; i++) {
 
         ArgumentUnderstood = FALSE;
@@ -463,6 +483,24 @@ ENTRYPOINT(
                 YoriLibDisplayMitLicense(_T("2021"));
                 Result = EXIT_SUCCESS;
                 goto Cleanup;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("cache")) == 0) {
+                if (i + 1 < ArgC) {
+                    MakeCleanupOutputCache(&MakeContext);
+                    if (!MakeInitializeOutputCache(&MakeContext, &ArgV[i + 1])) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                    ArgumentUnderstood = TRUE;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("deps")) == 0) {
+                if (MakeContext.HeaderDependencies == NULL) {
+                    MakeContext.HeaderDependencies = YoriLibAllocateHashTable(1000);
+                    if (MakeContext.HeaderDependencies == NULL) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                }
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("f")) == 0) {
                 if (i + 1 < ArgC) {
                     FileName = &ArgV[i + 1];
@@ -475,6 +513,13 @@ ENTRYPOINT(
                         ArgumentUnderstood = TRUE;
                     }
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("jr")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        MakeContext.NumberRemoteProcesses = (YORI_ALLOC_SIZE_T)llTemp;
+                        ArgumentUnderstood = TRUE;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("k")) == 0) {
                 MakeContext.KeepGoing = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -489,6 +534,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
                 MakeContext.PerfDisplay = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("prefetch")) == 0) {
+                MakeContext.Prefetch.Enabled = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("pru")) == 0) {
                 if (MakeContext.PreprocessorCache == NULL) {
                     MakeContext.PreprocessorCache = YoriLibAllocateHashTable(100);
@@ -497,11 +545,58 @@ ENTRYPOINT(
                         goto Cleanup;
                     }
                 }
+                if (MakeContext.SpeculativeProbes == NULL) {
+                    MakeContext.SpeculativeProbes = YoriLibAllocateHashTable(100);
+                    if (MakeContext.SpeculativeProbes == NULL) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                }
+                if (MakeContext.TargetDurations == NULL) {
+                    MakeContext.TargetDurations = YoriLibAllocateHashTable(1000);
+                    if (MakeContext.TargetDurations == NULL) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                }
+                if (MakeContext.BuildDbInputs == NULL) {
+                    MakeContext.BuildDbInputs = YoriLibAllocateHashTable(250);
+                    if (MakeContext.BuildDbInputs == NULL) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                }
                 ArgumentUnderstood = TRUE;
 
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("prushare")) == 0) {
+                if (i + 1 < ArgC) {
+                    YoriLibFreeStringContents(&MakeContext.SharedPreprocessorCacheFileName);
+                    if (!YoriLibUserStringToSingleFilePath(&ArgV[i + 1], TRUE, &MakeContext.SharedPreprocessorCacheFileName)) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                    ArgumentUnderstood = TRUE;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("remote")) == 0) {
+                if (i + 1 < ArgC) {
+                    YoriLibFreeStringContents(&MakeContext.RemoteLauncher);
+                    if (!YoriLibCopyString(&MakeContext.RemoteLauncher, &ArgV[i + 1])) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                    ArgumentUnderstood = TRUE;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 MakeContext.SilentCommandLaunching = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("trace")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (!MakeTraceInitialize(&MakeContext, &ArgV[i + 1])) {
+                        Result = EXIT_FAILURE;
+                        goto Cleanup;
+                    }
+                    ArgumentUnderstood = TRUE;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("wundef")) == 0) {
                 MakeContext.WarnOnUndefinedVariable = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -609,12 +704,15 @@ ENTRYPOINT(
     }
 
     //
-    //  WaitForMultipleObjects has a limit of 64 things to wait for, so this
-    //  program can't currently have more than 64 children.
+    //  Remote slots only exist if there is a launcher to use them.  If one
+    //  is specified without a count, assume the build agents can absorb as
+    //  many recipes as this machine can.
     //
 
-    if (MakeContext.NumberProcesses > 64) {
-        MakeContext.NumberProcesses = 64;
+    if (MakeContext.RemoteLauncher.LengthInChars == 0) {
+        MakeContext.NumberRemoteProcesses = 0;
+    } else if (MakeContext.NumberRemoteProcesses == 0) {
+        MakeContext.NumberRemoteProcesses = MakeContext.NumberProcesses;
     }
 
     //
@@ -722,14 +820,41 @@ ENTRYPOINT(
 #endif
 
     //
-    //  When using a cache, try to load any cached preprocessor conditions for
-    //  this makefile.
+    //  If a previous invocation found nothing to build and nothing it
+    //  looked at has changed, there is nothing to build now either.  The
+    //  other caches haven't been loaded, so discard them without saving.
+    //
+
+    if (MakeContext.BuildDbInputs != NULL &&
+        MakeIsBuildDbCurrent(&MakeContext, &FullFileName, ArgC, ArgV)) {
+
+        YoriLibFreeEmptyHashTable(MakeContext.PreprocessorCache);
+        MakeContext.PreprocessorCache = NULL;
+        YoriLibFreeEmptyHashTable(MakeContext.SpeculativeProbes);
+        MakeContext.SpeculativeProbes = NULL;
+        YoriLibFreeEmptyHashTable(MakeContext.TargetDurations);
+        MakeContext.TargetDurations = NULL;
+        Result = EXIT_SUCCESS;
+        goto Cleanup;
+    }
+
+    //
+    //  When using a cache, try to load any cached preprocessor conditions and
+    //  recipe durations for this makefile.
     //
 
     if (MakeContext.PreprocessorCache != NULL) {
         MakeLoadPreprocessorCacheEntries(&MakeContext, &FullFileName);
     }
 
+    if (MakeContext.TargetDurations != NULL) {
+        MakeLoadTargetDurationHistory(&MakeContext, &FullFileName);
+    }
+
+    if (MakeContext.HeaderDependencies != NULL) {
+        MakeLoadHeaderDependencies(&MakeContext, &FullFileName);
+    }
+
     hStream = CreateFile(FullFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
     if (hStream == INVALID_HANDLE_VALUE) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("No makefile found\n"));
@@ -742,12 +867,14 @@ ENTRYPOINT(
     //
 
     QueryPerformanceCounter(&StartTime);
-    MakeProcessStream(hStream, &MakeContext, &FullFileName);
+    MakeProcessStream(hStream, &MakeContext, &FullFileName, NULL);
     QueryPerformanceCounter(&EndTime);
 
     MakeContext.TimeInPreprocessor = EndTime.QuadPart - StartTime.QuadPart;
+    MakeTraceRecordPhase(&MakeContext, _T("Preprocess"), &StartTime, &EndTime);
 
     CloseHandle(hStream);
+    MakeCleanupPrefetch(&MakeContext);
 
     if (MakeContext.ErrorTermination) {
         Result = EXIT_FAILURE;
@@ -762,6 +889,15 @@ ENTRYPOINT(
 
     QueryPerformanceCounter(&StartTime);
 
+    //
+    //  Find the timestamps of known targets in bulk, so that evaluating
+    //  dependencies doesn't need to open each file individually.
+    //
+
+    MakeProbeAllTargetFiles(&MakeContext);
+    QueryPerformanceCounter(&PhaseStartTime);
+    MakeTraceRecordPhase(&MakeContext, _T("Probe targets"), &StartTime, &PhaseStartTime);
+
     //
     //  Scan through command line arguments again, this time looking for
     //  targets to execute.
@@ -812,13 +948,31 @@ ENTRYPOINT(
         }
     }
 
+    QueryPerformanceCounter(&PhaseEndTime);
+    MakeTraceRecordPhase(&MakeContext, _T("Resolve dependencies"), &PhaseStartTime, &PhaseEndTime);
+
+    //
+    //  Now that all targets to build are known, order the ready list so
+    //  the longest chains of work start first.
+    //
+
+    MakeCalculateCriticalPaths(&MakeContext);
+
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeBuildingGraph = EndTime.QuadPart - StartTime.QuadPart;
+    MakeTraceRecordPhase(&MakeContext, _T("Calculate critical paths"), &PhaseEndTime, &EndTime);
 
     //
     //  Execute the tasks
     //
 
+    NothingToBuild = FALSE;
+    if (YoriLibIsListEmpty(&MakeContext.TargetsReady) &&
+        YoriLibIsListEmpty(&MakeContext.TargetsWaiting)) {
+
+        NothingToBuild = TRUE;
+    }
+
     StartTime.QuadPart = EndTime.QuadPart;
     if (!MakeExecuteRequiredTargets(&MakeContext)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Failed to build targets.\n"));
@@ -827,6 +981,16 @@ ENTRYPOINT(
     }
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeInExecute = EndTime.QuadPart - StartTime.QuadPart;
+    MakeTraceRecordPhase(&MakeContext, _T("Execute"), &StartTime, &EndTime);
+
+    //
+    //  If there was nothing to do, record everything that was used to
+    //  reach that conclusion, so the next invocation can reach it faster.
+    //
+
+    if (NothingToBuild && !MakeContext.ErrorTermination) {
+        MakeSaveBuildDb(&MakeContext, &FullFileName, ArgC, ArgV);
+    }
 
 
     Result = EXIT_SUCCESS;
@@ -835,6 +999,7 @@ Cleanup:
 
     QueryPerformanceCounter(&StartTime);
 
+    MakeCleanupPrefetch(&MakeContext);
     MakeDeleteInlineFiles(&MakeContext);
     MakeCleanupTemporaryDirectories(&MakeContext);
 
@@ -845,21 +1010,35 @@ Cleanup:
         MakeContext.RootScope = NULL;
     }
 
-    MakeSlabCleanup(&MakeContext.TargetAllocator);
-    MakeSlabCleanup(&MakeContext.DependencyAllocator);
+    YoriLibCleanupSlab(&MakeContext.TargetAllocator);
+    YoriLibCleanupSlab(&MakeContext.DependencyAllocator);
 
     MakeDeleteAllTargets(&MakeContext);
 
     if (MakeContext.Targets != NULL) {
-        YoriLibFreeEmptyHashTable(MakeContext.Targets);
+        YoriLibFreeEmptyGrowableHashTable(MakeContext.Targets);
     }
 
     MakeDeleteAllScopes(&MakeContext);
+
+    if (MakeContext.Names != NULL) {
+        YoriLibFreeStringPool(MakeContext.Names);
+    }
+
+    MakeDeleteAllSpeculativeProbes(&MakeContext);
+    MakeSaveSharedPreprocessorCacheEntries(&MakeContext);
     MakeSaveAndDeleteAllPreprocessorCacheEntries(&MakeContext, &FullFileName);
+    MakeSaveAndDeleteTargetDurationHistory(&MakeContext, &FullFileName);
+    MakeSaveAndDeleteHeaderDependencies(&MakeContext, &FullFileName);
+    MakeDeleteAllBuildDbInputs(&MakeContext);
+    MakeProbeCleanupDirectoryListings(&MakeContext);
+    MakeCleanupOutputCache(&MakeContext);
 
     YoriLibFreeStringContents(&FullFileName);
+    YoriLibFreeStringContents(&MakeContext.SharedPreprocessorCacheFileName);
 
     YoriLibFreeStringContents(&MakeContext.TempPath);
+    YoriLibFreeStringContents(&MakeContext.RemoteLauncher);
     YoriLibFreeStringContents(&MakeContext.ProcessCurrentDirectory);
     YoriLibFreeStringContents(&MakeContext.FilesToProbe[0]);
     YoriLibFreeStringContents(&MakeContext.FilesToProbe[1]);
@@ -874,6 +1053,9 @@ Cleanup:
 
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeInCleanup = EndTime.QuadPart - StartTime.QuadPart;
+    MakeTraceRecordPhase(&MakeContext, _T("Cleanup"), &StartTime, &EndTime);
+    MakeTraceCleanup(&MakeContext);
+    YoriLibEtwUnregister();
 
     if (MakeContext.PerfDisplay && Result == EXIT_SUCCESS) {
         LARGE_INTEGER Frequency;
@@ -896,6 +1078,8 @@ Cleanup:
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number dependency allocs: %i\n"), MakeContext.AllocDependency);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number inference rule allocs: %i\n"), MakeContext.AllocInferenceRule);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number target allocs: %i\n"), MakeContext.AllocTarget);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number target chunks: %i\n"), MakeContext.TargetAllocator.ChunksAllocated);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number dependency chunks: %i\n"), MakeContext.DependencyAllocator.ChunksAllocated);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number variable allocs: %i\n"), MakeContext.AllocVariable);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number variable data allocs: %i\n"), MakeContext.AllocVariableData);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Number expanded line allocs: %i\n"), MakeContext.AllocExpandedLine);
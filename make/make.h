@@ -58,35 +58,6 @@
  */
 #define MAKE_DEBUG_PERF         0
 
-
-/**
- A structure to record information about how to allocate fixed sized
- structures in groups.
- */
-typedef struct _MAKE_SLAB_ALLOC {
-
-    /**
-     The size of each element.
-     */
-    DWORD ElementSize;
-
-    /**
-     The number of elements allocated from the heap in the buffer array
-     below.
-     */
-    DWORD NumberAllocatedFromSystem;
-
-    /**
-     The number of elements from the buffer array below that have been used.
-     */
-    DWORD NumberAllocatedToCaller;
-
-    /**
-     An array of elements.
-     */
-    PVOID Buffer;
-} MAKE_SLAB_ALLOC, *PMAKE_SLAB_ALLOC;
-
 /**
  A record of the exitcode of a preprocessor command.  These can be recorded
  to save time on a subsequent compilation.
@@ -121,6 +92,12 @@ typedef struct _MAKE_PREPROC_EXEC_CACHE_ENTRY {
  */
 #define MAKE_DEFAULT_SCOPE_TARGET_NAME _T(":Default")
 
+/**
+ The length of the hash used to identify file contents when using the output
+ cache.  This is the length of a SHA1 hash.
+ */
+#define MAKE_CONTENT_HASH_LENGTH (20)
+
 /**
  Indicates the state of parsing, indicating whether the next line corresponds
  to an inline file, a recipe, or only rules are acceptable.
@@ -203,7 +180,7 @@ typedef struct _MAKE_SCOPE_CONTEXT {
      A hash table of known variables, used for regular lookup during
      line evaluation.
      */
-    PYORI_HASH_TABLE Variables;
+    PYORI_GROWABLE_HASH_TABLE Variables;
 
     /**
      A list of known variables, used to facilitate bulk delete.
@@ -313,6 +290,19 @@ typedef struct _MAKE_VARIABLE {
      */
     YORI_STRING Value;
 
+    /**
+     The most recent search and replace expression applied to the variable,
+     as in $(VARNAME:OLDTEXT=NEWTEXT).  Only meaningful if CachedExpansion
+     is allocated.
+     */
+    YORI_STRING CachedExpression;
+
+    /**
+     The result of applying CachedExpression to Value.  This is discarded
+     whenever the value changes.
+     */
+    YORI_STRING CachedExpansion;
+
 } MAKE_VARIABLE, *PMAKE_VARIABLE;
 
 /**
@@ -424,6 +414,13 @@ typedef struct _MAKE_CMD_TO_EXEC {
      */
     BOOLEAN IgnoreErrors;
 
+    /**
+     If the user prefixes a command with ^, the command is hermetic: it
+     depends only on its declared inputs and produces only its declared
+     outputs, so it can be executed via the remote launcher.
+     */
+    BOOLEAN Remote;
+
     /**
      The command string to execute.
      */
@@ -431,6 +428,94 @@ typedef struct _MAKE_CMD_TO_EXEC {
 
 } MAKE_CMD_TO_EXEC, *PMAKE_CMD_TO_EXEC;
 
+/**
+ A span within a compiled recipe line.  This is either literal text to copy
+ into the command, or the name of a variable to substitute.
+ */
+typedef struct _MAKE_RECIPE_SEGMENT {
+
+    /**
+     The literal text, or the variable name without $( and ).  This points
+     into MAKE_COMPILED_RECIPE::Source.
+     */
+    YORI_STRING Text;
+
+    /**
+     TRUE if Text refers to a variable name, FALSE if it is literal text.
+     */
+    BOOLEAN Variable;
+
+} MAKE_RECIPE_SEGMENT, *PMAKE_RECIPE_SEGMENT;
+
+/**
+ A single line within a compiled recipe.
+ */
+typedef struct _MAKE_RECIPE_LINE {
+
+    /**
+     FALSE if the line was prefixed with @.
+     */
+    BOOLEAN DisplayCmd;
+
+    /**
+     TRUE if the line was prefixed with -.
+     */
+    BOOLEAN IgnoreErrors;
+
+    /**
+     TRUE if the line was prefixed with ^.
+     */
+    BOOLEAN Remote;
+
+    /**
+     The index of the first segment for this line within
+     MAKE_COMPILED_RECIPE::Segments.
+     */
+    YORI_ALLOC_SIZE_T FirstSegment;
+
+    /**
+     The number of segments in this line.
+     */
+    YORI_ALLOC_SIZE_T SegmentCount;
+
+} MAKE_RECIPE_LINE, *PMAKE_RECIPE_LINE;
+
+/**
+ A recipe which has been split into lines and segments so that it can be
+ expanded for many targets without scanning the text each time.  This
+ structure is followed in memory by the arrays of lines and segments.
+ */
+typedef struct _MAKE_COMPILED_RECIPE {
+
+    /**
+     The recipe text that was compiled.  This holds a reference so that
+     segments remain valid, and allows a change to the recipe to be
+     detected.
+     */
+    YORI_STRING Source;
+
+    /**
+     The number of elements in Lines.
+     */
+    YORI_ALLOC_SIZE_T LineCount;
+
+    /**
+     The number of elements in Segments.
+     */
+    YORI_ALLOC_SIZE_T SegmentCount;
+
+    /**
+     An array of lines within the recipe.
+     */
+    PMAKE_RECIPE_LINE Lines;
+
+    /**
+     An array of segments for all lines within the recipe.
+     */
+    PMAKE_RECIPE_SEGMENT Segments;
+
+} MAKE_COMPILED_RECIPE, *PMAKE_COMPILED_RECIPE;
+
 /**
  Information describing a make target.  Note that a target is something that
  we might want to build, or may not be part of the current build process, or
@@ -555,6 +640,12 @@ typedef struct _MAKE_TARGET {
      */
     BOOLEAN InferenceRulePseudoTarget;
 
+    /**
+     TRUE if every command in the recipe is hermetic, so the recipe can be
+     executed in a remote slot.  FALSE if any command must run locally.
+     */
+    BOOLEAN RemoteEligible;
+
     /**
      The timestamp of the file.  This is only meaningful if FileExists is
      TRUE (implying FileProbed is also TRUE.)
@@ -583,14 +674,244 @@ typedef struct _MAKE_TARGET {
      */
     YORI_STRING Recipe;
 
+    /**
+     The recipe in compiled form, generated when the recipe is first used to
+     construct commands.  For an inference rule this is reused for each
+     target that the rule applies to.  NULL if not yet compiled.
+     */
+    PMAKE_COMPILED_RECIPE CompiledRecipe;
+
     /**
      The set of commands to execute to construct this target.  Paired with
      MAKE_CMD_TO_EXEC::ListEntry .
      */
     YORI_LIST_ENTRY ExecCmds;
 
+    /**
+     The expected time to execute this target and the longest chain of
+     targets that depend upon it, in milliseconds.  Targets with a longer
+     critical path are executed first.  This is only meaningful if
+     CriticalPathCalculated is TRUE.
+     */
+    DWORDLONG CriticalPathDuration;
+
+    /**
+     TRUE if CriticalPathDuration has been calculated for this target.
+     */
+    BOOLEAN CriticalPathCalculated;
+
+    /**
+     TRUE if ContentHash has been calculated for this target.
+     */
+    BOOLEAN ContentHashCalculated;
+
+    /**
+     A hash of the contents of the file for this target, used when the
+     output cache is in use to determine whether targets that depend on
+     this one have been built from identical inputs before.  This is only
+     meaningful if ContentHashCalculated is TRUE.
+     */
+    UCHAR ContentHash[MAKE_CONTENT_HASH_LENGTH];
+
 } MAKE_TARGET, *PMAKE_TARGET;
 
+/**
+ A record of the time taken to execute the recipe for a target in a
+ previous build.
+ */
+typedef struct _MAKE_TARGET_DURATION_ENTRY {
+
+    /**
+     The hash entry.  Key is the fully qualified path name of the target.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all duration entries, used to facilitate bulk delete.
+     Paired with MAKE_CONTEXT::TargetDurationList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The time taken to execute the recipe, in milliseconds.
+     */
+    DWORD Duration;
+
+} MAKE_TARGET_DURATION_ENTRY, *PMAKE_TARGET_DURATION_ENTRY;
+
+/**
+ A file that was read in order to construct the build graph, such as a
+ makefile or an include file.
+ */
+typedef struct _MAKE_BUILDDB_INPUT {
+
+    /**
+     The hash entry.  Key is the fully qualified path name of the file.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all inputs, used to facilitate bulk delete.  Paired
+     with MAKE_CONTEXT::BuildDbInputList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The last write time of the file when it was read.
+     */
+    LARGE_INTEGER ModifiedTime;
+
+} MAKE_BUILDDB_INPUT, *PMAKE_BUILDDB_INPUT;
+
+/**
+ The set of headers that a compiler reported reading when building a
+ target.
+ */
+typedef struct _MAKE_HEADER_DEPENDENCY_ENTRY {
+
+    /**
+     The hash entry.  Key is the fully qualified path name of the target.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all header dependency entries, used to facilitate bulk
+     delete.  Paired with MAKE_CONTEXT::HeaderDependencyList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The fully qualified path names of each header, each terminated by a
+     newline.
+     */
+    YORI_STRING Headers;
+
+    /**
+     TRUE if Headers was reported by a recipe in this build, so anything
+     from a previous build has been discarded.
+     */
+    BOOLEAN Captured;
+
+} MAKE_HEADER_DEPENDENCY_ENTRY, *PMAKE_HEADER_DEPENDENCY_ENTRY;
+
+/**
+ The maximum number of threads used to read subdirectory makefiles ahead of
+ the parser.
+ */
+#define MAKE_PREFETCH_MAXIMUM_THREADS (8)
+
+/**
+ State for reading subdirectory makefiles on background threads while the
+ parser is processing an earlier makefile.
+ */
+typedef struct _MAKE_PREFETCH_CONTEXT {
+
+    /**
+     TRUE if makefiles should be read ahead of the parser.
+     */
+    BOOLEAN Enabled;
+
+    /**
+     TRUE if background threads should exit.
+     */
+    BOOLEAN Shutdown;
+
+    /**
+     A hash table of makefiles which have been queued, indexed by the fully
+     qualified directory of the scope that will process them.  This is only
+     accessed by the parsing thread.
+     */
+    PYORI_HASH_TABLE Makefiles;
+
+    /**
+     A list of makefiles which have been queued, used to facilitate bulk
+     delete.  This is only accessed by the parsing thread.
+     */
+    YORI_LIST_ENTRY MakefileList;
+
+    /**
+     A list of makefiles which have not been read yet.  Access to this list
+     is synchronized with Mutex.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     A mutex synchronizing access to PendingList between threads.
+     */
+    HANDLE Mutex;
+
+    /**
+     A semaphore which is signalled once for each makefile added to
+     PendingList, and once for each thread when threads should exit.
+     */
+    HANDLE WorkAvailable;
+
+    /**
+     Handles to background threads reading makefiles.
+     */
+    HANDLE Threads[MAKE_PREFETCH_MAXIMUM_THREADS];
+
+    /**
+     The number of entries in Threads.
+     */
+    DWORD ThreadCount;
+
+} MAKE_PREFETCH_CONTEXT, *PMAKE_PREFETCH_CONTEXT;
+
+/**
+ The number of characters of trace events to accumulate in memory before
+ writing them to the trace file.
+ */
+#define MAKE_TRACE_FLUSH_THRESHOLD (64 * 1024)
+
+/**
+ State for recording the time spent in each phase of processing and in each
+ command, which is written as a Chrome trace event file.
+ */
+typedef struct _MAKE_TRACE_CONTEXT {
+
+    /**
+     A handle to the trace file being written.  NULL if tracing is not
+     enabled.
+     */
+    HANDLE hFile;
+
+    /**
+     Events which have been formatted but not yet written to the file.
+     */
+    YORI_STRING Buffer;
+
+    /**
+     A buffer used to escape strings before they are added to an event.
+     Retained to avoid repeated allocations.
+     */
+    YORI_STRING EscapedName;
+
+    /**
+     A buffer used to escape strings before they are added to an event.
+     Retained to avoid repeated allocations.
+     */
+    YORI_STRING EscapedDetail;
+
+    /**
+     The performance counter value when tracing started.  All events are
+     recorded relative to this time.
+     */
+    LARGE_INTEGER StartTime;
+
+    /**
+     The frequency of the performance counter.
+     */
+    LARGE_INTEGER Frequency;
+
+    /**
+     The number of events which have been recorded, used to determine
+     whether a separator is needed before the next event.
+     */
+    DWORD EventCount;
+
+} MAKE_TRACE_CONTEXT, *PMAKE_TRACE_CONTEXT;
+
 /**
  Information about an inline file.  An inline file is one generated by <<
  operators in a makefile.
@@ -639,12 +960,12 @@ typedef struct _MAKE_CONTEXT {
     /**
      An allocator used to preallocate and suballocate target structures.
      */
-    MAKE_SLAB_ALLOC TargetAllocator;
+    YORI_LIB_SLAB_ALLOC TargetAllocator;
 
     /**
      An allocator used to preallocate and suballocate dependency structures.
      */
-    MAKE_SLAB_ALLOC DependencyAllocator;
+    YORI_LIB_SLAB_ALLOC DependencyAllocator;
 
     /**
      A hash table of scopes whose key is their directory.
@@ -668,7 +989,13 @@ typedef struct _MAKE_CONTEXT {
      as dependencies even if they are assumed to already exist (source files.)
      The key of this hash table is fully qualified path.
      */
-    PYORI_HASH_TABLE Targets;
+    PYORI_GROWABLE_HASH_TABLE Targets;
+
+    /**
+     A pool of names, including variable names and target paths, so that
+     names which recur across scopes are stored once.
+     */
+    PYORI_LIB_STRING_POOL Names;
 
     /**
      A list of known targets, used to facilitate bulk delete.
@@ -697,6 +1024,16 @@ typedef struct _MAKE_CONTEXT {
      */
     YORI_LIST_ENTRY TargetsWaiting;
 
+    /**
+     State for reading subdirectory makefiles ahead of the parser.
+     */
+    MAKE_PREFETCH_CONTEXT Prefetch;
+
+    /**
+     State for recording a trace of where time is spent.
+     */
+    MAKE_TRACE_CONTEXT Trace;
+
     /**
      A hash table of cached preprocessor commands.
      */
@@ -707,6 +1044,89 @@ typedef struct _MAKE_CONTEXT {
      */
     YORI_LIST_ENTRY PreprocessorCacheList;
 
+    /**
+     The fully qualified name of a preprocessor cache file shared with other
+     makefiles.  This is empty if no shared cache is in use.
+     */
+    YORI_STRING SharedPreprocessorCacheFileName;
+
+    /**
+     A hash table of preprocessor commands which have been launched ahead of
+     being evaluated, or which have completed, keyed by the expanded
+     command.  This is only allocated if preprocessor results are cached.
+     */
+    PYORI_HASH_TABLE SpeculativeProbes;
+
+    /**
+     A list of preprocessor commands in SpeculativeProbes, used to
+     facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY SpeculativeProbeList;
+
+    /**
+     The number of preprocessor commands in SpeculativeProbes which have
+     been launched and not yet waited for.
+     */
+    YORI_ALLOC_SIZE_T OutstandingSpeculativeProbes;
+
+    /**
+     A hash table of recipe durations from previous builds.
+     */
+    PYORI_HASH_TABLE TargetDurations;
+
+    /**
+     A list of known recipe durations, used to facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY TargetDurationList;
+
+    /**
+     The average recipe duration among targets loaded from history, used
+     to estimate the duration of targets that have not been built before.
+     */
+    DWORD AverageTargetDuration;
+
+    /**
+     A hash table of headers that recipes reported reading, indexed by
+     target.  This is only allocated if header dependencies are tracked.
+     */
+    PYORI_HASH_TABLE HeaderDependencies;
+
+    /**
+     A list of header dependency entries, used to facilitate bulk delete.
+     Paired with MAKE_HEADER_DEPENDENCY_ENTRY::ListEntry .
+     */
+    YORI_LIST_ENTRY HeaderDependencyList;
+
+    /**
+     A hash table of files read to construct the build graph.  This is only
+     allocated if build state should be saved so that later builds with
+     nothing to do can complete without reading any makefile.
+     */
+    PYORI_HASH_TABLE BuildDbInputs;
+
+    /**
+     A list of files read to construct the build graph, used to facilitate
+     bulk delete.
+     */
+    YORI_LIST_ENTRY BuildDbInputList;
+
+    /**
+     The fully qualified directory containing the output cache.  This is
+     empty if the output cache is not in use.
+     */
+    YORI_STRING OutputCacheDirectory;
+
+    /**
+     The crypto provider used to hash inputs for the output cache.  Zero if
+     the output cache is not in use.
+     */
+    DWORD_PTR OutputCacheProvider;
+
+    /**
+     A buffer used to read files when hashing their contents.
+     */
+    PUCHAR OutputCacheBuffer;
+
     /**
      Allocations used to generate files to look for when determining which
      inference rules to apply.  Because these are very temporary, they are
@@ -716,6 +1136,20 @@ typedef struct _MAKE_CONTEXT {
      */
     YORI_STRING FilesToProbe[2];
 
+    /**
+     A hash table of directories which have been searched for inference
+     rule source files, indexed by fully qualified directory name.  This is
+     NULL until the first search.
+     */
+    PYORI_GROWABLE_HASH_TABLE DirectoryListings;
+
+    /**
+     A list of directories which have been searched for inference rule
+     source files, used to facilitate bulk delete.  Paired with
+     MAKE_DIRECTORY_LISTING::ListEntry .
+     */
+    YORI_LIST_ENTRY DirectoryListingList;
+
     /**
      The temporary path applied to the ymake process.  Child processes are
      assigned subdirectories under this path to use for their own temporary
@@ -724,14 +1158,10 @@ typedef struct _MAKE_CONTEXT {
     YORI_STRING TempPath;
 
     /**
-     A bitmask representing which job IDs have been allocated.
-     */
-    DWORDLONG JobIdsAllocated;
-
-    /**
-     A bitmask representing temporary directories which have been created.
+     An array of NumberProcesses plus NumberRemoteProcesses elements
+     indicating which job temporary directories have been created.
      */
-    DWORDLONG TempDirectoriesCreated;
+    PBOOLEAN TempDirectoriesCreated;
 
     /**
      The time taken to execute processes as part of preprocessor commands.
@@ -790,11 +1220,27 @@ typedef struct _MAKE_CONTEXT {
 
     /**
      The number of child processes to execute concurrently.  This defaults
-     to the number of logical processors, but is limited to 64 due to
+     to the number of logical processors.  If the system does not support
+     job objects with completion ports, it is limited to 64 due to
      WaitForMultipleObjects.
      */
     YORI_ALLOC_SIZE_T NumberProcesses;
 
+    /**
+     The number of hermetic recipes to execute concurrently via the remote
+     launcher, in addition to NumberProcesses local recipes.  Zero if no
+     remote launcher is configured.
+     */
+    YORI_ALLOC_SIZE_T NumberRemoteProcesses;
+
+    /**
+     A command to prefix to each hermetic command when it executes in a
+     remote slot.  The launcher is responsible for transferring inputs to a
+     build agent, executing the command there, and returning its outputs
+     and output text.  Empty if no remote launcher is configured.
+     */
+    YORI_STRING RemoteLauncher;
+
     /**
      The 32 bit hash of the environment block. This process does not modify
      its own environment, so this can be calculated once for the lifetime
@@ -819,6 +1265,18 @@ typedef struct _MAKE_CONTEXT {
      */
     BOOLEAN EnvHashCalculated;
 
+    /**
+     TRUE if the state of some file read to construct the build graph could
+     not be recorded, so the build state cannot be saved.
+     */
+    BOOLEAN BuildDbIncomplete;
+
+    /**
+     TRUE if header dependencies have been captured or discarded by this
+     build, so they need to be saved.
+     */
+    BOOLEAN HeaderDependenciesChanged;
+
     /**
      TRUE to indicate that execution should continue after failure as much
      as possible.
@@ -838,24 +1296,6 @@ typedef struct _MAKE_CONTEXT {
 
 } MAKE_CONTEXT, *PMAKE_CONTEXT;
 
-// *** ALLOC.C ***
-
-PVOID
-MakeSlabAlloc(
-    __in PMAKE_SLAB_ALLOC Alloc,
-    __in YORI_ALLOC_SIZE_T SizeInBytes
-    );
-
-VOID
-MakeSlabFree(
-    __in PVOID Ptr
-    );
-
-VOID
-MakeSlabCleanup(
-    __in PMAKE_SLAB_ALLOC Alloc
-    );
-
 // *** VAR.C ***
 
 BOOLEAN
@@ -882,6 +1322,26 @@ MakeExpandVariables(
     __out_opt PYORI_STRING VariableNotFound
     );
 
+__success(return != NULL)
+PMAKE_COMPILED_RECIPE
+MakeCompileRecipe(
+    __in PYORI_STRING Recipe
+    );
+
+VOID
+MakeFreeCompiledRecipe(
+    __in PMAKE_COMPILED_RECIPE CompiledRecipe
+    );
+
+BOOLEAN
+MakeExpandCompiledRecipeLine(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __in_opt PMAKE_TARGET Target,
+    __in PMAKE_COMPILED_RECIPE CompiledRecipe,
+    __in PMAKE_RECIPE_LINE RecipeLine,
+    __inout PYORI_STRING ExpandedLine
+    );
+
 VOID
 MakeDeleteAllVariables(
     __inout PMAKE_SCOPE_CONTEXT ScopeContext
@@ -898,6 +1358,110 @@ MakeExecuteSetVariable(
     __in PYORI_STRING Line
     );
 
+// *** BUILDDB.C ***
+
+VOID
+MakeBuildDbRecordInputTime(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName,
+    __in LARGE_INTEGER ModifiedTime
+    );
+
+VOID
+MakeBuildDbRecordInput(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName,
+    __in HANDLE hFile
+    );
+
+VOID
+MakeDeleteAllBuildDbInputs(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
+BOOLEAN
+MakeIsBuildDbCurrent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    );
+
+VOID
+MakeSaveBuildDb(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    );
+
+// *** DEPENDS.C ***
+
+VOID
+MakeLoadHeaderDependencies(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    );
+
+VOID
+MakeSaveAndDeleteHeaderDependencies(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    );
+
+VOID
+MakeCaptureHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __in PYORI_STRING CurrentDirectory,
+    __inout PYORI_STRING ProcessOutput
+    );
+
+VOID
+MakeCompleteHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    );
+
+BOOLEAN
+MakeCheckHeaderDependencies(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __inout PBOOLEAN RebuildRequired
+    );
+
+// *** HISTORY.C ***
+
+VOID
+MakeLoadTargetDurationHistory(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    );
+
+VOID
+MakeSaveAndDeleteTargetDurationHistory(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    );
+
+VOID
+MakeRecordTargetDuration(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __in DWORD Duration
+    );
+
+VOID
+MakeInsertReadyTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    );
+
+VOID
+MakeCalculateCriticalPaths(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
 // *** MINISH.C ***
 
 DWORD
@@ -906,6 +1470,11 @@ MakeShExecuteInProc(
     __in PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext
     );
 
+VOID
+MakeShCancelExecPlan(
+    __in PYORI_LIBSH_EXEC_PLAN ExecPlan
+    );
+
 DWORD
 MakeShExecExecPlan(
     __in PYORI_LIBSH_EXEC_PLAN ExecPlan,
@@ -919,6 +1488,13 @@ MakeTrimWhitespace(
     __in PYORI_STRING String
     );
 
+__success(return)
+BOOLEAN
+MakeFindMakefileInDirectoryByName(
+    __in PYORI_STRING Directory,
+    __out PYORI_STRING FileName
+    );
+
 __success(return)
 BOOLEAN
 MakeFindMakefileInDirectory(
@@ -930,7 +1506,15 @@ BOOL
 MakeProcessStream(
     __in HANDLE hSource,
     __in PMAKE_CONTEXT MakeContext,
-    __in PYORI_STRING FileName
+    __in PYORI_STRING FileName,
+    __in_opt PYORI_STRING PrefetchedLines
+    );
+
+BOOLEAN
+MakeGetCacheFileNameFromMakeFileName(
+    __in PYORI_STRING MakeFileName,
+    __in LPCTSTR Extension,
+    __out PYORI_STRING CacheFileName
     );
 
 VOID
@@ -939,6 +1523,11 @@ MakeLoadPreprocessorCacheEntries(
     __in PYORI_STRING MakeFileName
     );
 
+VOID
+MakeSaveSharedPreprocessorCacheEntries(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
 VOID
 MakeSaveAndDeleteAllPreprocessorCacheEntries(
     __inout PMAKE_CONTEXT MakeContext,
@@ -950,6 +1539,116 @@ MakeDeleteInlineFiles(
     __in PMAKE_CONTEXT MakeContext
     );
 
+// *** OUTCACHE.C ***
+
+__success(return)
+BOOLEAN
+MakeInitializeOutputCache(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING CacheDirectory
+    );
+
+VOID
+MakeCleanupOutputCache(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
+BOOLEAN
+MakeRestoreTargetFromCache(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    );
+
+VOID
+MakeSaveTargetToCache(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    );
+
+// *** PREFETCH.C ***
+
+VOID
+MakePrefetchSubdirectoryMakefiles(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryList
+    );
+
+__success(return)
+BOOLEAN
+MakeTakePrefetchedMakefile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Directory,
+    __out PYORI_STRING FileName,
+    __out PYORI_STRING Lines
+    );
+
+__success(return)
+BOOLEAN
+MakeGetNextPrefetchedLine(
+    __in PYORI_STRING Lines,
+    __inout PYORI_ALLOC_SIZE_T Offset,
+    __out PYORI_STRING Line
+    );
+
+VOID
+MakeCleanupPrefetch(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
+// *** PROBE.C ***
+
+BOOLEAN
+MakeProbeFileExists(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath
+    );
+
+__success(return)
+BOOLEAN
+MakeProbeFileTime(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PLARGE_INTEGER ModifiedTime
+    );
+
+VOID
+MakeProbeCleanupDirectoryListings(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+VOID
+MakeProbeAllTargetFiles(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+// *** SPECPROBE.C ***
+
+BOOLEAN
+MakeSpeculatePreprocessorCommand(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd
+    );
+
+__success(return)
+BOOLEAN
+MakeGetSpeculativeProbeResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd,
+    __out PDWORD ExitCode
+    );
+
+VOID
+MakeRecordSpeculativeProbeResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd,
+    __in DWORD ExitCode
+    );
+
+VOID
+MakeDeleteAllSpeculativeProbes(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
 // *** SCOPE.C ***
 
 PMAKE_SCOPE_CONTEXT
@@ -993,6 +1692,11 @@ MakeDeleteAllTargets(
     __inout PMAKE_CONTEXT MakeContext
     );
 
+VOID
+MakeProbeTargetFile(
+    __in PMAKE_TARGET Target
+    );
+
 VOID
 MakeDeactivateAllInferenceRules(
     __in PMAKE_SCOPE_CONTEXT ScopeContext
@@ -1045,6 +1749,12 @@ MakeMarkCommandLineTargetForBuild(
     __in PYORI_STRING TargetName
     );
 
+BOOLEAN
+MakeDetermineDependenciesForTarget(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    );
+
 BOOLEAN
 MakeDetermineDependencies(
     __in PMAKE_CONTEXT MakeContext
@@ -1059,8 +1769,46 @@ MakeExpandTargetVariable(
     __out PYORI_STRING VariableData
     );
 
+// *** TRACE.C ***
+
+__success(return)
+BOOLEAN
+MakeTraceInitialize(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName
+    );
+
+VOID
+MakeTraceRecordEvent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in LPCTSTR Category,
+    __in PCYORI_STRING Name,
+    __in DWORD ThreadId,
+    __in PLARGE_INTEGER StartTime,
+    __in PLARGE_INTEGER EndTime,
+    __in_opt PCYORI_STRING Detail,
+    __in DWORD ExitCode
+    );
+
+VOID
+MakeTraceRecordPhase(
+    __in PMAKE_CONTEXT MakeContext,
+    __in LPCTSTR Name,
+    __in PLARGE_INTEGER StartTime,
+    __in PLARGE_INTEGER EndTime
+    );
+
+VOID
+MakeTraceCleanup(
+    __inout PMAKE_CONTEXT MakeContext
+    );
+
 // *** EXEC.C ***
 
+YORI_CMD_BUILTIN MakeBuiltinCopy;
+
+YORI_CMD_BUILTIN MakeBuiltinErase;
+
 VOID
 MakeCleanupTemporaryDirectories(
     __in PMAKE_CONTEXT MakeContext
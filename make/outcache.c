@@ -0,0 +1,466 @@
+/**
+ * @file make/outcache.c
+ *
+ * Yori shell make content addressed recipe output cache
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ The size of the buffer used to read files when hashing their contents.
+ */
+#define MAKE_OUTPUT_CACHE_READ_BUFFER_SIZE (64 * 1024)
+
+/**
+ A version string which is included in every key.  This can be changed if
+ the composition of the key changes so older cache entries are not used.
+ */
+#define MAKE_OUTPUT_CACHE_KEY_VERSION "ymake output cache 1"
+
+/**
+ Initialize the output cache, so that target outputs can be restored from
+ and saved to the specified directory.
+
+ @param MakeContext Pointer to the context.
+
+ @param CacheDirectory Pointer to the user specified cache directory.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeInitializeOutputCache(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING CacheDirectory
+    )
+{
+    YORI_STRING FullPath;
+
+    YoriLibLoadAdvApi32Functions();
+    if (DllAdvApi32.pCryptAcquireContextW == NULL ||
+        DllAdvApi32.pCryptCreateHash == NULL ||
+        DllAdvApi32.pCryptDestroyHash == NULL ||
+        DllAdvApi32.pCryptGetHashParam == NULL ||
+        DllAdvApi32.pCryptHashData == NULL ||
+        DllAdvApi32.pCryptReleaseContext == NULL) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ymake: operating system support for hashing not present\n"));
+        return FALSE;
+    }
+
+    if (!DllAdvApi32.pCryptAcquireContextW(&MakeContext->OutputCacheProvider, NULL, MS_DEF_PROV, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) &&
+        !DllAdvApi32.pCryptAcquireContextW(&MakeContext->OutputCacheProvider, NULL, MS_DEF_PROV, PROV_RSA_FULL, 0)) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ymake: hash provider not functional\n"));
+        MakeContext->OutputCacheProvider = 0;
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FullPath);
+    if (!YoriLibUserStringToSingleFilePath(CacheDirectory, TRUE, &FullPath)) {
+        MakeCleanupOutputCache(MakeContext);
+        return FALSE;
+    }
+
+    if (!YoriLibCreateDirectoryAndParents(&FullPath) &&
+        GetLastError() != ERROR_ALREADY_EXISTS) {
+
+        if ((GetFileAttributes(FullPath.StartOfString) & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ymake: could not create cache directory %y\n"), &FullPath);
+            YoriLibFreeStringContents(&FullPath);
+            MakeCleanupOutputCache(MakeContext);
+            return FALSE;
+        }
+    }
+
+    MakeContext->OutputCacheBuffer = YoriLibMalloc(MAKE_OUTPUT_CACHE_READ_BUFFER_SIZE);
+    if (MakeContext->OutputCacheBuffer == NULL) {
+        YoriLibFreeStringContents(&FullPath);
+        MakeCleanupOutputCache(MakeContext);
+        return FALSE;
+    }
+
+    memcpy(&MakeContext->OutputCacheDirectory, &FullPath, sizeof(YORI_STRING));
+    return TRUE;
+}
+
+/**
+ Clean up any state allocated for the output cache.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeCleanupOutputCache(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    if (MakeContext->OutputCacheProvider != 0) {
+        DllAdvApi32.pCryptReleaseContext(MakeContext->OutputCacheProvider, 0);
+        MakeContext->OutputCacheProvider = 0;
+    }
+
+    if (MakeContext->OutputCacheBuffer != NULL) {
+        YoriLibFree(MakeContext->OutputCacheBuffer);
+        MakeContext->OutputCacheBuffer = NULL;
+    }
+
+    YoriLibFreeStringContents(&MakeContext->OutputCacheDirectory);
+}
+
+/**
+ Add the contents of a string to a hash in progress.
+
+ @param hHash The hash in progress.
+
+ @param String Pointer to the string to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeOutputCacheHashString(
+    __in DWORD_PTR hHash,
+    __in PYORI_STRING String
+    )
+{
+    TCHAR Terminator;
+
+    if (String->LengthInChars > 0 &&
+        !DllAdvApi32.pCryptHashData(hHash, (PUCHAR)String->StartOfString, String->LengthInChars * sizeof(TCHAR), 0)) {
+
+        return FALSE;
+    }
+
+    //
+    //  Terminate each string so that adjacent strings can't be confused
+    //  with a different split of the same characters.
+    //
+
+    Terminator = '\0';
+    if (!DllAdvApi32.pCryptHashData(hHash, (PUCHAR)&Terminator, sizeof(Terminator), 0)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Calculate a hash of the contents of a target's file.  This is retained in
+ the target so that targets used as input to several other targets only
+ need to be read once.  This should only be called once any recipe to
+ build the target has completed.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @return TRUE to indicate the contents were hashed, FALSE if the target
+         could not be read.
+ */
+BOOLEAN
+MakeOutputCacheHashTargetContents(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    HANDLE hFile;
+    DWORD_PTR hHash;
+    DWORD BytesRead;
+    DWORD HashLength;
+    BOOLEAN Result;
+
+    if (Target->ContentHashCalculated) {
+        return TRUE;
+    }
+
+    ASSERT(YoriLibIsStringNullTerminated(&Target->HashEntry.Key));
+    hFile = CreateFile(Target->HashEntry.Key.StartOfString,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (!DllAdvApi32.pCryptCreateHash(MakeContext->OutputCacheProvider, CALG_SHA1, 0, 0, &hHash)) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
+
+    Result = FALSE;
+    while (TRUE) {
+        if (!ReadFile(hFile, MakeContext->OutputCacheBuffer, MAKE_OUTPUT_CACHE_READ_BUFFER_SIZE, &BytesRead, NULL)) {
+            break;
+        }
+
+        if (BytesRead == 0) {
+            Result = TRUE;
+            break;
+        }
+
+        if (!DllAdvApi32.pCryptHashData(hHash, MakeContext->OutputCacheBuffer, BytesRead, 0)) {
+            break;
+        }
+    }
+
+    if (Result) {
+        HashLength = sizeof(Target->ContentHash);
+        if (DllAdvApi32.pCryptGetHashParam(hHash, HP_HASHVAL, Target->ContentHash, &HashLength, 0) &&
+            HashLength == sizeof(Target->ContentHash)) {
+
+            Target->ContentHashCalculated = TRUE;
+        } else {
+            Result = FALSE;
+        }
+    }
+
+    DllAdvApi32.pCryptDestroyHash(hHash);
+    CloseHandle(hFile);
+    return Result;
+}
+
+/**
+ Calculate the cache key for a target.  This consists of the name of the
+ target, the fully expanded commands used to build it, and the name and
+ contents of every target it depends upon.  If any dependency cannot be
+ read, such as a dependency which is not a file, the target cannot be
+ cached.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @param KeyName On successful completion, updated to contain a newly
+        allocated string containing the full path to the cache entry for
+        this target.
+
+ @return TRUE to indicate a key was generated, FALSE to indicate the target
+         cannot be cached.
+ */
+__success(return)
+BOOLEAN
+MakeOutputCacheGetTargetKey(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __out PYORI_STRING KeyName
+    )
+{
+    UCHAR KeyHash[MAKE_CONTENT_HASH_LENGTH];
+    YORI_STRING KeyVersion;
+    YORI_STRING HexName;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET_DEPENDENCY Dependency;
+    PMAKE_CMD_TO_EXEC CmdToExec;
+    DWORD_PTR hHash;
+    DWORD HashLength;
+    BOOLEAN Result;
+
+    if (MakeContext->OutputCacheProvider == 0 ||
+        Target->InferenceRulePseudoTarget ||
+        YoriLibIsListEmpty(&Target->ExecCmds)) {
+
+        return FALSE;
+    }
+
+    if (!DllAdvApi32.pCryptCreateHash(MakeContext->OutputCacheProvider, CALG_SHA1, 0, 0, &hHash)) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    YoriLibConstantString(&KeyVersion, _T(MAKE_OUTPUT_CACHE_KEY_VERSION));
+    if (!MakeOutputCacheHashString(hHash, &KeyVersion) ||
+        !MakeOutputCacheHashString(hHash, &Target->HashEntry.Key)) {
+
+        goto Exit;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Target->ExecCmds, NULL);
+    while (ListEntry != NULL) {
+        CmdToExec = CONTAINING_RECORD(ListEntry, MAKE_CMD_TO_EXEC, ListEntry);
+        if (!MakeOutputCacheHashString(hHash, &CmdToExec->Cmd)) {
+            goto Exit;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Target->ExecCmds, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Target->ParentDependents, NULL);
+    while (ListEntry != NULL) {
+        Dependency = CONTAINING_RECORD(ListEntry, MAKE_TARGET_DEPENDENCY, ChildDependents);
+        if (!MakeOutputCacheHashTargetContents(MakeContext, Dependency->Parent)) {
+            goto Exit;
+        }
+        if (!MakeOutputCacheHashString(hHash, &Dependency->Parent->HashEntry.Key) ||
+            !DllAdvApi32.pCryptHashData(hHash, Dependency->Parent->ContentHash, sizeof(Dependency->Parent->ContentHash), 0)) {
+
+            goto Exit;
+        }
+        ListEntry = YoriLibGetNextListEntry(&Target->ParentDependents, ListEntry);
+    }
+
+    HashLength = sizeof(KeyHash);
+    if (!DllAdvApi32.pCryptGetHashParam(hHash, HP_HASHVAL, KeyHash, &HashLength, 0) ||
+        HashLength != sizeof(KeyHash)) {
+
+        goto Exit;
+    }
+
+    if (!YoriLibAllocateString(KeyName, MakeContext->OutputCacheDirectory.LengthInChars + 1 + sizeof(KeyHash) * 2 + 1)) {
+        goto Exit;
+    }
+
+    KeyName->LengthInChars = YoriLibSPrintf(KeyName->StartOfString, _T("%y\\"), &MakeContext->OutputCacheDirectory);
+
+    YoriLibInitEmptyString(&HexName);
+    HexName.StartOfString = &KeyName->StartOfString[KeyName->LengthInChars];
+    HexName.LengthAllocated = KeyName->LengthAllocated - KeyName->LengthInChars;
+    if (!YoriLibHexBufferToString(KeyHash, sizeof(KeyHash), &HexName)) {
+        YoriLibFreeStringContents(KeyName);
+        goto Exit;
+    }
+
+    KeyName->LengthInChars = KeyName->LengthInChars + sizeof(KeyHash) * 2;
+    KeyName->StartOfString[KeyName->LengthInChars] = '\0';
+    Result = TRUE;
+
+Exit:
+    DllAdvApi32.pCryptDestroyHash(hHash);
+    return Result;
+}
+
+/**
+ Attempt to restore the output of a target from the cache rather than
+ executing its recipe.  The restored file is given the current time so
+ it is newer than anything it depends on.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @return TRUE to indicate the target was restored and its recipe does not
+         need to execute, FALSE to indicate the recipe should execute.
+ */
+BOOLEAN
+MakeRestoreTargetFromCache(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    YORI_STRING KeyName;
+    FILETIME Now;
+    HANDLE hFile;
+    BOOLEAN Result;
+
+    if (!MakeOutputCacheGetTargetKey(MakeContext, Target, &KeyName)) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    if (CopyFile(KeyName.StartOfString, Target->HashEntry.Key.StartOfString, FALSE)) {
+        hFile = CreateFile(Target->HashEntry.Key.StartOfString,
+                           FILE_WRITE_ATTRIBUTES,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL,
+                           OPEN_EXISTING,
+                           0,
+                           NULL);
+
+        if (hFile != INVALID_HANDLE_VALUE) {
+            GetSystemTimeAsFileTime(&Now);
+            if (SetFileTime(hFile, NULL, NULL, &Now)) {
+                Result = TRUE;
+            }
+            CloseHandle(hFile);
+        }
+
+        //
+        //  If the timestamp couldn't be updated, the restored file may
+        //  appear older than its dependencies, so remove it and build it
+        //  normally.
+        //
+
+        if (!Result) {
+            DeleteFile(Target->HashEntry.Key.StartOfString);
+        }
+    }
+
+    if (Result && !MakeContext->SilentCommandLaunching) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Restored %y from cache\n"), &Target->HashEntry.Key);
+    }
+
+    YoriLibFreeStringContents(&KeyName);
+    return Result;
+}
+
+/**
+ Save the output of a target whose recipe has completed successfully into
+ the cache, so that a later build with identical inputs can restore it.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+ */
+VOID
+MakeSaveTargetToCache(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target
+    )
+{
+    YORI_STRING KeyName;
+    YORI_STRING TempName;
+    DWORD Attributes;
+
+    Attributes = GetFileAttributes(Target->HashEntry.Key.StartOfString);
+    if (Attributes == (DWORD)-1 ||
+        (Attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+
+        return;
+    }
+
+    if (!MakeOutputCacheGetTargetKey(MakeContext, Target, &KeyName)) {
+        return;
+    }
+
+    //
+    //  Copy to a temporary name and rename into place, so that another
+    //  build sharing the cache never observes a partially written entry.
+    //
+
+    if (YoriLibAllocateString(&TempName, KeyName.LengthInChars + sizeof(".tmp") + 10)) {
+        TempName.LengthInChars = YoriLibSPrintf(TempName.StartOfString, _T("%y.%i.tmp"), &KeyName, GetCurrentProcessId());
+        if (CopyFile(Target->HashEntry.Key.StartOfString, TempName.StartOfString, FALSE)) {
+            if (!MoveFileEx(TempName.StartOfString, KeyName.StartOfString, MOVEFILE_REPLACE_EXISTING)) {
+                DeleteFile(TempName.StartOfString);
+            }
+        }
+        YoriLibFreeStringContents(&TempName);
+    }
+
+    YoriLibFreeStringContents(&KeyName);
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,603 @@
+/**
+ * @file make/prefetch.c
+ *
+ * Yori make background reading of subdirectory makefiles
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+//
+//  Preprocessing a makefile depends on the state of its parent scope, and
+//  creates targets and dependencies in tables shared by every scope, so
+//  makefiles are processed one at a time.  What does not depend on any
+//  state is locating each makefile, reading it, converting its encoding
+//  and splitting it into lines.  When a rule names subdirectories, this
+//  is performed for all of them on background threads, so that by the time
+//  the parser reaches each subdirectory its lines are already in memory.
+//
+
+/**
+ A single makefile being read ahead of the parser.
+ */
+typedef struct _MAKE_PREFETCH_MAKEFILE {
+
+    /**
+     The hash entry.  Key is the fully qualified directory of the scope that
+     will process the makefile.  Paired with MAKE_PREFETCH_CONTEXT::Makefiles .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all makefiles, used to facilitate bulk delete.  Paired
+     with MAKE_PREFETCH_CONTEXT::MakefileList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The linkage of makefiles which have not been read yet.  Paired with
+     MAKE_PREFETCH_CONTEXT::PendingList .
+     */
+    YORI_LIST_ENTRY PendingListEntry;
+
+    /**
+     An event which is signalled when a background thread has finished
+     reading the makefile.
+     */
+    HANDLE Complete;
+
+    /**
+     The fully qualified name of the makefile that was found.  This is only
+     meaningful if Succeeded is TRUE.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The contents of the makefile, with each line terminated by a newline.
+     This is only meaningful if Succeeded is TRUE.
+     */
+    YORI_STRING Lines;
+
+    /**
+     TRUE once a thread has removed this makefile from the pending list in
+     order to read it.  Access is synchronized with
+     MAKE_PREFETCH_CONTEXT::Mutex .
+     */
+    BOOLEAN Started;
+
+    /**
+     TRUE if the makefile was found and read successfully.
+     */
+    BOOLEAN Succeeded;
+
+} MAKE_PREFETCH_MAKEFILE, *PMAKE_PREFETCH_MAKEFILE;
+
+/**
+ Locate and read a single makefile into memory.  This is called on a
+ background thread, or on the parsing thread if it needs the makefile
+ before a background thread has started reading it, so it only uses the
+ makefile structure itself.
+
+ @param Makefile Pointer to the makefile to read.
+ */
+VOID
+MakePrefetchReadMakefile(
+    __in PMAKE_PREFETCH_MAKEFILE Makefile
+    )
+{
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    YORI_ALLOC_SIZE_T CharsToAllocate;
+    HANDLE hSource;
+
+    if (!MakeFindMakefileInDirectoryByName(&Makefile->HashEntry.Key, &Makefile->FileName)) {
+        return;
+    }
+
+    hSource = CreateFile(Makefile->FileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hSource == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+
+    Makefile->Succeeded = TRUE;
+    while (TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+            break;
+        }
+
+        CharsNeeded = Makefile->Lines.LengthInChars + LineString.LengthInChars + 1;
+        if (CharsNeeded > Makefile->Lines.LengthAllocated) {
+            CharsToAllocate = YoriLibMaximumAllocationInRange((YORI_MAX_UNSIGNED_T)CharsNeeded * sizeof(TCHAR), ((YORI_MAX_UNSIGNED_T)CharsNeeded * 2 + 16 * 1024) * sizeof(TCHAR));
+            CharsToAllocate = CharsToAllocate / sizeof(TCHAR);
+            if (CharsToAllocate < CharsNeeded ||
+                !YoriLibReallocateString(&Makefile->Lines, CharsToAllocate)) {
+
+                Makefile->Succeeded = FALSE;
+                break;
+            }
+        }
+
+        memcpy(&Makefile->Lines.StartOfString[Makefile->Lines.LengthInChars], LineString.StartOfString, LineString.LengthInChars * sizeof(TCHAR));
+        Makefile->Lines.LengthInChars = Makefile->Lines.LengthInChars + LineString.LengthInChars;
+        Makefile->Lines.StartOfString[Makefile->Lines.LengthInChars] = '\n';
+        Makefile->Lines.LengthInChars++;
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hSource);
+
+    if (!Makefile->Succeeded) {
+        YoriLibFreeStringContents(&Makefile->Lines);
+    }
+}
+
+/**
+ A background thread which reads makefiles until it is told to exit.
+
+ @param Context Pointer to the make context.
+
+ @return Thread exit code, unused.
+ */
+DWORD WINAPI
+MakePrefetchWorker(
+    __in LPVOID Context
+    )
+{
+    PMAKE_PREFETCH_CONTEXT PrefetchContext;
+    PMAKE_PREFETCH_MAKEFILE Makefile;
+    PYORI_LIST_ENTRY ListEntry;
+    BOOLEAN Shutdown;
+
+    PrefetchContext = &((PMAKE_CONTEXT)Context)->Prefetch;
+
+    while (TRUE) {
+        WaitForSingleObject(PrefetchContext->WorkAvailable, INFINITE);
+
+        WaitForSingleObject(PrefetchContext->Mutex, INFINITE);
+        Shutdown = PrefetchContext->Shutdown;
+        ListEntry = NULL;
+        if (!Shutdown) {
+            ListEntry = YoriLibGetNextListEntry(&PrefetchContext->PendingList, NULL);
+            if (ListEntry != NULL) {
+                YoriLibRemoveListItem(ListEntry);
+                Makefile = CONTAINING_RECORD(ListEntry, MAKE_PREFETCH_MAKEFILE, PendingListEntry);
+                Makefile->Started = TRUE;
+            }
+        }
+        ReleaseMutex(PrefetchContext->Mutex);
+
+        if (Shutdown) {
+            break;
+        }
+
+        //
+        //  The parsing thread may have taken this makefile before this
+        //  thread woke up, in which case there is nothing to do.
+        //
+
+        if (ListEntry == NULL) {
+            continue;
+        }
+
+        Makefile = CONTAINING_RECORD(ListEntry, MAKE_PREFETCH_MAKEFILE, PendingListEntry);
+        MakePrefetchReadMakefile(Makefile);
+        SetEvent(Makefile->Complete);
+    }
+
+    return 0;
+}
+
+/**
+ Create the synchronization objects and background threads used to read
+ makefiles.  If this fails, reading ahead is disabled and makefiles are
+ read by the parser when they are needed.
+
+ @param MakeContext Pointer to the make context.
+
+ @return TRUE to indicate background threads are available, FALSE if they
+         are not.
+ */
+BOOLEAN
+MakePrefetchStartThreads(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PMAKE_PREFETCH_CONTEXT PrefetchContext;
+    DWORD MaxThreads;
+    DWORD ThreadId;
+
+    PrefetchContext = &MakeContext->Prefetch;
+    if (PrefetchContext->ThreadCount > 0) {
+        return TRUE;
+    }
+
+    YoriLibInitializeListHead(&PrefetchContext->MakefileList);
+    YoriLibInitializeListHead(&PrefetchContext->PendingList);
+
+    PrefetchContext->Makefiles = YoriLibAllocateHashTable(250);
+    PrefetchContext->Mutex = CreateMutex(NULL, FALSE, NULL);
+    PrefetchContext->WorkAvailable = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+    if (PrefetchContext->Makefiles == NULL ||
+        PrefetchContext->Mutex == NULL ||
+        PrefetchContext->WorkAvailable == NULL) {
+
+        MakeCleanupPrefetch(MakeContext);
+        return FALSE;
+    }
+
+    MaxThreads = MakeContext->NumberProcesses;
+    if (MaxThreads > MAKE_PREFETCH_MAXIMUM_THREADS) {
+        MaxThreads = MAKE_PREFETCH_MAXIMUM_THREADS;
+    }
+
+    while (PrefetchContext->ThreadCount < MaxThreads) {
+        PrefetchContext->Threads[PrefetchContext->ThreadCount] = CreateThread(NULL, 0, MakePrefetchWorker, MakeContext, 0, &ThreadId);
+        if (PrefetchContext->Threads[PrefetchContext->ThreadCount] == NULL) {
+            break;
+        }
+        PrefetchContext->ThreadCount++;
+    }
+
+    if (PrefetchContext->ThreadCount == 0) {
+        MakeCleanupPrefetch(MakeContext);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Queue a single subdirectory makefile to be read on a background thread.
+
+ @param MakeContext Pointer to the make context.
+
+ @param DirName Pointer to the subdirectory name, relative to the active
+        scope.
+ */
+VOID
+MakePrefetchQueueDirectory(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirName
+    )
+{
+    PMAKE_PREFETCH_CONTEXT PrefetchContext;
+    PMAKE_PREFETCH_MAKEFILE Makefile;
+    YORI_STRING FullDir;
+
+    PrefetchContext = &MakeContext->Prefetch;
+
+    //
+    //  This must generate the same name as MakeActivateScope, so that the
+    //  scope can find the prefetched makefile.
+    //
+
+    YoriLibInitEmptyString(&FullDir);
+    YoriLibYPrintf(&FullDir, _T("%y\\%y"), &MakeContext->ActiveScope->HashEntry.Key, DirName);
+    if (FullDir.StartOfString == NULL) {
+        return;
+    }
+
+    if (YoriLibHashLookupByKey(MakeContext->Scopes, &FullDir) != NULL ||
+        YoriLibHashLookupByKey(PrefetchContext->Makefiles, &FullDir) != NULL) {
+
+        YoriLibFreeStringContents(&FullDir);
+        return;
+    }
+
+    Makefile = YoriLibMalloc(sizeof(MAKE_PREFETCH_MAKEFILE));
+    if (Makefile == NULL) {
+        YoriLibFreeStringContents(&FullDir);
+        return;
+    }
+
+    ZeroMemory(Makefile, sizeof(MAKE_PREFETCH_MAKEFILE));
+    YoriLibInitEmptyString(&Makefile->FileName);
+    YoriLibInitEmptyString(&Makefile->Lines);
+
+    Makefile->Complete = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Makefile->Complete == NULL) {
+        YoriLibFree(Makefile);
+        YoriLibFreeStringContents(&FullDir);
+        return;
+    }
+
+    YoriLibHashInsertByKey(PrefetchContext->Makefiles, &FullDir, Makefile, &Makefile->HashEntry);
+    YoriLibAppendList(&PrefetchContext->MakefileList, &Makefile->ListEntry);
+    YoriLibFreeStringContents(&FullDir);
+
+    WaitForSingleObject(PrefetchContext->Mutex, INFINITE);
+    YoriLibAppendList(&PrefetchContext->PendingList, &Makefile->PendingListEntry);
+    ReleaseMutex(PrefetchContext->Mutex);
+
+    ReleaseSemaphore(PrefetchContext->WorkAvailable, 1, NULL);
+}
+
+/**
+ Given the list of subdirectories from a rule, start reading the makefile
+ in each subdirectory on background threads.  Subdirectories whose scope
+ has already been processed are skipped.
+
+ @param MakeContext Pointer to the make context.
+
+ @param DirectoryList Pointer to the list of subdirectories, separated by
+        spaces or tabs, where each may be enclosed in quotes.
+ */
+VOID
+MakePrefetchSubdirectoryMakefiles(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryList
+    )
+{
+    YORI_STRING Substring;
+    YORI_ALLOC_SIZE_T ReadIndex;
+    BOOLEAN QuoteOpen;
+    BOOLEAN EndOfEntry;
+
+    if (!MakeContext->Prefetch.Enabled) {
+        return;
+    }
+
+    if (!MakePrefetchStartThreads(MakeContext)) {
+        MakeContext->Prefetch.Enabled = FALSE;
+        return;
+    }
+
+    YoriLibInitEmptyString(&Substring);
+    QuoteOpen = FALSE;
+    for (ReadIndex = 0; ReadIndex <= DirectoryList->LengthInChars; ReadIndex++) {
+
+        EndOfEntry = FALSE;
+        if (ReadIndex == DirectoryList->LengthInChars) {
+            EndOfEntry = TRUE;
+        } else {
+            if (DirectoryList->StartOfString[ReadIndex] == '"') {
+                QuoteOpen = (BOOLEAN)!QuoteOpen;
+            }
+
+            if (!QuoteOpen &&
+                (DirectoryList->StartOfString[ReadIndex] == ' ' ||
+                 DirectoryList->StartOfString[ReadIndex] == '\t')) {
+
+                EndOfEntry = TRUE;
+            }
+        }
+
+        if (!EndOfEntry) {
+            if (Substring.LengthInChars == 0) {
+                Substring.StartOfString = &DirectoryList->StartOfString[ReadIndex];
+            }
+            Substring.LengthInChars++;
+            continue;
+        }
+
+        if (Substring.LengthInChars == 0) {
+            continue;
+        }
+
+        //
+        //  If the string is quoted and has contents, strip off the
+        //  quotes.
+        //
+
+        if (Substring.LengthInChars >= 3 &&
+            Substring.StartOfString[0] == '"' &&
+            Substring.StartOfString[Substring.LengthInChars - 1] == '"') {
+
+            Substring.StartOfString++;
+            Substring.LengthInChars = Substring.LengthInChars - 2;
+        }
+
+        MakePrefetchQueueDirectory(MakeContext, &Substring);
+        Substring.LengthInChars = 0;
+    }
+}
+
+/**
+ Find the makefile for a scope if it has been read ahead of the parser.  If
+ a background thread is still reading it, this waits for it to complete.
+ If no thread has started reading it yet, it is read on this thread.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Directory Pointer to the fully qualified directory of the scope.
+
+ @param FileName On successful completion, updated to contain the fully
+        qualified name of the makefile.  The caller is expected to free this
+        with YoriLibFreeStringContents.
+
+ @param Lines On successful completion, updated to contain the lines of the
+        makefile, each terminated by a newline.  The caller is expected to
+        free this with YoriLibFreeStringContents.
+
+ @return TRUE if the makefile was read ahead of the parser, FALSE if it was
+         not and the caller should locate and read it.
+ */
+__success(return)
+BOOLEAN
+MakeTakePrefetchedMakefile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Directory,
+    __out PYORI_STRING FileName,
+    __out PYORI_STRING Lines
+    )
+{
+    PMAKE_PREFETCH_CONTEXT PrefetchContext;
+    PMAKE_PREFETCH_MAKEFILE Makefile;
+    PYORI_HASH_ENTRY HashEntry;
+    BOOLEAN ReadHere;
+    BOOLEAN Succeeded;
+
+    PrefetchContext = &MakeContext->Prefetch;
+    if (PrefetchContext->Makefiles == NULL) {
+        return FALSE;
+    }
+
+    HashEntry = YoriLibHashLookupByKey(PrefetchContext->Makefiles, Directory);
+    if (HashEntry == NULL) {
+        return FALSE;
+    }
+
+    Makefile = HashEntry->Context;
+
+    ReadHere = FALSE;
+    WaitForSingleObject(PrefetchContext->Mutex, INFINITE);
+    if (!Makefile->Started) {
+        YoriLibRemoveListItem(&Makefile->PendingListEntry);
+        Makefile->Started = TRUE;
+        ReadHere = TRUE;
+    }
+    ReleaseMutex(PrefetchContext->Mutex);
+
+    if (ReadHere) {
+        MakePrefetchReadMakefile(Makefile);
+    } else {
+        WaitForSingleObject(Makefile->Complete, INFINITE);
+    }
+
+    Succeeded = Makefile->Succeeded;
+    if (Succeeded) {
+        memcpy(FileName, &Makefile->FileName, sizeof(YORI_STRING));
+        memcpy(Lines, &Makefile->Lines, sizeof(YORI_STRING));
+    } else {
+        YoriLibFreeStringContents(&Makefile->FileName);
+        YoriLibFreeStringContents(&Makefile->Lines);
+    }
+
+    CloseHandle(Makefile->Complete);
+    YoriLibRemoveListItem(&Makefile->ListEntry);
+    YoriLibHashRemoveByEntry(&Makefile->HashEntry);
+    YoriLibFree(Makefile);
+
+    return Succeeded;
+}
+
+/**
+ Return the next line from a makefile that was read ahead of the parser.
+
+ @param Lines Pointer to the lines of the makefile, each terminated by a
+        newline.
+
+ @param Offset Pointer to the offset within Lines of the next line to
+        return.  On successful completion, updated to refer to the line
+        following the one returned.
+
+ @param Line On successful completion, updated to point to the next line.
+        This is a substring of Lines and is not NULL terminated.
+
+ @return TRUE to indicate a line was returned, FALSE if there are no more
+         lines.
+ */
+__success(return)
+BOOLEAN
+MakeGetNextPrefetchedLine(
+    __in PYORI_STRING Lines,
+    __inout PYORI_ALLOC_SIZE_T Offset,
+    __out PYORI_STRING Line
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (*Offset >= Lines->LengthInChars) {
+        return FALSE;
+    }
+
+    for (Index = *Offset; Index < Lines->LengthInChars; Index++) {
+        if (Lines->StartOfString[Index] == '\n') {
+            break;
+        }
+    }
+
+    YoriLibInitEmptyString(Line);
+    Line->StartOfString = &Lines->StartOfString[*Offset];
+    Line->LengthInChars = Index - *Offset;
+    *Offset = Index + 1;
+    return TRUE;
+}
+
+/**
+ Stop all background threads reading makefiles and deallocate any
+ makefiles which were read but never processed.
+
+ @param MakeContext Pointer to the make context.
+ */
+VOID
+MakeCleanupPrefetch(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    PMAKE_PREFETCH_CONTEXT PrefetchContext;
+    PMAKE_PREFETCH_MAKEFILE Makefile;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD Index;
+
+    PrefetchContext = &MakeContext->Prefetch;
+
+    if (PrefetchContext->ThreadCount > 0) {
+        WaitForSingleObject(PrefetchContext->Mutex, INFINITE);
+        PrefetchContext->Shutdown = TRUE;
+        ReleaseMutex(PrefetchContext->Mutex);
+
+        ReleaseSemaphore(PrefetchContext->WorkAvailable, PrefetchContext->ThreadCount, NULL);
+        WaitForMultipleObjects(PrefetchContext->ThreadCount, PrefetchContext->Threads, TRUE, INFINITE);
+        for (Index = 0; Index < PrefetchContext->ThreadCount; Index++) {
+            CloseHandle(PrefetchContext->Threads[Index]);
+        }
+        PrefetchContext->ThreadCount = 0;
+    }
+
+    if (PrefetchContext->Makefiles != NULL) {
+        ListEntry = YoriLibGetNextListEntry(&PrefetchContext->MakefileList, NULL);
+        while (ListEntry != NULL) {
+            Makefile = CONTAINING_RECORD(ListEntry, MAKE_PREFETCH_MAKEFILE, ListEntry);
+            YoriLibFreeStringContents(&Makefile->FileName);
+            YoriLibFreeStringContents(&Makefile->Lines);
+            CloseHandle(Makefile->Complete);
+            YoriLibRemoveListItem(&Makefile->ListEntry);
+            YoriLibHashRemoveByEntry(&Makefile->HashEntry);
+            YoriLibFree(Makefile);
+            ListEntry = YoriLibGetNextListEntry(&PrefetchContext->MakefileList, NULL);
+        }
+        YoriLibFreeEmptyHashTable(PrefetchContext->Makefiles);
+        PrefetchContext->Makefiles = NULL;
+    }
+
+    if (PrefetchContext->Mutex != NULL) {
+        CloseHandle(PrefetchContext->Mutex);
+        PrefetchContext->Mutex = NULL;
+    }
+
+    if (PrefetchContext->WorkAvailable != NULL) {
+        CloseHandle(PrefetchContext->WorkAvailable);
+        PrefetchContext->WorkAvailable = NULL;
+    }
+
+    PrefetchContext->Shutdown = FALSE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -673,11 +673,13 @@ MakeBeginNestedConditionFalse(
 }
 
 /**
- Generate the name of the preprocessor cache file from the specified
- make file name.
+ Generate the name of a cache file from the specified make file name.
 
  @param MakeFileName Pointer to the make file name.
 
+ @param Extension Pointer to a NULL terminated extension to append to the
+        make file name, including the leading period.
+
  @param CacheFileName On successful completion, updated to contain a newly
         allocated string referring to the file name of the cache file.
 
@@ -686,13 +688,14 @@ MakeBeginNestedConditionFalse(
 BOOLEAN
 MakeGetCacheFileNameFromMakeFileName(
     __in PYORI_STRING MakeFileName,
+    __in LPCTSTR Extension,
     __out PYORI_STRING CacheFileName
     )
 {
     YoriLibInitEmptyString(CacheFileName);
     if (MakeFileName->LengthInChars > 0) {
-        if (YoriLibAllocateString(CacheFileName, MakeFileName->LengthInChars + sizeof(".pru"))) {
-            CacheFileName->LengthInChars = YoriLibSPrintf(CacheFileName->StartOfString, _T("%y.pru"), MakeFileName);
+        if (YoriLibAllocateString(CacheFileName, MakeFileName->LengthInChars + (YORI_ALLOC_SIZE_T)_tcslen(Extension) + 1)) {
+            CacheFileName->LengthInChars = YoriLibSPrintf(CacheFileName->StartOfString, _T("%y%s"), MakeFileName, Extension);
             return TRUE;
         }
     }
@@ -701,34 +704,90 @@ MakeGetCacheFileNameFromMakeFileName(
 }
 
 /**
- Load preprocessor cache entries from cache file.
+ Parse a single line from a preprocessor cache file.
+
+ @param LineString Pointer to the line to parse.
+
+ @param ExitCode On successful completion, updated to contain the exit code
+        of the command.
+
+ @param Key On successful completion, updated to point to the cache key
+        within the line.  This is not a separate allocation.
+
+ @return TRUE to indicate the line was parsed successfully, FALSE if it is
+         not in the expected format.
+ */
+__success(return)
+BOOLEAN
+MakeParsePreprocessorCacheLine(
+    __in PYORI_STRING LineString,
+    __out PDWORD ExitCode,
+    __out PYORI_STRING Key
+    )
+{
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    YORI_MAX_SIGNED_T llTemp;
+
+    //
+    //  The format of each line is expected to be:
+    //  ExitCode:HashKey
+    //
+    //  Check that the first portion is numeric
+    //
+
+    if (!YoriLibStringToNumber(LineString, FALSE, &llTemp, &CharsConsumed) ||
+        CharsConsumed == 0) {
+
+        return FALSE;
+    }
+
+    //
+    //  Check that the line is long enough to contain an actual command
+    //
+
+    if (CharsConsumed + 1 + sizeof(DWORD) * 2 * 2 >= LineString->LengthInChars) {
+        return FALSE;
+    }
+
+    //
+    //  Check that the seperator is where it should be
+    //
+
+    if (LineString->StartOfString[CharsConsumed] != ':') {
+        return FALSE;
+    }
+
+    *ExitCode = (DWORD)llTemp;
+    YoriLibInitEmptyString(Key);
+    Key->StartOfString = &LineString->StartOfString[CharsConsumed + 1];
+    Key->LengthInChars = LineString->LengthInChars - CharsConsumed - 1;
+    return TRUE;
+}
+
+/**
+ Load preprocessor cache entries from a file.  Entries which are already
+ in the cache are retained, so when multiple files are loaded, the first
+ file to contain an entry takes precedence.
 
  @param MakeContext Pointer to the context.
 
- @param MakeFileName Pointer to the file name of the makefile.  If this
-        contains a string, it will be used as the base name for the cache.
+ @param CacheFileName Pointer to a NULL terminated fully qualified file name
+        of the cache file.
  */
 VOID
-MakeLoadPreprocessorCacheEntries(
+MakeLoadPreprocessorCacheFile(
     __inout PMAKE_CONTEXT MakeContext,
-    __in PYORI_STRING MakeFileName
+    __in LPCTSTR CacheFileName
     )
 {
     PMAKE_PREPROC_EXEC_CACHE_ENTRY Entry;
-    YORI_STRING CacheFileName;
     YORI_STRING Key;
     YORI_STRING LineString;
-    YORI_ALLOC_SIZE_T CharsConsumed;
-    YORI_MAX_SIGNED_T llTemp;
+    DWORD ExitCode;
     HANDLE hCache;
     PVOID LineContext = NULL;
 
-    if (!MakeGetCacheFileNameFromMakeFileName(MakeFileName, &CacheFileName)) {
-        return;
-    }
-
-    hCache = CreateFile(CacheFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    YoriLibFreeStringContents(&CacheFileName);
+    hCache = CreateFile(CacheFileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (hCache == INVALID_HANDLE_VALUE) {
         return;
     }
@@ -740,69 +799,158 @@ MakeLoadPreprocessorCacheEntries(
             break;
         }
 
+        if (!MakeParsePreprocessorCacheLine(&LineString, &ExitCode, &Key)) {
+            break;
+        }
+
+        if (YoriLibHashLookupByKey(MakeContext->PreprocessorCache, &Key) != NULL) {
+            continue;
+        }
+
         Entry = YoriLibMalloc(sizeof(MAKE_PREPROC_EXEC_CACHE_ENTRY));
         if (Entry == NULL) {
             break;
         }
 
         ZeroMemory(Entry, sizeof(MAKE_PREPROC_EXEC_CACHE_ENTRY));
+        Entry->ExitCode = ExitCode;
 
         //
-        //  The format of each line is expected to be:
-        //  ExitCode:HashKey
-        //
-        //  Check that the first portion is numeric
+        //  The hash package copies the key, so the line buffer can be
+        //  reused for the next line
         //
 
-        if (!YoriLibStringToNumber(&LineString, FALSE, &llTemp, &CharsConsumed) ||
-            CharsConsumed == 0) {
+        YoriLibHashInsertByKey(MakeContext->PreprocessorCache, &Key, Entry, &Entry->HashEntry);
 
-            YoriLibFree(Entry);
-            break;
-        }
-        Entry->ExitCode = (DWORD)llTemp;
+        YoriLibAppendList(&MakeContext->PreprocessorCacheList, &Entry->ListEntry);
+    }
 
-        //
-        //  Check that the line is long enough to contain an actual command
-        //
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(hCache);
+}
 
-        if (CharsConsumed + 1 + sizeof(DWORD) * 2 * 2 >= LineString.LengthInChars) {
-            YoriLibFree(Entry);
-            break;
-        }
+/**
+ Load preprocessor cache entries from cache file.  If a shared cache file
+ has been specified, entries from it are loaded after the entries specific
+ to this makefile.
 
-        //
-        //  Check that the seperator is where it should be
-        //
+ @param MakeContext Pointer to the context.
 
-        if (LineString.StartOfString[CharsConsumed] != ':') {
-            YoriLibFree(Entry);
-            break;
-        }
+ @param MakeFileName Pointer to the file name of the makefile.  If this
+        contains a string, it will be used as the base name for the cache.
+ */
+VOID
+MakeLoadPreprocessorCacheEntries(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING MakeFileName
+    )
+{
+    YORI_STRING CacheFileName;
 
-        //
-        //  Copy the trailing portion of the line so the hash package has
-        //  an allocation that won't go away
-        //
+    if (MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".pru"), &CacheFileName)) {
+        MakeLoadPreprocessorCacheFile(MakeContext, CacheFileName.StartOfString);
+        YoriLibFreeStringContents(&CacheFileName);
+    }
 
-        if (!YoriLibAllocateString(&Key, LineString.LengthInChars - CharsConsumed - 1)) {
-            YoriLibFree(Entry);
-            break;
-        }
+    if (MakeContext->SharedPreprocessorCacheFileName.LengthInChars > 0) {
+        MakeLoadPreprocessorCacheFile(MakeContext, MakeContext->SharedPreprocessorCacheFileName.StartOfString);
+    }
+}
 
-        memcpy(Key.StartOfString, &LineString.StartOfString[CharsConsumed + 1], (LineString.LengthInChars - CharsConsumed - 1) * sizeof(TCHAR));
-        Key.LengthInChars = LineString.LengthInChars - CharsConsumed - 1;
+/**
+ The maximum number of entries to retain in a shared preprocessor cache
+ file.  Since the file is shared by any number of makefiles, without a
+ limit it would grow indefinitely as environments and makefiles change.
+ */
+#define MAKE_SHARED_PREPROC_CACHE_MAXIMUM_ENTRIES (8192)
 
-        YoriLibHashInsertByKey(MakeContext->PreprocessorCache, &Key, Entry, &Entry->HashEntry);
+/**
+ Merge the preprocessor cache entries from this invocation into the shared
+ cache file.  The shared file is read again so that entries written by
+ other invocations since it was loaded are retained, and the result is
+ written to a temporary file and renamed over the shared file, so that a
+ concurrent reader never observes a partially written file.  Entries from
+ this invocation are written first, and older entries beyond
+ MAKE_SHARED_PREPROC_CACHE_MAXIMUM_ENTRIES are discarded.
 
-        YoriLibAppendList(&MakeContext->PreprocessorCacheList, &Entry->ListEntry);
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeSaveSharedPreprocessorCacheEntries(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry = NULL;
+    PMAKE_PREPROC_EXEC_CACHE_ENTRY Entry;
+    YORI_STRING TempName;
+    YORI_STRING LineString;
+    YORI_STRING Key;
+    PVOID LineContext = NULL;
+    DWORD ExitCode;
+    DWORD EntriesWritten;
+    HANDLE hShared;
+    HANDLE hTemp;
 
-        YoriLibFreeStringContents(&Key);
+    if (MakeContext->PreprocessorCache == NULL ||
+        MakeContext->SharedPreprocessorCacheFileName.LengthInChars == 0) {
+
+        return;
     }
 
-    YoriLibLineReadCloseOrCache(LineContext);
-    YoriLibFreeStringContents(&LineString);
-    CloseHandle(hCache);
+    if (!YoriLibAllocateString(&TempName, MakeContext->SharedPreprocessorCacheFileName.LengthInChars + sizeof(".tmp") + 10)) {
+        return;
+    }
+
+    TempName.LengthInChars = YoriLibSPrintf(TempName.StartOfString, _T("%y.%i.tmp"), &MakeContext->SharedPreprocessorCacheFileName, GetCurrentProcessId());
+
+    hTemp = CreateFile(TempName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hTemp == INVALID_HANDLE_VALUE) {
+        YoriLibFreeStringContents(&TempName);
+        return;
+    }
+
+    EntriesWritten = 0;
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->PreprocessorCacheList, NULL);
+    while (ListEntry != NULL && EntriesWritten < MAKE_SHARED_PREPROC_CACHE_MAXIMUM_ENTRIES) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_PREPROC_EXEC_CACHE_ENTRY, ListEntry);
+        YoriLibOutputToDevice(hTemp, 0, _T("%i:%y\n"), Entry->ExitCode, &Entry->HashEntry.Key);
+        EntriesWritten++;
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->PreprocessorCacheList, ListEntry);
+    }
+
+    hShared = CreateFile(MakeContext->SharedPreprocessorCacheFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hShared != INVALID_HANDLE_VALUE) {
+        YoriLibInitEmptyString(&LineString);
+        while (EntriesWritten < MAKE_SHARED_PREPROC_CACHE_MAXIMUM_ENTRIES) {
+            if (!YoriLibReadLineToString(&LineString, &LineContext, hShared)) {
+                break;
+            }
+
+            if (!MakeParsePreprocessorCacheLine(&LineString, &ExitCode, &Key)) {
+                break;
+            }
+
+            if (YoriLibHashLookupByKey(MakeContext->PreprocessorCache, &Key) != NULL) {
+                continue;
+            }
+
+            YoriLibOutputToDevice(hTemp, 0, _T("%i:%y\n"), ExitCode, &Key);
+            EntriesWritten++;
+        }
+
+        YoriLibLineReadCloseOrCache(LineContext);
+        YoriLibFreeStringContents(&LineString);
+        CloseHandle(hShared);
+    }
+
+    CloseHandle(hTemp);
+
+    if (!MoveFileEx(TempName.StartOfString, MakeContext->SharedPreprocessorCacheFileName.StartOfString, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFile(TempName.StartOfString);
+    }
+
+    YoriLibFreeStringContents(&TempName);
 }
 
 /**
@@ -831,7 +979,7 @@ MakeSaveAndDeleteAllPreprocessorCacheEntries(
 
     hCache = NULL;
     YoriLibInitEmptyString(&CacheFileName);
-    if (MakeGetCacheFileNameFromMakeFileName(MakeFileName, &CacheFileName)) {
+    if (MakeGetCacheFileNameFromMakeFileName(MakeFileName, _T(".pru"), &CacheFileName)) {
         hCache = CreateFile(CacheFileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
         if (hCache == INVALID_HANDLE_VALUE) {
             hCache = NULL;
@@ -1045,6 +1193,7 @@ MakeExecuteCommandCaptureExitCode(
     YORI_LIBSH_EXEC_PLAN ExecPlan;
     LARGE_INTEGER StartTime;
     LARGE_INTEGER EndTime;
+    YORI_STRING Source;
     DWORD ExitCode;
 
     //
@@ -1052,6 +1201,7 @@ MakeExecuteCommandCaptureExitCode(
     //
 
     ExitCode = 255;
+    YoriLibConstantString(&Source, _T("executed"));
 
 #if MAKE_DEBUG_PREPROCESSOR_CREATEPROCESS
     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Executing preprocessor command: %y\n"), Cmd);
@@ -1063,10 +1213,24 @@ MakeExecuteCommandCaptureExitCode(
         Entry = MakeLookupPreprocessorCache(ScopeContext, Cmd);
         if (Entry != NULL) {
             ExitCode = Entry->ExitCode;
+            YoriLibConstantString(&Source, _T("cached"));
             goto Complete;
         }
     }
 
+    //
+    //  If the command was launched speculatively or has already been
+    //  executed by another scope, use that result.
+    //
+
+    if (MakeGetSpeculativeProbeResult(ScopeContext->MakeContext, Cmd, &ExitCode)) {
+        YoriLibConstantString(&Source, _T("speculative"));
+        if (ScopeContext->MakeContext->PreprocessorCache != NULL) {
+            MakeAddToPreprocessorCache(ScopeContext, Cmd, ExitCode);
+        }
+        goto Complete;
+    }
+
     if (!YoriLibShParseCmdlineToCmdContext(Cmd, 0, &CmdContext)) {
         goto Complete;
     }
@@ -1081,6 +1245,15 @@ MakeExecuteCommandCaptureExitCode(
     YoriLibShFreeExecPlan(&ExecPlan);
     YoriLibShFreeCmdContext(&CmdContext);
 
+    MakeRecordSpeculativeProbeResult(ScopeContext->MakeContext, Cmd, ExitCode);
+
+    //
+    //  The command may have created or deleted files, so any directory
+    //  listings used to resolve inference rules may be stale.
+    //
+
+    MakeProbeCleanupDirectoryListings(ScopeContext->MakeContext);
+
     if (ScopeContext->MakeContext->PreprocessorCache != NULL) {
         MakeAddToPreprocessorCache(ScopeContext, Cmd, ExitCode);
     }
@@ -1089,6 +1262,7 @@ Complete:
 
     QueryPerformanceCounter(&EndTime);
     ScopeContext->MakeContext->TimeInPreprocessorCreateProcess = ScopeContext->MakeContext->TimeInPreprocessorCreateProcess + EndTime.QuadPart - StartTime.QuadPart;
+    MakeTraceRecordEvent(ScopeContext->MakeContext, _T("preprocessor"), Cmd, 0, &StartTime, &EndTime, &Source, ExitCode);
 #if MAKE_DEBUG_PREPROCESSOR_CREATEPROCESS
     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("...took %lli\n"), EndTime.QuadPart - StartTime.QuadPart);
 #endif
@@ -1566,7 +1740,7 @@ MakeInclude(
     YoriLibCloneString(&ScopeContext->CurrentIncludeDirectory, &FullPath);
     ScopeContext->CurrentIncludeDirectory.LengthInChars = (YORI_ALLOC_SIZE_T)((FilePart - ScopeContext->CurrentIncludeDirectory.StartOfString) - 1);
 
-    if (!MakeProcessStream(hStream, ScopeContext->MakeContext, &FullPath)) {
+    if (!MakeProcessStream(hStream, ScopeContext->MakeContext, &FullPath, NULL)) {
 #if MAKE_DEBUG_PREPROCESSOR
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ERROR: MakeProcessStream failed: %y\n"), &FullPath);
 #endif
@@ -1871,10 +2045,10 @@ CONST YORI_STRING MakefileNameCandidates[] = {
 };
 
 /**
- Find the first existing makefile in a directory specified by the scope
- context.
+ Find the first existing makefile in a specified directory.  This does not
+ depend on any make state, so it can be called from any thread.
 
- @param ScopeContext Pointer to the scope context.
+ @param Directory Pointer to the fully qualified directory name.
 
  @param FileName On successful completion, populated with a newly allocated
         string indicating the full path name to the makefile.
@@ -1884,8 +2058,8 @@ CONST YORI_STRING MakefileNameCandidates[] = {
  */
 __success(return)
 BOOLEAN
-MakeFindMakefileInDirectory(
-    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+MakeFindMakefileInDirectoryByName(
+    __in PYORI_STRING Directory,
     __out PYORI_STRING FileName
     )
 {
@@ -1900,12 +2074,12 @@ MakeFindMakefileInDirectory(
         }
     }
 
-    if (!YoriLibAllocateString(&ProbeName, ScopeContext->HashEntry.Key.LengthInChars + 1 + LongestName + 1)) {
+    if (!YoriLibAllocateString(&ProbeName, Directory->LengthInChars + 1 + LongestName + 1)) {
         return FALSE;
     }
 
     for (Index = 0; Index < sizeof(MakefileNameCandidates)/sizeof(MakefileNameCandidates[0]); Index++) {
-        ProbeName.LengthInChars = YoriLibSPrintf(ProbeName.StartOfString, _T("%y\\%y"), &ScopeContext->HashEntry.Key, &MakefileNameCandidates[Index]);
+        ProbeName.LengthInChars = YoriLibSPrintf(ProbeName.StartOfString, _T("%y\\%y"), Directory, &MakefileNameCandidates[Index]);
         if (GetFileAttributes(ProbeName.StartOfString) != (DWORD)-1) {
             memcpy(FileName, &ProbeName, sizeof(YORI_STRING));
             return TRUE;
@@ -1916,6 +2090,28 @@ MakeFindMakefileInDirectory(
     return FALSE;
 }
 
+/**
+ Find the first existing makefile in a directory specified by the scope
+ context.
+
+ @param ScopeContext Pointer to the scope context.
+
+ @param FileName On successful completion, populated with a newly allocated
+        string indicating the full path name to the makefile.
+
+ @return TRUE to indicate that a makefile was found, FALSE to indicate it was
+         not found or an error occurred.
+ */
+__success(return)
+BOOLEAN
+MakeFindMakefileInDirectory(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __out PYORI_STRING FileName
+    )
+{
+    return MakeFindMakefileInDirectoryByName(&ScopeContext->HashEntry.Key, FileName);
+}
+
 /**
  Parse extended information about a target.  These options are enclosed in
  square braces.
@@ -2106,6 +2302,8 @@ MakeCreateFileListDependency(
         return FALSE;
     }
 
+    MakeBuildDbRecordInput(MakeContext, &FullPath, hStream);
+
     LineContext = NULL;
     Result = TRUE;
     YoriLibInitEmptyString(&LineString);
@@ -2170,6 +2368,8 @@ MakeCreateSubdirectoryDependency(
     BOOLEAN Return;
     HANDLE hStream;
     YORI_STRING FullPath;
+    YORI_STRING PrefetchedLines;
+    PYORI_STRING LinesToProcess;
     BOOLEAN FoundExisting;
 
     if (!MakeActivateScope(MakeContext, ParentDependencyDirectory, &FoundExisting)) {
@@ -2178,10 +2378,20 @@ MakeCreateSubdirectoryDependency(
 
     Return = FALSE;
     YoriLibInitEmptyString(&FullPath);
+    YoriLibInitEmptyString(&PrefetchedLines);
 
     if (!FoundExisting) {
 
-        if (!MakeFindMakefileInDirectory(MakeContext->ActiveScope, &FullPath)) {
+        //
+        //  If the makefile has already been read on a background thread,
+        //  process the lines that were read.  The file is still opened
+        //  here so that it can be recorded with its timestamp.
+        //
+
+        LinesToProcess = NULL;
+        if (MakeTakePrefetchedMakefile(MakeContext, &MakeContext->ActiveScope->HashEntry.Key, &FullPath, &PrefetchedLines)) {
+            LinesToProcess = &PrefetchedLines;
+        } else if (!MakeFindMakefileInDirectory(MakeContext->ActiveScope, &FullPath)) {
             YoriLibInitEmptyString(&FullPath);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Could not find makefile in directory: %y\n"), &MakeContext->ActiveScope->HashEntry.Key);
             goto Exit;
@@ -2193,7 +2403,7 @@ MakeCreateSubdirectoryDependency(
             goto Exit;
         }
 
-        if (!MakeProcessStream(hStream, MakeContext, &FullPath)) {
+        if (!MakeProcessStream(hStream, MakeContext, &FullPath, LinesToProcess)) {
 #if MAKE_DEBUG_PREPROCESSOR
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ERROR: MakeProcessStream failed: %y\n"), &FullPath);
 #endif
@@ -2209,6 +2419,7 @@ MakeCreateSubdirectoryDependency(
 
 Exit:
     YoriLibFreeStringContents(&FullPath);
+    YoriLibFreeStringContents(&PrefetchedLines);
     MakeDeactivateScope(MakeContext->ActiveScope);
     return Return;
 }
@@ -2325,6 +2536,19 @@ MakeAddRule(
 
     MakeContext = ScopeContext->MakeContext;
 
+    //
+    //  If the dependencies are subdirectories, start reading all of their
+    //  makefiles in the background before processing the first of them.
+    //
+
+    if (Subdirectories && ReadIndex < Line->LengthInChars) {
+        YORI_STRING DirectoryList;
+        YoriLibInitEmptyString(&DirectoryList);
+        DirectoryList.StartOfString = &Line->StartOfString[ReadIndex];
+        DirectoryList.LengthInChars = Line->LengthInChars - ReadIndex;
+        MakePrefetchSubdirectoryMakefiles(MakeContext, &DirectoryList);
+    }
+
     SwallowingWhitespace = TRUE;
     QuoteOpen = FALSE;
     Substring.LengthInChars = 0;
@@ -2669,6 +2893,165 @@ MakeAddRecipeCommand(
     return TRUE;
 }
 
+/**
+ Scan a makefile before it is processed, and launch any commands in !IF
+ expressions that are not nested within another conditional.  These are
+ evaluated whenever the makefile is processed, so launching them early
+ allows them to execute concurrently with each other and with parsing of
+ the makefile, rather than each being executed serially when the
+ preprocessor reaches it.  Commands are expanded using the variables that
+ are defined when the makefile starts; if a variable is changed before the
+ command is evaluated, the expanded command will not match and it is
+ executed normally.
+
+ @param ScopeContext Pointer to the scope context.
+
+ @param FileName Pointer to the fully qualified file name of the makefile.
+ */
+VOID
+MakeSpeculatePreprocessorCommands(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __in PYORI_STRING FileName
+    )
+{
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    YORI_STRING LineToProcess;
+    YORI_STRING ExpandedLine;
+    YORI_STRING VariableNotFound;
+    YORI_STRING Arg;
+    YORI_STRING Cmd;
+    MAKE_PREPROCESSOR_LINE_TYPE PreprocessorLineType;
+    YORI_ALLOC_SIZE_T ArgOffset;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T EndIndex;
+    DWORD NestingLevel;
+    BOOLEAN PreviousLineContinued;
+    BOOLEAN MoreAllowed;
+    HANDLE hSource;
+
+    if (ScopeContext->MakeContext->SpeculativeProbes == NULL) {
+        return;
+    }
+
+    hSource = CreateFile(FileName->StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hSource == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&LineToProcess);
+    YoriLibInitEmptyString(&ExpandedLine);
+    NestingLevel = 0;
+    PreviousLineContinued = FALSE;
+    MoreAllowed = TRUE;
+
+    while (MoreAllowed) {
+
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+            break;
+        }
+
+        LineToProcess.StartOfString = LineString.StartOfString;
+        LineToProcess.LengthInChars = LineString.LengthInChars;
+        MakeTruncateComments(&LineToProcess);
+
+        //
+        //  Joined lines are skipped entirely.  Any command on them will be
+        //  executed when it is evaluated.
+        //
+
+        if (PreviousLineContinued) {
+            if (LineToProcess.LengthInChars == 0 ||
+                LineToProcess.StartOfString[LineToProcess.LengthInChars - 1] != '\\') {
+                PreviousLineContinued = FALSE;
+            }
+            continue;
+        }
+
+        if (LineToProcess.LengthInChars > 0 &&
+            LineToProcess.StartOfString[LineToProcess.LengthInChars - 1] == '\\') {
+            PreviousLineContinued = TRUE;
+            continue;
+        }
+
+        if (LineToProcess.LengthInChars == 0 ||
+            LineToProcess.StartOfString[0] != '!') {
+            continue;
+        }
+
+        MakeTrimWhitespace(&LineToProcess);
+        PreprocessorLineType = MakeDeterminePreprocessorLineType(&LineToProcess, &ArgOffset);
+
+        switch(PreprocessorLineType) {
+            case MakePreprocessorLineTypeIfDef:
+            case MakePreprocessorLineTypeIfNDef:
+                NestingLevel++;
+                break;
+            case MakePreprocessorLineTypeEndIf:
+                if (NestingLevel > 0) {
+                    NestingLevel--;
+                }
+                break;
+            case MakePreprocessorLineTypeError:
+                if (NestingLevel == 0) {
+                    MoreAllowed = FALSE;
+                }
+                break;
+            case MakePreprocessorLineTypeIf:
+                NestingLevel++;
+                if (NestingLevel > 1 || ArgOffset >= LineToProcess.LengthInChars) {
+                    break;
+                }
+
+                YoriLibInitEmptyString(&Arg);
+                Arg.StartOfString = &LineToProcess.StartOfString[ArgOffset];
+                Arg.LengthInChars = LineToProcess.LengthInChars - ArgOffset;
+
+                YoriLibInitEmptyString(&VariableNotFound);
+                if (!MakeExpandVariables(ScopeContext, NULL, &ExpandedLine, &Arg, &VariableNotFound) ||
+                    VariableNotFound.LengthInChars > 0) {
+                    break;
+                }
+
+                //
+                //  Launch the contents of each bracketed command within
+                //  the expression.
+                //
+
+                for (Index = 0; Index < ExpandedLine.LengthInChars && MoreAllowed; Index++) {
+                    if (ExpandedLine.StartOfString[Index] != '[') {
+                        continue;
+                    }
+
+                    for (EndIndex = Index + 1; EndIndex < ExpandedLine.LengthInChars; EndIndex++) {
+                        if (ExpandedLine.StartOfString[EndIndex] == ']') {
+                            break;
+                        }
+                    }
+
+                    if (EndIndex >= ExpandedLine.LengthInChars) {
+                        break;
+                    }
+
+                    YoriLibInitEmptyString(&Cmd);
+                    Cmd.StartOfString = &ExpandedLine.StartOfString[Index + 1];
+                    Cmd.LengthInChars = EndIndex - Index - 1;
+                    if (Cmd.LengthInChars > 0) {
+                        MoreAllowed = MakeSpeculatePreprocessorCommand(ScopeContext->MakeContext, &Cmd);
+                    }
+                    Index = EndIndex;
+                }
+                break;
+        }
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&ExpandedLine);
+    CloseHandle(hSource);
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
@@ -2680,16 +3063,23 @@ MakeAddRecipeCommand(
 
  @param FileName Pointer to the file name string, used in error reporting.
 
+ @param PrefetchedLines Optionally points to the contents of the stream,
+        which has already been read and split into lines, each terminated by
+        a newline.  If specified, lines are returned from here rather than
+        reading them from hSource.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 MakeProcessStream(
     __in HANDLE hSource,
     __in PMAKE_CONTEXT MakeContext,
-    __in PYORI_STRING FileName
+    __in PYORI_STRING FileName,
+    __in_opt PYORI_STRING PrefetchedLines
     )
 {
     PVOID LineContext = NULL;
+    YORI_ALLOC_SIZE_T PrefetchedOffset;
     YORI_STRING JoinedLine;
     YORI_STRING LineString;
     YORI_STRING LineToProcess;
@@ -2709,14 +3099,22 @@ MakeProcessStream(
     YoriLibInitEmptyString(&LineToProcess);
     YoriLibInitEmptyString(&ExpandedLine);
     LineNumber = 0;
+    PrefetchedOffset = 0;
 
 #if MAKE_DEBUG_PREPROCESSOR
     YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Processing %y\n"), FileName);
 #endif
 
+    MakeBuildDbRecordInput(MakeContext, FileName, hSource);
+    MakeSpeculatePreprocessorCommands(ScopeContext, FileName);
+
     while (TRUE) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        if (PrefetchedLines != NULL) {
+            if (!MakeGetNextPrefetchedLine(PrefetchedLines, &PrefetchedOffset, &LineString)) {
+                break;
+            }
+        } else if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
             break;
         }
         LineNumber++;
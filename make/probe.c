@@ -0,0 +1,1124 @@
+/**
+ * @file make/probe.c
+ *
+ * Yori shell make batched file timestamp probing
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ The minimum number of targets within a single directory before the
+ directory is enumerated to find their timestamps.  With fewer targets than
+ this, opening each target when it is needed is likely to be faster than
+ enumerating a directory that may contain many unrelated files.
+ */
+#define MAKE_PROBE_MINIMUM_TARGETS_PER_DIRECTORY (4)
+
+/**
+ The maximum number of threads to use when enumerating directories.  This
+ work is dominated by waiting on the file system, so it can use more threads
+ than there are processors, but there is little value in flooding a remote
+ server.
+ */
+#define MAKE_PROBE_MAXIMUM_THREADS (16)
+
+/**
+ A single target being probed as part of a directory enumeration.
+ */
+typedef struct _MAKE_PROBE_FILE {
+
+    /**
+     The hash entry.  Key is the file name component of the target, without
+     any path.  Paired with MAKE_PROBE_DIRECTORY::Files .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all files within a directory, used to facilitate bulk
+     delete.  Paired with MAKE_PROBE_DIRECTORY::FileList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The target to update with the result of the enumeration.
+     */
+    PMAKE_TARGET Target;
+
+} MAKE_PROBE_FILE, *PMAKE_PROBE_FILE;
+
+/**
+ A single directory containing targets whose timestamps should be probed.
+ */
+typedef struct _MAKE_PROBE_DIRECTORY {
+
+    /**
+     The hash entry.  Key is the fully qualified directory name.  Paired with
+     MAKE_PROBE_CONTEXT::Directories .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all directories, used to facilitate bulk delete.  Paired
+     with MAKE_PROBE_CONTEXT::DirectoryList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The linkage of directories which are waiting to be enumerated.  Paired
+     with MAKE_PROBE_CONTEXT::PendingList .
+     */
+    YORI_LIST_ENTRY PendingListEntry;
+
+    /**
+     A hash table of files within this directory, indexed by file name.
+     This is only allocated once enough targets are found within the
+     directory to make enumeration worthwhile, and until that point the
+     targets are only counted.
+     */
+    PYORI_HASH_TABLE Files;
+
+    /**
+     A list of files within this directory.  Paired with
+     MAKE_PROBE_FILE::ListEntry .
+     */
+    YORI_LIST_ENTRY FileList;
+
+    /**
+     The string to enumerate, consisting of the directory name followed by
+     a wildcard.  This is allocated before background threads are started
+     so they do not need to allocate.
+     */
+    YORI_STRING SearchString;
+
+    /**
+     The number of targets found within this directory.
+     */
+    DWORD TargetCount;
+
+} MAKE_PROBE_DIRECTORY, *PMAKE_PROBE_DIRECTORY;
+
+/**
+ State describing a single batched probe operation.
+ */
+typedef struct _MAKE_PROBE_CONTEXT {
+
+    /**
+     A hash table of directories containing targets.
+     */
+    PYORI_HASH_TABLE Directories;
+
+    /**
+     A list of directories containing targets, used to facilitate bulk
+     delete.  Paired with MAKE_PROBE_DIRECTORY::ListEntry .
+     */
+    YORI_LIST_ENTRY DirectoryList;
+
+    /**
+     A list of directories waiting to be enumerated.  Paired with
+     MAKE_PROBE_DIRECTORY::PendingListEntry .
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     A mutex synchronizing access to PendingList between threads.
+     */
+    HANDLE Mutex;
+
+    /**
+     The number of directories in PendingList.
+     */
+    DWORD PendingCount;
+
+} MAKE_PROBE_CONTEXT, *PMAKE_PROBE_CONTEXT;
+
+/**
+ Find the directory structure for a specified directory, allocating one if
+ it does not exist yet.
+
+ @param ProbeContext Pointer to the probe context.
+
+ @param DirectoryName Pointer to the fully qualified directory name.
+
+ @return Pointer to the directory structure, or NULL on allocation failure.
+ */
+PMAKE_PROBE_DIRECTORY
+MakeProbeLookupDirectory(
+    __in PMAKE_PROBE_CONTEXT ProbeContext,
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_PROBE_DIRECTORY Directory;
+
+    HashEntry = YoriLibHashLookupByKey(ProbeContext->Directories, DirectoryName);
+    if (HashEntry != NULL) {
+        return HashEntry->Context;
+    }
+
+    Directory = YoriLibMalloc(sizeof(MAKE_PROBE_DIRECTORY));
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Directory, sizeof(MAKE_PROBE_DIRECTORY));
+    YoriLibInitializeListHead(&Directory->FileList);
+    YoriLibInitializeListHead(&Directory->PendingListEntry);
+    YoriLibInitEmptyString(&Directory->SearchString);
+
+    YoriLibHashInsertByKey(ProbeContext->Directories, DirectoryName, Directory, &Directory->HashEntry);
+    YoriLibAppendList(&ProbeContext->DirectoryList, &Directory->ListEntry);
+    return Directory;
+}
+
+/**
+ Add a target to the set of files to find within a directory.
+
+ @param Directory Pointer to the directory containing the target.
+
+ @param Target Pointer to the target.
+
+ @param FileName Pointer to the file name component of the target.  This is
+        a substring of the target's name.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeProbeAddFileToDirectory(
+    __in PMAKE_PROBE_DIRECTORY Directory,
+    __in PMAKE_TARGET Target,
+    __in PYORI_STRING FileName
+    )
+{
+    PMAKE_PROBE_FILE File;
+
+    File = YoriLibMalloc(sizeof(MAKE_PROBE_FILE));
+    if (File == NULL) {
+        return FALSE;
+    }
+
+    File->Target = Target;
+    YoriLibHashInsertByKey(Directory->Files, FileName, File, &File->HashEntry);
+    YoriLibAppendList(&Directory->FileList, &File->ListEntry);
+    return TRUE;
+}
+
+/**
+ Split a target name into its directory and file name components.
+
+ @param Target Pointer to the target.
+
+ @param DirectoryName On successful completion, updated to point to the
+        directory component of the target name.  This is not NULL
+        terminated.
+
+ @param FileName On successful completion, updated to point to the file
+        name component of the target name.
+
+ @return TRUE to indicate the target name was split, FALSE if it does not
+         refer to an object within a directory.
+ */
+__success(return)
+BOOLEAN
+MakeProbeSplitTargetName(
+    __in PMAKE_TARGET Target,
+    __out PYORI_STRING DirectoryName,
+    __out PYORI_STRING FileName
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriLibInitEmptyString(DirectoryName);
+    YoriLibInitEmptyString(FileName);
+
+    for (Index = Target->HashEntry.Key.LengthInChars; Index > 0; Index--) {
+        if (Target->HashEntry.Key.StartOfString[Index - 1] == '\\') {
+            break;
+        }
+    }
+
+    if (Index <= 1 || Index == Target->HashEntry.Key.LengthInChars) {
+        return FALSE;
+    }
+
+    //
+    //  Enumerating by short name will not find targets specified by short
+    //  name, so leave these to be opened individually.
+    //
+
+    FileName->StartOfString = &Target->HashEntry.Key.StartOfString[Index];
+    FileName->LengthInChars = Target->HashEntry.Key.LengthInChars - Index;
+    if (YoriLibFindLeftMostCharacter(FileName, '~') != NULL ||
+        YoriLibFindLeftMostCharacter(FileName, '*') != NULL ||
+        YoriLibFindLeftMostCharacter(FileName, '?') != NULL) {
+
+        return FALSE;
+    }
+
+    DirectoryName->StartOfString = Target->HashEntry.Key.StartOfString;
+    DirectoryName->LengthInChars = Index - 1;
+    return TRUE;
+}
+
+/**
+ Enumerate a single directory and update the timestamps of all targets
+ found within it.  If the enumeration succeeds, targets that are not found
+ are marked as not existing.  If it fails, targets are left unprobed so
+ they can be opened individually when needed.
+
+ @param Directory Pointer to the directory to enumerate.
+ */
+VOID
+MakeProbeEnumerateDirectory(
+    __in PMAKE_PROBE_DIRECTORY Directory
+    )
+{
+    HANDLE hFind;
+    WIN32_FIND_DATA FindData;
+    YORI_STRING FileName;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_PROBE_FILE File;
+    PMAKE_TARGET Target;
+
+    hFind = FindFirstFile(Directory->SearchString.StartOfString, &FindData);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        if (GetLastError() != ERROR_FILE_NOT_FOUND &&
+            GetLastError() != ERROR_PATH_NOT_FOUND) {
+
+            return;
+        }
+    } else {
+        YoriLibInitEmptyString(&FileName);
+        do {
+            YoriLibConstantString(&FileName, FindData.cFileName);
+            HashEntry = YoriLibHashLookupByKey(Directory->Files, &FileName);
+            if (HashEntry != NULL) {
+                File = HashEntry->Context;
+                Target = File->Target;
+                Target->FileExists = TRUE;
+                if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                    Target->ModifiedTime.QuadPart = 0;
+                } else {
+                    Target->ModifiedTime.LowPart = FindData.ftLastWriteTime.dwLowDateTime;
+                    Target->ModifiedTime.HighPart = FindData.ftLastWriteTime.dwHighDateTime;
+                }
+            }
+        } while (FindNextFile(hFind, &FindData));
+
+        if (GetLastError() != ERROR_NO_MORE_FILES) {
+            FindClose(hFind);
+            ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+            while (ListEntry != NULL) {
+                File = CONTAINING_RECORD(ListEntry, MAKE_PROBE_FILE, ListEntry);
+                File->Target->FileExists = FALSE;
+                File->Target->ModifiedTime.QuadPart = 0;
+                ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+            }
+            return;
+        }
+        FindClose(hFind);
+    }
+
+    //
+    //  The directory was completely enumerated, so anything not found does
+    //  not exist.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, MAKE_PROBE_FILE, ListEntry);
+        File->Target->FileProbed = TRUE;
+        ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+    }
+}
+
+/**
+ A background thread which enumerates directories until no more directories
+ remain.
+
+ @param Context Pointer to the probe context.
+
+ @return Thread exit code, unused.
+ */
+DWORD WINAPI
+MakeProbeWorker(
+    __in LPVOID Context
+    )
+{
+    PMAKE_PROBE_CONTEXT ProbeContext;
+    PMAKE_PROBE_DIRECTORY Directory;
+    PYORI_LIST_ENTRY ListEntry;
+
+    ProbeContext = (PMAKE_PROBE_CONTEXT)Context;
+
+    while (TRUE) {
+        if (ProbeContext->Mutex != NULL) {
+            WaitForSingleObject(ProbeContext->Mutex, INFINITE);
+        }
+        ListEntry = YoriLibGetNextListEntry(&ProbeContext->PendingList, NULL);
+        if (ListEntry != NULL) {
+            YoriLibRemoveListItem(ListEntry);
+        }
+        if (ProbeContext->Mutex != NULL) {
+            ReleaseMutex(ProbeContext->Mutex);
+        }
+
+        if (ListEntry == NULL) {
+            break;
+        }
+
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_PROBE_DIRECTORY, PendingListEntry);
+        MakeProbeEnumerateDirectory(Directory);
+    }
+
+    return 0;
+}
+
+/**
+ A single file found when enumerating a directory to resolve inference rule
+ source files.
+ */
+typedef struct _MAKE_LISTED_FILE {
+
+    /**
+     The hash entry.  Key is the file name, which is stored immediately
+     following this structure.  Paired with MAKE_DIRECTORY_LISTING::Files .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all files within a directory, used to facilitate bulk
+     delete.  Paired with MAKE_DIRECTORY_LISTING::FileList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The last write time of the file, or zero if the file is a directory.
+     */
+    LARGE_INTEGER ModifiedTime;
+
+} MAKE_LISTED_FILE, *PMAKE_LISTED_FILE;
+
+/**
+ A directory whose contents may be cached to resolve inference rule source
+ files without opening each candidate file.
+ */
+typedef struct _MAKE_DIRECTORY_LISTING {
+
+    /**
+     The hash entry.  Key is the fully qualified directory name, which is
+     stored immediately following this structure.  Paired with
+     MAKE_CONTEXT::DirectoryListings .
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all directory listings, used to facilitate bulk delete.
+     Paired with MAKE_CONTEXT::DirectoryListingList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A hash table of files found within this directory, indexed by file
+     name.  This is only allocated once the directory has been enumerated.
+     */
+    PYORI_GROWABLE_HASH_TABLE Files;
+
+    /**
+     A list of files found within this directory.  Paired with
+     MAKE_LISTED_FILE::ListEntry .
+     */
+    YORI_LIST_ENTRY FileList;
+
+    /**
+     The number of times a file has been looked for in this directory.
+     */
+    DWORD ProbeCount;
+
+    /**
+     TRUE if the directory has been completely enumerated, so any file not
+     in Files does not exist.
+     */
+    BOOLEAN Enumerated;
+
+    /**
+     TRUE if an attempt to enumerate the directory failed, so files within
+     it should be opened individually.
+     */
+    BOOLEAN EnumerationFailed;
+
+} MAKE_DIRECTORY_LISTING, *PMAKE_DIRECTORY_LISTING;
+
+/**
+ Find the listing structure for a specified directory, allocating one if it
+ does not exist yet.
+
+ @param MakeContext Pointer to the context.
+
+ @param DirectoryName Pointer to the fully qualified directory name.  This
+        is copied, so it can refer to a temporary buffer.
+
+ @return Pointer to the directory listing, or NULL on allocation failure.
+ */
+PMAKE_DIRECTORY_LISTING
+MakeProbeGetDirectoryListing(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_DIRECTORY_LISTING Listing;
+    YORI_STRING Key;
+
+    if (MakeContext->DirectoryListings == NULL) {
+        MakeContext->DirectoryListings = YoriLibAllocateGrowableHashTable(64);
+        if (MakeContext->DirectoryListings == NULL) {
+            return NULL;
+        }
+    }
+
+    HashEntry = YoriLibGrowableHashLookupByKey(MakeContext->DirectoryListings, DirectoryName);
+    if (HashEntry != NULL) {
+        return HashEntry->Context;
+    }
+
+    Listing = YoriLibReferencedMalloc(sizeof(MAKE_DIRECTORY_LISTING) + (DirectoryName->LengthInChars + 1) * sizeof(TCHAR));
+    if (Listing == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Listing, sizeof(MAKE_DIRECTORY_LISTING));
+    YoriLibInitializeListHead(&Listing->FileList);
+
+    YoriLibInitEmptyString(&Key);
+    Key.MemoryToFree = Listing;
+    Key.StartOfString = (LPTSTR)(Listing + 1);
+    Key.LengthInChars = DirectoryName->LengthInChars;
+    Key.LengthAllocated = DirectoryName->LengthInChars + 1;
+    memcpy(Key.StartOfString, DirectoryName->StartOfString, DirectoryName->LengthInChars * sizeof(TCHAR));
+    Key.StartOfString[Key.LengthInChars] = '\0';
+
+    if (!YoriLibGrowableHashInsertByKey(MakeContext->DirectoryListings, &Key, Listing, &Listing->HashEntry)) {
+        YoriLibDereference(Listing);
+        return NULL;
+    }
+    YoriLibAppendList(&MakeContext->DirectoryListingList, &Listing->ListEntry);
+    return Listing;
+}
+
+/**
+ Free all files recorded within a directory listing, leaving the listing
+ itself allocated.
+
+ @param Listing Pointer to the directory listing.
+ */
+VOID
+MakeProbeFreeListedFiles(
+    __in PMAKE_DIRECTORY_LISTING Listing
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_LISTED_FILE File;
+
+    ListEntry = YoriLibGetNextListEntry(&Listing->FileList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, MAKE_LISTED_FILE, ListEntry);
+        YoriLibRemoveListItem(&File->ListEntry);
+        YoriLibGrowableHashRemoveByEntry(Listing->Files, &File->HashEntry);
+        YoriLibDereference(File);
+        ListEntry = YoriLibGetNextListEntry(&Listing->FileList, NULL);
+    }
+
+    if (Listing->Files != NULL) {
+        YoriLibFreeEmptyGrowableHashTable(Listing->Files);
+        Listing->Files = NULL;
+    }
+}
+
+/**
+ Enumerate a directory and record every file within it.  On failure, the
+ directory is marked so that files within it are opened individually.
+
+ @param Listing Pointer to the directory listing to populate.
+
+ @return TRUE to indicate the directory was enumerated, FALSE if it was not.
+ */
+BOOLEAN
+MakeProbeEnumerateDirectoryListing(
+    __in PMAKE_DIRECTORY_LISTING Listing
+    )
+{
+    YORI_STRING SearchString;
+    YORI_STRING FileName;
+    HANDLE hFind;
+    WIN32_FIND_DATA FindData;
+    PMAKE_LISTED_FILE File;
+    YORI_ALLOC_SIZE_T NameLength;
+
+    Listing->EnumerationFailed = TRUE;
+
+    Listing->Files = YoriLibAllocateGrowableHashTable(64);
+    if (Listing->Files == NULL) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&SearchString, Listing->HashEntry.Key.LengthInChars + sizeof("\\*"))) {
+        MakeProbeFreeListedFiles(Listing);
+        return FALSE;
+    }
+    SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y\\*"), &Listing->HashEntry.Key);
+
+    hFind = FindFirstFile(SearchString.StartOfString, &FindData);
+    YoriLibFreeStringContents(&SearchString);
+
+    if (hFind == INVALID_HANDLE_VALUE) {
+        if (GetLastError() != ERROR_FILE_NOT_FOUND &&
+            GetLastError() != ERROR_PATH_NOT_FOUND) {
+
+            MakeProbeFreeListedFiles(Listing);
+            return FALSE;
+        }
+    } else {
+        do {
+            NameLength = (YORI_ALLOC_SIZE_T)_tcslen(FindData.cFileName);
+            File = YoriLibReferencedMalloc(sizeof(MAKE_LISTED_FILE) + (NameLength + 1) * sizeof(TCHAR));
+            if (File == NULL) {
+                FindClose(hFind);
+                MakeProbeFreeListedFiles(Listing);
+                return FALSE;
+            }
+
+            YoriLibInitEmptyString(&FileName);
+            FileName.MemoryToFree = File;
+            FileName.StartOfString = (LPTSTR)(File + 1);
+            FileName.LengthInChars = NameLength;
+            FileName.LengthAllocated = NameLength + 1;
+            memcpy(FileName.StartOfString, FindData.cFileName, (NameLength + 1) * sizeof(TCHAR));
+
+            if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                File->ModifiedTime.QuadPart = 0;
+            } else {
+                File->ModifiedTime.LowPart = FindData.ftLastWriteTime.dwLowDateTime;
+                File->ModifiedTime.HighPart = FindData.ftLastWriteTime.dwHighDateTime;
+            }
+
+            if (!YoriLibGrowableHashInsertByKey(Listing->Files, &FileName, File, &File->HashEntry)) {
+                YoriLibDereference(File);
+                FindClose(hFind);
+                MakeProbeFreeListedFiles(Listing);
+                return FALSE;
+            }
+            YoriLibAppendList(&Listing->FileList, &File->ListEntry);
+
+        } while (FindNextFile(hFind, &FindData));
+
+        if (GetLastError() != ERROR_NO_MORE_FILES) {
+            FindClose(hFind);
+            MakeProbeFreeListedFiles(Listing);
+            return FALSE;
+        }
+        FindClose(hFind);
+    }
+
+    Listing->EnumerationFailed = FALSE;
+    Listing->Enumerated = TRUE;
+    return TRUE;
+}
+
+/**
+ Split a fully qualified path into its directory and file name components,
+ if the file can be found by enumerating its directory.
+
+ @param FullPath Pointer to the fully qualified path.
+
+ @param DirectoryName On successful completion, updated to point to the
+        directory component of the path.  This is not NULL terminated.
+
+ @param FileName On successful completion, updated to point to the file
+        name component of the path.
+
+ @return TRUE to indicate the path was split, FALSE if it should be opened
+         individually.
+ */
+__success(return)
+BOOLEAN
+MakeProbeSplitPath(
+    __in PYORI_STRING FullPath,
+    __out PYORI_STRING DirectoryName,
+    __out PYORI_STRING FileName
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriLibInitEmptyString(DirectoryName);
+    YoriLibInitEmptyString(FileName);
+
+    for (Index = FullPath->LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(FullPath->StartOfString[Index - 1])) {
+            break;
+        }
+    }
+
+    if (Index <= 1 || Index == FullPath->LengthInChars) {
+        return FALSE;
+    }
+
+    //
+    //  Enumerating by short name will not find files specified by short
+    //  name, and wildcards would match anything, so leave these to be
+    //  opened individually.
+    //
+
+    FileName->StartOfString = &FullPath->StartOfString[Index];
+    FileName->LengthInChars = FullPath->LengthInChars - Index;
+    if (YoriLibFindLeftMostCharacter(FileName, '~') != NULL ||
+        YoriLibFindLeftMostCharacter(FileName, '*') != NULL ||
+        YoriLibFindLeftMostCharacter(FileName, '?') != NULL) {
+
+        return FALSE;
+    }
+
+    DirectoryName->StartOfString = FullPath->StartOfString;
+    DirectoryName->LengthInChars = Index - 1;
+    return TRUE;
+}
+
+/**
+ Find the directory listing which can resolve a specified file, enumerating
+ the directory if enough files have been looked for within it.
+
+ @param MakeContext Pointer to the context.
+
+ @param FullPath Pointer to the fully qualified path to the file.
+
+ @param FileName On successful completion, updated to point to the file
+        name component of the path.
+
+ @return Pointer to a completely enumerated directory listing, or NULL if
+         the file should be opened individually.
+ */
+PMAKE_DIRECTORY_LISTING
+MakeProbeGetListingForFile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PYORI_STRING FileName
+    )
+{
+    YORI_STRING DirectoryName;
+    PMAKE_DIRECTORY_LISTING Listing;
+
+    if (!MakeProbeSplitPath(FullPath, &DirectoryName, FileName)) {
+        return NULL;
+    }
+
+    Listing = MakeProbeGetDirectoryListing(MakeContext, &DirectoryName);
+    if (Listing == NULL) {
+        return NULL;
+    }
+
+    if (!Listing->Enumerated && !Listing->EnumerationFailed) {
+        Listing->ProbeCount++;
+        if (Listing->ProbeCount >= MAKE_PROBE_MINIMUM_TARGETS_PER_DIRECTORY) {
+            MakeProbeEnumerateDirectoryListing(Listing);
+        }
+    }
+
+    if (!Listing->Enumerated) {
+        return NULL;
+    }
+
+    return Listing;
+}
+
+/**
+ Determine whether a file exists, typically a candidate source file for an
+ inference rule.  Once several files have been looked for within a single
+ directory, the directory is enumerated once and later lookups are resolved
+ from that listing, which is much faster than opening each candidate when
+ many inference rules apply to a directory with many files.
+
+ @param MakeContext Pointer to the context.
+
+ @param FullPath Pointer to the fully qualified path to the file.  This
+        must be NULL terminated.
+
+ @return TRUE if the file exists, FALSE if it does not.
+ */
+BOOLEAN
+MakeProbeFileExists(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath
+    )
+{
+    YORI_STRING FileName;
+    PMAKE_DIRECTORY_LISTING Listing;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    Listing = MakeProbeGetListingForFile(MakeContext, FullPath, &FileName);
+    if (Listing != NULL) {
+        if (YoriLibGrowableHashLookupByKey(Listing->Files, &FileName) != NULL) {
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    if (GetFileAttributes(FullPath->StartOfString) != (DWORD)-1) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ Find the last write time of a file which is not a target, such as a header
+ that a recipe reported reading.  This uses the same directory listings as
+ MakeProbeFileExists.
+
+ @param MakeContext Pointer to the context.
+
+ @param FullPath Pointer to the fully qualified path to the file.  This
+        must be NULL terminated.
+
+ @param ModifiedTime On successful completion, updated to contain the last
+        write time of the file, or zero if it is a directory.
+
+ @return TRUE if the file exists, FALSE if it does not.
+ */
+__success(return)
+BOOLEAN
+MakeProbeFileTime(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PLARGE_INTEGER ModifiedTime
+    )
+{
+    YORI_STRING FileName;
+    PMAKE_DIRECTORY_LISTING Listing;
+    PMAKE_LISTED_FILE File;
+    PYORI_HASH_ENTRY HashEntry;
+    WIN32_FIND_DATA FindData;
+    HANDLE hFind;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    Listing = MakeProbeGetListingForFile(MakeContext, FullPath, &FileName);
+    if (Listing != NULL) {
+        HashEntry = YoriLibGrowableHashLookupByKey(Listing->Files, &FileName);
+        if (HashEntry == NULL) {
+            return FALSE;
+        }
+        File = HashEntry->Context;
+        ModifiedTime->QuadPart = File->ModifiedTime.QuadPart;
+        return TRUE;
+    }
+
+    hFind = FindFirstFile(FullPath->StartOfString, &FindData);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+    FindClose(hFind);
+
+    ModifiedTime->QuadPart = 0;
+    if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        ModifiedTime->LowPart = FindData.ftLastWriteTime.dwLowDateTime;
+        ModifiedTime->HighPart = FindData.ftLastWriteTime.dwHighDateTime;
+    }
+    return TRUE;
+}
+
+/**
+ Update a target's timestamp from a directory listing if its directory has
+ already been enumerated.
+
+ @param MakeContext Pointer to the context.
+
+ @param Target Pointer to the target.
+
+ @param DirectoryName Pointer to the directory component of the target name.
+
+ @param FileName Pointer to the file name component of the target name.
+
+ @return TRUE if the target was updated from a listing, FALSE if it needs to
+         be probed by other means.
+ */
+BOOLEAN
+MakeProbeTargetFromDirectoryListing(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_TARGET Target,
+    __in PYORI_STRING DirectoryName,
+    __in PYORI_STRING FileName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_DIRECTORY_LISTING Listing;
+    PMAKE_LISTED_FILE File;
+
+    if (MakeContext->DirectoryListings == NULL) {
+        return FALSE;
+    }
+
+    HashEntry = YoriLibGrowableHashLookupByKey(MakeContext->DirectoryListings, DirectoryName);
+    if (HashEntry == NULL) {
+        return FALSE;
+    }
+
+    Listing = HashEntry->Context;
+    if (!Listing->Enumerated) {
+        return FALSE;
+    }
+
+    HashEntry = YoriLibGrowableHashLookupByKey(Listing->Files, FileName);
+    if (HashEntry != NULL) {
+        File = HashEntry->Context;
+        Target->FileExists = TRUE;
+        Target->ModifiedTime.QuadPart = File->ModifiedTime.QuadPart;
+    } else {
+        Target->FileExists = FALSE;
+        Target->ModifiedTime.QuadPart = 0;
+    }
+    Target->FileProbed = TRUE;
+    return TRUE;
+}
+
+/**
+ Discard any cached directory listings.  This is used when a command may
+ have modified the file system, and when the context is being torn down.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeProbeCleanupDirectoryListings(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_DIRECTORY_LISTING Listing;
+
+    if (MakeContext->DirectoryListings == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->DirectoryListingList, NULL);
+    while (ListEntry != NULL) {
+        Listing = CONTAINING_RECORD(ListEntry, MAKE_DIRECTORY_LISTING, ListEntry);
+        MakeProbeFreeListedFiles(Listing);
+        YoriLibRemoveListItem(&Listing->ListEntry);
+        YoriLibGrowableHashRemoveByEntry(MakeContext->DirectoryListings, &Listing->HashEntry);
+        YoriLibDereference(Listing);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->DirectoryListingList, NULL);
+    }
+
+    YoriLibFreeEmptyGrowableHashTable(MakeContext->DirectoryListings);
+    MakeContext->DirectoryListings = NULL;
+}
+
+/**
+ Find the timestamps of all known targets which have not been probed yet,
+ by enumerating each directory containing several targets rather than
+ opening each target when it is needed.  Directories are enumerated
+ concurrently.  Any target that cannot be resolved this way is left to be
+ opened individually when it is needed.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeProbeAllTargetFiles(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    MAKE_PROBE_CONTEXT ProbeContext;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY FileEntry;
+    PMAKE_TARGET Target;
+    PMAKE_PROBE_DIRECTORY Directory;
+    PMAKE_PROBE_FILE File;
+    YORI_STRING DirectoryName;
+    YORI_STRING FileName;
+    HANDLE Threads[MAKE_PROBE_MAXIMUM_THREADS];
+    DWORD ThreadCount;
+    DWORD MaxThreads;
+    DWORD ThreadId;
+    DWORD Index;
+
+    ZeroMemory(&ProbeContext, sizeof(ProbeContext));
+    YoriLibInitializeListHead(&ProbeContext.DirectoryList);
+    YoriLibInitializeListHead(&ProbeContext.PendingList);
+
+    ProbeContext.Directories = YoriLibAllocateHashTable(250);
+    if (ProbeContext.Directories == NULL) {
+        return;
+    }
+
+    //
+    //  Count the targets in each directory.  Targets in directories which
+    //  were already enumerated to resolve inference rules are updated from
+    //  that listing.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, ListEntry);
+        if (!Target->FileProbed &&
+            !Target->InferenceRulePseudoTarget &&
+            MakeProbeSplitTargetName(Target, &DirectoryName, &FileName) &&
+            !MakeProbeTargetFromDirectoryListing(MakeContext, Target, &DirectoryName, &FileName)) {
+
+            Directory = MakeProbeLookupDirectory(&ProbeContext, &DirectoryName);
+            if (Directory == NULL) {
+                goto Cleanup;
+            }
+            Directory->TargetCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, ListEntry);
+    }
+
+    //
+    //  For directories with enough targets, prepare to enumerate them.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_PROBE_DIRECTORY, ListEntry);
+        if (Directory->TargetCount >= MAKE_PROBE_MINIMUM_TARGETS_PER_DIRECTORY) {
+            Directory->Files = YoriLibAllocateHashTable((YORI_ALLOC_SIZE_T)Directory->TargetCount);
+            if (Directory->Files == NULL) {
+                goto Cleanup;
+            }
+
+            if (!YoriLibAllocateString(&Directory->SearchString, Directory->HashEntry.Key.LengthInChars + sizeof("\\*"))) {
+                goto Cleanup;
+            }
+
+            Directory->SearchString.LengthInChars = YoriLibSPrintf(Directory->SearchString.StartOfString, _T("%y\\*"), &Directory->HashEntry.Key);
+        }
+        ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, ListEntry);
+        if (!Target->FileProbed &&
+            !Target->InferenceRulePseudoTarget &&
+            MakeProbeSplitTargetName(Target, &DirectoryName, &FileName)) {
+
+            Directory = MakeProbeLookupDirectory(&ProbeContext, &DirectoryName);
+            ASSERT(Directory != NULL);
+            if (Directory != NULL && Directory->Files != NULL) {
+
+                //
+                //  Targets are indexed by fully qualified path, so two
+                //  targets should not refer to the same file.  If this
+                //  happens, the second is opened when it is needed.
+                //
+
+                if (YoriLibHashLookupByKey(Directory->Files, &FileName) == NULL) {
+                    if (!MakeProbeAddFileToDirectory(Directory, Target, &FileName)) {
+                        goto Cleanup;
+                    }
+                }
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_PROBE_DIRECTORY, ListEntry);
+        if (Directory->Files != NULL) {
+            YoriLibAppendList(&ProbeContext.PendingList, &Directory->PendingListEntry);
+            ProbeContext.PendingCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, ListEntry);
+    }
+
+    //
+    //  Start background threads to enumerate directories, and participate
+    //  in the enumeration from this thread.  If threads can't be created,
+    //  this thread will perform all of the work.
+    //
+
+    MaxThreads = MakeContext->NumberProcesses;
+    if (MaxThreads > MAKE_PROBE_MAXIMUM_THREADS) {
+        MaxThreads = MAKE_PROBE_MAXIMUM_THREADS;
+    }
+    if (MaxThreads > ProbeContext.PendingCount) {
+        MaxThreads = ProbeContext.PendingCount;
+    }
+
+    ThreadCount = 0;
+    if (MaxThreads > 1) {
+        ProbeContext.Mutex = CreateMutex(NULL, FALSE, NULL);
+        if (ProbeContext.Mutex != NULL) {
+            for (Index = 1; Index < MaxThreads; Index++) {
+                Threads[ThreadCount] = CreateThread(NULL, 0, MakeProbeWorker, &ProbeContext, 0, &ThreadId);
+                if (Threads[ThreadCount] == NULL) {
+                    break;
+                }
+                ThreadCount++;
+            }
+        }
+    }
+
+    MakeProbeWorker(&ProbeContext);
+
+    if (ThreadCount > 0) {
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+        for (Index = 0; Index < ThreadCount; Index++) {
+            CloseHandle(Threads[Index]);
+        }
+    }
+
+Cleanup:
+
+    if (ProbeContext.Mutex != NULL) {
+        CloseHandle(ProbeContext.Mutex);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_PROBE_DIRECTORY, ListEntry);
+        FileEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        while (FileEntry != NULL) {
+            File = CONTAINING_RECORD(FileEntry, MAKE_PROBE_FILE, ListEntry);
+            YoriLibRemoveListItem(&File->ListEntry);
+            YoriLibHashRemoveByEntry(&File->HashEntry);
+            YoriLibFree(File);
+            FileEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        }
+        if (Directory->Files != NULL) {
+            YoriLibFreeEmptyHashTable(Directory->Files);
+        }
+        YoriLibFreeStringContents(&Directory->SearchString);
+        YoriLibRemoveListItem(&Directory->ListEntry);
+        YoriLibHashRemoveByEntry(&Directory->HashEntry);
+        YoriLibFree(Directory);
+        ListEntry = YoriLibGetNextListEntry(&ProbeContext.DirectoryList, NULL);
+    }
+
+    YoriLibFreeEmptyHashTable(ProbeContext.Directories);
+}
+
+// vim:sw=4:ts=4:et:
@@ -59,7 +59,7 @@ MakeAllocateNewScope(
     ScopeContext->MakeContext = MakeContext;
     ScopeContext->ReferenceCount = 2; // One for the caller, one for the hash
 
-    ScopeContext->Variables = YoriLibAllocateHashTable(1000);
+    ScopeContext->Variables = YoriLibAllocateGrowableHashTable(250);
     if (ScopeContext->Variables == NULL) {
         YoriLibDereference(ScopeContext);
         return NULL;
@@ -97,7 +97,7 @@ MakeAllocateNewScope(
     ScopeContext->DefaultTarget = MakeLookupOrCreateTarget(ScopeContext, &Default, FALSE);
     if (ScopeContext->DefaultTarget == NULL) {
         if (ScopeContext->Variables != NULL) {
-            YoriLibFreeEmptyHashTable(ScopeContext->Variables);
+            YoriLibFreeEmptyGrowableHashTable(ScopeContext->Variables);
         }
         YoriLibRemoveListItem(&ScopeContext->ListEntry);
         YoriLibHashRemoveByEntry(&ScopeContext->HashEntry);
@@ -142,7 +142,7 @@ MakeDereferenceScope(
         YoriLibFreeStringContents(&ScopeContext->CurrentIncludeDirectory);
         MakeDeleteAllVariables(ScopeContext);
         if (ScopeContext->Variables != NULL) {
-            YoriLibFreeEmptyHashTable(ScopeContext->Variables);
+            YoriLibFreeEmptyGrowableHashTable(ScopeContext->Variables);
         }
 
         YoriLibDereference(ScopeContext);
@@ -0,0 +1,402 @@
+/**
+ * @file make/specprobe.c
+ *
+ * Yori make speculative preprocessor command execution
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+/**
+ A preprocessor command which may have been launched before the preprocessor
+ reached the line that evaluates it, or which has completed and whose result
+ can be reused by any scope that evaluates the same command.
+ */
+typedef struct _MAKE_SPECULATIVE_PROBE {
+
+    /**
+     The hash entry.  Key is the fully expanded command.  Since preprocessor
+     commands are executed with the environment and current directory of
+     the make process, the same command has the same result regardless of
+     which scope evaluates it.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The linkage of all speculative probes, used to facilitate bulk delete.
+     Paired with MAKE_CONTEXT::SpeculativeProbeList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The parsed command.  This is only meaningful if Outstanding is TRUE.
+     */
+    YORI_LIBSH_CMD_CONTEXT CmdContext;
+
+    /**
+     The plan containing the launched processes.  This is only meaningful
+     if Outstanding is TRUE.
+     */
+    YORI_LIBSH_EXEC_PLAN ExecPlan;
+
+    /**
+     TRUE if the processes have been launched and have not been waited for.
+     FALSE if ExitCode contains the result of the command.
+     */
+    BOOLEAN Outstanding;
+
+    /**
+     The exit code of the command.  This is only meaningful if Outstanding
+     is FALSE.
+     */
+    DWORD ExitCode;
+
+} MAKE_SPECULATIVE_PROBE, *PMAKE_SPECULATIVE_PROBE;
+
+/**
+ Determine whether an exec plan can be launched before the preprocessor
+ would have executed it.  This requires that every program is an external
+ program, since builtins execute synchronously within this process, that
+ every program is connected to the next by a pipe so that all of them are
+ executed unconditionally, and that nothing is redirected to or from a
+ file, since the file may not be in its final state yet.  On success, the
+ first argument of each program is updated to refer to the fully qualified
+ executable.
+
+ @param ExecPlan Pointer to the exec plan to check.
+
+ @return TRUE if the plan can be launched speculatively, FALSE if it should
+         only be executed when the preprocessor evaluates it.
+ */
+BOOLEAN
+MakeCanSpeculateExecPlan(
+    __in PYORI_LIBSH_EXEC_PLAN ExecPlan
+    )
+{
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    YORI_STRING FoundInPath;
+
+    ExecContext = ExecPlan->FirstCmd;
+    while (ExecContext != NULL) {
+
+        if (ExecContext->NextProgram != NULL &&
+            ExecContext->NextProgramType != NextProgramExecConcurrently) {
+            return FALSE;
+        }
+
+        if (ExecContext->StdInType == StdInTypeFile ||
+            ExecContext->StdOutType == StdOutTypeOverwrite ||
+            ExecContext->StdOutType == StdOutTypeAppend ||
+            ExecContext->StdOutType == StdOutTypeBuffer ||
+            ExecContext->StdErrType == StdErrTypeOverwrite ||
+            ExecContext->StdErrType == StdErrTypeAppend ||
+            ExecContext->StdErrType == StdErrTypeBuffer) {
+
+            return FALSE;
+        }
+
+        if (YoriLibShLookupBuiltinByName(&ExecContext->CmdToExec.ArgV[0]) != NULL) {
+            return FALSE;
+        }
+
+        YoriLibInitEmptyString(&FoundInPath);
+        if (!YoriLibLocateExecutableInPath(&ExecContext->CmdToExec.ArgV[0], NULL, NULL, &FoundInPath)) {
+            return FALSE;
+        }
+
+        if (FoundInPath.LengthInChars == 0) {
+            YoriLibFreeStringContents(&FoundInPath);
+            return FALSE;
+        }
+
+        YoriLibFreeStringContents(&ExecContext->CmdToExec.ArgV[0]);
+        memcpy(&ExecContext->CmdToExec.ArgV[0], &FoundInPath, sizeof(YORI_STRING));
+
+        ExecContext = ExecContext->NextProgram;
+    }
+
+    return TRUE;
+}
+
+/**
+ Wait for all processes launched for a speculative probe to complete,
+ capture the exit code of the final process, and release the plan.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Probe Pointer to the probe to wait for.
+ */
+VOID
+MakeWaitForSpeculativeProbe(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_SPECULATIVE_PROBE Probe
+    )
+{
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    DWORD ExitCode;
+
+    ASSERT(Probe->Outstanding);
+
+    ExitCode = 255;
+    ExecContext = Probe->ExecPlan.FirstCmd;
+    while (ExecContext != NULL) {
+        ExitCode = 255;
+        if (ExecContext->hProcess != NULL) {
+            WaitForSingleObject(ExecContext->hProcess, INFINITE);
+            GetExitCodeProcess(ExecContext->hProcess, &ExitCode);
+        }
+        ExecContext = ExecContext->NextProgram;
+    }
+
+    YoriLibShFreeExecPlan(&Probe->ExecPlan);
+    YoriLibShFreeCmdContext(&Probe->CmdContext);
+
+    Probe->ExitCode = ExitCode;
+    Probe->Outstanding = FALSE;
+
+    ASSERT(MakeContext->OutstandingSpeculativeProbes > 0);
+    MakeContext->OutstandingSpeculativeProbes--;
+}
+
+/**
+ Launch a preprocessor command before the preprocessor reaches the line that
+ evaluates it, so that it can execute concurrently with parsing and with
+ other commands.  Commands that cannot be safely launched early are ignored
+ and will be executed when they are evaluated.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Cmd Pointer to the fully expanded command.
+
+ @return TRUE to indicate that more commands may be launched, FALSE if the
+         limit of concurrently executing commands has been reached.
+ */
+BOOLEAN
+MakeSpeculatePreprocessorCommand(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd
+    )
+{
+    PMAKE_SPECULATIVE_PROBE Probe;
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    BOOL FailedInRedirection;
+    DWORD Err;
+
+    if (MakeContext->SpeculativeProbes == NULL) {
+        return FALSE;
+    }
+
+    if (YoriLibHashLookupByKey(MakeContext->SpeculativeProbes, Cmd) != NULL) {
+        return TRUE;
+    }
+
+    if (MakeContext->OutstandingSpeculativeProbes >= MakeContext->NumberProcesses) {
+        return FALSE;
+    }
+
+    Probe = YoriLibMalloc(sizeof(MAKE_SPECULATIVE_PROBE));
+    if (Probe == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Probe, sizeof(MAKE_SPECULATIVE_PROBE));
+
+    if (!YoriLibShParseCmdlineToCmdContext(Cmd, 0, &Probe->CmdContext)) {
+        YoriLibFree(Probe);
+        return TRUE;
+    }
+
+    if (!YoriLibShParseCmdContextToExecPlan(&Probe->CmdContext, &Probe->ExecPlan, NULL, NULL, NULL, NULL)) {
+        YoriLibShFreeCmdContext(&Probe->CmdContext);
+        YoriLibFree(Probe);
+        return TRUE;
+    }
+
+    if (!MakeCanSpeculateExecPlan(&Probe->ExecPlan)) {
+        YoriLibShFreeExecPlan(&Probe->ExecPlan);
+        YoriLibShFreeCmdContext(&Probe->CmdContext);
+        YoriLibFree(Probe);
+        return TRUE;
+    }
+
+    //
+    //  Launch each program without waiting for it.  If any program in a
+    //  pipeline cannot be launched, terminate the ones that were, and
+    //  leave the command to be executed normally when it is evaluated.
+    //
+
+    ExecContext = Probe->ExecPlan.FirstCmd;
+    while (ExecContext != NULL) {
+        FailedInRedirection = FALSE;
+        Err = YoriLibShCreateProcess(ExecContext, NULL, &FailedInRedirection);
+        if (Err != NO_ERROR) {
+            YoriLibShCleanupFailedProcessLaunch(ExecContext);
+            MakeShCancelExecPlan(&Probe->ExecPlan);
+            YoriLibShFreeExecPlan(&Probe->ExecPlan);
+            YoriLibShFreeCmdContext(&Probe->CmdContext);
+            YoriLibFree(Probe);
+            return TRUE;
+        }
+
+        YoriLibShCommenceProcessBuffersIfNeeded(ExecContext);
+        ExecContext = ExecContext->NextProgram;
+    }
+
+    Probe->Outstanding = TRUE;
+    MakeContext->OutstandingSpeculativeProbes++;
+
+    YoriLibHashInsertByKey(MakeContext->SpeculativeProbes, Cmd, Probe, &Probe->HashEntry);
+    YoriLibAppendList(&MakeContext->SpeculativeProbeList, &Probe->ListEntry);
+
+    return TRUE;
+}
+
+/**
+ Find the result of a preprocessor command that was either launched
+ speculatively or previously executed by any scope.  If the command was
+ launched speculatively and is still executing, this waits for it to
+ complete.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Cmd Pointer to the fully expanded command.
+
+ @param ExitCode On successful completion, updated to contain the exit code
+        of the command.
+
+ @return TRUE if the result of the command was found, FALSE if the command
+         needs to be executed.
+ */
+__success(return)
+BOOLEAN
+MakeGetSpeculativeProbeResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd,
+    __out PDWORD ExitCode
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_SPECULATIVE_PROBE Probe;
+
+    if (MakeContext->SpeculativeProbes == NULL) {
+        return FALSE;
+    }
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->SpeculativeProbes, Cmd);
+    if (HashEntry == NULL) {
+        return FALSE;
+    }
+
+    Probe = CONTAINING_RECORD(HashEntry, MAKE_SPECULATIVE_PROBE, HashEntry);
+    if (Probe->Outstanding) {
+        MakeWaitForSpeculativeProbe(MakeContext, Probe);
+    }
+
+    *ExitCode = Probe->ExitCode;
+    return TRUE;
+}
+
+/**
+ Record the result of a preprocessor command that was executed when it was
+ evaluated, so that any other scope evaluating the same command can use the
+ result without executing it again.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Cmd Pointer to the fully expanded command.
+
+ @param ExitCode The exit code of the command.
+ */
+VOID
+MakeRecordSpeculativeProbeResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING Cmd,
+    __in DWORD ExitCode
+    )
+{
+    PMAKE_SPECULATIVE_PROBE Probe;
+
+    if (MakeContext->SpeculativeProbes == NULL) {
+        return;
+    }
+
+    if (YoriLibHashLookupByKey(MakeContext->SpeculativeProbes, Cmd) != NULL) {
+        return;
+    }
+
+    Probe = YoriLibMalloc(sizeof(MAKE_SPECULATIVE_PROBE));
+    if (Probe == NULL) {
+        return;
+    }
+
+    ZeroMemory(Probe, sizeof(MAKE_SPECULATIVE_PROBE));
+    Probe->ExitCode = ExitCode;
+
+    YoriLibHashInsertByKey(MakeContext->SpeculativeProbes, Cmd, Probe, &Probe->HashEntry);
+    YoriLibAppendList(&MakeContext->SpeculativeProbeList, &Probe->ListEntry);
+}
+
+/**
+ Deallocate all speculative probes.  Any commands that were launched but
+ never evaluated are allowed to complete, unless the user has cancelled
+ the operation, in which case they are terminated.
+
+ @param MakeContext Pointer to the make context.
+ */
+VOID
+MakeDeleteAllSpeculativeProbes(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_SPECULATIVE_PROBE Probe;
+
+    if (MakeContext->SpeculativeProbes == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->SpeculativeProbeList, NULL);
+    while (ListEntry != NULL) {
+        Probe = CONTAINING_RECORD(ListEntry, MAKE_SPECULATIVE_PROBE, ListEntry);
+
+        if (Probe->Outstanding) {
+            if (YoriLibIsOperationCancelled()) {
+                MakeShCancelExecPlan(&Probe->ExecPlan);
+            }
+            MakeWaitForSpeculativeProbe(MakeContext, Probe);
+        }
+
+        YoriLibRemoveListItem(&Probe->ListEntry);
+        YoriLibHashRemoveByEntry(&Probe->HashEntry);
+        YoriLibFree(Probe);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->SpeculativeProbeList, NULL);
+    }
+
+    ASSERT(MakeContext->OutstandingSpeculativeProbes == 0);
+    YoriLibFreeEmptyHashTable(MakeContext->SpeculativeProbes);
+    MakeContext->SpeculativeProbes = NULL;
+}
+
+// vim:sw=4:ts=4:et:
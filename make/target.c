@@ -50,6 +50,10 @@ MakeDereferenceTarget(
     if (InterlockedDecrement((INTERLOCKED_VOLATILE LONG *)&Target->ReferenceCount) == 0) {
 
         YoriLibFreeStringContents(&Target->Recipe);
+        if (Target->CompiledRecipe != NULL) {
+            MakeFreeCompiledRecipe(Target->CompiledRecipe);
+            Target->CompiledRecipe = NULL;
+        }
 
         if (Target->InferenceRule != NULL) {
             MakeDereferenceInferenceRule(Target->InferenceRule);
@@ -75,7 +79,7 @@ MakeDereferenceTarget(
             Target->InferenceRuleParentTarget = NULL;
         }
 
-        MakeSlabFree(Target);
+        YoriLibSlabFree(Target);
     }
 }
 
@@ -83,10 +87,13 @@ MakeDereferenceTarget(
  Indicate that a target can no longer be resolved, dereferencing it since it
  is no longer active.  It may still be referenced by inference rules.
 
+ @param MakeContext Pointer to the make context.
+
  @param Target Pointer to the target to deactivate.
  */
 VOID
 MakeDeactivateTarget(
+    __in PMAKE_CONTEXT MakeContext,
     __in PMAKE_TARGET Target
     )
 {
@@ -94,7 +101,7 @@ MakeDeactivateTarget(
     ASSERT(YoriLibIsListEmpty(&Target->ChildDependents));
 
     YoriLibRemoveListItem(&Target->ListEntry);
-    YoriLibHashRemoveByEntry(&Target->HashEntry);
+    YoriLibGrowableHashRemoveByEntry(MakeContext->Targets, &Target->HashEntry);
     MakeDereferenceTarget(Target);
 }
 
@@ -111,7 +118,7 @@ MakeDeleteDependency(
     YoriLibRemoveListItem(&Dependency->ParentDependents);
     YoriLibRemoveListItem(&Dependency->ChildDependents);
 
-    MakeSlabFree(Dependency);
+    YoriLibSlabFree(Dependency);
 }
 
 /**
@@ -153,7 +160,7 @@ MakeDeleteAllTargets(
         }
 
         ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsList, &Target->ListEntry);
-        MakeDeactivateTarget(Target);
+        MakeDeactivateTarget(MakeContext, Target);
     }
 
 }
@@ -194,6 +201,7 @@ MakeProbeTargetFile(
     //
 
     ASSERT(YoriLibIsStringNullTerminated(&Target->HashEntry.Key));
+    YoriLibEtwWriteEvent("Probe", YORI_ETW_OPCODE_START, &Target->HashEntry.Key, 0);
     FileHandle = CreateFile(Target->HashEntry.Key.StartOfString,
                             FILE_READ_ATTRIBUTES | FILE_READ_DATA,
                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
@@ -216,6 +224,7 @@ MakeProbeTargetFile(
         }
         CloseHandle(FileHandle);
     }
+    YoriLibEtwWriteEvent("Probe", YORI_ETW_OPCODE_STOP, &Target->HashEntry.Key, Target->FileExists);
 
     Target->FileProbed = TRUE;
 }
@@ -289,7 +298,7 @@ MakeLookupTarget(
 
     MakeContext = ScopeContext->MakeContext;
 
-    HashEntry = YoriLibHashLookupByKey(MakeContext->Targets, &FullPath);
+    HashEntry = YoriLibGrowableHashLookupByKey(MakeContext->Targets, &FullPath);
     YoriLibFreeStringContents(&FullPath);
     if (HashEntry != NULL) {
         Target = HashEntry->Context;
@@ -322,6 +331,7 @@ MakeLookupOrCreateTarget(
     )
 {
     YORI_STRING FullPath;
+    YORI_STRING PooledPath;
     YORI_STRING TargetNoQuotes;
     PMAKE_TARGET Target;
     PYORI_HASH_ENTRY HashEntry;
@@ -333,13 +343,13 @@ MakeLookupOrCreateTarget(
 
     MakeContext = ScopeContext->MakeContext;
 
-    HashEntry = YoriLibHashLookupByKey(MakeContext->Targets, &FullPath);
+    HashEntry = YoriLibGrowableHashLookupByKey(MakeContext->Targets, &FullPath);
     if (HashEntry != NULL) {
         Target = HashEntry->Context;
         YoriLibFreeStringContents(&FullPath);
     } else {
 
-        Target = MakeSlabAlloc(&ScopeContext->MakeContext->TargetAllocator, sizeof(MAKE_TARGET));
+        Target = YoriLibSlabAlloc(&ScopeContext->MakeContext->TargetAllocator, sizeof(MAKE_TARGET));
         if (Target == NULL) {
             YoriLibFreeStringContents(&FullPath);
             return NULL;
@@ -363,15 +373,36 @@ MakeLookupOrCreateTarget(
         Target->DependenciesEvaluated = FALSE;
         Target->EvaluatingDependencies = FALSE;
         Target->InferenceRulePseudoTarget = FALSE;
+        Target->RemoteEligible = FALSE;
+        Target->CriticalPathCalculated = FALSE;
+        Target->ContentHashCalculated = FALSE;
         Target->ModifiedTime.QuadPart = 0;
         Target->InferenceRule = NULL;
         Target->InferenceRuleParentTarget = NULL;
         YoriLibInitEmptyString(&Target->Recipe);
+        Target->CompiledRecipe = NULL;
         YoriLibInitializeListHead(&Target->ExecCmds);
-        YoriLibHashInsertByKey(MakeContext->Targets, &FullPath, Target, &Target->HashEntry);
-        YoriLibAppendList(&MakeContext->TargetsList, &Target->ListEntry);
 
+        //
+        //  Store the name in the name pool, which holds an exactly sized
+        //  copy, rather than retaining the full path buffer.
+        //
+
+        if (!YoriLibInternString(MakeContext->Names, &FullPath, &PooledPath)) {
+            YoriLibSlabFree(Target);
+            YoriLibFreeStringContents(&FullPath);
+            return NULL;
+        }
         YoriLibFreeStringContents(&FullPath);
+
+        if (!YoriLibGrowableHashInsertByKey(MakeContext->Targets, &PooledPath, Target, &Target->HashEntry)) {
+            YoriLibSlabFree(Target);
+            YoriLibFreeStringContents(&PooledPath);
+            return NULL;
+        }
+        YoriLibAppendList(&MakeContext->TargetsList, &Target->ListEntry);
+
+        YoriLibFreeStringContents(&PooledPath);
     }
 
 #if MAKE_DEBUG_TARGETS
@@ -388,7 +419,7 @@ MakeLookupOrCreateTarget(
         YoriLibCompareStringWithLiteralInsensitive(&TargetNoQuotes, MAKE_DEFAULT_SCOPE_TARGET_NAME) != 0) {
 
         if (!MakeCreateParentChildDependency(ScopeContext->MakeContext, Target, ScopeContext->DefaultTarget)) {
-            MakeDeactivateTarget(Target);
+            MakeDeactivateTarget(MakeContext, Target);
             return NULL;
         }
 
@@ -987,7 +1018,7 @@ MakeFindInferenceRuleForTarget(
 #if MAKE_DEBUG_TARGETS
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("GetFileAttributes for: %s\n"), FileToProbe->StartOfString);
 #endif
-            if (GetFileAttributes(FileToProbe->StartOfString) != (DWORD)-1) {
+            if (MakeProbeFileExists(ScopeContext->MakeContext, FileToProbe)) {
                 FileToProbe->LengthInChars = FileToProbe->LengthInChars + InferenceRule->SourceExtension.LengthInChars;
                 if (!MakeAssignInferenceRuleToTarget(ScopeContext, Target, InferenceRule, FileToProbe)) {
                     return FALSE;
@@ -1041,7 +1072,7 @@ MakeFindInferenceRuleForTarget(
 #if MAKE_DEBUG_TARGETS
                     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Nested GetFileAttributes for: %s\n"), NestedFileToProbe->StartOfString);
 #endif
-                    if (GetFileAttributes(NestedFileToProbe->StartOfString) != (DWORD)-1) {
+                    if (MakeProbeFileExists(ScopeContext->MakeContext, NestedFileToProbe)) {
 
                         //
                         //  First, generate the outer rule, assigning the
@@ -1194,7 +1225,7 @@ MakeCreateParentChildDependency(
 {
     PMAKE_TARGET_DEPENDENCY Dependency;
 
-    Dependency = MakeSlabAlloc(&MakeContext->DependencyAllocator, sizeof(MAKE_TARGET_DEPENDENCY));
+    Dependency = YoriLibSlabAlloc(&MakeContext->DependencyAllocator, sizeof(MAKE_TARGET_DEPENDENCY));
     if (Dependency == NULL) {
         return FALSE;
     }
@@ -1541,11 +1572,12 @@ MakeGenerateExecScriptForTarget(
     __in PMAKE_TARGET Target
     )
 {
-    YORI_STRING Line;
-    YORI_ALLOC_SIZE_T StartLineIndex;
+    PMAKE_TARGET SourceTarget;
+    PMAKE_COMPILED_RECIPE CompiledRecipe;
+    PMAKE_RECIPE_LINE RecipeLine;
     YORI_ALLOC_SIZE_T Index;
-    PYORI_STRING SourceString;
     PMAKE_CMD_TO_EXEC CmdToExec;
+    BOOLEAN AllRemote;
 
     UNREFERENCED_PARAMETER(MakeContext);
 
@@ -1557,71 +1589,86 @@ MakeGenerateExecScriptForTarget(
     //  is still successful.
     //
 
-    SourceString = NULL;
+    SourceTarget = NULL;
     if (Target->Recipe.LengthInChars > 0) {
-        SourceString = &Target->Recipe;
+        SourceTarget = Target;
     } else if (Target->InferenceRule != NULL) {
         ASSERT(Target->InferenceRuleParentTarget != NULL);
         ASSERT(!YoriLibIsListEmpty(&Target->ParentDependents));
-        SourceString = &Target->InferenceRule->Target->Recipe;
+        SourceTarget = Target->InferenceRule->Target;
     } else if (Target->ExplicitRecipeFound) {
-        SourceString = &Target->Recipe;
+        SourceTarget = Target;
     }
 
     //
     //  There's nothing to do, and it's been done successfully.
     //
 
-    if (SourceString == NULL) {
+    if (SourceTarget == NULL) {
         return TRUE;
     }
 
     ASSERT(Target->ScopeContext != NULL);
     __analysis_assume(Target->ScopeContext != NULL);
 
-    YoriLibInitEmptyString(&Line);
-    StartLineIndex = 0;
-    for (Index = 0; Index < SourceString->LengthInChars; Index++) {
-        if (SourceString->StartOfString[Index] == '\n') {
-            Line.StartOfString = &SourceString->StartOfString[StartLineIndex];
-            Line.LengthInChars = Index - StartLineIndex;
+    //
+    //  Compile the recipe on first use.  An inference rule's recipe is
+    //  compiled once and reused for every target it applies to.  If the
+    //  recipe has been modified since it was compiled, compile it again.
+    //
 
-            StartLineIndex = Index + 1;
+    CompiledRecipe = SourceTarget->CompiledRecipe;
+    if (CompiledRecipe != NULL &&
+        (CompiledRecipe->Source.StartOfString != SourceTarget->Recipe.StartOfString ||
+         CompiledRecipe->Source.LengthInChars != SourceTarget->Recipe.LengthInChars)) {
 
-            CmdToExec = YoriLibMalloc(sizeof(MAKE_CMD_TO_EXEC));
-            if (CmdToExec == NULL) {
-                return FALSE;
-            }
+        MakeFreeCompiledRecipe(CompiledRecipe);
+        SourceTarget->CompiledRecipe = NULL;
+        CompiledRecipe = NULL;
+    }
 
-            CmdToExec->DisplayCmd = TRUE;
-            CmdToExec->IgnoreErrors = FALSE;
-
-            while (TRUE) {
-                if (Line.LengthInChars > 0) {
-                    if (Line.StartOfString[0] == '@') {
-                        CmdToExec->DisplayCmd = FALSE;
-                        Line.StartOfString++;
-                        Line.LengthInChars--;
-                    } else if (Line.StartOfString[0] == '-') {
-                        CmdToExec->IgnoreErrors = TRUE;
-                        Line.StartOfString++;
-                        Line.LengthInChars--;
-                    } else {
-                        break;
-                    }
-                } else {
-                    break;
-                }
-            }
+    if (CompiledRecipe == NULL) {
+        CompiledRecipe = MakeCompileRecipe(&SourceTarget->Recipe);
+        if (CompiledRecipe == NULL) {
+            return FALSE;
+        }
+        SourceTarget->CompiledRecipe = CompiledRecipe;
+    }
 
+    AllRemote = TRUE;
+    for (Index = 0; Index < CompiledRecipe->LineCount; Index++) {
+        RecipeLine = &CompiledRecipe->Lines[Index];
 
-            YoriLibInitEmptyString(&CmdToExec->Cmd);
-            if (!MakeExpandVariables(Target->ScopeContext, Target, &CmdToExec->Cmd, &Line, NULL)) {
-                return FALSE;
-            }
+        CmdToExec = YoriLibMalloc(sizeof(MAKE_CMD_TO_EXEC));
+        if (CmdToExec == NULL) {
+            return FALSE;
+        }
 
-            YoriLibAppendList(&Target->ExecCmds, &CmdToExec->ListEntry);
+        CmdToExec->DisplayCmd = RecipeLine->DisplayCmd;
+        CmdToExec->IgnoreErrors = RecipeLine->IgnoreErrors;
+        CmdToExec->Remote = RecipeLine->Remote;
+
+        if (!CmdToExec->Remote) {
+            AllRemote = FALSE;
+        }
+
+        YoriLibInitEmptyString(&CmdToExec->Cmd);
+        if (!MakeExpandCompiledRecipeLine(Target->ScopeContext, Target, CompiledRecipe, RecipeLine, &CmdToExec->Cmd)) {
+            YoriLibFreeStringContents(&CmdToExec->Cmd);
+            YoriLibFree(CmdToExec);
+            return FALSE;
         }
+
+        YoriLibAppendList(&Target->ExecCmds, &CmdToExec->ListEntry);
+    }
+
+    //
+    //  A recipe can only be sent to a remote slot if every command in it is
+    //  hermetic, since the slot executes all commands via the launcher.
+    //
+
+    if (AllRemote && !YoriLibIsListEmpty(&Target->ExecCmds)) {
+        Target->RemoteEligible = TRUE;
     }
 
     return TRUE;
@@ -1664,13 +1711,11 @@ MakeMarkTargetForRebuild(
     }
 
     //
-    //  MSFIX Ideally these lists would be sorted or approximately sorted
-    //  where the targets that have the most dependencies are done before
-    //  those with fewer dependencies.  Doing this intelligently really
-    //  requires knowledge of all ancestors.  Appending to the end means
-    //  that depth first traversal should ensure that all dependencies are
-    //  satisfied, and if many targets depend on one target that target
-    //  should be uncovered relatively early.
+    //  Appending to the end means that depth first traversal should ensure
+    //  that all dependencies are satisfied.  Once the full graph is known,
+    //  MakeCalculateCriticalPaths will reorder the ready list so that
+    //  targets with the longest chain of work depending on them are
+    //  executed first.
     //
 
     Target->RebuildRequired = TRUE;
@@ -1809,6 +1854,15 @@ MakeDetermineDependenciesForTarget(
         ListEntry = YoriLibGetNextListEntry(&Target->ParentDependents, ListEntry);
     }
 
+    //
+    //  Check any headers the target's recipe reported reading in a
+    //  previous build.
+    //
+
+    if (!MakeCheckHeaderDependencies(MakeContext, Target, &SetRebuildRequired)) {
+        goto Fail;
+    }
+
     Target->EvaluatingDependencies = FALSE;
     Target->DependenciesEvaluated = TRUE;
 
@@ -0,0 +1,397 @@
+/**
+ * @file make/trace.c
+ *
+ * Yori make trace of time spent in each phase and command
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include <yorish.h>
+#include "make.h"
+
+//
+//  The trace is written in the Chrome trace event format, which can be
+//  loaded into chrome://tracing or Perfetto.  Phases of processing are
+//  recorded on thread zero, and each recipe command is recorded on a thread
+//  corresponding to the job that executed it, so that the rows in the
+//  viewer show how busy each job slot was and which targets serialized the
+//  build.
+//
+
+/**
+ Write any buffered trace events to the trace file.
+
+ @param Trace Pointer to the trace context.
+ */
+VOID
+MakeTraceFlush(
+    __in PMAKE_TRACE_CONTEXT Trace
+    )
+{
+    if (Trace->Buffer.LengthInChars > 0) {
+        YoriLibOutputToDevice(Trace->hFile, 0, _T("%y"), &Trace->Buffer);
+        Trace->Buffer.LengthInChars = 0;
+    }
+}
+
+/**
+ Append formatted text to the trace buffer, writing buffered text to the
+ file if the buffer has become large.
+
+ @param Trace Pointer to the trace context.
+
+ @param szFmt The format string, followed by appropriate arguments.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeTraceAppend(
+    __in PMAKE_TRACE_CONTEXT Trace,
+    __in LPCTSTR szFmt,
+    ...
+    )
+{
+    va_list marker;
+    YORI_SIGNED_ALLOC_SIZE_T CharsNeeded;
+    YORI_SIGNED_ALLOC_SIZE_T CharsWritten;
+    YORI_ALLOC_SIZE_T CharsToAllocate;
+
+    va_start(marker, szFmt);
+    CharsNeeded = YoriLibVSPrintfSize(szFmt, marker);
+    va_end(marker);
+
+    if (CharsNeeded < 0) {
+        return FALSE;
+    }
+
+    if (Trace->Buffer.LengthInChars + (YORI_ALLOC_SIZE_T)CharsNeeded > MAKE_TRACE_FLUSH_THRESHOLD) {
+        MakeTraceFlush(Trace);
+    }
+
+    if (Trace->Buffer.LengthInChars + (YORI_ALLOC_SIZE_T)CharsNeeded > Trace->Buffer.LengthAllocated) {
+        CharsToAllocate = MAKE_TRACE_FLUSH_THRESHOLD;
+        if ((YORI_ALLOC_SIZE_T)CharsNeeded > CharsToAllocate) {
+            CharsToAllocate = (YORI_ALLOC_SIZE_T)CharsNeeded;
+        }
+        if (!YoriLibReallocateString(&Trace->Buffer, CharsToAllocate)) {
+            return FALSE;
+        }
+    }
+
+    va_start(marker, szFmt);
+    CharsWritten = YoriLibVSPrintf(&Trace->Buffer.StartOfString[Trace->Buffer.LengthInChars],
+                                   Trace->Buffer.LengthAllocated - Trace->Buffer.LengthInChars,
+                                   szFmt,
+                                   marker);
+    va_end(marker);
+
+    if (CharsWritten < 0) {
+        return FALSE;
+    }
+
+    Trace->Buffer.LengthInChars = Trace->Buffer.LengthInChars + (YORI_ALLOC_SIZE_T)CharsWritten;
+    return TRUE;
+}
+
+/**
+ Escape a string so that it can be included within a JSON string.
+
+ @param Dest Pointer to a string to populate with the escaped form.  This
+        may be reallocated within this routine.
+
+ @param Src Pointer to the string to escape.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeTraceEscapeString(
+    __inout PYORI_STRING Dest,
+    __in PCYORI_STRING Src
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    TCHAR Char;
+
+    //
+    //  The longest escape is \u00XX, which is six characters.
+    //
+
+    CharsNeeded = Src->LengthInChars * 6 + 1;
+    if (CharsNeeded > Dest->LengthAllocated) {
+        YoriLibFreeStringContents(Dest);
+        if (!YoriLibAllocateString(Dest, CharsNeeded)) {
+            return FALSE;
+        }
+    }
+
+    Dest->LengthInChars = 0;
+    for (Index = 0; Index < Src->LengthInChars; Index++) {
+        Char = Src->StartOfString[Index];
+        if (Char == '"' || Char == '\\') {
+            Dest->StartOfString[Dest->LengthInChars] = '\\';
+            Dest->StartOfString[Dest->LengthInChars + 1] = Char;
+            Dest->LengthInChars = Dest->LengthInChars + 2;
+        } else if (Char < 0x20) {
+            Dest->LengthInChars = Dest->LengthInChars +
+                (YORI_ALLOC_SIZE_T)YoriLibSPrintf(&Dest->StartOfString[Dest->LengthInChars], _T("\\u%04x"), Char);
+        } else {
+            Dest->StartOfString[Dest->LengthInChars] = Char;
+            Dest->LengthInChars++;
+        }
+    }
+
+    Dest->StartOfString[Dest->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Convert a performance counter value into microseconds since tracing
+ started, which is the unit used by the trace event format.
+
+ @param Trace Pointer to the trace context.
+
+ @param Time Pointer to the performance counter value.
+
+ @return The number of microseconds since tracing started.
+ */
+LONGLONG
+MakeTraceTimeToMicroseconds(
+    __in PMAKE_TRACE_CONTEXT Trace,
+    __in PLARGE_INTEGER Time
+    )
+{
+    LONGLONG Elapsed;
+
+    Elapsed = Time->QuadPart - Trace->StartTime.QuadPart;
+    if (Elapsed < 0) {
+        Elapsed = 0;
+    }
+
+    return Elapsed * 1000000 / Trace->Frequency.QuadPart;
+}
+
+/**
+ Begin recording a trace to the specified file.
+
+ @param MakeContext Pointer to the make context.
+
+ @param FileName Pointer to the name of the file to write the trace to, as
+        specified by the user.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeTraceInitialize(
+    __inout PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FileName
+    )
+{
+    PMAKE_TRACE_CONTEXT Trace;
+    YORI_STRING FullFileName;
+
+    Trace = &MakeContext->Trace;
+    MakeTraceCleanup(MakeContext);
+
+    YoriLibInitEmptyString(&FullFileName);
+    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullFileName)) {
+        return FALSE;
+    }
+
+    Trace->hFile = CreateFile(FullFileName.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (Trace->hFile == INVALID_HANDLE_VALUE) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ymake: could not open trace file %y\n"), &FullFileName);
+        YoriLibFreeStringContents(&FullFileName);
+        Trace->hFile = NULL;
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&FullFileName);
+
+    QueryPerformanceFrequency(&Trace->Frequency);
+    QueryPerformanceCounter(&Trace->StartTime);
+    Trace->EventCount = 0;
+
+    if (!MakeTraceAppend(Trace, _T("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"))) {
+        MakeTraceCleanup(MakeContext);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Record an operation which occurred during a specified interval.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Category The category of the operation, allowing the viewer to
+        filter operations of a type.
+
+ @param Name Pointer to the name of the operation, such as the command that
+        was executed.
+
+ @param ThreadId The row that the operation should be displayed on.  Zero
+        refers to work performed by ymake itself, and other values refer to
+        the job slot that executed a recipe.
+
+ @param StartTime Pointer to the performance counter value when the
+        operation started.
+
+ @param EndTime Pointer to the performance counter value when the operation
+        completed.
+
+ @param Detail Optionally points to additional information to display with
+        the operation, such as the target that a command is building.
+
+ @param ExitCode The result of the operation.
+ */
+VOID
+MakeTraceRecordEvent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in LPCTSTR Category,
+    __in PCYORI_STRING Name,
+    __in DWORD ThreadId,
+    __in PLARGE_INTEGER StartTime,
+    __in PLARGE_INTEGER EndTime,
+    __in_opt PCYORI_STRING Detail,
+    __in DWORD ExitCode
+    )
+{
+    PMAKE_TRACE_CONTEXT Trace;
+    LONGLONG Start;
+    LONGLONG End;
+    LPTSTR Separator;
+
+    Trace = &MakeContext->Trace;
+    if (Trace->hFile == NULL) {
+        return;
+    }
+
+    if (!MakeTraceEscapeString(&Trace->EscapedName, Name)) {
+        return;
+    }
+
+    Trace->EscapedDetail.LengthInChars = 0;
+    if (Detail != NULL) {
+        if (!MakeTraceEscapeString(&Trace->EscapedDetail, Detail)) {
+            return;
+        }
+    }
+
+    Start = MakeTraceTimeToMicroseconds(Trace, StartTime);
+    End = MakeTraceTimeToMicroseconds(Trace, EndTime);
+
+    Separator = _T("");
+    if (Trace->EventCount > 0) {
+        Separator = _T(",\n");
+    }
+
+    if (MakeTraceAppend(Trace,
+                        _T("%s{\"name\":\"%y\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%lli,\"dur\":%lli,\"args\":{\"detail\":\"%y\",\"exitCode\":%i}}"),
+                        Separator,
+                        &Trace->EscapedName,
+                        Category,
+                        ThreadId,
+                        Start,
+                        End - Start,
+                        &Trace->EscapedDetail,
+                        ExitCode)) {
+
+        Trace->EventCount++;
+    }
+}
+
+/**
+ Record a phase of processing performed by ymake itself.
+
+ @param MakeContext Pointer to the make context.
+
+ @param Name The name of the phase.
+
+ @param StartTime Pointer to the performance counter value when the phase
+        started.
+
+ @param EndTime Pointer to the performance counter value when the phase
+        completed.
+ */
+VOID
+MakeTraceRecordPhase(
+    __in PMAKE_CONTEXT MakeContext,
+    __in LPCTSTR Name,
+    __in PLARGE_INTEGER StartTime,
+    __in PLARGE_INTEGER EndTime
+    )
+{
+    YORI_STRING PhaseName;
+
+    YoriLibConstantString(&PhaseName, Name);
+    MakeTraceRecordEvent(MakeContext, _T("phase"), &PhaseName, 0, StartTime, EndTime, NULL, EXIT_SUCCESS);
+}
+
+/**
+ Complete the trace file, naming each row, and release all resources used
+ for tracing.  This function is safe to call if tracing has not been
+ enabled.
+
+ @param MakeContext Pointer to the make context.
+ */
+VOID
+MakeTraceCleanup(
+    __inout PMAKE_CONTEXT MakeContext
+    )
+{
+    PMAKE_TRACE_CONTEXT Trace;
+    DWORD Index;
+    LPTSTR Separator;
+
+    Trace = &MakeContext->Trace;
+
+    if (Trace->hFile != NULL) {
+
+        Separator = _T("");
+        if (Trace->EventCount > 0) {
+            Separator = _T(",\n");
+        }
+
+        MakeTraceAppend(Trace, _T("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ymake\"}}"), Separator);
+
+        for (Index = 0; Index < MakeContext->NumberProcesses + MakeContext->NumberRemoteProcesses; Index++) {
+            MakeTraceAppend(Trace, _T(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"Job %i\"}}"), Index + 1, Index);
+        }
+
+        MakeTraceAppend(Trace, _T("\n]}\n"));
+        MakeTraceFlush(Trace);
+        CloseHandle(Trace->hFile);
+        Trace->hFile = NULL;
+    }
+
+    YoriLibFreeStringContents(&Trace->Buffer);
+    YoriLibFreeStringContents(&Trace->EscapedName);
+    YoriLibFreeStringContents(&Trace->EscapedDetail);
+    Trace->EventCount = 0;
+}
+
+// vim:sw=4:ts=4:et:
@@ -42,10 +42,10 @@ MakeDeleteVariable(
     __in PMAKE_VARIABLE Variable
     )
 {
-    UNREFERENCED_PARAMETER(ScopeContext);
-
     YoriLibRemoveListItem(&Variable->ListEntry);
-    YoriLibHashRemoveByEntry(&Variable->HashEntry);
+    YoriLibGrowableHashRemoveByEntry(ScopeContext->Variables, &Variable->HashEntry);
+    YoriLibFreeStringContents(&Variable->CachedExpression);
+    YoriLibFreeStringContents(&Variable->CachedExpansion);
     YoriLibFreeStringContents(&Variable->Value);
     YoriLibDereference(Variable);
 }
@@ -140,7 +140,7 @@ MakeLookupVariable(
     FoundVariable = NULL;
 
     do {
-        FoundVariableEntry = YoriLibHashLookupByKey(SearchScopeContext->Variables, Variable);
+        FoundVariableEntry = YoriLibGrowableHashLookupByKey(SearchScopeContext->Variables, Variable);
         if (FoundVariableEntry != NULL) {
             FoundVariable = FoundVariableEntry->Context;
             break;
@@ -283,6 +283,20 @@ MakeSubstituteNamedVariable(
         return TRUE;
     }
 
+    //
+    //  Makefiles tend to apply the same substitution to the same variable
+    //  many times, such as converting a list of objects to sources for
+    //  each target.  If this is the expression that was last applied and
+    //  the value has not changed since, reuse the result.
+    //
+
+    if (FoundVariable->CachedExpansion.MemoryToFree != NULL &&
+        YoriLibCompareString(&FoundVariable->CachedExpression, VariableName) == 0) {
+
+        YoriLibCloneString(VariableData, &FoundVariable->CachedExpansion);
+        return TRUE;
+    }
+
     LengthNeeded = 0;
 
     //
@@ -340,9 +354,83 @@ MakeSubstituteNamedVariable(
     }
 
     VariableData->LengthInChars = LengthNeeded;
+
+    //
+    //  Remember this result for the next time the same expression is used.
+    //  Failing to do so only means it will be calculated again.
+    //
+
+    YoriLibFreeStringContents(&FoundVariable->CachedExpression);
+    YoriLibFreeStringContents(&FoundVariable->CachedExpansion);
+    if (YoriLibCopyString(&FoundVariable->CachedExpression, VariableName)) {
+        YoriLibCloneString(&FoundVariable->CachedExpansion, VariableData);
+    }
+
     return TRUE;
 }
 
+/**
+ Parse a reference to a variable within a line.  This can be of the form
+ $(NAME), or a single character form such as $@ or $<, or the two character
+ forms $$@ and $**.
+
+ @param Line Pointer to the line containing the reference.
+
+ @param ReadIndex The index within the line of the $ character.  The caller
+        is expected to have checked that at least one character follows.
+
+ @param VariableName On completion, updated to point to the name of the
+        variable within the line.  This is empty if the reference is not
+        terminated.
+
+ @return The index of the final character within the line that forms part
+         of the reference.
+ */
+YORI_ALLOC_SIZE_T
+MakeParseVariableReference(
+    __in PCYORI_STRING Line,
+    __in YORI_ALLOC_SIZE_T ReadIndex,
+    __out PYORI_STRING VariableName
+    )
+{
+    YORI_ALLOC_SIZE_T StartVariableNameIndex;
+    BOOLEAN BraceDelimited;
+
+    YoriLibInitEmptyString(VariableName);
+
+    BraceDelimited = FALSE;
+    StartVariableNameIndex = ReadIndex + 1;
+    if (Line->StartOfString[StartVariableNameIndex] == '(' &&
+        StartVariableNameIndex + 1 < Line->LengthInChars) {
+        StartVariableNameIndex = StartVariableNameIndex + 1;
+        BraceDelimited = TRUE;
+    }
+
+    VariableName->StartOfString = &Line->StartOfString[StartVariableNameIndex];
+
+    if (BraceDelimited) {
+        VariableName->LengthInChars = 0;
+        for (ReadIndex = StartVariableNameIndex ;ReadIndex < Line->LengthInChars; ReadIndex++) {
+            if (Line->StartOfString[ReadIndex] == ')') {
+                VariableName->LengthInChars = ReadIndex - StartVariableNameIndex;
+                break;
+            }
+        }
+    } else {
+
+        if (ReadIndex + 2 < Line->LengthInChars &&
+            ((VariableName->StartOfString[0] == '$' && VariableName->StartOfString[1] == '@') ||
+             (VariableName->StartOfString[0] == '*' && VariableName->StartOfString[1] == '*'))) {
+            VariableName->LengthInChars = 2;
+        } else {
+            VariableName->LengthInChars = 1;
+        }
+        ReadIndex = ReadIndex + VariableName->LengthInChars;
+    }
+
+    return ReadIndex;
+}
+
 /**
  Expand all of the variables in a given string.  This will always copy the
  string.  The reason for the copy is to support reusing the allocation that
@@ -384,9 +472,6 @@ MakeExpandVariables(
 {
     YORI_STRING VariableName;
     YORI_STRING VariableContents;
-    BOOLEAN BraceDelimited;
-
-    YORI_ALLOC_SIZE_T StartVariableNameIndex;
     YORI_ALLOC_SIZE_T ReadIndex;
     YORI_ALLOC_SIZE_T WriteIndex;
     YORI_ALLOC_SIZE_T LengthNeeded;
@@ -402,35 +487,7 @@ MakeExpandVariables(
         if (Line->StartOfString[ReadIndex] == '$' &&
             ReadIndex + 1 < Line->LengthInChars) {
 
-            BraceDelimited = FALSE;
-            StartVariableNameIndex = ReadIndex + 1;
-            if (Line->StartOfString[StartVariableNameIndex] == '(' &&
-                StartVariableNameIndex + 1 < Line->LengthInChars) {
-                StartVariableNameIndex = StartVariableNameIndex + 1;
-                BraceDelimited = TRUE;
-            }
-
-            VariableName.StartOfString = &Line->StartOfString[StartVariableNameIndex];
-
-            if (BraceDelimited) {
-                VariableName.LengthInChars = 0;
-                for (ReadIndex = StartVariableNameIndex ;ReadIndex < Line->LengthInChars; ReadIndex++) {
-                    if (Line->StartOfString[ReadIndex] == ')') {
-                        VariableName.LengthInChars = ReadIndex - StartVariableNameIndex;
-                        break;
-                    }
-                }
-            } else {
-
-                if (ReadIndex + 2 < Line->LengthInChars &&
-                    ((VariableName.StartOfString[0] == '$' && VariableName.StartOfString[1] == '@') ||
-                     (VariableName.StartOfString[0] == '*' && VariableName.StartOfString[1] == '*'))) {
-                    VariableName.LengthInChars = 2;
-                } else {
-                    VariableName.LengthInChars = 1;
-                }
-                ReadIndex = ReadIndex + VariableName.LengthInChars;
-            }
+            ReadIndex = MakeParseVariableReference(Line, ReadIndex, &VariableName);
 
             if (VariableName.LengthInChars > 0) {
                 if (MakeSubstituteNamedVariable(ScopeContext, Target, &VariableName, &VariableContents)) {
@@ -467,35 +524,7 @@ MakeExpandVariables(
         if (Line->StartOfString[ReadIndex] == '$' &&
             ReadIndex + 1 < Line->LengthInChars) {
 
-            BraceDelimited = FALSE;
-            StartVariableNameIndex = ReadIndex + 1;
-            if (Line->StartOfString[StartVariableNameIndex] == '(' &&
-                StartVariableNameIndex + 1 < Line->LengthInChars) {
-                StartVariableNameIndex = StartVariableNameIndex + 1;
-                BraceDelimited = TRUE;
-            }
-
-            VariableName.StartOfString = &Line->StartOfString[StartVariableNameIndex];
-
-            if (BraceDelimited) {
-                VariableName.LengthInChars = 0;
-                for (ReadIndex = StartVariableNameIndex ;ReadIndex < Line->LengthInChars; ReadIndex++) {
-                    if (Line->StartOfString[ReadIndex] == ')') {
-                        VariableName.LengthInChars = ReadIndex - StartVariableNameIndex;
-                        break;
-                    }
-                }
-            } else {
-
-                if (ReadIndex + 2 < Line->LengthInChars &&
-                    ((VariableName.StartOfString[0] == '$' && VariableName.StartOfString[1] == '@') ||
-                     (VariableName.StartOfString[0] == '*' && VariableName.StartOfString[1] == '*'))) {
-                    VariableName.LengthInChars = 2;
-                } else {
-                    VariableName.LengthInChars = 1;
-                }
-                ReadIndex = ReadIndex + VariableName.LengthInChars;
-            }
+            ReadIndex = MakeParseVariableReference(Line, ReadIndex, &VariableName);
 
             if (VariableName.LengthInChars > 0) {
                 if (MakeSubstituteNamedVariable(ScopeContext, Target, &VariableName, &VariableContents)) {
@@ -521,6 +550,288 @@ MakeExpandVariables(
     return TRUE;
 }
 
+/**
+ Split a single line of a recipe into literal text and variable references.
+ This is called once to count the segments and again to populate them.
+
+ @param Line Pointer to the line, after any command prefixes have been
+        removed.
+
+ @param Segments Optionally points to an array of segments to populate.  If
+        NULL, segments are counted but not populated.
+
+ @return The number of segments in the line.
+ */
+YORI_ALLOC_SIZE_T
+MakeCompileRecipeLine(
+    __in PCYORI_STRING Line,
+    __out_opt PMAKE_RECIPE_SEGMENT Segments
+    )
+{
+    YORI_STRING VariableName;
+    YORI_ALLOC_SIZE_T ReadIndex;
+    YORI_ALLOC_SIZE_T LiteralStart;
+    YORI_ALLOC_SIZE_T SegmentCount;
+
+    SegmentCount = 0;
+    LiteralStart = 0;
+    for (ReadIndex = 0; ReadIndex < Line->LengthInChars; ReadIndex++) {
+        if (Line->StartOfString[ReadIndex] == '$' &&
+            ReadIndex + 1 < Line->LengthInChars) {
+
+            if (ReadIndex > LiteralStart) {
+                if (Segments != NULL) {
+                    YoriLibInitEmptyString(&Segments[SegmentCount].Text);
+                    Segments[SegmentCount].Text.StartOfString = &Line->StartOfString[LiteralStart];
+                    Segments[SegmentCount].Text.LengthInChars = ReadIndex - LiteralStart;
+                    Segments[SegmentCount].Variable = FALSE;
+                }
+                SegmentCount++;
+            }
+
+            ReadIndex = MakeParseVariableReference(Line, ReadIndex, &VariableName);
+            if (VariableName.LengthInChars > 0) {
+                if (Segments != NULL) {
+                    memcpy(&Segments[SegmentCount].Text, &VariableName, sizeof(YORI_STRING));
+                    Segments[SegmentCount].Variable = TRUE;
+                }
+                SegmentCount++;
+            }
+            LiteralStart = ReadIndex + 1;
+
+        } else if (ReadIndex + 1 < Line->LengthInChars &&
+                   Line->StartOfString[ReadIndex] == '%' &&
+                   Line->StartOfString[ReadIndex + 1] == '%') {
+
+            //
+            //  Retain the first % and drop the second, matching
+            //  MakeExpandVariables.
+            //
+
+            if (Segments != NULL) {
+                YoriLibInitEmptyString(&Segments[SegmentCount].Text);
+                Segments[SegmentCount].Text.StartOfString = &Line->StartOfString[LiteralStart];
+                Segments[SegmentCount].Text.LengthInChars = ReadIndex + 1 - LiteralStart;
+                Segments[SegmentCount].Variable = FALSE;
+            }
+            SegmentCount++;
+            ReadIndex++;
+            LiteralStart = ReadIndex + 1;
+        }
+    }
+
+    if (LiteralStart < Line->LengthInChars) {
+        if (Segments != NULL) {
+            YoriLibInitEmptyString(&Segments[SegmentCount].Text);
+            Segments[SegmentCount].Text.StartOfString = &Line->StartOfString[LiteralStart];
+            Segments[SegmentCount].Text.LengthInChars = Line->LengthInChars - LiteralStart;
+            Segments[SegmentCount].Variable = FALSE;
+        }
+        SegmentCount++;
+    }
+
+    return SegmentCount;
+}
+
+/**
+ Split a recipe into lines, remove the prefixes from each line, and split
+ each line into literal text and variable references.  The result does not
+ depend on the value of any variable, so a recipe used by an inference rule
+ can be compiled once and expanded for each target that uses it.
+
+ @param Recipe Pointer to the recipe text.  The compiled recipe retains a
+        reference to this allocation.
+
+ @return Pointer to the compiled recipe, or NULL on allocation failure.  The
+         caller should free this with MakeFreeCompiledRecipe.
+ */
+__success(return != NULL)
+PMAKE_COMPILED_RECIPE
+MakeCompileRecipe(
+    __in PYORI_STRING Recipe
+    )
+{
+    PMAKE_COMPILED_RECIPE CompiledRecipe;
+    PMAKE_RECIPE_LINE RecipeLine;
+    YORI_STRING Line;
+    YORI_ALLOC_SIZE_T StartLineIndex;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T LineCount;
+    YORI_ALLOC_SIZE_T SegmentCount;
+    YORI_ALLOC_SIZE_T Pass;
+    YORI_ALLOC_SIZE_T BytesNeeded;
+    BOOLEAN DisplayCmd;
+    BOOLEAN IgnoreErrors;
+    BOOLEAN Remote;
+
+    CompiledRecipe = NULL;
+    LineCount = 0;
+    SegmentCount = 0;
+
+    //
+    //  The first pass counts lines and segments, and the second populates
+    //  them into a single allocation.
+    //
+
+    for (Pass = 0; Pass < 2; Pass++) {
+
+        if (Pass == 1) {
+            BytesNeeded = sizeof(MAKE_COMPILED_RECIPE) +
+                          LineCount * sizeof(MAKE_RECIPE_LINE) +
+                          SegmentCount * sizeof(MAKE_RECIPE_SEGMENT);
+
+            CompiledRecipe = YoriLibReferencedMalloc(BytesNeeded);
+            if (CompiledRecipe == NULL) {
+                return NULL;
+            }
+
+            YoriLibCloneString(&CompiledRecipe->Source, Recipe);
+            CompiledRecipe->LineCount = LineCount;
+            CompiledRecipe->SegmentCount = SegmentCount;
+            CompiledRecipe->Lines = (PMAKE_RECIPE_LINE)(CompiledRecipe + 1);
+            CompiledRecipe->Segments = (PMAKE_RECIPE_SEGMENT)(CompiledRecipe->Lines + LineCount);
+
+            LineCount = 0;
+            SegmentCount = 0;
+        }
+
+        YoriLibInitEmptyString(&Line);
+        StartLineIndex = 0;
+        for (Index = 0; Index < Recipe->LengthInChars; Index++) {
+            if (Recipe->StartOfString[Index] != '\n') {
+                continue;
+            }
+
+            Line.StartOfString = &Recipe->StartOfString[StartLineIndex];
+            Line.LengthInChars = Index - StartLineIndex;
+            StartLineIndex = Index + 1;
+
+            DisplayCmd = TRUE;
+            IgnoreErrors = FALSE;
+            Remote = FALSE;
+
+            while (Line.LengthInChars > 0) {
+                if (Line.StartOfString[0] == '@') {
+                    DisplayCmd = FALSE;
+                } else if (Line.StartOfString[0] == '-') {
+                    IgnoreErrors = TRUE;
+                } else if (Line.StartOfString[0] == '^') {
+                    Remote = TRUE;
+                } else {
+                    break;
+                }
+                Line.StartOfString++;
+                Line.LengthInChars--;
+            }
+
+            if (CompiledRecipe != NULL) {
+                RecipeLine = &CompiledRecipe->Lines[LineCount];
+                RecipeLine->DisplayCmd = DisplayCmd;
+                RecipeLine->IgnoreErrors = IgnoreErrors;
+                RecipeLine->Remote = Remote;
+                RecipeLine->FirstSegment = SegmentCount;
+                RecipeLine->SegmentCount = MakeCompileRecipeLine(&Line, &CompiledRecipe->Segments[SegmentCount]);
+                SegmentCount = SegmentCount + RecipeLine->SegmentCount;
+            } else {
+                SegmentCount = SegmentCount + MakeCompileRecipeLine(&Line, NULL);
+            }
+            LineCount++;
+        }
+    }
+
+    return CompiledRecipe;
+}
+
+/**
+ Free a compiled recipe.
+
+ @param CompiledRecipe Pointer to the compiled recipe to free.
+ */
+VOID
+MakeFreeCompiledRecipe(
+    __in PMAKE_COMPILED_RECIPE CompiledRecipe
+    )
+{
+    YoriLibFreeStringContents(&CompiledRecipe->Source);
+    YoriLibDereference(CompiledRecipe);
+}
+
+/**
+ Generate a command from a line of a compiled recipe by substituting each of
+ its variable references.  Unlike MakeExpandVariables, the line does not
+ need to be scanned, and each variable is substituted once rather than once
+ to measure and once to copy.
+
+ @param ScopeContext Pointer to the scope context specifying all of the
+        active variables.
+
+ @param Target Optionally points to a target that is associated with the
+        variables being expanded, used to expand $@, $< et al.
+
+ @param CompiledRecipe Pointer to the compiled recipe.
+
+ @param RecipeLine Pointer to the line within the compiled recipe to expand.
+
+ @param ExpandedLine On input, points to an initialized Yori string.  On
+        output, contains the command with variables expanded.  Note this
+        string can be reallocated within this routine.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeExpandCompiledRecipeLine(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __in_opt PMAKE_TARGET Target,
+    __in PMAKE_COMPILED_RECIPE CompiledRecipe,
+    __in PMAKE_RECIPE_LINE RecipeLine,
+    __inout PYORI_STRING ExpandedLine
+    )
+{
+    PMAKE_RECIPE_SEGMENT Segment;
+    PYORI_STRING Source;
+    YORI_STRING VariableContents;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T WriteIndex;
+
+    WriteIndex = 0;
+    ExpandedLine->LengthInChars = 0;
+    for (Index = 0; Index < RecipeLine->SegmentCount; Index++) {
+        Segment = &CompiledRecipe->Segments[RecipeLine->FirstSegment + Index];
+        YoriLibInitEmptyString(&VariableContents);
+        if (Segment->Variable) {
+            if (!MakeSubstituteNamedVariable(ScopeContext, Target, &Segment->Text, &VariableContents)) {
+                continue;
+            }
+            Source = &VariableContents;
+        } else {
+            Source = &Segment->Text;
+        }
+
+        if (ExpandedLine->LengthAllocated < WriteIndex + Source->LengthInChars + 1) {
+            if (!YoriLibReallocateString(ExpandedLine, WriteIndex + Source->LengthInChars + 1024)) {
+                YoriLibFreeStringContents(&VariableContents);
+                return FALSE;
+            }
+            ScopeContext->MakeContext->AllocExpandedLine++;
+        }
+
+        memcpy(&ExpandedLine->StartOfString[WriteIndex], Source->StartOfString, Source->LengthInChars * sizeof(TCHAR));
+        WriteIndex = WriteIndex + Source->LengthInChars;
+        ExpandedLine->LengthInChars = WriteIndex;
+        YoriLibFreeStringContents(&VariableContents);
+    }
+
+    if (ExpandedLine->LengthAllocated < WriteIndex + 1) {
+        if (!YoriLibReallocateString(ExpandedLine, WriteIndex + 1)) {
+            return FALSE;
+        }
+    }
+
+    ExpandedLine->StartOfString[WriteIndex] = '\0';
+    ExpandedLine->LengthInChars = WriteIndex;
+    return TRUE;
+}
+
 /**
  Set a variable to a value.
 
@@ -552,12 +863,19 @@ MakeSetVariable(
     PYORI_HASH_ENTRY FoundVariableEntry;
     PMAKE_VARIABLE FoundVariable;
 
-    FoundVariableEntry = YoriLibHashLookupByKey(ScopeContext->Variables, Variable);
+    FoundVariableEntry = YoriLibGrowableHashLookupByKey(ScopeContext->Variables, Variable);
     if (FoundVariableEntry != NULL) {
         FoundVariable = FoundVariableEntry->Context;
 
         if (FoundVariable->Precedence <= Precedence) {
 
+            //
+            //  Any cached substitution refers to the previous value.
+            //
+
+            YoriLibFreeStringContents(&FoundVariable->CachedExpression);
+            YoriLibFreeStringContents(&FoundVariable->CachedExpansion);
+
             if (Value != NULL && FoundVariable->Value.LengthAllocated < Value->LengthInChars) {
                 YoriLibFreeStringContents(&FoundVariable->Value);
                 if (!YoriLibAllocateString(&FoundVariable->Value, Value->LengthInChars)) {
@@ -586,9 +904,9 @@ MakeSetVariable(
         YORI_STRING VariableNameCopy;
         YORI_ALLOC_SIZE_T LengthNeeded;
 
-        LengthNeeded = Variable->LengthInChars;
+        LengthNeeded = 0;
         if (Value != NULL) {
-            LengthNeeded = LengthNeeded + Value->LengthInChars;
+            LengthNeeded = Value->LengthInChars;
         }
 
         FoundVariable = YoriLibReferencedMalloc(sizeof(MAKE_VARIABLE) + LengthNeeded * sizeof(TCHAR));
@@ -599,22 +917,23 @@ MakeSetVariable(
 
         //
         //  The hash package will clone (reference) the string rather than
-        //  copy it.  It has to be copied somewhere, so we copy it here, into
-        //  the same allocation used to hold the value.  Note the variable
-        //  name is effectively immutable, so we don't need referencing or
-        //  to support reallocation.
+        //  copy it.  The same variable names are defined in every scope, so
+        //  the name comes from the shared name pool and each scope refers to
+        //  a single copy.
         //
 
-        YoriLibInitEmptyString(&VariableNameCopy);
-        VariableNameCopy.StartOfString = (LPTSTR)(FoundVariable + 1);
-        memcpy(VariableNameCopy.StartOfString, Variable->StartOfString, Variable->LengthInChars * sizeof(TCHAR));
-        VariableNameCopy.LengthInChars = Variable->LengthInChars;
+        if (!YoriLibInternString(ScopeContext->MakeContext->Names, Variable, &VariableNameCopy)) {
+            YoriLibDereference(FoundVariable);
+            return FALSE;
+        }
 
         YoriLibInitEmptyString(&FoundVariable->Value);
+        YoriLibInitEmptyString(&FoundVariable->CachedExpression);
+        YoriLibInitEmptyString(&FoundVariable->CachedExpansion);
         if (Value != NULL) {
             YoriLibReference(FoundVariable);
             FoundVariable->Value.MemoryToFree = FoundVariable;
-            FoundVariable->Value.StartOfString = VariableNameCopy.StartOfString + VariableNameCopy.LengthInChars;
+            FoundVariable->Value.StartOfString = (LPTSTR)(FoundVariable + 1);
             memcpy(FoundVariable->Value.StartOfString, Value->StartOfString, Value->LengthInChars * sizeof(TCHAR));
             FoundVariable->Value.LengthAllocated = Value->LengthInChars;
             FoundVariable->Value.LengthInChars = Value->LengthInChars;
@@ -628,7 +947,13 @@ MakeSetVariable(
 
         FoundVariable->Precedence = Precedence;
 
-        YoriLibHashInsertByKey(ScopeContext->Variables, &VariableNameCopy, FoundVariable, &FoundVariable->HashEntry);
+        if (!YoriLibGrowableHashInsertByKey(ScopeContext->Variables, &VariableNameCopy, FoundVariable, &FoundVariable->HashEntry)) {
+            YoriLibFreeStringContents(&VariableNameCopy);
+            YoriLibFreeStringContents(&FoundVariable->Value);
+            YoriLibDereference(FoundVariable);
+            return FALSE;
+        }
+        YoriLibFreeStringContents(&VariableNameCopy);
         YoriLibInsertList(&ScopeContext->VariableList, &FoundVariable->ListEntry);
     }
 
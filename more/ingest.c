@@ -143,6 +143,8 @@ MoreAddPhysicalLineToBuffer(
     NewLine->InitialColor = AllocContext->PreviousColor;
     NewLine->LineNumber = MoreContext->LineCount + 1;
     NewLine->FilteredLineNumber = NewLine->LineNumber;
+    NewLine->FileOffset = 0;
+    NewLine->ByteLength = 0;
     YoriLibReference(AllocContext->Buffer);
     NewLine->LineContents.MemoryToFree = AllocContext->Buffer;
     NewLine->LineContents.StartOfString = (LPTSTR)(NewLine + 1);
@@ -432,6 +434,18 @@ MoreIngestThread(
         }
 
         MoreProcessStream(GetStdHandle(STD_INPUT_HANDLE), MoreContext);
+    } else if (MoreContext->InputSourceCount == 1 &&
+               !MoreContext->Recursive &&
+               !MoreContext->WaitForMore &&
+               MoreMappedOpen(MoreContext, &MoreContext->InputSources[0])) {
+
+        //
+        //  A single large file is indexed rather than copied, so it can be
+        //  displayed without reading the whole file into memory.
+        //
+
+        MoreContext->FilesFound++;
+        MoreMappedIndexFile(MoreContext);
     } else {
         MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
         if (MoreContext->Recursive) {
@@ -317,6 +317,25 @@ MoreGetNextFilteredPhysicalLine(
     PYORI_LIST_ENTRY ListEntry;
     PMORE_PHYSICAL_LINE ThisLine;
 
+    //
+    //  A mapped file has no filtered list, so lines are generated until one
+    //  matches.
+    //
+
+    if (MoreContext->MappedFileActive) {
+        ThisLine = PreviousLine;
+        while (TRUE) {
+            ThisLine = MoreMappedGetNextLine(MoreContext, ThisLine);
+            if (ThisLine == NULL ||
+                !MoreContext->FilterToSearch ||
+                MoreFindNextSearchMatch(MoreContext, &ThisLine->LineContents, NULL, NULL)) {
+
+                break;
+            }
+        }
+        return ThisLine;
+    }
+
     if (PreviousLine != NULL) {
         ListEntry = YoriLibGetNextListEntry(&MoreContext->FilteredPhysicalLineList, &PreviousLine->FilteredLineList);
     } else {
@@ -362,6 +381,20 @@ MoreGetPreviousFilteredPhysicalLine(
     PYORI_LIST_ENTRY ListEntry;
     PMORE_PHYSICAL_LINE ThisLine;
 
+    if (MoreContext->MappedFileActive) {
+        ThisLine = NextLine;
+        while (TRUE) {
+            ThisLine = MoreMappedGetPreviousLine(MoreContext, ThisLine);
+            if (ThisLine == NULL ||
+                !MoreContext->FilterToSearch ||
+                MoreFindNextSearchMatch(MoreContext, &ThisLine->LineContents, NULL, NULL)) {
+
+                break;
+            }
+        }
+        return ThisLine;
+    }
+
     if (NextLine != NULL) {
         ListEntry = YoriLibGetPreviousListEntry(&MoreContext->FilteredPhysicalLineList, &NextLine->FilteredLineList);
     } else {
@@ -384,7 +417,366 @@ MoreGetPreviousFilteredPhysicalLine(
 }
 
 /**
- Apply a new search criteria to update the set of filtered lines.
+ Evaluate the search strings against the lines described by a filter chunk.
+ This is invoked on a worker thread.  The lines described by the chunk were
+ present when the chunk was extended, and lines are never removed while the
+ viewport is active, so they can be examined without holding the physical
+ line mutex.  This allows ingest to continue appending lines concurrently.
+
+ @param Context Pointer to the more context.
+
+ @param Item Pointer to the work item within the chunk to evaluate.
+
+ @param Cancelled If TRUE, the chunk is not evaluated and any results it
+        contains are discarded.
+ */
+VOID
+MoreFilterChunkWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PMORE_CONTEXT MoreContext;
+    PMORE_FILTER_CHUNK Chunk;
+    PMORE_PHYSICAL_LINE ThisLine;
+    YORI_ALLOC_SIZE_T Index;
+    DWORD Mask;
+
+    MoreContext = (PMORE_CONTEXT)Context;
+    Chunk = CONTAINING_RECORD(Item, MORE_FILTER_CHUNK, WorkItem);
+
+    if (Cancelled) {
+        Chunk->LinesValid = 0;
+        return;
+    }
+
+    ThisLine = Chunk->FirstLine;
+    for (Index = 0; Index < Chunk->LineCount; Index++) {
+        Mask = 1 << (Index % 32);
+
+        //
+        //  Lines which are already known not to match are skipped, as are
+        //  lines with known results if the search strings haven't changed.
+        //
+
+        if (Index >= Chunk->LinesValid ||
+            (Chunk->RecheckMatches && (Chunk->Matches[Index / 32] & Mask) != 0)) {
+
+            if (MoreFindNextSearchMatch(MoreContext, &ThisLine->LineContents, NULL, NULL)) {
+                Chunk->Matches[Index / 32] = Chunk->Matches[Index / 32] | Mask;
+            } else {
+                Chunk->Matches[Index / 32] = Chunk->Matches[Index / 32] & ~Mask;
+            }
+        }
+
+        if (Index + 1 < Chunk->LineCount) {
+            ThisLine = CONTAINING_RECORD(ThisLine->LineList.Next, MORE_PHYSICAL_LINE, LineList);
+        }
+    }
+
+    Chunk->LinesValid = Chunk->LineCount;
+}
+
+/**
+ Extend the filter chunks to describe every physical line that is currently
+ present.  The caller is expected to hold the physical line mutex.
+
+ @param MoreContext Pointer to the more context.
+
+ @return TRUE to indicate every line is described by a chunk, FALSE on
+         allocation failure.  Lines not described by a chunk are evaluated
+         when the filtered list is updated.
+ */
+BOOLEAN
+MoreFilterExtendChunks(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMORE_PHYSICAL_LINE ThisLine;
+    PMORE_FILTER_CHUNK Chunk;
+    PMORE_FILTER_CHUNK *NewChunks;
+    YORI_ALLOC_SIZE_T NewAllocated;
+
+    if (MoreContext->FilterLastLine != NULL) {
+        ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, &MoreContext->FilterLastLine->LineList);
+    } else {
+        ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, NULL);
+    }
+
+    Chunk = NULL;
+    if (MoreContext->FilterChunkCount > 0) {
+        Chunk = MoreContext->FilterChunks[MoreContext->FilterChunkCount - 1];
+    }
+
+    while (ListEntry != NULL) {
+        ThisLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
+
+        if (Chunk == NULL || Chunk->LineCount >= MORE_FILTER_CHUNK_LINES) {
+            if (MoreContext->FilterChunkCount >= MoreContext->FilterChunksAllocated) {
+                NewAllocated = MoreContext->FilterChunksAllocated * 2;
+                if (NewAllocated == 0) {
+                    NewAllocated = 64;
+                }
+
+                if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)NewAllocated * sizeof(PMORE_FILTER_CHUNK))) {
+                    return FALSE;
+                }
+
+                NewChunks = YoriLibMalloc(NewAllocated * sizeof(PMORE_FILTER_CHUNK));
+                if (NewChunks == NULL) {
+                    return FALSE;
+                }
+
+                if (MoreContext->FilterChunks != NULL) {
+                    memcpy(NewChunks, MoreContext->FilterChunks, MoreContext->FilterChunkCount * sizeof(PMORE_FILTER_CHUNK));
+                    YoriLibFree(MoreContext->FilterChunks);
+                }
+
+                MoreContext->FilterChunks = NewChunks;
+                MoreContext->FilterChunksAllocated = NewAllocated;
+            }
+
+            Chunk = YoriLibMalloc(sizeof(MORE_FILTER_CHUNK));
+            if (Chunk == NULL) {
+                return FALSE;
+            }
+
+            ZeroMemory(Chunk, sizeof(MORE_FILTER_CHUNK));
+            Chunk->FirstLine = ThisLine;
+            MoreContext->FilterChunks[MoreContext->FilterChunkCount] = Chunk;
+            MoreContext->FilterChunkCount++;
+        }
+
+        Chunk->LineCount++;
+        MoreContext->FilterLastLine = ThisLine;
+        ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, ListEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Determine whether the results recorded in the filter chunks can be used
+ with the current search strings.
+
+ @param MoreContext Pointer to the more context.
+
+ @param RecheckMatches On successful completion, set to TRUE if lines which
+        matched previously need to be examined again because a search string
+        has been extended, or FALSE if the search strings are unchanged.
+
+ @return TRUE if previous results can be used, FALSE if every line must be
+         examined.
+ */
+__success(return)
+BOOLEAN
+MoreFilterResultsReusable(
+    __in PMORE_CONTEXT MoreContext,
+    __out PBOOLEAN RecheckMatches
+    )
+{
+    UCHAR SearchCount;
+    UCHAR Index;
+    BOOLEAN Recheck;
+
+    if (!MoreContext->FilterResultsValid) {
+        return FALSE;
+    }
+
+    SearchCount = MoreSearchCountActive(MoreContext);
+    if (SearchCount != MoreContext->FilterSearchCount) {
+        return FALSE;
+    }
+
+    Recheck = FALSE;
+    for (Index = 0; Index < SearchCount; Index++) {
+        if (YoriLibCompareStringInsensitive(&MoreContext->SearchStrings[Index], &MoreContext->FilterSearchStrings[Index]) == 0) {
+            continue;
+        }
+
+        //
+        //  If the new string contains the old one, any line containing the
+        //  new string contains the old one, so only lines that matched
+        //  before can match now.
+        //
+
+        if (YoriLibFindFirstMatchingSubstringInsensitive(&MoreContext->SearchStrings[Index], 1, &MoreContext->FilterSearchStrings[Index], NULL) == NULL) {
+            return FALSE;
+        }
+
+        Recheck = TRUE;
+    }
+
+    *RecheckMatches = Recheck;
+    return TRUE;
+}
+
+/**
+ Record the search strings that the filter chunks have been evaluated with.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreFilterRecordSearchStrings(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    UCHAR SearchCount;
+    UCHAR Index;
+
+    for (Index = 0; Index < MoreContext->FilterSearchCount; Index++) {
+        YoriLibFreeStringContents(&MoreContext->FilterSearchStrings[Index]);
+    }
+    MoreContext->FilterSearchCount = 0;
+    MoreContext->FilterResultsValid = FALSE;
+
+    SearchCount = MoreSearchCountActive(MoreContext);
+    for (Index = 0; Index < SearchCount; Index++) {
+        if (!YoriLibCopyString(&MoreContext->FilterSearchStrings[Index], &MoreContext->SearchStrings[Index])) {
+            break;
+        }
+        MoreContext->FilterSearchCount++;
+    }
+
+    if (MoreContext->FilterSearchCount == SearchCount) {
+        MoreContext->FilterResultsValid = TRUE;
+    }
+}
+
+/**
+ Evaluate the current search strings against every line described by the
+ filter chunks, using a worker thread for each chunk.  The caller must not
+ hold the physical line mutex, so that ingest can continue.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreFilterEvaluateChunks(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    YORILIB_WORK_QUEUE WorkQueue;
+    PMORE_FILTER_CHUNK Chunk;
+    YORI_ALLOC_SIZE_T Index;
+    BOOLEAN RecheckMatches;
+    BOOL QueueActive;
+
+    if (!MoreFilterResultsReusable(MoreContext, &RecheckMatches)) {
+        for (Index = 0; Index < MoreContext->FilterChunkCount; Index++) {
+            MoreContext->FilterChunks[Index]->LinesValid = 0;
+        }
+        RecheckMatches = FALSE;
+    }
+
+    QueueActive = YoriLibInitializeWorkQueue(&WorkQueue, 0, 0, MoreFilterChunkWorker, MoreContext);
+
+    for (Index = 0; Index < MoreContext->FilterChunkCount; Index++) {
+        Chunk = MoreContext->FilterChunks[Index];
+        if (!RecheckMatches && Chunk->LinesValid == Chunk->LineCount) {
+            continue;
+        }
+
+        Chunk->RecheckMatches = RecheckMatches;
+        if (!QueueActive || !YoriLibQueueWorkItem(&WorkQueue, &Chunk->WorkItem, TRUE)) {
+            MoreFilterChunkWorker(MoreContext, &Chunk->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+        }
+    }
+
+    YoriLibCleanupWorkQueue(&WorkQueue);
+
+    MoreFilterRecordSearchStrings(MoreContext);
+}
+
+/**
+ Look up whether a physical line matches the current filter from the results
+ recorded in the filter chunks.
+
+ @param MoreContext Pointer to the more context.
+
+ @param PhysicalLine Pointer to the physical line.
+
+ @param MatchFound On successful completion, set to TRUE if the line matches.
+
+ @return TRUE if the result is known, FALSE if the line needs to be examined.
+ */
+__success(return)
+BOOLEAN
+MoreFilterLookupMatch(
+    __in PMORE_CONTEXT MoreContext,
+    __in PMORE_PHYSICAL_LINE PhysicalLine,
+    __out PBOOLEAN MatchFound
+    )
+{
+    PMORE_FILTER_CHUNK Chunk;
+    DWORDLONG ChunkIndex;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (!MoreContext->FilterResultsValid) {
+        return FALSE;
+    }
+
+    ChunkIndex = (PhysicalLine->LineNumber - 1) / MORE_FILTER_CHUNK_LINES;
+    if (ChunkIndex >= MoreContext->FilterChunkCount) {
+        return FALSE;
+    }
+
+    Chunk = MoreContext->FilterChunks[(YORI_ALLOC_SIZE_T)ChunkIndex];
+    Index = (YORI_ALLOC_SIZE_T)((PhysicalLine->LineNumber - 1) % MORE_FILTER_CHUNK_LINES);
+    if (Index >= Chunk->LinesValid) {
+        return FALSE;
+    }
+
+    ASSERT(Index > 0 || Chunk->FirstLine == PhysicalLine);
+
+    if (Chunk->Matches[Index / 32] & (1 << (Index % 32))) {
+        *MatchFound = TRUE;
+    } else {
+        *MatchFound = FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ Free the filter chunks and recorded search strings.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreFilterCleanup(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    UCHAR SearchIndex;
+
+    for (Index = 0; Index < MoreContext->FilterChunkCount; Index++) {
+        YoriLibFree(MoreContext->FilterChunks[Index]);
+    }
+
+    if (MoreContext->FilterChunks != NULL) {
+        YoriLibFree(MoreContext->FilterChunks);
+        MoreContext->FilterChunks = NULL;
+    }
+
+    MoreContext->FilterChunkCount = 0;
+    MoreContext->FilterChunksAllocated = 0;
+    MoreContext->FilterLastLine = NULL;
+
+    for (SearchIndex = 0; SearchIndex < MoreContext->FilterSearchCount; SearchIndex++) {
+        YoriLibFreeStringContents(&MoreContext->FilterSearchStrings[SearchIndex]);
+    }
+    MoreContext->FilterSearchCount = 0;
+    MoreContext->FilterResultsValid = FALSE;
+}
+
+/**
+ Apply a new search criteria to update the set of filtered lines.  The
+ search strings are evaluated against lines in chunks on worker threads
+ without holding the physical line mutex, so ingest continues meanwhile.
+ The mutex is then held to update the filtered list from these results,
+ examining only the lines that arrived while the chunks were evaluated.
 
  MSFIX This routine wants to be much smarter.  Ideally it would initiate an
  asynchronous process that gets synchronized when next/previous lines are
@@ -422,6 +814,33 @@ MoreUpdateFilteredLines(
         PreviousStartLineNumber = PreviousStartPoint->LineNumber;
     }
 
+    //
+    //  A mapped file is filtered as lines are generated, so the new start
+    //  point is the first matching line at or after the previous one.
+    //
+
+    if (MoreContext->MappedFileActive) {
+        if (PreviousStartPoint == NULL) {
+            return MoreGetNextFilteredPhysicalLine(MoreContext, NULL);
+        }
+
+        if (!MoreContext->FilterToSearch ||
+            MoreFindNextSearchMatch(MoreContext, &PreviousStartPoint->LineContents, NULL, NULL)) {
+
+            return PreviousStartPoint;
+        }
+
+        return MoreGetNextFilteredPhysicalLine(MoreContext, PreviousStartPoint);
+    }
+
+    if (MoreContext->FilterToSearch) {
+        WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+        MoreFilterExtendChunks(MoreContext);
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+        MoreFilterEvaluateChunks(MoreContext);
+    }
+
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
 
     PreviousFilteredLine = NULL;
@@ -432,7 +851,9 @@ MoreUpdateFilteredLines(
 
         ThisLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
         if (MoreContext->FilterToSearch) {
-            MatchFound = MoreFindNextSearchMatch(MoreContext, &ThisLine->LineContents, NULL, NULL);
+            if (!MoreFilterLookupMatch(MoreContext, ThisLine, &MatchFound)) {
+                MatchFound = MoreFindNextSearchMatch(MoreContext, &ThisLine->LineContents, NULL, NULL);
+            }
         } else {
             MatchFound = TRUE;
         }
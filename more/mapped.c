@@ -0,0 +1,1174 @@
+/**
+ * @file more/mapped.c
+ *
+ * Yori shell more display large files through a mapping and line index
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "more.h"
+
+/**
+ The smallest file that is displayed through a mapping.  Smaller files are
+ copied into memory, which allows filtered line counts to be exact.
+ */
+#define MORE_MAPPED_FILE_MINIMUM_SIZE (64 * 1024 * 1024)
+
+/**
+ The number of bytes to map at a time.
+ */
+#define MORE_MAPPED_VIEW_SIZE (4 * 1024 * 1024)
+
+/**
+ The longest line, in bytes, that is displayed as a single physical line.
+ Longer lines are split at this length.  This ensures a line can always be
+ found within a single view.
+ */
+#define MORE_MAPPED_MAX_LINE (1024 * 1024)
+
+/**
+ The number of bytes beyond the end of a line which may be examined to
+ parse an escape sequence.  Escape sequences longer than this are not
+ interpreted as color changes.
+ */
+#define MORE_MAPPED_MAX_ESCAPE 32
+
+/**
+ The number of lines between entries in the line index.  Locating a line
+ requires scanning forward from the preceding index entry, so this trades
+ index size against the cost of moving backwards.
+ */
+#define MORE_MAPPED_INDEX_INTERVAL 256
+
+/**
+ The number of index entries to add between notifications to the viewport
+ that more lines are available.
+ */
+#define MORE_MAPPED_INDEX_ENTRIES_PER_NOTIFY 64
+
+/**
+ The number of materialized physical lines to retain.  Older lines are
+ released once this many newer lines have been materialized, unless they
+ are still displayed.
+ */
+#define MORE_MAPPED_LINE_CACHE_SIZE 4096
+
+/**
+ Return a pointer to a range of bytes within a mapped file, mapping a new
+ view if the range is not within the current one.  Any pointer previously
+ returned for the view may be invalidated.
+
+ @param MappedFile Pointer to the mapped file.
+
+ @param View Pointer to the view to use.  Each thread uses a separate view.
+
+ @param Offset The offset within the file of the first byte required.
+
+ @param Length The number of bytes required.  This must not extend beyond
+        the end of the file, and must be small enough to fit within a view
+        after rounding Offset down to the allocation granularity.
+
+ @return Pointer to the bytes, or NULL if a view could not be mapped.
+ */
+PUCHAR
+MoreMappedGetBytes(
+    __in PMORE_MAPPED_FILE MappedFile,
+    __inout PMORE_MAPPED_VIEW View,
+    __in DWORDLONG Offset,
+    __in DWORD Length
+    )
+{
+    LARGE_INTEGER ViewOffset;
+    DWORDLONG ViewLength;
+
+    ASSERT(Offset + Length <= MappedFile->FileSize);
+
+    if (View->Base != NULL &&
+        Offset >= View->Offset &&
+        Offset + Length <= View->Offset + View->Length) {
+
+        return View->Base + (DWORD)(Offset - View->Offset);
+    }
+
+    if (View->Base != NULL) {
+        UnmapViewOfFile(View->Base);
+        View->Base = NULL;
+    }
+
+    ViewOffset.QuadPart = Offset - (Offset % MappedFile->MapGranularity);
+    ViewLength = MappedFile->FileSize - ViewOffset.QuadPart;
+    if (ViewLength > MORE_MAPPED_VIEW_SIZE) {
+        ViewLength = MORE_MAPPED_VIEW_SIZE;
+    }
+
+    ASSERT(Offset + Length <= ViewOffset.QuadPart + ViewLength);
+
+    View->Base = MapViewOfFile(MappedFile->MappingHandle,
+                               FILE_MAP_READ,
+                               ViewOffset.HighPart,
+                               ViewOffset.LowPart,
+                               (SIZE_T)ViewLength);
+
+    if (View->Base == NULL) {
+        return NULL;
+    }
+
+    View->Offset = ViewOffset.QuadPart;
+    View->Length = (DWORD)ViewLength;
+
+    return View->Base + (DWORD)(Offset - View->Offset);
+}
+
+/**
+ Release a view of a mapped file.
+
+ @param View Pointer to the view.
+ */
+VOID
+MoreMappedReleaseView(
+    __inout PMORE_MAPPED_VIEW View
+    )
+{
+    if (View->Base != NULL) {
+        UnmapViewOfFile(View->Base);
+        View->Base = NULL;
+    }
+    View->Offset = 0;
+    View->Length = 0;
+}
+
+/**
+ Apply an escape sequence found in a mapped file to a color.  This follows
+ the same rules as ingesting a line into memory.
+
+ @param Buffer Pointer to the escape sequence, which starts with ESC and [.
+
+ @param BytesAvailable The number of bytes that can be examined.
+
+ @param Color The color before the escape sequence.
+
+ @return The color after the escape sequence.
+ */
+WORD
+MoreMappedApplyEscape(
+    __in_ecount(BytesAvailable) PUCHAR Buffer,
+    __in DWORD BytesAvailable,
+    __in WORD Color
+    )
+{
+    TCHAR SequenceBuffer[MORE_MAPPED_MAX_ESCAPE];
+    YORI_STRING Sequence;
+    DWORD Index;
+    DWORD CopyIndex;
+
+    for (Index = 2; Index < BytesAvailable && Index < MORE_MAPPED_MAX_ESCAPE; Index++) {
+        if ((Buffer[Index] < '0' || Buffer[Index] > '9') && Buffer[Index] != ';') {
+            break;
+        }
+    }
+
+    if (Index >= BytesAvailable || Index >= MORE_MAPPED_MAX_ESCAPE) {
+        return Color;
+    }
+
+    for (CopyIndex = 0; CopyIndex <= Index; CopyIndex++) {
+        SequenceBuffer[CopyIndex] = Buffer[CopyIndex];
+    }
+
+    YoriLibInitEmptyString(&Sequence);
+    Sequence.StartOfString = SequenceBuffer;
+    Sequence.LengthInChars = (YORI_ALLOC_SIZE_T)(Index + 1);
+    YoriLibVtFinalColorFromSequence(Color, &Sequence, &Color);
+    return Color;
+}
+
+/**
+ Find the end of a line within a mapped file.
+
+ @param Buffer Pointer to the first byte of the line.
+
+ @param LineLimit The maximum number of bytes in the line.  If no line
+        ending is found within this many bytes, the line ends here.
+
+ @param BytesAvailable The number of bytes that can be examined, which may
+        exceed LineLimit so that an escape sequence at the end of the line
+        can be parsed.
+
+ @param Color On input, the color at the start of the line.  On output,
+        updated to the color at the end of the line.
+
+ @return The number of bytes in the line, including any line ending.
+ */
+DWORD
+MoreMappedScanLine(
+    __in_ecount(BytesAvailable) PUCHAR Buffer,
+    __in DWORD LineLimit,
+    __in DWORD BytesAvailable,
+    __inout PWORD Color
+    )
+{
+    DWORD Index;
+
+    ASSERT(LineLimit <= BytesAvailable);
+
+    for (Index = 0; Index < LineLimit; Index++) {
+        if (Buffer[Index] == '\n') {
+            return Index + 1;
+        }
+
+        if (Buffer[Index] == 27 &&
+            Index + 2 < BytesAvailable &&
+            Buffer[Index + 1] == '[') {
+
+            *Color = MoreMappedApplyEscape(&Buffer[Index], BytesAvailable - Index, *Color);
+        }
+    }
+
+    return LineLimit;
+}
+
+/**
+ Determine the number of bytes that can be examined for a line starting at
+ a specified offset.
+
+ @param MappedFile Pointer to the mapped file.
+
+ @param Offset The offset of the start of the line.
+
+ @param LineLimit On completion, updated to the maximum number of bytes in
+        the line.
+
+ @return The number of bytes that can be examined, including any bytes
+         beyond LineLimit that may be needed to parse an escape sequence.
+ */
+DWORD
+MoreMappedBytesAvailable(
+    __in PMORE_MAPPED_FILE MappedFile,
+    __in DWORDLONG Offset,
+    __out PDWORD LineLimit
+    )
+{
+    DWORDLONG Remaining;
+
+    Remaining = MappedFile->FileSize - Offset;
+    if (Remaining > MORE_MAPPED_MAX_LINE) {
+        *LineLimit = MORE_MAPPED_MAX_LINE;
+    } else {
+        *LineLimit = (DWORD)Remaining;
+    }
+
+    if (Remaining > MORE_MAPPED_MAX_LINE + MORE_MAPPED_MAX_ESCAPE) {
+        return MORE_MAPPED_MAX_LINE + MORE_MAPPED_MAX_ESCAPE;
+    }
+
+    return (DWORD)Remaining;
+}
+
+/**
+ Attempt to open a file so that it is displayed through a mapping rather
+ than copying it into memory.  This is only done for large files whose
+ encoding can be parsed a byte at a time.
+
+ @param MoreContext Pointer to the more context.
+
+ @param FilePath Pointer to the file specification provided by the user.
+
+ @return TRUE if the file has been opened as a mapped file, FALSE if it
+         should be processed by copying into memory.
+ */
+__success(return)
+BOOLEAN
+MoreMappedOpen(
+    __inout PMORE_CONTEXT MoreContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    YORI_STRING FullPath;
+    SYSTEM_INFO SystemInfo;
+    LARGE_INTEGER FileSize;
+    UCHAR LeadingBytes[3];
+    DWORD BytesRead;
+    DWORD Encoding;
+    HANDLE FileHandle;
+    HANDLE MappingHandle;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    Encoding = YoriLibGetMultibyteInputEncoding();
+    if (Encoding == CP_UTF16) {
+        return FALSE;
+    }
+
+    GetSystemInfo(&SystemInfo);
+    if (SystemInfo.dwAllocationGranularity == 0 ||
+        SystemInfo.dwAllocationGranularity + MORE_MAPPED_MAX_LINE + MORE_MAPPED_MAX_ESCAPE > MORE_MAPPED_VIEW_SIZE) {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FullPath);
+    if (!YoriLibUserStringToSingleFilePath(FilePath, TRUE, &FullPath)) {
+        return FALSE;
+    }
+
+    FileHandle = CreateFile(FullPath.StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    YoriLibFreeStringContents(&FullPath);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    FileSize.LowPart = GetFileSize(FileHandle, (LPDWORD)&FileSize.HighPart);
+    if ((FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) ||
+        FileSize.QuadPart < MORE_MAPPED_FILE_MINIMUM_SIZE) {
+
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    //
+    //  UTF-16 files are handled by the line reader, which needs to see the
+    //  whole file.  A UTF-8 BOM is skipped.
+    //
+
+    if (!ReadFile(FileHandle, LeadingBytes, sizeof(LeadingBytes), &BytesRead, NULL) ||
+        BytesRead != sizeof(LeadingBytes) ||
+        (LeadingBytes[0] == 0xFF && LeadingBytes[1] == 0xFE)) {
+
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    MappingHandle = CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (MappingHandle == NULL) {
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    MappedFile->LineCache = YoriLibMalloc(MORE_MAPPED_LINE_CACHE_SIZE * sizeof(PMORE_PHYSICAL_LINE));
+    if (MappedFile->LineCache == NULL) {
+        CloseHandle(MappingHandle);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+    ZeroMemory(MappedFile->LineCache, MORE_MAPPED_LINE_CACHE_SIZE * sizeof(PMORE_PHYSICAL_LINE));
+    MappedFile->LineCacheNext = 0;
+
+    MappedFile->FileHandle = FileHandle;
+    MappedFile->MappingHandle = MappingHandle;
+    MappedFile->FileSize = FileSize.QuadPart;
+    MappedFile->MapGranularity = SystemInfo.dwAllocationGranularity;
+    MappedFile->DataOffset = 0;
+    if (Encoding == CP_UTF8 &&
+        LeadingBytes[0] == 0xEF &&
+        LeadingBytes[1] == 0xBB &&
+        LeadingBytes[2] == 0xBF) {
+
+        MappedFile->DataOffset = 3;
+    }
+
+    MappedFile->LineIndex = NULL;
+    MappedFile->LineIndexCount = 0;
+    MappedFile->LineIndexAllocated = 0;
+    MappedFile->IndexComplete = FALSE;
+    ZeroMemory(&MappedFile->ViewportView, sizeof(MORE_MAPPED_VIEW));
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+    MoreContext->MappedFileActive = TRUE;
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    return TRUE;
+}
+
+/**
+ Add an entry to the line index.  The caller is expected to hold the
+ physical line mutex.
+
+ @param MoreContext Pointer to the more context.
+
+ @param FileOffset The offset of the line being indexed.
+
+ @param InitialColor The color at the start of the line being indexed.
+
+ @return TRUE to indicate success, FALSE on allocation failure.
+ */
+BOOLEAN
+MoreMappedAddIndexEntry(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG FileOffset,
+    __in WORD InitialColor
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    PMORE_LINE_INDEX_ENTRY NewIndex;
+    YORI_ALLOC_SIZE_T NewAllocated;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    if (MappedFile->LineIndexCount >= MappedFile->LineIndexAllocated) {
+        NewAllocated = MappedFile->LineIndexAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 1024;
+        }
+
+        if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)NewAllocated * sizeof(MORE_LINE_INDEX_ENTRY))) {
+            return FALSE;
+        }
+
+        NewIndex = YoriLibMalloc(NewAllocated * sizeof(MORE_LINE_INDEX_ENTRY));
+        if (NewIndex == NULL) {
+            return FALSE;
+        }
+
+        if (MappedFile->LineIndex != NULL) {
+            memcpy(NewIndex, MappedFile->LineIndex, MappedFile->LineIndexCount * sizeof(MORE_LINE_INDEX_ENTRY));
+            YoriLibFree(MappedFile->LineIndex);
+        }
+
+        MappedFile->LineIndex = NewIndex;
+        MappedFile->LineIndexAllocated = NewAllocated;
+    }
+
+    MappedFile->LineIndex[MappedFile->LineIndexCount].FileOffset = FileOffset;
+    MappedFile->LineIndex[MappedFile->LineIndexCount].InitialColor = InitialColor;
+    MappedFile->LineIndexCount++;
+
+    return TRUE;
+}
+
+/**
+ Scan a mapped file to count its lines and record the offset of every
+ MORE_MAPPED_INDEX_INTERVAL'th line.  Lines are not copied; they are
+ generated from the file when they are displayed.  The viewport is notified
+ periodically so the beginning of the file can be displayed while the rest
+ is being scanned.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreMappedIndexFile(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    MORE_MAPPED_VIEW View;
+    DWORDLONG Offset;
+    DWORDLONG LinesFound;
+    PUCHAR Buffer;
+    DWORD BytesAvailable;
+    DWORD LineLimit;
+    DWORD EntriesSinceNotify;
+    WORD Color;
+
+    MappedFile = &MoreContext->MappedFile;
+    ZeroMemory(&View, sizeof(View));
+
+    Offset = MappedFile->DataOffset;
+    Color = MoreContext->InitialColor;
+    LinesFound = 0;
+    EntriesSinceNotify = 0;
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+    if (!MoreMappedAddIndexEntry(MoreContext, Offset, Color)) {
+        MoreContext->OutOfMemory = TRUE;
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
+        return;
+    }
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    while (Offset < MappedFile->FileSize) {
+        BytesAvailable = MoreMappedBytesAvailable(MappedFile, Offset, &LineLimit);
+        Buffer = MoreMappedGetBytes(MappedFile, &View, Offset, BytesAvailable);
+        if (Buffer == NULL) {
+            break;
+        }
+
+        Offset = Offset + MoreMappedScanLine(Buffer, LineLimit, BytesAvailable, &Color);
+        LinesFound++;
+
+        //
+        //  Lines are published along with the index entry that allows the
+        //  following lines to be found.
+        //
+
+        if ((LinesFound % MORE_MAPPED_INDEX_INTERVAL) == 0) {
+            WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+            if (!MoreMappedAddIndexEntry(MoreContext, Offset, Color)) {
+                MoreContext->OutOfMemory = TRUE;
+                ReleaseMutex(MoreContext->PhysicalLineMutex);
+                break;
+            }
+            MoreContext->LineCount = LinesFound;
+            MoreContext->FilteredLineCount = LinesFound;
+            ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+            EntriesSinceNotify++;
+            if (EntriesSinceNotify == 1 ||
+                EntriesSinceNotify >= MORE_MAPPED_INDEX_ENTRIES_PER_NOTIFY) {
+
+                SetEvent(MoreContext->PhysicalLineAvailableEvent);
+                if (EntriesSinceNotify > 1) {
+                    EntriesSinceNotify = 0;
+                }
+            }
+
+            if (WaitForSingleObject(MoreContext->ShutdownEvent, 0) == WAIT_OBJECT_0) {
+                break;
+            }
+        }
+    }
+
+    MoreMappedReleaseView(&View);
+
+    if (!MoreContext->OutOfMemory) {
+        WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+        MoreContext->LineCount = LinesFound;
+        MoreContext->FilteredLineCount = LinesFound;
+        if (Offset >= MappedFile->FileSize) {
+            MappedFile->IndexComplete = TRUE;
+        }
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
+    }
+
+    SetEvent(MoreContext->PhysicalLineAvailableEvent);
+}
+
+/**
+ Return TRUE if a physical line is currently displayed, meaning it must not
+ be released.
+
+ @param MoreContext Pointer to the more context.
+
+ @param PhysicalLine Pointer to the physical line to check.
+
+ @return TRUE if the line is displayed or being prepared for display.
+ */
+BOOLEAN
+MoreMappedIsLineInViewport(
+    __in PMORE_CONTEXT MoreContext,
+    __in PMORE_PHYSICAL_LINE PhysicalLine
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    for (Index = 0; Index < MoreContext->ViewportHeight; Index++) {
+        if (MoreContext->DisplayViewportLines[Index].PhysicalLine == PhysicalLine ||
+            MoreContext->StagingViewportLines[Index].PhysicalLine == PhysicalLine) {
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Retain a newly materialized physical line, releasing the oldest retained
+ line that is not displayed.  Logical lines which refer to the text of a
+ released line hold their own reference to it.
+
+ @param MoreContext Pointer to the more context.
+
+ @param PhysicalLine Pointer to the physical line to retain.
+ */
+VOID
+MoreMappedCacheLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in PMORE_PHYSICAL_LINE PhysicalLine
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    PMORE_PHYSICAL_LINE OldLine;
+    DWORD Attempts;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    for (Attempts = 0; Attempts < MORE_MAPPED_LINE_CACHE_SIZE; Attempts++) {
+        OldLine = MappedFile->LineCache[MappedFile->LineCacheNext];
+        if (OldLine == NULL || !MoreMappedIsLineInViewport(MoreContext, OldLine)) {
+            break;
+        }
+        MappedFile->LineCacheNext = (MappedFile->LineCacheNext + 1) % MORE_MAPPED_LINE_CACHE_SIZE;
+    }
+
+    OldLine = MappedFile->LineCache[MappedFile->LineCacheNext];
+    if (OldLine != NULL) {
+        YoriLibFreeStringContents(&OldLine->LineContents);
+        YoriLibDereference(OldLine->MemoryToFree);
+    }
+
+    MappedFile->LineCache[MappedFile->LineCacheNext] = PhysicalLine;
+    MappedFile->LineCacheNext = (MappedFile->LineCacheNext + 1) % MORE_MAPPED_LINE_CACHE_SIZE;
+}
+
+/**
+ Generate a physical line from the contents of a mapped file.  This
+ performs the same conversion as ingesting a line into memory.
+
+ @param MoreContext Pointer to the more context.
+
+ @param LineNumber The number of the line within the file, or zero if it is
+        not known.
+
+ @param FileOffset The offset of the start of the line.
+
+ @param InitialColor The color at the start of the line.
+
+ @return Pointer to the physical line, or NULL on failure.  The line remains
+         valid until MORE_MAPPED_LINE_CACHE_SIZE more lines have been
+         generated or, if it is displayed, until it is no longer displayed.
+ */
+PMORE_PHYSICAL_LINE
+MoreMappedMaterializeLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG LineNumber,
+    __in DWORDLONG FileOffset,
+    __in WORD InitialColor
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    PMORE_PHYSICAL_LINE NewLine;
+    PUCHAR Buffer;
+    DWORD BytesAvailable;
+    DWORD LineLimit;
+    DWORD ByteLength;
+    DWORD ContentLength;
+    YORI_ALLOC_SIZE_T CharCount;
+    YORI_ALLOC_SIZE_T TabCount;
+    YORI_ALLOC_SIZE_T CharIndex;
+    YORI_ALLOC_SIZE_T DestIndex;
+    YORI_ALLOC_SIZE_T TabIndex;
+    YORI_MAX_UNSIGNED_T BytesRequired;
+    WORD FinalColor;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    if (FileOffset >= MappedFile->FileSize) {
+        return NULL;
+    }
+
+    BytesAvailable = MoreMappedBytesAvailable(MappedFile, FileOffset, &LineLimit);
+    Buffer = MoreMappedGetBytes(MappedFile, &MappedFile->ViewportView, FileOffset, BytesAvailable);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    FinalColor = InitialColor;
+    ByteLength = MoreMappedScanLine(Buffer, LineLimit, BytesAvailable, &FinalColor);
+
+    ContentLength = ByteLength;
+    if (ContentLength > 0 && Buffer[ContentLength - 1] == '\n') {
+        ContentLength--;
+        if (ContentLength > 0 && Buffer[ContentLength - 1] == '\r') {
+            ContentLength--;
+        }
+    }
+
+    //
+    //  Tabs are single byte characters in every supported encoding, so they
+    //  can be counted before conversion.
+    //
+
+    TabCount = 0;
+    for (CharIndex = 0; CharIndex < ContentLength; CharIndex++) {
+        if (Buffer[CharIndex] == '\t') {
+            TabCount++;
+        }
+    }
+
+    CharCount = 0;
+    if (ContentLength > 0) {
+        CharCount = YoriLibGetMultibyteInputSizeNeeded((LPCSTR)Buffer, (YORI_ALLOC_SIZE_T)ContentLength);
+    }
+
+    BytesRequired = sizeof(MORE_PHYSICAL_LINE) + ((YORI_MAX_UNSIGNED_T)CharCount + TabCount * (MoreContext->TabWidth - 1) + 1) * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesRequired)) {
+        MoreContext->OutOfMemory = TRUE;
+        return NULL;
+    }
+
+    NewLine = YoriLibReferencedMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
+    if (NewLine == NULL) {
+        MoreContext->OutOfMemory = TRUE;
+        return NULL;
+    }
+
+    NewLine->LineList.Next = NULL;
+    NewLine->LineList.Prev = NULL;
+    NewLine->FilteredLineList.Next = NULL;
+    NewLine->FilteredLineList.Prev = NULL;
+    NewLine->MemoryToFree = NewLine;
+    NewLine->InitialColor = InitialColor;
+    NewLine->FinalColor = FinalColor;
+    NewLine->LineNumber = LineNumber;
+    NewLine->FilteredLineNumber = LineNumber;
+    NewLine->FileOffset = FileOffset;
+    NewLine->ByteLength = ByteLength;
+    YoriLibReference(NewLine);
+    YoriLibInitEmptyString(&NewLine->LineContents);
+    NewLine->LineContents.MemoryToFree = NewLine;
+    NewLine->LineContents.StartOfString = (LPTSTR)(NewLine + 1);
+
+    if (CharCount > 0) {
+        YoriLibMultibyteInput((LPCSTR)Buffer, (YORI_ALLOC_SIZE_T)ContentLength, NewLine->LineContents.StartOfString, CharCount);
+    }
+
+    //
+    //  Expand tabs in place, working backwards so that characters are not
+    //  overwritten before they are moved.
+    //
+
+    DestIndex = CharCount + TabCount * (MoreContext->TabWidth - 1);
+    NewLine->LineContents.StartOfString[DestIndex] = '\0';
+    NewLine->LineContents.LengthInChars = DestIndex;
+    NewLine->LineContents.LengthAllocated = DestIndex + 1;
+
+    if (TabCount > 0) {
+        for (CharIndex = CharCount; CharIndex > 0; CharIndex--) {
+            if (NewLine->LineContents.StartOfString[CharIndex - 1] == '\t') {
+                for (TabIndex = 0; TabIndex < MoreContext->TabWidth; TabIndex++) {
+                    DestIndex--;
+                    NewLine->LineContents.StartOfString[DestIndex] = ' ';
+                }
+            } else {
+                DestIndex--;
+                NewLine->LineContents.StartOfString[DestIndex] = NewLine->LineContents.StartOfString[CharIndex - 1];
+            }
+        }
+        ASSERT(DestIndex == 0);
+    }
+
+    MoreMappedCacheLine(MoreContext, NewLine);
+
+    return NewLine;
+}
+
+/**
+ Find the line containing a file offset by scanning forward from the
+ closest preceding index entry.  This is only possible once the index
+ extends beyond the offset.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Offset The offset of a byte within the line to find.
+
+ @param LineNumber On successful completion, updated to the number of the
+        line.
+
+ @param LineOffset On successful completion, updated to the offset of the
+        start of the line.
+
+ @param InitialColor On successful completion, updated to the color at the
+        start of the line.
+
+ @return TRUE if the line was found, FALSE if the index does not yet describe
+         the offset.
+ */
+__success(return)
+BOOLEAN
+MoreMappedFindLineFromIndex(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG Offset,
+    __out PDWORDLONG LineNumber,
+    __out PDWORDLONG LineOffset,
+    __out PWORD InitialColor
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    MORE_LINE_INDEX_ENTRY IndexEntry;
+    YORI_ALLOC_SIZE_T Lower;
+    YORI_ALLOC_SIZE_T Upper;
+    YORI_ALLOC_SIZE_T Midpoint;
+    DWORDLONG CurrentLine;
+    DWORDLONG CurrentOffset;
+    DWORDLONG NextOffset;
+    PUCHAR Buffer;
+    DWORD BytesAvailable;
+    DWORD LineLimit;
+    WORD Color;
+    WORD NextColor;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+    if (MappedFile->LineIndexCount == 0 ||
+        Offset < MappedFile->LineIndex[0].FileOffset ||
+        (!MappedFile->IndexComplete &&
+         Offset >= MappedFile->LineIndex[MappedFile->LineIndexCount - 1].FileOffset)) {
+
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
+        return FALSE;
+    }
+
+    //
+    //  Find the last index entry at or before the offset.
+    //
+
+    Lower = 0;
+    Upper = MappedFile->LineIndexCount;
+    while (Upper - Lower > 1) {
+        Midpoint = Lower + (Upper - Lower) / 2;
+        if (MappedFile->LineIndex[Midpoint].FileOffset <= Offset) {
+            Lower = Midpoint;
+        } else {
+            Upper = Midpoint;
+        }
+    }
+
+    memcpy(&IndexEntry, &MappedFile->LineIndex[Lower], sizeof(MORE_LINE_INDEX_ENTRY));
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    CurrentLine = (DWORDLONG)Lower * MORE_MAPPED_INDEX_INTERVAL + 1;
+    CurrentOffset = IndexEntry.FileOffset;
+    Color = IndexEntry.InitialColor;
+
+    while (TRUE) {
+        BytesAvailable = MoreMappedBytesAvailable(MappedFile, CurrentOffset, &LineLimit);
+        Buffer = MoreMappedGetBytes(MappedFile, &MappedFile->ViewportView, CurrentOffset, BytesAvailable);
+        if (Buffer == NULL) {
+            return FALSE;
+        }
+        NextColor = Color;
+        NextOffset = CurrentOffset + MoreMappedScanLine(Buffer, LineLimit, BytesAvailable, &NextColor);
+        if (NextOffset > Offset || NextOffset >= MappedFile->FileSize) {
+            break;
+        }
+        CurrentOffset = NextOffset;
+        Color = NextColor;
+        CurrentLine++;
+    }
+
+    *LineNumber = CurrentLine;
+    *LineOffset = CurrentOffset;
+    *InitialColor = Color;
+    return TRUE;
+}
+
+/**
+ Find the start of the line containing a file offset by scanning backwards
+ for the end of the preceding line.  This does not require the index, so it
+ can be used for regions of the file that have not been scanned yet.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Offset The offset of a byte within the line to find.
+
+ @param LineOffset On completion, updated to the offset of the start of the
+        line.
+
+ @return TRUE if the start of the line was found.  FALSE if no line ending
+         was found within MORE_MAPPED_MAX_LINE bytes, in which case
+         LineOffset refers to an arbitrary point within a long line.
+ */
+BOOLEAN
+MoreMappedFindLineStart(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG Offset,
+    __out PDWORDLONG LineOffset
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    DWORDLONG SearchStart;
+    PUCHAR Buffer;
+    DWORD Length;
+    DWORD Index;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    if (Offset - MappedFile->DataOffset > MORE_MAPPED_MAX_LINE) {
+        SearchStart = Offset - MORE_MAPPED_MAX_LINE;
+    } else {
+        SearchStart = MappedFile->DataOffset;
+    }
+
+    Length = (DWORD)(Offset - SearchStart);
+    if (Length == 0) {
+        *LineOffset = Offset;
+        return TRUE;
+    }
+
+    Buffer = MoreMappedGetBytes(MappedFile, &MappedFile->ViewportView, SearchStart, Length);
+    if (Buffer == NULL) {
+        *LineOffset = Offset;
+        return FALSE;
+    }
+
+    for (Index = Length; Index > 0; Index--) {
+        if (Buffer[Index - 1] == '\n') {
+            *LineOffset = SearchStart + Index;
+            return TRUE;
+        }
+    }
+
+    *LineOffset = SearchStart;
+    if (SearchStart == MappedFile->DataOffset) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Generate the line containing a file offset.  If the index describes the
+ offset the line number and color are exact.  Otherwise the line is found by
+ scanning backwards and the supplied line number and color are used.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Offset The offset of a byte within the line to generate.
+
+ @param LineNumber The number of the line if the index cannot be used, or
+        zero if it is not known.
+
+ @param InitialColor The color at the start of the line if the index cannot
+        be used.
+
+ @return Pointer to the line, or NULL on failure.
+ */
+PMORE_PHYSICAL_LINE
+MoreMappedLocateLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG Offset,
+    __in DWORDLONG LineNumber,
+    __in WORD InitialColor
+    )
+{
+    DWORDLONG IndexedLineNumber;
+    DWORDLONG LineOffset;
+    WORD IndexedColor;
+
+    if (MoreMappedFindLineFromIndex(MoreContext, Offset, &IndexedLineNumber, &LineOffset, &IndexedColor)) {
+        return MoreMappedMaterializeLine(MoreContext, IndexedLineNumber, LineOffset, IndexedColor);
+    }
+
+    if (!MoreMappedFindLineStart(MoreContext, Offset, &LineOffset)) {
+        LineNumber = 0;
+    } else if (LineOffset == MoreContext->MappedFile.DataOffset) {
+        LineNumber = 1;
+        InitialColor = MoreContext->InitialColor;
+    }
+
+    return MoreMappedMaterializeLine(MoreContext, LineNumber, LineOffset, InitialColor);
+}
+
+/**
+ Return the line in a mapped file containing a specified offset.  This does
+ not wait for the file to be indexed, so it allows any part of the file to
+ be displayed immediately.  If the line has not been indexed, its line
+ number is zero to indicate it is not yet known, and the color at the start
+ of the line is assumed to be the default color.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Offset The offset within the file.  This is capped to the range of
+        the file's data.
+
+ @return Pointer to the line, or NULL on failure or if the file contains no
+         data.
+ */
+PMORE_PHYSICAL_LINE
+MoreMappedGetLineAtOffset(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG Offset
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+
+    MappedFile = &MoreContext->MappedFile;
+
+    if (MappedFile->FileSize <= MappedFile->DataOffset) {
+        return NULL;
+    }
+
+    if (Offset < MappedFile->DataOffset) {
+        Offset = MappedFile->DataOffset;
+    } else if (Offset >= MappedFile->FileSize) {
+        Offset = MappedFile->FileSize - 1;
+    }
+
+    return MoreMappedLocateLine(MoreContext, Offset, 0, MoreContext->InitialColor);
+}
+
+/**
+ Attempt to determine the number of a line whose number was not known when
+ it was generated.  This succeeds once the index describes the line.
+
+ @param MoreContext Pointer to the more context.
+
+ @param PhysicalLine Pointer to the line.  If its number can be found, the
+        line is updated.
+ */
+VOID
+MoreMappedResolveLineNumber(
+    __inout PMORE_CONTEXT MoreContext,
+    __inout PMORE_PHYSICAL_LINE PhysicalLine
+    )
+{
+    DWORDLONG LineNumber;
+    DWORDLONG LineOffset;
+    WORD Color;
+
+    if (PhysicalLine->LineNumber != 0) {
+        return;
+    }
+
+    if (MoreMappedFindLineFromIndex(MoreContext, PhysicalLine->FileOffset, &LineNumber, &LineOffset, &Color) &&
+        LineOffset == PhysicalLine->FileOffset) {
+
+        PhysicalLine->LineNumber = LineNumber;
+        PhysicalLine->FilteredLineNumber = LineNumber;
+    }
+}
+
+/**
+ Return the next line in a mapped file.  Lines can be generated before the
+ index has reached them.
+
+ @param MoreContext Pointer to the more context.
+
+ @param PreviousLine Optionally points to the line preceding the line to
+        return.  If NULL, the first line is returned.
+
+ @return Pointer to the line, or NULL if there are no further lines.
+ */
+PMORE_PHYSICAL_LINE
+MoreMappedGetNextLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_PHYSICAL_LINE PreviousLine
+    )
+{
+    DWORDLONG LineNumber;
+
+    if (PreviousLine == NULL) {
+        return MoreMappedMaterializeLine(MoreContext, 1, MoreContext->MappedFile.DataOffset, MoreContext->InitialColor);
+    }
+
+    LineNumber = 0;
+    if (PreviousLine->LineNumber != 0) {
+        LineNumber = PreviousLine->LineNumber + 1;
+    }
+
+    return MoreMappedMaterializeLine(MoreContext,
+                                     LineNumber,
+                                     PreviousLine->FileOffset + PreviousLine->ByteLength,
+                                     PreviousLine->FinalColor);
+}
+
+/**
+ Return the previous line in a mapped file.  If the index describes the
+ line, it is located by scanning forward from the closest preceding index
+ entry.  Otherwise it is located by scanning backwards, and its color is
+ assumed to be the color at the start of the following line.
+
+ @param MoreContext Pointer to the more context.
+
+ @param NextLine Optionally points to the line following the line to
+        return.  If NULL, the final line in the file is returned.
+
+ @return Pointer to the line, or NULL if there is no previous line.
+ */
+PMORE_PHYSICAL_LINE
+MoreMappedGetPreviousLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_PHYSICAL_LINE NextLine
+    )
+{
+    DWORDLONG LineNumber;
+
+    if (NextLine == NULL) {
+        return MoreMappedGetLineAtOffset(MoreContext, MoreContext->MappedFile.FileSize);
+    }
+
+    if (NextLine->FileOffset <= MoreContext->MappedFile.DataOffset) {
+        return NULL;
+    }
+
+    LineNumber = 0;
+    if (NextLine->LineNumber > 1) {
+        LineNumber = NextLine->LineNumber - 1;
+    }
+
+    return MoreMappedLocateLine(MoreContext, NextLine->FileOffset - 1, LineNumber, NextLine->InitialColor);
+}
+
+/**
+ Release all state associated with a mapped file.  This is called once the
+ ingest thread has terminated and the viewport no longer refers to any
+ lines.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreMappedCleanup(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PMORE_MAPPED_FILE MappedFile;
+    PMORE_PHYSICAL_LINE PhysicalLine;
+    DWORD Index;
+
+    if (!MoreContext->MappedFileActive) {
+        return;
+    }
+
+    MappedFile = &MoreContext->MappedFile;
+
+    if (MappedFile->LineCache != NULL) {
+        for (Index = 0; Index < MORE_MAPPED_LINE_CACHE_SIZE; Index++) {
+            PhysicalLine = MappedFile->LineCache[Index];
+            if (PhysicalLine != NULL) {
+                YoriLibFreeStringContents(&PhysicalLine->LineContents);
+                YoriLibDereference(PhysicalLine->MemoryToFree);
+            }
+        }
+        YoriLibFree(MappedFile->LineCache);
+        MappedFile->LineCache = NULL;
+    }
+
+    MoreMappedReleaseView(&MappedFile->ViewportView);
+
+    if (MappedFile->LineIndex != NULL) {
+        YoriLibFree(MappedFile->LineIndex);
+        MappedFile->LineIndex = NULL;
+    }
+
+    if (MappedFile->MappingHandle != NULL) {
+        CloseHandle(MappedFile->MappingHandle);
+        MappedFile->MappingHandle = NULL;
+    }
+
+    if (MappedFile->FileHandle != NULL) {
+        CloseHandle(MappedFile->FileHandle);
+        MappedFile->FileHandle = NULL;
+    }
+
+    MoreContext->MappedFileActive = FALSE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -40,7 +40,10 @@ CHAR strMoreHelpText[] =
         "   -dd            Use the debug display\n"
         "   -f             Wait for more contents to be added to the file\n"
         "   -l             Display until Ctrl+Q, Scroll Lock, or pause\n"
-        "   -s             Process files from all subdirectories\n";
+        "   -s             Process files from all subdirectories\n"
+        "\n"
+        "Press 0 through 9 to move to that tenth of the input.  Large files are\n"
+        "displayed without waiting for earlier lines to be read.\n";
 
 /**
  Display usage text to the user.
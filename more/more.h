@@ -35,6 +35,12 @@
  */
 #define MORE_MAX_SEARCHES 10
 
+/**
+ The number of physical lines whose filter results are recorded in each
+ MORE_FILTER_CHUNK.  This must be a multiple of 32.
+ */
+#define MORE_FILTER_CHUNK_LINES 4096
+
 /**
  Data describing a physical line.  A physical line is a line of text from the
  data source, which may take more characters than fit on a viewport line.
@@ -64,9 +70,30 @@ typedef struct _MORE_PHYSICAL_LINE {
      */
     WORD InitialColor;
 
+    /**
+     The color attribute in effect at the end of the line.  This is only
+     populated for lines generated from a mapped file, where it is the
+     initial color of the following line.
+     */
+    WORD FinalColor;
+
+    /**
+     The number of bytes in the line within a mapped file, including any
+     line ending.  This is only populated for lines generated from a mapped
+     file.
+     */
+    DWORD ByteLength;
+
+    /**
+     The offset of the line within a mapped file.  This is only populated
+     for lines generated from a mapped file.
+     */
+    DWORDLONG FileOffset;
+
     /**
      The number of this physical line within the input stream.  The first
-     line is one.
+     line is one.  A line generated from a mapped file before its position
+     has been indexed has a line number of zero.
      */
     DWORDLONG LineNumber;
 
@@ -216,6 +243,163 @@ typedef struct _MORE_SEARCH_CONTEXT {
 
 } MORE_SEARCH_CONTEXT, *PMORE_SEARCH_CONTEXT;
 
+/**
+ The results of applying the search strings to a range of physical lines.
+ Chunks are evaluated on worker threads when the filter changes, and are
+ retained so that a later filter which can only match a subset of these
+ lines only needs to examine the lines that matched previously.
+ */
+typedef struct _MORE_FILTER_CHUNK {
+
+    /**
+     The work item used to evaluate this chunk on a worker thread.  The
+     chunk is owned by the more context, so the worker does not free it.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The first physical line described by this chunk.
+     */
+    PMORE_PHYSICAL_LINE FirstLine;
+
+    /**
+     The number of physical lines described by this chunk.  Only updated
+     by the viewport thread when it holds MORE_CONTEXT::PhysicalLineMutex .
+     */
+    YORI_ALLOC_SIZE_T LineCount;
+
+    /**
+     The number of lines, starting from FirstLine, whose bits in Matches
+     reflect MORE_CONTEXT::FilterSearchStrings .
+     */
+    YORI_ALLOC_SIZE_T LinesValid;
+
+    /**
+     If TRUE, the current evaluation only needs to examine lines within
+     LinesValid that previously matched.  If FALSE, every line within
+     LinesValid is already correct.  Lines beyond LinesValid are always
+     examined.
+     */
+    BOOLEAN RecheckMatches;
+
+    /**
+     A bitmap with one bit per line, set if the line matches.
+     */
+    DWORD Matches[MORE_FILTER_CHUNK_LINES / 32];
+} MORE_FILTER_CHUNK, *PMORE_FILTER_CHUNK;
+
+/**
+ An entry in the index of lines within a mapped file.  Entries are recorded
+ periodically so that any line can be found by scanning forward from the
+ closest preceding entry.
+ */
+typedef struct _MORE_LINE_INDEX_ENTRY {
+
+    /**
+     The offset of the line within the file.
+     */
+    DWORDLONG FileOffset;
+
+    /**
+     The color attribute in effect at the beginning of the line.
+     */
+    WORD InitialColor;
+} MORE_LINE_INDEX_ENTRY, *PMORE_LINE_INDEX_ENTRY;
+
+/**
+ A view of part of a mapped file.
+ */
+typedef struct _MORE_MAPPED_VIEW {
+
+    /**
+     Pointer to the mapped view, or NULL if no view is mapped.
+     */
+    PUCHAR Base;
+
+    /**
+     The offset within the file of the start of the view.
+     */
+    DWORDLONG Offset;
+
+    /**
+     The number of bytes in the view.
+     */
+    DWORD Length;
+} MORE_MAPPED_VIEW, *PMORE_MAPPED_VIEW;
+
+/**
+ State describing a large file which is displayed through a mapping.  Rather
+ than copying every line into memory, the ingest thread records an index of
+ line offsets and lines are generated from the file as they are displayed.
+ */
+typedef struct _MORE_MAPPED_FILE {
+
+    /**
+     A handle to the file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     A handle to the mapping of the file.
+     */
+    HANDLE MappingHandle;
+
+    /**
+     The size of the file, in bytes.
+     */
+    DWORDLONG FileSize;
+
+    /**
+     The offset of the first line, which is after any byte order mark.
+     */
+    DWORDLONG DataOffset;
+
+    /**
+     The granularity that views must be aligned to.
+     */
+    DWORD MapGranularity;
+
+    /**
+     The number of entries populated in LineIndex.  Synchronized with
+     MORE_CONTEXT::PhysicalLineMutex .
+     */
+    YORI_ALLOC_SIZE_T LineIndexCount;
+
+    /**
+     The number of entries allocated in LineIndex.
+     */
+    YORI_ALLOC_SIZE_T LineIndexAllocated;
+
+    /**
+     An array of index entries.  Synchronized with
+     MORE_CONTEXT::PhysicalLineMutex .
+     */
+    PMORE_LINE_INDEX_ENTRY LineIndex;
+
+    /**
+     TRUE once LineIndex describes the entire file.  Synchronized with
+     MORE_CONTEXT::PhysicalLineMutex .
+     */
+    BOOLEAN IndexComplete;
+
+    /**
+     The view used to generate lines for the viewport.  Only used by the
+     viewport thread.
+     */
+    MORE_MAPPED_VIEW ViewportView;
+
+    /**
+     An array of recently generated lines which are retained until they are
+     no longer needed.  Only used by the viewport thread.
+     */
+    PMORE_PHYSICAL_LINE *LineCache;
+
+    /**
+     The index within LineCache of the next line to replace.
+     */
+    DWORD LineCacheNext;
+} MORE_MAPPED_FILE, *PMORE_MAPPED_FILE;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -373,6 +557,43 @@ typedef struct _MORE_CONTEXT {
      */
     BOOLEAN FilterToSearch;
 
+    /**
+     TRUE if FilterSearchStrings describes the search strings which were
+     used to evaluate FilterChunks.
+     */
+    BOOLEAN FilterResultsValid;
+
+    /**
+     The number of strings in FilterSearchStrings.
+     */
+    UCHAR FilterSearchCount;
+
+    /**
+     Copies of the search strings which were used to evaluate FilterChunks.
+     */
+    YORI_STRING FilterSearchStrings[MORE_MAX_SEARCHES];
+
+    /**
+     An array of pointers to chunks recording filter results for physical
+     lines, in line order.  Only used by the viewport thread.
+     */
+    PMORE_FILTER_CHUNK *FilterChunks;
+
+    /**
+     The number of entries populated in FilterChunks.
+     */
+    YORI_ALLOC_SIZE_T FilterChunkCount;
+
+    /**
+     The number of entries allocated in FilterChunks.
+     */
+    YORI_ALLOC_SIZE_T FilterChunksAllocated;
+
+    /**
+     The final physical line described by FilterChunks.
+     */
+    PMORE_PHYSICAL_LINE FilterLastLine;
+
     /**
      TRUE if the display implies that text at the last cell in a line auto
      wraps to the next line.  This behavior is generally undesirable on NT,
@@ -424,6 +645,19 @@ typedef struct _MORE_CONTEXT {
      */
     BOOLEAN WaitForMore;
 
+    /**
+     TRUE if input is a single large file displayed through MappedFile.  In
+     this case PhysicalLineList is not used, and FilteredLineNumber and
+     FilteredLineCount refer to the position within the whole file.
+     */
+    BOOLEAN MappedFileActive;
+
+    /**
+     State describing a file displayed through a mapping, if
+     MappedFileActive is TRUE.
+     */
+    MORE_MAPPED_FILE MappedFile;
+
     /**
      Records the total number of files processed.
      */
@@ -485,6 +719,47 @@ MoreIngestThread(
     __in LPVOID Context
     );
 
+__success(return)
+BOOLEAN
+MoreMappedOpen(
+    __inout PMORE_CONTEXT MoreContext,
+    __in PYORI_STRING FilePath
+    );
+
+VOID
+MoreMappedIndexFile(
+    __inout PMORE_CONTEXT MoreContext
+    );
+
+PMORE_PHYSICAL_LINE
+MoreMappedGetNextLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_PHYSICAL_LINE PreviousLine
+    );
+
+PMORE_PHYSICAL_LINE
+MoreMappedGetPreviousLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_PHYSICAL_LINE NextLine
+    );
+
+PMORE_PHYSICAL_LINE
+MoreMappedGetLineAtOffset(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG Offset
+    );
+
+VOID
+MoreMappedResolveLineNumber(
+    __inout PMORE_CONTEXT MoreContext,
+    __inout PMORE_PHYSICAL_LINE PhysicalLine
+    );
+
+VOID
+MoreMappedCleanup(
+    __inout PMORE_CONTEXT MoreContext
+    );
+
 BOOL
 MoreViewportDisplay(
     __inout PMORE_CONTEXT MoreContext
@@ -566,6 +841,12 @@ MoreGetPreviousLogicalLines(
     __out PYORI_ALLOC_SIZE_T NumberLinesGenerated
     );
 
+PMORE_PHYSICAL_LINE
+MoreGetNextFilteredPhysicalLine(
+    __in PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_PHYSICAL_LINE PreviousLine
+    );
+
 __success(return != NULL)
 PMORE_PHYSICAL_LINE
 MoreFindNextLineWithSearchMatch(
@@ -592,4 +873,9 @@ MoreUpdateFilteredLines(
     __in_opt PMORE_PHYSICAL_LINE PreviousStartPoint
     );
 
+VOID
+MoreFilterCleanup(
+    __inout PMORE_CONTEXT MoreContext
+    );
+
 // vim:sw=4:ts=4:et:
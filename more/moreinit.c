@@ -274,6 +274,8 @@ MoreCleanupContext(
         MoreContext->IngestThread = NULL;
     }
 
+    MoreFilterCleanup(MoreContext);
+
     for (Index = 0; Index < MORE_MAX_SEARCHES; Index++) {
         YoriLibFreeStringContents(&MoreContext->SearchStrings[Index]);
         MoreContext->SearchContext[Index].ColorIndex = (UCHAR)-1;
@@ -321,6 +323,8 @@ MoreGracefulExit(
         ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, NULL);
     }
 
+    MoreMappedCleanup(MoreContext);
+
     MoreCleanupContext(MoreContext);
 }
 
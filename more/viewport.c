@@ -121,6 +121,11 @@ MoreDrawStatusLine(
     UCHAR SearchIndex;
     DWORD InvisibleChars;
     DWORD Percent;
+    BOOLEAN AtEnd;
+    TCHAR PositionBuffer[64];
+    PMORE_PHYSICAL_LINE FirstPhysicalLine;
+    PMORE_PHYSICAL_LINE LastPhysicalLine;
+    PMORE_MAPPED_FILE MappedFile;
 
     //
     //  If the screen isn't full, there's no point displaying status
@@ -142,13 +147,46 @@ MoreDrawStatusLine(
     //
 
     Percent = 0;
+    AtEnd = FALSE;
+    PositionBuffer[0] = '\0';
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
 
     TotalLines = MoreContext->LineCount;
     TotalFilteredLines = MoreContext->FilteredLineCount;
     MoreContext->TotalLinesInViewportStatus = TotalFilteredLines;
 
-    if (MoreContext->FilterToSearch) {
+    //
+    //  A mapped file may be displaying lines whose numbers were not known
+    //  when they were generated.  Try to find them now, and report progress
+    //  through the file by offset, which is always known.
+    //
+
+    if (MoreContext->MappedFileActive && MoreContext->LinesInViewport > 0) {
+        MappedFile = &MoreContext->MappedFile;
+        FirstPhysicalLine = MoreContext->DisplayViewportLines[0].PhysicalLine;
+        LastPhysicalLine = MoreContext->DisplayViewportLines[MoreContext->LinesInViewport - 1].PhysicalLine;
+        MoreMappedResolveLineNumber(MoreContext, FirstPhysicalLine);
+        MoreMappedResolveLineNumber(MoreContext, LastPhysicalLine);
+        FirstViewportLine = FirstPhysicalLine->LineNumber;
+        LastViewportLine = LastPhysicalLine->LineNumber;
+
+        if (LastPhysicalLine->FileOffset + LastPhysicalLine->ByteLength >= MappedFile->FileSize) {
+            AtEnd = TRUE;
+        }
+
+        Percent = 100;
+        if (MappedFile->FileSize > MappedFile->DataOffset) {
+            Percent = (DWORD)((LastPhysicalLine->FileOffset + LastPhysicalLine->ByteLength - MappedFile->DataOffset) * 100 / (MappedFile->FileSize - MappedFile->DataOffset));
+        }
+
+        if (FirstViewportLine == 0 || LastViewportLine == 0) {
+            YoriLibSPrintfS(PositionBuffer,
+                            sizeof(PositionBuffer)/sizeof(PositionBuffer[0]),
+                            _T("byte %lli of %lli"),
+                            FirstPhysicalLine->FileOffset,
+                            MappedFile->FileSize);
+        }
+    } else if (MoreContext->FilterToSearch) {
         if (MoreContext->LinesInViewport > 0) {
             FirstViewportLine = MoreContext->DisplayViewportLines[0].PhysicalLine->FilteredLineNumber;
             LastViewportLine = MoreContext->DisplayViewportLines[MoreContext->LinesInViewport - 1].PhysicalLine->FilteredLineNumber;
@@ -170,6 +208,15 @@ MoreDrawStatusLine(
 
     ReleaseMutex(MoreContext->PhysicalLineMutex);
 
+    if (PositionBuffer[0] == '\0') {
+        YoriLibSPrintfS(PositionBuffer,
+                        sizeof(PositionBuffer)/sizeof(PositionBuffer[0]),
+                        _T("%lli-%lli of %lli"),
+                        FirstViewportLine,
+                        LastViewportLine,
+                        TotalFilteredLines);
+    }
+
     ASSERT(MoreContext->LinesInPage <= MoreContext->LinesInViewport);
     if (MoreContext->LinesInViewport == MoreContext->LinesInPage) {
         PageFull = TRUE;
@@ -187,7 +234,13 @@ MoreDrawStatusLine(
         ThreadActive = TRUE;
     }
 
-    if (!ThreadActive && TotalFilteredLines == LastViewportLine) {
+    if (MoreContext->MappedFileActive) {
+        if (AtEnd) {
+            StringToDisplay = _T("End");
+        } else {
+            StringToDisplay = _T("More");
+        }
+    } else if (!ThreadActive && TotalFilteredLines == LastViewportLine) {
         StringToDisplay = _T("End");
     } else if (!PageFull) {
         StringToDisplay = _T("Awaiting data");
@@ -219,11 +272,9 @@ MoreDrawStatusLine(
         InvisibleChars = SearchColorString.LengthInChars;
 
         YoriLibYPrintf(&LineToDisplay,
-                      _T(" --- %s --- (%lli-%lli of %lli, %i%%)%s %ySearch: %y"),
+                      _T(" --- %s --- (%s, %i%%)%s %ySearch: %y"),
                       StringToDisplay,
-                      FirstViewportLine,
-                      LastViewportLine,
-                      TotalFilteredLines,
+                      PositionBuffer,
                       Percent,
                       (MoreContext->FilterToSearch?_T(" (filtered)"):_T("")),
                       &SearchColorString,
@@ -250,11 +301,9 @@ MoreDrawStatusLine(
 
         if (YoriLibAllocateString(&LineToDisplay, CharsNeeded)) {
             YoriLibYPrintf(&LineToDisplay,
-                          _T(" --- %s --- (%lli-%lli of %lli, %i%%)%s"),
+                          _T(" --- %s --- (%s, %i%%)%s"),
                           StringToDisplay,
-                          FirstViewportLine,
-                          LastViewportLine,
-                          TotalFilteredLines,
+                          PositionBuffer,
                           Percent,
                           (MoreContext->FilterToSearch?_T(" (filtered)"):_T("")));
 
@@ -1184,8 +1233,11 @@ MoreGenerateEntireViewportWithStartingLine(
     //
 
     if (Success && MoreContext->LinesInViewport > 0 && LinesReturned > 0) {
-        if (MoreContext->DisplayViewportLines[0].PhysicalLine ==
-            MoreContext->StagingViewportLines[0].PhysicalLine &&
+        if (MoreContext->DisplayViewportLines[0].PhysicalLine->LineNumber ==
+            MoreContext->StagingViewportLines[0].PhysicalLine->LineNumber &&
+
+            MoreContext->DisplayViewportLines[0].PhysicalLine->FileOffset ==
+            MoreContext->StagingViewportLines[0].PhysicalLine->FileOffset &&
 
             MoreContext->DisplayViewportLines[0].LogicalLineIndex ==
             MoreContext->StagingViewportLines[0].LogicalLineIndex) {
@@ -1289,6 +1341,63 @@ MoreMoveViewportToPreviousSearchMatch(
     }
 }
 
+/**
+ Move the viewport to a position expressed as a percentage of the input.
+ For a mapped file this is a percentage of the file's size, so the line is
+ found without waiting for the file to be indexed.  Otherwise it is a
+ percentage of the lines that have been ingested so far.
+
+ @param MoreContext Pointer to the context describing the data to display.
+
+ @param Percent The position to display, from zero to 100.
+ */
+VOID
+MoreMoveViewportToPercentage(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORD Percent
+    )
+{
+    PMORE_PHYSICAL_LINE TargetLine;
+    PMORE_MAPPED_FILE MappedFile;
+    DWORDLONG TargetLineNumber;
+    DWORDLONG Offset;
+
+    if (MoreContext->LinesInViewport == 0) {
+        return;
+    }
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+
+    if (MoreContext->MappedFileActive) {
+        MappedFile = &MoreContext->MappedFile;
+        Offset = MappedFile->DataOffset + (MappedFile->FileSize - MappedFile->DataOffset) * Percent / 100;
+        TargetLine = MoreMappedGetLineAtOffset(MoreContext, Offset);
+        if (TargetLine != NULL) {
+            TargetLine = MoreUpdateFilteredLines(MoreContext, TargetLine);
+        }
+    } else {
+        TargetLineNumber = MoreContext->FilteredLineCount * Percent / 100;
+        TargetLine = MoreGetNextFilteredPhysicalLine(MoreContext, NULL);
+        while (TargetLine != NULL && TargetLine->FilteredLineNumber < TargetLineNumber) {
+            TargetLine = MoreGetNextFilteredPhysicalLine(MoreContext, TargetLine);
+        }
+    }
+
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    if (TargetLine == NULL) {
+        return;
+    }
+
+    if (YoriLibIsSelectionActive(&MoreContext->Selection)) {
+        YoriLibClearSelection(&MoreContext->Selection);
+        YoriLibRedrawSelection(&MoreContext->Selection);
+    }
+
+    MoreContext->LinesInPage = 0;
+    MoreGenerateEntireViewportWithStartingLine(MoreContext, TargetLine);
+}
+
 /**
  Move the viewport left, if the buffer is wider than the window.
 
@@ -1657,8 +1766,6 @@ MoreAreMoreLinesAvailable(
 {
     DWORDLONG LastViewportLineNumber;
     DWORDLONG LastPhysicalLineNumber;
-    PYORI_LIST_ENTRY ListEntry;
-    PMORE_PHYSICAL_LINE LastPhysicalLine;
     PMORE_LOGICAL_LINE LastViewportLine;
 
     //
@@ -1683,6 +1790,18 @@ MoreAreMoreLinesAvailable(
         return TRUE;
     }
 
+    //
+    //  A mapped file can generate lines beyond those that have been
+    //  indexed, so the only limit is the end of the file.
+    //
+
+    if (MoreContext->MappedFileActive) {
+        if (LastViewportLine->PhysicalLine->FileOffset + LastViewportLine->PhysicalLine->ByteLength < MoreContext->MappedFile.FileSize) {
+            return TRUE;
+        }
+        return FALSE;
+    }
+
     // 
     //  If the end of the physical line has been reached, check for the
     //  existence of more physical lines.
@@ -1690,10 +1809,13 @@ MoreAreMoreLinesAvailable(
 
     LastViewportLineNumber = LastViewportLine->PhysicalLine->LineNumber;
 
+    //
+    //  Lines are numbered from one, so the number of the final line is the
+    //  number of lines.
+    //
+
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
-    ListEntry = YoriLibGetPreviousListEntry(&MoreContext->PhysicalLineList, NULL);
-    LastPhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
-    LastPhysicalLineNumber = LastPhysicalLine->LineNumber;
+    LastPhysicalLineNumber = MoreContext->LineCount;
     ReleaseMutex(MoreContext->PhysicalLineMutex);
 
     if (LastPhysicalLineNumber > LastViewportLineNumber) {
@@ -1997,6 +2119,8 @@ MoreProcessKeyDown(
                 MoreRefreshFilteredLinesDisplay(MoreContext);
             } else if (Char == '\r') {
                 MoreCopySelectionIfPresent(MoreContext);
+            } else if (Char >= '0' && Char <= '9') {
+                MoreMoveViewportToPercentage(MoreContext, (Char - '0') * 10);
             } else if (Char == '/') {
                 MoreContext->SearchUiActive = TRUE;
                 MoreContext->SearchDirty = TRUE;
@@ -35,10 +35,11 @@ CHAR strMoveHelpText[] =
         "\n"
         "Moves or renames one or more files.\n"
         "\n"
-        "MOVE [-license] [-b] [-k] [-p] <src>\n"
-        "MOVE [-license] [-b] [-k] [-p] <src> [<src> ...] <dest>\n"
+        "MOVE [-license] [-b] [-j n] [-k] [-p] <src>\n"
+        "MOVE [-license] [-b] [-j n] [-k] [-p] <src> [<src> ...] <dest>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -j             Move files between volumes on the specified number of threads\n"
         "   -p             Move with POSIX semantics\n"
         "   -k             Keep existing files, do not overwrite\n";
 
@@ -81,6 +82,25 @@ typedef struct _MOVE_CONTEXT {
      */
     DWORD FilesMoved;
 
+    /**
+     The number of files which were queued to a background thread and
+     subsequently failed to move.
+     */
+    volatile LONG FilesFailed;
+
+    /**
+     The number of threads to use when moving files between volumes.  Zero
+     means use one thread per processor, and one means move files on the
+     main thread.
+     */
+    DWORD ThreadCount;
+
+    /**
+     The queue of files to move between volumes on background threads.
+     This is only used if ThreadCount is not one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
     /**
      TRUE if existing files should be replaced, FALSE if they should be kept.
      */
@@ -94,6 +114,477 @@ typedef struct _MOVE_CONTEXT {
 
 } MOVE_CONTEXT, *PMOVE_CONTEXT;
 
+/**
+ A single file to be moved between volumes on a background thread.
+ */
+typedef struct _MOVE_WORK_ITEM {
+
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     Fully qualified path to the source file.
+     */
+    YORI_STRING SourceFile;
+
+    /**
+     Fully qualified path to the destination file.
+     */
+    YORI_STRING DestFile;
+} MOVE_WORK_ITEM, *PMOVE_WORK_ITEM;
+
+/**
+ A source directory whose contents are being moved to another volume.  The
+ directory is removed once all of its contents have been moved.
+ */
+typedef struct _MOVE_SOURCE_DIRECTORY {
+
+    /**
+     The list of source directories.  Directories are inserted at the head,
+     so a parent is always later in the list than its children.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     Fully qualified path to the source directory.  The string buffer
+     follows this structure.
+     */
+    YORI_STRING Path;
+} MOVE_SOURCE_DIRECTORY, *PMOVE_SOURCE_DIRECTORY;
+
+/**
+ Context used when moving the contents of a directory tree between volumes.
+ */
+typedef struct _MOVE_TREE_CONTEXT {
+
+    /**
+     Pointer to the context for the move operation.
+     */
+    PMOVE_CONTEXT MoveContext;
+
+    /**
+     Fully qualified path to the source directory being moved.
+     */
+    PYORI_STRING SourceRoot;
+
+    /**
+     Fully qualified path to the destination directory.
+     */
+    PYORI_STRING DestRoot;
+
+    /**
+     A list of MOVE_SOURCE_DIRECTORY entries to remove once the files within
+     them have been moved.
+     */
+    YORI_LIST_ENTRY SourceDirectories;
+} MOVE_TREE_CONTEXT, *PMOVE_TREE_CONTEXT;
+
+/**
+ A callback that is invoked when a directory cannot be successfully enumerated.
+
+ @param FilePath Pointer to the file path that could not be enumerated.
+
+ @param ErrorCode The Win32 error code describing the failure.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Ignored.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+MoveFileEnumerateErrorCallback(
+    __in PYORI_STRING FilePath,
+    __in DWORD ErrorCode,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    YORI_STRING UnescapedFilePath;
+    BOOL Result = FALSE;
+
+    UNREFERENCED_PARAMETER(Depth);
+    UNREFERENCED_PARAMETER(Context);
+
+    YoriLibInitEmptyString(&UnescapedFilePath);
+    if (!YoriLibUnescapePath(FilePath, &UnescapedFilePath)) {
+        UnescapedFilePath.StartOfString = FilePath->StartOfString;
+        UnescapedFilePath.LengthInChars = FilePath->LengthInChars;
+    }
+
+    if (ErrorCode == ERROR_FILE_NOT_FOUND || ErrorCode == ERROR_PATH_NOT_FOUND) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File or directory not found: %y\n"), &UnescapedFilePath);
+        Result = TRUE;
+    } else {
+        LPTSTR ErrText = YoriLibGetWinErrorText(ErrorCode);
+        YORI_STRING DirName;
+        LPTSTR FilePart;
+        YoriLibInitEmptyString(&DirName);
+        DirName.StartOfString = UnescapedFilePath.StartOfString;
+        FilePart = YoriLibFindRightMostCharacter(&UnescapedFilePath, '\\');
+        if (FilePart != NULL) {
+            DirName.LengthInChars = (YORI_ALLOC_SIZE_T)(FilePart - DirName.StartOfString);
+        } else {
+            DirName.LengthInChars = UnescapedFilePath.LengthInChars;
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Enumerate of %y failed: %s"), &DirName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    }
+    YoriLibFreeStringContents(&UnescapedFilePath);
+    return Result;
+}
+
+/**
+ Display an error from moving a file.
+
+ @param LastError The Win32 error code describing the failure.
+ */
+VOID
+MoveReportError(
+    __in DWORD LastError
+    )
+{
+    LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("MoveFile failed: %s"), ErrText);
+    YoriLibFreeWinErrorText(ErrText);
+}
+
+/**
+ Move a single file on a background thread.  Since the source and target are
+ on different volumes, this copies the data and deletes the source.
+
+ @param Context Pointer to the move context.
+
+ @param Item Pointer to the work item within the move work item.  The move
+        work item is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be moved.
+ */
+VOID
+MoveWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PMOVE_CONTEXT MoveContext = (PMOVE_CONTEXT)Context;
+    PMOVE_WORK_ITEM MoveItem;
+    DWORD LastError;
+
+    MoveItem = CONTAINING_RECORD(Item, MOVE_WORK_ITEM, WorkItem);
+
+    if (Cancelled) {
+        InterlockedIncrement(&MoveContext->FilesFailed);
+    } else {
+        LastError = YoriLibMoveFile(&MoveItem->SourceFile, &MoveItem->DestFile, MoveContext->ReplaceExisting, MoveContext->PosixSemantics);
+        if (LastError != ERROR_SUCCESS) {
+            MoveReportError(LastError);
+            InterlockedIncrement(&MoveContext->FilesFailed);
+        }
+    }
+
+    YoriLibFreeStringContents(&MoveItem->SourceFile);
+    YoriLibFreeStringContents(&MoveItem->DestFile);
+    YoriLibFree(MoveItem);
+}
+
+/**
+ Move a file to a different volume.  If background threads are in use the
+ file is queued, otherwise it is moved synchronously.
+
+ @param MoveContext Pointer to the move context.
+
+ @param SourceFile Pointer to the fully qualified source file name.
+
+ @param DestFile Pointer to the fully qualified destination file name.
+
+ @return TRUE if the file was moved or queued, FALSE if it could not be
+         moved.
+ */
+BOOL
+MoveFileAcrossVolumes(
+    __in PMOVE_CONTEXT MoveContext,
+    __in PYORI_STRING SourceFile,
+    __in PYORI_STRING DestFile
+    )
+{
+    PMOVE_WORK_ITEM MoveItem;
+    DWORD LastError;
+
+    if (MoveContext->ThreadCount != 1) {
+        MoveItem = YoriLibMalloc(sizeof(MOVE_WORK_ITEM));
+        if (MoveItem != NULL) {
+            ZeroMemory(MoveItem, sizeof(MOVE_WORK_ITEM));
+
+            //
+            //  The source name is a buffer owned by the enumerator which will
+            //  be reused for the next file, so it needs to be copied.  The
+            //  destination was allocated for this file, so it can be
+            //  referenced.
+            //
+
+            if (YoriLibCopyString(&MoveItem->SourceFile, SourceFile)) {
+                YoriLibCloneString(&MoveItem->DestFile, DestFile);
+                if (YoriLibQueueWorkItem(&MoveContext->WorkQueue, &MoveItem->WorkItem, TRUE)) {
+                    return TRUE;
+                }
+                YoriLibFreeStringContents(&MoveItem->SourceFile);
+                YoriLibFreeStringContents(&MoveItem->DestFile);
+            }
+            YoriLibFree(MoveItem);
+        }
+
+        if (MoveContext->WorkQueue.Cancelled) {
+            return FALSE;
+        }
+    }
+
+    LastError = YoriLibMoveFile(SourceFile, DestFile, MoveContext->ReplaceExisting, MoveContext->PosixSemantics);
+    if (LastError != ERROR_SUCCESS) {
+        MoveReportError(LastError);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Record a source directory which should be removed once its contents have
+ been moved.
+
+ @param TreeContext Pointer to the context for the directory tree being
+        moved.
+
+ @param DirPath Pointer to the fully qualified source directory.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+MoveRecordSourceDirectory(
+    __in PMOVE_TREE_CONTEXT TreeContext,
+    __in PYORI_STRING DirPath
+    )
+{
+    PMOVE_SOURCE_DIRECTORY SourceDir;
+
+    SourceDir = YoriLibMalloc(sizeof(MOVE_SOURCE_DIRECTORY) + (DirPath->LengthInChars + 1) * sizeof(TCHAR));
+    if (SourceDir == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&SourceDir->Path);
+    SourceDir->Path.StartOfString = (LPTSTR)(SourceDir + 1);
+    SourceDir->Path.LengthInChars = DirPath->LengthInChars;
+    SourceDir->Path.LengthAllocated = DirPath->LengthInChars + 1;
+    memcpy(SourceDir->Path.StartOfString, DirPath->StartOfString, DirPath->LengthInChars * sizeof(TCHAR));
+    SourceDir->Path.StartOfString[DirPath->LengthInChars] = '\0';
+
+    YoriLibInsertList(&TreeContext->SourceDirectories, &SourceDir->ListEntry);
+    return TRUE;
+}
+
+/**
+ A callback that is invoked for each object within a directory tree that is
+ being moved to a different volume.  Directories are created on this thread
+ so they exist before any files within them are moved; files are moved by
+ the work queue.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies the recursion depth.  Ignored in this application.
+
+ @param Context Pointer to the tree context.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+MoveTreeFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PMOVE_TREE_CONTEXT TreeContext = (PMOVE_TREE_CONTEXT)Context;
+    YORI_STRING RelativePath;
+    YORI_STRING DestPath;
+    DWORD LastError;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    if (FilePath->LengthInChars <= TreeContext->SourceRoot->LengthInChars + 1 ||
+        YoriLibCompareStringInsensitiveCount(FilePath, TreeContext->SourceRoot, TreeContext->SourceRoot->LengthInChars) != 0 ||
+        !YoriLibIsSep(FilePath->StartOfString[TreeContext->SourceRoot->LengthInChars])) {
+
+        return TRUE;
+    }
+
+    YoriLibInitEmptyString(&RelativePath);
+    RelativePath.StartOfString = &FilePath->StartOfString[TreeContext->SourceRoot->LengthInChars + 1];
+    RelativePath.LengthInChars = FilePath->LengthInChars - TreeContext->SourceRoot->LengthInChars - 1;
+
+    if (!YoriLibAllocateString(&DestPath, TreeContext->DestRoot->LengthInChars + 1 + RelativePath.LengthInChars + 1)) {
+        return FALSE;
+    }
+    DestPath.LengthInChars = YoriLibSPrintf(DestPath.StartOfString, _T("%y\\%y"), TreeContext->DestRoot, &RelativePath);
+
+    if (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+
+        //
+        //  Links are not traversed, and recreating one on another volume
+        //  is not a move, so leave it behind.  This also leaves its parent
+        //  in place since that cannot be removed while it is not empty.
+        //
+
+        if (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Cannot move link between volumes: %y\n"), FilePath);
+        } else if (!CreateDirectory(DestPath.StartOfString, NULL) &&
+                   GetLastError() != ERROR_ALREADY_EXISTS) {
+            LastError = GetLastError();
+            MoveReportError(LastError);
+        } else {
+            MoveRecordSourceDirectory(TreeContext, FilePath);
+        }
+    } else if (!MoveFileAcrossVolumes(TreeContext->MoveContext, FilePath, &DestPath)) {
+        if (TreeContext->MoveContext->WorkQueue.Cancelled) {
+            YoriLibFreeStringContents(&DestPath);
+            return FALSE;
+        }
+    }
+
+    YoriLibFreeStringContents(&DestPath);
+    return TRUE;
+}
+
+/**
+ Move a directory tree to a different volume.  A single rename is not
+ possible, so the directory structure is created at the destination, the
+ files are moved by the work queue, and the source directories are removed
+ from the deepest upwards once all of the files have been moved.
+
+ @param MoveContext Pointer to the move context.
+
+ @param SourceDir Pointer to the fully qualified source directory.
+
+ @param DestDir Pointer to the fully qualified destination directory.
+
+ @return TRUE if the directory was created and its contents were
+         enumerated, FALSE if it could not be moved.  Failures to move
+         individual files are reported as they occur.
+ */
+BOOL
+MoveDirectoryAcrossVolumes(
+    __in PMOVE_CONTEXT MoveContext,
+    __in PYORI_STRING SourceDir,
+    __in PYORI_STRING DestDir
+    )
+{
+    MOVE_TREE_CONTEXT TreeContext;
+    PYORI_LIST_ENTRY ListEntry;
+    PMOVE_SOURCE_DIRECTORY SourceDirEntry;
+    DWORD MatchFlags;
+
+    if (!CreateDirectory(DestDir->StartOfString, NULL)) {
+        MoveReportError(GetLastError());
+        return FALSE;
+    }
+
+    TreeContext.MoveContext = MoveContext;
+    TreeContext.SourceRoot = SourceDir;
+    TreeContext.DestRoot = DestDir;
+    YoriLibInitializeListHead(&TreeContext.SourceDirectories);
+
+    if (!MoveRecordSourceDirectory(&TreeContext, SourceDir)) {
+        return FALSE;
+    }
+
+    //
+    //  Directories are returned before their contents so they can be
+    //  created before any file within them is queued.
+    //
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
+                 YORILIB_FILEENUM_RETURN_DIRECTORIES |
+                 YORILIB_FILEENUM_DIRECTORY_CONTENTS |
+                 YORILIB_FILEENUM_RECURSE_AFTER_RETURN |
+                 YORILIB_FILEENUM_NO_LINK_TRAVERSE |
+                 YORILIB_FILEENUM_BASIC_EXPANSION;
+
+    YoriLibForEachFile(SourceDir,
+                       MatchFlags,
+                       0,
+                       MoveTreeFoundCallback,
+                       MoveFileEnumerateErrorCallback,
+                       &TreeContext);
+
+    //
+    //  All files need to be gone before their directories can be removed.
+    //  Any directory that still contains a file which failed to move is
+    //  left in place, along with its parents.
+    //
+
+    if (MoveContext->ThreadCount != 1) {
+        YoriLibWaitForWorkQueue(&MoveContext->WorkQueue);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&TreeContext.SourceDirectories, NULL);
+    while (ListEntry != NULL) {
+        SourceDirEntry = CONTAINING_RECORD(ListEntry, MOVE_SOURCE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&TreeContext.SourceDirectories, ListEntry);
+        YoriLibRemoveListItem(&SourceDirEntry->ListEntry);
+        if (!MoveContext->WorkQueue.Cancelled) {
+            RemoveDirectory(SourceDirEntry->Path.StartOfString);
+        }
+        YoriLibFree(SourceDirEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Determine if a move needs to cross volumes, which means it cannot be
+ performed as a rename.
+
+ @param SourcePath Pointer to the fully qualified source path.
+
+ @param DestPath Pointer to the fully qualified destination path.
+
+ @return TRUE if the source and destination are known to be on different
+         volumes, FALSE if they are on the same volume or this could not be
+         determined.
+ */
+BOOL
+MoveIsAcrossVolumes(
+    __in PYORI_STRING SourcePath,
+    __in PYORI_STRING DestPath
+    )
+{
+    YORI_STRING SourceVolume;
+    YORI_STRING DestVolume;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&SourceVolume);
+    YoriLibInitEmptyString(&DestVolume);
+
+    Result = FALSE;
+    if (YoriLibGetVolumePathName(SourcePath, &SourceVolume) &&
+        YoriLibGetVolumePathName(DestPath, &DestVolume)) {
+
+        if (YoriLibCompareStringInsensitive(&SourceVolume, &DestVolume) != 0) {
+            Result = TRUE;
+        }
+    }
+
+    YoriLibFreeStringContents(&SourceVolume);
+    YoriLibFreeStringContents(&DestVolume);
+    return Result;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -176,74 +667,34 @@ MoveFileFoundCallback(
         }
     }
 
-    LastError = YoriLibMoveFile(FilePath, &FullDest, MoveContext->ReplaceExisting, MoveContext->PosixSemantics);
-    if (LastError != ERROR_SUCCESS) {
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("MoveFile failed: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-    } else {
-        MoveContext->FilesMoved++;
-    }
-
-    YoriLibDereference(FullDest.StartOfString);
-    return TRUE;
-}
-
-/**
- A callback that is invoked when a directory cannot be successfully enumerated.
-
- @param FilePath Pointer to the file path that could not be enumerated.
-
- @param ErrorCode The Win32 error code describing the failure.
-
- @param Depth Recursion depth, ignored in this application.
-
- @param Context Ignored.
-
- @return TRUE to continute enumerating, FALSE to abort.
- */
-BOOL
-MoveFileEnumerateErrorCallback(
-    __in PYORI_STRING FilePath,
-    __in DWORD ErrorCode,
-    __in DWORD Depth,
-    __in PVOID Context
-    )
-{
-    YORI_STRING UnescapedFilePath;
-    BOOL Result = FALSE;
-
-    UNREFERENCED_PARAMETER(Depth);
-    UNREFERENCED_PARAMETER(Context);
-
-    YoriLibInitEmptyString(&UnescapedFilePath);
-    if (!YoriLibUnescapePath(FilePath, &UnescapedFilePath)) {
-        UnescapedFilePath.StartOfString = FilePath->StartOfString;
-        UnescapedFilePath.LengthInChars = FilePath->LengthInChars;
-    }
+    //
+    //  A move within a volume is a rename, including for a directory and
+    //  everything beneath it.  Between volumes, files are copied and
+    //  deleted on the work queue, and directories are moved as a tree of
+    //  files.
+    //
 
-    if (ErrorCode == ERROR_FILE_NOT_FOUND || ErrorCode == ERROR_PATH_NOT_FOUND) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File or directory not found: %y\n"), &UnescapedFilePath);
-        Result = TRUE;
+    if (MoveIsAcrossVolumes(FilePath, &FullDest)) {
+        if (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY &&
+            (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) {
+            if (MoveDirectoryAcrossVolumes(MoveContext, FilePath, &FullDest)) {
+                MoveContext->FilesMoved++;
+            }
+        } else if (MoveFileAcrossVolumes(MoveContext, FilePath, &FullDest)) {
+            MoveContext->FilesMoved++;
+        }
     } else {
-        LPTSTR ErrText = YoriLibGetWinErrorText(ErrorCode);
-        YORI_STRING DirName;
-        LPTSTR FilePart;
-        YoriLibInitEmptyString(&DirName);
-        DirName.StartOfString = UnescapedFilePath.StartOfString;
-        FilePart = YoriLibFindRightMostCharacter(&UnescapedFilePath, '\\');
-        if (FilePart != NULL) {
-            DirName.LengthInChars = (YORI_ALLOC_SIZE_T)(FilePart - DirName.StartOfString);
+        LastError = YoriLibMoveFile(FilePath, &FullDest, MoveContext->ReplaceExisting, MoveContext->PosixSemantics);
+        if (LastError != ERROR_SUCCESS) {
+            MoveReportError(LastError);
         } else {
-            DirName.LengthInChars = UnescapedFilePath.LengthInChars;
+            MoveContext->FilesMoved++;
         }
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Enumerate of %y failed: %s"), &DirName, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
     }
-    YoriLibFreeStringContents(&UnescapedFilePath);
-    return Result;
-}
 
+    YoriLibDereference(FullDest.StartOfString);
+    return TRUE;
+}
 
 #ifdef YORI_BUILTIN
 /**
@@ -282,12 +733,15 @@ ENTRYPOINT(
     BOOLEAN AllocatedDest;
     BOOLEAN BasicEnumeration;
     YORI_STRING Arg;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     FileCount = 0;
     AllocatedDest = FALSE;
     BasicEnumeration = FALSE;
     MoveContext.ReplaceExisting = TRUE;
     MoveContext.PosixSemantics = FALSE;
+    MoveContext.ThreadCount = 0;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -305,6 +759,14 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        MoveContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("k")) == 0) {
                 MoveContext.ReplaceExisting = FALSE;
                 ArgumentUnderstood = TRUE;
@@ -346,8 +808,23 @@ ENTRYPOINT(
         MoveContext.DestAttributes = 0;
     }
     MoveContext.FilesMoved = 0;
+    MoveContext.FilesFailed = 0;
     FilesProcessed = 0;
 
+    //
+    //  Threads are only created when files are queued, which only happens
+    //  when moving between volumes.
+    //
+
+    if (MoveContext.ThreadCount != 1) {
+        if (!YoriLibInitializeWorkQueue(&MoveContext.WorkQueue, (YORI_ALLOC_SIZE_T)MoveContext.ThreadCount, 0, MoveWorkItem, &MoveContext)) {
+            if (AllocatedDest) {
+                YoriLibFreeStringContents(&MoveContext.Dest);
+            }
+            return EXIT_FAILURE;
+        }
+    }
+
     YoriLibLoadAdvApi32Functions();
 
     for (i = 1; i < ArgC; i++) {
@@ -369,11 +846,16 @@ ENTRYPOINT(
         }
     }
 
+    if (MoveContext.ThreadCount != 1) {
+        YoriLibWaitForWorkQueue(&MoveContext.WorkQueue);
+        YoriLibCleanupWorkQueue(&MoveContext.WorkQueue);
+    }
+
     if (AllocatedDest) {
         YoriLibFreeStringContents(&MoveContext.Dest);
     }
 
-    if (MoveContext.FilesMoved == 0) {
+    if (MoveContext.FilesMoved <= (DWORD)MoveContext.FilesFailed) {
         return EXIT_FAILURE;
     }
 
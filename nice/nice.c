@@ -38,7 +38,14 @@ CHAR strNiceHelpText[] =
         "\n"
         "Runs a child program at low priority.\n"
         "\n"
-        "NICE [-license] <command>\n";
+        "NICE [-license] [-a <mask>] [-c <percent>] [-n <node>] <command>\n"
+        "\n"
+        "   -a             Only run the command on processors in the mask\n"
+        "   -c             Limit the command to a percentage of processor time\n"
+        "   -n             Only run the command on processors in the NUMA node\n"
+        "\n"
+        "Limits apply to the command and any processes it launches.  When limits\n"
+        "are specified, the command must be an external program.\n";
 
 /**
  Display usage text to the user.
@@ -54,6 +61,178 @@ NiceHelp(VOID)
     return TRUE;
 }
 
+/**
+ Limits to apply to the child process tree.
+ */
+typedef struct _NICE_CONTEXT {
+
+    /**
+     If nonzero, the set of processors that the child process tree may
+     execute on.
+     */
+    DWORD_PTR Affinity;
+
+    /**
+     If nonzero, the maximum processor time that the child process tree may
+     consume, in hundredths of a percent.
+     */
+    DWORD CpuRate;
+
+} NICE_CONTEXT, *PNICE_CONTEXT;
+
+/**
+ Launch a program within a job object at low priority, apply any requested
+ limits to the job, and wait for the program to complete.
+
+ @param NiceContext Pointer to the limits to apply.
+
+ @param ArgC The number of arguments describing the program to execute.
+
+ @param ArgV An array of arguments describing the program to execute.
+
+ @param ExitCode On successful completion, updated to contain the exit code
+        of the program.
+
+ @return TRUE to indicate the program was executed, FALSE if it was not.
+ */
+__success(return)
+BOOL
+NiceExecuteInJob(
+    __in PNICE_CONTEXT NiceContext,
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[],
+    __out PDWORD ExitCode
+    )
+{
+    YORI_STRING CmdLine;
+    YORI_STRING Executable;
+    PYORI_STRING ChildArgs;
+    PROCESS_INFORMATION ProcessInfo;
+    STARTUPINFO StartupInfo;
+    HANDLE hJob;
+
+    ChildArgs = YoriLibMalloc((YORI_ALLOC_SIZE_T)(ArgC * sizeof(YORI_STRING)));
+    if (ChildArgs == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Executable);
+    if (!YoriLibLocateExecutableInPath(&ArgV[0], NULL, NULL, &Executable) ||
+        Executable.LengthInChars == 0) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: unable to find executable\n"));
+        YoriLibFree(ChildArgs);
+        YoriLibFreeStringContents(&Executable);
+        return FALSE;
+    }
+
+
+    memcpy(&ChildArgs[0], &Executable, sizeof(YORI_STRING));
+    if (ArgC > 1) {
+        memcpy(&ChildArgs[1], &ArgV[1], (ArgC - 1) * sizeof(YORI_STRING));
+    }
+
+    if (!YoriLibBuildCmdlineFromArgcArgv(ArgC, ChildArgs, TRUE, TRUE, &CmdLine)) {
+        YoriLibFree(ChildArgs);
+        YoriLibFreeStringContents(&Executable);
+        return FALSE;
+    }
+
+    ASSERT(YoriLibIsStringNullTerminated(&CmdLine));
+
+    hJob = YoriLibCreateJobObject();
+    if (hJob == NULL &&
+        (NiceContext->Affinity != 0 || NiceContext->CpuRate != 0)) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: OS support not present\n"));
+        YoriLibFree(ChildArgs);
+        YoriLibFreeStringContents(&CmdLine);
+        YoriLibFreeStringContents(&Executable);
+        return FALSE;
+    }
+
+    memset(&StartupInfo, 0, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+
+    if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, IDLE_PRIORITY_CLASS | CREATE_SUSPENDED | CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &StartupInfo, &ProcessInfo)) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: execution failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        YoriLibFree(ChildArgs);
+        YoriLibFreeStringContents(&CmdLine);
+        YoriLibFreeStringContents(&Executable);
+        if (hJob != NULL) {
+            CloseHandle(hJob);
+        }
+        return FALSE;
+    }
+
+    if (hJob != NULL) {
+        YoriLibAssignProcessToJobObject(hJob, ProcessInfo.hProcess);
+        YoriLibLimitJobObjectPriority(hJob, IDLE_PRIORITY_CLASS);
+
+        //
+        //  If a requested limit cannot be applied, don't run the program
+        //  without it.
+        //
+
+        if ((NiceContext->Affinity != 0 && !YoriLibLimitJobObjectAffinity(hJob, NiceContext->Affinity)) ||
+            (NiceContext->CpuRate != 0 && !YoriLibLimitJobObjectCpuRate(hJob, NiceContext->CpuRate))) {
+
+            DWORD LastError = GetLastError();
+            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: could not apply limits: %s"), ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            TerminateProcess(ProcessInfo.hProcess, EXIT_FAILURE);
+            CloseHandle(ProcessInfo.hProcess);
+            CloseHandle(ProcessInfo.hThread);
+            CloseHandle(hJob);
+            YoriLibFree(ChildArgs);
+            YoriLibFreeStringContents(&CmdLine);
+            YoriLibFreeStringContents(&Executable);
+            return FALSE;
+        }
+    }
+
+    ResumeThread(ProcessInfo.hThread);
+
+#if YORI_BUILTIN
+    {
+        HANDLE HandleArray[2];
+        DWORD WaitResult;
+
+        YoriLibCancelEnable(FALSE);
+        HandleArray[1] = YoriLibCancelGetEvent();
+        HandleArray[0] = ProcessInfo.hProcess;
+
+        WaitResult = WaitForMultipleObjectsEx(2, HandleArray, FALSE, INFINITE, FALSE);
+
+        //
+        //  If cancelled, leave the program running and return failure.
+        //
+
+        if (WaitResult == WAIT_OBJECT_0 + 1) {
+            *ExitCode = EXIT_FAILURE;
+        } else {
+            GetExitCodeProcess(ProcessInfo.hProcess, ExitCode);
+        }
+    }
+#else
+    WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+    GetExitCodeProcess(ProcessInfo.hProcess, ExitCode);
+#endif
+    CloseHandle(ProcessInfo.hProcess);
+    CloseHandle(ProcessInfo.hThread);
+    if (hJob != NULL) {
+        CloseHandle(hJob);
+    }
+    YoriLibFreeStringContents(&Executable);
+    YoriLibFreeStringContents(&CmdLine);
+    YoriLibFree(ChildArgs);
+    return TRUE;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the nice builtin command.
@@ -82,12 +261,16 @@ ENTRYPOINT(
     __in YORI_STRING ArgV[]
     )
 {
-    YORI_STRING CmdLine;
     DWORD ExitCode;
     BOOL ArgumentUnderstood;
     YORI_ALLOC_SIZE_T StartArg = 1;
     YORI_ALLOC_SIZE_T i;
     YORI_STRING Arg;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    NICE_CONTEXT NiceContext;
+
+    ZeroMemory(&NiceContext, sizeof(NiceContext));
 
     for (i = 1; i < ArgC; i++) {
 
@@ -102,6 +285,56 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2017-2018"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
+                if (i + 1 < ArgC &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp != 0) {
+
+                    if (NiceContext.Affinity != 0) {
+                        NiceContext.Affinity = NiceContext.Affinity & (DWORD_PTR)llTemp;
+                    } else {
+                        NiceContext.Affinity = (DWORD_PTR)llTemp;
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
+                if (i + 1 < ArgC &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp > 0 &&
+                    llTemp <= 100) {
+
+                    NiceContext.CpuRate = (DWORD)llTemp * 100;
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("n")) == 0) {
+                if (i + 1 < ArgC &&
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                    CharsConsumed > 0 &&
+                    llTemp >= 0 &&
+                    llTemp <= 0xFF) {
+
+                    ULONGLONG NodeMask;
+
+                    if (DllKernel32.pGetNumaNodeProcessorMask == NULL ||
+                        !DllKernel32.pGetNumaNodeProcessorMask((UCHAR)llTemp, &NodeMask) ||
+                        NodeMask == 0) {
+
+                        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: could not find processors for NUMA node %y\n"), &ArgV[i + 1]);
+                        return EXIT_FAILURE;
+                    }
+
+                    if (NiceContext.Affinity != 0) {
+                        NiceContext.Affinity = NiceContext.Affinity & (DWORD_PTR)NodeMask;
+                    } else {
+                        NiceContext.Affinity = (DWORD_PTR)NodeMask;
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 StartArg = i + 1;
                 ArgumentUnderstood = TRUE;
@@ -126,7 +359,14 @@ ENTRYPOINT(
 
 #ifdef YORI_BUILTIN
 
-    {
+    //
+    //  If no limits were requested, execute the command within the shell
+    //  at low priority, so it can use any shell feature.  Limits require a
+    //  job object which is populated by launching a program directly.
+    //
+
+    if (NiceContext.Affinity == 0 && NiceContext.CpuRate == 0) {
+        YORI_STRING CmdLine;
         DWORD OldPriority;
 
         OldPriority = GetPriorityClass(GetCurrentProcess());
@@ -141,78 +381,13 @@ ENTRYPOINT(
         YoriLibFreeStringContents(&CmdLine);
 
         ExitCode = YoriCallGetErrorLevel();
+        return ExitCode;
     }
-#else
-    {
-        YORI_STRING Executable;
-        PYORI_STRING ChildArgs;
-        PROCESS_INFORMATION ProcessInfo;
-        STARTUPINFO StartupInfo;
-        HANDLE hJob;
-
-        ChildArgs = YoriLibMalloc((YORI_ALLOC_SIZE_T)((ArgC - StartArg) * sizeof(YORI_STRING)));
-        if (ChildArgs == NULL) {
-            return EXIT_FAILURE;
-        }
-
-        YoriLibInitEmptyString(&Executable);
-        if (!YoriLibLocateExecutableInPath(&ArgV[StartArg], NULL, NULL, &Executable) ||
-            Executable.LengthInChars == 0) {
-
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: unable to find executable\n"));
-            YoriLibFree(ChildArgs);
-            YoriLibFreeStringContents(&Executable);
-            return EXIT_FAILURE;
-        }
-
-
-        memcpy(&ChildArgs[0], &Executable, sizeof(YORI_STRING));
-        if (StartArg + 1 < (YORI_ALLOC_SIZE_T)ArgC) {
-            memcpy(&ChildArgs[1], &ArgV[StartArg + 1], (ArgC - StartArg - 1) * sizeof(YORI_STRING));
-        }
-
-        if (!YoriLibBuildCmdlineFromArgcArgv(ArgC - StartArg, ChildArgs, TRUE, TRUE, &CmdLine)) {
-            YoriLibFree(ChildArgs);
-            YoriLibFreeStringContents(&Executable);
-            return EXIT_FAILURE;
-        }
-
-        ASSERT(YoriLibIsStringNullTerminated(&CmdLine));
-
-        hJob = YoriLibCreateJobObject();
-
-        memset(&StartupInfo, 0, sizeof(StartupInfo));
-        StartupInfo.cb = sizeof(StartupInfo);
-
-        if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, IDLE_PRIORITY_CLASS | CREATE_SUSPENDED | CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &StartupInfo, &ProcessInfo)) {
-            DWORD LastError = GetLastError();
-            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("nice: execution failed: %s"), ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-            YoriLibFree(ChildArgs);
-            YoriLibFreeStringContents(&CmdLine);
-            YoriLibFreeStringContents(&Executable);
-            return EXIT_FAILURE;
-        }
-
-        if (hJob != NULL) {
-            YoriLibAssignProcessToJobObject(hJob, ProcessInfo.hProcess);
-            YoriLibLimitJobObjectPriority(hJob, IDLE_PRIORITY_CLASS);
-        }
+#endif
 
-        ResumeThread(ProcessInfo.hThread);
-        WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
-        GetExitCodeProcess(ProcessInfo.hProcess, &ExitCode);
-        CloseHandle(ProcessInfo.hProcess);
-        CloseHandle(ProcessInfo.hThread);
-        if (hJob != NULL) {
-            CloseHandle(hJob);
-        }
-        YoriLibFreeStringContents(&Executable);
-        YoriLibFreeStringContents(&CmdLine);
-        YoriLibFree(ChildArgs);
+    if (!NiceExecuteInJob(&NiceContext, ArgC - StartArg, &ArgV[StartArg], &ExitCode)) {
+        return EXIT_FAILURE;
     }
-#endif
 
     return ExitCode;
 }
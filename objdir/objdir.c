@@ -35,9 +35,11 @@ CHAR strObjDirHelpText[] =
         "\n"
         "Enumerate the contents of the object manager.\n"
         "\n"
-        "OBJDIR [-license] [-m] [<spec>...]\n"
+        "OBJDIR [-license] [-j <num>] [-m] [-s] [<spec>...]\n"
         "\n"
-        "   -m             Minimal display, file names only\n";
+        "   -j <num>       Resolve symbolic links on the specified number of threads\n"
+        "   -m             Minimal display, file names only\n"
+        "   -s             Display contents of child directories\n";
 
 /**
  Display usage text to the user.
@@ -53,6 +55,12 @@ ObjDirHelp(VOID)
     return TRUE;
 }
 
+/**
+ The maximum number of symbolic links that can be waiting for a worker
+ thread to resolve them before the enumerating thread waits.
+ */
+#define OBJDIR_MAX_PENDING_LINKS (1024)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -63,6 +71,24 @@ typedef struct _OBJDIR_CONTEXT {
      */
     BOOLEAN MinimalDisplay;
 
+    /**
+     TRUE if the contents of child directories should be displayed.
+     */
+    BOOLEAN Recursive;
+
+    /**
+     The number of threads to use to resolve symbolic links.  Zero means one
+     per processor, and one means links are resolved on the enumerating
+     thread.
+     */
+    DWORD ThreadCount;
+
+    /**
+     The work queue used to resolve symbolic links when ThreadCount is not
+     one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
     /**
      Records the total number of objects processed.
      */
@@ -73,19 +99,72 @@ typedef struct _OBJDIR_CONTEXT {
      */
     YORI_MAX_SIGNED_T DirsFound;
 
+} OBJDIR_CONTEXT, *POBJDIR_CONTEXT;
+
+/**
+ A single object found within an object manager directory.
+ */
+typedef struct _OBJDIR_ENTRY {
+
     /**
-     An allocation that receives the target location of a symbolic link.
-     This is here so the same allocation can be reused for different links
-     encountered when enumerating the same directory.
+     The work item used to resolve the target of a symbolic link on a worker
+     thread.
      */
-    LPWSTR SymbolicLinkBuffer;
+    YORILIB_WORK_ITEM WorkItem;
 
     /**
-     The number of bytes in SymbolicLinkBuffer allocation.
+     Handle to the directory containing the object, opened for traverse
+     access, or NULL if the object should be opened by its full path.
      */
-    WORD SymbolicLinkBufferLength;
+    HANDLE DirHandle;
 
-} OBJDIR_CONTEXT, *POBJDIR_CONTEXT;
+    /**
+     The full path to the object.  This allocation also contains the type of
+     the object.
+     */
+    YORI_STRING FullPath;
+
+    /**
+     The name of the object, pointing within FullPath.
+     */
+    YORI_STRING NameOnly;
+
+    /**
+     The type of the object, pointing within the FullPath allocation.
+     */
+    YORI_STRING ObjectType;
+
+    /**
+     If the object is a symbolic link, the target of the link once it has
+     been resolved.
+     */
+    YORI_STRING LinkTarget;
+
+} OBJDIR_ENTRY, *POBJDIR_ENTRY;
+
+/**
+ The set of objects found within a single object manager directory.
+ Objects are collected before they are displayed so that the targets of
+ symbolic links can be resolved in parallel.
+ */
+typedef struct _OBJDIR_DIRECTORY {
+
+    /**
+     An array of pointers to objects found in the directory.
+     */
+    POBJDIR_ENTRY *Entries;
+
+    /**
+     The number of elements populated in Entries.
+     */
+    YORI_ALLOC_SIZE_T EntryCount;
+
+    /**
+     The number of elements allocated in Entries.
+     */
+    YORI_ALLOC_SIZE_T EntriesAllocated;
+
+} OBJDIR_DIRECTORY, *POBJDIR_DIRECTORY;
 
 /**
  The number of characters to use to display the size of objects in the
@@ -153,26 +232,20 @@ ObjDirOutputEndOfDirectorySummary(
 }
 
 /**
- Load the reparse buffer from an object manager symbolic link.
+ Load the target of an object manager symbolic link.  This may be called on
+ a worker thread.
 
- @param FullPath Pointer to the full path to the object.
+ @param Entry Pointer to the symbolic link object.  On successful
+        completion, LinkTarget is populated with a newly allocated string
+        containing the target.
 
- @param ObjDirContext Pointer to the context for the application.  This
-        contains the buffer to populate with the symbolic link target
-        location.
-
- @param ReparsePath On successful completion, a string to be updated to point
-        to the symbolic link target location.
-
- @return TRUE to indicate the reparse data was successfully obtained, FALSE to
+ @return TRUE to indicate the target was successfully obtained, FALSE to
          indicate it was not.
  */
 __success(return)
 BOOL
 ObjDirLoadReparseData(
-    __in PCYORI_STRING FullPath,
-    __inout POBJDIR_CONTEXT ObjDirContext,
-    __out PYORI_STRING ReparsePath
+    __inout POBJDIR_ENTRY Entry
     )
 {
     HANDLE FileHandle;
@@ -180,6 +253,8 @@ ObjDirLoadReparseData(
     LONG NtStatus;
     YORI_OBJECT_ATTRIBUTES ObjectAttributes;
     YORI_UNICODE_STRING LinkTarget;
+    WCHAR LocalBuffer[MAX_PATH];
+    LPWSTR HeapBuffer;
 
     if (DllNtDll.pNtOpenSymbolicLinkObject == NULL ||
         DllNtDll.pNtQuerySymbolicLinkObject == NULL) {
@@ -187,34 +262,100 @@ ObjDirLoadReparseData(
         return FALSE;
     }
 
-    YoriLibInitializeObjectAttributes(&ObjectAttributes, NULL, FullPath, 0);
+    //
+    //  Opening relative to the directory avoids walking the namespace from
+    //  the root for every link.
+    //
+
+    if (Entry->DirHandle != NULL) {
+        YoriLibInitializeObjectAttributes(&ObjectAttributes, Entry->DirHandle, &Entry->NameOnly, 0);
+    } else {
+        YoriLibInitializeObjectAttributes(&ObjectAttributes, NULL, &Entry->FullPath, 0);
+    }
 
     NtStatus = DllNtDll.pNtOpenSymbolicLinkObject(&FileHandle, GENERIC_READ, &ObjectAttributes);
     if (NtStatus != 0) {
         return FALSE;
     }
 
+    //
+    //  Most targets fit in a small buffer.  If not, retry with the maximum
+    //  size that can fit in a UNICODE_STRING.
+    //
+
+    HeapBuffer = NULL;
     LinkTarget.LengthInBytes =
-    LinkTarget.LengthAllocatedInBytes = ObjDirContext->SymbolicLinkBufferLength;
-    LinkTarget.Buffer = ObjDirContext->SymbolicLinkBuffer;
+    LinkTarget.LengthAllocatedInBytes = sizeof(LocalBuffer);
+    LinkTarget.Buffer = LocalBuffer;
 
     NtStatus = DllNtDll.pNtQuerySymbolicLinkObject(FileHandle, &LinkTarget, &BytesReturned);
     if (NtStatus != 0) {
-        CloseHandle(FileHandle);
+        HeapBuffer = YoriLibMalloc(0xfffe);
+        if (HeapBuffer == NULL) {
+            CloseHandle(FileHandle);
+            return FALSE;
+        }
+
+        LinkTarget.LengthInBytes =
+        LinkTarget.LengthAllocatedInBytes = 0xfffe;
+        LinkTarget.Buffer = HeapBuffer;
+
+        NtStatus = DllNtDll.pNtQuerySymbolicLinkObject(FileHandle, &LinkTarget, &BytesReturned);
+    }
+
+    CloseHandle(FileHandle);
+
+    if (NtStatus != 0 ||
+        !YoriLibAllocateString(&Entry->LinkTarget, (YORI_ALLOC_SIZE_T)(LinkTarget.LengthInBytes / sizeof(WCHAR) + 1))) {
+
+        if (HeapBuffer != NULL) {
+            YoriLibFree(HeapBuffer);
+        }
         return FALSE;
     }
 
-    YoriLibInitEmptyString(ReparsePath);
-    ReparsePath->StartOfString = LinkTarget.Buffer;
-    ReparsePath->LengthInChars = LinkTarget.LengthInBytes / sizeof(TCHAR);
+    Entry->LinkTarget.LengthInChars = LinkTarget.LengthInBytes / sizeof(WCHAR);
+    memcpy(Entry->LinkTarget.StartOfString, LinkTarget.Buffer, LinkTarget.LengthInBytes);
+    Entry->LinkTarget.StartOfString[Entry->LinkTarget.LengthInChars] = '\0';
+
+    if (HeapBuffer != NULL) {
+        YoriLibFree(HeapBuffer);
+    }
 
-    CloseHandle(FileHandle);
     return TRUE;
 }
 
+/**
+ Resolve the target of a symbolic link on a worker thread.
+
+ @param Context Pointer to the objdir context.
+
+ @param Item Pointer to the work item within the object.  The object remains
+        owned by the directory that contains it.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the link
+        should not be resolved.
+ */
+VOID
+ObjDirResolveLinkWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    POBJDIR_ENTRY Entry;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    Entry = CONTAINING_RECORD(Item, OBJDIR_ENTRY, WorkItem);
+    if (!Cancelled) {
+        ObjDirLoadReparseData(Entry);
+    }
+}
+
 /**
  A callback that is invoked when an object is found in an object manager
- directory.
+ directory.  This records the object in the directory's list of objects.
 
  @param FullPath Fully qualified name to the object that was found.
 
@@ -223,8 +364,7 @@ ObjDirLoadReparseData(
 
  @param ObjectType The type of the object.
 
- @param Context Pointer to the ObjDirContext structure indicating the
-        action to perform and populated with the number of objects found.
+ @param Context Pointer to the ObjDirDirectory structure to populate.
 
  @return TRUE to continute enumerating, FALSE to abort.
  */
@@ -235,11 +375,93 @@ ObjDirFileFoundCallback(
     __in PCYORI_STRING ObjectType,
     __in PVOID Context
     )
+{
+    POBJDIR_DIRECTORY Directory = (POBJDIR_DIRECTORY)Context;
+    POBJDIR_ENTRY Entry;
+    POBJDIR_ENTRY *NewEntries;
+    YORI_ALLOC_SIZE_T NewAllocated;
+
+    if (YoriLibIsOperationCancelled()) {
+        return FALSE;
+    }
+
+    if (Directory->EntryCount == Directory->EntriesAllocated) {
+        NewAllocated = Directory->EntriesAllocated * 2;
+        if (NewAllocated == 0) {
+            NewAllocated = 64;
+        }
+        if (!YoriLibIsSizeAllocatable(NewAllocated * sizeof(POBJDIR_ENTRY))) {
+            return FALSE;
+        }
+        NewEntries = YoriLibMalloc(NewAllocated * sizeof(POBJDIR_ENTRY));
+        if (NewEntries == NULL) {
+            return FALSE;
+        }
+        if (Directory->EntryCount > 0) {
+            memcpy(NewEntries, Directory->Entries, Directory->EntryCount * sizeof(POBJDIR_ENTRY));
+        }
+        if (Directory->Entries != NULL) {
+            YoriLibFree(Directory->Entries);
+        }
+        Directory->Entries = NewEntries;
+        Directory->EntriesAllocated = NewAllocated;
+    }
+
+    //
+    //  The strings supplied here are owned by the enumerator and will be
+    //  reused for the next object, so they need to be copied.
+    //
+
+    Entry = YoriLibMalloc(sizeof(OBJDIR_ENTRY) + (FullPath->LengthInChars + 1 + ObjectType->LengthInChars + 1) * sizeof(TCHAR));
+    if (Entry == NULL) {
+        return FALSE;
+    }
+
+    Entry->DirHandle = NULL;
+    YoriLibInitEmptyString(&Entry->LinkTarget);
+
+    YoriLibInitEmptyString(&Entry->FullPath);
+    Entry->FullPath.StartOfString = (LPTSTR)(Entry + 1);
+    Entry->FullPath.LengthInChars = FullPath->LengthInChars;
+    Entry->FullPath.LengthAllocated = FullPath->LengthInChars + 1;
+    memcpy(Entry->FullPath.StartOfString, FullPath->StartOfString, FullPath->LengthInChars * sizeof(TCHAR));
+    Entry->FullPath.StartOfString[Entry->FullPath.LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Entry->NameOnly);
+    Entry->NameOnly.StartOfString = Entry->FullPath.StartOfString + FullPath->LengthInChars - NameOnly->LengthInChars;
+    Entry->NameOnly.LengthInChars = NameOnly->LengthInChars;
+    Entry->NameOnly.LengthAllocated = NameOnly->LengthInChars + 1;
+
+    YoriLibInitEmptyString(&Entry->ObjectType);
+    Entry->ObjectType.StartOfString = Entry->FullPath.StartOfString + Entry->FullPath.LengthAllocated;
+    Entry->ObjectType.LengthInChars = ObjectType->LengthInChars;
+    Entry->ObjectType.LengthAllocated = ObjectType->LengthInChars + 1;
+    memcpy(Entry->ObjectType.StartOfString, ObjectType->StartOfString, ObjectType->LengthInChars * sizeof(TCHAR));
+    Entry->ObjectType.StartOfString[Entry->ObjectType.LengthInChars] = '\0';
+
+    Directory->Entries[Directory->EntryCount] = Entry;
+    Directory->EntryCount++;
+
+    return TRUE;
+}
+
+/**
+ Display a single object found in an object manager directory.
+
+ @param ObjDirContext Pointer to the context indicating the display format
+        and populated with the number of objects found.
+
+ @param Entry Pointer to the object to display.
+ */
+VOID
+ObjDirDisplayEntry(
+    __inout POBJDIR_CONTEXT ObjDirContext,
+    __in POBJDIR_ENTRY Entry
+    )
 {
     YORI_STRING TypeString;
-    YORI_STRING ReparseString;
     TCHAR TypeStringBuffer[OBJDIR_TYPE_FIELD_SIZE];
-    POBJDIR_CONTEXT ObjDirContext = (POBJDIR_CONTEXT)Context;
+    PYORI_STRING ObjectType;
     BOOLEAN IsDirectory;
     BOOLEAN IsLink;
     BOOLEAN IsDevice;
@@ -249,6 +471,7 @@ ObjDirFileFoundCallback(
     IsLink = FALSE;
     IsDevice = FALSE;
     IsDriver = FALSE;
+    ObjectType = &Entry->ObjectType;
 
     if (YoriLibCompareStringWithLiteral(ObjectType, _T("Directory")) == 0) {
         IsDirectory = TRUE;
@@ -266,46 +489,19 @@ ObjDirFileFoundCallback(
         ObjDirContext->ObjectsFound++;
     }
 
-    YoriLibInitEmptyString(&TypeString);
-    YoriLibInitEmptyString(&ReparseString);
-
     if (ObjDirContext->MinimalDisplay) {
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), NameOnly);
+        if (ObjDirContext->Recursive) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &Entry->FullPath);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &Entry->NameOnly);
+        }
 
     } else {
 
-        BOOLEAN DisplayReparseBuffer;
-
+        YoriLibInitEmptyString(&TypeString);
         TypeString.StartOfString = TypeStringBuffer;
         TypeString.LengthAllocated = sizeof(TypeStringBuffer)/sizeof(TypeStringBuffer[0]);
-        DisplayReparseBuffer = FALSE;
-
-        if (IsLink) {
-
-            //
-            //  If the entry should display the reparse buffer contents after
-            //  the file name, allocate memory for the buffer if necessary and
-            //  load the buffer
-            //
-
-            if (ObjDirContext->SymbolicLinkBuffer == NULL) {
-
-                //
-                //  This is the maximum size that can fit in a UNICODE_STRING
-                //
-
-                ObjDirContext->SymbolicLinkBufferLength = 0xfffe;
-                ObjDirContext->SymbolicLinkBuffer = YoriLibMalloc(ObjDirContext->SymbolicLinkBufferLength);
-                if (ObjDirContext->SymbolicLinkBuffer == NULL) {
-                    ObjDirContext->SymbolicLinkBufferLength = 0;
-                }
-            }
-
-            if (ObjDirContext->SymbolicLinkBuffer != NULL) {
-                ObjDirLoadReparseData(FullPath, ObjDirContext, &ReparseString);
-            }
-        }
 
         if (IsDirectory) {
             YoriLibYPrintf(&TypeString, _T("<DIR>"));
@@ -319,16 +515,14 @@ ObjDirFileFoundCallback(
             YoriLibYPrintf(&TypeString, _T("<\?\?\?>"));
         }
 
-        if (ReparseString.LengthInChars > 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y [%y]\n"), &TypeString, NameOnly, &ReparseString);
+        if (Entry->LinkTarget.LengthInChars > 0) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y [%y]\n"), &TypeString, &Entry->NameOnly, &Entry->LinkTarget);
         } else {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), &TypeString, NameOnly);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), &TypeString, &Entry->NameOnly);
         }
 
         YoriLibFreeStringContents(&TypeString);
     }
-
-    return TRUE;
 }
 
 /**
@@ -339,7 +533,7 @@ ObjDirFileFoundCallback(
 
  @param NtStatus The NTSTATUS code describing the failure.
 
- @param Context Pointer to the ObjDirContext.
+ @param Context Pointer to the ObjDirDirectory.
 
  @return TRUE to continute enumerating, FALSE to abort.
  */
@@ -362,6 +556,112 @@ ObjDirFileEnumerateErrorCallback(
     return Result;
 }
 
+/**
+ Enumerate and display the contents of an object manager directory, and if
+ requested, the contents of any child directories.  The objects in the
+ directory are collected first, any symbolic links are resolved, which
+ may occur on worker threads, and the objects are then displayed in the
+ order they were enumerated.
+
+ @param ObjDirContext Pointer to the context describing the operation.
+
+ @param DirectoryName Pointer to the name of the directory to display.
+
+ @param DisplayHeader TRUE if the name of the directory should be displayed
+        before its contents.
+ */
+VOID
+ObjDirEnumerateDirectory(
+    __inout POBJDIR_CONTEXT ObjDirContext,
+    __in PCYORI_STRING DirectoryName,
+    __in BOOLEAN DisplayHeader
+    )
+{
+    OBJDIR_DIRECTORY Directory;
+    YORI_OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE DirHandle;
+    POBJDIR_ENTRY Entry;
+    YORI_ALLOC_SIZE_T Index;
+    BOOLEAN LinksQueued;
+
+    ZeroMemory(&Directory, sizeof(Directory));
+
+    YoriLibForEachObjectEnum(DirectoryName,
+                             0,
+                             ObjDirFileFoundCallback,
+                             ObjDirFileEnumerateErrorCallback,
+                             &Directory);
+
+    //
+    //  Resolve the targets of any symbolic links.  These are opened
+    //  relative to a handle to the directory if one can be obtained.
+    //
+
+    DirHandle = NULL;
+    LinksQueued = FALSE;
+    if (!ObjDirContext->MinimalDisplay &&
+        DllNtDll.pNtOpenDirectoryObject != NULL) {
+
+        YoriLibInitializeObjectAttributes(&ObjectAttributes, NULL, DirectoryName, 0);
+        if (DllNtDll.pNtOpenDirectoryObject(&DirHandle, DIRECTORY_TRAVERSE, &ObjectAttributes) != 0) {
+            DirHandle = NULL;
+        }
+    }
+
+    for (Index = 0; Index < Directory.EntryCount && !ObjDirContext->MinimalDisplay; Index++) {
+        Entry = Directory.Entries[Index];
+        if (YoriLibCompareStringWithLiteral(&Entry->ObjectType, _T("SymbolicLink")) != 0) {
+            continue;
+        }
+
+        Entry->DirHandle = DirHandle;
+        if (ObjDirContext->ThreadCount != 1 &&
+            YoriLibQueueWorkItem(&ObjDirContext->WorkQueue, &Entry->WorkItem, TRUE)) {
+
+            LinksQueued = TRUE;
+        } else {
+            ObjDirLoadReparseData(Entry);
+        }
+    }
+
+    if (LinksQueued) {
+        YoriLibWaitForWorkQueue(&ObjDirContext->WorkQueue);
+    }
+
+    if (DirHandle != NULL) {
+        CloseHandle(DirHandle);
+    }
+
+    if (DisplayHeader && !ObjDirContext->MinimalDisplay) {
+        ObjDirOutputBeginningOfDirectorySummary(DirectoryName);
+    }
+
+    for (Index = 0; Index < Directory.EntryCount; Index++) {
+        ObjDirDisplayEntry(ObjDirContext, Directory.Entries[Index]);
+    }
+
+    //
+    //  Display child directories after the parent, so each directory's
+    //  contents are displayed together.
+    //
+
+    for (Index = 0; Index < Directory.EntryCount; Index++) {
+        Entry = Directory.Entries[Index];
+        if (ObjDirContext->Recursive &&
+            !YoriLibIsOperationCancelled() &&
+            YoriLibCompareStringWithLiteral(&Entry->ObjectType, _T("Directory")) == 0) {
+
+            ObjDirEnumerateDirectory(ObjDirContext, &Entry->FullPath, TRUE);
+        }
+        YoriLibFreeStringContents(&Entry->LinkTarget);
+        YoriLibFree(Entry);
+    }
+
+    if (Directory.Entries != NULL) {
+        YoriLibFree(Directory.Entries);
+    }
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the dir builtin command.
@@ -414,6 +714,19 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
                 ObjDirContext.MinimalDisplay = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) && CharsConsumed > 0) {
+                        ObjDirContext.ThreadCount = (DWORD)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                ObjDirContext.Recursive = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 ArgumentUnderstood = TRUE;
                 StartArg = i + 1;
@@ -434,36 +747,38 @@ ENTRYPOINT(
     YoriLibCancelEnable(FALSE);
 #endif
 
+    //
+    //  Symbolic link targets are only displayed in the full display.  When
+    //  they are, resolve them on worker threads.
+    //
+
+    if (ObjDirContext.MinimalDisplay) {
+        ObjDirContext.ThreadCount = 1;
+    }
+
+    if (ObjDirContext.ThreadCount != 1) {
+        if (!YoriLibInitializeWorkQueue(&ObjDirContext.WorkQueue, (YORI_ALLOC_SIZE_T)ObjDirContext.ThreadCount, OBJDIR_MAX_PENDING_LINKS, ObjDirResolveLinkWorkItem, &ObjDirContext)) {
+            YoriLibCleanupWorkQueue(&ObjDirContext.WorkQueue);
+            ObjDirContext.ThreadCount = 1;
+        }
+    }
+
     if (StartArg == 0 || StartArg == ArgC) {
         YORI_STRING FilesInDirectorySpec;
         YoriLibConstantString(&FilesInDirectorySpec, _T("\\"));
-        if (!ObjDirContext.MinimalDisplay) {
-            ObjDirOutputBeginningOfDirectorySummary(&FilesInDirectorySpec);
-        }
-        YoriLibForEachObjectEnum(&FilesInDirectorySpec,
-                                 0,
-                                 ObjDirFileFoundCallback,
-                                 ObjDirFileEnumerateErrorCallback,
-                                 &ObjDirContext);
+        ObjDirEnumerateDirectory(&ObjDirContext, &FilesInDirectorySpec, TRUE);
     } else {
         for (i = StartArg; i < ArgC; i++) {
-            if (!ObjDirContext.MinimalDisplay) {
-                ObjDirOutputBeginningOfDirectorySummary(&ArgV[i]);
-            }
-            YoriLibForEachObjectEnum(&ArgV[i],
-                                     0,
-                                     ObjDirFileFoundCallback,
-                                     ObjDirFileEnumerateErrorCallback,
-                                     &ObjDirContext);
+            ObjDirEnumerateDirectory(&ObjDirContext, &ArgV[i], TRUE);
         }
     }
 
-    if ((ObjDirContext.ObjectsFound > 0 || ObjDirContext.DirsFound > 0) && !ObjDirContext.MinimalDisplay) {
-        ObjDirOutputEndOfDirectorySummary(&ObjDirContext);
+    if (ObjDirContext.ThreadCount != 1) {
+        YoriLibCleanupWorkQueue(&ObjDirContext.WorkQueue);
     }
 
-    if (ObjDirContext.SymbolicLinkBuffer != NULL) {
-        YoriLibFree(ObjDirContext.SymbolicLinkBuffer);
+    if ((ObjDirContext.ObjectsFound > 0 || ObjDirContext.DirsFound > 0) && !ObjDirContext.MinimalDisplay) {
+        ObjDirOutputEndOfDirectorySummary(&ObjDirContext);
     }
 
     if (ObjDirContext.ObjectsFound == 0 && ObjDirContext.DirsFound == 0) {
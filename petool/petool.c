@@ -39,10 +39,16 @@ CHAR strPeToolHelpText[] =
         "PETOOL -c file\n"
         "PETOOL -cu file\n"
         "PETOOL -os file version\n"
+        "PETOOL -m [-b] [-j n] [-s] -c|-cu <file>...\n"
+        "PETOOL -m [-b] [-j n] [-s] -os version <file>...\n"
         "\n"
+        "   -b             Use basic search criteria for files only\n"
         "   -c             Calculate the PE checksum for a binary\n"
         "   -cu            Update the checksum in the PE header from contents\n"
-        "   -os            Set the minimum OS version and update checksum\n";
+        "   -j             Process files on the specified number of threads\n"
+        "   -m             Process all files matching the specified criteria\n"
+        "   -os            Set the minimum OS version and update checksum\n"
+        "   -s             Process files in all subdirectories\n";
 
 /**
  Display usage text to the user.
@@ -148,80 +154,6 @@ PeToolVersionRange[] = {
     {IMAGE_FILE_MACHINE_ARM64,    10,  0,  10,  0}
 };
 
-/**
- Write a new checksum to a PE header in a file.
-
- @param FullPath Pointer to the executable file name.
-
- @param Checksum The new checksum to apply to the PE header.
-
- @return Win32 error code, including ERROR_SUCCESS to indicate success.
- */
-DWORD
-PeToolWriteChecksumToFile(
-    __in PYORI_STRING FullPath,
-    __in DWORD Checksum
-    )
-{
-    DWORD PeHeaderOffset;
-    HANDLE hFileRead;
-    union {
-        IMAGE_DOS_HEADER DosHeader;
-        YORILIB_PE_HEADERS PeHeaders;
-    } u;
-    DWORD BytesReturned;
-    DWORD Err;
-
-    //
-    //  We want the earlier handle to be attribute only so we can
-    //  operate on directories, but we need data for this, so we
-    //  end up with two handles.
-    //
-
-    hFileRead = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES|FILE_READ_DATA|FILE_WRITE_DATA,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS,
-                           NULL);
-
-    if (hFileRead == INVALID_HANDLE_VALUE) {
-        Err = GetLastError();
-        return Err;
-    }
-
-    if (ReadFile(hFileRead, &u.DosHeader, sizeof(u.DosHeader), &BytesReturned, NULL) &&
-        BytesReturned == sizeof(u.DosHeader) &&
-        u.DosHeader.e_magic == IMAGE_DOS_SIGNATURE &&
-        u.DosHeader.e_lfanew != 0) {
-
-        PeHeaderOffset = u.DosHeader.e_lfanew;
-        SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
-
-        if (ReadFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL) &&
-            BytesReturned == sizeof(YORILIB_PE_HEADERS) &&
-            u.PeHeaders.Signature == IMAGE_NT_SIGNATURE &&
-            u.PeHeaders.ImageHeader.SizeOfOptionalHeader >= FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(u.PeHeaders.OptionalHeader.CheckSum)) {
-
-            u.PeHeaders.OptionalHeader.CheckSum = Checksum;
-            SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
-
-            if (!WriteFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL)) {
-                Err = GetLastError();
-                CloseHandle(hFileRead);
-                return Err;
-            }
-
-            CloseHandle(hFileRead);
-            return ERROR_SUCCESS;
-        }
-    }
-
-    CloseHandle(hFileRead);
-    return ERROR_BAD_EXE_FORMAT;
-}
-
 /**
  Check if the specified version is valid for a specified architecture.
  This includes checking if the specified version is a valid version, and if
@@ -290,288 +222,592 @@ PeToolIsVersionValidForArchitecture(
 }
 
 /**
- Check if a specified version is applicable to an executable file, and if so,
- update the minimum OS version in the header with the specified values.
+ A set of operations supported by this application.
+ */
+typedef enum _PETOOL_OP {
+    PeToolOpNone = 0,
+    PeToolOpCalculateChecksum = 1,
+    PeToolOpUpdateChecksum = 2,
+    PeToolOpUpdateSubsystemVersion = 3,
+} PETOOL_OP;
 
- @param FullPath Pointer to the executable file name.
+/**
+ Context describing the operation to apply to each file.
+ */
+typedef struct _PETOOL_CONTEXT {
 
- @param MajorVersion Specifies the new minimum major version.
+    /**
+     The operation to apply to each file.
+     */
+    PETOOL_OP Op;
 
- @param MinorVersion Specifies the new minimum minor version.
+    /**
+     The new minimum OS major version, if the operation is
+     PeToolOpUpdateSubsystemVersion.
+     */
+    WORD MajorVersion;
 
- @return Win32 error code, including ERROR_SUCCESS to indicate success.
- */
-DWORD
-PeToolWriteSubsystemVersionToFile(
-    __in PYORI_STRING FullPath,
-    __in WORD MajorVersion,
-    __in WORD MinorVersion
-    )
-{
-    DWORD PeHeaderOffset;
-    HANDLE hFileRead;
-    union {
-        IMAGE_DOS_HEADER DosHeader;
-        YORILIB_PE_HEADERS PeHeaders;
-    } u;
-    DWORD BytesReturned;
-    DWORD Err;
+    /**
+     The new minimum OS minor version, if the operation is
+     PeToolOpUpdateSubsystemVersion.
+     */
+    WORD MinorVersion;
 
-    //
-    //  We want the earlier handle to be attribute only so we can
-    //  operate on directories, but we need data for this, so we
-    //  end up with two handles.
-    //
+    /**
+     TRUE if multiple files are being processed, so output for each file
+     should be a single line which includes the file name.
+     */
+    BOOLEAN Batch;
 
-    hFileRead = CreateFile(FullPath->StartOfString,
-                           FILE_READ_ATTRIBUTES|FILE_READ_DATA|FILE_WRITE_DATA,
-                           FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
-                           NULL,
-                           OPEN_EXISTING,
-                           FILE_FLAG_BACKUP_SEMANTICS,
-                           NULL);
+    /**
+     The number of threads to use when processing multiple files.  Zero
+     means use one thread per processor, and one means process files on
+     the main thread.
+     */
+    DWORD ThreadCount;
 
-    if (hFileRead == INVALID_HANDLE_VALUE) {
-        Err = GetLastError();
-        return Err;
-    }
+    /**
+     The queue of files to process on background threads.  This is only
+     used when processing multiple files and ThreadCount is not one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
 
-    if (ReadFile(hFileRead, &u.DosHeader, sizeof(u.DosHeader), &BytesReturned, NULL) &&
-        BytesReturned == sizeof(u.DosHeader) &&
-        u.DosHeader.e_magic == IMAGE_DOS_SIGNATURE &&
-        u.DosHeader.e_lfanew != 0) {
+    /**
+     The number of files found when processing multiple files.
+     */
+    DWORD FilesFound;
 
-        PeHeaderOffset = u.DosHeader.e_lfanew;
-        SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
+    /**
+     The number of files which could not be processed.
+     */
+    volatile LONG FilesFailed;
 
-        if (ReadFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL) &&
-            BytesReturned == sizeof(YORILIB_PE_HEADERS) &&
-            u.PeHeaders.Signature == IMAGE_NT_SIGNATURE &&
-            u.PeHeaders.ImageHeader.SizeOfOptionalHeader >= FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(u.PeHeaders.OptionalHeader.CheckSum)) {
+} PETOOL_CONTEXT, *PPETOOL_CONTEXT;
 
-            if (!PeToolIsVersionValidForArchitecture(u.PeHeaders.ImageHeader.Machine, MajorVersion, MinorVersion)) {
-                CloseHandle(hFileRead);
-                return ERROR_OLD_WIN_VERSION;
-            }
+/**
+ A single file to be processed on a background thread.
+ */
+typedef struct _PETOOL_WORK_ITEM {
 
-            u.PeHeaders.OptionalHeader.MajorSubsystemVersion = MajorVersion;
-            u.PeHeaders.OptionalHeader.MinorSubsystemVersion = MinorVersion;
-            SetFilePointer(hFileRead, PeHeaderOffset, NULL, FILE_BEGIN);
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
 
-            if (!WriteFile(hFileRead, &u.PeHeaders, sizeof(YORILIB_PE_HEADERS), &BytesReturned, NULL)) {
-                Err = GetLastError();
-                CloseHandle(hFileRead);
-                return Err;
-            }
+    /**
+     Fully qualified path to the file.
+     */
+    YORI_STRING FilePath;
+} PETOOL_WORK_ITEM, *PPETOOL_WORK_ITEM;
+
+/**
+ Parse a user specified version string in the form major.minor.
+
+ @param VersionString Pointer to the version string.
+
+ @param MajorVersion On completion, updated to contain the major version.
+
+ @param MinorVersion On completion, updated to contain the minor version.
+ */
+VOID
+PeToolParseVersion(
+    __in PYORI_STRING VersionString,
+    __out PWORD MajorVersion,
+    __out PWORD MinorVersion
+    )
+{
+    YORI_STRING WinVer;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
-            CloseHandle(hFileRead);
-            return ERROR_SUCCESS;
+    *MajorVersion = 0;
+    *MinorVersion = 0;
+    YoriLibInitEmptyString(&WinVer);
+    WinVer.StartOfString = VersionString->StartOfString;
+    WinVer.LengthInChars = VersionString->LengthInChars;
+    if (YoriLibStringToNumber(&WinVer, FALSE, &llTemp, &CharsConsumed)) {
+        *MajorVersion = (WORD)llTemp;
+        WinVer.LengthInChars = WinVer.LengthInChars - CharsConsumed;
+        WinVer.StartOfString += CharsConsumed;
+        if (WinVer.LengthInChars > 0) {
+            WinVer.LengthInChars -= 1;
+            WinVer.StartOfString += 1;
+            if (YoriLibStringToNumber(&WinVer, FALSE, &llTemp, &CharsConsumed)) {
+                *MinorVersion = (WORD)llTemp;
+            }
         }
     }
-
-    CloseHandle(hFileRead);
-    return ERROR_BAD_EXE_FORMAT;
 }
 
-
 /**
- Calculate and display the checksum for a specified file.
+ Locate and capture the PE headers within a mapped file.  The headers are
+ copied because nothing guarantees they are aligned within the file.
+
+ @param Buffer Pointer to the mapped file.
+
+ @param Length The length of the mapped file, in bytes.
 
- @param FileName Pointer to the file name to calculate a checksum for.
+ @param PeHeaders On successful completion, populated with a copy of the PE
+        headers.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param PeHeaderOffset On successful completion, updated to contain the
+        offset of the PE headers within the file.
+
+ @return TRUE if the file contains valid PE headers, FALSE if not.
  */
 BOOLEAN
-PeToolCalculateChecksum(
-    __in PYORI_STRING FileName
+PeToolCapturePeHeaders(
+    __in_bcount(Length) PUCHAR Buffer,
+    __in DWORD Length,
+    __out PYORILIB_PE_HEADERS PeHeaders,
+    __out PDWORD PeHeaderOffset
     )
 {
-    DWORD Err;
-    DWORD HeaderChecksum;
-    DWORD DataChecksum;
-    YORI_STRING FullPath;
-
-    YoriLibLoadImageHlpFunctions();
+    IMAGE_DOS_HEADER DosHeader;
+    DWORD Offset;
 
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
+    if (Length < sizeof(DosHeader)) {
         return FALSE;
     }
 
-    YoriLibInitEmptyString(&FullPath);
-    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
+    memcpy(&DosHeader, Buffer, sizeof(DosHeader));
+    if (DosHeader.e_magic != IMAGE_DOS_SIGNATURE ||
+        DosHeader.e_lfanew == 0) {
+
         return FALSE;
     }
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
+    Offset = (DWORD)DosHeader.e_lfanew;
+    if (Offset > Length ||
+        Length - Offset < sizeof(YORILIB_PE_HEADERS)) {
+
         return FALSE;
     }
 
-    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Checksum in PE header: %08x\n")
-                                          _T("Checksum of file contents: %08x\n"),
-                                          HeaderChecksum,
-                                          DataChecksum);
+    memcpy(PeHeaders, Buffer + Offset, sizeof(YORILIB_PE_HEADERS));
+    if (PeHeaders->Signature != IMAGE_NT_SIGNATURE ||
+        PeHeaders->ImageHeader.SizeOfOptionalHeader < FIELD_OFFSET(IMAGE_OPTIONAL_HEADER, CheckSum) + sizeof(PeHeaders->OptionalHeader.CheckSum)) {
 
-    YoriLibFreeStringContents(&FullPath);
+        return FALSE;
+    }
+
+    *PeHeaderOffset = Offset;
     return TRUE;
 }
 
 /**
- Generate the checksum for a binary and update the header.
+ Calculate the ones complement sum of a buffer as a series of 16 bit little
+ endian values, where an odd trailing byte is treated as the low byte of a
+ final value.
+
+ Since 0x10000 is congruent to one modulo 0xFFFF, the sum of 32 bit values
+ folded to 16 bits is the same as the sum of the 16 bit values that make
+ them up.  This allows the buffer to be consumed 32 bits at a time into
+ independent 64 bit accumulators with no carry handling in the loop, and
+ the result is folded once at the end.
 
- @param FileName Pointer to the file name to generate a checksum for.
+ @param Buffer Pointer to the buffer, which must be aligned to a DWORD.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @param Length The length of the buffer, in bytes.
+
+ @return The 16 bit ones complement sum.
  */
-BOOLEAN
-PeToolUpdateChecksum(
-    __in PYORI_STRING FileName
+WORD
+PeToolOnesComplementSum(
+    __in_bcount(Length) PUCHAR Buffer,
+    __in DWORD Length
     )
 {
-    DWORD Err;
-    DWORD HeaderChecksum;
-    DWORD DataChecksum;
-    YORI_STRING FullPath;
-
-    YoriLibLoadImageHlpFunctions();
+    DWORDLONG Sum0;
+    DWORDLONG Sum1;
+    DWORDLONG Sum2;
+    DWORDLONG Sum3;
+    DWORDLONG Sum;
+    PDWORD Dwords;
+    DWORD Count;
+    DWORD Index;
+    DWORD Offset;
+
+    Dwords = (PDWORD)Buffer;
+    Count = Length / sizeof(DWORD);
+    Sum0 = 0;
+    Sum1 = 0;
+    Sum2 = 0;
+    Sum3 = 0;
+
+    for (Index = 0; Index + 4 <= Count; Index += 4) {
+        Sum0 += Dwords[Index];
+        Sum1 += Dwords[Index + 1];
+        Sum2 += Dwords[Index + 2];
+        Sum3 += Dwords[Index + 3];
+    }
 
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
-        return FALSE;
+    for (; Index < Count; Index++) {
+        Sum0 += Dwords[Index];
     }
 
-    YoriLibInitEmptyString(&FullPath);
-    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
-        return FALSE;
+    Sum = Sum0 + Sum1 + Sum2 + Sum3;
+
+    Offset = Count * sizeof(DWORD);
+    if (Length - Offset >= sizeof(WORD)) {
+        Sum += Buffer[Offset] | (Buffer[Offset + 1] << 8);
+        Offset += sizeof(WORD);
+    }
+    if (Offset < Length) {
+        Sum += Buffer[Offset];
     }
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+    while (Sum > 0xFFFF) {
+        Sum = (Sum & 0xFFFF) + (Sum >> 16);
     }
 
-    ASSERT(YoriLibIsStringNullTerminated(&FullPath));
+    return (WORD)Sum;
+}
 
-    Err = PeToolWriteChecksumToFile(&FullPath, DataChecksum);
-    if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-    }
+/**
+ Calculate the checksum of a PE file from its contents.  This is the ones
+ complement sum of the file excluding the checksum field in the PE header,
+ plus the length of the file.
 
-    YoriLibFreeStringContents(&FullPath);
+ @param Buffer Pointer to the mapped file.
 
-    return TRUE;
+ @param Length The length of the mapped file, in bytes.
+
+ @param HeaderChecksum The checksum currently stored in the PE header, which
+        is excluded from the sum.
+
+ @return The checksum of the file contents.
+ */
+DWORD
+PeToolCalculateImageChecksum(
+    __in_bcount(Length) PUCHAR Buffer,
+    __in DWORD Length,
+    __in DWORD HeaderChecksum
+    )
+{
+    WORD PartialSum;
+    WORD Adjust;
+
+    PartialSum = PeToolOnesComplementSum(Buffer, Length);
+
+    //
+    //  Subtract each half of the header checksum with end around borrow,
+    //  which is the same as summing the file with the field set to zero.
+    //
+
+    Adjust = LOWORD(HeaderChecksum);
+    PartialSum = (WORD)(PartialSum - (PartialSum < Adjust));
+    PartialSum = (WORD)(PartialSum - Adjust);
+
+    Adjust = HIWORD(HeaderChecksum);
+    PartialSum = (WORD)(PartialSum - (PartialSum < Adjust));
+    PartialSum = (WORD)(PartialSum - Adjust);
+
+    return (DWORD)PartialSum + Length;
 }
 
 /**
- Update the subsystem version for a PE file and regenerate the checksum.
+ Apply the requested operation to a single file.  The file is mapped so the
+ checksum can be calculated without copying data, and any header updates are
+ written directly into the mapped view.
 
- @param FileName Pointer to the file name to generate a checksum for.
+ @param PeToolContext Pointer to the context describing the operation.
 
- @param NewSubsystemVersion Pointer to the new subsystem version.
+ @param FullPath Pointer to the fully qualified file name.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @return Win32 error code, including ERROR_SUCCESS to indicate success.
  */
-BOOLEAN
-PeToolUpdateSubsystemVersion(
-    __in PYORI_STRING FileName,
-    __in PYORI_STRING NewSubsystemVersion
+DWORD
+PeToolProcessFile(
+    __in PPETOOL_CONTEXT PeToolContext,
+    __in PYORI_STRING FullPath
     )
 {
-    DWORD Err;
-    DWORD HeaderChecksum;
+    HANDLE hFile;
+    HANDLE hMapping;
+    PUCHAR Buffer;
+    DWORD FileSize;
+    DWORD FileSizeHigh;
+    DWORD PeHeaderOffset;
     DWORD DataChecksum;
-    YORI_STRING FullPath;
-    YORI_STRING WinVer;
-    YORI_MAX_SIGNED_T llTemp;
-    YORI_ALLOC_SIZE_T CharsConsumed;
-    WORD MajorVersion;
-    WORD MinorVersion;
+    BOOLEAN Writable;
+    YORILIB_PE_HEADERS PeHeaders;
+    DWORD Err;
 
-    YoriLibLoadImageHlpFunctions();
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
 
-    if (DllImageHlp.pMapFileAndCheckSumW == NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: OS support not present\n"));
-        return FALSE;
+    Writable = TRUE;
+    if (PeToolContext->Op == PeToolOpCalculateChecksum) {
+        Writable = FALSE;
     }
 
-    YoriLibInitEmptyString(&FullPath);
-    if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
-        return FALSE;
+    hFile = CreateFile(FullPath->StartOfString,
+                       FILE_READ_ATTRIBUTES|FILE_READ_DATA|(Writable?FILE_WRITE_DATA:0),
+                       FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_BACKUP_SEMANTICS,
+                       NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return GetLastError();
     }
 
-    MajorVersion = 0;
-    MinorVersion = 0;
-    YoriLibInitEmptyString(&WinVer);
-    WinVer.StartOfString = NewSubsystemVersion->StartOfString;
-    WinVer.LengthInChars = NewSubsystemVersion->LengthInChars;
-    if (YoriLibStringToNumber(&WinVer, FALSE, &llTemp, &CharsConsumed)) {
-        MajorVersion = (WORD)llTemp;
-        WinVer.LengthInChars = WinVer.LengthInChars - CharsConsumed;
-        WinVer.StartOfString += CharsConsumed;
-        if (WinVer.LengthInChars > 0) {
-            WinVer.LengthInChars -= 1;
-            WinVer.StartOfString += 1;
-            if (YoriLibStringToNumber(&WinVer, FALSE, &llTemp, &CharsConsumed)) {
-                MinorVersion = (WORD)llTemp;
+    //
+    //  PE files cannot exceed 4Gb, and an empty file cannot be mapped.
+    //
+
+    FileSize = GetFileSize(hFile, &FileSizeHigh);
+    if (FileSize == 0 || FileSize == INVALID_FILE_SIZE || FileSizeHigh != 0) {
+        CloseHandle(hFile);
+        return ERROR_BAD_EXE_FORMAT;
+    }
+
+    hMapping = CreateFileMapping(hFile, NULL, Writable?PAGE_READWRITE:PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL) {
+        Err = GetLastError();
+        CloseHandle(hFile);
+        return Err;
+    }
+
+    Buffer = MapViewOfFile(hMapping, Writable?FILE_MAP_WRITE:FILE_MAP_READ, 0, 0, 0);
+    if (Buffer == NULL) {
+        Err = GetLastError();
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return Err;
+    }
+
+    Err = ERROR_SUCCESS;
+    if (!PeToolCapturePeHeaders(Buffer, FileSize, &PeHeaders, &PeHeaderOffset)) {
+        Err = ERROR_BAD_EXE_FORMAT;
+    } else if (PeToolContext->Op == PeToolOpCalculateChecksum) {
+        DataChecksum = PeToolCalculateImageChecksum(Buffer, FileSize, PeHeaders.OptionalHeader.CheckSum);
+        if (PeToolContext->Batch) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%08x %08x %y\n"), PeHeaders.OptionalHeader.CheckSum, DataChecksum, FullPath);
+        } else {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Checksum in PE header: %08x\n")
+                                                  _T("Checksum of file contents: %08x\n"),
+                                                  PeHeaders.OptionalHeader.CheckSum,
+                                                  DataChecksum);
+        }
+    } else {
+        if (PeToolContext->Op == PeToolOpUpdateSubsystemVersion) {
+            if (!PeToolIsVersionValidForArchitecture(PeHeaders.ImageHeader.Machine, PeToolContext->MajorVersion, PeToolContext->MinorVersion)) {
+                Err = ERROR_OLD_WIN_VERSION;
+            } else if (PeHeaders.OptionalHeader.MajorSubsystemVersion != PeToolContext->MajorVersion ||
+                       PeHeaders.OptionalHeader.MinorSubsystemVersion != PeToolContext->MinorVersion) {
+
+                PeHeaders.OptionalHeader.MajorSubsystemVersion = PeToolContext->MajorVersion;
+                PeHeaders.OptionalHeader.MinorSubsystemVersion = PeToolContext->MinorVersion;
+                memcpy(Buffer + PeHeaderOffset, &PeHeaders, sizeof(YORILIB_PE_HEADERS));
+            }
+        }
+
+        //
+        //  Only write the checksum if it changed, so files which are
+        //  already correct are never dirtied.
+        //
+
+        if (Err == ERROR_SUCCESS) {
+            DataChecksum = PeToolCalculateImageChecksum(Buffer, FileSize, PeHeaders.OptionalHeader.CheckSum);
+            if (DataChecksum != PeHeaders.OptionalHeader.CheckSum) {
+                PeHeaders.OptionalHeader.CheckSum = DataChecksum;
+                memcpy(Buffer + PeHeaderOffset, &PeHeaders, sizeof(YORILIB_PE_HEADERS));
             }
         }
     }
 
-    Err = PeToolWriteSubsystemVersionToFile(&FullPath, MajorVersion, MinorVersion);
+    UnmapViewOfFile(Buffer);
+    CloseHandle(hMapping);
+    CloseHandle(hFile);
+    return Err;
+}
+
+/**
+ Display an error from processing a file.
+
+ @param FullPath Pointer to the fully qualified file name.
+
+ @param Err The Win32 error code describing the failure.
+ */
+VOID
+PeToolReportError(
+    __in PYORI_STRING FullPath,
+    __in DWORD Err
+    )
+{
+    LPTSTR ErrText;
+
     if (Err == ERROR_OLD_WIN_VERSION) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("The specified version is not valid for the processor architecture of this program: %y\n"), &FullPath);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("The specified version is not valid for the processor architecture of this program: %y\n"), FullPath);
     } else if (Err == ERROR_BAD_EXE_FORMAT) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("This file is not a valid Windows executable: %y\n"), &FullPath);
-    } else if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("This file is not a valid Windows executable: %y\n"), FullPath);
+    } else {
         ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), FullPath, ErrText);
         YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
     }
+}
 
-    Err = DllImageHlp.pMapFileAndCheckSumW(FullPath.StartOfString, &HeaderChecksum, &DataChecksum);
-    if (Err != 0) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of source failed: %y\n"), FileName);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+/**
+ Process a single file on a background thread.
+
+ @param Context Pointer to the petool context.
+
+ @param Item Pointer to the work item within the petool work item.  The
+        petool work item is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be processed.
+ */
+VOID
+PeToolWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PPETOOL_CONTEXT PeToolContext = (PPETOOL_CONTEXT)Context;
+    PPETOOL_WORK_ITEM PeToolItem;
+    DWORD Err;
+
+    PeToolItem = CONTAINING_RECORD(Item, PETOOL_WORK_ITEM, WorkItem);
+
+    if (Cancelled) {
+        InterlockedIncrement(&PeToolContext->FilesFailed);
+    } else {
+        Err = PeToolProcessFile(PeToolContext, &PeToolItem->FilePath);
+        if (Err != ERROR_SUCCESS) {
+            PeToolReportError(&PeToolItem->FilePath, Err);
+            InterlockedIncrement(&PeToolContext->FilesFailed);
+        }
     }
 
-    ASSERT(YoriLibIsStringNullTerminated(&FullPath));
+    YoriLibFreeStringContents(&PeToolItem->FilePath);
+    YoriLibFree(PeToolItem);
+}
 
-    Err = PeToolWriteChecksumToFile(&FullPath, DataChecksum);
-    if (Err != ERROR_SUCCESS) {
-        LPTSTR ErrText;
-        ErrText = YoriLibGetWinErrorText(Err);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of file failed: %y: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FullPath);
-        return FALSE;
+/**
+ A callback that is invoked when a file is found that matches a search criteria
+ specified in the set of strings to enumerate.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.  Ignored in this application.
+
+ @param Depth Specifies the recursion depth.  Ignored in this application.
+
+ @param Context Pointer to the petool context.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+PeToolFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PPETOOL_CONTEXT PeToolContext = (PPETOOL_CONTEXT)Context;
+    PPETOOL_WORK_ITEM PeToolItem;
+    DWORD Err;
+
+    UNREFERENCED_PARAMETER(FileInfo);
+    UNREFERENCED_PARAMETER(Depth);
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    PeToolContext->FilesFound++;
+
+    if (PeToolContext->ThreadCount != 1) {
+        PeToolItem = YoriLibMalloc(sizeof(PETOOL_WORK_ITEM));
+        if (PeToolItem != NULL) {
+
+            //
+            //  The file name is a buffer owned by the enumerator which will
+            //  be reused for the next file, so it needs to be copied.
+            //
+
+            ZeroMemory(PeToolItem, sizeof(PETOOL_WORK_ITEM));
+            if (YoriLibCopyString(&PeToolItem->FilePath, FilePath)) {
+                if (YoriLibQueueWorkItem(&PeToolContext->WorkQueue, &PeToolItem->WorkItem, TRUE)) {
+                    return TRUE;
+                }
+                YoriLibFreeStringContents(&PeToolItem->FilePath);
+            }
+            YoriLibFree(PeToolItem);
+        }
+
+        if (PeToolContext->WorkQueue.Cancelled) {
+            return FALSE;
+        }
     }
 
-    YoriLibFreeStringContents(&FullPath);
+    Err = PeToolProcessFile(PeToolContext, FilePath);
+    if (Err != ERROR_SUCCESS) {
+        PeToolReportError(FilePath, Err);
+        InterlockedIncrement(&PeToolContext->FilesFailed);
+    }
 
     return TRUE;
 }
 
 /**
- A set of operations supported by this application.
+ A callback that is invoked when a directory cannot be successfully enumerated.
+
+ @param FilePath Pointer to the file path that could not be enumerated.
+
+ @param ErrorCode The Win32 error code describing the failure.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Ignored.
+
+ @return TRUE to continute enumerating, FALSE to abort.
  */
-typedef enum _PETOOL_OP {
-    PeToolOpNone = 0,
-    PeToolOpCalculateChecksum = 1,
-    PeToolOpUpdateChecksum = 2,
-    PeToolOpUpdateSubsystemVersion = 3,
-} PETOOL_OP;
+BOOL
+PeToolFileEnumerateErrorCallback(
+    __in PYORI_STRING FilePath,
+    __in DWORD ErrorCode,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    YORI_STRING UnescapedFilePath;
+    BOOL Result = FALSE;
+
+    UNREFERENCED_PARAMETER(Depth);
+    UNREFERENCED_PARAMETER(Context);
+
+    YoriLibInitEmptyString(&UnescapedFilePath);
+    if (!YoriLibUnescapePath(FilePath, &UnescapedFilePath)) {
+        UnescapedFilePath.StartOfString = FilePath->StartOfString;
+        UnescapedFilePath.LengthInChars = FilePath->LengthInChars;
+    }
+
+    if (ErrorCode == ERROR_FILE_NOT_FOUND || ErrorCode == ERROR_PATH_NOT_FOUND) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File or directory not found: %y\n"), &UnescapedFilePath);
+        Result = TRUE;
+    } else {
+        LPTSTR ErrText = YoriLibGetWinErrorText(ErrorCode);
+        YORI_STRING DirName;
+        LPTSTR FilePart;
+        YoriLibInitEmptyString(&DirName);
+        DirName.StartOfString = UnescapedFilePath.StartOfString;
+        FilePart = YoriLibFindRightMostCharacter(&UnescapedFilePath, '\\');
+        if (FilePart != NULL) {
+            DirName.LengthInChars = (YORI_ALLOC_SIZE_T)(FilePart - DirName.StartOfString);
+        } else {
+            DirName.LengthInChars = UnescapedFilePath.LengthInChars;
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Enumerate of %y failed: %s"), &DirName, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+    }
+    YoriLibFreeStringContents(&UnescapedFilePath);
+    return Result;
+}
 
 #ifdef YORI_BUILTIN
 /**
@@ -602,15 +838,25 @@ ENTRYPOINT(
     )
 {
     BOOLEAN ArgumentUnderstood;
+    BOOLEAN BasicEnumeration;
+    BOOLEAN Recursive;
     YORI_ALLOC_SIZE_T i;
-    YORI_ALLOC_SIZE_T StartArg;
+    YORI_ALLOC_SIZE_T StartArg = 0;
     YORI_STRING Arg;
     PYORI_STRING FileName = NULL;
     PYORI_STRING NewSubsystemVersion = NULL;
-    PETOOL_OP Op;
+    PETOOL_CONTEXT PeToolContext;
+    YORI_STRING FullPath;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    DWORD MatchFlags;
     DWORD Result;
+    DWORD Err;
 
-    Op = PeToolOpNone;
+    ZeroMemory(&PeToolContext, sizeof(PeToolContext));
+    PeToolContext.Op = PeToolOpNone;
+    BasicEnumeration = FALSE;
+    Recursive = FALSE;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -625,25 +871,49 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2021"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
+                BasicEnumeration = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
                 if (ArgC > i + 1) {
                     FileName = &ArgV[i + 1];
-                    Op = PeToolOpCalculateChecksum;
+                    PeToolContext.Op = PeToolOpCalculateChecksum;
                     ArgumentUnderstood = TRUE;
                 }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("cu")) == 0) {
                 if (ArgC > i + 1) {
                     FileName = &ArgV[i + 1];
-                    Op = PeToolOpUpdateChecksum;
+                    PeToolContext.Op = PeToolOpUpdateChecksum;
                     ArgumentUnderstood = TRUE;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        PeToolContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                PeToolContext.Batch = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("os")) == 0) {
-                if (ArgC > i + 2) {
+                if (PeToolContext.Batch) {
+                    if (ArgC > i + 1) {
+                        NewSubsystemVersion = &ArgV[i + 1];
+                        PeToolContext.Op = PeToolOpUpdateSubsystemVersion;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                } else if (ArgC > i + 2) {
                     FileName = &ArgV[i + 1];
                     NewSubsystemVersion = &ArgV[i + 2];
-                    Op = PeToolOpUpdateSubsystemVersion;
+                    PeToolContext.Op = PeToolOpUpdateSubsystemVersion;
                     ArgumentUnderstood = TRUE;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
+                Recursive = TRUE;
+                ArgumentUnderstood = TRUE;
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -656,29 +926,83 @@ ENTRYPOINT(
         }
     }
 
-    if (Op == PeToolOpNone) {
+    if (PeToolContext.Op == PeToolOpNone) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: operation not specified\n"));
         return EXIT_FAILURE;
     }
 
+    if (NewSubsystemVersion != NULL) {
+        PeToolParseVersion(NewSubsystemVersion, &PeToolContext.MajorVersion, &PeToolContext.MinorVersion);
+    }
+
+    if (!PeToolContext.Batch) {
+        YoriLibInitEmptyString(&FullPath);
+        if (!YoriLibUserStringToSingleFilePath(FileName, TRUE, &FullPath)) {
+            return EXIT_FAILURE;
+        }
+
+        Result = EXIT_SUCCESS;
+        Err = PeToolProcessFile(&PeToolContext, &FullPath);
+        if (Err != ERROR_SUCCESS) {
+            PeToolReportError(&FullPath, Err);
+            Result = EXIT_FAILURE;
+        }
+
+        YoriLibFreeStringContents(&FullPath);
+        return Result;
+    }
+
+    if (StartArg == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: missing argument\n"));
+        return EXIT_FAILURE;
+    }
+
+    //
+    //  Threads are only created as files are queued, so this is cheap if
+    //  few files are found.
+    //
+
+    if (PeToolContext.ThreadCount != 1) {
+        if (!YoriLibInitializeWorkQueue(&PeToolContext.WorkQueue, (YORI_ALLOC_SIZE_T)PeToolContext.ThreadCount, 0, PeToolWorkItem, &PeToolContext)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+#if YORI_BUILTIN
+    YoriLibCancelEnable(FALSE);
+#endif
+
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES;
+    if (Recursive) {
+        MatchFlags |= YORILIB_FILEENUM_RECURSE_BEFORE_RETURN | YORILIB_FILEENUM_RECURSE_PRESERVE_WILD;
+    }
+    if (BasicEnumeration) {
+        MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
+    }
+
+    for (i = StartArg; i < ArgC; i++) {
+        YoriLibForEachFile(&ArgV[i],
+                           MatchFlags,
+                           0,
+                           PeToolFileFoundCallback,
+                           PeToolFileEnumerateErrorCallback,
+                           &PeToolContext);
+    }
+
     Result = EXIT_SUCCESS;
 
-    switch(Op) {
-        case PeToolOpCalculateChecksum:
-            if (!PeToolCalculateChecksum(FileName)) {
-                Result = EXIT_FAILURE;
-            }
-            break;
-        case PeToolOpUpdateChecksum:
-            if (!PeToolUpdateChecksum(FileName)) {
-                Result = EXIT_FAILURE;
-            }
-            break;
-        case PeToolOpUpdateSubsystemVersion:
-            if (!PeToolUpdateSubsystemVersion(FileName, NewSubsystemVersion)) {
-                Result = EXIT_FAILURE;
-            }
-            break;
+    if (PeToolContext.ThreadCount != 1) {
+        if (!YoriLibWaitForWorkQueue(&PeToolContext.WorkQueue)) {
+            Result = EXIT_FAILURE;
+        }
+        YoriLibCleanupWorkQueue(&PeToolContext.WorkQueue);
+    }
+
+    if (PeToolContext.FilesFound == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("petool: no matching files found\n"));
+        Result = EXIT_FAILURE;
+    } else if (PeToolContext.FilesFailed > 0) {
+        Result = EXIT_FAILURE;
     }
 
     return Result;
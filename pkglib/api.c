@@ -59,6 +59,8 @@ YoriPkgUpgradeInstalledPackages(
     BOOL Result;
     BOOL UpgradeThisPackage;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
 
     if (DllKernel32.pGetPrivateProfileIntW == NULL ||
         DllKernel32.pGetPrivateProfileSectionW == NULL ||
@@ -155,16 +157,12 @@ YoriPkgUpgradeInstalledPackages(
             }
             if (UpgradeThisPackage) {
                 if (RedirectedPath.LengthInChars > 0) {
-                    Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &RedirectedPath);
-                    YoriLibFreeStringContents(&RedirectedPath);
+                    YoriPkgAddDownloadToSet(&PendingPackages.Downloads, &RedirectedPath, &PkgIniFile);
                 } else {
-                    Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &UpgradePath);
-                }
-                if (Error != ERROR_SUCCESS) {
-                    YoriPkgDisplayErrorStringForInstallFailure(Error);
-                    goto Exit;
+                    YoriPkgAddDownloadToSet(&PendingPackages.Downloads, &UpgradePath, &PkgIniFile);
                 }
             }
+            YoriLibFreeStringContents(&RedirectedPath);
         }
         if (Equals) {
             *Equals = '=';
@@ -174,6 +172,25 @@ YoriPkgUpgradeInstalledPackages(
         ThisLine++;
     }
 
+    //
+    //  Download all of the packages to upgrade concurrently, then prepare
+    //  each of them in order.
+    //
+
+    YoriPkgDownloadAllInSet(&PendingPackages.Downloads);
+
+    ListEntry = YoriLibGetNextListEntry(&PendingPackages.Downloads.DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        ListEntry = YoriLibGetNextListEntry(&PendingPackages.Downloads.DownloadList, ListEntry);
+
+        Error = YoriPkgPreparePackageForInstallRedirectBuild(&PkgIniFile, NULL, &PendingPackages, &Download->PackageUrl);
+        if (Error != ERROR_SUCCESS) {
+            YoriPkgDisplayErrorStringForInstallFailure(Error);
+            goto Exit;
+        }
+    }
+
     //
     //  Upgrade all packages which specify an upgrade path.
     //
@@ -326,7 +343,8 @@ Exit:
 }
 
 /**
- Install a single package from a specified path to a package.
+ Install a single package from a specified path to a package, optionally
+ using a copy of the package that is being downloaded in advance.
 
  @param PackagePath The path of the package file to install.
 
@@ -334,12 +352,17 @@ Exit:
         install the package.  If NULL, the directory containing the
         application is used.
 
+ @param Downloads Optionally points to a set of packages being downloaded in
+        advance.  If the package is in this set, its download is used rather
+        than downloading it again.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
-YoriPkgInstallSinglePackage(
+YoriPkgInstallSinglePackageFromSet(
     __in PYORI_STRING PackagePath,
-    __in_opt PCYORI_STRING TargetDirectory
+    __in_opt PCYORI_STRING TargetDirectory,
+    __in_opt PYORIPKG_DOWNLOAD_SET Downloads
     )
 {
     YORI_STRING PkgIniFile;
@@ -361,7 +384,9 @@ YoriPkgInstallSinglePackage(
     }
 
     Result = FALSE;
-    if (YoriLibIsPathUrl(PackagePath)) {
+    if (Downloads != NULL) {
+        YoriPkgMoveDownloadToSet(&PendingPackages.Downloads, Downloads, PackagePath);
+    } else if (YoriLibIsPathUrl(PackagePath)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading %y...\n"), PackagePath);
     }
     Error = YoriPkgPreparePackageForInstall(&PkgIniFile, TargetDirectory, &PendingPackages, PackagePath, NULL);
@@ -384,6 +409,98 @@ Exit:
     return Result;
 }
 
+/**
+ Install a single package from a specified path to a package.
+
+ @param PackagePath The path of the package file to install.
+
+ @param TargetDirectory Pointer to a string specifying the directory to
+        install the package.  If NULL, the directory containing the
+        application is used.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriPkgInstallSinglePackage(
+    __in PYORI_STRING PackagePath,
+    __in_opt PCYORI_STRING TargetDirectory
+    )
+{
+    return YoriPkgInstallSinglePackageFromSet(PackagePath, TargetDirectory, NULL);
+}
+
+/**
+ Install a set of packages in order, each as a separate installation.  All
+ remote packages start downloading in the background immediately, so each
+ package is installed while the packages following it are still being
+ downloaded.  Installation stops at the first package that fails.
+
+ @param PackagePaths An array of paths to package files to install.
+
+ @param PackageCount The number of elements in the PackagePaths array.
+
+ @param TargetDirectory Pointer to a string specifying the directory to
+        install the packages.  If NULL, the directory containing the
+        application is used.
+
+ @param ProgressCallback Optionally points to a function to invoke before
+        each package is installed.
+
+ @param ProgressContext Context to pass to ProgressCallback.
+
+ @param PackagesInstalled On completion, set to the number of packages which
+        were installed successfully.  If this function fails, this is the
+        index of the package that could not be installed.
+
+ @return TRUE to indicate all packages were installed, FALSE to indicate
+         failure.
+ */
+BOOL
+YoriPkgInstallPackageSet(
+    __in PYORI_STRING PackagePaths,
+    __in YORI_ALLOC_SIZE_T PackageCount,
+    __in_opt PCYORI_STRING TargetDirectory,
+    __in_opt PYORIPKG_INSTALL_PROGRESS_FN ProgressCallback,
+    __in_opt PVOID ProgressContext,
+    __out PYORI_ALLOC_SIZE_T PackagesInstalled
+    )
+{
+    YORIPKG_DOWNLOAD_SET Downloads;
+    YORI_STRING PkgIniFile;
+    YORI_ALLOC_SIZE_T Index;
+    BOOL Result;
+
+    *PackagesInstalled = 0;
+
+    if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
+        return FALSE;
+    }
+
+    YoriPkgInitializeDownloadSet(&Downloads);
+    for (Index = 0; Index < PackageCount; Index++) {
+        YoriPkgAddDownloadToSet(&Downloads, &PackagePaths[Index], &PkgIniFile);
+    }
+
+    YoriPkgStartDownloadsInSet(&Downloads);
+
+    Result = TRUE;
+    for (Index = 0; Index < PackageCount; Index++) {
+        if (ProgressCallback != NULL) {
+            ProgressCallback(Index, PackageCount, &PackagePaths[Index], ProgressContext);
+        }
+        if (!YoriPkgInstallSinglePackageFromSet(&PackagePaths[Index], TargetDirectory, &Downloads)) {
+            Result = FALSE;
+            break;
+        }
+        *PackagesInstalled = Index + 1;
+    }
+
+    YoriPkgFreeDownloadSet(&Downloads);
+    YoriLibFreeStringContents(&PkgIniFile);
+
+    return Result;
+}
+
 
 /**
  Install source for all installed packages in the system.
@@ -840,18 +957,15 @@ YoriPkgListInstalledPackages(
     YORI_STRING PkgNameOnly;
     YORI_STRING PkgVersion;
     YORI_STRING PkgArch;
-
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
-        return FALSE;
-    }
+    YORI_STRING PkgSection;
+    YORI_STRING SectionName;
 
     if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+    YoriLibConstantString(&SectionName, _T("Installed"));
+    if (!YoriPkgGetIndexedIniSection(&PkgIniFile, &SectionName, &InstalledSection)) {
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
@@ -862,12 +976,6 @@ YoriPkgListInstalledPackages(
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile.StartOfString);
-
     YoriLibInitEmptyString(&PkgNameOnly);
     YoriLibInitEmptyString(&PkgVersion);
     ThisLine = InstalledSection.StartOfString;
@@ -890,13 +998,13 @@ YoriPkgListInstalledPackages(
 
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        PkgArch.LengthInChars = (YORI_ALLOC_SIZE_T)
-            DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                  _T("Architecture"),
-                                                  _T(""),
-                                                  PkgArch.StartOfString,
-                                                  PkgArch.LengthAllocated,
-                                                  PkgIniFile.StartOfString);
+        PkgArch.LengthInChars = 0;
+        if (Verbose &&
+            YoriPkgGetIndexedIniSection(&PkgIniFile, &PkgNameOnly, &PkgSection)) {
+
+            YoriPkgCopyIniSectionValue(&PkgSection, _T("Architecture"), &PkgArch);
+            YoriLibFreeStringContents(&PkgSection);
+        }
 
         if (Verbose) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y (%y)\n"), &PkgNameOnly, &PkgVersion, &PkgArch);
@@ -908,6 +1016,7 @@ YoriPkgListInstalledPackages(
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&PkgArch);
+    YoriPkgInvalidateInstalledIndex();
 
     return TRUE;
 }
@@ -1158,7 +1267,7 @@ YoriPkgInstallPseudoPackage(
     }
     YoriLibSPrintf(FileIndexString, _T("%i"), FileCount);
     DllKernel32.pWritePrivateProfileStringW(Name->StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
-
+    YoriPkgInvalidateInstalledIndex();
 
     YoriLibFreeStringContents(&PkgIniFile);
 
@@ -77,7 +77,9 @@ YoriPkgDeleteRenamedFiles(
         ASSERT(YoriLibIsStringNullTerminated(&BackupFile->OriginalName));
         ASSERT(YoriLibIsStringNullTerminated(&BackupFile->OriginalRelativeName));
 
-        if (BackupFile->BackupName.LengthInChars > 0) {
+        if (BackupFile->BackupName.LengthInChars > 0 &&
+            !BackupFile->RestoredToOriginalName) {
+
             ASSERT(YoriLibIsStringNullTerminated(&BackupFile->BackupName));
             DeleteFile(BackupFile->BackupName.StartOfString);
         }
@@ -91,6 +93,37 @@ YoriPkgDeleteRenamedFiles(
     }
 }
 
+/**
+ Rename any backed up files which were reused by a new package installation
+ back to their backup names.  This is used when rolling back an installation
+ so that deleting the new package does not delete the reused files, and the
+ subsequent rollback can restore them along with every other backed up file.
+ Note this routine is best effort and continues on error.
+
+ @param PackageBackup Pointer to the backed up package.
+ */
+VOID
+YoriPkgReturnRestoredFilesToBackupNames(
+    __in PYORIPKG_BACKUP_PACKAGE PackageBackup
+    )
+{
+    PYORI_LIST_ENTRY ListEntry = NULL;
+    PYORIPKG_BACKUP_FILE BackupFile;
+
+    ListEntry = YoriLibGetNextListEntry(&PackageBackup->FileList, ListEntry);
+    while (ListEntry != NULL) {
+        BackupFile = CONTAINING_RECORD(ListEntry, YORIPKG_BACKUP_FILE, ListEntry);
+        if (BackupFile->RestoredToOriginalName) {
+            ASSERT(YoriLibIsStringNullTerminated(&BackupFile->OriginalName));
+            ASSERT(YoriLibIsStringNullTerminated(&BackupFile->BackupName));
+            if (MoveFile(BackupFile->OriginalName.StartOfString, BackupFile->BackupName.StartOfString)) {
+                BackupFile->RestoredToOriginalName = FALSE;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&PackageBackup->FileList, ListEntry);
+    }
+}
+
 /**
  Rename all backed up files back into their original location.  Optionally
  this also restores each file entry back into the INI file.  Note this routine
@@ -245,6 +278,7 @@ YoriPkgRollbackPackage(
     //
 
     DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageBackup->PackageName.StartOfString, PackageBackup->Version.StartOfString, IniPath->StartOfString);
+    YoriPkgInvalidateInstalledIndex();
 }
 
 /**
@@ -281,10 +315,11 @@ YoriPkgBackupPackage(
     PYORIPKG_BACKUP_PACKAGE Context;
     PYORIPKG_BACKUP_FILE BackupFile;
     YORI_STRING FullTargetDirectory;
-    YORI_STRING IniValue;
+    YORI_STRING Section;
+    PYORI_STRING FileNames;
+    PYORI_STRING IniValue;
     DWORD FileIndex;
     DWORD Err;
-    TCHAR FileIndexString[16];
 
     if (DllKernel32.pGetPrivateProfileIntW == NULL ||
         DllKernel32.pGetPrivateProfileStringW == NULL ||
@@ -339,36 +374,28 @@ YoriPkgBackupPackage(
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
-    Context->FileCount = DllKernel32.pGetPrivateProfileIntW(Context->PackageName.StartOfString, _T("FileCount"), 0, IniPath->StartOfString);
-    if (Context->FileCount == 0) {
-        Err = GetLastError();
+    if (!YoriPkgGetPackageFileList(IniPath, &Context->PackageName, &Section, &FileNames, &Context->FileCount)) {
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
-        return Err;
+        return ERROR_NOT_ENOUGH_MEMORY;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+    if (Context->FileCount == 0) {
+        YoriLibFreeStringContents(&Section);
+        YoriLibFree(FileNames);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
-        return ERROR_NOT_ENOUGH_MEMORY;
+        return ERROR_MOD_NOT_FOUND;
     }
 
     for (FileIndex = 1; FileIndex <= Context->FileCount; FileIndex++) {
-        YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
-
-        IniValue.LengthInChars = (YORI_ALLOC_SIZE_T)
-            DllKernel32.pGetPrivateProfileStringW(Context->PackageName.StartOfString,
-                                                  FileIndexString,
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  IniPath->StartOfString);
+        IniValue = &FileNames[FileIndex - 1];
 
         //
         //  Don't backup files with absolute paths
         //
 
-        if (YoriLibIsPathPrefixed(&IniValue)) {
+        if (YoriLibIsPathPrefixed(IniValue)) {
             continue;
         }
 
@@ -376,18 +403,20 @@ YoriPkgBackupPackage(
         if (BackupFile == NULL) {
             YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
             YoriLibFreeStringContents(&FullTargetDirectory);
-            YoriLibFreeStringContents(&IniValue);
+            YoriLibFreeStringContents(&Section);
+            YoriLibFree(FileNames);
             YoriPkgFreeBackupPackage(Context);
             return ERROR_NOT_ENOUGH_MEMORY;
         }
 
         ZeroMemory(BackupFile, sizeof(YORIPKG_BACKUP_FILE));
 
-        YoriLibYPrintf(&BackupFile->OriginalName, _T("%y\\%y"), &FullTargetDirectory, &IniValue);
+        YoriLibYPrintf(&BackupFile->OriginalName, _T("%y\\%y"), &FullTargetDirectory, IniValue);
         if (BackupFile->OriginalName.LengthInChars == 0) {
             YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
             YoriLibFreeStringContents(&FullTargetDirectory);
-            YoriLibFreeStringContents(&IniValue);
+            YoriLibFreeStringContents(&Section);
+            YoriLibFree(FileNames);
             YoriLibDereference(BackupFile);
             YoriPkgFreeBackupPackage(Context);
             return ERROR_NOT_ENOUGH_MEMORY;
@@ -404,7 +433,8 @@ YoriPkgBackupPackage(
                 YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
                 YoriLibFreeStringContents(&BackupFile->OriginalName);
                 YoriLibFreeStringContents(&FullTargetDirectory);
-                YoriLibFreeStringContents(&IniValue);
+                YoriLibFreeStringContents(&Section);
+                YoriLibFree(FileNames);
                 YoriLibDereference(BackupFile);
                 YoriPkgFreeBackupPackage(Context);
                 return Err;
@@ -415,7 +445,8 @@ YoriPkgBackupPackage(
 
     }
     YoriLibFreeStringContents(&FullTargetDirectory);
-    YoriLibFreeStringContents(&IniValue);
+    YoriLibFreeStringContents(&Section);
+    YoriLibFree(FileNames);
 
     *PackageBackup = Context;
     return ERROR_SUCCESS;
@@ -442,6 +473,7 @@ YoriPkgRemoveSystemReferencesToPackage(
 
     DllKernel32.pWritePrivateProfileStringW(PackageBackup->PackageName.StartOfString, NULL, NULL, IniPath->StartOfString);
     DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageBackup->PackageName.StartOfString, NULL, IniPath->StartOfString);
+    YoriPkgInvalidateInstalledIndex();
 }
 
 /**
@@ -475,6 +507,7 @@ YoriPkgRollbackAndFreeBackupPackageList(
     while (ListEntry != NULL) {
         BackupPackage = CONTAINING_RECORD(ListEntry, YORIPKG_BACKUP_PACKAGE, PackageList);
         ListEntry = YoriLibGetNextListEntry(ListHead, ListEntry);
+        YoriPkgReturnRestoredFilesToBackupNames(BackupPackage);
         YoriPkgDeletePackage(NewDirectory, &BackupPackage->PackageName, FALSE);
         YoriPkgRollbackPackage(IniPath, BackupPackage);
         YoriLibRemoveListItem(&BackupPackage->PackageList);
@@ -623,33 +656,18 @@ YoriPkgAddExistingFilesToPendingPackages(
     LPTSTR ThisLine;
     LPTSTR Equals;
     YORI_STRING PkgNameOnly;
-    YORI_STRING IniValue;
+    YORI_STRING PackageSection;
+    PYORI_STRING FileNames;
     YORI_ALLOC_SIZE_T LineLength;
+    YORI_STRING SectionName;
     DWORD FileCount;
     DWORD FileIndex;
-    TCHAR FileIndexString[16];
 
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileSectionW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL) {
+    YoriLibConstantString(&SectionName, _T("Installed"));
+    if (!YoriPkgGetIndexedIniSection(PkgIniFile, &SectionName, &InstalledSection)) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
-        return FALSE;
-    }
-
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
-        YoriLibFreeStringContents(&InstalledSection);
-        return FALSE;
-    }
-
-    InstalledSection.LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileSectionW(_T("Installed"),
-                                               InstalledSection.StartOfString,
-                                               InstalledSection.LengthAllocated,
-                                               PkgIniFile->StartOfString);
-
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
 
@@ -666,28 +684,25 @@ YoriPkgAddExistingFilesToPendingPackages(
         ThisLine++;
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        FileCount = DllKernel32.pGetPrivateProfileIntW(PkgNameOnly.StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
-
-        for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
-            YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
+        if (!YoriPkgGetPackageFileList(PkgIniFile, &PkgNameOnly, &PackageSection, &FileNames, &FileCount)) {
+            YoriLibFreeStringContents(&InstalledSection);
+            return FALSE;
+        }
 
-            IniValue.LengthInChars = (YORI_ALLOC_SIZE_T)
-                DllKernel32.pGetPrivateProfileStringW(PkgNameOnly.StartOfString,
-                                                      FileIndexString,
-                                                      _T(""),
-                                                      IniValue.StartOfString,
-                                                      IniValue.LengthAllocated,
-                                                      PkgIniFile->StartOfString);
-            if (!YoriPkgAddExistingFileToPendingPackages(PendingPackages, &IniValue)) {
+        for (FileIndex = 0; FileIndex < FileCount; FileIndex++) {
+            if (!YoriPkgAddExistingFileToPendingPackages(PendingPackages, &FileNames[FileIndex])) {
+                YoriLibFreeStringContents(&PackageSection);
+                YoriLibFree(FileNames);
                 YoriLibFreeStringContents(&InstalledSection);
-                YoriLibFreeStringContents(&IniValue);
                 return FALSE;
             }
         }
+
+        YoriLibFreeStringContents(&PackageSection);
+        YoriLibFree(FileNames);
     }
 
     YoriLibFreeStringContents(&InstalledSection);
-    YoriLibFreeStringContents(&IniValue);
 
     return TRUE;
 }
@@ -709,7 +724,8 @@ YoriPkgInitializePendingPackages(
     YoriLibInitializeListHead(&PendingPackages->PackageList);
     YoriLibInitializeListHead(&PendingPackages->BackupPackages);
     YoriLibInitializeListHead(&PendingPackages->KnownPackages);
-    PendingPackages->ExistingFilesTable = YoriLibAllocateHashTable(253);
+    YoriPkgInitializeDownloadSet(&PendingPackages->Downloads);
+    PendingPackages->ExistingFilesTable = YoriLibAllocateHashTable(1021);
     if (PendingPackages->ExistingFilesTable == NULL) {
         return FALSE;
     }
@@ -745,6 +761,7 @@ YoriPkgDeletePendingPackage(
     YoriLibFreeStringContents(&PendingPackage->SymbolPath);
     YoriLibFreeStringContents(&PendingPackage->UpgradeToDailyPath);
     YoriLibFreeStringContents(&PendingPackage->UpgradeToStablePath);
+    YoriLibFreeStringContents(&PendingPackage->FileHashes);
     YoriLibFree(PendingPackage);
 }
 
@@ -773,6 +790,7 @@ YoriPkgDeletePendingPackages(
     ASSERT(YoriLibIsListEmpty(&PendingPackages->BackupPackages));
 
     YoriPkgFreeAllSourcesAndPackages(NULL, &PendingPackages->KnownPackages);
+    YoriPkgFreeDownloadSet(&PendingPackages->Downloads);
 
     ListEntry = YoriLibGetNextListEntry(&PendingPackages->PackageList, ListEntry);
     while (ListEntry != NULL) {
@@ -790,6 +808,50 @@ YoriPkgDeletePendingPackages(
     }
 }
 
+/**
+ Load the hashes of files within a package from its pkginfo.ini.  Packages
+ created by older versions of this tool do not contain hashes, in which case
+ no hashes are loaded and every file is extracted on installation.  Note this
+ routine is best effort, since failing to load hashes only implies that files
+ will be extracted from the package.
+
+ @param PkgInfoFile Pointer to the pkginfo.ini file extracted from the
+        package.
+
+ @param PendingPackage Pointer to the package awaiting installation.  On
+        success, its FileHashes member is populated.
+ */
+VOID
+YoriPkgLoadFileHashes(
+    __in PCYORI_STRING PkgInfoFile,
+    __inout PYORIPKG_PACKAGE_PENDING_INSTALL PendingPackage
+    )
+{
+    ASSERT(DllKernel32.pGetPrivateProfileSectionW != NULL);
+    ASSERT(YoriLibIsStringNullTerminated(PkgInfoFile));
+
+    if (!YoriLibAllocateString(&PendingPackage->FileHashes, YORIPKG_MAX_SECTION_LENGTH)) {
+        return;
+    }
+
+    PendingPackage->FileHashes.LengthInChars = (YORI_ALLOC_SIZE_T)
+        DllKernel32.pGetPrivateProfileSectionW(_T("FileHashes"),
+                                               PendingPackage->FileHashes.StartOfString,
+                                               PendingPackage->FileHashes.LengthAllocated,
+                                               PkgInfoFile->StartOfString);
+
+    //
+    //  If the section doesn't exist, or is too large to be returned in
+    //  full, don't use it.
+    //
+
+    if (PendingPackage->FileHashes.LengthInChars == 0 ||
+        PendingPackage->FileHashes.LengthInChars + 2 >= PendingPackage->FileHashes.LengthAllocated) {
+
+        YoriLibFreeStringContents(&PendingPackage->FileHashes);
+    }
+}
+
 /**
  Given a package URL, download if necessary, extract metadata, check if an
  existing package needs to be upgraded or replaced, back up any packages that
@@ -881,7 +943,14 @@ YoriPkgPreparePackageForInstall(
     }
     ZeroMemory(PendingPackage, sizeof(YORIPKG_PACKAGE_PENDING_INSTALL));
 
-    Result = YoriPkgPackagePathToLocalPath(PackageUrl, PkgIniFile, &PendingPackage->LocalPackagePath, &PendingPackage->DeleteLocalPackagePath);
+    //
+    //  Use a copy of the package that was downloaded in advance if there is
+    //  one, otherwise download it now.
+    //
+
+    if (!YoriPkgTakeDownloadFromSet(&PackageList->Downloads, PackageUrl, &PendingPackage->LocalPackagePath, &PendingPackage->DeleteLocalPackagePath)) {
+        Result = YoriPkgPackagePathToLocalPath(PackageUrl, PkgIniFile, &PendingPackage->LocalPackagePath, &PendingPackage->DeleteLocalPackagePath);
+    }
     if (Result != ERROR_SUCCESS) {
         YoriLibFree(PendingPackage);
         return Result;
@@ -906,7 +975,7 @@ YoriPkgPreparePackageForInstall(
     //
 
     YoriLibInitEmptyString(&ErrorString);
-    if (!YoriLibExtractCab(&PendingPackage->LocalPackagePath, &TempPath, FALSE, 0, NULL, 1, &PkgInfoFile, NULL, NULL, NULL, &Result, &ErrorString)) {
+    if (!YoriLibExtractCab(&PendingPackage->LocalPackagePath, &TempPath, FALSE, 0, NULL, 1, &PkgInfoFile, NULL, NULL, NULL, 0, &Result, &ErrorString)) {
         YoriLibFreeStringContents(&ErrorString);
         goto Exit;
     }
@@ -1057,6 +1126,16 @@ YoriPkgPreparePackageForInstall(
     YoriLibFreeStringContents(&ReplacesList);
     YoriLibFreeStringContents(&PkgInstalled);
 
+    //
+    //  If any packages were backed up, capture the hashes of files in the
+    //  new package, if it has them, so that installation can reuse any
+    //  backed up files which have not changed.
+    //
+
+    if (!YoriLibIsListEmpty(&PackageList->BackupPackages)) {
+        YoriPkgLoadFileHashes(&TempPath, PendingPackage);
+    }
+
     DeleteFile(TempPath.StartOfString);
     YoriLibFreeStringContents(&TempPath);
 
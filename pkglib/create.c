@@ -28,6 +28,97 @@
 #include <yorilib.h>
 #include "yoripkgp.h"
 
+/**
+ Parse a line from a file list describing the files to include in a package.
+ If the line contains a pipe character, the text before it is the file path
+ to store in the cab, and the text after it is the name to use within the
+ cab.  If there's no pipe character, the same string is used for both
+ meanings.
+
+ @param LineString On input, points to the line read from the file list.  On
+        output, updated to refer to the path of the file to store in the cab.
+
+ @param FileNameInCab On output, updated to refer to the name to use within
+        the cab.  This points into the LineString allocation.
+ */
+VOID
+YoriPkgParseFileListLine(
+    __inout PYORI_STRING LineString,
+    __out PYORI_STRING FileNameInCab
+    )
+{
+    YORI_ALLOC_SIZE_T Count;
+
+    YoriLibInitEmptyString(FileNameInCab);
+    FileNameInCab->StartOfString = LineString->StartOfString;
+    FileNameInCab->LengthInChars = LineString->LengthInChars;
+
+    for (Count = 0; Count < LineString->LengthInChars; Count++) {
+        if (LineString->StartOfString[Count] == '|') {
+            FileNameInCab->StartOfString = &LineString->StartOfString[Count + 1];
+            FileNameInCab->LengthInChars = LineString->LengthInChars - Count - 1;
+
+            LineString->LengthInChars = Count;
+            break;
+        }
+    }
+}
+
+/**
+ Record the hash of each file in a binary package into its pkginfo.ini.  When
+ the package is used to upgrade a previous version, files whose hashes match
+ the previously installed copy are reused rather than extracted.  Note this
+ routine is best effort: any file which cannot be hashed is left without a
+ hash, and will be extracted on installation.
+
+ @param FileListSource Handle to the file list describing the files in the
+        package.  On completion, the file pointer is returned to the start of
+        the file.
+
+ @param PkgInfoFile Pointer to the pkginfo.ini file to record hashes in.
+ */
+VOID
+YoriPkgAddFileHashesToPkgInfo(
+    __in HANDLE FileListSource,
+    __in PYORI_STRING PkgInfoFile
+    )
+{
+    YORI_STRING LineString;
+    YORI_STRING FileNameInCab;
+    YORI_STRING FullPath;
+    YORI_STRING Hash;
+    PVOID LineContext = NULL;
+
+    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
+
+    YoriLibInitEmptyString(&LineString);
+    while(TRUE) {
+        if (!YoriLibReadLineToString(&LineString, &LineContext, FileListSource)) {
+            break;
+        }
+
+        YoriPkgParseFileListLine(&LineString, &FileNameInCab);
+        if (FileNameInCab.LengthInChars == 0) {
+            continue;
+        }
+
+        if (!YoriLibUserStringToSingleFilePath(&LineString, FALSE, &FullPath)) {
+            continue;
+        }
+
+        if (YoriPkgHashFile(&FullPath, &Hash)) {
+            FileNameInCab.StartOfString[FileNameInCab.LengthInChars] = '\0';
+            DllKernel32.pWritePrivateProfileStringW(_T("FileHashes"), FileNameInCab.StartOfString, Hash.StartOfString, PkgInfoFile->StartOfString);
+            YoriLibFreeStringContents(&Hash);
+        }
+        YoriLibFreeStringContents(&FullPath);
+    }
+
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    SetFilePointer(FileListSource, 0, NULL, FILE_BEGIN);
+}
+
 /**
  Creates a binary (installable) package.  This could be architecture specific
  or architecture neutral.
@@ -192,6 +283,8 @@ YoriPkgCreateBinaryPackage(
 
     YoriLibFreeStringContents(&FullFileListFile);
 
+    YoriPkgAddFileHashesToPkgInfo(FileListSource, &TempFile);
+
     if (!YoriLibCreateCab(FileName, &CabHandle)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("YoriLibCreateCab failure\n"));
         DeleteFile(TempFile.StartOfString);
@@ -216,25 +309,7 @@ YoriPkgCreateBinaryPackage(
             break;
         }
 
-        FileNameInCab.StartOfString = LineString.StartOfString;
-        FileNameInCab.LengthInChars = LineString.LengthInChars;
-
-        //
-        //  If there's a pipe character, treat all of the text before it as
-        //  the file path to store in the cab, and all of the text after it
-        //  as the name to use within the cab.  If there's no pipe character,
-        //  the same string is used for both meanings.
-        //
-
-        for (Count = 0; Count < LineString.LengthInChars; Count++) {
-            if (LineString.StartOfString[Count] == '|') {
-                FileNameInCab.StartOfString = &LineString.StartOfString[Count + 1];
-                FileNameInCab.LengthInChars = LineString.LengthInChars - Count - 1;
-
-                LineString.LengthInChars = Count;
-                break;
-            }
-        }
+        YoriPkgParseFileListLine(&LineString, &FileNameInCab);
 
         if (!YoriLibAddFileToCab(CabHandle, &LineString, &FileNameInCab)) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("YoriLibAddFileToCab cannot add %y\n"), &LineString);
@@ -0,0 +1,548 @@
+/**
+ * @file pkglib/download.c
+ *
+ * Yori package manager concurrent package download support
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "yoripkgp.h"
+
+/**
+ The maximum number of packages to download at once.
+ */
+#define YORIPKG_MAX_CONCURRENT_DOWNLOADS 8
+
+/**
+ The maximum number of packages to download at once from a single server.
+ */
+#define YORIPKG_MAX_DOWNLOADS_PER_HOST 4
+
+/**
+ Initialize a set of downloads.
+
+ @param DownloadSet Pointer to the download set to initialize.
+ */
+VOID
+YoriPkgInitializeDownloadSet(
+    __out PYORIPKG_DOWNLOAD_SET DownloadSet
+    )
+{
+    YoriLibInitializeListHead(&DownloadSet->DownloadList);
+    YoriLibInitializeListHead(&DownloadSet->HostList);
+    DownloadSet->WorkQueueActive = FALSE;
+}
+
+/**
+ Find the host name component of a URL, being the text between the scheme
+ and the first following path separator.
+
+ @param Url Pointer to the URL.
+
+ @param HostName On successful completion, updated to point to the host name
+        within the URL.  This is not referenced and does not need to be
+        freed.
+
+ @return TRUE to indicate a host name was found, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriPkgGetUrlHostName(
+    __in PCYORI_STRING Url,
+    __out PYORI_STRING HostName
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T Start;
+
+    for (Index = 0; Index + 2 < Url->LengthInChars; Index++) {
+        if (Url->StartOfString[Index] == ':' &&
+            Url->StartOfString[Index + 1] == '/' &&
+            Url->StartOfString[Index + 2] == '/') {
+
+            break;
+        }
+    }
+
+    if (Index + 2 >= Url->LengthInChars) {
+        return FALSE;
+    }
+
+    Start = Index + 3;
+    for (Index = Start; Index < Url->LengthInChars; Index++) {
+        if (Url->StartOfString[Index] == '/') {
+            break;
+        }
+    }
+
+    if (Index == Start) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(HostName);
+    HostName->StartOfString = &Url->StartOfString[Start];
+    HostName->LengthInChars = Index - Start;
+    return TRUE;
+}
+
+/**
+ Find the entry for a host within a download set, creating it if it does not
+ exist.
+
+ @param DownloadSet Pointer to the download set.
+
+ @param HostName Pointer to the name of the host.
+
+ @return Pointer to the host entry, or NULL on allocation failure.
+ */
+PYORIPKG_DOWNLOAD_HOST
+YoriPkgFindOrCreateDownloadHost(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet,
+    __in PCYORI_STRING HostName
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD_HOST Host;
+
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->HostList, NULL);
+    while (ListEntry != NULL) {
+        Host = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD_HOST, HostList);
+        if (YoriLibCompareStringInsensitive(&Host->HostName, HostName) == 0) {
+            return Host;
+        }
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->HostList, ListEntry);
+    }
+
+    Host = YoriLibMalloc(sizeof(YORIPKG_DOWNLOAD_HOST));
+    if (Host == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Host, sizeof(YORIPKG_DOWNLOAD_HOST));
+    if (!YoriLibCopyString(&Host->HostName, HostName)) {
+        YoriLibFree(Host);
+        return NULL;
+    }
+
+    Host->Semaphore = CreateSemaphore(NULL, YORIPKG_MAX_DOWNLOADS_PER_HOST, YORIPKG_MAX_DOWNLOADS_PER_HOST, NULL);
+    if (Host->Semaphore == NULL) {
+        YoriLibFreeStringContents(&Host->HostName);
+        YoriLibFree(Host);
+        return NULL;
+    }
+
+    YoriLibAppendList(&DownloadSet->HostList, &Host->HostList);
+    return Host;
+}
+
+/**
+ Add a package to a set of packages to download.  Packages that are already
+ in the set are not added twice.  Packages which are not remote are
+ recorded, but are not downloaded in advance.
+
+ @param DownloadSet Pointer to the download set.
+
+ @param PackageUrl Pointer to the path of the package as specified by the
+        caller.  This is the path used to find the download later.
+
+ @param PkgIniFile Optionally points to the system global INI file, which is
+        used to find any mirror for the package.
+
+ @return TRUE to indicate the package was added, FALSE on allocation
+         failure.
+ */
+__success(return)
+BOOL
+YoriPkgAddDownloadToSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet,
+    __in PYORI_STRING PackageUrl,
+    __in_opt PCYORI_STRING PkgIniFile
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
+    YORI_STRING HostName;
+
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        if (YoriLibCompareString(&Download->PackageUrl, PackageUrl) == 0) {
+            return TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, ListEntry);
+    }
+
+    Download = YoriLibMalloc(sizeof(YORIPKG_DOWNLOAD));
+    if (Download == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Download, sizeof(YORIPKG_DOWNLOAD));
+    if (!YoriLibCopyString(&Download->PackageUrl, PackageUrl)) {
+        YoriLibFree(Download);
+        return FALSE;
+    }
+
+    if (PkgIniFile == NULL ||
+        !YoriPkgConvertUserPackagePathToMirroredPath(PackageUrl, PkgIniFile, &Download->SourceUrl)) {
+
+        YoriLibCloneString(&Download->SourceUrl, &Download->PackageUrl);
+    }
+
+    //
+    //  Only remote packages have a host and are downloaded in advance.
+    //
+
+    if (YoriLibIsPathUrl(&Download->SourceUrl) &&
+        YoriPkgGetUrlHostName(&Download->SourceUrl, &HostName)) {
+
+        Download->Host = YoriPkgFindOrCreateDownloadHost(DownloadSet, &HostName);
+    }
+
+    Download->Error = ERROR_NOT_READY;
+    YoriLibAppendList(&DownloadSet->DownloadList, &Download->DownloadList);
+    return TRUE;
+}
+
+/**
+ Download a single package.  This is invoked on a worker thread, and waits
+ for a connection to the package's host to be available before downloading.
+
+ @param Context Unused.
+
+ @param Item Pointer to the work item within the download to perform.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the package
+        should not be downloaded.
+ */
+VOID
+YoriPkgDownloadWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PYORIPKG_DOWNLOAD Download;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    Download = CONTAINING_RECORD(Item, YORIPKG_DOWNLOAD, WorkItem);
+    if (Cancelled) {
+        Download->Error = ERROR_CANCELLED;
+    } else {
+        WaitForSingleObject(Download->Host->Semaphore, INFINITE);
+        YoriLibInitEmptyString(&Download->LocalPath);
+        Download->Error = YoriPkgPackagePathToLocalPath(&Download->SourceUrl, NULL, &Download->LocalPath, &Download->DeleteWhenFinished);
+        ReleaseSemaphore(Download->Host->Semaphore, 1, NULL);
+    }
+
+    //
+    //  Once this is signalled the download can be taken by another thread,
+    //  so it must not be touched afterwards.
+    //
+
+    SetEvent(Download->Complete);
+}
+
+/**
+ Wait for a download which may be in progress in the background to finish.
+ Once this returns, the download is owned by the calling thread.
+
+ @param Download Pointer to the download.
+ */
+VOID
+YoriPkgWaitForDownload(
+    __in PYORIPKG_DOWNLOAD Download
+    )
+{
+    if (Download->Complete != NULL) {
+        WaitForSingleObject(Download->Complete, INFINITE);
+        CloseHandle(Download->Complete);
+        Download->Complete = NULL;
+    }
+}
+
+/**
+ Start downloading all remote packages within a download set concurrently,
+ without waiting for the downloads to finish.  This allows the caller to
+ install each package as soon as it is available while the remaining
+ packages continue to download.  Failures are recorded against each package,
+ and packages which could not be downloaded here are downloaded again when
+ they are used, which allows any error to be reported in context.
+
+ @param DownloadSet Pointer to the download set.
+ */
+VOID
+YoriPkgStartDownloadsInSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
+    YORI_ALLOC_SIZE_T RemoteCount;
+    YORI_ALLOC_SIZE_T ThreadCount;
+
+    if (DownloadSet->WorkQueueActive) {
+        return;
+    }
+
+    RemoteCount = 0;
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        if (Download->Host != NULL) {
+            RemoteCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, ListEntry);
+    }
+
+    //
+    //  A single package gains nothing from a worker thread.  Leave it to be
+    //  downloaded when it is used.
+    //
+
+    if (RemoteCount < 2) {
+        return;
+    }
+
+    //
+    //  Load the network functions before any worker thread can, since
+    //  loading them is not synchronized.
+    //
+
+    YoriLibLoadWinInetFunctions();
+    YoriLibLoadWinHttpFunctions();
+
+    if (DllWinInet.pInternetOpenW == NULL && DllWinHttp.pWinHttpOpen == NULL) {
+        return;
+    }
+
+    ThreadCount = RemoteCount;
+    if (ThreadCount > YORIPKG_MAX_CONCURRENT_DOWNLOADS) {
+        ThreadCount = YORIPKG_MAX_CONCURRENT_DOWNLOADS;
+    }
+
+    //
+    //  Allow every package to be queued so that queueing never waits for
+    //  a download to finish.
+    //
+
+    DownloadSet->WorkQueueActive = TRUE;
+    if (!YoriLibInitializeWorkQueue(&DownloadSet->WorkQueue, ThreadCount, RemoteCount, YoriPkgDownloadWorker, NULL)) {
+        return;
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading packages...\n"));
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, ListEntry);
+        if (Download->Host == NULL) {
+            continue;
+        }
+
+        //
+        //  If the item cannot be queued, leave it to be downloaded when
+        //  it is used.
+        //
+
+        Download->Complete = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Download->Complete == NULL) {
+            continue;
+        }
+
+        if (!YoriLibQueueWorkItem(&DownloadSet->WorkQueue, &Download->WorkItem, TRUE)) {
+            CloseHandle(Download->Complete);
+            Download->Complete = NULL;
+            if (YoriLibIsOperationCancelled()) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ Download all remote packages within a download set concurrently, and wait
+ for all of the downloads to finish.
+
+ @param DownloadSet Pointer to the download set.
+ */
+VOID
+YoriPkgDownloadAllInSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    )
+{
+    YoriPkgStartDownloadsInSet(DownloadSet);
+    if (DownloadSet->WorkQueueActive) {
+        YoriLibWaitForWorkQueue(&DownloadSet->WorkQueue);
+        YoriLibCleanupWorkQueue(&DownloadSet->WorkQueue);
+        DownloadSet->WorkQueueActive = FALSE;
+    }
+}
+
+/**
+ Find a package which has been downloaded in advance and take ownership of
+ its local copy.
+
+ @param DownloadSet Pointer to the download set.
+
+ @param PackageUrl Pointer to the path of the package as specified by the
+        caller.
+
+ @param LocalPath On successful completion, updated to contain the path to a
+        local copy of the package.
+
+ @param DeleteWhenFinished On successful completion, set to TRUE if the
+        local copy is a temporary file that the caller should delete when it
+        is no longer needed.
+
+ @return TRUE to indicate a local copy was found, FALSE if the package was
+         not downloaded in advance and should be downloaded by the caller.
+ */
+__success(return)
+BOOL
+YoriPkgTakeDownloadFromSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet,
+    __in PCYORI_STRING PackageUrl,
+    __out PYORI_STRING LocalPath,
+    __out PBOOLEAN DeleteWhenFinished
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
+
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        if (YoriLibCompareString(&Download->PackageUrl, PackageUrl) == 0) {
+            YoriPkgWaitForDownload(Download);
+            if (Download->Error != ERROR_SUCCESS) {
+                return FALSE;
+            }
+
+            memcpy(LocalPath, &Download->LocalPath, sizeof(YORI_STRING));
+            *DeleteWhenFinished = Download->DeleteWhenFinished;
+            YoriLibInitEmptyString(&Download->LocalPath);
+            Download->DeleteWhenFinished = FALSE;
+            Download->Error = ERROR_NOT_READY;
+            return TRUE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, ListEntry);
+    }
+
+    return FALSE;
+}
+
+/**
+ Move a package from one download set to another, waiting for any download
+ in progress to finish.  This allows a package downloaded as part of a
+ larger set to be installed as part of a smaller operation.  If the package
+ is not in the source set, this does nothing.
+
+ @param TargetSet Pointer to the download set to move the package to.
+
+ @param SourceSet Pointer to the download set containing the package.
+
+ @param PackageUrl Pointer to the path of the package as specified by the
+        caller.
+ */
+VOID
+YoriPkgMoveDownloadToSet(
+    __inout PYORIPKG_DOWNLOAD_SET TargetSet,
+    __inout PYORIPKG_DOWNLOAD_SET SourceSet,
+    __in PCYORI_STRING PackageUrl
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
+
+    ListEntry = YoriLibGetNextListEntry(&SourceSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        if (YoriLibCompareString(&Download->PackageUrl, PackageUrl) == 0) {
+            YoriPkgWaitForDownload(Download);
+
+            //
+            //  The host belongs to the source set.  It is only needed to
+            //  perform the download, which has now finished.
+            //
+
+            YoriLibRemoveListItem(&Download->DownloadList);
+            Download->Host = NULL;
+            YoriLibAppendList(&TargetSet->DownloadList, &Download->DownloadList);
+            return;
+        }
+        ListEntry = YoriLibGetNextListEntry(&SourceSet->DownloadList, ListEntry);
+    }
+}
+
+/**
+ Free a set of downloads, deleting any downloaded packages which were not
+ used.  Any downloads which have not started are cancelled.
+
+ @param DownloadSet Pointer to the download set.
+ */
+VOID
+YoriPkgFreeDownloadSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORIPKG_DOWNLOAD Download;
+    PYORIPKG_DOWNLOAD_HOST Host;
+
+    if (DownloadSet->WorkQueueActive) {
+        YoriLibCancelWorkQueue(&DownloadSet->WorkQueue);
+        YoriLibCleanupWorkQueue(&DownloadSet->WorkQueue);
+        DownloadSet->WorkQueueActive = FALSE;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, NULL);
+    while (ListEntry != NULL) {
+        Download = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD, DownloadList);
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->DownloadList, ListEntry);
+        YoriLibRemoveListItem(&Download->DownloadList);
+        YoriPkgWaitForDownload(Download);
+
+        if (Download->Error == ERROR_SUCCESS && Download->DeleteWhenFinished) {
+            DeleteFile(Download->LocalPath.StartOfString);
+        }
+        YoriLibFreeStringContents(&Download->PackageUrl);
+        YoriLibFreeStringContents(&Download->SourceUrl);
+        YoriLibFreeStringContents(&Download->LocalPath);
+        YoriLibFree(Download);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&DownloadSet->HostList, NULL);
+    while (ListEntry != NULL) {
+        Host = CONTAINING_RECORD(ListEntry, YORIPKG_DOWNLOAD_HOST, HostList);
+        ListEntry = YoriLibGetNextListEntry(&DownloadSet->HostList, ListEntry);
+        YoriLibRemoveListItem(&Host->HostList);
+
+        CloseHandle(Host->Semaphore);
+        YoriLibFreeStringContents(&Host->HostName);
+        YoriLibFree(Host);
+    }
+}
+
+// vim:sw=4:ts=4:et:
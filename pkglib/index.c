@@ -0,0 +1,341 @@
+/**
+ * @file pkglib/index.c
+ *
+ * Yori package manager cached index of installed packages
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "yoripkgp.h"
+
+/**
+ The number of buckets in the hash table of cached package sections.
+ */
+#define YORIPKG_INDEX_HASH_BUCKETS (127)
+
+/**
+ A section of the system package INI file which has been read into memory.
+ */
+typedef struct _YORIPKG_INDEX_SECTION {
+
+    /**
+     The linkage for this section within the hash table of sections, keyed
+     by the section name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The name of the section.  This string contains a reference on the
+     parent structure.
+     */
+    YORI_STRING SectionName;
+
+    /**
+     The contents of the section, in the form returned by
+     GetPrivateProfileSection.
+     */
+    YORI_STRING Contents;
+} YORIPKG_INDEX_SECTION, *PYORIPKG_INDEX_SECTION;
+
+/**
+ An index of the system package INI file.  Each section is read from the INI
+ file the first time it is queried, and subsequent queries are satisfied from
+ memory.  The index is discarded if the INI file is modified.
+ */
+typedef struct _YORIPKG_INSTALLED_INDEX {
+
+    /**
+     The path to the INI file that has been indexed.
+     */
+    YORI_STRING IniPath;
+
+    /**
+     The last write time of the INI file when the index was populated.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The size of the INI file when the index was populated.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     A hash table of sections that have been read from the INI file.
+     */
+    PYORI_HASH_TABLE Sections;
+} YORIPKG_INSTALLED_INDEX, *PYORIPKG_INSTALLED_INDEX;
+
+/**
+ The index of the system package INI file for this process.
+ */
+YORIPKG_INSTALLED_INDEX YoriPkgInstalledIndex;
+
+/**
+ Discard all cached information about the system package INI file.  This is
+ called after any modification to the INI file, and should be called when
+ package operations are complete to release memory.
+ */
+VOID
+YoriPkgInvalidateInstalledIndex(VOID)
+{
+    DWORD BucketIndex;
+    PYORI_HASH_BUCKET Bucket;
+    PYORIPKG_INDEX_SECTION Section;
+
+    if (YoriPkgInstalledIndex.Sections != NULL) {
+        for (BucketIndex = 0; BucketIndex < YoriPkgInstalledIndex.Sections->NumberBuckets; BucketIndex++) {
+            Bucket = &YoriPkgInstalledIndex.Sections->Buckets[BucketIndex];
+            while (!YoriLibIsListEmpty(&Bucket->ListHead)) {
+                Section = CONTAINING_RECORD(Bucket->ListHead.Next, YORIPKG_INDEX_SECTION, HashEntry.ListEntry);
+                YoriLibHashRemoveByEntry(&Section->HashEntry);
+                YoriLibFreeStringContents(&Section->Contents);
+                YoriLibDereference(Section);
+            }
+        }
+        YoriLibFreeEmptyHashTable(YoriPkgInstalledIndex.Sections);
+        YoriPkgInstalledIndex.Sections = NULL;
+    }
+
+    YoriLibFreeStringContents(&YoriPkgInstalledIndex.IniPath);
+}
+
+/**
+ Ensure the index describes the current contents of the specified INI file.
+ If the index describes a different file, or the file has been modified
+ since the index was populated, the index is discarded.
+
+ @param IniPath Pointer to the system package INI file.
+
+ @return TRUE to indicate the index is ready to use, FALSE if it could not
+         be initialized.
+ */
+__success(return)
+BOOL
+YoriPkgRefreshInstalledIndex(
+    __in PCYORI_STRING IniPath
+    )
+{
+    WIN32_FILE_ATTRIBUTE_DATA FileInfo;
+
+    ASSERT(YoriLibIsStringNullTerminated(IniPath));
+
+    if (!GetFileAttributesEx(IniPath->StartOfString, GetFileExInfoStandard, &FileInfo)) {
+        ZeroMemory(&FileInfo, sizeof(FileInfo));
+    }
+
+    if (YoriPkgInstalledIndex.Sections != NULL) {
+        if (YoriLibCompareStringInsensitive(&YoriPkgInstalledIndex.IniPath, IniPath) == 0 &&
+            YoriPkgInstalledIndex.LastWriteTime.dwLowDateTime == FileInfo.ftLastWriteTime.dwLowDateTime &&
+            YoriPkgInstalledIndex.LastWriteTime.dwHighDateTime == FileInfo.ftLastWriteTime.dwHighDateTime &&
+            YoriPkgInstalledIndex.FileSize.LowPart == FileInfo.nFileSizeLow &&
+            (DWORD)YoriPkgInstalledIndex.FileSize.HighPart == FileInfo.nFileSizeHigh) {
+
+            return TRUE;
+        }
+
+        YoriPkgInvalidateInstalledIndex();
+    }
+
+    if (!YoriLibCopyString(&YoriPkgInstalledIndex.IniPath, IniPath)) {
+        return FALSE;
+    }
+
+    YoriPkgInstalledIndex.Sections = YoriLibAllocateHashTable(YORIPKG_INDEX_HASH_BUCKETS);
+    if (YoriPkgInstalledIndex.Sections == NULL) {
+        YoriLibFreeStringContents(&YoriPkgInstalledIndex.IniPath);
+        return FALSE;
+    }
+
+    YoriPkgInstalledIndex.LastWriteTime.dwLowDateTime = FileInfo.ftLastWriteTime.dwLowDateTime;
+    YoriPkgInstalledIndex.LastWriteTime.dwHighDateTime = FileInfo.ftLastWriteTime.dwHighDateTime;
+    YoriPkgInstalledIndex.FileSize.LowPart = FileInfo.nFileSizeLow;
+    YoriPkgInstalledIndex.FileSize.HighPart = (LONG)FileInfo.nFileSizeHigh;
+
+    return TRUE;
+}
+
+/**
+ Return the contents of a section of the system package INI file, reading it
+ from the INI file if it has not been read previously.
+
+ @param IniPath Pointer to the system package INI file.
+
+ @param SectionName Pointer to the name of the section to return.  This must
+        be NULL terminated.
+
+ @param Contents On successful completion, populated with a newly allocated
+        copy of the section, in the form returned by GetPrivateProfileSection.
+        The caller may modify this copy and should free it with
+        @ref YoriLibFreeStringContents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgGetIndexedIniSection(
+    __in PCYORI_STRING IniPath,
+    __in PCYORI_STRING SectionName,
+    __out PYORI_STRING Contents
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PYORIPKG_INDEX_SECTION Section;
+    YORI_ALLOC_SIZE_T SectionSize;
+
+    ASSERT(YoriLibIsStringNullTerminated(SectionName));
+
+    if (DllKernel32.pGetPrivateProfileSectionW == NULL) {
+        return FALSE;
+    }
+
+    if (!YoriPkgRefreshInstalledIndex(IniPath)) {
+        return FALSE;
+    }
+
+    HashEntry = YoriLibHashLookupByKey(YoriPkgInstalledIndex.Sections, SectionName);
+    if (HashEntry != NULL) {
+        Section = HashEntry->Context;
+    } else {
+
+        Section = YoriLibReferencedMalloc(sizeof(YORIPKG_INDEX_SECTION) + (SectionName->LengthInChars + 1) * sizeof(TCHAR));
+        if (Section == NULL) {
+            return FALSE;
+        }
+        ZeroMemory(Section, sizeof(YORIPKG_INDEX_SECTION));
+
+        //
+        //  Read the section, growing the buffer if the section is too large
+        //  to be returned in full.
+        //
+
+        SectionSize = YORIPKG_MAX_SECTION_LENGTH;
+        while (TRUE) {
+            if (!YoriLibAllocateString(&Section->Contents, SectionSize)) {
+                YoriLibDereference(Section);
+                return FALSE;
+            }
+
+            Section->Contents.LengthInChars = (YORI_ALLOC_SIZE_T)
+                DllKernel32.pGetPrivateProfileSectionW(SectionName->StartOfString,
+                                                       Section->Contents.StartOfString,
+                                                       Section->Contents.LengthAllocated,
+                                                       IniPath->StartOfString);
+
+            if (Section->Contents.LengthInChars + 2 < Section->Contents.LengthAllocated) {
+                break;
+            }
+
+            YoriLibFreeStringContents(&Section->Contents);
+            if (SectionSize > YORI_MAX_ALLOC_SIZE / sizeof(TCHAR) / 2) {
+                YoriLibDereference(Section);
+                return FALSE;
+            }
+            SectionSize = SectionSize * 2;
+        }
+
+        //
+        //  Ensure the section is terminated by an empty entry even if it
+        //  contains no entries.
+        //
+
+        Section->Contents.StartOfString[Section->Contents.LengthInChars] = '\0';
+        Section->Contents.StartOfString[Section->Contents.LengthInChars + 1] = '\0';
+
+        YoriLibInitEmptyString(&Section->SectionName);
+        Section->SectionName.MemoryToFree = Section;
+        Section->SectionName.StartOfString = (LPTSTR)(Section + 1);
+        Section->SectionName.LengthInChars = SectionName->LengthInChars;
+        Section->SectionName.LengthAllocated = SectionName->LengthInChars + 1;
+        memcpy(Section->SectionName.StartOfString, SectionName->StartOfString, SectionName->LengthInChars * sizeof(TCHAR));
+        Section->SectionName.StartOfString[SectionName->LengthInChars] = '\0';
+
+        YoriLibHashInsertByKey(YoriPkgInstalledIndex.Sections, &Section->SectionName, Section, &Section->HashEntry);
+    }
+
+    //
+    //  Return a copy including the terminating empty entry.
+    //
+
+    if (!YoriLibAllocateString(Contents, Section->Contents.LengthInChars + 2)) {
+        return FALSE;
+    }
+
+    memcpy(Contents->StartOfString, Section->Contents.StartOfString, (Section->Contents.LengthInChars + 2) * sizeof(TCHAR));
+    Contents->LengthInChars = Section->Contents.LengthInChars;
+    return TRUE;
+}
+
+/**
+ Find the value associated with a key within a section that has been read
+ from an INI file.
+
+ @param Section Pointer to the contents of the section, in the form returned
+        by GetPrivateProfileSection.
+
+ @param Key Pointer to the key to find.
+
+ @param Value On successful completion, updated to refer to the value.  This
+        string points into the Section allocation and is NULL terminated.
+
+ @return TRUE to indicate the key was found, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriPkgGetIniSectionValue(
+    __in PCYORI_STRING Section,
+    __in LPCTSTR Key,
+    __out PYORI_STRING Value
+    )
+{
+    YORI_STRING ThisKey;
+    YORI_ALLOC_SIZE_T LineLength;
+    LPTSTR ThisLine;
+    LPTSTR Equals;
+
+    YoriLibInitEmptyString(Value);
+    if (Section->LengthInChars == 0) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&ThisKey);
+    ThisLine = Section->StartOfString;
+    while (*ThisLine != '\0') {
+        LineLength = (YORI_ALLOC_SIZE_T)_tcslen(ThisLine);
+        Equals = _tcschr(ThisLine, '=');
+        if (Equals != NULL) {
+            ThisKey.StartOfString = ThisLine;
+            ThisKey.LengthInChars = (YORI_ALLOC_SIZE_T)(Equals - ThisLine);
+            if (YoriLibCompareStringWithLiteralInsensitive(&ThisKey, Key) == 0) {
+                Value->StartOfString = Equals + 1;
+                Value->LengthInChars = LineLength - ThisKey.LengthInChars - 1;
+                Value->LengthAllocated = Value->LengthInChars + 1;
+                return TRUE;
+            }
+        }
+        ThisLine += LineLength + 1;
+    }
+
+    return FALSE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -342,29 +342,26 @@ YoriPkgDeletePackageInternal(
     )
 {
     YORI_STRING AppPath;
-    YORI_STRING IniValue;
+    YORI_STRING Section;
+    PYORI_STRING FileNames;
+    PYORI_STRING IniValue;
     YORI_STRING FileToDelete;
     PYORI_STRING FileBeingDeleted;
     DWORD FileCount;
     DWORD FileIndex;
-    TCHAR FileIndexString[16];
     DWORD DeleteResult;
     BOOL BestEffortDelete;
+    YORI_STRING BestEffortValue;
+    YORI_MAX_SIGNED_T Number;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
-    if (DllKernel32.pGetPrivateProfileIntW == NULL ||
-        DllKernel32.pGetPrivateProfileStringW == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
+    if (DllKernel32.pWritePrivateProfileStringW == NULL) {
 
         return ERROR_PROC_NOT_FOUND;
     }
 
-    if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
-        return ERROR_NOT_ENOUGH_MEMORY;
-    }
-
     if (TargetDirectory == NULL) {
         if (!YoriPkgGetApplicationDirectory(&AppPath)) {
-            YoriLibFreeStringContents(&IniValue);
             return ERROR_NOT_ENOUGH_MEMORY;
         }
     } else {
@@ -376,38 +373,43 @@ YoriPkgDeletePackageInternal(
         AppPath.LengthInChars = TargetDirectory->LengthInChars;
     }
 
-    BestEffortDelete = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("BestEffortDelete"), 0, PkgIniFile->StartOfString);
+    if (!YoriPkgGetPackageFileList(PkgIniFile, PackageName, &Section, &FileNames, &FileCount)) {
+        YoriLibFreeStringContents(&AppPath);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
 
-    FileCount = DllKernel32.pGetPrivateProfileIntW(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
     if (FileCount == 0) {
+        YoriLibFreeStringContents(&Section);
+        YoriLibFree(FileNames);
         YoriLibFreeStringContents(&AppPath);
-        YoriLibFreeStringContents(&IniValue);
         return ERROR_MOD_NOT_FOUND;
     }
 
+    BestEffortDelete = FALSE;
+    if (YoriPkgGetIniSectionValue(&Section, _T("BestEffortDelete"), &BestEffortValue)) {
+        if (YoriLibStringToNumber(&BestEffortValue, FALSE, &Number, &CharsConsumed) &&
+            Number != 0) {
+
+            BestEffortDelete = TRUE;
+        }
+    }
+
     YoriLibInitEmptyString(&FileToDelete);
     if (!YoriLibAllocateString(&FileToDelete, AppPath.LengthInChars + YORIPKG_MAX_FIELD_LENGTH)) {
         YoriLibFreeStringContents(&AppPath);
-        YoriLibFreeStringContents(&IniValue);
+        YoriLibFreeStringContents(&Section);
+        YoriLibFree(FileNames);
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
     for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
-        YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
-
-        IniValue.LengthInChars = (YORI_ALLOC_SIZE_T)
-            DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                                  FileIndexString,
-                                                  _T(""),
-                                                  IniValue.StartOfString,
-                                                  IniValue.LengthAllocated,
-                                                  PkgIniFile->StartOfString);
-        if (IniValue.LengthInChars > 0) {
-            if (!YoriLibIsPathPrefixed(&IniValue)) {
-                YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, &IniValue);
+        IniValue = &FileNames[FileIndex - 1];
+        if (IniValue->LengthInChars > 0) {
+            if (!YoriLibIsPathPrefixed(IniValue)) {
+                YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, IniValue);
                 FileBeingDeleted = &FileToDelete;
             } else {
-                FileBeingDeleted = &IniValue;
+                FileBeingDeleted = IniValue;
             }
             DeleteResult = YoriPkgDeleteInstalledPackageFile(FileBeingDeleted);
 
@@ -440,29 +442,26 @@ YoriPkgDeletePackageInternal(
             //
 
             if (DeleteResult != ERROR_SUCCESS && !BestEffortDelete && FileIndex == 1) {
-                YoriLibFreeStringContents(&IniValue);
+                YoriLibFreeStringContents(&Section);
+                YoriLibFree(FileNames);
                 YoriLibFreeStringContents(&AppPath);
                 YoriLibFreeStringContents(&FileToDelete);
                 return DeleteResult;
             }
         }
-
-        DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, FileIndexString, NULL, PkgIniFile->StartOfString);
     }
 
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("FileCount"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("Architecture"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("SourcePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("SymbolPath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradeToDailyPath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("UpgradeToStablePath"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, _T("Version"), NULL, PkgIniFile->StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageName->StartOfString, NULL, PkgIniFile->StartOfString);
+    //
+    //  Remove the package's entire section in one update rather than
+    //  rewriting the INI file for each entry.
+    //
 
+    DllKernel32.pWritePrivateProfileStringW(_T("Installed"), PackageName->StartOfString, NULL, PkgIniFile->StartOfString);
     DllKernel32.pWritePrivateProfileStringW(PackageName->StartOfString, NULL, NULL, PkgIniFile->StartOfString);
+    YoriPkgInvalidateInstalledIndex();
 
-    YoriLibFreeStringContents(&IniValue);
+    YoriLibFreeStringContents(&Section);
+    YoriLibFree(FileNames);
     YoriLibFreeStringContents(&AppPath);
     YoriLibFreeStringContents(&FileToDelete);
 
@@ -491,12 +490,23 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
      */
     PYORI_STRING PackageName;
 
+    /**
+     The package being installed.
+     */
+    PYORIPKG_PACKAGE_PENDING_INSTALL Package;
+
     /**
      The number of files installed as part of this package.  THis value is
      incremented each time a file is found.
      */
     DWORD NumberFiles;
 
+    /**
+     The number of files in this package which were identical to a backed
+     up file, so the backed up file was reused instead of being extracted.
+     */
+    DWORD UnchangedFiles;
+
     /**
      If TRUE, files extracted from this package should be compressed.
      */
@@ -507,6 +517,20 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
      */
     BOOL ConflictingFileFound;
 
+    /**
+     If TRUE, installation is aborted because memory could not be allocated
+     to record the files in the package.
+     */
+    BOOL AllocationFailed;
+
+    /**
+     The entries to write into the package's section of the INI file, in the
+     form used by WritePrivateProfileSection.  Entries are accumulated here
+     as files are extracted and the section is written once when the package
+     has been installed, rather than rewriting the INI file for every file.
+     */
+    YORI_STRING PackageSection;
+
     /**
      Context for background compression threads.
      */
@@ -514,6 +538,171 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
 
 } YORIPKG_INSTALL_PKG_CONTEXT, *PYORIPKG_INSTALL_PKG_CONTEXT;
 
+/**
+ Append a key and value to a buffer describing the contents of an INI
+ section, in the form used by WritePrivateProfileSection.  The buffer is
+ reallocated if needed, and is always terminated by an empty entry so it can
+ be written at any point.
+
+ @param Section Pointer to the buffer describing the section.
+
+ @param Key Pointer to the key to append.
+
+ @param Value Pointer to the value to append.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgAppendIniSectionEntry(
+    __inout PYORI_STRING Section,
+    __in LPCTSTR Key,
+    __in PCYORI_STRING Value
+    )
+{
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    YORI_ALLOC_SIZE_T NewLength;
+
+    CharsNeeded = (YORI_ALLOC_SIZE_T)_tcslen(Key) + 1 + Value->LengthInChars + 1;
+
+    if (Section->LengthInChars + CharsNeeded + 1 > Section->LengthAllocated) {
+        NewLength = Section->LengthAllocated * 2;
+        if (NewLength < Section->LengthInChars + CharsNeeded + 1) {
+            NewLength = Section->LengthInChars + CharsNeeded + 1024;
+        }
+        if (!YoriLibReallocateString(Section, NewLength)) {
+            return FALSE;
+        }
+    }
+
+    YoriLibSPrintf(&Section->StartOfString[Section->LengthInChars], _T("%s=%y"), Key, Value);
+    Section->LengthInChars = Section->LengthInChars + CharsNeeded;
+    Section->StartOfString[Section->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Find the hash of a file within a package being installed, as recorded in the
+ package's pkginfo.ini.
+
+ @param Package Pointer to the package being installed.
+
+ @param RelativePath The relative path name of the file as stored within the
+        package.
+
+ @param Hash On successful completion, updated to point to the hash of the
+        file.  This string points into the Package allocation and should not
+        be freed.
+
+ @return TRUE to indicate the hash was found, FALSE if the package does not
+         contain a hash for the file.
+ */
+__success(return)
+BOOL
+YoriPkgFindFileHash(
+    __in PYORIPKG_PACKAGE_PENDING_INSTALL Package,
+    __in PCYORI_STRING RelativePath,
+    __out PYORI_STRING Hash
+    )
+{
+    YORI_STRING FileName;
+    YORI_ALLOC_SIZE_T LineLength;
+    LPTSTR ThisLine;
+    LPTSTR Equals;
+
+    if (Package->FileHashes.LengthInChars == 0) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FileName);
+    ThisLine = Package->FileHashes.StartOfString;
+
+    while (*ThisLine != '\0') {
+        LineLength = (YORI_ALLOC_SIZE_T)_tcslen(ThisLine);
+        Equals = _tcschr(ThisLine, '=');
+        if (Equals != NULL) {
+            FileName.StartOfString = ThisLine;
+            FileName.LengthInChars = (YORI_ALLOC_SIZE_T)(Equals - ThisLine);
+            if (YoriLibCompareStringInsensitive(&FileName, RelativePath) == 0) {
+                YoriLibInitEmptyString(Hash);
+                Hash->StartOfString = Equals + 1;
+                Hash->LengthInChars = LineLength - FileName.LengthInChars - 1;
+                return TRUE;
+            }
+        }
+        ThisLine += LineLength + 1;
+    }
+
+    return FALSE;
+}
+
+/**
+ Check whether a file about to be installed is identical to a file which was
+ backed up from a previous version of a package.  If it is, the backed up
+ file is renamed back into place, so the new copy does not need to be
+ extracted.
+
+ @param InstallContext Pointer to the context describing the package being
+        installed.
+
+ @param RelativePath The relative path name of the file as stored within the
+        package.
+
+ @return TRUE to indicate the backed up file has been restored and
+         extraction should be skipped, FALSE to indicate the file should be
+         extracted.
+ */
+BOOL
+YoriPkgRestoreUnchangedFile(
+    __in PYORIPKG_INSTALL_PKG_CONTEXT InstallContext,
+    __in PYORI_STRING RelativePath
+    )
+{
+    PYORI_LIST_ENTRY PackageEntry;
+    PYORI_LIST_ENTRY FileEntry;
+    PYORIPKG_BACKUP_PACKAGE BackupPackage;
+    PYORIPKG_BACKUP_FILE BackupFile;
+    YORI_STRING NewHash;
+    YORI_STRING OldHash;
+    BOOL Result;
+
+    if (!YoriPkgFindFileHash(InstallContext->Package, RelativePath, &NewHash)) {
+        return FALSE;
+    }
+
+    PackageEntry = YoriLibGetNextListEntry(&InstallContext->PendingPackages->BackupPackages, NULL);
+    while (PackageEntry != NULL) {
+        BackupPackage = CONTAINING_RECORD(PackageEntry, YORIPKG_BACKUP_PACKAGE, PackageList);
+        FileEntry = YoriLibGetNextListEntry(&BackupPackage->FileList, NULL);
+        while (FileEntry != NULL) {
+            BackupFile = CONTAINING_RECORD(FileEntry, YORIPKG_BACKUP_FILE, ListEntry);
+            if (BackupFile->BackupName.LengthInChars > 0 &&
+                !BackupFile->RestoredToOriginalName &&
+                YoriLibCompareStringInsensitive(&BackupFile->OriginalRelativeName, RelativePath) == 0) {
+
+                if (!YoriPkgHashFile(&BackupFile->BackupName, &OldHash)) {
+                    return FALSE;
+                }
+
+                Result = FALSE;
+                if (YoriLibCompareStringInsensitive(&OldHash, &NewHash) == 0 &&
+                    MoveFile(BackupFile->BackupName.StartOfString, BackupFile->OriginalName.StartOfString)) {
+
+                    BackupFile->RestoredToOriginalName = TRUE;
+                    Result = TRUE;
+                }
+
+                YoriLibFreeStringContents(&OldHash);
+                return Result;
+            }
+            FileEntry = YoriLibGetNextListEntry(&BackupPackage->FileList, FileEntry);
+        }
+        PackageEntry = YoriLibGetNextListEntry(&InstallContext->PendingPackages->BackupPackages, PackageEntry);
+    }
+
+    return FALSE;
+}
+
 /**
  A callback function invoked for each file installed as part of a package.
 
@@ -536,9 +725,9 @@ YoriPkgInstallPackageFileCallback(
     PYORIPKG_INSTALL_PKG_CONTEXT InstallContext = (PYORIPKG_INSTALL_PKG_CONTEXT)Context;
     TCHAR FileIndexString[16];
 
-    ASSERT(DllKernel32.pWritePrivateProfileStringW != NULL);
+    if (InstallContext->ConflictingFileFound ||
+        InstallContext->AllocationFailed) {
 
-    if (InstallContext->ConflictingFileFound) {
         return FALSE;
     }
 
@@ -557,10 +746,21 @@ YoriPkgInstallPackageFileCallback(
     InstallContext->NumberFiles++;
     YoriLibSPrintf(FileIndexString, _T("File%i"), InstallContext->NumberFiles);
 
-    DllKernel32.pWritePrivateProfileStringW(InstallContext->PackageName->StartOfString,
-                                            FileIndexString,
-                                            RelativePath->StartOfString,
-                                            InstallContext->IniFileName->StartOfString);
+    if (!YoriPkgAppendIniSectionEntry(&InstallContext->PackageSection, FileIndexString, RelativePath)) {
+        InstallContext->AllocationFailed = TRUE;
+        return FALSE;
+    }
+
+    //
+    //  If the file is unchanged from the version being replaced, put the
+    //  previous copy back rather than writing the same contents again.
+    //
+
+    if (YoriPkgRestoreUnchangedFile(InstallContext, RelativePath)) {
+        InstallContext->UnchangedFiles++;
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -623,6 +823,7 @@ YoriPkgInstallPackage(
     YORI_STRING FullTargetDirectory;
 
     YORI_STRING ErrorString;
+    YORI_STRING FileCountString;
     YORIPKG_INSTALL_PKG_CONTEXT InstallContext;
 
     DWORD Error = ERROR_SUCCESS;
@@ -635,13 +836,20 @@ YoriPkgInstallPackage(
 
     YoriLibInitEmptyString(&FullTargetDirectory);
     YoriLibInitEmptyString(&PkgIniFile);
+    YoriLibInitEmptyString(&InstallContext.PackageSection);
 
     if (DllKernel32.pGetPrivateProfileStringW == NULL ||
+        DllKernel32.pWritePrivateProfileSectionW == NULL ||
         DllKernel32.pWritePrivateProfileStringW == NULL) {
 
         goto Exit;
     }
 
+    if (!YoriLibAllocateString(&InstallContext.PackageSection, 4096)) {
+        goto Exit;
+    }
+    InstallContext.PackageSection.StartOfString[0] = '\0';
+
     //
     //  Create path to system packages.ini
     //
@@ -742,7 +950,9 @@ YoriPkgInstallPackage(
     InstallContext.PendingPackages = PendingPackages;
     InstallContext.IniFileName = &PkgIniFile;
     InstallContext.PackageName = &Package->PackageName;
+    InstallContext.Package = Package;
     InstallContext.NumberFiles = 0;
+    InstallContext.UnchangedFiles = 0;
     InstallContext.ConflictingFileFound = FALSE;
     YoriLibInitEmptyString(&ErrorString);
     if (!YoriLibExtractCab(&Package->LocalPackagePath,
@@ -755,6 +965,7 @@ YoriPkgInstallPackage(
                            YoriPkgInstallPackageFileCallback,
                            YoriPkgCompressPackageFileCallback,
                            &InstallContext,
+                           YORI_LIB_CAB_EXTRACT_PARALLEL_WRITE,
                            &Error,
                            &ErrorString)) {
 
@@ -794,41 +1005,51 @@ YoriPkgInstallPackage(
         goto Exit;
     }
 
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString, PkgIniFile.StartOfString);
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("Architecture"), Package->Architecture.StartOfString, PkgIniFile.StartOfString);
-    if (Package->UpgradePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString, PkgIniFile.StartOfString);
-    }
-    if (Package->SourcePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("SourcePath"), Package->SourcePath.StartOfString, PkgIniFile.StartOfString);
-    }
-    if (Package->SymbolPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("SymbolPath"), Package->SymbolPath.StartOfString, PkgIniFile.StartOfString);
-    }
-    if (Package->UpgradeToDailyPath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                _T("UpgradeToDailyPath"),
-                                                Package->UpgradeToDailyPath.StartOfString,
-                                                PkgIniFile.StartOfString);
-    }
+    //
+    //  Append the fixed headers for the package to the list of files and
+    //  write the package's entire section in a single update.
+    //
 
-    if (Package->UpgradeToStablePath.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString,
-                                                _T("UpgradeToStablePath"),
-                                                Package->UpgradeToStablePath.StartOfString,
-                                                PkgIniFile.StartOfString);
+    YoriLibSPrintf(FileIndexString, _T("%i"), InstallContext.NumberFiles);
+    YoriLibConstantString(&FileCountString, FileIndexString);
+
+    if (!YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("Version"), &Package->Version) ||
+        !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("Architecture"), &Package->Architecture) ||
+        !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("FileCount"), &FileCountString) ||
+        (Package->UpgradePath.LengthInChars > 0 &&
+         !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("UpgradePath"), &Package->UpgradePath)) ||
+        (Package->SourcePath.LengthInChars > 0 &&
+         !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("SourcePath"), &Package->SourcePath)) ||
+        (Package->SymbolPath.LengthInChars > 0 &&
+         !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("SymbolPath"), &Package->SymbolPath)) ||
+        (Package->UpgradeToDailyPath.LengthInChars > 0 &&
+         !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("UpgradeToDailyPath"), &Package->UpgradeToDailyPath)) ||
+        (Package->UpgradeToStablePath.LengthInChars > 0 &&
+         !YoriPkgAppendIniSectionEntry(&InstallContext.PackageSection, _T("UpgradeToStablePath"), &Package->UpgradeToStablePath))) {
+
+        InstallContext.AllocationFailed = TRUE;
     }
 
-    YoriLibSPrintf(FileIndexString, _T("%i"), InstallContext.NumberFiles);
+    if (InstallContext.AllocationFailed) {
+        DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, NULL, PkgIniFile.StartOfString);
+        YoriPkgDisplayErrorStringForInstallFailure(ERROR_NOT_ENOUGH_MEMORY);
+        goto Exit;
+    }
 
-    DllKernel32.pWritePrivateProfileStringW(Package->PackageName.StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
+    DllKernel32.pWritePrivateProfileSectionW(Package->PackageName.StartOfString, InstallContext.PackageSection.StartOfString, PkgIniFile.StartOfString);
     DllKernel32.pWritePrivateProfileStringW(_T("Installed"), Package->PackageName.StartOfString, Package->Version.StartOfString, PkgIniFile.StartOfString);
 
+    if (InstallContext.UnchangedFiles > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%i of %i files unchanged\n"), InstallContext.UnchangedFiles, InstallContext.NumberFiles);
+    }
+
     Result = TRUE;
 
 Exit:
+    YoriPkgInvalidateInstalledIndex();
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&FullTargetDirectory);
+    YoriLibFreeStringContents(&InstallContext.PackageSection);
     if (InstallContext.CompressFiles) {
         YoriLibFreeCompressContext(&InstallContext.CompressContext);
     }
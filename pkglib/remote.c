@@ -928,6 +928,7 @@ YoriPkgDownloadRemotePackages(
     YORI_ALLOC_SIZE_T Index;
     DWORD Err;
     BOOLEAN DeleteWhenFinished;
+    YORIPKG_DOWNLOAD_SET Downloads;
 
     if (DllKernel32.pWritePrivateProfileStringW == NULL) {
         return FALSE;
@@ -943,9 +944,21 @@ YoriPkgDownloadRemotePackages(
     }
 
     //
-    //  Download the packages we found.
+    //  Download the packages we found concurrently, then move each into
+    //  place and record it in order.
     //
 
+    YoriPkgInitializeDownloadSet(&Downloads);
+    PackageEntry = NULL;
+    PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
+    while (PackageEntry != NULL) {
+        Package = CONTAINING_RECORD(PackageEntry, YORIPKG_REMOTE_PACKAGE, PackageList);
+        YoriPkgAddDownloadToSet(&Downloads, &Package->InstallUrl, NULL);
+        PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
+    }
+
+    YoriPkgDownloadAllInSet(&Downloads);
+
     PackageEntry = NULL;
     PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     while (PackageEntry != NULL) {
@@ -974,7 +987,10 @@ YoriPkgDownloadRemotePackages(
             //
 
             YoriLibInitEmptyString(&TempLocalPath);
-            Err = YoriPkgPackagePathToLocalPath(&Package->InstallUrl, NULL, &TempLocalPath, &DeleteWhenFinished);
+            Err = ERROR_SUCCESS;
+            if (!YoriPkgTakeDownloadFromSet(&Downloads, &Package->InstallUrl, &TempLocalPath, &DeleteWhenFinished)) {
+                Err = YoriPkgPackagePathToLocalPath(&Package->InstallUrl, NULL, &TempLocalPath, &DeleteWhenFinished);
+            }
             if (Err == ERROR_SUCCESS) {
                 YoriLibYPrintf(&FullFinalName, _T("%y\\%y"), DownloadPath, &FinalFileName);
                 if (FullFinalName.LengthInChars == 0) {
@@ -1055,6 +1071,7 @@ YoriPkgDownloadRemotePackages(
         PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     }
 
+    YoriPkgFreeDownloadSet(&Downloads);
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
     YoriLibFreeStringContents(&PackagesIni);
 
@@ -1388,6 +1405,21 @@ YoriPkgInstallRemotePackages(
                                                      MatchArch,
                                                      &PackagesMatchingCriteria);
 
+    //
+    //  Download the packages concurrently.  Each is then processed below
+    //  in order.
+    //
+
+    PackageEntry = NULL;
+    PackageEntry = YoriLibGetNextListEntry(&PackagesMatchingCriteria, PackageEntry);
+    while (PackageEntry != NULL) {
+        Package = CONTAINING_RECORD(PackageEntry, YORIPKG_REMOTE_PACKAGE, PackageList);
+        PackageEntry = YoriLibGetNextListEntry(&PackagesMatchingCriteria, PackageEntry);
+        YoriPkgAddDownloadToSet(&PendingPackages.Downloads, &Package->InstallUrl, &IniFile);
+    }
+
+    YoriPkgDownloadAllInSet(&PendingPackages.Downloads);
+
     //
     //  Find if any of these are installed and back them up.
     //
@@ -331,6 +331,42 @@ YoriPkgGetPackageInfo(
     return TRUE;
 }
 
+/**
+ Copy the value associated with a key within an INI section into a caller
+ supplied buffer.  If the key is not found, the buffer is populated with an
+ empty string.  Values which do not fit in the buffer are truncated, as
+ GetPrivateProfileString would do.
+
+ @param Section Pointer to the contents of the section, in the form returned
+        by GetPrivateProfileSection.
+
+ @param Key Pointer to the key to find.
+
+ @param Value Pointer to a string with an allocated buffer to populate with
+        the value.  On completion, the string is NULL terminated.
+ */
+VOID
+YoriPkgCopyIniSectionValue(
+    __in PCYORI_STRING Section,
+    __in LPCTSTR Key,
+    __inout PYORI_STRING Value
+    )
+{
+    YORI_STRING Found;
+
+    ASSERT(Value->LengthAllocated > 0);
+
+    Value->LengthInChars = 0;
+    if (YoriPkgGetIniSectionValue(Section, Key, &Found)) {
+        Value->LengthInChars = Found.LengthInChars;
+        if (Value->LengthInChars >= Value->LengthAllocated) {
+            Value->LengthInChars = Value->LengthAllocated - 1;
+        }
+        memcpy(Value->StartOfString, Found.StartOfString, Value->LengthInChars * sizeof(TCHAR));
+    }
+    Value->StartOfString[Value->LengthInChars] = '\0';
+}
+
 /**
  Given a fully qualified path to the system package INI file and a package
  name, extract fixed sized information.
@@ -377,102 +413,61 @@ YoriPkgGetInstalledPackageInfo(
     )
 {
     YORI_STRING TempBuffer;
+    YORI_STRING Section;
     YORI_ALLOC_SIZE_T MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
 
     ASSERT(YoriLibIsStringNullTerminated(IniPath));
     ASSERT(YoriLibIsStringNullTerminated(PackageName));
 
-    if (DllKernel32.pGetPrivateProfileStringW == NULL) {
+    //
+    //  Read the package's section once and extract each field from it,
+    //  rather than parsing the INI file for each field.
+    //
+
+    if (!YoriPkgGetIndexedIniSection(IniPath, PackageName, &Section)) {
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&TempBuffer, 7 * MaxFieldSize)) {
+        YoriLibFreeStringContents(&Section);
         return FALSE;
     }
 
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->LengthAllocated = MaxFieldSize;
-
-    PackageVersion->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("Version"),
-                                              _T(""),
-                                              PackageVersion->StartOfString,
-                                              PackageVersion->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("Version"), PackageVersion);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 1 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
-
-    PackageArch->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("Architecture"),
-                                              _T(""),
-                                              PackageArch->StartOfString,
-                                              PackageArch->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("Architecture"), PackageArch);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 2 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
-
-    UpgradePath->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradePath"),
-                                              _T(""),
-                                              UpgradePath->StartOfString,
-                                              UpgradePath->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("UpgradePath"), UpgradePath);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 3 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
-
-    SourcePath->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SourcePath"),
-                                              _T(""),
-                                              SourcePath->StartOfString,
-                                              SourcePath->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("SourcePath"), SourcePath);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 4 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
-
-    SymbolPath->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("SymbolPath"),
-                                              _T(""),
-                                              SymbolPath->StartOfString,
-                                              SymbolPath->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("SymbolPath"), SymbolPath);
 
     YoriLibCloneString(UpgradeToDailyPath, &TempBuffer);
     UpgradeToDailyPath->StartOfString += 5 * MaxFieldSize;
     UpgradeToDailyPath->LengthAllocated = MaxFieldSize;
-
-    UpgradeToDailyPath->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradeToDailyPath"),
-                                              _T(""),
-                                              UpgradeToDailyPath->StartOfString,
-                                              UpgradeToDailyPath->LengthAllocated,
-                                              IniPath->StartOfString);
+    YoriPkgCopyIniSectionValue(&Section, _T("UpgradeToDailyPath"), UpgradeToDailyPath);
 
     YoriLibCloneString(UpgradeToStablePath, &TempBuffer);
-    UpgradeToStablePath->StartOfString += 5 * MaxFieldSize;
+    UpgradeToStablePath->StartOfString += 6 * MaxFieldSize;
     UpgradeToStablePath->LengthAllocated = MaxFieldSize;
+    YoriPkgCopyIniSectionValue(&Section, _T("UpgradeToStablePath"), UpgradeToStablePath);
 
-    UpgradeToStablePath->LengthInChars = (YORI_ALLOC_SIZE_T)
-        DllKernel32.pGetPrivateProfileStringW(PackageName->StartOfString,
-                                              _T("UpgradeToStablePath"),
-                                              _T(""),
-                                              UpgradeToStablePath->StartOfString,
-                                              UpgradeToStablePath->LengthAllocated,
-                                              IniPath->StartOfString);
-
+    YoriLibFreeStringContents(&Section);
     YoriLibFreeStringContents(&TempBuffer);
     return TRUE;
 }
@@ -1061,9 +1056,155 @@ Exit:
     return Result;
 }
 
+/**
+ The name of the directory within the temporary directory used to cache
+ remote packages and package lists.
+ */
+#define YORIPKG_CACHE_DIRECTORY _T("ypmcache")
+
+/**
+ The maximum length of a file extension to preserve from a URL when
+ generating the name of a file in the cache.
+ */
+#define YORIPKG_CACHE_MAX_EXTENSION 8
+
+/**
+ Generate the path to the local cache file for a remote URL, creating the
+ cache directory if it does not exist.  The file name is generated from a
+ hash of the URL, followed by any extension from the URL.
+
+ @param Url Pointer to the remote URL.
+
+ @param CachePath On successful completion, populated with a fully qualified
+        path to the cache file for the URL.  This file may not exist.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgGetCachePathForUrl(
+    __in PCYORI_STRING Url,
+    __out PYORI_STRING CachePath
+    )
+{
+    YORI_STRING CacheDirectory;
+    YORI_STRING Extension;
+    YORILIB_XXHASH64_CONTEXT HashContext;
+    DWORDLONG Hash;
+    YORI_ALLOC_SIZE_T Index;
+
+    YoriLibInitEmptyString(&CacheDirectory);
+    if (!YoriLibGetTempPath(&CacheDirectory, sizeof(YORIPKG_CACHE_DIRECTORY) / sizeof(TCHAR))) {
+        return FALSE;
+    }
+
+    YoriLibSPrintf(&CacheDirectory.StartOfString[CacheDirectory.LengthInChars], _T("%s"), YORIPKG_CACHE_DIRECTORY);
+    CacheDirectory.LengthInChars = CacheDirectory.LengthInChars + sizeof(YORIPKG_CACHE_DIRECTORY) / sizeof(TCHAR) - 1;
+
+    if (!CreateDirectory(CacheDirectory.StartOfString, NULL) &&
+        GetLastError() != ERROR_ALREADY_EXISTS) {
+
+        YoriLibFreeStringContents(&CacheDirectory);
+        return FALSE;
+    }
+
+    //
+    //  Keep the extension of the final path component, if it is short
+    //  enough to be an extension.
+    //
+
+    YoriLibInitEmptyString(&Extension);
+    for (Index = Url->LengthInChars; Index > 0; Index--) {
+        if (Url->StartOfString[Index - 1] == '/') {
+            break;
+        }
+        if (Url->StartOfString[Index - 1] == '.') {
+            if (Url->LengthInChars - Index + 1 <= YORIPKG_CACHE_MAX_EXTENSION) {
+                Extension.StartOfString = &Url->StartOfString[Index - 1];
+                Extension.LengthInChars = Url->LengthInChars - Index + 1;
+            }
+            break;
+        }
+    }
+
+    YoriLibXxHash64Initialize(&HashContext, 0);
+    YoriLibXxHash64Update(&HashContext, Url->StartOfString, Url->LengthInChars * sizeof(TCHAR));
+    Hash = YoriLibXxHash64Finalize(&HashContext);
+
+    YoriLibInitEmptyString(CachePath);
+    YoriLibYPrintf(CachePath, _T("%y\\%08x%08x%y"), &CacheDirectory, (DWORD)(Hash >> 32), (DWORD)Hash, &Extension);
+    YoriLibFreeStringContents(&CacheDirectory);
+
+    if (CachePath->LengthInChars == 0) {
+        YoriLibFreeStringContents(CachePath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Download a remote URL into the local cache.  If the cache already contains
+ a copy of the URL, the server is asked to send the object only if it has
+ changed since the cached copy was downloaded, so an unchanged object is
+ not transferred again.
+
+ @param Url Pointer to the remote URL.
+
+ @param CachePath Pointer to the cache file for the URL.
+
+ @return An update error code indicating success or appropriate error.  On
+         success, CachePath contains the current contents of the URL.
+ */
+YORI_LIB_UPDATE_ERROR
+YoriPkgDownloadToCache(
+    __in PCYORI_STRING Url,
+    __in PCYORI_STRING CachePath
+    )
+{
+    YORI_STRING UserAgent;
+    YORI_LIB_UPDATE_ERROR Error;
+    SYSTEMTIME CachedFileTime;
+    BOOLEAN CachedFileFound;
+    HANDLE hFile;
+
+    CachedFileFound = FALSE;
+    hFile = CreateFile(CachePath->StartOfString,
+                       FILE_READ_ATTRIBUTES | SYNCHRONIZE,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL,
+                       NULL);
+
+    if (hFile != INVALID_HANDLE_VALUE) {
+        FILETIME LastAccessTime;
+        FILETIME LastWriteTime;
+        FILETIME CreateTime;
+
+        if (GetFileTime(hFile, &CreateTime, &LastAccessTime, &LastWriteTime) &&
+            FileTimeToSystemTime(&LastWriteTime, &CachedFileTime)) {
+
+            CachedFileFound = TRUE;
+        }
+        CloseHandle(hFile);
+    }
+
+    YoriLibInitEmptyString(&UserAgent);
+    YoriLibYPrintf(&UserAgent, _T("ypm %i.%02i\r\n"), YORI_VER_MAJOR, YORI_VER_MINOR);
+    if (UserAgent.StartOfString == NULL) {
+        return YoriLibUpdErrorInetInit;
+    }
+
+    Error = YoriLibUpdateBinaryFromUrl(Url, CachePath, &UserAgent, CachedFileFound?&CachedFileTime:NULL);
+    YoriLibFreeStringContents(&UserAgent);
+    return Error;
+}
+
 /**
  Download a remote package into a temporary location and return the
- temporary location to allow for subsequent processing.
+ temporary location to allow for subsequent processing.  Remote packages are
+ kept in a local cache and only downloaded again if they have changed.
 
  @param PackagePath Pointer to a string referring to the package which can
         be local or remote.
@@ -1119,9 +1260,33 @@ YoriPkgPackagePathToLocalPath(
         YORI_STRING TempPath;
         YORI_STRING TempFileName;
         YORI_STRING UserAgent;
+        YORI_STRING CachePath;
         YORI_LIB_UPDATE_ERROR Error;
         YoriLibInitEmptyString(&TempPath);
 
+        //
+        //  Use the cache if possible.  The cached file is retained for
+        //  future use, so the caller should not delete it.  If the cache
+        //  cannot be written, fall back to a temporary file.
+        //
+
+        if (YoriPkgGetCachePathForUrl(&MirroredPath, &CachePath)) {
+            Error = YoriPkgDownloadToCache(&MirroredPath, &CachePath);
+            if (Error == YoriLibUpdErrorSuccess) {
+                memcpy(LocalPath, &CachePath, sizeof(YORI_STRING));
+                *DeleteWhenFinished = FALSE;
+                goto Exit;
+            }
+            YoriLibFreeStringContents(&CachePath);
+
+            if (Error != YoriLibUpdErrorFileWrite &&
+                Error != YoriLibUpdErrorFileReplace) {
+
+                Result = ERROR_NO_NETWORK;
+                goto Exit;
+            }
+        }
+
         //
         //  Query for a temporary directory
         //
@@ -1251,4 +1416,194 @@ YoriPkgDisplayErrorStringForInstallFailure(
     }
 }
 
+/**
+ Load the names of all files installed by a package from the system INI file.
+ The package's section is obtained from the index of the INI file, and each
+ File entry within it is located in memory, which avoids parsing the INI file
+ again for every file in the package.
+
+ @param IniPath Pointer to a path to the system's INI file.
+
+ @param PackageName Pointer to the package's canonical name.  This must be
+        NULL terminated.
+
+ @param Section On successful completion, populated with the contents of the
+        package's section.  The file names returned in FileNames point into
+        this allocation.  The caller should free this with
+        @ref YoriLibFreeStringContents.
+
+ @param FileNames On successful completion, populated with an array of
+        FileCount strings, where element zero describes File1.  Any entry
+        missing from the INI file is returned as an empty string.  Each
+        nonempty string is NULL terminated.  The caller should free this
+        with YoriLibFree.
+
+ @param FileCount On successful completion, populated with the number of
+        files in the package, as described by the package's FileCount entry.
+        This may be zero if the package is not installed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgGetPackageFileList(
+    __in PCYORI_STRING IniPath,
+    __in PCYORI_STRING PackageName,
+    __out PYORI_STRING Section,
+    __out PYORI_STRING * FileNames,
+    __out PDWORD FileCount
+    )
+{
+    YORI_STRING Key;
+    YORI_STRING Value;
+    YORI_ALLOC_SIZE_T LineLength;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    YORI_MAX_SIGNED_T FileIndex;
+    YORI_MAX_SIGNED_T Count;
+    PYORI_STRING Names;
+    LPTSTR ThisLine;
+    LPTSTR Equals;
+
+    if (!YoriPkgGetIndexedIniSection(IniPath, PackageName, Section)) {
+        return FALSE;
+    }
+
+    Count = 0;
+    if (YoriPkgGetIniSectionValue(Section, _T("FileCount"), &Value)) {
+        if (!YoriLibStringToNumber(&Value, FALSE, &Count, &CharsConsumed) ||
+            Count < 0 ||
+            (YORI_MAX_UNSIGNED_T)Count > YORI_MAX_ALLOC_SIZE / sizeof(YORI_STRING)) {
+
+            Count = 0;
+        }
+    }
+
+    Names = YoriLibMalloc((YORI_ALLOC_SIZE_T)Count * sizeof(YORI_STRING) + 1);
+    if (Names == NULL) {
+        YoriLibFreeStringContents(Section);
+        return FALSE;
+    }
+    ZeroMemory(Names, (YORI_ALLOC_SIZE_T)Count * sizeof(YORI_STRING));
+
+    YoriLibInitEmptyString(&Key);
+    ThisLine = Section->StartOfString;
+    while (*ThisLine != '\0') {
+        LineLength = (YORI_ALLOC_SIZE_T)_tcslen(ThisLine);
+        Equals = _tcschr(ThisLine, '=');
+        if (Equals != NULL) {
+            Key.StartOfString = ThisLine;
+            Key.LengthInChars = (YORI_ALLOC_SIZE_T)(Equals - ThisLine);
+
+            if (Key.LengthInChars > sizeof("File") - 1 &&
+                YoriLibCompareStringWithLiteralInsensitiveCount(&Key, _T("File"), sizeof("File") - 1) == 0) {
+
+                Key.StartOfString += sizeof("File") - 1;
+                Key.LengthInChars = Key.LengthInChars - (sizeof("File") - 1);
+
+                if (YoriLibStringToNumber(&Key, FALSE, &FileIndex, &CharsConsumed) &&
+                    CharsConsumed == Key.LengthInChars &&
+                    FileIndex >= 1 &&
+                    FileIndex <= Count) {
+
+                    Names[FileIndex - 1].StartOfString = Equals + 1;
+                    Names[FileIndex - 1].LengthInChars = LineLength - (YORI_ALLOC_SIZE_T)(Equals - ThisLine) - 1;
+                    Names[FileIndex - 1].LengthAllocated = Names[FileIndex - 1].LengthInChars + 1;
+                }
+            }
+        }
+        ThisLine += LineLength + 1;
+    }
+
+    *FileNames = Names;
+    *FileCount = (DWORD)Count;
+    return TRUE;
+}
+
+/**
+ The size of the buffer used to read files when generating a hash of their
+ contents.
+ */
+#define YORIPKG_HASH_BUFFER_SIZE (64 * 1024)
+
+/**
+ Generate a hash of the contents of a file.  This is used to record the
+ contents of each file within a package so that a later upgrade can detect
+ files which have not changed between versions.
+
+ @param FilePath Pointer to a fully specified, NULL terminated path to the
+        file to hash.
+
+ @param HashString On successful completion, updated to contain a newly
+        allocated string describing the hash of the file's contents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgHashFile(
+    __in PCYORI_STRING FilePath,
+    __out PYORI_STRING HashString
+    )
+{
+    YORILIB_XXHASH64_CONTEXT HashContext;
+    DWORDLONG Hash;
+    HANDLE FileHandle;
+    PUCHAR Buffer;
+    DWORD BytesRead;
+    BOOL Result;
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    FileHandle = CreateFile(FilePath->StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(YORIPKG_HASH_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    Result = TRUE;
+    YoriLibXxHash64Initialize(&HashContext, 0);
+    while (TRUE) {
+        if (!ReadFile(FileHandle, Buffer, YORIPKG_HASH_BUFFER_SIZE, &BytesRead, NULL)) {
+            Result = FALSE;
+            break;
+        }
+
+        if (BytesRead == 0) {
+            break;
+        }
+
+        YoriLibXxHash64Update(&HashContext, Buffer, BytesRead);
+    }
+
+    YoriLibFree(Buffer);
+    CloseHandle(FileHandle);
+
+    if (!Result) {
+        return FALSE;
+    }
+
+    Hash = YoriLibXxHash64Finalize(&HashContext);
+
+    YoriLibInitEmptyString(HashString);
+    YoriLibYPrintf(HashString, _T("%08x%08x"), (DWORD)(Hash >> 32), (DWORD)Hash);
+    if (HashString->LengthInChars == 0) {
+        YoriLibFreeStringContents(HashString);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 // vim:sw=4:ts=4:et:
@@ -34,6 +34,33 @@ typedef enum _YORIPKG_UPGRADE_PREFER {
     YoriPkgUpgradePreferDaily = 2
 } YORIPKG_UPGRADE_PREFER;
 
+/**
+ A function invoked before each package in a set is installed, allowing the
+ caller to report progress.
+
+ @param PackageIndex The zero based index of the package about to be
+        installed.
+
+ @param PackageCount The total number of packages in the set.
+
+ @param PackagePath Pointer to the path of the package about to be installed.
+
+ @param Context The context supplied by the caller.
+ */
+typedef
+VOID
+YORIPKG_INSTALL_PROGRESS_FN(
+    __in YORI_ALLOC_SIZE_T PackageIndex,
+    __in YORI_ALLOC_SIZE_T PackageCount,
+    __in PCYORI_STRING PackagePath,
+    __in_opt PVOID Context
+    );
+
+/**
+ A pointer to a function invoked before each package in a set is installed.
+ */
+typedef YORIPKG_INSTALL_PROGRESS_FN *PYORIPKG_INSTALL_PROGRESS_FN;
+
 BOOL
 YoriPkgCreateBinaryPackage(
     __in PYORI_STRING FileName,
@@ -73,6 +100,16 @@ YoriPkgInstallSinglePackage(
     __in_opt PCYORI_STRING TargetDirectory
     );
 
+BOOL
+YoriPkgInstallPackageSet(
+    __in PYORI_STRING PackagePaths,
+    __in YORI_ALLOC_SIZE_T PackageCount,
+    __in_opt PCYORI_STRING TargetDirectory,
+    __in_opt PYORIPKG_INSTALL_PROGRESS_FN ProgressCallback,
+    __in_opt PVOID ProgressContext,
+    __out PYORI_ALLOC_SIZE_T PackagesInstalled
+    );
+
 BOOL
 YoriPkgUpgradeInstalledPackages(
     __in YORIPKG_UPGRADE_PREFER Prefer,
@@ -54,6 +54,14 @@ typedef struct _YORIPKG_BACKUP_FILE {
      stored in the master .ini file for the file.
      */
     YORI_STRING OriginalRelativeName;
+
+    /**
+     TRUE if the backup file was found to be identical to the file in a
+     package being installed, so it has been renamed back to OriginalName
+     rather than extracting the new copy.  The file at BackupName no longer
+     exists, and the file at OriginalName must not be deleted on commit.
+     */
+    BOOLEAN RestoredToOriginalName;
 } YORIPKG_BACKUP_FILE, *PYORIPKG_BACKUP_FILE;
 
 /**
@@ -151,6 +159,115 @@ typedef struct _YORIPKG_EXISTING_FILE {
     YORI_STRING RelativeFileName;
 } YORIPKG_EXISTING_FILE, *PYORIPKG_EXISTING_FILE;
 
+/**
+ A server that packages are being downloaded from.  This is used to limit
+ the number of concurrent connections to any single server.
+ */
+typedef struct _YORIPKG_DOWNLOAD_HOST {
+
+    /**
+     The entry for this host within the download set.  Paired with
+     @ref YORIPKG_DOWNLOAD_SET::HostList .
+     */
+    YORI_LIST_ENTRY HostList;
+
+    /**
+     The name of the host, including any port.
+     */
+    YORI_STRING HostName;
+
+    /**
+     A semaphore which is acquired by each download from this host.
+     */
+    HANDLE Semaphore;
+} YORIPKG_DOWNLOAD_HOST, *PYORIPKG_DOWNLOAD_HOST;
+
+/**
+ A single package which may be downloaded before it is installed.
+ */
+typedef struct _YORIPKG_DOWNLOAD {
+
+    /**
+     The work item used to download this package on a worker thread.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     The entry for this package within the download set.  Paired with
+     @ref YORIPKG_DOWNLOAD_SET::DownloadList .
+     */
+    YORI_LIST_ENTRY DownloadList;
+
+    /**
+     The path to the package as specified by the caller.
+     */
+    YORI_STRING PackageUrl;
+
+    /**
+     The path to download the package from, after applying any mirror.
+     */
+    YORI_STRING SourceUrl;
+
+    /**
+     On successful download, the path to a local copy of the package.
+     */
+    YORI_STRING LocalPath;
+
+    /**
+     The server to download the package from.  If NULL, the package is not
+     remote and is not downloaded in advance.
+     */
+    PYORIPKG_DOWNLOAD_HOST Host;
+
+    /**
+     The result of the download.  This is ERROR_SUCCESS if LocalPath refers
+     to a local copy of the package.
+     */
+    DWORD Error;
+
+    /**
+     An event which is signalled once the download has finished.  This is
+     only created for downloads started in the background, and is NULL if
+     the download is not being performed in the background.
+     */
+    HANDLE Complete;
+
+    /**
+     TRUE if LocalPath refers to a temporary file which should be deleted
+     when it is no longer needed.
+     */
+    BOOLEAN DeleteWhenFinished;
+} YORIPKG_DOWNLOAD, *PYORIPKG_DOWNLOAD;
+
+/**
+ A set of packages to download concurrently before they are installed.
+ */
+typedef struct _YORIPKG_DOWNLOAD_SET {
+
+    /**
+     The list of packages to download, in the order they were added.
+     Paired with @ref YORIPKG_DOWNLOAD::DownloadList .
+     */
+    YORI_LIST_ENTRY DownloadList;
+
+    /**
+     The list of servers that packages are downloaded from.  Paired with
+     @ref YORIPKG_DOWNLOAD_HOST::HostList .
+     */
+    YORI_LIST_ENTRY HostList;
+
+    /**
+     The threads performing downloads in the background.  This is only
+     meaningful if WorkQueueActive is TRUE.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
+    /**
+     TRUE if WorkQueue has been initialized and may be performing downloads.
+     */
+    BOOLEAN WorkQueueActive;
+} YORIPKG_DOWNLOAD_SET, *PYORIPKG_DOWNLOAD_SET;
+
 /**
  A list of packages awaiting installation.  These have been downloaded and
  parsed, and any existing packages that conflict with the new packages have
@@ -188,6 +305,12 @@ typedef struct _YORIPKG_PACKAGES_PENDING_INSTALL {
      */
     PYORI_HASH_TABLE ExistingFilesTable;
 
+    /**
+     Packages which have been downloaded concurrently in advance of being
+     prepared for installation.
+     */
+    YORIPKG_DOWNLOAD_SET Downloads;
+
 } YORIPKG_PACKAGES_PENDING_INSTALL, *PYORIPKG_PACKAGES_PENDING_INSTALL;
 
 /**
@@ -277,6 +400,14 @@ typedef struct _YORIPKG_PACKAGE_PENDING_INSTALL {
      stored in a temporary location.
      */
     BOOLEAN DeleteLocalPackagePath;
+
+    /**
+     The contents of the FileHashes section of the package's pkginfo.ini,
+     in the form returned by GetPrivateProfileSection.  Each entry maps a
+     file name within the package to the hash of its contents.  This is an
+     empty string if the package does not describe the hashes of its files.
+     */
+    YORI_STRING FileHashes;
 } YORIPKG_PACKAGE_PENDING_INSTALL, *PYORIPKG_PACKAGE_PENDING_INSTALL;
 
 /**
@@ -397,6 +528,49 @@ YoriPkgDisplayErrorStringForInstallFailure(
     __in DWORD ErrorCode
     );
 
+__success(return)
+BOOL
+YoriPkgGetPackageFileList(
+    __in PCYORI_STRING IniPath,
+    __in PCYORI_STRING PackageName,
+    __out PYORI_STRING Section,
+    __out PYORI_STRING * FileNames,
+    __out PDWORD FileCount
+    );
+
+VOID
+YoriPkgInvalidateInstalledIndex(VOID);
+
+__success(return)
+BOOL
+YoriPkgGetIndexedIniSection(
+    __in PCYORI_STRING IniPath,
+    __in PCYORI_STRING SectionName,
+    __out PYORI_STRING Contents
+    );
+
+__success(return)
+BOOL
+YoriPkgGetIniSectionValue(
+    __in PCYORI_STRING Section,
+    __in LPCTSTR Key,
+    __out PYORI_STRING Value
+    );
+
+VOID
+YoriPkgCopyIniSectionValue(
+    __in PCYORI_STRING Section,
+    __in LPCTSTR Key,
+    __inout PYORI_STRING Value
+    );
+
+__success(return)
+BOOL
+YoriPkgHashFile(
+    __in PCYORI_STRING FilePath,
+    __out PYORI_STRING HashString
+    );
+
 VOID
 YoriPkgFreeBackupPackage(
     __in PYORIPKG_BACKUP_PACKAGE PackageBackup
@@ -450,6 +624,50 @@ YoriPkgDeletePendingPackages(
     __in PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages
     );
 
+VOID
+YoriPkgInitializeDownloadSet(
+    __out PYORIPKG_DOWNLOAD_SET DownloadSet
+    );
+
+__success(return)
+BOOL
+YoriPkgAddDownloadToSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet,
+    __in PYORI_STRING PackageUrl,
+    __in_opt PCYORI_STRING PkgIniFile
+    );
+
+VOID
+YoriPkgStartDownloadsInSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    );
+
+VOID
+YoriPkgDownloadAllInSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    );
+
+VOID
+YoriPkgMoveDownloadToSet(
+    __inout PYORIPKG_DOWNLOAD_SET TargetSet,
+    __inout PYORIPKG_DOWNLOAD_SET SourceSet,
+    __in PCYORI_STRING PackageUrl
+    );
+
+__success(return)
+BOOL
+YoriPkgTakeDownloadFromSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet,
+    __in PCYORI_STRING PackageUrl,
+    __out PYORI_STRING LocalPath,
+    __out PBOOLEAN DeleteWhenFinished
+    );
+
+VOID
+YoriPkgFreeDownloadSet(
+    __inout PYORIPKG_DOWNLOAD_SET DownloadSet
+    );
+
 __success(return == ERROR_SUCCESS)
 DWORD
 YoriPkgPreparePackageForInstall(
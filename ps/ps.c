@@ -35,11 +35,17 @@ CHAR strPsHelpText[] =
         "\n"
         "Display process list.\n"
         "\n"
-        "PS [-license] [-a] [-f] [-l]\n"
+        "PS [-license] [-a] [-f] [-l] [-m [seconds]]\n"
         "\n"
         "   -a             Display all processes\n"
         "   -f             Display full format including command line\n"
-        "   -l             Display long format including memory usage\n";
+        "   -l             Display long format including memory usage\n"
+        "   -m             Monitor processes, displaying changes at an interval\n";
+
+/**
+ The default number of seconds between samples in monitor mode.
+ */
+#define PS_DEFAULT_MONITOR_INTERVAL (1)
 
 /**
  Display usage text to the user.
@@ -77,6 +83,41 @@ typedef struct _PS_CONTEXT {
 
 } PS_CONTEXT, *PPS_CONTEXT;
 
+/**
+ A single sample of the system process list, along with an index to find
+ processes within it by process ID.
+ */
+typedef struct _PS_SNAPSHOT {
+
+    /**
+     The process list returned from the system.
+     */
+    PYORI_SYSTEM_PROCESS_INFORMATION ProcessList;
+
+    /**
+     The size of the ProcessList allocation, in bytes.  This buffer is reused
+     for subsequent samples.
+     */
+    YORI_ALLOC_SIZE_T ProcessListSize;
+
+    /**
+     The system time when the sample was taken.
+     */
+    LARGE_INTEGER SampleTime;
+
+    /**
+     An open addressed hash table of pointers to processes within
+     ProcessList, indexed by process ID.  Empty slots are NULL.
+     */
+    PYORI_SYSTEM_PROCESS_INFORMATION *Index;
+
+    /**
+     The number of slots in Index.  This is always a power of two.
+     */
+    YORI_ALLOC_SIZE_T IndexSize;
+
+} PS_SNAPSHOT, *PPS_SNAPSHOT;
+
 /**
  Display a header for the output including the fields and spacing that the
  requested output will have.
@@ -501,6 +542,447 @@ PsDisplayConsoleProcesses(
     return TRUE;
 }
 
+/**
+ Return the slot within a snapshot index where a process ID should be
+ searched for first.
+
+ @param Snapshot Pointer to the snapshot.
+
+ @param ProcessId The process ID.
+
+ @return The slot within the index.
+ */
+YORI_ALLOC_SIZE_T
+PsSnapshotHashProcessId(
+    __in PPS_SNAPSHOT Snapshot,
+    __in DWORD_PTR ProcessId
+    )
+{
+    //
+    //  Process IDs are multiples of four, so discard the low bits.
+    //
+
+    return (YORI_ALLOC_SIZE_T)((ProcessId / 4) & (Snapshot->IndexSize - 1));
+}
+
+/**
+ Take a new sample of the system process list and build an index of the
+ processes within it.  Any buffers from a previous sample in the snapshot are
+ reused.
+
+ @param Snapshot Pointer to the snapshot to populate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+PsSnapshotRefresh(
+    __inout PPS_SNAPSHOT Snapshot
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
+    YORI_ALLOC_SIZE_T ProcessCount;
+    YORI_ALLOC_SIZE_T IndexSize;
+    YORI_ALLOC_SIZE_T Slot;
+
+    if (!YoriLibRefreshSystemProcessList(&Snapshot->ProcessList, &Snapshot->ProcessListSize)) {
+        return FALSE;
+    }
+    Snapshot->SampleTime.QuadPart = YoriLibGetSystemTimeAsInteger();
+
+    ProcessCount = 0;
+    CurrentEntry = Snapshot->ProcessList;
+    do {
+        ProcessCount++;
+        if (CurrentEntry->NextEntryOffset == 0) {
+            break;
+        }
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    } while(TRUE);
+
+    //
+    //  Keep the index at most half full so probe sequences remain short.
+    //
+
+    IndexSize = 64;
+    while (IndexSize < ProcessCount * 2) {
+        IndexSize = IndexSize * 2;
+    }
+
+    if (IndexSize > Snapshot->IndexSize) {
+        if (!YoriLibIsSizeAllocatable(IndexSize * sizeof(PYORI_SYSTEM_PROCESS_INFORMATION))) {
+            return FALSE;
+        }
+        if (Snapshot->Index != NULL) {
+            YoriLibFree(Snapshot->Index);
+        }
+        Snapshot->IndexSize = 0;
+        Snapshot->Index = YoriLibMalloc(IndexSize * sizeof(PYORI_SYSTEM_PROCESS_INFORMATION));
+        if (Snapshot->Index == NULL) {
+            return FALSE;
+        }
+        Snapshot->IndexSize = IndexSize;
+    }
+
+    ZeroMemory(Snapshot->Index, Snapshot->IndexSize * sizeof(PYORI_SYSTEM_PROCESS_INFORMATION));
+
+    CurrentEntry = Snapshot->ProcessList;
+    do {
+        Slot = PsSnapshotHashProcessId(Snapshot, CurrentEntry->ProcessId);
+        while (Snapshot->Index[Slot] != NULL) {
+            Slot = (Slot + 1) & (Snapshot->IndexSize - 1);
+        }
+        Snapshot->Index[Slot] = CurrentEntry;
+
+        if (CurrentEntry->NextEntryOffset == 0) {
+            break;
+        }
+        CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+    } while(TRUE);
+
+    return TRUE;
+}
+
+/**
+ Find a process within a snapshot.  Because process IDs can be reused, a
+ process is only considered to match if its creation time matches too.
+
+ @param Snapshot Pointer to the snapshot to search.
+
+ @param ProcessInfo Pointer to the process to find, typically from a
+        different snapshot.
+
+ @return Pointer to the process within the snapshot, or NULL if the process
+         was not present when the snapshot was taken.
+ */
+PYORI_SYSTEM_PROCESS_INFORMATION
+PsSnapshotFindProcess(
+    __in PPS_SNAPSHOT Snapshot,
+    __in PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo
+    )
+{
+    PYORI_SYSTEM_PROCESS_INFORMATION Entry;
+    YORI_ALLOC_SIZE_T Slot;
+
+    if (Snapshot->Index == NULL) {
+        return NULL;
+    }
+
+    Slot = PsSnapshotHashProcessId(Snapshot, ProcessInfo->ProcessId);
+    while (Snapshot->Index[Slot] != NULL) {
+        Entry = Snapshot->Index[Slot];
+        if (Entry->ProcessId == ProcessInfo->ProcessId &&
+            Entry->CreateTime.QuadPart == ProcessInfo->CreateTime.QuadPart) {
+
+            return Entry;
+        }
+        Slot = (Slot + 1) & (Snapshot->IndexSize - 1);
+    }
+
+    return NULL;
+}
+
+/**
+ Free any allocations within a snapshot.
+
+ @param Snapshot Pointer to the snapshot to clean up.
+ */
+VOID
+PsSnapshotCleanup(
+    __inout PPS_SNAPSHOT Snapshot
+    )
+{
+    if (Snapshot->ProcessList != NULL) {
+        YoriLibFree(Snapshot->ProcessList);
+        Snapshot->ProcessList = NULL;
+    }
+    Snapshot->ProcessListSize = 0;
+
+    if (Snapshot->Index != NULL) {
+        YoriLibFree(Snapshot->Index);
+        Snapshot->Index = NULL;
+    }
+    Snapshot->IndexSize = 0;
+}
+
+/**
+ Return the total number of bytes transferred by a process.
+
+ @param ProcessInfo Pointer to the process.
+
+ @return The number of bytes transferred.
+ */
+DWORDLONG
+PsGetProcessTransferCount(
+    __in PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo
+    )
+{
+    return ProcessInfo->ReadTransferCount.QuadPart +
+           ProcessInfo->WriteTransferCount.QuadPart +
+           ProcessInfo->OtherTransferCount.QuadPart;
+}
+
+/**
+ Display a header for monitor mode output.
+
+ @param PsContext Pointer to the ps context specifying which fields will be
+        displayed.
+ */
+VOID
+PsDisplayMonitorHeader(
+    __in PPS_CONTEXT PsContext
+    )
+{
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("  Pid  | State | Cpu%% | IO/sec | Process         "));
+    if (PsContext->DisplayMemory) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("| WorkingSet | Commit     "));
+    }
+    if (PsContext->DisplayCommandLine) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("| CommandLine"));
+    }
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+}
+
+/**
+ Display the change in a process between two samples.
+
+ @param PsContext Pointer to the ps context indicating what to display.
+
+ @param ProcessInfo Pointer to the process from the most recent sample, or
+        from the previous sample if the process has exited.
+
+ @param State Pointer to a string describing the change in the process.
+
+ @param CpuPercent The percentage of a processor consumed by the process
+        during the interval.  This can exceed 100 on multiprocessor systems.
+
+ @param BytesPerSecond The number of bytes per second transferred by the
+        process during the interval.
+
+ @param Exited TRUE if the process is no longer running, FALSE if it is.
+ */
+VOID
+PsDisplayProcessDelta(
+    __in PPS_CONTEXT PsContext,
+    __in PYORI_SYSTEM_PROCESS_INFORMATION ProcessInfo,
+    __in LPCTSTR State,
+    __in DWORD CpuPercent,
+    __in DWORDLONG BytesPerSecond,
+    __in BOOLEAN Exited
+    )
+{
+    YORI_STRING BaseName;
+    YORI_STRING IoString;
+    TCHAR IoStringBuffer[6];
+    LARGE_INTEGER liIo;
+
+    YoriLibInitEmptyString(&BaseName);
+    BaseName.StartOfString = ProcessInfo->ImageName;
+    BaseName.LengthInChars = ProcessInfo->ImageNameLengthInBytes / sizeof(WCHAR);
+
+    if (BaseName.LengthInChars == 0 && ProcessInfo->ProcessId == 0) {
+        YoriLibConstantString(&BaseName, _T("Idle"));
+    }
+
+    YoriLibInitEmptyString(&IoString);
+    IoString.StartOfString = IoStringBuffer;
+    IoString.LengthAllocated = sizeof(IoStringBuffer)/sizeof(IoStringBuffer[0]);
+    liIo.QuadPart = BytesPerSecond;
+    YoriLibFileSizeToString(&IoString, &liIo);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%-6i | %-5s | %4i | %-6y | %-15y"),
+                  ProcessInfo->ProcessId,
+                  State,
+                  CpuPercent,
+                  &IoString,
+                  &BaseName);
+
+    if (PsContext->DisplayMemory) {
+        LARGE_INTEGER liCommit;
+        LARGE_INTEGER liWorkingSet;
+        YORI_STRING CommitString;
+        YORI_STRING WorkingSetString;
+        TCHAR CommitStringBuffer[6];
+        TCHAR WorkingSetStringBuffer[6];
+
+        YoriLibInitEmptyString(&CommitString);
+        YoriLibInitEmptyString(&WorkingSetString);
+
+        CommitString.StartOfString = CommitStringBuffer;
+        CommitString.LengthAllocated = sizeof(CommitStringBuffer)/sizeof(CommitStringBuffer[0]);
+
+        WorkingSetString.StartOfString = WorkingSetStringBuffer;
+        WorkingSetString.LengthAllocated = sizeof(WorkingSetStringBuffer)/sizeof(WorkingSetStringBuffer[0]);
+
+        liCommit.QuadPart = ProcessInfo->CommitSize;
+        liWorkingSet.QuadPart = ProcessInfo->WorkingSetSize;
+        YoriLibFileSizeToString(&CommitString, &liCommit);
+        YoriLibFileSizeToString(&WorkingSetString, &liWorkingSet);
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T(" | %-10y | %-10y"),
+                      &WorkingSetString,
+                      &CommitString);
+    }
+
+    if (PsContext->DisplayCommandLine && !Exited) {
+        PsDisplayProcessCommandLine(ProcessInfo->ProcessId);
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+}
+
+/**
+ Repeatedly sample the system process list and display processes which have
+ started, exited, consumed processor time or performed IO since the previous
+ sample.  Processes which have not changed are not displayed.  This continues
+ until the user cancels.
+
+ @param PsContext Pointer to the ps context indicating what to display.
+
+ @param IntervalInSeconds The number of seconds between samples.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+PsMonitorProcesses(
+    __in PPS_CONTEXT PsContext,
+    __in DWORD IntervalInSeconds
+    )
+{
+    PS_SNAPSHOT Snapshots[2];
+    PPS_SNAPSHOT Previous;
+    PPS_SNAPSHOT Current;
+    PPS_SNAPSHOT Swap;
+    PYORI_SYSTEM_PROCESS_INFORMATION CurrentEntry;
+    PYORI_SYSTEM_PROCESS_INFORMATION PreviousEntry;
+    LONGLONG Elapsed;
+    DWORDLONG CpuDelta;
+    DWORDLONG IoDelta;
+    DWORD CpuPercent;
+    DWORD OsMajor;
+    DWORD OsMinor;
+    DWORD OsBuild;
+    BOOLEAN HaveIoCounters;
+    HANDLE CancelHandle;
+    BOOL Result;
+
+    ZeroMemory(Snapshots, sizeof(Snapshots));
+    Previous = &Snapshots[0];
+    Current = &Snapshots[1];
+
+    //
+    //  IO counters were added to the process information in Windows 2000.
+    //
+
+    YoriLibGetOsVersion(&OsMajor, &OsMinor, &OsBuild);
+    HaveIoCounters = FALSE;
+    if (OsMajor >= 5) {
+        HaveIoCounters = TRUE;
+    }
+
+    if (!PsSnapshotRefresh(Previous)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("yps: Unable to load system process list\n"));
+        PsSnapshotCleanup(Previous);
+        return FALSE;
+    }
+
+#if YORI_BUILTIN
+    YoriLibCancelEnable(FALSE);
+#endif
+    CancelHandle = YoriLibCancelGetEvent();
+
+    PsDisplayMonitorHeader(PsContext);
+    Result = TRUE;
+
+    while (TRUE) {
+        if (CancelHandle != NULL) {
+            if (WaitForSingleObject(CancelHandle, IntervalInSeconds * 1000) == WAIT_OBJECT_0) {
+                break;
+            }
+        } else {
+            Sleep(IntervalInSeconds * 1000);
+        }
+
+        if (!PsSnapshotRefresh(Current)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("yps: Unable to load system process list\n"));
+            Result = FALSE;
+            break;
+        }
+
+        Elapsed = Current->SampleTime.QuadPart - Previous->SampleTime.QuadPart;
+        if (Elapsed <= 0) {
+            Elapsed = 1;
+        }
+
+        //
+        //  Display processes that are new or that have done something since
+        //  the previous sample.
+        //
+
+        CurrentEntry = Current->ProcessList;
+        do {
+            PreviousEntry = PsSnapshotFindProcess(Previous, CurrentEntry);
+            if (PreviousEntry == NULL) {
+                PsDisplayProcessDelta(PsContext, CurrentEntry, _T("New"), 0, 0, FALSE);
+            } else {
+                CpuDelta = (CurrentEntry->KernelTime.QuadPart + CurrentEntry->UserTime.QuadPart) -
+                           (PreviousEntry->KernelTime.QuadPart + PreviousEntry->UserTime.QuadPart);
+                IoDelta = 0;
+                if (HaveIoCounters) {
+                    IoDelta = PsGetProcessTransferCount(CurrentEntry) - PsGetProcessTransferCount(PreviousEntry);
+                }
+
+                if (CpuDelta != 0 || IoDelta != 0) {
+                    CpuPercent = (DWORD)(CpuDelta * 100 / Elapsed);
+                    PsDisplayProcessDelta(PsContext,
+                                          CurrentEntry,
+                                          _T(""),
+                                          CpuPercent,
+                                          IoDelta * 10 * 1000 * 1000 / Elapsed,
+                                          FALSE);
+                }
+            }
+
+            if (CurrentEntry->NextEntryOffset == 0) {
+                break;
+            }
+            CurrentEntry = YoriLibAddToPointer(CurrentEntry, CurrentEntry->NextEntryOffset);
+        } while(TRUE);
+
+        //
+        //  Display processes that have exited since the previous sample.
+        //
+
+        PreviousEntry = Previous->ProcessList;
+        do {
+            if (PsSnapshotFindProcess(Current, PreviousEntry) == NULL) {
+                PsDisplayProcessDelta(PsContext, PreviousEntry, _T("Exit"), 0, 0, TRUE);
+            }
+
+            if (PreviousEntry->NextEntryOffset == 0) {
+                break;
+            }
+            PreviousEntry = YoriLibAddToPointer(PreviousEntry, PreviousEntry->NextEntryOffset);
+        } while(TRUE);
+
+        //
+        //  The current sample becomes the baseline for the next one, and the
+        //  previous sample's buffers are reused to take it.
+        //
+
+        Swap = Previous;
+        Previous = Current;
+        Current = Swap;
+    }
+
+    PsSnapshotCleanup(&Snapshots[0]);
+    PsSnapshotCleanup(&Snapshots[1]);
+    return Result;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the ps builtin command.
@@ -534,10 +1016,14 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T StartArg = 0;
     YORI_STRING Arg;
     BOOLEAN DisplayAll;
+    BOOLEAN Monitor;
+    DWORD MonitorInterval;
     PS_CONTEXT PsContext;
 
     ZeroMemory(&PsContext, sizeof(PsContext));
     DisplayAll = FALSE;
+    Monitor = FALSE;
+    MonitorInterval = PS_DEFAULT_MONITOR_INTERVAL;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -561,6 +1047,23 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 PsContext.DisplayMemory = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                Monitor = TRUE;
+                ArgumentUnderstood = TRUE;
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T llTemp;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) &&
+                        CharsConsumed > 0 &&
+                        CharsConsumed == ArgV[i + 1].LengthInChars &&
+                        llTemp > 0 &&
+                        llTemp < 3600) {
+
+                        MonitorInterval = (DWORD)llTemp;
+                        i++;
+                    }
+                }
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -575,7 +1078,11 @@ ENTRYPOINT(
 
     PsContext.Now.QuadPart = YoriLibGetSystemTimeAsInteger();
 
-    if (DisplayAll) {
+    if (Monitor) {
+        if (!PsMonitorProcesses(&PsContext, MonitorInterval)) {
+            return EXIT_FAILURE;
+        }
+    } else if (DisplayAll) {
         PsDisplayAllProcesses(&PsContext);
     } else {
         PsDisplayConsoleProcesses(&PsContext);
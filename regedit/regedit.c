@@ -163,295 +163,952 @@ RegeditValueListSelectionChanged(
 
 
 /**
- Open the current registry key and populate the lists containing the subkeys
- and values within the currently active key.
+ Query the lengths of the longest subkey name, value name, and value data
+ within a key.
 
- @param RegeditContext Pointer to the global registry context, indicating the
-        currently active key.  This may be a root pseudohandle and subkey, or
-        may be Depth 0, indicating that the well known root keys should be
-        enumerated.
+ @param Key The opened key.
 
- @param KeyListCtrl Pointer to the list control containing subkeys.
+ @param MaxSubKeyLength On successful completion, updated to contain the
+        length of the longest subkey name, in characters.
 
- @param ValueListCtrl Pointer to the list control containing values.
+ @param MaxValueNameLength On successful completion, updated to contain the
+        length of the longest value name, in characters.
 
- @param SelectKey Optionally points to a string containing the previously
-        selected key.  On refresh the list of keys will change, but if
-        supplied, either this key, or the one following it, or the last
-        item in the list, should be selected.
+ @param MaxValueData On successful completion, updated to contain the length
+        of the longest value data, in bytes.
 
- @param SelectValue Optionally points to a string containing the previously
-        selected value.  On refresh the list of values will change, but if
-        supplied, either this value, or the one following it, or the last
-        item in the list, should be selected.
+ @return A Win32 error code, including ERROR_SUCCESS to indicate success.
  */
-VOID
-RegeditPopulateKeyValueList(
-    __in PREGEDIT_CONTEXT RegeditContext,
-    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
-    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl,
-    __in_opt PYORI_STRING SelectKey,
-    __in_opt PYORI_STRING SelectValue
+DWORD
+RegeditQueryKeyLimits(
+    __in HKEY Key,
+    __out PDWORD MaxSubKeyLength,
+    __out PDWORD MaxValueNameLength,
+    __out PDWORD MaxValueData
     )
 {
-    YORI_ALLOC_SIZE_T Index;
-    PYORI_WIN_CTRL_HANDLE Parent;
-    YORI_ALLOC_SIZE_T ArrayCount;
-    DWORD BytesRequired;
-    YORI_ALLOC_SIZE_T ArrayElementSize;
+    YORI_STRING Text;
+    DWORD Err;
     DWORD SubKeyCount;
     DWORD ValueCount;
-    DWORD MaxValueNameLength;
-    DWORD MaxSubKeyLength;
-    PYORI_STRING StringArray;
+    DWORD MaxClassLength;
+    DWORD SecurityDescriptorLength;
+    DWORD ClassLength;
+    FILETIME LastWriteTime;
+
+    ClassLength = 0;
+    Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
+                                        NULL,
+                                        &ClassLength,
+                                        NULL,
+                                        &SubKeyCount,
+                                        MaxSubKeyLength,
+                                        &MaxClassLength,
+                                        &ValueCount,
+                                        MaxValueNameLength,
+                                        MaxValueData,
+                                        &SecurityDescriptorLength,
+                                        &LastWriteTime);
 
-    Parent = YoriWinGetControlParent(KeyListCtrl);
-    YoriWinListClearAllItems(KeyListCtrl);
-    YoriWinListClearAllItems(ValueListCtrl);
+    //
+    //  Older versions of Windows insist all parameters are populated,
+    //  including the class name, which we don't care about.  If needed,
+    //  allocate space for it, call again, and throw it away.
+    //
 
-    if (RegeditContext->TreeDepth == 0) {
-        for (Index = 0; Index < sizeof(RegeditRootKeys)/sizeof(RegeditRootKeys[0]); Index++) {
-            YoriWinListAddItems(KeyListCtrl, &RegeditRootKeys[Index].KeyName, 1);
+    if (Err == ERROR_MORE_DATA || Err == ERROR_INSUFFICIENT_BUFFER) {
+        if (!YoriLibIsSizeAllocatable(ClassLength + 1)) {
+            return ERROR_OUTOFMEMORY;
         }
-    } else {
-        YORI_STRING Text;
-        DWORD Err;
-        YORI_ALLOC_SIZE_T SelectIndex;
-        DWORD ValueSize;
-        DWORD MaxClassLength;
-        DWORD MaxValueData;
-        DWORD SecurityDescriptorLength;
-        DWORD ClassLength;
-        HKEY Key;
-        FILETIME LastWriteTime;
-
-        YoriLibConstantString(&Text, _T(".."));
-        YoriWinListAddItems(KeyListCtrl, &Text, 1);
-
-        Err = DllAdvApi32.pRegOpenKeyExW(RegeditContext->ActiveRootKey, RegeditContext->Subkey.StartOfString, 0, KEY_READ, &Key);
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-            return;
+        if (!YoriLibAllocateString(&Text, (YORI_ALLOC_SIZE_T)(ClassLength + 1))) {
+            return GetLastError();
         }
 
-        ClassLength = 0;
+        ClassLength = Text.LengthAllocated;
         Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
-                                            NULL,
+                                            Text.StartOfString,
                                             &ClassLength,
                                             NULL,
                                             &SubKeyCount,
-                                            &MaxSubKeyLength,
+                                            MaxSubKeyLength,
                                             &MaxClassLength,
                                             &ValueCount,
-                                            &MaxValueNameLength,
-                                            &MaxValueData,
+                                            MaxValueNameLength,
+                                            MaxValueData,
                                             &SecurityDescriptorLength,
                                             &LastWriteTime);
+        YoriLibFreeStringContents(&Text);
+    }
+
+    return Err;
+}
+
+/**
+ The number of subkeys to enumerate before they are first displayed.  This
+ is small so the beginning of a large key is displayed quickly.
+ */
+#define REGEDIT_LOAD_FIRST_BATCH (0x100)
+
+/**
+ The number of subkeys or values to enumerate in each subsequent batch.
+ */
+#define REGEDIT_LOAD_BATCH (0x1000)
+
+/**
+ The interval, in milliseconds, between checks for subkeys enumerated by the
+ background thread.
+ */
+#define REGEDIT_LOAD_POLL_INTERVAL (100)
+
+/**
+ Append an array of strings to a growable array of strings.
+
+ @param Array On input, points to the existing array, which may be NULL.  On
+        successful output, points to the array, which may have been
+        reallocated.
+
+ @param Allocated On input, points to the number of entries allocated in the
+        array.  On successful output, updated to the new allocation size.
+
+ @param Populated On input, points to the number of entries populated in the
+        array.  On successful output, updated to include the new entries.
+
+ @param Source Pointer to the strings to append.  On success, ownership of
+        the strings moves to the array, although the source array itself
+        remains owned by the caller.
+
+ @param Count The number of strings in Source.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditAppendStrings(
+    __inout PYORI_STRING *Array,
+    __inout PYORI_ALLOC_SIZE_T Allocated,
+    __inout PYORI_ALLOC_SIZE_T Populated,
+    __in PYORI_STRING Source,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    if (*Populated + Count > *Allocated) {
+        PYORI_STRING NewArray;
+        YORI_ALLOC_SIZE_T BytesToAllocate;
+        DWORD RequiredBytes;
+        DWORD DesiredBytes;
+
+        RequiredBytes = *Populated;
+        RequiredBytes = RequiredBytes + Count;
+        RequiredBytes = RequiredBytes * sizeof(YORI_STRING);
+
+        DesiredBytes = *Populated;
+        DesiredBytes = DesiredBytes + Count;
+        DesiredBytes = DesiredBytes * 2;
+        DesiredBytes = DesiredBytes * sizeof(YORI_STRING);
+
+        BytesToAllocate = YoriLibMaximumAllocationInRange(RequiredBytes, DesiredBytes);
+        if (BytesToAllocate == 0) {
+            return FALSE;
+        }
+
+        NewArray = YoriLibReferencedMalloc(BytesToAllocate);
+        if (NewArray == NULL) {
+            return FALSE;
+        }
+
+        if (*Populated > 0) {
+            memcpy(NewArray, *Array, *Populated * sizeof(YORI_STRING));
+        }
+        if (*Array != NULL) {
+            YoriLibDereference(*Array);
+        }
+        *Array = NewArray;
+        *Allocated = BytesToAllocate / sizeof(YORI_STRING);
+    }
+
+    memcpy(&(*Array)[*Populated], Source, Count * sizeof(YORI_STRING));
+    *Populated = *Populated + Count;
+    return TRUE;
+}
+
+/**
+ Free a growable array of strings, including the strings within it.
+
+ @param Array On input, points to the array, which may be NULL.  On output,
+        set to NULL.
+
+ @param Allocated Points to the number of entries allocated in the array.
+        On output, set to zero.
+
+ @param Populated Points to the number of entries populated in the array.
+        On output, set to zero.
+ */
+VOID
+RegeditFreeStrings(
+    __inout PYORI_STRING *Array,
+    __inout PYORI_ALLOC_SIZE_T Allocated,
+    __inout PYORI_ALLOC_SIZE_T Populated
+    )
+{
+    while (*Populated > 0) {
+        YoriLibFreeStringContents(&(*Array)[*Populated - 1]);
+        *Populated = *Populated - 1;
+    }
+
+    if (*Array != NULL) {
+        YoriLibDereference(*Array);
+        *Array = NULL;
+    }
+    *Allocated = 0;
+}
+
+/**
+ Make a batch of subkeys or values enumerated by the background thread
+ available to the thread processing input.
+
+ @param LoadContext Pointer to the load context.
+
+ @param Values If TRUE, the batch contains values.  If FALSE, the batch
+        contains subkeys.
+
+ @param Batch Pointer to an array of names.  On success, ownership of the
+        names moves to the load context, although the array itself remains
+        owned by the caller.
+
+ @param Count The number of names in Batch.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditLoadPublish(
+    __in PREGEDIT_LOAD_CONTEXT LoadContext,
+    __in BOOLEAN Values,
+    __in PYORI_STRING Batch,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    BOOLEAN Result;
+
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+    if (Values) {
+        Result = RegeditAppendStrings(&LoadContext->Values, &LoadContext->ValuesAllocated, &LoadContext->ValuesPopulated, Batch, Count);
+    } else {
+        Result = RegeditAppendStrings(&LoadContext->PendingKeys, &LoadContext->PendingKeysAllocated, &LoadContext->PendingKeysPopulated, Batch, Count);
+    }
+    ReleaseMutex(LoadContext->Mutex);
+    return Result;
+}
+
+/**
+ Enumerate either the subkeys or the values of the key being loaded, and
+ publish them in batches.  This is called on the background thread.
+
+ @param LoadContext Pointer to the load context.
+
+ @param Values If TRUE, values are enumerated.  If FALSE, subkeys are
+        enumerated.
+
+ @return A Win32 error code, including ERROR_SUCCESS to indicate all items
+         were enumerated, or ERROR_CANCELLED if enumeration was stopped
+         because the shutdown event was signalled.
+ */
+DWORD
+RegeditLoadEnumerate(
+    __in PREGEDIT_LOAD_CONTEXT LoadContext,
+    __in BOOLEAN Values
+    )
+{
+    YORI_STRING Name;
+    PYORI_STRING Batch;
+    YORI_ALLOC_SIZE_T BatchCount;
+    YORI_ALLOC_SIZE_T BatchLimit;
+    DWORD Index;
+    DWORD NameLength;
+    DWORD Err;
+    FILETIME LastWriteTime;
+
+    if (Values) {
+        NameLength = LoadContext->MaxValueNameLength;
+        BatchLimit = REGEDIT_LOAD_BATCH;
+    } else {
+        NameLength = LoadContext->MaxSubKeyLength;
+        BatchLimit = REGEDIT_LOAD_FIRST_BATCH;
+    }
+
+    if (!YoriLibAllocateString(&Name, (YORI_ALLOC_SIZE_T)(NameLength + 1))) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    Batch = YoriLibMalloc(REGEDIT_LOAD_BATCH * sizeof(YORI_STRING));
+    if (Batch == NULL) {
+        YoriLibFreeStringContents(&Name);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    BatchCount = 0;
+    Index = 0;
+    Err = ERROR_SUCCESS;
+
+    while (TRUE) {
+
+        if (BatchCount == 0 &&
+            WaitForSingleObject(LoadContext->ShutdownEvent, 0) == WAIT_OBJECT_0) {
+
+            Err = ERROR_CANCELLED;
+            break;
+        }
+
+        NameLength = Name.LengthAllocated;
+        if (Values) {
+            Err = DllAdvApi32.pRegEnumValueW(LoadContext->Key, Index, Name.StartOfString, &NameLength, NULL, NULL, NULL, NULL);
+        } else {
+            Err = DllAdvApi32.pRegEnumKeyExW(LoadContext->Key, Index, Name.StartOfString, &NameLength, NULL, NULL, NULL, &LastWriteTime);
+        }
 
         //
-        //  Older versions of Windows insist all parameters are populated,
-        //  including the class name, which we don't care about.  If needed,
-        //  allocate space for it, call again, and throw it away.
+        //  If a longer name has been added since the key was queried, grow
+        //  the buffer and try again.
         //
 
-        if (Err == ERROR_MORE_DATA || Err == ERROR_INSUFFICIENT_BUFFER) {
-            if (!YoriLibIsSizeAllocatable(ClassLength + 1)) {
-                RegeditDisplayWin32Error(Parent, ERROR_OUTOFMEMORY);
-                DllAdvApi32.pRegCloseKey(Key);
-                return;
-            }
-            if (!YoriLibAllocateString(&Text, (YORI_ALLOC_SIZE_T)(ClassLength + 1))) {
-                RegeditDisplayWin32Error(Parent, GetLastError());
-                DllAdvApi32.pRegCloseKey(Key);
-                return;
+        if (Err == ERROR_MORE_DATA) {
+            NameLength = Name.LengthAllocated;
+            NameLength = NameLength * 2;
+            YoriLibFreeStringContents(&Name);
+            if (!YoriLibIsSizeAllocatable(NameLength) ||
+                !YoriLibAllocateString(&Name, (YORI_ALLOC_SIZE_T)NameLength)) {
+
+                Err = ERROR_NOT_ENOUGH_MEMORY;
+                break;
             }
+            continue;
+        }
 
-            ClassLength = Text.LengthAllocated;
-            Err = DllAdvApi32.pRegQueryInfoKeyW(Key,
-                                                Text.StartOfString,
-                                                &ClassLength,
-                                                NULL,
-                                                &SubKeyCount,
-                                                &MaxSubKeyLength,
-                                                &MaxClassLength,
-                                                &ValueCount,
-                                                &MaxValueNameLength,
-                                                &MaxValueData,
-                                                &SecurityDescriptorLength,
-                                                &LastWriteTime);
-            YoriLibFreeStringContents(&Text);
+        if (Err == ERROR_NO_MORE_ITEMS) {
+            Err = ERROR_SUCCESS;
+            break;
+        } else if (Err != ERROR_SUCCESS) {
+            break;
         }
 
-        if (Err != ERROR_SUCCESS) {
-            RegeditDisplayWin32Error(Parent, Err);
-            DllAdvApi32.pRegCloseKey(Key);
-            return;
+        if (!YoriLibArenaAllocateString(&LoadContext->Arena, &Batch[BatchCount], (YORI_ALLOC_SIZE_T)(NameLength + 1))) {
+            Err = ERROR_NOT_ENOUGH_MEMORY;
+            break;
         }
 
-        //
-        //  Use a single array both for keys and values.  This means the
-        //  allocations need to be for the larger of the two.
-        //
+        memcpy(Batch[BatchCount].StartOfString, Name.StartOfString, NameLength * sizeof(TCHAR));
+        Batch[BatchCount].StartOfString[NameLength] = '\0';
+        Batch[BatchCount].LengthInChars = (YORI_ALLOC_SIZE_T)NameLength;
+        BatchCount++;
+        Index++;
 
-        if (!YoriLibIsSizeAllocatable(SubKeyCount) ||
-            !YoriLibIsSizeAllocatable(ValueCount) ||
-            !YoriLibIsSizeAllocatable(MaxSubKeyLength + 1) ||
-            !YoriLibIsSizeAllocatable(MaxValueNameLength + 1)) {
+        if (BatchCount == BatchLimit) {
+            if (!RegeditLoadPublish(LoadContext, Values, Batch, BatchCount)) {
+                Err = ERROR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+            BatchCount = 0;
+            BatchLimit = REGEDIT_LOAD_BATCH;
+        }
+    }
 
-            RegeditDisplayWin32Error(Parent, ERROR_NOT_ENOUGH_MEMORY);
-            DllAdvApi32.pRegCloseKey(Key);
-            return;
+    //
+    //  Publish whatever has been enumerated, even on failure, so the user
+    //  can see the items that could be enumerated.
+    //
+
+    if (BatchCount > 0) {
+        if (RegeditLoadPublish(LoadContext, Values, Batch, BatchCount)) {
+            BatchCount = 0;
+        } else if (Err == ERROR_SUCCESS) {
+            Err = ERROR_NOT_ENOUGH_MEMORY;
         }
-        ArrayCount = (YORI_ALLOC_SIZE_T)SubKeyCount;
-        if (ValueCount > ArrayCount) {
-            ArrayCount = (YORI_ALLOC_SIZE_T)ValueCount;
+    }
+
+    while (BatchCount > 0) {
+        BatchCount--;
+        YoriLibFreeStringContents(&Batch[BatchCount]);
+    }
+
+    YoriLibFree(Batch);
+    YoriLibFreeStringContents(&Name);
+    return Err;
+}
+
+/**
+ A background thread which enumerates the subkeys of a key, publishing them
+ in batches to be displayed by the thread processing input, followed by the
+ values of the key.
+
+ @param Context Pointer to the load context.
+
+ @return Thread exit code, which is not used.
+ */
+DWORD WINAPI
+RegeditLoadThread(
+    __in PVOID Context
+    )
+{
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+    DWORD Err;
+
+    LoadContext = (PREGEDIT_LOAD_CONTEXT)Context;
+
+    Err = RegeditLoadEnumerate(LoadContext, FALSE);
+    if (Err == ERROR_SUCCESS) {
+        Err = RegeditLoadEnumerate(LoadContext, TRUE);
+    }
+
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+    LoadContext->Error = Err;
+    ReleaseMutex(LoadContext->Mutex);
+
+    return 0;
+}
+
+/**
+ Free a load context, including any subkeys and values that were enumerated
+ but not added to the lists.  The background thread must have terminated
+ before this is called.
+
+ @param RegeditContext Pointer to the regedit context.
+ */
+VOID
+RegeditFreeLoadContext(
+    __in PREGEDIT_CONTEXT RegeditContext
+    )
+{
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+
+    LoadContext = RegeditContext->LoadContext;
+    RegeditContext->LoadContext = NULL;
+
+    YoriWinSetPeriodicNotifyCallback(LoadContext->Window, 0, NULL);
+
+    RegeditFreeStrings(&LoadContext->PendingKeys, &LoadContext->PendingKeysAllocated, &LoadContext->PendingKeysPopulated);
+    RegeditFreeStrings(&LoadContext->Values, &LoadContext->ValuesAllocated, &LoadContext->ValuesPopulated);
+    YoriLibCleanupArena(&LoadContext->Arena);
+    YoriLibFreeStringContents(&LoadContext->SelectKey);
+    YoriLibFreeStringContents(&LoadContext->SelectValue);
+
+    if (LoadContext->hThread != NULL) {
+        CloseHandle(LoadContext->hThread);
+    }
+
+    if (LoadContext->ShutdownEvent != NULL) {
+        CloseHandle(LoadContext->ShutdownEvent);
+    }
+
+    if (LoadContext->Mutex != NULL) {
+        CloseHandle(LoadContext->Mutex);
+    }
+
+    if (LoadContext->Key != NULL) {
+        DllAdvApi32.pRegCloseKey(LoadContext->Key);
+    }
+
+    YoriLibFree(LoadContext);
+}
+
+/**
+ If a key is being enumerated in the background, stop enumerating it and
+ discard any items that have not been added to the lists.
+
+ @param RegeditContext Pointer to the regedit context.
+ */
+VOID
+RegeditCancelLoad(
+    __in PREGEDIT_CONTEXT RegeditContext
+    )
+{
+    if (RegeditContext->LoadContext == NULL) {
+        return;
+    }
+
+    SetEvent(RegeditContext->LoadContext->ShutdownEvent);
+    WaitForSingleObject(RegeditContext->LoadContext->hThread, INFINITE);
+    RegeditFreeLoadContext(RegeditContext);
+}
+
+/**
+ Free the subkeys of the active key that are displayed in the key list.  The
+ key list must not be displaying any of these when this is called.
+
+ @param RegeditContext Pointer to the regedit context.
+ */
+VOID
+RegeditFreeKeys(
+    __in PREGEDIT_CONTEXT RegeditContext
+    )
+{
+    RegeditFreeStrings(&RegeditContext->Keys, &RegeditContext->KeysAllocated, &RegeditContext->KeysPopulated);
+    RegeditContext->KeysOutOfOrder = FALSE;
+}
+
+/**
+ Return the text for an item in the key list.  Item zero is the ".." entry
+ which navigates to the parent key, and the remaining items are the subkeys
+ of the active key.
+
+ @param CtrlHandle Pointer to the key list control.
+
+ @param Index The index of the item to return.
+
+ @param Text On successful completion, populated with the text of the item.
+        This refers to memory owned by the regedit context, or a constant.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+RegeditGetKeyListItemText(
+    __in PYORI_WIN_CTRL_HANDLE CtrlHandle,
+    __in YORI_ALLOC_SIZE_T Index,
+    __out PYORI_STRING Text
+    )
+{
+    PREGEDIT_CONTEXT RegeditContext;
+
+    RegeditContext = YoriWinGetControlContext(YoriWinGetControlParent(CtrlHandle));
+
+    if (Index == 0) {
+        YoriLibConstantString(Text, _T(".."));
+        return TRUE;
+    }
+
+    Index--;
+    if (Index >= RegeditContext->KeysPopulated) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Text);
+    Text->StartOfString = RegeditContext->Keys[Index].StartOfString;
+    Text->LengthInChars = RegeditContext->Keys[Index].LengthInChars;
+    return TRUE;
+}
+
+/**
+ Find the index of the first string in a sorted array which is equal to or
+ greater than a specified string.
+
+ @param Array Pointer to the sorted array of strings.
+
+ @param Count The number of strings in the array.
+
+ @param Select Pointer to the string to find.
+
+ @return The index of the first string equal to or greater than Select.  If
+         no such string exists, returns Count.
+ */
+YORI_ALLOC_SIZE_T
+RegeditFindSelectIndex(
+    __in PYORI_STRING Array,
+    __in YORI_ALLOC_SIZE_T Count,
+    __in PYORI_STRING Select
+    )
+{
+    YORI_ALLOC_SIZE_T SelectIndex;
+
+    for (SelectIndex = 0; SelectIndex < Count; SelectIndex++) {
+        if (YoriLibCompareStringInsensitive(&Array[SelectIndex], Select) >= 0) {
+            break;
         }
+    }
+
+    return SelectIndex;
+}
+
+/**
+ Complete the enumeration of a key.  If the subkeys were not enumerated in
+ sorted order, sort them now, preserving the user's selection.  Select the
+ requested key if the user has not selected anything, and add the values to
+ the value list.
+
+ @param RegeditContext Pointer to the regedit context.
+
+ @param KeyListCtrl Pointer to the list control containing subkeys.
+
+ @param ValueListCtrl Pointer to the list control containing values.
+ */
+VOID
+RegeditCompleteLoad(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
+    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl
+    )
+{
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+    YORI_ALLOC_SIZE_T ActiveOption;
+    YORI_ALLOC_SIZE_T SelectIndex;
+    YORI_STRING ActiveKey;
+    BOOLEAN ItemActive;
+
+    LoadContext = RegeditContext->LoadContext;
 
-        ArrayElementSize = (YORI_ALLOC_SIZE_T)(MaxSubKeyLength + 1);
-        if (MaxValueNameLength + 1 > ArrayElementSize) {
-            ArrayElementSize = (YORI_ALLOC_SIZE_T)(MaxValueNameLength + 1);
+    ItemActive = YoriWinListGetActiveOption(KeyListCtrl, &ActiveOption);
+    if (RegeditContext->KeysOutOfOrder) {
+        YoriLibInitEmptyString(&ActiveKey);
+        if (ItemActive && ActiveOption > 0) {
+            YoriLibCloneString(&ActiveKey, &RegeditContext->Keys[ActiveOption - 1]);
         }
 
-        BytesRequired = ArrayCount;
-        BytesRequired = BytesRequired * sizeof(YORI_STRING);
-        if (!YoriLibIsSizeAllocatable(BytesRequired)) {
-            RegeditDisplayWin32Error(Parent, ERROR_NOT_ENOUGH_MEMORY);
-            DllAdvApi32.pRegCloseKey(Key);
-            return;
+        YoriLibSortStringArray(RegeditContext->Keys, RegeditContext->KeysPopulated);
+        RegeditContext->KeysOutOfOrder = FALSE;
+
+        if (ActiveKey.LengthInChars > 0) {
+            SelectIndex = RegeditFindSelectIndex(RegeditContext->Keys, RegeditContext->KeysPopulated, &ActiveKey);
+            YoriWinListSetActiveOption(KeyListCtrl, SelectIndex + 1);
         }
+        YoriLibFreeStringContents(&ActiveKey);
+        YoriWinListSetVirtualItemCount(KeyListCtrl, RegeditContext->KeysPopulated + 1);
+    }
 
-        StringArray = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
-        if (StringArray == NULL) {
-            RegeditDisplayWin32Error(Parent, GetLastError());
-            DllAdvApi32.pRegCloseKey(Key);
-            return;
+    //
+    //  If an item should be selected, find the index of a matching string
+    //  or the first item to be greater than it, and select that.  Because
+    //  of the .. entry, this normally moves forward one element, unless
+    //  the search has gone beyond the final element.
+    //
+
+    if (!ItemActive &&
+        LoadContext->SelectKey.LengthInChars > 0 &&
+        RegeditContext->KeysPopulated > 0) {
+
+        SelectIndex = RegeditFindSelectIndex(RegeditContext->Keys, RegeditContext->KeysPopulated, &LoadContext->SelectKey);
+        if (SelectIndex < RegeditContext->KeysPopulated) {
+            SelectIndex++;
         }
+        YoriWinListSetActiveOption(KeyListCtrl, SelectIndex);
+    }
 
-        for (Index = 0; Index < ArrayCount; Index++) {
-            YoriLibInitEmptyString(&StringArray[Index]);
+    if (LoadContext->ValuesPopulated > 0) {
+        YoriLibSortStringArray(LoadContext->Values, LoadContext->ValuesPopulated);
+        YoriWinListAddItems(ValueListCtrl, LoadContext->Values, LoadContext->ValuesPopulated);
+        if (LoadContext->SelectValue.LengthInChars > 0) {
+            SelectIndex = RegeditFindSelectIndex(LoadContext->Values, LoadContext->ValuesPopulated, &LoadContext->SelectValue);
+            if (SelectIndex == LoadContext->ValuesPopulated) {
+                SelectIndex--;
+            }
+            YoriWinListSetActiveOption(ValueListCtrl, SelectIndex);
         }
+    }
+}
 
-        //
-        //  Enumerate keys
-        //
+/**
+ Add any subkeys enumerated by the background thread to the key list.  If
+ the background thread has finished, complete the enumeration.
 
-        for (Index = 0; Index < SubKeyCount; Index++) {
-            if (!YoriLibAllocateString(&StringArray[Index], ArrayElementSize)) {
-                Err = ERROR_OUTOFMEMORY;
-                break;
+ @param RegeditContext Pointer to the regedit context.
+
+ @param KeyListCtrl Pointer to the list control containing subkeys.
+
+ @param ValueListCtrl Pointer to the list control containing values.
+ */
+VOID
+RegeditProcessLoadedItems(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
+    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl
+    )
+{
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+    PYORI_STRING KeyArray;
+    YORI_ALLOC_SIZE_T KeyCount;
+    YORI_ALLOC_SIZE_T KeysAllocated;
+    YORI_ALLOC_SIZE_T Index;
+    BOOLEAN Complete;
+    DWORD Err;
+
+    LoadContext = RegeditContext->LoadContext;
+    if (LoadContext == NULL) {
+        return;
+    }
+
+    //
+    //  Check for thread completion before taking the subkeys, so all
+    //  subkeys published before completion are consumed here.
+    //
+
+    Complete = FALSE;
+    if (WaitForSingleObject(LoadContext->hThread, 0) == WAIT_OBJECT_0) {
+        Complete = TRUE;
+    }
+
+    WaitForSingleObject(LoadContext->Mutex, INFINITE);
+    KeyArray = LoadContext->PendingKeys;
+    KeyCount = LoadContext->PendingKeysPopulated;
+    KeysAllocated = LoadContext->PendingKeysAllocated;
+    LoadContext->PendingKeys = NULL;
+    LoadContext->PendingKeysAllocated = 0;
+    LoadContext->PendingKeysPopulated = 0;
+    Err = LoadContext->Error;
+    ReleaseMutex(LoadContext->Mutex);
+
+    //
+    //  The registry normally returns subkeys in sorted order, so they can
+    //  be displayed as they arrive.  Check whether this holds, and if not,
+    //  sort them once everything has been enumerated.
+    //
+
+    if (KeyCount > 0) {
+        if (!RegeditContext->KeysOutOfOrder) {
+            if (RegeditContext->KeysPopulated > 0 &&
+                YoriLibCompareStringInsensitive(&RegeditContext->Keys[RegeditContext->KeysPopulated - 1], &KeyArray[0]) > 0) {
+
+                RegeditContext->KeysOutOfOrder = TRUE;
+            }
+            for (Index = 1; Index < KeyCount && !RegeditContext->KeysOutOfOrder; Index++) {
+                if (YoriLibCompareStringInsensitive(&KeyArray[Index - 1], &KeyArray[Index]) > 0) {
+                    RegeditContext->KeysOutOfOrder = TRUE;
+                }
             }
-            ValueSize = ArrayElementSize;
-            Err = DllAdvApi32.pRegEnumKeyExW(Key, Index, StringArray[Index].StartOfString, &ValueSize, NULL, NULL, NULL, &LastWriteTime);
+        }
+
+        if (RegeditAppendStrings(&RegeditContext->Keys, &RegeditContext->KeysAllocated, &RegeditContext->KeysPopulated, KeyArray, KeyCount)) {
+            YoriWinListSetVirtualItemCount(KeyListCtrl, RegeditContext->KeysPopulated + 1);
+            KeyCount = 0;
+        } else if (Err == ERROR_SUCCESS) {
+            Err = ERROR_NOT_ENOUGH_MEMORY;
+        }
+    }
+
+    RegeditFreeStrings(&KeyArray, &KeysAllocated, &KeyCount);
+
+    if (!Complete) {
+        return;
+    }
+
+    RegeditCompleteLoad(RegeditContext, KeyListCtrl, ValueListCtrl);
+    RegeditFreeLoadContext(RegeditContext);
+
+    if (Err != ERROR_SUCCESS) {
+        RegeditDisplayWin32Error(YoriWinGetControlParent(KeyListCtrl), Err);
+    }
+}
+
+/**
+ A callback invoked periodically while a key is being enumerated in the
+ background, to add enumerated subkeys to the key list.
+
+ @param WindowHandle Pointer to the main window.
+ */
+VOID
+RegeditLoadPeriodicCallback(
+    __in PYORI_WIN_CTRL_HANDLE WindowHandle
+    )
+{
+    PREGEDIT_CONTEXT RegeditContext;
+    PYORI_WIN_CTRL_HANDLE KeyList;
+    PYORI_WIN_CTRL_HANDLE ValueList;
+
+    RegeditContext = YoriWinGetControlContext(WindowHandle);
+    if (RegeditContext == NULL) {
+        return;
+    }
+
+    KeyList = YoriWinFindControlById(WindowHandle, RegeditControlKeyList);
+    ASSERT(KeyList != NULL);
+    __analysis_assume(KeyList != NULL);
+
+    ValueList = YoriWinFindControlById(WindowHandle, RegeditControlValueList);
+    ASSERT(ValueList != NULL);
+    __analysis_assume(ValueList != NULL);
+
+    RegeditProcessLoadedItems(RegeditContext, KeyList, ValueList);
+}
+
+/**
+ Start enumerating the subkeys and values of an opened key on a background
+ thread.  Subkeys are added to the key list in batches as they are
+ enumerated, so the beginning of a large key can be displayed before the
+ entire key has been enumerated.  Values are added when the enumeration
+ completes.
+
+ @param RegeditContext Pointer to the regedit context.
+
+ @param Parent Pointer to the main window.
+
+ @param Key The opened key.  On success, this handle is owned by the
+        background enumeration and will be closed when it completes.
+
+ @param MaxSubKeyLength The length of the longest subkey name, in
+        characters.
+
+ @param MaxValueNameLength The length of the longest value name, in
+        characters.
+
+ @param SelectKey Optionally points to a key to select when the enumeration
+        completes.
+
+ @param SelectValue Optionally points to a value to select when the
+        enumeration completes.
+
+ @return A Win32 error code, including ERROR_SUCCESS to indicate success.
+ */
+DWORD
+RegeditStartLoad(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent,
+    __in HKEY Key,
+    __in DWORD MaxSubKeyLength,
+    __in DWORD MaxValueNameLength,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    )
+{
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+    DWORD ThreadId;
+    DWORD Err;
+
+    ASSERT(RegeditContext->LoadContext == NULL);
+
+    LoadContext = YoriLibMalloc(sizeof(REGEDIT_LOAD_CONTEXT));
+    if (LoadContext == NULL) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    ZeroMemory(LoadContext, sizeof(REGEDIT_LOAD_CONTEXT));
+    YoriLibInitializeArena(&LoadContext->Arena, 0);
+    LoadContext->Window = Parent;
+    LoadContext->MaxSubKeyLength = MaxSubKeyLength;
+    LoadContext->MaxValueNameLength = MaxValueNameLength;
+    RegeditContext->LoadContext = LoadContext;
+
+    if (SelectKey != NULL &&
+        !YoriLibCopyString(&LoadContext->SelectKey, SelectKey)) {
+
+        RegeditFreeLoadContext(RegeditContext);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    if (SelectValue != NULL &&
+        !YoriLibCopyString(&LoadContext->SelectValue, SelectValue)) {
+
+        RegeditFreeLoadContext(RegeditContext);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    LoadContext->Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (LoadContext->Mutex == NULL) {
+        Err = GetLastError();
+        RegeditFreeLoadContext(RegeditContext);
+        return Err;
+    }
+
+    LoadContext->ShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (LoadContext->ShutdownEvent == NULL) {
+        Err = GetLastError();
+        RegeditFreeLoadContext(RegeditContext);
+        return Err;
+    }
+
+    if (!YoriWinSetPeriodicNotifyCallback(Parent, REGEDIT_LOAD_POLL_INTERVAL, RegeditLoadPeriodicCallback)) {
+        RegeditFreeLoadContext(RegeditContext);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    LoadContext->Key = Key;
+    LoadContext->hThread = CreateThread(NULL, 0, RegeditLoadThread, LoadContext, 0, &ThreadId);
+    if (LoadContext->hThread == NULL) {
+        Err = GetLastError();
+        LoadContext->Key = NULL;
+        RegeditFreeLoadContext(RegeditContext);
+        return Err;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/**
+ Open the current registry key and populate the lists containing the subkeys
+ and values within the currently active key.  Subkeys and values are
+ enumerated on a background thread, and are added to the lists as they
+ become available.
+
+ @param RegeditContext Pointer to the global registry context, indicating the
+        currently active key.  This may be a root pseudohandle and subkey, or
+        may be Depth 0, indicating that the well known root keys should be
+        enumerated.
+
+ @param KeyListCtrl Pointer to the list control containing subkeys.
+
+ @param ValueListCtrl Pointer to the list control containing values.
+
+ @param SelectKey Optionally points to a string containing the previously
+        selected key.  On refresh the list of keys will change, but if
+        supplied, either this key, or the one following it, or the last
+        item in the list, should be selected.
+
+ @param SelectValue Optionally points to a string containing the previously
+        selected value.  On refresh the list of values will change, but if
+        supplied, either this value, or the one following it, or the last
+        item in the list, should be selected.
+ */
+VOID
+RegeditPopulateKeyValueList(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE KeyListCtrl,
+    __in PYORI_WIN_CTRL_HANDLE ValueListCtrl,
+    __in_opt PYORI_STRING SelectKey,
+    __in_opt PYORI_STRING SelectValue
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    PYORI_WIN_CTRL_HANDLE Parent;
+    DWORD MaxValueNameLength;
+    DWORD MaxSubKeyLength;
+    DWORD MaxValueData;
 
-            //
-            //  MSFIX Possibly reallocate
-            //
+    Parent = YoriWinGetControlParent(KeyListCtrl);
 
-            if (Err == ERROR_NO_MORE_ITEMS) {
-                Err = ERROR_SUCCESS;
-                break;
-            } else if (Err != ERROR_SUCCESS) {
-                break;
-            }
+    //
+    //  Stop any enumeration of the previous key, and stop displaying its
+    //  subkeys before freeing them.
+    //
 
-            if (!YoriLibIsSizeAllocatable(ValueSize)) {
-                Err = ERROR_NOT_ENOUGH_MEMORY;
-                break;
-            }
+    RegeditCancelLoad(RegeditContext);
+    YoriWinListClearAllItems(KeyListCtrl);
+    YoriWinListClearAllItems(ValueListCtrl);
+    RegeditFreeKeys(RegeditContext);
 
-            StringArray[Index].LengthInChars = (YORI_ALLOC_SIZE_T)ValueSize;
+    if (RegeditContext->TreeDepth == 0) {
+        YoriWinListSetVirtualItemSource(KeyListCtrl, NULL, 0, FALSE);
+        for (Index = 0; Index < sizeof(RegeditRootKeys)/sizeof(RegeditRootKeys[0]); Index++) {
+            YoriWinListAddItems(KeyListCtrl, &RegeditRootKeys[Index].KeyName, 1);
         }
+    } else {
+        DWORD Err;
+        HKEY Key;
 
-        //
-        //  If it failed, tell the user.  Otherwise, sort, and add them to the
-        //  list.  If an item should be selected, find the index of a matching
-        //  string or the first item to be greater than it, and select that.
-        //
+        YoriWinListSetVirtualItemSource(KeyListCtrl, RegeditGetKeyListItemText, 1, FALSE);
 
+        Err = DllAdvApi32.pRegOpenKeyExW(RegeditContext->ActiveRootKey, RegeditContext->Subkey.StartOfString, 0, KEY_READ, &Key);
         if (Err != ERROR_SUCCESS) {
             RegeditDisplayWin32Error(Parent, Err);
-        } else if (Index > 0) {
-            YoriLibSortStringArray(StringArray, Index);
-            YoriWinListAddItems(KeyListCtrl, StringArray, Index);
-            if (SelectKey != NULL) {
-                for (SelectIndex = 0; SelectIndex < Index; SelectIndex++) {
-                    if (YoriLibCompareStringInsensitive(&StringArray[SelectIndex], SelectKey) >= 0) {
-                        break;
-                    }
-                }
-
-                //
-                //  Because of the .. entry above, we normally move forward one
-                //  element.  The exception is if we've already navigated
-                //  beyond the final element.
-                //
-
-                if (SelectIndex < Index) {
-                    SelectIndex++;
-                }
-                YoriWinListSetActiveOption(KeyListCtrl, SelectIndex);
-            }
+            return;
         }
 
-        Err = ERROR_SUCCESS;
-
-        //
-        //  Collect values, sort, find item to select, etc.
-        //
-
-        for (Index = 0; Index < ValueCount; Index++) {
-            if (StringArray[Index].LengthAllocated == 0) {
-                if (!YoriLibAllocateString(&StringArray[Index], (YORI_ALLOC_SIZE_T)(MaxValueNameLength + 1))) {
-                    Err = ERROR_OUTOFMEMORY;
-                    break;
-                }
-            }
-            ValueSize = StringArray[Index].LengthAllocated;
-            Err = DllAdvApi32.pRegEnumValueW(Key, Index, StringArray[Index].StartOfString, &ValueSize, NULL, NULL, NULL, NULL);
-
-            //
-            //  MSFIX Possibly reallocate
-            //
-            if (Err == ERROR_NO_MORE_ITEMS) {
-                Err = ERROR_SUCCESS;
-                break;
-            } else if (Err != ERROR_SUCCESS) {
-                break;
-            }
+        Err = RegeditQueryKeyLimits(Key, &MaxSubKeyLength, &MaxValueNameLength, &MaxValueData);
+        if (Err != ERROR_SUCCESS) {
+            RegeditDisplayWin32Error(Parent, Err);
+            DllAdvApi32.pRegCloseKey(Key);
+            return;
+        }
 
-            if (!YoriLibIsSizeAllocatable(ValueSize)) {
-                Err = ERROR_NOT_ENOUGH_MEMORY;
-                break;
-            }
+        if (!YoriLibIsSizeAllocatable(MaxSubKeyLength + 1) ||
+            !YoriLibIsSizeAllocatable(MaxValueNameLength + 1)) {
 
-            StringArray[Index].LengthInChars = (YORI_ALLOC_SIZE_T)ValueSize;
+            RegeditDisplayWin32Error(Parent, ERROR_NOT_ENOUGH_MEMORY);
+            DllAdvApi32.pRegCloseKey(Key);
+            return;
         }
 
+        Err = RegeditStartLoad(RegeditContext, Parent, Key, MaxSubKeyLength, MaxValueNameLength, SelectKey, SelectValue);
         if (Err != ERROR_SUCCESS) {
             RegeditDisplayWin32Error(Parent, Err);
-        } else {
-            YoriLibSortStringArray(StringArray, Index);
-            YoriWinListAddItems(ValueListCtrl, StringArray, Index);
-            if (SelectValue != NULL) {
-                for (SelectIndex = 0; SelectIndex < Index; SelectIndex++) {
-                    if (YoriLibCompareStringInsensitive(&StringArray[SelectIndex], SelectValue) >= 0) {
-                        break;
-                    }
-                }
-
-                if (SelectIndex == Index) {
-                    SelectIndex--;
-                }
-                YoriWinListSetActiveOption(ValueListCtrl, SelectIndex);
-            }
-        }
-
-        for (Index = 0; Index < ArrayCount; Index++) {
-            YoriLibFreeStringContents(&StringArray[Index]);
+            DllAdvApi32.pRegCloseKey(Key);
+            return;
         }
-        YoriLibFree(StringArray);
-
-        DllAdvApi32.pRegCloseKey(Key);
     }
 }
 
@@ -1035,6 +1692,7 @@ RegeditEditButtonClicked(
     PYORI_WIN_CTRL_HANDLE EditMenu;
     PYORI_WIN_CTRL_HANDLE NewMenu;
     PYORI_WIN_CTRL_HANDLE DeleteItem;
+    PYORI_WIN_CTRL_HANDLE DuplicateItem;
 
     PYORI_WIN_CTRL_HANDLE Parent;
     PREGEDIT_CONTEXT RegeditContext;
@@ -1045,13 +1703,16 @@ RegeditEditButtonClicked(
     EditMenu = YoriWinMenuBarGetSubmenuHandle(Ctrl, NULL, RegeditContext->EditMenuIndex);
     NewMenu = YoriWinMenuBarGetSubmenuHandle(Ctrl, EditMenu, RegeditContext->NewMenuIndex);
     DeleteItem = YoriWinMenuBarGetSubmenuHandle(Ctrl, EditMenu, RegeditContext->DeleteMenuIndex);
+    DuplicateItem = YoriWinMenuBarGetSubmenuHandle(Ctrl, EditMenu, RegeditContext->DuplicateKeyMenuIndex);
 
     if (RegeditContext->TreeDepth == 0) {
         YoriWinMenuBarDisableMenuItem(NewMenu);
         YoriWinMenuBarDisableMenuItem(DeleteItem);
+        YoriWinMenuBarDisableMenuItem(DuplicateItem);
     } else {
         YoriWinMenuBarEnableMenuItem(NewMenu);
         YoriWinMenuBarEnableMenuItem(DeleteItem);
+        YoriWinMenuBarEnableMenuItem(DuplicateItem);
     }
 
 }
@@ -1456,6 +2117,292 @@ RegeditDeleteButtonClicked(
     }
 }
 
+/**
+ Copy all values and subkeys from one key to another by enumerating them.
+ This is used on systems without RegCopyTreeW.
+
+ @param SourceKey The key to copy from, opened for read.
+
+ @param DestKey The key to copy to, opened for write.
+
+ @return A Win32 error code, including ERROR_SUCCESS to indicate success.
+ */
+DWORD
+RegeditCopyTreeRecursive(
+    __in HKEY SourceKey,
+    __in HKEY DestKey
+    )
+{
+    YORI_STRING Name;
+    PUCHAR Data;
+    DWORD MaxSubKeyLength;
+    DWORD MaxValueNameLength;
+    DWORD MaxValueData;
+    DWORD NameLength;
+    DWORD DataLength;
+    DWORD DataType;
+    DWORD Disposition;
+    DWORD Index;
+    DWORD Err;
+    HKEY SourceChild;
+    HKEY DestChild;
+    FILETIME LastWriteTime;
+
+    Err = RegeditQueryKeyLimits(SourceKey, &MaxSubKeyLength, &MaxValueNameLength, &MaxValueData);
+    if (Err != ERROR_SUCCESS) {
+        return Err;
+    }
+
+    //
+    //  Use a single buffer both for subkey and value names.
+    //
+
+    if (MaxValueNameLength > MaxSubKeyLength) {
+        MaxSubKeyLength = MaxValueNameLength;
+    }
+
+    if (!YoriLibIsSizeAllocatable(MaxSubKeyLength + 1) ||
+        !YoriLibIsSizeAllocatable(MaxValueData)) {
+
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    if (!YoriLibAllocateString(&Name, (YORI_ALLOC_SIZE_T)(MaxSubKeyLength + 1))) {
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    Data = NULL;
+    if (MaxValueData > 0) {
+        Data = YoriLibMalloc((YORI_ALLOC_SIZE_T)MaxValueData);
+        if (Data == NULL) {
+            YoriLibFreeStringContents(&Name);
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+    }
+
+    for (Index = 0; ; Index++) {
+        NameLength = Name.LengthAllocated;
+        DataLength = MaxValueData;
+        Err = DllAdvApi32.pRegEnumValueW(SourceKey, Index, Name.StartOfString, &NameLength, NULL, &DataType, Data, &DataLength);
+        if (Err == ERROR_NO_MORE_ITEMS) {
+            Err = ERROR_SUCCESS;
+            break;
+        } else if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        Err = DllAdvApi32.pRegSetValueExW(DestKey, Name.StartOfString, 0, DataType, Data, DataLength);
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+    }
+
+    for (Index = 0; Err == ERROR_SUCCESS; Index++) {
+        NameLength = Name.LengthAllocated;
+        Err = DllAdvApi32.pRegEnumKeyExW(SourceKey, Index, Name.StartOfString, &NameLength, NULL, NULL, NULL, &LastWriteTime);
+        if (Err == ERROR_NO_MORE_ITEMS) {
+            Err = ERROR_SUCCESS;
+            break;
+        } else if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        Err = DllAdvApi32.pRegOpenKeyExW(SourceKey, Name.StartOfString, 0, KEY_READ, &SourceChild);
+        if (Err != ERROR_SUCCESS) {
+            break;
+        }
+
+        Err = DllAdvApi32.pRegCreateKeyExW(DestKey, Name.StartOfString, 0, NULL, 0, KEY_READ | KEY_WRITE, NULL, &DestChild, &Disposition);
+        if (Err != ERROR_SUCCESS) {
+            DllAdvApi32.pRegCloseKey(SourceChild);
+            break;
+        }
+
+        Err = RegeditCopyTreeRecursive(SourceChild, DestChild);
+        DllAdvApi32.pRegCloseKey(DestChild);
+        DllAdvApi32.pRegCloseKey(SourceChild);
+    }
+
+    if (Data != NULL) {
+        YoriLibFree(Data);
+    }
+    YoriLibFreeStringContents(&Name);
+    return Err;
+}
+
+/**
+ Copy all values and subkeys from one key to another.  Where the system
+ supports it, this is a single call to RegCopyTreeW, which is much faster
+ than enumerating and copying each item.
+
+ @param SourceKey The key to copy from, opened for read.
+
+ @param DestKey The key to copy to, opened for write.
+
+ @return A Win32 error code, including ERROR_SUCCESS to indicate success.
+ */
+DWORD
+RegeditCopyTree(
+    __in HKEY SourceKey,
+    __in HKEY DestKey
+    )
+{
+    if (DllAdvApi32.pRegCopyTreeW != NULL) {
+        return DllAdvApi32.pRegCopyTreeW(SourceKey, NULL, DestKey);
+    }
+
+    return RegeditCopyTreeRecursive(SourceKey, DestKey);
+}
+
+/**
+ Copy the currently selected key, including all of its values and subkeys,
+ to a new key with a name supplied by the user within the same parent.
+
+ @param RegeditContext Pointer to the global registry editor context.
+
+ @param Parent Pointer to the main window.
+
+ @param KeyList Pointer to the list control containing keys.
+
+ @param SelectedKeyIndex Indicates the currently selected item within the
+        key list control.
+ */
+VOID
+RegeditDuplicateSelectedKey(
+    __in PREGEDIT_CONTEXT RegeditContext,
+    __in PYORI_WIN_CTRL_HANDLE Parent,
+    __in PYORI_WIN_CTRL_HANDLE KeyList,
+    __in YORI_ALLOC_SIZE_T SelectedKeyIndex
+    )
+{
+    YORI_STRING Title;
+    YORI_STRING KeyName;
+    YORI_STRING Value;
+    DWORD Disposition;
+    DWORD Err;
+    HKEY Key;
+    HKEY SourceKey;
+    HKEY DestKey;
+
+    YoriLibInitEmptyString(&KeyName);
+    YoriLibInitEmptyString(&Value);
+    YoriWinListGetItemText(KeyList, SelectedKeyIndex, &KeyName);
+
+    Err = DllAdvApi32.pRegOpenKeyExW(RegeditContext->ActiveRootKey, RegeditContext->Subkey.StartOfString, 0, KEY_READ | KEY_CREATE_SUB_KEY, &Key);
+    if (Err != ERROR_SUCCESS) {
+        YoriLibFreeStringContents(&KeyName);
+        RegeditDisplayWin32Error(Parent, Err);
+        return;
+    }
+
+    Err = DllAdvApi32.pRegOpenKeyExW(Key, KeyName.StartOfString, 0, KEY_READ, &SourceKey);
+    YoriLibFreeStringContents(&KeyName);
+    if (Err != ERROR_SUCCESS) {
+        DllAdvApi32.pRegCloseKey(Key);
+        RegeditDisplayWin32Error(Parent, Err);
+        return;
+    }
+
+    YoriLibConstantString(&Title, _T("Duplicate key as"));
+
+    if (!YoriDlgInput(YoriWinGetWindowManagerHandle(YoriWinGetWindowFromWindowCtrl(Parent)),
+                      &Title,
+                      FALSE,
+                      &Value)) {
+
+        DllAdvApi32.pRegCloseKey(SourceKey);
+        DllAdvApi32.pRegCloseKey(Key);
+        return;
+    }
+
+    ASSERT(YoriLibIsStringNullTerminated(&Value));
+
+    //
+    //  Only allow the copy to be created alongside the source.  A path
+    //  could place the copy within the source, which would be copied
+    //  into itself.
+    //
+
+    Err = ERROR_SUCCESS;
+    if (Value.LengthInChars == 0 ||
+        YoriLibFindLeftMostCharacter(&Value, '\\') != NULL) {
+
+        Err = ERROR_INVALID_NAME;
+    }
+
+    Disposition = 0;
+    if (Err == ERROR_SUCCESS) {
+        Err = DllAdvApi32.pRegCreateKeyExW(Key, Value.StartOfString, 0, NULL, 0, KEY_READ | KEY_WRITE, NULL, &DestKey, &Disposition);
+    }
+
+    YoriLibFreeStringContents(&Value);
+
+    if (Err == ERROR_SUCCESS) {
+        if (Disposition == REG_OPENED_EXISTING_KEY) {
+            YORI_STRING ButtonText[1];
+
+            YoriLibConstantString(&Title, _T("Key already exists"));
+            YoriLibConstantString(&ButtonText[0], _T("&Ok"));
+
+            YoriDlgMessageBox(YoriWinGetWindowManagerHandle(YoriWinGetWindowFromWindowCtrl(Parent)),
+                              &Title,
+                              &Title,
+                              1,
+                              ButtonText,
+                              0,
+                              0);
+        } else {
+            Err = RegeditCopyTree(SourceKey, DestKey);
+        }
+        DllAdvApi32.pRegCloseKey(DestKey);
+    }
+
+    DllAdvApi32.pRegCloseKey(SourceKey);
+    DllAdvApi32.pRegCloseKey(Key);
+
+    if (Err != ERROR_SUCCESS) {
+        RegeditDisplayWin32Error(Parent, Err);
+    }
+
+    RegeditRefreshView(RegeditContext, Parent);
+}
+
+/**
+ Callback invoked when the duplicate key menu item is clicked.
+
+ @param Ctrl Pointer to the menu control.
+ */
+VOID
+RegeditDuplicateKeyButtonClicked(
+    __in PYORI_WIN_CTRL_HANDLE Ctrl
+    )
+{
+    PYORI_WIN_CTRL_HANDLE Parent;
+    PREGEDIT_CONTEXT RegeditContext;
+    PYORI_WIN_CTRL_HANDLE KeyList;
+    YORI_ALLOC_SIZE_T ActiveOption;
+
+    Parent = YoriWinGetControlParent(Ctrl);
+    RegeditContext = YoriWinGetControlContext(Parent);
+
+    if (RegeditContext->TreeDepth == 0) {
+        return;
+    }
+
+    KeyList = YoriWinFindControlById(Parent, RegeditControlKeyList);
+    ASSERT(KeyList != NULL);
+    __analysis_assume(KeyList != NULL);
+
+    //
+    //  The first item is the parent key, which cannot be copied into
+    //  itself.
+    //
+
+    if (YoriWinListGetActiveOption(KeyList, &ActiveOption) && ActiveOption > 0) {
+        RegeditDuplicateSelectedKey(RegeditContext, Parent, KeyList, ActiveOption);
+    }
+}
+
 /**
  Callback invoked when the copy key menu item is clicked.
 
@@ -1696,7 +2643,7 @@ RegeditPopulateMenuBar(
     )
 {
     YORI_WIN_MENU_ENTRY FileMenuEntries[1];
-    YORI_WIN_MENU_ENTRY EditMenuEntries[5];
+    YORI_WIN_MENU_ENTRY EditMenuEntries[6];
     YORI_WIN_MENU_ENTRY ViewMenuEntries[1];
     YORI_WIN_MENU_ENTRY NewMenuEntries[7];
     YORI_WIN_MENU_ENTRY HelpMenuEntries[1];
@@ -1748,6 +2695,11 @@ RegeditPopulateMenuBar(
     YoriLibConstantString(&EditMenuEntries[MenuIndex].Hotkey, _T("Del"));
     RegeditContext->DeleteMenuIndex = MenuIndex;
 
+    MenuIndex++;
+    YoriLibConstantString(&EditMenuEntries[MenuIndex].Caption, _T("D&uplicate Key..."));
+    EditMenuEntries[MenuIndex].NotifyCallback = RegeditDuplicateKeyButtonClicked;
+    RegeditContext->DuplicateKeyMenuIndex = MenuIndex;
+
     MenuIndex++;
     EditMenuEntries[MenuIndex].Flags = YORI_WIN_MENU_ENTRY_SEPERATOR;
     MenuIndex++;
@@ -2105,6 +3057,7 @@ RegeditCreateMainWindow(
 
     Ctrl = YoriWinButtonCreate(Parent, &Area, &Caption, YORI_WIN_BUTTON_STYLE_CANCEL, RegeditCloseButtonClicked);
     if (Ctrl == NULL) {
+        RegeditCancelLoad(RegeditContext);
         YoriWinDestroyWindow(Parent);
         YoriWinCloseWindowManager(WinMgr);
         return FALSE;
@@ -2119,6 +3072,7 @@ RegeditCreateMainWindow(
 
     Ctrl = YoriWinButtonCreate(Parent, &Area, &Caption, YORI_WIN_BUTTON_STYLE_DEFAULT, RegeditGoButtonClicked);
     if (Ctrl == NULL) {
+        RegeditCancelLoad(RegeditContext);
         YoriWinDestroyWindow(Parent);
         YoriWinCloseWindowManager(WinMgr);
         return FALSE;
@@ -2133,6 +3087,7 @@ RegeditCreateMainWindow(
         Result = FALSE;
     }
 
+    RegeditCancelLoad(RegeditContext);
     YoriWinDestroyWindow(Parent);
     YoriWinCloseWindowManager(WinMgr);
     return (BOOLEAN)Result;
@@ -2175,6 +3130,11 @@ ENTRYPOINT(
     RegeditContext.UseAsciiDrawing = FALSE;
     RegeditContext.TreeDepth = 0;
     YoriLibInitEmptyString(&RegeditContext.Subkey);
+    RegeditContext.LoadContext = NULL;
+    RegeditContext.Keys = NULL;
+    RegeditContext.KeysAllocated = 0;
+    RegeditContext.KeysPopulated = 0;
+    RegeditContext.KeysOutOfOrder = FALSE;
 
 
     for (i = 1; i < ArgC; i++) {
@@ -2223,9 +3183,11 @@ ENTRYPOINT(
     }
 
     if (!RegeditCreateMainWindow(&RegeditContext)) {
+        RegeditFreeKeys(&RegeditContext);
         YoriLibFreeStringContents(&RegeditContext.Subkey);
         return EXIT_FAILURE;
     }
+    RegeditFreeKeys(&RegeditContext);
     YoriLibFreeStringContents(&RegeditContext.Subkey);
     return EXIT_SUCCESS;
 }
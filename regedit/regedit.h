@@ -38,6 +38,110 @@ typedef enum _REGEDIT_CONTROLS {
     RegeditControlValueCaption = 8,
 } REGEDIT_CONTROLS;
 
+/**
+ State for the subkeys and values of a key being enumerated by a background
+ thread.
+ */
+typedef struct _REGEDIT_LOAD_CONTEXT {
+
+    /**
+     Handle to the key being enumerated.
+     */
+    HKEY Key;
+
+    /**
+     Handle to the background thread enumerating the key.
+     */
+    HANDLE hThread;
+
+    /**
+     A mutex synchronizing access to the pending subkeys between the
+     background thread and the thread processing input.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled to indicate the background thread should stop
+     enumerating.
+     */
+    HANDLE ShutdownEvent;
+
+    /**
+     The main window, which receives periodic notifications while the
+     enumeration is in progress.
+     */
+    PYORI_WIN_CTRL_HANDLE Window;
+
+    /**
+     An arena used by the background thread to allocate names.  Each name
+     holds a reference to its chunk, so names remain valid after the arena
+     is cleaned up.
+     */
+    YORI_LIB_ARENA Arena;
+
+    /**
+     The length of the longest subkey name, in characters, as reported when
+     the key was opened.
+     */
+    DWORD MaxSubKeyLength;
+
+    /**
+     The length of the longest value name, in characters, as reported when
+     the key was opened.
+     */
+    DWORD MaxValueNameLength;
+
+    /**
+     An array of subkeys that have been enumerated but not yet added to the
+     key list.  Protected by Mutex.
+     */
+    PYORI_STRING PendingKeys;
+
+    /**
+     The number of entries allocated in PendingKeys.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T PendingKeysAllocated;
+
+    /**
+     The number of entries populated in PendingKeys.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T PendingKeysPopulated;
+
+    /**
+     An array of values that have been enumerated.  These are added to the
+     value list when the enumeration completes.  Protected by Mutex.
+     */
+    PYORI_STRING Values;
+
+    /**
+     The number of entries allocated in Values.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T ValuesAllocated;
+
+    /**
+     The number of entries populated in Values.  Protected by Mutex.
+     */
+    YORI_ALLOC_SIZE_T ValuesPopulated;
+
+    /**
+     The key that should be selected when the enumeration completes, if the
+     user has not selected a key by then.  Empty if no key should be
+     selected.
+     */
+    YORI_STRING SelectKey;
+
+    /**
+     The value that should be selected when the enumeration completes.
+     Empty if no value should be selected.
+     */
+    YORI_STRING SelectValue;
+
+    /**
+     The error encountered by the background thread, or ERROR_SUCCESS.
+     */
+    DWORD Error;
+
+} REGEDIT_LOAD_CONTEXT, *PREGEDIT_LOAD_CONTEXT;
 
 /**
  Context for the regedit application.
@@ -84,11 +188,45 @@ typedef struct _REGEDIT_CONTEXT {
      */
     DWORD DeleteMenuIndex;
 
+    /**
+     The index of the duplicate key menu item.
+     */
+    DWORD DuplicateKeyMenuIndex;
+
     /**
      The index of the copy key menu item.
      */
     DWORD CopyKeyMenuIndex;
 
+    /**
+     If the active key is being enumerated by a background thread, points
+     to the state of the enumeration.  NULL if no enumeration is in
+     progress.
+     */
+    PREGEDIT_LOAD_CONTEXT LoadContext;
+
+    /**
+     An array of subkeys of the active key.  The key list is a virtual list
+     displaying these, following a ".." entry.
+     */
+    PYORI_STRING Keys;
+
+    /**
+     The number of entries allocated in Keys.
+     */
+    YORI_ALLOC_SIZE_T KeysAllocated;
+
+    /**
+     The number of entries populated in Keys.
+     */
+    YORI_ALLOC_SIZE_T KeysPopulated;
+
+    /**
+     TRUE if the subkeys were not enumerated in sorted order, so the Keys
+     array needs to be sorted when enumeration completes.
+     */
+    BOOLEAN KeysOutOfOrder;
+
     /**
      TRUE to use only 7 bit ASCII characters for visual display.
      */
@@ -87,8 +87,112 @@ typedef struct _REPL_CONTEXT {
      */
     PYORI_STRING NewString;
 
+    /**
+     A prepared matcher used to find MatchString within lines.  This is only
+     valid while a stream is being processed.
+     */
+    YORI_LIB_SUBSTRING_MATCHER Matcher;
+
 } REPL_CONTEXT, *PREPL_CONTEXT;
 
+/**
+ Apply the replacement to a single line, appending the result to an output
+ string.  All occurrences of the match string are replaced, and searching
+ resumes after each replacement so that replaced text is not searched
+ again.
+
+ @param ReplContext Pointer to the replacement criteria.
+
+ @param Line Pointer to the line to process.
+
+ @param Output Pointer to a string to append the result to.  This string
+        may be reallocated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ReplReplaceLine(
+    __in PREPL_CONTEXT ReplContext,
+    __in PYORI_STRING Line,
+    __inout PYORI_STRING Output
+    )
+{
+    YORI_STRING SearchSubset;
+    YORI_STRING Portion;
+    YORI_ALLOC_SIZE_T SearchOffset;
+    YORI_ALLOC_SIZE_T MatchOffset;
+
+    SearchOffset = 0;
+    YoriLibInitEmptyString(&SearchSubset);
+    YoriLibInitEmptyString(&Portion);
+
+    while(TRUE) {
+
+        //
+        //  Continue searching after any previous replacements
+        //
+
+        SearchSubset.StartOfString = &Line->StartOfString[SearchOffset];
+        SearchSubset.LengthInChars = Line->LengthInChars - SearchOffset;
+
+        //
+        //  If no match is found, the line processing is complete
+        //
+
+        if (YoriLibFindFirstMatchWithMatcher(&ReplContext->Matcher, &SearchSubset, &MatchOffset) == NULL) {
+            break;
+        }
+
+        //
+        //  Output the characters before the match, followed by the new
+        //  string, and continue searching after the match.
+        //
+
+        Portion.StartOfString = SearchSubset.StartOfString;
+        Portion.LengthInChars = MatchOffset;
+
+        if (!YoriLibStringConcatenate(Output, &Portion) ||
+            !YoriLibStringConcatenate(Output, ReplContext->NewString)) {
+
+            return FALSE;
+        }
+
+        SearchOffset = SearchOffset + MatchOffset + ReplContext->MatchString->LengthInChars;
+    }
+
+    return YoriLibStringConcatenate(Output, &SearchSubset);
+}
+
+/**
+ Apply the replacement to a single line when processing a file on multiple
+ threads.  This appends the result and a line ending to the output string.
+
+ @param Context Pointer to the repl context.
+
+ @param Line Pointer to the line to process.
+
+ @param Output Pointer to a string to append the result to.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ReplProcessLineInParallel(
+    __in PVOID Context,
+    __in PYORI_STRING Line,
+    __inout PYORI_STRING Output
+    )
+{
+    PREPL_CONTEXT ReplContext = (PREPL_CONTEXT)Context;
+
+    if (!ReplReplaceLine(ReplContext, Line, Output)) {
+        return FALSE;
+    }
+
+    return YoriLibStringConcatenateWithLiteral(Output, _T("\n"));
+}
+
 /**
  Process a stream and apply the repl criteria before outputting to standard
  output.
@@ -109,110 +213,50 @@ ReplProcessStream(
     PVOID LineContext = NULL;
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     YORI_STRING LineString;
-    YORI_STRING AlternateStrings[2];
-    YORI_STRING InitialPortion;
-    YORI_STRING TrailingPortion;
-    PYORI_STRING SourceString;
-    YORI_ALLOC_SIZE_T SearchOffset;
-    YORI_STRING SearchSubset;
-    YORI_ALLOC_SIZE_T MatchOffset;
-    YORI_ALLOC_SIZE_T NextAlternate;
-    YORI_ALLOC_SIZE_T LengthRequired;
+    YORI_STRING OutputString;
 
     YoriLibInitEmptyString(&LineString);
-    YoriLibInitEmptyString(&AlternateStrings[0]);
-    YoriLibInitEmptyString(&AlternateStrings[1]);
+    YoriLibInitEmptyString(&OutputString);
+    YoriLibInitializeSubstringMatcher(&ReplContext->Matcher, 1, ReplContext->MatchString, (BOOLEAN)ReplContext->Insensitive);
 
     ReplContext->FilesFound++;
 
+    //
+    //  Each line is replaced independently, so large files can be
+    //  processed on multiple threads.  If that is not possible, process
+    //  the file here.
+    //
+
+    if (YoriLibProcessLinesInParallel(hSource, ReplProcessLineInParallel, ReplContext)) {
+        YoriLibCleanupSubstringMatcher(&ReplContext->Matcher);
+        return TRUE;
+    }
+
     while (TRUE) {
 
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
             break;
         }
 
-        //
-        //  Loop through the line, finding all occurrences of the MatchString
-        //  and replacing them with NewString
-        //
-
-        SourceString = &LineString;
-        SearchOffset = 0;
-        NextAlternate = 0;
-        while(TRUE) {
-
-            //
-            //  Continue searching after any previous replacements
-            //
-
-            YoriLibInitEmptyString(&SearchSubset);
-            SearchSubset.StartOfString = &SourceString->StartOfString[SearchOffset];
-            SearchSubset.LengthInChars = SourceString->LengthInChars - SearchOffset;
-
-            //
-            //  If no match is found, the line processing is complete
-            //
-
-            if (ReplContext->Insensitive) {
-                if (YoriLibFindFirstMatchingSubstringInsensitive(&SearchSubset, 1, ReplContext->MatchString, &MatchOffset) == NULL) {
-                    break;
-                }
-            } else {
-                if (YoriLibFindFirstMatchingSubstring(&SearchSubset, 1, ReplContext->MatchString, &MatchOffset) == NULL) {
-                    break;
-                }
-            }
-
-            //
-            //  If a match is found, a new line needs to be assembled
-            //  consisting of characters already processed and not searched
-            //  for, characters before any match was found, the new string,
-            //  and any characters following the match.
-            //
-
-            LengthRequired = SearchOffset + SearchSubset.LengthInChars + ReplContext->NewString->LengthInChars - ReplContext->MatchString->LengthInChars + 1;
-
-            if (LengthRequired > AlternateStrings[NextAlternate].LengthAllocated) {
-                YoriLibFreeStringContents(&AlternateStrings[NextAlternate]);
-                if (!YoriLibAllocateString(&AlternateStrings[NextAlternate], LengthRequired + 256)) {
-                    break;
-                }
-            }
-
-            YoriLibInitEmptyString(&InitialPortion);
-            InitialPortion.StartOfString = SourceString->StartOfString;
-            InitialPortion.LengthInChars = SearchOffset + MatchOffset;
-
-            YoriLibInitEmptyString(&TrailingPortion);
-            TrailingPortion.StartOfString = &SourceString->StartOfString[SearchOffset + MatchOffset + ReplContext->MatchString->LengthInChars];
-            TrailingPortion.LengthInChars = SourceString->LengthInChars - SearchOffset - MatchOffset - ReplContext->MatchString->LengthInChars;
-
-            AlternateStrings[NextAlternate].LengthInChars = YoriLibSPrintf(AlternateStrings[NextAlternate].StartOfString, _T("%y%y%y"), &InitialPortion, ReplContext->NewString, &TrailingPortion);
-
-            //
-            //  Continue searching from the newly assembled string after
-            //  the point of any substitutions.
-            //
-
-            SourceString = &AlternateStrings[NextAlternate];
-            SearchOffset += MatchOffset + ReplContext->NewString->LengthInChars;
-            NextAlternate = (NextAlternate + 1) % 2;
+        OutputString.LengthInChars = 0;
+        if (!ReplReplaceLine(ReplContext, &LineString, &OutputString)) {
+            break;
         }
 
         //
         //  Output the line.
         //
 
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), SourceString);
-        if (SourceString->LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &OutputString);
+        if (OutputString.LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
         }
     }
 
     YoriLibLineReadCloseOrCache(LineContext);
     YoriLibFreeStringContents(&LineString);
-    YoriLibFreeStringContents(&AlternateStrings[0]);
-    YoriLibFreeStringContents(&AlternateStrings[1]);
+    YoriLibFreeStringContents(&OutputString);
+    YoriLibCleanupSubstringMatcher(&ReplContext->Matcher);
 
     return TRUE;
 }
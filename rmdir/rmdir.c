@@ -35,10 +35,11 @@ CHAR strRmdirHelpText[] =
         "\n"
         "Removes directories.\n"
         "\n"
-        "RMDIR [-license] [-b] [-r] [-s] <dir> [<dir>...]\n"
+        "RMDIR [-license] [-b] [-j <num>] [-r] [-s] <dir> [<dir>...]\n"
         "\n"
         "   -b             Use basic search criteria for directories only\n"
         "   -f             Delete files as well as directories\n"
+        "   -j <num>       Delete on the specified number of threads\n"
         "   -l             Delete links without contents\n"
         "   -p             Delete with POSIX semantics\n"
         "   -r             Send directories to the recycle bin\n"
@@ -80,12 +81,93 @@ typedef struct _RMDIR_CONTEXT {
     BOOLEAN PosixSemantics;
 
     /**
-     The number of directories successfully removed.
+     If TRUE, attempt to delete with POSIX semantics, and fall back to
+     regular deletion if the file system does not support it.  This is used
+     when deleting in parallel, because objects deleted with POSIX
+     semantics are removed from the namespace immediately, allowing their
+     parent directory to be removed as soon as the delete completes.
+     */
+    BOOLEAN TryPosixSemantics;
+
+    /**
+     The number of directories successfully removed.  This is updated by
+     worker threads when deleting in parallel.
      */
     DWORD DirectoriesRemoved;
 
+    /**
+     The number of threads to delete with.  If greater than one, objects are
+     deleted in parallel.
+     */
+    DWORD ThreadCount;
+
+    /**
+     When deleting in parallel, a list of directories on the enumerating
+     thread which may still have objects found within them.  The most
+     recently found directory is at the end of the list.
+     */
+    YORI_LIST_ENTRY OpenDirectories;
+
+    /**
+     When deleting in parallel, the work queue which deletes objects.  This
+     is only initialized if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
 } RMDIR_CONTEXT, *PRMDIR_CONTEXT;
 
+/**
+ An object to delete when deleting in parallel.  A directory can only be
+ removed once all objects within it have been deleted, so each object holds
+ a reference on its parent directory, and a directory is deleted when its
+ final reference is released.
+ */
+typedef struct _RMDIR_OBJECT {
+
+    /**
+     The work item used to queue this object to be deleted.
+     */
+    YORILIB_WORK_ITEM WorkItem;
+
+    /**
+     For a directory, the link within the list of directories which may
+     still have objects found within them.  This is only used by the
+     enumerating thread.
+     */
+    YORI_LIST_ENTRY OpenDirectoryList;
+
+    /**
+     The directory containing this object, or NULL if the containing
+     directory is not being tracked.
+     */
+    struct _RMDIR_OBJECT *Parent;
+
+    /**
+     The number of references on this object.  For a directory, one
+     reference is held until the enumerate has returned the directory or
+     moved beyond it, and one reference is held by each object within it.
+     */
+    DWORD ReferenceCount;
+
+    /**
+     The attributes of the object.
+     */
+    DWORD FileAttributes;
+
+    /**
+     TRUE if the enumerate returned this object so it should be deleted.
+     FALSE if the object was only tracked because objects within it were
+     returned.
+     */
+    BOOLEAN Found;
+
+    /**
+     The fully qualified name of the object.  This is allocated as part of
+     this structure.
+     */
+    YORI_STRING FilePath;
+} RMDIR_OBJECT, *PRMDIR_OBJECT;
+
 BOOL
 RmdirFileEnumerateErrorCallback(
     __in PYORI_STRING FilePath,
@@ -95,25 +177,21 @@ RmdirFileEnumerateErrorCallback(
     );
 
 /**
- A callback that is invoked when a file is found that matches a search criteria
- specified in the set of strings to enumerate.
-
- @param FilePath Pointer to the file path that was found.
+ Delete a single file or directory, displaying any error to the user.  This
+ may be called on multiple threads concurrently.
 
- @param FileInfo Information about the file.
+ @param RmdirContext Pointer to the context indicating how to delete the
+        object.
 
- @param Depth Specifies the recursion depth.  Ignored in this application.
-
- @param Context Pointer to a RMDIR_CONTEXT.
+ @param FilePath Pointer to the fully qualified file path to delete.
 
- @return TRUE to continute enumerating, FALSE to abort.
+ @param FileAttributes The attributes of the object to delete.
  */
-BOOL
-RmdirFileFoundCallback(
+VOID
+RmdirDeleteObject(
+    __in PRMDIR_CONTEXT RmdirContext,
     __in PYORI_STRING FilePath,
-    __in PWIN32_FIND_DATA FileInfo,
-    __in DWORD Depth,
-    __in PVOID Context
+    __in DWORD FileAttributes
     )
 {
     DWORD Err = NO_ERROR;
@@ -121,21 +199,6 @@ RmdirFileFoundCallback(
     DWORD OldAttributes;
     DWORD NewAttributes;
     BOOL FileDeleted;
-    PRMDIR_CONTEXT RmdirContext = (PRMDIR_CONTEXT)Context;
-
-    //
-    //  Don't delete any files that are specified on the command line
-    //  directly.  These can be deleted if they're enumerated underneath
-    //  a parent object.
-    //
-
-    if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
-        Depth == 0 &&
-        !RmdirContext->DeleteFiles) {
-
-        RmdirFileEnumerateErrorCallback(FilePath, ERROR_DIRECTORY, Depth, Context);
-        return TRUE;
-    }
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
@@ -147,21 +210,49 @@ RmdirFileFoundCallback(
 
     if (RmdirContext->RecycleBin) {
         if (YoriLibRecycleBinFile(FilePath)) {
-            if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
-                RmdirContext->DirectoriesRemoved++;
+            if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&RmdirContext->DirectoriesRemoved);
             }
             FileDeleted = TRUE;
         }
     }
 
+    //
+    //  If POSIX semantics are being attempted opportunistically, try them
+    //  first.  If the file system doesn't understand the request, stop
+    //  trying.  Any other failure falls through to a regular delete, which
+    //  knows how to handle attributes that prevent deletion.
+    //
+
+    if (!FileDeleted &&
+        !RmdirContext->PosixSemantics &&
+        RmdirContext->TryPosixSemantics) {
+
+        if (YoriLibPosixDeleteFile(FilePath)) {
+            if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&RmdirContext->DirectoriesRemoved);
+            }
+            FileDeleted = TRUE;
+        } else {
+            Err = GetLastError();
+            if (Err == ERROR_INVALID_PARAMETER ||
+                Err == ERROR_INVALID_FUNCTION ||
+                Err == ERROR_NOT_SUPPORTED) {
+
+                RmdirContext->TryPosixSemantics = FALSE;
+            }
+            Err = NO_ERROR;
+        }
+    }
+
     if (!FileDeleted) {
         if (RmdirContext->PosixSemantics) {
             if (!YoriLibPosixDeleteFile(FilePath)) {
                 Err = GetLastError();
-            } else if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
-                RmdirContext->DirectoriesRemoved++;
+            } else if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+                InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&RmdirContext->DirectoriesRemoved);
             }
-        } else if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        } else if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
             if (!DeleteFile(FilePath->StartOfString)) {
                 Err = GetLastError();
             }
@@ -169,7 +260,7 @@ RmdirFileFoundCallback(
             if (!RemoveDirectory(FilePath->StartOfString)) {
                 Err = GetLastError();
             } else {
-                RmdirContext->DirectoriesRemoved++;
+                InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&RmdirContext->DirectoriesRemoved);
             }
         }
     }
@@ -191,7 +282,7 @@ RmdirFileFoundCallback(
 
             Err = NO_ERROR;
 
-            if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
                 if (!DeleteFile(FilePath->StartOfString)) {
                     Err = GetLastError();
                 }
@@ -199,7 +290,7 @@ RmdirFileFoundCallback(
                 if (!RemoveDirectory(FilePath->StartOfString)) {
                     Err = GetLastError();
                 } else {
-                    RmdirContext->DirectoriesRemoved++;
+                    InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&RmdirContext->DirectoriesRemoved);
                 }
             }
 
@@ -215,13 +306,314 @@ RmdirFileFoundCallback(
 
     if (Err != NO_ERROR) {
         ErrText = YoriLibGetWinErrorText(Err);
-        if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        if ((FileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("rmdir: delete failed: %y: %s"), FilePath, ErrText);
         } else {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("rmdir: rmdir failed: %y: %s"), FilePath, ErrText);
         }
         YoriLibFreeWinErrorText(ErrText);
     }
+}
+
+VOID
+RmdirObjectWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    );
+
+/**
+ Allocate an object to delete in parallel.
+
+ @param FilePath Pointer to the fully qualified path of the object.
+
+ @param FileAttributes The attributes of the object.
+
+ @return Pointer to the object, with a single reference held by the caller,
+         or NULL on allocation failure.
+ */
+PRMDIR_OBJECT
+RmdirAllocateObject(
+    __in PYORI_STRING FilePath,
+    __in DWORD FileAttributes
+    )
+{
+    PRMDIR_OBJECT Object;
+    YORI_MAX_UNSIGNED_T BytesRequested;
+
+    BytesRequested = sizeof(RMDIR_OBJECT) + (FilePath->LengthInChars + 1) * sizeof(TCHAR);
+    if (!YoriLibIsSizeAllocatable(BytesRequested)) {
+        return NULL;
+    }
+
+    Object = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequested);
+    if (Object == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Object, sizeof(RMDIR_OBJECT));
+    YoriLibInitializeListHead(&Object->OpenDirectoryList);
+    Object->ReferenceCount = 1;
+    Object->FileAttributes = FileAttributes;
+
+    YoriLibInitEmptyString(&Object->FilePath);
+    Object->FilePath.StartOfString = (LPTSTR)(Object + 1);
+    Object->FilePath.LengthAllocated = (YORI_ALLOC_SIZE_T)(FilePath->LengthInChars + 1);
+    memcpy(Object->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    Object->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+    Object->FilePath.LengthInChars = FilePath->LengthInChars;
+
+    return Object;
+}
+
+/**
+ Release a reference on an object to delete in parallel.  When the final
+ reference is released, the object is queued to be deleted on a worker
+ thread.  If the queue is full, it is deleted on the current thread, so
+ workers releasing directories never wait on each other.
+
+ @param RmdirContext Pointer to the context including the work queue.
+
+ @param Object Pointer to the object to release.
+ */
+VOID
+RmdirReleaseObject(
+    __in PRMDIR_CONTEXT RmdirContext,
+    __in PRMDIR_OBJECT Object
+    )
+{
+    if (InterlockedDecrement((INTERLOCKED_VOLATILE LONG *)&Object->ReferenceCount) == 0) {
+        if (!YoriLibQueueWorkItem(&RmdirContext->WorkQueue, &Object->WorkItem, FALSE)) {
+            RmdirObjectWorker(RmdirContext, &Object->WorkItem, (BOOLEAN)YoriLibIsOperationCancelled());
+        }
+    }
+}
+
+/**
+ A work queue callback invoked to delete an object once everything within
+ it has been deleted.  Deleting the object releases its reference on its
+ parent directory, which may allow the parent to be deleted.
+
+ @param Context Pointer to the rmdir context.
+
+ @param Item Pointer to the work item within the object to delete.
+
+ @param Cancelled If TRUE, the operation has been cancelled, and the object
+        should be freed without being deleted.
+ */
+VOID
+RmdirObjectWorker(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PRMDIR_CONTEXT RmdirContext;
+    PRMDIR_OBJECT Object;
+    PRMDIR_OBJECT Parent;
+
+    RmdirContext = (PRMDIR_CONTEXT)Context;
+    Object = CONTAINING_RECORD(Item, RMDIR_OBJECT, WorkItem);
+
+    if (!Cancelled && Object->Found) {
+        RmdirDeleteObject(RmdirContext, &Object->FilePath, Object->FileAttributes);
+    }
+
+    Parent = Object->Parent;
+    YoriLibFree(Object);
+
+    if (Parent != NULL) {
+        RmdirReleaseObject(RmdirContext, Parent);
+    }
+}
+
+/**
+ Remove directories from the end of the list of open directories until the
+ most recent open directory is either the specified path or a parent of it.
+ Since objects are returned after all objects within them, no more objects
+ can be found within directories removed from the list, so their reference
+ for the enumerate is released.
+
+ @param RmdirContext Pointer to the context containing the list of open
+        directories.
+
+ @param FilePath Pointer to the path to retain in the list of open
+        directories, along with its parents.  If this is an empty string,
+        all directories are removed from the list.
+ */
+VOID
+RmdirCloseOpenDirectories(
+    __in PRMDIR_CONTEXT RmdirContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PRMDIR_OBJECT Directory;
+    YORI_ALLOC_SIZE_T Length;
+
+    while (!YoriLibIsListEmpty(&RmdirContext->OpenDirectories)) {
+        ListEntry = RmdirContext->OpenDirectories.Prev;
+        Directory = CONTAINING_RECORD(ListEntry, RMDIR_OBJECT, OpenDirectoryList);
+        Length = Directory->FilePath.LengthInChars;
+
+        if (Length > 0 &&
+            Length <= FilePath->LengthInChars &&
+            YoriLibCompareStringCount(&Directory->FilePath, FilePath, Length) == 0 &&
+            (Length == FilePath->LengthInChars ||
+             YoriLibIsSep(FilePath->StartOfString[Length]) ||
+             YoriLibIsSep(Directory->FilePath.StartOfString[Length - 1]))) {
+
+            break;
+        }
+
+        YoriLibRemoveListItem(&Directory->OpenDirectoryList);
+        YoriLibInitializeListHead(&Directory->OpenDirectoryList);
+        RmdirReleaseObject(RmdirContext, Directory);
+    }
+}
+
+/**
+ A callback that is invoked when a file is found when deleting in parallel.
+ Files are queued to be deleted immediately.  Directories are deleted once
+ all objects within them have been deleted.
+
+ @param RmdirContext Pointer to the context.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+RmdirParallelFileFound(
+    __in PRMDIR_CONTEXT RmdirContext,
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo
+    )
+{
+    PRMDIR_OBJECT Object;
+    PRMDIR_OBJECT Parent;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING ParentPath;
+    LPTSTR FilePart;
+
+    //
+    //  If this is a directory that already has objects found within it,
+    //  it is the most recent open directory.  Take over the enumerate's
+    //  reference on it.
+    //
+
+    Object = NULL;
+    if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        RmdirCloseOpenDirectories(RmdirContext, FilePath);
+        if (!YoriLibIsListEmpty(&RmdirContext->OpenDirectories)) {
+            ListEntry = RmdirContext->OpenDirectories.Prev;
+            Object = CONTAINING_RECORD(ListEntry, RMDIR_OBJECT, OpenDirectoryList);
+            if (YoriLibCompareString(&Object->FilePath, FilePath) == 0) {
+                YoriLibRemoveListItem(&Object->OpenDirectoryList);
+                YoriLibInitializeListHead(&Object->OpenDirectoryList);
+                Object->FileAttributes = FileInfo->dwFileAttributes;
+            } else {
+                Object = NULL;
+            }
+        }
+    }
+
+    if (Object == NULL) {
+        Object = RmdirAllocateObject(FilePath, FileInfo->dwFileAttributes);
+        if (Object == NULL) {
+            return FALSE;
+        }
+    }
+
+    Object->Found = TRUE;
+
+    //
+    //  Find the directory containing this object, and add it to the list of
+    //  open directories if it's not there already.
+    //
+
+    YoriLibInitEmptyString(&ParentPath);
+    ParentPath.StartOfString = FilePath->StartOfString;
+    FilePart = YoriLibFindRightMostCharacter(FilePath, '\\');
+    if (FilePart != NULL) {
+        ParentPath.LengthInChars = (YORI_ALLOC_SIZE_T)(FilePart - FilePath->StartOfString);
+    }
+
+    Parent = NULL;
+    if (ParentPath.LengthInChars > 0) {
+        RmdirCloseOpenDirectories(RmdirContext, &ParentPath);
+        if (!YoriLibIsListEmpty(&RmdirContext->OpenDirectories)) {
+            ListEntry = RmdirContext->OpenDirectories.Prev;
+            Parent = CONTAINING_RECORD(ListEntry, RMDIR_OBJECT, OpenDirectoryList);
+            if (YoriLibCompareString(&Parent->FilePath, &ParentPath) != 0) {
+                Parent = NULL;
+            }
+        }
+
+        if (Parent == NULL) {
+            Parent = RmdirAllocateObject(&ParentPath, FILE_ATTRIBUTE_DIRECTORY);
+            if (Parent == NULL) {
+                RmdirReleaseObject(RmdirContext, Object);
+                return FALSE;
+            }
+            YoriLibAppendList(&RmdirContext->OpenDirectories, &Parent->OpenDirectoryList);
+        }
+
+        InterlockedIncrement((INTERLOCKED_VOLATILE LONG *)&Parent->ReferenceCount);
+        Object->Parent = Parent;
+    }
+
+    RmdirReleaseObject(RmdirContext, Object);
+    return TRUE;
+}
+
+/**
+ A callback that is invoked when a file is found that matches a search criteria
+ specified in the set of strings to enumerate.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies the recursion depth.  Ignored in this application.
+
+ @param Context Pointer to a RMDIR_CONTEXT.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+RmdirFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PRMDIR_CONTEXT RmdirContext = (PRMDIR_CONTEXT)Context;
+
+    //
+    //  Don't delete any files that are specified on the command line
+    //  directly.  These can be deleted if they're enumerated underneath
+    //  a parent object.
+    //
+
+    if ((FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
+        Depth == 0 &&
+        !RmdirContext->DeleteFiles) {
+
+        RmdirFileEnumerateErrorCallback(FilePath, ERROR_DIRECTORY, Depth, Context);
+        return TRUE;
+    }
+
+    ASSERT(YoriLibIsStringNullTerminated(FilePath));
+
+    if (RmdirContext->ThreadCount > 1) {
+        return RmdirParallelFileFound(RmdirContext, FilePath, FileInfo);
+    }
+
+    RmdirDeleteObject(RmdirContext, FilePath, FileInfo->dwFileAttributes);
     return TRUE;
 }
 
@@ -321,6 +713,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
 
     ZeroMemory(&RmdirContext, sizeof(RmdirContext));
+    YoriLibInitializeListHead(&RmdirContext.OpenDirectories);
 
     Recursive = FALSE;
     BasicEnumeration = FALSE;
@@ -345,6 +738,16 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("f")) == 0) {
                 ArgumentUnderstood = TRUE;
                 RmdirContext.DeleteFiles = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    YORI_MAX_SIGNED_T ThreadCount;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &ThreadCount, &CharsConsumed) && CharsConsumed > 0) {
+                        RmdirContext.ThreadCount = (DWORD)ThreadCount;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 DeleteLinks = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -405,6 +808,23 @@ ENTRYPOINT(
         MatchFlags |= YORILIB_FILEENUM_NO_LINK_TRAVERSE;
     }
 
+    //
+    //  The recycle bin is not used in parallel, since moving objects there
+    //  requires the shell to process each request.
+    //
+
+    if (RmdirContext.RecycleBin) {
+        RmdirContext.ThreadCount = 1;
+    }
+
+    if (RmdirContext.ThreadCount > 1) {
+        if (!YoriLibInitializeWorkQueue(&RmdirContext.WorkQueue, (YORI_ALLOC_SIZE_T)RmdirContext.ThreadCount, 0, RmdirObjectWorker, &RmdirContext)) {
+            RmdirContext.ThreadCount = 1;
+        } else if (DllKernel32.pSetFileInformationByHandle != NULL) {
+            RmdirContext.TryPosixSemantics = TRUE;
+        }
+    }
+
     for (i = StartArg; i < ArgC; i++) {
         YoriLibForEachFile(&ArgV[i],
                            MatchFlags,
@@ -412,8 +832,22 @@ ENTRYPOINT(
                            RmdirFileFoundCallback,
                            RmdirFileEnumerateErrorCallback,
                            &RmdirContext);
+
+        //
+        //  Wait for each argument to be deleted before the next, so that
+        //  arguments which refer to the same objects behave as they would
+        //  when deleting serially.
+        //
+
+        if (RmdirContext.ThreadCount > 1) {
+            YoriLibInitEmptyString(&Arg);
+            RmdirCloseOpenDirectories(&RmdirContext, &Arg);
+            YoriLibWaitForWorkQueue(&RmdirContext.WorkQueue);
+        }
     }
 
+    YoriLibCleanupWorkQueue(&RmdirContext.WorkQueue);
+
     if (RmdirContext.DirectoriesRemoved == 0) {
         return EXIT_FAILURE;
     }
@@ -351,6 +351,14 @@ SdirParseOpt (
             Opts->TraverseLinks = TRUE;
             OptParsed = TRUE;
         }
+    } else if (Opt[0] == 'm') {
+        if (Opt[1] == 'n') {
+            Opts->MetadataCache = FALSE;
+            OptParsed = TRUE;
+        } else if (Opt[1] == '\0') {
+            Opts->MetadataCache = TRUE;
+            OptParsed = TRUE;
+        }
     } else if (Opt[0] == 's' || Opt[0] == 'i') {
 
         //
@@ -432,6 +440,11 @@ SdirParseOpt (
             OptParsed = TRUE;
         }
 #endif
+    } else if (Opt[0] == 'w') {
+        if (Opt[1] == '\0') {
+            Opts->Watch = TRUE;
+            OptParsed = TRUE;
+        }
     }
 
     return OptParsed;
@@ -610,9 +623,11 @@ SdirAppCleanup(VOID)
     YoriLibFileFiltFreeFilter(&SdirGlobal.FileColorCriteria);
     YoriLibFileFiltFreeFilter(&SdirGlobal.FileHideCriteria);
 
-    if (SdirDirCollection != NULL) {
+    while (SdirDirCollection != NULL) {
+        PSDIR_COLLECTION_CHUNK NextChunk;
+        NextChunk = SdirDirCollection->Next;
         YoriLibFree(SdirDirCollection);
-        SdirDirCollection = NULL;
+        SdirDirCollection = NextChunk;
     }
 
     if (SdirDirSorted != NULL) {
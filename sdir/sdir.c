@@ -31,20 +31,36 @@
 
 
 /**
- Specifies the number of directory entries that are currently allocated.
+ The number of bytes of entry data in each block of directory entries.
+ */
+#define SDIR_COLLECTION_CHUNK_SIZE (256 * 1024)
+
+/**
+ Specifies the number of directory entries that SdirDirSorted can currently
+ refer to.
  */
 YORI_ALLOC_SIZE_T SdirAllocatedDirents;
 
 /**
- Pointer to an array of directory entries.  This corresponds to files in
- a single directory, populated in response to enumerate.
+ Pointer to a list of blocks containing directory entries.  This corresponds
+ to files in a single directory, populated in response to enumerate.  Blocks
+ are retained when the collection is reset so they can be reused.
+ */
+PSDIR_COLLECTION_CHUNK SdirDirCollection;
+
+/**
+ Pointer to the block within SdirDirCollection that new entries are being
+ added to.
  */
-PYORI_FILE_INFO SdirDirCollection;
+PSDIR_COLLECTION_CHUNK SdirDirCollectionChunk;
 
 /**
- Pointer to an array of pointers to directory entries.  These pointers
- are maintained sorted based on the user's sort criteria so that files
- can be displayed in order from this indirection.
+ Pointer to an array of pointers to directory entries.  These are populated
+ in the order entries are found.  Once all entries have been collected, these
+ pointers are sorted based on the user's sort criteria so that files can be
+ displayed in order from this indirection.  This allocation is twice
+ SdirAllocatedDirents, with the second half used as scratch space while
+ sorting.
  */
 PYORI_FILE_INFO * SdirDirSorted;
 
@@ -67,6 +83,31 @@ YORI_ALLOC_SIZE_T SdirDirCollectionLongest;
  */
 ULONG SdirDirCollectionTotalNameLength;
 
+/**
+ If TRUE, entries are displayed a page at a time as they are found rather
+ than being collected and sorted before display.  This is only used when the
+ file system is returning entries in the order they would be sorted into.
+ */
+BOOLEAN SdirStreamDisplay;
+
+/**
+ Specifies the number of entries that have already been displayed from the
+ current enumeration as a result of streaming display.
+ */
+YORI_ALLOC_SIZE_T SdirDirCollectionStreamed;
+
+/**
+ State allowing collectors to share a single handle to each file, and to
+ remember the access needed so each file is opened once.
+ */
+YORILIB_COLLECT_SESSION SdirCollectSession;
+
+/**
+ A persistent cache of executable metadata, used if Opts->MetadataCache is
+ set.
+ */
+YORILIB_METADATA_CACHE SdirMetadataCache;
+
 /**
  Pointer to a dynamically allocated options structure which contains run
  time configuration about the application.
@@ -87,6 +128,18 @@ SDIR_GLOBAL SdirGlobal;
 BOOL
 SdirDisplayCollection(VOID);
 
+DWORD
+SdirCompareForSort(
+    __in PYORI_FILE_INFO Left,
+    __in PYORI_FILE_INFO Right
+    );
+
+YORI_ALLOC_SIZE_T
+SdirGetColumnLayout(
+    __inout PYORI_ALLOC_SIZE_T LongestDisplayedFileName,
+    __out PYORI_ALLOC_SIZE_T ColumnWidth
+    );
+
 /**
  Capture all required information from a file found by the system into a
  directory entry.
@@ -116,8 +169,11 @@ SdirCaptureFoundItemIntoDirent (
 
     //
     //  Copy over the data from Win32's FindFirstFile into our own structure.
+    //  Collectors which need a handle to the file share one via the session.
     //
 
+    YoriLibBeginCollectSession(&SdirCollectSession, CurrentEntry);
+
     for (i = 0; i < SdirGetNumSdirOptions(); i++) {
 
         PSDIR_FEATURE Feature;
@@ -134,6 +190,8 @@ SdirCaptureFoundItemIntoDirent (
         }
     }
 
+    YoriLibEndCollectSession(&SdirCollectSession, CurrentEntry);
+
     //
     //  Determine the color to display each entry from extensions and attributes.
     //
@@ -191,7 +249,133 @@ SdirRenderAttributesFromPath (
 }
 
 /**
- Add a single found object to the set of files found so far.
+ Discard all entries in the collection so that it can be populated with a
+ new set of entries.  Memory is retained so that it can be reused.
+ */
+VOID
+SdirResetCollection(VOID)
+{
+    PSDIR_COLLECTION_CHUNK Chunk;
+
+    Chunk = SdirDirCollection;
+    while (Chunk != NULL) {
+        Chunk->BytesUsed = 0;
+        Chunk = Chunk->Next;
+    }
+
+    SdirDirCollectionChunk = SdirDirCollection;
+    SdirDirCollectionCurrent = 0;
+    SdirDirCollectionLongest = 0;
+    SdirDirCollectionTotalNameLength = 0;
+}
+
+/**
+ Allocate space for a directory entry within the collection.  Entries are
+ never moved once allocated.
+
+ @param EntrySize The number of bytes to allocate.
+
+ @return Pointer to the allocated entry, or NULL on failure.
+ */
+PYORI_FILE_INFO
+SdirAllocateDirent(
+    __in DWORD EntrySize
+    )
+{
+    PSDIR_COLLECTION_CHUNK Chunk;
+    PSDIR_COLLECTION_CHUNK NewChunk;
+    PYORI_FILE_INFO Entry;
+
+    //
+    //  Find a block with space, reusing blocks retained from an earlier
+    //  collection before allocating a new one at the end of the list.
+    //
+
+    Chunk = SdirDirCollectionChunk;
+    while (Chunk == NULL || Chunk->BytesUsed + EntrySize > Chunk->BytesAllocated) {
+        if (Chunk != NULL && Chunk->Next != NULL) {
+            Chunk = Chunk->Next;
+            continue;
+        }
+
+        NewChunk = YoriLibMalloc(sizeof(SDIR_COLLECTION_CHUNK) + SDIR_COLLECTION_CHUNK_SIZE);
+        if (NewChunk == NULL) {
+            return NULL;
+        }
+
+        NewChunk->Next = NULL;
+        NewChunk->BytesAllocated = SDIR_COLLECTION_CHUNK_SIZE;
+        NewChunk->BytesUsed = 0;
+
+        if (Chunk == NULL) {
+            SdirDirCollection = NewChunk;
+        } else {
+            Chunk->Next = NewChunk;
+        }
+        Chunk = NewChunk;
+    }
+
+    SdirDirCollectionChunk = Chunk;
+    Entry = YoriLibAddToPointer(Chunk + 1, Chunk->BytesUsed);
+    Chunk->BytesUsed = Chunk->BytesUsed + EntrySize;
+    return Entry;
+}
+
+/**
+ Ensure the array of pointers to directory entries has room for another
+ entry, reallocating it if needed.  Since entries are not moved, existing
+ pointers are copied as they are.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirGrowSortedArray(VOID)
+{
+    YORI_ALLOC_SIZE_T NewAllocatedDirents;
+    PYORI_FILE_INFO * NewSdirDirSorted;
+    YORI_MAX_UNSIGNED_T BytesRequired;
+
+    if (SdirDirSorted != NULL && SdirDirCollectionCurrent < SdirAllocatedDirents) {
+        return TRUE;
+    }
+
+    NewAllocatedDirents = SdirAllocatedDirents;
+    if (SdirDirSorted != NULL) {
+        NewAllocatedDirents = NewAllocatedDirents * 2;
+        if (NewAllocatedDirents <= SdirAllocatedDirents) {
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return FALSE;
+        }
+    }
+
+    BytesRequired = NewAllocatedDirents;
+    BytesRequired = BytesRequired * 2 * sizeof(PYORI_FILE_INFO);
+    if (!YoriLibIsSizeAllocatable(BytesRequired)) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
+    NewSdirDirSorted = YoriLibMalloc((YORI_ALLOC_SIZE_T)BytesRequired);
+    if (NewSdirDirSorted == NULL) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
+    if (SdirDirSorted != NULL) {
+        memcpy(NewSdirDirSorted, SdirDirSorted, SdirDirCollectionCurrent * sizeof(PYORI_FILE_INFO));
+        YoriLibFree(SdirDirSorted);
+    }
+
+    SdirDirSorted = NewSdirDirSorted;
+    SdirAllocatedDirents = NewAllocatedDirents;
+    return TRUE;
+}
+
+/**
+ Add a single found object to the set of files found so far.  The entry is
+ captured into a complete YORI_FILE_INFO, then stored in the collection
+ containing only as much of the file name as is used, which is typically
+ around half of the structure.
 
  @param FindData Pointer to the block of data returned from the directory as
         part of the enumeration.
@@ -206,29 +390,40 @@ SdirAddToCollection (
     __in PYORI_STRING FullPath
     ) 
 {
+    YORI_FILE_INFO CapturedEntry;
     PYORI_FILE_INFO CurrentEntry;
-    YORI_ALLOC_SIZE_T i, j;
-    DWORD CompareResult = 0;
+    DWORD EntrySize;
 
-    if (SdirDirCollectionCurrent >= SdirAllocatedDirents) {
-        if (SdirDirCollectionCurrent < ((YORI_ALLOC_SIZE_T)-1)) {
-            SdirDirCollectionCurrent++;
-        }
-        return FALSE;
-    }
+    SdirCaptureFoundItemIntoDirent(&CapturedEntry, FindData, FullPath, FALSE);
 
-    CurrentEntry = &SdirDirCollection[SdirDirCollectionCurrent];
+    if (CapturedEntry.RenderAttributes.Ctrl & YORILIB_ATTRCTRL_HIDE) {
+        return TRUE;
+    }
 
-    SdirDirCollectionCurrent++;
+    if (!SdirGrowSortedArray()) {
+        return FALSE;
+    }
 
-    SdirCaptureFoundItemIntoDirent(CurrentEntry, FindData, FullPath, FALSE);
+    EntrySize = FIELD_OFFSET(YORI_FILE_INFO, FileName) + (CapturedEntry.FileNameLengthInChars + 1) * sizeof(TCHAR);
+    EntrySize = (EntrySize + sizeof(LARGE_INTEGER) - 1) & ~(sizeof(LARGE_INTEGER) - 1);
+    if (EntrySize > sizeof(YORI_FILE_INFO)) {
+        EntrySize = sizeof(YORI_FILE_INFO);
+    }
 
-    if (CurrentEntry->RenderAttributes.Ctrl & YORILIB_ATTRCTRL_HIDE) {
+    CurrentEntry = SdirAllocateDirent(EntrySize);
+    if (CurrentEntry == NULL) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
 
-        SdirDirCollectionCurrent--;
-        return TRUE;
+    memcpy(CurrentEntry, &CapturedEntry, EntrySize);
+    if (CapturedEntry.Extension != NULL) {
+        CurrentEntry->Extension = CurrentEntry->FileName + (CapturedEntry.Extension - CapturedEntry.FileName);
     }
 
+    SdirDirSorted[SdirDirCollectionCurrent] = CurrentEntry;
+    SdirDirCollectionCurrent++;
+
     if (CurrentEntry->FileNameLengthInChars > SdirDirCollectionLongest) {
         SdirDirCollectionLongest = CurrentEntry->FileNameLengthInChars;
     }
@@ -240,46 +435,67 @@ SdirAddToCollection (
     }
 
     //
-    //  Now that our internal entry is fully poulated, insert it into the
-    //  correct sorted position.  As an optimization, check if we just need
-    //  to insert at the end (for file name sort on NTFS, this is the
-    //  common case.)
+    //  If the file system isn't returning entries in sorted order, stop
+    //  streaming and sort everything before display.  If a page has already
+    //  been displayed it's too late for that, so keep going; each page is
+    //  still sorted before display.
     //
 
-    if (SdirDirCollectionCurrent > 1 &&
-        Opts->Sort[0].CompareFn(SdirDirSorted[SdirDirCollectionCurrent - 2], CurrentEntry) == Opts->Sort[0].CompareInverseCondition) {
+    if (SdirStreamDisplay &&
+        SdirDirCollectionStreamed == 0 &&
+        SdirDirCollectionCurrent > 1 &&
+        SdirCompareForSort(SdirDirSorted[SdirDirCollectionCurrent - 2], CurrentEntry) == YORI_LIB_GREATER_THAN) {
+
+        SdirStreamDisplay = FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ When streaming display, display the entries collected so far if they are
+ enough to fill a page, and start collecting the next page.  The summary
+ is not reset, so it continues to describe all entries found.
+
+ @return TRUE to indicate success, FALSE to indicate failure or that the
+         user cancelled display.
+ */
+BOOL
+SdirStreamPageIfFull(VOID)
+{
+    YORI_ALLOC_SIZE_T LongestDisplayedFileName;
+    YORI_ALLOC_SIZE_T ColumnWidth;
+    YORI_ALLOC_SIZE_T PageEntries;
+    YORI_ALLOC_SIZE_T PageRows;
 
-        SdirDirSorted[SdirDirCollectionCurrent - 1] = CurrentEntry;
+    if (!SdirStreamDisplay || SdirDirCollectionCurrent == 0) {
         return TRUE;
     }
 
     //
-    //  Currently sorting is done very inefficiently by a selection sort
-    //  type algorithm.  Generally this doesn't run due to the optimization
-    //  above.  When a different sort order is requested, performance could
-    //  be improved by using a better algorithm here.
+    //  A page is as many rows as fit on the screen alongside the grid
+    //  lines, in as many columns as the names found so far allow.
     //
 
-    for (i = 0; i < SdirDirCollectionCurrent - 1; i++) {
+    PageRows = 1;
+    if (Opts->ConsoleHeight > 4) {
+        PageRows = Opts->ConsoleHeight - 3;
+    }
 
-        for (j = 0; j < Opts->CurrentSort; j++) {
-            CompareResult = Opts->Sort[j].CompareFn(SdirDirSorted[i], CurrentEntry);
+    LongestDisplayedFileName = SdirDirCollectionLongest;
+    PageEntries = PageRows * SdirGetColumnLayout(&LongestDisplayedFileName, &ColumnWidth);
 
-            if (CompareResult == Opts->Sort[j].CompareBreakCondition ||
-                CompareResult == Opts->Sort[j].CompareInverseCondition) {
-                break;
-            }
-        }
+    if (SdirDirCollectionCurrent < PageEntries) {
+        return TRUE;
+    }
 
-        if (CompareResult == Opts->Sort[j].CompareBreakCondition) {
-            for (j = SdirDirCollectionCurrent - 1; j > i; j--) {
-                SdirDirSorted[j] = SdirDirSorted[j - 1];
-            }
-            SdirDirSorted[i] = CurrentEntry;
-            return TRUE;
-        }
+    if (!SdirDisplayCollection()) {
+        Opts->Cancelled = TRUE;
+        return FALSE;
     }
-    SdirDirSorted[SdirDirCollectionCurrent - 1] = CurrentEntry;
+
+    SdirDirCollectionStreamed = SdirDirCollectionStreamed + SdirDirCollectionCurrent;
+    SdirResetCollection();
     return TRUE;
 }
 
@@ -391,7 +607,10 @@ SdirItemFoundCallback(
         //  Display the default stream
         //
 
-        SdirAddToCollection(FindData, FullPath);
+        if (!SdirAddToCollection(FindData, FullPath)) {
+            ItemContext->Error = GetLastError();
+            return FALSE;
+        }
 
         //
         //  Look for any named streams
@@ -461,7 +680,11 @@ SdirItemFoundCallback(
                     if (!YoriLibUpdateFindDataFromFileInformation(&BogusFindData, ItemContext->StreamFullPath.StartOfString, FALSE)) {
                         memcpy(&BogusFindData, &FindData, sizeof(FindData));
                     }
-                    SdirAddToCollection(&BogusFindData, &ItemContext->StreamFullPath);
+                    if (!SdirAddToCollection(&BogusFindData, &ItemContext->StreamFullPath)) {
+                        ItemContext->Error = GetLastError();
+                        FindClose(hStreamFind);
+                        return FALSE;
+                    }
                 }
             } while (DllKernel32.pFindNextStreamW(hStreamFind, &FindStreamData));
         }
@@ -470,80 +693,25 @@ SdirItemFoundCallback(
 
     } else {
 #endif
-        SdirAddToCollection(FindData, FullPath);
+        if (!SdirAddToCollection(FindData, FullPath)) {
+            ItemContext->Error = GetLastError();
+            return FALSE;
+        }
 #if defined(UNICODE)
     }
 #endif
     ItemContext->ItemsFound++;
-    return TRUE;
-}
-
-/**
- Copy entries from one old sorted array allocation to a new allocation.
- When this occurs the pointer values in the old array need to be adjusted
- from the old allocation to the new allocation.  In addition, entries may
- have been inserted into the old collection which should not be preserved
- because they will be reenumerated.  When this occurs they will be in the
- sorted array in sorted order, so any entry beyond the end of the
- collection array should not be propagated to the new sort array.
-
- @param OldCollection Pointer to the previous array of directory entries.
 
- @param NewCollection Pointer to the new array of directory entries.  This,
-        combined with OldCollection, implies the offset adjustment to apply
-        to any entry within the sorted array.
-
- @param NumberEntriesToCopy Specifies the maximum number of entries that
-        should be copied into the new sorted array.  This is the number of
-        entries within the collection that are being preserved; newer entries
-        will be enumerated again in a subsequent operation.
-
- @param OldSorted Pointer to the previous array of sorted entries.  Entries
-        within this array will be filtered against NumberEntriesToCopy,
-        adjusted based on pointer offset, and propagated to the new array.
-
- @param NewSorted Pointer to the new array of sorted entries.  This will be
-        populated within this routine.
-
- @param NumberSortedEntries The number of elements in the OldSorted array.
- */
-VOID
-SdirMoveSortedEntries(
-    __in PYORI_FILE_INFO OldCollection,
-    __in PYORI_FILE_INFO NewCollection,
-    __in YORI_ALLOC_SIZE_T NumberEntriesToCopy,
-    __in_ecount(NumberSortedEntries) PYORI_FILE_INFO* OldSorted,
-    __out_ecount(NumberEntriesToCopy) PYORI_FILE_INFO* NewSorted,
-    __in YORI_ALLOC_SIZE_T NumberSortedEntries
-    )
-{
-    YORI_ALLOC_SIZE_T SrcIndex;
-    YORI_ALLOC_SIZE_T DestIndex;
-    PYORI_FILE_INFO ThisEntry;
-
-    DestIndex = 0;
-    for (SrcIndex = 0; SrcIndex < NumberSortedEntries; SrcIndex++) {
-        ThisEntry = (PYORI_FILE_INFO)OldSorted[SrcIndex];
-        ASSERT(ThisEntry >= OldCollection);
-        if (ThisEntry < &OldCollection[NumberEntriesToCopy]) {
-            ASSERT(DestIndex < NumberEntriesToCopy);
-            if (DestIndex >= NumberEntriesToCopy) {
-                break;
-            }
-            NewSorted[DestIndex] = (PYORI_FILE_INFO)((PUCHAR)ThisEntry -
-                                                     (PUCHAR)OldCollection +
-                                                     (PUCHAR)NewCollection);
-            DestIndex++;
-        }
+    if (!SdirStreamPageIfFull()) {
+        return FALSE;
     }
 
-    ASSERT(DestIndex == NumberEntriesToCopy);
+    return TRUE;
 }
 
-
 /**
  Enumerate all of the files in a given single directory/wildcard pattern,
- and populate the results into the global SdirAllocatedDirents array.
+ and populate the results into the global SdirDirCollection.
 
  @param FindStr The compound directory/wildcard pattern to enumerate.
 
@@ -558,10 +726,6 @@ SdirEnumeratePathWithDepth (
     )
 {
     LPTSTR FinalPart;
-    YORI_ALLOC_SIZE_T DirEntsToPreserve;
-    SDIR_SUMMARY SummaryToPreserve;
-    PYORI_FILE_INFO NewSdirDirCollection;
-    PYORI_FILE_INFO * NewSdirDirSorted;
     SDIR_ITEM_FOUND_CONTEXT ItemFoundContext;
     WORD MatchFlags;
 
@@ -641,170 +805,87 @@ SdirEnumeratePathWithDepth (
     }
 
     //
-    //  We loop enumerating all the files.  Hopefully for common directories
-    //  we'll allocate a big enough buffer in the first case and we can then
-    //  just populate that buffer and display it.  If the directory is large
-    //  enough though, we count the number of entries, loop back, and allocate
-    //  a large enough buffer to hold the result, then enumerate it again.
-    //  Because we sort the output, we must keep the entire set in memory to
-    //  be able to meaningfully process it.
+    //  If we can't find enumerate, display the error except when we're recursive
+    //  and the error is we found no files in this particular directory.
     //
 
-    DirEntsToPreserve = SdirDirCollectionCurrent;
-    memcpy(&SummaryToPreserve, Summary, sizeof(SummaryToPreserve));
-
-    do {
+    ItemFoundContext.ItemsFound = 0;
+    MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_INCLUDE_DOTFILES;
 
-        //
-        //  If this is a subsequent pass and we didn't allocate a big enough
-        //  buffer, reallocate our buffers.  Add an extra 64 just in case
-        //  we're still adding files in real time.
-        //
+    //
+    //  MSFIX This isn't really correct without a major refactor.  What
+    //  we want is to allow full expansion of the search criteria but
+    //  basic expansion of the search path, since it was the result of
+    //  a prior enumerate.
+    //
 
-        if (SdirDirCollectionCurrent >= SdirAllocatedDirents || SdirDirCollection == NULL) {
-            YORI_ALLOC_SIZE_T PreviousAllocatedDirents = SdirAllocatedDirents;
-            DWORD BytesRequired;
+    if (Depth > 0 || Opts->BasicEnumeration) {
+        MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
+    }
 
-            if (SdirDirCollectionCurrent >= SdirAllocatedDirents) {
-                SdirAllocatedDirents = SdirDirCollectionCurrent + 1;
-            }
-            if (SdirAllocatedDirents < UINT_MAX - 64) {
-                SdirAllocatedDirents += 64;
-            }
+    YoriLibInitEmptyString(&ItemFoundContext.StreamFullPath);
+    ItemFoundContext.Error = ERROR_SUCCESS;
 
-            BytesRequired = SdirAllocatedDirents;
-            BytesRequired = BytesRequired * sizeof(YORI_FILE_INFO);
-            if (!YoriLibIsSizeAllocatable(BytesRequired)) {
-                SdirAllocatedDirents = SdirDirCollectionCurrent;
-                SdirWriteStringWithAttribute(_T("Too many files for a single memory allocation\n"), Opts->FtError.HighlightColor);
-                return FALSE;
-            }
+    if (!YoriLibForEachFile(FindStr,
+                            MatchFlags,
+                            0,
+                            SdirItemFoundCallback,
+                            SdirEnumerateErrorCallback,
+                            &ItemFoundContext)) {
 
-            NewSdirDirCollection = YoriLibMalloc(SdirAllocatedDirents * sizeof(YORI_FILE_INFO));
-            if (NewSdirDirCollection == NULL) {
-                SdirAllocatedDirents = SdirDirCollectionCurrent;
-                SdirDisplayError(GetLastError(), _T("YoriLibMalloc"));
-                return FALSE;
-            }
+        if (Opts->Cancelled) {
+            YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
+            return FALSE;
+        }
 
-            NewSdirDirSorted = YoriLibMalloc(SdirAllocatedDirents * sizeof(PYORI_FILE_INFO));
-            if (NewSdirDirSorted == NULL) {
-                SdirAllocatedDirents = SdirDirCollectionCurrent;
-                YoriLibFree(NewSdirDirCollection);
-                SdirDisplayError(GetLastError(), _T("YoriLibMalloc"));
-                return FALSE;
+        if (!Opts->Recursive) {
+            if (ItemFoundContext.Error == ERROR_SUCCESS) {
+                ItemFoundContext.Error = GetLastError();
             }
+            YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
 
             //
-            //  Copy back any previous data.  This occurs when multiple
-            //  criteria are specified, eg., "*.a *.b".  Apply fixups to
-            //  everything in the sorted array which were based on the
-            //  previous collection and now need to be based on the new one.
+            //  For file not found errors, continue enumerating through
+            //  all of the criteria specified by the user, and display
+            //  it only if there are no files from any criteria
             //
 
-            if (DirEntsToPreserve > 0 && SdirDirCollection != NULL) {
-                memcpy(NewSdirDirCollection, SdirDirCollection, sizeof(YORI_FILE_INFO)*DirEntsToPreserve);
-                SdirMoveSortedEntries(SdirDirCollection, NewSdirDirCollection, DirEntsToPreserve, SdirDirSorted, NewSdirDirSorted, PreviousAllocatedDirents);
-            }
-
-            if (SdirDirCollection != NULL) {
-                YoriLibFree(SdirDirCollection);
-            }
-
-            if (SdirDirSorted != NULL) {
-                YoriLibFree(SdirDirSorted);
-            }
-
-            SdirDirCollection = NewSdirDirCollection;
-            SdirDirSorted = NewSdirDirSorted;
-            SdirDirCollectionCurrent = DirEntsToPreserve;
-            memcpy(Summary, &SummaryToPreserve, sizeof(SummaryToPreserve));
-        }
-
-        //
-        //  If we can't find enumerate, display the error except when we're recursive
-        //  and the error is we found no files in this particular directory.
-        //
-
-        ItemFoundContext.ItemsFound = 0;
-        MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES | YORILIB_FILEENUM_INCLUDE_DOTFILES;
-
-        //
-        //  MSFIX This isn't really correct without a major refactor.  What
-        //  we want is to allow full expansion of the search criteria but
-        //  basic expansion of the search path, since it was the result of
-        //  a prior enumerate.
-        //
-
-        if (Depth > 0 || Opts->BasicEnumeration) {
-            MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
-        }
-
-        YoriLibInitEmptyString(&ItemFoundContext.StreamFullPath);
-        ItemFoundContext.Error = ERROR_SUCCESS;
-
-        if (!YoriLibForEachFile(FindStr,
-                                MatchFlags,
-                                0,
-                                SdirItemFoundCallback,
-                                SdirEnumerateErrorCallback,
-                                &ItemFoundContext)) {
-
-            if (!Opts->Recursive) {
-                if (ItemFoundContext.Error == ERROR_SUCCESS) {
-                    ItemFoundContext.Error = GetLastError();
-                }
-                YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
-
-                //
-                //  For file not found errors, continue enumerating through
-                //  all of the criteria specified by the user, and display
-                //  it only if there are no files from any criteria
-                //
-
-                if (ItemFoundContext.Error != ERROR_FILE_NOT_FOUND) {
-                    SdirDisplayYsError(ItemFoundContext.Error, FindStr);
-                    SetLastError(ItemFoundContext.Error);
-                } else {
-                    return TRUE;
-                }
+            if (ItemFoundContext.Error != ERROR_FILE_NOT_FOUND) {
+                SdirDisplayYsError(ItemFoundContext.Error, FindStr);
+                SetLastError(ItemFoundContext.Error);
             } else {
-                YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
+                return TRUE;
             }
-            return FALSE;
+        } else {
+            YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
         }
+        return FALSE;
+    }
 
-        YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
+    YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
 
-        if (ItemFoundContext.ItemsFound == 0) {
-            if (!Opts->Recursive) {
-                if (ItemFoundContext.Error == ERROR_SUCCESS) {
-                    ItemFoundContext.Error = ERROR_FILE_NOT_FOUND;
-                }
+    if (ItemFoundContext.ItemsFound == 0) {
+        if (!Opts->Recursive) {
+            if (ItemFoundContext.Error == ERROR_SUCCESS) {
+                ItemFoundContext.Error = ERROR_FILE_NOT_FOUND;
+            }
 
-                if (ItemFoundContext.Error != ERROR_FILE_NOT_FOUND) {
-                    SdirDisplayYsError(ItemFoundContext.Error, FindStr);
-                } else {
-                    return TRUE;
-                }
+            if (ItemFoundContext.Error != ERROR_FILE_NOT_FOUND) {
+                SdirDisplayYsError(ItemFoundContext.Error, FindStr);
+            } else {
+                return TRUE;
             }
-            SetLastError(ERROR_FILE_NOT_FOUND);
-            return FALSE;
         }
-
-        //
-        //  If we've encountered more than we've allocated, go back
-        //  and reallocate.
-        //
-
-    } while (SdirDirCollectionCurrent >= SdirAllocatedDirents);
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return FALSE;
+    }
 
     return TRUE;
 }
 
 /**
  Enumerate all of the files in a given single directory/wildcard pattern,
- and populate the results into the global SdirAllocatedDirents array.
+ and populate the results into the global SdirDirCollection.
  This is a trivial wrapper around SdirEnumeratePathWithDepth to maintain
  a function signature.
 
@@ -899,32 +980,323 @@ SdirFeatureColor(
 
 
 /**
- Display the loaded set of files.
+ The number of entries below which a collection is always sorted on a
+ single thread.  Below this, the cost of creating threads exceeds the time
+ spent sorting.
+ */
+#define SDIR_PARALLEL_SORT_THRESHOLD (32 * 1024)
 
- @return TRUE to indicate success, FALSE to indicate failure.
+/**
+ The maximum number of threads to sort a collection with.  This must be a
+ power of two.
  */
-BOOL
-SdirDisplayCollection(VOID)
+#define SDIR_MAX_SORT_THREADS (16)
+
+/**
+ A range of the sorted array to be sorted by a single thread.
+ */
+typedef struct _SDIR_SORT_RANGE {
+
+    /**
+     Pointer to the first entry to sort.
+     */
+    PYORI_FILE_INFO * Entries;
+
+    /**
+     Pointer to scratch space with room for Count entries.
+     */
+    PYORI_FILE_INFO * Scratch;
+
+    /**
+     The number of entries to sort.
+     */
+    YORI_ALLOC_SIZE_T Count;
+} SDIR_SORT_RANGE, *PSDIR_SORT_RANGE;
+
+/**
+ Compare two directory entries against all of the sort criteria specified
+ by the user.
+
+ @param Left Pointer to the first entry to compare.
+
+ @param Right Pointer to the second entry to compare.
+
+ @return YORI_LIB_LESS_THAN if Left should be displayed before Right,
+         YORI_LIB_GREATER_THAN if Left should be displayed after Right,
+         YORI_LIB_EQUAL if the sort criteria do not distinguish them.
+ */
+DWORD
+SdirCompareForSort(
+    __in PYORI_FILE_INFO Left,
+    __in PYORI_FILE_INFO Right
+    )
 {
-    PYORI_FILE_INFO CurrentEntry;
-    YORI_ALLOC_SIZE_T Index, Ext;
-    YORILIB_COLOR_ATTRIBUTES Attributes;
-    YORILIB_COLOR_ATTRIBUTES FeatureColor;
-    YORI_ALLOC_SIZE_T Columns;
-    YORI_ALLOC_SIZE_T ColumnWidth;
-    YORI_ALLOC_SIZE_T ActiveColumn = 0;
-    SDIR_FMTCHAR Line[SDIR_MAX_WIDTH];
-    YORI_ALLOC_SIZE_T CurrentChar = 0;
-    YORI_ALLOC_SIZE_T BufferRows;
-    YORI_ALLOC_SIZE_T LongestDisplayedFileName = SdirDirCollectionLongest;
-    LPTSTR LineElements = SdirLineElementsText;
-    PSDIR_FEATURE Feature;
+    DWORD Index;
+    DWORD CompareResult;
 
-#ifdef UNICODE
-    if (Opts->OutputExtendedCharacters) {
-        LineElements = SdirLineElementsRich;
+    for (Index = 0; Index < Opts->CurrentSort; Index++) {
+        CompareResult = Opts->Sort[Index].CompareFn(Left, Right);
+        if (CompareResult == Opts->Sort[Index].CompareBreakCondition) {
+            return YORI_LIB_GREATER_THAN;
+        }
+        if (CompareResult == Opts->Sort[Index].CompareInverseCondition) {
+            return YORI_LIB_LESS_THAN;
+        }
+    }
+
+    return YORI_LIB_EQUAL;
+}
+
+/**
+ Merge two adjacent sorted runs into a destination array.  Entries which
+ compare equal retain their order, with entries from the first run
+ preceding entries from the second.
+
+ @param Source Pointer to the array containing both runs.
+
+ @param Dest Pointer to the array to write the merged run to.  The merged
+        run is written at the same offset as it is found in Source.
+
+ @param Start The index of the first entry in the first run.
+
+ @param Middle The index of the first entry in the second run.
+
+ @param End The index after the last entry in the second run.
+ */
+VOID
+SdirMergeRuns(
+    __in PYORI_FILE_INFO * Source,
+    __out PYORI_FILE_INFO * Dest,
+    __in YORI_ALLOC_SIZE_T Start,
+    __in YORI_ALLOC_SIZE_T Middle,
+    __in YORI_ALLOC_SIZE_T End
+    )
+{
+    YORI_ALLOC_SIZE_T LeftIndex;
+    YORI_ALLOC_SIZE_T RightIndex;
+    YORI_ALLOC_SIZE_T DestIndex;
+
+    LeftIndex = Start;
+    RightIndex = Middle;
+
+    for (DestIndex = Start; DestIndex < End; DestIndex++) {
+        if (LeftIndex < Middle &&
+            (RightIndex >= End ||
+             SdirCompareForSort(Source[LeftIndex], Source[RightIndex]) != YORI_LIB_GREATER_THAN)) {
+
+            Dest[DestIndex] = Source[LeftIndex];
+            LeftIndex++;
+        } else {
+            Dest[DestIndex] = Source[RightIndex];
+            RightIndex++;
+        }
+    }
+}
+
+/**
+ Sort a range of entries with a stable merge sort.
+
+ @param Entries Pointer to the entries to sort.  On completion, these are
+        in sorted order.
+
+ @param Scratch Pointer to scratch space with room for Count entries.
+
+ @param Count The number of entries to sort.
+ */
+VOID
+SdirSortRange(
+    __inout PYORI_FILE_INFO * Entries,
+    __in PYORI_FILE_INFO * Scratch,
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    PYORI_FILE_INFO * Source;
+    PYORI_FILE_INFO * Dest;
+    PYORI_FILE_INFO * Swap;
+    YORI_ALLOC_SIZE_T Width;
+    YORI_ALLOC_SIZE_T Start;
+    YORI_ALLOC_SIZE_T Middle;
+    YORI_ALLOC_SIZE_T End;
+
+    Source = Entries;
+    Dest = Scratch;
+
+    for (Width = 1; Width < Count; Width = Width * 2) {
+        for (Start = 0; Start < Count; Start = End) {
+            Middle = Start + Width;
+            if (Middle > Count) {
+                Middle = Count;
+            }
+            End = Middle + Width;
+            if (End > Count || End < Middle) {
+                End = Count;
+            }
+            SdirMergeRuns(Source, Dest, Start, Middle, End);
+        }
+
+        Swap = Source;
+        Source = Dest;
+        Dest = Swap;
     }
-#endif
+
+    if (Source != Entries) {
+        memcpy(Entries, Source, Count * sizeof(PYORI_FILE_INFO));
+    }
+}
+
+/**
+ A thread entrypoint which sorts a single range of entries.
+
+ @param Param Pointer to the SDIR_SORT_RANGE describing the entries to sort.
+
+ @return Zero.
+ */
+DWORD WINAPI
+SdirSortRangeThread(
+    __in LPVOID Param
+    )
+{
+    PSDIR_SORT_RANGE Range;
+
+    Range = (PSDIR_SORT_RANGE)Param;
+    SdirSortRange(Range->Entries, Range->Scratch, Range->Count);
+    return 0;
+}
+
+/**
+ Sort the collection of files found according to the user's sort criteria.
+ Entries are collected unsorted, then sorted once here.  Large collections
+ are split into ranges which are sorted on separate threads, then merged.
+
+ @param Count The number of entries in the collection.
+ */
+VOID
+SdirSortCollection(
+    __in YORI_ALLOC_SIZE_T Count
+    )
+{
+    PYORI_FILE_INFO * Scratch;
+    PYORI_FILE_INFO * Source;
+    PYORI_FILE_INFO * Dest;
+    PYORI_FILE_INFO * Swap;
+    SDIR_SORT_RANGE Ranges[SDIR_MAX_SORT_THREADS];
+    HANDLE Threads[SDIR_MAX_SORT_THREADS];
+    YORI_ALLOC_SIZE_T Boundaries[SDIR_MAX_SORT_THREADS + 1];
+    SYSTEM_INFO SystemInfo;
+    DWORD ThreadId;
+    DWORD ThreadCount;
+    DWORD Step;
+    DWORD Index;
+    YORI_ALLOC_SIZE_T Entry;
+    BOOLEAN AlreadySorted;
+
+    Scratch = &SdirDirSorted[SdirAllocatedDirents];
+
+    //
+    //  The sorted array is populated in enumeration order.  For file name
+    //  sort on NTFS, this is already the desired order, so check for that
+    //  first.
+    //
+
+    AlreadySorted = TRUE;
+    for (Entry = 1; Entry < Count; Entry++) {
+        if (SdirCompareForSort(SdirDirSorted[Entry - 1], SdirDirSorted[Entry]) == YORI_LIB_GREATER_THAN) {
+            AlreadySorted = FALSE;
+            break;
+        }
+    }
+
+    if (AlreadySorted) {
+        return;
+    }
+
+    ThreadCount = 1;
+    if (Count >= SDIR_PARALLEL_SORT_THRESHOLD) {
+        GetSystemInfo(&SystemInfo);
+        while (ThreadCount * 2 <= SystemInfo.dwNumberOfProcessors &&
+               ThreadCount * 2 <= SDIR_MAX_SORT_THREADS) {
+
+            ThreadCount = ThreadCount * 2;
+        }
+    }
+
+    if (ThreadCount == 1) {
+        SdirSortRange(SdirDirSorted, Scratch, Count);
+        return;
+    }
+
+    //
+    //  Sort each range on its own thread.  If a thread can't be created,
+    //  sort its range on this thread instead.
+    //
+
+    for (Index = 0; Index <= ThreadCount; Index++) {
+        Boundaries[Index] = (YORI_ALLOC_SIZE_T)((DWORDLONG)Count * Index / ThreadCount);
+    }
+
+    for (Index = 0; Index < ThreadCount; Index++) {
+        Ranges[Index].Entries = &SdirDirSorted[Boundaries[Index]];
+        Ranges[Index].Scratch = &Scratch[Boundaries[Index]];
+        Ranges[Index].Count = Boundaries[Index + 1] - Boundaries[Index];
+        Threads[Index] = CreateThread(NULL, 0, SdirSortRangeThread, &Ranges[Index], 0, &ThreadId);
+        if (Threads[Index] == NULL) {
+            SdirSortRange(Ranges[Index].Entries, Ranges[Index].Scratch, Ranges[Index].Count);
+        }
+    }
+
+    for (Index = 0; Index < ThreadCount; Index++) {
+        if (Threads[Index] != NULL) {
+            WaitForSingleObject(Threads[Index], INFINITE);
+            CloseHandle(Threads[Index]);
+        }
+    }
+
+    //
+    //  Merge adjacent ranges until one sorted range remains.
+    //
+
+    Source = SdirDirSorted;
+    Dest = Scratch;
+
+    for (Step = 1; Step < ThreadCount; Step = Step * 2) {
+        for (Index = 0; Index < ThreadCount; Index = Index + Step * 2) {
+            SdirMergeRuns(Source, Dest, Boundaries[Index], Boundaries[Index + Step], Boundaries[Index + Step * 2]);
+        }
+
+        Swap = Source;
+        Source = Dest;
+        Dest = Swap;
+    }
+
+    if (Source != SdirDirSorted) {
+        memcpy(SdirDirSorted, Source, Count * sizeof(PYORI_FILE_INFO));
+    }
+}
+
+/**
+ Determine how many columns the collection can be displayed in, and the
+ width of each.
+
+ @param LongestDisplayedFileName On input, the length of the longest file
+        name in the collection.  On output, the number of characters of each
+        file name that can be displayed.
+
+ @param ColumnWidth On output, the width of each column in characters,
+        including the grid line separating it from the next.
+
+ @return The number of columns.
+ */
+YORI_ALLOC_SIZE_T
+SdirGetColumnLayout(
+    __inout PYORI_ALLOC_SIZE_T LongestDisplayedFileName,
+    __out PYORI_ALLOC_SIZE_T ColumnWidth
+    )
+{
+    YORI_ALLOC_SIZE_T Columns;
+    YORI_ALLOC_SIZE_T Width;
+    YORI_ALLOC_SIZE_T Longest;
+
+    Longest = *LongestDisplayedFileName;
 
     //
     //  If we're allowed to shorten names to make the display more
@@ -934,27 +1306,27 @@ SdirDisplayCollection(VOID)
     //  a meaningful length to start with (currently 10.)
     //
 
-    if (Opts->EnableNameTruncation) {
+    if (Opts->EnableNameTruncation && SdirDirCollectionCurrent > 0) {
         YORI_ALLOC_SIZE_T AverageNameLength;
 
         AverageNameLength = (YORI_ALLOC_SIZE_T)(SdirDirCollectionTotalNameLength / SdirDirCollectionCurrent);
-        if (LongestDisplayedFileName > 2 * AverageNameLength) {
-            LongestDisplayedFileName = 2 * AverageNameLength;
-            if (LongestDisplayedFileName < 10) {
-                LongestDisplayedFileName = 10;
+        if (Longest > 2 * AverageNameLength) {
+            Longest = 2 * AverageNameLength;
+            if (Longest < 10) {
+                Longest = 10;
             }
         }
     }
 
-    ColumnWidth = Opts->ConsoleWidth;
-    if (ColumnWidth > SDIR_MAX_WIDTH) {
-        ColumnWidth = SDIR_MAX_WIDTH;
+    Width = Opts->ConsoleWidth;
+    if (Width > SDIR_MAX_WIDTH) {
+        Width = SDIR_MAX_WIDTH;
     }
 
     if (Opts->FtFileName.Flags & SDIR_FEATURE_DISPLAY) {
-        Columns = ColumnWidth / (LongestDisplayedFileName + Opts->MetadataWidth);
+        Columns = Width / (Longest + Opts->MetadataWidth);
     } else {
-        Columns = ColumnWidth / (Opts->MetadataWidth);
+        Columns = Width / (Opts->MetadataWidth);
     }
 
     //
@@ -964,16 +1336,53 @@ SdirDisplayCollection(VOID)
     //
 
     if (Columns > 0) {
-        ColumnWidth = ColumnWidth / Columns;
-        LongestDisplayedFileName = ColumnWidth - Opts->MetadataWidth;
+        Width = Width / Columns;
+        Longest = Width - Opts->MetadataWidth;
     } else {
         Columns = 1;
-        ColumnWidth = Opts->MetadataWidth;
+        Width = Opts->MetadataWidth;
         if (Opts->FtFileName.Flags & SDIR_FEATURE_DISPLAY) {
-            ColumnWidth = ColumnWidth + LongestDisplayedFileName;
+            Width = Width + Longest;
         }
     }
 
+    *LongestDisplayedFileName = Longest;
+    *ColumnWidth = Width;
+    return Columns;
+}
+
+/**
+ Display the loaded set of files.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirDisplayCollection(VOID)
+{
+    PYORI_FILE_INFO CurrentEntry;
+    YORI_ALLOC_SIZE_T Index, Ext;
+    YORILIB_COLOR_ATTRIBUTES Attributes;
+    YORILIB_COLOR_ATTRIBUTES FeatureColor;
+    YORI_ALLOC_SIZE_T Columns;
+    YORI_ALLOC_SIZE_T ColumnWidth;
+    YORI_ALLOC_SIZE_T ActiveColumn = 0;
+    SDIR_FMTCHAR Line[SDIR_MAX_WIDTH];
+    YORI_ALLOC_SIZE_T CurrentChar = 0;
+    YORI_ALLOC_SIZE_T BufferRows;
+    YORI_ALLOC_SIZE_T LongestDisplayedFileName = SdirDirCollectionLongest;
+    LPTSTR LineElements = SdirLineElementsText;
+    PSDIR_FEATURE Feature;
+
+#ifdef UNICODE
+    if (Opts->OutputExtendedCharacters) {
+        LineElements = SdirLineElementsRich;
+    }
+#endif
+
+    SdirSortCollection(SdirDirCollectionCurrent);
+
+    Columns = SdirGetColumnLayout(&LongestDisplayedFileName, &ColumnWidth);
+
     //
     //  This really shouldn't happen, even in the worst case of a MAX_PATH name
     //  with all metadata options enabled, but we'll be paranoid.
@@ -1301,6 +1710,473 @@ SdirForEachPathSpec (
     return TRUE;
 }
 
+/**
+ Count the number of sets of files specified by the user.  This follows the
+ same rules as @ref SdirForEachPathSpec without opening any of them.
+
+ @param ArgC The number of arguments passed to the application.
+
+ @param ArgV An array of arguments passed to the application.
+
+ @return The number of sets of files that will be enumerated.
+ */
+YORI_ALLOC_SIZE_T
+SdirCountPathSpecs (
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[]
+    )
+{
+    YORI_ALLOC_SIZE_T CurrentArg;
+    YORI_ALLOC_SIZE_T Count;
+    YORI_STRING Arg;
+
+    Count = 0;
+    for (CurrentArg = 1; CurrentArg < ArgC; CurrentArg++) {
+        if (!YoriLibIsCommandLineOption(&ArgV[CurrentArg], &Arg)) {
+            Count++;
+        }
+    }
+
+    if (Count == 0) {
+        Count = 1;
+    }
+
+    return Count;
+}
+
+/**
+ The size of the buffer used to receive change notifications, in bytes.
+ */
+#define SDIR_WATCH_BUFFER_SIZE (64 * 1024)
+
+/**
+ The time to wait after a change notification for further changes before
+ redisplaying, in milliseconds.  This allows a burst of changes to result in
+ a single redisplay.
+ */
+#define SDIR_WATCH_COALESCE_MS 250
+
+/**
+ The time to wait for a change notification before checking whether the
+ user has cancelled, in milliseconds.
+ */
+#define SDIR_WATCH_POLL_MS     500
+
+/**
+ The set of changes that should cause the directory to be redisplayed.
+ */
+#define SDIR_WATCH_NOTIFY_FILTER (FILE_NOTIFY_CHANGE_FILE_NAME | \
+                                  FILE_NOTIFY_CHANGE_DIR_NAME | \
+                                  FILE_NOTIFY_CHANGE_ATTRIBUTES | \
+                                  FILE_NOTIFY_CHANGE_SIZE | \
+                                  FILE_NOTIFY_CHANGE_LAST_WRITE)
+
+/**
+ The path specification being watched, including the wildcard criteria.
+ This is retained so the collection can be rebuilt.
+ */
+YORI_STRING SdirWatchFindStr;
+
+/**
+ The wildcard criteria component of SdirWatchFindStr.  Files which are
+ created or renamed are only added to the collection if they match it.
+ */
+YORI_STRING SdirWatchCriteria;
+
+/**
+ The number of entries which have been removed from the collection since it
+ was populated.  Removed entries are not freed from the collection blocks,
+ so once this exceeds the number of live entries the collection is rebuilt.
+ */
+YORI_ALLOC_SIZE_T SdirWatchDiscarded;
+
+/**
+ Enumerate the single path specification that will be watched, retaining it
+ so that the collection can be rebuilt and new files can be compared against
+ its criteria.
+
+ @param FindStr The compound directory/wildcard pattern to enumerate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirEnumerateWatchedPath (
+    __in PYORI_STRING FindStr
+    )
+{
+    LPTSTR FinalBackslash;
+
+    YoriLibFreeStringContents(&SdirWatchFindStr);
+    if (!YoriLibCopyString(&SdirWatchFindStr, FindStr)) {
+        SdirDisplayError(ERROR_NOT_ENOUGH_MEMORY, _T("YoriLibCopyString"));
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&SdirWatchCriteria);
+    FinalBackslash = YoriLibFindRightMostCharacter(&SdirWatchFindStr, '\\');
+    if (FinalBackslash != NULL) {
+        SdirWatchCriteria.StartOfString = FinalBackslash + 1;
+        SdirWatchCriteria.LengthInChars = (YORI_ALLOC_SIZE_T)(SdirWatchFindStr.LengthInChars - (FinalBackslash - SdirWatchFindStr.StartOfString) - 1);
+    } else {
+        SdirWatchCriteria.StartOfString = SdirWatchFindStr.StartOfString;
+        SdirWatchCriteria.LengthInChars = SdirWatchFindStr.LengthInChars;
+    }
+
+    return SdirEnumeratePath(FindStr);
+}
+
+/**
+ Remove any entries from the collection that describe the specified file
+ name, including any named streams of it.
+
+ @param FileName The name of the file, relative to the watched directory.
+ */
+VOID
+SdirWatchRemoveEntry(
+    __in PYORI_STRING FileName
+    )
+{
+    PYORI_FILE_INFO Entry;
+    YORI_STRING EntryName;
+    YORI_ALLOC_SIZE_T Index;
+
+    Index = 0;
+    while (Index < SdirDirCollectionCurrent) {
+        Entry = SdirDirSorted[Index];
+        YoriLibInitEmptyString(&EntryName);
+        EntryName.StartOfString = Entry->FileName;
+        EntryName.LengthInChars = Entry->FileNameLengthInChars;
+
+        if (EntryName.LengthInChars >= FileName->LengthInChars &&
+            YoriLibCompareStringInsensitiveCount(&EntryName, FileName, FileName->LengthInChars) == 0 &&
+            (EntryName.LengthInChars == FileName->LengthInChars ||
+             EntryName.StartOfString[FileName->LengthInChars] == ':')) {
+
+            memmove(&SdirDirSorted[Index],
+                    &SdirDirSorted[Index + 1],
+                    (SdirDirCollectionCurrent - Index - 1) * sizeof(PYORI_FILE_INFO));
+            SdirDirCollectionCurrent--;
+            SdirWatchDiscarded++;
+        } else {
+            Index++;
+        }
+    }
+}
+
+/**
+ Apply a buffer of change notifications to the collection.  Entries for
+ files which changed are removed, and files which still exist and match the
+ criteria are captured again and added.
+
+ @param Buffer Pointer to a buffer of FILE_NOTIFY_INFORMATION records.
+
+ @param FullPath Pointer to a string which can be reallocated to hold the
+        full path to each changed file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirWatchApplyChanges(
+    __in PUCHAR Buffer,
+    __inout PYORI_STRING FullPath
+    )
+{
+    PFILE_NOTIFY_INFORMATION Notify;
+    SDIR_ITEM_FOUND_CONTEXT ItemFoundContext;
+    WIN32_FIND_DATA FindData;
+    YORI_STRING FileName;
+    HANDLE hFind;
+    BOOL Result;
+
+    YoriLibInitEmptyString(&ItemFoundContext.StreamFullPath);
+    ItemFoundContext.Error = ERROR_SUCCESS;
+    ItemFoundContext.ItemsFound = 0;
+    Result = TRUE;
+
+    Notify = (PFILE_NOTIFY_INFORMATION)Buffer;
+    while (TRUE) {
+        YoriLibInitEmptyString(&FileName);
+        FileName.StartOfString = Notify->FileName;
+        FileName.LengthInChars = (YORI_ALLOC_SIZE_T)(Notify->FileNameLength / sizeof(WCHAR));
+
+        SdirWatchRemoveEntry(&FileName);
+
+        if (Notify->Action != FILE_ACTION_REMOVED &&
+            Notify->Action != FILE_ACTION_RENAMED_OLD_NAME &&
+            YoriLibDoesFileMatchExpression(&FileName, &SdirWatchCriteria)) {
+
+            if (YoriLibYPrintf(FullPath, _T("%y%y"), &Opts->ParentName, &FileName) < 0 ||
+                FullPath->LengthInChars == 0) {
+
+                SdirWriteString(_T("Path exceeds allocated length\n"));
+                Result = FALSE;
+                break;
+            }
+
+            //
+            //  If the file has already gone away, a later notification will
+            //  describe that, so there's nothing to add.
+            //
+
+            hFind = FindFirstFile(FullPath->StartOfString, &FindData);
+            if (hFind != INVALID_HANDLE_VALUE) {
+                FindClose(hFind);
+                if (!SdirItemFoundCallback(FullPath, &FindData, 0, &ItemFoundContext)) {
+                    SdirDisplayError(ItemFoundContext.Error, _T("SdirItemFoundCallback"));
+                    Result = FALSE;
+                    break;
+                }
+            }
+        }
+
+        if (Notify->NextEntryOffset == 0) {
+            break;
+        }
+        Notify = YoriLibAddToPointer(Notify, Notify->NextEntryOffset);
+    }
+
+    YoriLibFreeStringContents(&ItemFoundContext.StreamFullPath);
+    return Result;
+}
+
+/**
+ Recalculate the state derived from the entire collection, including name
+ lengths used for column layout and the summary, after entries have been
+ removed.
+ */
+VOID
+SdirWatchRecalculateCollection(VOID)
+{
+    PYORI_FILE_INFO Entry;
+    YORI_ALLOC_SIZE_T Index;
+
+    SdirDirCollectionLongest = 0;
+    SdirDirCollectionTotalNameLength = 0;
+    Summary->NumFiles = 0;
+    Summary->NumDirs = 0;
+    Summary->TotalSize = 0;
+    Summary->CompressedSize = 0;
+
+    for (Index = 0; Index < SdirDirCollectionCurrent; Index++) {
+        Entry = SdirDirSorted[Index];
+        if (Entry->FileNameLengthInChars > SdirDirCollectionLongest) {
+            SdirDirCollectionLongest = Entry->FileNameLengthInChars;
+        }
+        SdirDirCollectionTotalNameLength += Entry->FileNameLengthInChars;
+
+        if (Opts->FtSummary.Flags & SDIR_FEATURE_COLLECT) {
+            SdirCollectSummary(Entry);
+        }
+    }
+}
+
+/**
+ Display the collection again after changes have been applied to it.  This
+ sorts and displays the entries already in memory without enumerating the
+ directory again.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirWatchRedisplay(VOID)
+{
+    SdirWatchRecalculateCollection();
+    SdirNewlineThroughDisplay();
+
+    if (SdirDirCollectionCurrent == 0) {
+        SdirDisplayError(ERROR_FILE_NOT_FOUND, NULL);
+    } else if (!SdirDisplayCollection()) {
+        return FALSE;
+    }
+
+    if (Opts->FtSummary.Flags & SDIR_FEATURE_DISPLAY) {
+        SdirDisplaySummary(Opts->FtSummary.HighlightColor);
+    }
+
+    return TRUE;
+}
+
+/**
+ Discard the collection and enumerate the watched directory again.  This is
+ used when change notifications were lost, or when too many entries have
+ been replaced and the collection is mostly consumed by stale entries.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirWatchRebuild(VOID)
+{
+    SdirResetCollection();
+    SdirWatchDiscarded = 0;
+    if (!SdirEnumeratePath(&SdirWatchFindStr)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Watch the directory which has been displayed for changes, and apply them
+ to the collection, redisplaying it once a set of changes is complete.  This
+ continues until the user cancels.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirWatchAndDisplay(VOID)
+{
+    HANDLE hDir;
+    OVERLAPPED Overlapped;
+    PUCHAR Buffer;
+    YORI_STRING FullPath;
+    DWORD BytesReturned;
+    DWORD WaitResult;
+    DWORD Err;
+    BOOLEAN ChangesPending;
+    BOOLEAN ReadPending;
+    BOOL Result;
+
+    if (DllKernel32.pReadDirectoryChangesW == NULL) {
+        SdirDisplayError(ERROR_CALL_NOT_IMPLEMENTED, _T("ReadDirectoryChangesW"));
+        return FALSE;
+    }
+
+    hDir = CreateFile(Opts->ParentName.StartOfString,
+                      FILE_LIST_DIRECTORY,
+                      FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                      NULL,
+                      OPEN_EXISTING,
+                      FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OVERLAPPED,
+                      NULL);
+
+    if (hDir == INVALID_HANDLE_VALUE) {
+        SdirDisplayYsError(GetLastError(), &Opts->ParentName);
+        return FALSE;
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Overlapped.hEvent == NULL) {
+        SdirDisplayError(GetLastError(), _T("CreateEvent"));
+        CloseHandle(hDir);
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(SDIR_WATCH_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        SdirDisplayError(ERROR_NOT_ENOUGH_MEMORY, _T("YoriLibMalloc"));
+        CloseHandle(Overlapped.hEvent);
+        CloseHandle(hDir);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FullPath);
+    ChangesPending = FALSE;
+    ReadPending = FALSE;
+    Result = TRUE;
+
+    while (!Opts->Cancelled) {
+
+        ResetEvent(Overlapped.hEvent);
+        if (!DllKernel32.pReadDirectoryChangesW(hDir,
+                                                Buffer,
+                                                SDIR_WATCH_BUFFER_SIZE,
+                                                FALSE,
+                                                SDIR_WATCH_NOTIFY_FILTER,
+                                                NULL,
+                                                &Overlapped,
+                                                NULL)) {
+
+            SdirDisplayError(GetLastError(), _T("ReadDirectoryChangesW"));
+            Result = FALSE;
+            break;
+        }
+        ReadPending = TRUE;
+
+        //
+        //  Once changes have been applied, only wait briefly for more.  If
+        //  none arrive, the set of changes is complete, so display it.
+        //
+
+        while (TRUE) {
+            if (ChangesPending) {
+                WaitResult = WaitForSingleObject(Overlapped.hEvent, SDIR_WATCH_COALESCE_MS);
+            } else {
+                WaitResult = WaitForSingleObject(Overlapped.hEvent, SDIR_WATCH_POLL_MS);
+            }
+
+            if (WaitResult == WAIT_OBJECT_0 || Opts->Cancelled) {
+                break;
+            }
+
+            if (ChangesPending) {
+                ChangesPending = FALSE;
+                if (!SdirWatchRedisplay()) {
+                    Result = FALSE;
+                    break;
+                }
+            }
+        }
+
+        if (!Result || Opts->Cancelled) {
+            break;
+        }
+
+        ReadPending = FALSE;
+        if (!GetOverlappedResult(hDir, &Overlapped, &BytesReturned, FALSE)) {
+            Err = GetLastError();
+            if (Err != ERROR_NOTIFY_ENUM_DIR) {
+                SdirDisplayError(Err, _T("ReadDirectoryChangesW"));
+                Result = FALSE;
+                break;
+            }
+            BytesReturned = 0;
+        }
+
+        //
+        //  If the buffer overflowed, the individual changes are lost, so
+        //  enumerate the directory again.  Also do this if enough entries
+        //  have been replaced that most of the collection is stale.
+        //
+
+        if (BytesReturned == 0) {
+            if (!SdirWatchRebuild()) {
+                Result = FALSE;
+                break;
+            }
+        } else {
+            if (!SdirWatchApplyChanges(Buffer, &FullPath)) {
+                Result = FALSE;
+                break;
+            }
+
+            if (SdirWatchDiscarded > SdirDirCollectionCurrent) {
+                if (!SdirWatchRebuild()) {
+                    Result = FALSE;
+                    break;
+                }
+            }
+        }
+
+        ChangesPending = TRUE;
+    }
+
+    //
+    //  Closing the handle cancels any outstanding read.  Wait for that to
+    //  complete before freeing the buffer it refers to.
+    //
+
+    CloseHandle(hDir);
+    if (ReadPending) {
+        WaitForSingleObject(Overlapped.hEvent, INFINITE);
+    }
+
+    YoriLibFreeStringContents(&FullPath);
+    YoriLibFree(Buffer);
+    CloseHandle(Overlapped.hEvent);
+    return Result;
+}
+
 /**
  Enumerate and display the contents of a single directory.
 
@@ -1316,12 +2192,47 @@ SdirEnumerateAndDisplay (
     __in YORI_STRING ArgV[]
     )
 {
-    if (!SdirForEachPathSpec(ArgC, ArgV, SdirEnumeratePath)) {
+    //
+    //  If there's a single set of files to display, sorted by name, the
+    //  file system may return them in order already, so display them as
+    //  they arrive.  This is abandoned if they turn out not to be in order
+    //  before the first page is displayed.
+    //
+
+    SdirDirCollectionStreamed = 0;
+    if (!Opts->Watch &&
+        SdirCountPathSpecs(ArgC, ArgV) == 1 &&
+        Opts->Sort[0].CompareFn == YoriLibCompareFileName &&
+        Opts->Sort[0].CompareBreakCondition == YORI_LIB_GREATER_THAN) {
+
+        SdirStreamDisplay = TRUE;
+    }
+
+    //
+    //  When watching, remember the path specification so that changes can
+    //  be applied to it later.  This requires the entries to remain in the
+    //  collection, so they are never streamed.
+    //
+
+    if (Opts->Watch) {
+        if (!SdirForEachPathSpec(ArgC, ArgV, SdirEnumerateWatchedPath)) {
+            return FALSE;
+        }
+    } else if (!SdirForEachPathSpec(ArgC, ArgV, SdirEnumeratePath)) {
+        SdirStreamDisplay = FALSE;
         return FALSE;
     }
 
+    SdirStreamDisplay = FALSE;
+
     if (SdirDirCollectionCurrent == 0) {
+        if (SdirDirCollectionStreamed > 0) {
+            return TRUE;
+        }
         SdirDisplayError(ERROR_FILE_NOT_FOUND, NULL);
+        if (Opts->Watch) {
+            return TRUE;
+        }
         return FALSE;
     }
 
@@ -1463,9 +2374,7 @@ SdirEnumerateAndDisplaySubtree (
     //  optionally following links.
     //
 
-    SdirDirCollectionCurrent = 0;
-    SdirDirCollectionLongest = 0;
-    SdirDirCollectionTotalNameLength = 0;
+    SdirResetCollection();
 
     if (ParentDirectory.LengthInChars == 0 ||
         ParentDirectory.StartOfString[ParentDirectory.LengthInChars - 1] == '\\') {
@@ -1627,16 +2536,46 @@ ENTRYPOINT(
 {
     SdirAllocatedDirents = 1000;
     SdirDirCollection = NULL;
+    SdirDirCollectionChunk = NULL;
     SdirDirSorted = NULL;
     SdirDirCollectionCurrent = 0;
+    SdirDirCollectionStreamed = 0;
+    SdirStreamDisplay = FALSE;
+    YoriLibInitializeCollectSession(&SdirCollectSession);
     SdirDirCollectionLongest = 0;
     SdirDirCollectionTotalNameLength = 0;
     SdirWriteStringLinesDisplayed = 0;
+    YoriLibInitEmptyString(&SdirWatchFindStr);
+    YoriLibInitEmptyString(&SdirWatchCriteria);
+    SdirWatchDiscarded = 0;
 
     if (!SdirInit(ArgC, ArgV)) {
         goto restore_and_exit;
     }
 
+    //
+    //  If the cache can't be used, continue without it.
+    //
+
+    if (Opts->MetadataCache &&
+        YoriLibInitializeMetadataCache(&SdirMetadataCache)) {
+
+        SdirCollectSession.MetadataCache = &SdirMetadataCache;
+    }
+
+    if (Opts->Watch) {
+        if (Opts->Recursive || SdirCountPathSpecs(ArgC, ArgV) != 1) {
+            SdirWriteString(_T("Watch requires a single path specification and cannot be recursive\n"));
+            goto restore_and_exit;
+        }
+
+        //
+        //  Pausing would stop the display from keeping up with changes.
+        //
+
+        Opts->EnablePause = FALSE;
+    }
+
     if (Opts->Recursive) {
         if (!SdirEnumerateAndDisplayRecursive(ArgC, ArgV)) {
             goto restore_and_exit;
@@ -1656,8 +2595,18 @@ ENTRYPOINT(
         SdirDisplaySummary(Opts->FtSummary.HighlightColor);
     }
 
+    if (Opts->Watch) {
+        SdirWatchAndDisplay();
+    }
+
 restore_and_exit:
 
+    YoriLibFreeStringContents(&SdirWatchFindStr);
+    if (SdirCollectSession.MetadataCache != NULL) {
+        YoriLibSaveMetadataCache(SdirCollectSession.MetadataCache);
+        YoriLibCleanupMetadataCache(SdirCollectSession.MetadataCache);
+        SdirCollectSession.MetadataCache = NULL;
+    }
     if (Opts != NULL) {
         SdirSetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), Opts->PreviousAttributes);
     }
@@ -508,6 +508,18 @@ typedef struct _SDIR_OPTS {
      */
     BOOLEAN         BasicEnumeration:1;
 
+    /**
+     TRUE if, after the initial display, the directory should be watched for
+     changes and redisplayed as they occur.
+     */
+    BOOLEAN         Watch:1;
+
+    /**
+     TRUE if metadata parsed from executables should be retained in a
+     persistent cache and reused while the file is unchanged.
+     */
+    BOOLEAN         MetadataCache:1;
+
     /**
      The color attributes from when the program was started, that should
      be restored on exit.
@@ -674,13 +686,37 @@ typedef struct _SDIR_GLOBAL {
     YORI_LIB_FILE_FILTER FileHideCriteria;
 } SDIR_GLOBAL, *PSDIR_GLOBAL;
 
+/**
+ A block of memory containing directory entries.  Entries are stored packed,
+ with each containing only as much of its file name as is used, and are
+ never moved once stored, so pointers to them remain valid as more blocks
+ are added.
+ */
+typedef struct _SDIR_COLLECTION_CHUNK {
+
+    /**
+     Pointer to the next block, or NULL if this is the final block.
+     */
+    struct _SDIR_COLLECTION_CHUNK *Next;
+
+    /**
+     The number of bytes of entry data in this block.
+     */
+    DWORD BytesAllocated;
+
+    /**
+     The number of bytes of entry data currently used in this block.
+     */
+    DWORD BytesUsed;
+} SDIR_COLLECTION_CHUNK, *PSDIR_COLLECTION_CHUNK;
+
 extern SDIR_GLOBAL SdirGlobal;
 
 extern PSDIR_OPTS Opts;
 extern PSDIR_SUMMARY Summary;
 extern const SDIR_OPT SdirOptions[];
 extern const SDIR_EXEC SdirExec[];
-extern PYORI_FILE_INFO SdirDirCollection;
+extern PSDIR_COLLECTION_CHUNK SdirDirCollection;
 extern PYORI_FILE_INFO * SdirDirSorted;
 extern WORD SdirWriteStringLinesDisplayed;
 
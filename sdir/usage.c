@@ -213,6 +213,7 @@ CHAR strCmdLineOpts[] =
                    "   -fc[string]  Apply custom file color string, see file color section\n"
                    "   -fe[string]  Exclude files matching criteria, see file color section\n"
                    "   -l/-ln       Traverse symbolic links and mount points when recursing\n"
+                   "   -m/-mn       Cache/no cache executable metadata between runs\n"
                    "   -p/-pn       Pause/no pause after each screen\n"
                    "   -r           Recurse through directories when enumerating\n"
                    "   -t/-tn       Truncate/no truncate of very long file names\n"
@@ -220,6 +221,7 @@ CHAR strCmdLineOpts[] =
                    "   -u/-un       Unicode/no unicode output\n"
 #endif
                    "   -v           Display version/build info and exit\n"
+                   "   -w           Watch a single directory and redisplay as it changes\n"
                    "";
 
 /**
@@ -82,6 +82,24 @@ PYORI_HASH_TABLE YoriShAliasesHash;
  */
 #define ALIAS_IMPORT_APP_NAME _T("CMD.EXE")
 
+/**
+ Remove an alias from the list and hash table of aliases and free it.  This
+ does not update the console's alias table.
+
+ @param ExistingAlias Pointer to the alias to remove.
+ */
+VOID
+YoriShRemoveAliasEntry(
+    __in PYORI_ALIAS ExistingAlias
+    )
+{
+    YoriLibHashRemoveByKey(YoriShAliasesHash, &ExistingAlias->Alias);
+    YoriLibRemoveListItem(&ExistingAlias->ListEntry);
+    YoriLibFreeStringContents(&ExistingAlias->Alias);
+    YoriLibFreeStringContents(&ExistingAlias->Value);
+    YoriLibDereference(ExistingAlias);
+}
+
 /**
  Delete an existing shell alias.
 
@@ -103,7 +121,7 @@ YoriShDeleteAlias(
         return FALSE;
     }
 
-    HashEntry = YoriLibHashRemoveByKey(YoriShAliasesHash, Alias);
+    HashEntry = YoriLibHashLookupByKey(YoriShAliasesHash, Alias);
     if (HashEntry == NULL) {
         return FALSE;
     }
@@ -113,10 +131,7 @@ YoriShDeleteAlias(
     if (!ExistingAlias->Internal && DllKernel32.pAddConsoleAliasW) {
         DllKernel32.pAddConsoleAliasW(ExistingAlias->Alias.StartOfString, NULL, ALIAS_APP_NAME);
     }
-    YoriLibRemoveListItem(&ExistingAlias->ListEntry);
-    YoriLibFreeStringContents(&ExistingAlias->Alias);
-    YoriLibFreeStringContents(&ExistingAlias->Value);
-    YoriLibDereference(ExistingAlias);
+    YoriShRemoveAliasEntry(ExistingAlias);
     return TRUE;
 }
 
@@ -142,22 +157,40 @@ YoriShAddAlias(
     )
 {
     PYORI_ALIAS NewAlias;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_ALIAS ExistingAlias;
     YORI_ALLOC_SIZE_T AliasNameLengthInChars;
     YORI_ALLOC_SIZE_T ValueNameLengthInChars;
 
     if (YoriShAliasesHash != NULL) {
-        if (Internal) {
-            PYORI_HASH_ENTRY HashEntry;
-            PYORI_ALIAS ExistingAlias;
-            HashEntry = YoriLibHashLookupByKey(YoriShAliasesHash, Alias);
-            if (HashEntry != NULL) {
-                ExistingAlias = HashEntry->Context;
-                if (!ExistingAlias->Internal) {
-                    return FALSE;
-                }
+        HashEntry = YoriLibHashLookupByKey(YoriShAliasesHash, Alias);
+        if (HashEntry != NULL) {
+            ExistingAlias = HashEntry->Context;
+            if (Internal && !ExistingAlias->Internal) {
+                return FALSE;
             }
+
+            //
+            //  If the alias already has this value, there's nothing to
+            //  change here or in the console's alias table.
+            //
+
+            if (ExistingAlias->Internal == Internal &&
+                YoriLibCompareString(&ExistingAlias->Alias, Alias) == 0 &&
+                YoriLibCompareString(&ExistingAlias->Value, Value) == 0) {
+
+                return TRUE;
+            }
+
+            //
+            //  A user alias is replaced in the console's alias table when
+            //  the new value is added below, and an internal alias is not
+            //  there at all, so there's no need to delete it from the
+            //  console first.
+            //
+
+            YoriShRemoveAliasEntry(ExistingAlias);
         }
-        YoriShDeleteAlias(Alias);
     } else {
         YoriLibInitializeListHead(&YoriShAliasesList);
         YoriShAliasesHash = YoriLibAllocateHashTable(250);
@@ -311,6 +344,69 @@ YoriShExpandAlias(
     return FALSE;
 }
 
+/**
+ Determine whether an unparsed command string could begin with an alias.
+ This allows callers to avoid parsing a command when the first argument is
+ a simple word that is not an alias.  If the first argument contains any
+ character that parsing or environment expansion could change, this returns
+ TRUE so that the caller performs a full expansion.
+
+ @param CommandString Pointer to the unparsed command string.
+
+ @return TRUE if the first argument may be an alias, FALSE if it is
+         definitely not an alias.
+ */
+BOOLEAN
+YoriShCommandMayBeAlias(
+    __in PYORI_STRING CommandString
+    )
+{
+    YORI_STRING FirstArg;
+    YORI_ALLOC_SIZE_T Index;
+    TCHAR Char;
+
+    if (YoriShAliasesHash == NULL) {
+        return FALSE;
+    }
+
+    Index = 0;
+    while (Index < CommandString->LengthInChars && CommandString->StartOfString[Index] == ' ') {
+        Index++;
+    }
+
+    YoriLibInitEmptyString(&FirstArg);
+    FirstArg.StartOfString = &CommandString->StartOfString[Index];
+
+    while (Index < CommandString->LengthInChars) {
+        Char = CommandString->StartOfString[Index];
+        if (Char == ' ') {
+            break;
+        }
+
+        if ((Char < 'A' || Char > 'Z') &&
+            (Char < 'a' || Char > 'z') &&
+            (Char < '0' || Char > '9') &&
+            Char != '.' && Char != '-' && Char != '_' && Char != ':' &&
+            Char != '\\' && Char != '/') {
+
+            return TRUE;
+        }
+
+        FirstArg.LengthInChars++;
+        Index++;
+    }
+
+    if (FirstArg.LengthInChars == 0) {
+        return FALSE;
+    }
+
+    if (YoriLibHashLookupByKey(YoriShAliasesHash, &FirstArg) == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Expand aliases in an arbitrary (unparsed) string and return the result as a
  string.
@@ -332,6 +428,10 @@ YoriShExpandAliasFromString(
 {
     YORI_LIBSH_CMD_CONTEXT CmdContext;
 
+    if (!YoriShCommandMayBeAlias(CommandString)) {
+        return FALSE;
+    }
+
     if (!YoriLibShParseCmdlineToCmdContext(CommandString, 0, &CmdContext)) {
         return FALSE;
     }
@@ -719,6 +819,17 @@ YoriShMergeChangedAliasStrings(
     YoriLibInitEmptyString(&FoundAliasName);
     YoriLibInitEmptyString(&FoundAliasValue);
 
+    //
+    //  Typically the child process didn't change any aliases, so check if
+    //  the two sets are identical before comparing each alias.
+    //
+
+    if (OldStrings->LengthInChars == NewStrings->LengthInChars &&
+        memcmp(OldStrings->StartOfString, NewStrings->StartOfString, NewStrings->LengthInChars * sizeof(TCHAR)) == 0) {
+
+        return TRUE;
+    }
+
     //
     //  Navigate through the new alias strings.
     //
@@ -259,6 +259,36 @@ YoriApiGetAliasStrings(
     return YoriShGetAliasStrings(YORI_SH_GET_ALIAS_STRINGS_INCLUDE_USER, AliasStrings);
 }
 
+/**
+ Return a report describing the time spent in each phase of executing
+ commands.  The report must be freed with a subsequent call to
+ @ref YoriApiFreeYoriString .
+
+ @param Reset If TRUE, discard collected timings after generating the
+        report.
+
+ @param Report Pointer to a string structure to populate with a newly
+        allocated string containing the report.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriApiGetCommandTimings(
+    __in BOOL Reset,
+    __out PYORI_STRING Report
+    )
+{
+    BOOL Result;
+
+    YoriLibInitEmptyString(Report);
+    Result = YoriShTimingGetReport(Report);
+    if (Reset) {
+        YoriShTimingReset();
+    }
+    return Result;
+}
+
 /**
  Get an environment variable.
 
@@ -628,4 +658,28 @@ YoriApiWaitForJob(
     YoriShJobWait(JobId);
 }
 
+/**
+ Waits until any one of a set of jobs is no longer active.
+
+ @param JobCount The number of jobs in the JobIds array.
+
+ @param JobIds An array of job IDs to wait for.
+
+ @param CompletedJobId On successful completion, updated to contain the ID
+        of the job that completed.
+
+ @return TRUE to indicate a job completed, FALSE if the wait was cancelled
+         or failed.
+ */
+__success(return)
+BOOL
+YoriApiWaitForAnyJob(
+    __in DWORD JobCount,
+    __in_ecount(JobCount) PDWORD JobIds,
+    __out PDWORD CompletedJobId
+    )
+{
+    return YoriShJobWaitForAny(JobCount, JobIds, CompletedJobId);
+}
+
 // vim:sw=4:ts=4:et:
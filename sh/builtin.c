@@ -266,6 +266,7 @@ YoriShExecuteInProc(
     YoriShGlobal.EscapedArgV = EscapedArgV;
     YoriShGlobal.RecursionDepth++;
     ExitCode = Fn(ArgC, NoEscapedArgV);
+    YoriLibDisplayStatistics();
     YoriShGlobal.RecursionDepth--;
     YoriShGlobal.EscapedArgC = SavedEscapedArgC;
     YoriShGlobal.EscapedArgV = SavedEscapedArgV;
@@ -26,6 +26,32 @@
 
 #include "yori.h"
 
+/**
+ Check whether population of a match list should stop because it is being
+ performed on a background thread and the result is no longer needed.
+
+ @param TabContext Pointer to the tab completion context.
+
+ @return TRUE if population should stop, FALSE if it should continue.
+ */
+BOOLEAN
+YoriShIsTabCompletionCancelled(
+    __in PYORI_SH_TAB_COMPLETE_CONTEXT TabContext
+    )
+{
+    if (TabContext->CancelEvent == NULL) {
+        return FALSE;
+    }
+
+    if (TabContext->RequiresInputThread ||
+        WaitForSingleObject(TabContext->CancelEvent, 0) == WAIT_OBJECT_0) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 /**
  Add a new match to the list of matches and add the match to the hash table
  to check for duplicates.
@@ -182,7 +208,7 @@ YoriShPerformHistoryTabCompletion(
 {
     LPTSTR FoundPath;
     YORI_ALLOC_SIZE_T CompareLength;
-    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING Prefix;
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
     PYORI_SH_TAB_COMPLETE_MATCH Match;
     PYORI_HASH_ENTRY PriorEntry;
@@ -202,56 +228,61 @@ YoriShPerformHistoryTabCompletion(
     FoundPath = NULL;
 
     //
-    //  Search the list of history.
+    //  Search the list of history for entries beginning with the search
+    //  string.
     //
 
-    ListEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, NULL);
-    while (ListEntry != NULL) {
-        HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+    YoriLibInitEmptyString(&Prefix);
+    Prefix.StartOfString = TabContext->SearchString.StartOfString;
+    Prefix.LengthInChars = CompareLength;
 
-        if (YoriLibCompareStringInsensitiveCount(&HistoryEntry->CmdLine, &TabContext->SearchString, CompareLength) == 0) {
+    HistoryEntry = YoriShFindPreviousHistoryEntryByPrefix(&Prefix, NULL);
+    while (HistoryEntry != NULL) {
+        if (YoriShIsTabCompletionCancelled(TabContext)) {
+            return;
+        }
 
-            //
-            //  Allocate a match entry for this file.
-            //
+        //
+        //  Allocate a match entry for this file.
+        //
 
-            Match = YoriLibReferencedMalloc(sizeof(YORI_SH_TAB_COMPLETE_MATCH) + (HistoryEntry->CmdLine.LengthInChars + 1) * sizeof(TCHAR));
-            if (Match == NULL) {
-                return;
-            }
+        Match = YoriLibReferencedMalloc(sizeof(YORI_SH_TAB_COMPLETE_MATCH) + (HistoryEntry->CmdLine.LengthInChars + 1) * sizeof(TCHAR));
+        if (Match == NULL) {
+            return;
+        }
 
-            //
-            //  Populate the file into the entry.
-            //
+        //
+        //  Populate the file into the entry.
+        //
 
-            YoriLibInitEmptyString(&Match->Value);
-            Match->Value.StartOfString = (LPTSTR)(Match + 1);
-            YoriLibReference(Match);
-            Match->Value.MemoryToFree = Match;
-            YoriLibSPrintf(Match->Value.StartOfString, _T("%y"), &HistoryEntry->CmdLine);
-            Match->Value.LengthInChars = HistoryEntry->CmdLine.LengthInChars;
-            Match->CursorOffset = Match->Value.LengthInChars;
+        YoriLibInitEmptyString(&Match->Value);
+        Match->Value.StartOfString = (LPTSTR)(Match + 1);
+        YoriLibReference(Match);
+        Match->Value.MemoryToFree = Match;
+        YoriLibSPrintf(Match->Value.StartOfString, _T("%y"), &HistoryEntry->CmdLine);
+        Match->Value.LengthInChars = HistoryEntry->CmdLine.LengthInChars;
+        Match->CursorOffset = Match->Value.LengthInChars;
 
-            //
-            //  If the user is requesting all matches to be enumerates for
-            //  tab completion, don't add an entry if there's a duplicate.
-            //  If the user is requesting to be able to cycle to the next
-            //  entry, keep duplicates, because they're an in-order record
-            //  of the commands the user entered.
-
-            PriorEntry = NULL;
-            if (YoriShGlobal.CompletionListAll) {
-                PriorEntry = YoriLibHashLookupByKey(TabContext->MatchHashTable, &Match->Value);
-            }
+        //
+        //  If the user is requesting all matches to be enumerates for
+        //  tab completion, don't add an entry if there's a duplicate.
+        //  If the user is requesting to be able to cycle to the next
+        //  entry, keep duplicates, because they're an in-order record
+        //  of the commands the user entered.
 
-            if (PriorEntry == NULL) {
-                YoriShAddMatchToTabContextAtEnd(TabContext, Match);
-            } else {
-                YoriLibFreeStringContents(&Match->Value);
-                YoriLibDereference(Match);
-            }
+        PriorEntry = NULL;
+        if (YoriShGlobal.CompletionListAll) {
+            PriorEntry = YoriLibHashLookupByKey(TabContext->MatchHashTable, &Match->Value);
         }
-        ListEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+
+        if (PriorEntry == NULL) {
+            YoriShAddMatchToTabContextAtEnd(TabContext, Match);
+        } else {
+            YoriLibFreeStringContents(&Match->Value);
+            YoriLibDereference(Match);
+        }
+
+        HistoryEntry = YoriShFindPreviousHistoryEntryByPrefix(&Prefix, HistoryEntry);
     }
 }
 
@@ -347,6 +378,10 @@ YoriShAddExecutableToTabList(
     YORI_STRING PathToReturn;
     YORI_STRING StringToFinalSlash;
 
+    if (YoriShIsTabCompletionCancelled(ExecTabContext->TabContext)) {
+        return FALSE;
+    }
+
     YoriLibInitEmptyString(&PathToReturn);
     YoriLibInitEmptyString(&StringToFinalSlash);
 
@@ -813,6 +848,10 @@ YoriShFileTabCompletionCallback(
 
     UNREFERENCED_PARAMETER(Depth);
 
+    if (YoriShIsTabCompletionCancelled(FileCompleteContext->TabContext)) {
+        return FALSE;
+    }
+
     if (FileCompleteContext->ExpandFullPath) {
 
         //
@@ -1044,6 +1083,604 @@ YoriShFileTabCompletionErrorCallback(
     return TRUE;
 }
 
+/**
+ The maximum number of directories whose contents are retained for
+ completion.
+ */
+#define YORI_SH_DIRECTORY_CACHE_MAX_DIRECTORIES (16)
+
+/**
+ The number of milliseconds that the contents of a directory are retained
+ for completion.  Changes are normally detected with a change notification,
+ so this exists to bound the staleness if notifications are not delivered.
+ */
+#define YORI_SH_DIRECTORY_CACHE_LIFETIME (30 * 1000)
+
+/**
+ A single object found within a cached directory.
+ */
+typedef struct _YORI_SH_DIRECTORY_CACHE_ENTRY {
+
+    /**
+     The full path to the object, as returned by directory enumeration.
+     */
+    YORI_STRING FullPath;
+
+    /**
+     Information about the object returned by directory enumeration.
+     */
+    WIN32_FIND_DATA FindData;
+} YORI_SH_DIRECTORY_CACHE_ENTRY, *PYORI_SH_DIRECTORY_CACHE_ENTRY;
+
+/**
+ The contents of a directory retained for completion.
+ */
+typedef struct _YORI_SH_DIRECTORY_CACHE_DIRECTORY {
+
+    /**
+     The links within the list of cached directories, ordered from least to
+     most recently used.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry within the hash table of cached directories, keyed by the
+     full path to the directory.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     A change notification handle which is signalled when the directory's
+     contents change.  This can be NULL if change notification is not
+     available.
+     */
+    HANDLE ChangeHandle;
+
+    /**
+     The tick count when the directory was enumerated.
+     */
+    DWORD LoadTime;
+
+    /**
+     The number of elements within Entries that have been populated.
+     */
+    YORI_ALLOC_SIZE_T EntryCount;
+
+    /**
+     The number of elements allocated in Entries.
+     */
+    YORI_ALLOC_SIZE_T EntriesAllocated;
+
+    /**
+     An array of objects found within the directory.
+     */
+    PYORI_SH_DIRECTORY_CACHE_ENTRY Entries;
+
+    /**
+     Set to TRUE if the directory could not be completely enumerated.
+     */
+    BOOLEAN LoadFailed;
+} YORI_SH_DIRECTORY_CACHE_DIRECTORY, *PYORI_SH_DIRECTORY_CACHE_DIRECTORY;
+
+/**
+ Directory contents retained for completion.  Enumerating a directory on a
+ network share can take seconds, and repeated tab completion or
+ suggestions in the same directory would otherwise enumerate it each
+ time.
+ */
+typedef struct _YORI_SH_DIRECTORY_CACHE {
+
+    /**
+     A mutex to synchronize access to the cache.  The cache is used by the
+     input thread and by background suggestion threads.  If NULL, the cache
+     is not enabled.
+     */
+    HANDLE Mutex;
+
+    /**
+     A hash table of cached directories.
+     */
+    PYORI_HASH_TABLE Directories;
+
+    /**
+     A list of cached directories, ordered from least to most recently
+     used.
+     */
+    YORI_LIST_ENTRY DirectoryList;
+
+    /**
+     The number of directories in the cache.
+     */
+    DWORD DirectoryCount;
+} YORI_SH_DIRECTORY_CACHE, *PYORI_SH_DIRECTORY_CACHE;
+
+/**
+ Directory contents retained for completion.
+ */
+YORI_SH_DIRECTORY_CACHE YoriShDirectoryCache;
+
+/**
+ Enable retaining the contents of directories on network shares for
+ completion.  This should be called before any background suggestion
+ threads are started.  The caller should call
+ @ref YoriShCleanupCompletionCache before exiting.
+
+ @return TRUE to indicate the cache was enabled, FALSE if it was not.
+ */
+BOOL
+YoriShEnableCompletionCache(VOID)
+{
+    if (YoriShDirectoryCache.Mutex != NULL) {
+        return TRUE;
+    }
+
+    YoriShDirectoryCache.Directories = YoriLibAllocateHashTable(YORI_SH_DIRECTORY_CACHE_MAX_DIRECTORIES);
+    if (YoriShDirectoryCache.Directories == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitializeListHead(&YoriShDirectoryCache.DirectoryList);
+    YoriShDirectoryCache.DirectoryCount = 0;
+
+    YoriShDirectoryCache.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriShDirectoryCache.Mutex == NULL) {
+        YoriLibFreeEmptyHashTable(YoriShDirectoryCache.Directories);
+        YoriShDirectoryCache.Directories = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Free a cached directory.  The directory must not be in the cache.
+
+ @param Directory Pointer to the directory to free.
+ */
+VOID
+YoriShFreeDirectoryCacheDirectory(
+    __in PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (Directory->ChangeHandle != NULL) {
+        FindCloseChangeNotification(Directory->ChangeHandle);
+    }
+
+    if (Directory->Entries != NULL) {
+        for (Index = 0; Index < Directory->EntryCount; Index++) {
+            YoriLibFreeStringContents(&Directory->Entries[Index].FullPath);
+        }
+        YoriLibFree(Directory->Entries);
+    }
+
+    YoriLibFree(Directory);
+}
+
+/**
+ Remove a directory from the cache and free it.  The caller must hold the
+ cache mutex.
+
+ @param Directory Pointer to the directory to remove.
+ */
+VOID
+YoriShRemoveDirectoryCacheDirectory(
+    __in PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory
+    )
+{
+    YoriLibRemoveListItem(&Directory->ListEntry);
+    YoriLibHashRemoveByEntry(&Directory->HashEntry);
+    ASSERT(YoriShDirectoryCache.DirectoryCount > 0);
+    YoriShDirectoryCache.DirectoryCount--;
+    YoriShFreeDirectoryCacheDirectory(Directory);
+}
+
+/**
+ Free all state associated with the completion cache.
+ */
+VOID
+YoriShCleanupCompletionCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory;
+
+    if (YoriShDirectoryCache.Mutex == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShDirectoryCache.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, YORI_SH_DIRECTORY_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShDirectoryCache.DirectoryList, ListEntry);
+        YoriShRemoveDirectoryCacheDirectory(Directory);
+    }
+
+    YoriLibFreeEmptyHashTable(YoriShDirectoryCache.Directories);
+    YoriShDirectoryCache.Directories = NULL;
+    CloseHandle(YoriShDirectoryCache.Mutex);
+    YoriShDirectoryCache.Mutex = NULL;
+}
+
+/**
+ Invoked for each object found when enumerating a directory to populate
+ the cache.
+
+ @param Filename Pointer to a string containing the full file name.
+
+ @param FileInfo Pointer to the block of information returned by directory
+        enumeration describing the entry.
+
+ @param Depth Specifies the recursion depth.  Ignored in this function.
+
+ @param Context Pointer to the cached directory being populated.
+
+ @return TRUE to continue enumerating, FALSE to stop.
+ */
+BOOL
+YoriShDirectoryCacheLoadCallback(
+    __in PYORI_STRING Filename,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory;
+    PYORI_SH_DIRECTORY_CACHE_ENTRY NewEntries;
+    PYORI_SH_DIRECTORY_CACHE_ENTRY Entry;
+    YORI_ALLOC_SIZE_T NewAllocated;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    Directory = (PYORI_SH_DIRECTORY_CACHE_DIRECTORY)Context;
+
+    if (Directory->EntryCount == Directory->EntriesAllocated) {
+        NewAllocated = Directory->EntriesAllocated * 2 + 64;
+        if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)NewAllocated * sizeof(YORI_SH_DIRECTORY_CACHE_ENTRY))) {
+            Directory->LoadFailed = TRUE;
+            return FALSE;
+        }
+
+        NewEntries = YoriLibMalloc(NewAllocated * sizeof(YORI_SH_DIRECTORY_CACHE_ENTRY));
+        if (NewEntries == NULL) {
+            Directory->LoadFailed = TRUE;
+            return FALSE;
+        }
+
+        if (Directory->Entries != NULL) {
+            memcpy(NewEntries, Directory->Entries, Directory->EntryCount * sizeof(YORI_SH_DIRECTORY_CACHE_ENTRY));
+            YoriLibFree(Directory->Entries);
+        }
+
+        Directory->Entries = NewEntries;
+        Directory->EntriesAllocated = NewAllocated;
+    }
+
+    Entry = &Directory->Entries[Directory->EntryCount];
+    if (!YoriLibCopyString(&Entry->FullPath, Filename)) {
+        Directory->LoadFailed = TRUE;
+        return FALSE;
+    }
+
+    memcpy(&Entry->FindData, FileInfo, sizeof(WIN32_FIND_DATA));
+    Directory->EntryCount++;
+    return TRUE;
+}
+
+/**
+ Invoked when a directory cannot be enumerated to populate the cache.  The
+ directory is not cached, so any error is reported when enumerating it
+ without the cache.
+
+ @param FilePath Pointer to the file path that could not be enumerated.
+
+ @param ErrorCode The Win32 error code describing the failure.
+
+ @param Depth Recursion depth, ignored in this application.
+
+ @param Context Pointer to the cached directory being populated.
+
+ @return FALSE to abort enumeration.
+ */
+BOOL
+YoriShDirectoryCacheLoadErrorCallback(
+    __in PYORI_STRING FilePath,
+    __in DWORD ErrorCode,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory;
+
+    UNREFERENCED_PARAMETER(FilePath);
+    UNREFERENCED_PARAMETER(ErrorCode);
+    UNREFERENCED_PARAMETER(Depth);
+
+    Directory = (PYORI_SH_DIRECTORY_CACHE_DIRECTORY)Context;
+    Directory->LoadFailed = TRUE;
+    return FALSE;
+}
+
+/**
+ Enumerate a directory and construct a cached directory from its
+ contents.
+
+ @param DirectoryPart The directory to enumerate, as specified by the user.
+        This may be relative and may be empty to indicate the current
+        directory.  It is used to enumerate so that the names found are
+        identical to the names found when enumerating without the cache.
+
+ @param FullDirectory The full path to the directory.
+
+ @return On successful completion, a newly allocated cached directory which
+         is not yet inserted into the cache.  NULL on failure.
+ */
+__success(return != NULL)
+PYORI_SH_DIRECTORY_CACHE_DIRECTORY
+YoriShLoadDirectoryCacheDirectory(
+    __in PYORI_STRING DirectoryPart,
+    __in PYORI_STRING FullDirectory
+    )
+{
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory;
+    YORI_STRING SearchName;
+
+    Directory = YoriLibMalloc(sizeof(YORI_SH_DIRECTORY_CACHE_DIRECTORY));
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Directory, sizeof(YORI_SH_DIRECTORY_CACHE_DIRECTORY));
+
+    //
+    //  Register for changes before reading the directory so that any change
+    //  made while reading it is detected on the next lookup.
+    //
+
+    Directory->ChangeHandle = FindFirstChangeNotification(FullDirectory->StartOfString, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+    if (Directory->ChangeHandle == INVALID_HANDLE_VALUE) {
+        Directory->ChangeHandle = NULL;
+    }
+
+    if (!YoriLibAllocateString(&SearchName, DirectoryPart->LengthInChars + sizeof("*"))) {
+        YoriShFreeDirectoryCacheDirectory(Directory);
+        return NULL;
+    }
+
+    SearchName.LengthInChars = YoriLibSPrintfS(SearchName.StartOfString, SearchName.LengthAllocated, _T("%y*"), DirectoryPart);
+
+    Directory->LoadTime = GetTickCount();
+    YoriLibForEachFile(&SearchName,
+                       YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES,
+                       0,
+                       YoriShDirectoryCacheLoadCallback,
+                       YoriShDirectoryCacheLoadErrorCallback,
+                       Directory);
+
+    YoriLibFreeStringContents(&SearchName);
+
+    if (Directory->LoadFailed) {
+        YoriShFreeDirectoryCacheDirectory(Directory);
+        return NULL;
+    }
+
+    return Directory;
+}
+
+/**
+ Check whether a cached directory still describes the directory's contents.
+
+ @param Directory Pointer to the cached directory.
+
+ @return TRUE if the cached directory is current, FALSE if it should be
+         discarded.
+ */
+BOOLEAN
+YoriShIsDirectoryCacheDirectoryCurrent(
+    __in PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory
+    )
+{
+    if (GetTickCount() - Directory->LoadTime > YORI_SH_DIRECTORY_CACHE_LIFETIME) {
+        return FALSE;
+    }
+
+    if (Directory->ChangeHandle != NULL &&
+        WaitForSingleObject(Directory->ChangeHandle, 0) == WAIT_OBJECT_0) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Check whether a directory is on a network share, where enumerating it is
+ expensive enough to justify caching its contents.
+
+ @param FullDirectory The full path to the directory, including the \\?\
+        prefix.
+
+ @return TRUE if the directory is on a network share, FALSE if it is not.
+ */
+BOOLEAN
+YoriShIsDirectoryRemote(
+    __in PYORI_STRING FullDirectory
+    )
+{
+    TCHAR DriveRoot[4];
+
+    if (YoriLibIsFullPathUnc(FullDirectory)) {
+        return TRUE;
+    }
+
+    if (YoriLibIsPrefixedDriveLetterWithColon(FullDirectory)) {
+        DriveRoot[0] = FullDirectory->StartOfString[4];
+        DriveRoot[1] = ':';
+        DriveRoot[2] = '\\';
+        DriveRoot[3] = '\0';
+        if (GetDriveType(DriveRoot) == DRIVE_REMOTE) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Enumerate files matching a search string for completion, using cached
+ directory contents if the directory is on a network share.  If the search
+ string cannot be resolved from a single directory's contents, such as
+ when it refers to streams or contains file operators, or the directory is
+ local, this enumerates without the cache.
+
+ @param SearchString The string to search for.
+
+ @param MatchFlags The flags to match against when enumerating.
+
+ @param EnumContext Pointer to a context structure used when enumerating
+        files and streams for the purpose of tab completion.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriShForEachCompletionFile(
+    __in PYORI_STRING SearchString,
+    __in WORD MatchFlags,
+    __in PYORI_SH_FILE_COMPLETE_CONTEXT EnumContext
+    )
+{
+    YORI_STRING DirectoryPart;
+    YORI_STRING FilePart;
+    YORI_STRING FullDirectory;
+    YORI_STRING LongName;
+    YORI_STRING ShortName;
+    YORI_ALLOC_SIZE_T Index;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY Directory;
+    PYORI_SH_DIRECTORY_CACHE_DIRECTORY EvictDirectory;
+    PYORI_SH_DIRECTORY_CACHE_ENTRY Entry;
+    PYORI_LIST_ENTRY ListEntry;
+    TCHAR Char;
+
+    if (YoriShDirectoryCache.Mutex == NULL) {
+        return YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+    }
+
+    YoriLibInitEmptyString(&DirectoryPart);
+    DirectoryPart.StartOfString = SearchString->StartOfString;
+    DirectoryPart.LengthInChars = YoriShFindFinalSlashIfSpecified(SearchString);
+
+    YoriLibInitEmptyString(&FilePart);
+    FilePart.StartOfString = &SearchString->StartOfString[DirectoryPart.LengthInChars];
+    FilePart.LengthInChars = SearchString->LengthInChars - DirectoryPart.LengthInChars;
+
+    //
+    //  Wildcards in the directory, stream names and file operators all
+    //  require enumeration that the cache can't answer.
+    //
+
+    for (Index = 0; Index < SearchString->LengthInChars; Index++) {
+        Char = SearchString->StartOfString[Index];
+        if (Char == '{' || Char == '[' ||
+            (Index < DirectoryPart.LengthInChars && (Char == '*' || Char == '?')) ||
+            (Index >= DirectoryPart.LengthInChars && Char == ':')) {
+
+            return YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+        }
+    }
+
+    if (FilePart.LengthInChars == 0) {
+        return YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+    }
+
+    if (DirectoryPart.LengthInChars == 0) {
+        YORI_STRING CurrentDirectory;
+        YoriLibConstantString(&CurrentDirectory, _T("."));
+        if (!YoriLibUserStringToSingleFilePath(&CurrentDirectory, TRUE, &FullDirectory)) {
+            return FALSE;
+        }
+    } else {
+        if (!YoriLibUserStringToSingleFilePath(&DirectoryPart, TRUE, &FullDirectory)) {
+            return FALSE;
+        }
+    }
+
+    if (!YoriShIsDirectoryRemote(&FullDirectory)) {
+        YoriLibFreeStringContents(&FullDirectory);
+        return YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+    }
+
+    WaitForSingleObject(YoriShDirectoryCache.Mutex, INFINITE);
+
+    Directory = NULL;
+    HashEntry = YoriLibHashLookupByKey(YoriShDirectoryCache.Directories, &FullDirectory);
+    if (HashEntry != NULL) {
+        Directory = HashEntry->Context;
+        if (YoriShIsDirectoryCacheDirectoryCurrent(Directory)) {
+            YoriLibRemoveListItem(&Directory->ListEntry);
+            YoriLibAppendList(&YoriShDirectoryCache.DirectoryList, &Directory->ListEntry);
+        } else {
+            YoriShRemoveDirectoryCacheDirectory(Directory);
+            Directory = NULL;
+        }
+    }
+
+    if (Directory == NULL) {
+        Directory = YoriShLoadDirectoryCacheDirectory(&DirectoryPart, &FullDirectory);
+        if (Directory == NULL) {
+            ReleaseMutex(YoriShDirectoryCache.Mutex);
+            YoriLibFreeStringContents(&FullDirectory);
+            return YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+        }
+
+        if (YoriShDirectoryCache.DirectoryCount >= YORI_SH_DIRECTORY_CACHE_MAX_DIRECTORIES) {
+            ListEntry = YoriLibGetNextListEntry(&YoriShDirectoryCache.DirectoryList, NULL);
+            EvictDirectory = CONTAINING_RECORD(ListEntry, YORI_SH_DIRECTORY_CACHE_DIRECTORY, ListEntry);
+            YoriShRemoveDirectoryCacheDirectory(EvictDirectory);
+        }
+
+        YoriLibHashInsertByKey(YoriShDirectoryCache.Directories, &FullDirectory, Directory, &Directory->HashEntry);
+        YoriLibAppendList(&YoriShDirectoryCache.DirectoryList, &Directory->ListEntry);
+        YoriShDirectoryCache.DirectoryCount++;
+    }
+
+    YoriLibFreeStringContents(&FullDirectory);
+
+    //
+    //  Apply the same filtering as enumeration would, including matching
+    //  against short names.
+    //
+
+    for (Index = 0; Index < Directory->EntryCount; Index++) {
+        Entry = &Directory->Entries[Index];
+
+        if (Entry->FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if ((MatchFlags & YORILIB_FILEENUM_RETURN_DIRECTORIES) == 0) {
+                continue;
+            }
+        } else {
+            if ((MatchFlags & YORILIB_FILEENUM_RETURN_FILES) == 0) {
+                continue;
+            }
+        }
+
+        YoriLibConstantString(&LongName, Entry->FindData.cFileName);
+        YoriLibConstantString(&ShortName, Entry->FindData.cAlternateFileName);
+        if (!YoriLibDoesFileMatchExpression(&LongName, &FilePart) &&
+            (ShortName.LengthInChars == 0 || !YoriLibDoesFileMatchExpression(&ShortName, &FilePart))) {
+
+            continue;
+        }
+
+        if (!YoriShFileTabCompletionCallback(&Entry->FullPath, &Entry->FindData, 0, EnumContext)) {
+            break;
+        }
+    }
+
+    ReleaseMutex(YoriShDirectoryCache.Mutex);
+    return TRUE;
+}
+
 /**
  A structure describing a string which when encountered in a string used for
  file tab completion may indicate the existence of a file.
@@ -1127,7 +1764,7 @@ YoriShFindMatchingStreamsForStringOrCursorPosition(
     //
 
     EnumContext->SearchString = SearchString->StartOfString;
-    if (!YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext)) {
+    if (!YoriShForEachCompletionFile(SearchString, MatchFlags, EnumContext)) {
         return;
     }
 
@@ -1179,7 +1816,7 @@ YoriShFindMatchingStreamsForStringOrCursorPosition(
         FileMidpointSearchString.LengthInChars = Index + 1;
 
         EnumContext->SearchString = FileMidpointSearchString.StartOfString;
-        YoriLibForEachStream(&FileMidpointSearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+        YoriShForEachCompletionFile(&FileMidpointSearchString, MatchFlags, EnumContext);
         if (EnumContext->AbortMatching) {
             YoriLibFreeStringContents(&FileMidpointSearchString);
             EnumContext->SearchString = SearchString->StartOfString;
@@ -1223,7 +1860,7 @@ YoriShFindMatchingStreamsForStringOrCursorPosition(
         EnumContext->CharsToFinalSlash = YoriShFindFinalSlashIfSpecified(&FileMidpointSearchString);
         EnumContext->SearchString = FileMidpointSearchString.StartOfString;
 
-        YoriLibForEachStream(&FileMidpointSearchString, YORILIB_FILEENUM_RETURN_DIRECTORIES, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext);
+        YoriShForEachCompletionFile(&FileMidpointSearchString, YORILIB_FILEENUM_RETURN_DIRECTORIES, EnumContext);
 
         YoriLibInitEmptyString(&EnumContext->Suffix);
         YoriLibFreeStringContents(&FileMidpointSearchString);
@@ -1831,6 +2468,19 @@ YoriShResolveTabCompletionActionForExecutable(
     YoriLibFreeStringContents(&FoundCompletionScript);
     YoriLibFreeStringContents(&FullArgs);
 
+    //
+    //  Executing the script runs a command on behalf of the shell, which
+    //  can't happen on a background thread.  Indicate that this population
+    //  needs to be performed on the input thread instead.
+    //
+
+    if (TabContext->CancelEvent != NULL) {
+        YoriLibFreeStringContents(&CompletionExpression);
+        TabContext->RequiresInputThread = TRUE;
+        Action->CompletionAction = CompletionActionTypeFilesAndDirectories;
+        return TRUE;
+    }
+
     if (!YoriShExecuteExpressionAndCaptureOutput(&CompletionExpression, &ActionString)) {
 
         Action->CompletionAction = CompletionActionTypeFilesAndDirectories;
@@ -3067,6 +3717,8 @@ YoriShCompleteSuggestion(
     YORI_ALLOC_SIZE_T OffsetInSubstring;
     YORI_STRING PrefixBeforeBackquoteSubstring;
     YORI_STRING SuffixAfterBackquoteSubstring;
+    YORI_STRING FrecentArg;
+    PYORI_HASH_ENTRY HashEntry;
 
     if (Buffer->String.LengthInChars == 0) {
         return;
@@ -3163,6 +3815,25 @@ YoriShCompleteSuggestion(
         return;
     }
 
+    //
+    //  If history contains an argument with this prefix, and that argument
+    //  is still a valid match, move it to the front so the suggestion is
+    //  the one the user has used most frequently and recently rather than
+    //  the first alphabetically.  Matches that are no longer valid, such as
+    //  files that have been deleted, are never suggested.
+    //
+
+    if (YoriShFindFrecentArg(Arg, (BOOLEAN)(CmdContext.CurrentArg == 0), &FrecentArg)) {
+        HashEntry = YoriLibHashLookupByKey(Buffer->TabContext.MatchHashTable, &FrecentArg);
+        if (HashEntry != NULL) {
+            Match = HashEntry->Context;
+            YoriLibRemoveListItem(&Match->ListEntry);
+            YoriLibInsertList(&Buffer->TabContext.MatchList, &Match->ListEntry);
+            ListEntry = &Match->ListEntry;
+        }
+        YoriLibFreeStringContents(&FrecentArg);
+    }
+
     Match = CONTAINING_RECORD(ListEntry, YORI_SH_TAB_COMPLETE_MATCH, ListEntry);
 
     ASSERT(Buffer->SuggestionString.MemoryToFree == NULL);
@@ -3183,4 +3854,202 @@ YoriShCompleteSuggestion(
     YoriLibShFreeCmdContext(&CmdContext);
 }
 
+
+/**
+ The entrypoint for a background thread calculating a suggestion.
+
+ @param Context Pointer to the suggestion worker.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriShSuggestionWorkerThread(
+    __in LPVOID Context
+    )
+{
+    PYORI_SH_SUGGESTION_WORKER Worker;
+
+    Worker = (PYORI_SH_SUGGESTION_WORKER)Context;
+    YoriShCompleteSuggestion(&Worker->Buffer);
+    return 0;
+}
+
+/**
+ Begin calculating a suggestion for the current input on a background
+ thread.  The input thread is expected to continue processing input, cancel
+ the worker if the input changes, and collect the result when the thread
+ completes.
+
+ @param Buffer Pointer to the current input context.
+
+ @return Pointer to the suggestion worker, or NULL if a background thread
+         could not be started.  If NULL, the caller should calculate the
+         suggestion synchronously.
+ */
+__success(return != NULL)
+PYORI_SH_SUGGESTION_WORKER
+YoriShStartSuggestionWorker(
+    __in PYORI_SH_INPUT_BUFFER Buffer
+    )
+{
+    PYORI_SH_SUGGESTION_WORKER Worker;
+    DWORD ThreadId;
+
+    Worker = YoriLibMalloc(sizeof(YORI_SH_SUGGESTION_WORKER));
+    if (Worker == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Worker, sizeof(YORI_SH_SUGGESTION_WORKER));
+
+    if (!YoriLibAllocateString(&Worker->Buffer.String, Buffer->String.LengthInChars + 1)) {
+        YoriLibFree(Worker);
+        return NULL;
+    }
+
+    memcpy(Worker->Buffer.String.StartOfString, Buffer->String.StartOfString, Buffer->String.LengthInChars * sizeof(TCHAR));
+    Worker->Buffer.String.LengthInChars = Buffer->String.LengthInChars;
+    Worker->Buffer.String.StartOfString[Worker->Buffer.String.LengthInChars] = '\0';
+    Worker->Buffer.CurrentOffset = Buffer->CurrentOffset;
+    Worker->Buffer.TabContext.SearchType = Buffer->TabContext.SearchType;
+
+    Worker->CancelEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Worker->CancelEvent == NULL) {
+        YoriShFreeSuggestionWorker(Worker);
+        return NULL;
+    }
+
+    Worker->Buffer.TabContext.CancelEvent = Worker->CancelEvent;
+
+    Worker->Thread = CreateThread(NULL, 0, YoriShSuggestionWorkerThread, Worker, 0, &ThreadId);
+    if (Worker->Thread == NULL) {
+        YoriShFreeSuggestionWorker(Worker);
+        return NULL;
+    }
+
+    return Worker;
+}
+
+/**
+ Check whether the input is unchanged since a background suggestion was
+ requested, so that its result can still be used.
+
+ @param Worker Pointer to the suggestion worker.
+
+ @param Buffer Pointer to the current input context.
+
+ @return TRUE if the result of the worker is still applicable to the input,
+         FALSE if it is not.
+ */
+BOOLEAN
+YoriShIsSuggestionWorkerCurrent(
+    __in PYORI_SH_SUGGESTION_WORKER Worker,
+    __in PYORI_SH_INPUT_BUFFER Buffer
+    )
+{
+    if (Worker->Cancelled) {
+        return FALSE;
+    }
+
+    if (Buffer->CurrentOffset != Worker->Buffer.CurrentOffset ||
+        Buffer->TabContext.TabCount != 0 ||
+        Buffer->TabContext.MatchList.Next != NULL ||
+        Buffer->SuggestionString.LengthInChars != 0 ||
+        YoriLibCompareString(&Buffer->String, &Worker->Buffer.String) != 0) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Indicate that the result of a background suggestion is no longer needed.
+ The background thread will stop as soon as it can, but the caller is not
+ blocked waiting for it.
+
+ @param Worker Pointer to the suggestion worker.
+ */
+VOID
+YoriShCancelSuggestionWorker(
+    __inout PYORI_SH_SUGGESTION_WORKER Worker
+    )
+{
+    Worker->Cancelled = TRUE;
+    SetEvent(Worker->CancelEvent);
+}
+
+/**
+ Move the match list and suggestion calculated by a background thread, which
+ has completed, into the input buffer.  The caller should first check that
+ the result is applicable with @ref YoriShIsSuggestionWorkerCurrent .
+
+ @param Worker Pointer to the suggestion worker.
+
+ @param Buffer Pointer to the current input context.
+ */
+VOID
+YoriShCompleteSuggestionWorker(
+    __inout PYORI_SH_SUGGESTION_WORKER Worker,
+    __inout PYORI_SH_INPUT_BUFFER Buffer
+    )
+{
+    PYORI_SH_TAB_COMPLETE_CONTEXT Src;
+    PYORI_SH_TAB_COMPLETE_CONTEXT Dest;
+
+    Src = &Worker->Buffer.TabContext;
+    Dest = &Buffer->TabContext;
+
+    YoriShClearTabCompletionMatches(Buffer);
+    memcpy(Dest, Src, sizeof(YORI_SH_TAB_COMPLETE_CONTEXT));
+
+    //
+    //  The list head has moved, so update the first and last entries to
+    //  point to its new location.
+    //
+
+    if (Src->MatchList.Next == &Src->MatchList) {
+        YoriLibInitializeListHead(&Dest->MatchList);
+    } else if (Src->MatchList.Next != NULL) {
+        Dest->MatchList.Next->Prev = &Dest->MatchList;
+        Dest->MatchList.Prev->Next = &Dest->MatchList;
+    }
+
+    Dest->CancelEvent = NULL;
+    Dest->RequiresInputThread = FALSE;
+    ZeroMemory(Src, sizeof(YORI_SH_TAB_COMPLETE_CONTEXT));
+
+    YoriLibFreeStringContents(&Buffer->SuggestionString);
+    memcpy(&Buffer->SuggestionString, &Worker->Buffer.SuggestionString, sizeof(YORI_STRING));
+    YoriLibInitEmptyString(&Worker->Buffer.SuggestionString);
+}
+
+/**
+ Free a suggestion worker.  If the background thread is still running, this
+ waits for it to complete, so callers that do not want to block should
+ cancel the worker and wait for the thread before calling this function.
+
+ @param Worker Pointer to the suggestion worker.
+ */
+VOID
+YoriShFreeSuggestionWorker(
+    __in PYORI_SH_SUGGESTION_WORKER Worker
+    )
+{
+    if (Worker->Thread != NULL) {
+        WaitForSingleObject(Worker->Thread, INFINITE);
+        CloseHandle(Worker->Thread);
+    }
+
+    YoriShClearTabCompletionMatches(&Worker->Buffer);
+    YoriLibFreeStringContents(&Worker->Buffer.SuggestionString);
+    YoriLibFreeStringContents(&Worker->Buffer.String);
+
+    if (Worker->CancelEvent != NULL) {
+        CloseHandle(Worker->CancelEvent);
+    }
+
+    YoriLibFree(Worker);
+}
+
 // vim:sw=4:ts=4:et:
@@ -195,6 +195,271 @@ YoriShGetAppDirectoryWithTrailingSlash(
     return LengthNeeded;
 }
 
+/**
+ The maximum number of variables to remember in the environment cache
+ before discarding it and starting again.
+ */
+#define YORI_SH_ENV_CACHE_MAX_ENTRIES 256
+
+/**
+ A single cached environment variable.  The name and value strings are
+ stored in the same allocation, immediately following this structure.
+ */
+typedef struct _YORI_SH_ENV_CACHE_ENTRY {
+
+    /**
+     The entry within the hash table, indexed by variable name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry within the list of all cached variables.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The value of the variable.  Only meaningful if Defined is TRUE.
+     */
+    YORI_STRING Value;
+
+    /**
+     TRUE if the variable was found in the environment, FALSE if the cache
+     entry records that the variable does not exist.
+     */
+    BOOLEAN Defined;
+
+} YORI_SH_ENV_CACHE_ENTRY, *PYORI_SH_ENV_CACHE_ENTRY;
+
+/**
+ A cache of environment variable values, so that repeatedly expanding the
+ same variable does not need to search the process environment block each
+ time.  The cache is discarded whenever the environment generation changes.
+ */
+typedef struct _YORI_SH_ENV_CACHE {
+
+    /**
+     A hash table of cached variables, indexed by name.  Lookups are case
+     insensitive, which matches the environment.
+     */
+    PYORI_GROWABLE_HASH_TABLE Table;
+
+    /**
+     A list of all cached variables.
+     */
+    YORI_LIST_ENTRY Entries;
+
+    /**
+     The number of entries in the Entries list.
+     */
+    DWORD EntryCount;
+
+    /**
+     The environment generation that the cached values were obtained from.
+     */
+    DWORD Generation;
+
+} YORI_SH_ENV_CACHE, *PYORI_SH_ENV_CACHE;
+
+/**
+ The global cache of environment variable values.
+ */
+YORI_SH_ENV_CACHE YoriShEnvironmentCache;
+
+/**
+ Discard all variables in the environment cache.
+ */
+VOID
+YoriShFlushEnvironmentCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_ENV_CACHE_ENTRY Entry;
+
+    if (YoriShEnvironmentCache.Entries.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShEnvironmentCache.Entries, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORI_SH_ENV_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShEnvironmentCache.Entries, ListEntry);
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibGrowableHashRemoveByEntry(YoriShEnvironmentCache.Table, &Entry->HashEntry);
+        YoriLibDereference(Entry);
+    }
+    YoriShEnvironmentCache.EntryCount = 0;
+}
+
+/**
+ Free the environment cache and all variables within it.
+ */
+VOID
+YoriShCleanupEnvironmentCache(VOID)
+{
+    YoriShFlushEnvironmentCache();
+    if (YoriShEnvironmentCache.Table != NULL) {
+        YoriLibFreeEmptyGrowableHashTable(YoriShEnvironmentCache.Table);
+        YoriShEnvironmentCache.Table = NULL;
+    }
+}
+
+/**
+ Query a variable from the process environment and add it to the
+ environment cache.
+
+ @param Name Pointer to the name of the variable to query.
+
+ @return Pointer to the newly cached entry, or NULL if the variable could
+         not be cached.
+ */
+PYORI_SH_ENV_CACHE_ENTRY
+YoriShAddEnvironmentCacheEntry(
+    __in PYORI_STRING Name
+    )
+{
+    PYORI_SH_ENV_CACHE_ENTRY Entry;
+    YORI_ALLOC_SIZE_T ValueLength;
+    YORI_ALLOC_SIZE_T ValueCopied;
+    YORI_ALLOC_SIZE_T BytesNeeded;
+    LPTSTR NameBuffer;
+    YORI_STRING Key;
+
+    if (YoriShEnvironmentCache.EntryCount >= YORI_SH_ENV_CACHE_MAX_ENTRIES) {
+        YoriShFlushEnvironmentCache();
+    }
+
+    ValueLength = (YORI_ALLOC_SIZE_T)GetEnvironmentVariable(Name->StartOfString, NULL, 0);
+
+    BytesNeeded = sizeof(YORI_SH_ENV_CACHE_ENTRY) + (Name->LengthInChars + 1 + ValueLength + 1) * sizeof(TCHAR);
+    Entry = YoriLibReferencedMalloc(BytesNeeded);
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    NameBuffer = (LPTSTR)(Entry + 1);
+    memcpy(NameBuffer, Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+    NameBuffer[Name->LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Entry->Value);
+    Entry->Value.StartOfString = NameBuffer + Name->LengthInChars + 1;
+    Entry->Value.LengthAllocated = ValueLength + 1;
+    Entry->Value.StartOfString[0] = '\0';
+    Entry->Defined = FALSE;
+
+    if (ValueLength > 0) {
+
+        //
+        //  If the variable changed size between the two calls, don't
+        //  try to cache it.  The caller will query the environment
+        //  directly.
+        //
+
+        ValueCopied = (YORI_ALLOC_SIZE_T)GetEnvironmentVariable(Name->StartOfString, Entry->Value.StartOfString, Entry->Value.LengthAllocated);
+        if (ValueCopied == 0 || ValueCopied >= Entry->Value.LengthAllocated) {
+            YoriLibDereference(Entry);
+            return NULL;
+        }
+        Entry->Value.LengthInChars = ValueCopied;
+        Entry->Defined = TRUE;
+    }
+
+    if (YoriShEnvironmentCache.Table == NULL) {
+        YoriShEnvironmentCache.Table = YoriLibAllocateGrowableHashTable(YORI_SH_ENV_CACHE_MAX_ENTRIES);
+        if (YoriShEnvironmentCache.Table == NULL) {
+            YoriLibDereference(Entry);
+            return NULL;
+        }
+    }
+
+    if (YoriShEnvironmentCache.Entries.Next == NULL) {
+        YoriLibInitializeListHead(&YoriShEnvironmentCache.Entries);
+    }
+
+    //
+    //  The key refers to the name within this allocation, so it has no
+    //  MemoryToFree of its own and is released along with the entry.
+    //
+
+    YoriLibInitEmptyString(&Key);
+    Key.StartOfString = NameBuffer;
+    Key.LengthInChars = Name->LengthInChars;
+    if (!YoriLibGrowableHashInsertByKey(YoriShEnvironmentCache.Table, &Key, Entry, &Entry->HashEntry)) {
+        YoriLibDereference(Entry);
+        return NULL;
+    }
+
+    YoriLibAppendList(&YoriShEnvironmentCache.Entries, &Entry->ListEntry);
+    YoriShEnvironmentCache.EntryCount++;
+    return Entry;
+}
+
+/**
+ Query a regular environment variable, using the environment cache where
+ possible.  This has the same semantics as GetEnvironmentVariable.
+
+ @param Name The name of the environment variable to get.
+
+ @param Variable Pointer to the buffer to receive the variable's contents.
+
+ @param Size The length of the Variable parameter, in characters.
+
+ @return The number of characters copied (without NULL), of if the buffer
+         is too small, the number of characters needed (including NULL.)
+         Zero if the variable is not defined.
+ */
+YORI_ALLOC_SIZE_T
+YoriShGetCachedEnvironmentVariable(
+    __in LPCTSTR Name,
+    __out_opt LPTSTR Variable,
+    __in YORI_ALLOC_SIZE_T Size
+    )
+{
+    YORI_STRING NameString;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_ENV_CACHE_ENTRY Entry;
+
+    //
+    //  Per drive current directories are updated without going through
+    //  the shell, so never cache them.
+    //
+
+    if (Name[0] == '=') {
+        return (YORI_ALLOC_SIZE_T)GetEnvironmentVariable(Name, Variable, Size);
+    }
+
+    if (YoriShEnvironmentCache.Generation != YoriShGlobal.EnvironmentGeneration) {
+        YoriShFlushEnvironmentCache();
+        YoriShEnvironmentCache.Generation = YoriShGlobal.EnvironmentGeneration;
+    }
+
+    YoriLibConstantString(&NameString, Name);
+    Entry = NULL;
+    if (YoriShEnvironmentCache.Table != NULL) {
+        HashEntry = YoriLibGrowableHashLookupByKey(YoriShEnvironmentCache.Table, &NameString);
+        if (HashEntry != NULL) {
+            Entry = HashEntry->Context;
+        }
+    }
+
+    if (Entry == NULL) {
+        Entry = YoriShAddEnvironmentCacheEntry(&NameString);
+        if (Entry == NULL) {
+            return (YORI_ALLOC_SIZE_T)GetEnvironmentVariable(Name, Variable, Size);
+        }
+    }
+
+    if (!Entry->Defined) {
+        return 0;
+    }
+
+    if (Variable == NULL || Size <= Entry->Value.LengthInChars) {
+        return Entry->Value.LengthInChars + 1;
+    }
+
+    memcpy(Variable, Entry->Value.StartOfString, Entry->Value.LengthInChars * sizeof(TCHAR));
+    Variable[Entry->Value.LengthInChars] = '\0';
+    return Entry->Value.LengthInChars;
+}
+
 //
 //  Warning about manipulating the Variable buffer but failing the
 //  function.  This function is trying to mimic the behavior of the
@@ -269,7 +534,7 @@ YoriShGetEnvironmentVariableWithoutSubstitution(
         }
     } else {
 
-        Length = (YORI_ALLOC_SIZE_T)GetEnvironmentVariable(Name, Variable, Size);
+        Length = YoriShGetCachedEnvironmentVariable(Name, Variable, Size);
     }
 
     if (Generation != NULL) {
@@ -714,10 +979,22 @@ YoriShGetEnvironmentExpandedText(
     YORI_ALLOC_SIZE_T EnvVarCopied;
     LPTSTR EnvVarName;
     YORI_ALLOC_SIZE_T ReturnValue;
+    TCHAR NameBuffer[64];
 
-    EnvVarName = YoriLibCStringFromYoriString(Name);
-    if (EnvVarName == NULL) {
-        return FALSE;
+    //
+    //  Most variable names are short, so avoid an allocation for each one
+    //  by copying the name onto the stack where possible.
+    //
+
+    if (Name->LengthInChars < sizeof(NameBuffer)/sizeof(NameBuffer[0])) {
+        memcpy(NameBuffer, Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+        NameBuffer[Name->LengthInChars] = '\0';
+        EnvVarName = NameBuffer;
+    } else {
+        EnvVarName = YoriLibCStringFromYoriString(Name);
+        if (EnvVarName == NULL) {
+            return FALSE;
+        }
     }
 
     if (!YoriShGetEnvironmentVariable(EnvVarName, Result->StartOfString, Result->LengthAllocated, &EnvVarCopied, NULL)) {
@@ -737,7 +1014,9 @@ YoriShGetEnvironmentExpandedText(
         }
     }
 
-    YoriLibDereference(EnvVarName);
+    if (EnvVarName != NameBuffer) {
+        YoriLibDereference(EnvVarName);
+    }
 
     *ReturnedSize = ReturnValue;
     return TRUE;
@@ -1053,6 +1332,169 @@ YoriShSetEnvironmentVariable(
     return FALSE;
 }
 
+/**
+ Apply an environment block into the running process by only changing the
+ variables that differ from the current environment.  Environment blocks
+ tend to be large and each change requires the system to update the block,
+ so when restoring a saved environment that is mostly the same as the
+ current one, this avoids deleting and recreating every variable.
+
+ @param NewEnv Pointer to the new environment block to apply.  If the
+        environment is applied, this block is modified by this function to
+        NULL terminate variable names.
+
+ @return TRUE to indicate the environment was applied, FALSE if the data
+         structures required could not be allocated, in which case the
+         environment has not been modified.
+ */
+__success(return)
+BOOLEAN
+YoriShApplyEnvironmentDifferences(
+    __in PYORI_STRING NewEnv
+    )
+{
+    YORI_STRING CurrentEnvironment;
+    YORI_STRING VarName;
+    PYORI_GROWABLE_HASH_TABLE NewVars;
+    PYORI_HASH_ENTRY Entries;
+    PYORI_HASH_ENTRY Entry;
+    LPTSTR ThisVar;
+    LPTSTR ThisValue;
+    YORI_ALLOC_SIZE_T VarCount;
+    YORI_ALLOC_SIZE_T Index;
+    DWORD VarLen;
+
+    //
+    //  Count the variables in the new environment so an index of them can
+    //  be allocated.
+    //
+
+    VarCount = 0;
+    ThisVar = NewEnv->StartOfString;
+    while (*ThisVar != '\0') {
+        VarLen = _tcslen(ThisVar);
+        if (_tcschr(&ThisVar[1], '=') != NULL) {
+            VarCount++;
+        }
+        ThisVar += VarLen;
+        ThisVar++;
+    }
+
+    if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)(VarCount + 1) * sizeof(YORI_HASH_ENTRY))) {
+        return FALSE;
+    }
+
+    Entries = YoriLibMalloc((YORI_ALLOC_SIZE_T)((VarCount + 1) * sizeof(YORI_HASH_ENTRY)));
+    if (Entries == NULL) {
+        return FALSE;
+    }
+
+    NewVars = YoriLibAllocateGrowableHashTable(VarCount + 1);
+    if (NewVars == NULL) {
+        YoriLibFree(Entries);
+        return FALSE;
+    }
+
+    if (!YoriLibGetEnvironmentStrings(&CurrentEnvironment)) {
+        YoriLibFreeEmptyGrowableHashTable(NewVars);
+        YoriLibFree(Entries);
+        return FALSE;
+    }
+
+    //
+    //  Index the new environment by variable name.  Each entry's context
+    //  points to the new value.  If a variable is specified twice, the
+    //  first is used, since that is the one the system would find.  The
+    //  block is not modified until the index is complete, so that it can
+    //  still be applied another way if indexing fails.
+    //
+
+    Index = 0;
+    ThisVar = NewEnv->StartOfString;
+    while (*ThisVar != '\0') {
+        VarLen = _tcslen(ThisVar);
+
+        //
+        //  We know there's at least one char.  Skip it if it's equals since
+        //  that's how drive current directories are recorded.
+        //
+
+        ThisValue = _tcschr(&ThisVar[1], '=');
+        if (ThisValue != NULL) {
+            YoriLibInitEmptyString(&VarName);
+            VarName.StartOfString = ThisVar;
+            VarName.LengthInChars = (YORI_ALLOC_SIZE_T)(ThisValue - ThisVar);
+            if (YoriLibGrowableHashLookupByKey(NewVars, &VarName) == NULL) {
+                ASSERT(Index < VarCount);
+                if (!YoriLibGrowableHashInsertByKey(NewVars, &VarName, &ThisValue[1], &Entries[Index])) {
+                    while (Index > 0) {
+                        Index--;
+                        YoriLibGrowableHashRemoveByEntry(NewVars, &Entries[Index]);
+                    }
+                    YoriLibFreeStringContents(&CurrentEnvironment);
+                    YoriLibFreeEmptyGrowableHashTable(NewVars);
+                    YoriLibFree(Entries);
+                    return FALSE;
+                }
+                Index++;
+            }
+        }
+
+        ThisVar += VarLen;
+        ThisVar++;
+    }
+    VarCount = Index;
+
+    //
+    //  Walk the current environment.  Variables that are not in the new
+    //  environment, or differ in the case of their name, are deleted.
+    //  Variables whose value is unchanged don't need to be set again.
+    //
+
+    ThisVar = CurrentEnvironment.StartOfString;
+    while (*ThisVar != '\0') {
+        VarLen = _tcslen(ThisVar);
+
+        ThisValue = _tcschr(&ThisVar[1], '=');
+        if (ThisValue != NULL) {
+            ThisValue[0] = '\0';
+            ThisValue++;
+            YoriLibConstantString(&VarName, ThisVar);
+            Entry = YoriLibGrowableHashLookupByKey(NewVars, &VarName);
+            if (Entry == NULL ||
+                YoriLibCompareString(&VarName, &Entry->Key) != 0) {
+
+                SetEnvironmentVariable(ThisVar, NULL);
+            } else if (Entry->Context != NULL &&
+                       _tcscmp(ThisValue, Entry->Context) == 0) {
+
+                Entry->Context = NULL;
+            }
+        }
+
+        ThisVar += VarLen;
+        ThisVar++;
+    }
+    YoriLibFreeStringContents(&CurrentEnvironment);
+
+    //
+    //  Set any variables that are new or have changed.
+    //
+
+    for (Index = 0; Index < VarCount; Index++) {
+        if (Entries[Index].Context != NULL) {
+            Entries[Index].Key.StartOfString[Entries[Index].Key.LengthInChars] = '\0';
+            SetEnvironmentVariable(Entries[Index].Key.StartOfString, Entries[Index].Context);
+        }
+        YoriLibGrowableHashRemoveByEntry(NewVars, &Entries[Index]);
+    }
+
+    YoriLibFreeEmptyGrowableHashTable(NewVars);
+    YoriLibFree(Entries);
+
+    return TRUE;
+}
+
 /**
  Apply an environment block into the running process.  Variables not explicitly
  included in this block are discarded.
@@ -1072,6 +1514,11 @@ YoriShSetEnvironmentStrings(
     LPTSTR ThisValue;
     DWORD VarLen;
 
+    if (YoriShApplyEnvironmentDifferences(NewEnv)) {
+        YoriShGlobal.EnvironmentGeneration++;
+        return TRUE;
+    }
+
     //
     //  Query the current environment and delete everything in it.
     //
@@ -190,7 +190,18 @@ YoriShExecuteSingleProgram(
         BOOL FailedInRedirection = FALSE;
 
         if (!LaunchViaShellExecute && !ExecContext->CaptureEnvironmentOnExit) {
-            DWORD Err = YoriLibShCreateProcess(ExecContext, NULL, &FailedInRedirection);
+            DWORD Err;
+            LARGE_INTEGER LaunchStartTime;
+
+            YoriShTimingStart(&LaunchStartTime);
+            YoriLibEtwWriteEvent("CreateProcess", YORI_ETW_OPCODE_START, &ExecContext->CmdToExec.ArgV[0], 0);
+            Err = YoriLibShCreateProcess(ExecContext, NULL, &FailedInRedirection);
+            YoriShTimingRecord(YoriShTimingPhaseLaunch, &LaunchStartTime);
+            if (Err == NO_ERROR) {
+                YoriLibEtwWriteEvent("CreateProcess", YORI_ETW_OPCODE_STOP, NULL, ExecContext->dwProcessId);
+            } else {
+                YoriLibEtwWriteEvent("CreateProcess", YORI_ETW_OPCODE_STOP, NULL, 0);
+            }
 
             if (Err != NO_ERROR) {
                 if (Err == ERROR_ELEVATION_REQUIRED) {
@@ -249,12 +260,14 @@ YoriShExecuteSingleProgram(
                 ExecContext->WaitForCompletion = TRUE;
             }
             if (ExecContext->WaitForCompletion) {
+                YoriLibEtwWriteEvent("Wait", YORI_ETW_OPCODE_START, NULL, ExecContext->dwProcessId);
                 YoriShWaitForProcessToTerminate(ExecContext);
                 if (ExecContext->hProcess != NULL) {
                     GetExitCodeProcess(ExecContext->hProcess, &ExitCode);
                 } else {
                     ExitCode = EXIT_FAILURE;
                 }
+                YoriLibEtwWriteEvent("Wait", YORI_ETW_OPCODE_STOP, NULL, ExitCode);
             } else if (ExecContext->StdOutType != StdOutTypePipe) {
                 ASSERT(!ExecContext->CaptureEnvironmentOnExit);
                 if (YoriShCreateNewJob(ExecContext)) {
@@ -360,6 +373,132 @@ YoriShExecViaSubshell(
 }
 
 
+/**
+ Set to TRUE once the YORIPIPEBUILTIN variable has been queried.
+ */
+BOOLEAN YoriShPipeBuiltinDetermined;
+
+/**
+ Set to TRUE if programs within a pipeline that are also available as
+ builtin commands should execute as builtins rather than child processes.
+ */
+BOOLEAN YoriShPipeBuiltinEnabled;
+
+/**
+ The environment generation when YORIPIPEBUILTIN was queried.
+ */
+DWORD YoriShPipeBuiltinGeneration;
+
+/**
+ Return TRUE if the user has requested that programs in a pipeline execute as
+ builtins where possible.  This is controlled by the YORIPIPEBUILTIN
+ variable, which is reevaluated when the environment changes.
+
+ @return TRUE if pipeline programs should execute as builtins, FALSE if not.
+ */
+BOOLEAN
+YoriShIsPipeBuiltinEnabled(VOID)
+{
+    YORI_STRING EnvVar;
+    TCHAR EnvVarBuffer[8];
+    YORI_ALLOC_SIZE_T EnvVarLength;
+
+    if (YoriShPipeBuiltinDetermined &&
+        YoriShPipeBuiltinGeneration == YoriShGlobal.EnvironmentGeneration) {
+
+        return YoriShPipeBuiltinEnabled;
+    }
+
+    YoriShPipeBuiltinEnabled = FALSE;
+    YoriShPipeBuiltinDetermined = TRUE;
+    YoriShPipeBuiltinGeneration = YoriShGlobal.EnvironmentGeneration;
+
+    YoriLibInitEmptyString(&EnvVar);
+    EnvVar.StartOfString = EnvVarBuffer;
+    EnvVar.LengthAllocated = sizeof(EnvVarBuffer)/sizeof(EnvVarBuffer[0]);
+
+    EnvVarLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIPIPEBUILTIN"), NULL, 0, NULL);
+    if (EnvVarLength > 0 && EnvVarLength <= EnvVar.LengthAllocated) {
+        EnvVar.LengthInChars = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIPIPEBUILTIN"), EnvVar.StartOfString, EnvVar.LengthAllocated, NULL);
+        if (YoriLibCompareStringWithLiteral(&EnvVar, _T("1")) == 0) {
+            YoriShPipeBuiltinEnabled = TRUE;
+        }
+    }
+
+    return YoriShPipeBuiltinEnabled;
+}
+
+/**
+ Determine whether a program in a pipeline which has been resolved to an
+ external executable should instead be executed as a builtin.  This avoids
+ launching a child process for Yori tools that are also compiled into the
+ shell or have been loaded as builtin modules.  If so, the program name is
+ replaced with the builtin name.
+
+ @param ExecContext Pointer to the program, which has already been resolved
+        to a fully qualified executable path.
+
+ @return TRUE if the program should be executed as a builtin, FALSE if it
+         should be executed as a child process.
+ */
+BOOLEAN
+YoriShSubstitutePipelineBuiltin(
+    __in PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext
+    )
+{
+    PYORI_STRING FullPath;
+    YORI_STRING BaseName;
+    YORI_STRING NewArg;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (ExecContext->StdInType != StdInTypePipe &&
+        ExecContext->StdOutType != StdOutTypePipe) {
+
+        return FALSE;
+    }
+
+    if (!YoriShIsPipeBuiltinEnabled()) {
+        return FALSE;
+    }
+
+    //
+    //  Find the file name without its path or extension.
+    //
+
+    FullPath = &ExecContext->CmdToExec.ArgV[0];
+    YoriLibInitEmptyString(&BaseName);
+    BaseName.StartOfString = FullPath->StartOfString;
+    BaseName.LengthInChars = FullPath->LengthInChars;
+    for (Index = FullPath->LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(FullPath->StartOfString[Index - 1])) {
+            BaseName.StartOfString = &FullPath->StartOfString[Index];
+            BaseName.LengthInChars = FullPath->LengthInChars - Index;
+            break;
+        }
+    }
+
+    for (Index = BaseName.LengthInChars; Index > 0; Index--) {
+        if (BaseName.StartOfString[Index - 1] == '.') {
+            BaseName.LengthInChars = Index - 1;
+            break;
+        }
+    }
+
+    if (BaseName.LengthInChars == 0 ||
+        YoriLibShLookupBuiltinByName(&BaseName) == NULL) {
+
+        return FALSE;
+    }
+
+    if (!YoriLibCopyString(&NewArg, &BaseName)) {
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(FullPath);
+    memcpy(FullPath, &NewArg, sizeof(YORI_STRING));
+    return TRUE;
+}
+
 /**
  Execute an exec plan.  An exec plan has multiple processes, including
  different pipe and redirection operators.  Optionally return the result
@@ -432,7 +571,9 @@ YoriShExecExecPlan(
                 break;
             }
 
-            if (ExecutableFound) {
+            if (ExecutableFound && YoriShSubstitutePipelineBuiltin(ExecContext)) {
+                YoriShGlobal.ErrorLevel = YoriShBuiltIn(ExecContext);
+            } else if (ExecutableFound) {
                 YoriShGlobal.ErrorLevel = YoriShExecuteSingleProgram(ExecContext);
             } else if (ExecPlan->NumberCommands == 1 && !ExecPlan->WaitForCompletion) {
                 YoriShExecViaSubshell(ExecContext);
@@ -520,6 +661,47 @@ YoriShExecExecPlan(
     }
 }
 
+/**
+ Obtain the output of a backquoted expression from its process buffer, and
+ convert it into a form suitable for substitution into a command.
+
+ @param OutputBuffer Pointer to the process buffer containing output.
+
+ @param ProcessOutput On completion, populated with the output of the
+        process.  This is an empty string if no output could be obtained.
+ */
+VOID
+YoriShGetBackquoteOutput(
+    __in PVOID OutputBuffer,
+    __out PYORI_STRING ProcessOutput
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (!YoriLibShGetProcessOutputBuffer(OutputBuffer, ProcessOutput)) {
+        YoriLibInitEmptyString(ProcessOutput);
+    }
+
+    //
+    //  Truncate any newlines from the output, which tools
+    //  frequently emit but are of no value here
+    //
+
+    YoriLibTrimTrailingNewlines(ProcessOutput);
+
+    //
+    //  Convert any remaining newlines to spaces
+    //
+
+    for (Index = 0; Index < ProcessOutput->LengthInChars; Index++) {
+        if ((ProcessOutput->StartOfString[Index] == '\n' ||
+             ProcessOutput->StartOfString[Index] == '\r')) {
+
+            ProcessOutput->StartOfString[Index] = ' ';
+        }
+    }
+}
+
 /**
  Execute an expression and capture the output of the entire expression into
  a buffer.  This is used when evaluating backquoted expressions.
@@ -542,7 +724,6 @@ YoriShExecuteExpressionAndCaptureOutput(
     PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
     YORI_LIBSH_CMD_CONTEXT CmdContext;
     PVOID OutputBuffer;
-    YORI_ALLOC_SIZE_T Index;
 
     //
     //  Parse the expression we're trying to execute.
@@ -594,29 +775,7 @@ YoriShExecuteExpressionAndCaptureOutput(
 
     YoriLibInitEmptyString(ProcessOutput);
     if (OutputBuffer != NULL) {
-
-        if (!YoriLibShGetProcessOutputBuffer(OutputBuffer, ProcessOutput)) {
-            YoriLibInitEmptyString(ProcessOutput);
-        }
-
-        //
-        //  Truncate any newlines from the output, which tools
-        //  frequently emit but are of no value here
-        //
-
-        YoriLibTrimTrailingNewlines(ProcessOutput);
-
-        //
-        //  Convert any remaining newlines to spaces
-        //
-
-        for (Index = 0; Index < ProcessOutput->LengthInChars; Index++) {
-            if ((ProcessOutput->StartOfString[Index] == '\n' ||
-                 ProcessOutput->StartOfString[Index] == '\r')) {
-
-                ProcessOutput->StartOfString[Index] = ' ';
-            }
-        }
+        YoriShGetBackquoteOutput(OutputBuffer, ProcessOutput);
     }
 
     YoriLibShFreeExecPlan(&ExecPlan);
@@ -627,12 +786,43 @@ YoriShExecuteExpressionAndCaptureOutput(
 
 
 /**
- Parse and execute all backquotes in an expression, potentially resulting
- in a new expression.  This will internally perform parsing and redirection,
- as well as execute multiple subprocesses as needed.
+ Evaluate a single backquote expression by executing it and capturing its
+ output.  This is the default evaluation used when expanding backquotes.
 
  @param Expression The string to execute.
 
+ @param ProcessOutput On successful completion, populated with the output of
+        the command.
+
+ @param Context Ignored.
+
+ @return TRUE to indicate it was successfully executed, FALSE otherwise.
+ */
+__success(return)
+BOOL
+YoriShEvaluateBackquote(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ProcessOutput,
+    __in PVOID Context
+    )
+{
+    UNREFERENCED_PARAMETER(Context);
+    return YoriShExecuteExpressionAndCaptureOutput(Expression, ProcessOutput);
+}
+
+/**
+ Parse and evaluate all backquotes in an expression, potentially resulting
+ in a new expression.  Each backquote substring is supplied to a caller
+ provided function to obtain the text to substitute in its place, which
+ allows callers to reuse previous results.
+
+ @param Expression The string to expand.
+
+ @param EvaluateFn Pointer to a function to obtain the result of each
+        backquote substring.
+
+ @param Context Caller supplied context passed to EvaluateFn.
+
  @param ResultingExpression On successful completion, updated to contain
         the final expression to evaluate.  This may be the same as Expression
         if no backquote expansion occurred.
@@ -641,8 +831,10 @@ YoriShExecuteExpressionAndCaptureOutput(
  */
 __success(return)
 BOOL
-YoriShExpandBackquotes(
+YoriShExpandBackquotesWithCallback(
     __in PYORI_STRING Expression,
+    __in PYORI_SH_EVALUATE_BACKQUOTE_FN EvaluateFn,
+    __in_opt PVOID Context,
     __out PYORI_STRING ResultingExpression
     )
 {
@@ -673,7 +865,7 @@ YoriShExpandBackquotes(
             break;
         }
 
-        if (!YoriShExecuteExpressionAndCaptureOutput(&CurrentExpressionSubset, &ProcessOutput)) {
+        if (!EvaluateFn(&CurrentExpressionSubset, &ProcessOutput, Context)) {
             break;
         }
 
@@ -715,6 +907,370 @@ YoriShExpandBackquotes(
     return TRUE;
 }
 
+/**
+ The maximum number of backquote substrings within a single expression that
+ can be executed concurrently.
+ */
+#define YORI_SH_MAX_CONCURRENT_BACKQUOTES (16)
+
+/**
+ Information about a single backquote substring which is being executed
+ concurrently with other substrings in the same expression.
+ */
+typedef struct _YORI_SH_CONCURRENT_BACKQUOTE {
+
+    /**
+     The parsed form of the substring.
+     */
+    YORI_LIBSH_CMD_CONTEXT CmdContext;
+
+    /**
+     The plan to execute the substring.
+     */
+    YORI_LIBSH_EXEC_PLAN ExecPlan;
+
+    /**
+     The output of the substring, to substitute into the expression.
+     */
+    YORI_STRING Output;
+
+    /**
+     TRUE if CmdContext and ExecPlan have been populated and require
+     freeing.
+     */
+    BOOLEAN PlanValid;
+
+    /**
+     TRUE if the process for this substring has been launched and must be
+     waited on.
+     */
+    BOOLEAN Launched;
+} YORI_SH_CONCURRENT_BACKQUOTE, *PYORI_SH_CONCURRENT_BACKQUOTE;
+
+/**
+ Parse a backquote substring and determine whether it can be executed
+ concurrently with other substrings.  This is only possible if it consists of
+ a single external program, since builtins, scripts and in process modules
+ can alter shell state that other substrings observe.
+
+ @param Expression Pointer to the backquote substring.
+
+ @param Backquote Pointer to the concurrent backquote structure to populate.
+        If PlanValid is set on return, the caller must free the plan
+        regardless of the return value.
+
+ @return TRUE if the substring can be executed concurrently, FALSE if it
+         cannot.
+ */
+BOOLEAN
+YoriShPrepareConcurrentBackquote(
+    __in PYORI_STRING Expression,
+    __inout PYORI_SH_CONCURRENT_BACKQUOTE Backquote
+    )
+{
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    BOOLEAN ExecutableFound;
+    LPTSTR szExt;
+    YORI_STRING YsExt;
+
+    if (!YoriLibShParseCmdlineToCmdContext(Expression, 0, &Backquote->CmdContext)) {
+        return FALSE;
+    }
+
+    if (Backquote->CmdContext.ArgC == 0 ||
+        !YoriShExpandEnvironmentInCmdContext(&Backquote->CmdContext) ||
+        !YoriLibShParseCmdContextToExecPlan(&Backquote->CmdContext, &Backquote->ExecPlan, NULL, NULL, NULL, NULL)) {
+
+        YoriLibShFreeCmdContext(&Backquote->CmdContext);
+        return FALSE;
+    }
+
+    Backquote->PlanValid = TRUE;
+
+    if (Backquote->ExecPlan.NumberCommands != 1) {
+        return FALSE;
+    }
+
+    ExecContext = Backquote->ExecPlan.FirstCmd;
+    if (ExecContext->StdOutType != StdOutTypeDefault ||
+        YoriLibIsPathUrl(&ExecContext->CmdToExec.ArgV[0]) ||
+        YoriLibCompareStringWithLiteralInsensitive(&ExecContext->CmdToExec.ArgV[0], _T("BUILTIN")) == 0) {
+
+        return FALSE;
+    }
+
+    if (!YoriShResolveCommandToExecutable(&ExecContext->CmdToExec, &ExecutableFound) ||
+        !ExecutableFound) {
+
+        return FALSE;
+    }
+
+    szExt = YoriLibFindRightMostCharacter(&ExecContext->CmdToExec.ArgV[0], '.');
+    if (szExt == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&YsExt);
+    YsExt.StartOfString = szExt;
+    YsExt.LengthInChars = ExecContext->CmdToExec.ArgV[0].LengthInChars - (YORI_ALLOC_SIZE_T)(szExt - ExecContext->CmdToExec.ArgV[0].StartOfString);
+    if (YoriLibCompareStringWithLiteralInsensitive(&YsExt, _T(".exe")) != 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Launch the process for a backquote substring without waiting for it to
+ complete.
+
+ @param Backquote Pointer to the prepared backquote substring.
+
+ @return TRUE if the process was launched, FALSE if it was not.
+ */
+BOOLEAN
+YoriShLaunchConcurrentBackquote(
+    __inout PYORI_SH_CONCURRENT_BACKQUOTE Backquote
+    )
+{
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    DWORD Err;
+
+    ExecContext = Backquote->ExecPlan.FirstCmd;
+    ExecContext->StdOutType = StdOutTypeBuffer;
+    ExecContext->StdOut.Buffer.ProcessBuffers = NULL;
+    ExecContext->WaitForCompletion = TRUE;
+
+    Err = YoriLibShCreateProcess(ExecContext, NULL, NULL);
+    if (Err != NO_ERROR) {
+        YoriLibShCleanupFailedProcessLaunch(ExecContext);
+        return FALSE;
+    }
+
+    YoriLibShCommenceProcessBuffersIfNeeded(ExecContext);
+    if (ExecContext->hProcess == NULL) {
+        return FALSE;
+    }
+
+    Backquote->Launched = TRUE;
+    return TRUE;
+}
+
+/**
+ Attempt to execute all backquote substrings within an expression
+ concurrently and substitute their results.  This is only possible if the
+ substrings are not nested, and each consists of a single external program.
+ If this is not the case, nothing is executed and the caller is expected to
+ evaluate the substrings in sequence.
+
+ @param Expression The string to expand.
+
+ @param ResultingExpression On successful completion, updated to contain
+        the expression with all substrings substituted.  This is always a
+        newly allocated string.
+
+ @return TRUE to indicate the substrings were executed, FALSE if they were
+         not.
+ */
+__success(return)
+BOOL
+YoriShExpandIndependentBackquotes(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ResultingExpression
+    )
+{
+    YORI_STRING Subsets[YORI_SH_MAX_CONCURRENT_BACKQUOTES];
+    YORI_ALLOC_SIZE_T CharsInPrefix[YORI_SH_MAX_CONCURRENT_BACKQUOTES];
+    PYORI_SH_CONCURRENT_BACKQUOTE Backquotes;
+    PYORI_LIBSH_SINGLE_EXEC_CONTEXT ExecContext;
+    YORI_ALLOC_SIZE_T SubsetCount;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T CharsNeeded;
+    YORI_ALLOC_SIZE_T ReadOffset;
+    YORI_ALLOC_SIZE_T WriteOffset;
+    YORI_ALLOC_SIZE_T SubsetOffset;
+    DWORD ExitCode;
+    BOOLEAN Concurrent;
+    BOOLEAN Result;
+
+    if (!YoriLibShFindIndependentBackquoteSubstrings(Expression, YORI_SH_MAX_CONCURRENT_BACKQUOTES, Subsets, CharsInPrefix, &SubsetCount)) {
+        return FALSE;
+    }
+
+    //
+    //  With a single substring there's nothing to overlap.
+    //
+
+    if (SubsetCount < 2) {
+        return FALSE;
+    }
+
+    Backquotes = YoriLibMalloc(SubsetCount * sizeof(YORI_SH_CONCURRENT_BACKQUOTE));
+    if (Backquotes == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Backquotes, SubsetCount * sizeof(YORI_SH_CONCURRENT_BACKQUOTE));
+
+    //
+    //  Check that every substring can execute concurrently before executing
+    //  any of them, so that if any cannot, the whole expression can be
+    //  evaluated in sequence.
+    //
+
+    Concurrent = TRUE;
+    for (Index = 0; Index < SubsetCount; Index++) {
+        YoriLibInitEmptyString(&Backquotes[Index].Output);
+        if (!YoriShPrepareConcurrentBackquote(&Subsets[Index], &Backquotes[Index])) {
+            Concurrent = FALSE;
+            break;
+        }
+    }
+
+    Result = FALSE;
+    if (!Concurrent) {
+        goto Cleanup;
+    }
+
+    //
+    //  Launch all of the processes.  If any fails to launch here, it is
+    //  evaluated in sequence when its result is needed.
+    //
+
+    for (Index = 0; Index < SubsetCount; Index++) {
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+        YoriShLaunchConcurrentBackquote(&Backquotes[Index]);
+    }
+
+    //
+    //  Collect results in order, so the error level reflects the final
+    //  substring as it would if they were executed in sequence.
+    //
+
+    CharsNeeded = Expression->LengthInChars + 1;
+    for (Index = 0; Index < SubsetCount; Index++) {
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        if (Backquotes[Index].Launched) {
+            ExecContext = Backquotes[Index].ExecPlan.FirstCmd;
+            YoriShWaitForProcessToTerminate(ExecContext);
+            if (GetExitCodeProcess(ExecContext->hProcess, &ExitCode)) {
+                YoriShGlobal.ErrorLevel = ExitCode;
+            }
+            if (ExecContext->StdOut.Buffer.ProcessBuffers != NULL) {
+                YoriShGetBackquoteOutput(ExecContext->StdOut.Buffer.ProcessBuffers, &Backquotes[Index].Output);
+            }
+        } else {
+            if (!YoriShExecuteExpressionAndCaptureOutput(&Subsets[Index], &Backquotes[Index].Output)) {
+                YoriLibInitEmptyString(&Backquotes[Index].Output);
+            }
+        }
+
+        CharsNeeded = CharsNeeded - Subsets[Index].LengthInChars - CharsInPrefix[Index] - 1 + Backquotes[Index].Output.LengthInChars;
+    }
+
+    if (YoriLibIsOperationCancelled()) {
+        for (Index = 0; Index < SubsetCount; Index++) {
+            if (Backquotes[Index].Launched) {
+                YoriShCancelExecPlan(&Backquotes[Index].ExecPlan);
+            }
+        }
+        goto Cleanup;
+    }
+
+    //
+    //  Construct the new expression from the text between the substrings
+    //  and the output of each substring.
+    //
+
+    if (!YoriLibAllocateString(ResultingExpression, CharsNeeded)) {
+        goto Cleanup;
+    }
+
+    ReadOffset = 0;
+    WriteOffset = 0;
+    for (Index = 0; Index < SubsetCount; Index++) {
+        SubsetOffset = (YORI_ALLOC_SIZE_T)(Subsets[Index].StartOfString - Expression->StartOfString - CharsInPrefix[Index]);
+        memcpy(&ResultingExpression->StartOfString[WriteOffset], &Expression->StartOfString[ReadOffset], (SubsetOffset - ReadOffset) * sizeof(TCHAR));
+        WriteOffset = WriteOffset + SubsetOffset - ReadOffset;
+        memcpy(&ResultingExpression->StartOfString[WriteOffset], Backquotes[Index].Output.StartOfString, Backquotes[Index].Output.LengthInChars * sizeof(TCHAR));
+        WriteOffset = WriteOffset + Backquotes[Index].Output.LengthInChars;
+        ReadOffset = SubsetOffset + CharsInPrefix[Index] + Subsets[Index].LengthInChars + 1;
+    }
+
+    memcpy(&ResultingExpression->StartOfString[WriteOffset], &Expression->StartOfString[ReadOffset], (Expression->LengthInChars - ReadOffset) * sizeof(TCHAR));
+    WriteOffset = WriteOffset + Expression->LengthInChars - ReadOffset;
+    ResultingExpression->StartOfString[WriteOffset] = '\0';
+    ResultingExpression->LengthInChars = WriteOffset;
+    Result = TRUE;
+
+Cleanup:
+
+    for (Index = 0; Index < SubsetCount; Index++) {
+        YoriLibFreeStringContents(&Backquotes[Index].Output);
+        if (Backquotes[Index].PlanValid) {
+            YoriLibShFreeExecPlan(&Backquotes[Index].ExecPlan);
+            YoriLibShFreeCmdContext(&Backquotes[Index].CmdContext);
+        }
+    }
+    YoriLibFree(Backquotes);
+
+    return Result;
+}
+
+/**
+ Parse and execute all backquotes in an expression, potentially resulting
+ in a new expression.  This will internally perform parsing and redirection,
+ as well as execute multiple subprocesses as needed.  If the expression
+ contains several backquote substrings that do not depend on each other,
+ they are executed concurrently.
+
+ @param Expression The string to execute.
+
+ @param ResultingExpression On successful completion, updated to contain
+        the final expression to evaluate.  This may be the same as Expression
+        if no backquote expansion occurred.
+
+ @return TRUE to indicate it was successfully executed, FALSE otherwise.
+ */
+__success(return)
+BOOL
+YoriShExpandBackquotes(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ResultingExpression
+    )
+{
+    YORI_STRING ConcurrentExpression;
+    YORI_STRING FinalExpression;
+
+    if (!YoriShExpandIndependentBackquotes(Expression, &ConcurrentExpression)) {
+        return YoriShExpandBackquotesWithCallback(Expression, YoriShEvaluateBackquote, NULL, ResultingExpression);
+    }
+
+    //
+    //  The output of a substring may itself contain backquotes, which are
+    //  evaluated as they would be in sequence.
+    //
+
+    if (!YoriShExpandBackquotesWithCallback(&ConcurrentExpression, YoriShEvaluateBackquote, NULL, &FinalExpression)) {
+        YoriLibFreeStringContents(&ConcurrentExpression);
+        return FALSE;
+    }
+
+    if (FinalExpression.StartOfString == ConcurrentExpression.StartOfString) {
+        memcpy(ResultingExpression, &ConcurrentExpression, sizeof(YORI_STRING));
+    } else {
+        YoriLibFreeStringContents(&ConcurrentExpression);
+        memcpy(ResultingExpression, &FinalExpression, sizeof(YORI_STRING));
+    }
+
+    return TRUE;
+}
+
 /**
  Parse and execute a command string.  This will internally perform parsing
  and redirection, as well as execute multiple subprocesses as needed.  This
@@ -735,9 +1291,11 @@ YoriShExecuteExpression(
     YORI_LIBSH_EXEC_PLAN ExecPlan;
     YORI_LIBSH_CMD_CONTEXT CmdContext;
     YORI_STRING CurrentFullExpression;
+    LARGE_INTEGER PhaseStartTime;
 
     //
-    //  Expand all backquotes.
+    //  Expand all backquotes.  These execute commands which are measured
+    //  separately, so they are not part of any phase here.
     //
 
     if (!YoriShExpandBackquotes(Expression, &CurrentFullExpression)) {
@@ -750,11 +1308,16 @@ YoriShExecuteExpression(
     //  Parse the expression we're trying to execute.
     //
 
+    YoriShTimingStart(&PhaseStartTime);
+    YoriLibEtwWriteEvent("Parse", YORI_ETW_OPCODE_START, &CurrentFullExpression, 0);
     if (!YoriLibShParseCmdlineToCmdContext(&CurrentFullExpression, 0, &CmdContext)) {
+        YoriLibEtwWriteEvent("Parse", YORI_ETW_OPCODE_STOP, NULL, 0);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Parse error\n"));
         YoriLibFreeStringContents(&CurrentFullExpression);
         return FALSE;
     }
+    YoriLibEtwWriteEvent("Parse", YORI_ETW_OPCODE_STOP, NULL, CmdContext.ArgC);
+    YoriShTimingRecord(YoriShTimingPhaseParse, &PhaseStartTime);
 
     if (CmdContext.ArgC == 0) {
         YoriLibShFreeCmdContext(&CmdContext);
@@ -767,6 +1330,7 @@ YoriShExecuteExpression(
         YoriLibFreeStringContents(&CurrentFullExpression);
         return FALSE;
     }
+    YoriShTimingRecord(YoriShTimingPhaseExpand, &PhaseStartTime);
 
     if (!YoriLibShParseCmdContextToExecPlan(&CmdContext, &ExecPlan, NULL, NULL, NULL, NULL)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Parse error\n"));
@@ -774,6 +1338,7 @@ YoriShExecuteExpression(
         YoriLibShFreeCmdContext(&CmdContext);
         return FALSE;
     }
+    YoriShTimingRecord(YoriShTimingPhaseParse, &PhaseStartTime);
 
     YoriShExecExecPlan(&ExecPlan, NULL);
 
@@ -26,6 +26,23 @@
 
 #include "yori.h"
 
+/**
+ The size of each block of memory that history entries are allocated from.
+ Entries larger than a quarter of this size are allocated individually.
+ */
+#define YORI_SH_HISTORY_ARENA_SIZE (64 * 1024)
+
+/**
+ The number of characters at the beginning of each history entry used to
+ select its bucket in the prefix index.
+ */
+#define YORI_SH_HISTORY_INDEX_CHARS (3)
+
+/**
+ The number of buckets in the prefix index.
+ */
+#define YORI_SH_HISTORY_INDEX_BUCKETS (1024)
+
 /**
  Number of elements in command history.
  */
@@ -48,6 +65,590 @@ HANDLE YoriShHistoryLock;
  */
 BOOL YoriShHistoryInitialized;
 
+/**
+ Handle to a thread which is loading history from the history file.  NULL
+ if no load is in progress.  History must not be accessed until this
+ thread has completed, which is ensured by calling
+ @ref YoriShEnsureHistoryLoaded .
+ */
+HANDLE YoriShHistoryLoadThread;
+
+/**
+ The fully qualified name of the file that history was loaded from.  Empty
+ if history was not loaded from a file.
+ */
+YORI_STRING YoriShHistoryFileName;
+
+/**
+ The number of lines in the history file when it was loaded or last
+ written.
+ */
+DWORD YoriShHistoryFileLineCount;
+
+/**
+ The number of most recent history entries which have not been written to
+ the history file.
+ */
+DWORD YoriShHistoryUnsavedCount;
+
+/**
+ Set to TRUE if entries have been removed from history other than by
+ aging out, so the history file needs to be rewritten rather than appended
+ to.
+ */
+BOOL YoriShHistoryRewriteRequired;
+
+/**
+ The block of memory that new history entries are currently being
+ allocated from.  This holds a reference on the block, and each entry
+ within it holds another.
+ */
+PUCHAR YoriShHistoryArena;
+
+/**
+ The number of bytes within @ref YoriShHistoryArena that have been used.
+ */
+YORI_ALLOC_SIZE_T YoriShHistoryArenaOffset;
+
+/**
+ An index of history entries by the first few characters of each entry,
+ compared case insensitively.  Each bucket is a list of entries in the same
+ order as the history list.  Entries shorter than
+ YORI_SH_HISTORY_INDEX_CHARS are not indexed.
+ */
+YORI_LIST_ENTRY YoriShHistoryIndex[YORI_SH_HISTORY_INDEX_BUCKETS];
+
+/**
+ The number of buckets in the hash table of arguments used in history.
+ */
+#define YORI_SH_ARG_HASH_BUCKETS (1000)
+
+/**
+ A record of an argument that appears in one or more history entries.
+ These are used to suggest arguments that have been used frequently and
+ recently.
+ */
+typedef struct _YORI_SH_ARG_FRECENCY {
+
+    /**
+     The entry within @ref YoriShArgHash , keyed by the argument.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The links within the prefix bucket in @ref YoriShArgIndex .
+     */
+    YORI_LIST_ENTRY IndexListEntry;
+
+    /**
+     The number of history entries that use this argument as the command.
+     */
+    DWORD CommandCount;
+
+    /**
+     The number of history entries that use this argument other than as the
+     command.
+     */
+    DWORD ArgumentCount;
+
+    /**
+     The value of @ref YoriShHistorySequence when this argument was most
+     recently added to history.
+     */
+    DWORD LastUseSequence;
+
+    /**
+     The argument.  This points to memory within this allocation.
+     */
+    YORI_STRING Arg;
+
+} YORI_SH_ARG_FRECENCY, *PYORI_SH_ARG_FRECENCY;
+
+/**
+ Incremented each time an entry is added to history.  This is used to
+ determine how recently an argument was used.
+ */
+DWORD YoriShHistorySequence;
+
+/**
+ A hash table of arguments used in history, or NULL if arguments are not
+ being indexed.
+ */
+PYORI_HASH_TABLE YoriShArgHash;
+
+/**
+ An index of arguments used in history by their first few characters, in
+ the same form as @ref YoriShHistoryIndex .
+ */
+YORI_LIST_ENTRY YoriShArgIndex[YORI_SH_HISTORY_INDEX_BUCKETS];
+
+/**
+ Initialize the history list and prefix indexes if they have not been
+ initialized already.  If the hash table of arguments cannot be allocated,
+ history continues to function without argument suggestions.
+ */
+VOID
+YoriShInitHistoryLists(VOID)
+{
+    DWORD Index;
+
+    if (YoriShGlobal.CommandHistory.Next == NULL) {
+        YoriLibInitializeListHead(&YoriShGlobal.CommandHistory);
+    }
+
+    if (YoriShHistoryIndex[0].Next == NULL) {
+        for (Index = 0; Index < YORI_SH_HISTORY_INDEX_BUCKETS; Index++) {
+            YoriLibInitializeListHead(&YoriShHistoryIndex[Index]);
+            YoriLibInitializeListHead(&YoriShArgIndex[Index]);
+        }
+    }
+
+    if (YoriShArgHash == NULL) {
+        YoriShArgHash = YoriLibAllocateHashTable(YORI_SH_ARG_HASH_BUCKETS);
+    }
+}
+
+/**
+ Return the prefix index bucket for a string.  Only the first
+ YORI_SH_HISTORY_INDEX_CHARS characters are considered, so all strings with
+ a common prefix of at least this length share a bucket.
+
+ @param Index Pointer to the array of YORI_SH_HISTORY_INDEX_BUCKETS list
+        heads that form the index.
+
+ @param String Pointer to the string, which must contain at least
+        YORI_SH_HISTORY_INDEX_CHARS characters.
+
+ @return Pointer to the bucket list head.
+ */
+PYORI_LIST_ENTRY
+YoriShGetHistoryIndexBucket(
+    __in PYORI_LIST_ENTRY Index,
+    __in PYORI_STRING String
+    )
+{
+    DWORD Hash;
+    DWORD CharIndex;
+
+    ASSERT(String->LengthInChars >= YORI_SH_HISTORY_INDEX_CHARS);
+
+    Hash = 0;
+    for (CharIndex = 0; CharIndex < YORI_SH_HISTORY_INDEX_CHARS; CharIndex++) {
+        Hash = Hash * 37 + YoriLibUpcaseChar(String->StartOfString[CharIndex]);
+    }
+
+    return &Index[Hash % YORI_SH_HISTORY_INDEX_BUCKETS];
+}
+
+/**
+ Allocate a history entry containing a copy of a command.  Entries are
+ allocated sequentially from large referenced blocks, so that a long history
+ doesn't require an allocation per entry.
+
+ @param NewCmd Pointer to the command to copy into the entry.
+
+ @return Pointer to the new entry, or NULL on allocation failure.  The entry
+         is not inserted into any list.
+ */
+__success(return != NULL)
+PYORI_SH_HISTORY_ENTRY
+YoriShAllocateHistoryEntry(
+    __in PYORI_STRING NewCmd
+    )
+{
+    YORI_ALLOC_SIZE_T BytesNeeded;
+    PUCHAR Block;
+    PYORI_SH_HISTORY_ENTRY Entry;
+
+    if (!YoriLibIsSizeAllocatable(sizeof(YORI_SH_HISTORY_ENTRY) + ((YORI_MAX_UNSIGNED_T)NewCmd->LengthInChars + 1) * sizeof(TCHAR) + sizeof(PVOID))) {
+        return NULL;
+    }
+
+    BytesNeeded = sizeof(YORI_SH_HISTORY_ENTRY) + (NewCmd->LengthInChars + 1) * sizeof(TCHAR);
+    BytesNeeded = (BytesNeeded + sizeof(PVOID) - 1) & ~((YORI_ALLOC_SIZE_T)sizeof(PVOID) - 1);
+
+    if (BytesNeeded > YORI_SH_HISTORY_ARENA_SIZE / 4) {
+        Block = YoriLibReferencedMalloc(BytesNeeded);
+        if (Block == NULL) {
+            return NULL;
+        }
+        Entry = (PYORI_SH_HISTORY_ENTRY)Block;
+    } else {
+        if (YoriShHistoryArena == NULL ||
+            YoriShHistoryArenaOffset + BytesNeeded > YORI_SH_HISTORY_ARENA_SIZE) {
+
+            Block = YoriLibReferencedMalloc(YORI_SH_HISTORY_ARENA_SIZE);
+            if (Block == NULL) {
+                return NULL;
+            }
+
+            if (YoriShHistoryArena != NULL) {
+                YoriLibDereference(YoriShHistoryArena);
+            }
+            YoriShHistoryArena = Block;
+            YoriShHistoryArenaOffset = 0;
+        }
+
+        Block = YoriShHistoryArena;
+        Entry = (PYORI_SH_HISTORY_ENTRY)(Block + YoriShHistoryArenaOffset);
+        YoriShHistoryArenaOffset = YoriShHistoryArenaOffset + BytesNeeded;
+        YoriLibReference(Block);
+    }
+
+    YoriLibInitEmptyString(&Entry->CmdLine);
+    Entry->CmdLine.MemoryToFree = Block;
+    Entry->CmdLine.StartOfString = (LPTSTR)(Entry + 1);
+    memcpy(Entry->CmdLine.StartOfString, NewCmd->StartOfString, NewCmd->LengthInChars * sizeof(TCHAR));
+    Entry->CmdLine.StartOfString[NewCmd->LengthInChars] = '\0';
+    Entry->CmdLine.LengthInChars = NewCmd->LengthInChars;
+    Entry->CmdLine.LengthAllocated = NewCmd->LengthInChars + 1;
+
+    return Entry;
+}
+
+/**
+ Add or remove a single argument from the index of arguments used in
+ history.  The caller is expected to synchronize access to history.
+
+ @param Arg Pointer to the argument.
+
+ @param IsCommand TRUE if the argument is the command being executed,
+        FALSE if it is an argument to the command.
+
+ @param Add TRUE if a history entry containing the argument is being added,
+        FALSE if one is being removed.
+ */
+VOID
+YoriShUpdateArgIndexEntry(
+    __in PYORI_STRING Arg,
+    __in BOOLEAN IsCommand,
+    __in BOOLEAN Add
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_ARG_FRECENCY Record;
+
+    HashEntry = YoriLibHashLookupByKey(YoriShArgHash, Arg);
+    if (HashEntry != NULL) {
+        Record = HashEntry->Context;
+    } else {
+        if (!Add) {
+            return;
+        }
+
+        Record = YoriLibMalloc(sizeof(YORI_SH_ARG_FRECENCY) + (Arg->LengthInChars + 1) * sizeof(TCHAR));
+        if (Record == NULL) {
+            return;
+        }
+
+        YoriLibInitEmptyString(&Record->Arg);
+        Record->Arg.StartOfString = (LPTSTR)(Record + 1);
+        Record->Arg.LengthInChars = Arg->LengthInChars;
+        Record->Arg.LengthAllocated = Arg->LengthInChars + 1;
+        memcpy(Record->Arg.StartOfString, Arg->StartOfString, Arg->LengthInChars * sizeof(TCHAR));
+        Record->Arg.StartOfString[Arg->LengthInChars] = '\0';
+        Record->CommandCount = 0;
+        Record->ArgumentCount = 0;
+
+        YoriLibHashInsertByKey(YoriShArgHash, &Record->Arg, Record, &Record->HashEntry);
+        YoriLibAppendList(YoriShGetHistoryIndexBucket(YoriShArgIndex, &Record->Arg), &Record->IndexListEntry);
+    }
+
+    if (Add) {
+        if (IsCommand) {
+            Record->CommandCount++;
+        } else {
+            Record->ArgumentCount++;
+        }
+        Record->LastUseSequence = YoriShHistorySequence;
+    } else {
+        if (IsCommand) {
+            if (Record->CommandCount > 0) {
+                Record->CommandCount--;
+            }
+        } else {
+            if (Record->ArgumentCount > 0) {
+                Record->ArgumentCount--;
+            }
+        }
+
+        if (Record->CommandCount == 0 && Record->ArgumentCount == 0) {
+            YoriLibHashRemoveByEntry(&Record->HashEntry);
+            YoriLibRemoveListItem(&Record->IndexListEntry);
+            YoriLibFree(Record);
+        }
+    }
+}
+
+/**
+ Add or remove the arguments of a history entry from the index of arguments
+ used in history.  This splits the command on spaces outside of quotes,
+ which is much cheaper than a full parse and sufficient to find arguments
+ worth suggesting.  The caller is expected to synchronize access to
+ history.
+
+ @param CmdLine Pointer to the command line of the history entry.
+
+ @param Add TRUE if the entry is being added to history, FALSE if it is
+        being removed.
+ */
+VOID
+YoriShUpdateArgIndex(
+    __in PYORI_STRING CmdLine,
+    __in BOOLEAN Add
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+    YORI_ALLOC_SIZE_T ArgStart;
+    YORI_STRING Arg;
+    BOOLEAN InQuotes;
+    BOOLEAN IsCommand;
+    BOOLEAN HasWildcard;
+    TCHAR Char;
+
+    if (YoriShArgHash == NULL) {
+        return;
+    }
+
+    IsCommand = TRUE;
+    Index = 0;
+    while (Index < CmdLine->LengthInChars) {
+        if (CmdLine->StartOfString[Index] == ' ') {
+            Index++;
+            continue;
+        }
+
+        ArgStart = Index;
+        InQuotes = FALSE;
+        HasWildcard = FALSE;
+        while (Index < CmdLine->LengthInChars) {
+            Char = CmdLine->StartOfString[Index];
+            if (Char == '"') {
+                InQuotes = (BOOLEAN)!InQuotes;
+            } else if (Char == ' ' && !InQuotes) {
+                break;
+            } else if (Char == '*' || Char == '?') {
+                HasWildcard = TRUE;
+            }
+            Index++;
+        }
+
+        YoriLibInitEmptyString(&Arg);
+        Arg.StartOfString = &CmdLine->StartOfString[ArgStart];
+        Arg.LengthInChars = Index - ArgStart;
+
+        //
+        //  Remove enclosing quotes, since suggestions are generated without
+        //  them and quotes are added if needed when a suggestion is used.
+        //
+
+        if (Arg.LengthInChars >= 2 &&
+            Arg.StartOfString[0] == '"' &&
+            Arg.StartOfString[Arg.LengthInChars - 1] == '"') {
+
+            Arg.StartOfString++;
+            Arg.LengthInChars = Arg.LengthInChars - 2;
+        }
+
+        if (Arg.LengthInChars >= YORI_SH_HISTORY_INDEX_CHARS && !HasWildcard) {
+            YoriShUpdateArgIndexEntry(&Arg, IsCommand, Add);
+        }
+
+        IsCommand = FALSE;
+    }
+}
+
+/**
+ Calculate a score for an argument that combines how often it appears in
+ history with how recently it was used.  The caller is expected to
+ synchronize access to history.
+
+ @param Record Pointer to the argument.
+
+ @param IsCommand TRUE if the argument is being suggested as a command,
+        FALSE if it is being suggested as an argument to a command.
+
+ @return The score, where larger values indicate a better suggestion.  Zero
+         indicates the argument has not been used in this position.
+ */
+DWORD
+YoriShGetArgFrecencyScore(
+    __in PYORI_SH_ARG_FRECENCY Record,
+    __in BOOLEAN IsCommand
+    )
+{
+    DWORD Count;
+    DWORD Age;
+
+    if (IsCommand) {
+        Count = Record->CommandCount;
+    } else {
+        Count = Record->ArgumentCount;
+    }
+
+    Age = YoriShHistorySequence - Record->LastUseSequence;
+    if (Age < 32) {
+        return Count * 4;
+    } else if (Age < 256) {
+        return Count * 2;
+    }
+    return Count;
+}
+
+/**
+ Find the argument used in history which begins with a specified prefix,
+ is longer than the prefix, and has the highest frecency score.  This
+ searches only the prefix index bucket, so it is fast with large histories.
+ If history is being loaded or updated by another thread, this returns
+ without waiting.
+
+ @param Prefix Pointer to the prefix to search for.
+
+ @param IsCommand TRUE if the argument is being suggested as a command,
+        FALSE if it is being suggested as an argument to a command.
+
+ @param Found On successful completion, populated with a newly allocated
+        copy of the argument.
+
+ @return TRUE to indicate a matching argument was found, FALSE if it was
+         not.
+ */
+__success(return)
+BOOL
+YoriShFindFrecentArg(
+    __in PYORI_STRING Prefix,
+    __in BOOLEAN IsCommand,
+    __out PYORI_STRING Found
+    )
+{
+    PYORI_LIST_ENTRY ListHead;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_ARG_FRECENCY Record;
+    PYORI_SH_ARG_FRECENCY BestRecord;
+    DWORD BestScore;
+    DWORD Score;
+    BOOL Result;
+
+    YoriLibInitEmptyString(Found);
+
+    if (YoriShArgHash == NULL ||
+        YoriShHistoryLoadThread != NULL ||
+        Prefix->LengthInChars < YORI_SH_HISTORY_INDEX_CHARS) {
+
+        return FALSE;
+    }
+
+    if (WaitForSingleObject(YoriShHistoryLock, 0) != WAIT_OBJECT_0) {
+        return FALSE;
+    }
+
+    BestRecord = NULL;
+    BestScore = 0;
+    ListHead = YoriShGetHistoryIndexBucket(YoriShArgIndex, Prefix);
+    ListEntry = YoriLibGetNextListEntry(ListHead, NULL);
+    while (ListEntry != NULL) {
+        Record = CONTAINING_RECORD(ListEntry, YORI_SH_ARG_FRECENCY, IndexListEntry);
+        if (Record->Arg.LengthInChars > Prefix->LengthInChars &&
+            YoriLibCompareStringInsensitiveCount(&Record->Arg, Prefix, Prefix->LengthInChars) == 0) {
+
+            Score = YoriShGetArgFrecencyScore(Record, IsCommand);
+            if (Score > BestScore) {
+                BestScore = Score;
+                BestRecord = Record;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(ListHead, ListEntry);
+    }
+
+    Result = FALSE;
+    if (BestRecord != NULL) {
+        Result = YoriLibCopyString(Found, &BestRecord->Arg);
+    }
+
+    ReleaseMutex(YoriShHistoryLock);
+    return Result;
+}
+
+/**
+ Remove an entry from history and free it.  The caller is expected to
+ synchronize access to history.
+
+ @param HistoryEntry Pointer to the entry to free.
+ */
+VOID
+YoriShFreeHistoryEntry(
+    __in PYORI_SH_HISTORY_ENTRY HistoryEntry
+    )
+{
+    PVOID Block;
+
+    YoriLibRemoveListItem(&HistoryEntry->ListEntry);
+    if (HistoryEntry->IndexListEntry.Next != NULL) {
+        YoriLibRemoveListItem(&HistoryEntry->IndexListEntry);
+    }
+    YoriShUpdateArgIndex(&HistoryEntry->CmdLine, FALSE);
+
+    //
+    //  The entry may be within the block being dereferenced, so it can't
+    //  be touched afterwards.
+    //
+
+    Block = HistoryEntry->CmdLine.MemoryToFree;
+    YoriLibDereference(Block);
+    YoriShCommandHistoryCount--;
+}
+
+/**
+ Insert a new entry at the end of history, and remove the oldest entries if
+ history has exceeded its maximum size.  The caller is expected to
+ synchronize access to history.
+
+ @param HistoryEntry Pointer to the entry to insert.
+ */
+VOID
+YoriShAppendHistoryEntry(
+    __in PYORI_SH_HISTORY_ENTRY HistoryEntry
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+
+    YoriLibAppendList(&YoriShGlobal.CommandHistory, &HistoryEntry->ListEntry);
+    if (HistoryEntry->CmdLine.LengthInChars >= YORI_SH_HISTORY_INDEX_CHARS) {
+        YoriLibAppendList(YoriShGetHistoryIndexBucket(YoriShHistoryIndex, &HistoryEntry->CmdLine), &HistoryEntry->IndexListEntry);
+    } else {
+        HistoryEntry->IndexListEntry.Next = NULL;
+        HistoryEntry->IndexListEntry.Prev = NULL;
+    }
+    YoriShHistorySequence++;
+    YoriShUpdateArgIndex(&HistoryEntry->CmdLine, TRUE);
+    YoriShCommandHistoryCount++;
+
+    while (YoriShCommandHistoryCount > YoriShCommandHistoryMax) {
+        ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
+        YoriShFreeHistoryEntry(CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry));
+    }
+}
+
+/**
+ If history is being loaded from a file on a background thread, wait for
+ the load to complete.  This must be called before history is accessed.
+ */
+VOID
+YoriShEnsureHistoryLoaded(VOID)
+{
+    if (YoriShHistoryLoadThread == NULL) {
+        return;
+    }
+
+    WaitForSingleObject(YoriShHistoryLock, INFINITE);
+    if (YoriShHistoryLoadThread != NULL) {
+        WaitForSingleObject(YoriShHistoryLoadThread, INFINITE);
+        CloseHandle(YoriShHistoryLoadThread);
+        YoriShHistoryLoadThread = NULL;
+    }
+    ReleaseMutex(YoriShHistoryLock);
+}
+
 /**
  Add an entered command into the command history buffer.
 
@@ -68,20 +669,17 @@ YoriShAddToHistory(
     __in BOOLEAN IgnoreIfRepeat
     )
 {
-    YORI_ALLOC_SIZE_T LengthToAllocate;
     PYORI_SH_HISTORY_ENTRY NewHistoryEntry;
 
     if (NewCmd->LengthInChars == 0) {
         return TRUE;
     }
 
-    LengthToAllocate = sizeof(YORI_SH_HISTORY_ENTRY);
+    YoriShEnsureHistoryLoaded();
 
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
 
-        if (YoriShGlobal.CommandHistory.Next == NULL) {
-            YoriLibInitializeListHead(&YoriShGlobal.CommandHistory);
-        }
+        YoriShInitHistoryLists();
 
         if (IgnoreIfRepeat) {
             PYORI_LIST_ENTRY ExistingEntry;
@@ -95,27 +693,14 @@ YoriShAddToHistory(
             }
         }
 
-        NewHistoryEntry = YoriLibMalloc(LengthToAllocate);
+        NewHistoryEntry = YoriShAllocateHistoryEntry(NewCmd);
         if (NewHistoryEntry == NULL) {
             ReleaseMutex(YoriShHistoryLock);
             return FALSE;
         }
 
-        YoriLibCloneString(&NewHistoryEntry->CmdLine, NewCmd);
-
-        YoriLibAppendList(&YoriShGlobal.CommandHistory, &NewHistoryEntry->ListEntry);
-        YoriShCommandHistoryCount++;
-        while (YoriShCommandHistoryCount > YoriShCommandHistoryMax) {
-            PYORI_LIST_ENTRY ListEntry;
-            PYORI_SH_HISTORY_ENTRY OldHistoryEntry;
-
-            ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
-            OldHistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
-            YoriLibRemoveListItem(ListEntry);
-            YoriLibFreeStringContents(&OldHistoryEntry->CmdLine);
-            YoriLibFree(OldHistoryEntry);
-            YoriShCommandHistoryCount--;
-        }
+        YoriShAppendHistoryEntry(NewHistoryEntry);
+        YoriShHistoryUnsavedCount++;
         ReleaseMutex(YoriShHistoryLock);
     }
 
@@ -139,10 +724,8 @@ YoriShRemoveOneHistoryEntry(
     )
 {
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
-        YoriLibRemoveListItem(&HistoryEntry->ListEntry);
-        YoriLibFreeStringContents(&HistoryEntry->CmdLine);
-        YoriLibFree(HistoryEntry);
-        YoriShCommandHistoryCount--;
+        YoriShFreeHistoryEntry(HistoryEntry);
+        YoriShHistoryRewriteRequired = TRUE;
         ReleaseMutex(YoriShHistoryLock);
     }
 }
@@ -156,20 +739,97 @@ YoriShClearAllHistory(VOID)
     PYORI_LIST_ENTRY ListEntry = NULL;
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
 
+    YoriShEnsureHistoryLoaded();
+
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
         ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
         while (ListEntry != NULL) {
             HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
             ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
-            YoriLibRemoveListItem(&HistoryEntry->ListEntry);
-            YoriLibFreeStringContents(&HistoryEntry->CmdLine);
-            YoriLibFree(HistoryEntry);
-            YoriShCommandHistoryCount--;
+            YoriShFreeHistoryEntry(HistoryEntry);
+        }
+
+        if (YoriShHistoryArena != NULL) {
+            YoriLibDereference(YoriShHistoryArena);
+            YoriShHistoryArena = NULL;
+            YoriShHistoryArenaOffset = 0;
         }
+
+        YoriShHistoryUnsavedCount = 0;
+        YoriShHistoryRewriteRequired = TRUE;
         ReleaseMutex(YoriShHistoryLock);
     }
 }
 
+/**
+ Find the most recent history entry that begins with a specified string,
+ compared case insensitively.
+
+ @param Prefix Pointer to the string that the entry should begin with.
+
+ @param PreviousMatch Optionally points to an entry returned from a previous
+        call.  If specified, the search resumes with the entry preceding
+        this one.
+
+ @return Pointer to the matching entry, or NULL if no further entries
+         match.
+ */
+PYORI_SH_HISTORY_ENTRY
+YoriShFindPreviousHistoryEntryByPrefix(
+    __in PYORI_STRING Prefix,
+    __in_opt PYORI_SH_HISTORY_ENTRY PreviousMatch
+    )
+{
+    PYORI_LIST_ENTRY ListHead;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+
+    YoriShEnsureHistoryLoaded();
+
+    if (YoriShGlobal.CommandHistory.Next == NULL) {
+        return NULL;
+    }
+
+    //
+    //  If the prefix is long enough, only entries in its index bucket can
+    //  match.  Otherwise, search all of history.
+    //
+
+    if (Prefix->LengthInChars >= YORI_SH_HISTORY_INDEX_CHARS) {
+        ListHead = YoriShGetHistoryIndexBucket(YoriShHistoryIndex, Prefix);
+        if (PreviousMatch != NULL && PreviousMatch->IndexListEntry.Next != NULL) {
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, &PreviousMatch->IndexListEntry);
+        } else {
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, NULL);
+        }
+
+        while (ListEntry != NULL) {
+            HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, IndexListEntry);
+            if (YoriLibCompareStringInsensitiveCount(&HistoryEntry->CmdLine, Prefix, Prefix->LengthInChars) == 0) {
+                return HistoryEntry;
+            }
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, ListEntry);
+        }
+    } else {
+        ListHead = &YoriShGlobal.CommandHistory;
+        if (PreviousMatch != NULL) {
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, &PreviousMatch->ListEntry);
+        } else {
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, NULL);
+        }
+
+        while (ListEntry != NULL) {
+            HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+            if (YoriLibCompareStringInsensitiveCount(&HistoryEntry->CmdLine, Prefix, Prefix->LengthInChars) == 0) {
+                return HistoryEntry;
+            }
+            ListEntry = YoriLibGetPreviousListEntry(ListHead, ListEntry);
+        }
+    }
+
+    return NULL;
+}
+
 /**
  Configure the maximum amount of history to retain if the user has requested
  this behavior by setting YORIHISTSIZE.
@@ -200,9 +860,7 @@ YoriShInitHistory(VOID)
 
     YoriShCommandHistoryMax = 250;
 
-    if (YoriShGlobal.CommandHistory.Next == NULL) {
-        YoriLibInitializeListHead(&YoriShGlobal.CommandHistory);
-    }
+    YoriShInitHistoryLists();
 
     //
     //  See if the user has other ideas.
@@ -235,32 +893,25 @@ YoriShInitHistory(VOID)
 }
 
 /**
- Load history from a file if the user has requested this behavior by
- setting YORIHISTFILE.  Configure the maximum amount of history to retain
- if the user has requested this behavior by setting YORIHISTSIZE.
+ Resolve the file that history should be loaded from or saved to, if the
+ user has requested this behavior by setting YORIHISTFILE.
+
+ @param FilePath On successful completion, populated with the fully
+        qualified path to the history file.  This is empty if no history
+        file is configured.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriShLoadHistoryFromFile(VOID)
+YoriShGetHistoryFileName(
+    __out PYORI_STRING FilePath
+    )
 {
     YORI_ALLOC_SIZE_T EnvVarLength;
     YORI_STRING UserHistFileName;
-    YORI_STRING FilePath;
-    HANDLE FileHandle;
-    PVOID LineContext = NULL;
-    YORI_STRING LineString;
 
-    if (YoriShHistoryInitialized) {
-        return TRUE;
-    }
-
-    YoriShInitHistory();
-
-    //
-    //  Check if there's a file to load saved history from.
-    //
+    YoriLibInitEmptyString(FilePath);
 
     EnvVarLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), NULL, 0, NULL);
     if (EnvVarLength == 0) {
@@ -278,12 +929,100 @@ YoriShLoadHistoryFromFile(VOID)
         return FALSE;
     }
 
-    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, &FilePath)) {
+    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, FilePath)) {
         YoriLibFreeStringContents(&UserHistFileName);
         return FALSE;
     }
 
     YoriLibFreeStringContents(&UserHistFileName);
+    return TRUE;
+}
+
+/**
+ A background thread which reads history from the history file.  While this
+ thread is running, no other thread accesses history, so it populates
+ history without acquiring the history lock.
+
+ @param Context The handle to the opened history file.  This thread is
+        responsible for closing it.
+
+ @return Zero.
+ */
+DWORD WINAPI
+YoriShLoadHistoryWorker(
+    __in LPVOID Context
+    )
+{
+    HANDLE FileHandle;
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    PYORI_SH_HISTORY_ENTRY NewHistoryEntry;
+
+    FileHandle = (HANDLE)Context;
+
+    YoriLibInitEmptyString(&LineString);
+
+    while (TRUE) {
+
+        if (!YoriLibReadLineToString(&LineString, &LineContext, FileHandle)) {
+            break;
+        }
+
+        YoriShHistoryFileLineCount++;
+        if (LineString.LengthInChars == 0) {
+            continue;
+        }
+
+        NewHistoryEntry = YoriShAllocateHistoryEntry(&LineString);
+        if (NewHistoryEntry == NULL) {
+            break;
+        }
+
+        YoriShAppendHistoryEntry(NewHistoryEntry);
+    }
+
+    YoriLibLineReadCloseOrCache(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    CloseHandle(FileHandle);
+    return 0;
+}
+
+/**
+ Load history from a file if the user has requested this behavior by
+ setting YORIHISTFILE.  Configure the maximum amount of history to retain
+ if the user has requested this behavior by setting YORIHISTSIZE.
+
+ The file is opened here but read on a background thread, so the shell can
+ display its prompt without waiting for a large history file to be parsed.
+ Any later access to history waits for this to complete.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShLoadHistoryFromFile(VOID)
+{
+    YORI_STRING FilePath;
+    HANDLE FileHandle;
+    DWORD ThreadId;
+
+    if (YoriShHistoryInitialized) {
+        return TRUE;
+    }
+
+    YoriShInitHistory();
+
+    //
+    //  Check if there's a file to load saved history from.
+    //
+
+    if (!YoriShGetHistoryFileName(&FilePath)) {
+        return FALSE;
+    }
+
+    if (FilePath.LengthInChars == 0) {
+        return TRUE;
+    }
 
     FileHandle = CreateFile(FilePath.StartOfString,
                             GENERIC_READ,
@@ -299,38 +1038,26 @@ YoriShLoadHistoryFromFile(VOID)
             LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("yori: open of %y failed: %s"), &FilePath, ErrText);
             YoriLibFreeWinErrorText(ErrText);
-        }
-        YoriLibFreeStringContents(&FilePath);
-        return FALSE;
-    }
-
-    YoriLibFreeStringContents(&FilePath);
-
-    YoriLibInitEmptyString(&LineString);
-
-    while (TRUE) {
-
-        if (!YoriLibReadLineToString(&LineString, &LineContext, FileHandle)) {
-            break;
+            YoriLibFreeStringContents(&FilePath);
+            return FALSE;
         }
 
         //
-        //  If we fail to add to history, stop.  If it is added to history,
-        //  that string is now owned by the history buffer, so reinitialize
-        //  between lines.  The free below is really just a dereference.
+        //  The file doesn't exist yet, but history can be appended to it
+        //  when it is saved.
         //
 
-        if (!YoriShAddToHistory(&LineString, FALSE)) {
-            break;
-        }
+        memcpy(&YoriShHistoryFileName, &FilePath, sizeof(YORI_STRING));
+        return TRUE;
+    }
+
+    memcpy(&YoriShHistoryFileName, &FilePath, sizeof(YORI_STRING));
 
-        YoriLibFreeStringContents(&LineString);
-        YoriLibInitEmptyString(&LineString);
+    YoriShHistoryLoadThread = CreateThread(NULL, 0, YoriShLoadHistoryWorker, FileHandle, 0, &ThreadId);
+    if (YoriShHistoryLoadThread == NULL) {
+        YoriShLoadHistoryWorker(FileHandle);
     }
 
-    YoriLibLineReadCloseOrCache(LineContext);
-    YoriLibFreeStringContents(&LineString);
-    CloseHandle(FileHandle);
     return TRUE;
 }
 
@@ -338,49 +1065,60 @@ YoriShLoadHistoryFromFile(VOID)
  Write the current command history buffer to a file, if the user has requested
  this behavior by configuring the YORIHISTFILE environment variable.
 
+ The file is normally appended to with the commands entered since it was
+ loaded or last saved.  It is rewritten if entries were removed, if it is
+ a different file to the one that was loaded, or if it has grown to twice
+ the number of entries retained in history.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
 YoriShSaveHistoryToFile(VOID)
 {
-    YORI_ALLOC_SIZE_T FileNameLength;
-    YORI_STRING UserHistFileName;
     YORI_STRING FilePath;
     HANDLE FileHandle;
     PYORI_LIST_ENTRY ListEntry;
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
+    BOOLEAN Append;
+    DWORD EntriesToSkip;
 
-    FileNameLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), NULL, 0, NULL);
-    if (FileNameLength == 0) {
-        return TRUE;
+    if (!YoriShGetHistoryFileName(&FilePath)) {
+        return FALSE;
     }
 
-    if (!YoriLibAllocateString(&UserHistFileName, FileNameLength)) {
-        return FALSE;
+    if (FilePath.LengthInChars == 0) {
+        return TRUE;
     }
 
-    UserHistFileName.LengthInChars = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), UserHistFileName.StartOfString, UserHistFileName.LengthAllocated, NULL);
+    YoriShEnsureHistoryLoaded();
 
-    if (UserHistFileName.LengthInChars == 0 || UserHistFileName.LengthInChars >= UserHistFileName.LengthAllocated) {
-        YoriLibFreeStringContents(&UserHistFileName);
-        return FALSE;
-    }
+    Append = FALSE;
+    if (!YoriShHistoryRewriteRequired &&
+        YoriShHistoryFileName.LengthInChars > 0 &&
+        YoriLibCompareStringInsensitive(&FilePath, &YoriShHistoryFileName) == 0 &&
+        YoriShHistoryFileLineCount + YoriShHistoryUnsavedCount <= 2 * YoriShCommandHistoryMax) {
 
-    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, &FilePath)) {
-        YoriLibFreeStringContents(&UserHistFileName);
-        return FALSE;
+        Append = TRUE;
     }
 
-    YoriLibFreeStringContents(&UserHistFileName);
-
-    FileHandle = CreateFile(FilePath.StartOfString,
-                            GENERIC_WRITE,
-                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                            NULL,
-                            CREATE_ALWAYS,
-                            FILE_ATTRIBUTE_NORMAL,
-                            NULL);
+    if (Append) {
+        FileHandle = CreateFile(FilePath.StartOfString,
+                                FILE_APPEND_DATA,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+    } else {
+        FileHandle = CreateFile(FilePath.StartOfString,
+                                GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+    }
 
     if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
         DWORD LastError = GetLastError();
@@ -391,24 +1129,44 @@ YoriShSaveHistoryToFile(VOID)
         return FALSE;
     }
 
-    YoriLibFreeStringContents(&FilePath);
-
     //
-    //  Search the list of history.
+    //  Search the list of history.  When appending, skip the entries that
+    //  are already in the file.
     //
 
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
+        EntriesToSkip = 0;
+        if (Append) {
+            if (YoriShHistoryUnsavedCount > YoriShCommandHistoryCount) {
+                YoriShHistoryUnsavedCount = YoriShCommandHistoryCount;
+            }
+            EntriesToSkip = YoriShCommandHistoryCount - YoriShHistoryUnsavedCount;
+            YoriShHistoryFileLineCount = YoriShHistoryFileLineCount + YoriShHistoryUnsavedCount;
+        } else {
+            YoriShHistoryFileLineCount = YoriShCommandHistoryCount;
+        }
+
         ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
         while (ListEntry != NULL) {
-            HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
-
-            YoriLibOutputToDevice(FileHandle, 0, _T("%y\n"), &HistoryEntry->CmdLine);
+            if (EntriesToSkip > 0) {
+                EntriesToSkip--;
+            } else {
+                HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+                YoriLibOutputToDevice(FileHandle, 0, _T("%y\n"), &HistoryEntry->CmdLine);
+            }
 
             ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
         }
+
+        YoriShHistoryUnsavedCount = 0;
+        YoriShHistoryRewriteRequired = FALSE;
+        YoriLibFreeStringContents(&YoriShHistoryFileName);
+        memcpy(&YoriShHistoryFileName, &FilePath, sizeof(YORI_STRING));
+        YoriLibInitEmptyString(&FilePath);
         ReleaseMutex(YoriShHistoryLock);
     }
 
+    YoriLibFreeStringContents(&FilePath);
     CloseHandle(FileHandle);
 #if defined(_MSC_VER) && (_MSC_VER >= 1700)
 #pragma warning(suppress: 26165) // Analyze thinks a lock might be leaked
@@ -446,6 +1204,8 @@ YoriShGetHistoryStrings(
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
     PYORI_LIST_ENTRY StartReturningFrom = NULL;
 
+    YoriShEnsureHistoryLoaded();
+
     if (YoriShGlobal.CommandHistory.Next != NULL) {
         DWORD EntriesToSkip = 0;
         if (YoriShCommandHistoryCount > MaximumNumber && MaximumNumber > 0) {
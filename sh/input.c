@@ -322,6 +322,120 @@ YoriShPostKeyPress(
     }
 }
 
+/**
+ A buffer of characters and attributes composed before being written to the
+ console, so that each range of the input line is displayed with a single
+ character write and a single attribute write regardless of how many
+ portions of the line it covers.
+ */
+typedef struct _YORI_SH_INPUT_FRAME {
+
+    /**
+     The number of cells that Chars and Attributes can describe.
+     */
+    DWORD CellsAllocated;
+
+    /**
+     The attributes for each cell.  Chars follows this in the same
+     allocation.
+     */
+    PWORD Attributes;
+
+    /**
+     The characters for each cell.
+     */
+    LPTSTR Chars;
+} YORI_SH_INPUT_FRAME, *PYORI_SH_INPUT_FRAME;
+
+/**
+ The frame used to compose the input line for display.  This is retained
+ between key presses so that it is not reallocated on every key.
+ */
+YORI_SH_INPUT_FRAME YoriShInputFrame;
+
+/**
+ Display a range of the input line, consisting of any combination of the
+ input string, followed by the suggestion string, followed by empty cells to
+ erase previously displayed text.  The range is composed into a frame and
+ written to the console with one character write and one attribute write.
+
+ @param Buffer Pointer to the input buffer to display.
+
+ @param ScreenInfo Pointer to information about the current screen layout.
+
+ @param StartOffset The offset of the first cell to display, where the input
+        string starts at zero and the suggestion string immediately follows
+        the input string.
+
+ @param CellCount The number of cells to display.
+
+ @param Position The console coordinates of the first cell to display.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShRenderInputRange(
+    __in PYORI_SH_INPUT_BUFFER Buffer,
+    __in PCONSOLE_SCREEN_BUFFER_INFO ScreenInfo,
+    __in DWORD StartOffset,
+    __in DWORD CellCount,
+    __in COORD Position
+    )
+{
+    DWORD Index;
+    DWORD Offset;
+    DWORD CellsToAllocate;
+    DWORD NumberWritten;
+    WORD SuggestionAttributes;
+    PWORD NewAttributes;
+
+    if (CellCount > YoriShInputFrame.CellsAllocated) {
+        CellsToAllocate = 256;
+        while (CellsToAllocate < CellCount) {
+            CellsToAllocate = CellsToAllocate * 2;
+        }
+
+        if (!YoriLibIsSizeAllocatable((YORI_MAX_UNSIGNED_T)CellsToAllocate * (sizeof(WORD) + sizeof(TCHAR)))) {
+            return FALSE;
+        }
+
+        NewAttributes = YoriLibMalloc((YORI_ALLOC_SIZE_T)(CellsToAllocate * (sizeof(WORD) + sizeof(TCHAR))));
+        if (NewAttributes == NULL) {
+            return FALSE;
+        }
+
+        if (YoriShInputFrame.Attributes != NULL) {
+            YoriLibFree(YoriShInputFrame.Attributes);
+        }
+
+        YoriShInputFrame.Attributes = NewAttributes;
+        YoriShInputFrame.Chars = (LPTSTR)(NewAttributes + CellsToAllocate);
+        YoriShInputFrame.CellsAllocated = CellsToAllocate;
+    }
+
+    SuggestionAttributes = (WORD)((ScreenInfo->wAttributes & 0xF0) | FOREGROUND_INTENSITY);
+
+    for (Index = 0; Index < CellCount; Index++) {
+        Offset = StartOffset + Index;
+        if (Offset < Buffer->String.LengthInChars) {
+            YoriShInputFrame.Chars[Index] = Buffer->String.StartOfString[Offset];
+            YoriShInputFrame.Attributes[Index] = ScreenInfo->wAttributes;
+        } else if (Offset - Buffer->String.LengthInChars < Buffer->SuggestionString.LengthInChars) {
+            YoriShInputFrame.Chars[Index] = Buffer->SuggestionString.StartOfString[Offset - Buffer->String.LengthInChars];
+            YoriShInputFrame.Attributes[Index] = SuggestionAttributes;
+        } else {
+            YoriShInputFrame.Chars[Index] = ' ';
+            YoriShInputFrame.Attributes[Index] = ScreenInfo->wAttributes;
+        }
+    }
+
+    WriteConsoleOutputCharacter(Buffer->ConsoleOutputHandle, YoriShInputFrame.Chars, CellCount, Position, &NumberWritten);
+    WriteConsoleOutputAttribute(Buffer->ConsoleOutputHandle, YoriShInputFrame.Attributes, CellCount, Position, &NumberWritten);
+
+    return TRUE;
+}
+
 /**
  After a key has been pressed and processed, display the resulting buffer.
 
@@ -335,12 +449,14 @@ YoriShDisplayAfterKeyPress(
     __in PYORI_SH_INPUT_BUFFER Buffer
     )
 {
-    DWORD NumberWritten;
     DWORD NumberToWrite = 0;
     DWORD NumberToFill = 0;
+    DWORD TailOffset = 0;
+    DWORD TailCount = 0;
     COORD WritePosition;
     COORD FillPosition;
     COORD SuggestionPosition;
+    COORD TailPosition;
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     HANDLE hConsole;
 
@@ -500,31 +616,40 @@ YoriShDisplayAfterKeyPress(
         }
 
         //
-        //  Render any new text.
+        //  Determine the range following the input string that needs to be
+        //  displayed.  This is the suggestion if it changed, followed by
+        //  any additional cells to empty due to truncation.  These are
+        //  always adjacent.
         //
 
-        if (NumberToWrite) {
-            WriteConsoleOutputCharacter(hConsole, &Buffer->String.StartOfString[Buffer->DirtyBeginOffset], NumberToWrite, WritePosition, &NumberWritten);
-            FillConsoleOutputAttribute(hConsole, ScreenInfo.wAttributes, NumberToWrite, WritePosition, &NumberWritten);
-        }
-
-        if (Buffer->SuggestionDirty) {
-            WriteConsoleOutputCharacter(hConsole, Buffer->SuggestionString.StartOfString, Buffer->SuggestionString.LengthInChars, SuggestionPosition, &NumberWritten);
-            FillConsoleOutputAttribute(hConsole,
-                                       (USHORT)((ScreenInfo.wAttributes & 0xF0) | FOREGROUND_INTENSITY),
-                                       Buffer->SuggestionString.LengthInChars,
-                                       SuggestionPosition,
-                                       &NumberWritten);
+        TailPosition.X = 0;
+        TailPosition.Y = 0;
+        if (Buffer->SuggestionDirty && Buffer->SuggestionString.LengthInChars > 0) {
+            TailOffset = Buffer->String.LengthInChars;
+            TailCount = Buffer->SuggestionString.LengthInChars + NumberToFill;
+            TailPosition = SuggestionPosition;
+        } else if (NumberToFill) {
+            TailOffset = Buffer->String.LengthInChars + Buffer->SuggestionString.LengthInChars;
+            TailCount = NumberToFill;
+            TailPosition = FillPosition;
         }
 
         //
-        //  If there are additional cells to empty due to truncation, display
-        //  those now.
+        //  Render any new text.  In the common case of typing at the end of
+        //  the line, the new text is adjacent to the suggestion and any
+        //  truncated cells, so all of these are displayed together.
         //
 
-        if (NumberToFill) {
-            FillConsoleOutputCharacter(hConsole, ' ', NumberToFill, FillPosition, &NumberWritten);
-            FillConsoleOutputAttribute(hConsole, ScreenInfo.wAttributes, NumberToFill, FillPosition, &NumberWritten);
+        if (NumberToWrite) {
+            if (TailCount > 0 && Buffer->DirtyBeginOffset + NumberToWrite == TailOffset) {
+                NumberToWrite = NumberToWrite + TailCount;
+                TailCount = 0;
+            }
+            YoriShRenderInputRange(Buffer, &ScreenInfo, Buffer->DirtyBeginOffset, NumberToWrite, WritePosition);
+        }
+
+        if (TailCount) {
+            YoriShRenderInputRange(Buffer, &ScreenInfo, TailOffset, TailCount, TailPosition);
         }
 
         //
@@ -879,6 +1004,9 @@ YoriShCompletionListAllMatches(
     DWORD ColumnWidth;
     DWORD ColumnCount;
     DWORD EntryIndex;
+    DWORD MatchCount;
+    YORI_MAX_UNSIGNED_T CharsNeeded;
+    YORI_STRING Output;
     TCHAR FormatString[16];
 
     //
@@ -904,12 +1032,14 @@ YoriShCompletionListAllMatches(
     //
 
     LongestMatch = 0;
+    MatchCount = 0;
     ListEntry = YoriLibGetNextListEntry(&Buffer->TabContext.MatchList, NULL);
     while (ListEntry != NULL) {
         Match = CONTAINING_RECORD(ListEntry, YORI_SH_TAB_COMPLETE_MATCH, ListEntry);
         if (Match->Value.LengthInChars > LongestMatch) {
             LongestMatch = Match->Value.LengthInChars;
         }
+        MatchCount++;
 
         ListEntry = YoriLibGetNextListEntry(&Buffer->TabContext.MatchList, ListEntry);
     }
@@ -935,15 +1065,44 @@ YoriShCompletionListAllMatches(
     //  which firstly terminates the user input and leaves the last line to
     //  be terminated when the input processing is complete.
     //
+    //  The list is composed into a single string so it can be displayed
+    //  with one write.  If that can't be allocated, each match is displayed
+    //  individually.
+    //
+
+    YoriLibInitEmptyString(&Output);
+    CharsNeeded = (YORI_MAX_UNSIGNED_T)MatchCount * (ColumnWidth + LongestMatch + 1) + 1;
+    if (YoriLibIsSizeAllocatable(CharsNeeded)) {
+        YoriLibAllocateString(&Output, (YORI_ALLOC_SIZE_T)CharsNeeded);
+    }
 
     ListEntry = YoriLibGetNextListEntry(&Buffer->TabContext.MatchList, NULL);
     EntryIndex = 0;
     while (ListEntry != NULL) {
         if (EntryIndex % ColumnCount == 0) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            if (Output.LengthAllocated > 0) {
+                Output.StartOfString[Output.LengthInChars] = '\n';
+                Output.LengthInChars++;
+            } else {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+            }
         }
         Match = CONTAINING_RECORD(ListEntry, YORI_SH_TAB_COMPLETE_MATCH, ListEntry);
-        if (EntryIndex % ColumnCount != ColumnCount - 1) {
+        if (Output.LengthAllocated > 0) {
+            if (EntryIndex % ColumnCount != ColumnCount - 1) {
+                Output.LengthInChars = Output.LengthInChars +
+                    (YORI_ALLOC_SIZE_T)YoriLibSPrintfS(&Output.StartOfString[Output.LengthInChars],
+                                    Output.LengthAllocated - Output.LengthInChars,
+                                    FormatString,
+                                    &Match->Value);
+            } else {
+                Output.LengthInChars = Output.LengthInChars +
+                    (YORI_ALLOC_SIZE_T)YoriLibSPrintfS(&Output.StartOfString[Output.LengthInChars],
+                                    Output.LengthAllocated - Output.LengthInChars,
+                                    _T("%y"),
+                                    &Match->Value);
+            }
+        } else if (EntryIndex % ColumnCount != ColumnCount - 1) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, FormatString, &Match->Value);
         } else {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Match->Value);
@@ -953,6 +1112,11 @@ YoriShCompletionListAllMatches(
         EntryIndex++;
     }
 
+    if (Output.LengthAllocated > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Output);
+        YoriLibFreeStringContents(&Output);
+    }
+
     //
     //  Save off the currently entered string to be used for the next input
     //  operation, and reset the currently entered string.
@@ -1581,6 +1745,10 @@ YoriShHotkey(
 
     NewString.LengthInChars = YoriLibSPrintf(NewString.StartOfString, _T("%sF%i"), CtrlPressed?_T("Ctrl"):_T(""), FunctionIndex);
 
+    if (!YoriShCommandMayBeAlias(&NewString)) {
+        return FALSE;
+    }
+
     if (!YoriLibShParseCmdlineToCmdContext(&NewString, 0, &CmdContext)) {
         return FALSE;
     }
@@ -1640,6 +1808,7 @@ YoriShConfigureInputSettings(VOID)
         YoriShGlobal.MouseoverEnabled = TRUE;
         YoriShGlobal.CompletionTrailingSlash = FALSE;
         YoriShGlobal.CompletionListAll = FALSE;
+        YoriShGlobal.CommandTimingEnabled = FALSE;
         YoriLibResetSystemBackgroundColorSupport();
 
         //
@@ -1758,6 +1927,27 @@ YoriShConfigureInputSettings(VOID)
             }
         }
 
+        //
+        //  Check the environment to see if the user wants to measure the
+        //  time spent in each phase of executing commands.
+        //
+
+        EnvVarLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORICMDTIMING"), NULL, 0, NULL);
+        if (EnvVarLength > 0) {
+            if (EnvVarLength > EnvVar.LengthAllocated) {
+                YoriLibFreeStringContents(&EnvVar);
+                YoriLibAllocateString(&EnvVar, EnvVarLength);
+            }
+            if (EnvVarLength <= EnvVar.LengthAllocated) {
+                EnvVar.LengthInChars = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORICMDTIMING"), EnvVar.StartOfString, EnvVar.LengthAllocated, NULL);
+                if (YoriLibStringToNumber(&EnvVar, TRUE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                    if (llTemp == 1) {
+                        YoriShGlobal.CommandTimingEnabled = TRUE;
+                    }
+                }
+            }
+        }
+
         YoriLibFreeStringContents(&EnvVar);
 
         YoriLibConstantString(&MouseoverColorString, _T("mo"));
@@ -2043,6 +2233,7 @@ YoriShProcessEnhancedKeyDown(
     KeyCode = InputRecord->Event.KeyEvent.wVirtualKeyCode;
 
     if (KeyCode == VK_UP) {
+        YoriShEnsureHistoryLoaded();
         NewEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, Buffer->HistoryEntryToUse);
         if (NewEntry != NULL) {
             Buffer->HistoryEntryToUse = NewEntry;
@@ -3083,6 +3274,8 @@ YoriShGetExpressionFromConsole(
     BOOL ReDisplayRequired;
     BOOL TerminateInput;
     BOOL RestartStateSaved = FALSE;
+    PYORI_SH_SUGGESTION_WORKER SuggestionWorker = NULL;
+    HANDLE WaitHandles[2];
 
     ZeroMemory(&Buffer, sizeof(Buffer));
     Buffer.InsertMode = TRUE;
@@ -3180,6 +3373,11 @@ YoriShGetExpressionFromConsole(
             }
 
             if (TerminateInput) {
+                if (SuggestionWorker != NULL) {
+                    YoriShCancelSuggestionWorker(SuggestionWorker);
+                    YoriShFreeSuggestionWorker(SuggestionWorker);
+                    SuggestionWorker = NULL;
+                }
                 YoriShTerminateInput(&Buffer);
                 ReadConsoleInput(InputHandle, InputRecords, CurrentRecordIndex + 1, &ActuallyRead);
                 if (Buffer.String.LengthInChars > 0) {
@@ -3204,6 +3402,18 @@ YoriShGetExpressionFromConsole(
             }
         }
 
+        //
+        //  If a suggestion is being calculated in the background and the
+        //  input has changed since it started, its result is no longer
+        //  useful.
+        //
+
+        if (SuggestionWorker != NULL &&
+            !YoriShIsSuggestionWorkerCurrent(SuggestionWorker, &Buffer)) {
+
+            YoriShCancelSuggestionWorker(SuggestionWorker);
+        }
+
         //
         //  Wait to see if any further events arrive.  If we haven't saved
         //  state and the user hasn't done anything for 30 seconds, save
@@ -3229,6 +3439,40 @@ YoriShGetExpressionFromConsole(
                 if (err == WAIT_TIMEOUT) {
                     YoriLibPeriodicScrollForSelection(&Buffer.Selection);
                 }
+            } else if (SuggestionWorker != NULL) {
+
+                //
+                //  Wait for either input or the background suggestion to
+                //  complete.  When the suggestion completes, use it if the
+                //  input is unchanged, then continue waiting.  If the
+                //  suggestion requires the input thread, calculate it here.
+                //
+
+                WaitHandles[0] = InputHandle;
+                WaitHandles[1] = SuggestionWorker->Thread;
+                err = WaitForMultipleObjects(2, WaitHandles, FALSE, INFINITE);
+                if (err == WAIT_OBJECT_0) {
+                    break;
+                }
+                if (err == WAIT_OBJECT_0 + 1) {
+                    if (YoriShIsSuggestionWorkerCurrent(SuggestionWorker, &Buffer)) {
+                        if (SuggestionWorker->Buffer.TabContext.RequiresInputThread) {
+                            YoriShConfigureConsoleForTabComplete(&Buffer);
+                            YoriShCompleteSuggestion(&Buffer);
+                            YoriShConfigureConsoleForInput(&Buffer);
+                        } else {
+                            YoriShCompleteSuggestionWorker(SuggestionWorker, &Buffer);
+                        }
+                        Buffer.SuggestionPopulated = TRUE;
+                        if (Buffer.SuggestionString.LengthInChars > 0) {
+                            Buffer.SuggestionDirty = TRUE;
+                            YoriShDisplayAfterKeyPress(&Buffer);
+                        }
+                    }
+                    YoriShFreeSuggestionWorker(SuggestionWorker);
+                    SuggestionWorker = NULL;
+                    err = WAIT_TIMEOUT;
+                }
             } else if (!Buffer.SuggestionPopulated) {
                 err = WaitForSingleObject(InputHandle, YoriShGlobal.DelayBeforeSuggesting);
                 if (err == WAIT_OBJECT_0) {
@@ -3237,13 +3481,23 @@ YoriShGetExpressionFromConsole(
                 if (err == WAIT_TIMEOUT) {
                     ASSERT(!Buffer.SuggestionPopulated);
                     ASSERT(Buffer.SuggestionString.LengthInChars == 0);
-                    YoriShConfigureConsoleForTabComplete(&Buffer);
-                    YoriShCompleteSuggestion(&Buffer);
-                    YoriShConfigureConsoleForInput(&Buffer);
-                    Buffer.SuggestionPopulated = TRUE;
-                    if (Buffer.SuggestionString.LengthInChars > 0) {
-                        Buffer.SuggestionDirty = TRUE;
-                        YoriShDisplayAfterKeyPress(&Buffer);
+
+                    //
+                    //  Calculate the suggestion on a background thread so
+                    //  that slow enumeration doesn't prevent typing.  If
+                    //  that can't be started, calculate it here.
+                    //
+
+                    SuggestionWorker = YoriShStartSuggestionWorker(&Buffer);
+                    if (SuggestionWorker == NULL) {
+                        YoriShConfigureConsoleForTabComplete(&Buffer);
+                        YoriShCompleteSuggestion(&Buffer);
+                        YoriShConfigureConsoleForInput(&Buffer);
+                        Buffer.SuggestionPopulated = TRUE;
+                        if (Buffer.SuggestionString.LengthInChars > 0) {
+                            Buffer.SuggestionDirty = TRUE;
+                            YoriShDisplayAfterKeyPress(&Buffer);
+                        }
                     }
                 }
             } else if (!RestartStateSaved) {
@@ -3277,6 +3531,11 @@ YoriShGetExpressionFromConsole(
 
     YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Error reading from console %i handle %08x\n"), err, InputHandle);
 
+    if (SuggestionWorker != NULL) {
+        YoriShCancelSuggestionWorker(SuggestionWorker);
+        YoriShFreeSuggestionWorker(SuggestionWorker);
+    }
+
     YoriShTerminateInput(&Buffer);
     YoriLibFreeStringContents(&Buffer.String);
     return FALSE;
@@ -3336,6 +3595,13 @@ YoriShCleanupInputContext(VOID)
     if (YoriShGetExpressionLineContext != NULL) {
         YoriLibLineReadCloseOrCache(YoriShGetExpressionLineContext);
     }
+
+    if (YoriShInputFrame.Attributes != NULL) {
+        YoriLibFree(YoriShInputFrame.Attributes);
+        YoriShInputFrame.Attributes = NULL;
+        YoriShInputFrame.Chars = NULL;
+        YoriShInputFrame.CellsAllocated = 0;
+    }
 }
 
 
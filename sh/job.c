@@ -396,6 +396,143 @@ YoriShJobWait(
     YoriShCleanupWaitContext(&WaitContext);
 }
 
+/**
+ The number of processes that can be waited on in a single call, leaving one
+ slot for the cancel event.
+ */
+#define YORI_SH_JOB_WAIT_BATCH (MAXIMUM_WAIT_OBJECTS - 1)
+
+/**
+ The interval to wait on each batch of processes, in milliseconds, when there
+ are more processes than can be waited on in a single call.
+ */
+#define YORI_SH_JOB_WAIT_BATCH_INTERVAL (50)
+
+/**
+ Waits until any one of a set of jobs is no longer active, or until the user
+ cancels the wait.  Unlike @ref YoriShJobWait , cancelling the wait does not
+ terminate any job.
+
+ @param JobCount The number of jobs in the JobIds array.
+
+ @param JobIds An array of job IDs to wait for.
+
+ @param CompletedJobId On successful completion, updated to contain the ID
+        of the job that completed.  If several jobs have completed, one of
+        them is returned, so a caller removing each completed job from the
+        array and calling again observes every job.
+
+ @return TRUE to indicate a job completed, FALSE if the wait was cancelled,
+         failed, or none of the jobs exist.
+ */
+__success(return)
+BOOL
+YoriShJobWaitForAny(
+    __in DWORD JobCount,
+    __in_ecount(JobCount) PDWORD JobIds,
+    __out PDWORD CompletedJobId
+    )
+{
+    HANDLE WaitOn[MAXIMUM_WAIT_OBJECTS];
+    DWORD WaitJobIndex[MAXIMUM_WAIT_OBJECTS];
+    PHANDLE ProcessHandles;
+    PYORI_JOB ThisJob;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD Index;
+    DWORD ProcessCount;
+    DWORD WaitCount;
+    DWORD NextIndex;
+    DWORD Timeout;
+    DWORD Result;
+    BOOL Found;
+
+    if (YoriShGlobal.PreviousJobId == 0 || JobCount == 0) {
+        return FALSE;
+    }
+
+    ProcessHandles = YoriLibMalloc(JobCount * sizeof(HANDLE));
+    if (ProcessHandles == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Find the process for each job.  Jobs that don't exist are skipped.
+    //
+
+    ProcessCount = 0;
+    for (Index = 0; Index < JobCount; Index++) {
+        ProcessHandles[Index] = NULL;
+        ListEntry = YoriLibGetNextListEntry(&JobList, NULL);
+        while (ListEntry != NULL) {
+            ThisJob = CONTAINING_RECORD(ListEntry, YORI_JOB, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&JobList, ListEntry);
+            if (ThisJob->JobId == JobIds[Index]) {
+                ProcessHandles[Index] = ThisJob->hProcess;
+                if (ThisJob->hProcess != NULL) {
+                    ProcessCount++;
+                }
+                break;
+            }
+        }
+    }
+
+    if (ProcessCount == 0) {
+        YoriLibFree(ProcessHandles);
+        return FALSE;
+    }
+
+    //
+    //  If every process fits in a single wait, block until one completes.
+    //  If not, wait on each batch in turn for a short interval.
+    //
+
+    Timeout = INFINITE;
+    if (ProcessCount > YORI_SH_JOB_WAIT_BATCH) {
+        Timeout = YORI_SH_JOB_WAIT_BATCH_INTERVAL;
+    }
+
+    YoriLibCancelEnable(FALSE);
+    WaitOn[0] = YoriLibCancelGetEvent();
+
+    Found = FALSE;
+    NextIndex = 0;
+    while (TRUE) {
+        WaitCount = 1;
+        for (Index = NextIndex; Index < JobCount && WaitCount <= YORI_SH_JOB_WAIT_BATCH; Index++) {
+            if (ProcessHandles[Index] != NULL) {
+                WaitOn[WaitCount] = ProcessHandles[Index];
+                WaitJobIndex[WaitCount] = Index;
+                WaitCount++;
+            }
+        }
+
+        if (Index >= JobCount) {
+            NextIndex = 0;
+        } else {
+            NextIndex = Index;
+        }
+
+        Result = WaitForMultipleObjects(WaitCount, WaitOn, FALSE, Timeout);
+        if (Result == WAIT_OBJECT_0) {
+            break;
+        }
+
+        if (Result > WAIT_OBJECT_0 && Result < WAIT_OBJECT_0 + WaitCount) {
+            *CompletedJobId = JobIds[WaitJobIndex[Result - WAIT_OBJECT_0]];
+            Found = TRUE;
+            break;
+        }
+
+        if (Result != WAIT_TIMEOUT) {
+            break;
+        }
+    }
+
+    YoriLibCancelIgnore();
+    YoriLibFree(ProcessHandles);
+    return Found;
+}
+
 /**
  Sets the priority associated with a job.
 
@@ -39,12 +39,90 @@ CHAR strHelpText[] =
         "\n"
         "Start a Yori shell instance.\n"
         "\n"
-        "YORI [-license] [-c <cmd>] [-k <cmd>]\n"
+        "YORI [-license] [-nouser] [-profile-startup] [-c <cmd>] [-k <cmd>]\n"
         "\n"
-        "   -license       Display license text\n"
-        "   -c <cmd>       Execute command and terminate the shell\n"
-        "   -k <cmd>       Execute command and continue as an interactive shell\n"
-        "   -nouser        Do not execute per-user AutoInit scripts\n";
+        "   -license          Display license text\n"
+        "   -c <cmd>          Execute command and terminate the shell\n"
+        "   -k <cmd>          Execute command and continue as an interactive shell\n"
+        "   -nouser           Do not execute per-user AutoInit scripts\n"
+        "   -profile-startup  Display the time spent in each stage of startup\n"
+        "\n"
+        "Scripts in YoriInit.d\\Deferred are executed after the first prompt is\n"
+        "displayed, when the first command is entered.\n"
+        "\n"
+        "If this program is copied or linked to the name of a builtin command, such\n"
+        "as sdir.exe, it executes that command with its arguments and exits.\n";
+
+/**
+ A single measured stage of shell startup.
+ */
+typedef struct _YORI_SH_STARTUP_PROFILE_ENTRY {
+
+    /**
+     The link within the list of measured stages.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A constant string describing the kind of stage, such as an init script
+     or an alias block.
+     */
+    LPCTSTR Category;
+
+    /**
+     The name of the stage.  This is allocated as part of the entry.
+     */
+    YORI_STRING Name;
+
+    /**
+     The time spent in the stage, in microseconds.
+     */
+    DWORDLONG Duration;
+} YORI_SH_STARTUP_PROFILE_ENTRY, *PYORI_SH_STARTUP_PROFILE_ENTRY;
+
+/**
+ State describing the timing of shell startup.  Timings are always collected
+ since the initialization phase runs before arguments are parsed, and
+ collecting them is inexpensive.  They are only displayed if requested.
+ */
+typedef struct _YORI_SH_STARTUP_PROFILE {
+
+    /**
+     A list of measured stages, in the order they completed.
+     */
+    YORI_LIST_ENTRY Entries;
+
+    /**
+     The frequency of the performance counter.
+     */
+    LARGE_INTEGER Frequency;
+
+    /**
+     The performance counter value when the shell began initializing.
+     */
+    LARGE_INTEGER StartTime;
+
+    /**
+     TRUE if the user requested the timings to be displayed.
+     */
+    BOOLEAN Report;
+
+    /**
+     TRUE if deferred init scripts have not yet been executed.  These are
+     executed after the first prompt is displayed.
+     */
+    BOOLEAN DeferredInitPending;
+
+    /**
+     TRUE if the deferred init scripts should not include per-user scripts.
+     */
+    BOOLEAN DeferredIgnoreUserScripts;
+} YORI_SH_STARTUP_PROFILE, *PYORI_SH_STARTUP_PROFILE;
+
+/**
+ Timing information about shell startup.
+ */
+YORI_SH_STARTUP_PROFILE YoriShStartupProfile;
 
 /**
  Display usage text to the user.
@@ -60,6 +138,149 @@ YoriShHelp(VOID)
     return TRUE;
 }
 
+/**
+ Initialize startup timing.  This is called before any other initialization
+ so the startup profile can be measured from this point.
+ */
+VOID
+YoriShStartupProfileInitialize(VOID)
+{
+    YoriLibInitializeListHead(&YoriShStartupProfile.Entries);
+    if (!QueryPerformanceFrequency(&YoriShStartupProfile.Frequency)) {
+        YoriShStartupProfile.Frequency.QuadPart = 0;
+    }
+    QueryPerformanceCounter(&YoriShStartupProfile.StartTime);
+}
+
+/**
+ Return the number of microseconds since a specified performance counter
+ value.
+
+ @param StartTime Pointer to the performance counter value when the
+        measurement began.
+
+ @return The number of microseconds elapsed.
+ */
+DWORDLONG
+YoriShStartupProfileElapsed(
+    __in PLARGE_INTEGER StartTime
+    )
+{
+    LARGE_INTEGER EndTime;
+    DWORDLONG Elapsed;
+
+    if (YoriShStartupProfile.Frequency.QuadPart == 0) {
+        return 0;
+    }
+
+    QueryPerformanceCounter(&EndTime);
+    Elapsed = (DWORDLONG)(EndTime.QuadPart - StartTime->QuadPart);
+    return YoriLibDivide32(Elapsed * 1000000, YoriShStartupProfile.Frequency.LowPart);
+}
+
+/**
+ Record the completion of a stage of shell startup.
+
+ @param Category A constant string describing the kind of stage.
+
+ @param Name Pointer to the name of the stage.  This is copied into the
+        entry.
+
+ @param StartTime Pointer to the performance counter value when the stage
+        began.
+ */
+VOID
+YoriShStartupProfileRecord(
+    __in LPCTSTR Category,
+    __in PCYORI_STRING Name,
+    __in PLARGE_INTEGER StartTime
+    )
+{
+    PYORI_SH_STARTUP_PROFILE_ENTRY Entry;
+    DWORDLONG Duration;
+
+    Duration = YoriShStartupProfileElapsed(StartTime);
+
+    Entry = YoriLibReferencedMalloc(sizeof(YORI_SH_STARTUP_PROFILE_ENTRY) + (Name->LengthInChars + 1) * sizeof(TCHAR));
+    if (Entry == NULL) {
+        return;
+    }
+
+    Entry->Category = Category;
+    Entry->Duration = Duration;
+    YoriLibInitEmptyString(&Entry->Name);
+    Entry->Name.StartOfString = (LPTSTR)(Entry + 1);
+    Entry->Name.LengthAllocated = Name->LengthInChars + 1;
+    Entry->Name.LengthInChars = Name->LengthInChars;
+    memcpy(Entry->Name.StartOfString, Name->StartOfString, Name->LengthInChars * sizeof(TCHAR));
+    Entry->Name.StartOfString[Entry->Name.LengthInChars] = '\0';
+
+    YoriLibAppendList(&YoriShStartupProfile.Entries, &Entry->ListEntry);
+}
+
+/**
+ Record the completion of a stage of shell startup whose name is a constant.
+
+ @param Category A constant string describing the kind of stage.
+
+ @param Name The name of the stage.
+
+ @param StartTime Pointer to the performance counter value when the stage
+        began.  On completion this is updated to the current time, so that
+        consecutive stages can be measured without querying the counter
+        again.
+ */
+VOID
+YoriShStartupProfileRecordPhase(
+    __in LPCTSTR Category,
+    __in LPCTSTR Name,
+    __inout PLARGE_INTEGER StartTime
+    )
+{
+    YORI_STRING YsName;
+
+    YoriLibConstantString(&YsName, Name);
+    YoriShStartupProfileRecord(Category, &YsName, StartTime);
+    QueryPerformanceCounter(StartTime);
+}
+
+/**
+ Display the collected startup timings if the user requested them, and free
+ them.  Once this has been called no further timings are collected.
+ */
+VOID
+YoriShStartupProfileReport(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_STARTUP_PROFILE_ENTRY Entry;
+
+    if (YoriShStartupProfile.Entries.Next == NULL) {
+        return;
+    }
+
+    if (YoriShStartupProfile.Report) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Startup profile (microseconds):\n"));
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShStartupProfile.Entries, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, YORI_SH_STARTUP_PROFILE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShStartupProfile.Entries, ListEntry);
+        if (YoriShStartupProfile.Report) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%12lli  %-8s %y\n"), Entry->Duration, Entry->Category, &Entry->Name);
+        }
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibDereference(Entry);
+    }
+
+    if (YoriShStartupProfile.Report) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%12lli  total\n"), YoriShStartupProfileElapsed(&YoriShStartupProfile.StartTime));
+    }
+
+    YoriShStartupProfile.Entries.Next = NULL;
+    YoriShStartupProfile.Entries.Prev = NULL;
+}
+
 /**
  A callback function for every file found in the YoriInit.d directory.
 
@@ -86,6 +307,7 @@ YoriShExecuteYoriInit(
     LPTSTR szExt;
     YORI_STRING UnescapedPath;
     PYORI_STRING NameToUse;
+    LARGE_INTEGER StartTime;
 
     UNREFERENCED_PARAMETER(FileInfo);
     UNREFERENCED_PARAMETER(Depth);
@@ -112,7 +334,11 @@ YoriShExecuteYoriInit(
     YoriLibInitEmptyString(&InitNameWithQuotes);
     YoriLibYPrintf(&InitNameWithQuotes, _T("\"%y\""), NameToUse);
     if (InitNameWithQuotes.LengthInChars > 0) {
+        QueryPerformanceCounter(&StartTime);
         YoriShExecuteExpression(&InitNameWithQuotes);
+        if (YoriShStartupProfile.Entries.Next != NULL) {
+            YoriShStartupProfileRecord(_T("script"), Filename, &StartTime);
+        }
     }
     YoriLibFreeStringContents(&InitNameWithQuotes);
     YoriLibFreeStringContents(&UnescapedPath);
@@ -129,7 +355,10 @@ YoriShInit(VOID)
     TCHAR Letter;
     TCHAR AliasName[3];
     TCHAR AliasValue[16];
-    YORI_SH_BUILTIN_NAME_MAPPING CONST *BuiltinNameMapping = YoriShBuiltins;
+    LARGE_INTEGER StartTime;
+
+    YoriShStartupProfileInitialize();
+    StartTime.QuadPart = YoriShStartupProfile.StartTime.QuadPart;
 
     //
     //  Attempt to enable backup privilege so an administrator can access more
@@ -139,19 +368,29 @@ YoriShInit(VOID)
     YoriLibEnableBackupPrivilege();
 
     //
-    //  Translate the constant builtin function mapping into dynamic function
-    //  mappings.
+    //  The shell searches the path for every external command, so cache the
+    //  contents of path directories between searches.  Group membership is
+    //  checked by the prompt and builtins, and resolving group names can
+    //  require contacting a domain controller, so cache those too.
+    //  Completion in directories on network shares is cached so that
+    //  repeated tab presses and suggestions don't each enumerate the share.
     //
 
-    while (BuiltinNameMapping->CommandName != NULL) {
-        YORI_STRING YsCommandName;
+    YoriLibPathEnableLocateCache();
+    YoriLibEnableGroupCache();
+    YoriShEnableCompletionCache();
+    YoriShStartupProfileRecordPhase(_T("phase"), _T("privileges and caches"), &StartTime);
 
-        YoriLibConstantString(&YsCommandName, BuiltinNameMapping->CommandName);
-        if (!YoriLibShBuiltinRegister(&YsCommandName, BuiltinNameMapping->BuiltinFn)) {
-            return FALSE;
-        }
-        BuiltinNameMapping++;
+    //
+    //  Register the constant builtin function mapping.  This table is
+    //  sorted at build time and searched directly, so no per-builtin
+    //  allocation or hashing is needed here.
+    //
+
+    if (!YoriLibShBuiltinRegisterStaticTable(YoriShBuiltins)) {
+        return FALSE;
     }
+    YoriShStartupProfileRecordPhase(_T("builtin"), _T("register builtin commands"), &StartTime);
 
     //
     //  If we don't have a prompt defined, set a default.  If outputting to
@@ -271,13 +510,22 @@ YoriShInit(VOID)
         YoriLibAddEnvironmentComponent(_T("PATHEXT"), &NewExt, TRUE);
     }
 
+    //
+    //  The variables above were set directly, so discard anything that
+    //  was cached while the default environment was being constructed.
+    //
+
+    YoriShGlobal.EnvironmentGeneration++;
+
     YoriLibCancelEnable(TRUE);
+    YoriShStartupProfileRecordPhase(_T("phase"), _T("default environment"), &StartTime);
 
     //
     //  Register any builtin aliases, including drive letter colon commands.
     //
 
     YoriShRegisterDefaultAliases();
+    YoriShStartupProfileRecordPhase(_T("alias"), _T("default aliases"), &StartTime);
 
     AliasName[1] = ':';
     AliasName[2] = '\0';
@@ -290,13 +538,16 @@ YoriShInit(VOID)
 
         YoriShAddAliasLiteral(AliasName, AliasValue, TRUE);
     }
+    YoriShStartupProfileRecordPhase(_T("alias"), _T("drive letter aliases"), &StartTime);
 
     //
     //  Load aliases registered with conhost.
     //
 
     YoriShLoadSystemAliases(TRUE);
+    YoriShStartupProfileRecordPhase(_T("alias"), _T("system aliases (yori)"), &StartTime);
     YoriShLoadSystemAliases(FALSE);
+    YoriShStartupProfileRecordPhase(_T("alias"), _T("system aliases (cmd)"), &StartTime);
 
     return TRUE;
 }
@@ -318,7 +569,9 @@ YoriShExecuteInitScripts(
     YORI_STRING RelativeYoriInitName;
 
     //
-    //  Execute all system YoriInit scripts.
+    //  Execute all system YoriInit scripts.  Note that the enumeration only
+    //  returns files, so scripts in YoriInit.d\Deferred are not executed
+    //  here.
     //
 
     YoriLibConstantString(&RelativeYoriInitName, _T("~AppDir\\YoriInit.d\\*"));
@@ -346,6 +599,39 @@ YoriShExecuteInitScripts(
     return TRUE;
 }
 
+/**
+ Execute any system or user init scripts whose execution has been deferred
+ until after the first prompt is displayed.  These are scripts that are not
+ needed to display the prompt, so deferring them allows the shell to become
+ responsive sooner.
+
+ @param IgnoreUserScripts If TRUE, system scripts are executed but user
+        scripts are not.
+
+ @return TRUE to indicate success.
+ */
+BOOL
+YoriShExecuteDeferredInitScripts(
+    __in BOOLEAN IgnoreUserScripts
+    )
+{
+    YORI_STRING RelativeYoriInitName;
+
+    YoriShStartupProfile.DeferredInitPending = FALSE;
+
+    YoriLibConstantString(&RelativeYoriInitName, _T("~AppDir\\YoriInit.d\\Deferred\\*"));
+    YoriLibForEachFile(&RelativeYoriInitName, YORILIB_FILEENUM_RETURN_FILES, 0, YoriShExecuteYoriInit, NULL, NULL);
+
+    if (!IgnoreUserScripts) {
+        YoriLibConstantString(&RelativeYoriInitName, _T("~\\YoriInit.d\\Deferred\\*"));
+        YoriLibForEachFile(&RelativeYoriInitName, YORILIB_FILEENUM_RETURN_FILES, 0, YoriShExecuteYoriInit, NULL, NULL);
+    }
+
+    YoriShGlobal.EnvironmentGeneration++;
+
+    return TRUE;
+}
+
 /**
  Parse the Yori command line and perform any requested actions.
 
@@ -413,6 +699,9 @@ YoriShParseArgs(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("nouser")) == 0) {
                 IgnoreUserScripts = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("profile-startup")) == 0) {
+                YoriShStartupProfile.Report = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("restart")) == 0) {
                 if (ArgC > i + 1) {
                     YoriShLoadSavedRestartState(&ArgV[i + 1]);
@@ -450,8 +739,28 @@ YoriShParseArgs(
         }
     }
 
+    YoriShGlobal.EnvironmentGeneration++;
+
     if (ExecuteStartupScripts) {
         YoriShExecuteInitScripts(IgnoreUserScripts);
+
+        //
+        //  If a command is being executed, it may depend on anything
+        //  deferred scripts would do, so execute them now.  If the shell
+        //  is going to display a prompt, execute them after it is
+        //  displayed.
+        //
+
+        if (StartArgToExec > 0 || *TerminateApp) {
+            YoriShExecuteDeferredInitScripts(IgnoreUserScripts);
+        } else {
+            YoriShStartupProfile.DeferredInitPending = TRUE;
+            YoriShStartupProfile.DeferredIgnoreUserScripts = IgnoreUserScripts;
+        }
+    }
+
+    if (!YoriShStartupProfile.DeferredInitPending) {
+        YoriShStartupProfileReport();
     }
 
     if (StartArgToExec > 0) {
@@ -472,6 +781,91 @@ YoriShParseArgs(
     return TRUE;
 }
 
+/**
+ If the program was invoked under the name of a builtin command, for example
+ because oneyori.exe was copied or linked to sdir.exe, execute that command
+ with the supplied arguments and indicate that the shell should exit.  This
+ allows a single image to provide every tool without a separate process for
+ the shell.  Startup scripts are not executed, so the command behaves as the
+ standalone tool would.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV The argument array.
+
+ @param ExitCode On successful completion, set to the exit code of the
+        command.
+
+ @return TRUE if the program was invoked as a builtin command and that
+         command has been executed, FALSE if the program should run as a
+         shell.
+ */
+__success(return)
+BOOLEAN
+YoriShExecuteInvokedBuiltin(
+    __in YORI_ALLOC_SIZE_T ArgC,
+    __in YORI_STRING ArgV[],
+    __out PDWORD ExitCode
+    )
+{
+    YORI_STRING SavedArg0;
+    YORI_STRING CmdToExec;
+    YORI_ALLOC_SIZE_T Index;
+
+    if (ArgC < 1) {
+        return FALSE;
+    }
+
+    //
+    //  Find the file name component of the program name, without any
+    //  extension.
+    //
+
+    memcpy(&SavedArg0, &ArgV[0], sizeof(YORI_STRING));
+    for (Index = ArgV[0].LengthInChars; Index > 0; Index--) {
+        if (YoriLibIsSep(ArgV[0].StartOfString[Index - 1])) {
+            ArgV[0].StartOfString = &ArgV[0].StartOfString[Index];
+            ArgV[0].LengthInChars = ArgV[0].LengthInChars - Index;
+            break;
+        }
+    }
+
+    for (Index = ArgV[0].LengthInChars; Index > 0; Index--) {
+        if (ArgV[0].StartOfString[Index - 1] == '.') {
+            ArgV[0].LengthInChars = Index - 1;
+            break;
+        }
+    }
+
+    if (ArgV[0].LengthInChars == 0 ||
+        YoriLibShLookupBuiltinByName(&ArgV[0]) == NULL) {
+
+        memcpy(&ArgV[0], &SavedArg0, sizeof(YORI_STRING));
+        return FALSE;
+    }
+
+    if (!YoriLibBuildCmdlineFromArgcArgv(ArgC, ArgV, TRUE, TRUE, &CmdToExec)) {
+        memcpy(&ArgV[0], &SavedArg0, sizeof(YORI_STRING));
+        *ExitCode = EXIT_FAILURE;
+        return TRUE;
+    }
+    memcpy(&ArgV[0], &SavedArg0, sizeof(YORI_STRING));
+
+    if (GetEnvironmentVariable(_T("YORIINTERACTIVE"), NULL, 0) == 0) {
+        SetEnvironmentVariable(_T("YORIINTERACTIVE"), _T("0"));
+    }
+    YoriShGlobal.EnvironmentGeneration++;
+
+    if (YoriShExecuteExpression(&CmdToExec)) {
+        *ExitCode = YoriShGlobal.ErrorLevel;
+    } else {
+        *ExitCode = EXIT_FAILURE;
+    }
+    YoriLibFreeStringContents(&CmdToExec);
+
+    return TRUE;
+}
+
 #if YORI_BUILD_ID
 /**
  The number of days before suggesting the user upgrade on a testing build.
@@ -770,7 +1164,12 @@ ymain (
     BOOLEAN TerminateApp = FALSE;
 
     YoriShInit();
-    YoriShParseArgs(ArgC, ArgV, &TerminateApp, &YoriShGlobal.ExitProcessExitCode);
+    YoriLibEtwRegister();
+    if (YoriShExecuteInvokedBuiltin(ArgC, ArgV, &YoriShGlobal.ExitProcessExitCode)) {
+        TerminateApp = TRUE;
+    } else {
+        YoriShParseArgs(ArgC, ArgV, &TerminateApp, &YoriShGlobal.ExitProcessExitCode);
+    }
 
     if (!TerminateApp) {
 
@@ -797,7 +1196,9 @@ ymain (
             //
 
             YoriShPreCommand(FALSE);
+            YoriLibEtwWriteEvent("Prompt", YORI_ETW_OPCODE_START, NULL, 0);
             YoriShDisplayPrompt();
+            YoriLibEtwWriteEvent("Prompt", YORI_ETW_OPCODE_STOP, NULL, 0);
             YoriShPreCommand(FALSE);
 
             if (!YoriShGetExpression(&CurrentExpression)) {
@@ -807,8 +1208,20 @@ ymain (
                 break;
             }
             YoriShPreCommand(TRUE);
+
+            //
+            //  Now that the user has seen a prompt and entered a command,
+            //  execute any init scripts that were deferred so they can
+            //  apply to the command.
+            //
+
+            if (YoriShStartupProfile.DeferredInitPending) {
+                YoriShExecuteDeferredInitScripts(YoriShStartupProfile.DeferredIgnoreUserScripts);
+                YoriShStartupProfileReport();
+            }
             YoriShExecPreCommandString();
             if (CurrentExpression.LengthInChars > 0) {
+                YoriShTimingBeginCommand();
                 YoriShExecuteExpression(&CurrentExpression);
             }
             YoriLibFreeStringContents(&CurrentExpression);
@@ -819,13 +1232,19 @@ ymain (
 
     YoriLibShScanProcessBuffersForTeardown(TRUE);
     YoriShScanJobsReportCompletion(TRUE);
+    YoriShStartupProfileReport();
     YoriShClearAllHistory();
     YoriShClearAllAliases();
+    YoriShCleanupPromptCache();
+    YoriShCleanupEnvironmentCache();
     YoriLibShBuiltinUnregisterAll();
     YoriShDiscardSavedRestartState(NULL);
     YoriShCleanupInputContext();
     YoriLibLineReadCleanupCache();
     YoriLibCleanupCurrentDirectory();
+    YoriLibPathCleanupLocateCache();
+    YoriLibCleanupGroupCache();
+    YoriShCleanupCompletionCache();
     YoriLibFreeStringContents(&YoriShGlobal.PreCmdVariable);
     YoriLibFreeStringContents(&YoriShGlobal.PostCmdVariable);
     YoriLibFreeStringContents(&YoriShGlobal.PromptVariable);
@@ -835,6 +1254,7 @@ ymain (
     YoriLibFreeStringContents(&YoriShGlobal.CurrentDirectoryBuffers[0]);
     YoriLibFreeStringContents(&YoriShGlobal.CurrentDirectoryBuffers[1]);
     YoriLibEmptyProcessClipboard();
+    YoriLibEtwUnregister();
 
     return YoriShGlobal.ExitProcessExitCode;
 }
@@ -50,10 +50,16 @@ YoriShResolveCommandToExecutable(
 {
     YORI_STRING FoundExecutable;
     YORI_STRING ExpandedCmd;
+    LARGE_INTEGER PhaseStartTime;
 
     YoriLibInitEmptyString(&FoundExecutable);
+    YoriShTimingStart(&PhaseStartTime);
 
+    YoriLibEtwWriteEvent("ExpandAlias", YORI_ETW_OPCODE_START, &CmdContext->ArgV[0], 0);
     YoriShExpandAlias(CmdContext);
+    YoriLibEtwWriteEvent("ExpandAlias", YORI_ETW_OPCODE_STOP, &CmdContext->ArgV[0], 0);
+    YoriShTimingRecord(YoriShTimingPhaseExpand, &PhaseStartTime);
+    YoriLibEtwWriteEvent("ResolvePath", YORI_ETW_OPCODE_START, &CmdContext->ArgV[0], 0);
 
     if (!YoriLibExpandHomeDirectories(&CmdContext->ArgV[0], &ExpandedCmd)) {
         YoriLibCloneString(&ExpandedCmd, &CmdContext->ArgV[0]);
@@ -74,6 +80,8 @@ YoriShResolveCommandToExecutable(
     }
 
     YoriLibFreeStringContents(&ExpandedCmd);
+    YoriLibEtwWriteEvent("ResolvePath", YORI_ETW_OPCODE_STOP, &CmdContext->ArgV[0], *ExecutableFound);
+    YoriShTimingRecord(YoriShTimingPhaseLookup, &PhaseStartTime);
 
     return TRUE;
 }
@@ -97,6 +105,7 @@ YoriShExpandEnvironmentInCmdContext(
     YORI_ALLOC_SIZE_T Index;
     YORI_ALLOC_SIZE_T ArgOffset;
 
+    YoriLibEtwWriteEvent("ExpandEnvironment", YORI_ETW_OPCODE_START, NULL, CmdContext->ArgC);
     for (Index = 0; Index < CmdContext->ArgC; Index++) {
         YORI_STRING EnvExpandedString;
         ASSERT(YoriLibIsStringNullTerminated(&CmdContext->ArgV[Index]));
@@ -117,6 +126,7 @@ YoriShExpandEnvironmentInCmdContext(
             }
         }
     }
+    YoriLibEtwWriteEvent("ExpandEnvironment", YORI_ETW_OPCODE_STOP, NULL, CmdContext->ArgC);
 
     return TRUE;
 }
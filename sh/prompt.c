@@ -38,6 +38,90 @@ BOOL YoriShPromptAdminDetermined;
  */
 BOOL YoriShPromptAdminPresent;
 
+/**
+ The maximum number of backquote results that are retained for prompt and
+ title display.
+ */
+#define YORI_SH_PROMPT_CACHE_MAX_SEGMENTS (16)
+
+/**
+ The result of a backquote expression that was evaluated as part of
+ displaying the prompt or title.
+ */
+typedef struct _YORI_SH_PROMPT_SEGMENT {
+
+    /**
+     The link within the list of cached segments.  The most recently used
+     segment is at the head of the list.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The backquote expression that was evaluated.
+     */
+    YORI_STRING Expression;
+
+    /**
+     The output of the expression.
+     */
+    YORI_STRING Output;
+
+    /**
+     The current directory when the expression was evaluated.  If the
+     current directory changes, the segment must be evaluated again.
+     */
+    YORI_STRING CurrentDirectory;
+
+    /**
+     The environment generation when the expression was evaluated.  If the
+     environment changes, the segment must be evaluated again.
+     */
+    DWORD EnvironmentGeneration;
+
+    /**
+     The system time when the expression was evaluated.
+     */
+    LONGLONG EvaluatedTime;
+} YORI_SH_PROMPT_SEGMENT, *PYORI_SH_PROMPT_SEGMENT;
+
+/**
+ State for caching the results of backquote expressions in the prompt and
+ title.
+ */
+typedef struct _YORI_SH_PROMPT_CACHE {
+
+    /**
+     A list of cached segments, ordered from most recently used.
+     */
+    YORI_LIST_ENTRY Segments;
+
+    /**
+     The number of segments in the list.
+     */
+    DWORD SegmentCount;
+
+    /**
+     The number of milliseconds a cached result remains valid, from the
+     YORIPROMPTCACHE variable.  If zero, results are not cached.
+     */
+    DWORD Lifetime;
+
+    /**
+     The environment generation when YORIPROMPTCACHE was queried.
+     */
+    DWORD LifetimeGeneration;
+
+    /**
+     TRUE once YORIPROMPTCACHE has been queried.
+     */
+    BOOLEAN LifetimeDetermined;
+} YORI_SH_PROMPT_CACHE, *PYORI_SH_PROMPT_CACHE;
+
+/**
+ Cached results of backquote expressions in the prompt and title.
+ */
+YORI_SH_PROMPT_CACHE YoriShPromptCache;
+
 /**
  Return TRUE if the process is running as part of the administrator group,
  FALSE if not.
@@ -57,6 +141,233 @@ YoriShPromptIsAdmin(VOID)
     return YoriShPromptAdminPresent;
 }
 
+/**
+ Free a cached prompt segment.  The segment must have been removed from the
+ list.
+
+ @param Segment Pointer to the segment to free.
+ */
+VOID
+YoriShFreePromptSegment(
+    __in PYORI_SH_PROMPT_SEGMENT Segment
+    )
+{
+    YoriLibFreeStringContents(&Segment->Expression);
+    YoriLibFreeStringContents(&Segment->Output);
+    YoriLibFreeStringContents(&Segment->CurrentDirectory);
+    YoriLibDereference(Segment);
+}
+
+/**
+ Free all cached prompt segments.
+ */
+VOID
+YoriShCleanupPromptCache(VOID)
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_PROMPT_SEGMENT Segment;
+
+    if (YoriShPromptCache.Segments.Next == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShPromptCache.Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_SH_PROMPT_SEGMENT, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShPromptCache.Segments, ListEntry);
+        YoriLibRemoveListItem(&Segment->ListEntry);
+        YoriShFreePromptSegment(Segment);
+    }
+    YoriShPromptCache.SegmentCount = 0;
+}
+
+/**
+ Check the environment to determine how long backquote results in the prompt
+ remain valid.  This is only reevaluated when the environment changes.
+ */
+VOID
+YoriShRefreshPromptCacheLifetime(VOID)
+{
+    YORI_STRING EnvVar;
+    TCHAR EnvVarBuffer[16];
+    YORI_ALLOC_SIZE_T EnvVarLength;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+
+    if (YoriShPromptCache.LifetimeDetermined &&
+        YoriShPromptCache.LifetimeGeneration == YoriShGlobal.EnvironmentGeneration) {
+
+        return;
+    }
+
+    YoriShPromptCache.Lifetime = 0;
+    YoriShPromptCache.LifetimeDetermined = TRUE;
+    YoriShPromptCache.LifetimeGeneration = YoriShGlobal.EnvironmentGeneration;
+
+    YoriLibInitEmptyString(&EnvVar);
+    EnvVar.StartOfString = EnvVarBuffer;
+    EnvVar.LengthAllocated = sizeof(EnvVarBuffer)/sizeof(EnvVarBuffer[0]);
+
+    EnvVarLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIPROMPTCACHE"), NULL, 0, NULL);
+    if (EnvVarLength > 0 && EnvVarLength <= EnvVar.LengthAllocated) {
+        EnvVar.LengthInChars = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIPROMPTCACHE"), EnvVar.StartOfString, EnvVar.LengthAllocated, NULL);
+        if (YoriLibStringToNumber(&EnvVar, TRUE, &llTemp, &CharsConsumed) &&
+            CharsConsumed > 0 &&
+            llTemp > 0) {
+
+            YoriShPromptCache.Lifetime = (DWORD)llTemp;
+        }
+    }
+
+    if (YoriShPromptCache.Lifetime == 0) {
+        YoriShCleanupPromptCache();
+    }
+}
+
+/**
+ Return TRUE if a cached prompt segment can be used without evaluating it
+ again.  A segment is valid if the current directory and environment have
+ not changed since it was evaluated, and the user specified lifetime has not
+ elapsed.
+
+ @param Segment Pointer to the segment to check.
+
+ @param CurrentDirectory Pointer to the current directory.
+
+ @param Now The current system time.
+
+ @return TRUE if the segment can be used, FALSE if it must be evaluated.
+ */
+BOOLEAN
+YoriShIsPromptSegmentCurrent(
+    __in PYORI_SH_PROMPT_SEGMENT Segment,
+    __in PYORI_STRING CurrentDirectory,
+    __in LONGLONG Now
+    )
+{
+    if (Segment->EnvironmentGeneration != YoriShGlobal.EnvironmentGeneration) {
+        return FALSE;
+    }
+
+    if (YoriLibCompareString(&Segment->CurrentDirectory, CurrentDirectory) != 0) {
+        return FALSE;
+    }
+
+    //
+    //  System time is in 100ns units.
+    //
+
+    if (Now < Segment->EvaluatedTime ||
+        (DWORDLONG)(Now - Segment->EvaluatedTime) >= (DWORDLONG)YoriShPromptCache.Lifetime * 10 * 1000) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Evaluate a backquote expression within the prompt or title, using a cached
+ result if one is available and still valid.
+
+ @param Expression The backquote expression to evaluate.
+
+ @param ProcessOutput On successful completion, populated with the text to
+        substitute.
+
+ @param Context Ignored.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShEvaluatePromptBackquote(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ProcessOutput,
+    __in PVOID Context
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_PROMPT_SEGMENT Segment;
+    PYORI_STRING CurrentDirectory;
+    LONGLONG Now;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    if (YoriShPromptCache.Lifetime == 0) {
+        return YoriShExecuteExpressionAndCaptureOutput(Expression, ProcessOutput);
+    }
+
+    if (YoriShPromptCache.Segments.Next == NULL) {
+        YoriLibInitializeListHead(&YoriShPromptCache.Segments);
+    }
+
+    CurrentDirectory = &YoriShGlobal.CurrentDirectoryBuffers[YoriShGlobal.ActiveCurrentDirectory];
+    Now = YoriLibGetSystemTimeAsInteger();
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShPromptCache.Segments, NULL);
+    while (ListEntry != NULL) {
+        Segment = CONTAINING_RECORD(ListEntry, YORI_SH_PROMPT_SEGMENT, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShPromptCache.Segments, ListEntry);
+        if (YoriLibCompareString(&Segment->Expression, Expression) == 0) {
+            YoriLibRemoveListItem(&Segment->ListEntry);
+            if (YoriShIsPromptSegmentCurrent(Segment, CurrentDirectory, Now)) {
+                YoriLibInsertList(&YoriShPromptCache.Segments, &Segment->ListEntry);
+                YoriLibCloneString(ProcessOutput, &Segment->Output);
+                return TRUE;
+            }
+            YoriShPromptCache.SegmentCount--;
+            YoriShFreePromptSegment(Segment);
+            break;
+        }
+    }
+
+    if (!YoriShExecuteExpressionAndCaptureOutput(Expression, ProcessOutput)) {
+        return FALSE;
+    }
+
+    //
+    //  Record the result.  If this fails, the result is still returned to
+    //  the caller, it just won't be reused.
+    //
+
+    Segment = YoriLibReferencedMalloc(sizeof(YORI_SH_PROMPT_SEGMENT));
+    if (Segment == NULL) {
+        return TRUE;
+    }
+
+    YoriLibInitEmptyString(&Segment->Expression);
+    YoriLibInitEmptyString(&Segment->Output);
+    YoriLibInitEmptyString(&Segment->CurrentDirectory);
+    if (!YoriLibCopyString(&Segment->Expression, Expression) ||
+        !YoriLibCopyString(&Segment->CurrentDirectory, CurrentDirectory)) {
+
+        YoriShFreePromptSegment(Segment);
+        return TRUE;
+    }
+
+    YoriLibCloneString(&Segment->Output, ProcessOutput);
+    Segment->EnvironmentGeneration = YoriShGlobal.EnvironmentGeneration;
+    Segment->EvaluatedTime = Now;
+
+    YoriLibInsertList(&YoriShPromptCache.Segments, &Segment->ListEntry);
+    YoriShPromptCache.SegmentCount++;
+
+    //
+    //  If too many results are cached, discard the least recently used.
+    //
+
+    if (YoriShPromptCache.SegmentCount > YORI_SH_PROMPT_CACHE_MAX_SEGMENTS) {
+        ListEntry = YoriLibGetPreviousListEntry(&YoriShPromptCache.Segments, NULL);
+        Segment = CONTAINING_RECORD(ListEntry, YORI_SH_PROMPT_SEGMENT, ListEntry);
+        YoriLibRemoveListItem(&Segment->ListEntry);
+        YoriShPromptCache.SegmentCount--;
+        YoriShFreePromptSegment(Segment);
+    }
+
+    return TRUE;
+}
+
 /**
  Expand variables in a prompt environment variable to form a displayable
  string.
@@ -194,6 +505,12 @@ YoriShDisplayPrompt(VOID)
 
     YoriShGlobal.ImplicitSynchronousTaskActive = TRUE;
 
+    //
+    //  Determine whether backquote results in the prompt can be reused.
+    //
+
+    YoriShRefreshPromptCacheLifetime();
+
     //
     //  See if the environment has changed, and if so, reload the YORIPOSTCMD
     //  variable.
@@ -269,7 +586,7 @@ YoriShDisplayPrompt(VOID)
         //  expansion fails, we'll end up pointing at the previous string.
         //
 
-        if (YoriShExpandBackquotes(StringToUse, &PromptAfterBackquoteExpansion)) {
+        if (YoriShExpandBackquotesWithCallback(StringToUse, YoriShEvaluatePromptBackquote, NULL, &PromptAfterBackquoteExpansion)) {
             StringToUse = &PromptAfterBackquoteExpansion;
         } else {
             YoriLibInitEmptyString(&PromptAfterBackquoteExpansion);
@@ -375,7 +692,7 @@ YoriShDisplayPrompt(VOID)
         //  expansion fails, we'll end up pointing at the previous string.
         //
 
-        if (YoriShExpandBackquotes(StringToUse, &PromptAfterBackquoteExpansion)) {
+        if (YoriShExpandBackquotesWithCallback(StringToUse, YoriShEvaluatePromptBackquote, NULL, &PromptAfterBackquoteExpansion)) {
             StringToUse = &PromptAfterBackquoteExpansion;
         } else {
             YoriLibInitEmptyString(&PromptAfterBackquoteExpansion);
@@ -212,9 +212,417 @@ YoriShCleanupStaleRestartStates(VOID)
 }
 
 
+/**
+ The number of characters to allocate initially for the contents of an INI
+ section that is being built in memory.  This grows as needed.
+ */
+#define YORI_SH_RESTART_SECTION_INITIAL_SIZE (4 * 1024)
+
+/**
+ State remembered from the previous save, so that later saves only need to
+ write what has changed.  This is only accessed by the save worker thread,
+ and only one of those exists at a time.
+ */
+typedef struct _YORI_SH_RESTART_SAVED_STATE {
+
+    /**
+     The Window section as it was last written.
+     */
+    YORI_STRING Window;
+
+    /**
+     The Environment section as it was last written.
+     */
+    YORI_STRING Environment;
+
+    /**
+     The CurrentDirectories section as it was last written.
+     */
+    YORI_STRING CurrentDirectories;
+
+    /**
+     The Aliases section as it was last written.
+     */
+    YORI_STRING Aliases;
+
+    /**
+     The History section as it was last written.
+     */
+    YORI_STRING History;
+
+    /**
+     The cursor line when the window contents were last saved.  Lines above
+     this point have already been written to the buffer file.
+     */
+    DWORD ContentsCursorLine;
+
+    /**
+     The number of lines in the buffer file.
+     */
+    DWORD ContentsLineCount;
+
+    /**
+     A hash of the last console line written to the buffer file.  If the
+     line no longer matches, the console has scrolled or been redrawn and
+     the buffer file needs to be rewritten.
+     */
+    DWORD ContentsLastLineHash;
+
+    /**
+     The width of the console buffer when the window contents were saved.
+     */
+    SHORT ContentsBufferWidth;
+
+    /**
+     TRUE if the buffer file is populated and the Contents fields above
+     describe it.
+     */
+    BOOLEAN ContentsValid;
+} YORI_SH_RESTART_SAVED_STATE, *PYORI_SH_RESTART_SAVED_STATE;
+
+/**
+ State remembered from the previous restart save.
+ */
+YORI_SH_RESTART_SAVED_STATE YoriShRestartSavedState;
+
+/**
+ Discard any state remembered from a previous save, so that the next save
+ writes everything.
+ */
+VOID
+YoriShResetRestartSavedState(VOID)
+{
+    YoriLibFreeStringContents(&YoriShRestartSavedState.Window);
+    YoriLibFreeStringContents(&YoriShRestartSavedState.Environment);
+    YoriLibFreeStringContents(&YoriShRestartSavedState.CurrentDirectories);
+    YoriLibFreeStringContents(&YoriShRestartSavedState.Aliases);
+    YoriLibFreeStringContents(&YoriShRestartSavedState.History);
+    YoriShRestartSavedState.ContentsValid = FALSE;
+}
+
+/**
+ Add a key and value to an INI section that is being built in memory.  The
+ section is a series of NULL terminated key=value strings, followed by an
+ additional NULL, which is the form used by WritePrivateProfileSection.
+
+ @param Section Pointer to the section being built.  This may be reallocated
+        within this routine.
+
+ @param Key Pointer to the NULL terminated key to add.
+
+ @param Value Pointer to the NULL terminated value to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShRestartAddToSection(
+    __inout PYORI_STRING Section,
+    __in LPCTSTR Key,
+    __in LPCTSTR Value
+    )
+{
+    YORI_MAX_UNSIGNED_T CharsNeeded;
+    YORI_MAX_UNSIGNED_T NewAllocSize;
+    YORI_ALLOC_SIZE_T KeyLength;
+    YORI_ALLOC_SIZE_T ValueLength;
+
+    KeyLength = (YORI_ALLOC_SIZE_T)_tcslen(Key);
+    ValueLength = (YORI_ALLOC_SIZE_T)_tcslen(Value);
+
+    //
+    //  Space for the key, equals, value, its terminator, and the terminator
+    //  for the section.
+    //
+
+    CharsNeeded = (YORI_MAX_UNSIGNED_T)Section->LengthInChars + KeyLength + 1 + ValueLength + 2;
+    if (CharsNeeded > Section->LengthAllocated) {
+        NewAllocSize = (YORI_MAX_UNSIGNED_T)Section->LengthAllocated * 2;
+        if (NewAllocSize < CharsNeeded) {
+            NewAllocSize = CharsNeeded;
+        }
+        if (NewAllocSize < YORI_SH_RESTART_SECTION_INITIAL_SIZE) {
+            NewAllocSize = YORI_SH_RESTART_SECTION_INITIAL_SIZE;
+        }
+        if (!YoriLibIsSizeAllocatable(NewAllocSize * sizeof(TCHAR))) {
+            return FALSE;
+        }
+        if (!YoriLibReallocateString(Section, (YORI_ALLOC_SIZE_T)NewAllocSize)) {
+            return FALSE;
+        }
+    }
+
+    memcpy(&Section->StartOfString[Section->LengthInChars], Key, KeyLength * sizeof(TCHAR));
+    Section->LengthInChars = Section->LengthInChars + KeyLength;
+    Section->StartOfString[Section->LengthInChars] = '=';
+    Section->LengthInChars++;
+    memcpy(&Section->StartOfString[Section->LengthInChars], Value, ValueLength * sizeof(TCHAR));
+    Section->LengthInChars = Section->LengthInChars + ValueLength;
+    Section->StartOfString[Section->LengthInChars] = '\0';
+    Section->LengthInChars++;
+    Section->StartOfString[Section->LengthInChars] = '\0';
+
+    return TRUE;
+}
+
+/**
+ Add a key and numeric value to an INI section that is being built in
+ memory.
+
+ @param Section Pointer to the section being built.  This may be reallocated
+        within this routine.
+
+ @param Key Pointer to the NULL terminated key to add.
+
+ @param Value The value to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShRestartAddNumberToSection(
+    __inout PYORI_STRING Section,
+    __in LPCTSTR Key,
+    __in INT Value
+    )
+{
+    TCHAR NumberBuffer[16];
+
+    YoriLibSPrintf(NumberBuffer, _T("%i"), Value);
+    return YoriShRestartAddToSection(Section, Key, NumberBuffer);
+}
+
+/**
+ Write an INI section that has been built in memory, unless it is identical
+ to what was written previously.  Each section is written with a single
+ call, since every write to an INI file rewrites the whole file.
+
+ @param SectionName Pointer to the name of the INI section.
+
+ @param NewSection Pointer to the section that has been built.  On return
+        this string has been consumed, either by being freed or by being
+        moved into SavedSection.
+
+ @param SavedSection Pointer to the section as it was last written.  This is
+        updated to the new contents if they are written.
+
+ @param FileName Pointer to the name of the INI file.
+ */
+VOID
+YoriShRestartWriteSection(
+    __in LPCTSTR SectionName,
+    __inout PYORI_STRING NewSection,
+    __inout PYORI_STRING SavedSection,
+    __in LPCTSTR FileName
+    )
+{
+    //
+    //  If nothing was added, the section is empty.  Only write it if the
+    //  previous save had entries that need to be removed.
+    //
+
+    if (NewSection->StartOfString == NULL) {
+        if (SavedSection->LengthInChars > 0) {
+            DllKernel32.pWritePrivateProfileSectionW(SectionName, _T(""), FileName);
+            YoriLibFreeStringContents(SavedSection);
+        }
+        return;
+    }
+
+    if (SavedSection->StartOfString != NULL &&
+        SavedSection->LengthInChars == NewSection->LengthInChars &&
+        memcmp(SavedSection->StartOfString, NewSection->StartOfString, NewSection->LengthInChars * sizeof(TCHAR)) == 0) {
+
+        YoriLibFreeStringContents(NewSection);
+        return;
+    }
+
+    if (!DllKernel32.pWritePrivateProfileSectionW(SectionName, NewSection->StartOfString, FileName)) {
+        YoriLibFreeStringContents(NewSection);
+        YoriLibFreeStringContents(SavedSection);
+        return;
+    }
+
+    YoriLibFreeStringContents(SavedSection);
+    memcpy(SavedSection, NewSection, sizeof(YORI_STRING));
+    YoriLibInitEmptyString(NewSection);
+}
+
+/**
+ Calculate a hash of the characters and attributes on a single line of the
+ console.
+
+ @param hConsole Handle to the console.
+
+ @param Line The line to hash.
+
+ @param Width The width of the console buffer.
+
+ @param Hash On successful completion, updated to contain the hash.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShRestartHashConsoleLine(
+    __in HANDLE hConsole,
+    __in DWORD Line,
+    __in SHORT Width,
+    __out PDWORD Hash
+    )
+{
+    PCHAR_INFO LineBuffer;
+    SMALL_RECT ReadWindow;
+    COORD BufferSize;
+    COORD BufferOffset;
+    DWORD Index;
+    DWORD LocalHash;
+
+    LineBuffer = YoriLibMalloc(Width * sizeof(CHAR_INFO));
+    if (LineBuffer == NULL) {
+        return FALSE;
+    }
+
+    BufferSize.X = Width;
+    BufferSize.Y = 1;
+    BufferOffset.X = 0;
+    BufferOffset.Y = 0;
+    ReadWindow.Left = 0;
+    ReadWindow.Right = (SHORT)(Width - 1);
+    ReadWindow.Top = (SHORT)Line;
+    ReadWindow.Bottom = (SHORT)Line;
+
+    if (!ReadConsoleOutput(hConsole, LineBuffer, BufferSize, BufferOffset, &ReadWindow)) {
+        YoriLibFree(LineBuffer);
+        return FALSE;
+    }
+
+    LocalHash = 0;
+    for (Index = 0; Index < (DWORD)Width; Index++) {
+        LocalHash = (LocalHash << 5) + LocalHash + LineBuffer[Index].Char.UnicodeChar;
+        LocalHash = (LocalHash << 5) + LocalHash + LineBuffer[Index].Attributes;
+    }
+
+    YoriLibFree(LineBuffer);
+    *Hash = LocalHash;
+    return TRUE;
+}
+
+/**
+ Save the window contents to the buffer file.  If the lines saved previously
+ are still present at the same place in the console, only the lines written
+ since then are appended.  Otherwise, such as after the console has scrolled
+ or been cleared, or once appending has made the file much larger than the
+ requested number of lines, the file is rewritten.
+
+ @param FileName Pointer to the name of the buffer file.
+
+ @param ScreenBufferInfo Pointer to information about the console.
+
+ @param LineCount The number of lines the user requested be saved, or zero
+        to save all lines.
+
+ @return TRUE if the buffer file is populated, FALSE if it is not.
+ */
+BOOL
+YoriShRestartSaveContents(
+    __in PYORI_STRING FileName,
+    __in PYORI_CONSOLE_SCREEN_BUFFER_INFOEX ScreenBufferInfo,
+    __in DWORD LineCount
+    )
+{
+    PYORI_SH_RESTART_SAVED_STATE Saved;
+    HANDLE hConsole;
+    HANDLE hBufferFile;
+    DWORD CursorLine;
+    DWORD NewLines;
+    DWORD Hash;
+    BOOLEAN Append;
+
+    Saved = &YoriShRestartSavedState;
+    hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    CursorLine = ScreenBufferInfo->dwCursorPosition.Y;
+
+    Append = FALSE;
+    if (Saved->ContentsValid &&
+        Saved->ContentsBufferWidth == ScreenBufferInfo->dwSize.X &&
+        Saved->ContentsCursorLine > 0 &&
+        CursorLine >= Saved->ContentsCursorLine &&
+        YoriShRestartHashConsoleLine(hConsole, Saved->ContentsCursorLine - 1, ScreenBufferInfo->dwSize.X, &Hash) &&
+        Hash == Saved->ContentsLastLineHash) {
+
+        NewLines = CursorLine - Saved->ContentsCursorLine;
+        if (NewLines == 0) {
+            return TRUE;
+        }
+
+        if (LineCount == 0 || Saved->ContentsLineCount + NewLines <= 2 * LineCount) {
+            Append = TRUE;
+        }
+    }
+
+    Saved->ContentsValid = FALSE;
+
+    if (Append) {
+        hBufferFile = CreateFile(FileName->StartOfString,
+                                 FILE_APPEND_DATA,
+                                 FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                 NULL,
+                                 OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL,
+                                 NULL);
+        if (hBufferFile == INVALID_HANDLE_VALUE) {
+            Append = FALSE;
+        } else if (!YoriLibRewriteConsoleContents(hBufferFile, NewLines, 0, 0)) {
+            CloseHandle(hBufferFile);
+            Append = FALSE;
+        } else {
+            CloseHandle(hBufferFile);
+            Saved->ContentsLineCount = Saved->ContentsLineCount + NewLines;
+        }
+    }
+
+    if (!Append) {
+        hBufferFile = CreateFile(FileName->StartOfString,
+                                 GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                 NULL,
+                                 CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL,
+                                 NULL);
+
+        if (hBufferFile == INVALID_HANDLE_VALUE) {
+            return FALSE;
+        }
+
+        if (!YoriLibRewriteConsoleContents(hBufferFile, LineCount, 0, 0)) {
+            CloseHandle(hBufferFile);
+            return TRUE;
+        }
+        CloseHandle(hBufferFile);
+
+        Saved->ContentsLineCount = CursorLine;
+        if (LineCount != 0 && LineCount < CursorLine) {
+            Saved->ContentsLineCount = LineCount;
+        }
+    }
+
+    if (CursorLine > 0 &&
+        YoriShRestartHashConsoleLine(hConsole, CursorLine - 1, ScreenBufferInfo->dwSize.X, &Saved->ContentsLastLineHash)) {
+
+        Saved->ContentsCursorLine = CursorLine;
+        Saved->ContentsBufferWidth = ScreenBufferInfo->dwSize.X;
+        Saved->ContentsValid = TRUE;
+    }
+
+    return TRUE;
+}
+
 /**
  Try to save the current state of the process so that it can be recovered
- from this state after a subsequent unexpected termination.
+ from this state after a subsequent unexpected termination.  Each INI
+ section is built in memory and only written if it differs from the previous
+ save, and new console lines are appended to the buffer file where possible.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
@@ -230,6 +638,7 @@ YoriShSaveRestartStateWorker(
     YORI_STRING RestartFileName;
     YORI_STRING RestartBufferFileName;
     YORI_STRING Env;
+    YORI_STRING Section;
     LPTSTR Comma;
     YORI_ALLOC_SIZE_T Count;
     DWORD LineCount;
@@ -247,7 +656,7 @@ YoriShSaveRestartStateWorker(
         DllKernel32.pGetConsoleScreenBufferInfoEx == NULL ||
         DllKernel32.pGetCurrentConsoleFontEx == NULL ||
         DllKernel32.pGetConsoleWindow == NULL ||
-        DllKernel32.pWritePrivateProfileStringW == NULL) {
+        DllKernel32.pWritePrivateProfileSectionW == NULL) {
 
         return 0;
     }
@@ -329,30 +738,33 @@ YoriShSaveRestartStateWorker(
                    _T("\\yori-restart-%x.ini"),
                    GetCurrentProcessId());
 
+    //
+    //  If the INI file isn't there, something else removed it, so nothing
+    //  from the previous save can be assumed to be present.
+    //
+
+    if (GetFileAttributes(RestartFileName.StartOfString) == INVALID_FILE_ATTRIBUTES) {
+        YoriShResetRestartSavedState();
+    }
+
     if (!YoriLibAllocateString(&WriteBuffer, 32 * 1024)) {
         YoriLibFreeStringContents(&RestartFileName);
         return 0;
     }
 
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.X);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("BufferWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.dwSize.Y);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("BufferHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Right - ScreenBufferInfo.srWindow.Left + 1);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.srWindow.Bottom - ScreenBufferInfo.srWindow.Top + 1);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriLibInitEmptyString(&Section);
+    YoriShRestartAddNumberToSection(&Section, _T("BufferWidth"), ScreenBufferInfo.dwSize.X);
+    YoriShRestartAddNumberToSection(&Section, _T("BufferHeight"), ScreenBufferInfo.dwSize.Y);
+    YoriShRestartAddNumberToSection(&Section, _T("WindowWidth"), ScreenBufferInfo.srWindow.Right - ScreenBufferInfo.srWindow.Left + 1);
+    YoriShRestartAddNumberToSection(&Section, _T("WindowHeight"), ScreenBufferInfo.srWindow.Bottom - ScreenBufferInfo.srWindow.Top + 1);
 
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), YoriLibVtGetDefaultColor());
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("DefaultColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-    YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.wPopupAttributes);
-    DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("PopupColor"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+    YoriShRestartAddNumberToSection(&Section, _T("DefaultColor"), YoriLibVtGetDefaultColor());
+    YoriShRestartAddNumberToSection(&Section, _T("PopupColor"), ScreenBufferInfo.wPopupAttributes);
 
     for (Count = 0; Count < sizeof(ScreenBufferInfo.ColorTable)/sizeof(ScreenBufferInfo.ColorTable[0]); Count++) {
         TCHAR ColorName[32];
         YoriLibSPrintf(ColorName, _T("Color%i"), Count);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), ScreenBufferInfo.ColorTable[Count]);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), ColorName, WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriShRestartAddNumberToSection(&Section, ColorName, ScreenBufferInfo.ColorTable[Count]);
     }
 
     //
@@ -365,10 +777,8 @@ YoriShSaveRestartStateWorker(
         RECT WindowRect;
 
         if (DllUser32.pGetWindowRect(DllKernel32.pGetConsoleWindow(), &WindowRect)) {
-            YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), WindowRect.left);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowLeft"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-            YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), WindowRect.top);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("WindowTop"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+            YoriShRestartAddNumberToSection(&Section, _T("WindowLeft"), WindowRect.left);
+            YoriShRestartAddNumberToSection(&Section, _T("WindowTop"), WindowRect.top);
         }
     }
 
@@ -378,7 +788,7 @@ YoriShSaveRestartStateWorker(
 
     WriteBuffer.LengthInChars = (YORI_ALLOC_SIZE_T)GetConsoleTitle(WriteBuffer.StartOfString, 4095);
     if (WriteBuffer.LengthInChars > 0) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("Title"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriShRestartAddToSection(&Section, _T("Title"), WriteBuffer.StartOfString);
     } else {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Error getting window title: %i\n"), GetLastError());
     }
@@ -390,17 +800,12 @@ YoriShSaveRestartStateWorker(
     ZeroMemory(&FontInfo, sizeof(FontInfo));
     FontInfo.cbSize = sizeof(FontInfo);
     if (DllKernel32.pGetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), FALSE, &FontInfo)) {
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.nFont);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontIndex"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.X);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontWidth"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.dwFontSize.Y);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontHeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontFamily);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontFamily"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        YoriLibSPrintf(WriteBuffer.StartOfString, _T("%i"), FontInfo.FontWeight);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontWeight"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("FontName"), FontInfo.FaceName, RestartFileName.StartOfString);
+        YoriShRestartAddNumberToSection(&Section, _T("FontIndex"), FontInfo.nFont);
+        YoriShRestartAddNumberToSection(&Section, _T("FontWidth"), FontInfo.dwFontSize.X);
+        YoriShRestartAddNumberToSection(&Section, _T("FontHeight"), FontInfo.dwFontSize.Y);
+        YoriShRestartAddNumberToSection(&Section, _T("FontFamily"), FontInfo.FontFamily);
+        YoriShRestartAddNumberToSection(&Section, _T("FontWeight"), FontInfo.FontWeight);
+        YoriShRestartAddToSection(&Section, _T("FontName"), FontInfo.FaceName);
     }
 
     //
@@ -409,9 +814,31 @@ YoriShSaveRestartStateWorker(
 
     WriteBuffer.LengthInChars = (YORI_ALLOC_SIZE_T)GetCurrentDirectory(WriteBuffer.LengthAllocated, WriteBuffer.StartOfString);
     if (WriteBuffer.LengthInChars > 0 && WriteBuffer.LengthInChars < WriteBuffer.LengthAllocated) {
-        DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("CurrentDirectory"), WriteBuffer.StartOfString, RestartFileName.StartOfString);
+        YoriShRestartAddToSection(&Section, _T("CurrentDirectory"), WriteBuffer.StartOfString);
+    }
+
+    //
+    //  Write the window contents.  This is the last entry in the Window
+    //  section, which can then be written.
+    //
+
+    if (YoriLibAllocateString(&RestartBufferFileName, RestartFileName.LengthAllocated)) {
+
+        memcpy(RestartBufferFileName.StartOfString, RestartFileName.StartOfString, RestartFileName.LengthInChars * sizeof(TCHAR));
+        RestartBufferFileName.LengthInChars = RestartFileName.LengthInChars;
+        YoriLibSPrintf(RestartBufferFileName.StartOfString + RestartBufferFileName.LengthInChars,
+                       _T("\\yori-restart-%x.txt"),
+                       GetCurrentProcessId());
+
+        if (YoriShRestartSaveContents(&RestartBufferFileName, &ScreenBufferInfo, LineCount)) {
+            YoriShRestartAddToSection(&Section, _T("Contents"), RestartBufferFileName.StartOfString);
+        }
+
+        YoriLibFreeStringContents(&RestartBufferFileName);
     }
 
+    YoriShRestartWriteSection(_T("Window"), &Section, &YoriShRestartSavedState.Window, RestartFileName.StartOfString);
+
     //
     //  Write the current environment
     //
@@ -432,7 +859,7 @@ YoriShSaveRestartStateWorker(
                     ThisValue[0] = '\0';
                     ThisValue++;
 
-                    DllKernel32.pWritePrivateProfileStringW(_T("Environment"), ThisVar, ThisValue, RestartFileName.StartOfString);
+                    YoriShRestartAddToSection(&Section, ThisVar, ThisValue);
 
                     ThisValue--;
                     ThisValue[0] = '=';
@@ -440,6 +867,8 @@ YoriShSaveRestartStateWorker(
             }
         }
 
+        YoriShRestartWriteSection(_T("Environment"), &Section, &YoriShRestartSavedState.Environment, RestartFileName.StartOfString);
+
         //
         //  With the "regular" environment done, go through and write a new
         //  section for current directories on alternate drives.  These are
@@ -463,13 +892,15 @@ YoriShSaveRestartStateWorker(
                 ThisValue[0] = '\0';
                 ThisValue++;
 
-                DllKernel32.pWritePrivateProfileStringW(_T("CurrentDirectories"), ThisVar, ThisValue, RestartFileName.StartOfString);
+                YoriShRestartAddToSection(&Section, ThisVar, ThisValue);
 
                 ThisValue--;
                 ThisValue[0] = '=';
             }
         }
 
+        YoriShRestartWriteSection(_T("CurrentDirectories"), &Section, &YoriShRestartSavedState.CurrentDirectories, RestartFileName.StartOfString);
+
         YoriLibFreeStringContents(&Env);
     }
 
@@ -493,11 +924,13 @@ YoriShSaveRestartStateWorker(
                     ThisValue[0] = '\0';
                     ThisValue++;
 
-                    DllKernel32.pWritePrivateProfileStringW(_T("Aliases"), ThisVar, ThisValue, RestartFileName.StartOfString);
+                    YoriShRestartAddToSection(&Section, ThisVar, ThisValue);
                 }
             }
         }
 
+        YoriShRestartWriteSection(_T("Aliases"), &Section, &YoriShRestartSavedState.Aliases, RestartFileName.StartOfString);
+
         YoriLibFreeStringContents(&Env);
     }
 
@@ -513,43 +946,14 @@ YoriShSaveRestartStateWorker(
         Count = 1;
         while (*ThisValue != '\0') {
             YoriLibSPrintf(WriteBuffer.StartOfString, _T("%03i"), Count);
-            DllKernel32.pWritePrivateProfileStringW(_T("History"), WriteBuffer.StartOfString, ThisValue, RestartFileName.StartOfString);
+            YoriShRestartAddToSection(&Section, WriteBuffer.StartOfString, ThisValue);
             ThisValue += _tcslen(ThisValue) + 1;
             Count++;
         }
 
-        YoriLibFreeStringContents(&Env);
-    }
-
-    //
-    //  Write the window contents
-    //
+        YoriShRestartWriteSection(_T("History"), &Section, &YoriShRestartSavedState.History, RestartFileName.StartOfString);
 
-    if (YoriLibAllocateString(&RestartBufferFileName, RestartFileName.LengthAllocated)) {
-
-        HANDLE hBufferFile;
-
-        memcpy(RestartBufferFileName.StartOfString, RestartFileName.StartOfString, RestartFileName.LengthInChars * sizeof(TCHAR));
-        RestartBufferFileName.LengthInChars = RestartFileName.LengthInChars;
-        YoriLibSPrintf(RestartBufferFileName.StartOfString + RestartBufferFileName.LengthInChars,
-                       _T("\\yori-restart-%x.txt"),
-                       GetCurrentProcessId());
-
-        hBufferFile = CreateFile(RestartBufferFileName.StartOfString,
-                                 GENERIC_WRITE,
-                                 FILE_SHARE_READ | FILE_SHARE_DELETE,
-                                 NULL,
-                                 CREATE_ALWAYS,
-                                 FILE_ATTRIBUTE_NORMAL,
-                                 NULL);
-
-        if (hBufferFile != INVALID_HANDLE_VALUE) {
-            YoriLibRewriteConsoleContents(hBufferFile, LineCount, 0);
-            DllKernel32.pWritePrivateProfileStringW(_T("Window"), _T("Contents"), RestartBufferFileName.StartOfString, RestartFileName.StartOfString);
-            CloseHandle(hBufferFile);
-        }
-
-        YoriLibFreeStringContents(&RestartBufferFileName);
+        YoriLibFreeStringContents(&Env);
     }
 
     //
@@ -563,6 +967,7 @@ YoriShSaveRestartStateWorker(
         YoriShProcessRegisteredForRestart = TRUE;
     }
 
+    YoriLibFreeStringContents(&Section);
     YoriLibFreeStringContents(&RestartFileName);
     YoriLibFreeStringContents(&WriteBuffer);
 
@@ -1017,6 +1422,10 @@ YoriShDiscardSavedRestartState(
 
     DeleteFile(RestartFileName.StartOfString);
     YoriLibFreeStringContents(&RestartFileName);
+
+    if (ProcessId == NULL) {
+        YoriShResetRestartSavedState();
+    }
 }
 
 // vim:sw=4:ts=4:et:
@@ -0,0 +1,326 @@
+/**
+ * @file sh/timing.c
+ *
+ * Yori shell per command latency breakdown
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yori.h"
+
+/**
+ The number of histogram buckets recorded for each phase.  Each bucket
+ covers a power of ten microseconds, from under 10us to 10 seconds and
+ above.
+ */
+#define YORI_SH_TIMING_BUCKETS (8)
+
+/**
+ The name of each phase, as displayed to the user.
+ */
+CONST LPCTSTR YoriShTimingPhaseNames[YoriShTimingPhaseBeyondMax] = {
+    _T("parse"),
+    _T("expand"),
+    _T("lookup"),
+    _T("launch"),
+    _T("run"),
+    _T("drain")
+};
+
+/**
+ The heading of each histogram bucket, as displayed to the user.
+ */
+CONST LPCTSTR YoriShTimingBucketNames[YORI_SH_TIMING_BUCKETS] = {
+    _T("<10us"),
+    _T("<100us"),
+    _T("<1ms"),
+    _T("<10ms"),
+    _T("<100ms"),
+    _T("<1s"),
+    _T("<10s"),
+    _T(">=10s")
+};
+
+/**
+ Aggregated timing information for a single phase across all commands.
+ */
+typedef struct _YORI_SH_TIMING_PHASE_STATS {
+
+    /**
+     The number of times the phase has been measured.
+     */
+    DWORD Count;
+
+    /**
+     The total time spent in the phase, in microseconds.
+     */
+    DWORDLONG Total;
+
+    /**
+     The longest single measurement of the phase, in microseconds.
+     */
+    DWORDLONG Max;
+
+    /**
+     The number of measurements falling into each histogram bucket.
+     */
+    DWORD Buckets[YORI_SH_TIMING_BUCKETS];
+} YORI_SH_TIMING_PHASE_STATS, *PYORI_SH_TIMING_PHASE_STATS;
+
+/**
+ State describing the latency of commands executed by the shell.
+ */
+typedef struct _YORI_SH_TIMING {
+
+    /**
+     The frequency of the performance counter.  This is zero until the
+     first measurement is taken.
+     */
+    LARGE_INTEGER Frequency;
+
+    /**
+     The number of commands entered while timing was enabled.
+     */
+    DWORD Commands;
+
+    /**
+     The time spent in each phase by the most recent command, in
+     microseconds.  A command containing several programs accumulates the
+     time for all of them.
+     */
+    DWORDLONG Last[YoriShTimingPhaseBeyondMax];
+
+    /**
+     Aggregated information about each phase.
+     */
+    YORI_SH_TIMING_PHASE_STATS Phases[YoriShTimingPhaseBeyondMax];
+} YORI_SH_TIMING, *PYORI_SH_TIMING;
+
+/**
+ Timing information about commands executed by this shell.
+ */
+YORI_SH_TIMING YoriShTiming;
+
+/**
+ Begin measuring a phase of command execution.  If timing is not enabled,
+ the start time is set to zero, which causes the subsequent call to
+ @ref YoriShTimingRecord to do nothing.
+
+ @param StartTime On completion, populated with the current performance
+        counter value, or zero if timing is not enabled.
+ */
+VOID
+YoriShTimingStart(
+    __out PLARGE_INTEGER StartTime
+    )
+{
+    if (!YoriShGlobal.CommandTimingEnabled) {
+        StartTime->QuadPart = 0;
+        return;
+    }
+
+    if (YoriShTiming.Frequency.QuadPart == 0) {
+        if (!QueryPerformanceFrequency(&YoriShTiming.Frequency)) {
+            StartTime->QuadPart = 0;
+            return;
+        }
+    }
+
+    QueryPerformanceCounter(StartTime);
+}
+
+/**
+ Indicate that a new command has been entered, so the per command timings
+ should be reset.
+ */
+VOID
+YoriShTimingBeginCommand(VOID)
+{
+    if (!YoriShGlobal.CommandTimingEnabled) {
+        return;
+    }
+
+    ZeroMemory(YoriShTiming.Last, sizeof(YoriShTiming.Last));
+    YoriShTiming.Commands++;
+}
+
+/**
+ Complete measuring a phase of command execution.
+
+ @param Phase The phase being measured.
+
+ @param StartTime Pointer to the performance counter value returned from
+        @ref YoriShTimingStart .  On completion this is updated to the
+        current time, so that consecutive phases can be measured without
+        querying the counter again.
+ */
+VOID
+YoriShTimingRecord(
+    __in YORI_SH_TIMING_PHASE Phase,
+    __inout PLARGE_INTEGER StartTime
+    )
+{
+    LARGE_INTEGER EndTime;
+    DWORDLONG Elapsed;
+    PYORI_SH_TIMING_PHASE_STATS Stats;
+    DWORDLONG Limit;
+    DWORD Bucket;
+
+    if (StartTime->QuadPart == 0) {
+        return;
+    }
+
+    QueryPerformanceCounter(&EndTime);
+    Elapsed = (DWORDLONG)(EndTime.QuadPart - StartTime->QuadPart);
+    Elapsed = YoriLibDivide32(Elapsed * 1000000, YoriShTiming.Frequency.LowPart);
+    StartTime->QuadPart = EndTime.QuadPart;
+
+    YoriShTiming.Last[Phase] = YoriShTiming.Last[Phase] + Elapsed;
+
+    Stats = &YoriShTiming.Phases[Phase];
+    Stats->Count++;
+    Stats->Total = Stats->Total + Elapsed;
+    if (Elapsed > Stats->Max) {
+        Stats->Max = Elapsed;
+    }
+
+    Limit = 10;
+    for (Bucket = 0; Bucket < YORI_SH_TIMING_BUCKETS - 1; Bucket++) {
+        if (Elapsed < Limit) {
+            break;
+        }
+        Limit = Limit * 10;
+    }
+    Stats->Buckets[Bucket]++;
+}
+
+/**
+ Discard all collected timing information.
+ */
+VOID
+YoriShTimingReset(VOID)
+{
+    ZeroMemory(&YoriShTiming.Commands, sizeof(YoriShTiming) - FIELD_OFFSET(YORI_SH_TIMING, Commands));
+}
+
+/**
+ Append formatted text to a timing report, silently truncating the report
+ if the buffer is full.
+
+ @param Report Pointer to the report being constructed.
+
+ @param Format The printf style format string.
+ */
+VOID
+YoriShTimingAppend(
+    __inout PYORI_STRING Report,
+    __in LPCTSTR Format,
+    ...
+    )
+{
+    va_list marker;
+    YORI_SIGNED_ALLOC_SIZE_T CharsWritten;
+
+    if (Report->LengthInChars + 1 >= Report->LengthAllocated) {
+        return;
+    }
+
+    va_start(marker, Format);
+    CharsWritten = YoriLibVSPrintf(&Report->StartOfString[Report->LengthInChars],
+                                   Report->LengthAllocated - Report->LengthInChars,
+                                   Format,
+                                   marker);
+    va_end(marker);
+
+    if (CharsWritten > 0) {
+        Report->LengthInChars = Report->LengthInChars + (YORI_ALLOC_SIZE_T)CharsWritten;
+    }
+}
+
+/**
+ Generate a report describing the time spent in each phase of the most
+ recent command, and a histogram of the time spent in each phase for all
+ commands.
+
+ @param Report On successful completion, populated with a newly allocated
+        string containing the report.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShTimingGetReport(
+    __out PYORI_STRING Report
+    )
+{
+    DWORD Phase;
+    DWORD Bucket;
+    PYORI_SH_TIMING_PHASE_STATS Stats;
+    DWORDLONG Average;
+
+    if (!YoriLibAllocateString(Report, 4096)) {
+        return FALSE;
+    }
+
+    if (!YoriShGlobal.CommandTimingEnabled) {
+        YoriShTimingAppend(Report, _T("Command timing is not enabled.  Set YORICMDTIMING=1 to enable it.\n"));
+    }
+
+    if (YoriShTiming.Commands == 0) {
+        return TRUE;
+    }
+
+    YoriShTimingAppend(Report, _T("Commands measured: %i\n\n"), YoriShTiming.Commands);
+    YoriShTimingAppend(Report, _T("%-8s %12s %12s %12s %12s\n"), _T("phase"), _T("last(us)"), _T("count"), _T("avg(us)"), _T("max(us)"));
+    for (Phase = 0; Phase < YoriShTimingPhaseBeyondMax; Phase++) {
+        Stats = &YoriShTiming.Phases[Phase];
+        Average = 0;
+        if (Stats->Count > 0) {
+            Average = YoriLibDivide32(Stats->Total, Stats->Count);
+        }
+        YoriShTimingAppend(Report,
+                           _T("%-8s %12lli %12i %12lli %12lli\n"),
+                           YoriShTimingPhaseNames[Phase],
+                           YoriShTiming.Last[Phase],
+                           Stats->Count,
+                           Average,
+                           Stats->Max);
+    }
+
+    YoriShTimingAppend(Report, _T("\n%-8s"), _T("phase"));
+    for (Bucket = 0; Bucket < YORI_SH_TIMING_BUCKETS; Bucket++) {
+        YoriShTimingAppend(Report, _T(" %7s"), YoriShTimingBucketNames[Bucket]);
+    }
+    YoriShTimingAppend(Report, _T("\n"));
+
+    for (Phase = 0; Phase < YoriShTimingPhaseBeyondMax; Phase++) {
+        Stats = &YoriShTiming.Phases[Phase];
+        YoriShTimingAppend(Report, _T("%-8s"), YoriShTimingPhaseNames[Phase]);
+        for (Bucket = 0; Bucket < YORI_SH_TIMING_BUCKETS; Bucket++) {
+            YoriShTimingAppend(Report, _T(" %7i"), Stats->Buckets[Bucket]);
+        }
+        YoriShTimingAppend(Report, _T("\n"));
+    }
+
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -795,6 +795,9 @@ YoriShWaitForProcessToTerminate(
     HANDLE WaitHandle;
     YORI_SH_WAIT_INPUT_CONTEXT WaitContext;
     YORI_SH_WAIT_OUTCOME Outcome;
+    LARGE_INTEGER PhaseStartTime;
+
+    YoriShTimingStart(&PhaseStartTime);
 
     //
     //  If the child isn't running under a debugger, by this point redirection
@@ -847,6 +850,8 @@ YoriShWaitForProcessToTerminate(
 
         if (Outcome == YoriShWaitOutcomeProcessExit) {
 
+            YoriShTimingRecord(YoriShTimingPhaseRun, &PhaseStartTime);
+
             //
             //  Once the process has completed, if it's outputting to
             //  buffers, wait for the buffers to contain final data.
@@ -863,6 +868,7 @@ YoriShWaitForProcessToTerminate(
 
                 YoriLibShWaitForProcessBufferToFinalize(ExecContext->StdErr.Buffer.ProcessBuffers);
             }
+            YoriShTimingRecord(YoriShTimingPhaseDrain, &PhaseStartTime);
             break;
         }
 
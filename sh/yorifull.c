@@ -76,6 +76,11 @@ YORI_CMD_BUILTIN YoriCmd_YCHARMAP;
  */
 YORI_CMD_BUILTIN YoriCmd_CHDIR;
 
+/**
+ Declaration for the builtin command.
+ */
+YORI_CMD_BUILTIN YoriCmd_CMDTIME;
+
 /**
  Declaration for the builtin command.
  */
@@ -296,6 +301,11 @@ YORI_CMD_BUILTIN YoriCmd_INTCMP;
  */
 YORI_CMD_BUILTIN YoriCmd_JOB;
 
+/**
+ Declaration for the builtin command.
+ */
+YORI_CMD_BUILTIN YoriCmd_JOBPOOL;
+
 /**
  Declaration for the builtin command.
  */
@@ -585,6 +595,7 @@ YoriShBuiltins[] = {
                     {_T("CAB"),       YoriCmd_CAB},
                     {_T("CAL"),       YoriCmd_YCAL},
                     {_T("CHDIR"),     YoriCmd_CHDIR},
+                    {_T("CMDTIME"),   YoriCmd_CMDTIME},
                     {_T("COLOR"),     YoriCmd_COLOR},
                     {_T("CONTOOL"),   YoriCmd_CONTOOL},
                     {_T("CSHOT"),     YoriCmd_CSHOT},
@@ -607,14 +618,15 @@ YoriShBuiltins[] = {
                     {_T("INITOOL"),   YoriCmd_INITOOL},
                     {_T("INTCMP"),    YoriCmd_INTCMP},
                     {_T("JOB"),       YoriCmd_JOB},
+                    {_T("JOBPOOL"),   YoriCmd_JOBPOOL},
                     {_T("LINES"),     YoriCmd_LINES},
                     {_T("NICE"),      YoriCmd_NICE},
                     {_T("OSVER"),     YoriCmd_OSVER},
                     {_T("PETOOL"),    YoriCmd_PETOOL},
                     {_T("PROCINFO"),  YoriCmd_PROCINFO},
                     {_T("PUSHD"),     YoriCmd_PUSHD},
-                    {_T("REM"),       YoriCmd_REM},
                     {_T("READLINE"),  YoriCmd_READLINE},
+                    {_T("REM"),       YoriCmd_REM},
                     {_T("REPL"),      YoriCmd_REPL},
                     {_T("SCUT"),      YoriCmd_SCUT},
                     {_T("SDIR"),      YoriCmd_SDIR},
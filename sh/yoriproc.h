@@ -54,6 +54,11 @@ YoriShExpandAlias(
     __inout PYORI_LIBSH_CMD_CONTEXT CmdContext
     );
 
+BOOLEAN
+YoriShCommandMayBeAlias(
+    __in PYORI_STRING CommandString
+    );
+
 __success(return)
 BOOL
 YoriShExpandAliasFromString(
@@ -139,6 +144,12 @@ YoriShExecuteBuiltinString(
 
 // *** COMPLETE.C ***
 
+BOOL
+YoriShEnableCompletionCache(VOID);
+
+VOID
+YoriShCleanupCompletionCache(VOID);
+
 VOID
 YoriShClearTabCompletionMatches(
     __inout PYORI_SH_INPUT_BUFFER Buffer
@@ -191,6 +202,34 @@ YoriShCompleteSuggestion(
     __inout PYORI_SH_INPUT_BUFFER Buffer
     );
 
+__success(return != NULL)
+PYORI_SH_SUGGESTION_WORKER
+YoriShStartSuggestionWorker(
+    __in PYORI_SH_INPUT_BUFFER Buffer
+    );
+
+BOOLEAN
+YoriShIsSuggestionWorkerCurrent(
+    __in PYORI_SH_SUGGESTION_WORKER Worker,
+    __in PYORI_SH_INPUT_BUFFER Buffer
+    );
+
+VOID
+YoriShCancelSuggestionWorker(
+    __inout PYORI_SH_SUGGESTION_WORKER Worker
+    );
+
+VOID
+YoriShCompleteSuggestionWorker(
+    __inout PYORI_SH_SUGGESTION_WORKER Worker,
+    __inout PYORI_SH_INPUT_BUFFER Buffer
+    );
+
+VOID
+YoriShFreeSuggestionWorker(
+    __in PYORI_SH_SUGGESTION_WORKER Worker
+    );
+
 // *** ENV.C ***
 
 BOOLEAN
@@ -198,6 +237,9 @@ YoriShIsEnvironmentVariableChar(
     __in TCHAR Char
     );
 
+VOID
+YoriShCleanupEnvironmentCache(VOID);
+
 __success(return != 0)
 YORI_ALLOC_SIZE_T
 YoriShGetEnvironmentVariableWithoutSubstitution(
@@ -267,6 +309,23 @@ YoriShExecuteExpressionAndCaptureOutput(
     __out PYORI_STRING ProcessOutput
     );
 
+__success(return)
+BOOL
+YoriShEvaluateBackquote(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ProcessOutput,
+    __in PVOID Context
+    );
+
+__success(return)
+BOOL
+YoriShExpandBackquotesWithCallback(
+    __in PYORI_STRING Expression,
+    __in PYORI_SH_EVALUATE_BACKQUOTE_FN EvaluateFn,
+    __in_opt PVOID Context,
+    __out PYORI_STRING ResultingExpression
+    );
+
 __success(return)
 BOOL
 YoriShExpandBackquotes(
@@ -303,6 +362,23 @@ YoriShRemoveOneHistoryEntry(
 VOID
 YoriShClearAllHistory(VOID);
 
+VOID
+YoriShEnsureHistoryLoaded(VOID);
+
+PYORI_SH_HISTORY_ENTRY
+YoriShFindPreviousHistoryEntryByPrefix(
+    __in PYORI_STRING Prefix,
+    __in_opt PYORI_SH_HISTORY_ENTRY PreviousMatch
+    );
+
+__success(return)
+BOOL
+YoriShFindFrecentArg(
+    __in PYORI_STRING Prefix,
+    __in BOOLEAN IsCommand,
+    __out PYORI_STRING Found
+    );
+
 __success(return)
 BOOL
 YoriShInitHistory(VOID);
@@ -384,6 +460,14 @@ YoriShJobWait(
     __in DWORD JobId
     );
 
+__success(return)
+BOOL
+YoriShJobWaitForAny(
+    __in DWORD JobCount,
+    __in_ecount(JobCount) PDWORD JobIds,
+    __out PDWORD CompletedJobId
+    );
+
 __success(return)
 BOOL
 YoriShGetJobOutput(
@@ -438,6 +522,9 @@ YoriShDisplayPrompt(VOID);
 BOOL
 YoriShExecPreCommandString(VOID);
 
+VOID
+YoriShCleanupPromptCache(VOID);
+
 // *** RESTART.C ***
 
 BOOL
@@ -456,6 +543,31 @@ YoriShDiscardSavedRestartState(
     __in_opt PYORI_STRING ProcessId
     );
 
+// *** TIMING.C ***
+
+VOID
+YoriShTimingStart(
+    __out PLARGE_INTEGER StartTime
+    );
+
+VOID
+YoriShTimingBeginCommand(VOID);
+
+VOID
+YoriShTimingRecord(
+    __in YORI_SH_TIMING_PHASE Phase,
+    __inout PLARGE_INTEGER StartTime
+    );
+
+VOID
+YoriShTimingReset(VOID);
+
+__success(return)
+BOOL
+YoriShTimingGetReport(
+    __out PYORI_STRING Report
+    );
+
 // *** WAIT.C ***
 
 VOID
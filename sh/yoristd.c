@@ -36,6 +36,11 @@ YORI_CMD_BUILTIN YoriCmd_ALIAS;
  */
 YORI_CMD_BUILTIN YoriCmd_CHDIR;
 
+/**
+ Declaration for the builtin command.
+ */
+YORI_CMD_BUILTIN YoriCmd_CMDTIME;
+
 /**
  Declaration for the builtin command.
  */
@@ -91,6 +96,11 @@ YORI_CMD_BUILTIN YoriCmd_INTCMP;
  */
 YORI_CMD_BUILTIN YoriCmd_JOB;
 
+/**
+ Declaration for the builtin command.
+ */
+YORI_CMD_BUILTIN YoriCmd_JOBPOOL;
+
 /**
  Declaration for the builtin command.
  */
@@ -158,6 +168,7 @@ CONST YORI_SH_BUILTIN_NAME_MAPPING
 YoriShBuiltins[] = {
                     {_T("ALIAS"),     YoriCmd_ALIAS},
                     {_T("CHDIR"),     YoriCmd_CHDIR},
+                    {_T("CMDTIME"),   YoriCmd_CMDTIME},
                     {_T("COLOR"),     YoriCmd_COLOR},
                     {_T("DIRENV"),    YoriCmd_DIRENV},
                     {_T("ECHO"),      YoriCmd_YECHO},
@@ -169,6 +180,7 @@ YoriShBuiltins[] = {
                     {_T("IF"),        YoriCmd_IF},
                     {_T("INTCMP"),    YoriCmd_INTCMP},
                     {_T("JOB"),       YoriCmd_JOB},
+                    {_T("JOBPOOL"),   YoriCmd_JOBPOOL},
                     {_T("NICE"),      YoriCmd_NICE},
                     {_T("PUSHD"),     YoriCmd_PUSHD},
                     {_T("REM"),       YoriCmd_REM},
@@ -35,7 +35,14 @@ typedef struct _YORI_SH_HISTORY_ENTRY {
     YORI_LIST_ENTRY ListEntry;
 
     /**
-     The command that was executed by the user.
+     The links for this history entry within its prefix index bucket.  If
+     the entry is too short to be indexed, Next is NULL.
+     */
+    YORI_LIST_ENTRY IndexListEntry;
+
+    /**
+     The command that was executed by the user.  This refers to memory
+     which also contains the history entry itself.
      */
     YORI_STRING CmdLine;
 } YORI_SH_HISTORY_ENTRY, *PYORI_SH_HISTORY_ENTRY;
@@ -156,6 +163,20 @@ typedef struct _YORI_SH_TAB_COMPLETE_CONTEXT {
      */
     YORI_ALLOC_SIZE_T SearchStringOffset;
 
+    /**
+     If non-NULL, the match list is being populated on a background thread
+     and this event is signalled when the result is no longer needed, so
+     population should stop as soon as possible.
+     */
+    HANDLE CancelEvent;
+
+    /**
+     Set to TRUE if population on a background thread stopped because it
+     requires an operation that can only be performed on the input thread,
+     such as executing a completion script.
+     */
+    BOOLEAN RequiresInputThread;
+
 } YORI_SH_TAB_COMPLETE_CONTEXT, *PYORI_SH_TAB_COMPLETE_CONTEXT;
 
 /**
@@ -320,21 +341,42 @@ typedef struct _YORI_SH_INPUT_BUFFER {
 } YORI_SH_INPUT_BUFFER, *PYORI_SH_INPUT_BUFFER;
 
 /**
- A structure defining a mapping between a command name and a function to
- execute.  This is used to populate builtin commands.
+ State for calculating a suggestion on a background thread while the input
+ thread continues to process keystrokes.
  */
-typedef struct _YORI_SH_BUILTIN_NAME_MAPPING {
+typedef struct _YORI_SH_SUGGESTION_WORKER {
 
     /**
-     The command name.
+     Handle to the thread calculating the suggestion.
      */
-    LPTSTR CommandName;
+    HANDLE Thread;
 
     /**
-     Pointer to the function to execute.
+     An event signalled to indicate the suggestion is no longer needed.
      */
-    PYORI_CMD_BUILTIN BuiltinFn;
-} YORI_SH_BUILTIN_NAME_MAPPING, *PYORI_SH_BUILTIN_NAME_MAPPING;
+    HANDLE CancelEvent;
+
+    /**
+     Set to TRUE by the input thread if the input buffer has changed since
+     the suggestion was requested, so the result should be discarded.
+     */
+    BOOLEAN Cancelled;
+
+    /**
+     A private input buffer used by the background thread.  This contains a
+     copy of the input when the suggestion was requested, and on completion
+     contains the match list and suggestion string.
+     */
+    YORI_SH_INPUT_BUFFER Buffer;
+
+} YORI_SH_SUGGESTION_WORKER, *PYORI_SH_SUGGESTION_WORKER;
+
+/**
+ A structure defining a mapping between a command name and a function to
+ execute.  This is used to populate builtin commands, and tables of these
+ must be sorted by command name.
+ */
+typedef YORI_LIBSH_BUILTIN_NAME_MAPPING YORI_SH_BUILTIN_NAME_MAPPING, *PYORI_SH_BUILTIN_NAME_MAPPING;
 
 /**
  A structure defining an initial mapping of alias to value.
@@ -412,6 +454,20 @@ typedef enum _YORI_SH_WAIT_OUTCOME {
     YoriShWaitOutcomeLoseFocus = 3
 } YORI_SH_WAIT_OUTCOME;
 
+/**
+ A phase of command execution whose duration can be measured when command
+ timing is enabled.
+ */
+typedef enum _YORI_SH_TIMING_PHASE {
+    YoriShTimingPhaseParse = 0,
+    YoriShTimingPhaseExpand = 1,
+    YoriShTimingPhaseLookup = 2,
+    YoriShTimingPhaseLaunch = 3,
+    YoriShTimingPhaseRun = 4,
+    YoriShTimingPhaseDrain = 5,
+    YoriShTimingPhaseBeyondMax = 6
+} YORI_SH_TIMING_PHASE;
+
 /**
  A structure containing state that is global across the Yori shell process.
  */
@@ -627,6 +683,12 @@ typedef struct _YORI_SH_GLOBALS {
      */
     BOOLEAN CompletionListAll;
 
+    /**
+     Set to TRUE to measure the time spent in each phase of executing a
+     command.  This is controlled by the YORICMDTIMING variable.
+     */
+    BOOLEAN CommandTimingEnabled;
+
     /**
      TRUE if mouseover support is enabled, FALSE if it is disabled.  Note this
      is currently enabled by default.
@@ -646,6 +708,32 @@ typedef struct _YORI_SH_GLOBALS {
 
 } YORI_SH_GLOBALS, *PYORI_SH_GLOBALS;
 
+/**
+ A function to evaluate a single backquote expression and return the text
+ that should be substituted in its place.
+
+ @param Expression The backquote expression to evaluate.
+
+ @param ProcessOutput On successful completion, populated with the text to
+        substitute.
+
+ @param Context Caller supplied context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+typedef
+BOOL
+YORI_SH_EVALUATE_BACKQUOTE_FN(
+    __in PYORI_STRING Expression,
+    __out PYORI_STRING ProcessOutput,
+    __in PVOID Context
+    );
+
+/**
+ A pointer to a function to evaluate a single backquote expression.
+ */
+typedef YORI_SH_EVALUATE_BACKQUOTE_FN *PYORI_SH_EVALUATE_BACKQUOTE_FN;
+
 extern YORI_SH_GLOBALS YoriShGlobal;
 
 // vim:sw=4:ts=4:et:
@@ -56,6 +56,12 @@ SplitHelp(VOID)
     return TRUE;
 }
 
+/**
+ The maximum number of bytes to clone in a single request.  This is a
+ multiple of any cluster size.
+ */
+#define SPLIT_BLOCK_CLONE_CHUNK_SIZE (1024 * 1024 * 1024)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -68,6 +74,13 @@ typedef struct _SPLIT_CONTEXT {
      */
     BOOL LinesMode;
 
+    /**
+     If TRUE, the target volume supports sharing extents between files, so
+     data can be cloned rather than copied when the source is on the same
+     volume and offsets are cluster aligned.
+     */
+    BOOLEAN BlockClone;
+
     /**
      If LinesMode is FALSE, specifies the number of bytes per part.
      */
@@ -89,8 +102,420 @@ typedef struct _SPLIT_CONTEXT {
      */
     YORI_STRING Prefix;
 
+    /**
+     Two buffers used to copy data.  While one is being written, the next
+     block of data is read into the other.
+     */
+    PUCHAR Buffers[2];
+
+    /**
+     The length of each buffer in Buffers, in bytes.
+     */
+    DWORD BufferLength;
+
+    /**
+     If BlockClone is TRUE, the serial number of the target volume.
+     */
+    DWORD BlockCloneVolumeSerial;
+
+    /**
+     If BlockClone is TRUE, the cluster size of the target volume.  Clone
+     requests must be aligned to this size.
+     */
+    DWORD BlockCloneClusterSize;
+
 } SPLIT_CONTEXT, *PSPLIT_CONTEXT;
 
+/**
+ Allocate the buffers used to copy data.  The size of each buffer is fixed
+ regardless of the size of each part, so memory use is constant.
+
+ @param SplitContext Pointer to the context to allocate buffers for.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SplitAllocateBuffers(
+    __inout PSPLIT_CONTEXT SplitContext
+    )
+{
+    SplitContext->BufferLength = YoriLibMaximumAllocationInRange(60 * 1024, 1024 * 1024);
+    SplitContext->Buffers[0] = YoriLibMalloc(SplitContext->BufferLength * 2);
+    if (SplitContext->Buffers[0] == NULL) {
+        return FALSE;
+    }
+    SplitContext->Buffers[1] = SplitContext->Buffers[0] + SplitContext->BufferLength;
+    return TRUE;
+}
+
+/**
+ Free the buffers used to copy data.
+
+ @param SplitContext Pointer to the context to free buffers for.
+ */
+VOID
+SplitFreeBuffers(
+    __inout PSPLIT_CONTEXT SplitContext
+    )
+{
+    if (SplitContext->Buffers[0] != NULL) {
+        YoriLibFree(SplitContext->Buffers[0]);
+        SplitContext->Buffers[0] = NULL;
+        SplitContext->Buffers[1] = NULL;
+    }
+}
+
+/**
+ Determine whether the volume containing a target path supports cloning
+ extents between files, and if so, record its serial number and cluster
+ size.
+
+ @param SplitContext Pointer to the context to update.
+
+ @param Path Pointer to a fully qualified path on the target volume.
+ */
+VOID
+SplitDetectBlockClone(
+    __inout PSPLIT_CONTEXT SplitContext,
+    __in PYORI_STRING Path
+    )
+{
+    YORI_STRING VolRootName;
+    DWORD VolumeSerial;
+    DWORD MaxComponentLength;
+    DWORD Capabilities;
+    DWORD SectorsPerCluster;
+    DWORD SectorSize;
+    DWORD FreeClusters;
+    DWORD TotalClusters;
+
+    SplitContext->BlockClone = FALSE;
+
+    YoriLibInitEmptyString(&VolRootName);
+    if (!YoriLibGetVolumePathName(Path, &VolRootName)) {
+        return;
+    }
+
+    //
+    //  GetVolumeInformation wants a name with a trailing backslash.  Add one
+    //  if needed.
+    //
+
+    if (VolRootName.LengthInChars > 0 &&
+        VolRootName.LengthInChars + 1 < VolRootName.LengthAllocated &&
+        VolRootName.StartOfString[VolRootName.LengthInChars - 1] != '\\') {
+
+        VolRootName.StartOfString[VolRootName.LengthInChars] = '\\';
+        VolRootName.StartOfString[VolRootName.LengthInChars + 1] = '\0';
+        VolRootName.LengthInChars++;
+    }
+
+    if (GetVolumeInformation(VolRootName.StartOfString,
+                             NULL,
+                             0,
+                             &VolumeSerial,
+                             &MaxComponentLength,
+                             &Capabilities,
+                             NULL,
+                             0) &&
+        (Capabilities & FILE_SUPPORTS_BLOCK_REFCOUNTING) != 0 &&
+        GetDiskFreeSpace(VolRootName.StartOfString,
+                         &SectorsPerCluster,
+                         &SectorSize,
+                         &FreeClusters,
+                         &TotalClusters) &&
+        SectorsPerCluster * SectorSize != 0) {
+
+        SplitContext->BlockCloneVolumeSerial = VolumeSerial;
+        SplitContext->BlockCloneClusterSize = SectorsPerCluster * SectorSize;
+        SplitContext->BlockClone = TRUE;
+    }
+
+    YoriLibFreeStringContents(&VolRootName);
+}
+
+/**
+ Determine whether data from a source handle can be cloned into the target
+ volume.
+
+ @param SplitContext Pointer to the context describing the target volume.
+
+ @param hSource Handle to the source.
+
+ @param FileSize On successful completion, updated to contain the size of
+        the source file.
+
+ @return TRUE if the source is a regular file on the target volume, FALSE if
+         its data must be copied.
+ */
+BOOLEAN
+SplitCanCloneFrom(
+    __in PSPLIT_CONTEXT SplitContext,
+    __in HANDLE hSource,
+    __out PDWORDLONG FileSize
+    )
+{
+    BY_HANDLE_FILE_INFORMATION SourceInfo;
+    LARGE_INTEGER Size;
+
+    if (!SplitContext->BlockClone ||
+        GetFileType(hSource) != FILE_TYPE_DISK ||
+        !GetFileInformationByHandle(hSource, &SourceInfo) ||
+        SourceInfo.dwVolumeSerialNumber != SplitContext->BlockCloneVolumeSerial ||
+        (SourceInfo.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0) {
+
+        return FALSE;
+    }
+
+    Size.HighPart = SourceInfo.nFileSizeHigh;
+    Size.LowPart = SourceInfo.nFileSizeLow;
+    *FileSize = Size.QuadPart;
+    return TRUE;
+}
+
+/**
+ Clone a range of a source file into a target file, so the target shares
+ storage with the source rather than having data copied.  Both offsets must
+ be cluster aligned.  The target is extended to contain the range.
+
+ @param SplitContext Pointer to the context describing the target volume.
+
+ @param hSource Handle to the source file.
+
+ @param SourceOffset Offset within the source file to clone from.
+
+ @param hTarget Handle to the target file.
+
+ @param TargetOffset Offset within the target file to clone to.
+
+ @param Length The number of bytes to clone.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SplitCloneRange(
+    __in PSPLIT_CONTEXT SplitContext,
+    __in HANDLE hSource,
+    __in DWORDLONG SourceOffset,
+    __in HANDLE hTarget,
+    __in DWORDLONG TargetOffset,
+    __in DWORDLONG Length
+    )
+{
+    DUPLICATE_EXTENTS_DATA DuplicateExtents;
+    LARGE_INTEGER Offset;
+    DWORDLONG BytesRemaining;
+    DWORDLONG BytesDone;
+    DWORD BytesReturned;
+    DWORD LastError;
+
+    ASSERT((SourceOffset % SplitContext->BlockCloneClusterSize) == 0);
+    ASSERT((TargetOffset % SplitContext->BlockCloneClusterSize) == 0);
+
+    //
+    //  The target needs to be large enough to contain the cloned range
+    //  before extents can be cloned into it.
+    //
+
+    Offset.QuadPart = TargetOffset + Length;
+    if (SetFilePointer(hTarget, Offset.LowPart, &Offset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+        GetLastError() != NO_ERROR) {
+
+        return FALSE;
+    }
+
+    if (!SetEndOfFile(hTarget)) {
+        return FALSE;
+    }
+
+    //
+    //  Clone requests must be in whole clusters.  The final cluster can
+    //  extend beyond the end of the file.
+    //
+
+    BytesRemaining = Length;
+    if ((BytesRemaining % SplitContext->BlockCloneClusterSize) != 0) {
+        BytesRemaining = (BytesRemaining / SplitContext->BlockCloneClusterSize + 1) * SplitContext->BlockCloneClusterSize;
+    }
+
+    BytesDone = 0;
+    DuplicateExtents.FileHandle = hSource;
+    while (BytesRemaining > 0) {
+        DuplicateExtents.SourceFileOffset.QuadPart = SourceOffset + BytesDone;
+        DuplicateExtents.TargetFileOffset.QuadPart = TargetOffset + BytesDone;
+        DuplicateExtents.ByteCount.QuadPart = BytesRemaining;
+        if (BytesRemaining > SPLIT_BLOCK_CLONE_CHUNK_SIZE) {
+            DuplicateExtents.ByteCount.QuadPart = SPLIT_BLOCK_CLONE_CHUNK_SIZE;
+        }
+
+        if (!DeviceIoControl(hTarget, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &DuplicateExtents, sizeof(DuplicateExtents), NULL, 0, &BytesReturned, NULL)) {
+
+            //
+            //  If the file system doesn't support this at all, don't try
+            //  again for later parts.
+            //
+
+            LastError = GetLastError();
+            if (LastError == ERROR_INVALID_FUNCTION || LastError == ERROR_NOT_SUPPORTED) {
+                SplitContext->BlockClone = FALSE;
+            }
+            return FALSE;
+        }
+
+        BytesDone = BytesDone + DuplicateExtents.ByteCount.QuadPart;
+        BytesRemaining = BytesRemaining - DuplicateExtents.ByteCount.QuadPart;
+    }
+
+    return TRUE;
+}
+
+/**
+ Copy data from a source stream to a target file.  The source is read
+ synchronously, since it may be a pipe, and the target is written with
+ overlapped IO, so the next block is read while the previous one is being
+ written.
+
+ @param SplitContext Pointer to the context containing the buffers to use.
+
+ @param hSource Handle to the source stream.
+
+ @param hTarget Handle to the target file, which must have been opened for
+        overlapped IO.
+
+ @param TargetOffset Offset within the target file to write to.
+
+ @param MaxBytes The maximum number of bytes to copy.  The copy also ends
+        when the source reaches end of file.
+
+ @param InitialBytes The number of bytes already read into the first buffer
+        in the context, which should be written before any further reads.
+
+ @param BytesCopied On successful completion, updated to contain the number
+        of bytes written to the target.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SplitCopyRange(
+    __in PSPLIT_CONTEXT SplitContext,
+    __in HANDLE hSource,
+    __in HANDLE hTarget,
+    __in DWORDLONG TargetOffset,
+    __in DWORDLONG MaxBytes,
+    __in DWORD InitialBytes,
+    __out PDWORDLONG BytesCopied
+    )
+{
+    OVERLAPPED Overlapped;
+    LARGE_INTEGER Offset;
+    DWORDLONG TotalRead;
+    DWORD BytesRead;
+    DWORD BytesToRead;
+    DWORD BytesWritten;
+    DWORD WriteLength;
+    DWORD Current;
+    DWORD LastError;
+    LPTSTR ErrText;
+    BOOLEAN Pending;
+    BOOLEAN Result;
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Overlapped.hEvent == NULL) {
+        return FALSE;
+    }
+
+    Result = FALSE;
+    Pending = FALSE;
+    WriteLength = 0;
+    Current = 0;
+    Offset.QuadPart = TargetOffset;
+    TotalRead = InitialBytes;
+    BytesRead = InitialBytes;
+    LastError = ERROR_SUCCESS;
+
+    if (BytesRead == 0 && MaxBytes > 0) {
+        BytesToRead = SplitContext->BufferLength;
+        if (BytesToRead > MaxBytes) {
+            BytesToRead = (DWORD)MaxBytes;
+        }
+        if (!ReadFile(hSource, SplitContext->Buffers[Current], BytesToRead, &BytesRead, NULL)) {
+            BytesRead = 0;
+        }
+        TotalRead = BytesRead;
+    }
+
+    while (TRUE) {
+
+        //
+        //  Wait for the previous write to complete before issuing another,
+        //  which also allows the buffer it used to be filled again.
+        //
+
+        if (Pending) {
+            Pending = FALSE;
+            if (!GetOverlappedResult(hTarget, &Overlapped, &BytesWritten, TRUE) ||
+                BytesWritten != WriteLength) {
+
+                LastError = GetLastError();
+                break;
+            }
+        }
+
+        if (BytesRead == 0) {
+            Result = TRUE;
+            break;
+        }
+
+        Overlapped.Offset = Offset.LowPart;
+        Overlapped.OffsetHigh = Offset.HighPart;
+        WriteLength = BytesRead;
+        if (!WriteFile(hTarget, SplitContext->Buffers[Current], WriteLength, NULL, &Overlapped)) {
+            LastError = GetLastError();
+            if (LastError != ERROR_IO_PENDING) {
+                break;
+            }
+            LastError = ERROR_SUCCESS;
+        }
+        Pending = TRUE;
+        Offset.QuadPart = Offset.QuadPart + WriteLength;
+
+        //
+        //  While the write is in progress, read the next block into the
+        //  other buffer.
+        //
+
+        Current = (Current + 1) % 2;
+        BytesRead = 0;
+        if (TotalRead < MaxBytes) {
+            BytesToRead = SplitContext->BufferLength;
+            if (BytesToRead > MaxBytes - TotalRead) {
+                BytesToRead = (DWORD)(MaxBytes - TotalRead);
+            }
+            if (!ReadFile(hSource, SplitContext->Buffers[Current], BytesToRead, &BytesRead, NULL)) {
+                BytesRead = 0;
+            }
+            TotalRead = TotalRead + BytesRead;
+        }
+    }
+
+    if (Pending) {
+        GetOverlappedResult(hTarget, &Overlapped, &BytesWritten, TRUE);
+    }
+
+    CloseHandle(Overlapped.hEvent);
+
+    if (!Result) {
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    *BytesCopied = (DWORDLONG)(Offset.QuadPart - TargetOffset);
+    return TRUE;
+}
+
 /**
  Open a file in which to output the result of a fragment of the split
  operation.
@@ -98,16 +523,23 @@ typedef struct _SPLIT_CONTEXT {
  @param SplitContext Pointer to a context describing the split operation
         and its current state.
 
+ @param Overlapped If TRUE, the file is opened for overlapped IO and can be
+        used as a clone target.  If FALSE, the file is opened for synchronous
+        writes.
+
  @return Handle to the opened object, or NULL on failure.
  */
 HANDLE
 SplitOpenTargetForCurrentPart(
-    __in PSPLIT_CONTEXT SplitContext
+    __in PSPLIT_CONTEXT SplitContext,
+    __in BOOLEAN Overlapped
     )
 {
     LPTSTR NewFileName;
     YORI_STRING NumberString;
     HANDLE hDestFile;
+    DWORD DesiredAccess;
+    DWORD FlagsAndAttributes;
 
     YoriLibInitEmptyString(&NumberString);
     if (!YoriLibNumberToString(&NumberString, SplitContext->CurrentPartNumber, 10, 0, '\0')) {
@@ -123,12 +555,19 @@ SplitOpenTargetForCurrentPart(
     YoriLibSPrintf(NewFileName, _T("%y%y"), &SplitContext->Prefix, &NumberString);
     YoriLibFreeStringContents(&NumberString);
 
+    DesiredAccess = GENERIC_WRITE;
+    FlagsAndAttributes = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS;
+    if (Overlapped) {
+        DesiredAccess = GENERIC_READ | GENERIC_WRITE;
+        FlagsAndAttributes = FlagsAndAttributes | FILE_FLAG_OVERLAPPED;
+    }
+
     hDestFile = CreateFile(NewFileName,
-                           GENERIC_WRITE,
+                           DesiredAccess,
                            FILE_SHARE_READ|FILE_SHARE_DELETE,
                            NULL,
                            CREATE_ALWAYS,
-                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                           FlagsAndAttributes,
                            NULL);
     if (hDestFile == INVALID_HANDLE_VALUE) {
         DWORD LastError = GetLastError();
@@ -181,7 +620,7 @@ SplitProcessStream(
             }
 
             if (hDestFile == NULL) {
-                hDestFile = SplitOpenTargetForCurrentPart(SplitContext);
+                hDestFile = SplitOpenTargetForCurrentPart(SplitContext, FALSE);
                 if (hDestFile == NULL) {
                     YoriLibLineReadCloseOrCache(LineContext);
                     YoriLibFreeStringContents(&LineString);
@@ -197,44 +636,106 @@ SplitProcessStream(
         YoriLibLineReadCloseOrCache(LineContext);
         YoriLibFreeStringContents(&LineString);
     } else {
-        PVOID Buffer;
-        ULONG BytesRead;
+        LARGE_INTEGER SourceOffset;
+        DWORDLONG FileSize;
+        DWORDLONG BytesThisPart;
+        DWORDLONG BytesCopied;
+        DWORD BytesRead;
+        DWORD BytesToRead;
+        BOOLEAN Cloned;
 
-        Buffer = YoriLibMalloc((YORI_ALLOC_SIZE_T)SplitContext->BytesPerPart);
-        if (Buffer == NULL) {
-            return FALSE;
+        //
+        //  If the source is a file on a volume that supports cloning and
+        //  each part starts on a cluster boundary, parts can share storage
+        //  with the source file.  Otherwise each part is copied through a
+        //  pair of fixed size buffers.
+        //
+
+        SourceOffset.QuadPart = 0;
+        FileSize = 0;
+        if (SplitCanCloneFrom(SplitContext, hSource, &FileSize)) {
+            SourceOffset.LowPart = SetFilePointer(hSource, 0, &SourceOffset.HighPart, FILE_CURRENT);
+            if ((SourceOffset.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) ||
+                (SourceOffset.QuadPart % SplitContext->BlockCloneClusterSize) != 0 ||
+                (SplitContext->BytesPerPart % SplitContext->BlockCloneClusterSize) != 0) {
+
+                SplitContext->BlockClone = FALSE;
+            }
+        } else {
+            SplitContext->BlockClone = FALSE;
         }
 
         while (TRUE) {
-            if (!ReadFile(hSource, Buffer, (YORI_ALLOC_SIZE_T)SplitContext->BytesPerPart, &BytesRead, NULL)) {
-                break;
-            }
+            Cloned = FALSE;
+            BytesRead = 0;
+            if (SplitContext->BlockClone) {
+                if ((DWORDLONG)SourceOffset.QuadPart >= FileSize) {
+                    break;
+                }
 
-            if (BytesRead == 0) {
-                break;
+                BytesThisPart = FileSize - SourceOffset.QuadPart;
+                if (BytesThisPart > (DWORDLONG)SplitContext->BytesPerPart) {
+                    BytesThisPart = SplitContext->BytesPerPart;
+                }
+            } else {
+
+                //
+                //  Read the first block before creating the part, so no
+                //  empty part is created when input ends.
+                //
+
+                BytesToRead = SplitContext->BufferLength;
+                if ((YORI_MAX_SIGNED_T)BytesToRead > SplitContext->BytesPerPart) {
+                    BytesToRead = (DWORD)SplitContext->BytesPerPart;
+                }
+
+                if (!ReadFile(hSource, SplitContext->Buffers[0], BytesToRead, &BytesRead, NULL)) {
+                    break;
+                }
+
+                if (BytesRead == 0) {
+                    break;
+                }
             }
 
-            hDestFile = SplitOpenTargetForCurrentPart(SplitContext);
+            hDestFile = SplitOpenTargetForCurrentPart(SplitContext, TRUE);
             if (hDestFile == NULL) {
-                YoriLibFree(Buffer);
                 return FALSE;
             }
             SplitContext->CurrentPartNumber++;
 
-            if (!WriteFile(hDestFile, Buffer, BytesRead, &BytesRead, NULL)) {
-                DWORD LastError = GetLastError();
-                LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write failed: %s"), ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-                CloseHandle(hDestFile);
-                YoriLibFree(Buffer);
-                return FALSE;
+            if (SplitContext->BlockClone) {
+                if (SplitCloneRange(SplitContext, hSource, SourceOffset.QuadPart, hDestFile, 0, BytesThisPart)) {
+                    Cloned = TRUE;
+                } else {
+
+                    //
+                    //  If cloning fails, copy this part and every one after
+                    //  it, starting from where this part should begin.
+                    //
+
+                    SplitContext->BlockClone = FALSE;
+                    if (SetFilePointer(hDestFile, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER ||
+                        !SetEndOfFile(hDestFile) ||
+                        (SetFilePointer(hSource, SourceOffset.LowPart, &SourceOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+                         GetLastError() != NO_ERROR)) {
+
+                        CloseHandle(hDestFile);
+                        return FALSE;
+                    }
+                }
+                SourceOffset.QuadPart = SourceOffset.QuadPart + BytesThisPart;
+            }
+
+            if (!Cloned) {
+                if (!SplitCopyRange(SplitContext, hSource, hDestFile, 0, SplitContext->BytesPerPart, BytesRead, &BytesCopied)) {
+                    CloseHandle(hDestFile);
+                    return FALSE;
+                }
             }
 
             CloseHandle(hDestFile);
         }
-
-        YoriLibFree(Buffer);
     }
 
     return TRUE;
@@ -244,8 +745,8 @@ SplitProcessStream(
  Join a series of files with a given prefix back into a single file.  This is
  the inverse of split.
 
- @param Prefix Pointer to the string containing the prefix name of the set of
-        files.
+ @param SplitContext Pointer to a context containing the prefix name of the
+        set of files and buffers to use.
 
  @param OutputFile Pointer to the string containing the name of the combined
         file to generate.
@@ -254,35 +755,39 @@ SplitProcessStream(
  */
 BOOL
 SplitJoin(
-    __in PYORI_STRING Prefix,
+    __in PSPLIT_CONTEXT SplitContext,
     __in PYORI_STRING OutputFile
     )
 {
     HANDLE SourceHandle;
     HANDLE TargetHandle;
-    PUCHAR Buffer;
-    DWORD BytesRead;
-    YORI_ALLOC_SIZE_T BytesAllocated;
     YORI_MAX_SIGNED_T CurrentFragment;
     LPTSTR FragmentFileName;
     YORI_STRING NumberString;
+    YORI_STRING FullOutputFile;
+    PYORI_STRING Prefix;
+    LARGE_INTEGER TargetOffset;
+    DWORDLONG FragmentSize;
+    DWORDLONG BytesCopied;
     DWORD LastError;
     LPTSTR ErrText;
+    BOOLEAN Cloned;
 
     ASSERT(YoriLibIsStringNullTerminated(OutputFile));
+    Prefix = &SplitContext->Prefix;
 
-    BytesAllocated = YoriLibMaximumAllocationInRange(60 * 1024, 256 * 1024);
-    Buffer = YoriLibMalloc(BytesAllocated);
-    if (Buffer == NULL) {
-        return FALSE;
+    YoriLibInitEmptyString(&FullOutputFile);
+    if (YoriLibUserStringToSingleFilePath(OutputFile, TRUE, &FullOutputFile)) {
+        SplitDetectBlockClone(SplitContext, &FullOutputFile);
+        YoriLibFreeStringContents(&FullOutputFile);
     }
 
     TargetHandle = CreateFile(OutputFile->StartOfString,
-                              GENERIC_WRITE,
+                              GENERIC_READ | GENERIC_WRITE,
                               FILE_SHARE_READ | FILE_SHARE_DELETE,
                               NULL,
                               CREATE_ALWAYS,
-                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
                               NULL);
 
     if (TargetHandle == NULL || TargetHandle == INVALID_HANDLE_VALUE) {
@@ -290,18 +795,17 @@ SplitJoin(
         ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: open of %y failed: %s"), OutputFile, ErrText);
         YoriLibFreeWinErrorText(ErrText);
-        YoriLibFree(Buffer);
         return FALSE;
     }
 
     CurrentFragment = 0;
+    TargetOffset.QuadPart = 0;
 
     while(TRUE) {
 
         YoriLibInitEmptyString(&NumberString);
         if (!YoriLibNumberToString(&NumberString, CurrentFragment, 10, 0, '\0')) {
             CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
             return FALSE;
         }
 
@@ -309,7 +813,6 @@ SplitJoin(
         if (FragmentFileName == NULL) {
             YoriLibFreeStringContents(&NumberString);
             CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
             return FALSE;
         }
 
@@ -334,42 +837,35 @@ SplitJoin(
             YoriLibFreeWinErrorText(ErrText);
             YoriLibFree(FragmentFileName);
             CloseHandle(TargetHandle);
-            YoriLibFree(Buffer);
             return FALSE;
         }
 
-        while(TRUE) {
+        //
+        //  If the fragment is on the same volume and would start on a
+        //  cluster boundary, clone it into place.  Any partial cluster at
+        //  its end is overwritten by the following fragment.
+        //
 
-            if (!ReadFile(SourceHandle, Buffer, BytesAllocated, &BytesRead, NULL)) {
-                LastError = GetLastError();
-                if (LastError == ERROR_HANDLE_EOF) {
-                    break;
-                }
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: read of %s failed: %s"), FragmentFileName, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
-                YoriLibFree(FragmentFileName);
-                CloseHandle(TargetHandle);
-                CloseHandle(SourceHandle);
-                YoriLibFree(Buffer);
-                return FALSE;
-            }
+        Cloned = FALSE;
+        if (SplitContext->BlockClone &&
+            (TargetOffset.QuadPart % SplitContext->BlockCloneClusterSize) == 0 &&
+            SplitCanCloneFrom(SplitContext, SourceHandle, &FragmentSize) &&
+            FragmentSize > 0) {
 
-            if (BytesRead == 0) {
-                break;
+            if (SplitCloneRange(SplitContext, SourceHandle, 0, TargetHandle, TargetOffset.QuadPart, FragmentSize)) {
+                Cloned = TRUE;
+                TargetOffset.QuadPart = TargetOffset.QuadPart + FragmentSize;
             }
+        }
 
-            if (!WriteFile(TargetHandle, Buffer, BytesRead, &BytesRead, NULL)) {
-                LastError = GetLastError();
-                ErrText = YoriLibGetWinErrorText(LastError);
-                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write to %y failed: %s"), OutputFile, ErrText);
-                YoriLibFreeWinErrorText(ErrText);
+        if (!Cloned) {
+            if (!SplitCopyRange(SplitContext, SourceHandle, TargetHandle, TargetOffset.QuadPart, (DWORDLONG)-1, 0, &BytesCopied)) {
                 YoriLibFree(FragmentFileName);
                 CloseHandle(TargetHandle);
                 CloseHandle(SourceHandle);
-                YoriLibFree(Buffer);
                 return FALSE;
             }
+            TargetOffset.QuadPart = TargetOffset.QuadPart + BytesCopied;
         }
 
         CloseHandle(SourceHandle);
@@ -377,7 +873,17 @@ SplitJoin(
         CurrentFragment++;
     }
 
-    YoriLibFree(Buffer);
+    //
+    //  Writes are issued at explicit offsets, so the file size needs to be
+    //  set explicitly in case a partial cluster was cloned past the end.
+    //
+
+    if (SetFilePointer(TargetHandle, TargetOffset.LowPart, &TargetOffset.HighPart, FILE_BEGIN) != INVALID_SET_FILE_POINTER ||
+        GetLastError() == NO_ERROR) {
+
+        SetEndOfFile(TargetHandle);
+    }
+
     CloseHandle(TargetHandle);
     return TRUE;
 }
@@ -505,7 +1011,9 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        if (!SplitJoin(&SplitContext.Prefix, &ArgV[StartArg])) {
+        if (!SplitAllocateBuffers(&SplitContext)) {
+            Result = EXIT_FAILURE;
+        } else if (!SplitJoin(&SplitContext, &ArgV[StartArg])) {
             Result = EXIT_FAILURE;
         }
     } else {
@@ -515,9 +1023,13 @@ ENTRYPOINT(
                 Result = EXIT_FAILURE;
             }
         } else {
-            if (SplitContext.BytesPerPart == 0 || SplitContext.BytesPerPart >= YORI_MAX_ALLOC_SIZE) {
+            if (SplitContext.BytesPerPart <= 0) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: invalid bytes per part\n"));
                 Result = EXIT_FAILURE;
+            } else if (!SplitAllocateBuffers(&SplitContext)) {
+                Result = EXIT_FAILURE;
+            } else {
+                SplitDetectBlockClone(&SplitContext, &SplitContext.Prefix);
             }
         }
 
@@ -587,6 +1099,8 @@ ENTRYPOINT(
         YoriLibFreeStringContents(&SplitContext.Prefix);
     }
 
+    SplitFreeBuffers(&SplitContext);
+
 #if !YORI_BUILTIN
     YoriLibLineReadCleanupCache();
 #endif
@@ -36,7 +36,10 @@ CHAR strSpongeHelpText[] =
         "Read input into memory and output once all input is read,\n"
         "  allowing the output to modify the source stream.\n"
         "\n"
-        "SPONGE [-license] [file]\n"
+        "SPONGE [-license] [-m size] [file]\n"
+        "\n"
+        "   -m             Memory to use before spilling to a temporary file,\n"
+        "                    default 64Mb\n"
         ;
 
 /**
@@ -66,10 +69,84 @@ typedef struct _SPONGE_BUFFER {
     /**
      The data buffer.
      */
-    YORI_LIB_BYTE_BUFFER ByteBuffer;
+    YORI_LIB_CHUNK_BUFFER ChunkBuffer;
+
+    /**
+     The number of bytes to hold in memory before data is moved into a
+     temporary file.
+     */
+    YORI_MAX_UNSIGNED_T MemoryLimit;
+
+    /**
+     The directory to create a temporary file in if the memory limit is
+     exceeded.  This should be on the same volume as the final target so
+     the temporary file can be renamed into place.
+     */
+    YORI_STRING SpillDirectory;
+
+    /**
+     The full path to the temporary file, if one has been created.
+     */
+    YORI_STRING SpillFileName;
+
+    /**
+     A handle to the temporary file, or NULL if all data is in memory.
+     */
+    HANDLE hSpill;
 
 } SPONGE_BUFFER, *PSPONGE_BUFFER;
 
+/**
+ The default number of bytes to hold in memory before spilling to a
+ temporary file.
+ */
+#define SPONGE_DEFAULT_MEMORY_LIMIT (64 * 1024 * 1024)
+
+/**
+ The number of bytes to allocate each time the in memory buffer needs to
+ grow.
+ */
+#define SPONGE_CHUNK_SIZE (1024 * 1024)
+
+BOOLEAN
+SpongeBufferForward(
+    __in PSPONGE_BUFFER ThisBuffer,
+    __in HANDLE hTarget
+    );
+
+/**
+ Move any data currently held in memory into the temporary file, creating
+ the temporary file if it does not already exist.
+
+ @param ThisBuffer A pointer to the process buffer set.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SpongeBufferSpill(
+    __in PSPONGE_BUFFER ThisBuffer
+    )
+{
+    YORI_STRING Prefix;
+
+    if (ThisBuffer->hSpill == NULL) {
+        YoriLibConstantString(&Prefix, _T("SPG"));
+        if (!YoriLibGetTempFileName(&ThisBuffer->SpillDirectory, &Prefix, &ThisBuffer->hSpill, &ThisBuffer->SpillFileName)) {
+            ThisBuffer->hSpill = NULL;
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: could not create temporary file in %y\n"), &ThisBuffer->SpillDirectory);
+            return FALSE;
+        }
+    }
+
+    if (!SpongeBufferForward(ThisBuffer, ThisBuffer->hSpill)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: write to temporary file failed\n"));
+        return FALSE;
+    }
+
+    YoriLibChunkBufferReset(&ThisBuffer->ChunkBuffer);
+    return TRUE;
+}
+
 /**
  Populate data from stdin into an in memory buffer.
 
@@ -89,7 +166,7 @@ SpongeBufferPump(
 
     while (TRUE) {
 
-        WriteBuffer = YoriLibByteBufferGetPointerToEnd(&ThisBuffer->ByteBuffer, 16384, &BytesAvailable);
+        WriteBuffer = YoriLibChunkBufferGetPointerToEnd(&ThisBuffer->ChunkBuffer, 16384, &BytesAvailable);
         if (WriteBuffer == NULL) {
             break;
         }
@@ -105,7 +182,19 @@ SpongeBufferPump(
                 break;
             }
 
-            YoriLibByteBufferAddToPopulatedLength(&ThisBuffer->ByteBuffer, BytesRead);
+            YoriLibChunkBufferAddToPopulatedLength(&ThisBuffer->ChunkBuffer, BytesRead);
+
+            //
+            //  Once the memory limit is reached, move the data to a
+            //  temporary file and reuse the memory buffer.  Any data left
+            //  when input ends remains in memory for the caller.
+            //
+
+            if (YoriLibChunkBufferGetValidBytes(&ThisBuffer->ChunkBuffer) >= ThisBuffer->MemoryLimit) {
+                if (!SpongeBufferSpill(ThisBuffer)) {
+                    break;
+                }
+            }
         } else {
             Result = TRUE;
             break;
@@ -130,37 +219,7 @@ SpongeBufferForward(
     __in HANDLE hTarget
     )
 {
-    YORI_MAX_UNSIGNED_T BytesSent;
-    BOOLEAN Result;
-    YORI_MAX_UNSIGNED_T BytesPopulated;
-    PUCHAR SrcBuffer;
-    YORI_ALLOC_SIZE_T BytesToWrite;
-
-    BytesSent = 0;
-    Result = TRUE;
-
-    BytesPopulated = YoriLibByteBufferGetValidBytes(&ThisBuffer->ByteBuffer);
-
-    while (BytesSent < BytesPopulated) {
-        DWORD BytesWritten;
-
-        SrcBuffer = YoriLibByteBufferGetPointerToValidData(&ThisBuffer->ByteBuffer, BytesSent, &BytesToWrite);
-
-        if (WriteFile(hTarget,
-                      SrcBuffer,
-                      BytesToWrite,
-                      &BytesWritten,
-                      NULL)) {
-
-            BytesSent += BytesWritten;
-        } else {
-            Result = FALSE;
-        }
-
-        ASSERT(BytesSent <= BytesPopulated);
-    }
-
-    return Result;
+    return YoriLibChunkBufferWriteToHandle(&ThisBuffer->ChunkBuffer, hTarget);
 }
 
 /**
@@ -175,7 +234,11 @@ SpongeAllocateBuffer(
     __out PSPONGE_BUFFER Buffer
     )
 {
-    return YoriLibByteBufferInitialize(&Buffer->ByteBuffer, 1024);
+    Buffer->MemoryLimit = SPONGE_DEFAULT_MEMORY_LIMIT;
+    Buffer->hSpill = NULL;
+    YoriLibInitEmptyString(&Buffer->SpillDirectory);
+    YoriLibInitEmptyString(&Buffer->SpillFileName);
+    return YoriLibChunkBufferInitialize(&Buffer->ChunkBuffer, SPONGE_CHUNK_SIZE);
 }
 
 /**
@@ -188,7 +251,113 @@ SpongeFreeBuffer(
     __in PSPONGE_BUFFER Buffer
     )
 {
-    YoriLibByteBufferCleanup(&Buffer->ByteBuffer);
+    if (Buffer->hSpill != NULL) {
+        CloseHandle(Buffer->hSpill);
+        Buffer->hSpill = NULL;
+    }
+    if (Buffer->SpillFileName.StartOfString != NULL) {
+        DeleteFile(Buffer->SpillFileName.StartOfString);
+    }
+    YoriLibFreeStringContents(&Buffer->SpillFileName);
+    YoriLibFreeStringContents(&Buffer->SpillDirectory);
+    YoriLibChunkBufferCleanup(&Buffer->ChunkBuffer);
+}
+
+/**
+ Determine the directory to create a temporary file in if input exceeds the
+ memory limit.  For a file target this is the directory containing the
+ file, so the completed file can be renamed into place.  For standard
+ output this is the system temporary directory.
+
+ @param Buffer Pointer to the buffer to record the directory in.
+
+ @param FullFilePath Pointer to the fully specified target file path, or an
+        empty string if output is to standard output.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SpongeFindSpillDirectory(
+    __inout PSPONGE_BUFFER Buffer,
+    __in PYORI_STRING FullFilePath
+    )
+{
+    YORI_ALLOC_SIZE_T Index;
+
+    if (FullFilePath->LengthInChars > 0) {
+        for (Index = FullFilePath->LengthInChars; Index > 0; Index--) {
+            if (YoriLibIsSep(FullFilePath->StartOfString[Index - 1])) {
+                break;
+            }
+        }
+
+        if (Index == 0) {
+            return FALSE;
+        }
+
+        if (!YoriLibAllocateString(&Buffer->SpillDirectory, Index)) {
+            return FALSE;
+        }
+
+        memcpy(Buffer->SpillDirectory.StartOfString, FullFilePath->StartOfString, (Index - 1) * sizeof(TCHAR));
+        Buffer->SpillDirectory.StartOfString[Index - 1] = '\0';
+        Buffer->SpillDirectory.LengthInChars = Index - 1;
+        return TRUE;
+    }
+
+    if (!YoriLibGetTempPath(&Buffer->SpillDirectory, 0)) {
+        return FALSE;
+    }
+
+    while (Buffer->SpillDirectory.LengthInChars > 0 &&
+           YoriLibIsSep(Buffer->SpillDirectory.StartOfString[Buffer->SpillDirectory.LengthInChars - 1])) {
+
+        Buffer->SpillDirectory.LengthInChars--;
+        Buffer->SpillDirectory.StartOfString[Buffer->SpillDirectory.LengthInChars] = '\0';
+    }
+
+    return TRUE;
+}
+
+/**
+ Copy the contents of the temporary file to a target stream.
+
+ @param Buffer Pointer to the buffer whose temporary file should be copied.
+
+ @param hTarget Handle to the target stream.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+SpongeCopySpillFile(
+    __in PSPONGE_BUFFER Buffer,
+    __in HANDLE hTarget
+    )
+{
+    DWORD BytesRead;
+    DWORD BytesWritten;
+    PUCHAR WriteBuffer;
+    YORI_ALLOC_SIZE_T BytesAvailable;
+
+    if (SetFilePointer(Buffer->hSpill, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER) {
+        return FALSE;
+    }
+
+    YoriLibChunkBufferReset(&Buffer->ChunkBuffer);
+    WriteBuffer = YoriLibChunkBufferGetPointerToEnd(&Buffer->ChunkBuffer, SPONGE_CHUNK_SIZE, &BytesAvailable);
+    if (WriteBuffer == NULL) {
+        return FALSE;
+    }
+
+    while (ReadFile(Buffer->hSpill, WriteBuffer, BytesAvailable, &BytesRead, NULL) && BytesRead > 0) {
+        if (!WriteFile(hTarget, WriteBuffer, BytesRead, &BytesWritten, NULL) ||
+            BytesWritten != BytesRead) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
 }
 
 
@@ -227,8 +396,13 @@ ENTRYPOINT(
     SPONGE_BUFFER SpongeBuffer;
     YORI_STRING FullFilePath;
     HANDLE hTarget;
+    YORI_MAX_UNSIGNED_T MemoryLimit;
+    DWORD Error;
+    LPTSTR ErrText;
+    DWORD ExitCode;
 
     ZeroMemory(&SpongeBuffer, sizeof(SpongeBuffer));
+    MemoryLimit = SPONGE_DEFAULT_MEMORY_LIMIT;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -242,6 +416,15 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2019"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                if (ArgC > i + 1) {
+                    MemoryLimit = YoriLibStringToFileSize(&ArgV[i + 1]).QuadPart;
+                    if (MemoryLimit == 0) {
+                        MemoryLimit = 1;
+                    }
+                    ArgumentUnderstood = TRUE;
+                    i++;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 ArgumentUnderstood = TRUE;
                 StartArg = i + 1;
@@ -271,6 +454,7 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
     SpongeBuffer.hSource = GetStdHandle(STD_INPUT_HANDLE);
+    SpongeBuffer.MemoryLimit = MemoryLimit;
 
     YoriLibInitEmptyString(&FullFilePath);
     hTarget = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -282,11 +466,51 @@ ENTRYPOINT(
         }
     }
 
+    if (!SpongeFindSpillDirectory(&SpongeBuffer, &FullFilePath)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: could not determine temporary directory\n"));
+        SpongeFreeBuffer(&SpongeBuffer);
+        YoriLibFreeStringContents(&FullFilePath);
+        return EXIT_FAILURE;
+    }
+
     if (!SpongeBufferPump(&SpongeBuffer)) {
         SpongeFreeBuffer(&SpongeBuffer);
+        YoriLibFreeStringContents(&FullFilePath);
         return EXIT_FAILURE;
     }
 
+    //
+    //  If input exceeded the memory limit, the bulk of it is in a temporary
+    //  file.  Move the remainder there too, then either rename the file
+    //  over the target, which replaces it atomically without copying the
+    //  data again, or copy it to standard output.
+    //
+
+    if (SpongeBuffer.hSpill != NULL) {
+        ExitCode = EXIT_SUCCESS;
+        if (!SpongeBufferSpill(&SpongeBuffer)) {
+            ExitCode = EXIT_FAILURE;
+        } else if (FullFilePath.LengthInChars > 0) {
+            CloseHandle(SpongeBuffer.hSpill);
+            SpongeBuffer.hSpill = NULL;
+            Error = YoriLibMoveFile(&SpongeBuffer.SpillFileName, &FullFilePath, TRUE, FALSE);
+            if (Error != ERROR_SUCCESS) {
+                ErrText = YoriLibGetWinErrorText(Error);
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: rename of %y to %y failed: %s"), &SpongeBuffer.SpillFileName, &FullFilePath, ErrText);
+                YoriLibFreeWinErrorText(ErrText);
+                ExitCode = EXIT_FAILURE;
+            } else {
+                YoriLibFreeStringContents(&SpongeBuffer.SpillFileName);
+            }
+        } else if (!SpongeCopySpillFile(&SpongeBuffer, hTarget)) {
+            ExitCode = EXIT_FAILURE;
+        }
+
+        SpongeFreeBuffer(&SpongeBuffer);
+        YoriLibFreeStringContents(&FullFilePath);
+        return ExitCode;
+    }
+
     if (FullFilePath.LengthInChars > 0) {
         hTarget = CreateFile(FullFilePath.StartOfString,
                              GENERIC_WRITE,
@@ -296,8 +520,8 @@ ENTRYPOINT(
                              0,
                              NULL);
         if (hTarget == INVALID_HANDLE_VALUE) {
-            DWORD LastError = GetLastError();
-            LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+            Error = GetLastError();
+            ErrText = YoriLibGetWinErrorText(Error);
             SpongeFreeBuffer(&SpongeBuffer);
             YoriLibFreeStringContents(&FullFilePath);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sponge: open file failed: %s"), ErrText);
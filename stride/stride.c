@@ -127,6 +127,7 @@ StrideProcessStream(
 {
     PVOID LineContext = NULL;
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
+    YORI_LIB_LINE_VIEW LineView;
     YORI_STRING LineString;
     BOOL OutputIsConsole;
     DWORD dwMode;
@@ -149,7 +150,12 @@ StrideProcessStream(
 
     while (TRUE) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        //
+        //  Read a view of the line so that lines which are skipped are
+        //  never copied or converted.
+        //
+
+        if (!YoriLibReadLineView(&LineView, &LineContext, hSource)) {
             break;
         }
 
@@ -158,6 +164,10 @@ StrideProcessStream(
 
         if (LineRelativeToStride < StrideContext->LinesOnEachInterval) {
 
+            if (!YoriLibLineViewToString(&LineView, &LineString)) {
+                break;
+            }
+
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
             CharactersDisplayed = LineString.LengthInChars;
             if (CharactersDisplayed == 0 ||
@@ -41,7 +41,10 @@ CHAR strSyncHelpText[] =
         "   -q             Query if the volume is in use, and flush if it is not in use\n"
         "   -r             Dismount and remount the volume\n"
         "   -s             Process files from all subdirectories\n"
-        "   -v             Display verbose output\n";
+        "   -v             Display verbose output\n"
+        "\n"
+        " Files on different volumes are flushed concurrently.  If the root of a\n"
+        " drive is specified, the volume is flushed, which flushes all files on it.\n";
 
 /**
  Display usage text to the user.
@@ -57,6 +60,62 @@ SyncHelp(VOID)
     return TRUE;
 }
 
+/**
+ A single file or directory to flush.
+ */
+typedef struct _SYNC_FILE {
+
+    /**
+     The list of files to flush on the volume.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The full path to the file or directory.
+     */
+    YORI_STRING FilePath;
+} SYNC_FILE, *PSYNC_FILE;
+
+/**
+ A volume containing files to flush.  Each volume is flushed on its own
+ thread so that a slow device doesn't delay flushing other devices.
+ */
+typedef struct _SYNC_VOLUME {
+
+    /**
+     The list of volumes to flush.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The list of files to flush on this volume.
+     */
+    YORI_LIST_ENTRY Files;
+
+    /**
+     Handle to the thread flushing this volume.
+     */
+    HANDLE hThread;
+
+    /**
+     TRUE if the volume itself was requested to be flushed.  When this
+     succeeds, all files on the volume are flushed, so the individual files
+     do not need to be flushed.
+     */
+    BOOLEAN FlushVolume;
+
+    /**
+     If TRUE, display output for each object where sync is attempted.
+     */
+    BOOLEAN Verbose;
+
+    /**
+     The path to the volume.  This can be empty if the volume could not be
+     determined, in which case the files are flushed individually.
+     */
+    YORI_STRING VolumePath;
+} SYNC_VOLUME, *PSYNC_VOLUME;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -86,8 +145,345 @@ typedef struct _SYNC_CONTEXT {
      */
     BOOL Verbose;
 
+    /**
+     The list of volumes containing files to flush.  Files are collected
+     during enumeration and flushed once enumeration is complete.
+     */
+    YORI_LIST_ENTRY Volumes;
+
 } SYNC_CONTEXT, *PSYNC_CONTEXT;
 
+/**
+ Flush a single file or directory to disk.
+
+ @param FilePath Pointer to the full path of the file or directory to flush.
+
+ @param Verbose If TRUE, display output indicating the file being flushed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SyncFlushFile(
+    __in PYORI_STRING FilePath,
+    __in BOOLEAN Verbose
+    )
+{
+    HANDLE FileHandle;
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    if (Verbose) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("sync: syncing %y\n"), FilePath);
+    }
+
+    FileHandle = CreateFile(FilePath->StartOfString,
+                            GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                            NULL);
+
+    if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: open of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    if (!FlushFileBuffers(FileHandle)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: flush of %y failed: %s"), FilePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    CloseHandle(FileHandle);
+    return TRUE;
+}
+
+/**
+ Flush all files on a volume by flushing the volume.  This requires the
+ volume to be opened for write, which is typically only possible for an
+ administrator.
+
+ @param SyncVolume Pointer to the volume to flush.
+
+ @return TRUE to indicate the volume was flushed, FALSE if it was not and
+         files should be flushed individually.
+ */
+BOOL
+SyncFlushVolume(
+    __in PSYNC_VOLUME SyncVolume
+    )
+{
+    HANDLE VolumeHandle;
+    DWORD LastError;
+    LPTSTR ErrText;
+
+    if (SyncVolume->Verbose) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("sync: syncing volume %y\n"), &SyncVolume->VolumePath);
+    }
+
+    VolumeHandle = CreateFile(SyncVolume->VolumePath.StartOfString,
+                              GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+
+    if (VolumeHandle == NULL || VolumeHandle == INVALID_HANDLE_VALUE) {
+        if (SyncVolume->Verbose) {
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("sync: open of %y failed, syncing files individually: %s"), &SyncVolume->VolumePath, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+        }
+        return FALSE;
+    }
+
+    if (!FlushFileBuffers(VolumeHandle)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: flush of %y failed, syncing files individually: %s"), &SyncVolume->VolumePath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(VolumeHandle);
+        return FALSE;
+    }
+
+    CloseHandle(VolumeHandle);
+    return TRUE;
+}
+
+/**
+ Flush a volume, or if that is not requested or not possible, each file on
+ the volume that was requested to be flushed.
+
+ @param Context Pointer to the SYNC_VOLUME to flush.
+
+ @return Zero to indicate success, nonzero to indicate failure.
+ */
+DWORD WINAPI
+SyncVolumeThread(
+    __in PVOID Context
+    )
+{
+    PSYNC_VOLUME SyncVolume;
+    PSYNC_FILE SyncFile;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD Result;
+
+    SyncVolume = (PSYNC_VOLUME)Context;
+
+    if (SyncVolume->FlushVolume) {
+        if (SyncFlushVolume(SyncVolume)) {
+            return 0;
+        }
+    }
+
+    Result = 0;
+    ListEntry = YoriLibGetNextListEntry(&SyncVolume->Files, NULL);
+    while (ListEntry != NULL) {
+        SyncFile = CONTAINING_RECORD(ListEntry, SYNC_FILE, ListEntry);
+        if (!SyncFlushFile(&SyncFile->FilePath, SyncVolume->Verbose)) {
+            Result = 1;
+        }
+        ListEntry = YoriLibGetNextListEntry(&SyncVolume->Files, ListEntry);
+    }
+
+    return Result;
+}
+
+/**
+ Add a file to the set of files to flush, grouped by the volume that it
+ resides on.  If the file refers to the root of a drive letter volume, the
+ volume is flushed, which flushes all files on it.
+
+ @param SyncContext Pointer to the sync context.
+
+ @param FilePath Pointer to the full path to the file to flush.
+
+ @return TRUE to indicate the file was added, FALSE to indicate failure.
+ */
+BOOL
+SyncAddFile(
+    __in PSYNC_CONTEXT SyncContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    YORI_STRING VolumePath;
+    YORI_STRING RootPath;
+    PYORI_LIST_ENTRY ListEntry;
+    PSYNC_VOLUME SyncVolume;
+    PSYNC_FILE SyncFile;
+
+    YoriLibInitEmptyString(&VolumePath);
+    if (!YoriLibGetVolumePathName(FilePath, &VolumePath)) {
+        VolumePath.LengthInChars = 0;
+    }
+
+    SyncVolume = NULL;
+    ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, NULL);
+    while (ListEntry != NULL) {
+        SyncVolume = CONTAINING_RECORD(ListEntry, SYNC_VOLUME, ListEntry);
+        if (YoriLibCompareStringInsensitive(&SyncVolume->VolumePath, &VolumePath) == 0) {
+            break;
+        }
+        SyncVolume = NULL;
+        ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, ListEntry);
+    }
+
+    if (SyncVolume == NULL) {
+        SyncVolume = YoriLibMalloc(sizeof(SYNC_VOLUME) + (VolumePath.LengthInChars + 1) * sizeof(TCHAR));
+        if (SyncVolume == NULL) {
+            YoriLibFreeStringContents(&VolumePath);
+            return FALSE;
+        }
+
+        ZeroMemory(SyncVolume, sizeof(SYNC_VOLUME));
+        YoriLibInitializeListHead(&SyncVolume->Files);
+        SyncVolume->Verbose = (BOOLEAN)SyncContext->Verbose;
+        YoriLibInitEmptyString(&SyncVolume->VolumePath);
+        SyncVolume->VolumePath.StartOfString = (LPTSTR)(SyncVolume + 1);
+        SyncVolume->VolumePath.LengthInChars = VolumePath.LengthInChars;
+        SyncVolume->VolumePath.LengthAllocated = VolumePath.LengthInChars + 1;
+        memcpy(SyncVolume->VolumePath.StartOfString, VolumePath.StartOfString, VolumePath.LengthInChars * sizeof(TCHAR));
+        SyncVolume->VolumePath.StartOfString[VolumePath.LengthInChars] = '\0';
+        YoriLibAppendList(&SyncContext->Volumes, &SyncVolume->ListEntry);
+    }
+
+    YoriLibFreeStringContents(&VolumePath);
+
+    //
+    //  If the file is the root of a drive letter, such as "\\?\C:\", flush
+    //  the volume.  Other volume paths, such as mount points or UNC shares,
+    //  refer to directories rather than volumes, so they are flushed as
+    //  files.
+    //
+
+    YoriLibInitEmptyString(&RootPath);
+    RootPath.StartOfString = FilePath->StartOfString;
+    RootPath.LengthInChars = FilePath->LengthInChars;
+    if (RootPath.LengthInChars > 0 &&
+        YoriLibIsSep(RootPath.StartOfString[RootPath.LengthInChars - 1])) {
+
+        RootPath.LengthInChars--;
+    }
+
+    if (SyncVolume->VolumePath.LengthInChars == sizeof("\\\\?\\C:") - 1 &&
+        SyncVolume->VolumePath.StartOfString[SyncVolume->VolumePath.LengthInChars - 1] == ':' &&
+        YoriLibCompareStringInsensitive(&RootPath, &SyncVolume->VolumePath) == 0) {
+
+        SyncVolume->FlushVolume = TRUE;
+    }
+
+    SyncFile = YoriLibMalloc(sizeof(SYNC_FILE) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+    if (SyncFile == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&SyncFile->FilePath);
+    SyncFile->FilePath.StartOfString = (LPTSTR)(SyncFile + 1);
+    SyncFile->FilePath.LengthInChars = FilePath->LengthInChars;
+    SyncFile->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+    memcpy(SyncFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    SyncFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+    YoriLibAppendList(&SyncVolume->Files, &SyncFile->ListEntry);
+
+    return TRUE;
+}
+
+/**
+ Flush all files that have been collected.  Each volume is flushed on its
+ own thread, so flushes to different devices proceed concurrently.  Since
+ threads are waited on together, at most MAXIMUM_WAIT_OBJECTS volumes are
+ flushed at once.
+
+ @param SyncContext Pointer to the sync context containing the volumes to
+        flush.
+ */
+VOID
+SyncFlushAllVolumes(
+    __in PSYNC_CONTEXT SyncContext
+    )
+{
+    HANDLE ThreadHandles[MAXIMUM_WAIT_OBJECTS];
+    PYORI_LIST_ENTRY ListEntry;
+    PSYNC_VOLUME SyncVolume;
+    DWORD ThreadCount;
+    DWORD ThreadId;
+    DWORD Index;
+
+    ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, NULL);
+    while (ListEntry != NULL) {
+
+        ThreadCount = 0;
+        while (ListEntry != NULL && ThreadCount < MAXIMUM_WAIT_OBJECTS) {
+            SyncVolume = CONTAINING_RECORD(ListEntry, SYNC_VOLUME, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, ListEntry);
+
+            //
+            //  If a thread can't be created, flush the volume on this
+            //  thread.
+            //
+
+            SyncVolume->hThread = CreateThread(NULL, 0, SyncVolumeThread, SyncVolume, 0, &ThreadId);
+            if (SyncVolume->hThread == NULL) {
+                SyncVolumeThread(SyncVolume);
+                continue;
+            }
+
+            ThreadHandles[ThreadCount] = SyncVolume->hThread;
+            ThreadCount++;
+        }
+
+        if (ThreadCount > 0) {
+            WaitForMultipleObjects(ThreadCount, ThreadHandles, TRUE, INFINITE);
+            for (Index = 0; Index < ThreadCount; Index++) {
+                CloseHandle(ThreadHandles[Index]);
+            }
+        }
+    }
+}
+
+/**
+ Free all volumes and files that have been collected.
+
+ @param SyncContext Pointer to the sync context containing the volumes to
+        free.
+ */
+VOID
+SyncFreeVolumes(
+    __in PSYNC_CONTEXT SyncContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY FileEntry;
+    PSYNC_VOLUME SyncVolume;
+    PSYNC_FILE SyncFile;
+
+    ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, NULL);
+    while (ListEntry != NULL) {
+        SyncVolume = CONTAINING_RECORD(ListEntry, SYNC_VOLUME, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&SyncContext->Volumes, ListEntry);
+
+        FileEntry = YoriLibGetNextListEntry(&SyncVolume->Files, NULL);
+        while (FileEntry != NULL) {
+            SyncFile = CONTAINING_RECORD(FileEntry, SYNC_FILE, ListEntry);
+            FileEntry = YoriLibGetNextListEntry(&SyncVolume->Files, FileEntry);
+            YoriLibRemoveListItem(&SyncFile->ListEntry);
+            YoriLibFree(SyncFile);
+        }
+
+        YoriLibRemoveListItem(&SyncVolume->ListEntry);
+        YoriLibFree(SyncVolume);
+    }
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -193,35 +589,14 @@ SyncFileFoundCallback(
 
     } else {
 
-        if (SyncContext->Verbose) {
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("sync: syncing %y\n"), FilePath);
-        }
-
-        FileHandle = CreateFile(FilePath->StartOfString,
-                                DesiredAccess,
-                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                                NULL,
-                                OPEN_ALWAYS,
-                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
-                                NULL);
-
-        if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
-            LastError = GetLastError();
-            ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: open of %y failed: %s"), FilePath, ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-            return TRUE;
-        }
+        //
+        //  Flushes are deferred until enumeration is complete so they can
+        //  be grouped by volume.
+        //
 
-        if (!FlushFileBuffers(FileHandle)) {
-            LastError = GetLastError();
-            ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: flush of %y failed: %s"), FilePath, ErrText);
-            YoriLibFreeWinErrorText(ErrText);
-            return TRUE;
+        if (!SyncAddFile(SyncContext, FilePath)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("sync: out of memory\n"));
         }
-
-        CloseHandle(FileHandle);
         return TRUE;
     }
 }
@@ -264,6 +639,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
 
     ZeroMemory(&SyncContext, sizeof(SyncContext));
+    YoriLibInitializeListHead(&SyncContext.Volumes);
 
     for (i = 1; i < ArgC; i++) {
 
@@ -345,6 +721,9 @@ ENTRYPOINT(
                 }
             }
         }
+
+        SyncFlushAllVolumes(&SyncContext);
+        SyncFreeVolumes(&SyncContext);
     }
 
     return EXIT_SUCCESS;
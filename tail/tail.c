@@ -41,7 +41,8 @@ CHAR strTailHelpText[] =
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Specify a line to display context around instead of EOF\n"
-        "   -f             Wait for new output and continue outputting\n"
+        "   -f             Wait for new output and continue outputting, following\n"
+        "                    all files specified\n"
         "   -n             Specify the number of lines to display\n"
         "   -s             Process files from all subdirectories\n";
 
@@ -59,6 +60,73 @@ TailHelp(VOID)
     return TRUE;
 }
 
+/**
+ The maximum time, in milliseconds, to wait between checks of followed files
+ for new data.  Files are normally checked when a change notification is
+ received for their directory, but these can be delayed while the writer
+ holds the file open, and cannot be registered for every directory.
+ */
+#define TAIL_FOLLOW_CHECK_INTERVAL (2000)
+
+/**
+ The number of bytes to read at a time when scanning backwards from the end
+ of a file to find its final lines.
+ */
+#define TAIL_REVERSE_SCAN_BLOCK_SIZE (64 * 1024)
+
+/**
+ A directory which contains one or more followed files, and a notification
+ which is signalled when files within it change.
+ */
+typedef struct _TAIL_WATCHED_DIRECTORY {
+
+    /**
+     The link within the list of watched directories.  Paired with
+     TAIL_CONTEXT::WatchedDirectories .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The path to the directory.
+     */
+    YORI_STRING DirectoryPath;
+
+    /**
+     A change notification handle for the directory, or NULL if one could
+     not be created.
+     */
+    HANDLE ChangeHandle;
+} TAIL_WATCHED_DIRECTORY, *PTAIL_WATCHED_DIRECTORY;
+
+/**
+ A file whose final lines have been output and which is being checked for
+ new lines.
+ */
+typedef struct _TAIL_FOLLOWED_FILE {
+
+    /**
+     The link within the list of followed files.  Paired with
+     TAIL_CONTEXT::FollowedFiles .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A handle to the file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The line read context for the file, which describes any partial line
+     that has been read but not output.
+     */
+    PVOID LineContext;
+
+    /**
+     The name of the file to display when output switches between files.
+     */
+    YORI_STRING DisplayName;
+} TAIL_FOLLOWED_FILE, *PTAIL_FOLLOWED_FILE;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -117,14 +185,434 @@ typedef struct _TAIL_CONTEXT {
      */
     BOOLEAN Recursive;
 
+    /**
+     A list of files being followed.  Paired with
+     TAIL_FOLLOWED_FILE::ListEntry .
+     */
+    YORI_LIST_ENTRY FollowedFiles;
+
+    /**
+     A list of directories containing followed files.  Paired with
+     TAIL_WATCHED_DIRECTORY::ListEntry .
+     */
+    YORI_LIST_ENTRY WatchedDirectories;
+
+    /**
+     The number of entries in FollowedFiles.
+     */
+    DWORD FollowedFileCount;
+
+    /**
+     The followed file whose lines were most recently output.
+     */
+    PTAIL_FOLLOWED_FILE LastOutputFile;
+
 } TAIL_CONTEXT, *PTAIL_CONTEXT;
 
+/**
+ Register for change notifications on the directory containing a file, if
+ the directory is not already being watched.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @return TRUE if the directory is being watched, FALSE if not.
+ */
+BOOLEAN
+TailWatchDirectory(
+    __inout PTAIL_CONTEXT TailContext,
+    __in PCYORI_STRING FilePath
+    )
+{
+    PTAIL_WATCHED_DIRECTORY WatchedDirectory;
+    PYORI_LIST_ENTRY ListEntry;
+    YORI_STRING DirectoryPath;
+    LPTSTR FilePart;
+
+    YoriLibInitEmptyString(&DirectoryPath);
+    DirectoryPath.StartOfString = FilePath->StartOfString;
+    FilePart = YoriLibFindRightMostCharacter(FilePath, '\\');
+    if (FilePart == NULL) {
+        return FALSE;
+    }
+    DirectoryPath.LengthInChars = (YORI_ALLOC_SIZE_T)(FilePart - FilePath->StartOfString);
+
+    //
+    //  The root of a drive needs its trailing seperator to refer to the
+    //  directory rather than the volume.
+    //
+
+    if (DirectoryPath.LengthInChars > 0 &&
+        DirectoryPath.StartOfString[DirectoryPath.LengthInChars - 1] == ':') {
+
+        DirectoryPath.LengthInChars++;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, NULL);
+    while (ListEntry != NULL) {
+        WatchedDirectory = CONTAINING_RECORD(ListEntry, TAIL_WATCHED_DIRECTORY, ListEntry);
+        if (YoriLibCompareStringInsensitive(&WatchedDirectory->DirectoryPath, &DirectoryPath) == 0) {
+            return (BOOLEAN)(WatchedDirectory->ChangeHandle != NULL);
+        }
+        ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, ListEntry);
+    }
+
+    WatchedDirectory = YoriLibMalloc(sizeof(TAIL_WATCHED_DIRECTORY) + (DirectoryPath.LengthInChars + 1) * sizeof(TCHAR));
+    if (WatchedDirectory == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&WatchedDirectory->DirectoryPath);
+    WatchedDirectory->DirectoryPath.StartOfString = (LPTSTR)(WatchedDirectory + 1);
+    WatchedDirectory->DirectoryPath.LengthInChars = DirectoryPath.LengthInChars;
+    WatchedDirectory->DirectoryPath.LengthAllocated = DirectoryPath.LengthInChars + 1;
+    memcpy(WatchedDirectory->DirectoryPath.StartOfString, DirectoryPath.StartOfString, DirectoryPath.LengthInChars * sizeof(TCHAR));
+    WatchedDirectory->DirectoryPath.StartOfString[DirectoryPath.LengthInChars] = '\0';
+
+    WatchedDirectory->ChangeHandle = FindFirstChangeNotification(WatchedDirectory->DirectoryPath.StartOfString,
+                                                                 FALSE,
+                                                                 FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (WatchedDirectory->ChangeHandle == INVALID_HANDLE_VALUE) {
+        WatchedDirectory->ChangeHandle = NULL;
+    }
+
+    YoriLibAppendList(&TailContext->WatchedDirectories, &WatchedDirectory->ListEntry);
+
+    return (BOOLEAN)(WatchedDirectory->ChangeHandle != NULL);
+}
+
+/**
+ Add a file to the set of files to follow once all files have had their
+ final lines output.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FilePath Optionally points to the full path to the file.  If not
+        specified, the file is not associated with a directory, so it is
+        checked for new lines periodically.
+
+ @param FileHandle A handle to the file.  This function duplicates the
+        handle, so the caller retains ownership of it.
+
+ @param LineContext The line read context used to output the final lines of
+        the file.  On success, this is owned by the followed file.
+
+ @return TRUE to indicate the file is being followed, FALSE if it is not.
+ */
+__success(return)
+BOOLEAN
+TailAddFollowedFile(
+    __inout PTAIL_CONTEXT TailContext,
+    __in_opt PYORI_STRING FilePath,
+    __in HANDLE FileHandle,
+    __in PVOID LineContext
+    )
+{
+    PTAIL_FOLLOWED_FILE FollowedFile;
+
+    FollowedFile = YoriLibMalloc(sizeof(TAIL_FOLLOWED_FILE));
+    if (FollowedFile == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(FollowedFile, sizeof(TAIL_FOLLOWED_FILE));
+    if (!DuplicateHandle(GetCurrentProcess(), FileHandle, GetCurrentProcess(), &FollowedFile->FileHandle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        YoriLibFree(FollowedFile);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&FollowedFile->DisplayName);
+    if (FilePath != NULL) {
+        if (!YoriLibUnescapePath(FilePath, &FollowedFile->DisplayName)) {
+            YoriLibCopyString(&FollowedFile->DisplayName, FilePath);
+        }
+        TailWatchDirectory(TailContext, FilePath);
+    }
+
+    FollowedFile->LineContext = LineContext;
+    YoriLibAppendList(&TailContext->FollowedFiles, &FollowedFile->ListEntry);
+    TailContext->FollowedFileCount++;
+
+    return TRUE;
+}
+
+/**
+ Output any complete lines that have been added to a followed file.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FollowedFile Pointer to the file to check.
+ */
+VOID
+TailOutputFollowedFile(
+    __inout PTAIL_CONTEXT TailContext,
+    __in PTAIL_FOLLOWED_FILE FollowedFile
+    )
+{
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
+
+    while (YoriLibReadLineToStringEx(&TailContext->LinesArray[0],
+                                     &FollowedFile->LineContext,
+                                     FALSE,
+                                     INFINITE,
+                                     FollowedFile->FileHandle,
+                                     &LineEnding,
+                                     &TimeoutReached)) {
+
+        //
+        //  When following more than one file, indicate which file each
+        //  group of lines came from.
+        //
+
+        if (TailContext->FollowedFileCount > 1 &&
+            TailContext->LastOutputFile != FollowedFile &&
+            FollowedFile->DisplayName.LengthInChars > 0) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n==> %y <==\n"), &FollowedFile->DisplayName);
+        }
+        TailContext->LastOutputFile = FollowedFile;
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &TailContext->LinesArray[0]);
+    }
+}
+
+/**
+ Output new lines from all followed files as they arrive, until the
+ operation is cancelled or output can no longer be written.  A single wait
+ covers change notifications for every directory containing a followed
+ file.
+
+ @param TailContext Pointer to the tail context.
+ */
+VOID
+TailFollowFiles(
+    __inout PTAIL_CONTEXT TailContext
+    )
+{
+    HANDLE WaitHandles[MAXIMUM_WAIT_OBJECTS];
+    DWORD HandleCount;
+    DWORD FirstChangeHandle;
+    DWORD WaitResult;
+    DWORD BytesWritten;
+    DWORD Err;
+    PYORI_LIST_ENTRY ListEntry;
+    PTAIL_WATCHED_DIRECTORY WatchedDirectory;
+    PTAIL_FOLLOWED_FILE FollowedFile;
+
+    if (TailContext->FollowedFileCount == 0) {
+        return;
+    }
+
+    HandleCount = 0;
+    if (YoriLibCancelGetEvent() != NULL) {
+        WaitHandles[HandleCount] = YoriLibCancelGetEvent();
+        HandleCount++;
+    }
+    FirstChangeHandle = HandleCount;
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, NULL);
+    while (ListEntry != NULL && HandleCount < MAXIMUM_WAIT_OBJECTS) {
+        WatchedDirectory = CONTAINING_RECORD(ListEntry, TAIL_WATCHED_DIRECTORY, ListEntry);
+        if (WatchedDirectory->ChangeHandle != NULL) {
+            WaitHandles[HandleCount] = WatchedDirectory->ChangeHandle;
+            HandleCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, ListEntry);
+    }
+
+    while (TRUE) {
+
+        ListEntry = YoriLibGetNextListEntry(&TailContext->FollowedFiles, NULL);
+        while (ListEntry != NULL) {
+            FollowedFile = CONTAINING_RECORD(ListEntry, TAIL_FOLLOWED_FILE, ListEntry);
+            TailOutputFollowedFile(TailContext, FollowedFile);
+            ListEntry = YoriLibGetNextListEntry(&TailContext->FollowedFiles, ListEntry);
+        }
+
+        //
+        //  Check if the target handle is still around
+        //
+
+        if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), NULL, 0, &BytesWritten, NULL)) {
+            Err = GetLastError();
+            if (Err == ERROR_NO_DATA ||
+                Err == ERROR_PIPE_NOT_CONNECTED) {
+                break;
+            }
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        if (HandleCount == 0) {
+            Sleep(TAIL_FOLLOW_CHECK_INTERVAL);
+            continue;
+        }
+
+        WaitResult = WaitForMultipleObjectsEx(HandleCount, WaitHandles, FALSE, TAIL_FOLLOW_CHECK_INTERVAL, FALSE);
+        if (WaitResult >= WAIT_OBJECT_0 + FirstChangeHandle &&
+            WaitResult < WAIT_OBJECT_0 + HandleCount) {
+
+            FindNextChangeNotification(WaitHandles[WaitResult - WAIT_OBJECT_0]);
+        } else if (WaitResult == WAIT_FAILED) {
+            Sleep(TAIL_FOLLOW_CHECK_INTERVAL);
+        }
+    }
+}
+
+/**
+ Free the state used to follow files.
+
+ @param TailContext Pointer to the tail context.
+ */
+VOID
+TailCleanupFollowedFiles(
+    __inout PTAIL_CONTEXT TailContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PTAIL_WATCHED_DIRECTORY WatchedDirectory;
+    PTAIL_FOLLOWED_FILE FollowedFile;
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->FollowedFiles, NULL);
+    while (ListEntry != NULL) {
+        FollowedFile = CONTAINING_RECORD(ListEntry, TAIL_FOLLOWED_FILE, ListEntry);
+        YoriLibRemoveListItem(ListEntry);
+        YoriLibLineReadCloseOrCache(FollowedFile->LineContext);
+        CloseHandle(FollowedFile->FileHandle);
+        YoriLibFreeStringContents(&FollowedFile->DisplayName);
+        YoriLibFree(FollowedFile);
+        ListEntry = YoriLibGetNextListEntry(&TailContext->FollowedFiles, NULL);
+    }
+    TailContext->FollowedFileCount = 0;
+    TailContext->LastOutputFile = NULL;
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, NULL);
+    while (ListEntry != NULL) {
+        WatchedDirectory = CONTAINING_RECORD(ListEntry, TAIL_WATCHED_DIRECTORY, ListEntry);
+        YoriLibRemoveListItem(ListEntry);
+        if (WatchedDirectory->ChangeHandle != NULL) {
+            FindCloseChangeNotification(WatchedDirectory->ChangeHandle);
+        }
+        YoriLibFree(WatchedDirectory);
+        ListEntry = YoriLibGetNextListEntry(&TailContext->WatchedDirectories, NULL);
+    }
+}
+
+/**
+ Find the offset in a file of the start of its final lines by reading blocks
+ backwards from the end of the file and counting line feeds.  This reads only
+ as much of the file as contains the requested lines, regardless of how long
+ the lines are or how large the file is.
+
+ @param hSource Handle to the file.
+
+ @param LinesToDisplay The number of lines to find.
+
+ @param StartOffset On successful completion, updated to the offset of the
+        first line to display.  This is the start of the file if it does not
+        contain enough lines.
+
+ @return TRUE to indicate success, FALSE if the file could not be read.
+ */
+__success(return)
+BOOLEAN
+TailFindFinalLines(
+    __in HANDLE hSource,
+    __in YORI_ALLOC_SIZE_T LinesToDisplay,
+    __out PDWORDLONG StartOffset
+    )
+{
+    PUCHAR Buffer;
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER BlockOffset;
+    DWORDLONG ScanEnd;
+    DWORDLONG FileEnd;
+    DWORD BlockLength;
+    DWORD BytesRead;
+    DWORD Index;
+    DWORD CharSize;
+    YORI_ALLOC_SIZE_T LinesFound;
+
+    CharSize = sizeof(UCHAR);
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    FileSize.LowPart = GetFileSize(hSource, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(TAIL_REVERSE_SCAN_BLOCK_SIZE);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    FileEnd = FileSize.QuadPart - (FileSize.QuadPart % CharSize);
+    ScanEnd = FileEnd;
+    LinesFound = 0;
+
+    while (ScanEnd > 0) {
+        BlockLength = TAIL_REVERSE_SCAN_BLOCK_SIZE;
+        if (ScanEnd < BlockLength) {
+            BlockLength = (DWORD)ScanEnd;
+        }
+        BlockOffset.QuadPart = ScanEnd - BlockLength;
+
+        if ((SetFilePointer(hSource, BlockOffset.LowPart, &BlockOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+             GetLastError() != NO_ERROR) ||
+            !ReadFile(hSource, Buffer, BlockLength, &BytesRead, NULL) ||
+            BytesRead != BlockLength) {
+
+            YoriLibFree(Buffer);
+            return FALSE;
+        }
+
+        for (Index = BlockLength; Index >= CharSize; Index = Index - CharSize) {
+            if (Buffer[Index - CharSize] == '\n' &&
+                (CharSize == sizeof(UCHAR) || Buffer[Index - 1] == 0)) {
+
+                //
+                //  The line ending at the end of the file terminates the
+                //  final line rather than starting another one.
+                //
+
+                if (BlockOffset.QuadPart + Index == FileEnd) {
+                    continue;
+                }
+
+                LinesFound++;
+                if (LinesFound >= LinesToDisplay) {
+                    *StartOffset = BlockOffset.QuadPart + Index;
+                    YoriLibFree(Buffer);
+                    return TRUE;
+                }
+            }
+        }
+
+        ScanEnd = BlockOffset.QuadPart;
+    }
+
+    YoriLibFree(Buffer);
+    *StartOffset = 0;
+    return TRUE;
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
- the set requested by the user.
+ the set requested by the user.  If new output should be followed, a pipe is
+ followed until it is closed, and a file is added to the set of files that
+ are followed once all files have been processed.
 
  @param hSource The opened source stream.
 
+ @param FilePath Optionally points to the full path of the stream, used to
+        watch for changes to it.
+
  @param TailContext Pointer to context information specifying which lines to
         display.
  
@@ -133,6 +621,7 @@ typedef struct _TAIL_CONTEXT {
 BOOL
 TailProcessStream(
     __in HANDLE hSource,
+    __in_opt PYORI_STRING FilePath,
     __in PTAIL_CONTEXT TailContext
     )
 {
@@ -142,114 +631,81 @@ TailProcessStream(
     PYORI_STRING LineString;
     YORI_LIB_LINE_ENDING LineEnding;
     BOOL TimeoutReached;
-    DWORD SeekToEndOffset = 0;
-    DWORD Err;
-    DWORD BytesWritten;
+    DWORDLONG StartOffset;
+    LARGE_INTEGER SeekOffset;
 
     DWORD FileType = GetFileType(hSource);
     FileType = FileType & ~(FILE_TYPE_REMOTE);
 
     //
-    //  If it's a file and we want the final few lines, start searching
-    //  from the end, assuming an average line size of 256 bytes.
+    //  If it's a file and we want the final few lines, find where they
+    //  start by scanning backwards from the end.
     //
 
     if (FileType == FILE_TYPE_DISK && TailContext->FinalLine == 0) {
-        SeekToEndOffset = 256 * TailContext->LinesToDisplay;
+        if (!TailFindFinalLines(hSource, TailContext->LinesToDisplay, &StartOffset)) {
+            StartOffset = 0;
+        }
+        SeekOffset.QuadPart = StartOffset;
+        if (SetFilePointer(hSource, SeekOffset.LowPart, &SeekOffset.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+            GetLastError() != NO_ERROR) {
+
+            SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
+        }
     }
 
     TailContext->FilesFound++;
     TailContext->FilesFoundThisArg++;
+    TailContext->LinesFound = 0;
 
     while (TRUE) {
 
-        if (SeekToEndOffset != 0) {
-            if (!SetFilePointer(hSource, -1 * SeekToEndOffset, NULL, FILE_END)) {
-                SeekToEndOffset = 0;
-                SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
-            }
+        if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[TailContext->LinesFound % TailContext->LinesToDisplay],
+                                       &LineContext,
+                                       !TailContext->WaitForMore,
+                                       INFINITE,
+                                       hSource,
+                                       &LineEnding,
+                                       &TimeoutReached)) {
+            break;
         }
-        TailContext->LinesFound = 0;
 
-        while (TRUE) {
+        TailContext->LinesFound++;
 
-            if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[TailContext->LinesFound % TailContext->LinesToDisplay],
-                                           &LineContext,
-                                           !TailContext->WaitForMore,
-                                           INFINITE,
-                                           hSource,
-                                           &LineEnding,
-                                           &TimeoutReached)) {
-                break;
-            }
-
-            TailContext->LinesFound++;
-
-            if (TailContext->FinalLine != 0 && TailContext->LinesFound >= TailContext->FinalLine) {
-                break;
-            }
-        }
-
-        if (TailContext->LinesFound > TailContext->LinesToDisplay) {
-            StartLine = TailContext->LinesFound - TailContext->LinesToDisplay;
-            break;
-        } else if (SeekToEndOffset != 0) {
-            DWORD DesiredSeek;
-            DesiredSeek = 4096;
-            DesiredSeek = DesiredSeek * TailContext->LinesToDisplay;
-
-            //
-            //  If we didn't get enough lines and we have a file that
-            //  supports arbitrary seeks, try to grab more data.  If
-            //  we've already hit our arbitrary maximum (a 4Kb average
-            //  line size) start scanning from the top.
-            //
-
-            if (SeekToEndOffset < DesiredSeek) {
-                SeekToEndOffset = DesiredSeek;
-            } else {
-                SeekToEndOffset = 0;
-                SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
-            }
-            YoriLibLineReadCloseOrCache(LineContext);
-            LineContext = NULL;
-            continue;
-        } else {
-            StartLine = 0;
+        if (TailContext->FinalLine != 0 && TailContext->LinesFound >= TailContext->FinalLine) {
             break;
         }
     }
 
+    //
+    //  Only the final LinesToDisplay lines are retained.  More than this
+    //  are found when reading a pipe, in context mode, or if a file ends
+    //  lines with carriage returns alone.
+    //
+
+    if (TailContext->LinesFound > TailContext->LinesToDisplay) {
+        StartLine = TailContext->LinesFound - TailContext->LinesToDisplay;
+    }
+
     for (CurrentLine = StartLine; CurrentLine < TailContext->LinesFound; CurrentLine++) {
         LineString = &TailContext->LinesArray[CurrentLine % TailContext->LinesToDisplay];
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), LineString);
     }
 
     if (TailContext->WaitForMore) {
-        while (TRUE) {
-
-            if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[0], &LineContext, FALSE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
-
-                //
-                //  Check if the target handle is still around
-                //
 
-                if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), NULL, 0, &BytesWritten, NULL)) {
-                    Err = GetLastError();
-                    if (Err == ERROR_NO_DATA ||
-                        Err == ERROR_PIPE_NOT_CONNECTED) {
-                        break;
-                    }
-                }
+        //
+        //  Reading from a pipe waits for data to arrive, so failure means
+        //  the pipe has been closed.  Anything else is followed along with
+        //  any other files once they have all been processed.
+        //
 
-                if (YoriLibIsOperationCancelled()) {
-                    break;
-                }
-
-                Sleep(200);
-                continue;
+        if (FileType == FILE_TYPE_PIPE) {
+            while (YoriLibReadLineToStringEx(&TailContext->LinesArray[0], &LineContext, FALSE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &TailContext->LinesArray[0]);
             }
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &TailContext->LinesArray[0]);
+        } else if (TailAddFollowedFile(TailContext, FilePath, hSource, LineContext)) {
+            LineContext = NULL;
         }
     }
 
@@ -310,7 +766,7 @@ TailFileFoundCallback(
         }
 
         TailContext->SavedErrorThisArg = ERROR_SUCCESS;
-        TailProcessStream(FileHandle, TailContext);
+        TailProcessStream(FileHandle, FilePath, TailContext);
 
         CloseHandle(FileHandle);
     }
@@ -419,6 +875,8 @@ ENTRYPOINT(
 
     ZeroMemory(&TailContext, sizeof(TailContext));
     TailContext.LinesToDisplay = 10;
+    YoriLibInitializeListHead(&TailContext.FollowedFiles);
+    YoriLibInitializeListHead(&TailContext.WatchedDirectories);
     ContextLine = -1;
 
     for (i = 1; i < ArgC; i++) {
@@ -519,7 +977,7 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        TailProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TailContext);
+        TailProcessStream(GetStdHandle(STD_INPUT_HANDLE), NULL, &TailContext);
     } else {
         MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
         if (TailContext.Recursive) {
@@ -556,6 +1014,9 @@ ENTRYPOINT(
         }
     }
 
+    TailFollowFiles(&TailContext);
+    TailCleanupFollowedFiles(&TailContext);
+
     for (Count = 0; Count < TailContext.LinesToDisplay; Count++) {
         YoriLibFreeStringContents(&TailContext.LinesArray[Count]);
     }
@@ -33,12 +33,13 @@
 const
 CHAR strTeeHelpText[] =
         "\n"
-        "Output the contents of standard input to standard output and a file.\n"
+        "Output the contents of standard input to standard output and files.\n"
         "\n"
-        "TEE [-license] -c\n"
-        "TEE [-license] [-a] <file>]\n"
+        "TEE [-license] [-b] -c [<file>...]\n"
+        "TEE [-license] [-a] [-b] <file> [<file>...]\n"
         "\n"
-        "   -a             Append to the file\n"
+        "   -a             Append to the files\n"
+        "   -b             Copy data in blocks without interpreting lines\n"
         "   -c             Write to the console and standard output\n";
 
 /**
@@ -55,6 +56,92 @@ TeeHelp(VOID)
     return TRUE;
 }
 
+/**
+ The number of bytes to read from the source at a time in block mode.
+ */
+#define TEE_BLOCK_SIZE (64 * 1024)
+
+/**
+ The number of blocks that can be waiting to be written to each output in
+ block mode.  Once this many blocks are waiting for an output, reading from
+ the source pauses until the output has caught up.
+ */
+#define TEE_SINK_QUEUE_DEPTH (64)
+
+/**
+ A block of data read from the source.  This is a referenced allocation
+ which is referenced by each output that has yet to write it.
+ */
+typedef struct _TEE_BLOCK {
+
+    /**
+     The number of bytes of data in the block.
+     */
+    DWORD Length;
+
+    /**
+     The data, which extends beyond the end of this structure.
+     */
+    UCHAR Data[1];
+} TEE_BLOCK, *PTEE_BLOCK;
+
+/**
+ A single output device which receives the contents of the source.
+ */
+typedef struct _TEE_SINK {
+
+    /**
+     Handle to the output device.
+     */
+    HANDLE hDevice;
+
+    /**
+     TRUE if hDevice is a handle to a console; FALSE if it is a handle to a
+     different type of device.
+     */
+    BOOLEAN IsConsole;
+
+    /**
+     TRUE if a write to this output has failed in block mode.  Further
+     blocks are discarded for this output so the others can continue.
+     */
+    BOOLEAN WriteFailed;
+
+    /**
+     In block mode, a handle to the thread writing to this output.
+     */
+    HANDLE hThread;
+
+    /**
+     In block mode, a semaphore counting the blocks waiting in the queue.
+     */
+    HANDLE BlocksQueued;
+
+    /**
+     In block mode, a semaphore counting the free entries in the queue.
+     */
+    HANDLE EntriesFree;
+
+    /**
+     The index of the next block in the queue to write.  This is only
+     accessed by the thread writing to this output.
+     */
+    DWORD Head;
+
+    /**
+     The index of the next entry in the queue to populate.  This is only
+     accessed by the thread reading from the source.
+     */
+    DWORD Tail;
+
+    /**
+     The queue of blocks to write to this output.  A NULL entry indicates
+     the end of the source.
+     */
+    PTEE_BLOCK Queue[TEE_SINK_QUEUE_DEPTH];
+
+} TEE_SINK, *PTEE_SINK;
+
 /**
  Context passed to the callback which is invoked for each source stream
  processed.
@@ -62,16 +149,14 @@ TeeHelp(VOID)
 typedef struct _TEE_CONTEXT {
 
     /**
-     Handle to a file which will receive all output in addition to standard
-     output.
+     An array of output devices to write to.  The first is standard output.
      */
-    HANDLE hFile;
+    PTEE_SINK Sinks;
 
     /**
-     TRUE if hFile is a handle to a console; FALSE if it is a handle to a
-     different type of device.
+     The number of elements in the Sinks array.
      */
-    BOOLEAN FileIsConsole;
+    DWORD SinkCount;
 
 } TEE_CONTEXT, *PTEE_CONTEXT;
 
@@ -119,8 +204,8 @@ TeeWriteLine(
 
  @param hSource Handle to the source.
 
- @param TeeContext Pointer to the context for the operation, including a
-        handle to the output stream to write data to.
+ @param TeeContext Pointer to the context for the operation, including
+        handles to the output streams to write data to.
 
  @return TRUE to indicate success or FALSE to indicate failure.
  */
@@ -131,17 +216,8 @@ TeeProcessStream(
     )
 {
     PVOID LineContext = NULL;
-    DWORD Junk;
     YORI_STRING LineString;
-    HANDLE StdOutHandle;
-    BOOLEAN StdOutIsConsole;
-
-    StdOutIsConsole = FALSE;
-
-    StdOutHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (GetConsoleMode(StdOutHandle, &Junk)) {
-        StdOutIsConsole = TRUE;
-    }
+    DWORD Index;
 
     YoriLibInitEmptyString(&LineString);
 
@@ -151,8 +227,9 @@ TeeProcessStream(
             break;
         }
 
-        TeeWriteLine(StdOutHandle, StdOutIsConsole, &LineString);
-        TeeWriteLine(TeeContext->hFile, TeeContext->FileIsConsole, &LineString);
+        for (Index = 0; Index < TeeContext->SinkCount; Index++) {
+            TeeWriteLine(TeeContext->Sinks[Index].hDevice, TeeContext->Sinks[Index].IsConsole, &LineString);
+        }
     }
 
     YoriLibLineReadCloseOrCache(LineContext);
@@ -161,6 +238,177 @@ TeeProcessStream(
     return TRUE;
 }
 
+/**
+ A thread which writes blocks queued for a single output device, so that
+ each output proceeds at its own pace.
+
+ @param Context Pointer to the TEE_SINK to write to.
+
+ @return Zero to indicate success, nonzero to indicate failure.
+ */
+DWORD WINAPI
+TeeSinkThread(
+    __in PVOID Context
+    )
+{
+    PTEE_SINK Sink;
+    PTEE_BLOCK Block;
+    DWORD BytesWritten;
+    DWORD Offset;
+
+    Sink = (PTEE_SINK)Context;
+
+    while (TRUE) {
+        WaitForSingleObject(Sink->BlocksQueued, INFINITE);
+        Block = Sink->Queue[Sink->Head];
+        Sink->Queue[Sink->Head] = NULL;
+        Sink->Head = (Sink->Head + 1) % TEE_SINK_QUEUE_DEPTH;
+
+        if (Block == NULL) {
+            ReleaseSemaphore(Sink->EntriesFree, 1, NULL);
+            break;
+        }
+
+        Offset = 0;
+        while (!Sink->WriteFailed && Offset < Block->Length) {
+            if (!WriteFile(Sink->hDevice, &Block->Data[Offset], Block->Length - Offset, &BytesWritten, NULL) ||
+                BytesWritten == 0) {
+
+                Sink->WriteFailed = TRUE;
+                break;
+            }
+            Offset = Offset + BytesWritten;
+        }
+
+        YoriLibDereference(Block);
+        ReleaseSemaphore(Sink->EntriesFree, 1, NULL);
+    }
+
+    return Sink->WriteFailed?1:0;
+}
+
+/**
+ Add a block to the queue for an output device.  If the queue is full, this
+ waits for the output to write a block.
+
+ @param Sink Pointer to the output device.
+
+ @param Block Pointer to the block to add, or NULL to indicate the end of the
+        source.  If a block is specified, a reference is taken on it which
+        is released by the thread writing the output.
+ */
+VOID
+TeeQueueBlock(
+    __in PTEE_SINK Sink,
+    __in_opt PTEE_BLOCK Block
+    )
+{
+    WaitForSingleObject(Sink->EntriesFree, INFINITE);
+    if (Block != NULL) {
+        YoriLibReference(Block);
+    }
+    Sink->Queue[Sink->Tail] = Block;
+    Sink->Tail = (Sink->Tail + 1) % TEE_SINK_QUEUE_DEPTH;
+    ReleaseSemaphore(Sink->BlocksQueued, 1, NULL);
+}
+
+/**
+ Process a single stream without interpreting its contents.  Data is read in
+ large blocks and queued to a thread for each output device, so a slow
+ output does not delay the others until its queue is full.
+
+ @param hSource Handle to the source.
+
+ @param TeeContext Pointer to the context for the operation, including
+        handles to the output streams to write data to.
+
+ @return TRUE to indicate success or FALSE to indicate failure.
+ */
+BOOL
+TeeProcessStreamBlocks(
+    __in HANDLE hSource,
+    __in PTEE_CONTEXT TeeContext
+    )
+{
+    PTEE_SINK Sink;
+    PTEE_BLOCK Block;
+    DWORD BytesRead;
+    DWORD ThreadId;
+    DWORD Index;
+    DWORD ThreadsStarted;
+    BOOL Result;
+
+    Result = TRUE;
+    ThreadsStarted = 0;
+    for (Index = 0; Index < TeeContext->SinkCount; Index++) {
+        Sink = &TeeContext->Sinks[Index];
+        Sink->BlocksQueued = CreateSemaphore(NULL, 0, TEE_SINK_QUEUE_DEPTH, NULL);
+        Sink->EntriesFree = CreateSemaphore(NULL, TEE_SINK_QUEUE_DEPTH, TEE_SINK_QUEUE_DEPTH, NULL);
+        if (Sink->BlocksQueued == NULL || Sink->EntriesFree == NULL) {
+            Result = FALSE;
+            break;
+        }
+
+        Sink->hThread = CreateThread(NULL, 0, TeeSinkThread, Sink, 0, &ThreadId);
+        if (Sink->hThread == NULL) {
+            Result = FALSE;
+            break;
+        }
+        ThreadsStarted++;
+    }
+
+    while (Result) {
+        Block = YoriLibReferencedMalloc(FIELD_OFFSET(TEE_BLOCK, Data) + TEE_BLOCK_SIZE);
+        if (Block == NULL) {
+            Result = FALSE;
+            break;
+        }
+
+        if (!ReadFile(hSource, Block->Data, TEE_BLOCK_SIZE, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            YoriLibDereference(Block);
+            break;
+        }
+
+        Block->Length = BytesRead;
+        for (Index = 0; Index < ThreadsStarted; Index++) {
+            TeeQueueBlock(&TeeContext->Sinks[Index], Block);
+        }
+        YoriLibDereference(Block);
+    }
+
+    //
+    //  Indicate the end of the source to each output and wait for them to
+    //  finish writing.
+    //
+
+    for (Index = 0; Index < ThreadsStarted; Index++) {
+        Sink = &TeeContext->Sinks[Index];
+        TeeQueueBlock(Sink, NULL);
+        WaitForSingleObject(Sink->hThread, INFINITE);
+        CloseHandle(Sink->hThread);
+        Sink->hThread = NULL;
+        if (Sink->WriteFailed) {
+            Result = FALSE;
+        }
+    }
+
+    for (Index = 0; Index < TeeContext->SinkCount; Index++) {
+        Sink = &TeeContext->Sinks[Index];
+        if (Sink->BlocksQueued != NULL) {
+            CloseHandle(Sink->BlocksQueued);
+            Sink->BlocksQueued = NULL;
+        }
+        if (Sink->EntriesFree != NULL) {
+            CloseHandle(Sink->EntriesFree);
+            Sink->EntriesFree = NULL;
+        }
+    }
+
+    return Result;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the tee builtin command.
@@ -195,7 +443,13 @@ ENTRYPOINT(
     DWORD DesiredAccess;
     BOOLEAN Append = FALSE;
     BOOLEAN Console = FALSE;
+    BOOLEAN BlockMode = FALSE;
     TEE_CONTEXT TeeContext;
+    PTEE_SINK Sink;
+    DWORD SinksNeeded;
+    DWORD Index;
+    DWORD Junk;
+    DWORD Result;
     YORI_STRING FileName;
     YORI_STRING Arg;
 
@@ -217,6 +471,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
                 Append = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
+                BlockMode = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
                 Console = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -251,54 +508,102 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
+    //
+    //  Allocate an output for standard output, the console if requested,
+    //  and each file.
+    //
+
+    SinksNeeded = 1;
     if (Console) {
-        YoriLibConstantString(&FileName, _T("CONOUT$"));
-        TeeContext.FileIsConsole = TRUE;
+        SinksNeeded++;
+    }
+    if (StartArg != 0) {
+        SinksNeeded = SinksNeeded + (DWORD)(ArgC - StartArg);
+    }
+
+    TeeContext.Sinks = YoriLibMalloc(SinksNeeded * sizeof(TEE_SINK));
+    if (TeeContext.Sinks == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: out of memory\n"));
+        return EXIT_FAILURE;
+    }
+    ZeroMemory(TeeContext.Sinks, SinksNeeded * sizeof(TEE_SINK));
 
-        //
-        //  Open for read and write so we can query the cursor location.
-        //
+    Sink = &TeeContext.Sinks[0];
+    Sink->hDevice = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (GetConsoleMode(Sink->hDevice, &Junk)) {
+        Sink->IsConsole = TRUE;
+    }
+    TeeContext.SinkCount = 1;
 
-        DesiredAccess = GENERIC_READ | GENERIC_WRITE;
-    } else {
+    Result = EXIT_SUCCESS;
+    i = StartArg;
+    while (TeeContext.SinkCount < SinksNeeded) {
+        Sink = &TeeContext.Sinks[TeeContext.SinkCount];
+        if (Console && TeeContext.SinkCount == 1) {
+            YoriLibConstantString(&FileName, _T("CONOUT$"));
+            Sink->IsConsole = TRUE;
+
+            //
+            //  Open for read and write so we can query the cursor location.
+            //
+
+            DesiredAccess = GENERIC_READ | GENERIC_WRITE;
+        } else {
+
+            if (!YoriLibUserStringToSingleFilePath(&ArgV[i], TRUE, &FileName)) {
+                DWORD LastError = GetLastError();
+                LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: getfullpathname of %y failed: %s"), &ArgV[i], ErrText);
+                YoriLibFreeWinErrorText(ErrText);
+                Result = EXIT_FAILURE;
+                break;
+            }
+            i++;
+            DesiredAccess = (Append?FILE_APPEND_DATA:FILE_WRITE_DATA) | SYNCHRONIZE;
+        }
 
-        if (!YoriLibUserStringToSingleFilePath(&ArgV[StartArg], TRUE, &FileName)) {
+        Sink->hDevice = CreateFile(FileName.StartOfString,
+                                   DesiredAccess,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   NULL,
+                                   OPEN_ALWAYS,
+                                   FILE_ATTRIBUTE_NORMAL,
+                                   NULL);
+
+        if (Sink->hDevice == INVALID_HANDLE_VALUE || Sink->hDevice == NULL) {
             DWORD LastError = GetLastError();
             LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: getfullpathname of %y failed: %s"), &ArgV[StartArg], ErrText);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: open of %y failed: %s"), &FileName, ErrText);
             YoriLibFreeWinErrorText(ErrText);
-            return EXIT_FAILURE;
+            YoriLibFreeStringContents(&FileName);
+            Result = EXIT_FAILURE;
+            break;
         }
-        DesiredAccess = (Append?FILE_APPEND_DATA:FILE_WRITE_DATA) | SYNCHRONIZE;
-    }
 
-    TeeContext.hFile = CreateFile(FileName.StartOfString,
-                                  DesiredAccess,
-                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                                  NULL,
-                                  OPEN_ALWAYS,
-                                  FILE_ATTRIBUTE_NORMAL,
-                                  NULL);
-
-    if (TeeContext.hFile == INVALID_HANDLE_VALUE || TeeContext.hFile == NULL) {
-        DWORD LastError = GetLastError();
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tee: open of %y failed: %s"), &FileName, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
         YoriLibFreeStringContents(&FileName);
-        return EXIT_FAILURE;
+        TeeContext.SinkCount++;
     }
 
-    TeeProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TeeContext);
+    if (Result == EXIT_SUCCESS) {
+        if (BlockMode) {
+            if (!TeeProcessStreamBlocks(GetStdHandle(STD_INPUT_HANDLE), &TeeContext)) {
+                Result = EXIT_FAILURE;
+            }
+        } else {
+            TeeProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TeeContext);
+        }
+    }
 
 #if !YORI_BUILTIN
     YoriLibLineReadCleanupCache();
 #endif
 
-    CloseHandle(TeeContext.hFile);
-    YoriLibFreeStringContents(&FileName);
+    for (Index = 1; Index < TeeContext.SinkCount; Index++) {
+        CloseHandle(TeeContext.Sinks[Index].hDevice);
+    }
+    YoriLibFree(TeeContext.Sinks);
 
-    return EXIT_SUCCESS;
+    return Result;
 }
 
 // vim:sw=4:ts=4:et:
@@ -0,0 +1,365 @@
+/**
+ * @file test/mem.c
+ *
+ * Yori shell test memory copy, move, fill and compare routines
+ *
+ * Copyright (c) 2026 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "test.h"
+
+/**
+ The size of the buffers used to validate memory operations.  This needs to
+ be large enough to hold the largest length plus the largest offset.
+ */
+#define TEST_MEM_BUFFER_SIZE (256)
+
+/**
+ The largest offset from the start of a buffer to test.  This should exceed
+ the size of a machine word so every alignment is exercised.
+ */
+#define TEST_MEM_MAX_OFFSET (16)
+
+/**
+ The largest length to test.
+ */
+#define TEST_MEM_MAX_LENGTH (TEST_MEM_BUFFER_SIZE - TEST_MEM_MAX_OFFSET)
+
+/**
+ Fill a buffer with a pattern that differs for every byte within a word and
+ differs between calls with a different seed.
+
+ @param Buffer Pointer to the buffer to fill.
+
+ @param Length The number of bytes in the buffer.
+
+ @param Seed A value to mix into the pattern.
+ */
+VOID
+TestMemFillPattern(
+    __out_bcount(Length) PUCHAR Buffer,
+    __in DWORD Length,
+    __in DWORD Seed
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Length; Index++) {
+        Buffer[Index] = (UCHAR)((Index * 7 + Seed * 13 + 1) & 0xFF);
+    }
+}
+
+/**
+ Compare two buffers one byte at a time, without using the routines being
+ tested.
+
+ @param Buffer1 Pointer to the first buffer.
+
+ @param Buffer2 Pointer to the second buffer.
+
+ @param Length The number of bytes to compare.
+
+ @return TRUE if the buffers are identical, FALSE if they differ.
+ */
+BOOLEAN
+TestMemIsEqual(
+    __in_bcount(Length) PUCHAR Buffer1,
+    __in_bcount(Length) PUCHAR Buffer2,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < Length; Index++) {
+        if (Buffer1[Index] != Buffer2[Index]) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Copy memory at every combination of source offset, destination offset and
+ length, and check that exactly the requested range was updated.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+TestMemCopy(VOID)
+{
+    UCHAR Source[TEST_MEM_BUFFER_SIZE];
+    UCHAR Dest[TEST_MEM_BUFFER_SIZE];
+    UCHAR Expected[TEST_MEM_BUFFER_SIZE];
+    DWORD SrcOffset;
+    DWORD DestOffset;
+    DWORD Length;
+    DWORD Index;
+
+    for (SrcOffset = 0; SrcOffset < TEST_MEM_MAX_OFFSET; SrcOffset++) {
+        for (DestOffset = 0; DestOffset < TEST_MEM_MAX_OFFSET; DestOffset++) {
+            for (Length = 0; Length < TEST_MEM_MAX_LENGTH; Length++) {
+                TestMemFillPattern(Source, sizeof(Source), 1);
+                TestMemFillPattern(Dest, sizeof(Dest), 2);
+                TestMemFillPattern(Expected, sizeof(Expected), 2);
+                for (Index = 0; Index < Length; Index++) {
+                    Expected[DestOffset + Index] = Source[SrcOffset + Index];
+                }
+
+                memcpy(&Dest[DestOffset], &Source[SrcOffset], Length);
+
+                if (!TestMemIsEqual(Dest, Expected, sizeof(Dest))) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memcpy mismatch, source offset %i dest offset %i length %i\n"), __FILE__, __LINE__, SrcOffset, DestOffset, Length);
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Move memory within a single buffer at every combination of source offset,
+ destination offset and length, so that forward and backward overlapping
+ moves are both exercised.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+TestMemMove(VOID)
+{
+    UCHAR Buffer[TEST_MEM_BUFFER_SIZE];
+    UCHAR Original[TEST_MEM_BUFFER_SIZE];
+    UCHAR Expected[TEST_MEM_BUFFER_SIZE];
+    DWORD SrcOffset;
+    DWORD DestOffset;
+    DWORD Length;
+    DWORD Index;
+
+    for (SrcOffset = 0; SrcOffset < TEST_MEM_MAX_OFFSET; SrcOffset++) {
+        for (DestOffset = 0; DestOffset < TEST_MEM_MAX_OFFSET; DestOffset++) {
+            for (Length = 0; Length < TEST_MEM_MAX_LENGTH; Length++) {
+                TestMemFillPattern(Buffer, sizeof(Buffer), 3);
+                TestMemFillPattern(Original, sizeof(Original), 3);
+                TestMemFillPattern(Expected, sizeof(Expected), 3);
+                for (Index = 0; Index < Length; Index++) {
+                    Expected[DestOffset + Index] = Original[SrcOffset + Index];
+                }
+
+                memmove(&Buffer[DestOffset], &Buffer[SrcOffset], Length);
+
+                if (!TestMemIsEqual(Buffer, Expected, sizeof(Buffer))) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memmove mismatch, source offset %i dest offset %i length %i\n"), __FILE__, __LINE__, SrcOffset, DestOffset, Length);
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Fill memory at every combination of offset and length, using a value with
+ the high bit set to check that it is replicated without sign extension.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+TestMemSet(VOID)
+{
+    UCHAR Buffer[TEST_MEM_BUFFER_SIZE];
+    UCHAR Expected[TEST_MEM_BUFFER_SIZE];
+    DWORD Offset;
+    DWORD Length;
+    DWORD Index;
+
+    for (Offset = 0; Offset < TEST_MEM_MAX_OFFSET; Offset++) {
+        for (Length = 0; Length < TEST_MEM_MAX_LENGTH; Length++) {
+            TestMemFillPattern(Buffer, sizeof(Buffer), 4);
+            TestMemFillPattern(Expected, sizeof(Expected), 4);
+            for (Index = 0; Index < Length; Index++) {
+                Expected[Offset + Index] = 0xA5;
+            }
+
+            memset(&Buffer[Offset], (char)0xA5, Length);
+
+            if (!TestMemIsEqual(Buffer, Expected, sizeof(Buffer))) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memset mismatch, offset %i length %i\n"), __FILE__, __LINE__, Offset, Length);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Compare memory at every combination of offsets and lengths, where the
+ buffers are equal or differ at a single byte, and check that the ordering
+ is determined by the first differing byte.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+TestMemCompare(VOID)
+{
+    UCHAR Buffer1[TEST_MEM_BUFFER_SIZE];
+    UCHAR Buffer2[TEST_MEM_BUFFER_SIZE];
+    DWORD Offset1;
+    DWORD Offset2;
+    DWORD Length;
+    DWORD Index;
+    int Result;
+
+    for (Offset1 = 0; Offset1 < TEST_MEM_MAX_OFFSET; Offset1++) {
+        for (Offset2 = 0; Offset2 < TEST_MEM_MAX_OFFSET; Offset2++) {
+            for (Length = 1; Length < TEST_MEM_MAX_LENGTH; Length += 3) {
+                TestMemFillPattern(Buffer1, sizeof(Buffer1), 5);
+                TestMemFillPattern(Buffer2, sizeof(Buffer2), 6);
+                for (Index = 0; Index < Length; Index++) {
+                    Buffer2[Offset2 + Index] = Buffer1[Offset1 + Index];
+                }
+
+                if (memcmp(&Buffer1[Offset1], &Buffer2[Offset2], Length) != 0) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memcmp reported equal buffers as different, offset %i offset %i length %i\n"), __FILE__, __LINE__, Offset1, Offset2, Length);
+                    return FALSE;
+                }
+
+                //
+                //  Make the buffers differ at one byte, with a later byte
+                //  differing in the opposite direction, so a comparison of
+                //  whole little endian words would give the wrong answer.
+                //
+
+                Index = Length / 2;
+                Buffer1[Offset1 + Index] = 0x10;
+                Buffer2[Offset2 + Index] = 0x20;
+                if (Index + 1 < Length) {
+                    Buffer1[Offset1 + Index + 1] = 0xF0;
+                    Buffer2[Offset2 + Index + 1] = 0x00;
+                }
+
+                Result = memcmp(&Buffer1[Offset1], &Buffer2[Offset2], Length);
+                if (Result >= 0) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memcmp returned %i, expected less than zero, offset %i offset %i length %i\n"), __FILE__, __LINE__, Result, Offset1, Offset2, Length);
+                    return FALSE;
+                }
+
+                Result = memcmp(&Buffer2[Offset2], &Buffer1[Offset1], Length);
+                if (Result <= 0) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memcmp returned %i, expected greater than zero, offset %i offset %i length %i\n"), __FILE__, __LINE__, Result, Offset1, Offset2, Length);
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ The size of the buffers used to measure memory bandwidth.
+ */
+#define TEST_MEM_BENCHMARK_BUFFER_SIZE (1024 * 1024)
+
+/**
+ The total number of bytes to copy for each block size when measuring
+ memory bandwidth.
+ */
+#define TEST_MEM_BENCHMARK_TOTAL_SIZE (256 * 1024 * 1024)
+
+/**
+ Copy a large amount of data using a range of block sizes and report the
+ throughput of each.  This variation only fails if the buffers cannot be
+ allocated or the data is not copied correctly; the numbers it reports are
+ for comparing builds of the runtime library.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+TestMemBandwidth(VOID)
+{
+    PUCHAR Source;
+    PUCHAR Dest;
+    DWORD BlockSizes[] = {16, 64, 256, 4096, 65536, TEST_MEM_BENCHMARK_BUFFER_SIZE};
+    DWORD SizeIndex;
+    DWORD BlockSize;
+    DWORD Offset;
+    DWORD Iteration;
+    DWORD Iterations;
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LONGLONG Elapsed;
+    LONGLONG MbPerSecond;
+
+    if (!QueryPerformanceFrequency(&Frequency) || Frequency.QuadPart == 0) {
+        Frequency.QuadPart = 1000;
+    }
+
+    Source = YoriLibMalloc(TEST_MEM_BENCHMARK_BUFFER_SIZE * 2);
+    if (Source == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i Allocation failure\n"), __FILE__, __LINE__);
+        return FALSE;
+    }
+    Dest = Source + TEST_MEM_BENCHMARK_BUFFER_SIZE;
+
+    TestMemFillPattern(Source, TEST_MEM_BENCHMARK_BUFFER_SIZE, 7);
+
+    for (SizeIndex = 0; SizeIndex < sizeof(BlockSizes)/sizeof(BlockSizes[0]); SizeIndex++) {
+        BlockSize = BlockSizes[SizeIndex];
+        Iterations = TEST_MEM_BENCHMARK_TOTAL_SIZE / BlockSize;
+        Offset = 0;
+
+        QueryPerformanceCounter(&StartTime);
+        for (Iteration = 0; Iteration < Iterations; Iteration++) {
+            memcpy(&Dest[Offset], &Source[Offset], BlockSize);
+            Offset = Offset + BlockSize;
+            if (Offset >= TEST_MEM_BENCHMARK_BUFFER_SIZE) {
+                Offset = 0;
+            }
+        }
+        QueryPerformanceCounter(&EndTime);
+
+        if (!TestMemIsEqual(Source, Dest, TEST_MEM_BENCHMARK_BUFFER_SIZE)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%hs:%i memcpy mismatch with block size %i\n"), __FILE__, __LINE__, BlockSize);
+            YoriLibFree(Source);
+            return FALSE;
+        }
+
+        Elapsed = EndTime.QuadPart - StartTime.QuadPart;
+        if (Elapsed <= 0) {
+            Elapsed = 1;
+        }
+
+        MbPerSecond = (LONGLONG)TEST_MEM_BENCHMARK_TOTAL_SIZE * Frequency.QuadPart / Elapsed / (1024 * 1024);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("    memcpy %8i byte blocks: %lli Mb/s\n"), BlockSize, MbPerSecond);
+    }
+
+    YoriLibFree(Source);
+    return TRUE;
+}
+
+// vim:sw=4:ts=4:et:
@@ -93,6 +93,11 @@ TEST_VARIATION TestVariations[] = {
     {TestArgOneArgEnclosedInQuotesCmd,     _T("ArgOneArgEnclosedInQuotesCmd")},
     {TestArgRedirectWithEndingQuoteCmd,    _T("ArgRedirectWithEndingQuoteCmd")},
     {TestArgBackslashEscapeCmd,            _T("ArgBackslashEscapeCmd")},
+    {TestMemCopy,                          _T("MemCopy")},
+    {TestMemMove,                          _T("MemMove")},
+    {TestMemSet,                           _T("MemSet")},
+    {TestMemCompare,                       _T("MemCompare")},
+    {TestMemBandwidth,                     _T("MemBandwidth")},
 };
 
 
@@ -125,4 +125,29 @@ YORI_TEST_FN TestArgRedirectWithEndingQuoteCmd;
  */
 YORI_TEST_FN TestArgBackslashEscapeCmd;
 
+/**
+ A test variation to copy memory at every alignment.
+ */
+YORI_TEST_FN TestMemCopy;
+
+/**
+ A test variation to move overlapping memory at every alignment.
+ */
+YORI_TEST_FN TestMemMove;
+
+/**
+ A test variation to fill memory at every alignment.
+ */
+YORI_TEST_FN TestMemSet;
+
+/**
+ A test variation to compare memory at every alignment.
+ */
+YORI_TEST_FN TestMemCompare;
+
+/**
+ A test variation to report memory copy throughput.
+ */
+YORI_TEST_FN TestMemBandwidth;
+
 // vim:sw=4:ts=4:et:
@@ -38,7 +38,11 @@ CHAR strTimeThisHelpText[] =
         "\n"
         "Runs a child program and times its execution.\n"
         "\n"
-        "TIMETHIS [-license] [-f <fmt>] <command>\n"
+        "TIMETHIS [-license] [-f <fmt>] [-r <count>] <command>\n"
+        "\n"
+        "   -f             Specify a format string to display results\n"
+        "   -r             Run the command multiple times and display the minimum,\n"
+        "                    median and maximum of each result\n"
         "\n"
         "Format specifiers are:\n"
         "   $CHILDCPU$         Amount of CPU time used by the child process\n"
@@ -53,8 +57,16 @@ CHAR strTimeThisHelpText[] =
         "   $TREECPUMS$        Amount of CPU time used by all child processes in ms\n"
         "   $TREEKERNEL$       Amount of kernel time used by all child processes\n"
         "   $TREEKERNELMS$     Amount of kernel time used by all child processes in ms\n"
+        "   $TREEOTHERBYTES$   Bytes transferred by other IO from all child processes\n"
+        "   $TREEOTHEROPS$     Number of other IO operations by all child processes\n"
+        "   $TREEPEAKMEMORY$   Peak memory committed by all child processes in bytes\n"
+        "   $TREEPROCESSES$    Number of processes launched including the child\n"
+        "   $TREEREADBYTES$    Bytes read by all child processes\n"
+        "   $TREEREADOPS$      Number of read operations by all child processes\n"
         "   $TREEUSER$         Amount of user time used by all child processes\n"
-        "   $TREEUSERMS$       Amount of user time used by all child processes in ms\n";
+        "   $TREEUSERMS$       Amount of user time used by all child processes in ms\n"
+        "   $TREEWRITEBYTES$   Bytes written by all child processes\n"
+        "   $TREEWRITEOPS$     Number of write operations by all child processes\n";
 
 /**
  Display usage text to the user.
@@ -160,7 +172,8 @@ TimeThisOutputTimestamp(
 
 /**
  Context containing the results of execution to pass to helper function used
- to format output.
+ to format output.  Every field is a LARGE_INTEGER so that statistics across
+ multiple runs can be calculated by treating the structure as an array.
  */
 typedef struct _TIMETHIS_CONTEXT {
 
@@ -192,6 +205,48 @@ typedef struct _TIMETHIS_CONTEXT {
      Amount of time taken to execute the child process.
      */
     LARGE_INTEGER WallTimeInMs;
+
+    /**
+     The number of processes launched within the child process tree.
+     */
+    LARGE_INTEGER TreeProcesses;
+
+    /**
+     The largest amount of memory committed by the child process tree at any
+     one time, in bytes.
+     */
+    LARGE_INTEGER TreePeakMemory;
+
+    /**
+     The number of read operations performed by the child process tree.
+     */
+    LARGE_INTEGER TreeReadOperations;
+
+    /**
+     The number of write operations performed by the child process tree.
+     */
+    LARGE_INTEGER TreeWriteOperations;
+
+    /**
+     The number of other operations performed by the child process tree.
+     */
+    LARGE_INTEGER TreeOtherOperations;
+
+    /**
+     The number of bytes read by the child process tree.
+     */
+    LARGE_INTEGER TreeReadBytes;
+
+    /**
+     The number of bytes written by the child process tree.
+     */
+    LARGE_INTEGER TreeWriteBytes;
+
+    /**
+     The number of bytes transferred by other operations in the child
+     process tree.
+     */
+    LARGE_INTEGER TreeOtherBytes;
 } TIMETHIS_CONTEXT, *PTIMETHIS_CONTEXT;
 
 /**
@@ -248,14 +303,291 @@ TimeThisExpandVariables(
         return TimeThisOutputTimestamp(TimeThisContext->KernelTimeTreeInMs, OutputBuffer);
     } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEKERNELMS")) == 0) {
         return TimeThisOutputLargeInteger(TimeThisContext->KernelTimeTreeInMs, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEOTHERBYTES")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeOtherBytes, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEOTHEROPS")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeOtherOperations, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEPEAKMEMORY")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreePeakMemory, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEPROCESSES")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeProcesses, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEREADBYTES")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeReadBytes, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEREADOPS")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeReadOperations, 10, OutputBuffer);
     } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEUSER")) == 0) {
         return TimeThisOutputTimestamp(TimeThisContext->UserTimeTreeInMs, OutputBuffer);
     } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEUSERMS")) == 0) {
         return TimeThisOutputLargeInteger(TimeThisContext->UserTimeTreeInMs, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEWRITEBYTES")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeWriteBytes, 10, OutputBuffer);
+    } else if (YoriLibCompareStringWithLiteral(VariableName, _T("TREEWRITEOPS")) == 0) {
+        return TimeThisOutputLargeInteger(TimeThisContext->TreeWriteOperations, 10, OutputBuffer);
     }
     return 0;
 }
 
+/**
+ Expand a format string with the results of execution and display it.
+
+ @param FormatString Pointer to the format string.
+
+ @param TimeThisContext Pointer to the results of execution.
+ */
+VOID
+TimeThisDisplayResults(
+    __in PYORI_STRING FormatString,
+    __in PTIMETHIS_CONTEXT TimeThisContext
+    )
+{
+    YORI_STRING DisplayString;
+
+    YoriLibInitEmptyString(&DisplayString);
+    YoriLibExpandCommandVariables(FormatString, '$', FALSE, TimeThisExpandVariables, TimeThisContext, &DisplayString);
+    if (DisplayString.StartOfString != NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
+        YoriLibFreeStringContents(&DisplayString);
+    }
+}
+
+/**
+ Calculate the minimum, median and maximum of each result across a set of
+ runs.  Each result is considered independently, so the values reported
+ for a statistic may come from different runs.
+
+ @param Runs Pointer to an array of results from each run.
+
+ @param RunCount The number of elements in the Runs array.
+
+ @param Minimum On completion, populated with the smallest value of each
+        result.
+
+ @param Median On completion, populated with the median value of each
+        result.
+
+ @param Maximum On completion, populated with the largest value of each
+        result.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+TimeThisCalculateStatistics(
+    __in PTIMETHIS_CONTEXT Runs,
+    __in DWORD RunCount,
+    __out PTIMETHIS_CONTEXT Minimum,
+    __out PTIMETHIS_CONTEXT Median,
+    __out PTIMETHIS_CONTEXT Maximum
+    )
+{
+    PLARGE_INTEGER Sorted;
+    PLARGE_INTEGER RunValues;
+    LARGE_INTEGER Value;
+    DWORD FieldIndex;
+    DWORD FieldCount;
+    DWORD RunIndex;
+    DWORD InsertIndex;
+
+    Sorted = YoriLibMalloc(RunCount * sizeof(LARGE_INTEGER));
+    if (Sorted == NULL) {
+        return FALSE;
+    }
+
+    FieldCount = sizeof(TIMETHIS_CONTEXT) / sizeof(LARGE_INTEGER);
+    for (FieldIndex = 0; FieldIndex < FieldCount; FieldIndex++) {
+
+        //
+        //  Insertion sort the values for this field.  The number of runs is
+        //  expected to be small.
+        //
+
+        for (RunIndex = 0; RunIndex < RunCount; RunIndex++) {
+            RunValues = (PLARGE_INTEGER)&Runs[RunIndex];
+            Value.QuadPart = RunValues[FieldIndex].QuadPart;
+            InsertIndex = RunIndex;
+            while (InsertIndex > 0 && Sorted[InsertIndex - 1].QuadPart > Value.QuadPart) {
+                Sorted[InsertIndex].QuadPart = Sorted[InsertIndex - 1].QuadPart;
+                InsertIndex--;
+            }
+            Sorted[InsertIndex].QuadPart = Value.QuadPart;
+        }
+
+        ((PLARGE_INTEGER)Minimum)[FieldIndex].QuadPart = Sorted[0].QuadPart;
+        ((PLARGE_INTEGER)Maximum)[FieldIndex].QuadPart = Sorted[RunCount - 1].QuadPart;
+        if ((RunCount % 2) == 0) {
+            ((PLARGE_INTEGER)Median)[FieldIndex].QuadPart = (Sorted[RunCount / 2 - 1].QuadPart + Sorted[RunCount / 2].QuadPart) / 2;
+        } else {
+            ((PLARGE_INTEGER)Median)[FieldIndex].QuadPart = Sorted[RunCount / 2].QuadPart;
+        }
+    }
+
+    YoriLibFree(Sorted);
+    return TRUE;
+}
+
+/**
+ Execute a child process within a job object, wait for it to complete, and
+ collect the resources consumed by it and any processes it launched.
+
+ @param CmdLine Pointer to the command line to execute.
+
+ @param TimeThisContext On successful completion, populated with the
+        resources consumed by the child.
+
+ @param ExitCode On successful completion, populated with the exit code of
+        the child process.
+
+ @return TRUE to indicate the child was executed, FALSE if it could not be
+         executed or the user cancelled execution.
+ */
+__success(return)
+BOOL
+TimeThisExecuteChild(
+    __in PYORI_STRING CmdLine,
+    __out PTIMETHIS_CONTEXT TimeThisContext,
+    __out PDWORD ExitCode
+    )
+{
+    PROCESS_INFORMATION ProcessInfo;
+    STARTUPINFO StartupInfo;
+    HANDLE hJob;
+    FILETIME ftCreationTime;
+    FILETIME ftExitTime;
+    FILETIME ftKernelTime;
+    FILETIME ftUserTime;
+    LARGE_INTEGER liCreationTime;
+    LARGE_INTEGER liExitTime;
+
+    ZeroMemory(TimeThisContext, sizeof(TIMETHIS_CONTEXT));
+
+    hJob = YoriLibCreateJobObject();
+
+    memset(&StartupInfo, 0, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+
+    if (!CreateProcess(NULL, CmdLine->StartOfString, NULL, NULL, TRUE, CREATE_SUSPENDED | CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &StartupInfo, &ProcessInfo)) {
+        DWORD LastError = GetLastError();
+        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("timethis: execution failed: %s"), ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        if (hJob != NULL) {
+            CloseHandle(hJob);
+        }
+        return FALSE;
+    }
+
+    if (hJob != NULL) {
+        YoriLibAssignProcessToJobObject(hJob, ProcessInfo.hProcess);
+    }
+
+    ResumeThread(ProcessInfo.hThread);
+
+    //
+    //  Wait for the immediate child process to terminate.
+    //
+
+#if YORI_BUILTIN
+    {
+        HANDLE HandleArray[2];
+        DWORD WaitResult;
+
+        YoriLibCancelEnable(FALSE);
+        HandleArray[1] = YoriLibCancelGetEvent();
+        HandleArray[0] = ProcessInfo.hProcess;
+
+        WaitResult = WaitForMultipleObjectsEx(2, HandleArray, FALSE, INFINITE, FALSE);
+
+        //
+        //  If cancelled, abort
+        //
+
+        if (WaitResult == WAIT_OBJECT_0 + 1) {
+            CloseHandle(ProcessInfo.hProcess);
+            CloseHandle(ProcessInfo.hThread);
+            if (hJob != NULL) {
+                CloseHandle(hJob);
+            }
+
+            return FALSE;
+        }
+    }
+#else
+    WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+#endif
+    GetExitCodeProcess(ProcessInfo.hProcess, ExitCode);
+
+    //
+    //  Save off times from the child process.
+    //
+
+    GetProcessTimes(ProcessInfo.hProcess, &ftCreationTime, &ftExitTime, &ftKernelTime, &ftUserTime);
+
+    liCreationTime.HighPart = ftCreationTime.dwHighDateTime;
+    liCreationTime.LowPart = ftCreationTime.dwLowDateTime;
+    liExitTime.HighPart = ftExitTime.dwHighDateTime;
+    liExitTime.LowPart = ftExitTime.dwLowDateTime;
+    TimeThisContext->KernelTimeInMs.HighPart = ftKernelTime.dwHighDateTime;
+    TimeThisContext->KernelTimeInMs.LowPart = ftKernelTime.dwLowDateTime;
+    TimeThisContext->KernelTimeInMs.QuadPart = TimeThisContext->KernelTimeInMs.QuadPart / (10 * 1000);
+    TimeThisContext->UserTimeInMs.HighPart = ftUserTime.dwHighDateTime;
+    TimeThisContext->UserTimeInMs.LowPart = ftUserTime.dwLowDateTime;
+    TimeThisContext->UserTimeInMs.QuadPart = TimeThisContext->UserTimeInMs.QuadPart / (10 * 1000);
+
+    TimeThisContext->WallTimeInMs.QuadPart = (liExitTime.QuadPart - liCreationTime.QuadPart) / (10 * 1000);
+
+    //
+    //  Save off times from all processes within the job, if it exists.
+    //  Note that currently we're not waiting for all processes within the
+    //  job to terminate.
+    //
+
+    TimeThisContext->KernelTimeTreeInMs.QuadPart = TimeThisContext->KernelTimeInMs.QuadPart;
+    TimeThisContext->UserTimeTreeInMs.QuadPart = TimeThisContext->UserTimeInMs.QuadPart;
+    TimeThisContext->TreeProcesses.QuadPart = 1;
+
+    if (hJob != NULL && DllKernel32.pQueryInformationJobObject != NULL) {
+        YORI_JOB_BASIC_AND_IO_ACCOUNTING_INFORMATION JobInfo;
+        YORI_JOB_EXTENDED_LIMIT_INFORMATION LimitInfo;
+        DWORD BytesReturned;
+
+        //
+        //  IO accounting is available from NT 5.0.  Older systems only
+        //  provide basic accounting.
+        //
+
+        if (DllKernel32.pQueryInformationJobObject(hJob, YORI_JOB_OBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION, &JobInfo, sizeof(JobInfo), &BytesReturned)) {
+
+            TimeThisContext->TreeReadOperations.QuadPart = JobInfo.IoInfo.ReadOperationCount;
+            TimeThisContext->TreeWriteOperations.QuadPart = JobInfo.IoInfo.WriteOperationCount;
+            TimeThisContext->TreeOtherOperations.QuadPart = JobInfo.IoInfo.OtherOperationCount;
+            TimeThisContext->TreeReadBytes.QuadPart = JobInfo.IoInfo.ReadTransferCount;
+            TimeThisContext->TreeWriteBytes.QuadPart = JobInfo.IoInfo.WriteTransferCount;
+            TimeThisContext->TreeOtherBytes.QuadPart = JobInfo.IoInfo.OtherTransferCount;
+        } else if (!DllKernel32.pQueryInformationJobObject(hJob, 1, &JobInfo.BasicInfo, sizeof(JobInfo.BasicInfo), &BytesReturned)) {
+            JobInfo.BasicInfo.TotalProcesses = 0;
+        }
+
+        if (JobInfo.BasicInfo.TotalProcesses > 0) {
+            TimeThisContext->KernelTimeTreeInMs.QuadPart = JobInfo.BasicInfo.TotalKernelTime.QuadPart / (10 * 1000);
+            TimeThisContext->UserTimeTreeInMs.QuadPart = JobInfo.BasicInfo.TotalUserTime.QuadPart / (10 * 1000);
+            TimeThisContext->TreeProcesses.QuadPart = JobInfo.BasicInfo.TotalProcesses;
+        }
+
+        if (DllKernel32.pQueryInformationJobObject(hJob, YORI_JOB_OBJECT_EXTENDED_LIMIT_INFORMATION, &LimitInfo, sizeof(LimitInfo), &BytesReturned)) {
+            TimeThisContext->TreePeakMemory.QuadPart = LimitInfo.PeakJobMemoryUsed;
+        }
+    }
+
+    if (hJob != NULL) {
+        CloseHandle(hJob);
+    }
+
+    CloseHandle(ProcessInfo.hProcess);
+    CloseHandle(ProcessInfo.hThread);
+
+    return TRUE;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the timethis builtin command.
@@ -290,31 +622,28 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T StartArg = 0;
     YORI_ALLOC_SIZE_T i;
     YORI_STRING Arg;
-    YORI_STRING DisplayString;
     YORI_STRING AllocatedFormatString;
-    TIMETHIS_CONTEXT TimeThisContext;
     YORI_STRING Executable;
     PYORI_STRING ChildArgs;
-    PROCESS_INFORMATION ProcessInfo;
-    STARTUPINFO StartupInfo;
-    HANDLE hJob;
-    FILETIME ftCreationTime;
-    FILETIME ftExitTime;
-    FILETIME ftKernelTime;
-    FILETIME ftUserTime;
-
-    LARGE_INTEGER liCreationTime;
-    LARGE_INTEGER liExitTime;
+    PTIMETHIS_CONTEXT Runs;
+    DWORD RunCount;
+    DWORD RunIndex;
     LPTSTR DefaultFormatString = _T("Elapsed time:      $ELAPSEDTIME$\n")
                                  _T("Child CPU time:    $CHILDCPU$\n")
                                  _T("Child kernel time: $CHILDKERNEL$\n")
                                  _T("Child user time:   $CHILDUSER$\n")
                                  _T("Tree CPU time:     $TREECPU$\n")
                                  _T("Tree kernel time:  $TREEKERNEL$\n")
-                                 _T("Tree user time:    $TREEUSER$\n");
+                                 _T("Tree user time:    $TREEUSER$\n")
+                                 _T("Tree processes:    $TREEPROCESSES$\n")
+                                 _T("Tree peak memory:  $TREEPEAKMEMORY$\n")
+                                 _T("Tree read:         $TREEREADBYTES$ bytes in $TREEREADOPS$ operations\n")
+                                 _T("Tree write:        $TREEWRITEBYTES$ bytes in $TREEWRITEOPS$ operations\n")
+                                 _T("Tree other IO:     $TREEOTHERBYTES$ bytes in $TREEOTHEROPS$ operations\n");
 
     YoriLibInitEmptyString(&AllocatedFormatString);
     YoriLibConstantString(&AllocatedFormatString, DefaultFormatString);
+    RunCount = 1;
 
     for (i = 1; i < ArgC; i++) {
 
@@ -336,6 +665,21 @@ ENTRYPOINT(
                     ArgumentUnderstood = TRUE;
                     i++;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
+                if (ArgC > i + 1) {
+                    YORI_MAX_SIGNED_T llTemp;
+                    YORI_ALLOC_SIZE_T CharsConsumed;
+
+                    if (YoriLibStringToNumber(&ArgV[i + 1], TRUE, &llTemp, &CharsConsumed) &&
+                        CharsConsumed > 0 &&
+                        llTemp > 0 &&
+                        llTemp <= 10000) {
+
+                        RunCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -350,6 +694,7 @@ ENTRYPOINT(
 
     if (StartArg == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("timethis: missing argument\n"));
+        YoriLibFreeStringContents(&AllocatedFormatString);
         return EXIT_FAILURE;
     }
 
@@ -383,123 +728,48 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    ASSERT(YoriLibIsStringNullTerminated(&CmdLine));
-
-    hJob = YoriLibCreateJobObject();
+    YoriLibFreeStringContents(&Executable);
+    YoriLibFree(ChildArgs);
 
-    memset(&StartupInfo, 0, sizeof(StartupInfo));
-    StartupInfo.cb = sizeof(StartupInfo);
+    ASSERT(YoriLibIsStringNullTerminated(&CmdLine));
 
-    if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, CREATE_SUSPENDED | CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &StartupInfo, &ProcessInfo)) {
-        DWORD LastError = GetLastError();
-        LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("timethis: execution failed: %s"), ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFree(ChildArgs);
+    Runs = YoriLibMalloc(RunCount * sizeof(TIMETHIS_CONTEXT));
+    if (Runs == NULL) {
         YoriLibFreeStringContents(&CmdLine);
-        YoriLibFreeStringContents(&Executable);
         YoriLibFreeStringContents(&AllocatedFormatString);
-        if (hJob != NULL) {
-            CloseHandle(hJob);
-        }
         return EXIT_FAILURE;
     }
 
-    if (hJob != NULL) {
-        YoriLibAssignProcessToJobObject(hJob, ProcessInfo.hProcess);
-    }
-
-    ResumeThread(ProcessInfo.hThread);
-
-    YoriLibFreeStringContents(&Executable);
-    YoriLibFreeStringContents(&CmdLine);
-    YoriLibFree(ChildArgs);
-
-    //
-    //  Wait for the immediate child process to terminate.
-    //
-
-#if YORI_BUILTIN
-    {
-        HANDLE HandleArray[2];
-        DWORD WaitResult;
-
-        YoriLibCancelEnable(FALSE);
-        HandleArray[1] = YoriLibCancelGetEvent();
-        HandleArray[0] = ProcessInfo.hProcess;
-
-        WaitResult = WaitForMultipleObjectsEx(2, HandleArray, FALSE, INFINITE, FALSE);
-
-        //
-        //  If cancelled, abort
-        //
-
-        if (WaitResult == WAIT_OBJECT_0 + 1) {
-            CloseHandle(ProcessInfo.hProcess);
-            CloseHandle(ProcessInfo.hThread);
-            if (hJob != NULL) {
-                CloseHandle(hJob);
-            }
+    ExitCode = EXIT_FAILURE;
+    for (RunIndex = 0; RunIndex < RunCount; RunIndex++) {
+        if (!TimeThisExecuteChild(&CmdLine, &Runs[RunIndex], &ExitCode)) {
+            YoriLibFree(Runs);
+            YoriLibFreeStringContents(&CmdLine);
             YoriLibFreeStringContents(&AllocatedFormatString);
-
             return EXIT_FAILURE;
         }
     }
-#else
-    WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
-#endif
-    GetExitCodeProcess(ProcessInfo.hProcess, &ExitCode);
-
-    //
-    //  Save off times from the child process.
-    //
-
-    GetProcessTimes(ProcessInfo.hProcess, &ftCreationTime, &ftExitTime, &ftKernelTime, &ftUserTime);
 
-    liCreationTime.HighPart = ftCreationTime.dwHighDateTime;
-    liCreationTime.LowPart = ftCreationTime.dwLowDateTime;
-    liExitTime.HighPart = ftExitTime.dwHighDateTime;
-    liExitTime.LowPart = ftExitTime.dwLowDateTime;
-    TimeThisContext.KernelTimeInMs.HighPart = ftKernelTime.dwHighDateTime;
-    TimeThisContext.KernelTimeInMs.LowPart = ftKernelTime.dwLowDateTime;
-    TimeThisContext.KernelTimeInMs.QuadPart = TimeThisContext.KernelTimeInMs.QuadPart / (10 * 1000);
-    TimeThisContext.UserTimeInMs.HighPart = ftUserTime.dwHighDateTime;
-    TimeThisContext.UserTimeInMs.LowPart = ftUserTime.dwLowDateTime;
-    TimeThisContext.UserTimeInMs.QuadPart = TimeThisContext.UserTimeInMs.QuadPart / (10 * 1000);
-
-    TimeThisContext.WallTimeInMs.QuadPart = (liExitTime.QuadPart - liCreationTime.QuadPart) / (10 * 1000);
-
-    //
-    //  Save off times from all processes within the job, if it exists.
-    //  Note that currently we're not waiting for all processes within the
-    //  job to terminate.
-    //
-
-    TimeThisContext.KernelTimeTreeInMs.QuadPart = TimeThisContext.KernelTimeInMs.QuadPart;
-    TimeThisContext.UserTimeTreeInMs.QuadPart = TimeThisContext.UserTimeInMs.QuadPart;
-
-    if (hJob != NULL) {
-        YORI_JOB_BASIC_ACCOUNTING_INFORMATION JobInfo;
-        DWORD BytesReturned;
-
-        if (DllKernel32.pQueryInformationJobObject != NULL &&
-            DllKernel32.pQueryInformationJobObject(hJob, 1, &JobInfo, sizeof(JobInfo), &BytesReturned)) {
+    YoriLibFreeStringContents(&CmdLine);
 
-            TimeThisContext.KernelTimeTreeInMs.QuadPart = JobInfo.TotalKernelTime.QuadPart / (10 * 1000);
-            TimeThisContext.UserTimeTreeInMs.QuadPart = JobInfo.TotalUserTime.QuadPart / (10 * 1000);
+    if (RunCount == 1) {
+        TimeThisDisplayResults(&AllocatedFormatString, &Runs[0]);
+    } else {
+        TIMETHIS_CONTEXT Minimum;
+        TIMETHIS_CONTEXT Median;
+        TIMETHIS_CONTEXT Maximum;
+
+        if (TimeThisCalculateStatistics(Runs, RunCount, &Minimum, &Median, &Maximum)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Minimum of %i runs:\n"), RunCount);
+            TimeThisDisplayResults(&AllocatedFormatString, &Minimum);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\nMedian of %i runs:\n"), RunCount);
+            TimeThisDisplayResults(&AllocatedFormatString, &Median);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\nMaximum of %i runs:\n"), RunCount);
+            TimeThisDisplayResults(&AllocatedFormatString, &Maximum);
         }
-        CloseHandle(hJob);
     }
 
-    CloseHandle(ProcessInfo.hProcess);
-    CloseHandle(ProcessInfo.hThread);
-
-    YoriLibInitEmptyString(&DisplayString);
-    YoriLibExpandCommandVariables(&AllocatedFormatString, '$', FALSE, TimeThisExpandVariables, &TimeThisContext, &DisplayString);
-    if (DisplayString.StartOfString != NULL) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &DisplayString);
-        YoriLibFreeStringContents(&DisplayString);
-    }
+    YoriLibFree(Runs);
     YoriLibFreeStringContents(&AllocatedFormatString);
 
     return ExitCode;
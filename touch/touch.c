@@ -35,8 +35,8 @@ CHAR strTouchHelpText[] =
         "\n"
         "Create files or update timestamps.\n"
         "\n"
-        "TOUCH [-license] [-a] [-b] [-c] [-e] [-f size] [-h] [-s] [-t <date and time>]\n"
-        "      [-w] <file>...\n"
+        "TOUCH [-license] [-a] [-b] [-c] [-e] [-f size] [-h] [-j n] [-s]\n"
+        "      [-t <date and time>] [-w] <file>...\n"
         "\n"
         "   -a             Update last access time\n"
         "   -b             Use basic search criteria for files only\n"
@@ -44,6 +44,7 @@ CHAR strTouchHelpText[] =
         "   -e             Only update existing files\n"
         "   -f             Create new file with specified file size\n"
         "   -h             Operate on links as opposed to link targets\n"
+        "   -j             Update existing files on the specified number of threads\n"
         "   -s             Process files from all subdirectories\n"
         "   -t             Specify the timestamp to set\n"
         "   -w             Update write time\n";
@@ -93,6 +94,18 @@ typedef struct _TOUCH_CONTEXT {
      */
     ULONG FilesFoundThisArg;
 
+    /**
+     The number of threads to use when updating existing files.  If this is
+     greater than one, files are updated by the work queue.
+     */
+    DWORD ThreadCount;
+
+    /**
+     The queue of existing files to update on background threads.  This is
+     only used if ThreadCount is greater than one.
+     */
+    YORILIB_WORK_QUEUE WorkQueue;
+
     /**
      If TRUE, only existing files should be modified, and no new files should
      be created.
@@ -107,42 +120,56 @@ typedef struct _TOUCH_CONTEXT {
 } TOUCH_CONTEXT, *PTOUCH_CONTEXT;
 
 /**
- A callback that is invoked when a file is found that matches a search criteria
- specified in the set of strings to enumerate.
+ A single existing file to update on a background thread.
+ */
+typedef struct _TOUCH_WORK_ITEM {
 
- @param FilePath Pointer to the file path that was found.
+    /**
+     The work queue item for this file.
+     */
+    YORILIB_WORK_ITEM WorkItem;
 
- @param FileInfo Information about the file.  Note in this application this can
-        be NULL when it is operating on files that do not yet exist.
+    /**
+     Fully qualified path to the file.
+     */
+    YORI_STRING FilePath;
+} TOUCH_WORK_ITEM, *PTOUCH_WORK_ITEM;
 
- @param Depth Specifies the recursion depth.  Ignored in this application.
+/**
+ Open a file, creating it if requested, and apply the new timestamps to it.
 
- @param Context Pointer to the touch context structure indicating the
-        action to perform and populated with the file and line count found.
+ @param TouchContext Pointer to the touch context describing the timestamps
+        to apply.
 
- @return TRUE to continute enumerating, FALSE to abort.
+ @param FilePath Pointer to the fully qualified file path.
+
+ @param NewFile TRUE if the file was not found by enumeration and is
+        expected to be created.
+
+ @return TRUE if the file was opened, FALSE if it was not.
  */
 BOOL
-TouchFileFoundCallback(
+TouchUpdateFile(
+    __in PTOUCH_CONTEXT TouchContext,
     __in PYORI_STRING FilePath,
-    __in_opt PWIN32_FIND_DATA FileInfo,
-    __in DWORD Depth,
-    __in PVOID Context
+    __in BOOLEAN NewFile
     )
 {
     HANDLE FileHandle;
     DWORD DesiredAccess;
     DWORD OpenFlags;
-    PTOUCH_CONTEXT TouchContext = (PTOUCH_CONTEXT)Context;
-
-    UNREFERENCED_PARAMETER(Depth);
-    UNREFERENCED_PARAMETER(FileInfo);
 
     ASSERT(YoriLibIsStringNullTerminated(FilePath));
 
-    DesiredAccess = GENERIC_READ | FILE_WRITE_ATTRIBUTES;
-    if (FileInfo == NULL) {
-        DesiredAccess |= GENERIC_WRITE;
+    //
+    //  Updating timestamps on an existing file only needs attribute access,
+    //  which avoids opening file data and breaking oplocks held by other
+    //  processes.
+    //
+
+    DesiredAccess = FILE_WRITE_ATTRIBUTES;
+    if (NewFile) {
+        DesiredAccess |= GENERIC_READ | GENERIC_WRITE;
     }
 
     OpenFlags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS;
@@ -163,14 +190,13 @@ TouchFileFoundCallback(
         LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("touch: open of %y failed: %s"), FilePath, ErrText);
         YoriLibFreeWinErrorText(ErrText);
-        return TRUE;
+        return FALSE;
     }
 
-    TouchContext->FilesFoundThisArg++;
-
-    if (FileInfo == NULL) {
+    if (NewFile) {
         if (TouchContext->NewFileSize.QuadPart != 0) {
-            SetFilePointer(FileHandle, TouchContext->NewFileSize.LowPart, &TouchContext->NewFileSize.HighPart, FILE_BEGIN);
+            LONG NewFileSizeHigh = TouchContext->NewFileSize.HighPart;
+            SetFilePointer(FileHandle, TouchContext->NewFileSize.LowPart, &NewFileSizeHigh, FILE_BEGIN);
             if (!SetEndOfFile(FileHandle)) {
                 DWORD LastError = GetLastError();
                 LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
@@ -199,6 +225,132 @@ TouchFileFoundCallback(
     return TRUE;
 }
 
+/**
+ Update a single existing file on a background thread.
+
+ @param Context Pointer to the touch context.
+
+ @param Item Pointer to the work item within the touch work item.  The touch
+        work item is deallocated within this function.
+
+ @param Cancelled If TRUE, the operation has been cancelled and the file
+        should not be updated.
+ */
+VOID
+TouchWorkItem(
+    __in PVOID Context,
+    __in PYORILIB_WORK_ITEM Item,
+    __in BOOLEAN Cancelled
+    )
+{
+    PTOUCH_CONTEXT TouchContext = (PTOUCH_CONTEXT)Context;
+    PTOUCH_WORK_ITEM TouchItem;
+
+    TouchItem = CONTAINING_RECORD(Item, TOUCH_WORK_ITEM, WorkItem);
+
+    if (!Cancelled) {
+        TouchUpdateFile(TouchContext, &TouchItem->FilePath, FALSE);
+    }
+
+    YoriLibFreeStringContents(&TouchItem->FilePath);
+    YoriLibFree(TouchItem);
+}
+
+/**
+ Attempt to update an existing file on a background thread.
+
+ @param TouchContext Pointer to the touch context.
+
+ @param FilePath Pointer to the fully qualified file path.
+
+ @return TRUE if the file was queued for a background thread, FALSE if it
+         was not and should be updated by the caller.
+ */
+BOOL
+TouchQueueFile(
+    __in PTOUCH_CONTEXT TouchContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PTOUCH_WORK_ITEM TouchItem;
+
+    TouchItem = YoriLibMalloc(sizeof(TOUCH_WORK_ITEM));
+    if (TouchItem == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(TouchItem, sizeof(TOUCH_WORK_ITEM));
+
+    //
+    //  The file name is a buffer owned by the enumerator which will be
+    //  reused for the next file, so it needs to be copied.
+    //
+
+    if (!YoriLibCopyString(&TouchItem->FilePath, FilePath)) {
+        YoriLibFree(TouchItem);
+        return FALSE;
+    }
+
+    if (YoriLibQueueWorkItem(&TouchContext->WorkQueue, &TouchItem->WorkItem, TRUE)) {
+        return TRUE;
+    }
+
+    YoriLibFreeStringContents(&TouchItem->FilePath);
+    YoriLibFree(TouchItem);
+    return FALSE;
+}
+
+/**
+ A callback that is invoked when a file is found that matches a search criteria
+ specified in the set of strings to enumerate.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.  Note in this application this can
+        be NULL when it is operating on files that do not yet exist.
+
+ @param Depth Specifies the recursion depth.  Ignored in this application.
+
+ @param Context Pointer to the touch context structure indicating the
+        action to perform and populated with the file and line count found.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+TouchFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in_opt PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PTOUCH_CONTEXT TouchContext = (PTOUCH_CONTEXT)Context;
+
+    UNREFERENCED_PARAMETER(Depth);
+
+    //
+    //  Files found by enumeration already exist, so they can be updated in
+    //  any order.  Files being created are handled on this thread so the
+    //  caller can tell whether anything was found.
+    //
+
+    if (FileInfo != NULL && TouchContext->ThreadCount > 1) {
+        if (TouchQueueFile(TouchContext, FilePath)) {
+            TouchContext->FilesFoundThisArg++;
+            return TRUE;
+        }
+        if (TouchContext->WorkQueue.Cancelled) {
+            return FALSE;
+        }
+    }
+
+    if (TouchUpdateFile(TouchContext, FilePath, (BOOLEAN)(FileInfo == NULL))) {
+        TouchContext->FilesFoundThisArg++;
+    }
+
+    return TRUE;
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the touch builtin command.
@@ -240,6 +392,8 @@ ENTRYPOINT(
     FILETIME TimestampToUse;
     TOUCH_CONTEXT TouchContext;
     YORI_STRING Arg;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
 
     ZeroMemory(&TouchContext, sizeof(TouchContext));
     GetSystemTime(&CurrentSystemTime);
@@ -282,6 +436,14 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
                 TouchContext.NoFollowLinks = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        TouchContext.ThreadCount = (DWORD)llTemp;
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -367,6 +529,12 @@ ENTRYPOINT(
             MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
         }
 
+        if (TouchContext.ThreadCount > 1) {
+            if (!YoriLibInitializeWorkQueue(&TouchContext.WorkQueue, (YORI_ALLOC_SIZE_T)TouchContext.ThreadCount, 0, TouchWorkItem, &TouchContext)) {
+                return EXIT_FAILURE;
+            }
+        }
+
         for (i = StartArg; i < ArgC; i++) {
 
             TouchContext.FilesFoundThisArg = 0;
@@ -380,6 +548,11 @@ ENTRYPOINT(
                 }
             }
         }
+
+        if (TouchContext.ThreadCount > 1) {
+            YoriLibWaitForWorkQueue(&TouchContext.WorkQueue);
+            YoriLibCleanupWorkQueue(&TouchContext.WorkQueue);
+        }
     }
 
     return EXIT_SUCCESS;
@@ -35,9 +35,10 @@ CHAR strTypeHelpText[] =
         "\n"
         "Output the contents of one or more files.\n"
         "\n"
-        "TYPE [-license] [-b] [-s] [-h <num>] [-n] [<file>...]\n"
+        "TYPE [-license] [-b] [-c] [-s] [-h <num>] [-n] [<file>...]\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -c             Copy contents without converting encoding or line endings\n"
         "   -h <num>       Display <num> lines from the beginning of each file\n"
         "   -n             Display line numbers\n"
         "   -s             Process files from all subdirectories\n";
@@ -100,8 +101,65 @@ typedef struct _TYPE_CONTEXT {
      */
     DWORDLONG FileLinesFound;
 
+    /**
+     When copying contents without interpreting lines, a buffer to read each
+     block into.  NULL if contents are processed as lines.
+     */
+    PUCHAR Buffer;
+
 } TYPE_CONTEXT, *PTYPE_CONTEXT;
 
+/**
+ The number of bytes to read and write at a time when copying contents
+ without interpreting lines.
+ */
+#define TYPE_BLOCK_SIZE (1024 * 1024)
+
+/**
+ Copy a single opened stream to standard output in large blocks, without
+ splitting it into lines or converting its encoding.
+
+ @param hSource The opened source stream.
+
+ @param hOutput The output stream.
+
+ @param TypeContext Pointer to context information, including the buffer to
+        read into.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+TypeCopyStreamBlocks(
+    __in HANDLE hSource,
+    __in HANDLE hOutput,
+    __in PTYPE_CONTEXT TypeContext
+    )
+{
+    DWORD BytesRead;
+    DWORD BytesWritten;
+    DWORD Offset;
+
+    while (TRUE) {
+        if (!ReadFile(hSource, TypeContext->Buffer, TYPE_BLOCK_SIZE, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            break;
+        }
+
+        Offset = 0;
+        while (Offset < BytesRead) {
+            if (!WriteFile(hOutput, &TypeContext->Buffer[Offset], BytesRead - Offset, &BytesWritten, NULL) ||
+                BytesWritten == 0) {
+
+                return FALSE;
+            }
+            Offset = Offset + BytesWritten;
+        }
+    }
+
+    return TRUE;
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
@@ -140,6 +198,15 @@ TypeProcessStream(
         OutputIsConsole = TRUE;
     }
 
+    //
+    //  A console needs text to be converted for display, but anything else
+    //  can receive the contents as they are.
+    //
+
+    if (TypeContext->Buffer != NULL && !OutputIsConsole) {
+        return TypeCopyStreamBlocks(hSource, OutputHandle, TypeContext);
+    }
+
     while (TRUE) {
 
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
@@ -199,6 +266,7 @@ TypeFileFoundCallback(
     )
 {
     HANDLE FileHandle;
+    DWORD Flags;
     PTYPE_CONTEXT TypeContext = (PTYPE_CONTEXT)Context;
 
     UNREFERENCED_PARAMETER(Depth);
@@ -208,12 +276,17 @@ TypeFileFoundCallback(
     if (FileInfo == NULL ||
         (FileInfo->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
 
+        Flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS;
+        if (TypeContext->Buffer != NULL) {
+            Flags = Flags | FILE_FLAG_SEQUENTIAL_SCAN;
+        }
+
         FileHandle = CreateFile(FilePath->StartOfString,
                                 GENERIC_READ,
                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                                 NULL,
                                 OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                                Flags,
                                 NULL);
 
         if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
@@ -328,6 +401,7 @@ ENTRYPOINT(
     YORI_ALLOC_SIZE_T StartArg = 0;
     WORD MatchFlags;
     BOOLEAN BasicEnumeration = FALSE;
+    BOOLEAN CopyContents = FALSE;
     TYPE_CONTEXT TypeContext;
     YORI_STRING Arg;
 
@@ -348,6 +422,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("c")) == 0) {
+                CopyContents = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("h")) == 0) {
                 if (ArgC > i + 1) {
                     YORI_ALLOC_SIZE_T CharsConsumed;
@@ -414,6 +491,19 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  Copying contents in blocks is only possible if nothing needs to be
+    //  done with each line.  If the buffer can't be allocated, fall back to
+    //  processing lines.
+    //
+
+    if (CopyContents &&
+        !TypeContext.DisplayLineNumbers &&
+        TypeContext.HeadLines == 0) {
+
+        TypeContext.Buffer = YoriLibMalloc(TYPE_BLOCK_SIZE);
+    }
+
     //
     //  If no file name is specified, use stdin; otherwise open
     //  the file and use that
@@ -422,6 +512,9 @@ ENTRYPOINT(
     if (StartArg == 0 || StartArg == ArgC) {
         if (YoriLibIsStdInConsole()) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("No file or pipe for input\n"));
+            if (TypeContext.Buffer != NULL) {
+                YoriLibFree(TypeContext.Buffer);
+            }
             return EXIT_FAILURE;
         }
 
@@ -465,6 +558,10 @@ ENTRYPOINT(
     YoriLibLineReadCleanupCache();
 #endif
 
+    if (TypeContext.Buffer != NULL) {
+        YoriLibFree(TypeContext.Buffer);
+    }
+
     if (TypeContext.FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("type: no matching files found\n"));
         return EXIT_FAILURE;
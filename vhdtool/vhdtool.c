@@ -98,6 +98,454 @@ typedef enum _VHDTOOL_SECTOR_SIZE {
     VhdToolSector4kNative = 3
 } VHDTOOL_SECTOR_SIZE;
 
+/**
+ The size of each buffer used when cloning an ISO with overlapped I/O.
+ This is also the granularity at which regions of zeroes are skipped, so it
+ is smaller than a typical copy buffer to allow more of the target to
+ remain sparse.
+ */
+#define VHDTOOL_CLONE_BUFFER_SIZE (256 * 1024)
+
+/**
+ The number of buffers used when cloning an ISO with overlapped I/O.  Each
+ buffer can have a read or a write in flight at any time.
+ */
+#define VHDTOOL_CLONE_BUFFER_COUNT (8)
+
+/**
+ The alignment to use for unbuffered I/O when the device does not report a
+ sector size.  This is the page size, which is at least as large as the
+ sector size of any device expected to be encountered.
+ */
+#define VHDTOOL_CLONE_UNBUFFERED_ALIGNMENT (4096)
+
+/**
+ The state of a single buffer used when cloning with overlapped I/O.
+ */
+typedef enum _VHDTOOL_CLONE_STATE {
+    VhdToolCloneIdle = 0,
+    VhdToolCloneReading = 1,
+    VhdToolCloneWriting = 2
+} VHDTOOL_CLONE_STATE;
+
+/**
+ A single buffer used when cloning with overlapped I/O.  Each buffer is read
+ from the source and written to the same offset in the target.
+ */
+typedef struct _VHDTOOL_CLONE_SLOT {
+
+    /**
+     The overlapped structure for the I/O in progress on this buffer.
+     */
+    OVERLAPPED Overlapped;
+
+    /**
+     Pointer to the buffer.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The offset in the source and target that this buffer refers to.
+     */
+    DWORDLONG Offset;
+
+    /**
+     The number of bytes of the source that this buffer refers to.
+     */
+    DWORD Length;
+
+    /**
+     The I/O that is currently in progress on this buffer.
+     */
+    VHDTOOL_CLONE_STATE State;
+} VHDTOOL_CLONE_SLOT, *PVHDTOOL_CLONE_SLOT;
+
+/**
+ Returns TRUE if a buffer contains only zeroes.
+
+ @param Buffer Pointer to the buffer, which must be aligned to a DWORDLONG.
+
+ @param Length The length of the buffer, in bytes.
+
+ @return TRUE if every byte in the buffer is zero, FALSE if not.
+ */
+BOOLEAN
+VhdToolIsBufferZero(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    PDWORDLONG Words;
+    DWORD WordCount;
+    DWORD Index;
+
+    Words = (PDWORDLONG)Buffer;
+    WordCount = Length / sizeof(DWORDLONG);
+    for (Index = 0; Index < WordCount; Index++) {
+        if (Words[Index] != 0) {
+            return FALSE;
+        }
+    }
+
+    for (Index = WordCount * sizeof(DWORDLONG); Index < Length; Index++) {
+        if (Buffer[Index] != 0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Display an error encountered while cloning data.
+
+ @param Operation Pointer to a NULL terminated string describing the
+        operation that failed.
+
+ @param FileName Pointer to the file that the operation failed on.
+
+ @param LastError The Win32 error code.
+ */
+VOID
+VhdToolCloneDisplayError(
+    __in LPCTSTR Operation,
+    __in PYORI_STRING FileName,
+    __in DWORD LastError
+    )
+{
+    LPTSTR ErrText;
+
+    ErrText = YoriLibGetWinErrorText(LastError);
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%s failed: %y: %s"), Operation, FileName, ErrText);
+    YoriLibFreeWinErrorText(ErrText);
+}
+
+/**
+ Copy data from a source to a target file with several unbuffered,
+ overlapped reads and writes in flight at once, so reading from the source
+ and writing to the target proceed concurrently at device speed.  Buffers
+ that contain only zeroes are not written, so if the target is sparse these
+ regions do not consume space.  If the objects cannot be opened for
+ overlapped I/O, this function returns FALSE and the caller should copy
+ synchronously.
+
+ @param SourcePath Pointer to the fully qualified source file or device.
+
+ @param TargetPath Pointer to the fully qualified target file, which has
+        already been created.
+
+ @param BytesToCopy The number of bytes in the source.
+
+ @param SourceSectorSize The sector size of the source if it is a device, in
+        bytes, or zero if it is a file.
+
+ @param CopyResult On return from this function indicating the copy was
+        attempted, set to TRUE if the copy succeeded or FALSE if it failed.
+
+ @return TRUE to indicate the copy was attempted by this function, FALSE to
+         indicate the caller should perform the copy.
+ */
+BOOL
+VhdToolClonePipelined(
+    __in PYORI_STRING SourcePath,
+    __in PYORI_STRING TargetPath,
+    __in DWORDLONG BytesToCopy,
+    __in DWORD SourceSectorSize,
+    __out PBOOL CopyResult
+    )
+{
+    VHDTOOL_CLONE_SLOT Slots[VHDTOOL_CLONE_BUFFER_COUNT];
+    HANDLE WaitHandles[VHDTOOL_CLONE_BUFFER_COUNT];
+    DWORD WaitSlots[VHDTOOL_CLONE_BUFFER_COUNT];
+    PVHDTOOL_CLONE_SLOT Slot;
+    HANDLE SourceHandle;
+    HANDLE TargetHandle;
+    HANDLE IoHandle;
+    PUCHAR BufferBase;
+    DWORDLONG NextReadOffset;
+    LARGE_INTEGER NewEndOfFile;
+    DWORD Alignment;
+    DWORD ReadAlignment;
+    DWORD IoLength;
+    DWORD BytesTransferred;
+    DWORD ActiveCount;
+    DWORD FoundEvent;
+    DWORD LastError;
+    DWORD Index;
+    BOOL Attempted;
+    BOOL Success;
+
+    *CopyResult = FALSE;
+    Attempted = FALSE;
+    Success = TRUE;
+    SourceHandle = INVALID_HANDLE_VALUE;
+    TargetHandle = INVALID_HANDLE_VALUE;
+    BufferBase = NULL;
+    ZeroMemory(Slots, sizeof(Slots));
+
+    //
+    //  Writes must be a multiple of the sector size of the target, which is
+    //  a file whose sector size isn't known, so use the page size, which is
+    //  at least as large.  Reads from a device are rounded to its sector
+    //  size so they never extend beyond the end of the device, which fails
+    //  rather than returning a short read.
+    //
+
+    Alignment = VHDTOOL_CLONE_UNBUFFERED_ALIGNMENT;
+    if (SourceSectorSize > Alignment) {
+        Alignment = SourceSectorSize;
+    }
+
+    ReadAlignment = Alignment;
+    if (SourceSectorSize != 0) {
+        ReadAlignment = SourceSectorSize;
+    }
+
+    if ((VHDTOOL_CLONE_BUFFER_SIZE % Alignment) != 0) {
+        return FALSE;
+    }
+
+    SourceHandle = CreateFile(SourcePath->StartOfString,
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING,
+                              NULL);
+
+    if (SourceHandle == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    TargetHandle = CreateFile(TargetPath->StartOfString,
+                              GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING,
+                              NULL);
+
+    if (TargetHandle == INVALID_HANDLE_VALUE) {
+        goto Exit;
+    }
+
+    //
+    //  Allocate with VirtualAlloc so buffers are page aligned as required
+    //  by unbuffered I/O.
+    //
+
+    BufferBase = VirtualAlloc(NULL, VHDTOOL_CLONE_BUFFER_SIZE * VHDTOOL_CLONE_BUFFER_COUNT, MEM_COMMIT, PAGE_READWRITE);
+    if (BufferBase == NULL) {
+        goto Exit;
+    }
+
+    for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+        Slots[Index].Buffer = BufferBase + Index * VHDTOOL_CLONE_BUFFER_SIZE;
+        Slots[Index].Overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Slots[Index].Overlapped.hEvent == NULL) {
+            goto Exit;
+        }
+    }
+
+    Attempted = TRUE;
+    NextReadOffset = 0;
+
+    while (TRUE) {
+
+        //
+        //  Start reads into any idle buffers.
+        //
+
+        for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+            Slot = &Slots[Index];
+            if (Slot->State != VhdToolCloneIdle ||
+                !Success ||
+                NextReadOffset >= BytesToCopy) {
+
+                continue;
+            }
+
+            Slot->Offset = NextReadOffset;
+            Slot->Length = VHDTOOL_CLONE_BUFFER_SIZE;
+            if (BytesToCopy - NextReadOffset < VHDTOOL_CLONE_BUFFER_SIZE) {
+                Slot->Length = (DWORD)(BytesToCopy - NextReadOffset);
+            }
+
+            IoLength = Slot->Length;
+            if ((IoLength % ReadAlignment) != 0) {
+                IoLength = (IoLength / ReadAlignment + 1) * ReadAlignment;
+            }
+
+            Slot->Overlapped.Offset = (DWORD)Slot->Offset;
+            Slot->Overlapped.OffsetHigh = (DWORD)(Slot->Offset >> 32);
+            if (!ReadFile(SourceHandle, Slot->Buffer, IoLength, NULL, &Slot->Overlapped)) {
+                LastError = GetLastError();
+                if (LastError != ERROR_IO_PENDING) {
+                    VhdToolCloneDisplayError(_T("Read from source"), SourcePath, LastError);
+                    Success = FALSE;
+                    continue;
+                }
+            }
+
+            Slot->State = VhdToolCloneReading;
+            NextReadOffset = NextReadOffset + Slot->Length;
+        }
+
+        //
+        //  Wait for any I/O to complete.  If none are in flight, the copy
+        //  is finished.
+        //
+
+        ActiveCount = 0;
+        for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+            if (Slots[Index].State != VhdToolCloneIdle) {
+                WaitHandles[ActiveCount] = Slots[Index].Overlapped.hEvent;
+                WaitSlots[ActiveCount] = Index;
+                ActiveCount++;
+            }
+        }
+
+        if (ActiveCount == 0) {
+            break;
+        }
+
+        FoundEvent = WaitForMultipleObjects(ActiveCount, WaitHandles, FALSE, INFINITE);
+        if (FoundEvent >= WAIT_OBJECT_0 + ActiveCount) {
+
+            //
+            //  This is not expected.  Cancel any I/O and wait for it to
+            //  complete before the buffers are freed.
+            //
+
+            Success = FALSE;
+            CancelIo(SourceHandle);
+            CancelIo(TargetHandle);
+            for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+                Slot = &Slots[Index];
+                if (Slot->State == VhdToolCloneReading) {
+                    GetOverlappedResult(SourceHandle, &Slot->Overlapped, &BytesTransferred, TRUE);
+                } else if (Slot->State == VhdToolCloneWriting) {
+                    GetOverlappedResult(TargetHandle, &Slot->Overlapped, &BytesTransferred, TRUE);
+                }
+                Slot->State = VhdToolCloneIdle;
+            }
+            break;
+        }
+
+        Slot = &Slots[WaitSlots[FoundEvent - WAIT_OBJECT_0]];
+        if (Slot->State == VhdToolCloneReading) {
+            IoHandle = SourceHandle;
+        } else {
+            IoHandle = TargetHandle;
+        }
+
+        if (!GetOverlappedResult(IoHandle, &Slot->Overlapped, &BytesTransferred, FALSE)) {
+            LastError = GetLastError();
+            if (Slot->State == VhdToolCloneReading && LastError == ERROR_HANDLE_EOF) {
+                BytesTransferred = 0;
+            } else {
+                if (Slot->State == VhdToolCloneReading) {
+                    VhdToolCloneDisplayError(_T("Read from source"), SourcePath, LastError);
+                } else {
+                    VhdToolCloneDisplayError(_T("Write to target"), TargetPath, LastError);
+                }
+                Success = FALSE;
+                Slot->State = VhdToolCloneIdle;
+                continue;
+            }
+        }
+
+        if (Slot->State == VhdToolCloneWriting) {
+            Slot->State = VhdToolCloneIdle;
+            continue;
+        }
+
+        //
+        //  A read has completed.  If the source ended sooner than expected,
+        //  stop issuing reads beyond its end.  If there is data that isn't
+        //  all zero, write it to the target at the same offset.  Regions
+        //  that aren't written read as zero once the target is extended to
+        //  its final size, and remain unallocated if the target is sparse.
+        //
+
+        Slot->State = VhdToolCloneIdle;
+        if (BytesTransferred > Slot->Length) {
+            BytesTransferred = Slot->Length;
+        }
+
+        if (BytesTransferred < Slot->Length) {
+            if (Slot->Offset + BytesTransferred < BytesToCopy) {
+                BytesToCopy = Slot->Offset + BytesTransferred;
+            }
+        }
+
+        if (!Success ||
+            BytesTransferred == 0 ||
+            VhdToolIsBufferZero(Slot->Buffer, BytesTransferred)) {
+
+            continue;
+        }
+
+        IoLength = BytesTransferred;
+        if ((IoLength % Alignment) != 0) {
+            IoLength = (IoLength / Alignment + 1) * Alignment;
+            ZeroMemory(Slot->Buffer + BytesTransferred, IoLength - BytesTransferred);
+        }
+
+        if (!WriteFile(TargetHandle, Slot->Buffer, IoLength, NULL, &Slot->Overlapped)) {
+            LastError = GetLastError();
+            if (LastError != ERROR_IO_PENDING) {
+                VhdToolCloneDisplayError(_T("Write to target"), TargetPath, LastError);
+                Success = FALSE;
+                continue;
+            }
+        }
+
+        Slot->State = VhdToolCloneWriting;
+    }
+
+    //
+    //  Writes may have been extended to meet alignment requirements, and
+    //  the source may have been shorter than expected, so set the target
+    //  to the size of the data.
+    //
+
+    if (Success) {
+        NewEndOfFile.QuadPart = BytesToCopy;
+        SetFilePointer(TargetHandle, NewEndOfFile.LowPart, &NewEndOfFile.HighPart, FILE_BEGIN);
+        if (!SetEndOfFile(TargetHandle)) {
+            VhdToolCloneDisplayError(_T("Setting size of target"), TargetPath, GetLastError());
+            Success = FALSE;
+        }
+    }
+
+Exit:
+
+    for (Index = 0; Index < VHDTOOL_CLONE_BUFFER_COUNT; Index++) {
+        if (Slots[Index].Overlapped.hEvent != NULL) {
+            CloseHandle(Slots[Index].Overlapped.hEvent);
+        }
+    }
+
+    if (BufferBase != NULL) {
+        VirtualFree(BufferBase, 0, MEM_RELEASE);
+    }
+
+    if (TargetHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(TargetHandle);
+    }
+
+    if (SourceHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(SourceHandle);
+    }
+
+    if (Attempted) {
+        *CopyResult = Success;
+    }
+
+    return Attempted;
+}
+
 /**
  Clone a fixed ISO file.
 
@@ -125,8 +573,11 @@ VhdToolCloneIso(
     DWORD FreeClusters;
     DWORD TotalClusters;
     DISK_GEOMETRY DiskGeometry;
+    DWORDLONG SourceSize;
+    DWORD DeviceSectorSize;
     LPTSTR ErrText;
     DWORD Err;
+    BOOL Result;
 
     YoriLibInitEmptyString(&FullPath);
     YoriLibInitEmptyString(&FullSourcePath);
@@ -155,8 +606,13 @@ VhdToolCloneIso(
         return FALSE;
     }
 
-    TargetHandle = CreateFile(FullPath.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (SourceHandle == INVALID_HANDLE_VALUE) {
+    //
+    //  The target allows write sharing so it can be opened again for
+    //  overlapped I/O below.
+    //
+
+    TargetHandle = CreateFile(FullPath.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (TargetHandle == INVALID_HANDLE_VALUE) {
         Err = GetLastError();
         ErrText = YoriLibGetWinErrorText(Err);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Open of target failed: %y: %s"), &FullPath, ErrText);
@@ -179,6 +635,31 @@ VhdToolCloneIso(
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("BytesPerSector could not be detected, using default %i\n"), BytesPerSector);
     }
 
+    //
+    //  Images commonly contain large regions of zeroes.  Mark the target
+    //  sparse so these don't need to be allocated.  This is best effort,
+    //  since the target may be on a file system without sparse support.
+    //
+
+    DeviceIoControl(TargetHandle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &BytesRead, NULL);
+
+    //
+    //  If the size of the source is known, try to copy with unbuffered,
+    //  overlapped I/O so the source and target are busy concurrently.  If
+    //  that can't be done, fall back to a synchronous copy below.
+    //
+
+    if (YoriLibGetFileOrDeviceSize(SourceHandle, &SourceSize) == ERROR_SUCCESS) {
+        DeviceSectorSize = YoriLibGetHandleSectorSize(SourceHandle);
+        if (VhdToolClonePipelined(&FullSourcePath, &FullPath, SourceSize, DeviceSectorSize, &Result)) {
+            YoriLibFreeStringContents(&FullPath);
+            YoriLibFreeStringContents(&FullSourcePath);
+            CloseHandle(SourceHandle);
+            CloseHandle(TargetHandle);
+            return Result;
+        }
+    }
+
     BufferSize = YoriLibMaximumAllocationInRange(32 * 1024, 1024 * 1024);
     Buffer = YoriLibMalloc(BufferSize);
     if (Buffer == NULL) {
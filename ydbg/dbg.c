@@ -41,6 +41,7 @@ CHAR strYDbgHelpText[] =
         "YDBG -license\n"
         "YDBG -k <file>\n"
         "YDBG -ks <pid> <file>\n"
+        "YDBG -m <directory> <pid> [<pid>...]\n"
         "\n"
         "   -c             Dump memory from kernel and user processes to a file\n"
         "   -d             Dump memory from a process to a file\n"
@@ -48,6 +49,8 @@ CHAR strYDbgHelpText[] =
         "   -k             Dump memory from kernel to a file\n"
         "   -ks            Dump memory from kernel stacks associated with a process to a file\n"
         "   -l             Enable loader snaps for a child process\n"
+        "   -m             Dump memory from multiple processes at the same moment to a\n"
+        "                    directory\n"
         "   -w             Create child process in a new window\n";
 
 /**
@@ -64,6 +67,94 @@ YDbgHelp(VOID)
     return TRUE;
 }
 
+/**
+ A callback invoked by MiniDumpWriteDump.  This is used to indicate that the
+ handle passed to MiniDumpWriteDump refers to a process snapshot.
+
+ @param CallbackParam The context supplied with the callback, unused.
+
+ @param CallbackInput Pointer to information about the callback.
+
+ @param CallbackOutput Pointer to information to return from the callback.
+
+ @return TRUE to indicate the callback was processed.
+ */
+BOOL CALLBACK
+YDbgSnapshotDumpCallback(
+    __in PVOID CallbackParam,
+    __in PYORI_MINIDUMP_CALLBACK_INPUT CallbackInput,
+    __inout PYORI_MINIDUMP_CALLBACK_OUTPUT CallbackOutput
+    )
+{
+    UNREFERENCED_PARAMETER(CallbackParam);
+
+    if (CallbackInput->CallbackType == YORI_MINIDUMP_IS_PROCESS_SNAPSHOT_CALLBACK) {
+        CallbackOutput->Status = S_FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write the memory from a process or process snapshot to a dump file.  Note
+ this function will display errors so the caller doesn't have to.
+
+ @param ProcessHandle Specifies a handle to the process or process snapshot
+        whose memory should be written.
+
+ @param ProcessPid Specifies the process ID of the process.
+
+ @param FullPath Specifies the fully qualified file name to write the memory
+        to.
+
+ @param IsSnapshot If TRUE, ProcessHandle refers to a process snapshot
+        captured with PssCaptureSnapshot.  If FALSE, it refers to a process.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YDbgWriteDumpFile(
+    __in HANDLE ProcessHandle,
+    __in DWORD ProcessPid,
+    __in PYORI_STRING FullPath,
+    __in BOOLEAN IsSnapshot
+    )
+{
+    HANDLE FileHandle;
+    DWORD LastError;
+    LPTSTR ErrText;
+    YORI_MINIDUMP_CALLBACK_INFORMATION CallbackInfo;
+    PYORI_MINIDUMP_CALLBACK_INFORMATION CallbackParam;
+
+    FileHandle = CreateFile(FullPath->StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: CreateFile of %y failed: %s"), FullPath, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        return FALSE;
+    }
+
+    CallbackParam = NULL;
+    if (IsSnapshot) {
+        CallbackInfo.CallbackRoutine = YDbgSnapshotDumpCallback;
+        CallbackInfo.CallbackParam = NULL;
+        CallbackParam = &CallbackInfo;
+    }
+
+    if (!DllDbgHelp.pMiniDumpWriteDump(ProcessHandle, ProcessPid, FileHandle, 2, NULL, NULL, CallbackParam)) {
+        LastError = GetLastError();
+        ErrText = YoriLibGetWinErrorText(LastError);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: MiniDumpWriteDump of %i failed: %s"), ProcessPid, ErrText);
+        YoriLibFreeWinErrorText(ErrText);
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
+
+    CloseHandle(FileHandle);
+    return TRUE;
+}
+
 /**
  Write the memory from a process to a dump file.
 
@@ -80,10 +171,10 @@ YDbgDumpProcess(
     )
 {
     HANDLE ProcessHandle;
-    HANDLE FileHandle;
     DWORD LastError;
     LPTSTR ErrText;
     YORI_STRING FullPath;
+    BOOL Result;
 
     YoriLibLoadDbgHelpFunctions();
     if (DllDbgHelp.pMiniDumpWriteDump == NULL) {
@@ -111,32 +202,262 @@ YDbgDumpProcess(
         return FALSE;
     }
 
-    FileHandle = CreateFile(FullPath.StartOfString, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (FileHandle == INVALID_HANDLE_VALUE) {
-        LastError = GetLastError();
-        ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: CreateFile of %y failed: %s"), &FullPath, ErrText);
-        YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FullPath);
-        CloseHandle(ProcessHandle);
+    Result = YDbgWriteDumpFile(ProcessHandle, ProcessPid, &FullPath, FALSE);
+
+    YoriLibFreeStringContents(&FullPath);
+    CloseHandle(ProcessHandle);
+    return Result;
+}
+
+/**
+ The information to capture when snapshotting a process.  This is the set
+ needed for MiniDumpWriteDump to write a dump from the snapshot.
+ */
+#define YDBG_SNAPSHOT_CAPTURE_FLAGS (PSS_CAPTURE_VA_CLONE | \
+                                     PSS_CAPTURE_HANDLES | \
+                                     PSS_CAPTURE_HANDLE_NAME_INFORMATION | \
+                                     PSS_CAPTURE_HANDLE_BASIC_INFORMATION | \
+                                     PSS_CAPTURE_HANDLE_TYPE_SPECIFIC_INFORMATION | \
+                                     PSS_CAPTURE_HANDLE_TRACE | \
+                                     PSS_CAPTURE_THREADS | \
+                                     PSS_CAPTURE_THREAD_CONTEXT | \
+                                     PSS_CAPTURE_THREAD_CONTEXT_EXTENDED | \
+                                     PSS_CREATE_BREAKAWAY_OPTIONAL | \
+                                     PSS_CREATE_USE_VM_ALLOCATIONS | \
+                                     PSS_CREATE_RELEASE_SECTION)
+
+/**
+ State for a single process being dumped as part of a multiple process
+ dump.
+ */
+typedef struct _YDBG_SNAPSHOT_PROCESS {
+
+    /**
+     The process ID of the process.
+     */
+    DWORD ProcessPid;
+
+    /**
+     The result of capturing the snapshot, as a Win32 error code.
+     */
+    DWORD Error;
+
+    /**
+     A handle to the process, or NULL if it could not be opened.
+     */
+    HANDLE ProcessHandle;
+
+    /**
+     A handle to the snapshot of the process, or NULL if no snapshot has
+     been captured.
+     */
+    HANDLE SnapshotHandle;
+
+    /**
+     A handle to the thread capturing the snapshot, or NULL if no thread
+     was created.
+     */
+    HANDLE ThreadHandle;
+
+    /**
+     A manual reset event shared by all processes which is signalled to
+     indicate that snapshots should be captured.
+     */
+    HANDLE StartEvent;
+
+} YDBG_SNAPSHOT_PROCESS, *PYDBG_SNAPSHOT_PROCESS;
+
+/**
+ A thread which waits for the start event and captures a snapshot of a
+ single process.  One of these is created for each process so that all
+ snapshots are taken at as close to the same moment as possible.
+
+ @param Context Pointer to the YDBG_SNAPSHOT_PROCESS describing the process.
+
+ @return Thread exit code, which is not used.
+ */
+DWORD WINAPI
+YDbgCaptureSnapshotThread(
+    __in PVOID Context
+    )
+{
+    PYDBG_SNAPSHOT_PROCESS Process;
+
+    Process = (PYDBG_SNAPSHOT_PROCESS)Context;
+    WaitForSingleObject(Process->StartEvent, INFINITE);
+    Process->Error = DllKernel32.pPssCaptureSnapshot(Process->ProcessHandle, YDBG_SNAPSHOT_CAPTURE_FLAGS, CONTEXT_ALL, &Process->SnapshotHandle);
+    return 0;
+}
+
+/**
+ Write the memory from a set of processes to dump files in a directory.
+ Where the system supports process snapshots, every process is snapshotted
+ concurrently first, so the dumps reflect the same moment and each process
+ is only suspended while its snapshot is captured.  The dumps are then
+ written from the snapshots.  On older systems each process is dumped
+ directly in turn.
+
+ @param DirectoryName Specifies the directory to write dump files to.  Each
+        file is named after the process ID.
+
+ @param PidStrings Pointer to an array of strings containing process IDs.
+
+ @param PidCount The number of elements in PidStrings.
+
+ @return TRUE to indicate all processes were dumped, FALSE to indicate
+         failure.
+ */
+BOOL
+YDbgDumpMultipleProcesses(
+    __in PYORI_STRING DirectoryName,
+    __in PYORI_STRING PidStrings,
+    __in YORI_ALLOC_SIZE_T PidCount
+    )
+{
+    PYDBG_SNAPSHOT_PROCESS Processes;
+    YORI_MAX_SIGNED_T llTemp;
+    YORI_ALLOC_SIZE_T CharsConsumed;
+    YORI_ALLOC_SIZE_T Index;
+    YORI_STRING FullDirectory;
+    YORI_STRING FullPath;
+    HANDLE StartEvent;
+    DWORD ThreadId;
+    DWORD LastError;
+    LPTSTR ErrText;
+    BOOL Result;
+
+    YoriLibLoadDbgHelpFunctions();
+    if (DllDbgHelp.pMiniDumpWriteDump == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: OS support not present\n"));
+        return FALSE;
+    }
+
+    if (!YoriLibIsSizeAllocatable(PidCount * sizeof(YDBG_SNAPSHOT_PROCESS))) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: too many processes\n"));
+        return FALSE;
+    }
+
+    Processes = YoriLibMalloc((YORI_ALLOC_SIZE_T)(PidCount * sizeof(YDBG_SNAPSHOT_PROCESS)));
+    if (Processes == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: out of memory\n"));
         return FALSE;
     }
+    ZeroMemory(Processes, PidCount * sizeof(YDBG_SNAPSHOT_PROCESS));
 
-    if (!DllDbgHelp.pMiniDumpWriteDump(ProcessHandle, ProcessPid, FileHandle, 2, NULL, NULL, NULL)) {
+    for (Index = 0; Index < PidCount; Index++) {
+        if (!YoriLibStringToNumber(&PidStrings[Index], TRUE, &llTemp, &CharsConsumed)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not a valid pid.\n"), &PidStrings[Index]);
+            YoriLibFree(Processes);
+            return FALSE;
+        }
+        Processes[Index].ProcessPid = (DWORD)llTemp;
+    }
+
+    YoriLibInitEmptyString(&FullDirectory);
+    if (!YoriLibUserStringToSingleFilePath(DirectoryName, TRUE, &FullDirectory)) {
         LastError = GetLastError();
         ErrText = YoriLibGetWinErrorText(LastError);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: MiniDumpWriteDump failed: %s"), ErrText);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: getfullpathname of %y failed: %s"), DirectoryName, ErrText);
         YoriLibFreeWinErrorText(ErrText);
-        YoriLibFreeStringContents(&FullPath);
-        CloseHandle(ProcessHandle);
-        CloseHandle(FileHandle);
+        YoriLibFree(Processes);
         return FALSE;
     }
 
+    if (!YoriLibAllocateString(&FullPath, FullDirectory.LengthInChars + 1 + 10 + sizeof(".dmp"))) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: out of memory\n"));
+        YoriLibFreeStringContents(&FullDirectory);
+        YoriLibFree(Processes);
+        return FALSE;
+    }
+
+    Result = TRUE;
+    for (Index = 0; Index < PidCount; Index++) {
+        Processes[Index].ProcessHandle = OpenProcess(PROCESS_ALL_ACCESS, FALSE, Processes[Index].ProcessPid);
+        if (Processes[Index].ProcessHandle == NULL) {
+            LastError = GetLastError();
+            ErrText = YoriLibGetWinErrorText(LastError);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: OpenProcess of %i failed: %s"), Processes[Index].ProcessPid, ErrText);
+            YoriLibFreeWinErrorText(ErrText);
+            Result = FALSE;
+        }
+    }
+
+    //
+    //  Create a thread per process, each waiting on a common event, so
+    //  that once everything is ready the snapshots are captured together.
+    //  If a thread cannot be created, that snapshot is captured here once
+    //  the others have been released.
+    //
+
+    StartEvent = NULL;
+    if (DllKernel32.pPssCaptureSnapshot != NULL &&
+        DllKernel32.pPssFreeSnapshot != NULL) {
+
+        StartEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    }
+
+    if (StartEvent != NULL) {
+        for (Index = 0; Index < PidCount; Index++) {
+            if (Processes[Index].ProcessHandle != NULL) {
+                Processes[Index].StartEvent = StartEvent;
+                Processes[Index].ThreadHandle = CreateThread(NULL, 0, YDbgCaptureSnapshotThread, &Processes[Index], 0, &ThreadId);
+            }
+        }
+
+        SetEvent(StartEvent);
+
+        for (Index = 0; Index < PidCount; Index++) {
+            if (Processes[Index].ThreadHandle != NULL) {
+                WaitForSingleObject(Processes[Index].ThreadHandle, INFINITE);
+                CloseHandle(Processes[Index].ThreadHandle);
+                Processes[Index].ThreadHandle = NULL;
+            } else if (Processes[Index].ProcessHandle != NULL) {
+                YDbgCaptureSnapshotThread(&Processes[Index]);
+            }
+
+            if (Processes[Index].ProcessHandle != NULL &&
+                Processes[Index].Error != ERROR_SUCCESS) {
+
+                ErrText = YoriLibGetWinErrorText(Processes[Index].Error);
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ydbg: PssCaptureSnapshot of %i failed, dumping process directly: %s"), Processes[Index].ProcessPid, ErrText);
+                YoriLibFreeWinErrorText(ErrText);
+                Processes[Index].SnapshotHandle = NULL;
+            }
+        }
+
+        CloseHandle(StartEvent);
+    }
+
+    //
+    //  DbgHelp is single threaded, so the dumps are written one at a time.
+    //  The processes are not suspended while this occurs.
+    //
+
+    for (Index = 0; Index < PidCount; Index++) {
+        if (Processes[Index].ProcessHandle == NULL) {
+            continue;
+        }
+
+        YoriLibYPrintf(&FullPath, _T("%y\\%i.dmp"), &FullDirectory, Processes[Index].ProcessPid);
+
+        if (Processes[Index].SnapshotHandle != NULL) {
+            if (!YDbgWriteDumpFile(Processes[Index].SnapshotHandle, Processes[Index].ProcessPid, &FullPath, TRUE)) {
+                Result = FALSE;
+            }
+            DllKernel32.pPssFreeSnapshot(GetCurrentProcess(), Processes[Index].SnapshotHandle);
+        } else {
+            if (!YDbgWriteDumpFile(Processes[Index].ProcessHandle, Processes[Index].ProcessPid, &FullPath, FALSE)) {
+                Result = FALSE;
+            }
+        }
+
+        CloseHandle(Processes[Index].ProcessHandle);
+    }
+
     YoriLibFreeStringContents(&FullPath);
-    CloseHandle(ProcessHandle);
-    CloseHandle(FileHandle);
-    return TRUE;
+    YoriLibFreeStringContents(&FullDirectory);
+    YoriLibFree(Processes);
+    return Result;
 }
 
 /**
@@ -1137,6 +1458,7 @@ typedef enum _YDBG_OP {
     YDbgOperationCompleteDump = 3,
     YDbgOperationProcessKernelStacks = 4,
     YDbgOperationDebugChildProcess = 5,
+    YDbgOperationMultipleProcessDump = 6,
 } YDBG_OP;
 
 #ifdef YORI_BUILTIN
@@ -1242,6 +1564,14 @@ ENTRYPOINT(
                     ArgumentUnderstood = TRUE;
                     i += 2;
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("m")) == 0) {
+                if (ArgC > i + 2) {
+                    Op = YDbgOperationMultipleProcessDump;
+                    FileName = &ArgV[i + 1];
+                    StartArg = i + 2;
+                    ArgumentUnderstood = TRUE;
+                    break;
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 EnableLoaderSnaps = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -1284,6 +1614,10 @@ ENTRYPOINT(
         if (!YDbgDumpKernel(FileName, TRUE)) {
             ExitResult = EXIT_FAILURE;
         }
+    } else if (Op == YDbgOperationMultipleProcessDump) {
+        if (!YDbgDumpMultipleProcesses(FileName, &ArgV[StartArg], ArgC - StartArg)) {
+            ExitResult = EXIT_FAILURE;
+        }
     } else if (Op == YDbgOperationDebugChildProcess) {
         ExitResult = YDbgDebugChildProcess(EnableLoaderSnaps, CreateNewWindow, ArgC - StartArg, &ArgV[StartArg]);
     }
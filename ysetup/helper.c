@@ -394,6 +394,81 @@ ReturnDefault:
 #pragma warning(pop)
 #endif
 
+/**
+ State used to report progress while a set of packages is installed.
+ */
+typedef struct _SETUP_INSTALL_PROGRESS_CONTEXT {
+
+    /**
+     The function to invoke to display status.
+     */
+    PYSETUP_STATUS_CALLBACK StatusCallback;
+
+    /**
+     The opaque context to pass to StatusCallback.
+     */
+    PVOID StatusContext;
+
+    /**
+     The standard output handle to restore while status is displayed.
+     */
+    HANDLE OriginalStdOut;
+
+    /**
+     The standard error handle to restore while status is displayed.
+     */
+    HANDLE OriginalStdErr;
+
+    /**
+     A handle to the NUL device which standard output and standard error
+     are directed to while packages are installed, or INVALID_HANDLE_VALUE
+     if output is not redirected.
+     */
+    HANDLE NulDevice;
+} SETUP_INSTALL_PROGRESS_CONTEXT, *PSETUP_INSTALL_PROGRESS_CONTEXT;
+
+/**
+ Display status before a package is installed.
+
+ @param PackageIndex The zero based index of the package about to be
+        installed.
+
+ @param PackageCount The total number of packages being installed.
+
+ @param PackagePath Pointer to the path of the package about to be installed.
+
+ @param Context Pointer to the SETUP_INSTALL_PROGRESS_CONTEXT.
+ */
+VOID
+SetupInstallProgress(
+    __in YORI_ALLOC_SIZE_T PackageIndex,
+    __in YORI_ALLOC_SIZE_T PackageCount,
+    __in PCYORI_STRING PackagePath,
+    __in_opt PVOID Context
+    )
+{
+    PSETUP_INSTALL_PROGRESS_CONTEXT ProgressContext;
+    YORI_STRING StatusText;
+
+    ProgressContext = (PSETUP_INSTALL_PROGRESS_CONTEXT)Context;
+    if (ProgressContext == NULL) {
+        return;
+    }
+
+    YoriLibInitEmptyString(&StatusText);
+    YoriLibYPrintf(&StatusText, _T("Installing %i of %i: %y"), PackageIndex + 1, PackageCount, PackagePath);
+    if (StatusText.StartOfString != NULL) {
+        SetStdHandle(STD_OUTPUT_HANDLE, ProgressContext->OriginalStdOut);
+        SetStdHandle(STD_ERROR_HANDLE, ProgressContext->OriginalStdErr);
+        ProgressContext->StatusCallback(&StatusText, ProgressContext->StatusContext);
+        if (ProgressContext->NulDevice != INVALID_HANDLE_VALUE) {
+            SetStdHandle(STD_OUTPUT_HANDLE, ProgressContext->NulDevice);
+            SetStdHandle(STD_ERROR_HANDLE, ProgressContext->NulDevice);
+        }
+        YoriLibFreeStringContents(&StatusText);
+    }
+}
+
 /**
  Install the user specified set of packages and options.
 
@@ -437,6 +512,8 @@ SetupInstallSelectedWithOptions(
     YORI_ALLOC_SIZE_T PkgCount;
     YORI_ALLOC_SIZE_T PkgIndex;
     YORI_ALLOC_SIZE_T PkgUrlCount;
+    YORI_ALLOC_SIZE_T PkgInstalledCount;
+    SETUP_INSTALL_PROGRESS_CONTEXT ProgressContext;
     BOOL Result = FALSE;
     HANDLE OriginalStdOut;
     HANDLE OriginalStdErr;
@@ -603,24 +680,23 @@ SetupInstallSelectedWithOptions(
     }
 
     //
-    //  Install the packages
+    //  Install the packages.  Later packages are downloaded while earlier
+    //  ones are being installed.
     //
 
-    for (PkgCount = 0; PkgCount < PkgUrlCount; PkgCount++) {
-        YoriLibYPrintf(&StatusText, _T("Installing %i of %i: %y"), PkgCount + 1, PkgUrlCount, &PackageUrls[PkgCount]);
-        if (StatusText.StartOfString != NULL) {
-            SetStdHandle(STD_OUTPUT_HANDLE, OriginalStdOut);
-            SetStdHandle(STD_ERROR_HANDLE, OriginalStdErr);
-            StatusCallback(&StatusText, StatusContext);
-            if (NulDevice != INVALID_HANDLE_VALUE) {
-                SetStdHandle(STD_OUTPUT_HANDLE, NulDevice);
-                SetStdHandle(STD_ERROR_HANDLE, NulDevice);
-            }
-        }
-        if (!YoriPkgInstallSinglePackage(&PackageUrls[PkgCount], InstallDir)) {
-            YoriLibYPrintf(ErrorText, _T("Failed to install %y from %y"), &PkgNames[PkgCount], &PackageUrls[PkgCount]);
-            goto Exit;
+    ProgressContext.StatusCallback = StatusCallback;
+    ProgressContext.StatusContext = StatusContext;
+    ProgressContext.OriginalStdOut = OriginalStdOut;
+    ProgressContext.OriginalStdErr = OriginalStdErr;
+    ProgressContext.NulDevice = NulDevice;
+
+    if (!YoriPkgInstallPackageSet(PackageUrls, PkgUrlCount, InstallDir, SetupInstallProgress, &ProgressContext, &PkgInstalledCount)) {
+        if (PkgInstalledCount < PkgUrlCount) {
+            YoriLibYPrintf(ErrorText, _T("Failed to install %y from %y"), &PkgNames[PkgInstalledCount], &PackageUrls[PkgInstalledCount]);
+        } else {
+            YoriLibConstantString(ErrorText, _T("Installation failed."));
         }
+        goto Exit;
     }
 
     YoriLibFreeStringContents(&StatusText);
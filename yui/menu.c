@@ -118,6 +118,13 @@ typedef struct _YUI_MENU_FILE {
      */
     YORI_STRING FilePath;
 
+    /**
+     The entry for this file within the index of programs by name.  The key
+     is the display name of the item.  The context is NULL if the file is
+     not in the index.
+     */
+    YORI_HASH_ENTRY NameHashEntry;
+
     /**
      The depth of this entry.  All objects underneath the root start at 1.
      */
@@ -129,6 +136,68 @@ typedef struct _YUI_MENU_FILE {
     DWORD MenuId;
 } YUI_MENU_FILE, *PYUI_MENU_FILE;
 
+/**
+ The number of buckets in the hash table of previously parsed shortcuts.
+ */
+#define YUI_MENU_SHORTCUT_CACHE_BUCKETS (251)
+
+/**
+ The number of buckets in the hash table of programs indexed by name.
+ */
+#define YUI_MENU_PROGRAM_NAME_BUCKETS (251)
+
+/**
+ Information parsed from a shortcut file which is retained across start
+ menu reloads, so that shortcuts which have not changed do not need to be
+ parsed again.
+ */
+typedef struct _YUI_MENU_SHORTCUT_CACHE_ENTRY {
+
+    /**
+     The entry for this shortcut within the hash table of parsed shortcuts.
+     The key is FilePath.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The fully qualified path to the shortcut.  This is allocated as part
+     of this structure.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The entry for this shortcut within the list of all parsed shortcuts.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The last write time of the shortcut when it was parsed.
+     */
+    FILETIME LastWriteTime;
+
+    /**
+     The size of the shortcut when it was parsed.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The path to the icon for the shortcut.  This is empty if the shortcut
+     did not specify an icon.
+     */
+    YORI_STRING IconPath;
+
+    /**
+     The index of the icon within IconPath.
+     */
+    DWORD IconIndex;
+
+    /**
+     The value of @ref YUI_MENU_CONTEXT::ShortcutCacheGeneration when this
+     shortcut was last found in the start menu.
+     */
+    DWORD Generation;
+} YUI_MENU_SHORTCUT_CACHE_ENTRY, *PYUI_MENU_SHORTCUT_CACHE_ENTRY;
+
 
 /**
  A context structure for the menu module.
@@ -318,6 +387,38 @@ typedef struct _YUI_MENU_CONTEXT {
      */
     YUI_MENU_OWNERDRAW_ITEM WinContextLaunchNew;
 
+    /**
+     A hash table of previously parsed shortcuts, keyed by path.  This is
+     allocated when the start menu is first populated.
+     */
+    PYORI_HASH_TABLE ShortcutCache;
+
+    /**
+     A list of previously parsed shortcuts.  This is paired with
+     @ref YUI_MENU_SHORTCUT_CACHE_ENTRY::ListEntry .
+     */
+    YORI_LIST_ENTRY ShortcutCacheList;
+
+    /**
+     Incremented each time the start menu is populated.  Cached shortcuts
+     which were not found in the most recent population are discarded.
+     */
+    DWORD ShortcutCacheGeneration;
+
+    /**
+     COM objects used to read shortcuts that cannot be parsed directly.
+     These are retained while the start menu is being populated so they are
+     created at most once per population, and released before population
+     completes since they can only be used on the populating thread.
+     */
+    YORI_LIB_SHORTCUT_SESSION ShortcutSession;
+
+    /**
+     A hash table of programs in the start menu, keyed by display name.  This
+     allows programs to be found by name without walking the menu tree.
+     */
+    PYORI_HASH_TABLE ProgramNames;
+
 } YUI_MENU_CONTEXT, *PYUI_MENU_CONTEXT;
 
 /**
@@ -358,12 +459,178 @@ YuiMenuCleanupItem(
     YoriLibFreeStringContents(&Item->Text);
 }
 
+/**
+ Remove a shortcut from the cache of previously parsed shortcuts and free
+ it.
+
+ @param CacheEntry Pointer to the cached shortcut to remove.
+ */
+VOID
+YuiMenuDeleteShortcutCacheEntry(
+    __in PYUI_MENU_SHORTCUT_CACHE_ENTRY CacheEntry
+    )
+{
+    YoriLibHashRemoveByEntry(&CacheEntry->HashEntry);
+    YoriLibRemoveListItem(&CacheEntry->ListEntry);
+    YoriLibFreeStringContents(&CacheEntry->FilePath);
+    YoriLibFreeStringContents(&CacheEntry->IconPath);
+    YoriLibDereference(CacheEntry);
+}
+
+/**
+ Remove shortcuts from the cache of previously parsed shortcuts.
+
+ @param RemoveAll If TRUE, all shortcuts are removed.  If FALSE, only
+        shortcuts which were not found in the most recent population of the
+        start menu are removed.
+ */
+VOID
+YuiMenuPruneShortcutCache(
+    __in BOOLEAN RemoveAll
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYUI_MENU_SHORTCUT_CACHE_ENTRY CacheEntry;
+
+    if (YuiMenuContext.ShortcutCache == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YuiMenuContext.ShortcutCacheList, NULL);
+    while (ListEntry != NULL) {
+        CacheEntry = CONTAINING_RECORD(ListEntry, YUI_MENU_SHORTCUT_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YuiMenuContext.ShortcutCacheList, ListEntry);
+        if (RemoveAll || CacheEntry->Generation != YuiMenuContext.ShortcutCacheGeneration) {
+            YuiMenuDeleteShortcutCacheEntry(CacheEntry);
+        }
+    }
+
+    if (RemoveAll) {
+        YoriLibFreeEmptyHashTable(YuiMenuContext.ShortcutCache);
+        YuiMenuContext.ShortcutCache = NULL;
+    }
+}
+
+/**
+ Return the icon specified by a shortcut.  If the shortcut has been parsed
+ previously and has not changed since, the previous result is returned
+ without parsing it again.
+
+ @param FilePath Pointer to the fully qualified path to the shortcut.
+
+ @param FileInfo Pointer to information about the shortcut from the
+        directory enumeration.
+
+ @param IconPath On successful completion, populated with the path to the
+        icon.  The caller should free this with
+        @ref YoriLibFreeStringContents .
+
+ @param IconIndex On successful completion, populated with the index of the
+        icon within IconPath.
+
+ @return TRUE to indicate the shortcut specifies an icon, FALSE if it does
+         not or it could not be parsed.
+ */
+__success(return)
+BOOLEAN
+YuiMenuGetShortcutIconPath(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __out PYORI_STRING IconPath,
+    __out PDWORD IconIndex
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PYUI_MENU_SHORTCUT_CACHE_ENTRY CacheEntry;
+
+    CacheEntry = NULL;
+    if (YuiMenuContext.ShortcutCache != NULL) {
+        HashEntry = YoriLibHashLookupByKey(YuiMenuContext.ShortcutCache, FilePath);
+        if (HashEntry != NULL) {
+            CacheEntry = HashEntry->Context;
+            if (CacheEntry->LastWriteTime.dwLowDateTime != FileInfo->ftLastWriteTime.dwLowDateTime ||
+                CacheEntry->LastWriteTime.dwHighDateTime != FileInfo->ftLastWriteTime.dwHighDateTime ||
+                CacheEntry->FileSize.LowPart != FileInfo->nFileSizeLow ||
+                (DWORD)CacheEntry->FileSize.HighPart != FileInfo->nFileSizeHigh) {
+
+                YuiMenuDeleteShortcutCacheEntry(CacheEntry);
+                CacheEntry = NULL;
+            }
+        }
+    }
+
+    if (CacheEntry == NULL) {
+        YORI_STRING FoundIconPath;
+        DWORD FoundIconIndex;
+
+        YoriLibInitEmptyString(&FoundIconPath);
+        FoundIconIndex = 0;
+        if (!YoriLibLoadShortcutIconPath(FilePath, &YuiMenuContext.ShortcutSession, &FoundIconPath, &FoundIconIndex)) {
+            YoriLibInitEmptyString(&FoundIconPath);
+        }
+
+        if (YuiMenuContext.ShortcutCache != NULL) {
+            CacheEntry = YoriLibReferencedMalloc(sizeof(YUI_MENU_SHORTCUT_CACHE_ENTRY) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+            if (CacheEntry != NULL) {
+                ZeroMemory(CacheEntry, sizeof(YUI_MENU_SHORTCUT_CACHE_ENTRY));
+                CacheEntry->FilePath.StartOfString = (LPTSTR)(CacheEntry + 1);
+                CacheEntry->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+                CacheEntry->FilePath.LengthInChars = FilePath->LengthInChars;
+                CacheEntry->FilePath.MemoryToFree = CacheEntry;
+                YoriLibReference(CacheEntry);
+                memcpy(CacheEntry->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+                CacheEntry->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+            }
+        }
+
+        //
+        //  If the result can't be cached, return it directly.
+        //
+
+        if (CacheEntry == NULL) {
+            if (FoundIconPath.LengthInChars == 0) {
+                return FALSE;
+            }
+            memcpy(IconPath, &FoundIconPath, sizeof(YORI_STRING));
+            *IconIndex = FoundIconIndex;
+            return TRUE;
+        }
+
+        CacheEntry->LastWriteTime.dwLowDateTime = FileInfo->ftLastWriteTime.dwLowDateTime;
+        CacheEntry->LastWriteTime.dwHighDateTime = FileInfo->ftLastWriteTime.dwHighDateTime;
+        CacheEntry->FileSize.LowPart = FileInfo->nFileSizeLow;
+        CacheEntry->FileSize.HighPart = (LONG)FileInfo->nFileSizeHigh;
+        memcpy(&CacheEntry->IconPath, &FoundIconPath, sizeof(YORI_STRING));
+        CacheEntry->IconIndex = FoundIconIndex;
+
+        YoriLibHashInsertByKey(YuiMenuContext.ShortcutCache, &CacheEntry->FilePath, CacheEntry, &CacheEntry->HashEntry);
+        YoriLibAppendList(&YuiMenuContext.ShortcutCacheList, &CacheEntry->ListEntry);
+    }
+
+    CacheEntry->Generation = YuiMenuContext.ShortcutCacheGeneration;
+
+    if (CacheEntry->IconPath.LengthInChars == 0) {
+        return FALSE;
+    }
+
+    YoriLibCloneString(IconPath, &CacheEntry->IconPath);
+    *IconIndex = CacheEntry->IconIndex;
+    return TRUE;
+}
+
 /**
  Cleanup state associated with the menu module.
  */
 VOID
 YuiMenuCleanupContext(VOID)
 {
+    YuiMenuPruneShortcutCache(TRUE);
+
+    if (YuiMenuContext.ProgramNames != NULL) {
+        YoriLibFreeEmptyHashTable(YuiMenuContext.ProgramNames);
+        YuiMenuContext.ProgramNames = NULL;
+    }
+
     YuiMenuCleanupItem(&YuiMenuContext.Programs);
     YuiMenuCleanupItem(&YuiMenuContext.Seperator);
 
@@ -430,6 +697,7 @@ YuiMenuInitializeContext(
     YoriLibInitializeListHead(&YuiMenuContext.StartDirectory.ChildDirectories);
     YoriLibInitializeListHead(&YuiMenuContext.StartDirectory.ChildFiles);
     YuiMenuInitializeItem(&YuiMenuContext.StartDirectory.Item);
+    YoriLibInitializeListHead(&YuiMenuContext.ShortcutCacheList);
 
     YuiMenuInitializeItem(&YuiMenuContext.Seperator);
     YoriLibConstantString(&YuiMenuContext.Seperator.Text, _T(""));
@@ -754,6 +1022,9 @@ YuiDeleteMenuDirectory(
 
  @param FilePath Pointer to the full path to a shortcut file for this entry.
 
+ @param FileInfo Pointer to information about the shortcut file from the
+        directory enumeration.
+
  @param FriendlyName Pointer to the human readable name for the file.
 
  @param TallItem TRUE if the item should be a full height item, FALSE if the
@@ -765,6 +1036,7 @@ PYUI_MENU_FILE
 YuiCreateMenuFile(
     __in PYUI_CONTEXT YuiContext,
     __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
     __in PYORI_STRING FriendlyName,
     __in BOOLEAN TallItem
     )
@@ -784,6 +1056,7 @@ YuiCreateMenuFile(
     YoriLibInitializeListHead(&Entry->ListEntry);
     YoriLibInitEmptyString(&Entry->FilePath);
     YuiMenuInitializeItem(&Entry->Item);
+    ZeroMemory(&Entry->NameHashEntry, sizeof(Entry->NameHashEntry));
 
     //
     //  Even though no flyout is associated with a file, add one so the space
@@ -807,7 +1080,7 @@ YuiCreateMenuFile(
     memcpy(Entry->Item.Text.StartOfString, FriendlyName->StartOfString, FriendlyName->LengthInChars * sizeof(TCHAR));
     Entry->Item.Text.StartOfString[Entry->Item.Text.LengthInChars] = '\0';
 
-    if (YoriLibLoadShortcutIconPath(FilePath, &IconPath, &IconIndex)) {
+    if (YuiMenuGetShortcutIconPath(FilePath, FileInfo, &IconPath, &IconIndex)) {
         YORI_STRING Ext;
 
         YoriLibInitEmptyString(&Ext);
@@ -827,6 +1100,10 @@ YuiCreateMenuFile(
         YoriLibFreeStringContents(&IconPath);
     }
 
+    if (YuiMenuContext.ProgramNames != NULL) {
+        YoriLibHashInsertByKey(YuiMenuContext.ProgramNames, &Entry->Item.Text, Entry, &Entry->NameHashEntry);
+    }
+
     return Entry;
 }
 
@@ -848,6 +1125,10 @@ YuiDeleteMenuFile(
     UNREFERENCED_PARAMETER(Context);
     YoriLibRemoveListItem(&File->ListEntry);
 
+    if (File->NameHashEntry.Context != NULL) {
+        YoriLibHashRemoveByEntry(&File->NameHashEntry);
+    }
+
     YoriLibFreeStringContents(&File->FilePath);
     YuiMenuCleanupItem(&File->Item);
     YoriLibDereference(File);
@@ -1488,7 +1769,7 @@ YuiFileFoundCallback(
             if (YoriLibCompareStringWithLiteralInsensitive(&Ext, _T(".lnk")) == 0 &&
                 YuiFindDepthComponent(FilePath, &FriendlyName, 0, TRUE)) {
 
-                NewFile = YuiCreateMenuFile(YuiContext, FilePath, &FriendlyName, TRUE);
+                NewFile = YuiCreateMenuFile(YuiContext, FilePath, FileInfo, &FriendlyName, TRUE);
                 if (NewFile != NULL) {
                     NewFile->Depth = Depth + 1;
                     YuiInsertFileInOrder(&YuiMenuContext.StartDirectory, NewFile);
@@ -1529,7 +1810,7 @@ YuiFileFoundCallback(
         if (Parent != NULL &&
             YoriLibCompareStringWithLiteralInsensitive(&Ext, _T(".lnk")) == 0 &&
             YuiFindDepthComponent(FilePath, &FriendlyName, 0, TRUE)) {
-            NewFile = YuiCreateMenuFile(YuiContext, FilePath, &FriendlyName, FALSE);
+            NewFile = YuiCreateMenuFile(YuiContext, FilePath, FileInfo, &FriendlyName, FALSE);
             if (NewFile != NULL) {
                 NewFile->Depth = Depth + 1;
                 YuiInsertFileInOrder(Parent, NewFile);
@@ -1792,6 +2073,22 @@ YuiMenuPopulate(
     MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES;
     MatchFlags |= YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_PRESERVE_WILD;
 
+    //
+    //  Shortcuts that were parsed when the menu was previously populated
+    //  are reused if they have not changed, so a reload after a change
+    //  only needs to parse new or modified shortcuts.
+    //
+
+    if (YuiMenuContext.ShortcutCache == NULL) {
+        YuiMenuContext.ShortcutCache = YoriLibAllocateHashTable(YUI_MENU_SHORTCUT_CACHE_BUCKETS);
+    }
+    YuiMenuContext.ShortcutCacheGeneration++;
+    YoriLibInitializeShortcutSession(&YuiMenuContext.ShortcutSession);
+
+    if (YuiMenuContext.ProgramNames == NULL) {
+        YuiMenuContext.ProgramNames = YoriLibAllocateHashTable(YUI_MENU_PROGRAM_NAME_BUCKETS);
+    }
+
     //
     //  Load everything from the user's start menu directory, ignoring
     //  anything that's also under the programs directory.
@@ -1861,6 +2158,8 @@ YuiMenuPopulate(
                        YuiFileEnumerateErrorCallback,
                        YuiContext);
 
+    YoriLibCleanupShortcutSession(&YuiMenuContext.ShortcutSession);
+
     //
     //  Populate the menus with human readable strings from the entries we
     //  just loaded, and assign each menu an identifier that corresponds
@@ -1890,6 +2189,8 @@ YuiMenuPopulate(
                                         NULL,
                                         YuiPopulateMenuOnDirectory);
 
+    YuiMenuPruneShortcutCache(FALSE);
+
     YuiContext->SystemMenu = CreatePopupMenu();
     if (YuiContext->SystemMenu == NULL) {
         return FALSE;
@@ -2370,6 +2671,38 @@ YuiMenuRunBrowse(
     return GetOpenFileNameW(&ofn);
 }
 
+/**
+ Find a program in the start menu by its display name.
+
+ @param YuiContext Pointer to the application context.
+
+ @param Name Pointer to the name to find.
+
+ @return Pointer to the program, or NULL if no program has the name.  The
+         program remains valid until the start menu is next reloaded.
+ */
+PYUI_MENU_FILE
+YuiMenuFindProgramByName(
+    __in PYUI_CONTEXT YuiContext,
+    __in PCYORI_STRING Name
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+
+    YuiMenuWaitForBackgroundReload(YuiContext);
+
+    if (YuiMenuContext.ProgramNames == NULL) {
+        return NULL;
+    }
+
+    HashEntry = YoriLibHashLookupByKey(YuiMenuContext.ProgramNames, Name);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
 /**
  Context that is preserved from when the run dialog is initialized so long
  as it remains active.  Currently this just points to the global context.
@@ -2439,6 +2772,31 @@ RunDialogProc(
 
                                 Cmd.LengthInChars = (YORI_ALLOC_SIZE_T)GetDlgItemText(hDlg, IDC_RUNCMD, Cmd.StartOfString, Cmd.LengthAllocated);
 
+                                //
+                                //  If the command is the name of a program
+                                //  in the start menu, launch it the same way
+                                //  as the start menu would.
+                                //
+
+                                {
+                                    PYUI_MENU_FILE Program;
+                                    YORI_STRING Name;
+
+                                    YoriLibInitEmptyString(&Name);
+                                    Name.StartOfString = Cmd.StartOfString;
+                                    Name.LengthInChars = Cmd.LengthInChars;
+                                    YoriLibTrimSpaces(&Name);
+
+                                    Program = YuiMenuFindProgramByName(RunDlgContext->YuiContext, &Name);
+                                    if (Program != NULL &&
+                                        YuiExecuteShortcut(RunDlgContext, &Program->FilePath, FALSE)) {
+
+                                        YoriLibFreeStringContents(&Cmd);
+                                        EndDialog(hDlg, TRUE);
+                                        return TRUE;
+                                    }
+                                }
+
                                 ArgV = YoriLibCmdlineToArgcArgv(Cmd.StartOfString, 2, FALSE, &ArgC);
                                 if (ArgV != NULL) {
                                     ArgString = NULL;
@@ -1010,11 +1010,17 @@ YuiTaskbarNotifyNewWindow(
     YuiMonitor = YuiMonitorFromApplicationHwnd(YuiContext, hWnd);
     YuiTaskbarUpdateFullscreenStatus(YuiMonitor, hWnd);
 
+    //
+    //  If the window already has a button, the layout is unchanged.
+    //
+
     ThisButton = YuiTaskbarFindButtonFromHwndToActivate(YuiMonitor, hWnd);
     if (ThisButton == NULL) {
         if (!YuiTaskbarAllocateAndAddButton(YuiMonitor, hWnd)) {
             return;
         }
+    } else if (ThisButton->hWndButton != NULL) {
+        return;
     }
 
     YuiTaskbarRepositionExistingButtons(YuiMonitor);
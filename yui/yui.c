@@ -724,6 +724,147 @@ YuiDesktopWindowProc(
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
+/**
+ A callback invoked when a WinEvent hook observes a change to a window.
+ This is used to update the taskbar on systems which can't provide shell
+ hook messages.  Since these events are generated for all objects, events
+ are filtered to top level windows before updating taskbar buttons.
+
+ @param hWinEventHook The hook which observed the event.
+
+ @param Event The type of the event.
+
+ @param hWnd The window associated with the event.
+
+ @param idObject The object within the window associated with the event.
+
+ @param idChild The child of the object associated with the event.
+
+ @param dwEventThread The thread which generated the event.
+
+ @param dwmsEventTime The time the event was generated.
+ */
+VOID CALLBACK
+YuiTaskbarWinEventCallback(
+    __in HANDLE hWinEventHook,
+    __in DWORD Event,
+    __in HWND hWnd,
+    __in LONG idObject,
+    __in LONG idChild,
+    __in DWORD dwEventThread,
+    __in DWORD dwmsEventTime
+    )
+{
+    UNREFERENCED_PARAMETER(hWinEventHook);
+    UNREFERENCED_PARAMETER(dwEventThread);
+    UNREFERENCED_PARAMETER(dwmsEventTime);
+
+    if (hWnd == NULL ||
+        idObject != OBJID_WINDOW ||
+        idChild != CHILDID_SELF) {
+
+        return;
+    }
+
+    //
+    //  A destroyed window can't be queried, so look for it in the taskbar
+    //  regardless.  Other events are only interesting for top level
+    //  windows.
+    //
+
+    if (Event == EVENT_OBJECT_DESTROY) {
+        YuiTaskbarNotifyDestroyWindow(&YuiContext, hWnd);
+        return;
+    }
+
+    if (GetWindowLong(hWnd, GWL_STYLE) & WS_CHILD) {
+        return;
+    }
+
+    switch(Event) {
+        case EVENT_SYSTEM_FOREGROUND:
+            YuiTaskbarNotifyActivateWindow(&YuiContext, hWnd);
+            break;
+        case EVENT_OBJECT_SHOW:
+            YuiTaskbarNotifyNewWindow(&YuiContext, hWnd);
+            break;
+        case EVENT_OBJECT_HIDE:
+        case EVENT_OBJECT_NAMECHANGE:
+
+            //
+            //  This removes the button if the window is no longer eligible
+            //  for one.
+            //
+
+            YuiTaskbarNotifyTitleChange(&YuiContext, hWnd);
+            break;
+    }
+}
+
+/**
+ Remove any WinEvent hooks registered to monitor changes to windows.
+
+ @param Context Pointer to the application context.
+ */
+VOID
+YuiTaskbarUnregisterWinEventHooks(
+    __in PYUI_CONTEXT Context
+    )
+{
+    DWORD Count;
+
+    for (Count = 0; Count < sizeof(Context->WinEventHooks)/sizeof(Context->WinEventHooks[0]); Count++) {
+        if (Context->WinEventHooks[Count] != NULL) {
+            DllUser32.pUnhookWinEvent(Context->WinEventHooks[Count]);
+            Context->WinEventHooks[Count] = NULL;
+        }
+    }
+}
+
+/**
+ Register for WinEvent notifications describing changes to windows.  This is
+ used when shell hook messages are not available.
+
+ @param Context Pointer to the application context.
+
+ @return TRUE to indicate notifications were registered, FALSE if they were
+         not.
+ */
+BOOLEAN
+YuiTaskbarRegisterWinEventHooks(
+    __in PYUI_CONTEXT Context
+    )
+{
+    DWORD Count;
+    DWORD Flags;
+
+    if (DllUser32.pSetWinEventHook == NULL ||
+        DllUser32.pUnhookWinEvent == NULL) {
+
+        return FALSE;
+    }
+
+    //
+    //  Register for narrow ranges of events, since every event in a range
+    //  is delivered to this process, and some events such as location
+    //  changes are very frequent.
+    //
+
+    Flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+    Context->WinEventHooks[0] = DllUser32.pSetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL, YuiTaskbarWinEventCallback, 0, 0, Flags);
+    Context->WinEventHooks[1] = DllUser32.pSetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_HIDE, NULL, YuiTaskbarWinEventCallback, 0, 0, Flags);
+    Context->WinEventHooks[2] = DllUser32.pSetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, NULL, YuiTaskbarWinEventCallback, 0, 0, Flags);
+
+    for (Count = 0; Count < sizeof(Context->WinEventHooks)/sizeof(Context->WinEventHooks[0]); Count++) {
+        if (Context->WinEventHooks[Count] == NULL) {
+            YuiTaskbarUnregisterWinEventHooks(Context);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 /**
  The main window procedure which processes messages sent to the taskbar
  window.
@@ -1167,6 +1308,8 @@ YuiCleanupGlobalState(VOID)
         YuiContext.SyncTimerId = 0;
     }
 
+    YuiTaskbarUnregisterWinEventHooks(&YuiContext);
+
     YuiMonitor = NULL;
     YuiMonitor = YuiGetNextMonitor(&YuiContext, YuiMonitor);
     while (YuiMonitor != NULL) {
@@ -1643,18 +1786,36 @@ YuiInitializeApplication(
     //
 
     if (Context->TaskbarRefreshFrequency == 0 &&
-        (DllUser32.pRegisterShellHookWindow == NULL)) {
+        DllUser32.pRegisterShellHookWindow == NULL &&
+        DllUser32.pSetWinEventHook == NULL) {
 
         Context->TaskbarRefreshFrequency = 250;
     }
 
     //
-    //  If we support notifications, attempt to set them up.
+    //  If we support notifications, attempt to set them up.  Prefer shell
+    //  hook messages, which describe taskbar changes directly, and fall back
+    //  to WinEvent hooks, which describe changes to any window.
     //
 
     if (Context->TaskbarRefreshFrequency == 0) {
-        Context->ShellHookMsg = RegisterWindowMessage(_T("SHELLHOOK"));
-        if (!DllUser32.pRegisterShellHookWindow(hWnd)) {
+        BOOLEAN NotificationsRegistered;
+
+        NotificationsRegistered = FALSE;
+        if (DllUser32.pRegisterShellHookWindow != NULL) {
+            Context->ShellHookMsg = RegisterWindowMessage(_T("SHELLHOOK"));
+            if (DllUser32.pRegisterShellHookWindow(hWnd)) {
+                NotificationsRegistered = TRUE;
+            }
+        }
+
+        if (!NotificationsRegistered &&
+            YuiTaskbarRegisterWinEventHooks(Context)) {
+
+            NotificationsRegistered = TRUE;
+        }
+
+        if (!NotificationsRegistered) {
             Context->TaskbarRefreshFrequency = 250;
         }
     }
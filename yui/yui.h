@@ -520,6 +520,12 @@ typedef struct _YUI_CONTEXT {
      */
     DWORD ShellHookMsg;
 
+    /**
+     Handles to WinEvent hooks used to monitor window changes.  These are
+     only used when shell hook messages are not available.
+     */
+    HANDLE WinEventHooks[3];
+
     /**
      Handle to a background thread that is populating the start menu.
      */